@@ -0,0 +1,325 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Engine/CPUInstructionSet.h"
+#include "Engine/Timer.h"
+
+// The number of calls to run() in a sample is not increased beyond this
+#define NATRON_BENCHMARK_MAX_ITERATIONS (1 << 20)
+
+NATRON_NAMESPACE_ENTER
+
+Benchmark::Benchmark(const std::string& name)
+: _name(name)
+, _parameters()
+, _bytesProcessed(0)
+{
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+const std::string&
+Benchmark::getName() const
+{
+    return _name;
+}
+
+std::string
+Benchmark::getFullName() const
+{
+    std::string ret = _name;
+    for (ParametersList::const_iterator it = _parameters.begin(); it != _parameters.end(); ++it) {
+        ret += '/';
+        ret += it->second;
+    }
+    return ret;
+}
+
+void
+Benchmark::addParameter(const std::string& name,
+                        const std::string& value)
+{
+    _parameters.push_back( std::make_pair(name, value) );
+}
+
+void
+Benchmark::addParameter(const std::string& name,
+                        int value)
+{
+    std::stringstream ss;
+    ss << value;
+    addParameter( name, ss.str() );
+}
+
+const Benchmark::ParametersList&
+Benchmark::getParameters() const
+{
+    return _parameters;
+}
+
+void
+Benchmark::setBytesProcessed(double bytes)
+{
+    _bytesProcessed = bytes;
+}
+
+double
+Benchmark::getBytesProcessed() const
+{
+    return _bytesProcessed;
+}
+
+struct BenchmarkRunnerPrivate
+{
+    std::vector<BenchmarkPtr> benchmarks;
+    std::string filter;
+    int samplesCount;
+    double minSampleTime;
+    std::vector<BenchmarkRunner::Result> results;
+
+    BenchmarkRunnerPrivate()
+    : benchmarks()
+    , filter()
+    , samplesCount(9)
+    , minSampleTime(0.01)
+    , results()
+    {
+    }
+
+    bool passesFilter(const Benchmark& benchmark) const
+    {
+        return filter.empty() || benchmark.getFullName().find(filter) != std::string::npos;
+    }
+
+    void runBenchmark(Benchmark& benchmark, BenchmarkRunner::Result* result);
+};
+
+BenchmarkRunner::BenchmarkRunner()
+: _imp( new BenchmarkRunnerPrivate() )
+{
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+}
+
+void
+BenchmarkRunner::addBenchmark(const BenchmarkPtr& benchmark)
+{
+    _imp->benchmarks.push_back(benchmark);
+}
+
+void
+BenchmarkRunner::setFilter(const std::string& filter)
+{
+    _imp->filter = filter;
+}
+
+void
+BenchmarkRunner::setSamplesCount(int samples)
+{
+    _imp->samplesCount = std::max(1, samples);
+}
+
+void
+BenchmarkRunner::setMinSampleTime(double seconds)
+{
+    _imp->minSampleTime = seconds;
+}
+
+void
+BenchmarkRunner::list() const
+{
+    for (std::size_t i = 0; i < _imp->benchmarks.size(); ++i) {
+        if ( _imp->passesFilter(*_imp->benchmarks[i]) ) {
+            std::cout << _imp->benchmarks[i]->getFullName() << std::endl;
+        }
+    }
+}
+
+void
+BenchmarkRunnerPrivate::runBenchmark(Benchmark& benchmark,
+                                     BenchmarkRunner::Result* result)
+{
+    result->name = benchmark.getName();
+    result->fullName = benchmark.getFullName();
+    result->parameters = benchmark.getParameters();
+
+    if ( !benchmark.setUp() ) {
+        return;
+    }
+    result->ran = true;
+    result->bytesProcessed = benchmark.getBytesProcessed();
+
+    // Warm-up: the first call pays for the page faults of the buffers
+    benchmark.run();
+
+    TimeLapse timer;
+    int iterations = 1;
+    for (;;) {
+        timer.getTimeElapsedReset();
+        for (int i = 0; i < iterations; ++i) {
+            benchmark.run();
+        }
+        const double time = timer.getTimeElapsedReset();
+        if (time >= minSampleTime || iterations >= NATRON_BENCHMARK_MAX_ITERATIONS) {
+            break;
+        }
+        iterations *= 2;
+    }
+    result->iterations = iterations;
+
+    std::vector<double> times(samplesCount);
+    double totalTime = 0;
+    for (int s = 0; s < samplesCount; ++s) {
+        timer.getTimeElapsedReset();
+        for (int i = 0; i < iterations; ++i) {
+            benchmark.run();
+        }
+        times[s] = timer.getTimeElapsedReset() / iterations;
+        totalTime += times[s];
+    }
+    std::sort( times.begin(), times.end() );
+    result->minTime = times.front();
+    result->medianTime = times[times.size() / 2];
+    result->meanTime = totalTime / samplesCount;
+
+    benchmark.tearDown();
+} // runBenchmark
+
+int
+BenchmarkRunner::run()
+{
+    _imp->results.clear();
+    int count = 0;
+    for (std::size_t i = 0; i < _imp->benchmarks.size(); ++i) {
+        Benchmark& benchmark = *_imp->benchmarks[i];
+        if ( !_imp->passesFilter(benchmark) ) {
+            continue;
+        }
+        Result result;
+        _imp->runBenchmark(benchmark, &result);
+        _imp->results.push_back(result);
+        ++count;
+
+        std::cout << std::left << std::setw(56) << result.fullName << std::right;
+        if (!result.ran) {
+            std::cout << "skipped" << std::endl;
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(3)
+                  << std::setw(12) << result.medianTime * 1000. << " ms";
+        if ( (result.bytesProcessed > 0) && (result.medianTime > 0) ) {
+            std::cout << std::setw(10) << std::setprecision(2)
+                      << result.bytesProcessed / result.medianTime / 1e9 << " GB/s";
+        }
+        std::cout << std::endl;
+    }
+    return count;
+}
+
+const std::vector<BenchmarkRunner::Result>&
+BenchmarkRunner::getResults() const
+{
+    return _imp->results;
+}
+
+static std::string
+escapeJSON(const std::string& str)
+{
+    std::string ret;
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        const char c = str[i];
+        switch (c) {
+        case '"':
+            ret += "\\\"";
+            break;
+        case '\\':
+            ret += "\\\\";
+            break;
+        case '\n':
+            ret += "\\n";
+            break;
+        default:
+            if ( (unsigned char)c < 0x20 ) {
+                char buf[8];
+                std::sprintf(buf, "\\u%04x", (unsigned int)c);
+                ret += buf;
+            } else {
+                ret += c;
+            }
+            break;
+        }
+    }
+    return ret;
+}
+
+std::string
+BenchmarkRunner::getResultsJSON() const
+{
+    std::stringstream ss;
+    ss << std::setprecision(9);
+    ss << "{\n";
+    ss << "  \"version\": \"" << NATRON_VERSION_STRING << "\",\n";
+    ss << "  \"instructionSet\": \"" << escapeJSON( CPUInstructionSet::getInstructionSetName( CPUInstructionSet::getInstructionSet() ) ) << "\",\n";
+    ss << "  \"samples\": " << _imp->samplesCount << ",\n";
+    ss << "  \"minSampleTime\": " << _imp->minSampleTime << ",\n";
+    ss << "  \"benchmarks\": [";
+    for (std::size_t i = 0; i < _imp->results.size(); ++i) {
+        const Result& r = _imp->results[i];
+        ss << (i == 0 ? "\n" : ",\n");
+        ss << "    {\n";
+        ss << "      \"name\": \"" << escapeJSON(r.name) << "\",\n";
+        ss << "      \"fullName\": \"" << escapeJSON(r.fullName) << "\",\n";
+        ss << "      \"parameters\": {";
+        for (std::size_t p = 0; p < r.parameters.size(); ++p) {
+            ss << (p == 0 ? " " : ", ") << '"' << escapeJSON(r.parameters[p].first) << "\": \"" << escapeJSON(r.parameters[p].second) << '"';
+        }
+        ss << (r.parameters.empty() ? "},\n" : " },\n");
+        ss << "      \"ran\": " << (r.ran ? "true" : "false") << ",\n";
+        ss << "      \"iterations\": " << r.iterations << ",\n";
+        ss << "      \"minTime\": " << r.minTime << ",\n";
+        ss << "      \"medianTime\": " << r.medianTime << ",\n";
+        ss << "      \"meanTime\": " << r.meanTime << ",\n";
+        ss << "      \"bytesProcessed\": " << r.bytesProcessed << ",\n";
+        ss << "      \"bytesPerSecond\": " << ( (r.ran && r.medianTime > 0) ? r.bytesProcessed / r.medianTime : 0. ) << "\n";
+        ss << "    }";
+    }
+    ss << "\n  ]\n";
+    ss << "}\n";
+    return ss.str();
+} // getResultsJSON
+
+NATRON_NAMESPACE_EXIT
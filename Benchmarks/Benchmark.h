@@ -0,0 +1,215 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Benchmarks_Benchmark_h
+#define Benchmarks_Benchmark_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A microbenchmark of a kernel with a given set of parameters, e.g: the bit depth, the number of components
+ * and the size of the image. Its name followed by the values of its parameters identifies it in the results,
+ * e.g: "copyPixels/float/4/1024".
+ *
+ * setUp() allocates the buffers before the benchmark is timed and run() calls the kernel once.
+ * run() is called many times on the same buffers, so it must not depend on the result of the previous call.
+ **/
+class Benchmark
+{
+public:
+
+    typedef std::vector<std::pair<std::string, std::string> > ParametersList;
+
+    explicit Benchmark(const std::string& name);
+
+    virtual ~Benchmark();
+
+    const std::string& getName() const;
+
+    /**
+     * @brief Returns the name followed by the values of the parameters, separated by slashes
+     **/
+    std::string getFullName() const;
+
+    void addParameter(const std::string& name, const std::string& value);
+
+    void addParameter(const std::string& name, int value);
+
+    const ParametersList& getParameters() const;
+
+    /**
+     * @brief The number of bytes read and written by a call to run(), to compute the throughput
+     **/
+    void setBytesProcessed(double bytes);
+
+    double getBytesProcessed() const;
+
+    /**
+     * @brief Allocates and initializes the buffers. Returns false if the benchmark cannot run,
+     * e.g: if the kernel does not support the parameters.
+     **/
+    virtual bool setUp()
+    {
+        return true;
+    }
+
+    virtual void run() = 0;
+
+    virtual void tearDown()
+    {
+    }
+
+private:
+
+    std::string _name;
+    ParametersList _parameters;
+    double _bytesProcessed;
+};
+
+typedef boost::shared_ptr<Benchmark> BenchmarkPtr;
+
+struct BenchmarkRunnerPrivate;
+
+/**
+ * @brief Runs the benchmarks and reports their timings on the standard output and as JSON.
+ *
+ * Each benchmark is run once to warm up the caches, then the number of calls to run() in a sample is doubled
+ * until a sample lasts at least the minimum sample time, so that the timer resolution does not matter.
+ * The time of a call is measured on several samples, of which the minimum, median and mean are reported:
+ * the median is the most repeatable of them.
+ **/
+class BenchmarkRunner
+{
+public:
+
+    struct Result
+    {
+        std::string name;
+        std::string fullName;
+        Benchmark::ParametersList parameters;
+
+        // False if setUp() failed
+        bool ran;
+
+        // The number of calls to run() in each sample
+        int iterations;
+
+        // The time of a call to run(), in seconds
+        double minTime, medianTime, meanTime;
+
+        double bytesProcessed;
+
+        Result()
+        : name()
+        , fullName()
+        , parameters()
+        , ran(false)
+        , iterations(0)
+        , minTime(0)
+        , medianTime(0)
+        , meanTime(0)
+        , bytesProcessed(0)
+        {
+        }
+    };
+
+    BenchmarkRunner();
+
+    ~BenchmarkRunner();
+
+    void addBenchmark(const BenchmarkPtr& benchmark);
+
+    /**
+     * @brief Only the benchmarks whose full name contains the filter are run
+     **/
+    void setFilter(const std::string& filter);
+
+    /**
+     * @brief The number of samples of each benchmark. The default is 9.
+     **/
+    void setSamplesCount(int samples);
+
+    /**
+     * @brief The minimum time of a sample, in seconds. The default is 0.01.
+     **/
+    void setMinSampleTime(double seconds);
+
+    /**
+     * @brief Lists the full names of the benchmarks that pass the filter on the standard output
+     **/
+    void list() const;
+
+    /**
+     * @brief Runs the benchmarks that pass the filter and prints their median time as they complete.
+     * Returns the number of benchmarks that were run.
+     **/
+    int run();
+
+    const std::vector<Result>& getResults() const;
+
+    /**
+     * @brief Returns the results, the Natron version and the instruction set the kernels were bound to as JSON
+     **/
+    std::string getResultsJSON() const;
+
+private:
+
+    boost::scoped_ptr<BenchmarkRunnerPrivate> _imp;
+};
+
+/**
+ * @brief Returns a RAM image with a packed full rect layout of size x size pixels,
+ * filled with random values in [0, 1]. The values are the same for each call with the same arguments.
+ **/
+ImagePtr createRandomImage(ImageBitDepthEnum bitDepth, int nComps, int size);
+
+const char* getBitDepthName(ImageBitDepthEnum bitDepth);
+
+/**
+ * @brief The benchmarks of each module are added by their register function
+ **/
+void registerImageBenchmarks(BenchmarkRunner* runner);
+void registerLutBenchmarks(BenchmarkRunner* runner);
+void registerHistogramBenchmarks(BenchmarkRunner* runner);
+void registerTLSHolderBenchmarks(BenchmarkRunner* runner);
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Benchmarks_Benchmark_h
@@ -0,0 +1,666 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheStress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QProcess>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/CacheEntryBase.h"
+#include "Engine/CacheEntryKeyBase.h"
+#include "Engine/Hash64.h"
+#include "Engine/ImageTilesState.h"
+#include "Engine/Timer.h"
+
+// The unique ID of the keys of the entries of the stress test, which no other kind of entry uses
+#define kCacheKeyUniqueIDCacheStress 100
+
+// The line printed by a worker process with its results
+#define NATRON_CACHE_STRESS_RESULT_PREFIX "CACHE_STRESS_RESULT"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class CacheStressKey
+    : public CacheEntryKeyBase
+{
+public:
+
+    explicit CacheStressKey(U64 id)
+    : CacheEntryKeyBase("CacheStress")
+    , _id(id)
+    {
+    }
+
+    virtual ~CacheStressKey()
+    {
+    }
+
+    virtual int getUniqueID() const OVERRIDE FINAL
+    {
+        return kCacheKeyUniqueIDCacheStress;
+    }
+
+    virtual void toMemorySegment(IPCPropertyMap* properties) const OVERRIDE FINAL
+    {
+        properties->setIPCProperty("StressID", _id);
+        CacheEntryKeyBase::toMemorySegment(properties);
+    }
+
+    virtual CacheEntryKeyBase::FromMemorySegmentRetCodeEnum fromMemorySegment(const IPCPropertyMap& properties) OVERRIDE FINAL
+    {
+        if ( !properties.getIPCProperty("StressID", 0, &_id) ) {
+            return eFromMemorySegmentRetCodeFailed;
+        }
+        return CacheEntryKeyBase::fromMemorySegment(properties);
+    }
+
+private:
+
+    virtual void appendToHash(Hash64* hash) const OVERRIDE FINAL
+    {
+        hash->append(_id);
+    }
+
+    U64 _id;
+};
+
+CacheEntryBasePtr
+createStressEntry(const CacheBasePtr& cache,
+                  U64 id)
+{
+    CacheEntryBasePtr entry = boost::make_shared<CacheEntryBase>(cache);
+    entry->setKey( boost::make_shared<CacheStressKey>(id) );
+    return entry;
+}
+
+int
+getLatencyBucket(double seconds)
+{
+    const double us = seconds * 1e6;
+    if (us < 1.) {
+        return 0;
+    }
+    const int bucket = 1 + (int)(4. * std::log(us) / std::log(2.));
+    return std::min(bucket, NATRON_CACHE_STRESS_LATENCY_BUCKETS - 1);
+}
+
+// A xorshift generator: rand() is not thread-safe
+class StressRandom
+{
+public:
+
+    explicit StressRandom(U64 seed)
+    : _state(seed ? seed : 0x9E3779B97F4A7C15ULL)
+    {
+    }
+
+    U64 next()
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return _state;
+    }
+
+private:
+
+    U64 _state;
+};
+
+class CacheStressThread
+    : public QThread
+{
+public:
+
+    CacheStressThread(const CacheBasePtr& cache,
+                      const CacheStress::Options& options,
+                      U64 seed)
+    : QThread()
+    , _cache(cache)
+    , _options(options)
+    , _random(seed)
+    , _results()
+    , _checksum(0)
+    {
+    }
+
+    virtual ~CacheStressThread()
+    {
+    }
+
+    const CacheStress::Results& getResults() const
+    {
+        return _results;
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        TimeLapse clock;
+        TimeLapse opTimer;
+        while (clock.getTimeSinceCreation() < _options.duration) {
+            const U64 r = _random.next();
+            const int op = (int)(r % 100);
+            const U64 id = (r >> 8) % (U64)_options.keysCount;
+
+            opTimer.getTimeElapsedReset();
+            if (op < _options.removePercent) {
+                _cache->removeEntry( createStressEntry(_cache, id) );
+                ++_results.removesCount;
+            } else if (op < _options.removePercent + _options.evictPercent) {
+                _cache->evictLRUEntries(_options.tilesPerEntry * _cache->getTileSizeBytes());
+                ++_results.evictionsCount;
+            } else {
+                lookup(id);
+            }
+            ++_results.latencyHistogram[getLatencyBucket( opTimer.getTimeElapsedReset() )];
+            ++_results.operationsCount;
+        }
+    }
+
+    void lookup(U64 id)
+    {
+        CacheEntryBasePtr entry = createStressEntry(_cache, id);
+        CacheEntryLockerBasePtr locker = _cache->get(entry);
+        CacheEntryLockerBase::CacheEntryStatusEnum status = locker->getStatus();
+        if (status == CacheEntryLockerBase::eCacheEntryStatusComputationPending) {
+            ++_results.pendingWaitsCount;
+            TimeLapse waitTimer;
+            status = locker->waitForPendingEntry(_options.pendingWaitTimeoutMS);
+            if ( (status != CacheEntryLockerBase::eCacheEntryStatusCached) &&
+                 (waitTimer.getTimeSinceCreation() * 1000. >= (double)_options.pendingWaitTimeoutMS) ) {
+                ++_results.pendingWaitTimeoutsCount;
+            }
+        }
+        switch (status) {
+        case CacheEntryLockerBase::eCacheEntryStatusCached:
+            ++_results.hitsCount;
+            break;
+        case CacheEntryLockerBase::eCacheEntryStatusMustCompute:
+            ++_results.missesCount;
+            // The entry must be in the cache for its tiles to be allocated
+            locker->insertInCache();
+            writeTiles( locker->getProcessLocalEntry(), id );
+            break;
+        case CacheEntryLockerBase::eCacheEntryStatusComputationPending:
+            break;
+        }
+    }
+
+    void writeTiles(const CacheEntryBasePtr& entry,
+                    U64 id)
+    {
+        if (_options.tilesPerEntry <= 0) {
+            return;
+        }
+        const std::size_t tileSizeBytes = _cache->getTileSizeBytes();
+
+#ifdef NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED
+        std::size_t tilesToAlloc = _options.tilesPerEntry;
+#else
+        const U64 entryHash = entry->getKey()->getHashKey();
+        std::vector<TileHash> tilesToAllocVec(_options.tilesPerEntry);
+        for (int i = 0; i < _options.tilesPerEntry; ++i) {
+            tilesToAllocVec[i] = CacheBase::makeTileCacheIndex(i, 0, 0, 0, entryHash);
+        }
+        const std::vector<TileHash>* tilesToAlloc = &tilesToAllocVec;
+#endif
+
+        std::vector<std::pair<TileInternalIndex, void*> > allocatedTiles;
+        void* cacheData = 0;
+        bool gotTiles = _cache->retrieveAndLockTiles(entry, 0 /*existingTiles*/, tilesToAlloc, 0 /*evictedTilesElementSize*/,
+                                                     0 /*existingTilesData*/, &allocatedTiles, &cacheData);
+        std::vector<TileInternalIndex> tileIndices;
+        if ( gotTiles && ( allocatedTiles.size() == (std::size_t)_options.tilesPerEntry ) ) {
+            for (std::size_t i = 0; i < allocatedTiles.size(); ++i) {
+                std::memset(allocatedTiles[i].second, (int)(id & 0xff), tileSizeBytes);
+                tileIndices.push_back(allocatedTiles[i].first);
+            }
+        }
+        _cache->unLockTiles(cacheData, false);
+        if ( tileIndices.empty() ) {
+            ++_results.tileFailuresCount;
+            return;
+        }
+
+        // Read the tiles back, as a render that finds them in the cache. The entry may have been removed in the meantime.
+        std::vector<void*> existingTiles;
+        gotTiles = _cache->retrieveAndLockTiles(entry, &tileIndices, 0 /*tilesToAlloc*/, 0 /*evictedTilesElementSize*/,
+                                                &existingTiles, 0 /*allocatedTilesData*/, &cacheData);
+        if (gotTiles) {
+            for (std::size_t i = 0; i < existingTiles.size(); ++i) {
+                if (existingTiles[i]) {
+                    _checksum += *(const unsigned char*)existingTiles[i];
+                } else {
+                    ++_results.tileFailuresCount;
+                }
+            }
+        } else {
+            ++_results.tileFailuresCount;
+        }
+        _cache->unLockTiles(cacheData, false);
+    } // writeTiles
+
+    CacheBasePtr _cache;
+    CacheStress::Options _options;
+    StressRandom _random;
+    CacheStress::Results _results;
+
+    // Keeps the reads of the tiles from being optimized out
+    volatile unsigned int _checksum;
+};
+
+typedef boost::shared_ptr<CacheStressThread> CacheStressThreadPtr;
+
+// Parses the options of --cache-stress and --cache-stress-worker, starting after the mode option
+bool
+parseOptions(int argc,
+             char* argv[],
+             CacheStress::Options* options,
+             std::string* caches,
+             std::string* outputFile)
+{
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Unknown option or missing value: " << arg << std::endl;
+
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--threads") {
+            options->threadsCount = std::max(1, std::atoi(value));
+        } else if (arg == "--processes") {
+            options->processesCount = std::max(0, std::atoi(value));
+        } else if (arg == "--duration") {
+            options->duration = std::atof(value);
+        } else if (arg == "--keys") {
+            options->keysCount = std::max(1, std::atoi(value));
+        } else if (arg == "--tiles-per-entry") {
+            options->tilesPerEntry = std::max(0, std::atoi(value));
+        } else if (arg == "--remove-percent") {
+            options->removePercent = std::max(0, std::atoi(value));
+        } else if (arg == "--evict-percent") {
+            options->evictPercent = std::max(0, std::atoi(value));
+        } else if (arg == "--pending-wait-timeout") {
+            options->pendingWaitTimeoutMS = (std::size_t)std::max(1, std::atoi(value));
+        } else if (arg == "--cache-size") {
+            options->cacheSize = (std::size_t)std::max(1, std::atoi(value)) * 1024 * 1024;
+        } else if ( (arg == "--cache") && caches ) {
+            *caches = value;
+        } else if ( (arg == "--output") && outputFile ) {
+            *outputFile = value;
+        } else {
+            std::cerr << "Unknown option or missing value: " << arg << std::endl;
+
+            return false;
+        }
+    }
+    return true;
+} // parseOptions
+
+QStringList
+makeWorkerArgs(const CacheStress::Options& options)
+{
+    QStringList args;
+    args << QString::fromUtf8("--cache-stress-worker");
+    args << QString::fromUtf8("--threads") << QString::number(options.threadsCount);
+    args << QString::fromUtf8("--duration") << QString::number(options.duration);
+    args << QString::fromUtf8("--keys") << QString::number(options.keysCount);
+    args << QString::fromUtf8("--tiles-per-entry") << QString::number(options.tilesPerEntry);
+    args << QString::fromUtf8("--remove-percent") << QString::number(options.removePercent);
+    args << QString::fromUtf8("--evict-percent") << QString::number(options.evictPercent);
+    args << QString::fromUtf8("--pending-wait-timeout") << QString::number( (qulonglong)options.pendingWaitTimeoutMS );
+    args << QString::fromUtf8("--cache-size") << QString::number( (qulonglong)(options.cacheSize / (1024 * 1024)) );
+    return args;
+}
+
+void
+printResults(const CacheStress::Results& r)
+{
+    std::cout << r.cacheName << " cache (" << (r.persistent ? "Cache<true>" : "Cache<false>") << "), "
+              << r.processesCount << " process(es):" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "  operations: " << r.operationsCount
+              << " (" << (r.duration > 0 ? r.operationsCount / r.duration : 0.) << "/s)" << std::endl
+              << "  hits: " << r.hitsCount << ", misses: " << r.missesCount
+              << ", removes: " << r.removesCount << ", evictions: " << r.evictionsCount << std::endl
+              << "  pending waits: " << r.pendingWaitsCount << ", timed out: " << r.pendingWaitTimeoutsCount << std::endl
+              << "  lock timeouts: " << r.lockTimeoutsCount << ", tile failures: " << r.tileFailuresCount << std::endl
+              << std::setprecision(3)
+              << "  latency (ms): p50 " << r.getLatencyPercentile(50) * 1000.
+              << ", p99 " << r.getLatencyPercentile(99) * 1000.
+              << ", p99.9 " << r.getLatencyPercentile(99.9) * 1000.
+              << ", max " << r.getLatencyPercentile(100) * 1000. << std::endl;
+}
+
+std::string
+getResultsJSON(const std::vector<CacheStress::Results>& results,
+               const CacheStress::Options& options)
+{
+    std::stringstream ss;
+    ss << std::setprecision(9);
+    ss << "{\n";
+    ss << "  \"version\": \"" << NATRON_VERSION_STRING << "\",\n";
+    ss << "  \"threads\": " << options.threadsCount << ",\n";
+    ss << "  \"duration\": " << options.duration << ",\n";
+    ss << "  \"keys\": " << options.keysCount << ",\n";
+    ss << "  \"tilesPerEntry\": " << options.tilesPerEntry << ",\n";
+    ss << "  \"removePercent\": " << options.removePercent << ",\n";
+    ss << "  \"evictPercent\": " << options.evictPercent << ",\n";
+    ss << "  \"pendingWaitTimeoutMS\": " << options.pendingWaitTimeoutMS << ",\n";
+    ss << "  \"cacheSize\": " << options.cacheSize << ",\n";
+    ss << "  \"caches\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const CacheStress::Results& r = results[i];
+        ss << (i == 0 ? "\n" : ",\n");
+        ss << "    {\n";
+        ss << "      \"name\": \"" << r.cacheName << "\",\n";
+        ss << "      \"persistent\": " << (r.persistent ? "true" : "false") << ",\n";
+        ss << "      \"processes\": " << r.processesCount << ",\n";
+        ss << "      \"operations\": " << r.operationsCount << ",\n";
+        ss << "      \"operationsPerSecond\": " << (r.duration > 0 ? r.operationsCount / r.duration : 0.) << ",\n";
+        ss << "      \"hits\": " << r.hitsCount << ",\n";
+        ss << "      \"misses\": " << r.missesCount << ",\n";
+        ss << "      \"removes\": " << r.removesCount << ",\n";
+        ss << "      \"evictions\": " << r.evictionsCount << ",\n";
+        ss << "      \"pendingWaits\": " << r.pendingWaitsCount << ",\n";
+        ss << "      \"pendingWaitTimeouts\": " << r.pendingWaitTimeoutsCount << ",\n";
+        ss << "      \"lockTimeouts\": " << r.lockTimeoutsCount << ",\n";
+        ss << "      \"tileFailures\": " << r.tileFailuresCount << ",\n";
+        ss << "      \"latencyP50\": " << r.getLatencyPercentile(50) << ",\n";
+        ss << "      \"latencyP99\": " << r.getLatencyPercentile(99) << ",\n";
+        ss << "      \"latencyP999\": " << r.getLatencyPercentile(99.9) << ",\n";
+        ss << "      \"latencyMax\": " << r.getLatencyPercentile(100) << "\n";
+        ss << "    }";
+    }
+    ss << "\n  ]\n";
+    ss << "}\n";
+    return ss.str();
+} // getResultsJSON
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+CacheStress::Options::Options()
+: threadsCount(8)
+, processesCount(0)
+, duration(5.)
+, keysCount(1024)
+, tilesPerEntry(4)
+, removePercent(5)
+, evictPercent(5)
+, pendingWaitTimeoutMS(1000)
+, cacheSize( (std::size_t)256 * 1024 * 1024 )
+{
+}
+
+CacheStress::Results::Results()
+: cacheName()
+, persistent(false)
+, processesCount(1)
+, duration(0)
+, operationsCount(0)
+, hitsCount(0)
+, missesCount(0)
+, removesCount(0)
+, evictionsCount(0)
+, pendingWaitsCount(0)
+, pendingWaitTimeoutsCount(0)
+, tileFailuresCount(0)
+, lockTimeoutsCount(0)
+, latencyHistogram(NATRON_CACHE_STRESS_LATENCY_BUCKETS, 0)
+{
+}
+
+void
+CacheStress::Results::add(const Results& other)
+{
+    operationsCount += other.operationsCount;
+    hitsCount += other.hitsCount;
+    missesCount += other.missesCount;
+    removesCount += other.removesCount;
+    evictionsCount += other.evictionsCount;
+    pendingWaitsCount += other.pendingWaitsCount;
+    pendingWaitTimeoutsCount += other.pendingWaitTimeoutsCount;
+    tileFailuresCount += other.tileFailuresCount;
+    lockTimeoutsCount += other.lockTimeoutsCount;
+    for (std::size_t i = 0; i < latencyHistogram.size() && i < other.latencyHistogram.size(); ++i) {
+        latencyHistogram[i] += other.latencyHistogram[i];
+    }
+}
+
+double
+CacheStress::Results::getLatencyPercentile(double percent) const
+{
+    U64 total = 0;
+    for (std::size_t i = 0; i < latencyHistogram.size(); ++i) {
+        total += latencyHistogram[i];
+    }
+    if (total == 0) {
+        return 0.;
+    }
+    const double threshold = total * percent / 100.;
+    U64 count = 0;
+    for (std::size_t i = 0; i < latencyHistogram.size(); ++i) {
+        count += latencyHistogram[i];
+        if ( (count > 0) && (count >= threshold) ) {
+            // The upper bound of the bucket
+            return std::pow(2., i / 4.) * 1e-6;
+        }
+    }
+    return std::pow(2., (latencyHistogram.size() - 1) / 4.) * 1e-6;
+}
+
+std::string
+CacheStress::Results::toLine() const
+{
+    std::stringstream ss;
+    ss << NATRON_CACHE_STRESS_RESULT_PREFIX << ' ' << (persistent ? 1 : 0) << ' ' << operationsCount << ' ' << hitsCount << ' ' << missesCount
+       << ' ' << removesCount << ' ' << evictionsCount << ' ' << pendingWaitsCount << ' ' << pendingWaitTimeoutsCount
+       << ' ' << tileFailuresCount << ' ' << lockTimeoutsCount;
+    for (std::size_t i = 0; i < latencyHistogram.size(); ++i) {
+        ss << ' ' << latencyHistogram[i];
+    }
+    return ss.str();
+}
+
+bool
+CacheStress::Results::fromLine(const std::string& line)
+{
+    std::stringstream ss(line);
+    std::string prefix;
+    int isPersistent;
+    ss >> prefix >> isPersistent >> operationsCount >> hitsCount >> missesCount >> removesCount >> evictionsCount
+    >> pendingWaitsCount >> pendingWaitTimeoutsCount >> tileFailuresCount >> lockTimeoutsCount;
+    persistent = (isPersistent != 0);
+    for (std::size_t i = 0; i < latencyHistogram.size(); ++i) {
+        ss >> latencyHistogram[i];
+    }
+    return (prefix == NATRON_CACHE_STRESS_RESULT_PREFIX) && !ss.fail();
+}
+
+void
+CacheStress::run(const CacheBasePtr& cache,
+                 const Options& options,
+                 Results* results)
+{
+    results->persistent = cache->isPersistent();
+    results->duration = options.duration;
+
+    const std::size_t previousMaximumSize = cache->getMaximumCacheSize();
+    cache->setMaximumCacheSize(options.cacheSize);
+    const U64 previousRecoveries = cache->getInconsistentStateRecoveriesCount();
+
+    const U64 pid = (U64)QCoreApplication::applicationPid();
+    std::vector<CacheStressThreadPtr> threads;
+    for (int i = 0; i < options.threadsCount; ++i) {
+        threads.push_back( boost::make_shared<CacheStressThread>(cache, options, (pid << 16) + i + 1) );
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->start();
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->wait();
+        results->add( threads[i]->getResults() );
+    }
+
+    results->lockTimeoutsCount += cache->getInconsistentStateRecoveriesCount() - previousRecoveries;
+    cache->setMaximumCacheSize(previousMaximumSize);
+}
+
+int
+CacheStress::main(int argc,
+                  char* argv[])
+{
+    Options options;
+    std::string caches = "all";
+    std::string outputFile;
+    if ( !parseOptions(argc, argv, &options, &caches, &outputFile) ) {
+        return 1;
+    }
+    if ( (caches != "all") && (caches != "local") && (caches != "persistent") ) {
+        std::cerr << "Unknown cache: " << caches << ", expected local, persistent or all" << std::endl;
+
+        return 1;
+    }
+
+    std::vector<Results> allResults;
+    const CacheBasePtr tileCache = appPTR->getTileCache();
+
+    if ( (caches == "all") || (caches == "local") ) {
+        // A process-local cache with the same tiles as the tile cache: the worker processes cannot use it
+        CacheBasePtr localCache = Cache<false>::create(true /*enableTileStorage*/, tileCache->getTileSizePo2());
+        Results results;
+        results.cacheName = "local";
+        run(localCache, options, &results);
+        printResults(results);
+        allResults.push_back(results);
+    }
+
+    if ( (caches == "all") || (caches == "persistent") ) {
+        if ( !tileCache->isPersistent() ) {
+            std::cerr << "The persistent cache is used by another process, it is not stressed" << std::endl;
+        } else {
+            // The worker processes start with this process and work on the same keys
+            const QString program = QString::fromLocal8Bit(argv[0]);
+            const QStringList workerArgs = makeWorkerArgs(options);
+            std::vector<boost::shared_ptr<QProcess> > processes;
+            for (int i = 0; i < options.processesCount; ++i) {
+                boost::shared_ptr<QProcess> process = boost::make_shared<QProcess>();
+                process->setProcessChannelMode(QProcess::SeparateChannels);
+                process->start(program, workerArgs);
+                processes.push_back(process);
+            }
+
+            Results results;
+            results.cacheName = "persistent";
+            run(tileCache, options, &results);
+
+            for (std::size_t i = 0; i < processes.size(); ++i) {
+                QProcess& process = *processes[i];
+                process.waitForFinished(-1);
+                Results workerResults;
+                bool gotResults = false;
+                const QStringList lines = QString::fromUtf8( process.readAllStandardOutput() ).split( QLatin1Char('\n') );
+                for (int l = 0; l < lines.size(); ++l) {
+                    if ( lines[l].startsWith( QString::fromUtf8(NATRON_CACHE_STRESS_RESULT_PREFIX) ) ) {
+                        gotResults = workerResults.fromLine( lines[l].toStdString() );
+                    }
+                }
+                if (!gotResults) {
+                    std::cerr << "Worker process " << i + 1 << " failed:" << std::endl;
+                    std::cerr << QString::fromUtf8( process.readAllStandardError() ).toStdString() << std::endl;
+                    continue;
+                }
+                if (!workerResults.persistent) {
+                    std::cerr << "Worker process " << i + 1 << " could not share the persistent cache, "
+                              << "Natron is not built with NATRON_CACHE_INTERPROCESS_ROBUST" << std::endl;
+                    continue;
+                }
+                results.add(workerResults);
+                ++results.processesCount;
+            }
+            printResults(results);
+            allResults.push_back(results);
+
+            // Do not leave the entries of the stress test in the cache of the user
+            for (int i = 0; i < options.keysCount; ++i) {
+                tileCache->removeEntry( createStressEntry(tileCache, i) );
+            }
+        }
+    }
+
+    if ( !outputFile.empty() ) {
+        std::ofstream ofile( outputFile.c_str() );
+        if ( !ofile.good() ) {
+            std::cerr << "Failed to write " << outputFile << std::endl;
+
+            return 1;
+        }
+        ofile << getResultsJSON(allResults, options);
+    }
+
+    return 0;
+} // main
+
+int
+CacheStress::workerMain(int argc,
+                        char* argv[])
+{
+    Options options;
+    if ( !parseOptions(argc, argv, &options, 0, 0) ) {
+        return 1;
+    }
+
+    // This is the persistent cache if it can be shared with the other processes, which is reported in the results
+    Results results;
+    run(appPTR->getTileCache(), options, &results);
+    std::cout << results.toLine() << std::endl;
+
+    return 0;
+}
+
+NATRON_NAMESPACE_EXIT
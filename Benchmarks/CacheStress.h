@@ -0,0 +1,150 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Benchmarks_CacheStress_h
+#define Benchmarks_CacheStress_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+// The latencies are counted in buckets of a quarter of a power of 2 microseconds, up to about 2^32 us
+#define NATRON_CACHE_STRESS_LATENCY_BUCKETS 128
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A load test of the caches: threads, and optionally other processes, look up, insert, remove and evict
+ * entries of a small set of keys at the same time, so that they contend on the bucket mutexes, wait for the entries
+ * pending in other threads and processes and lock the tiles storage.
+ *
+ * Each look-up that misses inserts the entry and allocates, writes and reads back its tiles with retrieveAndLockTiles().
+ * The entries are evicted when the cache exceeds its maximum size.
+ *
+ * The processes are NatronBenchmarks processes started with --cache-stress-worker that work on the same keys.
+ * They share the persistent cache, Cache<true>, with this process if Natron is built with NATRON_CACHE_INTERPROCESS_ROBUST.
+ * Otherwise they use a process-local cache and only the threads of a process contend.
+ **/
+class CacheStress
+{
+public:
+
+    struct Options
+    {
+        int threadsCount;
+        int processesCount;
+
+        // In seconds
+        double duration;
+
+        // The number of distinct entries
+        int keysCount;
+
+        int tilesPerEntry;
+
+        // The percentages of the operations that remove an entry and that evict the least recently used entries,
+        // the others are look-ups
+        int removePercent;
+        int evictPercent;
+
+        // How long a thread waits for an entry pending in another thread before computing it itself
+        std::size_t pendingWaitTimeoutMS;
+
+        // The maximum size of the cache, in bytes
+        std::size_t cacheSize;
+
+        Options();
+    };
+
+    struct Results
+    {
+        std::string cacheName;
+        bool persistent;
+
+        // The number of processes that ran the workload, including this one
+        int processesCount;
+        double duration;
+
+        U64 operationsCount;
+        U64 hitsCount;
+        U64 missesCount;
+        U64 removesCount;
+        U64 evictionsCount;
+        U64 pendingWaitsCount;
+        U64 pendingWaitTimeoutsCount;
+
+        // The tiles that could not be allocated or retrieved
+        U64 tileFailuresCount;
+
+        // How many times a lock could not be taken before NATRON_CACHE_INTERPROCESS_MUTEX_TIMEOUT_MS
+        // or the cache was found corrupted, see CacheBase::getInconsistentStateRecoveriesCount()
+        U64 lockTimeoutsCount;
+
+        // The number of operations per latency bucket, see getLatencyPercentile()
+        std::vector<U64> latencyHistogram;
+
+        Results();
+
+        void add(const Results& other);
+
+        /**
+         * @brief Returns the upper bound of the latency in seconds below which are the given percentage of the operations
+         **/
+        double getLatencyPercentile(double percent) const;
+
+        /**
+         * @brief Serializes the counters and the latency histogram to a line of text, to report them from a worker process
+         **/
+        std::string toLine() const;
+
+        bool fromLine(const std::string& line);
+    };
+
+    /**
+     * @brief Runs the workload with the threads of this process only
+     **/
+    static void run(const CacheBasePtr& cache, const Options& options, Results* results);
+
+    /**
+     * @brief Parses the options of --cache-stress and runs the workload on the local cache and the persistent cache
+     * with the worker processes, then prints the results. Returns the exit code of the program.
+     **/
+    static int main(int argc, char* argv[]);
+
+    /**
+     * @brief The entry point of a worker process started with --cache-stress-worker
+     **/
+    static int workerMain(int argc, char* argv[]);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Benchmarks_CacheStress_h
@@ -0,0 +1,108 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Benchmark.h"
+
+#include <vector>
+
+#include <boost/make_shared.hpp>
+
+#include "Engine/HistogramCPU.h"
+#include "Engine/Image.h"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Computes the histograms of a float image as the viewer does, with 256 bins upscaled 5 times
+ * before smoothing. The histogram kernel only reads float images.
+ **/
+class HistogramBenchmark
+    : public Benchmark
+{
+public:
+
+    HistogramBenchmark(int mode,
+                       int nComps,
+                       int size)
+    : Benchmark("histogram")
+    , _mode(mode)
+    , _nComps(nComps)
+    , _size(size)
+    , _image()
+    {
+        // keep in sync with Histogram::DisplayModeEnum
+        addParameter("mode", mode == 0 ? "RGB" : "Y");
+        addParameter("components", nComps);
+        addParameter("size", size);
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        _image = createRandomImage(eImageBitDepthFloat, _nComps, _size);
+        setBytesProcessed( (double)_size * _size * _nComps * sizeof(float) );
+        return (bool)_image;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        std::vector<unsigned int> bins[3];
+        HistogramCPUThread::computeBins(_image, _image->getBounds(), _mode, 256 * 5, 0., 1., bins);
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        _image.reset();
+    }
+
+private:
+
+    int _mode;
+    int _nComps;
+    int _size;
+    ImagePtr _image;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+registerHistogramBenchmarks(BenchmarkRunner* runner)
+{
+    // RGB computes 3 histograms in a single pass, Y a single one
+    const int modes[2] = { 0, 2 };
+    const int nComps[3] = { 1, 3, 4 };
+    const int sizes[3] = { 256, 1024, 2048 };
+
+    for (int m = 0; m < 2; ++m) {
+        for (int c = 0; c < 3; ++c) {
+            for (int s = 0; s < 3; ++s) {
+                runner->addBenchmark( boost::make_shared<HistogramBenchmark>(modes[m], nComps[c], sizes[s]) );
+            }
+        }
+    }
+}
+
+NATRON_NAMESPACE_EXIT
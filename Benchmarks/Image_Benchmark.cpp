@@ -0,0 +1,566 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Benchmark.h"
+
+#include <bitset>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+
+#include "Engine/CacheEntryBase.h"
+#include "Engine/Half.h"
+#include "Engine/Image.h"
+#include "Engine/ImagePlaneDesc.h"
+
+NATRON_NAMESPACE_ENTER
+
+static const ImageBitDepthEnum benchmarkBitDepths[4] = { eImageBitDepthByte, eImageBitDepthShort, eImageBitDepthHalf, eImageBitDepthFloat };
+static const int benchmarkNComps[3] = { 1, 3, 4 };
+static const int benchmarkSizes[3] = { 256, 1024, 2048 };
+
+const char*
+getBitDepthName(ImageBitDepthEnum bitDepth)
+{
+    switch (bitDepth) {
+    case eImageBitDepthByte:
+        return "byte";
+    case eImageBitDepthShort:
+        return "short";
+    case eImageBitDepthHalf:
+        return "half";
+    case eImageBitDepthFloat:
+        return "float";
+    case eImageBitDepthNone:
+        break;
+    }
+    return "none";
+}
+
+static const ImagePlaneDesc&
+getPlaneForNComps(int nComps)
+{
+    switch (nComps) {
+    case 1:
+        return ImagePlaneDesc::getAlphaComponents();
+    case 2:
+        return ImagePlaneDesc::getXYComponents();
+    case 3:
+        return ImagePlaneDesc::getRGBComponents();
+    default:
+        return ImagePlaneDesc::getRGBAComponents();
+    }
+}
+
+static ImagePtr
+createImage(ImageBitDepthEnum bitDepth,
+            int nComps,
+            int size)
+{
+    Image::InitStorageArgs initArgs;
+    initArgs.bounds.set(0, 0, size, size);
+    initArgs.bitdepth = bitDepth;
+    initArgs.plane = getPlaneForNComps(nComps);
+    initArgs.bufferFormat = eImageBufferLayoutRGBAPackedFullRect;
+    initArgs.storage = eStorageModeRAM;
+    return Image::create(initArgs);
+}
+
+ImagePtr
+createRandomImage(ImageBitDepthEnum bitDepth,
+                  int nComps,
+                  int size)
+{
+    // The random values are generated in float and converted to the bit depth
+    ImagePtr floatImage = createImage(eImageBitDepthFloat, nComps, size);
+    if (!floatImage) {
+        return ImagePtr();
+    }
+    Image::CPUData data;
+    floatImage->getCPUData(&data);
+    float* pix = (float*)data.ptrs[0];
+    const std::size_t nValues = (std::size_t)size * size * nComps;
+    srand(size * 4 + nComps);
+    for (std::size_t i = 0; i < nValues; ++i) {
+        // coverity[dont_call]
+        pix[i] = rand() / (float)RAND_MAX;
+    }
+    if (bitDepth == eImageBitDepthFloat) {
+        return floatImage;
+    }
+
+    ImagePtr image = createImage(bitDepth, nComps, size);
+    if (!image) {
+        return ImagePtr();
+    }
+    Image::CopyPixelsArgs copyArgs;
+    copyArgs.roi = image->getBounds();
+    if ( isFailureRetCode( image->copyPixels(*floatImage, copyArgs) ) ) {
+        return ImagePtr();
+    }
+    return image;
+}
+
+static double
+getImageBytes(ImageBitDepthEnum bitDepth,
+              int nComps,
+              int size)
+{
+    return (double)size * size * nComps * getSizeOfForBitDepth(bitDepth);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief A benchmark of a kernel applied to the whole of an image of the given bit depth, components and size
+ **/
+class ImageBenchmarkBase
+    : public Benchmark
+{
+public:
+
+    ImageBenchmarkBase(const std::string& name,
+                       ImageBitDepthEnum bitDepth,
+                       int nComps,
+                       int size)
+    : Benchmark(name)
+    , _bitDepth(bitDepth)
+    , _nComps(nComps)
+    , _size(size)
+    , _image()
+    {
+        addParameter( "bitDepth", getBitDepthName(bitDepth) );
+        addParameter("components", nComps);
+        addParameter("size", size);
+    }
+
+    virtual bool setUp() OVERRIDE
+    {
+        _image = createRandomImage(_bitDepth, _nComps, _size);
+        setBytesProcessed( getImageBytes(_bitDepth, _nComps, _size) );
+        return (bool)_image;
+    }
+
+    virtual void tearDown() OVERRIDE
+    {
+        _image.reset();
+    }
+
+protected:
+
+    ImageBitDepthEnum _bitDepth;
+    int _nComps;
+    int _size;
+    ImagePtr _image;
+};
+
+/**
+ * @brief Copies an image to an image of the same format: the buffers are copied even though they could be shared
+ **/
+class CopyPixelsBenchmark
+    : public ImageBenchmarkBase
+{
+public:
+
+    CopyPixelsBenchmark(ImageBitDepthEnum bitDepth,
+                        int nComps,
+                        int size)
+    : ImageBenchmarkBase("copyPixels", bitDepth, nComps, size)
+    , _dstImage()
+    {
+    }
+
+    virtual bool setUp() OVERRIDE
+    {
+        if ( !ImageBenchmarkBase::setUp() ) {
+            return false;
+        }
+        _dstImage = createImage(_bitDepth, _nComps, _size);
+        setBytesProcessed( 2 * getImageBytes(_bitDepth, _nComps, _size) );
+        return (bool)_dstImage;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        Image::CopyPixelsArgs args;
+        args.roi = _image->getBounds();
+        args.forceCopyEvenIfBuffersHaveSameLayout = true;
+        _dstImage->copyPixels(*_image, args);
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        ImageBenchmarkBase::tearDown();
+        _dstImage.reset();
+    }
+
+private:
+
+    ImagePtr _dstImage;
+};
+
+/**
+ * @brief Copies a float RGBA image, the format of the renders, to an image of the given bit depth and components
+ **/
+class CopyPixelsFromFloatRGBABenchmark
+    : public ImageBenchmarkBase
+{
+public:
+
+    CopyPixelsFromFloatRGBABenchmark(ImageBitDepthEnum bitDepth,
+                                     int nComps,
+                                     int size)
+    : ImageBenchmarkBase("copyPixelsFromFloatRGBA", bitDepth, nComps, size)
+    , _srcImage()
+    {
+    }
+
+    virtual bool setUp() OVERRIDE
+    {
+        _image = createImage(_bitDepth, _nComps, _size);
+        _srcImage = createRandomImage(eImageBitDepthFloat, 4, _size);
+        setBytesProcessed( getImageBytes(eImageBitDepthFloat, 4, _size) + getImageBytes(_bitDepth, _nComps, _size) );
+        return _image && _srcImage;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        Image::CopyPixelsArgs args;
+        args.roi = _image->getBounds();
+        args.forceCopyEvenIfBuffersHaveSameLayout = true;
+        _image->copyPixels(*_srcImage, args);
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        ImageBenchmarkBase::tearDown();
+        _srcImage.reset();
+    }
+
+private:
+
+    ImagePtr _srcImage;
+};
+
+/**
+ * @brief Copies the alpha channel of the original image, the RGB channels being processed
+ **/
+class CopyUnProcessedChannelsBenchmark
+    : public ImageBenchmarkBase
+{
+public:
+
+    CopyUnProcessedChannelsBenchmark(ImageBitDepthEnum bitDepth,
+                                     int nComps,
+                                     int size)
+    : ImageBenchmarkBase("copyUnProcessedChannels", bitDepth, nComps, size)
+    , _originalImage()
+    , _processChannels()
+    {
+        _processChannels[0] = _processChannels[1] = _processChannels[2] = true;
+        _processChannels[3] = false;
+    }
+
+    virtual bool setUp() OVERRIDE
+    {
+        if ( !ImageBenchmarkBase::setUp() ) {
+            return false;
+        }
+        _originalImage = createRandomImage(_bitDepth, _nComps, _size);
+        setBytesProcessed( 2 * getImageBytes(_bitDepth, _nComps, _size) );
+        return _originalImage && _image->canCallCopyUnProcessedChannels(_processChannels);
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _image->copyUnProcessedChannels(_image->getBounds(), _processChannels, _originalImage);
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        ImageBenchmarkBase::tearDown();
+        _originalImage.reset();
+    }
+
+private:
+
+    ImagePtr _originalImage;
+    std::bitset<4> _processChannels;
+};
+
+/**
+ * @brief Masks the image by an alpha image and dissolves it to the original image, as at the end of the render
+ * of a masked effect. The image converges to the original one as the benchmark runs, which does not change
+ * the work done by the kernel.
+ **/
+class ApplyMaskMixBenchmark
+    : public ImageBenchmarkBase
+{
+public:
+
+    ApplyMaskMixBenchmark(ImageBitDepthEnum bitDepth,
+                          int nComps,
+                          int size)
+    : ImageBenchmarkBase("applyMaskMix", bitDepth, nComps, size)
+    , _originalImage()
+    , _maskImage()
+    {
+    }
+
+    virtual bool setUp() OVERRIDE
+    {
+        if ( !ImageBenchmarkBase::setUp() ) {
+            return false;
+        }
+        _originalImage = createRandomImage(_bitDepth, _nComps, _size);
+        _maskImage = createRandomImage(_bitDepth, 1, _size);
+        setBytesProcessed( 3 * getImageBytes(_bitDepth, _nComps, _size) + getImageBytes(_bitDepth, 1, _size) );
+        return _originalImage && _maskImage;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _image->applyMaskMix(_image->getBounds(), _maskImage, _originalImage, true, false, 0.5f);
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        ImageBenchmarkBase::tearDown();
+        _originalImage.reset();
+        _maskImage.reset();
+    }
+
+private:
+
+    ImagePtr _originalImage, _maskImage;
+};
+
+/**
+ * @brief Fills the image with a colour, or with black and transparent which is optimized
+ **/
+class FillBenchmark
+    : public ImageBenchmarkBase
+{
+public:
+
+    FillBenchmark(bool zero,
+                  ImageBitDepthEnum bitDepth,
+                  int nComps,
+                  int size)
+    : ImageBenchmarkBase(zero ? "fillZero" : "fill", bitDepth, nComps, size)
+    , _zero(zero)
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        if (_zero) {
+            _image->fillZero( _image->getBounds() );
+        } else {
+            _image->fill(_image->getBounds(), 0.25f, 0.5f, 0.75f, 1.f);
+        }
+    }
+
+private:
+
+    bool _zero;
+};
+
+/**
+ * @brief Downscales the image by 2, the downscaled image being allocated by each call as in the renders
+ **/
+class DownscaleMipMapBenchmark
+    : public ImageBenchmarkBase
+{
+public:
+
+    DownscaleMipMapBenchmark(ImageBitDepthEnum bitDepth,
+                             int nComps,
+                             int size)
+    : ImageBenchmarkBase("downscaleMipMap", bitDepth, nComps, size)
+    {
+    }
+
+    virtual bool setUp() OVERRIDE
+    {
+        if ( !ImageBenchmarkBase::setUp() ) {
+            return false;
+        }
+        setBytesProcessed( getImageBytes(_bitDepth, _nComps, _size) * 1.25 );
+        return true;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        ImagePtr downscaled = _image->downscaleMipMap(_image->getBounds(), 1);
+        (void)downscaled;
+    }
+};
+
+/**
+ * @brief Scans an image that contains no NaN, which is the common case: nothing is written
+ **/
+class CheckForNaNsBenchmark
+    : public ImageBenchmarkBase
+{
+public:
+
+    CheckForNaNsBenchmark(ImageBitDepthEnum bitDepth,
+                          int nComps,
+                          int size)
+    : ImageBenchmarkBase("checkForNaNs", bitDepth, nComps, size)
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        bool foundNaN = false;
+        ActionRetCodeEnum stat = _image->checkForNaNs(_image->getBounds(), &foundNaN);
+        (void)stat;
+    }
+};
+
+/**
+ * @brief Converts a buffer of values from a bit depth to another one
+ **/
+template <typename SRCPIX, typename DSTPIX>
+class ConvertPixelDepthBenchmark
+    : public Benchmark
+{
+public:
+
+    ConvertPixelDepthBenchmark(ImageBitDepthEnum srcBitDepth,
+                               ImageBitDepthEnum dstBitDepth,
+                               int size)
+    : Benchmark("convertPixelDepth")
+    , _srcBitDepth(srcBitDepth)
+    , _size(size)
+    , _src()
+    , _dst()
+    {
+        addParameter( "srcBitDepth", getBitDepthName(srcBitDepth) );
+        addParameter( "dstBitDepth", getBitDepthName(dstBitDepth) );
+        addParameter("size", size);
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        // The values of a RGBA image
+        ImagePtr image = createRandomImage(_srcBitDepth, 4, _size);
+        if (!image) {
+            return false;
+        }
+        Image::CPUData data;
+        image->getCPUData(&data);
+        const std::size_t nValues = (std::size_t)_size * _size * 4;
+        _src.assign( (const SRCPIX*)data.ptrs[0], (const SRCPIX*)data.ptrs[0] + nValues );
+        _dst.resize(nValues);
+        setBytesProcessed( (double)nValues * ( sizeof(SRCPIX) + sizeof(DSTPIX) ) );
+        return true;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        Image::convertPixelDepthRow<SRCPIX, DSTPIX>(&_src[0], 1, &_dst[0], 1, (int)_src.size());
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        std::vector<SRCPIX>().swap(_src);
+        std::vector<DSTPIX>().swap(_dst);
+    }
+
+private:
+
+    ImageBitDepthEnum _srcBitDepth;
+    int _size;
+    std::vector<SRCPIX> _src;
+    std::vector<DSTPIX> _dst;
+};
+
+template <typename SRCPIX, typename DSTPIX>
+void
+addConvertPixelDepthBenchmarks(BenchmarkRunner* runner,
+                               ImageBitDepthEnum srcBitDepth,
+                               ImageBitDepthEnum dstBitDepth)
+{
+    for (int s = 0; s < 3; ++s) {
+        runner->addBenchmark( boost::make_shared<ConvertPixelDepthBenchmark<SRCPIX, DSTPIX> >(srcBitDepth, dstBitDepth, benchmarkSizes[s]) );
+    }
+}
+
+template <typename SRCPIX>
+void
+addConvertPixelDepthBenchmarksForSrc(BenchmarkRunner* runner,
+                                     ImageBitDepthEnum srcBitDepth)
+{
+    if (srcBitDepth != eImageBitDepthByte) {
+        addConvertPixelDepthBenchmarks<SRCPIX, unsigned char>(runner, srcBitDepth, eImageBitDepthByte);
+    }
+    if (srcBitDepth != eImageBitDepthShort) {
+        addConvertPixelDepthBenchmarks<SRCPIX, unsigned short>(runner, srcBitDepth, eImageBitDepthShort);
+    }
+    if (srcBitDepth != eImageBitDepthHalf) {
+        addConvertPixelDepthBenchmarks<SRCPIX, Half>(runner, srcBitDepth, eImageBitDepthHalf);
+    }
+    if (srcBitDepth != eImageBitDepthFloat) {
+        addConvertPixelDepthBenchmarks<SRCPIX, float>(runner, srcBitDepth, eImageBitDepthFloat);
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+registerImageBenchmarks(BenchmarkRunner* runner)
+{
+    addConvertPixelDepthBenchmarksForSrc<unsigned char>(runner, eImageBitDepthByte);
+    addConvertPixelDepthBenchmarksForSrc<unsigned short>(runner, eImageBitDepthShort);
+    addConvertPixelDepthBenchmarksForSrc<Half>(runner, eImageBitDepthHalf);
+    addConvertPixelDepthBenchmarksForSrc<float>(runner, eImageBitDepthFloat);
+
+    for (int d = 0; d < 4; ++d) {
+        const ImageBitDepthEnum bitDepth = benchmarkBitDepths[d];
+        for (int c = 0; c < 3; ++c) {
+            const int nComps = benchmarkNComps[c];
+            for (int s = 0; s < 3; ++s) {
+                const int size = benchmarkSizes[s];
+                runner->addBenchmark( boost::make_shared<CopyPixelsBenchmark>(bitDepth, nComps, size) );
+                runner->addBenchmark( boost::make_shared<CopyPixelsFromFloatRGBABenchmark>(bitDepth, nComps, size) );
+                runner->addBenchmark( boost::make_shared<CopyUnProcessedChannelsBenchmark>(bitDepth, nComps, size) );
+                runner->addBenchmark( boost::make_shared<ApplyMaskMixBenchmark>(bitDepth, nComps, size) );
+                runner->addBenchmark( boost::make_shared<FillBenchmark>(false, bitDepth, nComps, size) );
+                runner->addBenchmark( boost::make_shared<FillBenchmark>(true, bitDepth, nComps, size) );
+                runner->addBenchmark( boost::make_shared<DownscaleMipMapBenchmark>(bitDepth, nComps, size) );
+                // Byte and short images never contain NaNs
+                if ( (bitDepth == eImageBitDepthHalf) || (bitDepth == eImageBitDepthFloat) ) {
+                    runner->addBenchmark( boost::make_shared<CheckForNaNsBenchmark>(bitDepth, nComps, size) );
+                }
+            }
+        }
+    }
+} // registerImageBenchmarks
+
+NATRON_NAMESPACE_EXIT
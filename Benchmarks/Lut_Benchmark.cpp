@@ -0,0 +1,188 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Benchmark.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+
+#include "Engine/Lut.h"
+#include "Engine/RectI.h"
+
+NATRON_NAMESPACE_ENTER
+
+using namespace Color;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum LutConversionEnum
+{
+    eLutConversionToBytePacked = 0,
+    eLutConversionToFloatPacked,
+    eLutConversionFromBytePacked,
+    eLutConversionFromShortPacked,
+    eLutConversionFromFloatPacked
+};
+
+const char*
+getConversionName(LutConversionEnum conversion)
+{
+    switch (conversion) {
+    case eLutConversionToBytePacked:
+        return "Lut.to_byte_packed";
+    case eLutConversionToFloatPacked:
+        return "Lut.to_float_packed";
+    case eLutConversionFromBytePacked:
+        return "Lut.from_byte_packed";
+    case eLutConversionFromShortPacked:
+        return "Lut.from_short_packed";
+    case eLutConversionFromFloatPacked:
+        return "Lut.from_float_packed";
+    }
+    return "";
+}
+
+/**
+ * @brief Converts a size x size image between linear and sRGB with the packed conversions of the Lut,
+ * which the readers, the writers and the viewer use. The RGBA images are premultiplied.
+ **/
+class LutBenchmark
+    : public Benchmark
+{
+public:
+
+    LutBenchmark(LutConversionEnum conversion,
+                 int nComps,
+                 int size)
+    : Benchmark( getConversionName(conversion) )
+    , _conversion(conversion)
+    , _packing(nComps == 4 ? ePixelPackingRGBA : ePixelPackingRGB)
+    , _nComps(nComps)
+    , _bounds(0, 0, size, size)
+    , _floatPixels()
+    , _otherFloatPixels()
+    , _bytePixels()
+    , _shortPixels()
+    {
+        addParameter("components", nComps);
+        addParameter("size", size);
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        const std::size_t nValues = (std::size_t)_bounds.width() * _bounds.height() * _nComps;
+        _floatPixels.resize(nValues);
+        _otherFloatPixels.resize(nValues);
+        _bytePixels.resize(nValues);
+        _shortPixels.resize(nValues);
+        srand(_bounds.width() * 4 + _nComps);
+        for (std::size_t i = 0; i < nValues; ++i) {
+            // coverity[dont_call]
+            _floatPixels[i] = rand() / (float)RAND_MAX;
+            _bytePixels[i] = (unsigned char)(rand() % 256);
+            _shortPixels[i] = (unsigned short)(rand() % 65536);
+        }
+
+        double valueSize = sizeof(float);
+        switch (_conversion) {
+        case eLutConversionToBytePacked:
+        case eLutConversionFromBytePacked:
+            valueSize += sizeof(unsigned char);
+            break;
+        case eLutConversionFromShortPacked:
+            valueSize += sizeof(unsigned short);
+            break;
+        case eLutConversionToFloatPacked:
+        case eLutConversionFromFloatPacked:
+            valueSize += sizeof(float);
+            break;
+        }
+        setBytesProcessed(nValues * valueSize);
+        return true;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        const Lut* lut = LutManager::sRGBLut();
+        const bool premult = (_nComps == 4);
+
+        switch (_conversion) {
+        case eLutConversionToBytePacked:
+            lut->to_byte_packed(&_bytePixels[0], &_floatPixels[0], _bounds, _bounds, _bounds, _packing, _packing, false, premult);
+            break;
+        case eLutConversionToFloatPacked:
+            lut->to_float_packed(&_otherFloatPixels[0], &_floatPixels[0], _bounds, _bounds, _bounds, _packing, _packing, false, premult);
+            break;
+        case eLutConversionFromBytePacked:
+            lut->from_byte_packed(&_floatPixels[0], &_bytePixels[0], _bounds, _bounds, _bounds, _packing, _packing, false, premult);
+            break;
+        case eLutConversionFromShortPacked:
+            lut->from_short_packed(&_floatPixels[0], &_shortPixels[0], _bounds, _bounds, _bounds, _packing, _packing, false, premult);
+            break;
+        case eLutConversionFromFloatPacked:
+            lut->from_float_packed(&_otherFloatPixels[0], &_floatPixels[0], _bounds, _bounds, _bounds, _packing, _packing, false, premult);
+            break;
+        }
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        std::vector<float>().swap(_floatPixels);
+        std::vector<float>().swap(_otherFloatPixels);
+        std::vector<unsigned char>().swap(_bytePixels);
+        std::vector<unsigned short>().swap(_shortPixels);
+    }
+
+private:
+
+    LutConversionEnum _conversion;
+    PixelPackingEnum _packing;
+    int _nComps;
+    RectI _bounds;
+    std::vector<float> _floatPixels, _otherFloatPixels;
+    std::vector<unsigned char> _bytePixels;
+    std::vector<unsigned short> _shortPixels;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+registerLutBenchmarks(BenchmarkRunner* runner)
+{
+    const int nComps[2] = { 3, 4 };
+    const int sizes[3] = { 256, 1024, 2048 };
+
+    for (int conversion = eLutConversionToBytePacked; conversion <= eLutConversionFromFloatPacked; ++conversion) {
+        for (int c = 0; c < 2; ++c) {
+            for (int s = 0; s < 3; ++s) {
+                runner->addBenchmark( boost::make_shared<LutBenchmark>( (LutConversionEnum)conversion, nComps[c], sizes[s] ) );
+            }
+        }
+    }
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,25 @@
+# -*- coding: utf-8 -*-
+# Reference project: animated roto shapes with feather, merged over the source.
+
+import NatronEngine
+from common import setupProject, createSource, createOutput
+
+try:
+    benchmarkFormat
+except NameError:
+    benchmarkFormat = "2K_DCP"
+
+setupProject(app, benchmarkFormat)
+source = createSource(app)
+
+roto = app.createNode("fr.inria.built-in.Roto")
+roto.connectInput(0, source)
+shapes = roto.getItemsTable("rotoPaintItems")
+for i in range(8):
+    ellipse = shapes.createEllipse(200. + i * 150., 300. + i * 50., 300., True, 1)
+    ellipse.movePointByIndex(0, 10, 100., 50.)
+    ellipse.moveFeatherByIndex(1, 1, 40., 40.)
+rectangle = shapes.createRectangle(100., 100., 800., 1)
+rectangle.movePointByIndex(2, 10, 200., -100.)
+
+createOutput(app, roto)
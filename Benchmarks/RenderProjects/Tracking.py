@@ -0,0 +1,29 @@
+# -*- coding: utf-8 -*-
+# Reference project: a Tracker match-moving the source with the transform of 4 animated tracks.
+# The tracks are keyframed rather than tracked, so that only the render of the tracker is measured.
+
+import NatronEngine
+from common import setupProject, createSource, createOutput
+
+try:
+    benchmarkFormat
+except NameError:
+    benchmarkFormat = "2K_DCP"
+
+setupProject(app, benchmarkFormat)
+source = createSource(app)
+
+tracker = app.createNode("fr.inria.built-in.Tracker")
+tracker.connectInput(0, source)
+tracks = tracker.getItemsTable("tracksTable")
+corners = [(400., 300.), (1600., 300.), (1600., 800.), (400., 800.)]
+for (x, y) in corners:
+    track = tracks.createTrack()
+    center = track.getParam("centerPoint")
+    for frame in range(1, 11):
+        center.setValueAtTime(x + frame * 12., frame, 0)
+        center.setValueAtTime(y + frame * 5., frame, 1)
+tracker.getParam("motionType").set("Match-Move")
+tracker.getParam("transformType").set("CornerPin")
+
+createOutput(app, tracker)
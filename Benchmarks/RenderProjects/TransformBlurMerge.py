@@ -0,0 +1,37 @@
+# -*- coding: utf-8 -*-
+# Reference project: an animated transform, a large blur and a merge with a second branch.
+
+import NatronEngine
+from common import setupProject, createSource, createOutput
+
+try:
+    benchmarkFormat
+except NameError:
+    benchmarkFormat = "2K_DCP"
+
+setupProject(app, benchmarkFormat)
+source = createSource(app)
+
+transform = app.createNode("net.sf.openfx.TransformPlugin")
+transform.connectInput(0, source)
+rotate = transform.getParam("rotate")
+rotate.setValueAtTime(0., 1)
+rotate.setValueAtTime(30., 10)
+scale = transform.getParam("scale")
+scale.setValueAtTime(1., 1, 0)
+scale.setValueAtTime(1.5, 10, 0)
+
+blur = app.createNode("net.sf.cimg.CImgBlur")
+blur.connectInput(0, transform)
+blur.getParam("size").set(40., 40.)
+
+sharpBranch = app.createNode("net.sf.openfx.TransformPlugin")
+sharpBranch.connectInput(0, source)
+sharpBranch.getParam("translate").setValueAtTime(200., 10, 0)
+
+merge = app.createNode("net.sf.openfx.MergePlugin")
+merge.connectInput(0, blur)
+merge.connectInput(1, sharpBranch)
+merge.getParam("mix").set(0.5)
+
+createOutput(app, merge)
@@ -0,0 +1,30 @@
+# -*- coding: utf-8 -*-
+# Helpers of the reference projects of NatronBenchmarks --render-regression.
+# The format is given with: -c "benchmarkFormat = '4K_DCP'", and the harness adds this
+# directory to sys.path so that the projects can import this module.
+
+import NatronEngine
+
+
+def setupProject(app, formatName):
+    """Sets the format of the project, from which the generators take their size."""
+    app.getProjectParam("outputFormat").set(formatName)
+    app.getProjectParam("frameRange").set(1, 10)
+
+
+def createSource(app):
+    """A checkerboard with a radial ramp on top, so that the images are not uniform."""
+    checker = app.createNode("net.sf.openfx.CheckerBoardPlugin")
+    radial = app.createNode("net.sf.openfx.Radial")
+    merge = app.createNode("net.sf.openfx.MergePlugin")
+    merge.connectInput(0, checker)
+    merge.connectInput(1, radial)
+    return merge
+
+
+def createOutput(app, inputNode):
+    """The Output1 node, replaced by a Write node with the -o option of NatronRenderer."""
+    output = app.createNode("fr.inria.built-in.Output")
+    output.setScriptName("Output1")
+    output.connectInput(0, inputNode)
+    return output
@@ -0,0 +1,484 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderRegression.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QProcess>
+#include <QtCore/QRegExp>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct RenderRegressionOptions
+{
+    QString projectsDirectory;
+    QString renderer;
+    std::string filter;
+    QStringList formats;
+    QString frames;
+    int warmRunsCount;
+    std::string baselineFile;
+    double tolerancePercent;
+    std::string outputFile;
+
+    RenderRegressionOptions()
+    : projectsDirectory()
+    , renderer()
+    , filter()
+    , formats()
+    , frames( QString::fromUtf8("1-10") )
+    , warmRunsCount(1)
+    , baselineFile()
+    , tolerancePercent(10.)
+    , outputFile()
+    {
+        formats << QString::fromUtf8("2K_DCP") << QString::fromUtf8("4K_DCP");
+    }
+};
+
+std::string
+escapeJSONString(const std::string& str)
+{
+    std::string ret;
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        if ( (str[i] == '"') || (str[i] == '\\') ) {
+            ret.push_back('\\');
+        }
+        ret.push_back(str[i]);
+    }
+    return ret;
+}
+
+/**
+ * @brief Reads the metrics written by NatronRenderer with --metrics-file, see MetricsExporter::makeReport()
+ **/
+bool
+readMetrics(const QString& filePath,
+            RenderRegression::Run* run)
+{
+    QFile file(filePath);
+    if ( !file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
+        return false;
+    }
+    QRegExp sampleRe( QString::fromUtf8("^([a-z_]+)(\\{(.*)\\})? (\\S+)$") );
+    QRegExp nodeRe( QString::fromUtf8("node=\"([^\"]*)\"") );
+    double lookups = 0., hits = 0.;
+    QTextStream ts(&file);
+    while ( !ts.atEnd() ) {
+        const QString line = ts.readLine();
+        if ( line.startsWith( QLatin1Char('#') ) || !sampleRe.exactMatch(line) ) {
+            continue;
+        }
+        const QString name = sampleRe.cap(1);
+        const QString labels = sampleRe.cap(3);
+        const double value = sampleRe.cap(4).toDouble();
+        if ( name == QString::fromUtf8("natron_node_render_seconds_total") ) {
+            if (nodeRe.indexIn(labels) != -1) {
+                run->nodeTimes[nodeRe.cap(1).toStdString()] = value;
+            }
+        } else if ( name == QString::fromUtf8("natron_cache_lookups_total") ) {
+            lookups += value;
+        } else if ( name == QString::fromUtf8("natron_cache_hits_total") ) {
+            hits += value;
+        } else if ( name == QString::fromUtf8("natron_process_peak_resident_memory_bytes") ) {
+            run->peakRSS = (U64)value;
+        }
+    }
+    run->cacheHitRatio = lookups > 0 ? hits / lookups : 0.;
+    return true;
+}
+
+void
+removeDirectoryFiles(const QString& directory)
+{
+    QDir dir(directory);
+    const QStringList files = dir.entryList(QDir::Files);
+    for (int i = 0; i < files.size(); ++i) {
+        dir.remove(files[i]);
+    }
+}
+
+/**
+ * @brief Renders a project in a NatronRenderer process and fills the run with its wall time and metrics
+ **/
+void
+renderProject(const RenderRegressionOptions& options,
+              const QFileInfo& project,
+              const QString& format,
+              bool clearCache,
+              const QString& tmpDirectory,
+              RenderRegression::Run* run)
+{
+    run->caseName = project.completeBaseName().toStdString();
+    run->format = format.toStdString();
+    run->cacheState = clearCache ? "cold" : "warm";
+
+    const QString metricsFile = QDir(tmpDirectory).filePath( QString::fromUtf8("metrics.prom") );
+    removeDirectoryFiles(tmpDirectory);
+
+    QStringList args;
+    if (clearCache) {
+        args << QString::fromUtf8("--clear-cache");
+    }
+    args << QString::fromUtf8("--render-stats");
+    args << QString::fromUtf8("--metrics-file") << metricsFile;
+    // The projects import their helpers from their directory
+    args << QString::fromUtf8("-c") << QString::fromUtf8("import sys; sys.path.insert(0, r'%1')").arg( project.absolutePath() );
+    args << QString::fromUtf8("-c") << QString::fromUtf8("benchmarkFormat = '%1'").arg(format);
+    args << QString::fromUtf8("-o") << QDir(tmpDirectory).filePath( project.completeBaseName() + QString::fromUtf8("_###.exr") ) << options.frames;
+    args << project.absoluteFilePath();
+
+    QProcess process;
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    TimeLapse timer;
+    process.start(options.renderer, args);
+    const bool finished = process.waitForFinished(-1);
+    run->wallTime = timer.getTimeSinceCreation();
+    const QByteArray output = process.readAll();
+
+    run->succeeded = finished && (process.exitStatus() == QProcess::NormalExit) && (process.exitCode() == 0) && readMetrics(metricsFile, run);
+    if (!run->succeeded) {
+        std::cerr << "The render of " << run->getName() << " failed:" << std::endl;
+        std::cerr << QString::fromUtf8(output).toStdString() << std::endl;
+    }
+} // renderProject
+
+// Returns the run with the lowest wall time of each name, the one least disturbed by the other processes of the machine
+std::map<std::string, RenderRegression::Run>
+getBestRuns(const std::vector<RenderRegression::Run>& runs)
+{
+    std::map<std::string, RenderRegression::Run> ret;
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        if (!runs[i].succeeded) {
+            continue;
+        }
+        std::map<std::string, RenderRegression::Run>::iterator found = ret.find( runs[i].getName() );
+        if ( ( found == ret.end() ) || (runs[i].wallTime < found->second.wallTime) ) {
+            ret[runs[i].getName()] = runs[i];
+        }
+    }
+    return ret;
+}
+
+bool
+readBaseline(const std::string& filePath,
+             std::vector<RenderRegression::Run>* runs)
+{
+    std::ifstream ifile( filePath.c_str() );
+    if ( !ifile.good() ) {
+        return false;
+    }
+    std::string line;
+    while ( std::getline(ifile, line) ) {
+        if (line.find("\"case\"") == std::string::npos) {
+            continue;
+        }
+        RenderRegression::Run run;
+        if ( run.fromJSONLine(line) ) {
+            runs->push_back(run);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Prints the results and their change from the baseline, if any. Returns the number of regressions.
+ **/
+int
+printResults(const std::vector<RenderRegression::Run>& runs,
+             const std::vector<RenderRegression::Run>& baselineRuns,
+             double tolerancePercent)
+{
+    const std::map<std::string, RenderRegression::Run> best = getBestRuns(runs);
+    const std::map<std::string, RenderRegression::Run> baseline = getBestRuns(baselineRuns);
+    const double tolerance = 1. + tolerancePercent / 100.;
+    int nRegressions = 0;
+
+    std::cout << std::left << std::setw(36) << "Render"
+              << std::right << std::setw(12) << "Time (s)"
+              << std::setw(12) << "Peak (MB)"
+              << std::setw(10) << "Hits (%)"
+              << std::setw(12) << "Change (%)"
+              << "  Status" << std::endl;
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        const RenderRegression::Run& run = runs[i];
+        std::map<std::string, RenderRegression::Run>::const_iterator bestIt = best.find( run.getName() );
+        if ( run.succeeded && ( (bestIt == best.end()) || (bestIt->second.wallTime != run.wallTime) ) ) {
+            // Only the best of the runs with the same name is compared
+            continue;
+        }
+        std::cout << std::left << std::setw(36) << run.getName() << std::right << std::fixed;
+        if (!run.succeeded) {
+            std::cout << std::setw(46) << "" << "  FAILED" << std::endl;
+            ++nRegressions;
+            continue;
+        }
+        std::cout << std::setprecision(3) << std::setw(12) << run.wallTime
+                  << std::setprecision(1) << std::setw(12) << run.peakRSS / (1024. * 1024.)
+                  << std::setw(10) << run.cacheHitRatio * 100.;
+        std::map<std::string, RenderRegression::Run>::const_iterator baseIt = baseline.find( run.getName() );
+        if ( baseIt == baseline.end() ) {
+            std::cout << std::setw(12) << "" << (baselineRuns.empty() ? "" : "  new") << std::endl;
+            continue;
+        }
+        const RenderRegression::Run& base = baseIt->second;
+        std::cout << std::showpos << std::setw(12) << (base.wallTime > 0 ? (run.wallTime / base.wallTime - 1.) * 100. : 0.) << std::noshowpos;
+        if (run.wallTime > base.wallTime * tolerance) {
+            std::cout << "  SLOWER";
+            ++nRegressions;
+        } else if (run.peakRSS > base.peakRSS * tolerance) {
+            std::cout << "  MORE MEMORY";
+            ++nRegressions;
+        } else {
+            std::cout << "  ok";
+        }
+        std::cout << std::endl;
+    }
+    return nRegressions;
+} // printResults
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+RenderRegression::Run::Run()
+: caseName()
+, format()
+, cacheState()
+, succeeded(false)
+, wallTime(0)
+, peakRSS(0)
+, cacheHitRatio(0)
+, nodeTimes()
+{
+}
+
+std::string
+RenderRegression::Run::getName() const
+{
+    return caseName + '/' + format + '/' + cacheState;
+}
+
+std::string
+RenderRegression::Run::toJSONLine() const
+{
+    std::stringstream ss;
+    ss << std::setprecision(9);
+    ss << "{\"case\": \"" << escapeJSONString(caseName) << "\", \"format\": \"" << escapeJSONString(format)
+       << "\", \"cache\": \"" << cacheState << "\", \"succeeded\": " << (succeeded ? "true" : "false")
+       << ", \"wallTime\": " << wallTime << ", \"peakRSS\": " << peakRSS << ", \"cacheHitRatio\": " << cacheHitRatio
+       << ", \"nodes\": {";
+    for (std::map<std::string, double>::const_iterator it = nodeTimes.begin(); it != nodeTimes.end(); ++it) {
+        ss << ( it == nodeTimes.begin() ? "" : ", " ) << '"' << escapeJSONString(it->first) << "\": " << it->second;
+    }
+    ss << "}}";
+    return ss.str();
+}
+
+bool
+RenderRegression::Run::fromJSONLine(const std::string& line)
+{
+    const QString str = QString::fromUtf8( line.c_str() );
+    QRegExp stringRe( QString::fromUtf8("\"(case|format|cache)\": \"([^\"]*)\"") );
+    QRegExp valueRe( QString::fromUtf8("\"(succeeded|wallTime|peakRSS|cacheHitRatio)\": ([^,}]+)") );
+    int nFields = 0;
+
+    for (int pos = stringRe.indexIn(str); pos != -1; pos = stringRe.indexIn(str, pos + stringRe.matchedLength()), ++nFields) {
+        const std::string value = stringRe.cap(2).toStdString();
+        if ( stringRe.cap(1) == QString::fromUtf8("case") ) {
+            caseName = value;
+        } else if ( stringRe.cap(1) == QString::fromUtf8("format") ) {
+            format = value;
+        } else {
+            cacheState = value;
+        }
+    }
+    for (int pos = valueRe.indexIn(str); pos != -1; pos = valueRe.indexIn(str, pos + valueRe.matchedLength()), ++nFields) {
+        const QString value = valueRe.cap(2).trimmed();
+        if ( valueRe.cap(1) == QString::fromUtf8("succeeded") ) {
+            succeeded = ( value == QString::fromUtf8("true") );
+        } else if ( valueRe.cap(1) == QString::fromUtf8("wallTime") ) {
+            wallTime = value.toDouble();
+        } else if ( valueRe.cap(1) == QString::fromUtf8("peakRSS") ) {
+            peakRSS = value.toULongLong();
+        } else {
+            cacheHitRatio = value.toDouble();
+        }
+    }
+
+    QRegExp nodesRe( QString::fromUtf8("\"nodes\": \\{([^}]*)\\}") );
+    if (nodesRe.indexIn(str) != -1) {
+        const QString nodes = nodesRe.cap(1);
+        QRegExp nodeRe( QString::fromUtf8("\"([^\"]*)\": ([^,]+)") );
+        for (int pos = nodeRe.indexIn(nodes); pos != -1; pos = nodeRe.indexIn(nodes, pos + nodeRe.matchedLength())) {
+            nodeTimes[nodeRe.cap(1).toStdString()] = nodeRe.cap(2).trimmed().toDouble();
+        }
+    }
+    return nFields == 7;
+} // fromJSONLine
+
+int
+RenderRegression::main(int argc,
+                       char* argv[])
+{
+    RenderRegressionOptions options;
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Unknown option or missing value: " << arg << std::endl;
+
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--projects") {
+            options.projectsDirectory = QString::fromLocal8Bit(value);
+        } else if (arg == "--renderer") {
+            options.renderer = QString::fromLocal8Bit(value);
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--formats") {
+            options.formats = QString::fromUtf8(value).split( QLatin1Char(','), QString::SkipEmptyParts );
+        } else if (arg == "--frames") {
+            options.frames = QString::fromUtf8(value);
+        } else if (arg == "--warm-runs") {
+            options.warmRunsCount = std::max(0, std::atoi(value));
+        } else if (arg == "--baseline") {
+            options.baselineFile = value;
+        } else if (arg == "--tolerance") {
+            options.tolerancePercent = std::max(0., std::atof(value));
+        } else if (arg == "--output") {
+            options.outputFile = value;
+        } else {
+            std::cerr << "Unknown option or missing value: " << arg << std::endl;
+
+            return 1;
+        }
+    }
+
+    if ( options.projectsDirectory.isEmpty() ) {
+        std::cerr << "The directory of the reference projects must be given with --projects, e.g Benchmarks/RenderProjects" << std::endl;
+
+        return 1;
+    }
+    if ( options.renderer.isEmpty() ) {
+        // Installed next to NatronRenderer
+        options.renderer = QDir( QCoreApplication::applicationDirPath() ).filePath( QString::fromUtf8("NatronRenderer") );
+#ifdef __NATRON_WIN32__
+        options.renderer += QString::fromUtf8(".exe");
+#endif
+    }
+    if ( !QFileInfo(options.renderer).exists() ) {
+        std::cerr << "NatronRenderer was not found at " << options.renderer.toStdString() << ", give it with --renderer" << std::endl;
+
+        return 1;
+    }
+
+    std::vector<Run> baselineRuns;
+    if ( !options.baselineFile.empty() && !readBaseline(options.baselineFile, &baselineRuns) ) {
+        std::cerr << "Failed to read the baseline " << options.baselineFile << std::endl;
+
+        return 1;
+    }
+
+    // Every Python script of the directory but the modules they import, which start with a lowercase letter
+    QDir projectsDir(options.projectsDirectory);
+    const QFileInfoList projects = projectsDir.entryInfoList(QStringList() << QString::fromUtf8("*.py"), QDir::Files, QDir::Name);
+
+    const QString tmpDirectory = QDir::temp().filePath( QString::fromUtf8("NatronRenderRegression-%1").arg( QCoreApplication::applicationPid() ) );
+    QDir().mkpath(tmpDirectory);
+
+    std::vector<Run> runs;
+    for (int i = 0; i < projects.size(); ++i) {
+        if ( projects[i].fileName().at(0).isLower() ) {
+            continue;
+        }
+        for (int f = 0; f < options.formats.size(); ++f) {
+            const std::string caseName = projects[i].completeBaseName().toStdString() + '/' + options.formats[f].toStdString();
+            if ( !options.filter.empty() && (caseName.find(options.filter) == std::string::npos) ) {
+                continue;
+            }
+            // The first render clears the cache, the next ones find the tiles it left in the persistent cache
+            for (int r = 0; r <= options.warmRunsCount; ++r) {
+                Run run;
+                renderProject(options, projects[i], options.formats[f], r == 0 /*clearCache*/, tmpDirectory, &run);
+                std::cout << run.getName() << ": " << (run.succeeded ? "" : "failed, ") << std::fixed << std::setprecision(3) << run.wallTime << " s" << std::endl;
+                runs.push_back(run);
+            }
+        }
+    }
+
+    removeDirectoryFiles(tmpDirectory);
+    QDir().rmdir(tmpDirectory);
+
+    if ( runs.empty() ) {
+        std::cerr << "No reference project found in " << options.projectsDirectory.toStdString() << std::endl;
+
+        return 1;
+    }
+
+    std::cout << std::endl;
+    const int nRegressions = printResults(runs, baselineRuns, options.tolerancePercent);
+
+    if ( !options.outputFile.empty() ) {
+        std::ofstream ofile( options.outputFile.c_str() );
+        if ( !ofile.good() ) {
+            std::cerr << "Failed to write " << options.outputFile << std::endl;
+
+            return 1;
+        }
+        ofile << "{\n";
+        ofile << "  \"version\": \"" << NATRON_VERSION_STRING << "\",\n";
+        ofile << "  \"frames\": \"" << options.frames.toStdString() << "\",\n";
+        ofile << "  \"runs\": [\n";
+        for (std::size_t i = 0; i < runs.size(); ++i) {
+            ofile << "    " << runs[i].toJSONLine() << (i + 1 < runs.size() ? ",\n" : "\n");
+        }
+        ofile << "  ]\n";
+        ofile << "}\n";
+    }
+
+    if (nRegressions > 0) {
+        std::cerr << nRegressions << " render(s) failed or regressed by more than " << options.tolerancePercent << "%" << std::endl;
+
+        return 1;
+    }
+    return 0;
+} // main
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,97 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Benchmarks_RenderRegression_h
+#define Benchmarks_RenderRegression_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief An end-to-end benchmark of NatronRenderer: each reference project of a directory (the Python scripts of
+ * Benchmarks/RenderProjects, which exercise roto, tracking, transforms, blurs and merges) is rendered in 2K and 4K,
+ * once with a cleared cache and then with the cache left by the previous render.
+ *
+ * Each render is a NatronRenderer process started with --render-stats and --metrics-file: the wall time is measured
+ * here and the time spent by each node, the peak resident memory and the cache hit rate are read from the metrics.
+ * The results are written as JSON and may be compared with the results of a previous run, the baseline: the renders
+ * slower or using more memory than the baseline by more than a tolerance are reported as regressions.
+ **/
+class RenderRegression
+{
+public:
+
+    struct Run
+    {
+        // The name of the project, without extension
+        std::string caseName;
+
+        // The name of the format of the project, e.g 2K_DCP
+        std::string format;
+
+        // "cold" for the render with a cleared cache, "warm" for the next ones
+        std::string cacheState;
+
+        bool succeeded;
+
+        // In seconds
+        double wallTime;
+        U64 peakRSS;
+
+        // The ratio of the cache lookups that found their entry, over all the tiers
+        double cacheHitRatio;
+
+        // The time spent rendering by each node, in seconds
+        std::map<std::string, double> nodeTimes;
+
+        Run();
+
+        std::string getName() const;
+
+        /**
+         * @brief Serializes the run to a JSON object on a single line, which fromJSONLine() reads back
+         **/
+        std::string toJSONLine() const;
+
+        bool fromJSONLine(const std::string& line);
+    };
+
+    /**
+     * @brief Parses the options of --render-regression, renders the projects, writes the results and compares them
+     * with the baseline. Returns the exit code of the program, which is not 0 if a render failed or regressed.
+     **/
+    static int main(int argc, char* argv[]);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Benchmarks_RenderRegression_h
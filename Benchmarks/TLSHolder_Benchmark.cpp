@@ -0,0 +1,121 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Benchmark.h"
+
+#include <vector>
+
+#include <boost/make_shared.hpp>
+
+#include "Engine/TLSHolderImpl.h"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct BenchmarkTLSData
+{
+    int value;
+
+    BenchmarkTLSData()
+    : value(0)
+    {
+    }
+};
+
+typedef TLSHolder<BenchmarkTLSData> BenchmarkTLSHolder;
+
+/**
+ * @brief Looks up the data of the current thread on a number of holders, like the OFX suites do on the parameters
+ * and the clips of the effects of a tree during an action, with or without the native thread-local slots.
+ **/
+class TLSHolderBenchmark
+    : public Benchmark
+{
+public:
+
+    TLSHolderBenchmark(bool nativeSlots,
+                       int holdersCount)
+    : Benchmark("TLSHolder.getOrCreateTLSData")
+    , _nativeSlots(nativeSlots)
+    , _holders(holdersCount)
+    , _wasEnabled(false)
+    {
+        addParameter("mode", nativeSlots ? "native" : "map");
+        addParameter("holders", holdersCount);
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        if ( _nativeSlots && !TLSHolderBase::isNativeSlotsEnabled() ) {
+            // Natron was built without NATRON_TLS_NATIVE_SLOTS
+            return false;
+        }
+        _wasEnabled = TLSHolderBase::isNativeSlotsEnabled();
+        TLSHolderBase::setNativeSlotsEnabled(_nativeSlots);
+        for (std::size_t i = 0; i < _holders.size(); ++i) {
+            _holders[i] = boost::make_shared<BenchmarkTLSHolder>();
+            // Create the data of this thread outside of the timed runs
+            _holders[i]->getOrCreateTLSData();
+        }
+        return true;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (std::size_t i = 0; i < _holders.size(); ++i) {
+            ++_holders[i]->getOrCreateTLSData()->value;
+        }
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        TLSHolderBase::clearNativeSlots();
+        std::vector<boost::shared_ptr<BenchmarkTLSHolder> >( _holders.size() ).swap(_holders);
+        TLSHolderBase::setNativeSlotsEnabled(_wasEnabled);
+    }
+
+private:
+
+    bool _nativeSlots;
+    std::vector<boost::shared_ptr<BenchmarkTLSHolder> > _holders;
+    bool _wasEnabled;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+registerTLSHolderBenchmarks(BenchmarkRunner* runner)
+{
+    const int holdersCounts[3] = { 16, 256, 4096 };
+
+    for (int mode = 0; mode < 2; ++mode) {
+        for (int h = 0; h < 3; ++h) {
+            runner->addBenchmark( boost::make_shared<TLSHolderBenchmark>(mode == 1, holdersCounts[h]) );
+        }
+    }
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,211 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
+
+#include "Engine/AppManager.h"
+#include "Engine/CLArgs.h"
+#include "Engine/CPUInstructionSet.h"
+
+#include "Benchmark.h"
+#include "CacheStress.h"
+#include "RenderRegression.h"
+
+NATRON_NAMESPACE_USING
+
+static void
+printUsage(const char* programName)
+{
+    std::cout << "Usage: " << programName << " [options]\n"
+              << "       " << programName << " --cache-stress [cache stress options]\n"
+              << "       " << programName << " --render-regression --projects <dir> [render options]\n"
+              << "Runs the microbenchmarks of the image processing kernels.\n\n"
+              << "Options:\n"
+              << "  --list                    List the benchmarks and exit.\n"
+              << "  --filter <text>           Only run the benchmarks whose name contains text,\n"
+              << "                            e.g: copyPixels/float\n"
+              << "  --samples <n>             Number of timed samples of each benchmark (9).\n"
+              << "  --min-sample-time <sec>   Minimum duration of a sample (0.01).\n"
+              << "  --instruction-set <name>  Bind the kernels to this instruction set\n"
+              << "                            (scalar, sse2, avx2, avx512, neon).\n"
+              << "  --output <file>           Write the results as JSON to file.\n"
+              << "  --help                    Print this help and exit.\n\n"
+              << "Cache stress options:\n"
+              << "  --cache <name>            Stress the local, persistent or all caches (all).\n"
+              << "  --threads <n>             Number of threads per process (8).\n"
+              << "  --processes <n>           Number of other processes sharing the persistent\n"
+              << "                            cache (0).\n"
+              << "  --duration <sec>          Duration of the workload (5).\n"
+              << "  --keys <n>                Number of distinct entries (1024).\n"
+              << "  --tiles-per-entry <n>     Number of tiles of each entry (4).\n"
+              << "  --remove-percent <n>      Percentage of the operations that remove an entry (5).\n"
+              << "  --evict-percent <n>       Percentage of the operations that evict entries (5).\n"
+              << "  --pending-wait-timeout <ms>\n"
+              << "                            Timeout of the waits for pending entries (1000).\n"
+              << "  --cache-size <MiB>        Maximum size of the caches (256).\n"
+              << "  --output <file>           Write the results as JSON to file.\n\n"
+              << "Render options:\n"
+              << "  --projects <dir>          Directory of the reference projects, e.g:\n"
+              << "                            Benchmarks/RenderProjects\n"
+              << "  --renderer <path>         NatronRenderer executable (next to this program).\n"
+              << "  --filter <text>           Only render the projects whose name/format contains\n"
+              << "                            text, e.g: Roto/4K_DCP\n"
+              << "  --formats <list>          Formats of the renders (2K_DCP,4K_DCP).\n"
+              << "  --frames <range>          Frames to render (1-10).\n"
+              << "  --warm-runs <n>           Renders after the one with a cleared cache (1).\n"
+              << "  --baseline <file>         Compare with the JSON written by a previous run.\n"
+              << "  --tolerance <percent>     Slowdown or memory increase from the baseline\n"
+              << "                            reported as a regression (10).\n"
+              << "  --output <file>           Write the results as JSON to file." << std::endl;
+}
+
+// Loads the AppManager the benchmarks run in
+static bool
+loadAppManager(AppManager* manager)
+{
+    int appArgc = 0;
+    QStringList args;
+    args << QString::fromUtf8("--no-settings");
+    CLArgs cl(args, true);
+    if ( !manager->load(appArgc, 0, cl) ) {
+        std::cerr << "Failed to load AppManager" << std::endl;
+
+        return false;
+    }
+    return true;
+}
+
+int
+main(int argc,
+     char *argv[])
+{
+    // The renders run in NatronRenderer processes, this one does not need the AppManager
+    if ( (argc > 1) && (std::string(argv[1]) == "--render-regression") ) {
+        QCoreApplication app(argc, argv);
+
+        return RenderRegression::main(argc, argv);
+    }
+
+    // The cache stress test has its own options, the worker processes it starts run the same program
+    if (argc > 1) {
+        const std::string mode = argv[1];
+        if ( (mode == "--cache-stress") || (mode == "--cache-stress-worker") ) {
+            AppManager manager;
+            if ( !loadAppManager(&manager) ) {
+                return 1;
+            }
+
+            return (mode == "--cache-stress") ? CacheStress::main(argc, argv) : CacheStress::workerMain(argc, argv);
+        }
+    }
+
+    std::string filter, outputFile, instructionSetName;
+    int samples = 9;
+    double minSampleTime = 0.01;
+    bool listOnly = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = (i + 1 < argc);
+        if (arg == "--help") {
+            printUsage(argv[0]);
+
+            return 0;
+        } else if (arg == "--list") {
+            listOnly = true;
+        } else if ( (arg == "--filter") && hasValue ) {
+            filter = argv[++i];
+        } else if ( (arg == "--samples") && hasValue ) {
+            samples = std::atoi(argv[++i]);
+        } else if ( (arg == "--min-sample-time") && hasValue ) {
+            minSampleTime = std::atof(argv[++i]);
+        } else if ( (arg == "--instruction-set") && hasValue ) {
+            instructionSetName = argv[++i];
+        } else if ( (arg == "--output") && hasValue ) {
+            outputFile = argv[++i];
+        } else {
+            std::cerr << "Unknown option or missing value: " << arg << std::endl;
+            printUsage(argv[0]);
+
+            return 1;
+        }
+    }
+
+    BenchmarkRunner runner;
+    registerImageBenchmarks(&runner);
+    registerLutBenchmarks(&runner);
+    registerHistogramBenchmarks(&runner);
+    registerTLSHolderBenchmarks(&runner);
+    runner.setFilter(filter);
+    runner.setSamplesCount(samples);
+    runner.setMinSampleTime(minSampleTime);
+
+    if (listOnly) {
+        runner.list();
+
+        return 0;
+    }
+
+    // The kernels need the thread pool and the LUTs of the application, but not the settings or the cache
+    AppManager manager;
+    if ( !loadAppManager(&manager) ) {
+        return 1;
+    }
+
+    if ( !instructionSetName.empty() ) {
+        CPUInstructionSetEnum instructionSet;
+        if ( !CPUInstructionSet::getInstructionSetFromName(instructionSetName, &instructionSet) ||
+             !CPUInstructionSet::setInstructionSet(instructionSet) ) {
+            std::cerr << "Unsupported instruction set: " << instructionSetName << std::endl;
+
+            return 1;
+        }
+    }
+    std::cout << "Instruction set: " << CPUInstructionSet::getInstructionSetName( CPUInstructionSet::getInstructionSet() ) << std::endl;
+
+    if (runner.run() == 0) {
+        std::cerr << "No benchmark matches the filter: " << filter << std::endl;
+
+        return 1;
+    }
+
+    if ( !outputFile.empty() ) {
+        std::ofstream ofile( outputFile.c_str() );
+        if ( !ofile.good() ) {
+            std::cerr << "Failed to write " << outputFile << std::endl;
+
+            return 1;
+        }
+        ofile << runner.getResultsJSON();
+    }
+
+    return 0;
+} // main
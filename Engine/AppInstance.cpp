@@ -64,6 +64,7 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/FileDownloader.h"
 #include "Engine/GroupOutput.h"
 #include "Engine/DiskCacheNode.h"
+#include "Engine/DistributedRender.h"
 #include "Engine/Node.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/Plugin.h"
@@ -71,11 +72,15 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/ProcessHandler.h"
 #include "Engine/KnobFile.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderFrameQueue.h"
 #include "Engine/RenderQueue.h"
+#include "Engine/RenderStats.h"
 #include "Engine/SerializableWindow.h"
 #include "Engine/Settings.h"
+#include "Engine/StartupProfiler.h"
 #include "Engine/PyPanelI.h"
 #include "Engine/TabWidgetI.h"
+#include "Engine/TileArchive.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/WriteNode.h"
 
@@ -256,10 +261,14 @@ public:
 
     RenderQueuePtr renderQueue;
 
+    boost::scoped_ptr<RenderStatsAccumulator> renderStatsAccumulator;
 
     // Stack to recursively keep track of created nodes
     CreateNodeStack createNodeStack;
 
+    // Recursion count of beginCreateNodesBatch(), only accessed on the main-thread
+    int createNodesBatchRecursion;
+
 
     mutable QMutex invalidExprKnobsMutex;
     std::list<KnobIWPtr> invalidExprKnobs;
@@ -279,7 +288,10 @@ public:
         : _publicInterface(app)
         , _currentProject()
         , _appID(appID)
+        , renderQueue()
+        , renderStatsAccumulator( new RenderStatsAccumulator() )
         , createNodeStack()
+        , createNodesBatchRecursion(0)
         , invalidExprKnobsMutex()
         , invalidExprKnobs()
         , mainWindow(0)
@@ -568,6 +580,38 @@ AppInstance::load(const CLArgs& cl,
     loadInternal(cl, makeEmptyInstance);
 }
 
+void
+AppInstance::setReadersFromCommandLineArgs(const CLArgs& cl)
+{
+    const std::list<CLArgs::ReaderArg>& readerArgs = cl.getReaderArgs();
+    for (std::list<CLArgs::ReaderArg>::const_iterator it = readerArgs.begin(); it != readerArgs.end(); ++it) {
+        std::string readerName = it->name.toStdString();
+        NodePtr readNode = getNodeByFullySpecifiedName(readerName);
+
+        if (!readNode) {
+            std::string exc( tr("%1 does not belong to the project file. Please enter a valid Read node script-name.").arg( QString::fromUtf8( readerName.c_str() ) ).toStdString() );
+            throw std::invalid_argument(exc);
+        } else {
+            if ( !readNode->getEffectInstance()->isReader() ) {
+                std::string exc( tr("%1 is not a Read node! It cannot render anything.").arg( QString::fromUtf8( readerName.c_str() ) ).toStdString() );
+                throw std::invalid_argument(exc);
+            }
+        }
+
+        if ( it->filename.isEmpty() ) {
+            std::string exc( tr("%1: Filename specified is empty but [-i] or [--reader] was passed to the command-line.").arg( QString::fromUtf8( readerName.c_str() ) ).toStdString() );
+            throw std::invalid_argument(exc);
+        }
+        KnobIPtr fileKnob = readNode->getKnobByName(kOfxImageEffectFileParamName);
+        if (fileKnob) {
+            KnobFilePtr outFile = toKnobFile(fileKnob);
+            if (outFile) {
+                outFile->setValue(it->filename.toStdString());
+            }
+        }
+    }
+} // setReadersFromCommandLineArgs
+
 void
 AppInstance::loadInternal(const CLArgs& cl,
                           bool makeEmptyInstance)
@@ -612,11 +656,13 @@ AppInstance::loadInternal(const CLArgs& cl,
 
         if ( info.suffix() == QString::fromUtf8(NATRON_PROJECT_FILE_EXT) ) {
             ///Load the project
+            StartupPhase_RAII phase("Project");
             if ( !_imp->_currentProject->loadProject( info.path(), info.fileName() ) ) {
                 throw std::invalid_argument( tr("Project file loading failed.").toStdString() );
             }
         } else if ( info.suffix() == QString::fromUtf8("py") ) {
             ///Load the python script
+            StartupPhase_RAII phase("Python script");
             loadPythonScript(info);
         } else {
             throw std::invalid_argument( tr("%1 only accepts python scripts or .ntp project files.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ).toStdString() );
@@ -634,36 +680,31 @@ AppInstance::loadInternal(const CLArgs& cl,
         _imp->renderQueue->createRenderRequestsFromCommandLineArgs(cl, writersWork);
 
         ///Set reader parameters if specified from the command-line
-        const std::list<CLArgs::ReaderArg>& readerArgs = cl.getReaderArgs();
-        for (std::list<CLArgs::ReaderArg>::const_iterator it = readerArgs.begin(); it != readerArgs.end(); ++it) {
-            std::string readerName = it->name.toStdString();
-            NodePtr readNode = getNodeByFullySpecifiedName(readerName);
+        setReadersFromCommandLineArgs(cl);
 
-            if (!readNode) {
-                std::string exc( tr("%1 does not belong to the project file. Please enter a valid Read node script-name.").arg( QString::fromUtf8( readerName.c_str() ) ).toStdString() );
-                throw std::invalid_argument(exc);
-            } else {
-                if ( !readNode->getEffectInstance()->isReader() ) {
-                    std::string exc( tr("%1 is not a Read node! It cannot render anything.").arg( QString::fromUtf8( readerName.c_str() ) ).toStdString() );
-                    throw std::invalid_argument(exc);
-                }
-            }
+        // The launch is over, the time spent rendering is not part of it
+        StartupProfiler::finish();
 
-            if ( it->filename.isEmpty() ) {
-                std::string exc( tr("%1: Filename specified is empty but [-i] or [--reader] was passed to the command-line.").arg( QString::fromUtf8( readerName.c_str() ) ).toStdString() );
-                throw std::invalid_argument(exc);
+        ///launch renders
+        RectD renderRegion;
+        if ( !cl.getCacheExportFile().isEmpty() ) {
+            // Only the tiles of the given nodes are computed, the writers are not rendered
+            if ( !TileArchive::exportNodes(shared_from_this(), cl.getCacheExportFile(), cl.getCacheExportNodes(), cl.getFrameRanges()) ) {
+                throw std::runtime_error( tr("Failed to export the tiles of the nodes given with --export-cache.").toStdString() );
             }
-            KnobIPtr fileKnob = readNode->getKnobByName(kOfxImageEffectFileParamName);
-            if (fileKnob) {
-                KnobFilePtr outFile = toKnobFile(fileKnob);
-                if (outFile) {
-                    outFile->setValue(it->filename.toStdString());
-                }
+        } else if ( !cl.getFrameQueueDirectory().isEmpty() ) {
+            // The frames are pulled from the queue shared with the other render nodes instead of the fixed frame ranges
+            RenderFrameQueue queue( cl.getFrameQueueDirectory() );
+            queue.setBatchSize( cl.getFrameQueueBatchSize() );
+            if ( !queue.render(shared_from_this(), writersWork) ) {
+                throw std::runtime_error( tr("Failed to render the frames of the queue given with --frame-queue.").toStdString() );
             }
-        }
-
-        ///launch renders
-        if ( !writersWork.empty() ) {
+        } else if ( cl.getRenderRegion(&renderRegion) ) {
+            // A worker of a distributed render: the coordinator writes the frames from the tiles of all the workers
+            if ( !DistributedRender::renderRegion(writersWork, renderRegion) ) {
+                throw std::runtime_error( tr("Failed to render the region given with --render-region.").toStdString() );
+            }
+        } else if ( !writersWork.empty() ) {
             _imp->renderQueue->renderNonBlocking(writersWork);
         }
     } else if (appPTR->getAppType() == AppManager::eAppTypeInterpreter) {
@@ -687,6 +728,7 @@ AppInstance::loadInternal(const CLArgs& cl,
             }
         }
 
+        StartupProfiler::finish();
 
         appPTR->launchPythonInterpreter();
     } else {
@@ -1437,6 +1479,18 @@ AppInstance::getRenderQueue() const
     return _imp->renderQueue;
 }
 
+bool
+AppInstance::isRenderStatsActionChecked() const
+{
+    return _imp->renderStatsAccumulator->isEnabled();
+}
+
+RenderStatsAccumulator*
+AppInstance::getRenderStatsAccumulator() const
+{
+    return _imp->renderStatsAccumulator.get();
+}
+
 void
 AppInstance::errorDialog(const std::string & title,
                          const std::string & message,
@@ -1507,9 +1561,9 @@ AppInstance::questionDialog(const std::string & title,
 }
 
 void
-AppInstance::triggerAutoSave()
+AppInstance::triggerAutoSave(const NodePtr& changedNode)
 {
-    _imp->_currentProject->triggerAutoSave();
+    _imp->_currentProject->triggerAutoSave(changedNode);
 }
 
 
@@ -1576,6 +1630,10 @@ AppInstance::declareCurrentAppVariable_Python()
 
     return;
 #endif
+    if ( !appPTR->isPythonInitialized() ) {
+        // Declared when Python is initialized, see AppManager::ensurePythonInitialized()
+        return;
+    }
     /// define the app variable
     std::stringstream ss;
 
@@ -1612,6 +1670,34 @@ AppInstance::isCreatingNode() const
     return _imp->createNodeStack.root.get() != 0;
 }
 
+void
+AppInstance::beginCreateNodesBatch()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    ++_imp->createNodesBatchRecursion;
+}
+
+void
+AppInstance::endCreateNodesBatch()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    assert(_imp->createNodesBatchRecursion > 0);
+    if (_imp->createNodesBatchRecursion <= 0) {
+        return;
+    }
+    --_imp->createNodesBatchRecursion;
+    if (_imp->createNodesBatchRecursion == 0 && !getProject()->isLoadingProject()) {
+        // The renders that each connection would have triggered are done once for the whole batch
+        renderAllViewers();
+    }
+}
+
+bool
+AppInstance::isCreatingNodesBatch() const
+{
+    return _imp->createNodesBatchRecursion > 0;
+}
+
 void
 AppInstance::appendToScriptEditor(const std::string& str)
 {
@@ -127,6 +127,11 @@ public:
 
     void load(const CLArgs& cl, bool makeEmptyInstance);
 
+    /**
+     * @brief Sets the files of the Read nodes given with -i. Throws an exception if a node is not a Read node of the project.
+     **/
+    void setReadersFromCommandLineArgs(const CLArgs& cl);
+
 protected:
 
     virtual void loadInternal(const CLArgs& cl, bool makeEmptyInstance);
@@ -297,6 +302,21 @@ public:
      **/
     bool isCreatingNode() const;
 
+    /**
+     * @brief Nodes created between beginCreateNodesBatch() and endCreateNodesBatch(), e.g: when pasting nodes
+     * or instantiating a PyPlug, do not refresh the metadata downstream and the viewers every time an input
+     * is connected. The caller is expected to refresh the metadata of the created nodes once (see
+     * NodeCollection::createNodesFromSerialization) and the viewers are rendered once when the outermost batch ends.
+     * Calls may be nested. Only call these on the main-thread, or use the CreateNodesBatch_RAII class.
+     **/
+    void beginCreateNodesBatch();
+    void endCreateNodesBatch();
+
+    /**
+     * @brief Returns true if between beginCreateNodesBatch() and endCreateNodesBatch()
+     **/
+    bool isCreatingNodesBatch() const;
+
 
     virtual void appendToScriptEditor(const std::string& str);
     virtual void printAutoDeclaredVariable(const std::string& str);
@@ -345,7 +365,16 @@ public:
 
     virtual RotoStrokeItemPtr getActiveRotoDrawingStroke() const { return RotoStrokeItemPtr(); }
 
-    virtual bool isRenderStatsActionChecked() const { return false; }
+    /**
+     * @brief Returns true if the renders should be profiled in depth: this is the case when the stats are
+     * accumulated for the Python API, @see getRenderStatsAccumulator()
+     **/
+    virtual bool isRenderStatsActionChecked() const;
+
+    /**
+     * @brief The stats of the renders of this instance, accumulated when enabled from Python
+     **/
+    RenderStatsAccumulator* getRenderStatsAccumulator() const;
 
     bool saveTemp(const std::string& filename);
     virtual bool save(const std::string& filename);
@@ -424,7 +453,7 @@ public Q_SLOTS:
 
     virtual void redrawAllTimelines() {}
 
-    void triggerAutoSave();
+    void triggerAutoSave(const NodePtr& changedNode = NodePtr());
 
     void clearOpenFXPluginsCaches();
 
@@ -485,6 +514,28 @@ public:
     ~AddCreateNode_RAII();
 };
 
+class CreateNodesBatch_RAII
+{
+    AppInstancePtr _app;
+
+public:
+
+    CreateNodesBatch_RAII(const AppInstancePtr& app)
+    : _app(app)
+    {
+        if (_app) {
+            _app->beginCreateNodesBatch();
+        }
+    }
+
+    ~CreateNodesBatch_RAII()
+    {
+        if (_app) {
+            _app->endCreateNodesBatch();
+        }
+    }
+};
+
 NATRON_NAMESPACE_EXIT
 
 #endif // Engine_AppInstance_h
@@ -50,6 +50,7 @@
 #include <csignal>
 #include <cstddef>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 #include <cstring> // for std::memcpy, strlen
 #include <sstream> // stringstream
@@ -114,8 +115,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/AppInstance.h"
 #include "Engine/Backdrop.h"
 #include "Engine/CLArgs.h"
+#include "Engine/CPUInstructionSet.h"
 #include "Engine/Cache.h"
+#include "Engine/CacheFlusherThread.h"
 #include "Engine/CreateNodeArgs.h"
+#include "Engine/CompressedTileStorage.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/StorageDeleterThread.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/DimensionIdx.h"
@@ -123,13 +128,18 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/ExistenceCheckThread.h"
 #include "Engine/FileSystemModel.h" // FileSystemModel::initDriveLettersToNetworkShareNamesMapping
 #include "Global/FStreamsSupport.h"
+#include "Engine/GPUImageCache.h"
 #include "Engine/GroupInput.h"
 #include "Engine/GroupOutput.h"
 #include "Engine/JoinViewsNode.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/KeybindShortcut.h"
 #include "Engine/Log.h"
+#include "Engine/LockProfiler.h"
 #include "Engine/MemoryInfo.h" // getSystemTotalRAM, printAsRAM
+#include "Engine/MemoryPressureMonitorThread.h"
+#include "Engine/DistributedRender.h"
+#include "Engine/MetricsExporter.h"
 #include "Engine/Node.h"
 #include "Engine/OfxImageEffectInstance.h"
 #include "Engine/OfxEffectInstance.h"
@@ -137,18 +147,26 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/OSGLContext.h"
 #include "Engine/OSGLFunctions.h"
 #include "Engine/OneViewNode.h"
+#include "Engine/PluginMemory.h"
 #include "Engine/ProcessHandler.h" // ProcessInputChannel
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RemoteTileCache.h"
 #include "Engine/RemovePlaneNode.h"
+#include "Engine/RenderBatch.h"
+#include "Engine/RenderDaemon.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoShapeRenderNode.h"
 #include "Engine/RotoShapeRenderCairo.h"
 #include "Engine/StandardPaths.h"
+#include "Engine/StartupProfiler.h"
 #include "Engine/StubNode.h"
 #include "Engine/Settings.h"
+#include "Engine/TileArchive.h"
+#include "Engine/TraceRecorder.h"
 #include "Engine/TrackerNode.h"
+#include "Engine/ThreadPlacement.h"
 #include "Engine/ThreadPool.h"
 #include "Engine/Utils.h"
 #include "Engine/ViewIdx.h"
@@ -553,7 +571,10 @@ AppManager::checkForOlderProjectFile(const AppInstancePtr& app, const QString& f
 bool
 AppManager::loadFromArgs(const CLArgs& cl)
 {
-
+    // The phases of the launch are recorded until the project is loaded, see StartupProfiler::finish()
+    if ( cl.isStartupProfilingEnabled() ) {
+        StartupProfiler::setEnabled(true);
+    }
 
     // Ensure Qt knows C-strings are UTF-8 before creating the QApplication for argv
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
@@ -567,13 +588,19 @@ AppManager::loadFromArgs(const CLArgs& cl)
     // on Linux, X11 will create a context that would corrupt
     // the XUniqueContext created by Qt
     // scoped_ptr
-    _imp->renderingContextPool.reset( new GPUContextPool() );
-    initializeOpenGLFunctionsOnce(true);
+    {
+        StartupPhase_RAII phase("OpenGL");
+        _imp->renderingContextPool.reset( new GPUContextPool() );
+        initializeOpenGLFunctionsOnce(true);
+    }
 
 
     //  QCoreApplication will hold a reference to that appManagerArgc integer until it dies.
     //  Thus ensure that the QCoreApplication is destroyed when returning this function.
-    initializeQApp(_imp->nArgs, &_imp->commandLineArgsUtf8.front()); // calls QCoreApplication::QCoreApplication(), which calls setlocale()
+    {
+        StartupPhase_RAII phase("Qt application");
+        initializeQApp(_imp->nArgs, &_imp->commandLineArgsUtf8.front()); // calls QCoreApplication::QCoreApplication(), which calls setlocale()
+    }
     // see C++ standard 23.2.4.2 vector capacity [lib.vector.capacity]
     // resizing to a smaller size doesn't free/move memory, so the data pointer remains valid
     assert(_imp->nArgs <= (int)_imp->commandLineArgsUtf8.size());
@@ -606,12 +633,17 @@ AppManager::loadFromArgs(const CLArgs& cl)
         }
     }
 
-    try {
-        initPython(); // calls Py_InitializeEx(), which calls setlocale()
-    } catch (const std::runtime_error& e) {
-        std::cerr << e.what() << std::endl;
+    // With --lazy-python, Python is initialized when first needed, see ensurePythonInitialized()
+    bool lazyPython = cl.isPythonLazyInitializationRequested() && cl.isBackgroundMode() && !cl.isInterpreterMode();
+    if (!lazyPython) {
+        StartupPhase_RAII phase("Python");
+        try {
+            initPython(); // calls Py_InitializeEx(), which calls setlocale()
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
 
-        return false;
+            return false;
+        }
     }
 
 
@@ -704,12 +736,42 @@ AppManager::~AppManager()
 
     _imp->_backgroundIPC.reset();
 
+    // Writes the metrics file a last time, with the frames of the renders that just finished
+    _imp->metricsExporter.reset();
+
+    if ( !_imp->memoryTimelineFileOnExit.isEmpty() ) {
+        _imp->memoryTimelineRecorder->stopRecording();
+        if ( _imp->memoryTimelineRecorder->writeToFile( _imp->memoryTimelineFileOnExit.toStdString() ) ) {
+            std::cout << tr("Memory timeline written to %1").arg(_imp->memoryTimelineFileOnExit).toStdString() << std::endl;
+        } else {
+            std::cerr << tr("Failed to write the memory timeline to %1").arg(_imp->memoryTimelineFileOnExit).toStdString() << std::endl;
+        }
+    }
+    _imp->memoryTimelineRecorder->stopRecording();
+    _imp->memoryPressureMonitor->quitThread();
     _imp->storageDeleteThread->quitThread();
+    _imp->compressedTileStorage->quitThread();
+    _imp->cacheFlusherThread->quitThread();
+    _imp->remoteTileCache->quitThread();
 
 
     ///Caches may have launched some threads to delete images, wait for them to be done
     QThreadPool::globalInstance()->waitForDone();
 
+    if (_imp->printLockProfileOnExit) {
+        std::cout << tr("Lock contention report:").toStdString() << std::endl;
+        std::cout << LockProfiler::getReport() << std::endl;
+    }
+
+    if ( !_imp->traceFileOnExit.isEmpty() ) {
+        TraceRecorder::setEnabled(false);
+        if ( TraceRecorder::writeTrace( _imp->traceFileOnExit.toStdString() ) ) {
+            std::cout << tr("Render trace written to %1").arg(_imp->traceFileOnExit).toStdString() << std::endl;
+        } else {
+            std::cerr << tr("Failed to write the render trace to %1").arg(_imp->traceFileOnExit).toStdString() << std::endl;
+        }
+    }
+
     tearDownPython();
     _imp->tearDownGL();
 
@@ -955,22 +1017,65 @@ AppManager::loadInternal(const CLArgs& cl)
     Q_UNUSED(mustSetSignalsHandlers);
 # endif
 
+    // Bind the pixel kernels to the best instruction set of this CPU, unless another one was forced
+    // on the command-line, before anything may render
+    {
+        CPUInstructionSetEnum instructionSet = CPUInstructionSet::getSupportedInstructionSet();
+        const QString& forcedInstructionSet = cl.getInstructionSet();
+        CPUInstructionSetEnum forcedValue;
+        if ( !forcedInstructionSet.isEmpty() && CPUInstructionSet::getInstructionSetFromName(forcedInstructionSet.toStdString(), &forcedValue) ) {
+            if ( CPUInstructionSet::isInstructionSetSupported(forcedValue) ) {
+                instructionSet = forcedValue;
+            } else {
+                std::cerr << tr("The %1 instruction set is not supported by this CPU, using %2 instead.").arg(forcedInstructionSet).arg( QString::fromUtf8( CPUInstructionSet::getInstructionSetName(instructionSet).c_str() ) ).toStdString() << std::endl;
+            }
+        }
+        CPUInstructionSet::setInstructionSet(instructionSet);
+    }
+
     // Settings: we must load these and set the custom settings (using python) ASAP, before creating the OFX Plugin Cache
 
-    _imp->_settings = Settings::create();
-    _imp->_settings->initializeKnobsPublic();
+    {
+        StartupPhase_RAII phase("Settings");
+        _imp->_settings = Settings::create();
+        _imp->_settings->initializeKnobsPublic();
+
+        Settings::LoadSettingsType settingsLoadType;
+        if (cl.isLoadedUsingDefaultSettings()) {
+            settingsLoadType = Settings::eLoadSettingsNone;
+            ///Call restore after initializing knobs
+            _imp->_settings->setSaveSettings(false);
+        } else {
+            settingsLoadType = Settings::eLoadSettingsTypeKnobs;
+        }
+        _imp->_settings->loadSettingsFromFile(settingsLoadType);
+    }
+
+    // Place the render threads before the first thread of the pool is started
+    {
+        ThreadPlacementPolicyEnum placementPolicy = _imp->_settings->getThreadPlacementPolicy();
+        const QString& forcedPlacement = cl.getThreadPlacement();
+        if ( !forcedPlacement.isEmpty() ) {
+            ThreadPlacement::getPolicyFromName(forcedPlacement.toStdString(), &placementPolicy);
+        }
+        ThreadPlacement::setPolicy(placementPolicy);
+    }
+
+    // Profile the locks from the first render
+    if ( cl.isLockProfilingEnabled() ) {
+        LockProfiler::setEnabled(true);
+        _imp->printLockProfileOnExit = true;
+    }
 
-    Settings::LoadSettingsType settingsLoadType;
-    if (cl.isLoadedUsingDefaultSettings()) {
-        settingsLoadType = Settings::eLoadSettingsNone;
-        ///Call restore after initializing knobs
-        _imp->_settings->setSaveSettings(false);
-    } else {
-        settingsLoadType = Settings::eLoadSettingsTypeKnobs;
+    // Record the timeline of the renders from the first one
+    if ( !cl.getTraceFile().isEmpty() ) {
+        TraceRecorder::setEnabled(true);
+        _imp->traceFileOnExit = cl.getTraceFile();
     }
-    _imp->_settings->loadSettingsFromFile(settingsLoadType);
 
 
+    StartupProfiler::beginPhase("Caches");
+
     if (cl.isCacheClearRequestedOnLaunch()) {
         // Clear the cache before attempting to load any data.
         // It is important to call it AFTER _settings->loadSettingsFromFile() because the settings hold the cache
@@ -978,25 +1083,70 @@ AppManager::loadInternal(const CLArgs& cl)
         Cache<true>::clearDiskCache();
     }
 
+    _imp->cacheStats.reset(new CacheStats);
+
     // Create cache once we loaded the cache directory path wanted by the user
     _imp->generalPurposeCache = Cache<false>::create(false /*enableTileStorage*/);
     try {
 
         // If the cache is busy because another process is using it and we are not compiled
         // with NATRON_CACHE_INTERPROCESS_ROBUST, just create a process local cache instead.
-        _imp->tileCache = Cache<true>::create(true /*enableTileStorage*/);
+        _imp->tileCache = Cache<true>::create(true /*enableTileStorage*/, _imp->_settings->getTileSizePo2());
         _imp->mappedProcessWatcher.reset(new MappedProcessWatcherThread);
         _imp->mappedProcessWatcher->startWatching();
     } catch (const BusyCacheException&) {
-        _imp->tileCache = Cache<false>::create(true /*enableTileStorage*/);
+        _imp->tileCache = Cache<false>::create(true /*enableTileStorage*/, _imp->_settings->getTileSizePo2());
     }
 
 
     _imp->tileCache->setMaximumCacheSize(_imp->_settings->getTileCacheSize());
     _imp->generalPurposeCache->setMaximumCacheSize(_imp->_settings->getGeneralPurposeCacheSize());
+    _imp->tileCache->setEvictionPolicy(_imp->_settings->getCacheEvictionPolicy());
+    _imp->generalPurposeCache->setEvictionPolicy(_imp->_settings->getCacheEvictionPolicy());
+    {
+        // When the render threads are placed, the tiles they first write should be local to them
+        CacheNUMAPolicyEnum numaPolicy = _imp->_settings->getCacheNUMAPolicy();
+        if ( (numaPolicy == eCacheNUMAPolicyDefault) && (ThreadPlacement::getPolicy() != eThreadPlacementPolicyNone) ) {
+            numaPolicy = eCacheNUMAPolicyLocal;
+        }
+        _imp->tileCache->setTileStorageMemoryHints(_imp->_settings->isCacheHugePagesEnabled(), numaPolicy);
+    }
+
+    _imp->imageBufferPool.reset(new ImageBufferPool);
+    _imp->imageBufferPool->setMaximumSize(_imp->_settings->getImageBufferPoolSize());
+
+    _imp->memoryPressureMonitor.reset(new MemoryPressureMonitorThread);
+    _imp->memoryPressureMonitor->setEnabled(_imp->_settings->isAdaptiveCacheSizeEnabled());
+    _imp->memoryPressureMonitor->setUserMaximumCacheSize(_imp->_settings->getTileCacheSize());
+    _imp->memoryPressureMonitor->start();
 
     _imp->storageDeleteThread.reset(new StorageDeleterThread);
 
+    _imp->memoryTimelineRecorder.reset(new MemoryTimelineRecorder);
+    _imp->memoryTimelineFileOnExit = cl.getMemoryTimelineFile();
+
+    _imp->compressedTileStorage.reset(new CompressedTileStorage);
+    _imp->compressedTileStorage->setMaximumSize(_imp->_settings->getCompressedTileStorageSize());
+
+    _imp->cacheFlusherThread.reset(new CacheFlusherThread);
+    _imp->cacheFlusherThread->setDurability(_imp->_settings->getCacheDurability());
+
+    _imp->remoteTileCache.reset(new RemoteTileCache);
+    _imp->remoteTileCache->setServer(_imp->_settings->getRemoteTileCacheServer());
+
+    _imp->tileArchive.reset(new TileArchive);
+
+    // Sample the memory once all the caches exist
+    if ( !_imp->memoryTimelineFileOnExit.isEmpty() ) {
+        if (cl.getMemoryTimelineIntervalMS() > 0) {
+            _imp->memoryTimelineRecorder->startRecording( cl.getMemoryTimelineIntervalMS() );
+        } else {
+            _imp->memoryTimelineRecorder->startRecording();
+        }
+    }
+
+    StartupProfiler::endPhase();
+
     _imp->declareSettingsToPython();
 
     // executeCommandLineSettingCommands
@@ -1215,6 +1365,7 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
 
     /*loading all plugins*/
     try {
+        StartupPhase_RAII phase("Plug-ins");
         loadAllPlugins();
         _imp->loadBuiltinFormats();
     } catch (std::logic_error&) {
@@ -1242,6 +1393,14 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         _imp->_appType = eAppTypeGui;
     }
 
+    // Start before the main instance: in background mode, it renders the project before returning
+    if ( (cl.getMetricsPort() != -1) || !cl.getMetricsFile().isEmpty() ) {
+        _imp->metricsExporter.reset( new MetricsExporter() );
+        if ( !_imp->metricsExporter->start( cl.getMetricsPort(), cl.getMetricsFile() ) ) {
+            _imp->metricsExporter.reset();
+        }
+    }
+
     //Now that the locale is set, re-parse the command line arguments because the filenames might have non UTF-8 encodings
     CLArgs args;
     if ( !cl.getScriptFilename().isEmpty() ) {
@@ -1251,7 +1410,33 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         args = cl;
     }
 
-    AppInstancePtr mainInstance = newAppInstance(args, false);
+    if ( (args.getDistributedWorkersCount() > 0) || !args.getDistributedHosts().isEmpty() ) {
+        _imp->distributedRender.reset( new DistributedRender() );
+        _imp->distributedRender->setWorkers( args.getDistributedWorkersCount(), args.getDistributedHosts() );
+        _imp->distributedRender->setCommandLineArgs(args);
+    }
+
+    if ( !args.getCacheImportFile().isEmpty() ) {
+        const bool imported = _imp->tileArchive->importArchive( args.getCacheImportFile() );
+        if (imported) {
+            std::cout << tr("%1 imported to %2.").arg( args.getCacheImportFile() ).arg( TileArchive::getImportDirectoryPath() ).toStdString() << std::endl;
+        }
+        // A farm node only importing an archive has nothing else to do
+        if ( isBackground() && args.getScriptFilename().isEmpty() && !args.isInterpreterMode() && (args.getRenderDaemonPort() == -1) ) {
+            hideSplashScreen();
+            StartupProfiler::finish();
+
+            return imported;
+        }
+    }
+
+    AppInstancePtr mainInstance;
+    {
+        // The main instance loads the project: the report is printed before it renders
+        StartupPhase_RAII phase("Main instance");
+        mainInstance = newAppInstance(args, false);
+    }
+    StartupProfiler::finish();
 
     hideSplashScreen();
 
@@ -1262,6 +1447,33 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
     } else {
         onLoadCompleted();
 
+        if ( (_imp->_appType == eAppTypeBackground) && !cl.getBatchManifest().isEmpty() ) {
+            // The main instance stays empty: each project of the batch is loaded in its own instance
+            RenderBatch batch;
+            batch.setMaxConcurrentProjects( cl.getBatchMaxConcurrentProjects() );
+            batch.setMemoryBudget( (std::size_t)cl.getBatchMemoryBudgetMB() * 1024 * 1024 );
+            if ( !batch.loadManifest( cl.getBatchManifest() ) ) {
+                return false;
+            }
+
+            return batch.render();
+        }
+
+        if ( (_imp->_appType == eAppTypeBackground) && (cl.getRenderDaemonPort() != -1) ) {
+            // The main instance stays empty: each project rendered by the daemon is loaded in its own instance
+            _imp->renderDaemon.reset( new RenderDaemon() );
+            if ( !_imp->renderDaemon->start( cl.getRenderDaemonHost(), cl.getRenderDaemonPort() ) ) {
+                _imp->renderDaemon.reset();
+
+                return false;
+            }
+            exec();
+            _imp->renderDaemon->stop();
+            _imp->renderDaemon.reset();
+
+            return true;
+        }
+
         ///In background project auto-run the rendering is finished at this point, just exit the instance
         if ( ( (_imp->_appType == eAppTypeBackgroundAutoRun) ||
                ( _imp->_appType == eAppTypeBackgroundAutoRunLaunchedFromGui) ||
@@ -1434,6 +1646,9 @@ AppManager::clearAllCaches()
 
     _imp->generalPurposeCache->clear();
     _imp->tileCache->clear();
+    _imp->compressedTileStorage->clear();
+    _imp->imageBufferPool->clear();
+    _imp->cacheFlusherThread->clear();
 
     ///for each app instance clear all its nodes cache
     for (AppInstanceVec::iterator it = copy.begin(); it != copy.end(); ++it) {
@@ -1501,6 +1716,12 @@ AppManager::writeToOutputPipe(const QString & longMessage,
     return true;
 }
 
+bool
+AppManager::isSharingRenderedFramesWithMainProcess() const
+{
+    return _imp->_backgroundIPC && _imp->tileCache && _imp->tileCache->isPersistent();
+}
+
 
 void
 AppManager::loadAllPlugins()
@@ -1509,22 +1730,32 @@ AppManager::loadAllPlugins()
     assert( _imp->_formats.empty() );
 
     // Load plug-ins bundled into Natron
+    StartupProfiler::beginPhase("Built-in plug-ins");
     loadBuiltinNodePlugins();
+    StartupProfiler::endPhase();
 
     // Load OpenFX plug-ins
+    StartupProfiler::beginPhase("OpenFX plug-ins");
     _imp->ofxHost->loadOFXPlugins();
+    StartupProfiler::endPhase();
 
     // Load PyPlugs and init.py & initGui.py scripts
     // Should be done after settings are declared
-    loadPythonGroups();
+    // If Python is initialized lazily, this is done in ensurePythonInitialized()
+    if ( isPythonInitialized() ) {
+        StartupPhase_RAII phase("PyPlugs");
+        loadPythonGroups();
+    }
 
     // Load presets after all plug-ins are loaded
+    StartupProfiler::beginPhase("Presets and plug-in settings");
     loadNodesPresets();
 
     _imp->_settings->loadSettingsFromFile(Settings::eLoadSettingsTypePlugins);
 
 
     onAllPluginsLoaded();
+    StartupProfiler::endPhase();
 }
 
 void
@@ -2633,6 +2864,72 @@ AppManager::getTileCache() const
     return _imp->tileCache;
 }
 
+CompressedTileStorage*
+AppManager::getCompressedTileStorage() const
+{
+    return _imp->compressedTileStorage.get();
+}
+
+ImageBufferPool*
+AppManager::getImageBufferPool() const
+{
+    return _imp->imageBufferPool.get();
+}
+
+MemoryPressureMonitorThread*
+AppManager::getMemoryPressureMonitor() const
+{
+    return _imp->memoryPressureMonitor.get();
+}
+
+CacheFlusherThread*
+AppManager::getCacheFlusherThread() const
+{
+    return _imp->cacheFlusherThread.get();
+}
+
+StorageDeleterThread*
+AppManager::getStorageDeleterThread() const
+{
+    return _imp->storageDeleteThread.get();
+}
+
+MemoryTimelineRecorder*
+AppManager::getMemoryTimelineRecorder() const
+{
+    return _imp->memoryTimelineRecorder.get();
+}
+
+RemoteTileCache*
+AppManager::getRemoteTileCache() const
+{
+    return _imp->remoteTileCache.get();
+}
+
+TileArchive*
+AppManager::getTileArchive() const
+{
+    return _imp->tileArchive.get();
+}
+
+CacheStats*
+AppManager::getCacheStats() const
+{
+    return _imp->cacheStats.get();
+}
+
+MetricsExporter*
+AppManager::getMetricsExporter() const
+{
+    return _imp->metricsExporter.get();
+}
+
+DistributedRender*
+AppManager::getDistributedRender() const
+{
+    return _imp->distributedRender.get();
+}
+
 void
 AppManager::deleteCacheEntriesInSeparateThread(const std::list<ImageStorageBasePtr> & entriesToDelete)
 {
@@ -2683,6 +2980,39 @@ AppManager::printCacheMemoryStats() const
     reportStr += printAsRAM(totalBytes);
     reportStr += tr(" taken by %1 cache entries.").arg(QString::number(totalNEntries));
 
+    {
+        U64 nHits, nMisses;
+        _imp->imageBufferPool->getStats(&nHits, &nMisses);
+        reportStr += QLatin1String("\n");
+        reportStr += tr("Image buffers pool");
+        reportStr += QLatin1String("--> ");
+        reportStr += printAsRAM(_imp->imageBufferPool->getCurrentSize());
+        if (nHits + nMisses > 0) {
+            reportStr += tr(", %1% of the allocations reused a buffer").arg(QString::number(100. * nHits / (nHits + nMisses), 'f', 1));
+        }
+        reportStr += QLatin1String("\n");
+        reportStr += tr("Plug-ins memory");
+        reportStr += QLatin1String("--> ");
+        reportStr += printAsRAM( PluginMemory::getTotalPluginMemoryBytes() );
+        reportStr += QLatin1String("\n");
+        std::size_t videoMemoryBytes = _imp->renderingContextPool->getVideoMemoryAllocated();
+        if (videoMemoryBytes > 0) {
+            reportStr += tr("OpenGL textures");
+            reportStr += QLatin1String("--> ");
+            reportStr += printAsRAM(videoMemoryBytes);
+            reportStr += tr(", %1 of which by the GPU image cache").arg( printAsRAM( _imp->renderingContextPool->getImageCache()->getSize() ) );
+            reportStr += QLatin1String("\n");
+        }
+        std::size_t userCacheSize = _imp->_settings->getTileCacheSize();
+        std::size_t effectiveCacheSize = _imp->memoryPressureMonitor->getEffectiveCacheSize();
+        if (effectiveCacheSize < userCacheSize) {
+            reportStr += tr("Cache budget");
+            reportStr += QLatin1String("--> ");
+            reportStr += tr("%1 instead of %2 because the system is low on memory").arg( printAsRAM(effectiveCacheSize) ).arg( printAsRAM(userCacheSize) );
+            reportStr += QLatin1String("\n");
+        }
+    }
+
     appPTR->writeToErrorLog_mt_safe(tr("Cache Report"), QDateTime::currentDateTime(), reportStr);
 
     appPTR->showErrorLog();
@@ -3152,6 +3482,7 @@ AppManager::initPython()
 #else
     _imp->mainModule = NATRON_PYTHON_NAMESPACE::initializePython2(_imp->commandLineArgsUtf8);
 #endif
+    _imp->pythonInitialized.fetchAndStoreRelease(1);
 
     std::string err;
     // Import NatronEngine
@@ -3213,6 +3544,9 @@ AppManager::tearDownPython()
 
     return;
 #endif
+    if ( !isPythonInitialized() ) {
+        return;
+    }
     ///See https://web.archive.org/web/20150918224620/http://wiki.blender.org/index.php/Dev:2.4/Source/Python/API/Threads
 #if !defined(NDEBUG)
     QThread* curThread = QThread::currentThread();
@@ -3237,6 +3571,50 @@ AppManager::getMainModule()
     return _imp->mainModule;
 }
 
+bool
+AppManager::isPythonInitialized() const
+{
+    return _imp->pythonInitialized.loadAcquire() != 0;
+}
+
+void
+AppManager::ensurePythonInitialized()
+{
+#ifdef NATRON_RUN_WITHOUT_PYTHON
+
+    return;
+#endif
+    if ( isPythonInitialized() ) {
+        return;
+    }
+    if ( QThread::currentThread() != qApp->thread() ) {
+        // Py_Initialize must be called on the main thread, the project should have requested Python when loaded
+        throw std::runtime_error( tr("Python was not initialized and cannot be from a render thread").toStdString() );
+    }
+
+    qDebug() << "Initializing Python on first use...";
+    StartupPhase_RAII phase("Python (on first use)");
+    initPython();
+
+    // Py_InitializeEx calls setlocale()
+    setApplicationLocale();
+
+    loadPythonGroups();
+
+    // Declare the variables of the apps and nodes created while Python was not initialized.
+    // Parent groups are returned before their children by getNodes_recursive.
+    const AppInstanceVec& instances = getAppInstances();
+    for (AppInstanceVec::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+        (*it)->declareCurrentAppVariable_Python();
+        NodesList nodes;
+        (*it)->getProject()->getNodes_recursive(nodes);
+        for (NodesList::iterator it2 = nodes.begin(); it2 != nodes.end(); ++it2) {
+            (*it2)->declareAllPythonAttributes();
+        }
+    }
+    qDebug() << "Initializing Python on first use... done!";
+} // ensurePythonInitialized
+
 ///The symbol has been generated by Shiboken in  Engine/NatronEngine/natronengine_module_wrapper.cpp
 extern "C"
 {
@@ -3961,7 +4339,13 @@ QMap<QString,int> PythonGILLocker::natronCount;
 // Follow https://web.archive.org/web/20150918224620/http://wiki.blender.org/index.php/Dev:2.4/Source/Python/API/Threads
 PythonGILLocker::PythonGILLocker()
     : state(PyGILState_UNLOCKED)
+    , profiled( LockProfiler::isEnabled() )
+    , lockTime(0)
 {
+    if ( appPTR && !appPTR->isPythonInitialized() ) {
+        // Python is initialized lazily, see AppManager::ensurePythonInitialized()
+        appPTR->ensurePythonInitialized();
+    }
 #ifdef DEBUG_PYTHON_GIL
     if (!Py_IsInitialized()) {
         throw std::runtime_error("Trying to execute python code, but Py_IsInitialized() returns false");
@@ -3977,6 +4361,7 @@ PythonGILLocker::PythonGILLocker()
     QString threadname = (qApp && qApp->thread() == curThread) ? QString::fromUtf8("Main") : curThread->objectName();
     qDebug() << QString::fromUtf8("Thread '%1' is asking the Python GIL").arg(threadname);
 #endif
+    double startTime = profiled ? LockProfiler::getTime() : 0.;
     state = PyGILState_Ensure();
 #ifdef DEBUG_PYTHON_GIL
     ++pythonCount[threadname];
@@ -4000,6 +4385,13 @@ PythonGILLocker::PythonGILLocker()
     }
 #endif
 
+    if (profiled) {
+        // The GIL cannot be tried: long waits are considered contended
+        lockTime = LockProfiler::getTime();
+        double waitTime = lockTime - startTime;
+        LockProfiler::recordAcquisition(eLockProfilerSitePythonGIL, waitTime > LockProfiler::getContentionThreshold(), waitTime);
+    }
+
     assert(PyThreadState_Get());
 #if PY_VERSION_HEX >= 0x030400F0
     assert(PyGILState_Check()); // Not available prior to Python 3.4
@@ -4008,6 +4400,10 @@ PythonGILLocker::PythonGILLocker()
 
 PythonGILLocker::~PythonGILLocker()
 {
+    if (profiled) {
+        LockProfiler::recordRelease(eLockProfilerSitePythonGIL, LockProfiler::getTime() - lockTime);
+    }
+
     // Release the Natron GIL https://github.com/NatronGitHub/Natron/commit/46d9d616dfebfbb931a79776734e2fa17202f7cb
 #ifdef DEBUG_PYTHON_GIL
     QThread* curThread = QThread::currentThread();
@@ -4298,6 +4694,12 @@ NATRON_PYTHON_NAMESPACE::getAttrRecursive(const std::string& fullyQualifiedName,
 
     return 0;
 #endif
+    if (!parentObj) {
+        // Python is not initialized yet, nothing is defined
+        *isDefined = false;
+
+        return 0;
+    }
     std::size_t foundDot = fullyQualifiedName.find(".");
     std::string attrName = foundDot == std::string::npos ? fullyQualifiedName : fullyQualifiedName.substr(0, foundDot);
     PyObject* obj = 0;
@@ -192,6 +192,59 @@ public:
 
     CacheBasePtr getTileCache() const;
 
+    /**
+     * @brief Returns the storage holding compressed tiles evicted from the tile cache
+     **/
+    CompressedTileStorage* getCompressedTileStorage() const;
+
+    /**
+     * @brief Returns the pool of recycled buffers for images in RAM
+     **/
+    ImageBufferPool* getImageBufferPool() const;
+
+    /**
+     * @brief Returns the thread syncing to disk the tiles written to the persistent tile cache
+     **/
+    MemoryPressureMonitorThread* getMemoryPressureMonitor() const;
+
+    CacheFlusherThread* getCacheFlusherThread() const;
+
+    /**
+     * @brief Returns the thread freeing the images evicted from the caches
+     **/
+    StorageDeleterThread* getStorageDeleterThread() const;
+
+    /**
+     * @brief Returns the recorder of the memory of the caches and the process over time
+     **/
+    MemoryTimelineRecorder* getMemoryTimelineRecorder() const;
+
+    /**
+     * @brief Returns the tier of the tile cache shared with other machines
+     **/
+    RemoteTileCache* getRemoteTileCache() const;
+
+    /**
+     * @brief Returns the archives of tiles imported with --import-cache, also used to export tiles with --export-cache
+     **/
+    TileArchive* getTileArchive() const;
+
+    /**
+     * @brief Returns the per node statistics of all caches
+     **/
+    CacheStats* getCacheStats() const;
+
+    /**
+     * @brief Returns the exporter of the render metrics, or NULL if neither --metrics-port nor --metrics-file was given
+     **/
+    MetricsExporter* getMetricsExporter() const;
+
+    /**
+     * @brief Returns the coordinator of the distributed renders, or NULL if neither --distributed nor
+     * --distributed-hosts was given
+     **/
+    DistributedRender* getDistributedRender() const;
+
     void deleteCacheEntriesInSeparateThread(const std::list<ImageStorageBasePtr> & entriesToDelete);
 
     /**
@@ -211,6 +264,15 @@ public:
      **/
     bool writeToOutputPipe(const QString & longMessage, const QString & shortMessage, bool printIfNoChannel);
 
+    /**
+     * @brief Returns true if this is a background process started by a main process which shares the same persistent
+     * tile cache. In that case the images rendered by this process can be read from the cache by the main process
+     * and the frames are notified with kFrameAvailableInCacheStringShort on the output pipe.
+     * This requires the cache to be compiled with NATRON_CACHE_INTERPROCESS_ROBUST, otherwise only a single process
+     * may use the persistent cache and the background process uses a process local cache.
+     **/
+    bool isSharingRenderedFramesWithMainProcess() const;
+
     /**
      * @brief Abort any processing on all AppInstance. It is called in some very rare cases
      * such as when changing the number of threads used by the application or when a background render
@@ -337,6 +399,18 @@ public:
 
     PyObject* getMainModule();
 
+    /**
+     * @brief Returns true once Python is initialized. With --lazy-python in background mode, it is only initialized
+     * when first needed by the project or a Python command, until then no Python variable is declared.
+     **/
+    bool isPythonInitialized() const;
+
+    /**
+     * @brief Initializes Python if it was not yet: runs the init.py scripts, loads the Python PyPlugs and declares
+     * the app and nodes variables created so far. This may only be called on the main thread.
+     **/
+    void ensurePythonInitialized();
+
     QStringList getAllNonOFXPluginsPaths() const;
 
     QDir getBundledPluginDirectory() const;
@@ -723,6 +797,10 @@ class PythonGILLocker
 {
     // Follow https://web.archive.org/web/20150918224620/http://wiki.blender.org/index.php/Dev:2.4/Source/Python/API/Threads
     PyGILState_STATE state;
+
+    // When the GIL was taken while the LockProfiler is enabled, the time at which it was taken
+    bool profiled;
+    double lockTime;
 #ifdef DEBUG_PYTHON_GIL
     static QMap<QString, int> pythonCount;
 #ifdef USE_NATRON_GIL
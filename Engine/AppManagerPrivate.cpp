@@ -55,14 +55,18 @@
 
 #include "Engine/CLArgs.h"
 #include "Engine/Cache.h"
+#include "Engine/DistributedRender.h"
 #include "Engine/Format.h"
 #include "Engine/MultiThread.h"
 #include "Engine/Image.h"
+#include "Engine/MetricsExporter.h"
 #include "Engine/OfxHost.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/Settings.h"
 #include "Engine/ProcessHandler.h" // ProcessInputChannel
+#include "Engine/RenderDaemon.h"
 #include "Engine/StandardPaths.h"
+#include "Engine/TileArchive.h"
 
 #include "Serialization/SerializationIO.h"
 
@@ -92,6 +96,9 @@ AppManagerPrivate::AppManagerPrivate()
     , _knobFactory( new KnobFactory() )
     , generalPurposeCache()
     , tileCache()
+    , renderDaemon()
+    , metricsExporter()
+    , distributedRender()
     , _backgroundIPC()
     , _loaded(false)
     , binaryPath()
@@ -103,6 +110,7 @@ AppManagerPrivate::AppManagerPrivate()
     , nArgs(0)
     , mainModule(0)
     , mainThreadState(0)
+    , pythonInitialized()
 #ifdef NATRON_USE_BREAKPAD
     , breakpadProcessExecutableFilePath()
     , breakpadProcessPID(0)
@@ -122,6 +130,9 @@ AppManagerPrivate::AppManagerPrivate()
     , renderingContextPool()
     , openGLRenderers()
     , tasksQueueManager()
+    , printLockProfileOnExit(false)
+    , traceFileOnExit()
+    , memoryTimelineFileOnExit()
 {
     pythonTLS = boost::make_shared<TLSHolder<AppManager::PythonTLSData> >();
     setMaxCacheFiles();
@@ -694,7 +705,10 @@ AppManagerPrivate::initGl(bool checkRenderingReq)
 void
 AppManagerPrivate::tearDownGL()
 {
-    // Kill all rendering context
+    // Kill all rendering context. The cached textures are released first, while the contexts can still be attached.
+    if (renderingContextPool) {
+        renderingContextPool->clear();
+    }
     renderingContextPool.reset();
 
 #ifdef Q_OS_WIN32
@@ -57,7 +57,11 @@ CLANG_DIAG_ON(uninitialized)
 
 #include "Engine/AppManager.h"
 #include "Engine/Cache.h"
+#include "Engine/CacheStats.h"
 #include "Engine/ExistenceCheckThread.h"
+#include "Engine/CompressedTileStorage.h"
+#include "Engine/ImageBufferPool.h"
+#include "Engine/MemoryTimelineRecorder.h"
 #include "Engine/StorageDeleterThread.h"
 #include "Engine/Image.h"
 #include "Engine/GPUContextPool.h"
@@ -127,8 +131,30 @@ public:
 
     boost::scoped_ptr<MappedProcessWatcherThread> mappedProcessWatcher;
 
+    boost::scoped_ptr<ImageBufferPool> imageBufferPool; // recycled buffers of images in RAM, destroyed after the storage deleter thread
+
+    boost::scoped_ptr<MemoryPressureMonitorThread> memoryPressureMonitor; // lowers the budget of the tile cache when the system is low on memory
+
+    boost::scoped_ptr<MemoryTimelineRecorder> memoryTimelineRecorder; // samples the memory of the caches and the process while recording
+
     boost::scoped_ptr<StorageDeleterThread> storageDeleteThread; // thread used to kill cache entries without blocking a render thread
 
+    boost::scoped_ptr<CompressedTileStorage> compressedTileStorage; // tiles evicted from the tile cache, compressed in a separate thread
+
+    boost::scoped_ptr<CacheFlusherThread> cacheFlusherThread; // syncs the tiles written to the persistent tile cache to disk
+
+    boost::scoped_ptr<RemoteTileCache> remoteTileCache; // tiles shared with other machines through a network cache server
+
+    boost::scoped_ptr<TileArchive> tileArchive; // tiles imported with --import-cache and exported with --export-cache
+
+    boost::scoped_ptr<CacheStats> cacheStats; // per node statistics of all caches
+
+    boost::scoped_ptr<RenderDaemon> renderDaemon; //< receives render jobs when running with --daemon
+
+    boost::scoped_ptr<MetricsExporter> metricsExporter; //< exports render metrics with --metrics-port or --metrics-file
+
+    boost::scoped_ptr<DistributedRender> distributedRender; //< splits the frames between workers with --distributed
+
     boost::scoped_ptr<ProcessInputChannel> _backgroundIPC; //< object used to communicate with the main app
 
     //if this app is background, see the ProcessInputChannel def
@@ -161,6 +187,9 @@ public:
     PyObject* mainModule;
     PyThreadState* mainThreadState;
 
+    // 1 once Py_Initialize was called, see AppManager::ensurePythonInitialized()
+    QAtomicInt pythonInitialized;
+
 #ifdef NATRON_USE_BREAKPAD
     QString breakpadProcessExecutableFilePath;
     qint64 breakpadProcessPID;
@@ -216,6 +245,15 @@ public:
     // The application global manager that schedules render and maximizes CPU utilization
     TreeRenderQueueManagerPtr tasksQueueManager;
 
+    // True if the lock contention report is printed when the application exits (--lock-profile)
+    bool printLockProfileOnExit;
+
+    // The file to which the trace of the renders is written when the application exits (--trace)
+    QString traceFileOnExit;
+
+    // The file to which the memory timeline is written when the application exits (--memory-timeline)
+    QString memoryTimelineFileOnExit;
+
 public:
     AppManagerPrivate();
 
@@ -26,13 +26,16 @@
 #include "Bezier.h"
 
 #include <algorithm> // min, max
+#include <list>
 #include <sstream>
+#include <vector>
 #include <locale>
 #include <limits>
 #include <cmath>
 #include <cassert>
 #include <stdexcept>
 
+#include <QtCore/QMutex>
 #include <QtCore/QThread>
 #include <QCoreApplication>
 #include <QtCore/QLineF>
@@ -113,6 +116,194 @@ struct BezierShape
 
 typedef std::map<ViewIdx, BezierShape> PerViewBezierShapeMap;
 
+// How many polygons are kept in the flattening cache of a Bezier
+#define BEZIER_FLATTENING_CACHE_SIZE 8
+
+struct FlattenedPolygon
+{
+    // The hash of all the inputs of the subdivision
+    U64 key;
+    std::vector<ParametricPoint> points;
+    RectD bbox;
+
+    // The normal at each point, only computed once the polygon is offset to a feather distance
+    std::vector<Point> normals;
+};
+
+/**
+ * @brief A flattened polygon offset to a feather distance
+ **/
+struct FeatheredPolygon
+{
+    // The key of the flattened polygon it was offset from
+    U64 flatteningKey;
+    double featherDistance;
+    bool clockWise;
+    std::vector<ParametricPoint> points;
+    RectD bbox;
+};
+
+/**
+ * @brief The last polygons computed by the subdivision of a Bezier, most recently used first.
+ * The render clones of a Bezier share the cache of the main instance: entries are identified by the evaluated
+ * control points so they never have to be invalidated.
+ **/
+struct BezierFlatteningCache
+{
+    QMutex lock;
+    std::list<FlattenedPolygon> polygons;
+
+    // When the feather distance is animated or with motion-blur, the same polygon is offset to several distances:
+    // they are kept separately so that the polygon is only flattened once.
+    std::list<FeatheredPolygon> featheredPolygons;
+
+    BezierFlatteningCache()
+    : lock()
+    , polygons()
+    , featheredPolygons()
+    {
+
+    }
+};
+
+typedef boost::shared_ptr<BezierFlatteningCache> BezierFlatteningCachePtr;
+
+// The maximum number of cells along each axis of a PointsGrid
+#define BEZIER_PICKING_GRID_MAX_CELLS 128
+
+/**
+ * @brief A uniform grid over points, to find the points within a rectangle without visiting all of them
+ **/
+class PointsGrid
+{
+public:
+
+    PointsGrid()
+    : _points()
+    , _x1(0)
+    , _y1(0)
+    , _cellSize(1.)
+    , _nx(0)
+    , _ny(0)
+    , _cells()
+    {
+    }
+
+    void build(const std::vector<Point>& points);
+
+    /**
+     * @brief Appends to indices the index of the points such that x1 <= x <= x2 and y1 <= y <= y2, in increasing order
+     **/
+    void getPointsInRect(double x1, double y1, double x2, double y2, std::vector<int>* indices) const;
+
+private:
+
+    std::vector<Point> _points;
+    double _x1, _y1, _cellSize;
+    int _nx, _ny;
+
+    // For each cell, the index of the points it contains
+    std::vector<std::vector<int> > _cells;
+};
+
+void
+PointsGrid::build(const std::vector<Point>& points)
+{
+    _points = points;
+    _cells.clear();
+    _nx = _ny = 0;
+    if ( points.empty() ) {
+        return;
+    }
+
+    double x2 = points[0].x, y2 = points[0].y;
+    _x1 = x2;
+    _y1 = y2;
+    for (std::size_t i = 1; i < points.size(); ++i) {
+        _x1 = std::min(_x1, points[i].x);
+        _y1 = std::min(_y1, points[i].y);
+        x2 = std::max(x2, points[i].x);
+        y2 = std::max(y2, points[i].y);
+    }
+
+    // Aim at a few points per cell
+    int nCells = std::max( 1, std::min( BEZIER_PICKING_GRID_MAX_CELLS, (int)std::sqrt( (double)points.size() ) ) );
+    _cellSize = std::max(x2 - _x1, y2 - _y1) / nCells;
+    if (_cellSize <= 0.) {
+        _cellSize = 1.;
+    }
+    _nx = std::min( BEZIER_PICKING_GRID_MAX_CELLS, (int)( (x2 - _x1) / _cellSize ) + 1 );
+    _ny = std::min( BEZIER_PICKING_GRID_MAX_CELLS, (int)( (y2 - _y1) / _cellSize ) + 1 );
+    _cells.resize(_nx * _ny);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        int cx = std::min( _nx - 1, (int)( (points[i].x - _x1) / _cellSize ) );
+        int cy = std::min( _ny - 1, (int)( (points[i].y - _y1) / _cellSize ) );
+        _cells[cy * _nx + cx].push_back( (int)i );
+    }
+} // build
+
+void
+PointsGrid::getPointsInRect(double x1, double y1, double x2, double y2, std::vector<int>* indices) const
+{
+    if ( _cells.empty() || (x2 < x1) || (y2 < y1) ) {
+        return;
+    }
+    // Clamp before converting to int: the rectangle may be much larger than the grid
+    int cx1 = (int)std::max( 0., std::floor( (x1 - _x1) / _cellSize ) );
+    int cy1 = (int)std::max( 0., std::floor( (y1 - _y1) / _cellSize ) );
+    int cx2 = (int)std::min( (double)_nx - 1, std::floor( (x2 - _x1) / _cellSize ) );
+    int cy2 = (int)std::min( (double)_ny - 1, std::floor( (y2 - _y1) / _cellSize ) );
+
+    std::size_t firstFound = indices->size();
+    for (int cy = cy1; cy <= cy2; ++cy) {
+        for (int cx = cx1; cx <= cx2; ++cx) {
+            const std::vector<int>& cell = _cells[cy * _nx + cx];
+            for (std::size_t i = 0; i < cell.size(); ++i) {
+                const Point& p = _points[cell[i]];
+                if ( (p.x >= x1) && (p.x <= x2) && (p.y >= y1) && (p.y <= y2) ) {
+                    indices->push_back(cell[i]);
+                }
+            }
+        }
+    }
+    std::sort(indices->begin() + firstFound, indices->end());
+} // getPointsInRect
+
+/**
+ * @brief Everything the interact needs to pick the points and the curve of a Bezier at a given time
+ * without evaluating all control points.
+ **/
+struct BezierPickingIndex
+{
+    // Identifies the shape, the time, the view and the transform the index was built for
+    U64 key;
+
+    // The control points and feather points of the shape, in order
+    std::vector<BezierCPPtr> cps, fps;
+
+    // The positions of the points with the transform applied, and without the transform
+    PointsGrid transformedCps, transformedFps, untransformedCps, untransformedFps;
+
+    // The bounding box of the polygons drawn by the interact for the curve and the feather, with the transform applied
+    RectD curveBbox, featherBbox;
+    bool hasCurve, hasFeather;
+
+    BezierPickingIndex()
+    : key(0)
+    , cps()
+    , fps()
+    , transformedCps()
+    , transformedFps()
+    , untransformedCps()
+    , untransformedFps()
+    , curveBbox()
+    , featherBbox()
+    , hasCurve(false)
+    , hasFeather(false)
+    {
+    }
+};
+
 struct BezierPrivate
 {
     mutable QMutex itemMutex; //< protects points & featherPoits
@@ -133,12 +324,20 @@ struct BezierPrivate
     // When it is a render clone, we cache the result of getBoundingBox()
     boost::scoped_ptr<std::map<TimeValue,RectD> > renderCloneBBoxCache;
 
+    // Shared by evaluateAtTime(), evaluateFeatherPointsAtTime() and isPointOnCurve()
+    BezierFlatteningCachePtr flatteningCache;
+
+    // Used by the interact for picking, only on the main instance. Protected by itemMutex
+    mutable boost::scoped_ptr<BezierPickingIndex> pickingIndex;
+
     BezierPrivate(const std::string& baseName, bool isOpenBezier)
     : itemMutex()
     , viewShapes()
     , isOpenBezier(isOpenBezier)
     , baseName(baseName)
     , renderCloneBBoxCache()
+    , flatteningCache(new BezierFlatteningCache)
+    , pickingIndex()
     {
         viewShapes.insert(std::make_pair(ViewIdx(0), BezierShape()));
     }
@@ -147,6 +346,8 @@ struct BezierPrivate
     : itemMutex()
     , viewShapes()
     , renderCloneBBoxCache()
+    , flatteningCache(other.flatteningCache)
+    , pickingIndex()
     {
         isOpenBezier = other.isOpenBezier;
         baseName = other.baseName;
@@ -176,21 +377,46 @@ struct BezierPrivate
     
     BezierCPs::iterator atIndex(int index, BezierShape& shape);
     
-    BezierCPs::const_iterator findControlPointNearby(double x,
-                                                     double y,
-                                                     double acceptance,
-                                                     TimeValue time,
-                                                     const BezierShape& shape,
-                                                     const Transform::Matrix3x3& transform,
-                                                     int* index) const;
-    
-    BezierCPs::const_iterator findFeatherPointNearby(double x,
-                                                     double y,
-                                                     double acceptance,
-                                                     TimeValue time,
-                                                     const BezierShape& shape,
-                                                     const Transform::Matrix3x3& transform,
-                                                     int* index) const;
+    /**
+     * @brief Returns the index of the first point of the given grid within acceptance of (x,y), or -1
+     **/
+    static int findPointNearby(double x,
+                               double y,
+                               double acceptance,
+                               const PointsGrid& grid);
+
+    /**
+     * @brief Returns the picking index of the shape, built again if the key changed. The itemMutex must be locked.
+     * @param key The value returned by getPickingIndexKey()
+     **/
+    const BezierPickingIndex& getPickingIndex(U64 key,
+                                              const BezierShape& shape,
+                                              TimeValue time,
+                                              const Transform::Matrix3x3& transform,
+                                              bool useFeatherPoints) const;
+
+    /**
+     * @brief Same as Bezier::isClockwiseOriented() but the itemMutex must be locked.
+     **/
+    bool isClockwiseOrientedInternal(const BezierShape& shape, TimeValue time) const;
+
+    /**
+     * @brief Same as Bezier::deCasteljau() but the result is looked-up in the flattening cache first.
+     * The featherDistance is only applied when not zero, in which case the clockWise flag is used.
+     * The polygon is flattened once for all feather distances.
+     **/
+    void evaluateShape(const BezierCPs& cps,
+                       TimeValue time,
+                       const RenderScale &scale,
+                       double featherDistance,
+                       bool finished,
+                       bool clockWise,
+                       Bezier::DeCasteljauAlgorithmEnum algo,
+                       int nbPointsPerSegment,
+                       double errorScale,
+                       const Transform::Matrix3x3& transform,
+                       std::vector<ParametricPoint >* pointsSingleList,
+                       RectD* bbox) const;
 };
 
 
@@ -338,61 +564,98 @@ BezierPrivate::atIndex(int index, BezierShape& shape)
 }
 
 
-BezierCPs::const_iterator
-BezierPrivate::findControlPointNearby(double x,
-                                      double y,
-                                      double acceptance,
-                                      TimeValue time,
-                                      const BezierShape& shape,
-                                      const Transform::Matrix3x3& transform,
-                                      int* index) const
+int
+BezierPrivate::findPointNearby(double x,
+                               double y,
+                               double acceptance,
+                               const PointsGrid& grid)
 {
-    // PRIVATE - should not lock
-    int i = 0;
-    
-    for (BezierCPs::const_iterator it = shape.points.begin(); it != shape.points.end(); ++it, ++i) {
-        Transform::Point3D p;
-        p.z = 1;
-        (*it)->getPositionAtTime(time, &p.x, &p.y);
-        p = Transform::matApply(transform, p);
-        if ( ( p.x >= (x - acceptance) ) && ( p.x <= (x + acceptance) ) && ( p.y >= (y - acceptance) ) && ( p.y <= (y + acceptance) ) ) {
-            *index = i;
-            
-            return it;
-        }
-    }
-    
-    return shape.points.end();
+    std::vector<int> indices;
+    grid.getPointsInRect(x - acceptance, y - acceptance, x + acceptance, y + acceptance, &indices);
+    return indices.empty() ? -1 : indices.front();
 }
 
-BezierCPs::const_iterator
-BezierPrivate::findFeatherPointNearby(double x,
-                                      double y,
-                                      double acceptance,
-                                      TimeValue time,
-                                      const BezierShape& shape,
-                                      const Transform::Matrix3x3& transform,
-                                      int* index) const
+/**
+ * @brief Returns a key identifying everything the picking index of the bezier depends on.
+ * This must be called before locking the itemMutex since the hash of the item reads the control points.
+ **/
+static U64
+getPickingIndexKey(const Bezier* bezier,
+                   TimeValue time,
+                   ViewIdx view,
+                   const Transform::Matrix3x3& transform)
+{
+    HashableObject::ComputeHashArgs args;
+    args.time = time;
+    args.view = view;
+    args.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+
+    Hash64 hash;
+    hash.append( const_cast<Bezier*>(bezier)->computeHash(args) );
+    hash.append( (double)time );
+    hash.append( (int)view );
+    for (int i = 0; i < 9; ++i) {
+        hash.append(transform.m[i]);
+    }
+    hash.computeHash();
+    return hash.value();
+} // getPickingIndexKey
+
+const BezierPickingIndex&
+BezierPrivate::getPickingIndex(U64 key,
+                               const BezierShape& shape,
+                               TimeValue time,
+                               const Transform::Matrix3x3& transform,
+                               bool useFeatherPoints) const
 {
     // PRIVATE - should not lock
-    int i = 0;
-    
-    for (BezierCPs::const_iterator it = shape.featherPoints.begin(); it != shape.featherPoints.end(); ++it, ++i) {
-        Transform::Point3D p;
-        p.z = 1;
-        (*it)->getPositionAtTime(time, &p.x, &p.y);
-        p = Transform::matApply(transform, p);
-        if ( ( p.x >= (x - acceptance) ) && ( p.x <= (x + acceptance) ) && ( p.y >= (y - acceptance) ) && ( p.y <= (y + acceptance) ) ) {
-            *index = i;
-            
-            return it;
+    assert(!itemMutex.tryLock());
+
+    if ( pickingIndex && (pickingIndex->key == key) &&
+         ( pickingIndex->cps.size() == shape.points.size() ) &&
+         ( pickingIndex->fps.size() == shape.featherPoints.size() ) ) {
+        return *pickingIndex;
+    }
+
+    pickingIndex.reset(new BezierPickingIndex);
+    pickingIndex->key = key;
+    pickingIndex->cps.assign( shape.points.begin(), shape.points.end() );
+    pickingIndex->fps.assign( shape.featherPoints.begin(), shape.featherPoints.end() );
+
+    for (int c = 0; c < 2; ++c) {
+        const std::vector<BezierCPPtr>& points = c == 0 ? pickingIndex->cps : pickingIndex->fps;
+        std::vector<Point> transformedPoints( points.size() ), untransformedPoints( points.size() );
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            Transform::Point3D p;
+            p.z = 1;
+            points[i]->getPositionAtTime(time, &p.x, &p.y);
+            untransformedPoints[i].x = p.x;
+            untransformedPoints[i].y = p.y;
+            p = Transform::matApply(transform, p);
+            transformedPoints[i].x = p.x;
+            transformedPoints[i].y = p.y;
+        }
+        (c == 0 ? pickingIndex->transformedCps : pickingIndex->transformedFps).build(transformedPoints);
+        (c == 0 ? pickingIndex->untransformedCps : pickingIndex->untransformedFps).build(untransformedPoints);
+    }
+
+    // The bounding boxes of the polygons tested by isPointOnCurve(), they are flattened with the same parameters
+    // so that the flattening cache returns them when the point is close enough to be tested
+    if (shape.points.size() > 1) {
+        std::vector<ParametricPoint> polygon;
+        evaluateShape(shape.points, time, RenderScale(1.), 0 /*featherDistance*/, shape.finished, false /*clockWise*/,
+                      Bezier::eDeCasteljauAlgorithmRecursive, -1, 1., transform, &polygon, &pickingIndex->curveBbox);
+        pickingIndex->hasCurve = !polygon.empty();
+        if ( useFeatherPoints && ( shape.featherPoints.size() == shape.points.size() ) ) {
+            polygon.clear();
+            evaluateShape(shape.featherPoints, time, RenderScale(1.), 0 /*featherDistance*/, shape.finished, false /*clockWise*/,
+                          Bezier::eDeCasteljauAlgorithmRecursive, -1, 1., transform, &polygon, &pickingIndex->featherBbox);
+            pickingIndex->hasFeather = !polygon.empty();
         }
     }
-    
-    return shape.featherPoints.end();
-}
-
 
+    return *pickingIndex;
+} // getPickingIndex
 
 static inline double
 lerp(double a,
@@ -1074,80 +1337,61 @@ bezierSegmentEval(const Point& p0,
 } // bezierSegmentEval
 
 /**
- * @brief Determines if the point (x,y) lies on the Bezier curve segment defined by first and last.
- * @returns True if the point is close (according to the acceptance) to the curve, false otherwise.
- * @param param[out] It is set to the parametric value at which the subdivision of the Bezier segment
- * yields the closest point to (x,y) on the curve.
+ * @brief Determines if the point (x,y) lies on the polygon resulting of the subdivision of a Bezier.
+ * @returns The index of the Bezier segment of the closest point of the polygon to (x,y) if it is closer than distance, -1 otherwise.
+ * @param closed Whether the last point of the polygon is connected to the first one
+ * @param nSegments The number of Bezier segments of the curve
+ * @param sqDistance[out] The square distance between the closest point and (x,y)
+ * @param param[out] It is set to the parametric value of the closest point in the Bezier segment.
  **/
-static bool
-bezierSegmentMeetsPoint(const BezierCP & first,
-                        const BezierCP & last,
-                        const Transform::Matrix3x3& transform,
-                        TimeValue time,
-                        double x,
-                        double y,
-                        double distance,
-                        double *param) ///< output
+static int
+polygonMeetsPoint(const std::vector<ParametricPoint>& polygon,
+                  bool closed,
+                  int nSegments,
+                  double x,
+                  double y,
+                  double distance,
+                  double* sqDistance, ///< output
+                  double *param) ///< output
 {
-    Transform::Point3D p0, p1, p2, p3;
-
-    p0.z = p1.z = p2.z = p3.z = 1;
-
-    first.getPositionAtTime(time, &p0.x, &p0.y);
-    first.getRightBezierPointAtTime(time, &p1.x, &p1.y);
-    last.getPositionAtTime(time, &p3.x, &p3.y);
-    last.getLeftBezierPointAtTime(time, &p2.x, &p2.y);
-
-    p0 = Transform::matApply(transform, p0);
-    p1 = Transform::matApply(transform, p1);
-    p2 = Transform::matApply(transform, p2);
-    p3 = Transform::matApply(transform, p3);
+    if ( polygon.empty() || (nSegments <= 0) ) {
+        return -1;
+    }
 
-    ///Use the control polygon to approximate segment length
-    double length = ( std::sqrt( (p1.x - p0.x) * (p1.x - p0.x) + (p1.y - p0.y) * (p1.y - p0.y) ) +
-                      std::sqrt( (p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y) ) +
-                      std::sqrt( (p3.x - p2.x) * (p3.x - p2.x) + (p3.y - p2.y) * (p3.y - p2.y) ) );
-    // increment is the distance divided by the  segment length
-    double incr = length == 0. ? 1. : distance / length;
-    Point p02d, p12d, p22d, p32d;
-    {
-        p02d.x = p0.x; p02d.y = p0.y;
-        p12d.x = p1.x; p12d.y = p1.y;
-        p22d.x = p2.x; p22d.y = p2.y;
-        p32d.x = p3.x; p32d.y = p3.y;
-    }
-    ///the minimum square distance between a decasteljau point an the given (x,y) point
-    ///we save a sqrt call
-    double sqDistance = distance * distance;
-    double minSqDistance = std::numeric_limits<double>::infinity();
+    double minSqDistance = distance * distance;
     double tForMin = -1.;
-    // 1/incr = 0.9 -> 2 points   +                + o
-    // 1/incr = 1.0 -> 2 points   +                o
-    // 1/incr = 1.1 -> 3 points   +              o +
-    // 1/incr = 2.0 -> 3 points   +        o       o
-    // 1/incr = 2.1 -> 4 points   +       o       o+
-    int nbPoints = std::ceil(1. / incr) + 1;
-    for (int i = 0; i < nbPoints; ++i) {
-        double t = std::min(i * incr, 1.);
-        // the last point should be t == 1;
-        assert( t < 1 || (t == 1. && i == nbPoints - 1) );
-        Point p;
-        Bezier::bezierPoint(p02d, p12d, p22d, p32d, t, &p);
-        double sqdist = (p.x - x) * (p.x - x) + (p.y - y) * (p.y - y);
-        if ( (sqdist <= sqDistance) && (sqdist < minSqDistance) ) {
+
+    // When the polygon is closed, its last point is the first control point
+    std::size_t i = closed ? 0 : 1;
+    for (; i < polygon.size(); ++i) {
+        const ParametricPoint& a = i == 0 ? polygon.back() : polygon[i - 1];
+        const ParametricPoint& b = polygon[i];
+        double ta = i == 0 ? 0. : a.t;
+
+        // Project (x,y) on the [a,b] edge
+        double dx = b.x - a.x;
+        double dy = b.y - a.y;
+        double sqLength = dx * dx + dy * dy;
+        double u = sqLength == 0. ? 0. : ( (x - a.x) * dx + (y - a.y) * dy ) / sqLength;
+        u = std::max(0., std::min(u, 1.));
+        double px = a.x + u * dx;
+        double py = a.y + u * dy;
+        double sqdist = (px - x) * (px - x) + (py - y) * (py - y);
+        if (sqdist <= minSqDistance) {
             minSqDistance = sqdist;
-            tForMin = t;
+            tForMin = ta + u * (b.t - ta);
         }
     }
 
-    if (minSqDistance <= sqDistance) {
-        *param = tForMin;
-
-        return true;
+    if (tForMin < 0) {
+        return -1;
     }
 
-    return false;
-} // bezierSegmentMeetsPoint
+    int index = std::min( (int)std::floor(tForMin), nSegments - 1 );
+    *param = std::min(tForMin - index, 1.);
+    *sqDistance = minSqDistance;
+    return index;
+} // polygonMeetsPoint
 
 static bool
 isPointCloseTo(TimeValue time,
@@ -1351,6 +1595,12 @@ Bezier::addControlPoint(double x,
 void
 Bezier::evaluateCurveModified()
 {
+    // The hash is not invalidated below while the curve is not finished but the points moved
+    {
+        QMutexLocker l(&_imp->itemMutex);
+        _imp->pickingIndex.reset();
+    }
+
     // If the curve is not finished, do not evaluate.
     if (!isOpenBezier()) {
         bool hasCurveFinished = false;
@@ -1618,6 +1868,7 @@ Bezier::isPointOnCurve(double x,
 
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, view_i, &transform);
+    U64 pickingKey = getPickingIndexKey(this, time, view_i, transform);
 
     QMutexLocker l(&_imp->itemMutex);
 
@@ -1650,51 +1901,44 @@ Bezier::isPointOnCurve(double x,
         return -1;
     }
 
-    ///For each segment find out if the point lies on the bezier
-    int index = 0;
-    bool useFeather = useFeatherPoints();
-
-    assert( shape->featherPoints.size() == shape->points.size() || !useFeather);
-
-    BezierCPs::const_iterator fp = shape->featherPoints.begin();
-    for (BezierCPs::const_iterator it = shape->points.begin(); it != shape->points.end(); ++it, ++index) {
-        BezierCPs::const_iterator next = it;
-        BezierCPs::const_iterator nextFp = fp;
-
-        if ( useFeather && ( nextFp != shape->featherPoints.end() ) ) {
-            ++nextFp;
-        }
-        if ( next != shape->points.end() ) {
-            ++next;
-        }
-        if ( next == shape->points.end() ) {
-            if (!shape->finished) {
-                return -1;
-            } else {
-                next = shape->points.begin();
-                if (useFeather) {
-                    nextFp = shape->featherPoints.begin();
-                }
-            }
-        }
-        if ( bezierSegmentMeetsPoint(*(*it), *(*next), transform, time, x, y, distance, t) ) {
-            *feather = false;
+    // Most shapes are far from the point: reject them without evaluating the curve
+    const BezierPickingIndex& picking = _imp->getPickingIndex(pickingKey, *shape, time, transform, useFeatherPoints());
+    bool nearCurve = picking.hasCurve &&
+                     x >= picking.curveBbox.x1 - distance && x <= picking.curveBbox.x2 + distance &&
+                     y >= picking.curveBbox.y1 - distance && y <= picking.curveBbox.y2 + distance;
+    bool nearFeather = picking.hasFeather &&
+                       x >= picking.featherBbox.x1 - distance && x <= picking.featherBbox.x2 + distance &&
+                       y >= picking.featherBbox.y1 - distance && y <= picking.featherBbox.y2 + distance;
+    if (!nearCurve && !nearFeather) {
+        return -1;
+    }
 
-            return index;
-        }
+    // Test the polygons used to draw the curve in the interact so that they are taken from the flattening cache
+    bool closed = shape->finished && !isOpenBezier();
+    int nSegments = closed ? (int)shape->points.size() : (int)shape->points.size() - 1;
+    std::vector<ParametricPoint> polygon;
+    _imp->evaluateShape(shape->points, time, RenderScale(1.), 0 /*featherDistance*/, shape->finished, false /*clockWise*/,
+                        eDeCasteljauAlgorithmRecursive, -1, 1., transform, &polygon, 0);
+    double sqDistance;
+    int index = polygonMeetsPoint(polygon, closed, nSegments, x, y, distance, &sqDistance, t);
+    *feather = false;
 
-        if ( useFeather && bezierSegmentMeetsPoint(**fp, **nextFp, transform, time,  x, y, distance, t) ) {
+    if ( useFeatherPoints() ) {
+        assert( shape->featherPoints.size() == shape->points.size() );
+
+        std::vector<ParametricPoint> featherPolygon;
+        _imp->evaluateShape(shape->featherPoints, time, RenderScale(1.), 0 /*featherDistance*/, shape->finished, false /*clockWise*/,
+                            eDeCasteljauAlgorithmRecursive, -1, 1., transform, &featherPolygon, 0);
+        double featherSqDistance, featherT;
+        int featherIndex = polygonMeetsPoint(featherPolygon, closed, nSegments, x, y, distance, &featherSqDistance, &featherT);
+        if ( (featherIndex != -1) && ( (index == -1) || (featherSqDistance < sqDistance) ) ) {
+            index = featherIndex;
+            *t = featherT;
             *feather = true;
-
-            return index;
-        }
-        if (useFeather) {
-            ++fp;
         }
     }
 
-
-    return -1;
+    return index;
 } // isPointOnCurve
 
 void
@@ -3110,35 +3354,107 @@ Bezier::onKeyFrameMoved(const Curve* curve, const KeyFrame& from, const KeyFrame
 } // onKeyFrameMoved
 
 
-void
-Bezier::deCasteljau(bool isOpenBezier,
-                    const std::list<BezierCPPtr>& cps,
-                    TimeValue time,
+/**
+ * @brief Computes the direction in which each point of the polygon is expanded to the feather distance.
+ **/
+static void
+computePolygonNormals(const std::vector<ParametricPoint>& polygon,
+                      std::vector<Point>* normals)
+{
+    normals->resize(polygon.size());
+    if ( polygon.empty() ) {
+        return;
+    }
+    std::vector<ParametricPoint>::const_iterator it = polygon.begin();
+    std::vector<ParametricPoint>::const_iterator next = it;
+    ++next;
+    std::vector<ParametricPoint>::const_iterator prev = polygon.end();
+    --prev;
+    std::vector<Point>::iterator outIt = normals->begin();
+    for (; it != polygon.end(); ++it, ++prev, ++next, ++outIt) {
+        if ( prev == polygon.end() ) {
+            prev = polygon.begin();
+        }
+        if ( next == polygon.end() ) {
+            next = polygon.begin();
+        }
+        double diffx = next->x - prev->x;
+        double diffy = next->y - prev->y;
+        double norm = std::sqrt( diffx * diffx + diffy * diffy );
+        outIt->x = (norm != 0) ? -( diffy / norm ) : 0;
+        outIt->y = (norm != 0) ? ( diffx / norm ) : 1;
+    }
+} // computePolygonNormals
+
+/**
+ * @brief Expands each point of the polygon along its normal to the feather distance.
+ **/
+static void
+offsetPolygon(const std::vector<ParametricPoint>& polygon,
+              const std::vector<Point>& normals,
+              double featherDistance,
+              const RenderScale &scale,
+              bool clockWise,
+              std::vector<ParametricPoint>* offsetPoints)
+{
+    assert( normals.size() == polygon.size() );
+    double featherX = featherDistance * scale.x;
+    double featherY = featherDistance * scale.y;
+    if (!clockWise) {
+        featherX = -featherX;
+        featherY = -featherY;
+    }
+    offsetPoints->resize( polygon.size() );
+    for (std::size_t i = 0; i < polygon.size(); ++i) {
+        ParametricPoint& p = (*offsetPoints)[i];
+        p = polygon[i];
+        p.x += normals[i].x * featherX;
+        p.y += normals[i].y * featherY;
+    }
+} // offsetPolygon
+
+static void
+computePolygonBbox(const std::vector<ParametricPoint>& polygon,
+                   RectD* bbox)
+{
+    bool bboxSet = false;
+    for (std::size_t i = 0; i < polygon.size(); ++i) {
+        if (!bboxSet) {
+            bboxSet = true;
+            bbox->x1 = polygon[i].x;
+            bbox->x2 = polygon[i].x;
+            bbox->y1 = polygon[i].y;
+            bbox->y2 = polygon[i].y;
+        } else {
+            bbox->x1 = std::min(bbox->x1, polygon[i].x);
+            bbox->x2 = std::max(bbox->x2, polygon[i].x);
+            bbox->y1 = std::min(bbox->y1, polygon[i].y);
+            bbox->y2 = std::max(bbox->y2, polygon[i].y);
+        }
+    }
+} // computePolygonBbox
+
+static void
+deCasteljauInternal(bool isOpenBezier,
+                    const std::list<BezierPoint>& evaluatedPoints,
                     const RenderScale &scale,
                     double featherDistance,
                     bool finished,
                     bool clockWise,
-                    DeCasteljauAlgorithmEnum algo,
+                    Bezier::DeCasteljauAlgorithmEnum algo,
                     int nbPointsPerSegment,
                     double errorScale,
-                    const Transform::Matrix3x3& transform,
                     std::vector<ParametricPoint>* pointsSingleList,
                     RectD* bbox)
 {
-    assert(!cps.empty());
     assert(pointsSingleList);
 
-
-
     {
         // Do not expand the control polygon points to the feather distance otherwise the feather will have a Bezier that differs from the original bezier
         // instead, we expand each discretized point.
-        std::list<BezierPoint> evaluatedPoints;
-        getBezierPoints(cps, time, transform, evaluatedPoints);
-
         int segmentIndex = 0;
-        std::list<BezierPoint>::iterator it = evaluatedPoints.begin();
-        std::list<BezierPoint>::iterator next = it;
+        std::list<BezierPoint>::const_iterator it = evaluatedPoints.begin();
+        std::list<BezierPoint>::const_iterator next = it;
         ++next;
         for (; it != evaluatedPoints.end(); ++it, ++next, ++segmentIndex) {
             if (next == evaluatedPoints.end()) {
@@ -3166,65 +3482,160 @@ Bezier::deCasteljau(bool isOpenBezier,
             p3.x *= scale.x;
             p3.y *= scale.y;
 
-            bezierSegmentEval(p0, p1, p2, p3, segmentIndex, !isOpenBezier /*skipFirstPoint*/, algo, nbPointsPerSegment, errorScale, pointsSingleList, 0);
+            // The first point of a segment is the last point of the previous one, except for the first segment of a shape which is not closed
+            bool skipFirstPoint = !isOpenBezier && (finished || segmentIndex > 0);
+            bezierSegmentEval(p0, p1, p2, p3, segmentIndex, skipFirstPoint, algo, nbPointsPerSegment, errorScale, pointsSingleList, 0);
         } // for each control point
     }
 
-    
+
     // Expand points to feather distance if needed
     if (featherDistance != 0) {
-        double featherX = featherDistance * scale.x;
-        double featherY = featherDistance * scale.y;
+        std::vector<Point> normals;
+        computePolygonNormals(*pointsSingleList, &normals);
+        std::vector<ParametricPoint> polygon;
+        polygon.swap(*pointsSingleList);
+        offsetPolygon(polygon, normals, featherDistance, scale, clockWise, pointsSingleList);
+    }
 
-        std::vector<ParametricPoint > pointsCopy = *pointsSingleList;
-        std::vector<ParametricPoint >::iterator it = pointsCopy.begin();
-        std::vector<ParametricPoint >::iterator outIt = pointsSingleList->begin();
-        std::vector<ParametricPoint >::iterator next = it;
-        ++next;
-        std::vector<ParametricPoint >::iterator prev = pointsCopy.end();
-        --prev;
-        for (;it != pointsCopy.end(); ++it, ++prev, ++next, ++outIt) {
-            if (prev == pointsCopy.end()) {
-                prev = pointsCopy.begin();
-            }
-            if (next == pointsCopy.end()) {
-                next = pointsCopy.begin();
-            }
-            double diffx = next->x - prev->x;
-            double diffy = next->y - prev->y;
-            double norm = std::sqrt( diffx * diffx + diffy * diffy );
-            double dx = (norm != 0) ? -( diffy / norm ) : 0;
-            double dy = (norm != 0) ? ( diffx / norm ) : 1;
-
-            if (!clockWise) {
-                outIt->x -= dx * featherX;
-                outIt->y -= dy * featherY;
-            } else {
-                outIt->x += dx * featherX;
-                outIt->y += dy * featherY;
-            }
+    if (bbox) {
+        computePolygonBbox(*pointsSingleList, bbox);
+    }
+
+} // deCasteljauInternal
+
+void
+Bezier::deCasteljau(bool isOpenBezier,
+                    const std::list<BezierCPPtr>& cps,
+                    TimeValue time,
+                    const RenderScale &scale,
+                    double featherDistance,
+                    bool finished,
+                    bool clockWise,
+                    DeCasteljauAlgorithmEnum algo,
+                    int nbPointsPerSegment,
+                    double errorScale,
+                    const Transform::Matrix3x3& transform,
+                    std::vector<ParametricPoint>* pointsSingleList,
+                    RectD* bbox)
+{
+    assert(!cps.empty());
+
+    std::list<BezierPoint> evaluatedPoints;
+    getBezierPoints(cps, time, transform, evaluatedPoints);
+
+    deCasteljauInternal(isOpenBezier, evaluatedPoints, scale, featherDistance, finished, clockWise, algo, nbPointsPerSegment, errorScale, pointsSingleList, bbox);
+} // deCasteljau
+
+void
+BezierPrivate::evaluateShape(const BezierCPs& cps,
+                             TimeValue time,
+                             const RenderScale &scale,
+                             double featherDistance,
+                             bool finished,
+                             bool clockWise,
+                             Bezier::DeCasteljauAlgorithmEnum algo,
+                             int nbPointsPerSegment,
+                             double errorScale,
+                             const Transform::Matrix3x3& transform,
+                             std::vector<ParametricPoint >* pointsSingleList,
+                             RectD* bbox) const
+{
+    assert(!itemMutex.tryLock());
+    assert(pointsSingleList);
+    if ( cps.empty() ) {
+        return;
+    }
+
+    std::list<BezierPoint> evaluatedPoints;
+    getBezierPoints(cps, time, transform, evaluatedPoints);
+
+    // The evaluated points (which include the transform) and the subdivision parameters identify the polygon,
+    // whichever shape, time or view they come from.
+    U64 key;
+    {
+        Hash64 hash;
+        hash.append(isOpenBezier);
+        hash.append(finished);
+        hash.append(scale.x);
+        hash.append(scale.y);
+        hash.append((int)algo);
+        hash.append(nbPointsPerSegment);
+        hash.append(errorScale);
+        hash.append(evaluatedPoints.size());
+        for (std::list<BezierPoint>::const_iterator it = evaluatedPoints.begin(); it != evaluatedPoints.end(); ++it) {
+            hash.append(it->p.x);
+            hash.append(it->p.y);
+            hash.append(it->left.x);
+            hash.append(it->left.y);
+            hash.append(it->right.x);
+            hash.append(it->right.y);
         }
+        hash.computeHash();
+        key = hash.value();
     }
 
-    if (bbox) {
-        bool bboxSet = false;
-        for (std::size_t i = 0; i < pointsSingleList->size(); ++i) {
-            if (!bboxSet) {
-                bboxSet = true;
-                bbox->x1 = (*pointsSingleList)[i].x;
-                bbox->x2 = (*pointsSingleList)[i].x;
-                bbox->y1 = (*pointsSingleList)[i].y;
-                bbox->y2 = (*pointsSingleList)[i].y;
-            } else {
-                bbox->x1 = std::min(bbox->x1, (*pointsSingleList)[i].x);
-                bbox->x2 = std::max(bbox->x2, (*pointsSingleList)[i].x);
-                bbox->y1 = std::min(bbox->y1, (*pointsSingleList)[i].y);
-                bbox->y2 = std::max(bbox->y2, (*pointsSingleList)[i].y);
-            }
+    QMutexLocker k(&flatteningCache->lock);
+    std::list<FlattenedPolygon>& polygons = flatteningCache->polygons;
+    std::list<FlattenedPolygon>::iterator found = polygons.begin();
+    for (; found != polygons.end(); ++found) {
+        if (found->key == key) {
+            break;
+        }
+    }
+    if ( found != polygons.end() ) {
+        // Move it to the front of the list
+        polygons.splice(polygons.begin(), polygons, found);
+    } else {
+        FlattenedPolygon polygon;
+        polygon.key = key;
+        deCasteljauInternal(isOpenBezier, evaluatedPoints, scale, 0, finished, clockWise, algo, nbPointsPerSegment, errorScale, &polygon.points, &polygon.bbox);
+        polygons.push_front(polygon);
+        if (polygons.size() > BEZIER_FLATTENING_CACHE_SIZE) {
+            polygons.pop_back();
         }
     }
 
-} // deCasteljau
+    FlattenedPolygon& polygon = polygons.front();
+    if (featherDistance == 0) {
+        pointsSingleList->insert(pointsSingleList->end(), polygon.points.begin(), polygon.points.end());
+        if ( bbox && !polygon.points.empty() ) {
+            *bbox = polygon.bbox;
+        }
+        return;
+    }
+
+    std::list<FeatheredPolygon>& featheredPolygons = flatteningCache->featheredPolygons;
+    std::list<FeatheredPolygon>::iterator foundFeathered = featheredPolygons.begin();
+    for (; foundFeathered != featheredPolygons.end(); ++foundFeathered) {
+        if (foundFeathered->flatteningKey == key && foundFeathered->featherDistance == featherDistance && foundFeathered->clockWise == clockWise) {
+            break;
+        }
+    }
+    if ( foundFeathered != featheredPolygons.end() ) {
+        featheredPolygons.splice(featheredPolygons.begin(), featheredPolygons, foundFeathered);
+    } else {
+        if ( polygon.normals.empty() ) {
+            computePolygonNormals(polygon.points, &polygon.normals);
+        }
+        FeatheredPolygon feathered;
+        feathered.flatteningKey = key;
+        feathered.featherDistance = featherDistance;
+        feathered.clockWise = clockWise;
+        offsetPolygon(polygon.points, polygon.normals, featherDistance, scale, clockWise, &feathered.points);
+        computePolygonBbox(feathered.points, &feathered.bbox);
+        featheredPolygons.push_front(feathered);
+        if (featheredPolygons.size() > BEZIER_FLATTENING_CACHE_SIZE) {
+            featheredPolygons.pop_back();
+        }
+    }
+
+    const FeatheredPolygon& feathered = featheredPolygons.front();
+    pointsSingleList->insert(pointsSingleList->end(), feathered.points.begin(), feathered.points.end());
+    if ( bbox && !feathered.points.empty() ) {
+        *bbox = feathered.bbox;
+    }
+} // evaluateShape
 
 
 
@@ -3241,27 +3652,24 @@ Bezier::evaluateAtTime(TimeValue time,
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, view, &transform);
 
-    bool clockWise = isClockwiseOriented(time, view);
-
     QMutexLocker l(&_imp->itemMutex);
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
     const BezierShape* shape = _imp->getViewShape(view_i);
     if (!shape) {
         return;
     }
-    deCasteljau(isOpenBezier(),
-                shape->points,
-                time,
-                scale,
-                0, /*featherDistance*/
-                shape->finished,
-                clockWise,
-                algo,
-                nbPointsPerSegment,
-                errorScale,
-                transform,
-                pointsSingleList,
-                bbox);
+    _imp->evaluateShape(shape->points,
+                        time,
+                        scale,
+                        0, /*featherDistance*/
+                        shape->finished,
+                        false, /*clockWise*/
+                        algo,
+                        nbPointsPerSegment,
+                        errorScale,
+                        transform,
+                        pointsSingleList,
+                        bbox);
 } // evaluateAtTime
 
 
@@ -3279,7 +3687,6 @@ Bezier::evaluateFeatherPointsAtTime(bool applyFeatherDistance,
 {
     assert( useFeatherPoints() );
 
-    bool clockWise = isClockwiseOriented(time, view);
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, view, &transform);
 
@@ -3296,23 +3703,54 @@ Bezier::evaluateFeatherPointsAtTime(bool applyFeatherDistance,
         return;
     }
 
-    deCasteljau(isOpenBezier(),
-                shape->featherPoints,
-                time,
-                scale,
-                featherDistance,
-                shape->finished,
-                clockWise,
-                algo,
-                nbPointsPerSegment,
-                errorScale,
-                transform,
-                pointsSingleList,
-                bbox);
+    // The orientation is only needed to offset the polygon
+    bool clockWise = featherDistance != 0 ? _imp->isClockwiseOrientedInternal(*shape, time) : false;
+
+    _imp->evaluateShape(shape->featherPoints,
+                        time,
+                        scale,
+                        featherDistance,
+                        shape->finished,
+                        clockWise,
+                        algo,
+                        nbPointsPerSegment,
+                        errorScale,
+                        transform,
+                        pointsSingleList,
+                        bbox);
 
 } // evaluateFeatherPointsAtTime
 
 
+void
+Bezier::getMotionBlurReferencePoints(TimeValue time,
+                                     ViewIdx view,
+                                     std::vector<Point>* points) const
+{
+    Transform::Matrix3x3 transform;
+    getTransformAtTime(time, view, &transform);
+
+    QMutexLocker l(&_imp->itemMutex);
+    ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
+    const BezierShape* shape = _imp->getViewShape(view_i);
+    if (!shape) {
+        return;
+    }
+
+    std::list<BezierPoint> evaluatedPoints;
+    if ( !shape->points.empty() ) {
+        getBezierPoints(shape->points, time, transform, evaluatedPoints);
+    }
+    if ( !shape->featherPoints.empty() ) {
+        getBezierPoints(shape->featherPoints, time, transform, evaluatedPoints);
+    }
+    for (std::list<BezierPoint>::const_iterator it = evaluatedPoints.begin(); it != evaluatedPoints.end(); ++it) {
+        points->push_back(it->p);
+        points->push_back(it->left);
+        points->push_back(it->right);
+    }
+} // getMotionBlurReferencePoints
+
 RectD
 Bezier::getBoundingBox(TimeValue time, ViewIdx view) const
 {
@@ -3375,8 +3813,8 @@ Bezier::getBoundingBox(TimeValue time, ViewIdx view) const
 
         if (!_imp->renderCloneBBoxCache) {
             _imp->renderCloneBBoxCache.reset(new std::map<TimeValue,RectD>);
-            _imp->renderCloneBBoxCache->insert(std::make_pair(time, pointsBbox));
         }
+        _imp->renderCloneBBoxCache->insert(std::make_pair(time, pointsBbox));
     }
     return pointsBbox;
 } // Bezier::getBoundingBox
@@ -3424,58 +3862,39 @@ Bezier::isNearbyControlPoint(double x,
     ///only called on the main-thread
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, view, &transform);
+    ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
+    U64 pickingKey = getPickingIndexKey(this, time, view_i, transform);
+
     QMutexLocker l(&_imp->itemMutex);
     BezierCPPtr cp, fp;
-    ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
 
     const BezierShape* shape = _imp->getViewShape(view_i);
     if (!shape) {
         return std::make_pair(cp, fp);
     }
+    const BezierPickingIndex& picking = _imp->getPickingIndex(pickingKey, *shape, time, transform, useFeatherPoints());
     switch (pref) {
     case eControlPointSelectionPrefFeatherFirst: {
-        BezierCPs::const_iterator itF = _imp->findFeatherPointNearby(x, y, acceptance, time, *shape, transform, index);
-        if ( itF != shape->featherPoints.end() ) {
-            fp = *itF;
-            BezierCPs::const_iterator it = shape->points.begin();
-            std::advance(it, *index);
-            cp = *it;
-
-            return std::make_pair(fp, cp);
-        } else {
-            BezierCPs::const_iterator it = _imp->findControlPointNearby(x, y, acceptance, time, *shape, transform, index);
-            if ( it != shape->points.end() ) {
-                cp = *it;
-                itF = shape->featherPoints.begin();
-                std::advance(itF, *index);
-                fp = *itF;
-
-                return std::make_pair(cp, fp);
-            }
+        *index = BezierPrivate::findPointNearby(x, y, acceptance, picking.transformedFps);
+        if ( (*index != -1) && ( *index < (int)picking.cps.size() ) ) {
+            return std::make_pair(picking.fps[*index], picking.cps[*index]);
+        }
+        *index = BezierPrivate::findPointNearby(x, y, acceptance, picking.transformedCps);
+        if ( (*index != -1) && ( *index < (int)picking.fps.size() ) ) {
+            return std::make_pair(picking.cps[*index], picking.fps[*index]);
         }
         break;
     }
     case eControlPointSelectionPrefControlPointFirst:
     case eControlPointSelectionPrefWhateverFirst:
     default: {
-        BezierCPs::const_iterator it = _imp->findControlPointNearby(x, y, acceptance, time, *shape, transform, index);
-        if ( it != shape->points.end() ) {
-            cp = *it;
-            BezierCPs::const_iterator itF = shape->featherPoints.begin();
-            std::advance(itF, *index);
-            fp = *itF;
-
-            return std::make_pair(cp, fp);
-        } else {
-            BezierCPs::const_iterator itF = _imp->findFeatherPointNearby(x, y, acceptance, time, *shape, transform, index);
-            if ( itF != shape->featherPoints.end() ) {
-                fp = *itF;
-                it = shape->points.begin();
-                std::advance(it, *index);
-                cp = *it;
-
-                return std::make_pair(fp, cp);
-            }
+        *index = BezierPrivate::findPointNearby(x, y, acceptance, picking.transformedCps);
+        if ( (*index != -1) && ( *index < (int)picking.fps.size() ) ) {
+            return std::make_pair(picking.cps[*index], picking.fps[*index]);
+        }
+        *index = BezierPrivate::findPointNearby(x, y, acceptance, picking.transformedFps);
+        if ( (*index != -1) && ( *index < (int)picking.cps.size() ) ) {
+            return std::make_pair(picking.fps[*index], picking.cps[*index]);
         }
         break;
     }
@@ -3593,53 +4012,38 @@ Bezier::controlPointsWithinRect(TimeValue time,
 
     ///only called on the main-thread
     assert( QThread::currentThread() == qApp->thread() );
-    QMutexLocker locker(&_imp->itemMutex);
-    int i = 0;
+    Transform::Matrix3x3 transform;
+    getTransformAtTime(time, view, &transform);
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
+    U64 pickingKey = getPickingIndexKey(this, time, view_i, transform);
+
+    QMutexLocker locker(&_imp->itemMutex);
 
     const BezierShape* shape = _imp->getViewShape(view_i);
     if (!shape) {
         return ret;
     }
+    const BezierPickingIndex& picking = _imp->getPickingIndex(pickingKey, *shape, time, transform, useFeatherPoints());
+    if ( picking.cps.size() != picking.fps.size() ) {
+        return ret;
+    }
+
+    std::vector<int> cpsInRect;
     if ( (mode == 0) || (mode == 1) ) {
-        for (BezierCPs::const_iterator it = shape->points.begin(); it != shape->points.end(); ++it, ++i) {
-            double x, y;
-            (*it)->getPositionAtTime(time,  &x, &y);
-            if ( ( x >= (l - acceptance) ) && ( x <= (r + acceptance) ) && ( y >= (b - acceptance) ) && ( y <= (t - acceptance) ) ) {
-                std::pair<BezierCPPtr, BezierCPPtr> p;
-                p.first = *it;
-                BezierCPs::const_iterator itF = shape->featherPoints.begin();
-                std::advance(itF, i);
-                p.second = *itF;
-                ret.push_back(p);
-            }
+        picking.untransformedCps.getPointsInRect(l - acceptance, b - acceptance, r + acceptance, t - acceptance, &cpsInRect);
+        for (std::size_t i = 0; i < cpsInRect.size(); ++i) {
+            ret.push_back( std::make_pair(picking.cps[cpsInRect[i]], picking.fps[cpsInRect[i]]) );
         }
     }
-    i = 0;
     if ( (mode == 0) || (mode == 2) ) {
-        for (BezierCPs::const_iterator it = shape->featherPoints.begin(); it != shape->featherPoints.end(); ++it, ++i) {
-            double x, y;
-            (*it)->getPositionAtTime(time,  &x, &y);
-            if ( ( x >= (l - acceptance) ) && ( x <= (r + acceptance) ) && ( y >= (b - acceptance) ) && ( y <= (t - acceptance) ) ) {
-                std::pair<BezierCPPtr, BezierCPPtr> p;
-                p.first = *it;
-                BezierCPs::const_iterator itF = shape->points.begin();
-                std::advance(itF, i);
-                p.second = *itF;
-
-                ///avoid duplicates
-                bool found = false;
-                for (std::list<std::pair<BezierCPPtr, BezierCPPtr> >::iterator it2 = ret.begin();
-                     it2 != ret.end(); ++it2) {
-                    if (it2->first == *itF) {
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) {
-                    ret.push_back(p);
-                }
+        std::vector<int> fpsInRect;
+        picking.untransformedFps.getPointsInRect(l - acceptance, b - acceptance, r + acceptance, t - acceptance, &fpsInRect);
+        for (std::size_t i = 0; i < fpsInRect.size(); ++i) {
+            ///avoid duplicates, both lists are sorted
+            if ( std::binary_search(cpsInRect.begin(), cpsInRect.end(), fpsInRect[i]) ) {
+                continue;
             }
+            ret.push_back( std::make_pair(picking.fps[fpsInRect[i]], picking.cps[fpsInRect[i]]) );
         }
     }
 
@@ -3930,12 +4334,18 @@ Bezier::isClockwiseOriented(TimeValue time, ViewIdx view) const
     if (!shape) {
         return false;
     }
+    return _imp->isClockwiseOrientedInternal(*shape, time);
+} // isClockwiseOriented
 
-    if (shape->points.size() <= 1) {
+bool
+BezierPrivate::isClockwiseOrientedInternal(const BezierShape& shape, TimeValue time) const
+{
+    assert(!itemMutex.tryLock());
+    if (shape.points.size() <= 1) {
         return false;
     } 
 
-    const BezierCPs& cps = shape->points;
+    const BezierCPs& cps = shape.points;
     double polygonSurface = 0.;
     std::vector<Point> allPoints;
 
@@ -3967,7 +4377,7 @@ Bezier::isClockwiseOriented(TimeValue time, ViewIdx view) const
             allPoints.push_back(p2);
 
             // If we are a closed Bezier or we are not on the last segment, remove the last point so we don't add duplicates
-            if (shape->finished && next == cps.end()) {
+            if (shape.finished && next == cps.end()) {
                 Point p3;
                 (*next)->getPositionAtTime(time, &p3.x, &p3.y);
                 allPoints.push_back(p3);
@@ -4012,7 +4422,7 @@ Bezier::isClockwiseOriented(TimeValue time, ViewIdx view) const
     return polygonSurface < 0;
 
 
-} // isFeatherPolygonClockwiseOriented
+} // isClockwiseOrientedInternal
 
 
 /**
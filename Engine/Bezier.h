@@ -199,6 +199,8 @@ public:
      * the cubic Bezier curve of the feather points or of the control points or not.
      * @returns The index of the starting control point (P0) of the Bezier segment on which the given
      * point lies. If the point doesn't belong to any Bezier segment of this curve then it will return -1.
+     * If several segments are close enough, the closest one is returned.
+     * The curve is approximated with the same polygon as evaluateAtTime() with the recursive algorithm at scale 1.
      **/
     int isPointOnCurve(double x, double y, double acceptance, TimeValue time, ViewIdx view, double *t, bool* feather) const;
 
@@ -441,6 +443,9 @@ public:
     /**
      * @brief Evaluates the spline at the given time and returns the list of all the points on the curve.
      * See deCasteljau for details about each parameter
+     * The last polygons computed are cached (along with the ones of evaluateFeatherPointsAtTime) and shared
+     * with the render clones: callers should use the same parameters to benefit from it. The recursive algorithm
+     * is adaptive: with an errorScale of 1 the polygon does not deviate from the curve by more than half a pixel at the given scale.
      **/
     void evaluateAtTime(TimeValue time,
                         ViewIdx view,
@@ -475,6 +480,11 @@ public:
      **/
     virtual RectD getBoundingBox(TimeValue time,ViewIdx view) const OVERRIDE;
 
+    /**
+     * @brief Returns the control points, feather points and their tangents with the transform applied
+     **/
+    virtual void getMotionBlurReferencePoints(TimeValue time, ViewIdx view, std::vector<Point>* points) const OVERRIDE FINAL;
+
     static RectD getBezierSegmentListBbox(const std::list<BezierCPPtr> & points,
                                           double featherDistance,
                                           TimeValue time,
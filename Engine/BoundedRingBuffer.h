@@ -0,0 +1,183 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_BOUNDEDRINGBUFFER_H
+#define NATRON_ENGINE_BOUNDEDRINGBUFFER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cassert>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_array.hpp>
+#endif
+
+#include <QtCore/QAtomicInt>
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A fixed size queue that any number of threads push to without locking, and one thread pops from.
+ * When the queue is full, the values are dropped and counted instead of blocking the producers.
+ *
+ * Each cell has a sequence number: a producer reserves the cell at the write position with a compare-and-swap
+ * if its sequence shows it was consumed, and publishes the value by incrementing the sequence.
+ * The consumer frees the cell by setting the sequence to the position of the next turn of the ring.
+ * T must be default constructible and should be cheap to copy, e.g: a record of fixed size.
+ **/
+template <typename T>
+class BoundedRingBuffer
+{
+    struct Cell
+    {
+        QAtomicInt sequence;
+        T value;
+    };
+
+public:
+
+    /**
+     * @brief The capacity is rounded up to a power of 2
+     **/
+    explicit BoundedRingBuffer(int capacity)
+    : _cells()
+    , _capacity(1)
+    , _enqueuePos()
+    , _dequeuePos(0)
+    , _droppedCount()
+    {
+        while (_capacity < capacity) {
+            _capacity *= 2;
+        }
+        _cells.reset(new Cell[_capacity]);
+        for (int i = 0; i < _capacity; ++i) {
+            storeRelease(_cells[i].sequence, i);
+        }
+    }
+
+    int getCapacity() const
+    {
+        return _capacity;
+    }
+
+    /**
+     * @brief Copies the value in the queue. Returns false if the queue is full, the value is then counted as dropped.
+     * Can be called by any thread.
+     **/
+    bool tryPush(const T& value)
+    {
+        Cell* cell;
+        int pos = loadAcquire(_enqueuePos);
+        for (;;) {
+            cell = &_cells[pos & (_capacity - 1)];
+            const int seq = loadAcquire(cell->sequence);
+            const int dif = (int)( (unsigned int)seq - (unsigned int)pos );
+            if (dif == 0) {
+                // The cell is free, reserve it
+                if ( _enqueuePos.testAndSetRelaxed( pos, (int)( (unsigned int)pos + 1 ) ) ) {
+                    break;
+                }
+                pos = loadAcquire(_enqueuePos);
+            } else if (dif < 0) {
+                // The consumer did not free the cell yet: the queue is full
+                _droppedCount.fetchAndAddRelaxed(1);
+
+                return false;
+            } else {
+                // Another producer reserved the cell
+                pos = loadAcquire(_enqueuePos);
+            }
+        }
+        cell->value = value;
+        storeRelease( cell->sequence, (int)( (unsigned int)pos + 1 ) );
+
+        return true;
+    }
+
+    /**
+     * @brief Copies the oldest value to value and removes it. Returns false if the queue is empty.
+     * Must only be called by one thread at a time.
+     **/
+    bool tryPop(T* value)
+    {
+        Cell& cell = _cells[_dequeuePos & (_capacity - 1)];
+        const int seq = loadAcquire(cell.sequence);
+        const int dif = (int)( (unsigned int)seq - ( (unsigned int)_dequeuePos + 1 ) );
+        if (dif < 0) {
+            return false;
+        }
+        assert(dif == 0);
+        *value = cell.value;
+        storeRelease( cell.sequence, (int)( (unsigned int)_dequeuePos + (unsigned int)_capacity ) );
+        _dequeuePos = (int)( (unsigned int)_dequeuePos + 1 );
+
+        return true;
+    }
+
+    /**
+     * @brief Returns the number of values dropped because the queue was full
+     **/
+    int getDroppedCount() const
+    {
+        return loadAcquire(_droppedCount);
+    }
+
+private:
+
+    static int loadAcquire(const QAtomicInt& v)
+    {
+#if QT_VERSION < 0x050000
+        return (int)v;
+#else
+        return v.loadAcquire();
+#endif
+    }
+
+    static void storeRelease(QAtomicInt& v, int value)
+    {
+#if QT_VERSION < 0x050000
+        v.fetchAndStoreRelease(value);
+#else
+        v.storeRelease(value);
+#endif
+    }
+
+    boost::scoped_array<Cell> _cells;
+    int _capacity;
+
+    // The position of the next push
+    QAtomicInt _enqueuePos;
+
+    // The position of the next pop, only used by the consumer
+    int _dequeuePos;
+
+    QAtomicInt _droppedCount;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_BOUNDEDRINGBUFFER_H
@@ -42,6 +42,9 @@
 #include "Global/StrUtils.h"
 
 #include "Engine/AppManager.h"
+#include "Engine/CPUInstructionSet.h"
+#include "Engine/RectD.h"
+#include "Engine/ThreadPlacement.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -69,6 +72,8 @@ public:
     std::list<std::pair<int, std::pair<int, int> > > frameRanges;
     bool rangeSet;
     bool enableRenderStats;
+    bool renderWritersConcurrently;
+    bool resumeRender;
     bool isEmpty;
     mutable QString imageFilename;
     QString breakpadPipeFilePath;
@@ -77,6 +82,30 @@ public:
     QString breakpadProcessFilePath;
     qint64 breakpadProcessPID;
     QString exportDocsPath;
+    QString instructionSet;
+    QString threadPlacement;
+    bool enableLockProfiling;
+    QString traceFile;
+    QString memoryTimelineFile;
+    int memoryTimelineIntervalMS;
+    bool lazyPython;
+    bool enableStartupProfiling;
+    int renderDaemonPort;
+    QString renderDaemonHost;
+    int metricsPort;
+    QString metricsFile;
+    int distributedWorkersCount;
+    QStringList distributedHosts;
+    bool hasRenderRegion;
+    double renderRegion[4];
+    QString cacheExportFile;
+    QStringList cacheExportNodes;
+    QString cacheImportFile;
+    QString batchManifest;
+    int batchMaxConcurrentProjects;
+    int batchMemoryBudgetMB;
+    QString frameQueueDirectory;
+    int frameQueueBatchSize;
 
     CLArgsPrivate()
         : args()
@@ -97,6 +126,8 @@ public:
         , frameRanges()
         , rangeSet(false)
         , enableRenderStats(false)
+        , renderWritersConcurrently(false)
+        , resumeRender(false)
         , isEmpty(true)
         , imageFilename()
         , breakpadPipeFilePath()
@@ -105,7 +136,31 @@ public:
         , breakpadProcessFilePath()
         , breakpadProcessPID(-1)
         , exportDocsPath()
+        , instructionSet()
+        , threadPlacement()
+        , enableLockProfiling(false)
+        , traceFile()
+        , memoryTimelineFile()
+        , memoryTimelineIntervalMS(0)
+        , lazyPython(false)
+        , enableStartupProfiling(false)
+        , renderDaemonPort(-1)
+        , renderDaemonHost()
+        , metricsPort(-1)
+        , metricsFile()
+        , distributedWorkersCount(0)
+        , distributedHosts()
+        , hasRenderRegion(false)
+        , cacheExportFile()
+        , cacheExportNodes()
+        , cacheImportFile()
+        , batchManifest()
+        , batchMaxConcurrentProjects(1)
+        , batchMemoryBudgetMB(0)
+        , frameQueueDirectory()
+        , frameQueueBatchSize(1)
     {
+        renderRegion[0] = renderRegion[1] = renderRegion[2] = renderRegion[3] = 0.;
     }
 
     void parse();
@@ -233,9 +288,37 @@ CLArgs::operator=(const CLArgs& other)
     _imp->frameRanges = other._imp->frameRanges;
     _imp->rangeSet = other._imp->rangeSet;
     _imp->enableRenderStats = other._imp->enableRenderStats;
+    _imp->renderWritersConcurrently = other._imp->renderWritersConcurrently;
+    _imp->resumeRender = other._imp->resumeRender;
     _imp->isEmpty = other._imp->isEmpty;
     _imp->imageFilename = other._imp->imageFilename;
     _imp->exportDocsPath = other._imp->exportDocsPath;
+    _imp->instructionSet = other._imp->instructionSet;
+    _imp->threadPlacement = other._imp->threadPlacement;
+    _imp->enableLockProfiling = other._imp->enableLockProfiling;
+    _imp->traceFile = other._imp->traceFile;
+    _imp->memoryTimelineFile = other._imp->memoryTimelineFile;
+    _imp->memoryTimelineIntervalMS = other._imp->memoryTimelineIntervalMS;
+    _imp->lazyPython = other._imp->lazyPython;
+    _imp->enableStartupProfiling = other._imp->enableStartupProfiling;
+    _imp->renderDaemonPort = other._imp->renderDaemonPort;
+    _imp->renderDaemonHost = other._imp->renderDaemonHost;
+    _imp->metricsPort = other._imp->metricsPort;
+    _imp->metricsFile = other._imp->metricsFile;
+    _imp->distributedWorkersCount = other._imp->distributedWorkersCount;
+    _imp->distributedHosts = other._imp->distributedHosts;
+    _imp->hasRenderRegion = other._imp->hasRenderRegion;
+    for (int i = 0; i < 4; ++i) {
+        _imp->renderRegion[i] = other._imp->renderRegion[i];
+    }
+    _imp->cacheExportFile = other._imp->cacheExportFile;
+    _imp->cacheExportNodes = other._imp->cacheExportNodes;
+    _imp->cacheImportFile = other._imp->cacheImportFile;
+    _imp->batchManifest = other._imp->batchManifest;
+    _imp->batchMaxConcurrentProjects = other._imp->batchMaxConcurrentProjects;
+    _imp->batchMemoryBudgetMB = other._imp->batchMemoryBudgetMB;
+    _imp->frameQueueDirectory = other._imp->frameQueueDirectory;
+    _imp->frameQueueBatchSize = other._imp->frameQueueBatchSize;
 }
 
 bool
@@ -295,6 +378,73 @@ CLArgs::printUsage(const std::string& programName)
         "  --settings name=value\n"
         "    Sets the named %1 setting to the given value. This is done after loading\n"
         "    the settings and prior to executing Python commands or loading the project.\n"
+        "  --instruction-set <name>\n"
+        "    Forces the CPU instruction set used by the image processing kernels\n"
+        "    instead of the best one supported by the processor. Possible values\n"
+        "    are scalar, sse2, avx2, avx512 and neon.\n"
+        "  --thread-placement <policy>\n"
+        "    Controls on which CPUs the render threads run, instead of the value of\n"
+        "    the settings. Possible values are none (any CPU), numa (the CPUs of a\n"
+        "    NUMA node) and core (a single CPU). With numa and core, the threads are\n"
+        "    spread evenly across the NUMA nodes.\n"
+        "  --lock-profile\n"
+        "    Records the time the render threads spend waiting for and holding the\n"
+        "    locks of the render engine (requests, cache, knobs, luts and Python GIL)\n"
+        "    and prints a report by lock site when %1 exits.\n"
+        "  --trace <file path>\n"
+        "    Records the timeline of the renders (renders of each node, cache\n"
+        "    look-ups, waits, OpenFX actions, GPU transfers and file I/O) in each\n"
+        "    thread and writes it when %1 exits, in the trace-event JSON format\n"
+        "    of chrome://tracing and https://ui.perfetto.dev.\n"
+        "  --memory-timeline <file path>\n"
+        "    Samples the size of each cache, the memory of the images in RAM and\n"
+        "    on the GPU, the length of the queue of images to free, the resident\n"
+        "    memory of %1 and the free RAM, and writes the samples when %1 exits,\n"
+        "    in JSON if the file ends with .json and in CSV otherwise.\n"
+        "  --memory-timeline-interval <milliseconds>\n"
+        "    The time between two samples of --memory-timeline. Defaults to 1000.\n"
+        "  --lazy-python\n"
+        "    In background mode, initializes Python only when it is first needed:\n"
+        "    for an expression, a callback or a PyPlug of the project, or a Python\n"
+        "    command. The init.py scripts and the Python PyPlugs are loaded at that\n"
+        "    time, not on startup.\n"
+        "  --startup-profile\n"
+        "    Prints the time spent in each phase of the launch (OpenGL, Python,\n"
+        "    settings, caches, plug-ins, project...) once the project is loaded.\n"
+        "  --daemon <port>\n"
+        "    Runs %1Renderer as a render daemon: the plug-ins, Python and the cache\n"
+        "    stay loaded and render jobs are received over HTTP on the given port of\n"
+        "    the local host. Each job gives a project, the Write nodes and the frame\n"
+        "    range to render, as in the options below:\n"
+        "      curl -X POST \"http://localhost:<port>/render?project=<project file\n"
+        "      path>&writer=<Write node>&frames=<frameRange>\"\n"
+        "    The writer option may be repeated. If omitted, all the Write nodes of\n"
+        "    the project are rendered. Add stats=1 to enable render statistics and\n"
+        "    concurrent=1 to render the Write nodes at the same time (see\n"
+        "    --concurrent-writers) and resume=1 to skip the frames already written\n"
+        "    (see --resume).\n"
+        "    The answer is sent when the render is finished. Jobs are rendered one\n"
+        "    after the other and the last loaded projects are kept in memory, so\n"
+        "    that they are not loaded again by the next jobs. A project is reloaded\n"
+        "    if its file changed. A POST on /quit stops the daemon.\n"
+        "    Jobs may also be submitted without waiting with a POST on /jobs and the\n"
+        "    same options. GET /jobs and GET /jobs/<id> return their state, progress\n"
+        "    and per-frame timings in JSON, GET /jobs/<id>/log streams their log\n"
+        "    and POST /jobs/<id>/cancel cancels them.\n"
+        "  --daemon-host <address>\n"
+        "    The address of the network interface on which the render daemon listens,\n"
+        "    instead of the local host. Warning: anyone who can reach it can render\n"
+        "    projects, which may run arbitrary Python code.\n"
+        "  --metrics-port <port>\n"
+        "    Serves render metrics in the Prometheus text format on\n"
+        "    http://<host>:<port>/metrics: frames rendered, frame render times,\n"
+        "    time spent by each node (with render statistics), cache size and hit\n"
+        "    rate, thread pool usage, resident memory and GPU memory. This works with\n"
+        "    %1 and %1Renderer.\n"
+        "  --metrics-file <file path>\n"
+        "    Writes the same metrics to the given file every few seconds and when\n"
+        "    %1 exits, e.g. for the textfile collector of the Prometheus node\n"
+        "    exporter.\n"
         "  -c [ --cmd ] \"PythonCommand\"\n"
         "    Execute custom Python code passed as a script prior to executing the Python\n"
         "    script or loading the project passed as parameter. This option may be used\n"
@@ -345,7 +495,73 @@ CLArgs::printUsage(const std::string& programName)
         "     breakdown contains information about each nodes, render times etc...\n"
         "     This option is useful for debugging purposes or to control that a render\n"
         "     is working correctly.\n"
-        "     **Please note** that it does not work when writing video files."
+        "     **Please note** that it does not work when writing video files.\n"
+        "  --concurrent-writers\n"
+        "     Render all the Write nodes given with -w (or all the Write nodes of the\n"
+        "     project) at the same time instead of one after the other. They share the\n"
+        "     threads and the cache: the nodes they have in common are computed once\n"
+        "     per frame for all of them. This is faster to render several formats of\n"
+        "     the same comp.\n"
+        "  --resume\n"
+        "     Do not render again the frames that the previous render of the Write\n"
+        "     nodes wrote completely, e.g. when a farm task was killed in the middle\n"
+        "     of its frame range. In background mode, the frames written by each\n"
+        "     Write node of an image sequence are recorded in a hidden file next to\n"
+        "     the images (.<file pattern>.checkpoints). A frame is skipped if it was\n"
+        "     recorded and its files did not change since. Without --resume, this\n"
+        "     file is reset when the render starts.\n"
+        "  --distributed <count>\n"
+        "     Split each frame of the Write nodes into regions rendered at the same\n"
+        "     time by <count> %1Renderer worker processes on this machine, then write\n"
+        "     the frame from their tiles. This is faster for very large stills.\n"
+        "     The workers share their tiles through the remote tile cache server of\n"
+        "     the Preferences, which must be set. Regions that a worker failed to\n"
+        "     render are rendered by this process.\n"
+        "  --distributed-hosts <host1,host2,...>\n"
+        "     Like --distributed, with one worker started on each host with ssh.\n"
+        "     The project, the input files and %1Renderer must have the same paths\n"
+        "     on all hosts and the remote tile cache server must be reachable from\n"
+        "     them. May be combined with --distributed.\n"
+        "  --render-region <x1,y1,x2,y2>\n"
+        "     Used by the workers of a distributed render: only render the given\n"
+        "     region of the input of the Write nodes, in canonical coordinates, and\n"
+        "     publish the tiles to the remote tile cache instead of writing a file.\n"
+        "  --export-cache <archive> <node1,node2,...>\n"
+        "     Instead of rendering the Write nodes, render the given nodes for the\n"
+        "     frame range given on the command-line (or the frame range of the\n"
+        "     project) and write their tiles to the given archive file. Use it to\n"
+        "     compute expensive upstream nodes (denoise, lens distortion...) once.\n"
+        "  --import-cache <archive>\n"
+        "     Import an archive written with --export-cache: its tiles are used by\n"
+        "     the renders instead of being rendered again, as long as the nodes\n"
+        "     and their inputs are the same as in the exported project. The archive\n"
+        "     is copied to the cache directory and stays imported until the cache\n"
+        "     is cleared. A project is not needed with this option.\n"
+        "  --batch <manifest>\n"
+        "     Render many projects in this process, loading the plug-ins and the\n"
+        "     caches once. Each line of the manifest gives the arguments of one\n"
+        "     render, as on the command-line: the Write nodes, frames, -i, -o, -s,\n"
+        "     --concurrent-writers, --resume and the project, whose path may be\n"
+        "     relative to the manifest, e.g:\n"
+        "       -w Write1 1-10 shots/sh010/comp.ntp\n"
+        "     Empty lines and lines starting with # are ignored. The projects are\n"
+        "     loaded, rendered and closed one after the other.\n"
+        "  --batch-jobs <count>\n"
+        "     With --batch, render up to <count> projects at the same time. They\n"
+        "     share the threads and the caches.\n"
+        "  --batch-memory <MB>\n"
+        "     With --batch-jobs, do not start another project while this process\n"
+        "     uses more than the given amount of memory.\n"
+        "  --frame-queue <directory>\n"
+        "     Render the frames of the Write nodes with several processes, on one or\n"
+        "     more hosts, each started with the same project, Write nodes and frame\n"
+        "     ranges and the same <directory>, shared by the hosts (e.g: on NFS).\n"
+        "     Each process claims the next frames not rendered yet from the\n"
+        "     directory until there is none left, so that faster hosts render more\n"
+        "     frames. The frames of a slow or dead host are rendered again by\n"
+        "     another one near the end of the render.\n"
+        "  --frame-queue-batch <count>\n"
+        "     With --frame-queue, claim and render <count> frames at a time.\n"
         "Sample uses:\n"
         "  %1 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1 -b -w MyWriter /Users/Me/MyNatronProjects/MyProject.ntp\n"
@@ -523,6 +739,18 @@ CLArgs::areRenderStatsEnabled() const
     return _imp->enableRenderStats;
 }
 
+bool
+CLArgs::isRenderWritersConcurrentlyEnabled() const
+{
+    return _imp->renderWritersConcurrently;
+}
+
+bool
+CLArgs::isResumeRenderEnabled() const
+{
+    return _imp->resumeRender;
+}
+
 bool
 CLArgs::isPythonScript() const
 {
@@ -565,6 +793,152 @@ CLArgs::getExportDocsPath() const
     return _imp->exportDocsPath;
 }
 
+const QString &
+CLArgs::getInstructionSet() const
+{
+    return _imp->instructionSet;
+}
+
+const QString &
+CLArgs::getThreadPlacement() const
+{
+    return _imp->threadPlacement;
+}
+
+bool
+CLArgs::isLockProfilingEnabled() const
+{
+    return _imp->enableLockProfiling;
+}
+
+const QString&
+CLArgs::getTraceFile() const
+{
+    return _imp->traceFile;
+}
+
+const QString&
+CLArgs::getMemoryTimelineFile() const
+{
+    return _imp->memoryTimelineFile;
+}
+
+int
+CLArgs::getMemoryTimelineIntervalMS() const
+{
+    return _imp->memoryTimelineIntervalMS;
+}
+
+bool
+CLArgs::isPythonLazyInitializationRequested() const
+{
+    return _imp->lazyPython;
+}
+
+bool
+CLArgs::isStartupProfilingEnabled() const
+{
+    return _imp->enableStartupProfiling;
+}
+
+int
+CLArgs::getRenderDaemonPort() const
+{
+    return _imp->renderDaemonPort;
+}
+
+const QString&
+CLArgs::getRenderDaemonHost() const
+{
+    return _imp->renderDaemonHost;
+}
+
+int
+CLArgs::getMetricsPort() const
+{
+    return _imp->metricsPort;
+}
+
+const QString&
+CLArgs::getMetricsFile() const
+{
+    return _imp->metricsFile;
+}
+
+int
+CLArgs::getDistributedWorkersCount() const
+{
+    return _imp->distributedWorkersCount;
+}
+
+const QStringList&
+CLArgs::getDistributedHosts() const
+{
+    return _imp->distributedHosts;
+}
+
+bool
+CLArgs::getRenderRegion(RectD* region) const
+{
+    if (!_imp->hasRenderRegion) {
+        return false;
+    }
+    region->x1 = _imp->renderRegion[0];
+    region->y1 = _imp->renderRegion[1];
+    region->x2 = _imp->renderRegion[2];
+    region->y2 = _imp->renderRegion[3];
+
+    return true;
+}
+
+const QString&
+CLArgs::getCacheExportFile() const
+{
+    return _imp->cacheExportFile;
+}
+
+const QStringList&
+CLArgs::getCacheExportNodes() const
+{
+    return _imp->cacheExportNodes;
+}
+
+const QString&
+CLArgs::getCacheImportFile() const
+{
+    return _imp->cacheImportFile;
+}
+
+const QString&
+CLArgs::getBatchManifest() const
+{
+    return _imp->batchManifest;
+}
+
+int
+CLArgs::getBatchMaxConcurrentProjects() const
+{
+    return _imp->batchMaxConcurrentProjects;
+}
+
+int
+CLArgs::getBatchMemoryBudgetMB() const
+{
+    return _imp->batchMemoryBudgetMB;
+}
+
+const QString&
+CLArgs::getFrameQueueDirectory() const
+{
+    return _imp->frameQueueDirectory;
+}
+
+int
+CLArgs::getFrameQueueBatchSize() const
+{
+    return _imp->frameQueueBatchSize;
+}
+
 QStringList::iterator
 CLArgsPrivate::findFileNameWithExtension(const QString& extension)
 {
@@ -734,6 +1108,13 @@ tryParseMultipleFrameRanges(const QString& args,
     return added;
 }
 
+bool
+CLArgs::parseFrameRanges(const QString& str,
+                         std::list<std::pair<int, std::pair<int, int> > >* frameRanges)
+{
+    return tryParseMultipleFrameRanges(str, *frameRanges);
+}
+
 void
 CLArgsPrivate::parse()
 {
@@ -779,6 +1160,161 @@ CLArgsPrivate::parse()
 
 
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("lock-profile"), QString() );
+        if ( it != args.end() ) {
+            enableLockProfiling = true;
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("trace"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                traceFile = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the file to which the trace is written after --trace").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("memory-timeline"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                memoryTimelineFile = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the file to which the memory timeline is written after --memory-timeline").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("memory-timeline-interval"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            int interval = 0;
+            if ( next != args.end() ) {
+                interval = next->toInt(&ok);
+            }
+            if ( !ok || (interval <= 0) || memoryTimelineFile.isEmpty() ) {
+                std::cout << tr("You must specify the time between two samples in milliseconds after --memory-timeline-interval, along with --memory-timeline").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            memoryTimelineIntervalMS = interval;
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("lazy-python"), QString() );
+        if ( it != args.end() ) {
+            lazyPython = true;
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("startup-profile"), QString() );
+        if ( it != args.end() ) {
+            enableStartupProfiling = true;
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("daemon"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            int port = -1;
+            if ( next != args.end() ) {
+                port = next->toInt(&ok);
+            }
+            if ( !ok || (port <= 0) || (port > 65535) ) {
+                std::cout << tr("You must specify the port on which the render daemon listens").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            renderDaemonPort = port;
+            isBackground = true;
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("daemon-host"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( ( it != args.end() ) && (renderDaemonPort != -1) ) {
+                renderDaemonHost = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the address of the render daemon after --daemon-host, along with --daemon").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("metrics-port"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            int port = -1;
+            if ( next != args.end() ) {
+                port = next->toInt(&ok);
+            }
+            if ( !ok || (port <= 0) || (port > 65535) ) {
+                std::cout << tr("You must specify the port on which the metrics are served after --metrics-port").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            metricsPort = port;
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("metrics-file"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                metricsFile = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the file to which the metrics are written after --metrics-file").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8("no-settings"), QString() );
         if ( it != args.end() ) {
@@ -814,6 +1350,220 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("concurrent-writers"), QString() );
+        if ( it != args.end() ) {
+            renderWritersConcurrently = true;
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("resume"), QString() );
+        if ( it != args.end() ) {
+            resumeRender = true;
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("distributed"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            int count = 0;
+            if ( next != args.end() ) {
+                count = next->toInt(&ok);
+            }
+            if ( !ok || (count <= 0) ) {
+                std::cout << tr("You must specify the number of worker processes after --distributed").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            distributedWorkersCount = count;
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("distributed-hosts"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                distributedHosts = it->split( QLatin1Char(','), QString::SkipEmptyParts );
+                args.erase(it);
+            }
+            if ( distributedHosts.isEmpty() ) {
+                std::cout << tr("You must specify a comma-separated list of hosts after --distributed-hosts").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("render-region"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            QStringList coords;
+            if ( it != args.end() ) {
+                coords = it->split( QLatin1Char(',') );
+                args.erase(it);
+            }
+            bool ok = coords.size() == 4;
+            for (int i = 0; ok && i < 4; ++i) {
+                renderRegion[i] = coords[i].toDouble(&ok);
+            }
+            if ( !ok || (renderRegion[0] >= renderRegion[2]) || (renderRegion[1] >= renderRegion[3]) ) {
+                std::cout << tr("You must specify the region to render as x1,y1,x2,y2 after --render-region").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            hasRenderRegion = true;
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("export-cache"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                cacheExportFile = *it;
+                it = args.erase(it);
+            }
+            if ( it != args.end() ) {
+                cacheExportNodes = it->split( QLatin1Char(','), QString::SkipEmptyParts );
+                args.erase(it);
+            }
+            if ( cacheExportFile.isEmpty() || cacheExportNodes.isEmpty() ) {
+                std::cout << tr("You must specify the archive file and a comma-separated list of nodes after --export-cache").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("import-cache"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                cacheImportFile = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the archive file after --import-cache").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("batch"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                batchManifest = *it;
+                args.erase(it);
+                isBackground = true;
+            } else {
+                std::cout << tr("You must specify the manifest file after --batch").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("batch-jobs"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            int count = 0;
+            if ( next != args.end() ) {
+                count = next->toInt(&ok);
+            }
+            if ( !ok || (count <= 0) || batchManifest.isEmpty() ) {
+                std::cout << tr("You must specify the number of projects rendered at the same time after --batch-jobs, along with --batch").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            batchMaxConcurrentProjects = count;
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("batch-memory"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            int budget = 0;
+            if ( next != args.end() ) {
+                budget = next->toInt(&ok);
+            }
+            if ( !ok || (budget <= 0) || batchManifest.isEmpty() ) {
+                std::cout << tr("You must specify the memory budget in MB after --batch-memory, along with --batch").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            batchMemoryBudgetMB = budget;
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("frame-queue"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                frameQueueDirectory = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the directory of the queue after --frame-queue").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("frame-queue-batch"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            int count = 0;
+            if ( next != args.end() ) {
+                count = next->toInt(&ok);
+            }
+            if ( !ok || (count <= 0) || frameQueueDirectory.isEmpty() ) {
+                std::cout << tr("You must specify the number of frames claimed at a time after --frame-queue-batch, along with --frame-queue").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            frameQueueBatchSize = count;
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8(NATRON_BREAKPAD_PROCESS_PID), QString() );
         if ( it != args.end() ) {
@@ -910,6 +1660,40 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("instruction-set"), QString() );
+        if ( it != args.end() ) {
+            ++it;
+            CPUInstructionSetEnum instructionSetValue;
+            if ( ( it != args.end() ) && CPUInstructionSet::getInstructionSetFromName(it->toStdString(), &instructionSetValue) ) {
+                instructionSet = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify a valid instruction set: scalar, sse2, avx2, avx512 or neon").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("thread-placement"), QString() );
+        if ( it != args.end() ) {
+            ++it;
+            ThreadPlacementPolicyEnum policyValue;
+            if ( ( it != args.end() ) && ThreadPlacement::getPolicyFromName(it->toStdString(), &policyValue) ) {
+                threadPlacement = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify a valid thread placement policy: none, numa or core").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8("IPCpipe"), QString() );
         if ( it != args.end() ) {
@@ -963,7 +1747,8 @@ CLArgsPrivate::parse()
         QStringList::iterator it = findFileNameWithExtension( QString::fromUtf8(NATRON_PROJECT_FILE_EXT) );
         if ( it == args.end() ) {
             it = findFileNameWithExtension( QString::fromUtf8("py") );
-            if ( ( it == args.end() ) && !isInterpreterMode && isBackground ) {
+            // A farm node may only import an archive of tiles, without rendering
+            if ( ( it == args.end() ) && !isInterpreterMode && isBackground && (renderDaemonPort == -1) && cacheImportFile.isEmpty() && batchManifest.isEmpty() ) {
                 std::cout << tr("You must specify the filename of a script or %1 project. (.%2)").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ).arg( QString::fromUtf8(NATRON_PROJECT_FILE_EXT) ).toStdString() << std::endl;
                 error = 1;
 
@@ -984,6 +1769,27 @@ CLArgsPrivate::parse()
         }
     }
 
+    if ( (renderDaemonPort != -1) && ( isInterpreterMode || !filename.isEmpty() ) ) {
+        std::cout << tr("The --daemon option cannot be used with a script, a project or the interpreter mode: the projects are given by the render jobs").toStdString() << std::endl;
+        error = 1;
+
+        return;
+    }
+
+    if ( !batchManifest.isEmpty() && ( isInterpreterMode || !filename.isEmpty() || (renderDaemonPort != -1) ) ) {
+        std::cout << tr("The --batch option cannot be used with a script, a project, the interpreter mode or --daemon: the projects are given by the manifest").toStdString() << std::endl;
+        error = 1;
+
+        return;
+    }
+
+    if ( !frameQueueDirectory.isEmpty() && ( !batchManifest.isEmpty() || (renderDaemonPort != -1) || hasRenderRegion || !cacheExportFile.isEmpty() ) ) {
+        std::cout << tr("The --frame-queue option cannot be used with --batch, --daemon, --render-region or --export-cache").toStdString() << std::endl;
+        error = 1;
+
+        return;
+    }
+
     //Parse frame range
     for (QStringList::iterator it = args.begin(); it != args.end(); ++it) {
         if ( tryParseMultipleFrameRanges(*it, frameRanges) ) {
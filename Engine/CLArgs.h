@@ -136,6 +136,13 @@ public:
 
     bool areRenderStatsEnabled() const;
 
+    bool isRenderWritersConcurrentlyEnabled() const;
+
+    /*
+     * @brief True if --resume was given: the frames written by the previous render of the writers are skipped.
+     */
+    bool isResumeRenderEnabled() const;
+
     const QString& getBreakpadProcessExecutableFilePath() const;
 
     qint64 getBreakpadProcessPID() const;
@@ -145,6 +152,106 @@ public:
     const QString& getBreakpadPipeFilePath() const;
     const QString& getBreakpadComPipeFilePath() const;
     const QString& getExportDocsPath() const;
+    const QString& getInstructionSet() const;
+    const QString& getThreadPlacement() const;
+    bool isLockProfilingEnabled() const;
+
+    /*
+     * @brief The file given with --trace to which the timeline of the renders is written on exit, or an empty string.
+     */
+    const QString& getTraceFile() const;
+
+    /*
+     * @brief The file given with --memory-timeline to which the samples of the memory are written on exit, or an empty string.
+     */
+    const QString& getMemoryTimelineFile() const;
+
+    /*
+     * @brief The interval given with --memory-timeline-interval, or 0 for the default interval of the recorder.
+     */
+    int getMemoryTimelineIntervalMS() const;
+
+    bool isPythonLazyInitializationRequested() const;
+    bool isStartupProfilingEnabled() const;
+
+    /*
+     * @brief If --daemon was given, the port on which the render daemon listens, otherwise -1.
+     */
+    int getRenderDaemonPort() const;
+
+    /*
+     * @brief The address given with --daemon-host on which the render daemon listens. Empty for the local host.
+     */
+    const QString& getRenderDaemonHost() const;
+
+    /*
+     * @brief The port given with --metrics-port on which the metrics are served, or -1.
+     */
+    int getMetricsPort() const;
+
+    /*
+     * @brief The file given with --metrics-file to which the metrics are written, or an empty string.
+     */
+    const QString& getMetricsFile() const;
+
+    /*
+     * @brief The number of local worker processes given with --distributed, or 0.
+     */
+    int getDistributedWorkersCount() const;
+
+    /*
+     * @brief The hosts given with --distributed-hosts on which worker processes are started.
+     */
+    const QStringList& getDistributedHosts() const;
+
+    /*
+     * @brief If --render-region was given, returns true and the region in canonical coordinates: this process is the
+     * worker of a distributed render.
+     */
+    bool getRenderRegion(RectD* region) const;
+
+    /*
+     * @brief The archive given with --export-cache to which the tiles of the nodes returned by getCacheExportNodes()
+     * are written instead of rendering the writers, or an empty string.
+     */
+    const QString& getCacheExportFile() const;
+    const QStringList& getCacheExportNodes() const;
+
+    /*
+     * @brief The archive given with --import-cache, or an empty string.
+     */
+    const QString& getCacheImportFile() const;
+
+    /*
+     * @brief The manifest given with --batch listing the projects to render, or an empty string.
+     */
+    const QString& getBatchManifest() const;
+
+    /*
+     * @brief The number of projects of the batch rendered at the same time, given with --batch-jobs. 1 by default.
+     */
+    int getBatchMaxConcurrentProjects() const;
+
+    /*
+     * @brief The memory budget in MB given with --batch-memory, or 0.
+     */
+    int getBatchMemoryBudgetMB() const;
+
+    /*
+     * @brief The directory of the shared queue the frames are pulled from, given with --frame-queue, or an empty string.
+     */
+    const QString& getFrameQueueDirectory() const;
+
+    /*
+     * @brief The number of frames claimed at a time from the queue, given with --frame-queue-batch. 1 by default.
+     */
+    int getFrameQueueBatchSize() const;
+
+    /*
+     * @brief Parses frame ranges in the format of the command line, e.g: 1-10:2,20-30,40.
+     * Returns false if no frame range could be parsed.
+     */
+    static bool parseFrameRanges(const QString& str, std::list<std::pair<int, std::pair<int, int> > >* frameRanges);
 
 private:
 
@@ -0,0 +1,218 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CPUInstructionSet.h"
+
+#include <cctype>
+
+#include "Engine/Half.h"
+#include "Engine/Lut.h"
+
+// The features of x86 CPUs are detected with the builtins of gcc and clang, otherwise only the baseline
+// of the architecture is used
+#if (defined(__x86_64__) || defined(__i386__)) && ( ( defined(__GNUC__) && ( (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) ) ) || defined(__clang__) )
+#define NATRON_CPU_X86_DETECTION
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+static CPUInstructionSetEnum
+detectInstructionSet()
+{
+#if defined(NATRON_CPU_X86_DETECTION)
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") ) {
+        return eCPUInstructionSetAVX512;
+    }
+    if ( __builtin_cpu_supports("avx2") ) {
+        return eCPUInstructionSetAVX2;
+    }
+    if ( __builtin_cpu_supports("sse2") ) {
+        return eCPUInstructionSetSSE2;
+    }
+
+    return eCPUInstructionSetScalar;
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    return eCPUInstructionSetSSE2;
+#elif defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return eCPUInstructionSetNEON;
+#else
+    return eCPUInstructionSetScalar;
+#endif
+}
+
+static bool
+detectHalfConversion()
+{
+#if defined(NATRON_CPU_X86_DETECTION)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#elif defined(__aarch64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static CPUInstructionSetEnum
+getDetectedInstructionSet()
+{
+    // Thread-safe in C++11 and called before any thread is spawned by the AppManager anyway
+    static const CPUInstructionSetEnum instructionSet = detectInstructionSet();
+
+    return instructionSet;
+}
+
+static CPUInstructionSetEnum currentInstructionSet = getDetectedInstructionSet();
+
+//// The bind functions of the modules with several implementations of their kernels.
+//// Each of them uses the best implementation it has that the given instruction set can run.
+
+static void
+bindLutKernels(CPUInstructionSetEnum instructionSet)
+{
+    Color::LutInstructionSetEnum lutInstructionSet = Color::eLutInstructionSetScalar;
+    switch (instructionSet) {
+    case eCPUInstructionSetScalar:
+        lutInstructionSet = Color::eLutInstructionSetScalar;
+        break;
+    case eCPUInstructionSetSSE2:
+        lutInstructionSet = Color::eLutInstructionSetSSE2;
+        break;
+    case eCPUInstructionSetAVX2:
+    case eCPUInstructionSetAVX512: // there are no AVX-512 kernels
+        lutInstructionSet = Color::eLutInstructionSetAVX2;
+        break;
+    case eCPUInstructionSetNEON:
+        lutInstructionSet = Color::eLutInstructionSetNEON;
+        break;
+    }
+    while ( !Color::setInstructionSet(lutInstructionSet) && lutInstructionSet != Color::eLutInstructionSetScalar ) {
+        // NEON is the last one, there is no fallback between NEON and the x86 instruction sets
+        lutInstructionSet = (lutInstructionSet == Color::eLutInstructionSetNEON) ? Color::eLutInstructionSetScalar : (Color::LutInstructionSetEnum)(lutInstructionSet - 1);
+    }
+}
+
+static void
+bindHalfKernels(CPUInstructionSetEnum instructionSet)
+{
+    // F16C comes with the AVX2 generation of CPUs
+    Half::setHardwareConversionEnabled(instructionSet == eCPUInstructionSetAVX2 ||
+                                       instructionSet == eCPUInstructionSetAVX512 ||
+                                       instructionSet == eCPUInstructionSetNEON);
+}
+
+static const CPUInstructionSet::BindKernelsFunction bindKernelsFunctions[] = {
+    bindLutKernels,
+    bindHalfKernels,
+};
+
+CPUInstructionSetEnum
+CPUInstructionSet::getSupportedInstructionSet()
+{
+    return getDetectedInstructionSet();
+}
+
+bool
+CPUInstructionSet::isInstructionSetSupported(CPUInstructionSetEnum instructionSet)
+{
+    const CPUInstructionSetEnum supported = getDetectedInstructionSet();
+
+    if (instructionSet == eCPUInstructionSetScalar) {
+        return true;
+    } else if (supported == eCPUInstructionSetNEON) {
+        return instructionSet == eCPUInstructionSetNEON;
+    } else {
+        return instructionSet != eCPUInstructionSetNEON && instructionSet <= supported;
+    }
+}
+
+bool
+CPUInstructionSet::isHalfConversionSupported()
+{
+    static const bool supported = detectHalfConversion();
+
+    return supported;
+}
+
+CPUInstructionSetEnum
+CPUInstructionSet::getInstructionSet()
+{
+    return currentInstructionSet;
+}
+
+bool
+CPUInstructionSet::setInstructionSet(CPUInstructionSetEnum instructionSet)
+{
+    if ( !isInstructionSetSupported(instructionSet) ) {
+        return false;
+    }
+    currentInstructionSet = instructionSet;
+    for (std::size_t i = 0; i < sizeof(bindKernelsFunctions) / sizeof(bindKernelsFunctions[0]); ++i) {
+        bindKernelsFunctions[i](instructionSet);
+    }
+
+    return true;
+}
+
+std::string
+CPUInstructionSet::getInstructionSetName(CPUInstructionSetEnum instructionSet)
+{
+    switch (instructionSet) {
+    case eCPUInstructionSetScalar:
+        return "scalar";
+    case eCPUInstructionSetSSE2:
+        return "sse2";
+    case eCPUInstructionSetAVX2:
+        return "avx2";
+    case eCPUInstructionSetAVX512:
+        return "avx512";
+    case eCPUInstructionSetNEON:
+        return "neon";
+    }
+
+    return std::string();
+}
+
+bool
+CPUInstructionSet::getInstructionSetFromName(const std::string& name,
+                                             CPUInstructionSetEnum* instructionSet)
+{
+    std::string lowerName = name;
+    for (std::size_t i = 0; i < lowerName.size(); ++i) {
+        lowerName[i] = (char)std::tolower( (unsigned char)lowerName[i] );
+    }
+    for (int i = eCPUInstructionSetScalar; i <= eCPUInstructionSetNEON; ++i) {
+        if ( lowerName == getInstructionSetName( (CPUInstructionSetEnum)i ) ) {
+            *instructionSet = (CPUInstructionSetEnum)i;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,94 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_CPUInstructionSet_h
+#define Engine_CPUInstructionSet_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+NATRON_NAMESPACE_ENTER
+
+/// @enum The instruction sets that the pixel kernels may be compiled for, from the least to the most capable
+/// on each architecture. All the implementations of a kernel give exactly the same results.
+enum CPUInstructionSetEnum
+{
+    eCPUInstructionSetScalar = 0,
+    eCPUInstructionSetSSE2,
+    eCPUInstructionSetAVX2,
+    eCPUInstructionSetAVX512,
+    eCPUInstructionSetNEON
+};
+
+/**
+ * @brief Chooses the implementation of the pixel kernels that have several of them for the CPU the process runs on.
+ * The features of the CPU are detected once. The modules that select a kernel at runtime register a bind function
+ * in CPUInstructionSet.cpp, which setInstructionSet() calls so that each module binds its function pointers once,
+ * to the best implementation it has for the given instruction set.
+ *
+ * The AppManager selects the best supported instruction set at startup, unless another one is given
+ * with the --instruction-set command-line option.
+ **/
+class CPUInstructionSet
+{
+public:
+
+    typedef void (*BindKernelsFunction)(CPUInstructionSetEnum instructionSet);
+
+    /**
+     * @brief Returns the best instruction set supported by both this build and the CPU.
+     **/
+    static CPUInstructionSetEnum getSupportedInstructionSet();
+
+    static bool isInstructionSetSupported(CPUInstructionSetEnum instructionSet);
+
+    /**
+     * @brief Returns true if the CPU can convert between half and float (F16C on x86, always on ARMv8).
+     **/
+    static bool isHalfConversionSupported();
+
+    /**
+     * @brief Returns the instruction set the kernels are currently bound to.
+     **/
+    static CPUInstructionSetEnum getInstructionSet();
+
+    /**
+     * @brief Binds the kernels of all the modules to the given instruction set.
+     * This must not be called while kernels are running. Returns false if the CPU does not support it.
+     **/
+    static bool setInstructionSet(CPUInstructionSetEnum instructionSet);
+
+    static std::string getInstructionSetName(CPUInstructionSetEnum instructionSet);
+
+    /**
+     * @brief Returns the instruction set with the given name (case insensitive), as printed by getInstructionSetName().
+     **/
+    static bool getInstructionSetFromName(const std::string& name, CPUInstructionSetEnum* instructionSet);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_CPUInstructionSet_h
@@ -36,9 +36,13 @@
 
 #include <QMutex>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QWaitCondition>
 #include <QDebug>
 #include <QReadWriteLock>
+#include <QThread>
+#include <QAtomicInt>
 
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 GCC_DIAG_OFF(unused-parameter)
@@ -84,11 +88,15 @@ GCC_DIAG_ON(unused-parameter)
 #include "Global/QtCompat.h"
 
 #include "Engine/AppManager.h"
+#include "Engine/CacheFlusherThread.h"
+#include "Engine/CacheStats.h"
+#include "Engine/CompressedTileStorage.h"
 #include "Engine/StorageDeleterThread.h"
 #include "Global/FStreamsSupport.h"
 #include "Engine/EffectInstanceActionResults.h"
 #include "Engine/ImageCacheKey.h"
 #include "Engine/ImageCacheEntry.h"
+#include "Engine/LockProfiler.h"
 #include "Engine/MemoryFile.h"
 #include "Engine/MemoryInfo.h"
 #include "Engine/Hash64.h"
@@ -97,6 +105,7 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/RamBuffer.h"
 #include "Engine/Timer.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/TraceRecorder.h"
 #include "Engine/TreeRenderQueueManager.h"
 
 
@@ -114,15 +123,35 @@ NATRON_NAMESPACE_ENTER
 #define NATRON_CACHE_BUCKET_TOC_FILE_GROW_N_BYTES 524288 // = 512 * 1024
 
 // If we change the MemorySegmentEntryHeader struct, we must increment this version so we do not attempt to read an invalid structure.
-#define NATRON_MEMORY_SEGMENT_ENTRY_HEADER_VERSION 4
+// Also increment it when NATRON_HASH64_VERSION changes since entries are identified by their hash.
+#define NATRON_MEMORY_SEGMENT_ENTRY_HEADER_VERSION 9
+
+// Identifies the index snapshot file written at clean shutdown, see CachePrivate::writeIndexSnapshot()
+#define NATRON_CACHE_INDEX_SNAPSHOT_MAGIC 0x4E434953 // NCIS
+
+// With eCacheEvictionPolicyCostAware, the number of seconds an entry is kept longer than with a LRU policy
+// for each second it takes to compute a MiB of it
+#define NATRON_CACHE_COST_AWARE_LIFETIME_PER_COST 60.
+
+// Entries smaller than this are considered to be of this size when computing their cost, so that tiny entries
+// that took a while to compute do not get an unbounded priority
+#define NATRON_CACHE_COST_MIN_ENTRY_SIZE (64 * 1024)
+
+// With eCacheEvictionPolicyCostAware, the number of least recently used entries of each bucket that are
+// considered for eviction
+#define NATRON_CACHE_COST_AWARE_EVICTION_CANDIDATES 8
 
 // After this amount of milliseconds, if a thread is not able to access a mutex, the cache is assumed to be inconsistent
 #define NATRON_CACHE_INTERPROCESS_MUTEX_TIMEOUT_MS 10000
 
-// Each tile storage file is 1GB, which corresponds to exactly 256 tiles of NATRON_TILE_SIZE_BYTES bytes for each 256 buckets.
-#define NATRON_NUM_TILES_PER_BUCKET_FILE 256
-#define NATRON_NUM_TILES_PER_FILE (NATRON_NUM_TILES_PER_BUCKET_FILE * NATRON_CACHE_BUCKETS_COUNT)
-#define NATRON_TILE_STORAGE_FILE_SIZE (NATRON_TILE_SIZE_BYTES * NATRON_NUM_TILES_PER_FILE)
+// Maximum amount of milliseconds a thread sleeps between two look-ups of an entry pending in another thread
+#define NATRON_CACHE_PENDING_ENTRY_MAX_POLL_INTERVAL_MS 100
+
+// Each tile storage file is 1GiB whatever the tile size of the cache. The file is split in one region per bucket:
+// with the default tile size of 16KiB, this corresponds to exactly 256 tiles for each 256 buckets.
+// With 256KiB tiles (256x256 float tiles), each bucket has 16 tiles per file.
+#define NATRON_TILE_STORAGE_FILE_SIZE ((std::size_t)1024 * 1024 * 1024)
+#define NATRON_TILE_STORAGE_FILE_BUCKET_REGION_SIZE (NATRON_TILE_STORAGE_FILE_SIZE / NATRON_CACHE_BUCKETS_COUNT)
 
 
 #ifdef DEBUG
@@ -482,6 +511,186 @@ public:
 typedef scoped_timed_sharable_lock<bip::interprocess_sharable_mutex> TimedSharable_ReadLock;
 typedef scoped_timed_lock<bip::interprocess_sharable_mutex> TimedSharable_WriteLock;
 
+#ifndef NATRON_CACHE_INTERPROCESS_ROBUST
+
+// When defined, the process-local Cache uses ShardedSharedMutex instead of boost::shared_mutex
+// for the bucket, ToC and tiles storage mutexes. See ShardedSharedMutex below.
+#define NATRON_CACHE_USE_SHARDED_SHARED_MUTEX
+
+#endif
+
+#ifdef NATRON_CACHE_USE_SHARDED_SHARED_MUTEX
+
+// The number of reader counters of a ShardedSharedMutex. Each counter lives on its own cache line.
+#define NATRON_CACHE_SHARED_MUTEX_N_SHARDS 16
+
+// Assumed size of a cache line, used to pad the reader counters
+#define NATRON_CACHE_LINE_SIZE 64
+
+/**
+ * @brief A process local reader-writer mutex optimized for read-mostly access.
+ *
+ * Cache hits only need read access to the bucket and the tiles storage, but with boost::shared_mutex
+ * every lock_shared()/unlock_shared() goes through an internal mutex shared by all threads: on machines with
+ * many cores the hit latency collapses as all threads queue on that internal mutex, even though
+ * none of them want exclusive access.
+ *
+ * Here, readers only increment a counter selected from their thread id. Each counter is on a separate
+ * cache line so that readers on different shards never write to the same memory.
+ * A writer first takes the writerMutex (so only one writer is active at once), then raises the writerPending flag
+ * which prevents new readers to enter, and finally waits until the sum of all reader counters drops to 0.
+ * Readers that see the writerPending flag back off and wait until the flag is cleared.
+ *
+ * Only the sum of all counters is meaningful: a read lock may be released from another thread than the one
+ * that acquired it (e.g: retrieveAndLockTiles/unLockTiles) in which case an individual counter may become negative.
+ *
+ * This class implements the Lockable and SharedLockable concepts so it can be used with boost::unique_lock,
+ * boost::shared_lock and boost::condition_variable_any.
+ **/
+class ShardedSharedMutex
+{
+    struct ReaderShard
+    {
+        QAtomicInt count;
+        char padding[NATRON_CACHE_LINE_SIZE - sizeof(QAtomicInt)];
+
+        ReaderShard()
+        : count(0)
+        {
+        }
+    };
+
+    ReaderShard _shards[NATRON_CACHE_SHARED_MUTEX_N_SHARDS];
+
+    // Set to 1 whilst a writer owns or waits for the lock
+    QAtomicInt _writerPending;
+
+    // Serializes writers between themselves
+    boost::mutex _writerMutex;
+
+public:
+
+    ShardedSharedMutex()
+    : _shards()
+    , _writerPending(0)
+    , _writerMutex()
+    {
+
+    }
+
+    void lock_shared()
+    {
+        ReaderShard& shard = _shards[getCurrentThreadShardIndex()];
+        int nSpins = 0;
+        for (;;) {
+            shard.count.fetchAndAddOrdered(1);
+            if (!isWriterPending()) {
+                return;
+            }
+            // A writer is active: back-off so it can make progress
+            shard.count.fetchAndAddOrdered(-1);
+            while (isWriterPending()) {
+                backOff(&nSpins);
+            }
+        }
+    }
+
+    bool try_lock_shared()
+    {
+        ReaderShard& shard = _shards[getCurrentThreadShardIndex()];
+        shard.count.fetchAndAddOrdered(1);
+        if (!isWriterPending()) {
+            return true;
+        }
+        shard.count.fetchAndAddOrdered(-1);
+        return false;
+    }
+
+    void unlock_shared()
+    {
+        _shards[getCurrentThreadShardIndex()].count.fetchAndAddOrdered(-1);
+    }
+
+    void lock()
+    {
+        _writerMutex.lock();
+        _writerPending.fetchAndStoreOrdered(1);
+        int nSpins = 0;
+        while (getNumReaders() > 0) {
+            backOff(&nSpins);
+        }
+    }
+
+    bool try_lock()
+    {
+        if (!_writerMutex.try_lock()) {
+            return false;
+        }
+        _writerPending.fetchAndStoreOrdered(1);
+        if (getNumReaders() > 0) {
+            _writerPending.fetchAndStoreOrdered(0);
+            _writerMutex.unlock();
+            return false;
+        }
+        return true;
+    }
+
+    void unlock()
+    {
+        _writerPending.fetchAndStoreOrdered(0);
+        _writerMutex.unlock();
+    }
+
+private:
+
+    bool isWriterPending() const
+    {
+        // A plain acquire load: readers must not write to the shared flag cache line
+#if QT_VERSION < 0x050000
+        return (int)_writerPending != 0;
+#else
+        return _writerPending.loadAcquire() != 0;
+#endif
+    }
+
+    int getNumReaders() const
+    {
+        int ret = 0;
+        for (int i = 0; i < NATRON_CACHE_SHARED_MUTEX_N_SHARDS; ++i) {
+#if QT_VERSION < 0x050000
+            ret += (int)_shards[i].count;
+#else
+            ret += _shards[i].count.loadAcquire();
+#endif
+        }
+        return ret;
+    }
+
+    static int getCurrentThreadShardIndex()
+    {
+        // Mix the bits of the thread id: thread handles are usually aligned pointers
+        U64 id = (U64)reinterpret_cast<std::size_t>(QThread::currentThreadId());
+        id ^= id >> 33;
+        id *= 0xff51afd7ed558ccdULL;
+        id ^= id >> 33;
+        return (int)(id % NATRON_CACHE_SHARED_MUTEX_N_SHARDS);
+    }
+
+    static void backOff(int* nSpins)
+    {
+        // Spin by yielding first since critical sections are short, then sleep
+        // if the other side holds the lock for a long time (e.g: tiles storage being grown)
+        ++(*nSpins);
+        if (*nSpins < 64) {
+            QThread::yieldCurrentThread();
+        } else {
+            CacheEntryLockerBase::sleep_milliseconds(1);
+        }
+    }
+};
+
+#endif // NATRON_CACHE_USE_SHARDED_SHARED_MUTEX
+
 template <bool persistent>
 class SharedMemoryProcessLocalReadLocker;
 
@@ -508,7 +717,11 @@ typedef bip::interprocess_condition_any ConditionVariable;
 
 #else // !NATRON_CACHE_INTERPROCESS_ROBUST
 
+#ifdef NATRON_CACHE_USE_SHARDED_SHARED_MUTEX
+typedef ShardedSharedMutex SharedMutex;
+#else
 typedef boost::shared_mutex SharedMutex;
+#endif
 typedef boost::upgrade_mutex UpgradableMutex;
 typedef boost::mutex ExclusiveMutex;
 typedef boost::recursive_mutex RecursiveExclusiveMutex;
@@ -630,8 +843,20 @@ struct TileInternalIndexImplCompareLess
 // The list of free tiles indices in a bucket
 typedef bip::list<TileInternalIndexImpl, TileInternalIndexImplAllocator> TileInternalIndexImplList;
 
-typedef boost::interprocess::allocator<TileInternalIndex, ExternalSegmentType::segment_manager> TileInternalIndexAllocator;
-typedef boost::interprocess::list<TileInternalIndex, TileInternalIndexAllocator> TileInternalIndexList;
+/**
+ * @brief A tile allocated for a cache entry
+ **/
+struct EntryTile
+{
+    TileInternalIndex index;
+
+    // The hash passed to retrieveAndLockTiles() for this tile. This is 0 if the tile must not be kept
+    // in the CompressedTileStorage when the entry is evicted.
+    U64 hash;
+};
+
+typedef boost::interprocess::allocator<EntryTile, ExternalSegmentType::segment_manager> EntryTileAllocator;
+typedef boost::interprocess::list<EntryTile, EntryTileAllocator> EntryTileList;
 
 struct TileInternalIndexCompareLess
 {
@@ -657,6 +882,11 @@ struct TileInternalIndexCompareLess
         return false;
 
     }
+
+    bool operator() (const EntryTile& lhs, const EntryTile& rhs) const
+    {
+        return (*this)(lhs.index, rhs.index);
+    }
 };
 
 inline bool operator==(const TileInternalIndex& lhs, const TileInternalIndex& rhs)
@@ -664,9 +894,6 @@ inline bool operator==(const TileInternalIndex& lhs, const TileInternalIndex& rh
     return lhs.bucketIndex == rhs.bucketIndex && lhs.index.fileIndex == rhs.index.fileIndex && lhs.index.tileIndex == rhs.index.tileIndex;
 }
 
-//typedef boost::interprocess::set<TileInternalIndex, TileInternalIndexCompareLess, TileInternalIndexAllocator> TileInternalIndexSet;
-typedef boost::interprocess::list<TileInternalIndex, TileInternalIndexAllocator> TileInternalIndexList;
-
 /**
  * @brief Unique identifier for a process mapped to the Cache
  **/
@@ -802,7 +1029,17 @@ struct MemorySegmentEntryHeaderBase
     TimestampVal timestamp;
 
     // Set of tile indices allocated for this entry
-    TileInternalIndexList tileIndices;
+    EntryTileList tileIndices;
+
+    // The size in bytes of a pixel component of the tiles of this entry, used by the CompressedTileStorage
+    // when the entry is evicted. 0 if the tiles of this entry should not be preserved.
+    int evictedTilesElementSize;
+
+    // The node to which evictions of this entry are attributed, @see CacheEntryKeyBase::getStatsHolderID()
+    U64 statsHolderID;
+
+    // The time it took to compute the entry in seconds per MiB, @see CacheEntryKeyBase::getComputeCostHint()
+    double computeCost;
 
     MemorySegmentEntryHeaderBase(const external_void_allocator& allocator)
     : size(0)
@@ -813,6 +1050,9 @@ struct MemorySegmentEntryHeaderBase
     , lruNode()
     , timestamp()
     , tileIndices(allocator)
+    , evictedTilesElementSize(0)
+    , statsHolderID(0)
+    , computeCost(0)
     {}
 
 };
@@ -919,6 +1159,11 @@ struct CacheBucketIPCData
     // Never changes, thread-safe
     unsigned int version;
 
+    // The tile size of the cache that created the ToC: the tile indices stored in the ToC
+    // are not valid for another tile size, in which case we wipe it.
+    // Never changes, thread-safe
+    int tileSizePo2;
+
     // What operation is done on the bucket. When obtaining a write lock on the bucket,
     // if the state is other than eBucketStateOk we detected an inconsistency.
     // The bucket state is protected by the bucketMutex
@@ -937,10 +1182,11 @@ struct CacheBucketIPCData
     //
     bip::offset_ptr<TileInternalIndexImplList> freeTiles;
 
-    CacheBucketIPCData(ExternalSegmentType* segment, bool allocateFreeTiles)
+    CacheBucketIPCData(ExternalSegmentType* segment, bool allocateFreeTiles, int tileSizePo2)
     : lruListFront(0)
     , lruListBack(0)
     , version(NATRON_MEMORY_SEGMENT_ENTRY_HEADER_VERSION)
+    , tileSizePo2(tileSizePo2)
     , bucketState(eBucketStateOk)
     , size(0)
     , entriesMap()
@@ -984,6 +1230,20 @@ struct CacheBucket
     // The index of this bucket in the cache
     int bucketIndex;
 
+    // The tile size of the cache, see CacheBase::getTileSizePo2()
+    int tileSizePo2;
+
+    // True if the ToC was wiped when opened because it was written by an incompatible cache.
+    // In that case the tiles storage is not referenced anymore and must be wiped too.
+    bool tocWipedOnOpen;
+
+    // True once tocFile is mapped in this process. When the cache starts from the index snapshot of a clean shutdown,
+    // the ToC is only mapped the first time the bucket is accessed, see checkToCMemorySegmentStatus()
+    bool tocMapped;
+
+    // The path of tocFile. It is known before the file is mapped.
+    std::string tocFilePath;
+
     // Memory mapped file used to store interprocess table of contents (IPCData)
     // It contains for each entry:
     // - A LRUListNode
@@ -1002,6 +1262,10 @@ struct CacheBucket
     : cache()
     , tocFileManager()
     , bucketIndex(-1)
+    , tileSizePo2(NATRON_TILE_SIZE_PO2_DEFAULT)
+    , tocWipedOnOpen(false)
+    , tocMapped(false)
+    , tocFilePath()
     , tocFile()
     , ipc(0)
     {
@@ -1119,8 +1383,29 @@ struct CacheEntryLockerPrivate
     // UUID of the process that computed the cache entry
     boost::uuids::uuid computeProcessUUID;
 
+    // The node to which the statistics of the look-up are attributed
+    U64 statsHolderID;
+
+    // Set if the entry must be computed: this measures the time spent until it is inserted
+    boost::scoped_ptr<TimeLapse> computeTimer;
+
+    // True if the entry must be computed again after it was evicted
+    bool isReRender;
+    std::size_t reRenderSize;
+
     CacheEntryLockerPrivate(CacheEntryLocker<persistent>* publicInterface, const boost::shared_ptr<Cache<persistent> >& cache, const CacheEntryBasePtr& entry);
 
+    CacheTierEnum getStatsTier() const
+    {
+        return cache->_imp->useTileStorage ? eCacheTierTiles : eCacheTierGeneralPurpose;
+    }
+
+    /**
+     * @brief Called once the look-up status is either cached or must compute: starts measuring the compute time of the entry
+     * if it must be computed and accounts for the look-up in the cache statistics
+     **/
+    void onLookupFinished();
+
     // This function may throw a AbandonnedLockException
     enum LookUpRetCodeEnum
     {
@@ -1325,6 +1610,13 @@ struct CachePrivate
     // only protects against threads.
     boost::mutex maximumSizeMutex;
 
+    // The CacheEvictionPolicyEnum, local to the process. This is read on every cache hit.
+    QAtomicInt evictionPolicy;
+
+    // How the pages of the tile storage files should be backed, @see CacheBase::setTileStorageMemoryHints
+    QAtomicInt tileStorageHugePages;
+    QAtomicInt tileStorageNUMAPolicy;
+
     // Each bucket handle entries with the 2 first hexadecimal numbers of the hash
     // This allows to hopefully dispatch threads and processes in 256 different buckets so that they are less likely
     // to take the same lock.
@@ -1389,10 +1681,36 @@ struct CachePrivate
 
     bool useTileStorage;
 
+    // The size of a tile in bytes, see CacheBase::getTileSizeBytes()
+    std::size_t tileSizeBytes;
+
+    // How many tiles fit in a tile storage file, and in the region of each bucket in that file
+    std::size_t nTilesPerFile, nTilesPerBucketFile;
+
+    // The listeners notified of the entries inserted and removed by this process, see CacheBase::registerListener()
+    std::list<CacheListenerWPtr> listeners;
+
+    // Protects listeners.
+    // Since it lives in process memory, this mutex
+    // only protects against threads.
+    boost::mutex listenersMutex;
+
+    // How many times recoverFromInconsistentState() was called in this process, see
+    // CacheBase::getInconsistentStateRecoveriesCount(). Protected by nRecoveriesMutex
+    U64 nRecoveries;
+    mutable boost::mutex nRecoveriesMutex;
+
+    // True if the cache was opened from the index snapshot of a clean shutdown: the ToC of the buckets
+    // are then mapped on first access instead of in initialize(). Set in initialize() only.
+    bool lazyToCMapping;
+
     CachePrivate(Cache<persistent>* publicInterface, bool enableTileStorage)
     : _publicInterface(publicInterface)
     , maximumSize((std::size_t)8 * 1024 * 1024 * 1024) // 8GB max by default
     , maximumSizeMutex()
+    , evictionPolicy((int)eCacheEvictionPolicyLRU)
+    , tileStorageHugePages(0)
+    , tileStorageNUMAPolicy((int)eCacheNUMAPolicyDefault)
     , buckets()
     , tilesStorage()
 #ifdef NATRON_CACHE_INTERPROCESS_ROBUST
@@ -1412,6 +1730,14 @@ struct CachePrivate
     , nThreadsTimedOutFailed(0)
     , nThreadsTimedOutFailedCond()
     , useTileStorage(enableTileStorage)
+    , tileSizeBytes(publicInterface->getTileSizeBytes())
+    , nTilesPerFile(NATRON_TILE_STORAGE_FILE_SIZE / tileSizeBytes)
+    , nTilesPerBucketFile(NATRON_TILE_STORAGE_FILE_BUCKET_REGION_SIZE / tileSizeBytes)
+    , listeners()
+    , listenersMutex()
+    , nRecoveries(0)
+    , nRecoveriesMutex()
+    , lazyToCMapping(false)
     {
         boost::uuids::random_generator gen;
         sessionUUID = gen();
@@ -1426,6 +1752,14 @@ struct CachePrivate
 
     QString getBucketAbsoluteDirPath(int bucketIndex) const;
 
+    std::list<CacheListenerPtr> getListeners();
+
+    void notifyEntryInserted(U64 hash);
+
+    void notifyEntryRemoved(U64 hash);
+
+    void notifyCleared();
+
     static std::string getSharedMemoryName();
 
     static std::size_t getSharedMemorySize();
@@ -1446,6 +1780,56 @@ struct CachePrivate
      **/
     void recoverFromInconsistentState(boost::scoped_ptr<SharedMemoryProcessLocalReadLocker<persistent> >& shmReader);
 
+    std::string getIndexSnapshotFilePath() const;
+
+    /**
+     * @brief Writes the index snapshot: a small checksummed file recording the layout of the ToC files of all buckets.
+     * This is called when the last process using the persistent cache exits cleanly.
+     **/
+    void writeIndexSnapshot();
+
+    /**
+     * @brief Returns true if the index snapshot of the last clean shutdown exists and matches the ToC files,
+     * in which case the buckets do not have to be checked when the cache is opened.
+     * The snapshot is removed so that it never outlives the session: a process that does not exit cleanly
+     * leaves no snapshot and the next process checks all buckets.
+     **/
+    bool readAndRemoveIndexSnapshot();
+
+    /**
+     * @brief Returns the eviction priority of an entry last accessed at the given time: entries with the lowest priority are evicted first.
+     * With eCacheEvictionPolicyLRU this is the access time. With eCacheEvictionPolicyCostAware this is a GreedyDual-Size like policy where the access time plays the role of the inflation value: each second it takes to compute
+     * a MiB of the entry keeps it NATRON_CACHE_COST_AWARE_LIFETIME_PER_COST seconds longer in the cache.
+     **/
+    TimestampVal getEvictionPriority(const TimestampVal& accessTime, double computeCost) const
+    {
+        if ( (computeCost <= 0) || (evictionPolicy.loadAcquire() != (int)eCacheEvictionPolicyCostAware) ) {
+            return accessTime;
+        }
+        return addTimeToTimestamp(accessTime, computeCost * NATRON_CACHE_COST_AWARE_LIFETIME_PER_COST, timerFrequency);
+    }
+
+    /**
+     * @brief Apply the memory hints set with setTileStorageMemoryHints to the mapping of a tile storage file.
+     * These are only hints: failures are ignored.
+     **/
+    void adviseTileStorage(const StoragePtrType& storage) const
+    {
+        char* data = storage->getData();
+        if (!data) {
+            return;
+        }
+        if ( tileStorageHugePages.loadAcquire() ) {
+            adviseHugePages(data, NATRON_TILE_STORAGE_FILE_SIZE);
+        }
+        int numaPolicy = tileStorageNUMAPolicy.loadAcquire();
+        if (numaPolicy == (int)eCacheNUMAPolicyInterleave) {
+            adviseNUMAInterleave(data, NATRON_TILE_STORAGE_FILE_SIZE);
+        } else if (numaPolicy == (int)eCacheNUMAPolicyLocal) {
+            adviseNUMALocal(data, NATRON_TILE_STORAGE_FILE_SIZE);
+        }
+    }
+
     /**
      * @brief Retrieves 1 tile from the tile storage. Allocates new memory mapped file backend if not enough space.
      **/
@@ -1506,6 +1890,12 @@ struct CachePrivate
                               boost::shared_ptr<Sharable_ReadLock>& tilesReadLock,
                               const std::vector<TileInternalIndex>* tileIndices);
 
+    /**
+     * @brief Hand the tiles of the given entry to the CompressedTileStorage before the entry is evicted.
+     * The tilesStorageMutex must be taken in read mode and the bucket of the entry must be locked.
+     **/
+    void preserveEvictedTiles(const typename CacheBucket<persistent>::EntryType* cacheEntry);
+
     /**
      * @brief Scan for existing tile files. This function throws an exception if the cache is corrupted
      **/
@@ -1581,6 +1971,17 @@ public:
 };
 
 
+/**
+ * @brief Records in the LockProfiler a cache lock that was requested at startTime and is now taken.
+ * The cache locks cannot be tried generically: long waits are considered contended.
+ **/
+static void
+recordCacheLockAcquisition(double startTime)
+{
+    double waitTime = LockProfiler::getTime() - startTime;
+    LockProfiler::recordAcquisition(eLockProfilerSiteCache, waitTime > LockProfiler::getContentionThreshold(), waitTime);
+}
+
 /**
  * @brief Creates a locker object around the given process shared mutex.
  * If after some time the mutex cannot be taken it is declared abandonned and throws a AbandonnedLockException
@@ -1588,6 +1989,8 @@ public:
 template <typename LOCKPTR, bool persistent>
 void create_timed_lock_impl(const CachePrivate<persistent>* imp,  LOCKPTR& lock, typename LOCKPTR::element_type::mutex_type* mutex)
 {
+    const bool profiled = LockProfiler::isEnabled();
+    double startTime = profiled ? LockProfiler::getTime() : 0.;
     lock.reset(new typename LOCKPTR::element_type(*mutex, imp->timerFrequency));
     if (!lock->timed_lock()) {
         throw AbandonnedLockException();
@@ -1595,6 +1998,9 @@ void create_timed_lock_impl(const CachePrivate<persistent>* imp,  LOCKPTR& lock,
         qDebug() << QThread::currentThread() << "Lock timeout, clearing cache since it is probably corrupted.";
 #endif
     }
+    if (profiled) {
+        recordCacheLockAcquisition(startTime);
+    }
 }
 
 
@@ -1619,14 +2025,24 @@ void createTimedLock(const CachePrivate<persistent>* imp,  boost::shared_ptr<LOC
 template <typename LOCK, bool persistent>
 void createLock(const CachePrivate<persistent>* /*imp*/,  boost::scoped_ptr<LOCK>& lock, typename LOCK::mutex_type* mutex)
 {
+    const bool profiled = LockProfiler::isEnabled();
+    double startTime = profiled ? LockProfiler::getTime() : 0.;
     lock.reset(new LOCK(*mutex));
+    if (profiled) {
+        recordCacheLockAcquisition(startTime);
+    }
 }
 
 
 template <typename LOCK, bool persistent>
 void createLock(const CachePrivate<persistent>* /*imp*/,  boost::shared_ptr<LOCK>& lock, typename LOCK::mutex_type* mutex)
 {
+    const bool profiled = LockProfiler::isEnabled();
+    double startTime = profiled ? LockProfiler::getTime() : 0.;
     lock.reset(new LOCK(*mutex));
+    if (profiled) {
+        recordCacheLockAcquisition(startTime);
+    }
 }
 
 #endif // #ifdef NATRON_CACHE_INTERPROCESS_ROBUST
@@ -1639,9 +2055,33 @@ CacheEntryLockerPrivate<persistent>::CacheEntryLockerPrivate(CacheEntryLocker<pe
 , hash(entry->getHashKey())
 , bucket(0)
 , status(CacheEntryLockerBase::eCacheEntryStatusMustCompute)
+, computeProcessUUID()
+, statsHolderID(entry->getKey() ? entry->getKey()->getStatsHolderID() : 0)
+, computeTimer()
+, isReRender(false)
+, reRenderSize(0)
 {
 }
 
+template <bool persistent>
+void
+CacheEntryLockerPrivate<persistent>::onLookupFinished()
+{
+    assert(status != CacheEntryLockerBase::eCacheEntryStatusComputationPending);
+    if (status == CacheEntryLockerBase::eCacheEntryStatusMustCompute) {
+        computeTimer.reset(new TimeLapse);
+    }
+    CacheStats* stats = appPTR->getCacheStats();
+    if (!stats || !statsHolderID) {
+        return;
+    }
+    CacheTierEnum tier = getStatsTier();
+    stats->addLookup(statsHolderID, tier, status == CacheEntryLockerBase::eCacheEntryStatusCached);
+    if (status == CacheEntryLockerBase::eCacheEntryStatusMustCompute) {
+        isReRender = stats->takeEvictedEntry(tier, hash, &reRenderSize);
+    }
+} // onLookupFinished
+
 template <bool persistent>
 CacheEntryLocker<persistent>::CacheEntryLocker(const boost::shared_ptr<Cache<persistent> >& cache, const CacheEntryBasePtr& entry)
 : _imp(new CacheEntryLockerPrivate<persistent>(this, cache, entry))
@@ -1678,6 +2118,11 @@ CacheEntryLocker<persistent>::create(const boost::shared_ptr<Cache<persistent> >
     std::size_t timeSpentWaiting = 0;
     ret->_imp->lookupAndSetStatus(&timeSpentWaiting, 0);
 
+    // If pending, the look-up is accounted for once done waiting in waitForPendingEntry()
+    if (ret->_imp->status != eCacheEntryStatusComputationPending) {
+        ret->_imp->onLookupFinished();
+    }
+
     return ret;
 }
 
@@ -1702,15 +2147,17 @@ CacheBucket<persistent>::isToCFileMappingValid() const
 template <typename StoragePtrType>
 void ensureMappingValidInternal(Sharable_WriteLock& lock,
                                 const StoragePtrType& memoryMappedFile,
+                                const std::string& filePath,
                                 CacheIPCData::SharedMemorySegmentData* segment);
 
 template <>
 void ensureMappingValidInternal(Sharable_WriteLock& lock,
                                 const MemoryFilePtr& memoryMappedFile,
+                                const std::string& filePath,
                                 CacheIPCData::SharedMemorySegmentData* segment)
 {
+    // The file may not be mapped yet, in which case this does nothing
     memoryMappedFile->close();
-    std::string filePath = memoryMappedFile->path();
 
     // Decrement nProcessWithMappingValid and notify the thread that is resizing
     if (segment->nProcessWithMappingValid > 0) {
@@ -1730,6 +2177,7 @@ void ensureMappingValidInternal(Sharable_WriteLock& lock,
 template <>
 void ensureMappingValidInternal(Sharable_WriteLock& /*lock*/,
                                 const ProcessLocalBufferPtr& /*memoryMappedFile*/,
+                                const std::string& /*filePath*/,
                                 CacheIPCData::SharedMemorySegmentData* /*segment*/) {}
 template <typename StoragePtrType>
 std::string getStoragePath(const StoragePtrType& storage);
@@ -1815,13 +2263,13 @@ static void reOpenToCData(CacheBucket<persistent>* bucket, bool create)
 #endif
 
         // The ipc data pointer must be re-fetched
-        bucket->ipc = bucket->tocFileManager->template find_or_construct<CacheBucketIPCData<persistent> >("BucketData")(bucket->tocFileManager.get(), allocateFreeTilesStorage);
+        bucket->ipc = bucket->tocFileManager->template find_or_construct<CacheBucketIPCData<persistent> >("BucketData")(bucket->tocFileManager.get(), allocateFreeTilesStorage, bucket->tileSizePo2);
 
-        // If the version of the data is different than this build, wipe it and re-create it
-        if (bucket->ipc->version != NATRON_MEMORY_SEGMENT_ENTRY_HEADER_VERSION) {
-            std::string tileFilePath = getStoragePath(bucket->tocFile);
+        // If the version of the data is different than this build or if it was written with another tile size, wipe it and re-create it
+        if (bucket->ipc->version != NATRON_MEMORY_SEGMENT_ENTRY_HEADER_VERSION || bucket->ipc->tileSizePo2 != bucket->tileSizePo2) {
+            bucket->tocWipedOnOpen = true;
             clearStorage(bucket->tocFile);
-            openStorage(bucket->tocFile, tileFilePath, MemoryFile::eFileOpenModeOpenTruncateOrCreate);
+            openStorage(bucket->tocFile, bucket->tocFilePath, MemoryFile::eFileOpenModeOpenTruncateOrCreate);
             resizeStorage(bucket->tocFile, NATRON_CACHE_BUCKET_TOC_FILE_GROW_N_BYTES);
             reOpenToCData(bucket, true /*create*/);
         }
@@ -1872,6 +2320,7 @@ CacheBucket<persistent>::remapToCMemoryFile(Sharable_WriteLock& lock, std::size_
 {
     // Private - the tocData.segmentMutex is assumed to be taken for write lock
     boost::shared_ptr<Cache<persistent> > c = cache.lock();
+    bool firstMapping = !tocMapped;
     if (persistent) {
         if (!c->_imp->ipc->bucketsData[bucketIndex].tocData.mappingValid) {
             // Save the entire file
@@ -1882,8 +2331,9 @@ CacheBucket<persistent>::remapToCMemoryFile(Sharable_WriteLock& lock, std::size_
         qDebug() << "Checking ToC mapping:" << c->_imp->ipc->bucketsData[bucketIndex].tocData.mappingValid;
 #endif
 
-        ensureMappingValidInternal(lock, tocFile, &c->_imp->ipc->bucketsData[bucketIndex].tocData);
+        ensureMappingValidInternal(lock, tocFile, tocFilePath, &c->_imp->ipc->bucketsData[bucketIndex].tocData);
     }
+    tocMapped = true;
     // Ensure the size of the ToC file is reasonable
     std::size_t curNumBytes = tocFile->size();
 
@@ -1901,6 +2351,13 @@ CacheBucket<persistent>::remapToCMemoryFile(Sharable_WriteLock& lock, std::size_
     }
     assert(tocFileManager->get_free_memory() >= minFreeSize);
 
+    if (firstMapping && tocWipedOnOpen && c->_imp->lazyToCMapping) {
+        // The ToC did not match the index snapshot it was opened with: the tiles storage may be referenced
+        // by entries that no longer exist. The caller recovers by wiping the cache.
+        tocWipedOnOpen = false;
+        throw std::runtime_error("The table of content of a cache bucket does not match the index snapshot");
+    }
+
 } // remapToCMemoryFile
 
 
@@ -2056,10 +2513,19 @@ CacheBucket<persistent>::readFromSharedMemoryEntryImpl(EntryType* cacheEntry,
 
     // Update LRU record if this item is not already at the tail of the list
     //
-    // Take the LRU list mutex
+    // Take the LRU list mutex.
+    // A cache hit only holds the bucket in read mode: to avoid serializing all readers of the bucket
+    // on the LRU list mutex, we skip the update if another thread is already modifying the list.
+    // The LRU order is only a hint for evictLRUEntries, missing a touch of a recently used entry is harmless.
+#ifndef NATRON_CACHE_INTERPROCESS_ROBUST
+    ExclusiveLock lruWriteLock(c->_imp->ipc->bucketsData[bucketIndex].lruListMutex, boost::try_to_lock);
+    if (lruWriteLock.owns_lock())
+#endif
     {
+#ifdef NATRON_CACHE_INTERPROCESS_ROBUST
         boost::scoped_ptr<ExclusiveLock> lruWriteLock;
         createLock<ExclusiveLock>(c->_imp.get(), lruWriteLock, &c->_imp->ipc->bucketsData[bucketIndex].lruListMutex);
+#endif
 
         // Ensure the back pointer doesn't have a next element
         assert(ipc->lruListBack && !ipc->lruListBack->next);
@@ -2087,18 +2553,24 @@ CacheBucket<persistent>::readFromSharedMemoryEntryImpl(EntryType* cacheEntry,
 
         // Update the entry access timestamp
         cacheEntry->timestamp = getTimestampInSeconds();
+
+        // The holder may know better how expensive the entry is now that it was computed
+        double costHint = processLocalEntry->getKey() ? processLocalEntry->getKey()->getComputeCostHint() : 0.;
+        if (costHint > 0) {
+            cacheEntry->computeCost = costHint;
+        }
     } // lruWriteLock
 
     return eShmEntryReadRetCodeOk;
 
 } // readFromSharedMemoryEntryImpl
 
-inline char* getTileIndexPointer(char* basePtr, const TileInternalIndex& index)
+inline char* getTileIndexPointer(char* basePtr, const TileInternalIndex& index, std::size_t tileSizeBytes)
 {
     char* ptr = basePtr +
-    (index.bucketIndex * NATRON_NUM_TILES_PER_BUCKET_FILE * NATRON_TILE_SIZE_BYTES) +
-    index.index.tileIndex * NATRON_TILE_SIZE_BYTES;
-    assert((ptr >= basePtr) && (ptr < (basePtr + NATRON_NUM_TILES_PER_FILE * NATRON_TILE_SIZE_BYTES)));
+    (index.bucketIndex * NATRON_TILE_STORAGE_FILE_BUCKET_REGION_SIZE) +
+    index.index.tileIndex * tileSizeBytes;
+    assert((ptr >= basePtr) && (ptr + tileSizeBytes <= (basePtr + NATRON_TILE_STORAGE_FILE_SIZE)));
     return ptr;
 }
 
@@ -2190,7 +2662,10 @@ CacheBucket<persistent>::deallocateCacheEntryImpl(typename EntriesMap::iterator
     }
 
 
+    U64 hash = cacheEntryIt->first;
     storage->erase(cacheEntryIt);
+
+    c->_imp->notifyEntryRemoved(hash);
 } // deallocateCacheEntryImpl
 
 /*
@@ -2501,6 +2976,7 @@ CacheEntryLockerPrivate<persistent>::lookupAndCreate(boost::shared_ptr<Sharable_
     cacheEntry->size = entryToCSize;
 
     cacheEntry->pluginID.append(processLocalEntry->getKey()->getHolderPluginID().c_str());
+    cacheEntry->statsHolderID = statsHolderID;
 
     // Lock the statusMutex: this will lock-out other threads interested in this entry.
     // This mutex is unlocked in deallocateCacheEntryImpl() or in insertInCache()
@@ -2545,7 +3021,8 @@ CacheBucket<persistent>::checkToCMemorySegmentStatus(boost::shared_ptr<Sharable_
     if (persistent) {
         // Every time we take the lock, we must ensure the memory mapping is ok because the
         // memory mapped file might have been resized to fit more entries.
-        if (!isToCFileMappingValid()) {
+        // The ToC may also not be mapped yet if the cache was opened from the index snapshot.
+        if ( !tocMapped || !isToCFileMappingValid() ) {
             // Remove the read lock, and take a write lock.
             // This could allow other threads to run in-between, but we don't care since nothing happens.
             tocReadLock->reset();
@@ -2791,6 +3268,15 @@ CacheEntryLockerPrivate<persistent>::insertInternal()
         // Update the entry access timestamp
         cacheEntryIt->second->timestamp = getTimestampInSeconds();
 
+        // Image entries are inserted before their tiles are rendered: their holder gives an estimate.
+        // Otherwise the entry was computed since it was looked-up.
+        double computeCost = processLocalEntry->getKey() ? processLocalEntry->getKey()->getComputeCostHint() : 0.;
+        if (computeCost <= 0 && computeTimer) {
+            double sizeMB = std::max((double)cacheEntryIt->second->size, (double)NATRON_CACHE_COST_MIN_ENTRY_SIZE) / (1024. * 1024.);
+            computeCost = computeTimer->getTimeSinceCreation() / sizeMB;
+        }
+        cacheEntryIt->second->computeCost = computeCost;
+
     } // lruWriteLock
     cacheEntryIt->second->computeThreadMagic = 0;
     cacheEntryIt->second->status = MemorySegmentEntryHeaderBase::eEntryStatusReady;
@@ -2858,6 +3344,17 @@ CacheEntryLocker<persistent>::insertInCache()
             return;
         }
 
+        _imp->cache->_imp->notifyEntryInserted(_imp->hash);
+
+        if (_imp->isReRender && _imp->computeTimer) {
+            CacheStats* stats = appPTR->getCacheStats();
+            if (stats) {
+                stats->addReRender(_imp->statsHolderID, _imp->getStatsTier(), _imp->reRenderSize, _imp->computeTimer->getTimeSinceCreation());
+            }
+            _imp->isReRender = false;
+        }
+        _imp->computeTimer.reset();
+
         // We just inserted something, ensure the cache size remains reasonable.
         // We cannot block here until the memory stays contained in the user requested memory portion:
         // if we would do so, then it could deadlock: Natron could require more memory than what
@@ -2886,6 +3383,8 @@ CacheEntryLocker<persistent>::waitForPendingEntry(std::size_t timeout)
     // and reserve it back when done waiting.
     RELEASE_THREAD_RAII();
 
+    TraceSpan_RAII traceSpan(eTraceCategoryWait, "Wait for pending cache entry");
+
     //
     // To correctly prevent other thread/processes to not try to compute the same cache entry some form of locking is
     // required:
@@ -2918,14 +3417,25 @@ CacheEntryLocker<persistent>::waitForPendingEntry(std::size_t timeout)
             if (timeout == 0 || timeSpentWaitingForPendingEntryMS < timeout) {
                 CacheEntryLockerBase::sleep_milliseconds(timeToWaitMS);
 
-                // Increase the time to wait at the next iteration
-                timeToWaitMS *= 1.2;
+                // Increase the time to wait at the next iteration. Do not let it grow unbounded: the caller cannot
+                // check for abortion while waiting, and a long sleep would delay it once the entry is available.
+                timeToWaitMS = std::min( (std::size_t)(timeToWaitMS * 1.2), (std::size_t)NATRON_CACHE_PENDING_ENTRY_MAX_POLL_INTERVAL_MS );
 
             }
         }
 
     } while(_imp->status == eCacheEntryStatusComputationPending);
 
+    {
+        CacheStats* stats = appPTR->getCacheStats();
+        if (stats) {
+            // If we must compute the entry after the timeout, we took it over
+            bool timedOut = timeout > 0 && timeSpentWaitingForPendingEntryMS >= timeout && _imp->status == eCacheEntryStatusMustCompute;
+            stats->addPendingWait(_imp->statsHolderID, _imp->getStatsTier(), timedOut);
+        }
+        _imp->onLookupFinished();
+    }
+
     // Concurrency resumes!
     return _imp->status;
 } // waitForPendingEntry
@@ -2984,15 +3494,30 @@ CacheEntryLocker<persistent>::~CacheEntryLocker()
 
 
 template <bool persistent>
-Cache<persistent>::Cache(bool enableTileStorage)
-: _imp(new CachePrivate<persistent>(this, enableTileStorage))
+Cache<persistent>::Cache(bool enableTileStorage, int tileSizePo2)
+: CacheBase(tileSizePo2)
+, _imp(new CachePrivate<persistent>(this, enableTileStorage))
 {
 
 }
 template <bool persistent>
 Cache<persistent>::~Cache()
 {
+    if (!persistent || !_imp->globalFileLock) {
+        return;
+    }
 
+    // If this is the last process using the cache, record that it was shut down cleanly
+    try {
+        _imp->globalFileLock->unlock_sharable();
+        if ( _imp->globalFileLock->try_lock() ) {
+            flushTiles(std::vector<TileInternalIndex>(), true /*flushTableOfContents*/);
+            _imp->writeIndexSnapshot();
+            _imp->globalFileLock->unlock();
+        }
+    } catch (...) {
+        // The next process will check all buckets
+    }
 }
 
 template <bool persistent>
@@ -3034,6 +3559,14 @@ CachePrivate<persistent>::isUUIDCurrentlyActive(const boost::uuids::uuid& tag) c
     return false;
 }
 
+template <bool persistent>
+U64
+Cache<persistent>::getInconsistentStateRecoveriesCount() const
+{
+    boost::mutex::scoped_lock k(_imp->nRecoveriesMutex);
+    return _imp->nRecoveries;
+}
+
 template <bool persistent>
 void
 Cache<persistent>::cleanupMappedProcessList()
@@ -3253,24 +3786,29 @@ Cache<persistent>::initialize(const boost::shared_ptr<Cache<persistent> >& thisS
         // Hold a weak pointer to the cache on the bucket
         _imp->buckets[i].cache = thisShared;
         _imp->buckets[i].bucketIndex = i;
+        _imp->buckets[i].tileSizePo2 = getTileSizePo2();
         
 
         _imp->buckets[i].tocFile = boost::make_shared<typename CacheBucket<persistent>::StorageType>();
 
         if (persistent) {
             // Get the bucket directory path. It ends with a separator.
+            // The file is mapped by remapToCMemoryFile().
             QString bucketDirPath = _imp->getBucketAbsoluteDirPath(i);
 
-            std::string tocFilePath = bucketDirPath.toStdString() + "Index";
-            openStorage(_imp->buckets[i].tocFile, tocFilePath, (int)MemoryFile::eFileOpenModeOpenOrCreate);
-            
+            _imp->buckets[i].tocFilePath = bucketDirPath.toStdString() + "Index";
         }
         
         
     } // for each bucket
 
+    // If the last process using the cache exited cleanly and no other process is active, the buckets are known to be valid:
+    // they are mapped when first accessed, which keeps the startup time independent of the cache size.
+    // Otherwise map and check all buckets now.
+    _imp->lazyToCMapping = persistent && gotFileLock && _imp->readAndRemoveIndexSnapshot();
+
     // Remap each bucket, this may potentially fail
-    for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+    for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT && !_imp->lazyToCMapping; ++i) {
         try {
 
             boost::scoped_ptr<Sharable_WriteLock> tocWriteLock;
@@ -3298,6 +3836,25 @@ Cache<persistent>::initialize(const boost::shared_ptr<Cache<persistent> >& thisS
                 // Take the tilesStorageMutex in read mode to indicate that we are operating on it (flush)
                 createLock<Sharable_WriteLock>(_imp.get(), writeLock, &_imp->ipc->tilesStorageMutex);
                 _imp->reOpenTileStorage();
+
+                // If a bucket ToC was wiped, the existing tiles storage files are either laid out for another tile size
+                // or referenced by free tiles lists that no longer exist: remove them.
+                bool tilesStorageStale = false;
+                for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+                    if (_imp->buckets[i].tocWipedOnOpen) {
+                        tilesStorageStale = true;
+                        break;
+                    }
+                }
+                if (tilesStorageStale) {
+                    for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+                        _imp->clearCacheBucket(i);
+                    }
+                    for (std::size_t i = 0; i < _imp->tilesStorage.size(); ++i) {
+                        clearStorage(_imp->tilesStorage[i]);
+                    }
+                    _imp->tilesStorage.clear();
+                }
                 if (_imp->tilesStorage.empty()) {
                     // Ensure we initialize the cache with at least one tile storage file
 
@@ -3325,11 +3882,92 @@ Cache<persistent>::initialize(const boost::shared_ptr<Cache<persistent> >& thisS
 
 } // initialize
 
+template <bool persistent>
+std::string
+CachePrivate<persistent>::getIndexSnapshotFilePath() const
+{
+    std::stringstream ss;
+    ss << directoryContainingCachePath << "/" << NATRON_CACHE_DIRECTORY_NAME << "/IndexSnapshot";
+    return ss.str();
+}
+
+template <bool persistent>
+void
+CachePrivate<persistent>::writeIndexSnapshot()
+{
+    // The snapshot records the format of the ToC files and their size. The size of a ToC file only changes
+    // when it grows, when it is wiped or when it is created, which are all changes made by another build or a crashed process.
+    Hash64 checksum;
+    std::vector<U64> values;
+    values.push_back(NATRON_CACHE_INDEX_SNAPSHOT_MAGIC);
+    values.push_back(NATRON_MEMORY_SEGMENT_ENTRY_HEADER_VERSION);
+    values.push_back( (U64)_publicInterface->getTileSizePo2() );
+    values.push_back(NATRON_CACHE_BUCKETS_COUNT);
+    for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+        values.push_back( (U64)QFileInfo( QString::fromUtf8( buckets[i].tocFilePath.c_str() ) ).size() );
+    }
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        checksum.append(values[i]);
+    }
+    checksum.computeHash();
+    values.push_back( checksum.value() );
+
+    QFile file( QString::fromUtf8( getIndexSnapshotFilePath().c_str() ) );
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        return;
+    }
+    qint64 nBytes = (qint64)( values.size() * sizeof(U64) );
+    if (file.write( (const char*)&values.front(), nBytes ) != nBytes) {
+        file.close();
+        file.remove();
+    }
+} // writeIndexSnapshot
+
+template <bool persistent>
+bool
+CachePrivate<persistent>::readAndRemoveIndexSnapshot()
+{
+    QFile file( QString::fromUtf8( getIndexSnapshotFilePath().c_str() ) );
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+
+    // magic, version, tile size, buckets count, the size of each ToC file and the checksum
+    std::vector<U64> values(4 + NATRON_CACHE_BUCKETS_COUNT + 1);
+    qint64 nBytes = (qint64)( values.size() * sizeof(U64) );
+    bool ok = file.size() == nBytes && file.read( (char*)&values.front(), nBytes ) == nBytes;
+    file.close();
+    file.remove();
+    if (!ok) {
+        return false;
+    }
+
+    Hash64 checksum;
+    for (std::size_t i = 0; i < values.size() - 1; ++i) {
+        checksum.append(values[i]);
+    }
+    checksum.computeHash();
+    if ( (checksum.value() != values.back()) ||
+         (values[0] != NATRON_CACHE_INDEX_SNAPSHOT_MAGIC) ||
+         (values[1] != NATRON_MEMORY_SEGMENT_ENTRY_HEADER_VERSION) ||
+         (values[2] != (U64)_publicInterface->getTileSizePo2()) ||
+         (values[3] != NATRON_CACHE_BUCKETS_COUNT) ) {
+        return false;
+    }
+    for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+        QFileInfo tocFileInfo( QString::fromUtf8( buckets[i].tocFilePath.c_str() ) );
+        if ( (values[4 + i] == 0) || ( (U64)tocFileInfo.size() != values[4 + i] ) ) {
+            return false;
+        }
+    }
+    return true;
+} // readAndRemoveIndexSnapshot
+
 template <bool persistent>
 CacheBasePtr
-Cache<persistent>::create(bool enableTileStorage)
+Cache<persistent>::create(bool enableTileStorage, int tileSizePo2)
 {
-    boost::shared_ptr<Cache<persistent> > ret  = boost::make_shared<Cache<persistent> >(enableTileStorage);
+    boost::shared_ptr<Cache<persistent> > ret  = boost::make_shared<Cache<persistent> >(enableTileStorage, tileSizePo2);
     ret->initialize(ret);
     return ret;
 } // create
@@ -3389,6 +4027,7 @@ CachePrivate<persistent>::createTileStorageInternal(
             openStorage(data, ss.str(), (int)MemoryFile::eFileOpenModeOpenOrCreate);
         }
         resizeStorage(data, NATRON_TILE_STORAGE_FILE_SIZE);
+        adviseTileStorage(data);
 
         fileIndex = tilesStorage.size();
         tilesStorage.push_back(data);
@@ -3400,7 +4039,10 @@ CachePrivate<persistent>::createTileStorageInternal(
 
 
     // The number of tiles should be a multiple of the buckets count
-    assert(NATRON_NUM_TILES_PER_FILE % NATRON_CACHE_BUCKETS_COUNT == 0);
+    assert(nTilesPerFile % NATRON_CACHE_BUCKETS_COUNT == 0);
+
+    // The tile index in a bucket region is encoded on a byte
+    assert(nTilesPerBucketFile <= 256);
 
 #ifdef CACHE_TRACE_TILES_ALLOCATION
     std::cout << "=========================\ncreateTileStorageInternal: Free tiles state:\n\n";
@@ -3449,9 +4091,9 @@ CachePrivate<persistent>::createTileStorageInternal(
         // Insert the new available tiles in the freeTiles set.
         // First insert in a temporary set and then assign to the free tiles set to avoid out of memory exceptions
 #ifdef NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED
-        std::vector<TileInternalIndexImpl> tmpSet(buckets[bucket_i].ipc->freeTiles->size() + NATRON_NUM_TILES_PER_FILE);
+        std::vector<TileInternalIndexImpl> tmpSet(buckets[bucket_i].ipc->freeTiles->size() + nTilesPerFile);
 #else
-        std::vector<TileInternalIndexImpl> tmpSet(buckets[bucket_i].ipc->freeTiles->size() + NATRON_NUM_TILES_PER_BUCKET_FILE);
+        std::vector<TileInternalIndexImpl> tmpSet(buckets[bucket_i].ipc->freeTiles->size() + nTilesPerBucketFile);
 #endif
         {
             int tmpSetIndex = 0;
@@ -3460,9 +4102,9 @@ CachePrivate<persistent>::createTileStorageInternal(
                 tmpSet[tmpSetIndex] = *it;
             }
 #ifdef NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED
-            for (size_t i = 0; i < NATRON_NUM_TILES_PER_FILE; ++i, ++tmpSetIndex)
+            for (size_t i = 0; i < nTilesPerFile; ++i, ++tmpSetIndex)
 #else
-            for (size_t i = 0; i <  NATRON_NUM_TILES_PER_BUCKET_FILE; ++i, ++tmpSetIndex)
+            for (size_t i = 0; i <  nTilesPerBucketFile; ++i, ++tmpSetIndex)
 #endif
             {
                 TileInternalIndexImpl encodedIndex;
@@ -3643,6 +4285,7 @@ CachePrivate<true>::reOpenTileStorage()
             if ((data)->size() != NATRON_TILE_STORAGE_FILE_SIZE) {
                 (data)->resize(NATRON_TILE_STORAGE_FILE_SIZE, false);
             }
+            adviseTileStorage(data);
             tilesStorage.push_back(data);
         }
     }
@@ -3664,6 +4307,7 @@ Cache<persistent>::retrieveAndLockTiles(const CacheEntryBasePtr& entry,
 #else
                                         const std::vector<TileHash>* tilesToAlloc,
 #endif
+                                        int evictedTilesElementSize,
                                         std::vector<void*>* existingTilesData,
                                         std::vector<std::pair<TileInternalIndex, void*> >* allocatedTilesData,
                                         void** cacheData)
@@ -3765,11 +4409,11 @@ Cache<persistent>::retrieveAndLockTiles(const CacheEntryBasePtr& entry,
                 char* data = (*storage)->getData();
 
                 // Set the tile index on the entry so we can free it afterwards.
-                char* ptr = getTileIndexPointer(data, freeTileEncodedIndex);
+                char* ptr = getTileIndexPointer(data, freeTileEncodedIndex, _imp->tileSizeBytes);
 #ifdef INIT_TILES_TO_NAN
                 {
                     float* p = reinterpret_cast<float*>(ptr);
-                    const float* pend = p + (NATRON_TILE_SIZE_BYTES / sizeof(float));
+                    const float* pend = p + (_imp->tileSizeBytes / sizeof(float));
                     for (; p < pend; ++p) {
                         *p = std::numeric_limits<float>::quiet_NaN();
                     }
@@ -3808,7 +4452,7 @@ Cache<persistent>::retrieveAndLockTiles(const CacheEntryBasePtr& entry,
 
                 // Increment the size of the entry in the cache.
                 // Do it before releaseTilesInternal() is called because the function decrements the size of the tiles released.
-                bucket.ipc->size += nTilesToAlloc * NATRON_TILE_SIZE_BYTES;
+                bucket.ipc->size += nTilesToAlloc * _imp->tileSizeBytes;
 
                 // Look-up the cache entry
                 bool gotEntry = bucket.tryCacheLookupImpl(entryHash, &found, &storage);
@@ -3823,12 +4467,23 @@ Cache<persistent>::retrieveAndLockTiles(const CacheEntryBasePtr& entry,
                 }
                 cacheEntry = found->second.get();
 
-                cacheEntry->size += nTilesToAlloc * NATRON_TILE_SIZE_BYTES;
+                cacheEntry->size += nTilesToAlloc * _imp->tileSizeBytes;
+
+#ifndef NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED
+                // Tiles of an entry may only be preserved if they all were allocated with the same element size
+                if (evictedTilesElementSize > 0) {
+                    if (cacheEntry->evictedTilesElementSize == 0) {
+                        cacheEntry->evictedTilesElementSize = evictedTilesElementSize;
+                    } else if (cacheEntry->evictedTilesElementSize != evictedTilesElementSize) {
+                        evictedTilesElementSize = 0;
+                    }
+                }
+#endif
 
 
 #ifdef CACHE_TRACE_SIZE
-                qDebug() << entryHash << "Entry += " << nTilesToAlloc * NATRON_TILE_SIZE_BYTES;
-                qDebug() << "Bucket += " << nTilesToAlloc * NATRON_TILE_SIZE_BYTES;
+                qDebug() << entryHash << "Entry += " << nTilesToAlloc * _imp->tileSizeBytes;
+                qDebug() << "Bucket += " << nTilesToAlloc * _imp->tileSizeBytes;
 #endif
             }
 
@@ -3840,12 +4495,20 @@ Cache<persistent>::retrieveAndLockTiles(const CacheEntryBasePtr& entry,
                 for (int nAttempts = 0; nAttempts < 2; ++nAttempts) {
 
                     try {
-                        cacheEntry->tileIndices.push_back((*allocatedTilesData)[c].first);
+                        EntryTile tile;
+                        tile.index = (*allocatedTilesData)[c].first;
+#ifdef NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED
+                        tile.hash = 0;
+                        (void)evictedTilesElementSize;
+#else
+                        tile.hash = evictedTilesElementSize > 0 ? (*tilesToAlloc)[c].index : 0;
+#endif
+                        cacheEntry->tileIndices.push_back(tile);
                         break;
                     } catch (const bip::bad_alloc&) {
 
                         // We may not have enough memory to store all indices, so grow the ToC mapping
-                        std::size_t tocMemNeeded = allocatedTilesData->size() * sizeof(U64) * 2;
+                        std::size_t tocMemNeeded = allocatedTilesData->size() * sizeof(EntryTile) * 2;
 
                         // Release the bucket mutex because it will become invalid while we grow the ToC file
                         bucketWriteLock.reset();
@@ -3904,11 +4567,11 @@ Cache<persistent>::retrieveAndLockTiles(const CacheEntryBasePtr& entry,
 
 
                 char* data = (*storage)->getData();
-                char* tileDataPtr = getTileIndexPointer(data, (*tileIndices)[i]);
+                char* tileDataPtr = getTileIndexPointer(data, (*tileIndices)[i], _imp->tileSizeBytes);
 #ifdef INIT_TILES_TO_NAN
                 {
                     float* p = reinterpret_cast<float*>(tileDataPtr);
-                    const float* pend = p + (NATRON_TILE_SIZE_BYTES / sizeof(float));
+                    const float* pend = p + (_imp->tileSizeBytes / sizeof(float));
                     for (; p < pend; ++p) {
                         if (*p != *p) {
                             assert(false);
@@ -3917,7 +4580,7 @@ Cache<persistent>::retrieveAndLockTiles(const CacheEntryBasePtr& entry,
                     }
                 }
 #endif
-                assert((tileDataPtr>= data) && (tileDataPtr < (data + NATRON_NUM_TILES_PER_FILE * NATRON_TILE_SIZE_BYTES)));
+                assert((tileDataPtr>= data) && (tileDataPtr < (data + NATRON_TILE_STORAGE_FILE_SIZE)));
                 (*existingTilesData)[i] = tileDataPtr;
             } // for each tile indices
         }
@@ -3951,8 +4614,8 @@ Cache<persistent>::checkTileIndex(TileInternalIndex encodedIndex) const
         return false;
     }
     char* data = _imp->tilesStorage[encodedIndex.index.fileIndex]->getData();
-    char* tileDataPtr = getTileIndexPointer(data, encodedIndex);
-    if (tileDataPtr < data || tileDataPtr>= (data + NATRON_NUM_TILES_PER_FILE * NATRON_TILE_SIZE_BYTES)) {
+    char* tileDataPtr = getTileIndexPointer(data, encodedIndex, _imp->tileSizeBytes);
+    if (tileDataPtr < data || tileDataPtr>= (data + NATRON_TILE_STORAGE_FILE_SIZE)) {
         assert(false);
         return false;
     }
@@ -4001,10 +4664,10 @@ Cache<persistent>::unLockTiles(void* cacheData, bool invalidate)
 
 
                     char* data = (*storage)->getData();
-                    char* tileDataPtr = getTileIndexPointer(data, index);
+                    char* tileDataPtr = getTileIndexPointer(data, index, _imp->tileSizeBytes);
                     {
                         float* p = reinterpret_cast<float*>(tileDataPtr);
-                        const float* pend = p + (NATRON_TILE_SIZE_BYTES / sizeof(float));
+                        const float* pend = p + (_imp->tileSizeBytes / sizeof(float));
                         for (; p < pend; ++p) {
                             if (*p != *p) {
                                 assert(false);
@@ -4016,6 +4679,14 @@ Cache<persistent>::unLockTiles(void* cacheData, bool invalidate)
                 }
             }
 #endif
+
+            if (persistent && !invalidate && !tilesLock->allocatedTiles.empty()) {
+                // The tiles were written by the caller: sync them to disk in a separate thread
+                CacheFlusherThread* flusher = appPTR->getCacheFlusherThread();
+                if (flusher) {
+                    flusher->appendDirtyTiles(tilesLock->allocatedTiles, _imp->tileSizeBytes);
+                }
+            }
         } catch (...) {
 
             tilesLock->tileReadLock.reset();
@@ -4030,6 +4701,66 @@ Cache<persistent>::unLockTiles(void* cacheData, bool invalidate)
     
 } // unLockTiles
 
+template <bool persistent>
+void
+Cache<persistent>::flushTiles(const std::vector<TileInternalIndex>& tiles, bool flushTableOfContents)
+{
+    if (!persistent || !_imp->useTileStorage) {
+        return;
+    }
+
+    boost::scoped_ptr<SharedMemoryProcessLocalReadLocker<persistent> > shmReader(new SharedMemoryProcessLocalReadLocker<persistent>(_imp.get()));
+
+    try {
+        {
+            // Take the tilesStorageMutex in read mode to indicate that we are operating on it (flush)
+            boost::scoped_ptr<Sharable_ReadLock> tileReadLock;
+            createLock<Sharable_ReadLock>(_imp.get(), tileReadLock, &_imp->ipc->tilesStorageMutex);
+
+            // Sort the tiles by address so that contiguous tiles are synced with a single call
+            std::vector<std::pair<std::size_t, char*> > tilesPtr;
+            tilesPtr.reserve(tiles.size());
+            for (std::vector<TileInternalIndex>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+                // The cache may have been cleared since
+                if (it->index.fileIndex >= _imp->tilesStorage.size()) {
+                    continue;
+                }
+                char* data = _imp->tilesStorage[it->index.fileIndex]->getData();
+                if (!data) {
+                    continue;
+                }
+                tilesPtr.push_back(std::make_pair((std::size_t)it->index.fileIndex, getTileIndexPointer(data, *it, _imp->tileSizeBytes)));
+            }
+            std::sort(tilesPtr.begin(), tilesPtr.end());
+
+            std::size_t i = 0;
+            while (i < tilesPtr.size()) {
+                std::size_t fileIndex = tilesPtr[i].first;
+                char* rangeStart = tilesPtr[i].second;
+                std::size_t rangeSize = _imp->tileSizeBytes;
+                ++i;
+                while (i < tilesPtr.size() && tilesPtr[i].first == fileIndex && tilesPtr[i].second <= rangeStart + rangeSize) {
+                    rangeSize = std::max(rangeSize, (std::size_t)(tilesPtr[i].second - rangeStart) + _imp->tileSizeBytes);
+                    ++i;
+                }
+                flushMemory(_imp->tilesStorage[fileIndex], (int)MemoryFile::eFlushTypeSync, rangeStart, rangeSize);
+            }
+        }
+
+        // Sync the table of contents after the tiles so that it never references tiles that are not on disk yet
+        if (flushTableOfContents) {
+            for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+                boost::scoped_ptr<Sharable_ReadLock> tocReadLock;
+                createLock<Sharable_ReadLock>(_imp.get(), tocReadLock, &_imp->ipc->bucketsData[i].tocData.segmentMutex);
+                flushMemory(_imp->buckets[i].tocFile, (int)MemoryFile::eFlushTypeSync, NULL, 0);
+            }
+        }
+    } catch (...) {
+        // Any exception caught here means the cache is corrupted
+        _imp->recoverFromInconsistentState(shmReader);
+    }
+} // flushTiles
+
 template <bool persistent>
 void
 CachePrivate<persistent>::releaseTilesInternal(int cacheEntryBucketIndex,
@@ -4065,36 +4796,37 @@ CachePrivate<persistent>::releaseTilesInternal(int cacheEntryBucketIndex,
             cacheEntry->tileIndices.sort(TileInternalIndexCompareLess());
 
 
-            TileInternalIndexList::iterator startIterator = cacheEntry->tileIndices.begin();
+            EntryTileList::iterator startIterator = cacheEntry->tileIndices.begin();
             for (std::size_t i = 0; i < tileIndicesSorted.size(); ++i) {
 
-                for (TileInternalIndexList::iterator it = startIterator; it != cacheEntry->tileIndices.end(); ++it) {
-                    if (*it == tileIndicesSorted[i]) {
+                for (EntryTileList::iterator it = startIterator; it != cacheEntry->tileIndices.end(); ++it) {
+                    if (it->index == tileIndicesSorted[i]) {
                         ++nTilesRemoved;
                         startIterator = cacheEntry->tileIndices.erase(it);
                         tilesToDeallocate.push_back(tileIndicesSorted[i]);
+                        break;
                     }
                 }
             }
             
             
-            assert(cacheEntry->size >= nTilesRemoved * NATRON_TILE_SIZE_BYTES);
+            assert(cacheEntry->size >= nTilesRemoved * tileSizeBytes);
 #ifdef CACHE_TRACE_SIZE
-            qDebug() << cacheEntry->lruNode.hash << "Entry -= "<< nTilesRemoved * NATRON_TILE_SIZE_BYTES;
+            qDebug() << cacheEntry->lruNode.hash << "Entry -= "<< nTilesRemoved * tileSizeBytes;
 #endif
-            cacheEntry->size -= nTilesRemoved * NATRON_TILE_SIZE_BYTES;
+            cacheEntry->size -= nTilesRemoved * tileSizeBytes;
         } // cacheEntry
 
     } else if (cacheEntry) {
         tilesToDeallocate.resize(cacheEntry->tileIndices.size());
-        assert(cacheEntry->size >= cacheEntry->tileIndices.size() * NATRON_TILE_SIZE_BYTES);
+        assert(cacheEntry->size >= cacheEntry->tileIndices.size() * tileSizeBytes);
 #ifdef CACHE_TRACE_SIZE
-        qDebug() << cacheEntry->lruNode.hash << "Entry -= "<< cacheEntry->tileIndices.size() * NATRON_TILE_SIZE_BYTES;
+        qDebug() << cacheEntry->lruNode.hash << "Entry -= "<< cacheEntry->tileIndices.size() * tileSizeBytes;
 #endif
-        cacheEntry->size -= cacheEntry->tileIndices.size() * NATRON_TILE_SIZE_BYTES;
-        TileInternalIndexList::const_iterator it = cacheEntry->tileIndices.begin();
+        cacheEntry->size -= cacheEntry->tileIndices.size() * tileSizeBytes;
+        EntryTileList::const_iterator it = cacheEntry->tileIndices.begin();
         for (std::size_t i = 0; i < tilesToDeallocate.size(); ++i, ++it) {
-            tilesToDeallocate[i] = *it;
+            tilesToDeallocate[i] = it->index;
         }
         cacheEntry->tileIndices.clear();
     }
@@ -4200,8 +4932,8 @@ CachePrivate<persistent>::releaseTilesInternal(int cacheEntryBucketIndex,
                 storage = tilesStorage[internalIndex.index.fileIndex];
             }
             if (storage) {
-                char* ptr = getTileIndexPointer((char*)storage->getData(), internalIndex);
-                flushMemory(storage, (int)MemoryFile::eFlushTypeInvalidate, ptr, NATRON_TILE_SIZE_BYTES);
+                char* ptr = getTileIndexPointer((char*)storage->getData(), internalIndex, tileSizeBytes);
+                flushMemory(storage, (int)MemoryFile::eFlushTypeInvalidate, ptr, tileSizeBytes);
             }
 
         }
@@ -4209,14 +4941,39 @@ CachePrivate<persistent>::releaseTilesInternal(int cacheEntryBucketIndex,
 
     // Remove from the bucket size the tiles that we deallocated
 #ifdef CACHE_TRACE_SIZE
-    qDebug() << "Bucket -= "<< tilesToDeallocate.size() * NATRON_TILE_SIZE_BYTES;
+    qDebug() << "Bucket -= "<< tilesToDeallocate.size() * tileSizeBytes;
 #endif
-    assert(buckets[cacheEntryBucketIndex].ipc->size >= nSuccessfulDeallocation * NATRON_TILE_SIZE_BYTES);
-    buckets[cacheEntryBucketIndex].ipc->size -= nSuccessfulDeallocation * NATRON_TILE_SIZE_BYTES;
+    assert(buckets[cacheEntryBucketIndex].ipc->size >= nSuccessfulDeallocation * tileSizeBytes);
+    buckets[cacheEntryBucketIndex].ipc->size -= nSuccessfulDeallocation * tileSizeBytes;
 
 
 } // releaseTilesInternal
 
+template <bool persistent>
+void
+CachePrivate<persistent>::preserveEvictedTiles(const typename CacheBucket<persistent>::EntryType* cacheEntry)
+{
+    if (!useTileStorage || cacheEntry->evictedTilesElementSize <= 0 || cacheEntry->tileIndices.empty()) {
+        return;
+    }
+
+    CompressedTileStorage* compressedStorage = appPTR->getCompressedTileStorage();
+    if (!compressedStorage || !compressedStorage->isEnabled()) {
+        return;
+    }
+
+    // The tilesStorageMutex must be taken in read mode
+    assert(!ipc->tilesStorageMutex.try_lock());
+
+    for (EntryTileList::const_iterator it = cacheEntry->tileIndices.begin(); it != cacheEntry->tileIndices.end(); ++it) {
+        if (!it->hash || it->index.index.fileIndex >= tilesStorage.size()) {
+            continue;
+        }
+        char* data = tilesStorage[it->index.index.fileIndex]->getData();
+        compressedStorage->appendEvictedTile(it->hash, getTileIndexPointer(data, it->index, tileSizeBytes), tileSizeBytes, cacheEntry->evictedTilesElementSize);
+    }
+} // preserveEvictedTiles
+
 template <bool persistent>
 void
 CachePrivate<persistent>::lookupEntryAndReleaseTiles(U64 entryHash, const std::vector<TileInternalIndex>* tileIndices)
@@ -4475,6 +5232,48 @@ Cache<persistent>::getMaximumCacheSize() const
     }
 }
 
+template <bool persistent>
+void
+Cache<persistent>::setEvictionPolicy(CacheEvictionPolicyEnum policy)
+{
+    int prevPolicy = _imp->evictionPolicy.fetchAndStoreOrdered( (int)policy );
+    if (prevPolicy != (int)policy) {
+        // Entries that were kept for their cost may now be exceeding
+        evictLRUEntries(0);
+    }
+}
+
+template <bool persistent>
+CacheEvictionPolicyEnum
+Cache<persistent>::getEvictionPolicy() const
+{
+    return (CacheEvictionPolicyEnum)_imp->evictionPolicy.loadAcquire();
+}
+
+template <bool persistent>
+void
+Cache<persistent>::setTileStorageMemoryHints(bool useHugePages, CacheNUMAPolicyEnum numaPolicy)
+{
+    _imp->tileStorageHugePages.fetchAndStoreOrdered( (int)useHugePages );
+    _imp->tileStorageNUMAPolicy.fetchAndStoreOrdered( (int)numaPolicy );
+    if (!_imp->useTileStorage) {
+        return;
+    }
+
+    boost::scoped_ptr<SharedMemoryProcessLocalReadLocker<persistent> > shmReader(new SharedMemoryProcessLocalReadLocker<persistent>(_imp.get()));
+    try {
+        // Files that were opened before this call are advised too
+        boost::scoped_ptr<Sharable_ReadLock> tileReadLock;
+        createLock<Sharable_ReadLock>(_imp.get(), tileReadLock, &_imp->ipc->tilesStorageMutex);
+        for (std::size_t i = 0; i < _imp->tilesStorage.size(); ++i) {
+            _imp->adviseTileStorage(_imp->tilesStorage[i]);
+        }
+    } catch (...) {
+        // Any exception caught here means the cache is corrupted
+        _imp->recoverFromInconsistentState(shmReader);
+    }
+} // setTileStorageMemoryHints
+
 template <bool persistent>
 std::size_t
 Cache<persistent>::getCurrentSize() const
@@ -4592,21 +5391,28 @@ Cache<persistent>::isPersistent() const
 }
 
 void
-CacheBase::getTileSizePx(ImageBitDepthEnum bitdepth, int *tx, int *ty)
+CacheBase::getTileSizePx(ImageBitDepthEnum bitdepth, int *tx, int *ty) const
 {
+    getTileSizePx(_tileSizePo2, bitdepth, tx, ty);
+}
+
+void
+CacheBase::getTileSizePx(int tileSizePo2, ImageBitDepthEnum bitdepth, int *tx, int *ty)
+{
+    const int size8Bit = 1 << tileSizePo2;
     switch (bitdepth) {
         case eImageBitDepthByte:
-            *tx = NATRON_TILE_SIZE_X_8_BIT;
-            *ty = NATRON_TILE_SIZE_Y_8_BIT;
+            *tx = size8Bit;
+            *ty = size8Bit;
             break;
         case eImageBitDepthShort:
         case eImageBitDepthHalf:
-            *tx = NATRON_TILE_SIZE_X_16_BIT;
-            *ty = NATRON_TILE_SIZE_Y_16_BIT;
+            *tx = size8Bit;
+            *ty = size8Bit / 2;
             break;
         case eImageBitDepthFloat:
-            *tx = NATRON_TILE_SIZE_X_32_BIT;
-            *ty = NATRON_TILE_SIZE_Y_32_BIT;
+            *tx = size8Bit / 2;
+            *ty = size8Bit / 2;
             break;
         case eImageBitDepthNone:
             *tx = *ty = 0;
@@ -4723,6 +5529,11 @@ void
 CachePrivate<persistent>::recoverFromInconsistentState(boost::scoped_ptr<SharedMemoryProcessLocalReadLocker<persistent> >& shmAccess)
 {
 
+    {
+        boost::mutex::scoped_lock k(nRecoveriesMutex);
+        ++nRecoveries;
+    }
+
     // Release the read lock on the SHM
     shmAccess.reset();
 
@@ -4746,9 +5557,8 @@ CachePrivate<persistent>::clearCacheBucket(int bucket_i)
 
         createLock<Sharable_WriteLock>(this, tocWriteLock, &ipc->bucketsData[bucket_i].tocData.segmentMutex);
         // Close and re-create the memory mapped files
-        std::string tocFilePath = getStoragePath(bucket.tocFile);
         clearStorage(bucket.tocFile);
-        openStorage(bucket.tocFile, tocFilePath, (int)MemoryFile::eFileOpenModeOpenTruncateOrCreate);
+        openStorage(bucket.tocFile, bucket.tocFilePath, (int)MemoryFile::eFileOpenModeOpenTruncateOrCreate);
         bucket.remapToCMemoryFile(*tocWriteLock, 0);
 
     }
@@ -4799,7 +5609,7 @@ Cache<persistent>::clear()
         
     }
     
-    
+    _imp->notifyCleared();
     
 } // clear()
 
@@ -4873,10 +5683,13 @@ Cache<persistent>::evictLRUEntries(std::size_t nBytesToFree)
         boost::scoped_ptr<SharedMemoryProcessLocalReadLocker<persistent> > shmReader(new SharedMemoryProcessLocalReadLocker<persistent>(_imp.get()));
 
         // Cycle through each bucket, and establish which LRU entry of the buckets is the entry that
-        // has the oldest timestamp
-        U64 oldestEntryHash = (U64)-1;
-        bool oldestEntryTimeStampSet = false;
-        TimestampVal oldestEntryTimeStamp;
+        // has the lowest eviction priority. With a LRU policy, this is the entry with the oldest timestamp.
+        // Otherwise, an entry that is expensive to compute may be kept even if it is older than others in its
+        // bucket: look at the few least recently used entries of each bucket.
+        const int nCandidatesPerBucket = getEvictionPolicy() == eCacheEvictionPolicyCostAware ? NATRON_CACHE_COST_AWARE_EVICTION_CANDIDATES : 1;
+        U64 evictedEntryHash = (U64)-1;
+        bool evictedEntryPrioritySet = false;
+        TimestampVal evictedEntryPriority;
 
         for (int bucket_i = 0; bucket_i < NATRON_CACHE_BUCKETS_COUNT; ++bucket_i) {
             CacheBucket<persistent> & bucket = _imp->buckets[bucket_i];
@@ -4894,36 +5707,33 @@ Cache<persistent>::evictLRUEntries(std::size_t nBytesToFree)
 
 
 
-                U64 hash = 0;
+                std::vector<U64> candidates;
                 {
                     // Lock the LRU list
 
                     boost::scoped_ptr<ExclusiveLock> lruWriteLock;
                     createLock<ExclusiveLock>(_imp.get(), lruWriteLock, &_imp->ipc->bucketsData[bucket_i].lruListMutex);
                     // The least recently used entry is the one at the front of the linked list
-                    if (bucket.ipc->lruListFront) {
-                        hash = bucket.ipc->lruListFront->hash;
+                    for (LRUListNodePtr it = bucket.ipc->lruListFront; it && (int)candidates.size() < nCandidatesPerBucket; it = it->next) {
+                        candidates.push_back(it->hash);
                     }
                 }
-                if (hash == 0) {
-                    continue;
-                }
-
-                typename CacheBucket<persistent>::EntriesMap::iterator cacheEntryIt;
-                typename CacheBucket<persistent>::EntriesMap* storage;
-                if (!bucket.tryCacheLookupImpl(hash, &cacheEntryIt, &storage)) {
-                    continue;
-                }
 
+                for (std::size_t i = 0; i < candidates.size(); ++i) {
+                    if (candidates[i] == 0) {
+                        continue;
+                    }
+                    typename CacheBucket<persistent>::EntriesMap::iterator cacheEntryIt;
+                    typename CacheBucket<persistent>::EntriesMap* storage;
+                    if (!bucket.tryCacheLookupImpl(candidates[i], &cacheEntryIt, &storage)) {
+                        continue;
+                    }
 
-                if (!oldestEntryTimeStampSet) {
-                    oldestEntryTimeStampSet = true;
-                    oldestEntryTimeStamp = cacheEntryIt->second->timestamp;
-                    oldestEntryHash = hash;
-                } else {
-                    if (cacheEntryIt->second->timestamp < oldestEntryTimeStamp) {
-                        oldestEntryTimeStamp = cacheEntryIt->second->timestamp;
-                        oldestEntryHash = hash;
+                    TimestampVal priority = _imp->getEvictionPriority(cacheEntryIt->second->timestamp, cacheEntryIt->second->computeCost);
+                    if (!evictedEntryPrioritySet || priority < evictedEntryPriority) {
+                        evictedEntryPrioritySet = true;
+                        evictedEntryPriority = priority;
+                        evictedEntryHash = candidates[i];
                     }
                 }
 
@@ -4937,7 +5747,7 @@ Cache<persistent>::evictLRUEntries(std::size_t nBytesToFree)
 
         } // for each bucket
 
-        if (!oldestEntryTimeStampSet) {
+        if (!evictedEntryPrioritySet) {
 #ifdef DEBUG
             printf("Cache: could not evict!\n");
 #endif
@@ -4949,7 +5759,7 @@ Cache<persistent>::evictLRUEntries(std::size_t nBytesToFree)
 
 
 
-        int bucket_i = getBucketCacheBucketIndex(oldestEntryHash);
+        int bucket_i = getBucketCacheBucketIndex(evictedEntryHash);
         CacheBucket<persistent> & bucket = _imp->buckets[bucket_i];
 
         // Take the read lock on the toc file mapping
@@ -4967,7 +5777,7 @@ Cache<persistent>::evictLRUEntries(std::size_t nBytesToFree)
 
         typename CacheBucket<persistent>::EntriesMap::iterator cacheEntryIt;
         typename CacheBucket<persistent>::EntriesMap* storage;
-        if (!bucket.tryCacheLookupImpl(oldestEntryHash, &cacheEntryIt, &storage)) {
+        if (!bucket.tryCacheLookupImpl(evictedEntryHash, &cacheEntryIt, &storage)) {
             continue;
         }
 
@@ -4985,6 +5795,14 @@ Cache<persistent>::evictLRUEntries(std::size_t nBytesToFree)
             printf("Cache: evicted %llu bytes, curSize=%llu\n", (unsigned long long)entrySize, (unsigned long long)curSize);
 #endif
 
+            // Keep a compressed copy of the tiles so that they do not need to be rendered again if the image is requested later on
+            _imp->preserveEvictedTiles(cacheEntryIt->second.get());
+
+            CacheStats* stats = appPTR->getCacheStats();
+            if (stats) {
+                stats->addEviction(cacheEntryIt->second->statsHolderID, _imp->useTileStorage ? eCacheTierTiles : eCacheTierGeneralPurpose, evictedEntryHash, entrySize);
+            }
+
             bucket.deallocateCacheEntryImpl(cacheEntryIt, bucketLock, tocReadLock, tocWriteLock, tilesReadLock, storage);
         } catch (...) {
             // Any exception caught here means the cache is corrupted
@@ -4999,6 +5817,77 @@ Cache<persistent>::evictLRUEntries(std::size_t nBytesToFree)
     
 } // evictLRUEntries
 
+template <bool persistent>
+void
+Cache<persistent>::registerListener(const CacheListenerPtr& listener)
+{
+    boost::unique_lock<boost::mutex> k(_imp->listenersMutex);
+    _imp->listeners.push_back(listener);
+}
+
+template <bool persistent>
+void
+Cache<persistent>::unregisterListener(const CacheListenerPtr& listener)
+{
+    boost::unique_lock<boost::mutex> k(_imp->listenersMutex);
+    for (std::list<CacheListenerWPtr>::iterator it = _imp->listeners.begin(); it != _imp->listeners.end(); ++it) {
+        if (it->lock() == listener) {
+            _imp->listeners.erase(it);
+            return;
+        }
+    }
+}
+
+template <bool persistent>
+std::list<CacheListenerPtr>
+CachePrivate<persistent>::getListeners()
+{
+    std::list<CacheListenerPtr> ret;
+    boost::unique_lock<boost::mutex> k(listenersMutex);
+    std::list<CacheListenerWPtr>::iterator it = listeners.begin();
+    while (it != listeners.end()) {
+        CacheListenerPtr listener = it->lock();
+        if (!listener) {
+            // The listener was destroyed without unregistering
+            it = listeners.erase(it);
+            continue;
+        }
+        ret.push_back(listener);
+        ++it;
+    }
+    return ret;
+}
+
+template <bool persistent>
+void
+CachePrivate<persistent>::notifyEntryInserted(U64 hash)
+{
+    std::list<CacheListenerPtr> l = getListeners();
+    for (std::list<CacheListenerPtr>::const_iterator it = l.begin(); it != l.end(); ++it) {
+        (*it)->onCacheEntryInserted(hash);
+    }
+}
+
+template <bool persistent>
+void
+CachePrivate<persistent>::notifyEntryRemoved(U64 hash)
+{
+    std::list<CacheListenerPtr> l = getListeners();
+    for (std::list<CacheListenerPtr>::const_iterator it = l.begin(); it != l.end(); ++it) {
+        (*it)->onCacheEntryRemoved(hash);
+    }
+}
+
+template <bool persistent>
+void
+CachePrivate<persistent>::notifyCleared()
+{
+    std::list<CacheListenerPtr> l = getListeners();
+    for (std::list<CacheListenerPtr>::const_iterator it = l.begin(); it != l.end(); ++it) {
+        (*it)->onCacheCleared();
+    }
+}
+
 template <bool persistent>
 void
 Cache<persistent>::getMemoryStats(std::map<std::string, CacheReportInfo>* infos) const
@@ -5035,7 +5924,7 @@ Cache<persistent>::getMemoryStats(std::map<std::string, CacheReportInfo>* infos)
                     CacheReportInfo& entryData = (*infos)[pluginID];
                     ++entryData.nEntries;
                     entryData.nBytes += cacheEntryIt->second->size;
-                    entryData.nBytes += cacheEntryIt->second->tileIndices.size() * NATRON_TILE_SIZE_BYTES;
+                    entryData.nBytes += cacheEntryIt->second->tileIndices.size() * _imp->tileSizeBytes;
                 }
                 it = it->next;
             }
@@ -29,6 +29,7 @@
 #include "Global/Macros.h"
 
 #include <vector>
+#include <cassert>
 #include <sstream> // stringstream
 #include <fstream>
 #include <functional>
@@ -57,18 +58,14 @@
 // 16 bit tiles will have one side halved
 // 32 bit tiles will have both dimension halved (so tile size for 32bit is actually pow(2, tileSizePo2-1)
 //
-
-
-#define NATRON_TILE_SIZE_X_8_BIT 128
-#define NATRON_TILE_SIZE_Y_8_BIT 128
-
-#define NATRON_TILE_SIZE_X_16_BIT NATRON_TILE_SIZE_X_8_BIT
-#define NATRON_TILE_SIZE_Y_16_BIT (NATRON_TILE_SIZE_Y_8_BIT / 2)
-
-#define NATRON_TILE_SIZE_X_32_BIT (NATRON_TILE_SIZE_X_8_BIT / 2)
-#define NATRON_TILE_SIZE_Y_32_BIT (NATRON_TILE_SIZE_Y_8_BIT / 2)
-
-#define NATRON_TILE_SIZE_BYTES (NATRON_TILE_SIZE_X_8_BIT * NATRON_TILE_SIZE_Y_8_BIT)
+// A tile always takes pow(2, 2 * tileSizePo2) bytes, whatever its bitdepth.
+// The tile size is a parameter of each Cache, given when creating it (@see CacheBase::getTileSizePo2).
+// Large tiles reduce the per-tile overhead (tile state, look-ups, locking) on large images whereas small
+// tiles waste less memory on the borders of small images.
+// Tiles cannot be smaller than the default: a bucket can address at most 256 tiles per storage file (@see TileInternalIndexImpl).
+#define NATRON_TILE_SIZE_PO2_MIN 7 // 128x128 8-bit tiles, 64x64 float tiles: 16KiB
+#define NATRON_TILE_SIZE_PO2_MAX 9 // 512x512 8-bit tiles, 256x256 float tiles: 256KiB
+#define NATRON_TILE_SIZE_PO2_DEFAULT 7 // 128x128 8-bit tiles, 64x64 float tiles: 16KiB
 
 
 // The name of the directory containing all buckets on disk.
@@ -139,7 +136,7 @@
 // - Be inter-process robust so that if multiple Natron processes run at the same time they can share images
 // Since memory in the Cache is limited, the Cache itself has to be the manager of the memory used by images that are
 // stored within the Cache.
-// The memory in the Cache is actually stored in small memory chunks of NATRON_TILE_SIZE_BYTES bytes. For an image this represents a small tile
+// The memory in the Cache is actually stored in small memory chunks of getTileSizeBytes() bytes. For an image this represents a small tile
 // of a mono-channel image.
 // Since each tile has the same memory amount and the memory is aligned to a power of 2, efficient vector instructions can be used on them.
 // The Cache exposes mainly the functionnality to allocate and free tiles. The assembling of tiles into images is itself managed by the ImageCacheEntry.
@@ -344,15 +341,56 @@ private:
 template <bool persistent>
 struct CachePrivate;
 
+/**
+ * @brief A small listener class interface to inherit from to be notified of the entries inserted in and removed
+ * from a cache, so that a view of the cache content can be kept up to date without querying the cache.
+ *
+ * Only the changes made by this process are notified: entries of a persistent cache inserted or evicted by
+ * another process are not.
+ * The notifications are made from the thread modifying the cache, possibly while holding cache locks:
+ * implementations must return quickly and must not call the cache.
+ **/
+class CacheListener
+{
+public:
+
+    CacheListener()
+    {
+
+    }
+
+    virtual ~CacheListener()
+    {
+
+    }
+
+    /**
+     * @brief Called when the entry with the given hash was computed and inserted in the cache.
+     **/
+    virtual void onCacheEntryInserted(U64 hash) = 0;
+
+    /**
+     * @brief Called when the entry with the given hash was removed from the cache, either because it was evicted
+     * or explicitly removed.
+     **/
+    virtual void onCacheEntryRemoved(U64 hash) = 0;
+
+    /**
+     * @brief Called when all entries of the cache were removed.
+     **/
+    virtual void onCacheCleared() = 0;
+};
+
 class CacheBase
 {
 
 
 public:
 
-    CacheBase()
+    CacheBase(int tileSizePo2)
+    : _tileSizePo2(tileSizePo2)
     {
-
+        assert(tileSizePo2 >= NATRON_TILE_SIZE_PO2_MIN && tileSizePo2 <= NATRON_TILE_SIZE_PO2_MAX);
     }
 
     virtual ~CacheBase()
@@ -379,9 +417,35 @@ public:
 
 
     /**
-     * @brief Returns the tile size (of one dimension) in pixels for the given bitdepth/
+     * @brief Returns the tile size (of one dimension) in pixels for the given bitdepth of the tiles of this cache.
      **/
-    static void getTileSizePx(ImageBitDepthEnum bitdepth, int *tx, int *ty);
+    void getTileSizePx(ImageBitDepthEnum bitdepth, int *tx, int *ty) const;
+
+    /**
+     * @brief Same as above for a cache whose tiles are of the given size.
+     **/
+    static void getTileSizePx(int tileSizePo2, ImageBitDepthEnum bitdepth, int *tx, int *ty);
+
+    /**
+     * @brief Returns the size of the tiles of this cache: 8-bit tiles have pow(2, tileSizePo2) pixels in each dimension.
+     **/
+    int getTileSizePo2() const
+    {
+        return _tileSizePo2;
+    }
+
+    /**
+     * @brief Returns the number of bytes of a tile of this cache
+     **/
+    std::size_t getTileSizeBytes() const
+    {
+        return getTileSizeBytes(_tileSizePo2);
+    }
+
+    static std::size_t getTileSizeBytes(int tileSizePo2)
+    {
+        return (std::size_t)1 << (2 * tileSizePo2);
+    }
 
     /**
      * @brief Returns whether the cache is persistent or not
@@ -410,6 +474,22 @@ public:
      **/
     virtual std::size_t getCurrentSize() const = 0;
 
+    /**
+     * @brief Set how evictLRUEntries chooses the entries to evict. This is local to the process.
+     * By default this is eCacheEvictionPolicyLRU.
+     **/
+    virtual void setEvictionPolicy(CacheEvictionPolicyEnum policy) = 0;
+
+    virtual CacheEvictionPolicyEnum getEvictionPolicy() const = 0;
+
+    /**
+     * @brief Hint the OS about how the memory of the tile storage files should be backed: huge pages
+     * reduce TLB misses when copying tiles and interleaving the pages across NUMA nodes avoids that all tiles
+     * live on the memory of a single socket. This applies to the files already opened and to those created later on.
+     * The hints cannot be reverted on files already opened.
+     **/
+    virtual void setTileStorageMemoryHints(bool useHugePages, CacheNUMAPolicyEnum numaPolicy) = 0;
+
     /**
      * @brief Look-up the cache for the given entry's key.
      * The entry is assumed to have its key set.
@@ -430,8 +510,12 @@ public:
      * @param tilesToAlloc A vector of size of the number of desired tiles in output. The numbers in the vector are used to offset the bucket of the
      * cache on which to retrieve tiles from. If NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED is defined, this is instead the number of tiles
      * to allocate.
+     * @param evictedTilesElementSize If greater than 0, the tiles allocated by this call are kept compressed in the CompressedTileStorage
+     * under their TileHash when the entry gets evicted from the cache. This is the size in bytes of a pixel component of the tiles.
+     * Pass 0 if the content of the tiles cannot be retrieved later on from their hash only (e.g: draft renders).
+     * This is ignored if NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED is defined since tiles have no hash in that mode.
      * @param allocatedTilesData[out] In output, this contains each tiles allocated as a pair of <tileIndex, pointer>
-     * Each tile will have exactly NATRON_TILE_SIZE_BYTES bytes. The index is the index that must be passed back to the unLockTiles
+     * Each tile will have exactly getTileSizeBytes() bytes. The index is the index that must be passed back to the unLockTiles
      * and releaseTiles functions.
      *
      * @param tileIndices List of existing tile indices for which we want to retrieve a pointer to. In output they will be set to existingTilesData
@@ -455,6 +539,7 @@ public:
 #else
                                       const std::vector<TileHash>* tilesToAlloc,
 #endif
+                                      int evictedTilesElementSize,
                                       std::vector<void*>* existingTilesData,
                                       std::vector<std::pair<TileInternalIndex, void*> >* allocatedTilesData,
                                       void** cacheData) = 0;
@@ -483,6 +568,13 @@ public:
      **/
     virtual void releaseTiles(const CacheEntryBasePtr& entry, const std::vector<TileInternalIndex>& tileIndices) = 0;
 
+    /**
+     * @brief Syncs to disk the given tiles of the storage as well as the table of content of the buckets if flushTableOfContents is true.
+     * This is called by the CacheFlusherThread on the tiles the Cache queued in unLockTiles. Tiles that were freed in the meantime
+     * are ignored. This does nothing if the cache is not persistent.
+     **/
+    virtual void flushTiles(const std::vector<TileInternalIndex>& tiles, bool flushTableOfContents) = 0;
+
     /**
      * @brief Returns whether a cache entry exists for the given hash.
      * This is significantly faster than the get() function but does not return the entry.
@@ -531,7 +623,22 @@ public:
      **/
     virtual bool isUUIDCurrentlyActive(const boost::uuids::uuid& tag) const = 0;
 
+    /**
+     * @brief Register/unregister a listener. The cache will hold a weak ref to the listener.
+     **/
+    virtual void registerListener(const CacheListenerPtr& listener) = 0;
+    virtual void unregisterListener(const CacheListenerPtr& listener) = 0;
+
+    /**
+     * @brief Returns how many times this process failed to take a lock of the cache within
+     * NATRON_CACHE_INTERPROCESS_MUTEX_TIMEOUT_MS or found it corrupted, and cleared the cache to recover.
+     **/
+    virtual U64 getInconsistentStateRecoveriesCount() const = 0;
+
+private:
 
+    // See getTileSizePo2(), never changes
+    const int _tileSizePo2;
 };
 
 /**
@@ -578,7 +685,7 @@ class Cache
 
 public:
     // used by make_shared
-    Cache(bool enableTileStorage);
+    Cache(bool enableTileStorage, int tileSizePo2);
 
     virtual ~Cache();
 
@@ -593,8 +700,10 @@ public:
     /**
      * @brief Create a new instance of a cache
      * If the cache is persistent, this function may throw a BusyCacheException exception if the cache is used by another process
+     * @param tileSizePo2 The size of the tiles allocated by the cache, @see CacheBase::getTileSizePo2.
+     * If the cache is persistent and the tiles stored on disk have a different size, the cache is wiped.
      **/
-    static CacheBasePtr create(bool enableTileStorage);
+    static CacheBasePtr create(bool enableTileStorage, int tileSizePo2 = NATRON_TILE_SIZE_PO2_DEFAULT);
 
 
     virtual bool isPersistent() const OVERRIDE FINAL;
@@ -602,6 +711,9 @@ public:
     virtual void setMaximumCacheSize(std::size_t size) OVERRIDE FINAL;
     virtual std::size_t getMaximumCacheSize() const OVERRIDE FINAL;
     virtual std::size_t getCurrentSize() const OVERRIDE FINAL;
+    virtual void setEvictionPolicy(CacheEvictionPolicyEnum policy) OVERRIDE FINAL;
+    virtual CacheEvictionPolicyEnum getEvictionPolicy() const OVERRIDE FINAL;
+    virtual void setTileStorageMemoryHints(bool useHugePages, CacheNUMAPolicyEnum numaPolicy) OVERRIDE FINAL;
     virtual CacheEntryLockerBasePtr get(const CacheEntryBasePtr& entry) const OVERRIDE FINAL;
     virtual bool retrieveAndLockTiles(const CacheEntryBasePtr& entry,
                                       const std::vector<TileInternalIndex>* tileIndices,
@@ -610,6 +722,7 @@ public:
 #else
                                       const std::vector<TileHash>* tilesToAlloc,
 #endif
+                                      int evictedTilesElementSize,
                                       std::vector<void*>* existingTilesData,
                                       std::vector<std::pair<TileInternalIndex, void*> >* allocatedTilesData,
                                       void** cacheData) OVERRIDE FINAL;
@@ -618,6 +731,7 @@ public:
 #endif
     virtual void unLockTiles(void* cacheData, bool invalidate) OVERRIDE FINAL;
     virtual void releaseTiles(const CacheEntryBasePtr& entry, const std::vector<TileInternalIndex>& tileIndices) OVERRIDE FINAL;
+    virtual void flushTiles(const std::vector<TileInternalIndex>& tiles, bool flushTableOfContents) OVERRIDE FINAL;
     virtual bool hasCacheEntryForHash(U64 hash) const OVERRIDE FINAL;
     virtual void evictLRUEntries(std::size_t nBytesToFree) OVERRIDE FINAL;
     virtual void clear() OVERRIDE FINAL;
@@ -626,6 +740,9 @@ public:
     virtual void cleanupMappedProcessList() OVERRIDE FINAL;
     virtual boost::uuids::uuid getCurrentProcessUUID() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool isUUIDCurrentlyActive(const boost::uuids::uuid& tag) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+    virtual void registerListener(const CacheListenerPtr& listener) OVERRIDE FINAL;
+    virtual void unregisterListener(const CacheListenerPtr& listener) OVERRIDE FINAL;
+    virtual U64 getInconsistentStateRecoveriesCount() const OVERRIDE FINAL;
 
 private:
 
@@ -36,12 +36,16 @@ struct CacheEntryKeyBasePrivate
 {
     mutable QMutex lock;
     std::string pluginID;
+    U64 statsHolderID;
+    double computeCostHint;
     mutable U64 hash;
     mutable bool hashComputed;
 
     CacheEntryKeyBasePrivate()
     : lock()
     , pluginID()
+    , statsHolderID(0)
+    , computeCostHint(0)
     , hash(0)
     , hashComputed(false)
     {
@@ -113,6 +117,34 @@ CacheEntryKeyBase::setHolderPluginID(const std::string& holderID) {
     _imp->pluginID = holderID;
 }
 
+U64
+CacheEntryKeyBase::getStatsHolderID() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->statsHolderID;
+}
+
+void
+CacheEntryKeyBase::setStatsHolderID(U64 holderID)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->statsHolderID = holderID;
+}
+
+double
+CacheEntryKeyBase::getComputeCostHint() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->computeCostHint;
+}
+
+void
+CacheEntryKeyBase::setComputeCostHint(double secondsPerMB)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->computeCostHint = secondsPerMB;
+}
+
 std::size_t
 CacheEntryKeyBase::getMetadataSize() const
 {
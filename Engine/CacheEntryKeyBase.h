@@ -126,6 +126,21 @@ public:
     std::string getHolderPluginID() const;
     void setHolderPluginID(const std::string& holderID);
 
+    /**
+     * @brief The node to which the cache statistics of this entry are attributed, @see CacheStats.
+     * This does not participate in the hash. 0 if the entry is not attributed to any node.
+     **/
+    U64 getStatsHolderID() const;
+    void setStatsHolderID(U64 holderID);
+
+    /**
+     * @brief The time it takes to compute the entry, in seconds per MiB of data, as expected by the holder of the entry.
+     * This is used by the eCacheEvictionPolicyCostAware eviction policy and does not participate in the hash.
+     * If 0, the Cache measures the time elapsed between the look-up of the entry and its insertion instead.
+     **/
+    double getComputeCostHint() const;
+    void setComputeCostHint(double secondsPerMB);
+
     
     /**
      * @brief Must return a unique string identifying this class.
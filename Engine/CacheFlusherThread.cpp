@@ -0,0 +1,278 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheFlusherThread.h"
+
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#ifdef DEBUG
+#include "Global/FloatingPointExceptions.h"
+#endif
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/Timer.h"
+
+// Amount of tiles waiting to be synced beyond which they are synced right away, whatever the durability
+#define NATRON_CACHE_FLUSHER_MAX_DIRTY_BYTES (256 * 1024 * 1024)
+
+// Beyond this amount the thread is too far behind: new tiles are left to the operating system
+#define NATRON_CACHE_FLUSHER_MAX_PENDING_BYTES (4 * NATRON_CACHE_FLUSHER_MAX_DIRTY_BYTES)
+
+// Interval between 2 syncs with eCacheDurabilityPeriodic, in seconds
+#define NATRON_CACHE_FLUSHER_PERIOD 5.
+
+// Time without any tile written after which the cache is considered idle with eCacheDurabilityOnIdle, in seconds
+#define NATRON_CACHE_FLUSHER_IDLE_DELAY 1.
+
+NATRON_NAMESPACE_ENTER
+
+struct CacheFlusherThreadPrivate
+{
+    // Protects all fields below
+    mutable QMutex lock;
+
+    CacheDurabilityEnum durability;
+
+    // Tiles written since the last sync
+    std::vector<TileInternalIndex> dirtyTiles;
+    std::size_t dirtyBytes;
+
+    // Used to timestamp the fields below
+    TimeLapse clock;
+    double lastAppendTime;
+    double lastFlushTime;
+
+    // True while the thread syncs a batch of tiles
+    bool flushing;
+
+    QWaitCondition noworkCond;
+    bool mustQuit;
+
+    CacheFlusherThreadPrivate()
+    : lock()
+    , durability(eCacheDurabilityNone)
+    , dirtyTiles()
+    , dirtyBytes(0)
+    , clock()
+    , lastAppendTime(0)
+    , lastFlushTime(0)
+    , flushing(false)
+    , noworkCond()
+    , mustQuit(false)
+    {
+
+    }
+
+    /**
+     * @brief Returns the number of seconds to wait before the dirty tiles must be synced, 0 if they must be synced now
+     * or -1 if there's nothing to sync. The lock must be taken.
+     **/
+    double getTimeBeforeFlush() const;
+};
+
+CacheFlusherThread::CacheFlusherThread()
+: QThread()
+, _imp(new CacheFlusherThreadPrivate())
+{
+    setObjectName( QString::fromUtf8("CacheFlusher") );
+}
+
+CacheFlusherThread::~CacheFlusherThread()
+{
+
+}
+
+void
+CacheFlusherThread::setDurability(CacheDurabilityEnum durability)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->durability = durability;
+    if (durability == eCacheDurabilityNone) {
+        _imp->dirtyTiles.clear();
+        _imp->dirtyBytes = 0;
+    }
+    _imp->noworkCond.wakeOne();
+}
+
+CacheDurabilityEnum
+CacheFlusherThread::getDurability() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->durability;
+}
+
+void
+CacheFlusherThread::appendDirtyTiles(const std::vector<TileInternalIndex>& tiles, std::size_t tileSizeBytes)
+{
+    if ( tiles.empty() ) {
+        return;
+    }
+    bool mustWake;
+    {
+        QMutexLocker k(&_imp->lock);
+        if (_imp->durability == eCacheDurabilityNone) {
+            return;
+        }
+        const std::size_t nBytes = tiles.size() * tileSizeBytes;
+        if (_imp->dirtyBytes + nBytes > NATRON_CACHE_FLUSHER_MAX_PENDING_BYTES) {
+            return;
+        }
+        _imp->dirtyTiles.insert( _imp->dirtyTiles.end(), tiles.begin(), tiles.end() );
+        _imp->dirtyBytes += nBytes;
+        _imp->lastAppendTime = _imp->clock.getTimeSinceCreation();
+
+        // The thread only needs to be woken up when the budget is exceeded, otherwise it wakes up on its own
+        mustWake = _imp->dirtyBytes >= NATRON_CACHE_FLUSHER_MAX_DIRTY_BYTES || _imp->dirtyTiles.size() == tiles.size();
+    }
+    if ( !isRunning() ) {
+        start();
+    } else if (mustWake) {
+        QMutexLocker k(&_imp->lock);
+        _imp->noworkCond.wakeOne();
+    }
+} // appendDirtyTiles
+
+std::size_t
+CacheFlusherThread::getDirtyBytes() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->dirtyBytes;
+}
+
+void
+CacheFlusherThread::clear()
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->dirtyTiles.clear();
+    _imp->dirtyBytes = 0;
+}
+
+void
+CacheFlusherThread::quitThread()
+{
+    if ( !isRunning() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = true;
+        _imp->noworkCond.wakeOne();
+    }
+    wait();
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = false;
+    }
+}
+
+bool
+CacheFlusherThread::isWorking() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->flushing || !_imp->dirtyTiles.empty();
+}
+
+double
+CacheFlusherThreadPrivate::getTimeBeforeFlush() const
+{
+    if ( dirtyTiles.empty() ) {
+        return -1;
+    }
+    if (dirtyBytes >= NATRON_CACHE_FLUSHER_MAX_DIRTY_BYTES) {
+        return 0;
+    }
+    const double now = clock.getTimeSinceCreation();
+    switch (durability) {
+        case eCacheDurabilityPeriodic:
+            return std::max(0., lastFlushTime + NATRON_CACHE_FLUSHER_PERIOD - now);
+        case eCacheDurabilityOnIdle:
+            return std::max(0., lastAppendTime + NATRON_CACHE_FLUSHER_IDLE_DELAY - now);
+        case eCacheDurabilityNone:
+        default:
+            return -1;
+    }
+} // getTimeBeforeFlush
+
+void
+CacheFlusherThread::run()
+{
+#ifdef DEBUG
+    boost_adaptbx::floating_point::exception_trapping trap(boost_adaptbx::floating_point::exception_trapping::division_by_zero |
+                                                           boost_adaptbx::floating_point::exception_trapping::invalid |
+                                                           boost_adaptbx::floating_point::exception_trapping::overflow);
+#endif
+    for (;;) {
+
+        std::vector<TileInternalIndex> batch;
+        bool quit;
+        {
+            QMutexLocker k(&_imp->lock);
+            for (;;) {
+                if (_imp->mustQuit) {
+                    break;
+                }
+                double timeBeforeFlush = _imp->getTimeBeforeFlush();
+                if (timeBeforeFlush == 0) {
+                    break;
+                }
+                if (timeBeforeFlush < 0) {
+                    _imp->noworkCond.wait(&_imp->lock);
+                } else {
+                    _imp->noworkCond.wait( &_imp->lock, (unsigned long)std::ceil(timeBeforeFlush * 1000.) );
+                }
+            }
+            quit = _imp->mustQuit;
+
+            // When quitting, sync everything that was written so far so that the cache is complete on disk the next time it is opened
+            batch.swap(_imp->dirtyTiles);
+            _imp->dirtyBytes = 0;
+            _imp->flushing = !batch.empty();
+        }
+
+        if ( !batch.empty() ) {
+            CacheBasePtr cache = appPTR->getTileCache();
+            if (cache) {
+                cache->flushTiles(batch, true /*flushTableOfContents*/);
+            }
+        }
+
+        {
+            QMutexLocker k(&_imp->lock);
+            _imp->flushing = false;
+            _imp->lastFlushTime = _imp->clock.getTimeSinceCreation();
+        }
+
+        if (quit) {
+            return;
+        }
+    }
+} // run
+
+NATRON_NAMESPACE_EXIT
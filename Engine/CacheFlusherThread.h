@@ -0,0 +1,105 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_CacheFlusherThread_h
+#define Engine_CacheFlusherThread_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/Enums.h"
+
+#include "Engine/EngineFwd.h"
+#include "Engine/ImageTilesState.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Write-behind thread for the persistent tile cache: tiles are written by render threads directly in the
+ * memory mapped storage files and the Cache hands the tiles it just allocated to this thread when they are unlocked.
+ * This thread batches them and syncs them to disk with CacheBase::flushTiles, along with the table of content of
+ * the buckets, so that render threads never wait on disk I/O and the cache is in a consistent state on disk after a crash.
+ *
+ * When the tiles are synced depends on the CacheDurabilityEnum: periodically or once no tile was written for a while.
+ * In any case, they are synced as soon as more than NATRON_CACHE_FLUSHER_MAX_DIRTY_BYTES are waiting.
+ * If the disk is too slow to keep up, tiles are not queued anymore and the operating system writes them back on its own.
+ **/
+struct CacheFlusherThreadPrivate;
+class CacheFlusherThread
+: public QThread
+{
+
+public:
+
+    CacheFlusherThread();
+
+    virtual ~CacheFlusherThread();
+
+    void setDurability(CacheDurabilityEnum durability);
+
+    CacheDurabilityEnum getDurability() const;
+
+    /**
+     * @brief Queue the given tiles of the tile cache to be synced to disk. This is cheap and is called by the
+     * Cache while it holds its locks.
+     * @param tileSizeBytes The size of a tile, @see CacheBase::getTileSizeBytes()
+     **/
+    void appendDirtyTiles(const std::vector<TileInternalIndex>& tiles, std::size_t tileSizeBytes);
+
+    /**
+     * @brief Returns the number of bytes of tiles waiting to be synced
+     **/
+    std::size_t getDirtyBytes() const;
+
+    /**
+     * @brief Drop all tiles waiting to be synced, e.g: because the cache was cleared
+     **/
+    void clear();
+
+    /**
+     * @brief Sync all waiting tiles and stop the thread
+     **/
+    void quitThread();
+
+    bool isWorking() const;
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    boost::scoped_ptr<CacheFlusherThreadPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_CacheFlusherThread_h
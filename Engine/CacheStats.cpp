@@ -0,0 +1,416 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheStats.h"
+
+#include <cassert>
+#include <list>
+#include <map>
+
+#include <QMutex>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#endif
+
+#include "Engine/Hash64.h"
+#include "Engine/ThreadStorage.h"
+
+// How many evicted entries are remembered to detect re-renders
+#define NATRON_CACHE_STATS_MAX_EVICTED_ENTRIES 100000
+
+NATRON_NAMESPACE_ENTER
+
+CacheTierCounters::CacheTierCounters()
+: nLookups(0)
+, nHits(0)
+, nMisses(0)
+, nPendingWaits(0)
+, nPendingWaitTimeouts(0)
+, nEvictions(0)
+, nReRenders(0)
+, nReRenderedBytes(0)
+, reRenderTime(0)
+{
+
+}
+
+void
+CacheTierCounters::operator+=(const CacheTierCounters& other)
+{
+    nLookups += other.nLookups;
+    nHits += other.nHits;
+    nMisses += other.nMisses;
+    nPendingWaits += other.nPendingWaits;
+    nPendingWaitTimeouts += other.nPendingWaitTimeouts;
+    nEvictions += other.nEvictions;
+    nReRenders += other.nReRenders;
+    nReRenderedBytes += other.nReRenderedBytes;
+    reRenderTime += other.reRenderTime;
+}
+
+typedef std::map<U64, CacheNodeCounters> CacheNodeCountersMap;
+
+// The counters of a single thread
+struct CacheStatsThreadData
+{
+    // Only contended when the statistics are read
+    QMutex lock;
+    CacheNodeCountersMap counters;
+
+    // The counters of all holders, never reset, including the lookups without holder
+    CacheNodeCounters totals;
+};
+
+typedef boost::shared_ptr<CacheStatsThreadData> CacheStatsThreadDataPtr;
+
+struct EvictedEntry
+{
+    U64 hash;
+    CacheTierEnum tier;
+    std::size_t size;
+};
+
+// Front is the least recently evicted entry
+typedef std::list<EvictedEntry> EvictedEntryList;
+
+// The key identifies an entry in a tier
+typedef std::map<std::pair<U64, int>, EvictedEntryList::iterator> EvictedEntryMap;
+
+struct CacheStatsPrivate
+{
+    // Random part of the holder IDs made in this process
+    U64 holderIDSeed;
+
+    // The thread data of each thread that ever incremented a counter
+    ThreadStorage<CacheStatsThreadDataPtr> threadData;
+
+    // Protects threadsData, nextHolderID
+    mutable QMutex threadsDataLock;
+    std::list<CacheStatsThreadDataPtr> threadsData;
+    U64 nextHolderID;
+
+    // Protects evictedEntries, evictedEntriesMap
+    QMutex evictedEntriesLock;
+    EvictedEntryList evictedEntries;
+    EvictedEntryMap evictedEntriesMap;
+
+    CacheStatsPrivate()
+    : holderIDSeed(0)
+    , threadData()
+    , threadsDataLock()
+    , threadsData()
+    , nextHolderID(1)
+    , evictedEntriesLock()
+    , evictedEntries()
+    , evictedEntriesMap()
+    {
+        boost::uuids::random_generator gen;
+        boost::uuids::uuid uuid = gen();
+        Hash64 hash;
+        for (boost::uuids::uuid::const_iterator it = uuid.begin(); it != uuid.end(); ++it) {
+            hash.append(*it);
+        }
+        hash.computeHash();
+        holderIDSeed = hash.value();
+    }
+
+    /**
+     * @brief Returns the counters of the caller thread, registering them on first use.
+     **/
+    CacheStatsThreadData* getThreadData()
+    {
+        CacheStatsThreadDataPtr& data = threadData.localData();
+        if (!data) {
+            data = boost::make_shared<CacheStatsThreadData>();
+            QMutexLocker k(&threadsDataLock);
+            threadsData.push_back(data);
+        }
+        return data.get();
+    }
+};
+
+CacheStats::CacheStats()
+: _imp(new CacheStatsPrivate())
+{
+
+}
+
+CacheStats::~CacheStats()
+{
+
+}
+
+U64
+CacheStats::makeHolderID()
+{
+    U64 index;
+    {
+        QMutexLocker k(&_imp->threadsDataLock);
+        index = _imp->nextHolderID++;
+    }
+    Hash64 hash;
+    hash.append(_imp->holderIDSeed);
+    hash.append(index);
+    hash.computeHash();
+    U64 ret = hash.value();
+    return ret == 0 ? 1 : ret;
+}
+
+static void
+addLookupToCounters(CacheTierCounters& counters, bool hit)
+{
+    ++counters.nLookups;
+    if (hit) {
+        ++counters.nHits;
+    } else {
+        ++counters.nMisses;
+    }
+}
+
+void
+CacheStats::addLookup(U64 holderID, CacheTierEnum tier, bool hit)
+{
+    CacheStatsThreadData* data = _imp->getThreadData();
+    QMutexLocker k(&data->lock);
+    addLookupToCounters(data->totals.tiers[tier], hit);
+    if (!holderID) {
+        return;
+    }
+    addLookupToCounters(data->counters[holderID].tiers[tier], hit);
+}
+
+static void
+addPendingWaitToCounters(CacheTierCounters& counters, bool timedOut)
+{
+    ++counters.nPendingWaits;
+    if (timedOut) {
+        ++counters.nPendingWaitTimeouts;
+    }
+}
+
+void
+CacheStats::addPendingWait(U64 holderID, CacheTierEnum tier, bool timedOut)
+{
+    CacheStatsThreadData* data = _imp->getThreadData();
+    QMutexLocker k(&data->lock);
+    addPendingWaitToCounters(data->totals.tiers[tier], timedOut);
+    if (!holderID) {
+        return;
+    }
+    addPendingWaitToCounters(data->counters[holderID].tiers[tier], timedOut);
+}
+
+void
+CacheStats::addEviction(U64 holderID, CacheTierEnum tier, U64 entryHash, std::size_t entrySize)
+{
+    {
+        QMutexLocker k(&_imp->evictedEntriesLock);
+        std::pair<U64, int> key(entryHash, (int)tier);
+        EvictedEntryMap::iterator found = _imp->evictedEntriesMap.find(key);
+        if ( found != _imp->evictedEntriesMap.end() ) {
+            _imp->evictedEntries.erase(found->second);
+            _imp->evictedEntriesMap.erase(found);
+        }
+        EvictedEntry entry = {entryHash, tier, entrySize};
+        _imp->evictedEntries.push_back(entry);
+        _imp->evictedEntriesMap[key] = --_imp->evictedEntries.end();
+        while (_imp->evictedEntries.size() > NATRON_CACHE_STATS_MAX_EVICTED_ENTRIES) {
+            const EvictedEntry& oldest = _imp->evictedEntries.front();
+            _imp->evictedEntriesMap.erase( std::make_pair(oldest.hash, (int)oldest.tier) );
+            _imp->evictedEntries.pop_front();
+        }
+    }
+
+    CacheStatsThreadData* data = _imp->getThreadData();
+    QMutexLocker k(&data->lock);
+    ++data->totals.tiers[tier].nEvictions;
+    if (!holderID) {
+        return;
+    }
+    ++data->counters[holderID].tiers[tier].nEvictions;
+}
+
+bool
+CacheStats::takeEvictedEntry(CacheTierEnum tier, U64 entryHash, std::size_t* entrySize)
+{
+    QMutexLocker k(&_imp->evictedEntriesLock);
+    EvictedEntryMap::iterator found = _imp->evictedEntriesMap.find( std::make_pair(entryHash, (int)tier) );
+    if ( found == _imp->evictedEntriesMap.end() ) {
+        return false;
+    }
+    *entrySize = found->second->size;
+    _imp->evictedEntries.erase(found->second);
+    _imp->evictedEntriesMap.erase(found);
+    return true;
+}
+
+static void
+addReRenderToCounters(CacheTierCounters& counters, std::size_t entrySize, double timeSpent)
+{
+    ++counters.nReRenders;
+    counters.nReRenderedBytes += entrySize;
+    counters.reRenderTime += timeSpent;
+}
+
+void
+CacheStats::addReRender(U64 holderID, CacheTierEnum tier, std::size_t entrySize, double timeSpent)
+{
+    CacheStatsThreadData* data = _imp->getThreadData();
+    QMutexLocker k(&data->lock);
+    addReRenderToCounters(data->totals.tiers[tier], entrySize, timeSpent);
+    if (!holderID) {
+        return;
+    }
+    addReRenderToCounters(data->counters[holderID].tiers[tier], entrySize, timeSpent);
+}
+
+void
+CacheStats::getCounters(U64 holderID, CacheNodeCounters* counters) const
+{
+    *counters = CacheNodeCounters();
+    QMutexLocker k(&_imp->threadsDataLock);
+    for (std::list<CacheStatsThreadDataPtr>::const_iterator it = _imp->threadsData.begin(); it != _imp->threadsData.end(); ++it) {
+        QMutexLocker k2(&(*it)->lock);
+        CacheNodeCountersMap::const_iterator found = (*it)->counters.find(holderID);
+        if ( found == (*it)->counters.end() ) {
+            continue;
+        }
+        for (int i = 0; i < eCacheTierCount; ++i) {
+            counters->tiers[i] += found->second.tiers[i];
+        }
+    }
+}
+
+void
+CacheStats::getTotalCounters(CacheNodeCounters* counters) const
+{
+    *counters = CacheNodeCounters();
+    QMutexLocker k(&_imp->threadsDataLock);
+    for (std::list<CacheStatsThreadDataPtr>::const_iterator it = _imp->threadsData.begin(); it != _imp->threadsData.end(); ++it) {
+        QMutexLocker k2(&(*it)->lock);
+        for (int i = 0; i < eCacheTierCount; ++i) {
+            counters->tiers[i] += (*it)->totals.tiers[i];
+        }
+    }
+}
+
+void
+CacheStats::resetCounters(U64 holderID)
+{
+    QMutexLocker k(&_imp->threadsDataLock);
+    for (std::list<CacheStatsThreadDataPtr>::const_iterator it = _imp->threadsData.begin(); it != _imp->threadsData.end(); ++it) {
+        QMutexLocker k2(&(*it)->lock);
+        (*it)->counters.erase(holderID);
+    }
+}
+
+std::string
+CacheStats::getTierName(CacheTierEnum tier)
+{
+    switch (tier) {
+        case eCacheTierTiles:
+            return "tiles";
+        case eCacheTierCompressedTiles:
+            return "compressedTiles";
+        case eCacheTierRemoteTiles:
+            return "remoteTiles";
+        case eCacheTierDiskCacheNode:
+            return "diskCacheNode";
+        case eCacheTierImportedTiles:
+            return "importedTiles";
+        case eCacheTierGeneralPurpose:
+            return "generalPurpose";
+        case eCacheTierImageBufferPool:
+            return "imageBufferPool";
+        case eCacheTierCount:
+            break;
+    }
+    return std::string();
+}
+
+bool
+CacheStats::getCounterByName(const CacheNodeCounters& counters, const std::string& name, double* value)
+{
+    std::size_t dot = name.find('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string tierName = name.substr(0, dot);
+    std::string counterName = name.substr(dot + 1);
+    for (int i = 0; i < eCacheTierCount; ++i) {
+        if ( tierName != getTierName( (CacheTierEnum)i ) ) {
+            continue;
+        }
+        const CacheTierCounters& c = counters.tiers[i];
+        if (counterName == "lookups") {
+            *value = (double)c.nLookups;
+        } else if (counterName == "hits") {
+            *value = (double)c.nHits;
+        } else if (counterName == "misses") {
+            *value = (double)c.nMisses;
+        } else if (counterName == "pendingWaits") {
+            *value = (double)c.nPendingWaits;
+        } else if (counterName == "pendingWaitTimeouts") {
+            *value = (double)c.nPendingWaitTimeouts;
+        } else if (counterName == "evictions") {
+            *value = (double)c.nEvictions;
+        } else if (counterName == "reRenders") {
+            *value = (double)c.nReRenders;
+        } else if (counterName == "reRenderedBytes") {
+            *value = (double)c.nReRenderedBytes;
+        } else if (counterName == "reRenderTime") {
+            *value = c.reRenderTime;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    return false;
+} // getCounterByName
+
+void
+CacheStats::getCountersByName(const CacheNodeCounters& counters, std::map<std::string, double>* values)
+{
+    static const char* counterNames[] = {
+        "lookups", "hits", "misses", "pendingWaits", "pendingWaitTimeouts", "evictions", "reRenders", "reRenderedBytes", "reRenderTime", 0
+    };
+
+    for (int i = 0; i < eCacheTierCount; ++i) {
+        std::string tierName = getTierName( (CacheTierEnum)i );
+        for (int c = 0; counterNames[c]; ++c) {
+            std::string name = tierName + '.' + counterNames[c];
+            double value = 0.;
+            if ( getCounterByName(counters, name, &value) ) {
+                (*values)[name] = value;
+            }
+        }
+    }
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,204 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_CacheStats_h
+#define Engine_CacheStats_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The caches for which statistics are gathered
+ **/
+enum CacheTierEnum
+{
+    // The tile cache holding images, either in RAM or persistent on disk
+    eCacheTierTiles = 0,
+
+    // The tiles evicted from the tile cache and kept compressed in RAM, @see CompressedTileStorage
+    eCacheTierCompressedTiles,
+
+    // The tiles shared by several machines, @see RemoteTileCache
+    eCacheTierRemoteTiles,
+
+    // The tiles stored compressed in the file of a DiskCache node, @see CompressedTileFile
+    eCacheTierDiskCacheNode,
+
+    // The tiles of the archives imported with --import-cache, @see TileArchive
+    eCacheTierImportedTiles,
+
+    // The general purpose cache, holding the results of actions
+    eCacheTierGeneralPurpose,
+
+    // The recycled buffers of images in RAM, @see ImageBufferPool
+    eCacheTierImageBufferPool,
+
+    eCacheTierCount
+};
+
+/**
+ * @brief Counters of a node for one cache tier
+ **/
+struct CacheTierCounters
+{
+    // Number of times the node looked up an entry in the cache
+    U64 nLookups;
+
+    // Number of lookups that found the entry, either ready or after waiting for another thread to compute it
+    U64 nHits;
+
+    // Number of lookups after which the node had to compute the entry
+    U64 nMisses;
+
+    // Number of times the node waited for another thread or process computing the same entry
+    U64 nPendingWaits;
+
+    // Number of those waits that timed out, in which case the node computed the entry itself
+    U64 nPendingWaitTimeouts;
+
+    // Number of entries of the node evicted from the cache because it was full
+    U64 nEvictions;
+
+    // Number of entries of the node that were computed again after being evicted,
+    // the bytes they take in the cache and the time in seconds spent computing them again
+    U64 nReRenders;
+    U64 nReRenderedBytes;
+    double reRenderTime;
+
+    CacheTierCounters();
+
+    void operator+=(const CacheTierCounters& other);
+};
+
+struct CacheNodeCounters
+{
+    CacheTierCounters tiers[eCacheTierCount];
+};
+
+/**
+ * @brief Gathers per node cache statistics for all caches of the application.
+ *
+ * Nodes are identified by an opaque holder ID (@see Node::getCacheStatsHolderID()) which is stored on the
+ * cache entries keys so that the cache can attribute lookups and evictions to a node without knowing about nodes.
+ *
+ * Counters are accumulated per thread: incrementing a counter only takes a lock that no other thread takes
+ * except when reading the statistics, so this is cheap enough to always be enabled.
+ *
+ * To count the work wasted because of evictions, this class remembers the most recently evicted entries
+ * of the process: when a node has to compute again one of these entries, the time spent between the
+ * lookup and the insertion in the cache is accounted as a re-render.
+ **/
+struct CacheStatsPrivate;
+class CacheStats
+{
+public:
+
+    CacheStats();
+
+    ~CacheStats();
+
+    /**
+     * @brief Returns a new identifier for a node, never 0 which means no holder.
+     * Identifiers are unique across processes sharing a persistent cache.
+     **/
+    U64 makeHolderID();
+
+    void addLookup(U64 holderID, CacheTierEnum tier, bool hit);
+
+    /**
+     * @brief Called when a lookup found the entry pending: this is counted as a wait.
+     * @param timedOut True if the thread takes over the computation of the entry after waiting.
+     **/
+    void addPendingWait(U64 holderID, CacheTierEnum tier, bool timedOut);
+
+    /**
+     * @brief Called by the cache when it evicts an entry of the given size.
+     **/
+    void addEviction(U64 holderID, CacheTierEnum tier, U64 entryHash, std::size_t entrySize);
+
+    /**
+     * @brief Returns true if the entry with the given hash was evicted recently from the given tier and forget about it.
+     * In output, entrySize is the size the entry had in the cache.
+     **/
+    bool takeEvictedEntry(CacheTierEnum tier, U64 entryHash, std::size_t* entrySize);
+
+    /**
+     * @brief Called once an entry returned by takeEvictedEntry() was computed again in the given time (in seconds).
+     **/
+    void addReRender(U64 holderID, CacheTierEnum tier, std::size_t entrySize, double timeSpent);
+
+    /**
+     * @brief Returns the counters of the given holder, summed over all threads.
+     **/
+    void getCounters(U64 holderID, CacheNodeCounters* counters) const;
+
+    /**
+     * @brief Returns the counters of the whole process, summed over all holders and threads.
+     * Unlike the counters of each holder, these are never reset.
+     **/
+    void getTotalCounters(CacheNodeCounters* counters) const;
+
+    /**
+     * @brief Forget the counters of the given holder, this should also be called when the holder is destroyed.
+     **/
+    void resetCounters(U64 holderID);
+
+    /**
+     * @brief Returns the name of the tier as used by the Python API
+     **/
+    static std::string getTierName(CacheTierEnum tier);
+
+    /**
+     * @brief Returns the value of the counter with the given name, as used by the Python API: <tier>.<counter>
+     * e.g: "tiles.hits". Returns false if the name is not known.
+     **/
+    static bool getCounterByName(const CacheNodeCounters& counters, const std::string& name, double* value);
+
+    /**
+     * @brief Returns all the counters of all tiers by name, as accepted by getCounterByName()
+     **/
+    static void getCountersByName(const CacheNodeCounters& counters, std::map<std::string, double>* values);
+
+private:
+
+    boost::scoped_ptr<CacheStatsPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_CacheStats_h
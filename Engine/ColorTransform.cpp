@@ -0,0 +1,284 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ColorTransform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/FrameViewRequest.h"
+#include "Engine/Image.h"
+
+NATRON_NAMESPACE_ENTER
+
+ColorTransform::ColorTransform()
+: inputNbToTransform(-1)
+, lutRangeMin(0.)
+, lutRangeMax(1.)
+, clampBlack(false)
+, clampWhite(false)
+{
+    setIdentity();
+}
+
+ColorTransform::~ColorTransform()
+{
+
+}
+
+void
+ColorTransform::setIdentity()
+{
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            matrix[i][j] = i == j ? 1. : 0.;
+        }
+        offset[i] = 0.;
+        lut[i].clear();
+    }
+    lutRangeMin = 0.;
+    lutRangeMax = 1.;
+    clampBlack = false;
+    clampWhite = false;
+}
+
+bool
+ColorTransform::isAffine() const
+{
+    if (clampBlack || clampWhite) {
+        return false;
+    }
+    for (int i = 0; i < 4; ++i) {
+        if (!lut[i].empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+ColorTransform::concatenate(const ColorTransform& after)
+{
+    assert(isAffine());
+
+    // M = A * M, o = A * o + a
+    double m[4][4];
+    double o[4];
+    for (int i = 0; i < 4; ++i) {
+        o[i] = after.offset[i];
+        for (int j = 0; j < 4; ++j) {
+            m[i][j] = 0.;
+            for (int k = 0; k < 4; ++k) {
+                m[i][j] += after.matrix[i][k] * matrix[k][j];
+            }
+            o[i] += after.matrix[i][j] * offset[j];
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            matrix[i][j] = m[i][j];
+        }
+        offset[i] = o[i];
+        lut[i] = after.lut[i];
+    }
+    lutRangeMin = after.lutRangeMin;
+    lutRangeMax = after.lutRangeMax;
+    clampBlack = after.clampBlack;
+    clampWhite = after.clampWhite;
+} // concatenate
+
+void
+ColorTransform::apply(float rgba[4]) const
+{
+    float tmp[4];
+    for (int i = 0; i < 4; ++i) {
+        tmp[i] = (float)(matrix[i][0] * rgba[0] + matrix[i][1] * rgba[1] + matrix[i][2] * rgba[2] + matrix[i][3] * rgba[3] + offset[i]);
+    }
+    for (int i = 0; i < 4; ++i) {
+        const std::vector<float>& table = lut[i];
+        if (!table.empty()) {
+            const int lastIndex = (int)table.size() - 1;
+            double t = lutRangeMax > lutRangeMin ? (tmp[i] - lutRangeMin) / (lutRangeMax - lutRangeMin) * lastIndex : 0.;
+            if (t <= 0.) {
+                tmp[i] = table[0];
+            } else if (t >= lastIndex) {
+                tmp[i] = table[lastIndex];
+            } else {
+                int index = (int)t;
+                float alpha = (float)(t - index);
+                tmp[i] = table[index] * (1.f - alpha) + table[index + 1] * alpha;
+            }
+        }
+        if (clampBlack && tmp[i] < 0.f) {
+            tmp[i] = 0.f;
+        }
+        if (clampWhite && tmp[i] > 1.f) {
+            tmp[i] = 1.f;
+        }
+        rgba[i] = tmp[i];
+    }
+} // apply
+
+struct ColorTransformStackPrivate
+{
+    // The request from which we must retrieve the image
+    FrameViewRequestPtr inputRequest;
+    std::list<ColorTransform> stack;
+};
+
+
+ColorTransformStack::ColorTransformStack()
+: _imp(new ColorTransformStackPrivate)
+{
+
+}
+
+ColorTransformStack::~ColorTransformStack()
+{
+}
+
+FrameViewRequestPtr
+ColorTransformStack::getInputRequest() const
+{
+    return _imp->inputRequest;
+}
+
+void
+ColorTransformStack::setInputRequest(const FrameViewRequestPtr& request)
+{
+    _imp->inputRequest = request;
+}
+
+void
+ColorTransformStack::pushColorTransform(const ColorTransform& transform)
+{
+    // If the last pushed transform is affine, fold this one into it
+    if (!_imp->stack.empty() && _imp->stack.back().isAffine()) {
+        _imp->stack.back().concatenate(transform);
+    } else {
+        _imp->stack.push_back(transform);
+    }
+}
+
+void
+ColorTransformStack::pushColorTransformStack(const ColorTransformStack& stack)
+{
+    for (std::list<ColorTransform>::const_iterator it = stack._imp->stack.begin(); it != stack._imp->stack.end(); ++it) {
+        pushColorTransform(*it);
+    }
+}
+
+const std::list<ColorTransform>&
+ColorTransformStack::getStack() const
+{
+    return _imp->stack;
+}
+
+template <typename PIX, int maxValue>
+static void
+applyColorTransformStackToPixel(const void* customData, int nComps, PIX* pixelsPtr[4])
+{
+    const std::list<ColorTransform>* stack = (const std::list<ColorTransform>*)customData;
+
+    // Map the channels of the pixel to RGBA: alpha only images are mapped to the alpha channel.
+    // Missing color channels are considered black and a missing alpha opaque.
+    float rgba[4] = {0.f, 0.f, 0.f, 1.f};
+    const int firstChannel = nComps == 1 ? 3 : 0;
+    for (int c = 0; c < nComps; ++c) {
+        rgba[firstChannel + c] = maxValue == 1 ? (float)*pixelsPtr[c] : (float)*pixelsPtr[c] / maxValue;
+    }
+
+    for (std::list<ColorTransform>::const_iterator it = stack->begin(); it != stack->end(); ++it) {
+        it->apply(rgba);
+    }
+
+    for (int c = 0; c < nComps; ++c) {
+        float v = rgba[firstChannel + c];
+        if (maxValue == 1) {
+            *pixelsPtr[c] = (PIX)v;
+        } else {
+            v = std::max(0.f, std::min(v, 1.f));
+            *pixelsPtr[c] = (PIX)(v * maxValue + 0.5f);
+        }
+    }
+} // applyColorTransformStackToPixel
+
+ActionRetCodeEnum
+ColorTransformStack::applyColorTransformStack(const RectI& roi, const ImagePtr& image) const
+{
+    assert(image->getStorageMode() == eStorageModeRAM);
+    if (image->getStorageMode() != eStorageModeRAM) {
+        return eActionStatusFailed;
+    }
+    if (_imp->stack.empty()) {
+        return eActionStatusOK;
+    }
+    switch (image->getBitDepth()) {
+        case eImageBitDepthByte:
+            return image->applyCPUPixelShader_Byte(roi, &_imp->stack, applyColorTransformStackToPixel<unsigned char, 255>);
+        case eImageBitDepthShort:
+            return image->applyCPUPixelShader_Short(roi, &_imp->stack, applyColorTransformStackToPixel<unsigned short, 65535>);
+        case eImageBitDepthFloat:
+            return image->applyCPUPixelShader_Float(roi, &_imp->stack, applyColorTransformStackToPixel<float, 1>);
+        default:
+            return eActionStatusFailed;
+    }
+} // applyColorTransformStack
+
+ActionRetCodeEnum
+ColorTransformStack::renderFromInputRequest(const RectI& roi, const ImagePtr& dstImage) const
+{
+    assert(_imp->inputRequest);
+    ImagePtr srcImage = _imp->inputRequest->getRequestedScaleImagePlane();
+    if (!srcImage) {
+        return eActionStatusFailed;
+    }
+
+    RectI copyWindow;
+    if (!roi.intersect(srcImage->getBounds(), &copyWindow) || !copyWindow.intersect(dstImage->getBounds(), &copyWindow)) {
+        return eActionStatusOK;
+    }
+
+    Image::CopyPixelsArgs copyArgs;
+    {
+        AppInstancePtr app = _imp->inputRequest->getEffect()->getApp();
+        copyArgs.roi = copyWindow;
+        copyArgs.srcColorspace = app->getDefaultColorSpaceForBitDepth(srcImage->getBitDepth());
+        copyArgs.dstColorspace = app->getDefaultColorSpaceForBitDepth(dstImage->getBitDepth());
+        // The pixels are modified in place afterwards, they must not be shared with the input image
+        copyArgs.forceCopyEvenIfBuffersHaveSameLayout = true;
+    }
+    ActionRetCodeEnum stat = dstImage->copyPixels(*srcImage, copyArgs);
+    if (isFailureRetCode(stat)) {
+        return stat;
+    }
+    return applyColorTransformStack(copyWindow, dstImage);
+} // renderFromInputRequest
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,152 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef Engine_ColorTransform_h
+#define Engine_ColorTransform_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A per-pixel color operation that can be described as an affine transform of the RGBA channels,
+ * followed by an optional per-channel look-up table and an optional clamp.
+ * Effects that return such a transform (e.g: Grade, Multiply, Gamma...) may be concatenated by Natron:
+ * only the last effect of the chain processes the pixels, in a single pass.
+ **/
+class ColorTransform
+{
+
+public:
+
+    ColorTransform();
+
+    ~ColorTransform();
+
+    /**
+     * @brief Resets the transform to identity: identity matrix, no offset, no look-up table and no clamp
+     **/
+    void setIdentity();
+
+    /**
+     * @brief Returns true if the transform only has the matrix and offset parts, in which case it may be folded
+     * with the next transform of a chain.
+     **/
+    bool isAffine() const;
+
+    /**
+     * @brief Appends the given transform after this one. This transform must be affine. 
+     * The look-up tables and clamps of this transform are replaced by the ones of the given transform.
+     **/
+    void concatenate(const ColorTransform& after);
+
+    /**
+     * @brief Applies the transform to the given RGBA pixel
+     **/
+    void apply(float rgba[4]) const;
+
+public:
+
+    // Index of the input whose color is transformed
+    int inputNbToTransform;
+
+    // Row-major matrix applied to the RGBA channels: out[i] = sum_j(matrix[i][j] * in[j]) + offset[i]
+    double matrix[4][4];
+    double offset[4];
+
+    // Optional per-channel look-up tables applied after the matrix. Each table is sampled uniformly
+    // over [lutRangeMin, lutRangeMax], values are linearly interpolated and held outside of the range.
+    // An empty table leaves the channel unchanged.
+    std::vector<float> lut[4];
+    double lutRangeMin, lutRangeMax;
+
+    // Whether to clamp the result to 0 and 1
+    bool clampBlack, clampWhite;
+};
+
+/**
+ * @brief Represents a chain of color transforms to apply to the image rendered by an input request.
+ * Consecutive affine transforms are folded in a single matrix.
+ **/
+struct ColorTransformStackPrivate;
+class ColorTransformStack
+{
+public:
+
+    ColorTransformStack();
+
+    ~ColorTransformStack();
+
+    /**
+     * @brief Appends a new color transform to apply.
+     **/
+    void pushColorTransform(const ColorTransform& transform);
+
+    /**
+     * @brief Appends a stack of color transforms to apply.
+     **/
+    void pushColorTransformStack(const ColorTransformStack& stack);
+
+    const std::list<ColorTransform>& getStack() const;
+
+    /**
+     * @brief Get/Set the request producing the image on which to apply the color transform stack.
+     **/
+    FrameViewRequestPtr getInputRequest() const;
+    void setInputRequest(const FrameViewRequestPtr& request);
+
+    /**
+     * @brief Applies the stack onto the pixels of the given image within the given roi. 
+     * The image must be in RAM.
+     **/
+    ActionRetCodeEnum applyColorTransformStack(const RectI& roi, const ImagePtr& image) const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Copies the given roi of the image produced by the input request to dstImage and
+     * applies the color transform stack on it.
+     **/
+    ActionRetCodeEnum renderFromInputRequest(const RectI& roi, const ImagePtr& dstImage) const WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<ColorTransformStackPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+
+#endif // Engine_ColorTransform_h
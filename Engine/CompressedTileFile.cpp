@@ -0,0 +1,343 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CompressedTileFile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include <QtCore/QDebug>
+#include <QtCore/QReadWriteLock>
+
+#include "Engine/MemoryFile.h"
+#include "Engine/TileCompression.h"
+
+#define NATRON_COMPRESSED_TILE_FILE_MAGIC 0x4643544E // "NTCF"
+#define NATRON_COMPRESSED_TILE_FILE_VERSION 1
+
+// The file is grown by at least this many bytes so that it is rarely remapped
+#define NATRON_COMPRESSED_TILE_FILE_GROW_SIZE (64 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct FileHeader
+{
+    U32 magic;
+    U32 version;
+
+    // The number of bytes used in the file, including this header. The rest of the file is pre-allocated space.
+    U64 usedSize;
+};
+
+struct TileHeader
+{
+    U64 hash;
+    U32 compressedSize;
+    U32 reserved;
+};
+
+// Tiles are aligned on 8 bytes in the file so that their headers can be read in place
+inline std::size_t
+alignRecordSize(std::size_t size)
+{
+    return (size + 7) & ~(std::size_t)7;
+}
+
+struct TileLocation
+{
+    // The offset of the compressed data in the file
+    std::size_t offset;
+    std::size_t compressedSize;
+};
+
+typedef std::map<U64, TileLocation> TileIndex;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+struct CompressedTileFilePrivate
+{
+    // Protects all fields below. Readers decompress from the mapping with the read lock,
+    // writers take the write lock since growing the file remaps it.
+    mutable QReadWriteLock lock;
+
+    MemoryFile file;
+
+    TileIndex index;
+
+    // The number of bytes used in the file
+    std::size_t usedSize;
+
+    bool opened;
+
+    CompressedTileFilePrivate()
+    : lock()
+    , file()
+    , index()
+    , usedSize(0)
+    , opened(false)
+    {
+    }
+
+    FileHeader* getHeader() const
+    {
+        return reinterpret_cast<FileHeader*>( file.getData() );
+    }
+
+    void initHeader()
+    {
+        FileHeader* header = getHeader();
+        header->magic = NATRON_COMPRESSED_TILE_FILE_MAGIC;
+        header->version = NATRON_COMPRESSED_TILE_FILE_VERSION;
+        header->usedSize = sizeof(FileHeader);
+        usedSize = sizeof(FileHeader);
+        index.clear();
+    }
+
+    /**
+     * @brief Build the index by walking the tiles of the file. Returns false if the file is not a valid tile file.
+     **/
+    bool buildIndex();
+
+    /**
+     * @brief Ensures the file can hold size more bytes
+     **/
+    void ensureCapacity(std::size_t size);
+};
+
+bool
+CompressedTileFilePrivate::buildIndex()
+{
+    index.clear();
+    const std::size_t fileSize = file.size();
+    if ( fileSize < sizeof(FileHeader) ) {
+        return false;
+    }
+    const FileHeader* header = getHeader();
+    if ( (header->magic != NATRON_COMPRESSED_TILE_FILE_MAGIC) || (header->version != NATRON_COMPRESSED_TILE_FILE_VERSION) ||
+         (header->usedSize < sizeof(FileHeader)) || (header->usedSize > fileSize) ) {
+        return false;
+    }
+    usedSize = (std::size_t)header->usedSize;
+
+    const char* data = file.getData();
+    std::size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(TileHeader) <= usedSize) {
+        const TileHeader* tile = reinterpret_cast<const TileHeader*>(data + offset);
+        std::size_t dataOffset = offset + sizeof(TileHeader);
+        if (tile->compressedSize > usedSize - dataOffset) {
+            // Truncated tile, e.g: the process was killed while writing it
+            break;
+        }
+        TileLocation& location = index[tile->hash];
+        location.offset = dataOffset;
+        location.compressedSize = tile->compressedSize;
+        offset = alignRecordSize(dataOffset + tile->compressedSize);
+    }
+    usedSize = std::min(offset, usedSize);
+    return true;
+} // buildIndex
+
+void
+CompressedTileFilePrivate::ensureCapacity(std::size_t size)
+{
+    if (usedSize + size <= file.size()) {
+        return;
+    }
+    std::size_t newSize = std::max( usedSize + size, file.size() + std::max(file.size(), (std::size_t)NATRON_COMPRESSED_TILE_FILE_GROW_SIZE) );
+    file.resize(newSize, true /*preserve*/);
+}
+
+CompressedTileFile::CompressedTileFile()
+: _imp( new CompressedTileFilePrivate() )
+{
+}
+
+CompressedTileFile::~CompressedTileFile()
+{
+    close();
+}
+
+bool
+CompressedTileFile::open(const std::string& filePath)
+{
+    QWriteLocker k(&_imp->lock);
+    if (_imp->opened) {
+        return true;
+    }
+    try {
+        _imp->file.open(filePath, MemoryFile::eFileOpenModeOpenOrCreate);
+        if ( !_imp->buildIndex() ) {
+            _imp->file.resize(NATRON_COMPRESSED_TILE_FILE_GROW_SIZE, false /*preserve*/);
+            _imp->initHeader();
+        }
+    } catch (const std::exception& e) {
+        qDebug() << "Failed to open" << filePath.c_str() << ":" << e.what();
+        _imp->file.close();
+        _imp->index.clear();
+        return false;
+    }
+    _imp->opened = true;
+    return true;
+} // open
+
+void
+CompressedTileFile::close()
+{
+    QWriteLocker k(&_imp->lock);
+    if (!_imp->opened) {
+        return;
+    }
+    // Give back the space pre-allocated for the next tiles
+    try {
+        _imp->file.resize(_imp->usedSize, true /*preserve*/);
+    } catch (const std::exception& e) {
+        qDebug() << "Failed to truncate" << _imp->file.path().c_str() << ":" << e.what();
+    }
+    _imp->file.flush(MemoryFile::eFlushTypeSync, NULL, 0);
+    _imp->file.close();
+    _imp->index.clear();
+    _imp->usedSize = 0;
+    _imp->opened = false;
+}
+
+bool
+CompressedTileFile::isOpen() const
+{
+    QReadLocker k(&_imp->lock);
+    return _imp->opened;
+}
+
+std::string
+CompressedTileFile::getFilePath() const
+{
+    QReadLocker k(&_imp->lock);
+    return _imp->file.path();
+}
+
+bool
+CompressedTileFile::hasTile(U64 tileHash) const
+{
+    QReadLocker k(&_imp->lock);
+    return _imp->index.find(tileHash) != _imp->index.end();
+}
+
+void
+CompressedTileFile::writeTile(U64 tileHash,
+                              const void* data,
+                              std::size_t tileSizeBytes,
+                              int elementSizeBytes)
+{
+    if ( hasTile(tileHash) ) {
+        return;
+    }
+
+    // Compress outside of the lock so that other threads can keep reading
+    std::vector<U8> compressed;
+    TileCompression::compress(data, tileSizeBytes, elementSizeBytes, &compressed);
+
+    QWriteLocker k(&_imp->lock);
+    if ( !_imp->opened || ( _imp->index.find(tileHash) != _imp->index.end() ) ) {
+        return;
+    }
+
+    const std::size_t recordSize = alignRecordSize( sizeof(TileHeader) + compressed.size() );
+    try {
+        _imp->ensureCapacity(recordSize);
+    } catch (const std::exception& e) {
+        qDebug() << "Failed to grow" << _imp->file.path().c_str() << ":" << e.what();
+        return;
+    }
+
+    char* fileData = _imp->file.getData();
+    TileHeader* tile = reinterpret_cast<TileHeader*>(fileData + _imp->usedSize);
+    tile->hash = tileHash;
+    tile->compressedSize = (U32)compressed.size();
+    tile->reserved = 0;
+    std::size_t dataOffset = _imp->usedSize + sizeof(TileHeader);
+    std::memcpy(fileData + dataOffset, &compressed[0], compressed.size());
+
+    TileLocation& location = _imp->index[tileHash];
+    location.offset = dataOffset;
+    location.compressedSize = compressed.size();
+
+    // Only publish the tile in the header once its data is written
+    _imp->usedSize += recordSize;
+    _imp->getHeader()->usedSize = _imp->usedSize;
+} // writeTile
+
+bool
+CompressedTileFile::readTile(U64 tileHash,
+                             void* data,
+                             std::size_t tileSizeBytes) const
+{
+    QReadLocker k(&_imp->lock);
+    TileIndex::const_iterator found = _imp->index.find(tileHash);
+    if ( found == _imp->index.end() ) {
+        return false;
+    }
+    const U8* src = reinterpret_cast<const U8*>( _imp->file.getData() ) + found->second.offset;
+    if (TileCompression::getDecompressedSize(src, found->second.compressedSize) != tileSizeBytes) {
+        return false;
+    }
+    return TileCompression::decompress(src, found->second.compressedSize, data, tileSizeBytes);
+} // readTile
+
+void
+CompressedTileFile::clear()
+{
+    QWriteLocker k(&_imp->lock);
+    if (!_imp->opened) {
+        return;
+    }
+    try {
+        _imp->file.resize(NATRON_COMPRESSED_TILE_FILE_GROW_SIZE, false /*preserve*/);
+    } catch (const std::exception& e) {
+        qDebug() << "Failed to clear" << _imp->file.path().c_str() << ":" << e.what();
+        return;
+    }
+    _imp->initHeader();
+}
+
+std::size_t
+CompressedTileFile::getNumTiles() const
+{
+    QReadLocker k(&_imp->lock);
+    return _imp->index.size();
+}
+
+std::size_t
+CompressedTileFile::getSize() const
+{
+    QReadLocker k(&_imp->lock);
+    return _imp->usedSize;
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,120 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_COMPRESSEDTILEFILE_H
+#define NATRON_ENGINE_COMPRESSEDTILEFILE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A file holding tiles compressed with TileCompression, identified by the hash produced by CacheBase::makeTileCacheIndex.
+ * This is the storage of the DiskCacheNode when compression is enabled: unlike the persistent tile cache which stores
+ * uncompressed tiles, each tile only takes its compressed size on disk.
+ *
+ * The file is memory mapped. It starts with a small header followed by the tiles appended one after the other,
+ * each preceded by its hash and its compressed size. The index of the tiles is built when the file is opened by walking
+ * the tile headers, then a tile is read by decompressing it straight from the mapping at its offset.
+ * The file is grown by large chunks so that it is rarely remapped.
+ *
+ * This class is thread-safe.
+ **/
+struct CompressedTileFilePrivate;
+class CompressedTileFile
+{
+public:
+
+    CompressedTileFile();
+
+    ~CompressedTileFile();
+
+    /**
+     * @brief Opens the file at the given path, creating it if needed. A file that is not a valid tile file is truncated.
+     * Returns false if the file could not be opened.
+     **/
+    bool open(const std::string& filePath);
+
+    /**
+     * @brief Flushes the file to the disk and closes it
+     **/
+    void close();
+
+    bool isOpen() const;
+
+    std::string getFilePath() const;
+
+    /**
+     * @brief Returns true if a tile with the given hash is in the file
+     **/
+    bool hasTile(U64 tileHash) const;
+
+    /**
+     * @brief Compress the given tile and append it to the file. This does nothing if it is already in the file.
+     * @param tileSizeBytes The size of the tile, @see CacheBase::getTileSizeBytes()
+     * @param elementSizeBytes The size of a pixel component in the tile, this drives the predictor of the codec.
+     **/
+    void writeTile(U64 tileHash, const void* data, std::size_t tileSizeBytes, int elementSizeBytes);
+
+    /**
+     * @brief If the tile exists, decompress it to data which must be tileSizeBytes large.
+     * Returns false if the tile does not exist or if it was not of the given size.
+     **/
+    bool readTile(U64 tileHash, void* data, std::size_t tileSizeBytes) const;
+
+    /**
+     * @brief Removes all tiles from the file
+     **/
+    void clear();
+
+    /**
+     * @brief Returns the number of tiles in the file
+     **/
+    std::size_t getNumTiles() const;
+
+    /**
+     * @brief Returns the number of bytes taken by the tiles in the file
+     **/
+    std::size_t getSize() const;
+
+private:
+
+    boost::scoped_ptr<CompressedTileFilePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_COMPRESSEDTILEFILE_H
@@ -0,0 +1,341 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CompressedTileStorage.h"
+
+#include <cassert>
+#include <list>
+#include <map>
+#include <vector>
+#include <cstring>
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDebug>
+
+#ifdef DEBUG
+#include "Global/FloatingPointExceptions.h"
+#endif
+#include "Engine/Cache.h"
+#include "Engine/TileCompression.h"
+
+// Maximum number of bytes of uncompressed tiles waiting for the compression thread (1024 tiles of the default tile size).
+// Beyond that evicted tiles are dropped as they were before the compressed storage existed.
+#define NATRON_COMPRESSED_TILE_STORAGE_MAX_PENDING_BYTES (16 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER
+
+struct PendingTile
+{
+    U64 hash;
+    int elementSizeBytes;
+    std::vector<U8> data;
+};
+
+typedef std::list<PendingTile> PendingTileList;
+
+struct CompressedTile
+{
+    U64 hash;
+    std::vector<U8> data;
+};
+
+// Front is the least recently inserted tile
+typedef std::list<CompressedTile> CompressedTileList;
+
+struct CompressedTileStoragePrivate
+{
+    // Protects all fields below
+    mutable QMutex lock;
+
+    std::size_t maximumSize;
+    std::size_t currentSize;
+
+    PendingTileList pendingTiles;
+    std::map<U64, PendingTileList::iterator> pendingTilesMap;
+
+    // Sum of the size of the pending tiles
+    std::size_t pendingSize;
+
+    CompressedTileList compressedTiles;
+    std::map<U64, CompressedTileList::iterator> compressedTilesMap;
+
+    QWaitCondition noworkCond;
+    bool mustQuit;
+
+    CompressedTileStoragePrivate()
+    : lock()
+    , maximumSize(0)
+    , currentSize(0)
+    , pendingTiles()
+    , pendingTilesMap()
+    , pendingSize(0)
+    , compressedTiles()
+    , compressedTilesMap()
+    , noworkCond()
+    , mustQuit(false)
+    {
+
+    }
+
+    void clearPendingTiles()
+    {
+        pendingTiles.clear();
+        pendingTilesMap.clear();
+        pendingSize = 0;
+    }
+
+    void removeCompressedTile(std::map<U64, CompressedTileList::iterator>::iterator it)
+    {
+        assert(currentSize >= it->second->data.size());
+        currentSize -= it->second->data.size();
+        compressedTiles.erase(it->second);
+        compressedTilesMap.erase(it);
+    }
+
+    // Drop the oldest tiles until the pool fits in maximumSize
+    void evictOldestTiles()
+    {
+        while (currentSize > maximumSize && !compressedTiles.empty()) {
+            std::map<U64, CompressedTileList::iterator>::iterator found = compressedTilesMap.find(compressedTiles.front().hash);
+            assert(found != compressedTilesMap.end());
+            removeCompressedTile(found);
+        }
+    }
+};
+
+CompressedTileStorage::CompressedTileStorage()
+: QThread()
+, _imp(new CompressedTileStoragePrivate())
+{
+    setObjectName( QString::fromUtf8("CompressedTileStorage") );
+}
+
+CompressedTileStorage::~CompressedTileStorage()
+{
+
+}
+
+void
+CompressedTileStorage::setMaximumSize(std::size_t size)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->maximumSize = size;
+    if (!size) {
+        _imp->clearPendingTiles();
+    }
+    _imp->evictOldestTiles();
+}
+
+std::size_t
+CompressedTileStorage::getMaximumSize() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->maximumSize;
+}
+
+std::size_t
+CompressedTileStorage::getCurrentSize() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->currentSize;
+}
+
+bool
+CompressedTileStorage::isEnabled() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->maximumSize > 0;
+}
+
+void
+CompressedTileStorage::appendEvictedTile(U64 tileHash, const void* data, std::size_t tileSizeBytes, int elementSizeBytes)
+{
+    {
+        QMutexLocker k(&_imp->lock);
+        if (!_imp->maximumSize) {
+            return;
+        }
+        if ( _imp->pendingTilesMap.find(tileHash) != _imp->pendingTilesMap.end() ) {
+            return;
+        }
+        if (_imp->pendingSize + tileSizeBytes > NATRON_COMPRESSED_TILE_STORAGE_MAX_PENDING_BYTES) {
+            return;
+        }
+
+        // A tile with the same hash has the same content: an older compressed version is no longer needed
+        std::map<U64, CompressedTileList::iterator>::iterator foundCompressed = _imp->compressedTilesMap.find(tileHash);
+        if ( foundCompressed != _imp->compressedTilesMap.end() ) {
+            _imp->removeCompressedTile(foundCompressed);
+        }
+
+        _imp->pendingTiles.push_back( PendingTile() );
+        PendingTile& tile = _imp->pendingTiles.back();
+        tile.hash = tileHash;
+        tile.elementSizeBytes = elementSizeBytes;
+        tile.data.resize(tileSizeBytes);
+        std::memcpy(&tile.data[0], data, tileSizeBytes);
+        _imp->pendingTilesMap[tileHash] = --_imp->pendingTiles.end();
+        _imp->pendingSize += tileSizeBytes;
+    }
+    if ( !isRunning() ) {
+        start();
+    } else {
+        QMutexLocker k(&_imp->lock);
+        _imp->noworkCond.wakeOne();
+    }
+} // appendEvictedTile
+
+bool
+CompressedTileStorage::hasTile(U64 tileHash) const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->compressedTilesMap.find(tileHash) != _imp->compressedTilesMap.end() ||
+           _imp->pendingTilesMap.find(tileHash) != _imp->pendingTilesMap.end();
+}
+
+bool
+CompressedTileStorage::retrieveTile(U64 tileHash, void* data, std::size_t tileSizeBytes)
+{
+    CompressedTile tile;
+    {
+        QMutexLocker k(&_imp->lock);
+
+        // The tile may not have been compressed yet
+        std::map<U64, PendingTileList::iterator>::iterator foundPending = _imp->pendingTilesMap.find(tileHash);
+        if ( foundPending != _imp->pendingTilesMap.end() ) {
+            const std::vector<U8>& pendingData = foundPending->second->data;
+            bool sizeMatches = pendingData.size() == tileSizeBytes;
+            if (sizeMatches) {
+                std::memcpy(data, &pendingData[0], tileSizeBytes);
+            }
+            _imp->pendingSize -= pendingData.size();
+            _imp->pendingTiles.erase(foundPending->second);
+            _imp->pendingTilesMap.erase(foundPending);
+            return sizeMatches;
+        }
+
+        std::map<U64, CompressedTileList::iterator>::iterator found = _imp->compressedTilesMap.find(tileHash);
+        if ( found == _imp->compressedTilesMap.end() ) {
+            return false;
+        }
+        tile.data.swap(found->second->data);
+        _imp->currentSize -= tile.data.size();
+        _imp->compressedTiles.erase(found->second);
+        _imp->compressedTilesMap.erase(found);
+    }
+
+    // Decompress outside of the lock. This fails if the tile does not have the requested size.
+    if ( tile.data.empty() || !TileCompression::decompress(&tile.data[0], tile.data.size(), data, tileSizeBytes) ) {
+        qDebug() << "[BUG]: Failed to decompress tile" << tileHash;
+        return false;
+    }
+    return true;
+} // retrieveTile
+
+void
+CompressedTileStorage::clear()
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->clearPendingTiles();
+    _imp->compressedTiles.clear();
+    _imp->compressedTilesMap.clear();
+    _imp->currentSize = 0;
+}
+
+void
+CompressedTileStorage::quitThread()
+{
+    if ( !isRunning() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = true;
+        _imp->noworkCond.wakeOne();
+    }
+    wait();
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = false;
+    }
+}
+
+bool
+CompressedTileStorage::isWorking() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return !_imp->pendingTiles.empty();
+}
+
+void
+CompressedTileStorage::run()
+{
+#ifdef DEBUG
+    boost_adaptbx::floating_point::exception_trapping trap(boost_adaptbx::floating_point::exception_trapping::division_by_zero |
+                                                           boost_adaptbx::floating_point::exception_trapping::invalid |
+                                                           boost_adaptbx::floating_point::exception_trapping::overflow);
+#endif
+    for (;;) {
+
+        PendingTileList front;
+        {
+            QMutexLocker k(&_imp->lock);
+            while ( !_imp->mustQuit && _imp->pendingTiles.empty() ) {
+                _imp->noworkCond.wait(&_imp->lock);
+            }
+            if (_imp->mustQuit) {
+                // Pending tiles are not worth compressing if we are quitting
+                _imp->clearPendingTiles();
+                return;
+            }
+
+            // Move the tile out of the queue: from now on it is invisible to retrieveTile() until it is compressed
+            _imp->pendingTilesMap.erase(_imp->pendingTiles.front().hash);
+            _imp->pendingSize -= _imp->pendingTiles.front().data.size();
+            front.splice(front.begin(), _imp->pendingTiles, _imp->pendingTiles.begin());
+        }
+
+        CompressedTile tile;
+        tile.hash = front.front().hash;
+        TileCompression::compress(&front.front().data[0], front.front().data.size(), front.front().elementSizeBytes, &tile.data);
+
+        {
+            QMutexLocker k(&_imp->lock);
+            if ( !_imp->maximumSize || ( _imp->compressedTilesMap.find(tile.hash) != _imp->compressedTilesMap.end() ) ) {
+                continue;
+            }
+            _imp->currentSize += tile.data.size();
+            _imp->compressedTiles.push_back(CompressedTile());
+            _imp->compressedTiles.back().hash = tile.hash;
+            _imp->compressedTiles.back().data.swap(tile.data);
+            _imp->compressedTilesMap[tile.hash] = --_imp->compressedTiles.end();
+            _imp->evictOldestTiles();
+        }
+    }
+} // run
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,118 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_CompressedTileStorage_h
+#define Engine_CompressedTileStorage_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A second tier for the tile cache: when the Cache evicts an entry, the tiles it owned are handed
+ * to this class which compresses them with TileCompression in a separate thread and keeps them in a bounded
+ * process local RAM pool, identified by the hash produced by CacheBase::makeTileCacheIndex.
+ *
+ * When an image is fetched again from the cache, the ImageCacheEntry looks up the tiles it is missing here
+ * before marking them to be rendered. A tile that is retrieved is removed from the pool since it goes back to the Cache.
+ * The pool has its own LRU: when full the oldest compressed tiles are dropped.
+ **/
+struct CompressedTileStoragePrivate;
+class CompressedTileStorage
+: public QThread
+{
+
+public:
+
+    CompressedTileStorage();
+
+    virtual ~CompressedTileStorage();
+
+    /**
+     * @brief Set the maximum amount of RAM (in bytes) taken by compressed tiles. 0 disables the storage
+     * and frees all compressed tiles.
+     **/
+    void setMaximumSize(std::size_t size);
+
+    std::size_t getMaximumSize() const;
+
+    /**
+     * @brief Returns the number of bytes currently taken by compressed tiles
+     **/
+    std::size_t getCurrentSize() const;
+
+    bool isEnabled() const;
+
+    /**
+     * @brief Copy the given tile and queue it for compression. This is cheap and is called by the Cache while
+     * it holds its locks, the compression happens in this thread.
+     * If the compression thread is too far behind, the tile is dropped.
+     * @param tileSizeBytes The size of the tile, @see CacheBase::getTileSizeBytes()
+     * @param elementSizeBytes The size of a pixel component in the tile, this drives the predictor of the codec.
+     **/
+    void appendEvictedTile(U64 tileHash, const void* data, std::size_t tileSizeBytes, int elementSizeBytes);
+
+    /**
+     * @brief Returns true if a tile with the given hash is either in the pool or waiting to be compressed.
+     **/
+    bool hasTile(U64 tileHash) const;
+
+    /**
+     * @brief If the tile exists, decompress it to data which must be tileSizeBytes large and remove
+     * it from the storage. Returns false if the tile does not exist or if it was not of the given size.
+     **/
+    bool retrieveTile(U64 tileHash, void* data, std::size_t tileSizeBytes);
+
+    /**
+     * @brief Removes all tiles
+     **/
+    void clear();
+
+    void quitThread();
+
+    bool isWorking() const;
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    boost::scoped_ptr<CompressedTileStoragePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_CompressedTileStorage_h
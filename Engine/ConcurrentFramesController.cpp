@@ -0,0 +1,214 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ConcurrentFramesController.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+
+// A change of the number of frames is kept only if it increases the throughput by more than this fraction
+#define NATRON_CONCURRENT_FRAMES_THROUGHPUT_TOLERANCE 0.05
+
+// The minimum number of frames of a measurement window. A window has at least as many frames as there are in flight.
+#define NATRON_CONCURRENT_FRAMES_MIN_WINDOW_FRAMES 3
+
+// Number of windows to stay on a number of frames after reverting a change, before probing again.
+// This doubles each time a probe is reverted, up to NATRON_CONCURRENT_FRAMES_MAX_STABLE_WINDOWS.
+#define NATRON_CONCURRENT_FRAMES_STABLE_WINDOWS 4
+#define NATRON_CONCURRENT_FRAMES_MAX_STABLE_WINDOWS 64
+
+// Under this fraction of free physical RAM, the number of frames in flight is decreased
+#define NATRON_CONCURRENT_FRAMES_MIN_FREE_RAM_FRACTION 0.1
+
+NATRON_NAMESPACE_ENTER
+
+ConcurrentFramesController::ConcurrentFramesController()
+    : _maxFrames(1)
+    , _nFrames(1)
+    , _nFramesToSettle(0)
+    , _windowStartTime(0)
+    , _nFramesInWindow(0)
+    , _previousThroughput(0)
+    , _previousNumFrames(0)
+    , _direction(1)
+    , _nStableWindowsLeft(0)
+    , _nStableWindows(NATRON_CONCURRENT_FRAMES_STABLE_WINDOWS)
+    , _lastChangeWasProbe(false)
+    , _rssAtStart(0)
+    , _totalRAM(0)
+{
+}
+
+void
+ConcurrentFramesController::reset(int maxFrames,
+                                  double now,
+                                  std::size_t rss,
+                                  std::size_t /*freeRAM*/,
+                                  U64 totalRAM)
+{
+    _maxFrames = std::max(1, maxFrames);
+
+    // Start in the middle of the range so that the first probe tells in which direction to go
+    _nFrames = std::max(1, (_maxFrames + 1) / 2);
+
+    // Do not measure while the first frames fill the pipeline
+    _nFramesToSettle = _nFrames;
+    _windowStartTime = now;
+    _nFramesInWindow = 0;
+    _previousThroughput = 0;
+    _previousNumFrames = 0;
+    _direction = 1;
+    _nStableWindowsLeft = 0;
+    _nStableWindows = NATRON_CONCURRENT_FRAMES_STABLE_WINDOWS;
+    _lastChangeWasProbe = false;
+    _rssAtStart = rss;
+    _totalRAM = totalRAM;
+}
+
+bool
+ConcurrentFramesController::setNumFrames(int nFrames,
+                                         ChangeReasonEnum reason,
+                                         double throughput,
+                                         double previousThroughput,
+                                         std::size_t freeRAM,
+                                         Decision* decision)
+{
+    assert(nFrames >= 1 && nFrames <= _maxFrames);
+    decision->previousNumFrames = _nFrames;
+    decision->numFrames = nFrames;
+    decision->reason = reason;
+    decision->throughput = throughput;
+    decision->previousThroughput = previousThroughput;
+    decision->freeRAM = freeRAM;
+
+    // The frames in flight were launched with the previous number of frames: ignore them in the next window
+    _nFramesToSettle = _nFrames;
+    _nFramesInWindow = 0;
+    _nFrames = nFrames;
+    _lastChangeWasProbe = reason == eChangeReasonProbe;
+
+    return true;
+}
+
+bool
+ConcurrentFramesController::onFrameRendered(double now,
+                                            std::size_t rss,
+                                            std::size_t freeRAM,
+                                            Decision* decision)
+{
+    if (_nFramesToSettle > 0) {
+        --_nFramesToSettle;
+        if (_nFramesToSettle == 0) {
+            _windowStartTime = now;
+            _nFramesInWindow = 0;
+        }
+
+        return false;
+    }
+    ++_nFramesInWindow;
+
+    const std::size_t minFreeRAM = (std::size_t)(_totalRAM * NATRON_CONCURRENT_FRAMES_MIN_FREE_RAM_FRACTION);
+    if ( (freeRAM > 0) && (freeRAM < minFreeRAM) ) {
+        if (_nFrames <= 1) {
+            return false;
+        }
+        // The throughput measured with more frames is no longer relevant
+        _previousThroughput = 0;
+        _previousNumFrames = 0;
+        _direction = -1;
+        _nStableWindows = NATRON_CONCURRENT_FRAMES_STABLE_WINDOWS;
+        _nStableWindowsLeft = _nStableWindows;
+
+        return setNumFrames(_nFrames - 1, eChangeReasonLowMemory, 0., 0., freeRAM, decision);
+    }
+
+    const double elapsed = now - _windowStartTime;
+    if ( ( _nFramesInWindow < std::max(NATRON_CONCURRENT_FRAMES_MIN_WINDOW_FRAMES, _nFrames) ) || (elapsed <= 0) ) {
+        return false;
+    }
+    const double throughput = _nFramesInWindow / elapsed;
+    _windowStartTime = now;
+    _nFramesInWindow = 0;
+
+    int nextNumFrames;
+    ChangeReasonEnum reason;
+    if (_nStableWindowsLeft > 0) {
+        --_nStableWindowsLeft;
+        if (_nStableWindowsLeft > 0) {
+            _previousThroughput = throughput;
+            _previousNumFrames = _nFrames;
+
+            return false;
+        }
+        nextNumFrames = _nFrames + _direction;
+        reason = eChangeReasonProbe;
+    } else if ( (_previousNumFrames == 0) || (_previousNumFrames == _nFrames) ) {
+        nextNumFrames = _nFrames + _direction;
+        reason = eChangeReasonProbe;
+    } else if ( throughput > _previousThroughput * (1. + NATRON_CONCURRENT_FRAMES_THROUGHPUT_TOLERANCE) ) {
+        nextNumFrames = _nFrames + _direction;
+        reason = eChangeReasonThroughputIncreased;
+        _nStableWindows = NATRON_CONCURRENT_FRAMES_STABLE_WINDOWS;
+    } else if ( (_nFrames < _previousNumFrames) && ( throughput >= _previousThroughput * (1. - NATRON_CONCURRENT_FRAMES_THROUGHPUT_TOLERANCE) ) ) {
+        // Fewer frames use less memory: keep a decrease that did not change the throughput and stay here for a while
+        // before trying even fewer frames
+        _previousThroughput = throughput;
+        _previousNumFrames = _nFrames;
+        _nStableWindowsLeft = _nStableWindows;
+
+        return false;
+    } else {
+        nextNumFrames = _previousNumFrames;
+        reason = eChangeReasonThroughputNotIncreased;
+        _direction = -_direction;
+        if (_lastChangeWasProbe) {
+            _nStableWindows = std::min(_nStableWindows * 2, NATRON_CONCURRENT_FRAMES_MAX_STABLE_WINDOWS);
+        }
+        _nStableWindowsLeft = _nStableWindows;
+    }
+
+    // Do not add a frame if the memory it would use does not fit in the free RAM
+    bool canAddFrame = nextNumFrames <= _maxFrames;
+    if ( canAddFrame && (nextNumFrames > _nFrames) && (rss > _rssAtStart) && (freeRAM > 0) ) {
+        const std::size_t memoryPerFrame = (rss - _rssAtStart) / _nFrames;
+        canAddFrame = freeRAM > minFreeRAM + memoryPerFrame;
+    }
+
+    const double previousThroughput = _previousThroughput;
+    _previousThroughput = throughput;
+    _previousNumFrames = _nFrames;
+
+    if ( (nextNumFrames < 1) || ( (nextNumFrames > _nFrames) && !canAddFrame ) ) {
+        // At a bound: stay here for a while and probe the other way next time
+        _direction = nextNumFrames < 1 ? 1 : -1;
+        _nStableWindowsLeft = _nStableWindows;
+
+        return false;
+    }
+
+    return setNumFrames(nextNumFrames, reason, throughput, previousThroughput, freeRAM, decision);
+} // onFrameRendered
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,143 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_ConcurrentFramesController_h
+#define Engine_ConcurrentFramesController_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef> // std::size_t
+
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Adjusts the number of frames a sequence render keeps in flight from the throughput and the memory
+ * measured during the render. Some trees scale across frames and render faster with many frames in flight,
+ * others already use all threads on the tiles of a single frame and only consume more memory with more frames.
+ *
+ * This is a hill climbing: the number of frames is changed by one after each measurement window and the change is
+ * kept while the throughput increases. A decrease that keeps the same throughput is kept too, since fewer frames use
+ * less memory. Otherwise the controller goes back to the previous value and stays there for a few windows before probing
+ * again, waiting longer each time a probe fails.
+ * When the free physical RAM falls under a fraction of the total RAM, the number of frames is decreased regardless
+ * of the throughput, and it is not increased if the memory used per frame would not fit.
+ *
+ * This class is not thread-safe: all functions are called on the scheduler thread. It takes the measures
+ * as parameters so that it does not depend on the system.
+ **/
+class ConcurrentFramesController
+{
+public:
+
+    enum ChangeReasonEnum
+    {
+        // The number of frames did not change
+        eChangeReasonNone = 0,
+
+        // The number of frames is changed to measure whether the throughput is better
+        eChangeReasonProbe,
+
+        // The throughput increased with the last change, the number of frames keeps going in the same direction
+        eChangeReasonThroughputIncreased,
+
+        // The throughput decreased or did not improve with the last change, which is reverted
+        eChangeReasonThroughputNotIncreased,
+
+        // There is not enough free RAM
+        eChangeReasonLowMemory
+    };
+
+    struct Decision
+    {
+        int previousNumFrames;
+        int numFrames;
+        ChangeReasonEnum reason;
+
+        // Frames per second of the last window and of the window before it
+        double throughput;
+        double previousThroughput;
+
+        std::size_t freeRAM;
+    };
+
+    ConcurrentFramesController();
+
+    /**
+     * @brief Starts a new render which may have up to maxFrames in flight.
+     * @param now The time in seconds, from any origin
+     * @param rss The resident set size of the process in bytes, 0 if unknown
+     * @param freeRAM The amount of free physical RAM in bytes, 0 if unknown
+     **/
+    void reset(int maxFrames, double now, std::size_t rss, std::size_t freeRAM, U64 totalRAM);
+
+    /**
+     * @brief Call each time a frame of the sequence is rendered. Returns true if the number of frames
+     * in flight changed, in which case the decision is returned in the given struct.
+     **/
+    bool onFrameRendered(double now, std::size_t rss, std::size_t freeRAM, Decision* decision);
+
+    int getNumConcurrentFrames() const
+    {
+        return _nFrames;
+    }
+
+private:
+
+    bool setNumFrames(int nFrames, ChangeReasonEnum reason, double throughput, double previousThroughput, std::size_t freeRAM, Decision* decision);
+
+    int _maxFrames;
+    int _nFrames;
+
+    // Frames to ignore after a change, which were launched with the previous number of frames
+    int _nFramesToSettle;
+
+    // The current measurement window
+    double _windowStartTime;
+    int _nFramesInWindow;
+
+    // The throughput measured in the previous window and the number of frames it was measured with
+    double _previousThroughput;
+    int _previousNumFrames;
+
+    // +1 or -1
+    int _direction;
+
+    // Windows left before probing again
+    int _nStableWindowsLeft;
+
+    // Number of windows to wait after the next revert
+    int _nStableWindows;
+
+    bool _lastChangeWasProbe;
+
+    std::size_t _rssAtStart;
+    U64 _totalRAM;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_ConcurrentFramesController_h
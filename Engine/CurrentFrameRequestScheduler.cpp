@@ -42,9 +42,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include <QMutex>
 
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/InteractiveLatency.h"
 #include "Engine/Node.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/RenderEngine.h"
+#include "Engine/Settings.h"
 #include "Engine/TimeLine.h"
 #include "Engine/TreeRender.h"
 #include "Engine/TreeRenderQueueManager.h"
@@ -144,6 +147,7 @@ ViewerCurrentFrameRequestScheduler::processFrame(const ProcessFrameArgsBase& inA
     {
         QMutexLocker k(&_imp->renderAgeMutex);
         if (args->age <= _imp->displayAge) {
+            InteractiveLatency::onRenderDropped(this, args->age);
             return;
         }
     }
@@ -152,9 +156,21 @@ ViewerCurrentFrameRequestScheduler::processFrame(const ProcessFrameArgsBase& inA
 
     bool didSomething = ViewerDisplayScheduler::processFramesResults(viewerNode, args->results);
     if (didSomething) {
+        InteractiveLatency::onFrameUploaded(this, args->age);
+
         // Update the display age
-        QMutexLocker k(&_imp->renderAgeMutex);
-        _imp->displayAge = args->age;
+        {
+            QMutexLocker k(&_imp->renderAgeMutex);
+            _imp->displayAge = args->age;
+        }
+
+        // The viewer is up to date, use the idle threads to render the frames ahead of the playhead
+        RenderEnginePtr engine = _imp->renderEngine.lock();
+        if ( engine && !hasThreadsAlive() ) {
+            engine->warmCacheFromCurrentFrame();
+        }
+    } else {
+        InteractiveLatency::onRenderDropped(this, args->age);
     }
 } // processFrame
 
@@ -249,6 +265,13 @@ ViewerCurrentFrameRequestSchedulerPrivate::getRenderAgeAndIncrement()
     return ret;
 }
 
+// A render of the current frame at a coarser level than the viewer, displayed until the finer passes are done
+struct CoarseRenderPass
+{
+    U64 renderAge;
+    unsigned int mipMapLevel;
+};
+
 class CurrentFrameRequestStartArgs : public GenericThreadStartArgs
 {
 public:
@@ -264,6 +287,9 @@ public:
 
     }
 
+    // Rendered before the full resolution render, from the coarsest to the finest. Their age is older than renderAge
+    // so that they are not displayed once a finer pass was displayed.
+    std::vector<CoarseRenderPass> coarsePasses;
 
     U64 renderAge;
     std::vector<ViewIdx> viewsToRender;
@@ -292,8 +318,30 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats)
     args->frame = TimeValue(viewerNode->getTimeline()->currentFrame());;
     args->enableRenderStats = enableRenderStats;
 
+    // While painting, use a single render thread and always the same thread.
+    args->curStroke = treeRoot->getApp()->getActiveRotoDrawingStroke();
+
+    // If the frame is expected to take long, first render coarser images so that the user gets some feedback early.
+    // Each pass is 2 mipmap levels coarser than the next one: it has 1/16th of its pixels, which keeps the cost of the coarse passes low.
+    if ( !args->curStroke && !enableRenderStats && !viewerNode->getApp()->isDraftRenderEnabled() && !viewerNode->isDoingPartialUpdates() &&
+         appPTR->getCurrentSettings()->isProgressiveViewerRenderEnabled() ) {
+        unsigned int viewerLevel = ViewerDisplayScheduler::getViewerMipMapLevel(viewerNode, false /*draftModeEnabled*/, viewerNode->isFullFrameProcessingEnabled());
+        bool isSlow = viewerNode->getAdaptiveDraftMipMapLevel(NATRON_VIEWER_PROGRESSIVE_RENDER_MIN_MS / 1000., viewerLevel, viewerLevel + 1) > viewerLevel;
+        if (isSlow) {
+            unsigned int coarseLevel = viewerNode->getAdaptiveDraftMipMapLevel(NATRON_VIEWER_PROGRESSIVE_RENDER_COARSE_PASS_MS / 1000., viewerLevel, viewerLevel + NATRON_VIEWER_PROGRESSIVE_RENDER_MAX_LEVELS);
+            for (int level = (int)coarseLevel; level > (int)viewerLevel; level -= 2) {
+                CoarseRenderPass pass;
+                pass.mipMapLevel = (unsigned int)level;
+                pass.renderAge = _imp->getRenderAgeAndIncrement();
+                InteractiveLatency::onRenderRequested(this, pass.renderAge);
+                args->coarsePasses.push_back(pass);
+            }
+        }
+    }
+
     // Identify this render request with an age
     args->renderAge = _imp->getRenderAgeAndIncrement();
+    InteractiveLatency::onRenderRequested(this, args->renderAge);
 
     ViewIdx view;
     {
@@ -305,9 +353,6 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats)
     //  For now the viewer always asks to render 1 view since the interface can only allow 1 view at once per view
     args->viewsToRender.push_back(view);
 
-    // While painting, use a single render thread and always the same thread.
-    args->curStroke = treeRoot->getApp()->getActiveRotoDrawingStroke();
-
 
     // We are about to trigger a new render, cancel all other renders except the oldest so user gets some feedback.
     if (!args->curStroke) {
@@ -392,9 +437,22 @@ ViewerCurrentFrameRequestScheduler::onTreeRenderFinished(const TreeRenderPtr& re
 
     ActionRetCodeEnum stat = results->waitForRendersFinished();
 
+    if (!isFailureRetCode(stat)) {
+        // The older renders, such as the coarse passes of a progressive render, would not be displayed anymore
+        RendersMap olderRenders;
+        {
+            QMutexLocker k(&_imp->currentRendersMutex);
+            olderRenders.insert( _imp->currentRenders.begin(), _imp->currentRenders.lower_bound(renderAge) );
+        }
+        for (RendersMap::iterator it = olderRenders.begin(); it != olderRenders.end(); ++it) {
+            it->second.results->abortRenders();
+        }
+    }
+
 
     // Call updateViewer() on the main thread
     if (isFailureRetCode(stat)) {
+        InteractiveLatency::onRenderDropped(this, renderAge);
         if (stat != eActionStatusAborted) {
             // Clear viewer to black if not aborted
             ViewerNodePtr viewerNode =  _imp->viewer.lock()->isEffectViewerNode();
@@ -402,6 +460,7 @@ ViewerCurrentFrameRequestScheduler::onTreeRenderFinished(const TreeRenderPtr& re
         }
 
     } else {
+        InteractiveLatency::onRenderStageReached(this, renderAge, eInteractiveLatencyStageRenderFinished);
 
         boost::shared_ptr<ViewerCurrentFrameRenderProcessFrameArgs> processArgs = boost::make_shared<ViewerCurrentFrameRenderProcessFrameArgs>();
         processArgs->age = renderAge;
@@ -422,24 +481,37 @@ ViewerCurrentFrameRequestScheduler::threadLoopOnce(const GenericThreadStartArgsP
 
     ViewerNodePtr viewerNode =  _imp->viewer.lock()->isEffectViewerNode();
 
-    RenderFrameResultsContainerPtr results;
-    ActionRetCodeEnum stat = ViewerDisplayScheduler::createFrameRenderResultsGeneric(viewerNode, shared_from_this(), args->frame, false /*isPlayback*/, args->curStroke, args->viewsToRender, args->enableRenderStats, &results);
-
-    if (isFailureRetCode(stat)) {
-        return eThreadStateActive;
-    }
-
-    // Register the render
+    // Launch the coarse passes first, then the render at the level of the viewer
+    std::vector<CoarseRenderPass> passes = args->coarsePasses;
     {
-        QMutexLocker k(&_imp->currentRendersMutex);
-        RenderAndAge r;
-        r.finishedRenders[0] = r.finishedRenders[1] = false;
-        r.results = results;
-        _imp->currentRenders.insert(std::make_pair(args->renderAge,r));
+        CoarseRenderPass pass;
+        pass.renderAge = args->renderAge;
+        pass.mipMapLevel = 0;
+        passes.push_back(pass);
     }
 
-    // Launch the render
-    results->launchRenders();
+    for (std::size_t i = 0; i < passes.size(); ++i) {
+        RenderFrameResultsContainerPtr results;
+        ActionRetCodeEnum stat = ViewerDisplayScheduler::createFrameRenderResultsGeneric(viewerNode, shared_from_this(), args->frame, false /*isPlayback*/, args->curStroke, args->viewsToRender, args->enableRenderStats, passes[i].mipMapLevel, &results);
+
+        if (isFailureRetCode(stat)) {
+            InteractiveLatency::onRenderDropped(this, passes[i].renderAge);
+            continue;
+        }
+
+        // Register the render
+        {
+            QMutexLocker k(&_imp->currentRendersMutex);
+            RenderAndAge r;
+            r.finishedRenders[0] = r.finishedRenders[1] = false;
+            r.results = results;
+            _imp->currentRenders.insert(std::make_pair(passes[i].renderAge,r));
+        }
+
+        // Launch the render
+        InteractiveLatency::onRenderStageReached(this, passes[i].renderAge, eInteractiveLatencyStageRenderStarted);
+        results->launchRenders();
+    }
 
     GenericSchedulerThread::ThreadStateEnum state = resolveState();
     return state;
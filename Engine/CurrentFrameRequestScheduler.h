@@ -35,6 +35,14 @@
 #include "Engine/ProcessFrameThread.h"
 #include "Engine/TreeRenderQueueProvider.h"
 
+// When progressive rendering is enabled, the current frame is rendered progressively if the viewer expects it to take longer than this.
+// The first pass is then rendered at the finest level expected to take less than NATRON_VIEWER_PROGRESSIVE_RENDER_COARSE_PASS_MS
+#define NATRON_VIEWER_PROGRESSIVE_RENDER_MIN_MS 250
+#define NATRON_VIEWER_PROGRESSIVE_RENDER_COARSE_PASS_MS 50
+
+// The first pass is at most this many mipmap levels coarser than the viewer
+#define NATRON_VIEWER_PROGRESSIVE_RENDER_MAX_LEVELS 5
+
 NATRON_NAMESPACE_ENTER
 
 class CurrentFrameFunctorArgs;
@@ -256,6 +256,7 @@ Curve::setInterpolator(const KeyFrameInterpolatorPtr& interpolator)
     }
     QMutexLocker l(&_imp->_lock);
     _imp->interpolator = interpolator;
+    onCurveChanged();
 }
 
 void
@@ -264,6 +265,7 @@ Curve::setPeriodic(bool periodic)
     QMutexLocker k(&_imp->_lock);
     _imp->isPeriodic = periodic;
     _imp->keyFrames.clear();
+    onCurveChanged();
 }
 
 bool
@@ -284,6 +286,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    onCurveChanged();
 }
 
 bool
@@ -475,6 +478,9 @@ Curve::cloneAndCheckIfChanged(const Curve& other, double offset, const RangeD* r
                 ++oit;
             }
         }
+        if (hasChanged) {
+            onCurveChanged();
+        }
     }
     if (!listeners.empty()) {
         notifyKeyFramesChanged(listeners, *oldKeys, otherKeys);
@@ -623,6 +629,46 @@ Curve::setOrAddKeyframe(const KeyFrame& key, SetKeyFrameFlags flags, int *keyfra
     
 }
 
+bool
+Curve::setOrAddKeyframes(const std::list<KeyFrame>& keys, SetKeyFrameFlags flags)
+{
+    std::list<CurveChangesListenerPtr> listeners;
+    std::list<std::pair<KeyFrame, bool> > keysSet;
+    {
+        QMutexLocker l(&_imp->_lock);
+        listeners = getListeners();
+        const bool constantOnly = isInterpolationConstantOnly();
+
+        for (std::list<KeyFrame>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+            double val = it->getValue();
+            if ( (boost::math::isnan)(val) || (boost::math::isinf)(val) ) {
+                continue;
+            }
+            std::pair<KeyFrameSet::iterator, ValueChangedReturnCodeEnum> ret;
+            if (constantOnly) {
+                KeyFrame copy = *it;
+                copy.setInterpolation(eKeyframeTypeConstant);
+                ret = setOrUpdateKeyframeInternal(copy, flags);
+            } else {
+                ret = setOrUpdateKeyframeInternal(*it, flags);
+            }
+            assert(ret.first != _imp->keyFrames.end());
+
+            ret.first = evaluateCurveChanged(eCurveChangedReasonKeyframeChanged, ret.first);
+
+            if (ret.second == eValueChangedReturnCodeKeyframeAdded || ret.second == eValueChangedReturnCodeKeyframeModified) {
+                keysSet.push_back( std::make_pair(*it, ret.second == eValueChangedReturnCodeKeyframeAdded) );
+            }
+        }
+    }
+    if ( !listeners.empty() ) {
+        for (std::list<std::pair<KeyFrame, bool> >::const_iterator it = keysSet.begin(); it != keysSet.end(); ++it) {
+            notifyKeyFramesSet(listeners, it->first, it->second);
+        }
+    }
+    return !keysSet.empty();
+} // setOrAddKeyframes
+
 bool applyKeyFrameConflictsFlags(KeyFrame& tmp, const KeyFrame & cp, SetKeyFrameFlags flags)
 {
     bool changed = false;
@@ -671,7 +717,9 @@ std::pair<KeyFrameSet::iterator, ValueChangedReturnCodeEnum> Curve::setOrUpdateK
         double paramEps = NATRON_CURVE_X_SPACING_EPSILON;
         ValueChangedReturnCodeEnum retCode = eValueChangedReturnCodeKeyframeAdded;
         KeyFrame tmp = cp;
-        for (KeyFrameSet::iterator it = _imp->keyFrames.begin(); it != _imp->keyFrames.end(); ++it) {
+        // Only the keyframes within paramEps of the time may conflict
+        KeyFrameSet::iterator first = _imp->keyFrames.lower_bound( KeyFrame(cp.getTime() - paramEps, 0.) );
+        for (KeyFrameSet::iterator it = first; it != _imp->keyFrames.end() && it->getTime() < cp.getTime() + paramEps; ++it) {
             if (std::abs( it->getTime() - cp.getTime() ) < paramEps) {
 
                 tmp = *it;
@@ -758,11 +806,16 @@ Curve::removeKeyFrame(KeyFrameSet::const_iterator it)
     KeyFrame removedKey = *it;
     _imp->keyFrames.erase(it);
 
-    if (mustRefreshPrev) {
-        refreshDerivatives( eCurveChangedReasonDerivativesChanged, find( prevKey.getTime(), _imp->keyFrames.end()) );
-    }
-    if (mustRefreshNext) {
-        refreshDerivatives( eCurveChangedReasonDerivativesChanged, find( nextKey.getTime(), _imp->keyFrames.end() ) );
+    if (_imp->bulkEditsCount > 0) {
+        _imp->derivativesDirty = true;
+    } else {
+        // The keyframes are ordered by time: look them up in logarithmic time
+        if (mustRefreshPrev) {
+            refreshDerivatives( eCurveChangedReasonDerivativesChanged, _imp->keyFrames.find(prevKey) );
+        }
+        if (mustRefreshNext) {
+            refreshDerivatives( eCurveChangedReasonDerivativesChanged, _imp->keyFrames.find(nextKey) );
+        }
     }
 
     for (std::list<CurveChangesListenerWPtr>::const_iterator it = _imp->listeners.begin(); it != _imp->listeners.end(); ++it) {
@@ -1031,6 +1084,67 @@ Curve::getKeyFrameWithTime(TimeValue time,
 
 
 
+void
+CurvePrivate::ensureSegmentsUpToDate()
+{
+    if (segmentsValid && segmentsRevision == revision) {
+        return;
+    }
+    assert( !keyFrames.empty() );
+
+    const std::size_t n = keyFrames.size();
+    segmentKeyTimes.clear();
+    segmentKeyTimes.reserve(n);
+    segments.resize(n + 1);
+    segmentKeys.clear();
+    segmentKeys.reserve(n + 1);
+    for (KeyFrameSet::const_iterator it = keyFrames.begin(); it != keyFrames.end(); ++it) {
+        segmentKeyTimes.push_back( it->getTime() );
+    }
+
+    // Compute each segment exactly as KeyFrameInterpolator::interpolate would for a time in the segment
+    KeyFrameSet::const_iterator itup = keyFrames.begin();
+    for (std::size_t i = 0; i <= n; ++i, ++itup) {
+        TimeValue t;
+        if (i == 0) {
+            t = TimeValue(segmentKeyTimes[0] - 1.);
+        } else {
+            t = TimeValue(segmentKeyTimes[i - 1]);
+        }
+        KeyFrame kCur, kNext;
+        KeyFrameInterpolator::interParams(keyFrames, false, xMin, xMax, &t, itup, &kCur, &kNext);
+        Interpolation::computeCubicSegment(kCur.getTime(), kCur.getValue(),
+                                           kCur.getRightDerivative(),
+                                           kNext.getLeftDerivative(),
+                                           kNext.getTime(), kNext.getValue(),
+                                           kCur.getInterpolation(),
+                                           kNext.getInterpolation(),
+                                           &segments[i]);
+        segmentKeys.push_back(kCur);
+    }
+
+    segmentsRevision = revision;
+    segmentsValid = true;
+    lastSegmentIndex = 0;
+} // ensureSegmentsUpToDate
+
+std::size_t
+CurvePrivate::findSegment(double t)
+{
+    const std::size_t n = segmentKeyTimes.size();
+
+    // Try the segment of the last evaluation and the following one first
+    for (std::size_t i = lastSegmentIndex; i <= n && i <= lastSegmentIndex + 1; ++i) {
+        if ( (i == 0 || segmentKeyTimes[i - 1] <= t) && (i == n || t < segmentKeyTimes[i]) ) {
+            lastSegmentIndex = i;
+            return i;
+        }
+    }
+
+    lastSegmentIndex = std::upper_bound(segmentKeyTimes.begin(), segmentKeyTimes.end(), t) - segmentKeyTimes.begin();
+    return lastSegmentIndex;
+} // findSegment
+
 KeyFrame
 Curve::getValueAt(TimeValue t,
                   bool doClamp) const
@@ -1058,37 +1172,89 @@ Curve::getValueAt(TimeValue t,
     //    return (*_imp->keyFrames.begin()).getValue();
     //}
 
-    // find the first keyframe with time greater than t
-    KeyFrameSet::const_iterator itup = _imp->keyFrames.upper_bound(value);
-    value = _imp->interpolator->interpolate(t, itup, _imp->keyFrames, _imp->isPeriodic, TimeValue(_imp->xMin), TimeValue(_imp->xMax));
+    if ( _imp->canUseSegments() ) {
+        _imp->ensureSegmentsUpToDate();
+        std::size_t i = _imp->findSegment(t);
+        // Properties don't follow an interpolation unlike the value of the keyframe, see KeyFrameInterpolator::interpolate
+        value = _imp->segmentKeys[i];
+        value.setTime(t);
+        value.setValue( Interpolation::evaluateCubicSegment(_imp->segments[i], t) );
+    } else {
+        // find the first keyframe with time greater than t
+        KeyFrameSet::const_iterator itup = _imp->keyFrames.upper_bound(value);
+        value = _imp->interpolator->interpolate(t, itup, _imp->keyFrames, _imp->isPeriodic, TimeValue(_imp->xMin), TimeValue(_imp->xMax));
+    }
 
     double v = value.getValue();
+    if ( clampAndRoundInterpolatedValue(doClamp, &v) ) {
+        value.setValue(v);
+    }
+    return value;
+} // getValueAt
 
-
-    bool mustUpdateKeyFrame = false;
-    if ( doClamp ) {
-        v = clampValueToCurveYRange(v);
-        mustUpdateKeyFrame = true;
+bool
+Curve::clampAndRoundInterpolatedValue(bool clamp,
+                                      double* v) const
+{
+    // PRIVATE - should not lock
+    bool modified = false;
+    if (clamp) {
+        *v = clampValueToCurveYRange(*v);
+        modified = true;
     }
 
     switch (_imp->type) {
         case eCurveTypeString:
         case eCurveTypeInt:
-            v = std::floor(v + 0.5);
-            mustUpdateKeyFrame = true;
+            *v = std::floor(*v + 0.5);
+            modified = true;
             break;
         case eCurveTypeBool:
-            v = v >= 0.5 ? 1. : 0.;
-            mustUpdateKeyFrame = true;
+            *v = *v >= 0.5 ? 1. : 0.;
+            modified = true;
             break;
         default:
             break;
     }
-    if (mustUpdateKeyFrame) {
-        value.setValue(v);
+    return modified;
+} // clampAndRoundInterpolatedValue
+
+void
+Curve::getValuesAt(const TimeValue* times,
+                   double* values,
+                   int n,
+                   bool clamp) const
+{
+    if (n <= 0) {
+        return;
     }
-    return value;
-} // getValueAt
+    assert(times && values);
+
+    QMutexLocker l(&_imp->_lock);
+
+    if ( _imp->keyFrames.empty() ) {
+        // A curve with no control points is considered to be 0, see getValueAt
+        std::fill(values, values + n, 0.);
+        return;
+    }
+
+    if ( _imp->canUseSegments() ) {
+        _imp->ensureSegmentsUpToDate();
+        for (int i = 0; i < n; ++i) {
+            std::size_t s = _imp->findSegment(times[i]);
+            values[i] = Interpolation::evaluateCubicSegment(_imp->segments[s], times[i]);
+        }
+    } else {
+        for (int i = 0; i < n; ++i) {
+            KeyFrameSet::const_iterator itup = _imp->keyFrames.upper_bound( KeyFrame(times[i], 0.) );
+            values[i] = _imp->interpolator->interpolate(times[i], itup, _imp->keyFrames, _imp->isPeriodic, TimeValue(_imp->xMin), TimeValue(_imp->xMax)).getValue();
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        (void)clampAndRoundInterpolatedValue(clamp, &values[i]);
+    }
+} // getValuesAt
 
 double
 Curve::getDerivativeAt(TimeValue t) const
@@ -1294,6 +1460,7 @@ Curve::setXRange(double a,
 
     _imp->xMin = a;
     _imp->xMax = b;
+    onCurveChanged();
 }
 
 std::pair<double, double> Curve::getXRange() const
@@ -1894,6 +2061,52 @@ Curve::refreshDerivatives(Curve::CurveChangedReasonEnum reason,
     return key;
 } // refreshDerivatives
 
+void
+Curve::refreshAllDerivatives()
+{
+    // PRIVATE - should not lock
+    for (KeyFrameSet::iterator it = _imp->keyFrames.begin(); it != _imp->keyFrames.end(); ++it) {
+        if ( (it->getInterpolation() != eKeyframeTypeBroken) &&
+             ( it->getInterpolation() != eKeyframeTypeFree) &&
+             ( it->getInterpolation() != eKeyframeTypeNone) ) {
+            it = refreshDerivatives(eCurveChangedReasonDerivativesChanged, it);
+        }
+    }
+
+    // The first keyframe may depend on the derivative of the next one, which was refreshed after it
+    if (_imp->keyFrames.size() > 1) {
+        KeyFrameSet::iterator first = _imp->keyFrames.begin();
+        if ( (first->getInterpolation() != eKeyframeTypeBroken) &&
+             ( first->getInterpolation() != eKeyframeTypeFree) &&
+             ( first->getInterpolation() != eKeyframeTypeNone) ) {
+            (void)refreshDerivatives(eCurveChangedReasonDerivativesChanged, first);
+        }
+    }
+    onCurveChanged();
+} // refreshAllDerivatives
+
+void
+Curve::beginBulkEdit()
+{
+    QMutexLocker l(&_imp->_lock);
+    ++_imp->bulkEditsCount;
+}
+
+void
+Curve::endBulkEdit()
+{
+    QMutexLocker l(&_imp->_lock);
+    assert(_imp->bulkEditsCount > 0);
+    if (_imp->bulkEditsCount <= 0) {
+        return;
+    }
+    --_imp->bulkEditsCount;
+    if (_imp->bulkEditsCount == 0 && _imp->derivativesDirty) {
+        _imp->derivativesDirty = false;
+        refreshAllDerivatives();
+    }
+}
+
 KeyFrameSet::iterator
 Curve::evaluateCurveChanged(CurveChangedReasonEnum reason,
                             KeyFrameSet::iterator key)
@@ -1901,6 +2114,13 @@ Curve::evaluateCurveChanged(CurveChangedReasonEnum reason,
     // PRIVATE - should not lock
     assert( key != _imp->keyFrames.end() );
 
+    // The derivatives are refreshed at once at the end of the bulk edit
+    if (_imp->bulkEditsCount > 0) {
+        _imp->derivativesDirty = true;
+        onCurveChanged();
+        return key;
+    }
+
     if ( (key->getInterpolation() != eKeyframeTypeBroken) && (key->getInterpolation() != eKeyframeTypeFree)
          && ( reason != eCurveChangedReasonDerivativesChanged) ) {
         key = refreshDerivatives(eCurveChangedReasonDerivativesChanged, key);
@@ -2061,7 +2281,15 @@ Curve::setYRange(double yMin,
 void
 Curve::onCurveChanged()
 {
+    QMutexLocker l(&_imp->_lock);
+    ++_imp->revision;
+}
 
+U64
+Curve::getRevision() const
+{
+    QMutexLocker l(&_imp->_lock);
+    return _imp->revision;
 }
 
 void
@@ -2324,12 +2552,13 @@ Curve::setKeyframesInternal(const KeyFrameSet& keys, bool refreshDerivatives)
     } else {
         _imp->keyFrames.clear();
 
-        // Now recompute auto tangents
         for (KeyFrameSet::iterator it = keys.begin(); it != keys.end(); ++it) {
-            std::pair<KeyFrameSet::iterator, ValueChangedReturnCodeEnum> ret = setOrUpdateKeyframeInternal(*it);
-            ret.first = evaluateCurveChanged(Curve::eCurveChangedReasonKeyframeChanged, ret.first);
+            (void)setOrUpdateKeyframeInternal(*it);
         }
 
+        // Now recompute auto tangents, in a single pass
+        refreshAllDerivatives();
+
 
     }
 
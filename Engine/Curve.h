@@ -286,6 +286,13 @@ public:
 
     bool isAnimated() const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Returns a number incremented each time the keyframes, the interpolation or the range of the curve change.
+     * Unlike the listeners, which are only notified of keyframes added, removed or moved, this also accounts for
+     * changes of derivatives and interpolation, so it can be used to invalidate anything computed from the curve values.
+     **/
+    U64 getRevision() const WARN_UNUSED_RETURN;
+
     /**
      * @brief Returns true if the Curve represents a string animation, in which case the user cannot
      * modify the Y component of the curve.
@@ -325,6 +332,13 @@ public:
      **/
     ValueChangedReturnCodeEnum setOrAddKeyframe(const KeyFrame& key, SetKeyFrameFlags flags = eSetKeyFrameFlagSetValue, int* keyframeIndex = NULL);
 
+    /**
+     * @brief Same as setOrAddKeyframe for multiple keyframes at once: the curve is locked once and the listeners
+     * are notified once all keyframes are set. Keyframes whose value is NaN or infinite are ignored.
+     * @returns True if any keyframe was added or modified.
+     **/
+    bool setOrAddKeyframes(const std::list<KeyFrame>& keys, SetKeyFrameFlags flags = eSetKeyFrameFlagSetValue);
+
     void removeKeyFrameWithTime(TimeValue time);
 
     void removeKeyFrameWithIndex(int index);
@@ -369,6 +383,13 @@ public:
      **/
     KeyFrame getValueAt(TimeValue t, bool clamp = true) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Evaluates the curve at the n given times: values[i] is getValueAt(times[i], clamp).getValue().
+     * The curve is locked once and consecutive times in the same segment reuse it, so this is much faster
+     * than n calls to getValueAt, especially if the times are sorted.
+     **/
+    void getValuesAt(const TimeValue* times, double* values, int n, bool clamp = true) const;
+
     double getDerivativeAt(TimeValue t) const WARN_UNUSED_RETURN;
 
     double getIntegrateFromTo(TimeValue t1, TimeValue t2) const WARN_UNUSED_RETURN;
@@ -662,6 +683,15 @@ public:
 
     void setKeyframes(const KeyFrameSet& keys, bool refreshDerivatives);
 
+    /**
+     * @brief Between beginBulkEdit() and endBulkEdit(), the automatic derivatives of the keyframes are not refreshed each time
+     * a keyframe is added, modified or removed: they are all refreshed at once by endBulkEdit() in a single pass over the curve.
+     * Use this when setting many keyframes one by one, e.g. to write back tracking results.
+     * The calls may be nested. The values returned by getValueAt() in between use the derivatives as they were.
+     **/
+    void beginBulkEdit();
+    void endBulkEdit();
+
 private:
 
     friend class ::boost::serialization::access;
@@ -679,6 +709,12 @@ private:
 
     double clampValueToCurveYRange(double v) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Clamps the interpolated value v to the Y range if clamp is true and rounds it for integer curves.
+     * @returns True if v was modified.
+     **/
+    bool clampAndRoundInterpolatedValue(bool clamp, double* v) const;
+
     void setKeyframesInternal(const KeyFrameSet& keys, bool refreshDerivatives);
 
     ///returns an iterator to the new keyframe in the keyframe set and
@@ -694,6 +730,11 @@ private:
      **/
     KeyFrameSet::iterator evaluateCurveChanged(CurveChangedReasonEnum reason, KeyFrameSet::iterator key) WARN_UNUSED_RETURN;
     KeyFrameSet::iterator refreshDerivatives(CurveChangedReasonEnum reason, KeyFrameSet::iterator key);
+
+    /**
+     * @brief Refreshes the automatic derivatives of all keyframes in time order
+     **/
+    void refreshAllDerivatives();
     KeyFrameSet::iterator setKeyFrameValueAndTimeNoUpdate(double value, TimeValue time, KeyFrameSet::iterator k) WARN_UNUSED_RETURN;
 
 
@@ -32,6 +32,8 @@
 #include <boost/shared_ptr.hpp>
 #endif
 
+#include <vector>
+
 #include <QtCore/QMutex>
 
 #include "Engine/Variant.h"
@@ -40,6 +42,7 @@
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KeyFrameInterpolator.h"
+#include "Engine/Interpolation.h"
 
 
 #include "Engine/EngineFwd.h"
@@ -65,6 +68,28 @@ struct CurvePrivate
     bool isPeriodic;
     bool clampKeyFramesTimeToIntegers;
 
+    // Incremented each time the curve changes, see Curve::getRevision()
+    U64 revision;
+
+    // A flat copy of the keyframes with the polynomial of each segment, so that getValueAt does not walk the set
+    // nor compute the polynomial again. With n keyframes there are n + 1 segments: segment i lies before keyframe i,
+    // segment 0 extrapolates before the first keyframe and segment n after the last one.
+    // This is rebuilt when needed by getValueAt if the revision changed.
+    std::vector<double> segmentKeyTimes; // n times
+    std::vector<Interpolation::CubicSegment> segments; // n + 1 segments
+    std::vector<KeyFrame> segmentKeys; // n + 1 keyframes holding the properties returned for each segment
+    U64 segmentsRevision;
+    bool segmentsValid;
+
+    // The segment of the last evaluation: renders and the curve editor evaluate curves sequentially
+    std::size_t lastSegmentIndex;
+
+    // While strictly positive, the automatic derivatives are not refreshed when a keyframe changes, see Curve::beginBulkEdit()
+    int bulkEditsCount;
+
+    // True if a keyframe changed during a bulk edit
+    bool derivativesDirty;
+
     CurvePrivate()
     : keyFrames()
     , interpolator(new KeyFrameInterpolator)
@@ -79,11 +104,26 @@ struct CurvePrivate
     , _lock(QMutex::Recursive)
     , isPeriodic(false)
     , clampKeyFramesTimeToIntegers(true)
+    , revision(0)
+    , segmentKeyTimes()
+    , segments()
+    , segmentKeys()
+    , segmentsRevision(0)
+    , segmentsValid(false)
+    , lastSegmentIndex(0)
+    , bulkEditsCount(0)
+    , derivativesDirty(false)
     {
     }
 
     CurvePrivate(const CurvePrivate & other)
         : _lock(QMutex::Recursive)
+        , revision(0)
+        , segmentsRevision(0)
+        , segmentsValid(false)
+        , lastSegmentIndex(0)
+        , bulkEditsCount(0)
+        , derivativesDirty(false)
     {
         *this = other;
     }
@@ -102,10 +142,26 @@ struct CurvePrivate
         displayMax = other.displayMax;
         isPeriodic = other.isPeriodic;
         clampKeyFramesTimeToIntegers = other.clampKeyFramesTimeToIntegers;
+        ++revision;
+    }
+
+    /**
+     * @brief Returns true if getValueAt may use the precomputed segments
+     **/
+    bool canUseSegments() const
+    {
+        return !isPeriodic && interpolator->isCubicInterpolation();
     }
 
+    /**
+     * @brief Rebuilds the segments if the curve changed since they were computed. The lock must be held.
+     **/
+    void ensureSegmentsUpToDate();
 
-    
+    /**
+     * @brief Returns the index of the segment containing t, that is the number of keyframes with a time <= t
+     **/
+    std::size_t findSegment(double t);
 };
 
 NATRON_NAMESPACE_EXIT
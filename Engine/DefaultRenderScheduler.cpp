@@ -25,22 +25,200 @@
 
 #include "DefaultRenderScheduler.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <QTextStream>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
 
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
+#include "Engine/DistributedRender.h"
 #include "Engine/EffectInstance.h"
+#include "Engine/KnobFile.h"
+#include "Engine/MetricsExporter.h"
 #include "Engine/Node.h"
+#include "Engine/RenderCheckpointJournal.h"
 #include "Engine/RenderEngine.h"
 #include "Engine/Timer.h"
 #include "Engine/TreeRender.h"
+#include "Engine/TreeRenderBatch.h"
 #include "Engine/WriteNode.h"
 
 
+// How many frames may be encoded concurrently by a writer that does not require sequential renders
+#define NATRON_WRITE_ENCODE_MAX_THREADS 2
+
+// How many frames may wait to be encoded: when reached, the scheduler stops launching renders until a frame is encoded
+#define NATRON_WRITE_ENCODE_MAX_PENDING_FRAMES 4
+
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief The encode of a single frame by the writer, once its input was computed
+ **/
+class WriteEncodeJob
+{
+public:
+
+    WriteEncodeJob(const TreeRenderPtr& render)
+    : render(render)
+    , lock()
+    , cond()
+    , finished(false)
+    , status(eActionStatusOK)
+    {
+
+    }
+
+    ActionRetCodeEnum waitForFinished()
+    {
+        QMutexLocker k(&lock);
+        while (!finished) {
+            cond.wait(&lock);
+        }
+        return status;
+    }
+
+    void setFinished(ActionRetCodeEnum stat)
+    {
+        QMutexLocker k(&lock);
+        status = stat;
+        finished = true;
+        cond.wakeAll();
+    }
+
+    TreeRenderPtr render;
+
+    // Protects finished and status
+    QMutex lock;
+    QWaitCondition cond;
+    bool finished;
+    ActionRetCodeEnum status;
+};
+
+typedef boost::shared_ptr<WriteEncodeJob> WriteEncodeJobPtr;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+/**
+ * @brief Encodes the frames of a sequence render with its own threads so that the scheduler can compute
+ * the next frames while the previous ones are written. The number of frames waiting to be encoded is bounded:
+ * when full, push() blocks the scheduler until a frame is encoded.
+ **/
+class WriteEncodeQueue
+{
+public:
+
+    WriteEncodeQueue()
+    : _pool()
+    , _pendingMutex()
+    , _pendingCond()
+    , _nPending(0)
+    {
+        _pool.setMaxThreadCount(NATRON_WRITE_ENCODE_MAX_THREADS);
+    }
+
+    ~WriteEncodeQueue()
+    {
+        _pool.waitForDone();
+    }
+
+    void push(const OutputSchedulerThreadPtr& scheduler, const WriteEncodeJobPtr& job);
+
+    /**
+     * @brief Waits until all frames pushed are encoded
+     **/
+    void waitForDone()
+    {
+        _pool.waitForDone();
+    }
+
+    void onJobFinished()
+    {
+        QMutexLocker k(&_pendingMutex);
+        assert(_nPending > 0);
+        --_nPending;
+        _pendingCond.wakeAll();
+    }
+
+private:
+
+    QThreadPool _pool;
+
+    // Protects _nPending
+    QMutex _pendingMutex;
+    QWaitCondition _pendingCond;
+    int _nPending;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class WriteEncodeRunnable
+    : public QRunnable
+{
+public:
+
+    WriteEncodeRunnable(WriteEncodeQueue* queue,
+                        const OutputSchedulerThreadPtr& scheduler,
+                        const WriteEncodeJobPtr& job)
+    : QRunnable()
+    , _queue(queue)
+    , _scheduler(scheduler)
+    , _job(job)
+    {
+        setAutoDelete(true);
+    }
+
+    virtual ~WriteEncodeRunnable()
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        ActionRetCodeEnum stat;
+        if ( _scheduler->isBeingAborted() || (_scheduler->getThreadState() == GenericSchedulerThread::eThreadStateAborted) ) {
+            // Do not start writing frames that will be discarded
+            stat = eActionStatusAborted;
+        } else {
+            _scheduler->launchRender(_job->render);
+            stat = _scheduler->waitForRenderFinished(_job->render);
+        }
+        _job->render.reset();
+        _job->setFinished(stat);
+        _queue->onJobFinished();
+    }
+
+private:
+
+    // The queue waits for its pool before being destroyed
+    WriteEncodeQueue* _queue;
+    OutputSchedulerThreadPtr _scheduler;
+    WriteEncodeJobPtr _job;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+WriteEncodeQueue::push(const OutputSchedulerThreadPtr& scheduler, const WriteEncodeJobPtr& job)
+{
+    {
+        QMutexLocker k(&_pendingMutex);
+        while (_nPending >= NATRON_WRITE_ENCODE_MAX_PENDING_FRAMES) {
+            _pendingCond.wait(&_pendingMutex);
+        }
+        ++_nPending;
+    }
+    _pool.start( new WriteEncodeRunnable(this, scheduler, job) );
+} // push
+
+typedef boost::shared_ptr<WriteEncodeQueue> WriteEncodeQueuePtr;
+
 class DefaultRenderFrameSubResult : public RenderFrameSubResult
 {
 public:
@@ -61,6 +239,16 @@ public:
         // We no longer need the render object since the processFrame() function does nothing.
         render.reset();
 
+        if (encodeRender) {
+            // The input of the writer is in the cache: hand the encode to the queue and let the scheduler render
+            // the next frames. This blocks if too many frames are already waiting to be encoded.
+            if ( !isFailureRetCode(stat) ) {
+                encodeJob = boost::make_shared<WriteEncodeJob>(encodeRender);
+                encodeQueue->push(boost::dynamic_pointer_cast<OutputSchedulerThread>(provider), encodeJob);
+            }
+            encodeRender.reset();
+        }
+
         return stat;
     }
 
@@ -74,10 +262,31 @@ public:
         if (render) {
             render->setRenderAborted();
         }
+        if (encodeRender) {
+            encodeRender->setRenderAborted();
+        }
     }
 
+    /**
+     * @brief Waits for the frame to be encoded, if it was handed to the encode queue
+     **/
+    ActionRetCodeEnum waitForEncodeFinished()
+    {
+        if (!encodeJob) {
+            return eActionStatusOK;
+        }
+        ActionRetCodeEnum stat = encodeJob->waitForFinished();
+        encodeJob.reset();
+        return stat;
+    }
 
+    // The render of the output node, or of the input of the writer if the frame is encoded by the queue
     TreeRenderPtr render;
+
+    // The render of the writer once its input is computed, if the frame is encoded by the queue
+    TreeRenderPtr encodeRender;
+    WriteEncodeQueuePtr encodeQueue;
+    WriteEncodeJobPtr encodeJob;
 };
 
 struct DefaultScheduler::Implementation
@@ -98,6 +307,17 @@ struct DefaultScheduler::Implementation
     mutable QMutex bufferedOutputMutex;
     int lastBufferedOutputSize;
 
+    // Shares the time-invariant parts of the tree across the frames of the sequence render
+    mutable QMutex renderBatchMutex;
+    TreeRenderBatchPtr renderBatch;
+
+    // Encodes the frames of writers that do not require sequential renders
+    WriteEncodeQueuePtr encodeQueue;
+
+    // Records the frames written in background mode, so that the render can be resumed with --resume
+    mutable QMutex checkpointJournalMutex;
+    RenderCheckpointJournalPtr checkpointJournal;
+
     Implementation()
     : renderTimer()
     , nFramesRenderedMutex()
@@ -106,6 +326,11 @@ struct DefaultScheduler::Implementation
     , currentTime(0)
     , bufferedOutputMutex()
     , lastBufferedOutputSize(0)
+    , renderBatchMutex()
+    , renderBatch()
+    , encodeQueue( boost::make_shared<WriteEncodeQueue>() )
+    , checkpointJournalMutex()
+    , checkpointJournal()
     {
 
     }
@@ -149,6 +374,26 @@ DefaultScheduler::createFrameRenderResults(TimeValue time, const std::vector<Vie
         stats = boost::make_shared<RenderStats>(enableRenderStats);
     }
 
+    // When the writer may render frames in any order, its input is computed by the render of the frame and the
+    // writer encodes it from the cache on the encode queue, so that writing to disk does not hold the next frames.
+    NodePtr encodeInputNode;
+    if ( isWrite && (outputNode->getEffectInstance()->getSequentialRenderSupport() == eSequentialPreferenceNotSequential) ) {
+        encodeInputNode = outputNode->getInput(0);
+    }
+
+    // With --distributed, the workers render the input of the writer to the remote tile cache first: the renders
+    // below then only fetch the tiles and encode them
+    DistributedRender* distributedRender = appPTR->getDistributedRender();
+    if ( distributedRender && encodeInputNode && !viewsToRender.empty() ) {
+        distributedRender->renderFrameInWorkers(isWrite->getNode()->getFullyQualifiedName(), encodeInputNode->getEffectInstance(), time, viewsToRender.front());
+    }
+
+    TreeRenderBatchPtr batch;
+    {
+        QMutexLocker k(&_imp->renderBatchMutex);
+        batch = _imp->renderBatch;
+    }
+
     TreeRenderQueueProviderPtr thisShared = shared_from_this();
 
     *future = boost::make_shared<RenderFrameResultsContainer>(thisShared);
@@ -160,10 +405,11 @@ DefaultScheduler::createFrameRenderResults(TimeValue time, const std::vector<Vie
         subResults->view = viewsToRender[view];
         subResults->stats = stats;
 
-        {
+        for (int i = 0; i < (encodeInputNode ? 2 : 1); ++i) {
+            bool isEncode = encodeInputNode && i == 1;
             TreeRender::CtorArgsPtr args = boost::make_shared<TreeRender::CtorArgs>();
             args->provider = thisShared;
-            args->treeRootEffect = outputNode->getEffectInstance();
+            args->treeRootEffect = (encodeInputNode && !isEncode) ? encodeInputNode->getEffectInstance() : outputNode->getEffectInstance();
             args->time = time;
             args->view = viewsToRender[view];
 
@@ -177,12 +423,18 @@ DefaultScheduler::createFrameRenderResults(TimeValue time, const std::vector<Vie
             args->draftMode = false;
             args->playback = true;
             args->byPassCache = false;
+            args->batch = batch;
 
-            subResults->render = TreeRender::create(args);
-            if (!subResults->render) {
+            TreeRenderPtr render = TreeRender::create(args);
+            if (!render) {
                 return eActionStatusFailed;
             }
-
+            if (isEncode) {
+                subResults->encodeRender = render;
+                subResults->encodeQueue = _imp->encodeQueue;
+            } else {
+                subResults->render = render;
+            }
         }
         (*future)->frames.push_back(subResults);
     }
@@ -235,6 +487,43 @@ DefaultScheduler::onFrameProcessed(const ProcessFrameArgsBase& inArgs)
 
     RenderEnginePtr engine = getEngine();
 
+    // Wait for the frames handed to the encode queue so that frames are reported in order once written
+    for (std::list<RenderFrameSubResultPtr>::const_iterator it = results->frames.begin(); it != results->frames.end(); ++it) {
+        DefaultRenderFrameSubResult* subResult = dynamic_cast<DefaultRenderFrameSubResult*>( it->get() );
+        if (!subResult) {
+            continue;
+        }
+        ActionRetCodeEnum stat = subResult->waitForEncodeFinished();
+        if (stat == eActionStatusAborted) {
+            return;
+        } else if ( isFailureRetCode(stat) ) {
+            // Do not notify the scheduler from this thread: it may be waiting for this thread to process the next frames
+            onRenderFailed(stat);
+            engine->abortRenderingNoRestart();
+            return;
+        }
+    }
+
+    // The frame is fully written: checkpoint it
+    RenderCheckpointJournalPtr journal;
+    {
+        QMutexLocker k(&_imp->checkpointJournalMutex);
+        journal = _imp->checkpointJournal;
+    }
+    if (journal) {
+        KnobFilePtr fileKnob = toKnobFile( getOutputNode()->getKnobByName(kOfxImageEffectFileParamName) );
+        if (fileKnob) {
+            std::list<QString> files;
+            for (std::list<RenderFrameSubResultPtr>::const_iterator it = results->frames.begin(); it != results->frames.end(); ++it) {
+                QString file = QString::fromUtf8( fileKnob->getValueAtTime(results->time, DimIdx(0), (*it)->view).c_str() );
+                if ( std::find(files.begin(), files.end(), file) == files.end() ) {
+                    files.push_back(file);
+                }
+            }
+            journal->addFrame(results->time, files);
+        }
+    }
+
     // Report render stats if desired
     NodePtr effect = getOutputNode();
     for (std::list<RenderFrameSubResultPtr>::const_iterator it = results->frames.begin(); it != results->frames.end(); ++it) {
@@ -300,6 +589,24 @@ DefaultScheduler::onFrameProcessed(const ProcessFrameArgsBase& inArgs)
         }
 
         appPTR->writeToOutputPipe(longMessage, shortMessage, false);
+
+        // The images of this frame are in the tile cache shared with the main process: let it know so it can display them
+        if ( appPTR->isSharingRenderedFramesWithMainProcess() ) {
+            for (std::list<RenderFrameSubResultPtr>::const_iterator it = results->frames.begin(); it != results->frames.end(); ++it) {
+                QString availableMessage = QString::fromUtf8(kFrameAvailableInCacheStringShort) + frameStr + QString::fromUtf8(kViewStringShort) + QString::number( (int)(*it)->view );
+                appPTR->writeToOutputPipe(QString(), availableMessage, false);
+            }
+        }
+    }
+
+    // The views of a frame share the same stats
+    if ( !results->frames.empty() && results->frames.front()->stats ) {
+        engine->s_frameStatsReported(results->time, results->frames.front()->stats);
+    }
+
+    MetricsExporter* metrics = appPTR->getMetricsExporter();
+    if (metrics) {
+        metrics->addFrameRendered( effect->getScriptName_mt_safe(), results->frames.empty() ? RenderStatsPtr() : results->frames.front()->stats );
     }
 
     // Fire the frameRendered signal on the RenderEngine
@@ -384,6 +691,13 @@ DefaultScheduler::aboutToStartRender()
     if (isBackGround) {
         QString longText = QString::fromUtf8( outputNode->getScriptName_mt_safe().c_str() ) + tr(" ==> Rendering started");
         appPTR->writeToOutputPipe(longText, QString::fromUtf8(kRenderingStartedShort), true);
+
+        // The RenderQueue removed the journal of the previous render unless this render resumes it
+        QString journalPath = RenderCheckpointJournal::getJournalFilePath(outputNode);
+        if ( !journalPath.isEmpty() ) {
+            QMutexLocker k(&_imp->checkpointJournalMutex);
+            _imp->checkpointJournal = boost::make_shared<RenderCheckpointJournal>(journalPath);
+        }
     }
 
     // Activate the internal writer node for a write node
@@ -392,14 +706,45 @@ DefaultScheduler::aboutToStartRender()
         isWrite->onSequenceRenderStarted();
     }
 
+    // Analyse the tree once for the whole range so that its time-invariant parts are rendered only once
+    {
+        NodePtr treeRoot = outputNode;
+        if (isWrite) {
+            NodePtr embeddedWriter = isWrite->getEmbeddedWriter();
+            if (embeddedWriter) {
+                treeRoot = embeddedWriter;
+            }
+        }
+        TreeRenderBatchPtr batch = TreeRenderBatch::create(treeRoot->getEffectInstance(), args->firstFrame, args->lastFrame);
+        QMutexLocker k(&_imp->renderBatchMutex);
+        _imp->renderBatch = batch;
+    }
+
 
 } // DefaultScheduler::aboutToStartRender
 
+void
+DefaultScheduler::onAllFramesProcessed()
+{
+    _imp->encodeQueue->waitForDone();
+}
+
 void
 DefaultScheduler::onRenderStopped(bool /*aborted*/)
 {
     _imp->renderTimer.reset();
 
+    // Release the images shared by the frames of the range
+    {
+        QMutexLocker k(&_imp->renderBatchMutex);
+        _imp->renderBatch.reset();
+    }
+
+    {
+        QMutexLocker k(&_imp->checkpointJournalMutex);
+        _imp->checkpointJournal.reset();
+    }
+
 
     NodePtr outputNode = getOutputNode();
 
@@ -58,6 +58,11 @@ public:
 
     virtual void onFrameProcessed(const ProcessFrameArgsBase& args) OVERRIDE FINAL;
 
+    virtual TreeRenderPriorityEnum getRenderPriority() const OVERRIDE FINAL
+    {
+        return eTreeRenderPriorityBackgroundWrite;
+    }
+
 private:
 
     virtual ProcessFrameArgsBasePtr createProcessFrameArgs(const OutputSchedulerThreadStartArgsPtr& runArgs, const RenderFrameResultsContainerPtr& results) OVERRIDE FINAL;
@@ -70,6 +75,7 @@ private:
 
     virtual void onRenderFailed(ActionRetCodeEnum status) OVERRIDE FINAL;
     virtual void aboutToStartRender() OVERRIDE FINAL;
+    virtual void onAllFramesProcessed() OVERRIDE FINAL;
     virtual void onRenderStopped(bool aborted) OVERRIDE FINAL;
 
 private:
@@ -28,6 +28,11 @@
 #include <cassert>
 #include <stdexcept>
 
+#include <QtCore/QDir>
+#include <QtCore/QMutex>
+
+#include "Engine/AppManager.h"
+#include "Engine/CompressedTileFile.h"
 #include "Engine/Node.h"
 #include "Engine/Image.h"
 #include "Engine/AppInstance.h"
@@ -54,6 +59,19 @@ NATRON_NAMESPACE_ENTER
 #define kDiskCacheNodeFrameRangeLabel "Frame Range"
 #define kDiskCacheNodeFrameRangeHint ""
 
+#define kDiskCacheNodeCompressTiles "compressTiles"
+#define kDiskCacheNodeCompressTilesLabel "Compress"
+#define kDiskCacheNodeCompressTilesHint "When checked, the images are also stored losslessly compressed in a file of this node in the cache directory. " \
+    "They are read back from this file when they are no longer in the cache, which takes less disk space and bandwidth than the persistent cache " \
+    "when caching long sequences."
+
+#define kDiskCacheNodeClearCompressedTiles "clearCompressedTiles"
+#define kDiskCacheNodeClearCompressedTilesLabel "Clear Compressed"
+#define kDiskCacheNodeClearCompressedTilesHint "Removes all images from the compressed file of this node."
+
+// The directory of the cache directory holding the compressed files of the DiskCache nodes
+#define NATRON_DISK_CACHE_NODE_DIR_NAME "DiskCacheNode"
+
 
 struct DiskCacheNodePrivate
 {
@@ -61,8 +79,19 @@ struct DiskCacheNodePrivate
     KnobIntWPtr firstFrame;
     KnobIntWPtr lastFrame;
     KnobButtonWPtr preRender;
+    KnobBoolWPtr compressTiles;
+    KnobButtonWPtr clearCompressedTiles;
+
+    // Only used on the main instance: the render clones use the file of the main instance.
+    // Protects compressedFile
+    QMutex compressedFileMutex;
+
+    // The file is opened the first time it is needed
+    CompressedTileFilePtr compressedFile;
 
     DiskCacheNodePrivate()
+    : compressedFileMutex()
+    , compressedFile()
     {
     }
 };
@@ -81,7 +110,8 @@ DiskCacheNode::createPlugin()
                        "branches and cache any branch that one is no longer working on. The cached images are saved by default in the same directory that is used "
                        "for the viewer cache but you can set its location and size in the preferences. A solid state drive disk is recommended for efficiency of this node. "
                        "By default all images that pass into the node are cached but they depend on the zoom-level of the viewer. For convenience you can cache "
-                       "a specific frame range at scale 100% much like a writer node would do.\n"
+                       "a specific frame range at scale 100% much like a writer node would do. "
+                       "To save disk space and bandwidth on long sequences, the images can also be stored losslessly compressed in a file of the node.\n"
                        "WARNING: The DiskCache node must be part of the tree when you want to read cached data from it.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) );
     ret->setProperty<std::string>(kNatronPluginPropDescription, desc.toStdString());
     EffectDescriptionPtr effectDesc = ret->getEffectDescriptor();
@@ -179,6 +209,23 @@ DiskCacheNode::initializeKnobs()
     preRender->setHintToolTip( tr("Cache the frame range specified by rendering images at zoom-level 100% only.") );
     page->addKnob(preRender);
     _imp->preRender = preRender;
+
+    KnobBoolPtr compressTiles = createKnob<KnobBool>(kDiskCacheNodeCompressTiles);
+    compressTiles->setLabel(tr(kDiskCacheNodeCompressTilesLabel));
+    compressTiles->setHintToolTip(tr(kDiskCacheNodeCompressTilesHint));
+    compressTiles->setAnimationEnabled(false);
+    compressTiles->setEvaluateOnChange(false);
+    compressTiles->setAddNewLine(false);
+    compressTiles->setDefaultValue(false);
+    page->addKnob(compressTiles);
+    _imp->compressTiles = compressTiles;
+
+    KnobButtonPtr clearCompressedTiles = createKnob<KnobButton>(kDiskCacheNodeClearCompressedTiles);
+    clearCompressedTiles->setLabel(tr(kDiskCacheNodeClearCompressedTilesLabel));
+    clearCompressedTiles->setHintToolTip(tr(kDiskCacheNodeClearCompressedTilesHint));
+    clearCompressedTiles->setEvaluateOnChange(false);
+    page->addKnob(clearCompressedTiles);
+    _imp->clearCompressedTiles = clearCompressedTiles;
 }
 
 void
@@ -188,8 +235,38 @@ DiskCacheNode::fetchRenderCloneKnobs()
     _imp->frameRange = toKnobChoice(getKnobByName(kDiskCacheNodeFrameRange));
     _imp->firstFrame = toKnobInt(getKnobByName(kDiskCacheNodeFirstFrame));
     _imp->lastFrame = toKnobInt(getKnobByName(kDiskCacheNodeLastFrame));
+    _imp->compressTiles = toKnobBool(getKnobByName(kDiskCacheNodeCompressTiles));
 }
 
+CompressedTileFilePtr
+DiskCacheNode::getCompressedTileFile()
+{
+    KnobBoolPtr compressTiles = _imp->compressTiles.lock();
+    if ( !compressTiles || !compressTiles->getValue() ) {
+        return CompressedTileFilePtr();
+    }
+
+    // The file is shared by all render clones
+    DiskCacheNodePtr mainInstance = toDiskCacheNode( toEffectInstance( getMainInstance() ) );
+    if (mainInstance) {
+        return mainInstance->getCompressedTileFile();
+    }
+
+    QMutexLocker k(&_imp->compressedFileMutex);
+    if (!_imp->compressedFile) {
+        // Images are identified by their hash in the file, a name shared with a node of another project is harmless
+        QString dirPath = QString::fromUtf8( appPTR->getCacheDirPath().c_str() ) + QLatin1Char('/') + QString::fromUtf8(NATRON_DISK_CACHE_NODE_DIR_NAME);
+        QDir().mkpath(dirPath);
+        std::string filePath = dirPath.toStdString() + '/' + getNode()->getFullyQualifiedName() + ".tiles";
+        CompressedTileFilePtr file = boost::make_shared<CompressedTileFile>();
+        if ( !file->open(filePath) ) {
+            return CompressedTileFilePtr();
+        }
+        _imp->compressedFile = file;
+    }
+    return _imp->compressedFile;
+} // getCompressedTileFile
+
 bool
 DiskCacheNode::knobChanged(const KnobIPtr& k,
                            ValueChangedReasonEnum /*reason*/,
@@ -222,6 +299,17 @@ DiskCacheNode::knobChanged(const KnobIPtr& k,
         std::list<RenderQueue::RenderWork> works;
         works.push_back(w);
         getApp()->getRenderQueue()->renderNonBlocking(works);
+    } else if (_imp->compressTiles.lock() == k) {
+        if ( !_imp->compressTiles.lock()->getValue() ) {
+            // Close the file, it is opened again if compression is enabled again
+            QMutexLocker l(&_imp->compressedFileMutex);
+            _imp->compressedFile.reset();
+        }
+    } else if (_imp->clearCompressedTiles.lock() == k) {
+        CompressedTileFilePtr file = getCompressedTileFile();
+        if (file) {
+            file->clear();
+        }
     } else {
         ret = false;
     }
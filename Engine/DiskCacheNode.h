@@ -77,6 +77,11 @@ public:
     virtual void initializeKnobs() OVERRIDE FINAL;
     virtual ActionRetCodeEnum getFrameRange(double *first, double *last) OVERRIDE FINAL;
 
+    /**
+     * @brief Returns the file in which the images of this node are stored compressed, or NULL if compression is disabled.
+     **/
+    virtual CompressedTileFilePtr getCompressedTileFile() OVERRIDE FINAL;
+
 
 private:
 
@@ -26,6 +26,14 @@
 
 
 #include <list>
+#include <cstring>
+
+// SSE2 is always available on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_DISTORTION2D_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "Engine/EffectInstance.h"
 #include "Engine/Transform.h"
 NATRON_NAMESPACE_ENTER
@@ -93,10 +101,14 @@ Distortion2DStack::pushDistortionFunction(const DistortionFunction2DPtr& distort
             _imp->stack.push_back(distortion);
 
         } else {
-            // If the last pushed distortion is a matrix and this distortion is also a matrix, concatenate
+            // If the last pushed distortion is a matrix and this distortion is also a matrix, concatenate.
+            // The distortions may be shared with the stack of another request: replace it instead of modifying it.
             DistortionFunction2DPtr lastDistort = _imp->stack.back();
             if (lastDistort->transformMatrix) {
-                *lastDistort->transformMatrix = Transform::matMul(*lastDistort->transformMatrix, *distortion->transformMatrix);
+                DistortionFunction2DPtr concatenated(new DistortionFunction2D);
+                concatenated->inputNbToDistort = lastDistort->inputNbToDistort;
+                concatenated->transformMatrix.reset( new Transform::Matrix3x3( Transform::matMul(*lastDistort->transformMatrix, *distortion->transformMatrix) ) );
+                _imp->stack.back() = concatenated;
             } else {
                 // Cannot concatenate, append
                 _imp->stack.push_back(distortion);
@@ -122,6 +134,168 @@ Distortion2DStack::getStack() const
     return _imp->stack;
 }
 
+bool
+Distortion2DStack::getMatrix(Transform::Matrix3x3* mat) const
+{
+    mat->setIdentity();
+    for (std::list<DistortionFunction2DPtr>::const_iterator it = _imp->stack.begin(); it != _imp->stack.end(); ++it) {
+        if (!(*it)->transformMatrix) {
+            return false;
+        }
+        *mat = Transform::matMul(*mat, *(*it)->transformMatrix);
+    }
+    return true;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Calls the distortion function of the plug-in, computing the jacobian with finite differences if it does not provide it
+ **/
+static void
+callDistortionFunction(const DistortionFunction2D& distort, double x, double y, bool wantsJacobian, double* outX, double* outY, double J[4])
+{
+    bool gotJacobian;
+    distort.func(distort.customData, x, y, wantsJacobian, outX, outY, &gotJacobian, J);
+
+    if (wantsJacobian && !gotJacobian) {
+        // Compute the jacobian with centered finite differences
+        // The epsilon used for finite differences here is 0.5 because we want to evaluate the jacobian for a pixel at its center point (0.5,0.5)
+        Point pxHigh,pxLow;
+        distort.func(distort.customData, x + 0.5, y, false, &pxHigh.x, &pxHigh.y, 0, 0);
+        distort.func(distort.customData, x - 0.5, y, false, &pxLow.x, &pxLow.y, 0, 0);
+
+        Point pyHigh,pyLow;
+        distort.func(distort.customData, x, y + 0.5, false, &pyHigh.x, &pyHigh.y, 0, 0);
+        distort.func(distort.customData, x, y - 0.5, false, &pyLow.x, &pyLow.y, 0, 0);
+
+        // dFx/dx = (f(x + h) - f(x - h)) / 2h   here h = 0.5 so 2h = 1
+        J[0] = pxHigh.x - pxLow.x;
+
+        // dFx/dy
+        J[1] = pyHigh.x - pyLow.x;
+
+        // dFy/dx
+        J[2] = pxHigh.y - pxLow.y;
+
+        // dFy/dy
+        J[3] = pyHigh.y - pyLow.y;
+    }
+} // callDistortionFunction
+
+/**
+ * @brief Concatenates the jacobian J of a distortion with the jacobian of the distortions applied before it
+ **/
+static inline void
+concatenateJacobian(const double J[4], double jacobian[4])
+{
+    double j0 = J[0] * jacobian[0] + J[1] * jacobian[2];
+    double j1 = J[0] * jacobian[1] + J[1] * jacobian[3];
+    double j2 = J[2] * jacobian[0] + J[3] * jacobian[2];
+    double j3 = J[2] * jacobian[1] + J[3] * jacobian[3];
+    jacobian[0] = j0;
+    jacobian[1] = j1;
+    jacobian[2] = j2;
+    jacobian[3] = j3;
+}
+
+/**
+ * @brief Applies H to count positions in place, concatenating the jacobians if not NULL
+ **/
+static void
+applyMatrixToPoints(const Transform::Matrix3x3& H, double* x, double* y, std::size_t count, double* jacobians)
+{
+    const bool isAffine = H(2,0) == 0. && H(2,1) == 0. && H(2,2) == 1.;
+    std::size_t i = 0;
+
+    if (!jacobians) {
+#ifdef NATRON_DISTORTION2D_SSE2
+        // 2 positions at a time
+        const __m128d h00 = _mm_set1_pd( H(0,0) ), h01 = _mm_set1_pd( H(0,1) ), h02 = _mm_set1_pd( H(0,2) );
+        const __m128d h10 = _mm_set1_pd( H(1,0) ), h11 = _mm_set1_pd( H(1,1) ), h12 = _mm_set1_pd( H(1,2) );
+        const __m128d h20 = _mm_set1_pd( H(2,0) ), h21 = _mm_set1_pd( H(2,1) ), h22 = _mm_set1_pd( H(2,2) );
+        for (; i + 2 <= count; i += 2) {
+            __m128d px = _mm_loadu_pd(x + i);
+            __m128d py = _mm_loadu_pd(y + i);
+            __m128d qx = _mm_add_pd( _mm_add_pd( _mm_mul_pd(h00, px), _mm_mul_pd(h01, py) ), h02 );
+            __m128d qy = _mm_add_pd( _mm_add_pd( _mm_mul_pd(h10, px), _mm_mul_pd(h11, py) ), h12 );
+            if (!isAffine) {
+                __m128d qz = _mm_add_pd( _mm_add_pd( _mm_mul_pd(h20, px), _mm_mul_pd(h21, py) ), h22 );
+                qx = _mm_div_pd(qx, qz);
+                qy = _mm_div_pd(qy, qz);
+            }
+            _mm_storeu_pd(x + i, qx);
+            _mm_storeu_pd(y + i, qy);
+        }
+#endif
+        for (; i < count; ++i) {
+            double qx = H(0,0) * x[i] + H(0,1) * y[i] + H(0,2);
+            double qy = H(1,0) * x[i] + H(1,1) * y[i] + H(1,2);
+            if (!isAffine) {
+                double qz = H(2,0) * x[i] + H(2,1) * y[i] + H(2,2);
+                qx /= qz;
+                qy /= qz;
+            }
+            x[i] = qx;
+            y[i] = qy;
+        }
+        return;
+    }
+
+    for (; i < count; ++i) {
+        Transform::Point3D p = Transform::matApply( H, Transform::Point3D(x[i], y[i], 1.) );
+        double J[4];
+        J[0] = (H(0,0) * p.z - p.x * H(2,0)) / (p.z * p.z);
+        J[1] = (H(0,1) * p.z - p.x * H(2,1)) / (p.z * p.z);
+        J[2] = (H(1,0) * p.z - p.y * H(2,0)) / (p.z * p.z);
+        J[3] = (H(1,1) * p.z - p.y * H(2,1)) / (p.z * p.z);
+        concatenateJacobian(J, jacobians + i * 4);
+        x[i] = p.x / p.z;
+        y[i] = p.y / p.z;
+    }
+} // applyMatrixToPoints
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+Distortion2DStack::applyDistortionStack(const double* distortedX,
+                                        const double* distortedY,
+                                        std::size_t count,
+                                        const Distortion2DStack& stack,
+                                        double* undistortedX,
+                                        double* undistortedY,
+                                        double* jacobians)
+{
+    if (undistortedX != distortedX) {
+        std::memmove( undistortedX, distortedX, count * sizeof(double) );
+    }
+    if (undistortedY != distortedY) {
+        std::memmove( undistortedY, distortedY, count * sizeof(double) );
+    }
+    if (jacobians) {
+        for (std::size_t i = 0; i < count; ++i) {
+            double* J = jacobians + i * 4;
+            J[0] = J[3] = 1.;
+            J[1] = J[2] = 0.;
+        }
+    }
+
+    const bool wantsJacobian = jacobians != 0;
+    for (std::list<DistortionFunction2DPtr>::const_reverse_iterator it = stack._imp->stack.rbegin(); it != stack._imp->stack.rend(); ++it) {
+        if ((*it)->transformMatrix) {
+            applyMatrixToPoints(*(*it)->transformMatrix, undistortedX, undistortedY, count, jacobians);
+        } else {
+            for (std::size_t i = 0; i < count; ++i) {
+                double J[4];
+                callDistortionFunction(**it, undistortedX[i], undistortedY[i], wantsJacobian, &undistortedX[i], &undistortedY[i], J);
+                if (wantsJacobian) {
+                    concatenateJacobian(J, jacobians + i * 4);
+                }
+            }
+        }
+    }
+} // applyDistortionStack
+
 void
 Distortion2DStack::applyDistortionStack(double distortedX, double distortedY, const Distortion2DStack& stack, double* undistortedX, double* undistortedY, bool wantsJacobian, bool* gotJacobianOut, double jacobian[4])
 {
@@ -156,32 +330,7 @@ Distortion2DStack::applyDistortionStack(double distortedX, double distortedY, co
             p.y /= p.z;
 
         } else {
-            bool gotJacobian;
-            (*it)->func( (*it)->customData, p.x, p.y, wantsJacobian, &p.x, &p.y, &gotJacobian, J);
-
-            if (wantsJacobian && !gotJacobian) {
-                // Compute the jacobian with centered finite differences
-                // The epsilon used for finite differences here is 0.5 because we want to evaluate the jacobian for a pixel at its center point (0.5,0.5)
-                Point pxHigh,pxLow;
-                (*it)->func((*it)->customData, p.x + 0.5, p.y, false, &pxHigh.x, &pxHigh.y, 0, 0);
-                (*it)->func((*it)->customData, p.x - 0.5, p.y, false, &pxLow.x, &pxLow.y, 0, 0);
-
-                Point pyHigh,pyLow;
-                (*it)->func( (*it)->customData, p.x, p.y + 0.5, false, &pyHigh.x, &pyHigh.y, 0, 0);
-                (*it)->func( (*it)->customData, p.x, p.y - 0.5, false, &pyLow.x, &pyLow.y, 0, 0);
-
-                // dFx/dx = (f(x + h) - f(x - h)) / 2h   here h = 0.5 so 2h = 1
-                J[0] = pxHigh.x - pxLow.x;
-
-                // dFx/dy
-                J[1] = pyHigh.x - pyLow.x;
-
-                // dFy/dx
-                J[2] = pxHigh.y - pxLow.y;
-
-                // dFy/dy
-                J[3] = pyHigh.y - pyLow.y;
-            }
+            callDistortionFunction(**it, p.x, p.y, wantsJacobian, &p.x, &p.y, J);
         }
 
         if (wantsJacobian) {
@@ -189,11 +338,7 @@ Distortion2DStack::applyDistortionStack(double distortedX, double distortedY, co
                 jacobianSet = true;
                 memcpy(jacobian, J, sizeof(double) * 4);
             } else {
-                // Concatenate jacobians
-                jacobian[0] = J[0] * jacobian[0] + J[1] * jacobian[2];
-                jacobian[1] = J[0] * jacobian[1] + J[1] * jacobian[3];
-                jacobian[2] = J[2] * jacobian[0] + J[3] * jacobian[2];
-                jacobian[3] = J[2] * jacobian[1] + J[3] * jacobian[3];
+                concatenateJacobian(J, jacobian);
             }
         }
     }
@@ -27,6 +27,8 @@
 
 #include "Global/Macros.h"
 
+#include <cstddef>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
 #include <boost/weak_ptr.hpp>
@@ -97,6 +99,12 @@ public:
 
     const std::list<DistortionFunction2DPtr>& getStack() const;
 
+    /**
+     * @brief Returns true if the stack only contains transformation matrices, in which case they are concatenated in a single
+     * matrix returned in mat. An empty stack is the identity.
+     **/
+    bool getMatrix(Transform::Matrix3x3* mat) const;
+
     /**
      * @brief Get/Set the effect producing the image on which to apply the distortion stack.
      **/
@@ -108,6 +116,21 @@ public:
      **/
     static void applyDistortionStack(double distortedX, double distortedY, const Distortion2DStack& stack, double* undistortedX, double* undistortedY, bool wantsJacobian, bool* gotJacobian, double jacobian[4]);
 
+    /**
+     * @brief Same as above for count positions at once, typically a row of pixels. Each element of the stack is applied to all
+     * the positions before the next one: the matrices are applied with a vectorized kernel and the distortion functions
+     * are called in a tight loop.
+     * The undistorted positions may be written over the distorted ones.
+     * @param jacobians If not NULL, receives the 4 values of the jacobian of each position, in the same order as above.
+     **/
+    static void applyDistortionStack(const double* distortedX,
+                                     const double* distortedY,
+                                     std::size_t count,
+                                     const Distortion2DStack& stack,
+                                     double* undistortedX,
+                                     double* undistortedY,
+                                     double* jacobians);
+
 private:
 
     boost::scoped_ptr<Distortion2DStackPrivate> _imp;
@@ -0,0 +1,369 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "DistributedRender.h"
+
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QProcess>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/CLArgs.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/RectI.h"
+#include "Engine/RemoteTileCache.h"
+#include "Engine/Settings.h"
+#include "Engine/TreeRender.h"
+#include "Engine/WriteNode.h"
+
+// How long a worker waits for its tiles to be sent to the remote tile cache before it exits
+#define NATRON_DISTRIBUTED_RENDER_PUBLISH_TIMEOUT_MS 600000
+
+NATRON_NAMESPACE_ENTER
+
+struct DistributedRenderPrivate
+{
+    int localWorkersCount;
+    QStringList hosts;
+
+    // The project and the options passed to all the workers
+    QString projectFile;
+    QStringList projectArgs;
+
+    bool warnedNoRemoteCache;
+
+    DistributedRenderPrivate()
+    : localWorkersCount(0)
+    , hosts()
+    , projectFile()
+    , projectArgs()
+    , warnedNoRemoteCache(false)
+    {
+
+    }
+
+    QStringList makeWorkerArgs(const std::string& writerName, TimeValue time, const RectD& region) const;
+
+    /**
+     * @brief Returns the node whose regions are rendered for the given writer: the input of its encoder, as in
+     * DefaultScheduler::createFrameRenderResults. Returns NULL if the writer must render its frames in sequence,
+     * e.g. for a video file.
+     **/
+    static NodePtr getWriterInput(const NodePtr& writer);
+};
+
+static QString
+shellQuote(const QString& arg)
+{
+    QString ret = arg;
+    ret.replace( QLatin1Char('\''), QString::fromUtf8("'\\''") );
+
+    return QLatin1Char('\'') + ret + QLatin1Char('\'');
+}
+
+QStringList
+DistributedRenderPrivate::makeWorkerArgs(const std::string& writerName, TimeValue time, const RectD& region) const
+{
+    const QString frame = QString::number( (int)std::floor(time + 0.5) );
+    QStringList args;
+    args << QString::fromUtf8("-b");
+    args << QString::fromUtf8("-w") << QString::fromUtf8( writerName.c_str() ) << frame + QLatin1Char('-') + frame;
+    args << QString::fromUtf8("--render-region") << QString::fromUtf8("%1,%2,%3,%4")
+        .arg(region.x1, 0, 'g', 17)
+        .arg(region.y1, 0, 'g', 17)
+        .arg(region.x2, 0, 'g', 17)
+        .arg(region.y2, 0, 'g', 17);
+
+    // The workers must publish to the same server, even if their settings differ
+    const std::string server = appPTR->getCurrentSettings()->getRemoteTileCacheServer();
+    args << QString::fromUtf8("--setting") << QString::fromUtf8("remoteTileCacheServer=\"%1\"").arg( QString::fromUtf8( server.c_str() ) );
+    args << projectArgs;
+    args << projectFile;
+
+    return args;
+}
+
+NodePtr
+DistributedRenderPrivate::getWriterInput(const NodePtr& writer)
+{
+    if (!writer) {
+        return NodePtr();
+    }
+    WriteNodePtr isWrite = toWriteNode( writer->getEffectInstance() );
+    if (!isWrite) {
+        return NodePtr();
+    }
+    NodePtr outputNode = writer;
+    NodePtr embeddedWriter = isWrite->getEmbeddedWriter();
+    if (embeddedWriter) {
+        outputNode = embeddedWriter;
+    }
+    if (outputNode->getEffectInstance()->getSequentialRenderSupport() != eSequentialPreferenceNotSequential) {
+        return NodePtr();
+    }
+
+    return outputNode->getInput(0);
+}
+
+DistributedRender::DistributedRender()
+    : _imp( new DistributedRenderPrivate() )
+{
+}
+
+DistributedRender::~DistributedRender()
+{
+}
+
+void
+DistributedRender::setWorkers(int localWorkersCount,
+                              const QStringList& hosts)
+{
+    _imp->localWorkersCount = localWorkersCount;
+    _imp->hosts = hosts;
+}
+
+void
+DistributedRender::setCommandLineArgs(const CLArgs& cl)
+{
+    _imp->projectFile = QFileInfo( cl.getScriptFilename() ).absoluteFilePath();
+    _imp->projectArgs.clear();
+
+    // Give the workers what modifies the project after it is loaded
+    const std::list<CLArgs::ReaderArg>& readers = cl.getReaderArgs();
+    for (std::list<CLArgs::ReaderArg>::const_iterator it = readers.begin(); it != readers.end(); ++it) {
+        _imp->projectArgs << QString::fromUtf8("-i") << it->name << it->filename;
+    }
+    const std::list<std::string>& commands = cl.getPythonCommands();
+    for (std::list<std::string>::const_iterator it = commands.begin(); it != commands.end(); ++it) {
+        _imp->projectArgs << QString::fromUtf8("-c") << QString::fromUtf8( it->c_str() );
+    }
+    if ( !cl.getDefaultOnProjectLoadedScript().isEmpty() ) {
+        _imp->projectArgs << QString::fromUtf8("-l") << QFileInfo( cl.getDefaultOnProjectLoadedScript() ).absoluteFilePath();
+    }
+}
+
+bool
+DistributedRender::renderFrameInWorkers(const std::string& writerName,
+                                        const EffectInstancePtr& effect,
+                                        TimeValue time,
+                                        ViewIdx view)
+{
+    if ( !appPTR->getRemoteTileCache()->isEnabled() ) {
+        if (!_imp->warnedNoRemoteCache) {
+            _imp->warnedNoRemoteCache = true;
+            std::cerr << tr("The remote tile cache server is not set in the Preferences: the frames are not distributed "
+                            "to the workers since their tiles could not reach this process.").toStdString() << std::endl;
+        }
+
+        return false;
+    }
+
+    const int workersCount = _imp->localWorkersCount + _imp->hosts.size();
+    std::vector<RectD> regions;
+    getFrameRegions(effect, time, view, workersCount, &regions);
+    if (regions.size() < 2) {
+        return false;
+    }
+
+    std::cout << tr("Rendering frame %1 of %2 with %3 workers").arg( time.value() ).arg( QString::fromUtf8( writerName.c_str() ) ).arg( regions.size() ).toStdString() << std::endl;
+
+    const QString program = QCoreApplication::applicationFilePath();
+    std::vector<boost::shared_ptr<QProcess> > processes;
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+        QStringList args = _imp->makeWorkerArgs(writerName, time, regions[i]);
+        boost::shared_ptr<QProcess> process = boost::make_shared<QProcess>();
+        process->setProcessChannelMode(QProcess::MergedChannels);
+        if ( (int)i < _imp->localWorkersCount ) {
+            process->start(program, args);
+        } else {
+            // ssh passes a single command line to the shell of the host
+            QString command = shellQuote(program);
+            for (QStringList::const_iterator it = args.begin(); it != args.end(); ++it) {
+                command += QLatin1Char(' ') + shellQuote(*it);
+            }
+            QStringList sshArgs;
+            sshArgs << _imp->hosts[(int)i - _imp->localWorkersCount] << command;
+            process->start(QString::fromUtf8("ssh"), sshArgs);
+        }
+        processes.push_back(process);
+    }
+
+    bool ok = true;
+    for (std::size_t i = 0; i < processes.size(); ++i) {
+        QProcess& process = *processes[i];
+        process.waitForFinished(-1);
+        if ( (process.exitStatus() != QProcess::NormalExit) || (process.exitCode() != 0) ) {
+            std::cerr << tr("Worker %1 failed to render its region of frame %2, this process renders it:").arg(i + 1).arg( time.value() ).toStdString() << std::endl;
+            std::cerr << QString::fromUtf8( process.readAll() ).toStdString() << std::endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+} // renderFrameInWorkers
+
+void
+DistributedRender::getFrameRegions(const EffectInstancePtr& effect,
+                                   TimeValue time,
+                                   ViewIdx view,
+                                   int regionsCount,
+                                   std::vector<RectD>* regions)
+{
+    if ( !effect->supportsTiles() ) {
+        return;
+    }
+
+    GetRegionOfDefinitionResultsPtr results;
+    ActionRetCodeEnum stat = effect->getRegionOfDefinition_public(time, RenderScale(1.), view, &results);
+    if ( isFailureRetCode(stat) ) {
+        return;
+    }
+
+    // The regions are computed at the scale of the render of the writer, see DefaultScheduler::createFrameRenderResults
+    const double par = effect->getAspectRatio(-1);
+    RectI pixelRod;
+    results->getRoD().toPixelEnclosing(RenderScale(1.), par, &pixelRod);
+    if ( pixelRod.isNull() ) {
+        return;
+    }
+
+    int tileWidth, tileHeight;
+    appPTR->getTileCache()->getTileSizePx(effect->getBitDepth(-1), &tileWidth, &tileHeight);
+
+    const std::list<RectI> splits = pixelRod.splitIntoSmallerRects(regionsCount);
+    for (std::list<RectI>::const_iterator it = splits.begin(); it != splits.end(); ++it) {
+
+        // Move the edges inside the RoD to the closest tile edge. Neighbouring regions share their edges, so they
+        // still cover the RoD without overlapping.
+        RectI region = *it;
+        if (region.x1 != pixelRod.x1) {
+            region.x1 = (int)std::floor( (double)region.x1 / tileWidth + 0.5 ) * tileWidth;
+        }
+        if (region.x2 != pixelRod.x2) {
+            region.x2 = (int)std::floor( (double)region.x2 / tileWidth + 0.5 ) * tileWidth;
+        }
+        if (region.y1 != pixelRod.y1) {
+            region.y1 = (int)std::floor( (double)region.y1 / tileHeight + 0.5 ) * tileHeight;
+        }
+        if (region.y2 != pixelRod.y2) {
+            region.y2 = (int)std::floor( (double)region.y2 / tileHeight + 0.5 ) * tileHeight;
+        }
+        if ( !region.intersect(pixelRod, &region) ) {
+            continue;
+        }
+
+        RectD canonicalRegion;
+        region.toCanonical_noClipping(RenderScale(1.), par, &canonicalRegion);
+        regions->push_back(canonicalRegion);
+    }
+} // getFrameRegions
+
+bool
+DistributedRender::renderRegion(const std::list<RenderQueue::RenderWork>& works,
+                                const RectD& region)
+{
+    RemoteTileCache* remoteCache = appPTR->getRemoteTileCache();
+    if ( !remoteCache->isEnabled() ) {
+        std::cerr << tr("The remote tile cache server is not set: the region cannot be rendered since its tiles could not "
+                        "reach the coordinator of the render.").toStdString() << std::endl;
+
+        return false;
+    }
+
+    // All the tiles are needed by the coordinator, none may be dropped
+    remoteCache->setPublishBlocking(true);
+
+    bool ok = true;
+    for (std::list<RenderQueue::RenderWork>::const_iterator it = works.begin(); it != works.end(); ++it) {
+        NodePtr inputNode = DistributedRenderPrivate::getWriterInput(it->treeRoot);
+        if (!inputNode) {
+            std::cerr << tr("%1 cannot be rendered by regions: it must be a Write node writing an image sequence.")
+                .arg( QString::fromUtf8( it->treeRoot->getScriptName_mt_safe().c_str() ) ).toStdString() << std::endl;
+            ok = false;
+            continue;
+        }
+        if ( (it->firstFrame == INT_MIN) || (it->lastFrame == INT_MAX) ) {
+            std::cerr << tr("The frames to render must be given with -w to render a region.").toStdString() << std::endl;
+            ok = false;
+            continue;
+        }
+        EffectInstancePtr effect = inputNode->getEffectInstance();
+        const int viewsCount = effect->getApp()->getProject()->getProjectViewsCount();
+        const int step = (it->frameStep == INT_MIN || it->frameStep == 0) ? 1 : std::abs( (int)it->frameStep );
+        for (int frame = (int)it->firstFrame; frame <= (int)it->lastFrame; frame += step) {
+            for (int view = 0; view < viewsCount; ++view) {
+
+                // Same arguments as the render of the writer, so that the coordinator finds the same tiles
+                TreeRender::CtorArgsPtr args(new TreeRender::CtorArgs);
+                args->provider = effect;
+                args->treeRootEffect = effect;
+                args->time = TimeValue(frame);
+                args->view = ViewIdx(view);
+                args->canonicalRoI = region;
+                args->mipMapLevel = 0;
+                args->proxyScale = RenderScale(1.);
+                args->draftMode = false;
+                args->playback = true;
+                args->byPassCache = false;
+
+                TreeRenderPtr render = TreeRender::create(args);
+                ActionRetCodeEnum stat = eActionStatusFailed;
+                if (render) {
+                    effect->launchRender(render);
+                    effect->waitForRenderFinished(render);
+                    stat = render->getStatus();
+                }
+                if ( isFailureRetCode(stat) ) {
+                    std::cerr << tr("Failed to render the region of frame %1 of %2.").arg(frame)
+                        .arg( QString::fromUtf8( it->treeRoot->getScriptName_mt_safe().c_str() ) ).toStdString() << std::endl;
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    if ( !remoteCache->waitForPublished(NATRON_DISTRIBUTED_RENDER_PUBLISH_TIMEOUT_MS) ) {
+        std::cerr << tr("Timed out while sending the tiles to the remote tile cache server.").toStdString() << std::endl;
+        ok = false;
+    }
+    remoteCache->setPublishBlocking(false);
+
+    return ok;
+} // renderRegion
+
+NATRON_NAMESPACE_EXIT
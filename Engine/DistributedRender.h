@@ -0,0 +1,123 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_DistributedRender_h
+#define Engine_DistributedRender_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/RectD.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/TimeValue.h"
+#include "Engine/ViewIdx.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Renders a single large frame with several NatronRenderer processes, on this machine (--distributed <count>)
+ * and/or on other hosts (--distributed-hosts).
+ *
+ * The process started by the user is the coordinator. Before it renders a frame of a Write node, the RoD of the input
+ * of the writer is split into one region per worker, aligned to the tiles of the cache, and each worker is started with
+ * --render-region. A worker loads the same project and only renders its region of the input of the writer: the
+ * requests of the upstream nodes only cover the RoIs needed by that region, as for any render. The tiles of the region
+ * are published to the remote tile cache server, which is how they reach the coordinator: the regular render of the
+ * frame then finds all the tiles in the remote cache and only assembles them and writes the file. A tile that a
+ * worker failed to render is simply rendered by the coordinator.
+ **/
+struct DistributedRenderPrivate;
+class DistributedRender
+{
+    Q_DECLARE_TR_FUNCTIONS(DistributedRender)
+
+public:
+
+    DistributedRender();
+
+    ~DistributedRender();
+
+    /**
+     * @brief Set the workers started for each frame: localWorkersCount processes on this machine and one process
+     * on each of the given hosts, started with ssh.
+     **/
+    void setWorkers(int localWorkersCount, const QStringList& hosts);
+
+    /**
+     * @brief Take the project and the options that the workers need to load the same project as this process.
+     **/
+    void setCommandLineArgs(const CLArgs& cl);
+
+    /**
+     * @brief Called by the render of a Write node before it renders the given frame: render the regions of
+     * the output of the given effect, the input of the writer, in the workers and wait for them.
+     * Returns false if the frame could not be distributed or if a worker failed.
+     * The caller renders the frame in any case.
+     **/
+    bool renderFrameInWorkers(const std::string& writerName,
+                              const EffectInstancePtr& effect,
+                              TimeValue time,
+                              ViewIdx view);
+
+    /**
+     * @brief Split the RoD of the given effect in at most regionsCount regions in canonical coordinates. The edges
+     * between regions fall on the edges of the tiles, so that the renders of two regions never compute the same tile
+     * once requestRenderInternal rounded their RoI to the tile size. Nothing is returned if the effect does not
+     * support tiles, since it would render its whole RoD for each region.
+     **/
+    static void getFrameRegions(const EffectInstancePtr& effect,
+                                TimeValue time,
+                                ViewIdx view,
+                                int regionsCount,
+                                std::vector<RectD>* regions);
+
+    /**
+     * @brief Called in a worker: render the given region of the input of the writer of each render work, for all
+     * the frames of the work and all the views of the project, then wait for the tiles to be published.
+     * Returns false if a render failed.
+     **/
+    static bool renderRegion(const std::list<RenderQueue::RenderWork>& works,
+                             const RectD& region);
+
+private:
+
+    boost::scoped_ptr<DistributedRenderPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_DistributedRender_h
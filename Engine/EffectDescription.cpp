@@ -53,6 +53,7 @@ EffectDescription::initializeProperties() const
     createProperty<ImageBufferLayoutEnum>(kEffectPropImageBufferLayout, eImageBufferLayoutRGBAPackedFullRect);
     createProperty<bool>(kEffectPropSupportsCanReturnDistortion, false);
     createProperty<bool>(kEffectPropSupportsCanReturn3x3Transform, false);
+    createProperty<bool>(kEffectPropSupportsCanReturnColorTransform, false);
     createProperty<bool>(kEffectPropSupportsAlphaFillWith1, true);
 }
 
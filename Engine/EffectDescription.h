@@ -86,6 +86,12 @@ NATRON_NAMESPACE_ENTER
  **/
 #define kEffectPropSupportsCanReturn3x3Transform "EffectPropSupportsCanReturn3x3Transform"
 
+/**
+ * @brief x1 bool property (optional) indicating whether the plug-in implements the getColorTransform action.
+ * Default value - false
+ **/
+#define kEffectPropSupportsCanReturnColorTransform "EffectPropSupportsCanReturnColorTransform"
+
 /**
  * @brief x1 bool property (optional) indicating that the plug-in wants to fill the alpha channel with 1 when fetching a source image
  * that is converted automatically from RGB to RGBA.
@@ -56,6 +56,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/AppManager.h"
 #include "Engine/EffectOpenGLContextData.h"
 #include "Engine/Cache.h"
+#include "Engine/ColorTransform.h"
 #include "Engine/EffectInstanceActionResults.h"
 #include "Engine/EffectInstanceTLSData.h"
 #include "Engine/Image.h"
@@ -70,6 +71,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/OfxImageEffectInstance.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/OSGLContext.h"
+#include "Engine/OSGLFunctions.h"
 #include "Engine/GroupInput.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/PluginMemory.h"
@@ -171,7 +173,14 @@ EffectInstance::createRenderCopy(const FrameViewRenderKey& key) const
 
     EffectInstancePtr clone = createFunc(boost::const_pointer_cast<EffectInstance>(shared_from_this()), key);
 
+    fetchRenderCloneInputs(clone, key);
 
+    return clone;
+} // createRenderCopy
+
+void
+EffectInstance::fetchRenderCloneInputs(const EffectInstancePtr& clone, const FrameViewRenderKey& key) const
+{
     // Make a copy of the main instance input locally so the state of the graph does not change throughout the render
     int nInputs = getNInputs();
 
@@ -190,10 +199,42 @@ EffectInstance::createRenderCopy(const FrameViewRenderKey& key) const
 
         }
     }
+} // fetchRenderCloneInputs
 
-    return clone;
+bool
+EffectInstance::isRenderClonePoolingSupported() const
+{
+    // A node group is never cloned, see createRenderCopy
+    return !dynamic_cast<const NodeGroup*>(this);
 }
 
+void
+EffectInstance::onRenderCloneReleased()
+{
+    // Drop the requests, the input clones and the node reference of the finished render:
+    // the pooled clone must not keep the main instance alive.
+    _imp->renderData.reset(new RenderCloneData);
+}
+
+void
+EffectInstance::rebindRenderClone(const FrameViewRenderKey& key)
+{
+    KnobHolder::rebindRenderClone(key);
+
+    EffectInstancePtr mainInstance = toEffectInstance(getMainInstance());
+    assert(mainInstance);
+    _imp->renderData->node = mainInstance->getNode();
+    assert(_imp->renderData->node);
+
+    // The plug-in may have changed its properties on the clone during the previous render
+    {
+        QMutexLocker k(&_imp->common->pluginsPropMutex);
+        _imp->descriptionPtr->cloneProperties(*_imp->common->descriptor);
+    }
+
+    mainInstance->fetchRenderCloneInputs(toEffectInstance(shared_from_this()), key);
+} // rebindRenderClone
+
 RenderEnginePtr
 EffectInstance::createRenderEngine()
 {
@@ -238,7 +279,7 @@ EffectInstance::appendToHash(const ComputeHashArgs& args, Hash64* hash)
         if (isFrameVarying()) {
             hash->append((double)roundImageTimeToEpsilon(args.time));
         }
-        if (getViewVariance() == eViewInvarianceAllViewsVariant) {
+        if (getViewVarianceForHash() == eViewInvarianceAllViewsVariant) {
             hash->append((int)args.view);
         }
 
@@ -301,6 +342,7 @@ EffectInstance::appendToHash(const ComputeHashArgs& args, Hash64* hash)
     if (framesNeededResults) {
         GetFramesNeededKeyPtr cacheKey;
         cacheKey = boost::make_shared<GetFramesNeededKey>(hashValue, getNode()->getPluginID() );
+        cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
 
 
         CacheEntryLockerBasePtr cacheAccess = appPTR->getGeneralPurposeCache()->get(framesNeededResults);
@@ -323,6 +365,8 @@ EffectInstance::invalidateHashCacheRecursive(const bool recurse, std::set<Hashab
         return false;
     }
 
+    onHashCacheInvalidated();
+
     //qDebug() << "Invalidate hash of" << getScriptName_mt_safe().c_str();
 
 
@@ -349,6 +393,16 @@ EffectInstance::invalidateHashCacheInternal(std::set<HashableObject*>* invalidat
     return invalidateHashCacheRecursive(true /*recurse*/, invalidatedObjects);
 }
 
+std::string
+EffectInstance::getHashProfilerName() const
+{
+    NodePtr node = getNode();
+    if (!node) {
+        return std::string();
+    }
+    return node->getFullyQualifiedName();
+}
+
 void
 EffectInstance::refreshMetadaWarnings(const NodeMetadata &metadata)
 {
@@ -473,6 +527,11 @@ EffectInstance::shouldCacheOutput(bool isFrameVaryingOrAnimated,
 
     NodePtr node = getNode();
 
+    if ( node->isSharedByConcurrentRenders() ) {
+        // Several Write nodes rendering at the same time pull this image, compute it once for all of them
+        return true;
+    }
+
     OutputNodesMap outputs;
     node->getOutputs(outputs);
     for (OutputNodesMap::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
@@ -909,6 +968,34 @@ EffectInstance::getImagePlane(const GetImageInArgs& inArgs, GetImageOutArgs* out
         return false;
     }
 
+    // The input request was concatenated in a chain of color transforms but this effect does not apply it:
+    // apply the stack now, otherwise we would read the image upstream of the chain.
+    {
+        ColorTransformStackPtr colorStack = outputRequest->getColorTransformStack();
+        if (colorStack && outputRequest->getStatus() == FrameViewRequest::eFrameViewRequestStatusPassThrough) {
+            Image::InitStorageArgs initArgs;
+            {
+                initArgs.bounds = outArgs->image->getBounds();
+                initArgs.proxyScale = outArgs->image->getProxyScale();
+                initArgs.mipMapLevel = outArgs->image->getMipMapLevel();
+                initArgs.plane = outArgs->image->getLayer();
+                initArgs.bitdepth = outArgs->image->getBitDepth();
+                initArgs.bufferFormat = outArgs->image->getBufferFormat();
+                initArgs.storage = eStorageModeRAM;
+                initArgs.renderClone = inputEffect;
+            }
+            ImagePtr transformedImage = Image::create(initArgs);
+            if (!transformedImage) {
+                return false;
+            }
+            ActionRetCodeEnum stat = colorStack->renderFromInputRequest(initArgs.bounds, transformedImage);
+            if (isFailureRetCode(stat)) {
+                return false;
+            }
+            outArgs->image = transformedImage;
+        }
+    }
+
 
     // In output of getImagePlane we also return the region that was rendered on the input image, so that
     // further code limits its processing to this region, and not actually the full image size.
@@ -973,7 +1060,10 @@ EffectInstance::getImagePlane(const GetImageInArgs& inArgs, GetImageOutArgs* out
     if (!supportsMultiPlane || outArgs->image->getLayer().isColorPlane()) {
         ImagePlaneDesc plane, pairedPlane;
         getMetadataComponents(inArgs.inputNb, &plane, &pairedPlane);
-        if (outArgs->image->getLayer() != plane) {
+        // An effect that is not multi-planar reads any plane as its color plane: if the image has as many components,
+        // the conversion would only rename the plane, so hand out the image as is.
+        if ( (outArgs->image->getLayer() != plane) &&
+             ( supportsMultiPlane || (outArgs->image->getComponentsCount() != plane.getNumComponents()) ) ) {
             mustConvertImage = true;
             preferredLayer = plane;
         }
@@ -994,7 +1084,6 @@ EffectInstance::getImagePlane(const GetImageInArgs& inArgs, GetImageOutArgs* out
 
     outArgs->roiPixel.intersect(outArgs->image->getBounds(), &outArgs->roiPixel);
 
-    ImagePtr convertedImage = outArgs->image;
     if (mustConvertImage) {
 
         Image::InitStorageArgs initArgs;
@@ -1012,11 +1101,6 @@ EffectInstance::getImagePlane(const GetImageInArgs& inArgs, GetImageOutArgs* out
 
         }
 
-        convertedImage = Image::create(initArgs);
-        if (!convertedImage) {
-            return false;
-        }
-
         // inputIsMask || supportsOnlyAlpha
         int channelForMask = - 1;
         ImagePlaneDesc maskComps;
@@ -1071,20 +1155,75 @@ EffectInstance::getImagePlane(const GetImageInArgs& inArgs, GetImageOutArgs* out
                 copyArgs.monoConversion = Image::eMonoToPackedConversionCopyToAll;
             }
         }
-        ActionRetCodeEnum stat = convertedImage->copyPixels(*outArgs->image, copyArgs);
-        if (isFailureRetCode(stat)) {
+
+        // The same input image is often fetched several times in a render in the same format, e.g. by each thread of
+        // the host frame threading or for each tile: convert it once. Textures belong to the OpenGL context
+        // of a render thread, so only the images in RAM are shared.
+        const bool memoizeConversion = preferredStorage == eStorageModeRAM;
+        U64 conversionHash = 0;
+        if (memoizeConversion) {
+            Hash64 hash;
+            hash.append( (int)initArgs.bitdepth );
+            hash.append( (int)initArgs.bufferFormat );
+            hash.append(copyArgs.conversionChannel);
+            hash.append( (int)copyArgs.alphaHandling );
+            hash.append( (int)copyArgs.monoConversion );
+            hash.append( (int)copyArgs.srcColorspace );
+            hash.append( (int)copyArgs.dstColorspace );
+            // The black borders are part of the converted image
+            hash.append(roiPixels.x1);
+            hash.append(roiPixels.y1);
+            hash.append(roiPixels.x2);
+            hash.append(roiPixels.y2);
+            hash.computeHash();
+            conversionHash = hash.value();
+
+            ImagePtr memoizedImage = currentRender->getMemoizedConvertedImage(outArgs->image, conversionHash, initArgs.bounds, initArgs.plane);
+            if (memoizedImage) {
+                outArgs->image = memoizedImage;
+                return true;
+            }
+        }
+
+        ImagePtr convertedImage = Image::create(initArgs);
+        if (!convertedImage) {
             return false;
         }
-        outArgs->image = convertedImage;
-    } // mustConvertImage
 
-    // If the effect does not support multi-resolution image, add black borders so that all images have the same size in input.
-    if (roiExpandPixels != roiPixels) {
-        ActionRetCodeEnum stat = outArgs->image->fillOutSideWithBlack(roiPixels);
+        // Moving the image between the RAM and an OpenGL texture is accounted for the adaptive backend selection
+        TimeLapse transferTimer;
+        ActionRetCodeEnum stat = convertedImage->copyPixels(*outArgs->image, copyArgs);
         if (isFailureRetCode(stat)) {
             return false;
         }
-    }
+        if (storage != preferredStorage) {
+            if ( (preferredStorage == eStorageModeGLTex || storage == eStorageModeGLTex) && appPTR->getCurrentSettings()->isAdaptiveRenderBackendEnabled() ) {
+                GL_GPU::Finish();
+            }
+            double timeSpent = transferTimer.getTimeSinceCreation();
+            std::size_t nBytes = (std::size_t)copyArgs.roi.area() * convertedImage->getComponentsCount() * getSizeOfForBitDepth( convertedImage->getBitDepth() );
+            getNode()->addTransferCost(timeSpent, nBytes);
+            RenderStatsPtr stats = currentRender->getStatsObject();
+            if (stats && stats->isInDepthProfilingEnabled()) {
+                stats->addTransferInfosForNode(getNode(), timeSpent);
+            }
+        }
+
+        // If the effect does not support multi-resolution image, add black borders so that all images have the same size in input.
+        // This always goes with a conversion since the image is extended to roiExpandPixels.
+        if (roiExpandPixels != roiPixels) {
+            stat = convertedImage->fillOutSideWithBlack(roiPixels);
+            if (isFailureRetCode(stat)) {
+                return false;
+            }
+        }
+
+        if (memoizeConversion) {
+            // If another thread converted the image in the meantime, use the same image
+            convertedImage = currentRender->setMemoizedConvertedImage(outArgs->image, conversionHash, initArgs.bounds, initArgs.plane, convertedImage);
+        }
+        outArgs->image = convertedImage;
+    } // mustConvertImage
 
   //  qDebug() << QThread::currentThread() << "input roi: " << outArgs->roiPixel.x1 << outArgs->roiPixel.y1 << outArgs->roiPixel.x2 << outArgs->roiPixel.y2;
 
@@ -1183,7 +1322,7 @@ EffectInstance::evaluate(bool isSignificant,
     }
 
     if (isSignificant) {
-        getApp()->triggerAutoSave();
+        getApp()->triggerAutoSave(node);
     }
 
     node->refreshIdentityState();
@@ -1253,6 +1392,12 @@ EffectInstance::createMemoryChunk(size_t nBytes)
 {
     PluginMemoryPtr mem = createPluginMemory();
     PluginMemAllocateMemoryArgs args(nBytes);
+    args.budgets.push_back( getNode()->getMemoryBudget() );
+    TreeRenderPtr render = getCurrentRender();
+    if (render) {
+        args.budgets.push_back( render->getMemoryBudget() );
+    }
+    args.cache = getNode()->getPluginMemoryCache();
     mem->allocateMemory(args);
     QMutexLocker k(&_imp->pluginMemoryChunksMutex);
     _imp->pluginMemoryChunks.push_back(mem);
@@ -1877,6 +2022,7 @@ EffectInstance::makeInfoForInput(int inputNumber)
                 break;
             case eImageBitDepthHalf:
                 depthStr = tr("16fp");
+                break;
             case eImageBitDepthNone:
                 break;
         }
@@ -2021,6 +2167,28 @@ EffectInstance::getViewVariance() const
     return getNode()->getPlugin()->getPropertyUnsafe<ViewInvarianceLevel>(kNatronPluginPropViewInvariant);
 }
 
+ViewInvarianceLevel
+EffectInstance::getViewVarianceForHash() const
+{
+    ViewInvarianceLevel level = getViewVariance();
+    if (level != eViewInvarianceAllViewsVariant) {
+        return level;
+    }
+    if ( isViewAware() || isReader() || isWriter() || isOutput() ) {
+        return level;
+    }
+    KnobsVec knobs = getKnobs_mt_safe();
+    for (KnobsVec::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        if ( !(*it)->getEvaluateOnChange() || !isKnobPartOfHash(*it) ) {
+            continue;
+        }
+        if ( (*it)->getViewsList().size() > 1 ) {
+            return level;
+        }
+    }
+    return eViewInvarianceAllViewsInvariant;
+}
+
 bool
 EffectInstance::isMultiPlanar() const
 {
@@ -2303,6 +2471,23 @@ EffectInstance::getCanTransform3x3() const
     return _imp->descriptionPtr->getPropertyUnsafe<bool>(kEffectPropSupportsCanReturn3x3Transform);
 }
 
+void
+EffectInstance::setCanColorTransform(bool support)
+{
+    QMutexLocker k(&_imp->common->pluginsPropMutex);
+    _imp->descriptionPtr->setProperty(kEffectPropSupportsCanReturnColorTransform, support);
+    if (!getMainInstance()) {
+        onPropertiesChanged(*_imp->descriptionPtr);
+    }
+}
+
+bool
+EffectInstance::getCanColorTransform() const
+{
+    // Don't need to lock, since the render instance has a local copy of the properties
+    return _imp->descriptionPtr->getPropertyUnsafe<bool>(kEffectPropSupportsCanReturnColorTransform);
+}
+
 void
 EffectInstance::onPropertiesChanged(const EffectDescription& /*description*/)
 {
@@ -168,6 +168,18 @@ NATRON_NAMESPACE_ENTER
 #define kNatronNodeKnobConvertToGroupButton "convertToGroup"
 #define kNatronNodeKnobConvertToGroupButtonLabel "Convert to Group"
 
+#define kNatronNodeKnobFreezeSubGraph "freezeSubGraph"
+#define kNatronNodeKnobFreezeSubGraphLabel "Freeze"
+#define kNatronNodeKnobFreezeSubGraphHint "When checked, the output of the node-graph is pre-rendered over its frame range and stored on disk in the cache directory. " \
+"While frozen, the node-graph and the nodes upstream are no longer rendered and the stored images are used instead, even if the node-graph is modified. " \
+"A warning is displayed on the node when the stored images are stale."
+
+#define kNatronNodeKnobUpdateFrozenSubGraph "updateFrozenSubGraph"
+#define kNatronNodeKnobUpdateFrozenSubGraphLabel "Update Freeze"
+#define kNatronNodeKnobUpdateFrozenSubGraphHint "Pre-renders again the output of the frozen node-graph with its current state."
+
+#define kNatronNodeKnobFrozenSubGraphHash "frozenSubGraphHash"
+
 #define kNatronNodeKnobPyPlugPluginID "pyPlugPluginID"
 #define kNatronNodeKnobPyPlugPluginIDLabel "PyPlug ID"
 #define kNatronNodeKnobPyPlugPluginIDHint "When exporting a group to PyPlug, this will be the plug-in ID of the PyPlug.\n" \
@@ -557,7 +569,7 @@ public:
     ActionRetCodeEnum dettachOpenGLContext_public(const OSGLContextPtr& glContext, const EffectOpenGLContextDataPtr& data);
 
     /**
-     * @brief Called for plug-ins that support concurrent OpenGL renders when the effect is about to be destroyed to release all contexts data.
+     * @brief Called when the effect is about to be destroyed to release all contexts data.
      **/
     void dettachAllOpenGLContexts();
 
@@ -670,6 +682,26 @@ protected:
                                             ViewIdx view,
                                             DistortionFunction2D* distortion) WARN_UNUSED_RETURN;
 
+public:
+
+    /**
+     * @brief For effects that can describe their output as a per-pixel color transform of one of their input
+     * (e.g: Grade, Multiply, Gamma, Clamp...), then they may flag so with the getCanColorTransform() function.
+     * In this case this function will be called prior to calling render. If possible, Natron will concatenate
+     * color transform effects and only the effect at the bottom will process the pixels, in a single pass.
+     * The effect must return eActionStatusReplyDefault if the transform does not apply over the whole image,
+     * e.g: if a mask is connected or the mix is not 1.
+     **/
+    ActionRetCodeEnum getColorTransform_public(TimeValue time,
+                                               ViewIdx view,
+                                               ColorTransform* transform) WARN_UNUSED_RETURN;
+
+protected:
+
+    virtual ActionRetCodeEnum getColorTransform(TimeValue time,
+                                                ViewIdx view,
+                                                ColorTransform* transform) WARN_UNUSED_RETURN;
+
 public:
 
     /**
@@ -959,6 +991,15 @@ public:
 
     bool invalidateHashCacheRecursive(const bool recurse, std::set<HashableObject*>* invalidatedObjects);
 
+    virtual std::string getHashProfilerName() const OVERRIDE;
+
+protected:
+
+    /**
+     * @brief Called by invalidateHashCacheRecursive() when the hash of this node was invalidated,
+     * before the nodes downstream are invalidated.
+     **/
+    virtual void onHashCacheInvalidated() {}
 
 public:
 
@@ -1103,7 +1144,8 @@ public:
         eAcceptedRequestConcatenationNone = 0x0,
         eAcceptedRequestConcatenationDeprecatedTransformMatrix = 0x1,
         eAcceptedRequestConcatenationDistortionFunc = 0x2,
-        eAcceptedRequestConcatenationPixelShader = 0x4
+        eAcceptedRequestConcatenationPixelShader = 0x4,
+        eAcceptedRequestConcatenationColorTransform = 0x8
     };
 
     DECLARE_FLAGS(AcceptedRequestConcatenationFlags, AcceptedRequestConcatenationEnum)
@@ -1145,8 +1187,11 @@ public:
      * @brief Function that actually render a request. In output, the image corresponding to the request
      * is rendered. Only a single thread will be able to call launchRender on the same frame view request.
      * This function must be called on the FrameViewRequest object returned by requestRender()
+     * @param allowPendingTilesRetCode If true, instead of waiting for tiles that are being rendered by another thread or process,
+     * this function returns eActionStatusPendingTiles once it rendered everything else. The request is then not finished
+     * and must be launched again once the pending tiles are rendered.
      **/
-    ActionRetCodeEnum launchNodeRender(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestData);
+    ActionRetCodeEnum launchNodeRender(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestData, bool allowPendingTilesRetCode);
 
     /**
      * @brief Convenience function for getCurrentRender()->isRenderAborted()
@@ -1173,6 +1218,15 @@ public:
     **/
     ViewInvarianceLevel getViewVariance() const;
 
+    /**
+     * @brief Same as getViewVariance() except that an effect that does not know about the views and whose parameters
+     * are not split by view is view invariant: its image only depends on the views through its inputs, whose hashes are
+     * part of the hash of the effect. The view is then not part of the hash, so that the views share the images
+     * in the cache when the inputs are view invariant too.
+     * Readers, writers and outputs are never considered invariant since they use the view outside of their parameters.
+     **/
+    ViewInvarianceLevel getViewVarianceForHash() const;
+
     /**
     * @brief Returns whether the effect implements getLayersNeededAndProduced and knows about planes
     **/
@@ -1315,6 +1369,13 @@ public:
     bool getCanTransform3x3() const;
     void setCanTransform3x3(bool enabled);
 
+    /**
+     * @brief If this function returns true, the plug-in implements the getColorTransform() action to let a chance to the host to concatenate
+     * per-pixel color effects.
+     **/
+    bool getCanColorTransform() const;
+    void setCanColorTransform(bool enabled);
+
     /**
      * @brief Set the properties of the effect locked. While locked the refreshDynamicProperties() function will not refresh them.
      * This is used by the RotoPaint node when drawing so that we can lock the render thread safety of nodes to instance safe.
@@ -1343,10 +1404,21 @@ protected:
     // Overriden from KnobHolder when creating a render clone
     virtual KnobHolderPtr createRenderCopy(const FrameViewRenderKey& key) const OVERRIDE;
 
+    // Overriden from KnobHolder to recycle the render clones across renders
+    virtual bool isRenderClonePoolingSupported() const OVERRIDE;
+    virtual void onRenderCloneReleased() OVERRIDE;
+    virtual void rebindRenderClone(const FrameViewRenderKey& key) OVERRIDE;
+
 
 private:
 
-    ActionRetCodeEnum launchRenderInternal(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestData);
+    /**
+     * @brief Freeze the state of the inputs of this main instance in the given render clone
+     * and create the input render clones for the given key.
+     **/
+    void fetchRenderCloneInputs(const EffectInstancePtr& clone, const FrameViewRenderKey& key) const;
+
+    ActionRetCodeEnum launchRenderInternal(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestData, bool allowPendingTilesRetCode);
 
 
 public:
@@ -1436,6 +1508,15 @@ public:
 
     virtual bool shouldCacheOutput(bool isFrameVaryingOrAnimated, int visitsCount) const;
 
+    /**
+     * @brief Returns a file in which the images rendered by this effect are also stored compressed, or NULL.
+     * The ImageCacheEntry reads the tiles missing from the cache from this file and writes the rendered tiles to it.
+     **/
+    virtual CompressedTileFilePtr getCompressedTileFile()
+    {
+        return CompressedTileFilePtr();
+    }
+
 
     /**
      * @brief Override to initialize the overlay interact. It is called only on the
@@ -1753,6 +1834,11 @@ public:
 
     void setForceCachingEnabled(bool b);
 
+    /**
+     * @brief Returns the value of the Memory Budget parameter in bytes, 0 if unlimited
+     **/
+    std::size_t getMemoryBudgetLimit() const;
+
     bool isKeepInAnimationModuleButtonDown() const;
 
     bool getHideInputsKnobValue() const;
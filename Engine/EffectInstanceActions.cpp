@@ -31,6 +31,7 @@
 
 #include "Engine/AppInstance.h"
 #include "Engine/Cache.h"
+#include "Engine/ColorTransform.h"
 #include "Engine/EffectInstanceActionResults.h"
 #include "Engine/EffectOpenGLContextData.h"
 #include "Engine/Format.h"
@@ -39,8 +40,12 @@
 #include "Engine/Hash64.h"
 #include "Engine/Node.h"
 #include "Engine/NodeMetadata.h"
+#include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
+#include "Engine/ReadNode.h"
+#include "Engine/RenderStats.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/TreeRender.h"
 
 
 NATRON_NAMESPACE_ENTER
@@ -483,6 +488,7 @@ EffectInstance::getLayersProducedAndNeeded_public(TimeValue inArgsTime, ViewIdx
 
     GetComponentsKeyPtr cacheKey;
     cacheKey = boost::make_shared<GetComponentsKey>(hash,  getNode()->getPluginID());
+    cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
 
 
     *results = GetComponentsResults::create(cacheKey);
@@ -519,6 +525,7 @@ EffectInstance::getLayersProducedAndNeeded_public(TimeValue inArgsTime, ViewIdx
     std::bitset<4> processChannels;
     bool processAllRequested = false;
     {
+        RenderStatsActionTimer_RAII actionTimer(this, eRenderStatsActionGetComponents);
         ActionRetCodeEnum stat = getComponentsNeededInternal(time, view, &inputLayersNeeded, &outputLayersProduced, &passThroughPlanes, &passThroughTime, &passThroughView, &passThroughInputNb, &processAllRequested, &processChannels);
         if (isFailureRetCode(stat)) {
             return stat;
@@ -540,16 +547,15 @@ EffectInstance::attachOpenGLContext_public(TimeValue time, ViewIdx view, const R
                                            const OSGLContextPtr& glContext,
                                            EffectOpenGLContextDataPtr* data)
 {
+    QMutexLocker locker(&_imp->common->attachedContextsMutex);
 
-    // Does this effect support concurrent OpenGL renders ?
-    // If so, we just have to lock the attachedContexts map.
-    // If not, we have to take the lock now and release it in dettachOpenGLContext_public
-    bool concurrentGLRender = supportsConcurrentOpenGLRenders();
-    boost::scoped_ptr<QMutexLocker> locker;
-    if (concurrentGLRender) {
-        locker.reset( new QMutexLocker(&_imp->common->attachedContextsMutex) );
-    } else {
-        _imp->common->attachedContextsMutex.lock();
+    // The data of destroyed contexts cannot be detached anymore: their resources were released with the context
+    for (std::map<OSGLContextWPtr, EffectOpenGLContextDataPtr>::iterator it = _imp->common->attachedContexts.begin(); it != _imp->common->attachedContexts.end();) {
+        if ( it->first.expired() ) {
+            _imp->common->attachedContexts.erase(it++);
+        } else {
+            ++it;
+        }
     }
 
     std::map<OSGLContextWPtr, EffectOpenGLContextDataPtr>::iterator found = _imp->common->attachedContexts.find(glContext);
@@ -560,6 +566,20 @@ EffectInstance::attachOpenGLContext_public(TimeValue time, ViewIdx view, const R
         return eActionStatusOK;
     }
 
+    // Plug-ins that do not support concurrent OpenGL renders may only have a single attached context.
+    // Their renders are serialized by the caller, hence the other contexts are not in use.
+    if ( !supportsConcurrentOpenGLRenders() && !_imp->common->attachedContexts.empty() ) {
+        OSGLContextSaver saveCurrentContext;
+        for (std::map<OSGLContextWPtr, EffectOpenGLContextDataPtr>::iterator it = _imp->common->attachedContexts.begin(); it != _imp->common->attachedContexts.end(); ++it) {
+            OSGLContextPtr context = it->first.lock();
+            assert(context);
+            OSGLContextAttacherPtr attacher = OSGLContextAttacher::create(context);
+            attacher->attach();
+            dettachOpenGLContext(context, it->second);
+        }
+        _imp->common->attachedContexts.clear();
+    }
+
     const bool renderScaleSupported = supportsRenderScale();
     const RenderScale mappedScale = renderScaleSupported ? scale : RenderScale(1.);
 
@@ -567,17 +587,9 @@ EffectInstance::attachOpenGLContext_public(TimeValue time, ViewIdx view, const R
     ActionRetCodeEnum stat = attachOpenGLContext(time, view, mappedScale, glContext, data);
 
     if (!isFailureRetCode(stat)) {
-        if (!concurrentGLRender) {
-            (*data)->setHasTakenLock(true);
-        }
         _imp->common->attachedContexts.insert( std::make_pair(glContext, *data) );
-    } else {
-        if (!concurrentGLRender) {
-            _imp->common->attachedContextsMutex.unlock();
-        }
     }
 
-    // Take the lock until dettach is called for plug-ins that do not support concurrent GL renders
     return stat;
 
 } // attachOpenGLContext_public
@@ -627,26 +639,14 @@ EffectInstance::dettachOpenGLContext(const OSGLContextPtr& /*glContext*/, const
 ActionRetCodeEnum
 EffectInstance::dettachOpenGLContext_public(const OSGLContextPtr& glContext, const EffectOpenGLContextDataPtr& data)
 {
+    QMutexLocker locker(&_imp->common->attachedContextsMutex);
 
-    bool concurrentGLRender = supportsConcurrentOpenGLRenders();
-    boost::scoped_ptr<QMutexLocker> locker;
-    if (concurrentGLRender) {
-        locker.reset( new QMutexLocker(&_imp->common->attachedContextsMutex) );
-    }
-
-
-    bool mustUnlock = data->getHasTakenLock();
     std::map<OSGLContextWPtr, EffectOpenGLContextDataPtr>::iterator found = _imp->common->attachedContexts.find(glContext);
     if ( found != _imp->common->attachedContexts.end() ) {
         _imp->common->attachedContexts.erase(found);
     }
 
-    ActionRetCodeEnum ret = dettachOpenGLContext(glContext, data);
-    if (mustUnlock) {
-        _imp->common->attachedContextsMutex.unlock();
-    }
-    
-    return ret;
+    return dettachOpenGLContext(glContext, data);
 
 } // dettachOpenGLContext_public
 
@@ -700,7 +700,16 @@ EffectInstance::render_public(const RenderActionArgs & args)
     // Each render clone should hold the time and view passed to the render action
     assert(args.time == getCurrentRenderTime());
     assert(args.view == getCurrentRenderView());
-    
+
+    // Let the Read node read the files of the next frames while this one is decoded
+    if ( isReader() ) {
+        NodePtr container = getNode()->getIOContainer();
+        ReadNodePtr readNode = container ? toReadNode( container->getEffectInstance() ) : ReadNodePtr();
+        if (readNode) {
+            readNode->readAheadFromFrame(args.time, args.view);
+        }
+    }
+
     return render(args);
 
 } // render_public
@@ -778,6 +787,11 @@ EffectInstance::getInverseDistortion_public(TimeValue inArgsTime,
     const bool renderScaleSupported = supportsRenderScale();
     const RenderScale mappedScale = renderScaleSupported ? renderScale : RenderScale(1.);
 
+    // Look-up the results of this render first
+    *results = _imp->getInverseDistortionResults(time, view, renderScale, draftRender);
+    if (*results) {
+        return eActionStatusOK;
+    }
 
     bool isDeprecatedTransformSupportEnabled = getCanTransform3x3();
     bool distortSupported = getCanDistort();
@@ -813,6 +827,7 @@ EffectInstance::getInverseDistortion_public(TimeValue inArgsTime,
         // Do not cache the results
         (*results) = GetDistortionResults::create(GetDistortionKeyPtr());
         (*results)->setResults(disto);
+        _imp->setInverseDistortionResults(time, view, renderScale, draftRender, *results);
     } else {
 
         U64 hash;
@@ -829,6 +844,7 @@ EffectInstance::getInverseDistortion_public(TimeValue inArgsTime,
         GetDistortionKeyPtr cacheKey;
         {
             cacheKey = boost::make_shared<GetDistortionKey>(hash, renderScale, getNode()->getPluginID());
+            cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
         }
 
 
@@ -849,6 +865,7 @@ EffectInstance::getInverseDistortion_public(TimeValue inArgsTime,
                 if (!cacheAccess->isPersistent()) {
                     *results = toGetDistortionResults(cacheAccess->getProcessLocalEntry());
                 }
+                _imp->setInverseDistortionResults(time, view, renderScale, draftRender, *results);
                 return eActionStatusOK;
             }
 
@@ -871,11 +888,52 @@ EffectInstance::getInverseDistortion_public(TimeValue inArgsTime,
         }
 
         cacheAccess->insertInCache();
+        if (stat == eActionStatusOK) {
+            _imp->setInverseDistortionResults(time, view, renderScale, draftRender, *results);
+        }
     }
     
     return stat;
 } // getDistortion_public
 
+ActionRetCodeEnum
+EffectInstance::getColorTransform(TimeValue /*time*/,
+                                  ViewIdx /*view*/,
+                                  ColorTransform* /*transform*/)
+{
+    return eActionStatusReplyDefault;
+}
+
+ActionRetCodeEnum
+EffectInstance::getColorTransform_public(TimeValue inArgsTime,
+                                         ViewIdx view,
+                                         ColorTransform* transform)
+{
+    assert(transform);
+
+    if (!getCanColorTransform()) {
+        return eActionStatusReplyDefault;
+    }
+
+    TimeValue time = inArgsTime;
+    {
+        int roundedTime = std::floor(time + 0.5);
+        if (roundedTime != time && !canRenderContinuously()) {
+            time = TimeValue(roundedTime);
+        }
+    }
+
+    // The results are not cached: the action is cheap and only called once per FrameViewRequest
+    ActionRetCodeEnum stat = getColorTransform(time, view, transform);
+    if (isFailureRetCode(stat)) {
+        return stat;
+    }
+    if (stat != eActionStatusReplyDefault && transform->inputNbToTransform == -1) {
+        return eActionStatusReplyDefault;
+    }
+    return stat;
+} // getColorTransform_public
+
 ActionRetCodeEnum
 EffectInstance::isIdentity(TimeValue /*time*/,
                            const RenderScale & /*scale*/,
@@ -892,6 +950,31 @@ EffectInstance::isIdentity(TimeValue /*time*/,
 }
 
 
+/**
+ * @brief Returns the render of the effect if the results of actions called on a rectangle of the image
+ * can be memoized for this render, see TreeRender::getMemoizedRegionsOfInterest().
+ * The hash must already be cached: these actions are also called while computing the hash.
+ **/
+static TreeRenderPtr
+getRenderForMemoizedActions(const EffectInstance* effect,
+                            TimeValue time,
+                            ViewIdx view,
+                            U64* hash)
+{
+    TreeRenderPtr render = effect->getCurrentRender();
+    if (!render) {
+        return render;
+    }
+    HashableObject::FindHashArgs findArgs;
+    findArgs.time = time;
+    findArgs.view = view;
+    findArgs.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+    if ( !effect->findCachedHash(findArgs, hash) || (*hash == 0) ) {
+        return TreeRenderPtr();
+    }
+    return render;
+} // getRenderForMemoizedActions
+
 ActionRetCodeEnum
 EffectInstance::isIdentity_public(bool useIdentityCache, // only set to true when calling for the whole image (not for a subrect)
                                   TimeValue time,
@@ -934,11 +1017,27 @@ EffectInstance::isIdentity_public(bool useIdentityCache, // only set to true whe
     IsIdentityKeyPtr cacheKey;
     {
         cacheKey = boost::make_shared<IsIdentityKey>(hash, time, plane ? *plane : ImagePlaneDesc::getNoneComponents(), getNode()->getPluginID());
+        cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
     }
 
 
     *results = IsIdentityResults::create(cacheKey);
 
+    // Sub-rectangles are not cached, but the same rectangles are queried by the requests of the render
+    TreeRenderPtr memoizingRender;
+    U64 memoizedHash = 0;
+    const ImagePlaneDesc& memoizedPlane = plane ? *plane : ImagePlaneDesc::getNoneComponents();
+    if (!useIdentityCache) {
+        memoizingRender = getRenderForMemoizedActions(this, time, view, &memoizedHash);
+        if (memoizingRender) {
+            IsIdentityResultsPtr memoizedResults = memoizingRender->getMemoizedIdentity(memoizedHash, time, view, scale, renderWindow, memoizedPlane);
+            if (memoizedResults) {
+                *results = memoizedResults;
+                return eActionStatusOK;
+            }
+        }
+    }
+
     CacheEntryLockerBasePtr cacheAccess;
     if (useIdentityCache) {
 
@@ -986,7 +1085,11 @@ EffectInstance::isIdentity_public(bool useIdentityCache, // only set to true whe
             canonicalRenderWindow.toPixelEnclosing(mappedScale, par, &mappedRenderWindow);
         }
 
-        ActionRetCodeEnum stat = isIdentity(time, mappedScale, mappedRenderWindow, view, inputPlane, &identityTime, &identityView, &identityInputNb, &identityPlane);
+        ActionRetCodeEnum stat;
+        {
+            RenderStatsActionTimer_RAII actionTimer(this, eRenderStatsActionIsIdentity);
+            stat = isIdentity(time, mappedScale, mappedRenderWindow, view, inputPlane, &identityTime, &identityView, &identityInputNb, &identityPlane);
+        }
         if (isFailureRetCode(stat)) {
             return stat;
         }
@@ -1035,6 +1138,9 @@ EffectInstance::isIdentity_public(bool useIdentityCache, // only set to true whe
     if (cacheAccess) {
         cacheAccess->insertInCache();
     }
+    if (memoizingRender) {
+        memoizingRender->setMemoizedIdentity(memoizedHash, time, view, scale, renderWindow, memoizedPlane, *results);
+    }
     return eActionStatusOK;
 } // isIdentity_public
 
@@ -1056,7 +1162,11 @@ EffectInstance::getRegionOfDefinition_public(TimeValue inArgsTime,
     const bool renderScaleSupported = supportsRenderScale();
     const RenderScale mappedScale = renderScaleSupported ? scale : RenderScale(1.);
 
-
+    // Look-up the results of this render first
+    *results = _imp->getRegionOfDefinitionResults(time, view, mappedScale);
+    if (*results) {
+        return eActionStatusOK;
+    }
 
     U64 hash = 0;
     // Get a hash to cache the results
@@ -1070,6 +1180,7 @@ EffectInstance::getRegionOfDefinition_public(TimeValue inArgsTime,
 
     GetRegionOfDefinitionKeyPtr cacheKey;
     cacheKey = boost::make_shared<GetRegionOfDefinitionKey>(hash, mappedScale, getNode()->getPluginID());
+    cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
 
 
     *results = GetRegionOfDefinitionResults::create(cacheKey);
@@ -1088,6 +1199,7 @@ EffectInstance::getRegionOfDefinition_public(TimeValue inArgsTime,
             if (!cacheAccess->isPersistent()) {
                 *results = toGetRegionOfDefinitionResults(cacheAccess->getProcessLocalEntry());
             }
+            _imp->setRegionOfDefinitionResults(time, view, mappedScale, *results);
             return eActionStatusOK;
         }
         assert(cacheStatus == CacheEntryLockerBase::eCacheEntryStatusMustCompute);
@@ -1149,7 +1261,11 @@ EffectInstance::getRegionOfDefinition_public(TimeValue inArgsTime,
 
 
             RectD rod;
-            ActionRetCodeEnum stat = getRegionOfDefinition(time, mappedScale, view, &rod);
+            ActionRetCodeEnum stat;
+            {
+                RenderStatsActionTimer_RAII actionTimer(this, eRenderStatsActionGetRegionOfDefinition);
+                stat = getRegionOfDefinition(time, mappedScale, view, &rod);
+            }
 
             if (isFailureRetCode(stat)) {
                 return stat;
@@ -1165,6 +1281,7 @@ EffectInstance::getRegionOfDefinition_public(TimeValue inArgsTime,
     if (cacheAccess) {
         cacheAccess->insertInCache();
     }
+    _imp->setRegionOfDefinitionResults(time, view, mappedScale, *results);
     
     return eActionStatusOK;
     
@@ -1362,6 +1479,17 @@ EffectInstance::getRegionsOfInterest_public(TimeValue inArgsTime,
 
     assert(renderWindow.x2 >= renderWindow.x1 && renderWindow.y2 >= renderWindow.y1);
 
+    // The regions of interest are queried for each rectangle rendered, only call the plug-in once per rectangle for the render
+    U64 memoizedHash = 0;
+    TreeRenderPtr memoizingRender = getRenderForMemoizedActions(this, time, view, &memoizedHash);
+    if (memoizingRender) {
+        RoIMap memoizedResults;
+        if ( memoizingRender->getMemoizedRegionsOfInterest(memoizedHash, time, view, scale, renderWindow, &memoizedResults) ) {
+            ret->insert( memoizedResults.begin(), memoizedResults.end() );
+            return eActionStatusOK;
+        }
+    }
+
     int nInputs = getNInputs();
     for (int i = 0; i < nInputs; ++i) {
         if (!getNode()->isInputHostDescribed(i)) {
@@ -1378,7 +1506,11 @@ EffectInstance::getRegionsOfInterest_public(TimeValue inArgsTime,
         }
     }
 
-    return getRegionsOfInterest(time, mappedScale, renderWindow, view, ret);
+    ActionRetCodeEnum stat = getRegionsOfInterest(time, mappedScale, renderWindow, view, ret);
+    if (memoizingRender && !isFailureRetCode(stat)) {
+        memoizingRender->setMemoizedRegionsOfInterest(memoizedHash, time, view, scale, renderWindow, *ret);
+    }
+    return stat;
 
 } // getRegionsOfInterest_public
 
@@ -1465,6 +1597,7 @@ EffectInstance::getFramesNeeded_public(TimeValue inArgsTime,
 
     GetFramesNeededKeyPtr cacheKey;
     cacheKey = boost::make_shared<GetFramesNeededKey>(hash, getNode()->getPluginID());
+    cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
 
     *results = GetFramesNeededResults::create(cacheKey);
 
@@ -1521,7 +1654,11 @@ EffectInstance::getFramesNeeded_public(TimeValue inArgsTime,
         }
 
 
-        ActionRetCodeEnum stat = getFramesNeeded(time, view, &framesNeeded);
+        ActionRetCodeEnum stat;
+        {
+            RenderStatsActionTimer_RAII actionTimer(this, eRenderStatsActionGetFramesNeeded);
+            stat = getFramesNeeded(time, view, &framesNeeded);
+        }
         if (isFailureRetCode(stat)) {
             return stat;
         }
@@ -1571,6 +1708,7 @@ EffectInstance::getFramesNeeded_public(TimeValue inArgsTime,
 
     if (!cacheKey) {
         cacheKey = boost::make_shared<GetFramesNeededKey>(0,  getNode()->getPluginID());
+        cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
 
     }
     
@@ -1648,6 +1786,7 @@ EffectInstance::getFrameRange_public(GetFrameRangeResultsPtr* results)
     }
 
     GetFrameRangeKeyPtr cacheKey = boost::make_shared<GetFrameRangeKey>(hash, getNode()->getPluginID());
+    cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
     *results = GetFrameRangeResults::create(cacheKey);
 
     CacheEntryLockerBasePtr cacheAccess = (*results)->getFromCache();
@@ -1859,8 +1998,8 @@ EffectInstance::onMetadataChanged_recursive(std::set<NodePtr>* markedNodes)
     // Can only be called on the main thread
     assert(QThread::currentThread() == qApp->thread());
 
-    if (getApp()->isCreatingNode() || getApp()->getProject()->isLoadingProject()) {
-        // Never do a recursive downstream pass to refresh metadata when creating a node or loading a project.
+    if (getApp()->isCreatingNode() || getApp()->isCreatingNodesBatch() || getApp()->getProject()->isLoadingProject()) {
+        // Never do a recursive downstream pass to refresh metadata when creating nodes or loading a project.
         // Let the NodeCollection::createNodesFromSerialization function do it once for each nodes.
         return;
     }
@@ -1947,6 +2086,7 @@ EffectInstance::getTimeInvariantMetadata_public(GetTimeInvariantMetadataResultsP
     }
 
     GetTimeInvariantMetadataKeyPtr cacheKey = boost::make_shared<GetTimeInvariantMetadataKey>(hash, getNode()->getPluginID());
+    cacheKey->setStatsHolderID(getNode()->getCacheStatsHolderID());
     *results = GetTimeInvariantMetadataResults::create(cacheKey);
     NodeMetadataPtr metadata = boost::make_shared<NodeMetadata>();
     (*results)->setMetadataResults(metadata);
@@ -2001,7 +2141,11 @@ EffectInstance::getTimeInvariantMetadata_public(GetTimeInvariantMetadataResultsP
 
         // If the node is disabled, don't call getClipPreferences on the plug-in:
         // we don't want it to change output Format or other metadata
-        ActionRetCodeEnum stat = getTimeInvariantMetadata(*metadata);
+        ActionRetCodeEnum stat;
+        {
+            RenderStatsActionTimer_RAII actionTimer(this, eRenderStatsActionGetTimeInvariantMetadata);
+            stat = getTimeInvariantMetadata(*metadata);
+        }
         if (isFailureRetCode(stat)) {
             return stat;
         }
@@ -2365,6 +2509,9 @@ EffectInstance::purgeCaches_public()
 {
 
     purgeCaches();
+
+    // Give back the scratch memory kept for the plug-in
+    getNode()->getPluginMemoryCache()->clear();
 }
 
 void
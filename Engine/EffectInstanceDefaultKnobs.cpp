@@ -314,6 +314,24 @@ EffectInstance::createNodePage(const KnobPagePtr& settingsPage)
         _imp->defKnobs->forceCaching = param;
     }
 
+    {
+        KnobIntPtr param = createKnob<KnobInt>("memoryBudgetMb");
+        param->setLabel(tr("Memory Budget (MiB)"));
+        param->setKnobDeclarationType(KnobI::eKnobDeclarationTypeHost);
+        param->setDefaultValue(0);
+        param->setRange(0, INT_MAX);
+        param->disableSlider();
+        param->setAnimationEnabled(false);
+        param->setIsPersistent(true);
+        param->setEvaluateOnChange(false);
+        param->setHintToolTip( tr("The amount of RAM (in MiB) that the images allocated by the renders of this node may use. "
+                                  "When this budget is exceeded, this node renders one image at a time instead of concurrently. "
+                                  "Set to 0 to disable.") );
+        settingsPage->addKnob(param);
+
+        _imp->defKnobs->memoryBudgetMb = param;
+    }
+
     {
         KnobBoolPtr param = createKnob<KnobBool>(kEnablePreviewKnobName);
         param->setLabel(tr("Preview"));
@@ -975,6 +993,18 @@ EffectInstance::isForceCachingEnabled() const
     return b ? b->getValue() : false;
 }
 
+std::size_t
+EffectInstance::getMemoryBudgetLimit() const
+{
+    KnobIntPtr k = _imp->defKnobs->memoryBudgetMb.lock();
+    if (!k) {
+        return 0;
+    }
+    std::size_t kb = 1024;
+    std::size_t mb = kb * kb;
+    return (std::size_t)std::max(0, k->getValue()) * mb;
+}
+
 void
 EffectInstance::setForceCachingEnabled(bool value)
 {
@@ -1380,6 +1410,38 @@ EffectInstance::initializeDefaultKnobs(bool loadingSerialization, bool /*hasGUI*
     if (!isGrpNode && !isBackdropNode) {
         createInfoPage();
     } else if (isGrpNode) {
+        if (isGrpNode->isSubGraphFreezeSupported()) {
+            {
+                KnobBoolPtr param = createKnob<KnobBool>(kNatronNodeKnobFreezeSubGraph);
+                param->setLabel(tr(kNatronNodeKnobFreezeSubGraphLabel));
+                param->setHintToolTip( tr(kNatronNodeKnobFreezeSubGraphHint) );
+                param->setKnobDeclarationType(KnobI::eKnobDeclarationTypeHost);
+                param->setAnimationEnabled(false);
+                param->setAddNewLine(false);
+                param->setDefaultValue(false);
+                settingsPage->addKnob(param);
+                _imp->defKnobs->freezeSubGraphKnob = param;
+            }
+            {
+                KnobButtonPtr param = createKnob<KnobButton>(kNatronNodeKnobUpdateFrozenSubGraph);
+                param->setLabel(tr(kNatronNodeKnobUpdateFrozenSubGraphLabel));
+                param->setHintToolTip( tr(kNatronNodeKnobUpdateFrozenSubGraphHint) );
+                param->setKnobDeclarationType(KnobI::eKnobDeclarationTypeHost);
+                param->setEvaluateOnChange(false);
+                settingsPage->addKnob(param);
+                _imp->defKnobs->updateFrozenSubGraphKnob = param;
+            }
+            {
+                // The hash of the node-graph when it was frozen, this identifies the stored images
+                KnobStringPtr param = createKnob<KnobString>(kNatronNodeKnobFrozenSubGraphHash);
+                param->setKnobDeclarationType(KnobI::eKnobDeclarationTypeHost);
+                param->setAnimationEnabled(false);
+                param->setEvaluateOnChange(false);
+                param->setSecret(true);
+                settingsPage->addKnob(param);
+                _imp->defKnobs->frozenSubGraphHashKnob = param;
+            }
+        }
         if (isGrpNode->isSubGraphPersistent()) {
             createPyPlugPage();
             {
@@ -1660,6 +1722,13 @@ EffectInstance::handleDefaultKnobChanged(const KnobIPtr& what, ValueChangedReaso
         if (isGroup) {
             isGroup->setSubGraphEditedByUser(true);
         }
+    } else if (what == _imp->defKnobs->freezeSubGraphKnob.lock() || what == _imp->defKnobs->updateFrozenSubGraphKnob.lock()) {
+        NodeGroup* isGroup = dynamic_cast<NodeGroup*>(this);
+        if (isGroup) {
+            // Only pre-render when the user or a script asks for it, not when the project is loaded
+            bool preRender = reason == eValueChangedReasonUserEdited || reason == eValueChangedReasonPluginEdited;
+            isGroup->onFreezeSubGraphChanged(preRender);
+        }
     } else if (what == _imp->defKnobs->pyPlugExportButtonKnob.lock() && reason == eValueChangedReasonUserEdited) {
         try {
             getNode()->exportNodeToPyPlug(_imp->defKnobs->pyPlugExportDialogFile.lock()->getValue());
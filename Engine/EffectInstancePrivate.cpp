@@ -28,9 +28,14 @@
 #include <cassert>
 #include <stdexcept>
 #include <bitset>
+#include <algorithm> // min, max
 #include <QDebug>
 
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/FrameViewRequest.h"
+#include "Engine/GPUImageCache.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
 #include "Engine/OSGLContext.h"
@@ -42,6 +47,7 @@
 #include "Engine/TreeRender.h"
 #include "Engine/RenderStats.h"
 #include "Engine/RotoStrokeItem.h"
+#include "Engine/Settings.h"
 #include "Engine/ViewIdx.h"
 
 #define kNatronPersistentWarningCheckForNan "NatronPersistentWarningCheckForNan"
@@ -124,6 +130,77 @@ EffectInstance::Implementation::getTimeInvariantMetadataResults() const
     return renderData->metadataResults;
 }
 
+static RenderCloneActionKey
+makeRenderCloneActionKey(TimeValue time, ViewIdx view, const RenderScale& scale, bool draft)
+{
+    RenderCloneActionKey key;
+    key.time = time;
+    key.view = view;
+    key.scale = scale;
+    key.draft = draft;
+    return key;
+}
+
+void
+EffectInstance::Implementation::setRegionOfDefinitionResults(TimeValue time,
+                                                             ViewIdx view,
+                                                             const RenderScale& scale,
+                                                             const GetRegionOfDefinitionResultsPtr& results)
+{
+    if (!renderData) {
+        return;
+    }
+    QMutexLocker k(&renderData->lock);
+    renderData->rodResults[makeRenderCloneActionKey(time, view, scale, false)] = results;
+}
+
+GetRegionOfDefinitionResultsPtr
+EffectInstance::Implementation::getRegionOfDefinitionResults(TimeValue time,
+                                                             ViewIdx view,
+                                                             const RenderScale& scale) const
+{
+    if (!renderData) {
+        return GetRegionOfDefinitionResultsPtr();
+    }
+    QMutexLocker k(&renderData->lock);
+    RegionOfDefinitionResultsMap::const_iterator found = renderData->rodResults.find(makeRenderCloneActionKey(time, view, scale, false));
+    if ( found == renderData->rodResults.end() ) {
+        return GetRegionOfDefinitionResultsPtr();
+    }
+    return found->second;
+}
+
+void
+EffectInstance::Implementation::setInverseDistortionResults(TimeValue time,
+                                                            ViewIdx view,
+                                                            const RenderScale& scale,
+                                                            bool draft,
+                                                            const GetDistortionResultsPtr& results)
+{
+    if (!renderData) {
+        return;
+    }
+    QMutexLocker k(&renderData->lock);
+    renderData->distortionResults[makeRenderCloneActionKey(time, view, scale, draft)] = results;
+}
+
+GetDistortionResultsPtr
+EffectInstance::Implementation::getInverseDistortionResults(TimeValue time,
+                                                            ViewIdx view,
+                                                            const RenderScale& scale,
+                                                            bool draft) const
+{
+    if (!renderData) {
+        return GetDistortionResultsPtr();
+    }
+    QMutexLocker k(&renderData->lock);
+    DistortionResultsMap::const_iterator found = renderData->distortionResults.find(makeRenderCloneActionKey(time, view, scale, draft));
+    if ( found == renderData->distortionResults.end() ) {
+        return GetDistortionResultsPtr();
+    }
+    return found->second;
+}
+
 
 RenderScale
 EffectInstance::getCombinedScale(unsigned int mipMapLevel, const RenderScale& proxyScale)
@@ -153,34 +230,60 @@ EffectInstance::Implementation::resolveRenderBackend(const TreeRenderExecutionDa
 
         *renderBackend = eRenderBackendTypeOpenGL;
 
+        // OpenGL renders are not cached in the tile cache: keep the texture in the GPU image cache.
+        // If the effect renders at full scale, the texture is downscaled on the GPU and cached at the requested scale.
+        if ( (*cachePolicy != eCacheAccessModeNone) && GPUImageCache::isGPUImageCacheEnabled() ) {
+            requestPassData->setGPUImageCacheEnabled(true);
+        }
+
         // If the plug-in knows how to render on CPU, check if we should actually render on CPU instead.
         if (openGLSupport == ePluginOpenGLRenderSupportNeeded) {
             // We do not want to cache OpenGL renders
             if (*cachePolicy != eCacheAccessModeNone) {
                 *cachePolicy = eCacheAccessModeNone;
             }
+
+            // The plug-in cannot render on the CPU: split images that do not fit in a texture in tiles
+            resolveOpenGLRenderTileSize(requestPassData, glGpuContext, roi);
         } else if (openGLSupport == ePluginOpenGLRenderSupportYes) {
 
-            // We do not want to cache OpenGL renders, so fallback on CPU.
-            if (*cachePolicy != eCacheAccessModeNone) {
+            // We do not want to cache OpenGL renders in the tile cache, so fallback on CPU.
+            if (*cachePolicy != eCacheAccessModeNone && !requestPassData->isGPUImageCacheEnabled()) {
                 *renderBackend = eRenderBackendTypeCPU;
             }
 
             // If this image is requested multiple times , do not render it on OpenGL since we do not use the cache.
-            if (*renderBackend == eRenderBackendTypeOpenGL) {
+            if (*renderBackend == eRenderBackendTypeOpenGL && !requestPassData->isGPUImageCacheEnabled()) {
                 if (requestPassData->getNumListeners(requestPassSharedData) > 1) {
                     *renderBackend = eRenderBackendTypeCPU;
                 }
             }
 
-            // Ensure that the texture will be at least smaller than the maximum OpenGL texture size
+            // If the texture would be larger than the maximum OpenGL texture size or exceed the VRAM of the context, render in tiles.
+            // Fallback on CPU rendering if even a tile does not fit.
             if (*renderBackend == eRenderBackendTypeOpenGL) {
-                if ( (roi.width() >= glGpuContext->getMaxOpenGLWidth()) ||
-                    ( roi.height() >= glGpuContext->getMaxOpenGLHeight()) ) {
-                    // Fallback on CPU rendering since the image is larger than the maximum allowed OpenGL texture size
+                if ( !resolveOpenGLRenderTileSize(requestPassData, glGpuContext, roi) ) {
                     *renderBackend = eRenderBackendTypeCPU;
                 }
             }
+
+            // Some plug-ins are slower on the GPU for small images because of the transfers: let the timings decide
+            if (*renderBackend == eRenderBackendTypeOpenGL && appPTR->getCurrentSettings()->isAdaptiveRenderBackendEnabled()) {
+                *renderBackend = chooseRenderBackendFromTimings(requestPassSharedData, requestPassData, roi);
+            }
+
+            if (*renderBackend != eRenderBackendTypeOpenGL) {
+                requestPassData->setOpenGLRenderTileSize(0);
+            }
+
+            if (requestPassData->isGPUImageCacheEnabled()) {
+                if ( (*renderBackend == eRenderBackendTypeOpenGL) && (requestPassData->getOpenGLRenderTileSize() == 0) ) {
+                    *cachePolicy = eCacheAccessModeNone;
+                } else {
+                    // Rendered on the CPU or in tiles: the output image is in RAM, cached in the tile cache
+                    requestPassData->setGPUImageCacheEnabled(false);
+                }
+            }
         }
 
     } // canDoOpenGLRendering
@@ -205,6 +308,122 @@ EffectInstance::Implementation::resolveRenderBackend(const TreeRenderExecutionDa
     return eActionStatusOK;
 } // resolveRenderBackend
 
+bool
+EffectInstance::Implementation::resolveOpenGLRenderTileSize(const FrameViewRequestPtr& requestPassData,
+                                                           const OSGLContextPtr& glContext,
+                                                           const RectI& roi)
+{
+    requestPassData->setOpenGLRenderTileSize(0);
+
+    // OpenGL textures are always RGBA float
+    const std::size_t bytesPerPixel = 4 * sizeof(float);
+
+    // Only the output texture is known at this point, the textures of the inputs were allocated when they rendered.
+    if ( (roi.width() < glContext->getMaxOpenGLWidth()) &&
+         (roi.height() < glContext->getMaxOpenGLHeight()) &&
+         glContext->reserveVideoMemory( (std::size_t)roi.area() * bytesPerPixel ) ) {
+        return true;
+    }
+
+    // The tiles of the OpenGL render are aligned on the tiles of the cache so that the cache tiles are rendered once
+    int tileWidth, tileHeight;
+    appPTR->getTileCache()->getTileSizePx(_publicInterface->getBitDepth(-1), &tileWidth, &tileHeight);
+    const int cacheTileSize = std::max(tileWidth, tileHeight);
+
+    int tileSize = std::min(glContext->getMaxOpenGLWidth(), glContext->getMaxOpenGLHeight()) - 1;
+
+    // While rendering a tile, the context holds the output texture and the textures of the inputs for this tile
+    const std::size_t nTexturesPerTile = (std::size_t)_publicInterface->getNInputs() + 1;
+    const std::size_t videoMemoryBudget = glContext->getVideoMemoryBudget();
+    if (videoMemoryBudget > 0) {
+        while ( (tileSize > cacheTileSize) && ( (std::size_t)tileSize * tileSize * bytesPerPixel * nTexturesPerTile > videoMemoryBudget ) ) {
+            tileSize /= 2;
+        }
+    }
+    tileSize = std::max(cacheTileSize, (tileSize / cacheTileSize) * cacheTileSize);
+    if ( (tileSize >= glContext->getMaxOpenGLWidth()) || (tileSize >= glContext->getMaxOpenGLHeight()) ) {
+        return false;
+    }
+    if ( !glContext->reserveVideoMemory( (std::size_t)tileSize * tileSize * bytesPerPixel ) ) {
+        return false;
+    }
+    requestPassData->setOpenGLRenderTileSize(tileSize);
+
+    return true;
+} // resolveOpenGLRenderTileSize
+
+RenderBackendTypeEnum
+EffectInstance::Implementation::chooseRenderBackendFromTimings(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestPassData, const RectI& roi)
+{
+    NodePtr node = _publicInterface->getNode();
+    const double glCostPerMB = node->getRenderCostPerMB(eRenderBackendTypeOpenGL);
+    const double cpuCostPerMB = node->getRenderCostPerMB(eRenderBackendTypeCPU);
+
+    // Without history on a backend, try it
+    if (glCostPerMB == 0) {
+        return eRenderBackendTypeOpenGL;
+    }
+    if (cpuCostPerMB == 0) {
+        return eRenderBackendTypeCPU;
+    }
+
+    const double bytesToMB = 1. / (1024. * 1024.);
+
+    // Same size as the one accounted in tiledRenderingFunctor: OpenGL textures are always float
+    const int nComps = requestPassData->getPlaneDesc().getNumComponents();
+    const double glOutputMB = (double)roi.area() * nComps * sizeof(float) * bytesToMB;
+    const double cpuOutputMB = (double)roi.area() * nComps * getSizeOfForBitDepth( _publicInterface->getBitDepth(-1) ) * bytesToMB;
+
+    // Inputs that do not live on the device of the backend have to be moved first
+    double inputsInRAMMB = 0., inputsOnGPUMB = 0.;
+    {
+        std::list<FrameViewRequestPtr> inputs = requestPassData->getRenderedDependencies(requestPassSharedData);
+        for (std::list<FrameViewRequestPtr>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+            ImagePtr image = (*it)->getRequestedScaleImagePlane();
+            RectI inputRect;
+            if ( !image || !image->getBounds().intersect(roi, &inputRect) ) {
+                continue;
+            }
+            double inputMB = (double)inputRect.area() * image->getComponentsCount() * getSizeOfForBitDepth( image->getBitDepth() ) * bytesToMB;
+            if (image->getStorageMode() == eStorageModeGLTex) {
+                inputsOnGPUMB += inputMB;
+            } else {
+                inputsInRAMMB += inputMB;
+            }
+        }
+    }
+
+    // A listener that cannot render with OpenGL reads the output back to the RAM
+    bool outputReadBack = false;
+    {
+        std::list<FrameViewRequestPtr> listeners = requestPassData->getListeners(requestPassSharedData);
+        for (std::list<FrameViewRequestPtr>::const_iterator it = listeners.begin(); it != listeners.end(); ++it) {
+            EffectInstancePtr listenerEffect = (*it)->getEffect();
+            if (listenerEffect && listenerEffect->getOpenGLRenderSupport() == ePluginOpenGLRenderSupportNone) {
+                outputReadBack = true;
+                break;
+            }
+        }
+    }
+
+    const double transferCostPerMB = node->getTransferCostPerMB();
+    const double glCost = glCostPerMB * glOutputMB + transferCostPerMB * ( inputsInRAMMB + (outputReadBack ? glOutputMB : 0.) );
+
+    // The render cost is recorded per rectangle: with host frame threading the rectangles render concurrently
+    double cpuCost = cpuCostPerMB * cpuOutputMB;
+    if (_publicInterface->getRenderThreadSafety() == eRenderSafetyFullySafeFrame) {
+        // Same estimation as in checkRestToRender
+        unsigned int nCPUs = ( std::min(roi.width(), 4096) * roi.height() ) / 4096;
+        nCPUs = std::min( nCPUs, (unsigned int)std::max(1, appPTR->getMaxThreadCount()) );
+        if (nCPUs > 1) {
+            cpuCost /= nCPUs;
+        }
+    }
+    cpuCost += transferCostPerMB * inputsOnGPUMB;
+
+    return glCost <= cpuCost ? eRenderBackendTypeOpenGL : eRenderBackendTypeCPU;
+} // chooseRenderBackendFromTimings
+
 CacheAccessModeEnum
 EffectInstance::Implementation::shouldRenderUseCache(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestPassData)
 {
@@ -217,6 +436,20 @@ EffectInstance::Implementation::shouldRenderUseCache(const TreeRenderExecutionDa
         ret = eCacheAccessModeNone;
     }
 
+    // In a background render sharing the tile cache with the main process, cache the images consumed by the writer
+    // so that the viewers of the main process can display the rendered frames without rendering them again.
+    if ( !retSet && appPTR->isSharingRenderedFramesWithMainProcess() ) {
+        std::list<FrameViewRequestPtr> listeners = requestPassData->getListeners(requestPassSharedData);
+        for (std::list<FrameViewRequestPtr>::const_iterator it = listeners.begin(); it != listeners.end(); ++it) {
+            EffectInstancePtr listenerEffect = (*it)->getEffect();
+            if ( listenerEffect && listenerEffect->isWriter() ) {
+                ret = eCacheAccessModeReadWrite;
+                retSet = true;
+                break;
+            }
+        }
+    }
+
     if (!retSet) {
         TreeRenderPtr render = _publicInterface->getCurrentRender();
 
@@ -324,6 +557,7 @@ EffectInstance::Implementation::tiledRenderingFunctor(const RectToRender & rectT
     if (rectToRender.identityInputNumber != -1) {
         stat = renderHandlerIdentity(rectToRender, args);
     } else {
+        TimeLapse renderCostTimer;
         stat = renderHandlerPlugin(rectToRender, args);
         if (isFailureRetCode(stat)) {
             return stat;
@@ -335,11 +569,24 @@ EffectInstance::Implementation::tiledRenderingFunctor(const RectToRender & rectT
         if (isFailureRetCode(stat)) {
             return stat;
         }
+
+        // OpenGL commands are asynchronous: when the backend is chosen from the timings, wait for the GPU
+        // so that the time recorded is the actual render time and not only the time to submit the commands.
+        if (args.backendType == eRenderBackendTypeOpenGL && appPTR->getCurrentSettings()->isAdaptiveRenderBackendEnabled()) {
+            GL_GPU::Finish();
+        }
+
+        // Let the cache know how expensive the images of this node are to render again
+        std::size_t nBytesRendered = 0;
+        for (std::map<ImagePlaneDesc, ImagePtr>::const_iterator it = args.cachedPlanes.begin(); it != args.cachedPlanes.end(); ++it) {
+            nBytesRendered += (std::size_t)rectToRender.rect.area() * it->first.getNumComponents() * getSizeOfForBitDepth(it->second->getBitDepth());
+        }
+        _publicInterface->getNode()->addRenderCost(renderCostTimer.getTimeSinceCreation(), nBytesRendered, args.backendType);
     }
 
 
     if (timeRecorder) {
-        stats->addRenderInfosForNode(_publicInterface->getNode(), timeRecorder->getTimeSinceCreation());
+        stats->addRenderInfosForNode(_publicInterface->getNode(), timeRecorder->getTimeSinceCreation(), args.backendType);
     }
     return render->isRenderAborted() ? eActionStatusAborted : eActionStatusOK;
 } // tiledRenderingFunctor
@@ -569,10 +816,13 @@ EffectInstance::Implementation::renderHandlerPlugin(const RectToRender & rectToR
 
         OSGLContextAttacherPtr contextAttacher;
 
-        const ImagePtr& mainImagePlane = actionArgs.outputPlanes.front().second;
+        const ImagePtr mainImagePlane = actionArgs.outputPlanes.front().second;
 
         // For OSMesa, if the main image plane to render is not a 4 component image, we have to render first in a temporary image, then copy back the results.
         ImagePtr osmesaRenderImage;
+
+        // For OpenGL, if the main image plane is not a texture (the render is tiled), we render the tile in a temporary texture, then copy back the results.
+        ImagePtr glRenderImage;
         if (args.backendType == eRenderBackendTypeOpenGL ||
             args.backendType == eRenderBackendTypeOSMesa) {
 
@@ -580,7 +830,26 @@ EffectInstance::Implementation::renderHandlerPlugin(const RectToRender & rectToR
             // We only bind to the framebuffer color attachment 0 the "main" output image plane
             assert(actionArgs.outputPlanes.size() == 1);
             if (args.glContext->isGPUContext()) {
-                setupGLForRender<GL_GPU>(mainImagePlane, args.glContext, actionArgs.roi, _publicInterface->getNode()->isGLFinishRequiredBeforeRender(), &contextAttacher);
+                glRenderImage = mainImagePlane;
+                if (mainImagePlane->getStorageMode() != eStorageModeGLTex) {
+                    Image::InitStorageArgs initArgs;
+                    initArgs.bounds = actionArgs.roi;
+                    initArgs.renderClone = _publicInterface->shared_from_this();
+                    initArgs.plane = mainImagePlane->getLayer();
+                    initArgs.bitdepth = eImageBitDepthFloat;
+                    initArgs.bufferFormat = eImageBufferLayoutRGBAPackedFullRect;
+                    initArgs.storage = eStorageModeGLTex;
+                    initArgs.proxyScale = mainImagePlane->getProxyScale();
+                    initArgs.mipMapLevel = mainImagePlane->getMipMapLevel();
+                    initArgs.glContext = args.glContext;
+                    initArgs.textureTarget = GL_TEXTURE_2D;
+                    glRenderImage = Image::create(initArgs);
+                    if (!glRenderImage) {
+                        return eActionStatusOutOfMemory;
+                    }
+                    actionArgs.outputPlanes.front().second = glRenderImage;
+                }
+                setupGLForRender<GL_GPU>(glRenderImage, args.glContext, actionArgs.roi, _publicInterface->getNode()->isGLFinishRequiredBeforeRender(), &contextAttacher);
             } else {
                 osmesaRenderImage = mainImagePlane;
                 if (mainImagePlane->getComponentsCount() != 4) {
@@ -610,7 +879,7 @@ EffectInstance::Implementation::renderHandlerPlugin(const RectToRender & rectToR
         if (args.backendType == eRenderBackendTypeOpenGL ||
             args.backendType == eRenderBackendTypeOSMesa) {
             if (args.glContext && args.glContext->isGPUContext()) {
-                GLImageStoragePtr glEntry = mainImagePlane->getGLImageStorage();
+                GLImageStoragePtr glEntry = glRenderImage->getGLImageStorage();
                 assert(glEntry);
                 GL_GPU::BindTexture(glEntry->getGLTextureTarget(), 0);
                 finishGLRender<GL_GPU>();
@@ -627,6 +896,12 @@ EffectInstance::Implementation::renderHandlerPlugin(const RectToRender & rectToR
             stat = mainImagePlane->copyPixels(*osmesaRenderImage, cpyArgs);
         }
 
+        if ( glRenderImage && (glRenderImage != mainImagePlane) && !isFailureRetCode(stat) ) {
+            Image::CopyPixelsArgs cpyArgs;
+            cpyArgs.roi = actionArgs.roi;
+            stat = mainImagePlane->copyPixels(*glRenderImage, cpyArgs);
+        }
+
         if (isFailureRetCode(stat)) {
             return stat;
         }
@@ -671,6 +946,9 @@ EffectInstance::Implementation::renderHandlerPostProcess(const RectToRender & re
     const std::map<int, std::list<ImagePlaneDesc> > &inputPlanesNeeded = args.requestData->getComponentsResults()->getNeededInputPlanes();
     std::bitset<4> processChannels = args.requestData->getComponentsResults()->getProcessChannels();
 
+    // The inputs are fetched in the storage of the output images, which are in RAM when the OpenGL render is tiled
+    RenderBackendTypeEnum inputsBackendType = getOutputImagesBackendType(args.requestData, args.backendType);
+
     bool hostMasking = _publicInterface->isHostMaskEnabled();
     if ( hostMasking ) {
 
@@ -687,7 +965,7 @@ EffectInstance::Implementation::renderHandlerPostProcess(const RectToRender & re
             std::map<int, std::list<ImagePlaneDesc> >::const_iterator foundNeededLayers = inputPlanesNeeded.find(maskInputNb);
             if (foundNeededLayers != inputPlanesNeeded.end() && !foundNeededLayers->second.empty()) {
 
-                GetImageInArgs inArgs(&curMipMap, &proxyScale, &rectToRender.rect, &args.backendType);
+                GetImageInArgs inArgs(&curMipMap, &proxyScale, &rectToRender.rect, &inputsBackendType);
                 inArgs.plane = &foundNeededLayers->second.front();
                 inArgs.inputNb = maskInputNb;
                 GetImageOutArgs outArgs;
@@ -725,7 +1003,7 @@ EffectInstance::Implementation::renderHandlerPostProcess(const RectToRender & re
 
             bool foundNan = false;
             ActionRetCodeEnum stat = eActionStatusOK;
-            if (it->second->getBitDepth() == eImageBitDepthFloat && it->second->getStorageMode() == eStorageModeRAM) {
+            if (it->second->getStorageMode() == eStorageModeRAM) {
                 stat = it->second->checkForNaNs(rectToRender.rect, &foundNan);
                 if (isFailureRetCode(stat)) {
                     return stat;
@@ -757,7 +1035,7 @@ EffectInstance::Implementation::renderHandlerPostProcess(const RectToRender & re
 
             std::map<int, std::list<ImagePlaneDesc> >::const_iterator foundNeededLayers = inputPlanesNeeded.find(mainInputNb);
 
-            GetImageInArgs inArgs(&curMipMap, &proxyScale, &rectToRender.rect, &args.backendType);
+            GetImageInArgs inArgs(&curMipMap, &proxyScale, &rectToRender.rect, &inputsBackendType);
             if (foundNeededLayers != inputPlanesNeeded.end() && !foundNeededLayers->second.empty()) {
 
 
@@ -773,16 +1051,15 @@ EffectInstance::Implementation::renderHandlerPostProcess(const RectToRender & re
             }
         }
 
-        if (copyUnProcessed && mainInputImage) {
-            ActionRetCodeEnum stat = it->second->copyUnProcessedChannels(rectToRender.rect, processChannels, mainInputImage);
-            if (isFailureRetCode(stat)) {
-                return stat;
-            }
-        }
-
-
-        if (useMaskMix) {
-            ActionRetCodeEnum stat = it->second->applyMaskMix(rectToRender.rect, maskImage, mainInputImage, maskImage.get() /*masked*/, false /*maskInvert*/, mix);
+        // Copy the unprocessed channels and apply the mask and mix in a single pass over the image
+        if ( (copyUnProcessed && mainInputImage) || useMaskMix ) {
+            ActionRetCodeEnum stat = it->second->copyUnProcessedChannelsAndApplyMaskMix(rectToRender.rect,
+                                                                                       copyUnProcessed ? processChannels : std::bitset<4>().set(),
+                                                                                       mainInputImage,
+                                                                                       useMaskMix ? maskImage : ImagePtr(),
+                                                                                       useMaskMix && maskImage.get() /*masked*/,
+                                                                                       false /*maskInvert*/,
+                                                                                       useMaskMix ? mix : 1.);
             if (isFailureRetCode(stat)) {
                 return stat;
             }
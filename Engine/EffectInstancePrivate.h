@@ -43,9 +43,11 @@
 #include "Engine/Image.h"
 #include "Engine/ImageStorage.h"
 #include "Engine/EffectDescription.h"
+#include "Engine/GPUImageCache.h"
 #include "Engine/TLSHolder.h"
 #include "Engine/NodeMetadata.h"
 #include "Engine/OSGLContext.h"
+#include "Engine/SmallVector.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/EffectInstanceTLSData.h"
@@ -77,6 +79,9 @@ struct RectToRender
     }
 };
 
+// A render usually has only a few rectangles to render, they are stored inline
+typedef SmallVector<RectToRender, 4>::type RectToRenderVec;
+
 struct ChannelSelector
 {
 
@@ -116,6 +121,11 @@ struct DefaultKnobs
     KnobButtonWPtr pyPlugExportButtonKnob;
     KnobButtonWPtr pyPlugConvertToGroupButtonKnob;
 
+    // Freezing of the sub-graph of a NodeGroup
+    KnobBoolWPtr freezeSubGraphKnob;
+    KnobButtonWPtr updateFrozenSubGraphKnob;
+    KnobStringWPtr frozenSubGraphHashKnob;
+
     KnobStringWPtr nodeLabelKnob, ofxSubLabelKnob;
     KnobBoolWPtr previewEnabledKnob;
     KnobChoiceWPtr openglRenderingEnabledKnob;
@@ -129,6 +139,7 @@ struct DefaultKnobs
     KnobStringWPtr nodeInfos;
     KnobButtonWPtr refreshInfoButton;
     KnobBoolWPtr forceCaching;
+    KnobIntWPtr memoryBudgetMb;
     KnobBoolWPtr hideInputs;
     KnobStringWPtr beforeFrameRender;
     KnobStringWPtr beforeRender;
@@ -169,10 +180,13 @@ struct EffectInstanceCommonData
     mutable QMutex attachedContextsMutex;
 
     // A list of context that are currently attached (i.e attachOpenGLContext() has been called on them but not yet dettachOpenGLContext).
-    // If a plug-in returns false to supportsConcurrentOpenGLRenders() then whenever trying to attach a context, we take a lock in attachOpenGLContext
-    // that is released in dettachOpenGLContext so that there can only be a single attached OpenGL context at any time.
+    // Contexts stay attached across renders: they are detached when the effect is destroyed, or for plug-ins that return false
+    // to supportsConcurrentOpenGLRenders(), when another context is attached so that there is a single attached context at any time.
     std::map<OSGLContextWPtr, EffectOpenGLContextDataPtr> attachedContexts;
 
+    // Taken for the whole render by plug-ins that return false to supportsConcurrentOpenGLRenders()
+    QMutex nonConcurrentGLRenderMutex;
+
 
     // Protects all plug-in properties
     mutable QMutex pluginsPropMutex;
@@ -270,6 +284,50 @@ struct FrameViewKey_Compare
 
 typedef std::map<FrameViewKey, FrameViewRequestWPtr, FrameViewKey_Compare> FrameViewRequestMap;
 
+// Identifies the arguments of an action memoized on a render clone
+struct RenderCloneActionKey
+{
+    TimeValue time;
+    ViewIdx view;
+    RenderScale scale;
+    bool draft;
+};
+
+struct RenderCloneActionKey_Compare
+{
+    bool operator() (const RenderCloneActionKey& lhs, const RenderCloneActionKey& rhs) const
+    {
+        if (lhs.time < rhs.time) {
+            return true;
+        } else if (lhs.time > rhs.time) {
+            return false;
+        }
+
+        if (lhs.view < rhs.view) {
+            return true;
+        } else if (lhs.view > rhs.view) {
+            return false;
+        }
+
+        if (lhs.scale.x < rhs.scale.x) {
+            return true;
+        } else if (lhs.scale.x > rhs.scale.x) {
+            return false;
+        }
+
+        if (lhs.scale.y < rhs.scale.y) {
+            return true;
+        } else if (lhs.scale.y > rhs.scale.y) {
+            return false;
+        }
+
+        return (int)lhs.draft < (int)rhs.draft;
+    }
+};
+
+typedef std::map<RenderCloneActionKey, GetRegionOfDefinitionResultsPtr, RenderCloneActionKey_Compare> RegionOfDefinitionResultsMap;
+typedef std::map<RenderCloneActionKey, GetDistortionResultsPtr, RenderCloneActionKey_Compare> DistortionResultsMap;
+
 // Data specific to a render clone
 struct RenderCloneData
 {
@@ -296,6 +354,12 @@ struct RenderCloneData
     // The time invariant metadas for the render
     GetTimeInvariantMetadataResultsPtr metadataResults;
 
+    // The results of the getRegionOfDefinition and getInverseDistortion actions for this render.
+    // The knobs of a render clone do not change during the render: the results are looked up here
+    // before computing the hash and looking up the global cache.
+    RegionOfDefinitionResultsMap rodResults;
+    DistortionResultsMap distortionResults;
+
     // A shared pointer to the node, to ensure it does not get deleted while rendering
     NodePtr node;
 
@@ -307,6 +371,8 @@ struct RenderCloneData
     , requests()
     , frameRangeResults()
     , metadataResults()
+    , rodResults()
+    , distortionResults()
     , node()
     {
 
@@ -387,6 +453,18 @@ public:
      **/
     GetTimeInvariantMetadataResultsPtr getTimeInvariantMetadataResults() const;
 
+    /**
+     * @brief Set/Get the results of the getRegionOfDefinition action for this render
+     **/
+    void setRegionOfDefinitionResults(TimeValue time, ViewIdx view, const RenderScale& scale, const GetRegionOfDefinitionResultsPtr& results);
+    GetRegionOfDefinitionResultsPtr getRegionOfDefinitionResults(TimeValue time, ViewIdx view, const RenderScale& scale) const;
+
+    /**
+     * @brief Set/Get the results of the getInverseDistortion action for this render
+     **/
+    void setInverseDistortionResults(TimeValue time, ViewIdx view, const RenderScale& scale, bool draft, const GetDistortionResultsPtr& results);
+    GetDistortionResultsPtr getInverseDistortionResults(TimeValue time, ViewIdx view, const RenderScale& scale, bool draft) const;
+
 
     /**
      * @brief Helper function in the implementation of renderRoI to determine from the planes requested
@@ -412,6 +490,16 @@ public:
                                            AcceptedRequestConcatenationFlags concatenationFlags,
                                            bool *isIdentity);
 
+    /**
+     * @brief Returns the input on which this render clone is identity over its whole region of definition
+     * at the same time, view and plane, or -1 if the effect has to be requested.
+     * This is used by requestRender to collapse chains of identity effects: the requester then directly
+     * requests the first non-identity effect upstream.
+     **/
+    int getWholeImageIdentityInput(const RenderScale& proxyScale,
+                                   unsigned int mipMapLevel,
+                                   const ImagePlaneDesc& plane);
+
     /**
      * @brief Helper function in the implementation of renderRoI to handle effects that can concatenate (distortion etc...)
      **/
@@ -423,6 +511,19 @@ public:
                                           bool draftRender,
                                           bool *concatenated);
 
+    /**
+     * @brief Helper function in the implementation of renderRoI to handle effects that can concatenate a color transform.
+     * If the requester can receive a color transform, this request becomes pass-through and holds the stack of
+     * color transforms to apply. Otherwise, if this effect is the last one of a chain, fusedRender is set to true
+     * and the stack is rendered in a single pass instead of calling the render action.
+     **/
+    ActionRetCodeEnum handleColorConcatenation(const TreeRenderExecutionDataPtr& requestPassSharedData,
+                                               const FrameViewRequestPtr& requestData,
+                                               AcceptedRequestConcatenationFlags concatenationFlags,
+                                               const RectD& canonicalRoi,
+                                               bool *concatenated,
+                                               bool *fusedRender);
+
 
     /**
      * @brief Returns accepted concatenations with the given input nb
@@ -436,6 +537,21 @@ public:
      **/
     ActionRetCodeEnum resolveRenderBackend(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestPassData, const RectI& roi, CacheAccessModeEnum *cachePolicy, RenderBackendTypeEnum* renderBackend);
 
+    /**
+     * @brief Used by resolveRenderBackend when the adaptive backend selection is enabled in the settings: estimates the time
+     * to render the roi with OpenGL and on the CPU from the previous renders of this node, including the time to move the
+     * inputs and the output between the RAM and OpenGL textures, and returns the fastest backend.
+     * Each backend is tried at least once.
+     **/
+    RenderBackendTypeEnum chooseRenderBackendFromTimings(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestPassData, const RectI& roi);
+
+    /**
+     * @brief Used by resolveRenderBackend: if the roi does not fit in a texture of the given context or in its VRAM budget,
+     * sets the size of the tiles the OpenGL render is split into on the request, @see FrameViewRequest::getOpenGLRenderTileSize
+     * Returns false if the context cannot even hold the textures of a single tile.
+     **/
+    bool resolveOpenGLRenderTileSize(const FrameViewRequestPtr& requestPassData, const OSGLContextPtr& glContext, const RectI& roi);
+
     /**
      * @brief Helper function in the implementation of renderRoI to determine if a render should use the Cache or not.
      * @returns The cache access type, i.e: none, write only or read/write
@@ -463,6 +579,12 @@ public:
 
     static StorageModeEnum storageModeFromBackendType(RenderBackendTypeEnum backend);
 
+    /**
+     * @brief Returns the backend matching the storage of the output images of the request rendered with the given backend:
+     * the tiles of a tiled OpenGL render are copied to images in RAM, @see FrameViewRequest::getOpenGLRenderTileSize
+     **/
+    static RenderBackendTypeEnum getOutputImagesBackendType(const FrameViewRequestPtr& requestData, RenderBackendTypeEnum backend);
+
     ImagePtr createCachedImage(const RectI& roiPixels,
                                const std::vector<RectI>& perMipMapPixelRoD,
                                unsigned int mappedMipMapLevel,
@@ -472,6 +594,12 @@ public:
                                CacheAccessModeEnum cachePolicy,
                                bool delayAllocation);
 
+    /**
+     * @brief Returns the fields identifying the image of the given request in the GPU image cache
+     **/
+    GPUImageCacheEntryArgs getGPUImageCacheEntryArgs(const FrameViewRequestPtr& requestData,
+                                                     const std::vector<RectI>& perMipMapPixelRoD);
+
 
 
 
@@ -485,23 +613,55 @@ public:
                                         const RectI& renderMappedRoI,
                                         const RenderScale& renderMappedScale,
                                         const std::map<ImagePlaneDesc, ImagePtr>& producedImagePlanes,
-                                        std::list<RectToRender>* renderRects,
+                                        RectToRenderVec* renderRects,
                                         bool* hasPendingTiles);
 
 
+    /**
+     * @brief Renders the given rectangles one horizontal stripe at a time when the request is streamed,
+     * @see FrameViewRequest::isStreamedRender
+     **/
+    ActionRetCodeEnum launchStreamedRender(const FrameViewRequestPtr& requestData,
+                                           const RenderScale& combinedScale,
+                                           RenderBackendTypeEnum backendType,
+                                           const RectToRenderVec& renderRects,
+                                           const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes);
+
+    /**
+     * @brief Renders the given rectangles one tile at a time when the OpenGL render is tiled,
+     * @see FrameViewRequest::getOpenGLRenderTileSize
+     **/
+    ActionRetCodeEnum launchTiledOpenGLRender(const FrameViewRequestPtr& requestData,
+                                              const RenderScale& combinedScale,
+                                              const RectToRenderVec& renderRects,
+                                              const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes);
+
+    /**
+     * @brief Returns true if the RAM charged to the node or to the current render exceeds its budget,
+     * in which case the renders of the node are serialized.
+     **/
+    bool isMemoryBudgetExceeded() const;
+
     ActionRetCodeEnum launchRenderForSafetyAndBackend(const FrameViewRequestPtr& requestData,
                                                       const RenderScale& combinedScale,
                                                       RenderBackendTypeEnum backendType,
-                                                      const std::list<RectToRender>& renderRects,
+                                                      const RectToRenderVec& renderRects,
                                                       const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes);
 
 
+    /**
+     * @brief Renders the color transform stack of the request instead of calling the render action.
+     **/
+    ActionRetCodeEnum launchColorTransformStackRender(const FrameViewRequestPtr& requestData,
+                                                      const RectToRenderVec& renderRects,
+                                                      const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes);
+
     ActionRetCodeEnum launchPluginRenderAndHostFrameThreading(const FrameViewRequestPtr& requestData,
                                                               const OSGLContextPtr& glContext,
                                                               const EffectOpenGLContextDataPtr& glContextData,
                                                               const RenderScale& combinedScale,
                                                               RenderBackendTypeEnum backendType,
-                                                              const std::list<RectToRender>& renderRects,
+                                                              const RectToRenderVec& renderRects,
                                                               const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes);
 
 
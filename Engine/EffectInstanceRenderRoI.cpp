@@ -31,6 +31,7 @@
 #include <algorithm> // min, max
 #include <fstream>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
 #include <sstream> // stringstream
 
@@ -49,12 +50,14 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 // /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
 #include <boost/bind.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#include <boost/make_shared.hpp>
 #endif
 
 #include "Global/QtCompat.h"
 
 #include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
+#include "Engine/ColorTransform.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/EffectInstanceTLSData.h"
 #include "Engine/EffectOpenGLContextData.h"
@@ -76,8 +79,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/GPUContextPool.h"
+#include "Engine/GPUImageCache.h"
 #include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
+#include "Engine/RenderArena.h"
 #include "Engine/RenderStats.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/RotoShapeRenderNode.h"
@@ -88,6 +93,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/Timer.h"
 #include "Engine/Transform.h"
 #include "Engine/TreeRender.h"
+#include "Engine/TreeRenderBatch.h"
 #include "Engine/ThreadPool.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h"
@@ -100,6 +106,13 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 // do not all stick altogether in memory
 #define NATRON_MAX_FRAMES_NEEDED_PRE_FETCHING 3
 
+// With host frame threading, the render window is split in chunks that take about this time to render
+// so that the threads pulling them stay balanced even if some parts of the image are more expensive
+#define NATRON_HOST_FRAME_THREADING_CHUNK_SECONDS 0.01
+
+// Each chunk is a call to the render action: do not make more than this number of chunks per thread
+#define NATRON_HOST_FRAME_THREADING_MAX_CHUNKS_PER_THREAD 8
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -176,8 +189,9 @@ EffectInstance::Implementation::handlePassThroughPlanes(const FrameViewRequestPt
 
                     *isPassThrough = true;
 
+                    // A pass-through request does not forward the color transform stack of its input
                     FrameViewRequestPtr createdRequest;
-                    return ptInput->requestRender(passThroughTime, passThroughView, requestData->getProxyScale(), requestData->getMipMapLevel(), plane, roiCanonical, passThroughInputNb, concatenationFlags,requestData, requestPassSharedData, &createdRequest, 0);
+                    return ptInput->requestRender(passThroughTime, passThroughView, requestData->getProxyScale(), requestData->getMipMapLevel(), plane, roiCanonical, passThroughInputNb, concatenationFlags & ~eAcceptedRequestConcatenationColorTransform, requestData, requestPassSharedData, &createdRequest, 0);
                 }
             }
         }
@@ -225,6 +239,9 @@ EffectInstance::Implementation::handleIdentityEffect(double par,
         return eActionStatusOK;
     }
 
+    // An identity request does not forward the color transform stack of its input
+    concatenationFlags &= ~eAcceptedRequestConcatenationColorTransform;
+
     // If effect is identity on itself, call renderRoI again at different time and view.
     if (inputNbIdentity == -2) {
 
@@ -250,6 +267,70 @@ EffectInstance::Implementation::handleIdentityEffect(double par,
     }
 } // EffectInstance::Implementation::handleIdentityEffect
 
+int
+EffectInstance::Implementation::getWholeImageIdentityInput(const RenderScale& proxyScale,
+                                                           unsigned int mipMapLevel,
+                                                           const ImagePlaneDesc& plane)
+{
+    TreeRenderPtr render = _publicInterface->getCurrentRender();
+    if (!render) {
+        return -1;
+    }
+
+    // Nodes whose results are sampled by the render and nodes involved in the stroke being drawn need their own request
+    if (render->getCurrentlyDrawingItem() || render->isExtraResultsRequestedForNode(_publicInterface->getNode())) {
+        return -1;
+    }
+
+    const bool renderScaleSupport = _publicInterface->supportsRenderScale();
+    if (!renderScaleSupport && (proxyScale.x != 1. || proxyScale.y != 1.)) {
+        // Let requestRenderInternal report the error
+        return -1;
+    }
+
+    // Use the same scale as requestRenderInternal so that the identity results are shared with the cache
+    const RenderScale combinedScale = (!renderScaleSupport && mipMapLevel > 0) ? RenderScale(1.) : EffectInstance::getCombinedScale(mipMapLevel, proxyScale);
+
+    const TimeValue time = _publicInterface->getCurrentRenderTime();
+    const ViewIdx view = _publicInterface->getCurrentRenderView();
+
+    GetRegionOfDefinitionResultsPtr rodResults;
+    {
+        ActionRetCodeEnum stat = _publicInterface->getRegionOfDefinition_public(time, combinedScale, view, &rodResults);
+        if (isFailureRetCode(stat) || rodResults->getRoD().isNull()) {
+            return -1;
+        }
+    }
+
+    RectI pixelRod;
+    rodResults->getRoD().toPixelEnclosing(combinedScale, _publicInterface->getAspectRatio(-1), &pixelRod);
+
+    // The identity results are cached per hash and time, see isIdentity_public
+    IsIdentityResultsPtr results;
+    {
+        ActionRetCodeEnum stat = _publicInterface->isIdentity_public(true, time, combinedScale, pixelRod, view, &plane, &results);
+        if (isFailureRetCode(stat)) {
+            return -1;
+        }
+    }
+
+    TimeValue identityTime;
+    int identityInputNb;
+    ViewIdx identityView;
+    ImagePlaneDesc identityPlane;
+    results->getIdentityData(&identityInputNb, &identityTime, &identityView, &identityPlane);
+
+    // Only skip the request if the input is requested exactly as the requester would request this effect:
+    // the requester retrieves its input render clone by time and view in getImage.
+    if (identityInputNb < 0 || identityTime != time || identityView != view || identityPlane != plane) {
+        return -1;
+    }
+    if (!_publicInterface->getInputMainInstance(identityInputNb)) {
+        return -1;
+    }
+    return identityInputNb;
+} // getWholeImageIdentityInput
+
 EffectInstance::AcceptedRequestConcatenationFlags
 EffectInstance::Implementation::getConcatenationFlagsForInput(int inputNb) const
 {
@@ -260,6 +341,9 @@ EffectInstance::Implementation::getConcatenationFlagsForInput(int inputNb) const
     if (_publicInterface->getNode()->canInputReceiveDistortion(inputNb)) {
         ret |= eAcceptedRequestConcatenationDistortionFunc;
     }
+    if (_publicInterface->getCanColorTransform() && !_publicInterface->getNode()->isInputMask(inputNb)) {
+        ret |= eAcceptedRequestConcatenationColorTransform;
+    }
     return ret;
 }
 
@@ -391,6 +475,113 @@ EffectInstance::Implementation::handleConcatenation(const TreeRenderExecutionDat
     return eActionStatusOK;
 } // handleConcatenation
 
+ActionRetCodeEnum
+EffectInstance::Implementation::handleColorConcatenation(const TreeRenderExecutionDataPtr& requestPassSharedData,
+                                                         const FrameViewRequestPtr& requestData,
+                                                         AcceptedRequestConcatenationFlags downstreamConcatFlags,
+                                                         const RectD& canonicalRoi,
+                                                         bool *concatenated,
+                                                         bool *fusedRender)
+{
+    *concatenated = false;
+    *fusedRender = false;
+    if (!_publicInterface->getCurrentRender()->isConcatenationEnabled()) {
+        return eActionStatusOK;
+    }
+
+    // Only the color plane is transformed and the fused render only produces the requested plane
+    if (!_publicInterface->getCanColorTransform() || !requestData->getPlaneDesc().isColorPlane() || _publicInterface->isRenderAllPlanesAtOncePreferred()) {
+        return eActionStatusOK;
+    }
+
+    TimeValue curTime = _publicInterface->getCurrentRenderTime();
+    ViewIdx curView = _publicInterface->getCurrentRenderView();
+
+    // The host channels selection, masking and mixing are applied after the render action: they are not part of the transform
+    {
+        assert(requestData->getComponentsResults());
+        if (!requestData->getComponentsResults()->getProcessChannels().all()) {
+            return eActionStatusOK;
+        }
+        if (_publicInterface->isHostMixEnabled() && _publicInterface->getHostMixingValue(curTime, curView) != 1.) {
+            return eActionStatusOK;
+        }
+        if (_publicInterface->isHostMaskEnabled()) {
+            int inputsCount = _publicInterface->getNInputs();
+            for (int i = 0; i < inputsCount; ++i) {
+                if (_publicInterface->getNode()->isInputMask(i) && _publicInterface->isMaskEnabled(i) && _publicInterface->getInputMainInstance(i)) {
+                    return eActionStatusOK;
+                }
+            }
+        }
+    }
+
+    // Call the getColorTransform action
+    ColorTransform transform;
+    {
+        ActionRetCodeEnum stat = _publicInterface->getColorTransform_public(curTime, curView, &transform);
+        if (isFailureRetCode(stat)) {
+            return stat;
+        }
+        if (stat == eActionStatusReplyDefault) {
+            return eActionStatusOK;
+        }
+    }
+
+    EffectInstancePtr transformInput = _publicInterface->getInputMainInstance(transform.inputNbToTransform);
+    if (!transformInput) {
+        return eActionStatusInputDisconnected;
+    }
+
+    // A color transform is a per-pixel operation: request the same region on the input.
+    // The request is done again each time this request is visited so that the RoI of the input grows with the RoI of this request.
+    AcceptedRequestConcatenationFlags thisNodeConcatFlags = getConcatenationFlagsForInput(transform.inputNbToTransform);
+
+    FrameViewRequestPtr inputRequest;
+    {
+        ActionRetCodeEnum stat = transformInput->requestRender(curTime, curView, requestData->getProxyScale(), requestData->getMipMapLevel(), requestData->getPlaneDesc(), canonicalRoi, transform.inputNbToTransform, thisNodeConcatFlags, requestData, requestPassSharedData, &inputRequest, 0);
+        if (isFailureRetCode(stat)) {
+            return stat;
+        }
+    }
+
+    // If another requester already visited this request, keep the decision that was made then
+    if (requestData->getColorTransformStack()) {
+        *concatenated = requestData->getStatus() == FrameViewRequest::eFrameViewRequestStatusPassThrough;
+        *fusedRender = !*concatenated;
+        return eActionStatusOK;
+    }
+
+    ColorTransformStackPtr upstreamStack = inputRequest->getColorTransformStack();
+    const bool inputConcatenated = upstreamStack && inputRequest->getStatus() == FrameViewRequest::eFrameViewRequestStatusPassThrough;
+    const bool requesterCanReceiveColorTransform = downstreamConcatFlags & eAcceptedRequestConcatenationColorTransform;
+
+    // This is the only color transform of the chain: there's nothing to fuse, let the effect render
+    if (!requesterCanReceiveColorTransform && !inputConcatenated) {
+        return eActionStatusOK;
+    }
+
+    // Create a color transform stack that will be applied by the last effect of the chain
+    ColorTransformStackPtr colorStack(new ColorTransformStack);
+    if (inputConcatenated) {
+        assert(upstreamStack->getInputRequest());
+        colorStack->setInputRequest(upstreamStack->getInputRequest());
+        colorStack->pushColorTransformStack(*upstreamStack);
+    } else {
+        colorStack->setInputRequest(inputRequest);
+    }
+    colorStack->pushColorTransform(transform);
+    requestData->setColorTransformStack(colorStack);
+
+    if (requesterCanReceiveColorTransform) {
+        *concatenated = true;
+    } else {
+        *fusedRender = true;
+    }
+
+    return eActionStatusOK;
+} // handleColorConcatenation
+
 ActionRetCodeEnum
 EffectInstance::Implementation::lookupCachedImage(unsigned int mipMapLevel,
                                                   const RenderScale& proxyScale,
@@ -508,13 +699,41 @@ EffectInstance::Implementation::canSplitRenderWindowWithIdentityRectangles(const
     return false;
 } // canSplitRenderWindowWithIdentityRectangles
 
+/**
+ * @brief Splits the rectangle in chunks of about chunkArea pixels made of whole tiles of the cache,
+ * so that the threads of the host frame threading never render the same tile.
+ **/
+static void
+splitIntoTileAlignedChunks(const RectI& rect,
+                           int tileSizeX,
+                           int tileSizeY,
+                           double chunkArea,
+                           RectIVec* chunks)
+{
+    const int nTilesPerSide = std::max( 1, (int)std::floor(std::sqrt( chunkArea / ( (double)tileSizeX * tileSizeY ) ) + 0.5) );
+    const int chunkWidth = tileSizeX * nTilesPerSide;
+    const int chunkHeight = tileSizeY * nTilesPerSide;
+
+    // The tiles of the cache are aligned on multiples of the tile size
+    const int y0 = rect.y1 >= 0 ? (rect.y1 / chunkHeight) * chunkHeight : -( (-rect.y1 + chunkHeight - 1) / chunkHeight ) * chunkHeight;
+    const int x0 = rect.x1 >= 0 ? (rect.x1 / chunkWidth) * chunkWidth : -( (-rect.x1 + chunkWidth - 1) / chunkWidth ) * chunkWidth;
+    for (int y = y0; y < rect.y2; y += chunkHeight) {
+        for (int x = x0; x < rect.x2; x += chunkWidth) {
+            RectI chunk( std::max(x, rect.x1), std::max(y, rect.y1), std::min(x + chunkWidth, rect.x2), std::min(y + chunkHeight, rect.y2) );
+            if ( !chunk.isNull() ) {
+                chunks->push_back(chunk);
+            }
+        }
+    }
+} // splitIntoTileAlignedChunks
+
 ActionRetCodeEnum
 EffectInstance::Implementation::checkRestToRender(bool updateTilesStateFromCache,
                                                   const FrameViewRequestPtr& requestData,
                                                   const RectI& renderMappedRoI,
                                                   const RenderScale& renderMappedScale,
                                                   const std::map<ImagePlaneDesc, ImagePtr>& producedImagePlanes,
-                                                  std::list<RectToRender>* renderRects,
+                                                  RectToRenderVec* renderRects,
                                                   bool* hasPendingTiles)
 {
     renderRects->clear();
@@ -536,7 +755,7 @@ EffectInstance::Implementation::checkRestToRender(bool updateTilesStateFromCache
         *hasPendingTiles = false;
         int tileSizeX, tileSizeY;
         ImageBitDepthEnum outputBitDepth = _publicInterface->getBitDepth(-1);
-        appPTR->getTileCache()->getTileSizePx(outputBitDepth, &tileSizeX, &tileSizeY);;
+        appPTR->getTileCache()->getTileSizePx(outputBitDepth, &tileSizeX, &tileSizeY);
         tilesState.init(tileSizeX, tileSizeY, renderMappedRoI);
     } else {
 
@@ -590,7 +809,7 @@ EffectInstance::Implementation::checkRestToRender(bool updateTilesStateFromCache
     // We try to call isIdentity on each tile outside the input intersection
     // so that we may not have to render uninteresting areas.
     //
-    std::list<RectToRender> identityRects;
+    RectToRenderVec identityRects;
     {
         RectD inputRodIntersection;
         RectI inputRodIntersectionPixel;
@@ -646,7 +865,7 @@ EffectInstance::Implementation::checkRestToRender(bool updateTilesStateFromCache
 
     // Now we try to reduce the unrendered tiles in bigger rectangles so that there's a lot less calls to
     // the render action.
-    std::list<RectI> reducedRects;
+    RectIVec reducedRects;
     ImageTilesState::getMinimalRectsToRenderFromTilesState(renderMappedRoI, tilesState, &reducedRects);
 
     if (reducedRects.empty()) {
@@ -654,9 +873,9 @@ EffectInstance::Implementation::checkRestToRender(bool updateTilesStateFromCache
     }
 
     // If there's an identity rect covered by a rectangle to render, remove it
-    for (std::list<RectToRender>::const_iterator it = identityRects.begin(); it != identityRects.end(); ++it) {
+    for (RectToRenderVec::const_iterator it = identityRects.begin(); it != identityRects.end(); ++it) {
         bool hasRectContainingIdentityRect = false;
-        for (std::list<RectI>::const_iterator it2 = reducedRects.begin(); it2 != reducedRects.end(); ++it2) {
+        for (RectIVec::const_iterator it2 = reducedRects.begin(); it2 != reducedRects.end(); ++it2) {
             if (it2->contains(it->rect)) {
                 hasRectContainingIdentityRect = true;
                 break;
@@ -667,19 +886,45 @@ EffectInstance::Implementation::checkRestToRender(bool updateTilesStateFromCache
         }
     }
 
-    // If plug-in wants host frame threading and there is only 1 rect to render, split it
-    if (reducedRects.size() == 1 && requestData->getRenderDevice() == eRenderBackendTypeCPU && _publicInterface->getRenderThreadSafety() == eRenderSafetyFullySafeFrame) {
-        RectI mainRenderRect = reducedRects.front();
+    // If plug-in wants host frame threading, split the rects to render in chunks that the threads pull dynamically
+    if (requestData->getRenderDevice() == eRenderBackendTypeCPU && _publicInterface->getRenderThreadSafety() == eRenderSafetyFullySafeFrame) {
+        const int maxThreads = std::max(1, appPTR->getMaxThreadCount());
 
-        // Estimate num cpus according to the rectangle to render.
-        // the MultiThread suite will adjust the tasks to the actual number of cpus available, no need to do the clamping ourselves.
-        unsigned int nCPUs = ( std::min(mainRenderRect.x2 - mainRenderRect.x1, 4096) * (mainRenderRect.y2 - mainRenderRect.y1) ) / 4096;
-        if (nCPUs > 1) {
-            reducedRects = mainRenderRect.splitIntoSmallerRects(nCPUs);
+        // The render time per pixel of the previous renders of this node, if any
+        double costPerPixel = 0.;
+        {
+            double costPerMB = _publicInterface->getNode()->getRenderCostPerMB();
+            if (costPerMB > 0) {
+                double bytesPerPixel = requestData->getPlaneDesc().getNumComponents() * getSizeOfForBitDepth( _publicInterface->getBitDepth(-1) );
+                costPerPixel = costPerMB * bytesPerPixel / (1024. * 1024.);
+            }
         }
 
+        RectIVec chunks;
+        for (RectIVec::const_iterator it = reducedRects.begin(); it != reducedRects.end(); ++it) {
+
+            // Estimate num cpus according to the rectangle to render.
+            unsigned int nCPUs = ( std::min(it->x2 - it->x1, 4096) * (it->y2 - it->y1) ) / 4096;
+            nCPUs = std::min(nCPUs, (unsigned int)maxThreads);
+            if (nCPUs <= 1) {
+                chunks.push_back(*it);
+                continue;
+            }
+
+            // Without history, split in one chunk per thread. Otherwise aim for chunks that take about
+            // NATRON_HOST_FRAME_THREADING_CHUNK_SECONDS to render, but no more than NATRON_HOST_FRAME_THREADING_MAX_CHUNKS_PER_THREAD
+            // per thread because each render action call has a cost.
+            const double area = (double)it->area();
+            double chunkArea = area / nCPUs;
+            if (costPerPixel > 0) {
+                chunkArea = std::min( chunkArea, NATRON_HOST_FRAME_THREADING_CHUNK_SECONDS / costPerPixel );
+                chunkArea = std::max( chunkArea, area / (nCPUs * NATRON_HOST_FRAME_THREADING_MAX_CHUNKS_PER_THREAD) );
+            }
+            splitIntoTileAlignedChunks(*it, tilesState.tileSizeX, tilesState.tileSizeY, chunkArea, &chunks);
+        }
+        reducedRects.swap(chunks);
     }
-    for (std::list<RectI>::const_iterator it = reducedRects.begin(); it != reducedRects.end(); ++it) {
+    for (RectIVec::const_iterator it = reducedRects.begin(); it != reducedRects.end(); ++it) {
         if (!it->isNull()) {
             RectToRender r;
             r.rect = *it;
@@ -718,6 +963,17 @@ EffectInstance::Implementation::storageModeFromBackendType(RenderBackendTypeEnum
     return eStorageModeRAM;
 }
 
+RenderBackendTypeEnum
+EffectInstance::Implementation::getOutputImagesBackendType(const FrameViewRequestPtr& requestData,
+                                                           RenderBackendTypeEnum backend)
+{
+    if ( (backend == eRenderBackendTypeOpenGL) && (requestData->getOpenGLRenderTileSize() > 0) ) {
+        return eRenderBackendTypeCPU;
+    }
+
+    return backend;
+}
+
 ImagePtr
 EffectInstance::Implementation::createCachedImage(const RectI& roiPixels,
                                                   const std::vector<RectI>& perMipMapPixelRoD,
@@ -782,11 +1038,168 @@ EffectInstance::Implementation::createCachedImage(const RectI& roiPixels,
 } // createCachedImage
 
 
+GPUImageCacheEntryArgs
+EffectInstance::Implementation::getGPUImageCacheEntryArgs(const FrameViewRequestPtr& requestData,
+                                                          const std::vector<RectI>& perMipMapPixelRoD)
+{
+    GPUImageCacheEntryArgs args;
+    {
+        HashableObject::ComputeHashArgs hashArgs;
+        hashArgs.time = _publicInterface->getCurrentRenderTime();
+        hashArgs.view = _publicInterface->getCurrentRenderView();
+        hashArgs.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+        args.nodeTimeViewVariantHash = _publicInterface->computeHash(hashArgs);
+    }
+    args.proxyScale = requestData->getProxyScale();
+    args.mipMapLevel = requestData->getMipMapLevel();
+    args.isDraft = _publicInterface->isDraftRenderSupported() ? _publicInterface->getCurrentRender()->isDraftRender() : false;
+    args.plane = requestData->getPlaneDesc();
+    args.perMipMapPixelRoD = perMipMapPixelRoD;
+    args.bitdepth = _publicInterface->getBitDepth(-1);
+    args.bufferFormat = _publicInterface->getPreferredBufferLayout();
+
+    return args;
+} // getGPUImageCacheEntryArgs
+
+ActionRetCodeEnum
+EffectInstance::Implementation::launchColorTransformStackRender(const FrameViewRequestPtr& requestData,
+                                                                const RectToRenderVec& renderRects,
+                                                                const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes)
+{
+    ColorTransformStackPtr colorStack = requestData->getColorTransformStack();
+    assert(colorStack);
+
+    std::map<ImagePlaneDesc, ImagePtr>::const_iterator foundPlane = cachedPlanes.find(requestData->getPlaneDesc());
+    if (foundPlane == cachedPlanes.end()) {
+        return eActionStatusFailed;
+    }
+
+    // The stack is applied to identity rectangles as well: a color transform effect applies over the whole image,
+    // but the effects upstream in the stack still have to be applied.
+    for (RectToRenderVec::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
+        if (_publicInterface->isRenderAborted()) {
+            return eActionStatusAborted;
+        }
+        ActionRetCodeEnum stat = colorStack->renderFromInputRequest(it->rect, foundPlane->second);
+        if (isFailureRetCode(stat)) {
+            return stat;
+        }
+    }
+    return eActionStatusOK;
+} // launchColorTransformStackRender
+
+ActionRetCodeEnum
+EffectInstance::Implementation::launchStreamedRender(const FrameViewRequestPtr& requestData,
+                                                     const RenderScale& combinedScale,
+                                                     RenderBackendTypeEnum backendType,
+                                                     const RectToRenderVec& renderRects,
+                                                     const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes)
+{
+    const std::size_t stripeSize = _publicInterface->getCurrentRender()->getStreamingStripeSize();
+    assert(stripeSize > 0);
+
+    // Stripes are aligned on the tiles of the cache so that the tiles are rendered once
+    int tileWidth, tileHeight;
+    appPTR->getTileCache()->getTileSizePx(_publicInterface->getBitDepth(-1), &tileWidth, &tileHeight);
+
+    for (RectToRenderVec::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
+
+        // Identity rectangles do not allocate anything upstream
+        if (it->identityInputNumber != -1 || it->rect.isNull()) {
+            RectToRenderVec rects(1, *it);
+            ActionRetCodeEnum stat = launchRenderForSafetyAndBackend(requestData, combinedScale, backendType, rects, cachedPlanes);
+            if (isFailureRetCode(stat)) {
+                return stat;
+            }
+            continue;
+        }
+
+        int stripeHeight = (int)std::max( (std::size_t)1, stripeSize / (std::size_t)it->rect.width() );
+        stripeHeight = std::max(tileHeight, (stripeHeight / tileHeight) * tileHeight);
+
+        // Render the stripes from the top of the image, where scan-line formats start
+        for (int y2 = it->rect.y2; y2 > it->rect.y1; y2 -= stripeHeight) {
+            if ( _publicInterface->isRenderAborted() ) {
+                return eActionStatusAborted;
+            }
+            RectToRender stripe = *it;
+            stripe.rect.y2 = y2;
+            stripe.rect.y1 = std::max(it->rect.y1, y2 - stripeHeight);
+
+            // The images fetched upstream for this stripe are released when the render of the stripe returns
+            RectToRenderVec rects(1, stripe);
+            ActionRetCodeEnum stat = launchRenderForSafetyAndBackend(requestData, combinedScale, backendType, rects, cachedPlanes);
+            if (isFailureRetCode(stat)) {
+                return stat;
+            }
+        }
+    }
+    return eActionStatusOK;
+} // launchStreamedRender
+
+ActionRetCodeEnum
+EffectInstance::Implementation::launchTiledOpenGLRender(const FrameViewRequestPtr& requestData,
+                                                        const RenderScale& combinedScale,
+                                                        const RectToRenderVec& renderRects,
+                                                        const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes)
+{
+    const int tileSize = requestData->getOpenGLRenderTileSize();
+    assert(tileSize > 0);
+
+    for (RectToRenderVec::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
+
+        // Identity rectangles are copied from the inputs, no texture is needed
+        if (it->identityInputNumber != -1 || it->rect.isNull()) {
+            RectToRenderVec rects(1, *it);
+            ActionRetCodeEnum stat = launchRenderForSafetyAndBackend(requestData, combinedScale, eRenderBackendTypeOpenGL, rects, cachedPlanes);
+            if (isFailureRetCode(stat)) {
+                return stat;
+            }
+            continue;
+        }
+
+        // The tiles are rendered sequentially with the context of the render, each in a texture of its own that is
+        // copied to the output image. The inputs are fetched for the tile only, see EffectInstance::getImagePlane.
+        for (int y1 = it->rect.y1; y1 < it->rect.y2; y1 += tileSize) {
+            for (int x1 = it->rect.x1; x1 < it->rect.x2; x1 += tileSize) {
+                if ( _publicInterface->isRenderAborted() ) {
+                    return eActionStatusAborted;
+                }
+                RectToRender tile = *it;
+                tile.rect.x1 = x1;
+                tile.rect.y1 = y1;
+                tile.rect.x2 = std::min(it->rect.x2, x1 + tileSize);
+                tile.rect.y2 = std::min(it->rect.y2, y1 + tileSize);
+
+                RectToRenderVec rects(1, tile);
+                ActionRetCodeEnum stat = launchRenderForSafetyAndBackend(requestData, combinedScale, eRenderBackendTypeOpenGL, rects, cachedPlanes);
+                if (isFailureRetCode(stat)) {
+                    return stat;
+                }
+            }
+        }
+    }
+    return eActionStatusOK;
+} // launchTiledOpenGLRender
+
+bool
+EffectInstance::Implementation::isMemoryBudgetExceeded() const
+{
+    // The limit of the node follows its Memory Budget parameter
+    MemoryBudgetPtr nodeBudget = _publicInterface->getNode()->getMemoryBudget();
+    nodeBudget->setLimit( _publicInterface->getMemoryBudgetLimit() );
+    if ( nodeBudget->isExceeded() ) {
+        return true;
+    }
+    TreeRenderPtr render = _publicInterface->getCurrentRender();
+    return render && render->getMemoryBudget()->isExceeded();
+} // isMemoryBudgetExceeded
+
 ActionRetCodeEnum
 EffectInstance::Implementation::launchRenderForSafetyAndBackend(const FrameViewRequestPtr& requestData,
                                                                 const RenderScale& combinedScale,
                                                                 RenderBackendTypeEnum backendType,
-                                                                const std::list<RectToRender>& renderRects,
+                                                                const RectToRenderVec& renderRects,
                                                                 const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes)
 {
 
@@ -797,6 +1210,11 @@ EffectInstance::Implementation::launchRenderForSafetyAndBackend(const FrameViewR
     // There should always be at least 1 plane to render (The color plane)
     assert(!renderRects.empty());
 
+    // The last effect of a chain of color transforms does not call the plug-in render
+    if (requestData->getColorTransformStack()) {
+        return launchColorTransformStackRender(requestData, renderRects, cachedPlanes);
+    }
+
     RenderSafetyEnum safety = _publicInterface->getRenderThreadSafety();
     // eRenderSafetyInstanceSafe means that there is at most one render per instance
     // NOTE: the per-instance lock should be shared between
@@ -806,6 +1224,11 @@ EffectInstance::Implementation::launchRenderForSafetyAndBackend(const FrameViewR
 
     // eRenderSafetyFullySafe means that there is only one render per FRAME : the lock is per image
 
+    // Note that the rectangles of the render window cannot be dispatched to a pool of plug-in instances to avoid these locks:
+    // the render clones all share the same OpenFX instance, whose parameters create
+    // the knobs of the node, see OfxImageEffectInstance::newParam. eRenderSafetyUnsafe plug-ins
+    // may also rely on global state shared by all their instances.
+
     boost::scoped_ptr<QMutexLocker> locker;
 
     // Since we may are going to sit and wait on this lock, to allow this thread to be re-used by another task of the thread pool we
@@ -826,6 +1249,16 @@ EffectInstance::Implementation::launchRenderForSafetyAndBackend(const FrameViewR
         // no need to lock
         Q_UNUSED(locker);
     }
+
+    // When the memory budget is exceeded, reduce the concurrency: render one image of this node at a time
+    // so that the images fetched and allocated by its concurrent renders are not all held at once.
+    boost::scoped_ptr<QMutexLocker> budgetLocker;
+    if ( isMemoryBudgetExceeded() ) {
+        if (!releaser) {
+            releaser.reset(new ReleaseTPThread_RAII);
+        }
+        budgetLocker.reset( new QMutexLocker( _publicInterface->getNode()->getMemoryBudget()->getExceededRenderMutex() ) );
+    }
     releaser.reset();
 
     TreeRenderPtr render = _publicInterface->getCurrentRender();
@@ -843,6 +1276,13 @@ EffectInstance::Implementation::launchRenderForSafetyAndBackend(const FrameViewR
     }
 
 
+    // Plug-ins that do not support concurrent OpenGL renders render one image at a time.
+    // Lock before binding the context: attachOpenGLContext_public() may have to bind the previously attached one.
+    boost::scoped_ptr<QMutexLocker> glRenderLocker;
+    if ( glContext && !_publicInterface->supportsConcurrentOpenGLRenders() ) {
+        glRenderLocker.reset( new QMutexLocker(&common->nonConcurrentGLRenderMutex) );
+    }
+
     // Bind the OpenGL context if there's any
     OSGLContextAttacherPtr glContextAttacher;
     if (glContext) {
@@ -860,21 +1300,8 @@ EffectInstance::Implementation::launchRenderForSafetyAndBackend(const FrameViewR
     }
     if (renderRetCode == eActionStatusOK) {
 
+        // The context stays attached to the effect for the next renders, @see attachOpenGLContext_public
         renderRetCode = launchPluginRenderAndHostFrameThreading(requestData, glContext, glContextData, combinedScale, backendType, renderRects, cachedPlanes);
-
-        if (backendType == eRenderBackendTypeOpenGL ||
-            backendType == eRenderBackendTypeOSMesa) {
-            // If the plug-in doesn't support concurrent OpenGL renders, release the lock that was taken in the call to attachOpenGLContext_public() above.
-            // For safe plug-ins, we call dettachOpenGLContext_public when the effect is destroyed in Node::destroy() with the function EffectInstance::dettachAllOpenGLContexts().
-            // If we were the last render to use this context, clear the data now
-
-            if ( glContextData->getHasTakenLock() ||
-                !_publicInterface->supportsConcurrentOpenGLRenders() ||
-                glContextData.use_count() == 2) {
-
-                _publicInterface->dettachOpenGLContext_public(glContext, glContextData);
-            }
-        }
     }
 
     return renderRetCode;
@@ -1086,6 +1513,27 @@ EffectInstance::requestRender(TimeValue timeInArgs,
     if (!renderClone) {
         return eActionStatusFailed;
     }
+
+    // If this effect is identity over its whole image, do not create a request for it: the requester directly requests
+    // the identity input at the same time/view. Since this recurses, a chain of identity effects resolves in one step
+    // to the first non-identity effect upstream.
+    if (requesterFrameViewRequest && inputNbInRequester >= 0) {
+        int identityInputNb = renderClone->_imp->getWholeImageIdentityInput(proxyScale, mipMapLevel, plane);
+        if (identityInputNb >= 0) {
+            EffectInstancePtr identityInput = renderClone->getInputMainInstance(identityInputNb);
+            assert(identityInput);
+
+            // An identity request does not forward the color transform stack of its input
+            concatenationFlags &= ~eAcceptedRequestConcatenationColorTransform;
+            return identityInput->requestRender(time, view, proxyScale, mipMapLevel, plane, roiCanonical, inputNbInRequester, concatenationFlags, requesterFrameViewRequest, requestPassSharedData, createdRequest, createdRenderClone);
+        }
+    }
+
+    // If another node upstream of the requester produces the same images (e.g: an identical branch), share its request
+    // so that the upstream work is not scheduled twice.
+    if (requesterFrameViewRequest && inputNbInRequester >= 0) {
+        renderClone = requestPassSharedData->getTreeRender()->getEquivalentRenderClone(renderClone);
+    }
     if (createdRenderClone) {
         *createdRenderClone = renderClone;
     }
@@ -1117,8 +1565,9 @@ EffectInstance::requestRender(TimeValue timeInArgs,
             }
         }
         if (!*createdRequest) {
-            // Create a request if it did not already exist
-            createdRequest->reset(new FrameViewRequest(plane, mipMapLevel, proxyScale, renderClone, requestPassSharedData->getTreeRender()));
+            // Create a request if it did not already exist. The request and its reference count are allocated out of the render arena.
+            TreeRenderPtr render = requestPassSharedData->getTreeRender();
+            *createdRequest = boost::allocate_shared<FrameViewRequest>(RenderArenaAllocator<FrameViewRequest>(render->getArena()), plane, mipMapLevel, proxyScale, renderClone, render);
             renderClone->_imp->renderData->requests.insert(std::make_pair(requestKey, *createdRequest));
         }
     }
@@ -1262,6 +1711,20 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
         }
     }
 
+    // If the requester can receive a color transform, forward it the stack of color transforms.
+    // A request that was already concatenated for another requester stays pass-through.
+    if ((concatenationFlags & eAcceptedRequestConcatenationColorTransform) || requestData->getColorTransformStack()) {
+        bool concatenated, fusedRender;
+        ActionRetCodeEnum upstreamRetCode = _imp->handleColorConcatenation(requestPassSharedData, requestData, concatenationFlags, roiCanonical, &concatenated, &fusedRender);
+        if (isFailureRetCode(upstreamRetCode)) {
+            return upstreamRetCode;
+        }
+        if (concatenated) {
+            requestData->initStatus(FrameViewRequest::eFrameViewRequestStatusPassThrough);
+            return eActionStatusOK;
+        }
+    }
+
 
 
     ///////////////////////////////////////////////////////////////////////////////////////////////
@@ -1278,7 +1741,7 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
     // Round the roi to the tile size if the render is cached
     ImageBitDepthEnum outputBitDepth = getBitDepth(-1);
     int tileWidth, tileHeight;
-    CacheBase::getTileSizePx(outputBitDepth, &tileWidth, &tileHeight);
+    appPTR->getTileCache()->getTileSizePx(outputBitDepth, &tileWidth, &tileHeight);
 
 
     if (!supportsTiles()) {
@@ -1350,7 +1813,16 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
         requestData->setCurrentRoI(curRoI);
     }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////// Handle time-invariant results shared across a frame range //////////////////////////////
 
+    // If this node is the root of a time-invariant subgraph and another frame of the range already rendered it,
+    // re-use its image: neither the cache nor the subgraph upstream need to be visited.
+    TreeRenderBatchPtr batch = render->getBatch();
+    if (batch && batch->getSharedResult(shared_from_this(), requestData, downscaledRoI)) {
+        requestData->initStatus(FrameViewRequest::eFrameViewRequestStatusRendered);
+        return eActionStatusOK;
+    }
 
 
     // Check for abortion before checking cache
@@ -1398,6 +1870,8 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
 
     requestData->setCachePolicy(cachePolicy);
 
+    // The backend the output images are allocated for
+    const RenderBackendTypeEnum outputBackendType = EffectInstance::Implementation::getOutputImagesBackendType(requestData, backendType);
 
 
     // Get the image on the FrameViewRequest
@@ -1413,6 +1887,15 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
     ImagePtr requestedImageScale = requestData->getRequestedScaleImagePlane();
     ImagePtr fullScaleImage = requestData->getFullscaleImagePlane();
 
+    // An image shared with other frames of the batch or held by the GPU image cache may be read concurrently:
+    // never grow it, make a new one instead
+    GPUImageCache* gpuImageCache = appPTR->getGPUContextPool()->getImageCache();
+    if ( (batch && (batch->isSharedImage(requestedImageScale) || batch->isSharedImage(fullScaleImage))) ||
+         gpuImageCache->isCachedImage(requestedImageScale) || gpuImageCache->isCachedImage(fullScaleImage) ) {
+        requestedImageScale.reset();
+        fullScaleImage.reset();
+    }
+
     // The image must have a cache entry object, even if the policy is eCacheAccessModeNone
     // so we can sync concurrent threads to render the same image.
     assert(!requestedImageScale || requestedImageScale->getCacheEntry());
@@ -1427,7 +1910,7 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
         }
     } else {
 
-        bool differentStorage = requestedImageScale->getStorageMode() != EffectInstance::Implementation::storageModeFromBackendType(backendType);
+        bool differentStorage = requestedImageScale->getStorageMode() != EffectInstance::Implementation::storageModeFromBackendType(outputBackendType);
 
         if (differentStorage) {
 
@@ -1486,6 +1969,21 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
     } // isAccumulating
 
 
+    // An OpenGL render that should be cached may have been rendered by a previous render with the same context
+    if ( (backendType == eRenderBackendTypeOpenGL) && requestData->isGPUImageCacheEnabled() && !isAccumulating && !renderFullScaleThenDownScale ) {
+        GPUImageCacheEntryArgs gpuCacheArgs = _imp->getGPUImageCacheEntryArgs(requestData, perMipMapLevelRoDPixel);
+        ImagePtr cachedImage = gpuImageCache->get(GPUImageCache::makeKey(gpuCacheArgs), render->getGPUOpenGLContext(), downscaledRoI);
+        if (cachedImage) {
+            requestData->setRequestedScaleImagePlane(cachedImage);
+            requestData->setFullscaleImagePlane(cachedImage);
+            requestData->initStatus(FrameViewRequest::eFrameViewRequestStatusRendered);
+            if (batch) {
+                batch->setSharedResult(shared_from_this(), requestData);
+            }
+            return eActionStatusOK;
+        }
+    }
+
     // Evaluate the tiles state map on the image to check what's left to render and fetch tiles from cache
     // Note that no memory allocation is done here, only existing tiles are fetched from the cache.
 
@@ -1495,7 +1993,7 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
     bool hasPendingTiles = false;
 
     bool lookupReadOnly = requestPassSharedData->isNewTreeRenderUponUnrenderedImageEnabled();
-    ActionRetCodeEnum stat = _imp->lookupCachedImage(requestData->getMipMapLevel(), requestData->getProxyScale(), requestData->getPlaneDesc(), perMipMapLevelRoDPixel, downscaledRoI, cachePolicy, backendType, lookupReadOnly, &requestedImageScale, &hasPendingTiles, &hasUnRenderedTile);
+    ActionRetCodeEnum stat = _imp->lookupCachedImage(requestData->getMipMapLevel(), requestData->getProxyScale(), requestData->getPlaneDesc(), perMipMapLevelRoDPixel, downscaledRoI, cachePolicy, outputBackendType, lookupReadOnly, &requestedImageScale, &hasPendingTiles, &hasUnRenderedTile);
     if (isFailureRetCode(stat)) {
         return stat;
     }
@@ -1515,7 +2013,7 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
         requestedImageScale->getCacheEntry()->markCacheTilesAsAborted();
         requestedImageScale.reset();
 
-        stat = _imp->lookupCachedImage(mappedMipMapLevel, requestData->getProxyScale(), requestData->getPlaneDesc(), perMipMapLevelRoDPixel, renderMappedRoI, cachePolicy, backendType, false, &fullScaleImage, &hasPendingTiles, &hasUnRenderedTile);
+        stat = _imp->lookupCachedImage(mappedMipMapLevel, requestData->getProxyScale(), requestData->getPlaneDesc(), perMipMapLevelRoDPixel, renderMappedRoI, cachePolicy, outputBackendType, false, &fullScaleImage, &hasPendingTiles, &hasUnRenderedTile);
         if (isFailureRetCode(stat)) {
             return stat;
         }
@@ -1544,13 +2042,40 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
 
     requestData->initStatus(requestStatus);
 
+    if (batch && requestStatus == FrameViewRequest::eFrameViewRequestStatusRendered) {
+        batch->setSharedResult(shared_from_this(), requestData);
+    }
+
     // If there's nothing to render, do not even add the inputs as needed dependencies.
     if (requestStatus == FrameViewRequest::eFrameViewRequestStatusNotRendered) {
 
-        ActionRetCodeEnum upstreamRetCode = _imp->handleUpstreamFramesNeeded(requestPassSharedData, requestData, proxyScale, mappedMipMapLevel, roundedCanonicalRoI, inputLayersNeeded);
+        // If this effect is the last of a chain of color transforms, the stack is rendered in a single pass instead of the effect.
+        // The stack is only rendered on the CPU at the requested scale, otherwise the effect renders and the stack
+        // upstream is applied when it fetches its input image.
+        bool fusedColorTransformRender = false;
+        if (backendType == eRenderBackendTypeCPU && !renderFullScaleThenDownScale && !isAccumulating) {
+            bool concatenated;
+            ActionRetCodeEnum upstreamRetCode = _imp->handleColorConcatenation(requestPassSharedData, requestData, concatenationFlags & ~eAcceptedRequestConcatenationColorTransform, roundedCanonicalRoI, &concatenated, &fusedColorTransformRender);
+            if (isFailureRetCode(upstreamRetCode)) {
+                return upstreamRetCode;
+            }
+            assert(!concatenated);
+        }
+
+        // At the root of an execution, a window larger than the stripe size is rendered in stripes which fetch their inputs
+        // while rendering, instead of requesting the whole RoI upstream at once.
+        const std::size_t streamingStripeSize = render->getStreamingStripeSize();
+        const bool streamedRender = !fusedColorTransformRender && !requesterFrameViewRequest && streamingStripeSize > 0 &&
+                                    backendType == eRenderBackendTypeCPU && !renderFullScaleThenDownScale && !isAccumulating &&
+                                    supportsTiles() && (std::size_t)renderMappedRoI.area() > streamingStripeSize;
+        requestData->setStreamedRender(streamedRender);
 
-        if (isFailureRetCode(upstreamRetCode)) {
-            return upstreamRetCode;
+        if (!fusedColorTransformRender && !streamedRender) {
+            ActionRetCodeEnum upstreamRetCode = _imp->handleUpstreamFramesNeeded(requestPassSharedData, requestData, proxyScale, mappedMipMapLevel, roundedCanonicalRoI, inputLayersNeeded);
+
+            if (isFailureRetCode(upstreamRetCode)) {
+                return upstreamRetCode;
+            }
         }
     }
     return eActionStatusOK;
@@ -1559,7 +2084,7 @@ EffectInstance::requestRenderInternal(const RectD & roiCanonical,
 
 
 ActionRetCodeEnum
-EffectInstance::launchNodeRender(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestData)
+EffectInstance::launchNodeRender(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestData, bool allowPendingTilesRetCode)
 {
 
     {
@@ -1583,7 +2108,14 @@ EffectInstance::launchNodeRender(const TreeRenderExecutionDataPtr& requestPassSh
         assert(requestStatus == FrameViewRequest::eFrameViewRequestStatusNotRendered);
         (void)requestStatus;
     }
-    ActionRetCodeEnum stat = launchRenderInternal(requestPassSharedData, requestData);
+    ActionRetCodeEnum stat = launchRenderInternal(requestPassSharedData, requestData, allowPendingTilesRetCode);
+
+    if (stat == eActionStatusPendingTiles) {
+        // The request is not finished: it will be launched again when the pending tiles are rendered
+        assert(allowPendingTilesRetCode);
+        requestData->notifyRenderWaitingForPendingTiles();
+        return stat;
+    }
 
 #ifdef DEBUG
     if (stat == eActionStatusOK) {
@@ -1598,6 +2130,14 @@ EffectInstance::launchNodeRender(const TreeRenderExecutionDataPtr& requestPassSh
 
     // Notify that we are done rendering
     requestData->notifyRenderFinished(stat);
+
+    if (stat == eActionStatusOK) {
+        // Let the other frames of the range re-use the image if this node is the root of a time-invariant subgraph
+        TreeRenderBatchPtr batch = getCurrentRender()->getBatch();
+        if (batch) {
+            batch->setSharedResult(shared_from_this(), requestData);
+        }
+    }
     return stat;
 } // launchNodeRender
 
@@ -1615,7 +2155,7 @@ static void finishProducedPlanesTilesStatesMap(const std::map<ImagePlaneDesc, Im
 }
 
 ActionRetCodeEnum
-EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestData)
+EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPassSharedData, const FrameViewRequestPtr& requestData, bool allowPendingTilesRetCode)
 {
     assert(isRenderClone() && getCurrentRender());
 
@@ -1644,7 +2184,7 @@ EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPa
     {
         ImageBitDepthEnum outputBitDepth = getBitDepth(-1);
         int tileWidth, tileHeight;
-        CacheBase::getTileSizePx(outputBitDepth, &tileWidth, &tileHeight);
+        appPTR->getTileCache()->getTileSizePx(outputBitDepth, &tileWidth, &tileHeight);
         assert(renderMappedRoI.x1 % tileWidth == 0 || renderMappedRoI.x1 == perMipMapLevelRoDPixel[mappedMipMapLevel].x1);
         assert(renderMappedRoI.y1 % tileHeight == 0 || renderMappedRoI.y1 == perMipMapLevelRoDPixel[mappedMipMapLevel].y1);
         assert(renderMappedRoI.x2 % tileWidth == 0 || renderMappedRoI.x2 == perMipMapLevelRoDPixel[mappedMipMapLevel].x2);
@@ -1668,6 +2208,13 @@ EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPa
 
     RenderBackendTypeEnum backendType = requestData->getRenderDevice();
 
+    const RenderBackendTypeEnum outputBackendType = EffectInstance::Implementation::getOutputImagesBackendType(requestData, backendType);
+
+    // The texture is about to be rendered again: a readback started by a previous render would be outdated
+    if (outputBackendType == eRenderBackendTypeOpenGL) {
+        fullscalePlane->discardGPUReadback();
+    }
+
     const bool renderAllProducedPlanes = isRenderAllPlanesAtOncePreferred();
 
     for (std::list<ImagePlaneDesc>::const_iterator it = producedPlanes.begin(); it != producedPlanes.end(); ++it) {
@@ -1678,7 +2225,7 @@ EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPa
             if (!renderAllProducedPlanes) {
                 continue;
             } else {
-                imagePlane = _imp->createCachedImage(renderMappedRoI, perMipMapLevelRoDPixel, mappedMipMapLevel, requestData->getProxyScale(), *it, backendType, requestData->getCachePolicy(), false /*delayAllocation*/);
+                imagePlane = _imp->createCachedImage(renderMappedRoI, perMipMapLevelRoDPixel, mappedMipMapLevel, requestData->getProxyScale(), *it, outputBackendType, requestData->getCachePolicy(), false /*delayAllocation*/);
                 ActionRetCodeEnum stat = imagePlane->getCacheEntry()->fetchCachedTilesAndUpdateStatus(false, NULL, NULL, NULL);
                 if (isFailureRetCode(stat)) {
                     finishProducedPlanesTilesStatesMap(cachedImagePlanes, true);
@@ -1692,9 +2239,19 @@ EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPa
 
 
     ActionRetCodeEnum renderRetCode = eActionStatusOK;
-    std::list<RectToRender> renderRects;
+    RectToRenderVec renderRects;
     bool hasPendingTiles;
 
+    // If the render is launched again after waiting for tiles pending in another thread, these tiles may have been rendered
+    // since requestRender(): refresh the tiles state of the requested plane. The other produced planes were just fetched above.
+    if (requestData->isResumedAfterPendingTiles()) {
+        renderRetCode = fullscalePlane->getCacheEntry()->fetchCachedTilesAndUpdateStatus(false, NULL, NULL, NULL);
+        if (isFailureRetCode(renderRetCode)) {
+            finishProducedPlanesTilesStatesMap(cachedImagePlanes, true);
+            return renderRetCode;
+        }
+    }
+
     // Initialize what's left to render, without fetching the tiles state map from the cache because it was already fetched in
     // requestRender()
     renderRetCode = _imp->checkRestToRender(false /*updateTilesStateFromCache*/, requestData, renderMappedRoI, mappedCombinedScale, cachedImagePlanes, &renderRects, &hasPendingTiles);
@@ -1710,7 +2267,13 @@ EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPa
         // There may be no rectangles to render if all rectangles are pending (i.e: this render should wait for another thread
         // to complete the render first)
         if (!renderRects.empty()) {
-            renderRetCode = _imp->launchRenderForSafetyAndBackend(requestData, mappedCombinedScale, backendType, renderRects, cachedImagePlanes);
+            if (requestData->isStreamedRender()) {
+                renderRetCode = _imp->launchStreamedRender(requestData, mappedCombinedScale, backendType, renderRects, cachedImagePlanes);
+            } else if (outputBackendType != backendType) {
+                renderRetCode = _imp->launchTiledOpenGLRender(requestData, mappedCombinedScale, renderRects, cachedImagePlanes);
+            } else {
+                renderRetCode = _imp->launchRenderForSafetyAndBackend(requestData, mappedCombinedScale, backendType, renderRects, cachedImagePlanes);
+            }
         }
 
         if (isFailureRetCode(renderRetCode)) {
@@ -1721,6 +2284,12 @@ EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPa
         // Mark what we rendered in the tiles state map
         finishProducedPlanesTilesStatesMap(cachedImagePlanes, false /*aborted*/);
 
+        // Instead of blocking this thread until the other threads are done with the pending tiles, give it back to the caller
+        // which launches this render again when they are marked rendered.
+        if (hasPendingTiles && allowPendingTilesRetCode) {
+            return eActionStatusPendingTiles;
+        }
+
         // Wait for any pending results for the requested plane.
         // After this line other threads that should have computed should be done
         if (fullscalePlane->getCacheEntry()->waitForPendingTiles()) {
@@ -1787,7 +2356,7 @@ EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPa
 
         ImageBitDepthEnum outputBitDepth = getBitDepth(-1);
         int tileWidth, tileHeight;
-        CacheBase::getTileSizePx(outputBitDepth, &tileWidth, &tileHeight);
+        appPTR->getTileCache()->getTileSizePx(outputBitDepth, &tileWidth, &tileHeight);
         downscaledRoI.roundToTileSize(tileWidth, tileHeight);
         // Make sure the RoI falls within the image bounds
         if ( !downscaledRoI.intersect(perMipMapLevelRoDPixel[requestData->getMipMapLevel()], &downscaledRoI) ) {
@@ -1800,35 +2369,69 @@ EffectInstance::launchRenderInternal(const TreeRenderExecutionDataPtr& requestPa
 
         ImagePtr downscaledImage;
 
-        bool hasUnrenderedTile, hasPendingTiles;
-        ActionRetCodeEnum stat = _imp->lookupCachedImage(dstMipMapLevel, requestData->getProxyScale(), requestData->getPlaneDesc(), perMipMapLevelRoDPixel, downscaledRoI, eCacheAccessModeReadWrite, backendType, false, &downscaledImage, &hasPendingTiles, &hasUnrenderedTile);
-
-        if (isFailureRetCode(stat)) {
-            return stat;
-        }
-
-        // We just rendered the full scale version, no tiles should be marked unrendered.
-        // In some cases, the image might no longer be in the Cache if the Cache was cleared. In this case, manually downscale
-        // the image
-        if (hasUnrenderedTile) {
-            downscaledImage->getCacheEntry()->markCacheTilesAsAborted();
+        if (fullscalePlane->getStorageMode() == eStorageModeGLTex) {
+            // OpenGL renders are not in the tile cache: downscale the texture on the GPU
             downscaledImage = fullscalePlane->downscaleMipMap(fullscalePlane->getBounds(), dstMipMapLevel - mappedMipMapLevel);
+            if (!downscaledImage) {
+                return eActionStatusFailed;
+            }
+            requestData->setRequestedScaleImagePlane(downscaledImage);
         } else {
-            // However another thread could have marked pending the tiles at dstMipMapLevel in between, thus we just have to wait for it to be read
-            if (hasPendingTiles) {
-                if (!downscaledImage->getCacheEntry()->waitForPendingTiles()) {
-                    downscaledImage->getCacheEntry()->markCacheTilesAsAborted();
-                    return eActionStatusAborted;
-                }
+
+            bool hasUnrenderedTile, hasPendingTiles;
+            ActionRetCodeEnum stat = _imp->lookupCachedImage(dstMipMapLevel, requestData->getProxyScale(), requestData->getPlaneDesc(), perMipMapLevelRoDPixel, downscaledRoI, eCacheAccessModeReadWrite, outputBackendType, false, &downscaledImage, &hasPendingTiles, &hasUnrenderedTile);
+
+            if (isFailureRetCode(stat)) {
+                return stat;
             }
-            downscaledImage->getCacheEntry()->markCacheTilesAsRendered();
-        }
 
+            // We just rendered the full scale version, no tiles should be marked unrendered.
+            // In some cases, the image might no longer be in the Cache if the Cache was cleared. In this case, manually downscale
+            // the image
+            if (hasUnrenderedTile) {
+                downscaledImage->getCacheEntry()->markCacheTilesAsAborted();
+                downscaledImage = fullscalePlane->downscaleMipMap(fullscalePlane->getBounds(), dstMipMapLevel - mappedMipMapLevel);
+            } else {
+                // However another thread could have marked pending the tiles at dstMipMapLevel in between, thus we just have to wait for it to be read
+                if (hasPendingTiles) {
+                    if (!downscaledImage->getCacheEntry()->waitForPendingTiles()) {
+                        downscaledImage->getCacheEntry()->markCacheTilesAsAborted();
+                        return eActionStatusAborted;
+                    }
+                }
+                downscaledImage->getCacheEntry()->markCacheTilesAsRendered();
+            }
 
+            requestData->setRequestedScaleImagePlane(downscaledImage);
+        }
+    }
 
+    // Keep the texture for the next renders using the same context. If the effect rendered at full scale, this is
+    // the downscaled texture so that zoomed-out viewers get it directly.
+    if ( (backendType == eRenderBackendTypeOpenGL) && requestData->isGPUImageCacheEnabled() && !isRenderAborted() ) {
+        ImagePtr outputPlane = requestData->getRequestedScaleImagePlane();
+        if ( outputPlane && (outputPlane->getStorageMode() == eStorageModeGLTex) ) {
+            GPUImageCacheEntryArgs gpuCacheArgs = _imp->getGPUImageCacheEntryArgs(requestData, perMipMapLevelRoDPixel);
+            appPTR->getGPUContextPool()->getImageCache()->insert(GPUImageCache::makeKey(gpuCacheArgs), getCurrentRender()->getGPUOpenGLContext(), outputPlane, getNode(), gpuCacheArgs);
+        }
+    }
 
-        requestData->setRequestedScaleImagePlane(downscaledImage);
+    // If a node downstream renders on the CPU it will read the texture: start the transfer now
+    // so that it runs while the GPU and this thread carry on with other work.
+    if ( (backendType == eRenderBackendTypeOpenGL) && !isRenderAborted() ) {
+        std::list<FrameViewRequestPtr> listeners = requestData->getListeners(requestPassSharedData);
+        for (std::list<FrameViewRequestPtr>::const_iterator it = listeners.begin(); it != listeners.end(); ++it) {
+            EffectInstancePtr listenerEffect = (*it)->getEffect();
+            if ( listenerEffect && (listenerEffect->getOpenGLRenderSupport() == ePluginOpenGLRenderSupportNone) ) {
+                ImagePtr outputPlane = requestData->getRequestedScaleImagePlane();
+                if (outputPlane) {
+                    outputPlane->startGPUReadback();
+                }
+                break;
+            }
+        }
     }
+
     //QString name = QString::fromUtf8(getScriptName_mt_safe().c_str()) + QString::fromUtf8("_") + QString::number(getCurrentRenderTime()) + QString::fromUtf8("_") +  QDateTime::currentDateTime().toString() + QString::fromUtf8(".png");
     //if (isDuringPaintStrokeCreation()) {
     /*if (getNode()->getPluginID() == PLUGINID_OFX_ROTOMERGE) {
@@ -1848,10 +2451,17 @@ class HostFrameThreadingRenderProcessor : public MultiThreadProcessorBase
     boost::shared_ptr<EffectInstance::Implementation::TiledRenderingFunctorArgs> _args;
     EffectInstance::Implementation* _imp;
 
+    // The index of the next rectangle to render: the threads pull the rectangles until there are none left
+    QAtomicInt _nextRect;
+
 public:
 
     HostFrameThreadingRenderProcessor(const EffectInstancePtr& renderClone)
     : MultiThreadProcessorBase(renderClone)
+    , _rectsToRender()
+    , _args()
+    , _imp(0)
+    , _nextRect()
     {
 
     }
@@ -1861,29 +2471,41 @@ public:
 
     }
 
-    void setData(const std::list<RectToRender> &rectsToRender, const boost::shared_ptr<EffectInstance::Implementation::TiledRenderingFunctorArgs>& args, EffectInstance::Implementation* imp)
+    void setData(const RectToRenderVec &rectsToRender, const boost::shared_ptr<EffectInstance::Implementation::TiledRenderingFunctorArgs>& args, EffectInstance::Implementation* imp)
     {
         int i = 0;
         _rectsToRender.resize(rectsToRender.size());
-        for (std::list<RectToRender>::const_iterator it = rectsToRender.begin(); it != rectsToRender.end(); ++it, ++i) {
+        for (RectToRenderVec::const_iterator it = rectsToRender.begin(); it != rectsToRender.end(); ++it, ++i) {
             _rectsToRender[i] = *it;
         }
         _args = args;
         _imp = imp;
+        _nextRect.fetchAndStoreRelaxed(0);
     }
 
+    int getNumRects() const
+    {
+        return (int)_rectsToRender.size();
+    }
 
-    virtual ActionRetCodeEnum multiThreadFunction(unsigned int threadID,
-                                                  unsigned int nThreads) OVERRIDE FINAL WARN_UNUSED_RETURN
+
+    virtual ActionRetCodeEnum multiThreadFunction(unsigned int /*threadID*/,
+                                                  unsigned int /*nThreads*/) OVERRIDE FINAL WARN_UNUSED_RETURN
     {
         // If this plug-in has TLS, clear the action stack since it has been copied from the caller thread.
         EffectInstanceTLSDataPtr tlsData = _imp->_publicInterface->getTLSObject();
         if (tlsData) {
             tlsData->clearActionStack();
         }
-        int fromIndex, toIndex;
-        ImageMultiThreadProcessorBase::getThreadRange(threadID, nThreads, 0, _rectsToRender.size(), &fromIndex, &toIndex);
-        for (int i = fromIndex; i < toIndex; ++i) {
+        for (;;) {
+            // Do not start rendering another rectangle once the render is aborted
+            if ( _imp->_publicInterface->isRenderAborted() ) {
+                return eActionStatusAborted;
+            }
+            int i = _nextRect.fetchAndAddRelaxed(1);
+            if ( i >= (int)_rectsToRender.size() ) {
+                break;
+            }
             ActionRetCodeEnum stat = _imp->tiledRenderingFunctor(_rectsToRender[i], *_args);
             if (isFailureRetCode(stat)) {
                 return stat;
@@ -1899,7 +2521,7 @@ EffectInstance::Implementation::launchPluginRenderAndHostFrameThreading(const Fr
                                                                         const EffectOpenGLContextDataPtr& glContextData,
                                                                         const RenderScale& combinedScale,
                                                                         RenderBackendTypeEnum backendType,
-                                                                        const std::list<RectToRender>& renderRects,
+                                                                        const RectToRenderVec& renderRects,
                                                                         const std::map<ImagePlaneDesc, ImagePtr>& cachedPlanes)
 {
     assert( !renderRects.empty() );
@@ -1955,7 +2577,8 @@ EffectInstance::Implementation::launchPluginRenderAndHostFrameThreading(const Fr
 #else
     const bool attemptHostFrameThreading = _publicInterface->getRenderThreadSafety() == eRenderSafetyFullySafeFrame &&
                                            renderRects.size() > 1 &&
-                                           backendType == eRenderBackendTypeCPU;
+                                           backendType == eRenderBackendTypeCPU &&
+                                           !isMemoryBudgetExceeded();
 #endif
 
 
@@ -1969,9 +2592,12 @@ EffectInstance::Implementation::launchPluginRenderAndHostFrameThreading(const Fr
     // Pre-fetch all input images that will be needed by identity rectangles so that the call to getImagePlane
     // is done once for each of them.
 
+    // The identity rectangles are copied to the output images: fetch the inputs in the same storage
+    RenderBackendTypeEnum identityBackendType = getOutputImagesBackendType(requestData, backendType);
+
     // Get the bbox to fetch in input for identity rectangles
     RectI identityRectanglesBbox;
-    for (std::list<RectToRender>::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
+    for (RectToRenderVec::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
         if (it->identityInputNumber == -1) {
             continue;
         }
@@ -1981,7 +2607,7 @@ EffectInstance::Implementation::launchPluginRenderAndHostFrameThreading(const Fr
             identityRectanglesBbox.merge(it->rect);
         }
     }
-    for (std::list<RectToRender>::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
+    for (RectToRenderVec::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
         if (it->identityInputNumber == -1) {
             continue;
         }
@@ -2008,7 +2634,7 @@ EffectInstance::Implementation::launchPluginRenderAndHostFrameThreading(const Fr
             }
 
             boost::scoped_ptr<EffectInstance::GetImageInArgs> inArgs( new EffectInstance::GetImageInArgs() );
-            inArgs->renderBackend = &backendType;
+            inArgs->renderBackend = &identityBackendType;
             inArgs->currentRenderWindow = &identityRectanglesBbox;
             inArgs->inputTime = &it->identityTime;
             inArgs->inputView = &it->identityView;
@@ -2029,19 +2655,19 @@ EffectInstance::Implementation::launchPluginRenderAndHostFrameThreading(const Fr
 
     if (!attemptHostFrameThreading) {
 
-        for (std::list<RectToRender>::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
+        for (RectToRenderVec::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
 
             ActionRetCodeEnum functorRet = tiledRenderingFunctor(*it, *functorArgs);
             if (isFailureRetCode(functorRet)) {
                 return functorRet;
             }
 
-        } // for (std::list<RectI>::const_iterator it = rectsToRender.begin(); it != rectsToRender.end(); ++it) {
+        } // for (RectToRenderVec::const_iterator it = renderRects.begin(); it != renderRects.end(); ++it) {
 
     } else { // attemptHostFrameThreading
         HostFrameThreadingRenderProcessor processor(_publicInterface->shared_from_this());
         processor.setData(renderRects, functorArgs, this);
-        ActionRetCodeEnum stat = processor.launchThreadsBlocking();
+        ActionRetCodeEnum stat = processor.launchThreadsBlocking( std::min( processor.getNumRects(), std::max(1, appPTR->getMaxThreadCount()) ) );
         if (isFailureRetCode(stat)) {
             return stat;
         }
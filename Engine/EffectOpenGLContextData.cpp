@@ -38,13 +38,8 @@ struct EffectOpenGLContextDataPrivate
 
     bool isGPUContext;
 
-    // True if we did not unlock the context mutex in attachOpenGLContext()
-    bool hasTakenLock;
-
-
     EffectOpenGLContextDataPrivate(bool isGPUContext)
     : isGPUContext(isGPUContext)
-    , hasTakenLock(false)
     {
 
     }
@@ -66,18 +61,6 @@ EffectOpenGLContextData::isGPUContext() const
     return _imp->isGPUContext;
 }
 
-void
-EffectOpenGLContextData::setHasTakenLock(bool b)
-{
-    _imp->hasTakenLock = b;
-}
-
-bool
-EffectOpenGLContextData::getHasTakenLock() const
-{
-    return _imp->hasTakenLock;
-}
-
 
 
 NATRON_NAMESPACE_EXIT
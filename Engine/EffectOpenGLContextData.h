@@ -47,10 +47,6 @@ public:
 
     virtual ~EffectOpenGLContextData();
 
-    void setHasTakenLock(bool b);
-
-    bool getHasTakenLock() const;
-
     bool isGPUContext() const;
     
 private:
@@ -69,6 +69,9 @@ INCLUDEPATH += $$PWD/../libs/exprtk
 # hoedown
 INCLUDEPATH += $$PWD/../libs/hoedown/src
 
+# qhttpserver
+INCLUDEPATH += $$PWD/../libs/qhttpserver/src
+
 #To overcome wrongly generated #include <...> by shiboken
 INCLUDEPATH += $$PWD
 INCLUDEPATH += $$PWD/NatronEngine
@@ -99,10 +102,17 @@ SOURCES += \
     Bezier.cpp \
     BezierCP.cpp \
     CLArgs.cpp \
+    CPUInstructionSet.cpp \
     Cache.cpp \
     CacheEntryBase.cpp \
     CacheEntryKeyBase.cpp \
+    CacheFlusherThread.cpp \
+    CacheStats.cpp \
     ColorParser.cpp \
+    ColorTransform.cpp \
+    CompressedTileFile.cpp \
+    CompressedTileStorage.cpp \
+    ConcurrentFramesController.cpp \
     CoonsRegularization.cpp \
     CornerPinOverlayInteract.cpp \
     CreateNodeArgs.cpp \
@@ -111,6 +121,7 @@ SOURCES += \
     DefaultRenderScheduler.cpp \
     DiskCacheNode.cpp \
     Distortion2D.cpp \
+    DistributedRender.cpp \
     Dot.cpp \
     EffectDescription.cpp \
     EffectInstance.cpp \
@@ -125,21 +136,27 @@ SOURCES += \
     ExistenceCheckThread.cpp \
     ExprTk.cpp \
     FileDownloader.cpp \
+    FileReadAhead.cpp \
     FileSystemModel.cpp \
     FitCurve.cpp \
     Format.cpp \
     FrameViewRequest.cpp \
+    GLProgramBinaryCache.cpp \
     GPUContextPool.cpp \
+    GPUImageCache.cpp \
     GenericSchedulerThread.cpp \
     GenericSchedulerThreadWatcher.cpp \
     GroupInput.cpp \
     GroupOutput.cpp \
+    Half.cpp \
     Hash64.cpp \
     HashableObject.cpp \
+    HashProfiler.cpp \
     HistogramCPU.cpp \
     IPCCommon.cpp \
     Image.cpp \
     ImageApplyShader.cpp \
+    ImageBufferPool.cpp \
     ImageCacheEntry.cpp \
     ImageCacheKey.cpp \
     ImageConvert.cpp \
@@ -151,6 +168,7 @@ SOURCES += \
     ImageStorage.cpp \
     ImageTilesState.cpp \
     InputDescription.cpp \
+    InteractiveLatency.cpp \
     Interpolation.cpp \
     JoinViewsNode.cpp \
     KeyFrameInterpolator.cpp \
@@ -166,11 +184,15 @@ SOURCES += \
     KnobUndoCommand.cpp \
     LibraryBinary.cpp \
     LoadKnobsCompat.cpp \
+    LockProfiler.cpp \
     Log.cpp \
     Lut.cpp \
     Markdown.cpp \
     MemoryFile.cpp \
     MemoryInfo.cpp \
+    MemoryPressureMonitorThread.cpp \
+    MemoryTimelineRecorder.cpp \
+    MetricsExporter.cpp \
     MultiThread.cpp \
     NoOpBase.cpp \
     Node.cpp \
@@ -201,7 +223,10 @@ SOURCES += \
     OfxParamInstance.cpp \
     OneViewNode.cpp \
     OutputSchedulerThread.cpp \
+    OverlayDrawList.cpp \
     OverlayInteractBase.cpp \
+    PixelInspectorThread.cpp \
+    PlaybackFrameBuffer.cpp \
     Plugin.cpp \
     PluginMemory.cpp \
     PointOverlayInteract.cpp \
@@ -209,6 +234,7 @@ SOURCES += \
     ProcessFrameThread.cpp \
     ProcessHandler.cpp \
     Project.cpp \
+    ProjectAutoSaveJournal.cpp \
     ProjectPrivate.cpp \
     PropertiesHolder.cpp \
     PyAppInstance.cpp \
@@ -226,8 +252,14 @@ SOURCES += \
     ReadNode.cpp \
     RectD.cpp \
     RectI.cpp \
+    RemoteTileCache.cpp \
     RemovePlaneNode.cpp \
+    RenderArena.cpp \
+    RenderBatch.cpp \
+    RenderCheckpointJournal.cpp \
+    RenderDaemon.cpp \
     RenderEngine.cpp \
+    RenderFrameQueue.cpp \
     RenderQueue.cpp \
     RenderStats.cpp \
     RotoBezierTriangulation.cpp \
@@ -249,19 +281,27 @@ SOURCES += \
     Smooth1D.cpp \
     SplitterI.cpp \
     StandardPaths.cpp \
+    StartupProfiler.cpp \
     StorageDeleterThread.cpp \
     StubNode.cpp \
     TLSHolder.cpp \
     TabWidgetI.cpp \
     Texture.cpp \
+    ThreadPlacement.cpp \
     ThreadPool.cpp \
+    ThreadPoolMonitor.cpp \
+    TileArchive.cpp \
+    TileCompression.cpp \
     TimeLine.cpp \
     Timer.cpp \
+    TraceRecorder.cpp \
     TrackArgs.cpp \
     TrackMarker.cpp \
     TrackScheduler.cpp \
     TrackerDetect.cpp \
     TrackerFrameAccessor.cpp \
+    TrackerFramePrefetcher.cpp \
+    TrackerGPUMatcher.cpp \
     TrackerHelper.cpp \
     TrackerHelperPrivate.cpp \
     TrackerNode.cpp \
@@ -270,10 +310,12 @@ SOURCES += \
     Transform.cpp \
     TransformOverlayInteract.cpp \
     TreeRender.cpp \
+    TreeRenderBatch.cpp \
     TreeRenderQueueManager.cpp \
     TreeRenderQueueProvider.cpp \
     Utils.cpp \
     ViewIdx.cpp \
+    ViewerCacheWarmer.cpp \
     ViewerDisplayScheduler.cpp \
     ViewerInstance.cpp \
     ViewerNode.cpp \
@@ -354,13 +396,21 @@ HEADERS += \
     Bezier.h \
     BezierCP.h \
     BezierCPPrivate.h \
+    BoundedRingBuffer.h \
     CLArgs.h \
+    CPUInstructionSet.h \
     Cache.h \
     CacheEntryBase.h \
     CacheEntryKeyBase.h \
+    CacheFlusherThread.h \
+    CacheStats.h \
     ChoiceOption.h \
     Color.h \
     ColorParser.h \
+    ColorTransform.h \
+    CompressedTileFile.h \
+    CompressedTileStorage.h \
+    ConcurrentFramesController.h \
     CoonsRegularization.h \
     CornerPinOverlayInteract.h \
     CreateNodeArgs.h \
@@ -371,6 +421,7 @@ HEADERS += \
     DimensionIdx.h \
     DiskCacheNode.h \
     Distortion2D.h \
+    DistributedRender.h \
     DockablePanelI.h \
     Dot.h \
     EffectDescription.h \
@@ -383,21 +434,27 @@ HEADERS += \
     ExistenceCheckThread.h \
     FeatherPoint.h \
     FileDownloader.h \
+    FileReadAhead.h \
     FileSystemModel.h \
     FitCurve.h \
     Format.h \
     FrameViewRequest.h \
+    GLProgramBinaryCache.h \
     GLShader.h \
     GPUContextPool.h \
+    GPUImageCache.h \
     GenericSchedulerThread.h \
     GenericSchedulerThreadWatcher.h \
     GroupInput.h \
     GroupOutput.h \
+    Half.h \
     Hash64.h \
     HashableObject.h \
+    HashProfiler.h \
     HistogramCPU.h \
     IPCCommon.h \
     Image.h \
+    ImageBufferPool.h \
     ImageCacheEntry.h \
     ImageCacheEntryProcessing.h \
     ImageCacheKey.h \
@@ -406,6 +463,7 @@ HEADERS += \
     ImageStorage.h \
     ImageTilesState.h \
     InputDescription.h \
+    InteractiveLatency.h \
     Interpolation.h \
     JoinViewsNode.h \
     KeyFrameInterpolator.h \
@@ -424,12 +482,16 @@ HEADERS += \
     KnobUndoCommand.h \
     LibraryBinary.h \
     LoadKnobsCompat.h \
+    LockProfiler.h \
     Log.h \
     LogEntry.h \
     Lut.h \
     Markdown.h \
     MemoryFile.h \
     MemoryInfo.h \
+    MemoryPressureMonitorThread.h \
+    MemoryTimelineRecorder.h \
+    MetricsExporter.h \
     MergingEnum.h \
     MultiThread.h \
     NoOpBase.h \
@@ -456,8 +518,11 @@ HEADERS += \
     OneViewNode.h \
     OpenGLViewerI.h \
     OutputSchedulerThread.h \
+    OverlayDrawList.h \
     OverlayInteractBase.h \
     OverlaySupport.h \
+    PixelInspectorThread.h \
+    PlaybackFrameBuffer.h \
     Plugin.h \
     PluginActionShortcut.h \
     PluginMemory.h \
@@ -466,6 +531,7 @@ HEADERS += \
     ProcessFrameThread.h \
     ProcessHandler.h \
     Project.h \
+    ProjectAutoSaveJournal.h \
     ProjectPrivate.h \
     PropertiesHolder.h \
     PyAppInstance.h \
@@ -485,8 +551,14 @@ HEADERS += \
     ReadNode.h \
     RectD.h \
     RectI.h \
+    RemoteTileCache.h \
     RemovePlaneNode.h \
+    RenderArena.h \
+    RenderBatch.h \
+    RenderCheckpointJournal.h \
+    RenderDaemon.h \
     RenderEngine.h \
+    RenderFrameQueue.h \
     RenderQueue.h \
     RenderStats.h \
     RotoBezierTriangulation.h \
@@ -506,25 +578,34 @@ HEADERS += \
     SerializableWindow.h \
     Settings.h \
     Singleton.h \
+    SmallVector.h \
     SplitterI.h \
     StandardPaths.h \
+    StartupProfiler.h \
     StorageDeleterThread.h \
     StubNode.h \
     TLSHolder.h \
     TLSHolderImpl.h \
     TabWidgetI.h \
     Texture.h \
+    ThreadPlacement.h \
     ThreadPool.h \
+    ThreadPoolMonitor.h \
     ThreadStorage.h \
+    TileArchive.h \
+    TileCompression.h \
     TimeLine.h \
     TimeLineKeys.h \
     TimeValue.h \
     Timer.h \
+    TraceRecorder.h \
     TrackArgs.h \
     TrackMarker.h \
     TrackScheduler.h \
     TrackerDetect.h \
     TrackerFrameAccessor.h \
+    TrackerFramePrefetcher.h \
+    TrackerGPUMatcher.h \
     TrackerHelper.h \
     TrackerHelperPrivate.h \
     TrackerNode.h \
@@ -533,12 +614,14 @@ HEADERS += \
     Transform.h \
     TransformOverlayInteract.h \
     TreeRender.h \
+    TreeRenderBatch.h \
     TreeRenderQueueManager.h \
     TreeRenderQueueProvider.h \
     UndoCommand.h \
     Utils.h \
     Variant.h \
     ViewIdx.h \
+    ViewerCacheWarmer.h \
     ViewerDisplayScheduler.h \
     ViewerInstance.h \
     ViewerNode.h \
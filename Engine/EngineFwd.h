@@ -140,9 +140,16 @@ class CacheBase;
 class CacheEntryBase;
 class CacheEntryKeyBase;
 class CacheEntryLockerBase;
+class CacheFlusherThread;
 class CacheImageTileStorage;
+class CacheListener;
 class CacheSignalEmitter;
+class CacheStats;
+class ColorTransform;
+class ColorTransformStack;
 class CompNodeItem;
+class CompressedTileFile;
+class CompressedTileStorage;
 class CreateNodeArgs;
 class Curve;
 class CurveChangesListener;
@@ -150,6 +157,7 @@ class DimIdx;
 class DiskCacheNode;
 class Distortion2DStack;
 class DistortionFunction2D;
+class DistributedRender;
 class DockablePanelI;
 class Dot;
 class EffectDescription;
@@ -163,9 +171,11 @@ class Format;
 class FrameViewRequest;
 class FramebufferConfig;
 class GLImageStorage;
+class GLProgramBinaryCache;
 class GLRendererID;
 class GLShaderBase;
 class GPUContextPool;
+class GPUImageCache;
 class GenericAccess;
 class GenericActionTLSArgs;
 class GenericSchedulerThread;
@@ -191,6 +201,7 @@ class Hash64;
 class HashableObject;
 class HistogramCPUThread;
 class Image;
+class ImageBufferPool;
 class ImageCacheEntry;
 class ImageCacheKey;
 class ImagePlaneDesc;
@@ -233,12 +244,17 @@ class KnobTableItem;
 class LayeredCompNode;
 class LibraryBinary;
 class LogEntry;
+class MemoryBudget;
 class MemoryFile;
+class MemoryPressureMonitorThread;
+class MemoryTimelineRecorder;
+class MetricsExporter;
 class MultiThread;
 class NamedKnobHolder;
 class NoOpBase;
 class Node;
 class NodeCollection;
+class NodeCollectionTopology;
 class NodeGraphI;
 class NodeGroup;
 class NodeGuiI;
@@ -263,10 +279,13 @@ class OutputSchedulerThread;
 class OutputSchedulerThreadStartArgs;
 class OverlayInteractBase;
 class OverlaySupport;
+class PixelInspectorThread;
 class PlanarTrackLayer;
+class PlaybackFrameBuffer;
 class Plugin;
 class PluginGroupNode;
 class PluginMemory;
+class PluginMemoryCache;
 class PointOverlayInteract;
 class PrecompNode;
 class ProcessHandler;
@@ -278,11 +297,18 @@ class RAMImageStorage;
 class ReadNode;
 class RectD;
 class RectI;
+class RemoteTileCache;
 class RenderActionTLSData;
+class RenderArena;
+class RenderBatch;
+class RenderCheckpointJournal;
+class RenderDaemon;
 class RenderEngine;
+class RenderFrameQueue;
 class RenderFrameResultsContainer;
 class RenderQueue;
 class RenderStats;
+class RenderStatsAccumulator;
 class RotoDrawableItem;
 class RotoItem;
 class RotoLayer;
@@ -299,6 +325,7 @@ class StubNode;
 class TLSHolderBase;
 class TabWidgetI;
 class Texture;
+class TileArchive;
 class TextureRect;
 class TimeLapse;
 class TimeLine;
@@ -308,22 +335,27 @@ class TrackMarker;
 class TrackMarkerAndOptions;
 class TrackMarkerPM;
 class TrackerFrameAccessor;
+class TrackerFramePrefetcher;
+class TrackerGPUMatcher;
 class TrackerHelper;
 class TrackerNode;
 class TrackerParamsProvider;
 class TrackerParamsProviderBase;
 class TreeRender;
+class TreeRenderBatch;
 class TreeRenderExecutionData;
 class TreeRenderQueueManager;
 class TreeRenderQueueProvider;
 class UndoCommand;
 class ViewIdx;
 class ViewerCurrentFrameRequestRendererBackup;
+class ViewerCacheWarmer;
 class ViewerCurrentFrameRequestScheduler;
 class ViewerCurrentFrameRequestSchedulerStartArgs;
 class ViewerInstance;
 class ViewerNode;
 class WriteNode;
+struct CacheNodeCounters;
 struct FrameViewRenderKey;
 template<bool persistent> class Cache;
 template<bool persistent> class CacheEntryLocker;
@@ -354,7 +386,10 @@ typedef boost::shared_ptr<CacheEntryBase> CacheEntryBasePtr;
 typedef boost::shared_ptr<CacheEntryKeyBase> CacheEntryKeyBasePtr;
 typedef boost::shared_ptr<CacheEntryLockerBase> CacheEntryLockerBasePtr;
 typedef boost::shared_ptr<CacheImageTileStorage> CacheImageTileStoragePtr;
+typedef boost::shared_ptr<CacheListener> CacheListenerPtr;
+typedef boost::shared_ptr<ColorTransformStack> ColorTransformStackPtr;
 typedef boost::shared_ptr<CompNodeItem> CompNodeItemPtr;
+typedef boost::shared_ptr<CompressedTileFile> CompressedTileFilePtr;
 typedef boost::shared_ptr<CreateNodeArgs> CreateNodeArgsPtr;
 typedef boost::shared_ptr<Curve> CurvePtr;
 typedef boost::shared_ptr<CurveChangesListener> CurveChangesListenerPtr;
@@ -434,12 +469,14 @@ typedef boost::shared_ptr<KnobTableItem const> KnobTableItemConstPtr;
 typedef boost::shared_ptr<KnobTableItem> KnobTableItemPtr;
 typedef boost::shared_ptr<LayeredCompNode> LayeredCompNodePtr;
 typedef boost::shared_ptr<LibraryBinary> LibraryBinaryPtr;
+typedef boost::shared_ptr<MemoryBudget> MemoryBudgetPtr;
 typedef boost::shared_ptr<MemoryFile> MemoryFilePtr;
 typedef boost::shared_ptr<NamedKnobHolder> NamedKnobHolderPtr;
 typedef boost::shared_ptr<NoOpBase> NoOpBasePtr;
 typedef boost::shared_ptr<Node const> NodeConstPtr;
 typedef boost::shared_ptr<Node> NodePtr;
 typedef boost::shared_ptr<NodeCollection> NodeCollectionPtr;
+typedef boost::shared_ptr<NodeCollectionTopology const> NodeCollectionTopologyConstPtr;
 typedef boost::shared_ptr<NodeGroup> NodeGroupPtr;
 typedef boost::shared_ptr<NodeGuiI> NodeGuiIPtr;
 typedef boost::shared_ptr<NodeMetadata> NodeMetadataPtr;
@@ -453,10 +490,13 @@ typedef boost::shared_ptr<OpenGLViewerI> OpenGLViewerIPtr;
 typedef boost::shared_ptr<OutputSchedulerThread> OutputSchedulerThreadPtr;
 typedef boost::shared_ptr<OutputSchedulerThreadStartArgs> OutputSchedulerThreadStartArgsPtr;
 typedef boost::shared_ptr<OverlayInteractBase> OverlayInteractBasePtr;
+typedef boost::shared_ptr<PixelInspectorThread> PixelInspectorThreadPtr;
 typedef boost::shared_ptr<PlanarTrackLayer> PlanarTrackLayerPtr;
+typedef boost::shared_ptr<PlaybackFrameBuffer> PlaybackFrameBufferPtr;
 typedef boost::shared_ptr<Plugin> PluginPtr;
 typedef boost::shared_ptr<PluginGroupNode> PluginGroupNodePtr;
 typedef boost::shared_ptr<PluginMemory> PluginMemoryPtr;
+typedef boost::shared_ptr<PluginMemoryCache> PluginMemoryCachePtr;
 typedef boost::shared_ptr<PointOverlayInteract> PointOverlayInteractPtr;
 typedef boost::shared_ptr<PrecompNode> PrecompNodePtr;
 typedef boost::shared_ptr<ProcessHandler> ProcessHandlerPtr;
@@ -464,6 +504,8 @@ typedef boost::shared_ptr<Project> ProjectPtr;
 typedef boost::shared_ptr<RAMImageStorage> RAMImageStoragePtr;
 typedef boost::shared_ptr<ReadNode> ReadNodePtr;
 typedef boost::shared_ptr<RenderActionTLSData> RenderActionTLSDataPtr;
+typedef boost::shared_ptr<RenderArena> RenderArenaPtr;
+typedef boost::shared_ptr<RenderCheckpointJournal> RenderCheckpointJournalPtr;
 typedef boost::shared_ptr<RenderEngine> RenderEnginePtr;
 typedef boost::shared_ptr<RenderFrameResultsContainer> RenderFrameResultsContainerPtr;
 typedef boost::shared_ptr<RenderQueue> RenderQueuePtr;
@@ -490,16 +532,20 @@ typedef boost::shared_ptr<TrackMarker> TrackMarkerPtr;
 typedef boost::shared_ptr<TrackMarkerAndOptions> TrackMarkerAndOptionsPtr;
 typedef boost::shared_ptr<TrackMarkerPM> TrackMarkerPMPtr;
 typedef boost::shared_ptr<TrackerFrameAccessor> TrackerFrameAccessorPtr;
+typedef boost::shared_ptr<TrackerFramePrefetcher> TrackerFramePrefetcherPtr;
+typedef boost::shared_ptr<TrackerGPUMatcher> TrackerGPUMatcherPtr;
 typedef boost::shared_ptr<TrackerHelper> TrackerHelperPtr;
 typedef boost::shared_ptr<TrackerNode> TrackerNodePtr;
 typedef boost::shared_ptr<TrackerParamsProvider> TrackerParamsProviderPtr;
 typedef boost::shared_ptr<TrackerParamsProviderBase> TrackerParamsProviderBasePtr;
 typedef boost::shared_ptr<TreeRender> TreeRenderPtr;
+typedef boost::shared_ptr<TreeRenderBatch> TreeRenderBatchPtr;
 typedef boost::shared_ptr<TreeRenderExecutionData> TreeRenderExecutionDataPtr;
 typedef boost::shared_ptr<TreeRenderQueueManager> TreeRenderQueueManagerPtr;
 typedef boost::shared_ptr<TreeRenderQueueProvider const> TreeRenderQueueProviderConstPtr;
 typedef boost::shared_ptr<TreeRenderQueueProvider> TreeRenderQueueProviderPtr;
 typedef boost::shared_ptr<UndoCommand> UndoCommandPtr;
+typedef boost::shared_ptr<ViewerCacheWarmer> ViewerCacheWarmerPtr;
 typedef boost::shared_ptr<ViewerCurrentFrameRequestScheduler> ViewerCurrentFrameRequestSchedulerPtr;
 typedef boost::shared_ptr<ViewerInstance> ViewerInstancePtr;
 typedef boost::shared_ptr<ViewerNode> ViewerNodePtr;
@@ -509,6 +555,7 @@ typedef boost::weak_ptr<AnimatingObjectI> AnimatingObjectIWPtr;
 typedef boost::weak_ptr<AppInstance> AppInstanceWPtr;
 typedef boost::weak_ptr<Bezier> BezierWPtr;
 typedef boost::weak_ptr<CacheBase> CacheBaseWPtr;
+typedef boost::weak_ptr<CacheListener> CacheListenerWPtr;
 typedef boost::weak_ptr<CompNodeItem> CompNodeItemWPtr;
 typedef boost::weak_ptr<Curve> CurveWPtr;
 typedef boost::weak_ptr<CurveChangesListener> CurveChangesListenerWPtr;
@@ -548,6 +595,7 @@ typedef boost::weak_ptr<OverlayInteractBase> OverlayInteractBaseWPtr;
 typedef boost::weak_ptr<Plugin> PluginWPtr;
 typedef boost::weak_ptr<PluginGroupNode> PluginGroupNodeWPtr;
 typedef boost::weak_ptr<PluginMemory> PluginMemoryWPtr;
+typedef boost::weak_ptr<PluginMemoryCache> PluginMemoryCacheWPtr;
 typedef boost::weak_ptr<Project> ProjectWPtr;
 typedef boost::weak_ptr<RenderEngine> RenderEngineWPtr;
 typedef boost::weak_ptr<RotoDrawableItem> RotoDrawableItemWPtr;
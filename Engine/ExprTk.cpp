@@ -29,9 +29,12 @@
 #include <sstream> // stringstream
 #include <string>
 
+#include <QtCore/QAtomicInt>
+
 #include "Engine/KnobItemsTable.h"
 #include "Engine/Noise.h"
 #include "Engine/PyExprUtils.h"
+#include "Engine/ThreadStorage.h"
 #include "Global/StrUtils.h"
 
 // reduce object size:
@@ -151,12 +154,70 @@ struct KnobExprExprTk::ExpressionData
     std::vector<std::vector<double> > vectorVariables;
 };
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// For each thread, the data of the expressions it evaluated, mapped against their generation.
+// The data is owned by the expression: the pointers expire when the expression is destroyed.
+typedef std::map<unsigned int, KnobExprExprTk::ExpressionDataWPtr> ThreadExpressionDataCache;
+
+ThreadStorage<ThreadExpressionDataCache> threadExpressionData;
+
+QAtomicInt expressionGeneration;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+KnobExprExprTk::KnobExprExprTk()
+: generation( (unsigned int)expressionGeneration.fetchAndAddRelaxed(1) )
+{
+
+}
+
 KnobExprExprTk::ExpressionDataPtr
 KnobExprExprTk::createData()
 {
     return KnobExprExprTk::ExpressionDataPtr(new ExpressionData);
 }
 
+KnobExprExprTk::ExpressionDataPtr
+KnobExprExprTk::getOrCreateThreadData()
+{
+    // Fast path: the thread already evaluated this expression
+    ThreadExpressionDataCache& cache = threadExpressionData.localData();
+    ThreadExpressionDataCache::iterator found = cache.find(generation);
+    if ( found != cache.end() ) {
+        ExpressionDataPtr ret = found->second.lock();
+        if (ret) {
+            return ret;
+        }
+    }
+
+    QThread* curThread = QThread::currentThread();
+    ExpressionDataPtr ret;
+    {
+        QMutexLocker k(&lock);
+        PerThreadDataMap::iterator foundThreadData = data.find(curThread);
+        if ( foundThreadData == data.end() ) {
+            ret = createData();
+            data.insert( make_pair(curThread, ret) );
+        } else {
+            ret = foundThreadData->second;
+            assert(ret);
+        }
+    }
+
+    // Forget the expressions that were destroyed
+    for (ThreadExpressionDataCache::iterator it = cache.begin(); it != cache.end();) {
+        if ( it->second.expired() ) {
+            cache.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+    cache[generation] = ret;
+
+    return ret;
+} // getOrCreateThreadData
+
 NATRON_NAMESPACE_ANONYMOUS_ENTER
 
 template <typename T, typename FuncType>
@@ -259,6 +320,9 @@ struct hash
 struct noise1
     : public exprtk_ifunction_t
 {
+    // The lattice cells of the last samples: the expression is evaluated at successive times on the same thread
+    NoiseLatticeCache<1> _cache;
+
     noise1() : exprtk_ifunction_t(1) {}
 
     exprtk_scalar_t operator()(const exprtk_scalar_t& x)
@@ -267,7 +331,7 @@ struct noise1
         double input = x;
 
         // coverity[callee_ptr_arith]
-        Noise<1, 1>(&input, &ret);
+        NoiseCached<1, 1>(&input, &ret, &_cache);
 
         return ret;
     }
@@ -276,6 +340,9 @@ struct noise1
 struct noise2
     : public exprtk_ifunction_t
 {
+    // See noise1
+    NoiseLatticeCache<2> _cache;
+
     noise2() : exprtk_ifunction_t(2) {}
 
     exprtk_scalar_t operator()(const exprtk_scalar_t& x,
@@ -285,7 +352,7 @@ struct noise2
         double input[2] = {x, y};
 
         // coverity[callee_ptr_arith]
-        Noise<2, 1>(input, &ret);
+        NoiseCached<2, 1>(input, &ret, &_cache);
 
         return ret;
     }
@@ -294,6 +361,9 @@ struct noise2
 struct noise3
     : public exprtk_ifunction_t
 {
+    // See noise1
+    NoiseLatticeCache<3> _cache;
+
     noise3() : exprtk_ifunction_t(3) {}
 
     exprtk_scalar_t operator()(const exprtk_scalar_t& x,
@@ -304,7 +374,7 @@ struct noise3
         double input[3] = {x, y, z};
 
         // coverity[callee_ptr_arith]
-        Noise<3, 1>(input, &ret);
+        NoiseCached<3, 1>(input, &ret, &_cache);
 
         return ret;
     }
@@ -313,6 +383,9 @@ struct noise3
 struct noise4
     : public exprtk_ifunction_t
 {
+    // See noise1
+    NoiseLatticeCache<4> _cache;
+
     noise4() : exprtk_ifunction_t(4) {}
 
     exprtk_scalar_t operator()(const exprtk_scalar_t& x,
@@ -324,7 +397,7 @@ struct noise4
         double input[4] = {x, y, z, w};
 
         // coverity[callee_ptr_arith]
-        Noise<4, 1>(input, &ret);
+        NoiseCached<4, 1>(input, &ret, &_cache);
 
         return ret;
     }
@@ -335,6 +408,9 @@ struct turbulence
 {
     typedef typename exprtk_igeneric_function_t::parameter_list_t parameter_list_t;
 
+    // The lattice cells of the last samples for each octave, see noise1
+    NoiseLatticeCache<3> _caches[8];
+
     turbulence()
         : exprtk_igeneric_function_t("TTT|TTTT|TTTTT|TTTTTT")
     {}
@@ -370,7 +446,13 @@ struct turbulence
             gain = scalar_t(parameters[5])();
         }
 
-        return NATRON_PYTHON_NAMESPACE::ExprUtils::turbulence(p, octaves, lacunarity, gain);
+        // Same as ExprUtils::turbulence
+        int octavesCount = std::min(std::max( (int)octaves, 1 ), 8);
+        double result = 0.;
+        // coverity[callee_ptr_arith]
+        FBMCached<3, 1, true>( (const double*)&p.x, &result, octavesCount, lacunarity, gain, _caches, 8 );
+
+        return .5 * result + .5;
     }
 };
 
@@ -379,6 +461,9 @@ struct fbm
 {
     typedef typename exprtk_igeneric_function_t::parameter_list_t parameter_list_t;
 
+    // See turbulence
+    NoiseLatticeCache<3> _caches[8];
+
     fbm()
         : exprtk_igeneric_function_t("TTT|TTTT|TTTTT|TTTTTT")
     {}
@@ -413,7 +498,13 @@ struct fbm
             gain = scalar_t(parameters[5])();
         }
 
-        return NATRON_PYTHON_NAMESPACE::ExprUtils::fbm(p, octaves, lacunarity, gain);
+        // Same as ExprUtils::fbm
+        int octavesCount = std::min(std::max( (int)octaves, 1 ), 8);
+        double result = 0.;
+        // coverity[callee_ptr_arith]
+        FBMCached<3, 1, false>( (const double*)&p.x, &result, octavesCount, lacunarity, gain, _caches, 8 );
+
+        return .5 * result + .5;
     }
 };
 
@@ -1836,7 +1927,7 @@ KnobHelper::executeExprTkExpression(TimeValue time,
     // 2) Compile only once and run the expression under a lock
     // We picked solution 1)
     {
-        QMutexLocker k(&_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view);
         if ( ( foundView == _imp->common->expressions[dimension].end() ) || !foundView->second ) {
             return eExpressionReturnValueTypeError;
@@ -1851,20 +1942,7 @@ KnobHelper::executeExprTkExpression(TimeValue time,
 
     QThread* curThread = QThread::currentThread();
 
-    KnobExprExprTk::ExpressionDataPtr data;
-    {
-        QMutexLocker k(&obj->lock);
-        KnobExprExprTk::PerThreadDataMap::iterator foundThreadData = obj->data.find(curThread);
-        if ( foundThreadData == obj->data.end() ) {
-            data = KnobExprExprTk::createData();
-            pair<KnobExprExprTk::PerThreadDataMap::iterator, bool> ret = obj->data.insert( make_pair(curThread, data) );
-            assert(ret.second);
-            foundThreadData = ret.first;
-        } else {
-            data = foundThreadData->second;
-            assert(data);
-        }
-    }
+    KnobExprExprTk::ExpressionDataPtr data = obj->getOrCreateThreadData();
 
     // If we are a render clone, we must also reference clones that are local to this render
     bool isRenderClone = getHolder()->isRenderClone();
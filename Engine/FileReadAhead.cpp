@@ -0,0 +1,170 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "FileReadAhead.h"
+
+#include <list>
+#include <set>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+
+// How many files may be read concurrently
+#define NATRON_FILE_READ_AHEAD_MAX_THREADS 4
+
+// How many files read ahead are remembered so that they are not read again
+#define NATRON_FILE_READ_AHEAD_MAX_FILES 64
+
+// The size of the chunks in which files are read, the reads can be aborted between chunks
+#define NATRON_FILE_READ_AHEAD_CHUNK_SIZE (1 << 20)
+
+NATRON_NAMESPACE_ENTER
+
+struct FileReadAheadPrivate
+{
+    QThreadPool pool;
+
+    // Protects readFiles and readFilesSet
+    QMutex readFilesMutex;
+
+    // The files read or being read, the most recent at the end
+    std::list<std::string> readFiles;
+    std::set<std::string> readFilesSet;
+
+    // Incremented by clear() and the destructor: the reads launched before stop
+    QAtomicInt generation;
+
+    FileReadAheadPrivate()
+    : pool()
+    , readFilesMutex()
+    , readFiles()
+    , readFilesSet()
+    , generation(0)
+    {
+        pool.setMaxThreadCount(NATRON_FILE_READ_AHEAD_MAX_THREADS);
+    }
+
+    void abortAndWait()
+    {
+        generation.ref();
+        pool.waitForDone();
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class FileReadAheadRunnable
+    : public QRunnable
+{
+public:
+
+    FileReadAheadRunnable(FileReadAheadPrivate* imp,
+                          const std::string& filename,
+                          int generation)
+    : QRunnable()
+    , _imp(imp)
+    , _filename(filename)
+    , _generation(generation)
+    {
+        setAutoDelete(true);
+    }
+
+    virtual ~FileReadAheadRunnable()
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        QFile file( QString::fromUtf8( _filename.c_str() ) );
+        if ( !file.open(QIODevice::ReadOnly) ) {
+            return;
+        }
+
+        // The data is discarded: reading it is enough for the operating system to keep it in its page cache
+        std::vector<char> buffer(NATRON_FILE_READ_AHEAD_CHUNK_SIZE);
+        while (_imp->generation.loadAcquire() == _generation) {
+            qint64 nRead = file.read(&buffer[0], buffer.size());
+            if (nRead <= 0) {
+                break;
+            }
+        }
+    }
+
+private:
+
+    // The runnable never outlives the private data: it waits for the pool before being destroyed
+    FileReadAheadPrivate* _imp;
+    std::string _filename;
+    int _generation;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+FileReadAhead::FileReadAhead()
+: _imp( new FileReadAheadPrivate() )
+{
+}
+
+FileReadAhead::~FileReadAhead()
+{
+    _imp->abortAndWait();
+}
+
+void
+FileReadAhead::readAhead(const std::vector<std::string>& filenames)
+{
+    const int generation = _imp->generation.loadAcquire();
+
+    QMutexLocker k(&_imp->readFilesMutex);
+    for (std::vector<std::string>::const_iterator it = filenames.begin(); it != filenames.end(); ++it) {
+        if ( it->empty() || (_imp->readFilesSet.find(*it) != _imp->readFilesSet.end() ) ) {
+            continue;
+        }
+        _imp->readFiles.push_back(*it);
+        _imp->readFilesSet.insert(*it);
+        while (_imp->readFiles.size() > NATRON_FILE_READ_AHEAD_MAX_FILES) {
+            _imp->readFilesSet.erase( _imp->readFiles.front() );
+            _imp->readFiles.pop_front();
+        }
+
+        _imp->pool.start( new FileReadAheadRunnable(_imp.get(), *it, generation) );
+    }
+}
+
+void
+FileReadAhead::clear()
+{
+    _imp->abortAndWait();
+
+    QMutexLocker k(&_imp->readFilesMutex);
+    _imp->readFiles.clear();
+    _imp->readFilesSet.clear();
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,83 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_FILEREADAHEAD_H
+#define NATRON_ENGINE_FILEREADAHEAD_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Reads files ahead of the plug-in that will decode them so that their content is in the page cache
+ * of the operating system when the plug-in opens them: the render does not wait on the latency of the disk
+ * or the network file system anymore, only on the decoding.
+ *
+ * Files are read on a thread pool dedicated to this object, with at most NATRON_FILE_READ_AHEAD_MAX_THREADS
+ * concurrent reads, so that the I/O never takes threads from the renders.
+ * The last NATRON_FILE_READ_AHEAD_MAX_FILES files read, or being read, are remembered and not read again.
+ *
+ * This class is thread-safe.
+ **/
+struct FileReadAheadPrivate;
+class FileReadAhead
+{
+public:
+
+    FileReadAhead();
+
+    /**
+     * @brief Aborts the reads in progress and waits for them to return.
+     **/
+    ~FileReadAhead();
+
+    /**
+     * @brief Queue the reads of the given files, in order. Files that were read recently or that do not exist are skipped.
+     **/
+    void readAhead(const std::vector<std::string>& filenames);
+
+    /**
+     * @brief Abort the reads in progress, wait for them to return and forget the files read, e.g: because
+     * they may have changed on disk.
+     **/
+    void clear();
+
+private:
+
+    boost::shared_ptr<FileReadAheadPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_FILEREADAHEAD_H
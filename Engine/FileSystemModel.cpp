@@ -25,8 +25,12 @@
 
 #include "FileSystemModel.h"
 
+#include <list>
+#include <map>
+#include <set>
 #include <vector>
 #include <cassert>
+#include <cctype>
 #include <stdexcept>
 
 #include <boost/make_shared.hpp>
@@ -49,6 +53,7 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QDebug>
 #include <QtCore/QUrl>
 #include <QtCore/QMimeData>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -179,6 +184,9 @@ struct FileSystemItemPrivate
     boost::weak_ptr<FileSystemModel> model;
     boost::weak_ptr<FileSystemItem> parent;
     std::vector<FileSystemItemPtr> children; ///vector for random access
+
+    // The file names of the children, to find existing children without walking through all of them
+    std::set<QString> childrenNames;
     QMutex childrenMutex;
     bool isDir;
     QString filename;
@@ -202,6 +210,7 @@ struct FileSystemItemPrivate
         : model(model)
         , parent(parent)
         , children()
+        , childrenNames()
         , childrenMutex()
         , isDir(isDir)
         , filename(filename)
@@ -391,6 +400,7 @@ FileSystemItem::addChild(const FileSystemItemPtr& child)
     QMutexLocker l(&_imp->childrenMutex);
 
     _imp->children.push_back(child);
+    _imp->childrenNames.insert( child->fileName() );
 }
 
 void
@@ -420,10 +430,12 @@ FileSystemItem::addChild(const SequenceParsing::SequenceFromFilesPtr& sequence,
     }
 
 
-    for (std::vector<FileSystemItemPtr>::iterator it = _imp->children.begin(); it != _imp->children.end(); ++it) {
-        if ( (*it)->fileName() == filename ) {
-            _imp->children.erase(it);
-            break;
+    if ( _imp->childrenNames.find(filename) != _imp->childrenNames.end() ) {
+        for (std::vector<FileSystemItemPtr>::iterator it = _imp->children.begin(); it != _imp->children.end(); ++it) {
+            if ( (*it)->fileName() == filename ) {
+                _imp->children.erase(it);
+                break;
+            }
         }
     }
 
@@ -448,6 +460,7 @@ FileSystemItem::addChild(const SequenceParsing::SequenceFromFilesPtr& sequence,
                                      shared_from_this() );
     model->_imp->registerItem(child);
     _imp->children.push_back(child);
+    _imp->childrenNames.insert(filename);
 } // FileSystemItem::addChild
 
 void
@@ -456,6 +469,7 @@ FileSystemItem::clearChildren()
     QMutexLocker l(&_imp->childrenMutex);
 
     _imp->children.clear();
+    _imp->childrenNames.clear();
 }
 
 // This is a recursive method which tries to match a path to a specifiq
@@ -999,6 +1013,14 @@ FileSystemModel::generateRegexpFilterFromFileExtensions(const QStringList& exten
     return ret;
 }
 
+QString
+FileSystemModel::getRegexpFilters() const
+{
+    QMutexLocker l(&_imp->filtersMutex);
+
+    return _imp->encodedRegexps;
+}
+
 bool
 FileSystemModel::isAcceptedByRegexps(const QString & path) const
 {
@@ -1301,6 +1323,8 @@ FileSystemModel::onDirectoryLoadedByGatherer(const QString& directory)
 void
 FileSystemModel::onWatchedDirectoryChanged(const QString& directory)
 {
+    FileGathererThread::invalidateDirectoryListing(directory);
+
     FileSystemItemPtr item = _imp->getItemFromPath(directory);
 
     if (item) {
@@ -1337,6 +1361,7 @@ FileSystemModel::onWatchedFileChanged(const QString& file)
 {
     ///Get the item corresponding to the current directory
     QFileInfo info(file);
+    FileGathererThread::invalidateDirectoryListing( info.absolutePath() );
     FileSystemItemPtr parent = _imp->getItemFromPath( info.absolutePath() );
 
     if (parent) {
@@ -1592,16 +1617,155 @@ isVideoFileExtension(const std::string& ext)
 
 typedef std::list<std::pair<SequenceParsing::SequenceFromFilesPtr, QFileInfo > > FileSequences;
 
-#define KERNEL_INCR() \
-    switch (viewOrder) \
-    { \
-    case Qt::AscendingOrder: \
-        ++i; \
-        break; \
-    case Qt::DescendingOrder: \
-        --i; \
-        break; \
+// How many directory listings are kept in memory so that opening a directory listed recently is instant
+#define NATRON_FILE_GATHERER_CACHE_MAX_DIRECTORIES 16
+
+// The file names of a directory are parsed in parallel by chunks of this many files, the gathering can be aborted between chunks
+#define NATRON_FILE_GATHERER_PARSE_CHUNK_SIZE 4096
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Everything the listing of a directory depends on, apart from its content
+ **/
+struct DirectoryListingKey
+{
+    QString path;
+    int filters;
+    int sort;
+    int order;
+    QString regexps;
+    bool sequenceMode;
+
+    bool operator==(const DirectoryListingKey& other) const
+    {
+        return path == other.path && filters == other.filters && sort == other.sort && order == other.order &&
+               regexps == other.regexps && sequenceMode == other.sequenceMode;
     }
+};
+
+struct DirectoryListing
+{
+    DirectoryListingKey key;
+
+    // The modification date of the directory when it was listed: the listing is stale if it changed
+    QDateTime lastModified;
+    FileSequences sequences;
+};
+
+/**
+ * @brief The listings of the directories most recently gathered, shared by all file dialogs.
+ * The sequences are not modified once gathered so they can be shared by several models.
+ **/
+class DirectoryListingCache
+{
+public:
+
+    DirectoryListingCache()
+    : _lock()
+    , _listings()
+    {
+    }
+
+    bool get(const DirectoryListingKey& key, const QDateTime& lastModified, FileSequences* sequences)
+    {
+        QMutexLocker k(&_lock);
+        for (std::list<DirectoryListing>::iterator it = _listings.begin(); it != _listings.end(); ++it) {
+            if ( !(it->key == key) ) {
+                continue;
+            }
+            if (it->lastModified != lastModified) {
+                _listings.erase(it);
+                return false;
+            }
+            // Move it to the front of the LRU
+            _listings.splice(_listings.begin(), _listings, it);
+            *sequences = _listings.front().sequences;
+            return true;
+        }
+        return false;
+    }
+
+    void insert(const DirectoryListingKey& key, const QDateTime& lastModified, const FileSequences& sequences)
+    {
+        QMutexLocker k(&_lock);
+        for (std::list<DirectoryListing>::iterator it = _listings.begin(); it != _listings.end(); ++it) {
+            if (it->key == key) {
+                _listings.erase(it);
+                break;
+            }
+        }
+        _listings.push_front( DirectoryListing() );
+        _listings.front().key = key;
+        _listings.front().lastModified = lastModified;
+        _listings.front().sequences = sequences;
+        while (_listings.size() > NATRON_FILE_GATHERER_CACHE_MAX_DIRECTORIES) {
+            _listings.pop_back();
+        }
+    }
+
+    /**
+     * @brief Forget all listings of the given directory, e.g: when a file system watcher reports a change.
+     * The modification date alone is not enough since it may have a coarse resolution.
+     **/
+    void invalidate(const QString& path)
+    {
+        QMutexLocker k(&_lock);
+        std::list<DirectoryListing>::iterator it = _listings.begin();
+        while ( it != _listings.end() ) {
+            if (it->key.path == path) {
+                it = _listings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+private:
+
+    QMutex _lock;
+
+    // Front is the most recently used
+    std::list<DirectoryListing> _listings;
+};
+
+DirectoryListingCache directoryListingCache;
+
+typedef boost::shared_ptr<SequenceParsing::FileNameContent> FileNameContentPtr;
+
+struct ParsedFile
+{
+    std::string absoluteFilePath;
+    FileNameContentPtr content;
+
+    // The file name with the numbers masked: only files with the same key may belong to the same sequence
+    std::string sequenceKey;
+};
+
+void
+parseFile(ParsedFile& file)
+{
+    file.content = boost::make_shared<SequenceParsing::FileNameContent>(file.absoluteFilePath);
+
+    const std::string& path = file.absoluteFilePath;
+    file.sequenceKey.reserve( path.size() );
+    for (std::size_t i = 0; i < path.size(); ++i) {
+        bool isSign = path[i] == '-' && i + 1 < path.size() && std::isdigit( (unsigned char)path[i + 1] );
+        if ( isSign || std::isdigit( (unsigned char)path[i] ) ) {
+            // A frame number may be negative and does not have a fixed number of digits
+            file.sequenceKey.push_back('#');
+            ++i;
+            while ( i < path.size() && std::isdigit( (unsigned char)path[i] ) ) {
+                ++i;
+            }
+            --i;
+        } else {
+            file.sequenceKey.push_back(path[i]);
+        }
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 void
 FileGathererThread::gatheringKernel(const FileSystemItemPtr& item)
@@ -1637,72 +1801,115 @@ FileGathererThread::gatheringKernel(const FileSystemItemPtr& item)
     sort |= QDir::IgnoreCase;
     sort |= QDir::DirsFirst;
 
-    ///All entries in the directory
-    QFileInfoList all = dir.entryInfoList(model->filter(), sort);
+    const bool sequenceMode = model->isSequenceModeEnabled();
+
+    DirectoryListingKey key;
+    key.path = item->absoluteFilePath();
+    key.filters = (int)model->filter();
+    key.sort = (int)sort;
+    key.order = (int)viewOrder;
+    key.regexps = model->getRegexpFilters();
+    key.sequenceMode = sequenceMode;
+    QDateTime lastModified = QFileInfo( item->absoluteFilePath() ).lastModified();
 
     ///List of all possible file sequences in the directory or directories
     FileSequences sequences;
-    int start = 0;
-    int end = 0;
-    switch (viewOrder) {
-    case Qt::AscendingOrder:
-        start = 0;
-        end = all.size();
-        break;
-    case Qt::DescendingOrder:
-        start = all.size() - 1;
-        end = -1;
-        break;
-    }
+    if ( !directoryListingCache.get(key, lastModified, &sequences) ) {
+
+        ///All entries in the directory
+        QFileInfoList all = dir.entryInfoList(model->filter(), sort);
 
-    int i = start;
-    while (i != end) {
-        ///If we must abort we do it now
-        if ( _imp->checkForAbort() ) {
-            return;
+        int start = 0;
+        int end = 0;
+        switch (viewOrder) {
+        case Qt::AscendingOrder:
+            start = 0;
+            end = all.size();
+            break;
+        case Qt::DescendingOrder:
+            start = all.size() - 1;
+            end = -1;
+            break;
         }
 
-        if ( all[i].isDir() ) {
-            ///This is a directory
-            sequences.push_back( std::make_pair(SequenceParsing::SequenceFromFilesPtr(), all[i]) );
-        } else {
-            QString filename = all[i].fileName();
-            /// If the item does not match the filter regexp set by the user, discard it
-            if ( !model->isAcceptedByRegexps(filename) ) {
-                KERNEL_INCR();
-                continue;
+        // The sequences of each sequence key, the most recently created last
+        std::map<std::string, std::vector<FileSequences::iterator> > sequencesByKey;
+
+        std::vector<int> chunkEntries;
+        std::vector<ParsedFile> chunkFiles;
+        chunkEntries.reserve(NATRON_FILE_GATHERER_PARSE_CHUNK_SIZE);
+        int i = start;
+        while (i != end) {
+            ///If we must abort we do it now
+            if ( _imp->checkForAbort() ) {
+                return;
             }
 
-            /// If file sequence fetching is disabled, accept it
-            if ( !model->isSequenceModeEnabled() ) {
-                sequences.push_back( std::make_pair(SequenceParsing::SequenceFromFilesPtr(), all[i]) );
+            // Gather a chunk of entries, in the order of the view
+            chunkEntries.clear();
+            while ( i != end && chunkEntries.size() < NATRON_FILE_GATHERER_PARSE_CHUNK_SIZE ) {
+                if ( all[i].isDir() || model->isAcceptedByRegexps( all[i].fileName() ) ) {
+                    /// If the item does not match the filter regexp set by the user, discard it
+                    chunkEntries.push_back(i);
+                }
                 KERNEL_INCR();
-                continue;
             }
 
-            std::string absoluteFilePath = generateChildAbsoluteName(item.get(), filename).toStdString();
-            bool foundMatchingSequence = false;
+            // Parse the file names of the chunk in parallel, this is the most expensive part for large sequences
+            chunkFiles.clear();
+            if (sequenceMode) {
+                for (std::size_t e = 0; e < chunkEntries.size(); ++e) {
+                    const QFileInfo& info = all[chunkEntries[e]];
+                    if ( !info.isDir() ) {
+                        chunkFiles.push_back( ParsedFile() );
+                        chunkFiles.back().absoluteFilePath = generateChildAbsoluteName( item.get(), info.fileName() ).toStdString();
+                    }
+                }
+                QtConcurrent::blockingMap(chunkFiles, parseFile);
+            }
+
+            std::size_t fileIndex = 0;
+            for (std::size_t e = 0; e < chunkEntries.size(); ++e) {
+                const QFileInfo& info = all[chunkEntries[e]];
 
-            /// If we reach here, this is a valid file and we need to determine if it belongs to another sequence or we need
-            /// to create a new one
-            SequenceParsing::FileNameContent fileContent(absoluteFilePath);
+                /// If file sequence fetching is disabled, accept it
+                if ( info.isDir() || !sequenceMode ) {
+                    ///This is a directory
+                    sequences.push_back( std::make_pair(SequenceParsing::SequenceFromFilesPtr(), info) );
+                    continue;
+                }
 
-            if ( !isVideoFileExtension( fileContent.getExtension() ) ) {
-                ///Note that we use a reverse iterator because we have more chance to find a match in the last recently added entries
-                for (FileSequences::reverse_iterator it = sequences.rbegin(); it != sequences.rend(); ++it) {
-                    if ( it->first && it->first->tryInsertFile(fileContent, false) ) {
-                        foundMatchingSequence = true;
-                        break;
+                /// If we reach here, this is a valid file and we need to determine if it belongs to another sequence or we need
+                /// to create a new one
+                const ParsedFile& file = chunkFiles[fileIndex++];
+                const SequenceParsing::FileNameContent& fileContent = *file.content;
+                bool foundMatchingSequence = false;
+                bool isVideo = isVideoFileExtension( fileContent.getExtension() );
+                std::vector<FileSequences::iterator>* candidates = isVideo ? 0 : &sequencesByKey[file.sequenceKey];
+
+                if (candidates) {
+                    ///Note that we use a reverse iterator because we have more chance to find a match in the last recently added entries
+                    for (std::vector<FileSequences::iterator>::reverse_iterator it = candidates->rbegin(); it != candidates->rend(); ++it) {
+                        if ( (*it)->first->tryInsertFile(fileContent, false) ) {
+                            foundMatchingSequence = true;
+                            break;
+                        }
                     }
                 }
-            }
 
-            if (!foundMatchingSequence) {
-                SequenceParsing::SequenceFromFilesPtr newSequence = boost::make_shared<SequenceParsing::SequenceFromFiles>(fileContent, true);
-                sequences.push_back( std::make_pair(newSequence, all[i]) );
+                if (!foundMatchingSequence) {
+                    SequenceParsing::SequenceFromFilesPtr newSequence = boost::make_shared<SequenceParsing::SequenceFromFiles>(fileContent, true);
+                    sequences.push_back( std::make_pair(newSequence, info) );
+                    if (candidates) {
+                        FileSequences::iterator inserted = sequences.end();
+                        --inserted;
+                        candidates->push_back(inserted);
+                    }
+                }
             }
         }
-        KERNEL_INCR();
+
+        directoryListingCache.insert(key, lastModified, sequences);
     }
 
     ///Now iterate through the sequences and create the children as necessary
@@ -1713,6 +1920,12 @@ FileGathererThread::gatheringKernel(const FileSystemItemPtr& item)
     Q_EMIT directoryLoaded( item->absoluteFilePath() );
 } // FileGathererThread::gatheringKernel
 
+void
+FileGathererThread::invalidateDirectoryListing(const QString& path)
+{
+    directoryListingCache.invalidate(path);
+}
+
 void
 FileGathererThread::fetchDirectory(const FileSystemItemPtr& item)
 {
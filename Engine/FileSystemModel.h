@@ -163,6 +163,12 @@ public:
 
     void fetchDirectory(const FileSystemItemPtr& item);
 
+    /**
+     * @brief The listings of the directories gathered recently are shared by all models and reused as long as
+     * the directory modification date does not change. Call this when a directory is known to have changed.
+     **/
+    static void invalidateDirectoryListing(const QString& path);
+
     bool isWorking() const;
 Q_SIGNALS:
 
@@ -293,6 +299,8 @@ public:
      **/
     void setRegexpFilters(const QString& filters);
 
+    QString getRegexpFilters() const;
+
     /**
      * @brief Generates an encoded regexp filter that can be passed to setRegexpFilters from a list of file extensions
      * @extensions A list of file extensions in the form "jpg", "png", "exr" etc...
@@ -27,8 +27,13 @@
 
 #include <cmath>
 #include <cassert>
+#include <list>
+#include <map>
 #include <stdexcept>
 
+// Points closer than this along both axes are considered duplicates
+#define FIT_CURVE_DUPLICATE_TOLERANCE 1e-4
+
 #ifndef M_PI_2
 #define M_PI_2      1.57079632679489661923132169163975144   /* pi/2           */
 #endif
@@ -115,12 +120,12 @@ computeCenterTangent(const Point& prev,
  **/
 static Point
 bezierEval(int degree,
-           const std::vector<Point>& v,
+           const Point* v,
            double t)
 {
-    std::vector<Point>  vtemp( v.size() );        /* Local copy of control points		*/
+    Point vtemp[4];        /* Local copy of control points		*/
 
-    assert( (int)v.size() == degree + 1 );
+    assert(degree >= 0 && degree <= 3);
 
     for (int i = 0; i <= degree; ++i) {
         vtemp[i] = v[i];
@@ -141,12 +146,12 @@ bezierEval(int degree,
  * @brief Use Newton-Raphson iteration to find better root.
  **/
 static double
-newtonRaphsonRootFind(const std::vector<Point>& Q,
+newtonRaphsonRootFind(const Point* Q,
                       const Point& P,
                       double u)
 {
-    std::vector<Point> Q1(3); // Q'
-    std::vector<Point> Q2(2); // Q''
+    Point Q1[3]; // Q'
+    Point Q2[2]; // Q''
     Point Q_u, Q1_u, Q2_u; /*u evaluated at Q, Q', & Q''	*/
 
     // Compute Q(u)
@@ -180,50 +185,57 @@ newtonRaphsonRootFind(const std::vector<Point>& Q,
     return u - (numerator / denominator);
 }
 
+static void
+getBezierSegment(const std::vector<SimpleBezierCP>& bezCurve,
+                 Point* bezSeg)
+{
+    bezSeg[0] = bezCurve[0].p;
+    bezSeg[1] = bezCurve[0].rightTan;
+    bezSeg[2] = bezCurve[1].leftTan;
+    bezSeg[3] = bezCurve[1].p;
+}
+
 /**
  * @brief Given set of points and their parameterization, try to find
  * a better parameterization.
- *
+ * The points are the ones in [first, last] and u has one value per point of the range.
  **/
 static void
 reparameterize(const std::vector<Point> &points,
+               std::size_t first,
                const std::vector<SimpleBezierCP>& bezCurve,
                std::vector<double>& u)
 {
-    std::vector<Point> bezSeg;
+    Point bezSeg[4];
 
-    bezSeg.push_back(bezCurve[0].p);
-    bezSeg.push_back(bezCurve[0].rightTan);
-    bezSeg.push_back(bezCurve[1].leftTan);
-    bezSeg.push_back(bezCurve[1].p);
+    getBezierSegment(bezCurve, bezSeg);
 
     for (std::size_t i = 0; i < u.size(); ++i) {
-        u[i] = newtonRaphsonRootFind(bezSeg, points[i], u[i]);
+        u[i] = newtonRaphsonRootFind(bezSeg, points[first + i], u[i]);
     }
 }
 
 /**
  *	Find the maximum squared distance of digitized points
  *	to fitted curve.
+ *	The split point is returned as an index in the range.
  **/
 static double
 computeMaxError(const std::vector<Point>& points,
+                std::size_t first,
                 const std::vector<SimpleBezierCP>& bezierCurve,
                 const std::vector<double>& u,
                 int* splitPoint)
 {
-    *splitPoint = points.size() / 2;
+    *splitPoint = u.size() / 2;
     double maxDist = 0.0;
-    std::vector<Point> bezierSegment;
-    bezierSegment.push_back(bezierCurve[0].p);
-    bezierSegment.push_back(bezierCurve[0].rightTan);
-    bezierSegment.push_back(bezierCurve[1].leftTan);
-    bezierSegment.push_back(bezierCurve[1].p);
-    for (std::size_t i = 1; i < points.size() - 1; ++i) {
+    Point bezierSegment[4];
+    getBezierSegment(bezierCurve, bezierSegment);
+    for (std::size_t i = 1; i < u.size() - 1; ++i) {
         Point p = bezierEval(3, bezierSegment, u[i]);
         Point v;
-        v.x = p.x - points[i].x;
-        v.y = p.y - points[i].y;
+        v.x = p.x - points[first + i].x;
+        v.y = p.y - points[first + i].y;
         double distSq = v.x * v.x + v.y * v.y;
         if (distSq >= maxDist) {
             maxDist = distSq;
@@ -241,27 +253,21 @@ computeMaxError(const std::vector<Point>& points,
  **/
 static void
 chordLengthParametrize(const std::vector<Point>& points,
+                       std::size_t first,
+                       std::size_t last,
                        std::vector<double>* u)
 {
-    assert(points.size() > 1);
-    u->push_back(0.);
-    std::vector<Point>::const_iterator prev = points.begin();
-    std::vector<Point>::const_iterator cur = points.begin();
-    ++cur;
-
-    for (; cur != points.end(); ++prev, ++cur) {
-        double last = u->back();
-        double dist = euclideanDistance(*cur, *prev);
-        u->push_back(last + dist);
+    assert(last > first);
+    u->resize(last - first + 1);
+    (*u)[0] = 0.;
+    for (std::size_t i = first + 1; i <= last; ++i) {
+        (*u)[i - first] = (*u)[i - first - 1] + euclideanDistance(points[i], points[i - 1]);
     }
-    assert( u->size() == points.size() );
-    double last = u->back();
-    assert(last != 0.);
-
-    std::vector<double>::iterator it = u->begin();
-    ++it;
-    for (; it != u->end(); ++it) {
-        *it /= last;
+    double length = u->back();
+    assert(length != 0.);
+
+    for (std::size_t i = 1; i < u->size(); ++i) {
+        (*u)[i] /= length;
     }
 }
 
@@ -298,66 +304,54 @@ Bezier3(double u)
     return (u * u * u);
 }
 
+/**
+ * @brief Solves the least-squares problem for the length of the tangents of the Bezier segment fitting
+ * the points in [first, last], in a single pass over the points.
+ **/
 static void
 generateBezier(const std::vector<Point>& points,
+               std::size_t first,
+               std::size_t last,
                const std::vector<double>& u,
                const Point& tHat1,
                const Point& tHat2,
                std::vector<SimpleBezierCP>* generatedBezier)
 {
-    assert( points.size() == u.size() );
-
-    std::vector<std::pair<Point, Point> > a( points.size() ); // Precomputed rhs for eqn
-    for (std::size_t i = 0; i < points.size(); ++i) {
-        Point v1, v2;
-        v1 = tHat1;
-        v2 = tHat2;
-        v1.x *= Bezier1(u[i]);
-        v1.y *= Bezier1(u[i]);
-
-        v2.x *= Bezier2(u[i]);
-        v2.y *= Bezier2(u[i]);
-        a[i].first = v1;
-        a[i].second = v2;
-    }
+    assert( last - first + 1 == u.size() );
 
-    assert( a.size() == points.size() );
+    const Point& firstPoint = points[first];
+    const Point& lastPoint = points[last];
 
     double c[2][2]; // Matrix C
     c[0][0] = c[0][1] = c[1][0] = c[1][1] = 0.0;
     double x[2]; // Matrix X
     x[0] = x[1] = 0.;
 
-    Point tmp;
-    for (std::size_t i = 0; i < points.size(); ++i) {
-        c[0][0] += dotProduct(a[i].first, a[i].first);
-        c[0][1] += dotProduct(a[i].first, a[i].second);
-        c[1][0] += c[0][1];
-        c[1][1] += dotProduct(a[i].second, a[i].second);
-        tmp = points[i];
-
-        Point firstBezier0 = points[0];
-        firstBezier0.x *= Bezier0(u[i]);
-        firstBezier0.y *= Bezier0(u[i]);
+    // The rhs of the equations are tHat1 * Bezier1(u) and tHat2 * Bezier2(u): their dot products are
+    // those of the tangents scaled by the multipliers
+    double t11 = dotProduct(tHat1, tHat1);
+    double t12 = dotProduct(tHat1, tHat2);
+    double t22 = dotProduct(tHat2, tHat2);
 
-        Point firstBezier1 = points[0];
-        firstBezier1.x *= Bezier1(u[i]);
-        firstBezier1.y *= Bezier1(u[i]);
-
-        Point lastBezier3 = points[points.size() - 1];
-        lastBezier3.x *= Bezier3(u[i]);
-        lastBezier3.y *= Bezier3(u[i]);
-
-        Point lastBezier2 = points[points.size() - 1];
-        lastBezier2.x *= Bezier2(u[i]);
-        lastBezier2.y *= Bezier2(u[i]);
-
-        tmp.x -= (firstBezier0.x + firstBezier1.x +  lastBezier2.x + lastBezier3.x);
-        tmp.y -= (firstBezier0.y + firstBezier1.y +  lastBezier2.y + lastBezier3.y);
-
-        x[0] += dotProduct(a[i].first, tmp);
-        x[1] += dotProduct(a[i].second, tmp);
+    for (std::size_t i = 0; i < u.size(); ++i) {
+        double b0 = Bezier0(u[i]);
+        double b1 = Bezier1(u[i]);
+        double b2 = Bezier2(u[i]);
+        double b3 = Bezier3(u[i]);
+
+        // Precomputed rhs for eqn: a1 = tHat1 * b1, a2 = tHat2 * b2
+        c[0][0] += b1 * b1 * t11;
+        c[0][1] += b1 * b2 * t12;
+        c[1][1] += b2 * b2 * t22;
+
+        Point tmp;
+        tmp.x = points[first + i].x - ( firstPoint.x * (b0 + b1) + lastPoint.x * (b2 + b3) );
+        tmp.y = points[first + i].y - ( firstPoint.y * (b0 + b1) + lastPoint.y * (b2 + b3) );
+
+        x[0] += b1 * dotProduct(tHat1, tmp);
+        x[1] += b2 * dotProduct(tHat2, tmp);
     }
+    c[1][0] = c[0][1];
 
     //Compute the determinants of C and X
     double det_c0_c1 = c[0][0] * c[1][1] - c[1][0] * c[0][1];
@@ -371,7 +365,7 @@ generateBezier(const std::vector<Point>& points,
     // If alpha negative, use the Wu/Barsky heuristic (see text)
     // (if alpha is 0, you get coincident control points that lead to
     // divide by zero in any subsequent NewtonRaphsonRootFind() call.
-    double segLength = euclideanDistance(points[points.size() - 1], points[0]);
+    double segLength = euclideanDistance(lastPoint, firstPoint);
     double epsilon = 1.0e-6 * segLength;
     if ( (alpha_l < epsilon) || (alpha_r < epsilon) ) {
         // fall back on standard (probably inaccurate) formula, and subdivide further if needed.
@@ -384,9 +378,9 @@ generateBezier(const std::vector<Point>& points,
     //  Control points 1 and 2 are positioned an alpha distance out
     //  on the tangent vectors, left and right, respectively
     SimpleBezierCP firstCp, lastCp;
-    firstCp.p = points[0];
+    firstCp.p = firstPoint;
     firstCp.leftTan = firstCp.p;
-    lastCp.p = points[points.size() - 1];
+    lastCp.p = lastPoint;
     lastCp.rightTan = lastCp.p;
     firstCp.rightTan.x = firstCp.p.x + tHat1.x * alpha_l;
     firstCp.rightTan.y = firstCp.p.y + tHat1.y * alpha_l;
@@ -396,95 +390,93 @@ generateBezier(const std::vector<Point>& points,
     generatedBezier->push_back(lastCp);
 } // generateBezier
 
+/**
+ * @brief Fits the points in [first, last] and appends the generated control points to generatedBezier.
+ * If generatedBezier is not empty, its last control point must be the first point of the range: it is given the
+ * right tangent of the fitted segment instead of being inserted again.
+ * The u vector is only used as scratch memory, to avoid allocating it for each segment.
+ **/
 static void
 fit_cubic_internal(const std::vector<Point>& points,
+                   std::size_t first,
+                   std::size_t last,
                    const Point&  tHat1,
                    const Point& tHat2,
                    double error,
+                   std::vector<double>& u,
                    std::vector<SimpleBezierCP>* generatedBezier)
 {
     //Error below which you try iterating
     double iterationError = error * error;
 
-    ;
     int maxIterations = 4;
 
+    std::vector<SimpleBezierCP> segment;
+
     //Use heuristic if the region only has 2 points
-    if (points.size() == 2) {
-        const Point& first = points.front();
-        const Point& last = points.back();
-        double dist =  euclideanDistance(first, last);
+    if (last - first == 1) {
+        const Point& firstPoint = points[first];
+        const Point& lastPoint = points[last];
+        double dist =  euclideanDistance(firstPoint, lastPoint);
         SimpleBezierCP firstCp, lastCp;
-        firstCp.p = first;
-        firstCp.leftTan = first;
+        firstCp.p = firstPoint;
+        firstCp.leftTan = firstPoint;
         firstCp.rightTan.x = firstCp.p.x + tHat1.x * dist * (1./ 3);
         firstCp.rightTan.y = firstCp.p.y + tHat1.y * dist * (1./ 3);
-        lastCp.p = last;
-        lastCp.rightTan = last;
+        lastCp.p = lastPoint;
+        lastCp.rightTan = lastPoint;
         lastCp.leftTan.x = lastCp.p.x + tHat2.x * dist * (1./ 3);
         lastCp.leftTan.y = lastCp.p.y + tHat2.y * dist * (1./ 3);
-        generatedBezier->push_back(firstCp);
-        generatedBezier->push_back(lastCp);
-
-        return;
-    }
-
-    // Parameterize points, and attempt to fit curve
-    std::vector<double> u;
-    chordLengthParametrize(points, &u);
-    generateBezier(points, u, tHat1, tHat2, generatedBezier);
-
-    int splitPoint;
-    double maxError = computeMaxError(points, *generatedBezier, u, &splitPoint);
-
-    //  If error not too large, try some reparameterization and iteration
-    if (maxError < iterationError) {
-        for (int i = 0; i < maxIterations; ++i) {
-            reparameterize(points, *generatedBezier, u);
-            generatedBezier->clear();
-            generateBezier(points, u, tHat1, tHat2, generatedBezier);
-            maxError = computeMaxError(points, *generatedBezier, u, &splitPoint);
-            if (maxError < error) {
-                return;
+        segment.push_back(firstCp);
+        segment.push_back(lastCp);
+    } else {
+        // Parameterize points, and attempt to fit curve
+        chordLengthParametrize(points, first, last, &u);
+        generateBezier(points, first, last, u, tHat1, tHat2, &segment);
+
+        int splitPoint;
+        double maxError = computeMaxError(points, first, segment, u, &splitPoint);
+        bool fitted = false;
+
+        //  If error not too large, try some reparameterization and iteration
+        if (maxError < iterationError) {
+            for (int i = 0; i < maxIterations; ++i) {
+                reparameterize(points, first, segment, u);
+                segment.clear();
+                generateBezier(points, first, last, u, tHat1, tHat2, &segment);
+                maxError = computeMaxError(points, first, segment, u, &splitPoint);
+                if (maxError < error) {
+                    fitted = true;
+                    break;
+                }
             }
         }
-    }
 
-    assert(splitPoint >= 1 && splitPoint < (int)points.size() - 1);
-    // Fitting failed -- split at max error point and fit recursively
-    Point tHatCenter = computeCenterTangent(points[splitPoint - 1], points[splitPoint], points[splitPoint + 1]);
-    std::vector<Point> firstSplit, secondSplit;
-    for (std::size_t i = 0; i <= (std::size_t)splitPoint; ++i) {
-        firstSplit.push_back(points[i]);
-    }
-    for (std::size_t i = (std::size_t)splitPoint; i < points.size(); ++i) {
-        secondSplit.push_back(points[i]);
-    }
-
-    std::vector<SimpleBezierCP> first, second;
-    fit_cubic_internal(firstSplit, tHat1, tHatCenter, error, &first);
-    tHatCenter.x = -tHatCenter.x;
-    tHatCenter.y = -tHatCenter.y;
-    fit_cubic_internal(secondSplit, tHatCenter, tHat2, error, &second);
-    generatedBezier->clear();
-    if ( !first.empty() ) {
-        generatedBezier->insert( generatedBezier->end(), first.begin(), first.end() );
+        if (!fitted) {
+            assert( splitPoint >= 1 && splitPoint < (int)(last - first) );
+            // Fitting failed -- split at max error point and fit recursively
+            std::size_t split = first + splitPoint;
+            Point tHatCenter = computeCenterTangent(points[split - 1], points[split], points[split + 1]);
+            fit_cubic_internal(points, first, split, tHat1, tHatCenter, error, u, generatedBezier);
+            tHatCenter.x = -tHatCenter.x;
+            tHatCenter.y = -tHatCenter.y;
+            fit_cubic_internal(points, split, last, tHatCenter, tHat2, error, u, generatedBezier);
+
+            return;
+        }
     }
 
-    for (std::vector<SimpleBezierCP>::iterator it = second.begin(); it != second.end(); ++it) {
-        /*
-         * We already inserted the last control point of the "first" segment which should be equal to the first control
-         * point of our segment, so give it the left tangent computed in the "first" segment and the right tangent
-         * computed in the "second" segment
-         */
-        if ( it == second.begin() ) {
-            if ( !generatedBezier->empty() ) {
-                generatedBezier->back().rightTan = it->rightTan;
-            }
-        } else {
-            generatedBezier->push_back(*it);
-        }
+    /*
+     * The last control point of the previous segment should be equal to the first control
+     * point of our segment, so give it the left tangent computed in the previous segment and the right tangent
+     * computed in this segment
+     */
+    if ( !generatedBezier->empty() ) {
+        generatedBezier->back().rightTan = segment.front().rightTan;
+    } else {
+        generatedBezier->push_back( segment.front() );
     }
+    generatedBezier->push_back( segment.back() );
 } // fit_cubic_internal
 
 static void
@@ -502,7 +494,9 @@ fit_cubic_for_sub_set(const std::vector<Point>& points,
     }
     Point tHat1 = computeEndTangent(points[0], points[1]);
     Point tHat2 = computeEndTangent(points[points.size() - 1], points[points.size() - 2]);
-    fit_cubic_internal(points, tHat1, tHat2, error, generatedBezier);
+    std::vector<double> u;
+    u.reserve( points.size() );
+    fit_cubic_internal(points, 0, points.size() - 1, tHat1, tHat2, error, u, generatedBezier);
 }
 
 NATRON_NAMESPACE_ANONYMOUS_EXIT
@@ -517,18 +511,32 @@ FitCurve::fit_cubic(const std::vector<Point>& points,
         return;
     }
 
-    //First remove (almost) duplicate points
+    //First remove (almost) duplicate points.
+    //The points already kept are bucketed in cells of the size of the tolerance so that only the
+    //neighbouring cells of a point need to be searched.
     std::list<Point> newPoints;
+    std::map<std::pair<long long, long long>, std::vector<Point> > keptPoints;
     for (std::vector<Point>::const_iterator it = points.begin(); it != points.end(); ++it) {
+        long long cellX = (long long)std::floor(it->x / FIT_CURVE_DUPLICATE_TOLERANCE);
+        long long cellY = (long long)std::floor(it->y / FIT_CURVE_DUPLICATE_TOLERANCE);
         bool foundDuplicate = false;
-        for (std::list<Point>::const_iterator it2 = newPoints.begin(); it2 != newPoints.end(); ++it2) {
-            if ( (std::abs(it2->x - it->x) < 1e-4) && (std::abs(it2->y - it->y) < 1e-4) ) {
-                foundDuplicate = true;
-                break;
+        for (long long cx = cellX - 1; cx <= cellX + 1 && !foundDuplicate; ++cx) {
+            for (long long cy = cellY - 1; cy <= cellY + 1 && !foundDuplicate; ++cy) {
+                std::map<std::pair<long long, long long>, std::vector<Point> >::const_iterator found = keptPoints.find( std::make_pair(cx, cy) );
+                if ( found == keptPoints.end() ) {
+                    continue;
+                }
+                for (std::vector<Point>::const_iterator it2 = found->second.begin(); it2 != found->second.end(); ++it2) {
+                    if ( (std::abs(it2->x - it->x) < FIT_CURVE_DUPLICATE_TOLERANCE) && (std::abs(it2->y - it->y) < FIT_CURVE_DUPLICATE_TOLERANCE) ) {
+                        foundDuplicate = true;
+                        break;
+                    }
+                }
             }
         }
         if (!foundDuplicate) {
             newPoints.push_back(*it);
+            keptPoints[std::make_pair(cellX, cellY)].push_back(*it);
         }
     }
 
@@ -601,15 +609,12 @@ FitCurve::fit_cubic(const std::vector<Point>& points,
         std::vector<SimpleBezierCP> subsetBezier;
         fit_cubic_for_sub_set(*it, error, &subsetBezier);
         for (std::size_t i = 0; i < subsetBezier.size(); ++i) {
-            //For the first segment point check if the  point is not already inserted in generatedBezie
+            //For the first segment point check if the  point is not already inserted in generatedBezier.
+            //The duplicate points were removed above, so it can only be the last inserted point.
             bool found = false;
-            if (i == 0) {
-                for (std::vector<SimpleBezierCP>::iterator it2 = generatedBezier->begin(); it2 != generatedBezier->end(); ++it2) {
-                    if ( (std::abs(it2->p.x - subsetBezier[i].p.x) < 1e-6) && (std::abs(it2->p.y - subsetBezier[i].p.y) < 1e-6) ) {
-                        found = true;
-                        break;
-                    }
-                }
+            if ( (i == 0) && !generatedBezier->empty() ) {
+                const SimpleBezierCP& back = generatedBezier->back();
+                found = (std::abs(back.p.x - subsetBezier[i].p.x) < 1e-6) && (std::abs(back.p.y - subsetBezier[i].p.y) < 1e-6);
             }
             if (!found) {
                 generatedBezier->push_back(subsetBezier[i]);
@@ -45,11 +45,13 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
 #include "Engine/ImageCacheEntry.h"
+#include "Engine/LockProfiler.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
 #include "Engine/NodeMetadata.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/OSGLContext.h"
+#include "Engine/RenderArena.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/TreeRender.h"
@@ -113,31 +115,38 @@ FrameViewRenderKey_compare_less::operator() (const FrameViewRenderKey & lhs,
 }
 
 
+// The bookkeeping of the requests is allocated out of the arena of the render, see RenderArena
+typedef std::set<FrameViewRequestPtr, std::less<FrameViewRequestPtr>, RenderArenaAllocator<FrameViewRequestPtr> > FrameViewRequestSet;
+typedef std::set<FrameViewRequestWPtr, std::less<FrameViewRequestWPtr>, RenderArenaAllocator<FrameViewRequestWPtr> > FrameViewRequestWSet;
+
 struct PerLaunchRequestData
 {
 
     // Dependencies of this frame/view.
     // This frame/view will not be able to render until all dependencies will be rendered.
     // (i.e: the set is empty)
-    std::set<FrameViewRequestPtr> dependencies;
+    FrameViewRequestSet dependencies;
 
     // List of dependnencies that we already rendered (they are no longer in the dependencies set)
     // but that we still keep around so that the associated image plane is not destroyed.
-    std::set<FrameViewRequestPtr> renderedDependencies;
+    FrameViewRequestSet renderedDependencies;
 
     // The listeners of this frame/view:
     // This frame/view is in the dependencies list each of the listeners.
-    std::set<FrameViewRequestWPtr> listeners;
+    FrameViewRequestWSet listeners;
 
 
-    PerLaunchRequestData()
+    PerLaunchRequestData(const RenderArenaPtr& arena)
+    : dependencies(std::less<FrameViewRequestPtr>(), RenderArenaAllocator<FrameViewRequestPtr>(arena))
+    , renderedDependencies(std::less<FrameViewRequestPtr>(), RenderArenaAllocator<FrameViewRequestPtr>(arena))
+    , listeners(std::less<FrameViewRequestWPtr>(), RenderArenaAllocator<FrameViewRequestWPtr>(arena))
     {
 
     }
 
 };
 
-typedef std::map<TreeRenderExecutionDataWPtr, PerLaunchRequestData> LaunchRequestDataMap;
+typedef std::map<TreeRenderExecutionDataWPtr, PerLaunchRequestData, std::less<TreeRenderExecutionDataWPtr>, RenderArenaAllocator<std::pair<const TreeRenderExecutionDataWPtr, PerLaunchRequestData> > > LaunchRequestDataMap;
 
 struct FrameViewRequestPrivate
 {
@@ -156,6 +165,9 @@ struct FrameViewRequestPrivate
     // The tree render associated to this request
     TreeRenderWPtr parentRender;
 
+    // The arena of the render, kept alive as long as the request exists
+    RenderArenaPtr arena;
+
     // The plane to render
     ImagePlaneDesc plane;
 
@@ -209,6 +221,9 @@ struct FrameViewRequestPrivate
     // The stack of upstram effect distortions
     Distortion2DStackPtr distortionStack;
 
+    // The color transforms concatenated up to this request
+    ColorTransformStackPtr colorTransformStack;
+
 #ifdef TRACE_REQUEST_LIFETIME
     std::string nodeName;
 #endif
@@ -220,6 +235,18 @@ struct FrameViewRequestPrivate
     // True if cache write is allowed but not cache read
     bool byPassCache;
 
+    // True if a previous launch of the render returned because of tiles pending in another thread or process
+    bool resumedAfterPendingTiles;
+
+    // True if the render window is rendered in stripes
+    bool streamedRender;
+
+    // True if the OpenGL render is cached in the GPU image cache
+    bool gpuImageCacheEnabled;
+
+    // If not 0, the OpenGL render is split in square tiles of this size
+    int openGLRenderTileSize;
+
     FrameViewRequestPrivate(const ImagePlaneDesc& plane,
                             unsigned int mipMapLevel,
                             const RenderScale& proxyScale,
@@ -230,6 +257,7 @@ struct FrameViewRequestPrivate
     , isDrescribed(false)
     , renderClone(effect)
     , parentRender(render)
+    , arena(render ? render->getArena() : RenderArenaPtr())
     , plane(plane)
     , proxyScale(proxyScale)
     , mipMapLevel(mipMapLevel)
@@ -243,15 +271,20 @@ struct FrameViewRequestPrivate
     , fullScaleImage()
     , requestedScaleImage()
     , finalRoi()
-    , requestData()
+    , requestData(std::less<TreeRenderExecutionDataWPtr>(), LaunchRequestDataMap::allocator_type(arena))
     , status(FrameViewRequest::eFrameViewRequestStatusNotRendered)
     , frameViewsNeeded()
     , neededComps()
     , distortion()
     , distortionStack()
+    , colorTransformStack()
     , canonicalRoDs()
     , pixelRoDs()
     , byPassCache(false)
+    , resumedAfterPendingTiles(false)
+    , streamedRender(false)
+    , gpuImageCacheEnabled(false)
+    , openGLRenderTileSize(0)
     {
 #ifdef TRACE_REQUEST_LIFETIME
         nodeName = effect->getNode()->getScriptName_mt_safe();
@@ -266,6 +299,20 @@ struct FrameViewRequestPrivate
             fallbackRenderDevice = eRenderBackendTypeOpenGL;
         }
     }
+
+    /**
+     * @brief Returns the dependencies and listeners for the given launch, creating them in the arena if needed.
+     * Must be called with lock held.
+     **/
+    PerLaunchRequestData& getLaunchData(const TreeRenderExecutionDataPtr& request)
+    {
+        TreeRenderExecutionDataWPtr key = request;
+        LaunchRequestDataMap::iterator found = requestData.find(key);
+        if (found == requestData.end()) {
+            found = requestData.insert(std::make_pair(key, PerLaunchRequestData(arena))).first;
+        }
+        return found->second;
+    }
 };
 
 FrameViewRequest::FrameViewRequest(const ImagePlaneDesc& plane,
@@ -405,6 +452,8 @@ FrameViewRequest::getDescribedOnce() const
 FrameViewRequestLocker::FrameViewRequestLocker(const FrameViewRequestPtr& request, bool doLock)
 : request(request)
 , locked(false)
+, profiled(false)
+, lockTime(0)
 {
     if (doLock) {
         lockRequest();
@@ -421,6 +470,11 @@ FrameViewRequestLocker::tryLockRequest()
 {
     if (!locked) {
         locked = request->_imp->renderLock.tryLock();
+        profiled = locked && LockProfiler::isEnabled();
+        if (profiled) {
+            lockTime = LockProfiler::getTime();
+            LockProfiler::recordAcquisition(eLockProfilerSiteFrameViewRequest, false, 0.);
+        }
         return locked;
     } else {
         return false;
@@ -431,13 +485,18 @@ void
 FrameViewRequestLocker::lockRequest()
 {
     if (!locked) {
-        if (!request->_imp->renderLock.tryLock()) {
+        profiled = LockProfiler::isEnabled();
+        double startTime = profiled ? LockProfiler::getTime() : 0.;
+        bool contended = !request->_imp->renderLock.tryLock();
+        if (contended) {
             // We may take a while before getting the lock, so release this thread to the thread pool in the meantime
             ReleaseTPThread_RAII _thread_releaser;
             request->_imp->renderLock.lock();
-            locked = true;
-        } else {
-            locked = true;
+        }
+        locked = true;
+        if (profiled) {
+            lockTime = LockProfiler::getTime();
+            LockProfiler::recordAcquisition(eLockProfilerSiteFrameViewRequest, contended, contended ? lockTime - startTime : 0.);
         }
 
     }
@@ -447,9 +506,12 @@ void
 FrameViewRequestLocker::unlockRequest()
 {
     if (locked) {
-        
+        double holdTime = profiled ? LockProfiler::getTime() - lockTime : 0.;
         request->_imp->renderLock.unlock();
         locked = false;
+        if (profiled) {
+            LockProfiler::recordRelease(eLockProfilerSiteFrameViewRequest, holdTime);
+        }
     }
 
 }
@@ -484,6 +546,64 @@ FrameViewRequest::notifyRenderFinished(ActionRetCodeEnum stat)
     _imp->status = FrameViewRequest::eFrameViewRequestStatusRendered;
 }
 
+void
+FrameViewRequest::notifyRenderWaitingForPendingTiles()
+{
+    assert(!_imp->renderLock.tryLock());
+    assert(_imp->status == FrameViewRequest::eFrameViewRequestStatusPending);
+    _imp->status = FrameViewRequest::eFrameViewRequestStatusNotRendered;
+    _imp->resumedAfterPendingTiles = true;
+}
+
+bool
+FrameViewRequest::isResumedAfterPendingTiles() const
+{
+    assert(!_imp->renderLock.tryLock());
+    return _imp->resumedAfterPendingTiles;
+}
+
+void
+FrameViewRequest::setStreamedRender(bool streamed)
+{
+    assert(!_imp->renderLock.tryLock());
+    _imp->streamedRender = streamed;
+}
+
+bool
+FrameViewRequest::isStreamedRender() const
+{
+    assert(!_imp->renderLock.tryLock());
+    return _imp->streamedRender;
+}
+
+void
+FrameViewRequest::setGPUImageCacheEnabled(bool enabled)
+{
+    assert(!_imp->renderLock.tryLock());
+    _imp->gpuImageCacheEnabled = enabled;
+}
+
+bool
+FrameViewRequest::isGPUImageCacheEnabled() const
+{
+    assert(!_imp->renderLock.tryLock());
+    return _imp->gpuImageCacheEnabled;
+}
+
+void
+FrameViewRequest::setOpenGLRenderTileSize(int tileSize)
+{
+    assert(!_imp->renderLock.tryLock());
+    _imp->openGLRenderTileSize = tileSize;
+}
+
+int
+FrameViewRequest::getOpenGLRenderTileSize() const
+{
+    assert(!_imp->renderLock.tryLock());
+    return _imp->openGLRenderTileSize;
+}
+
 
 RectD
 FrameViewRequest::getCurrentRoI() const
@@ -504,7 +624,7 @@ FrameViewRequest::addDependency(const TreeRenderExecutionDataPtr& request, const
 
     {
         QMutexLocker k(&_imp->lock);
-        PerLaunchRequestData& data = _imp->requestData[request];
+        PerLaunchRequestData& data = _imp->getLaunchData(request);
         data.dependencies.insert(deps);
     }
 }
@@ -515,7 +635,7 @@ FrameViewRequest::markDependencyAsRendered(const TreeRenderExecutionDataPtr& req
 
     FrameViewRequestStatusEnum status = getStatus();
     QMutexLocker k(&_imp->lock);
-    PerLaunchRequestData& data = _imp->requestData[request];
+    PerLaunchRequestData& data = _imp->getLaunchData(request);
 
     // If this FrameViewRequest is pass-through, copy results from the pass-through dependency
     if (status == eFrameViewRequestStatusPassThrough) {
@@ -525,7 +645,7 @@ FrameViewRequest::markDependencyAsRendered(const TreeRenderExecutionDataPtr& req
         _imp->finalRoi = deps->getCurrentRoI();
     }
 
-    std::set<FrameViewRequestPtr>::iterator foundDep = data.dependencies.find(deps);
+    FrameViewRequestSet::iterator foundDep = data.dependencies.find(deps);
     if (foundDep != data.dependencies.end()) {
         // The dependency might not exist if we did not call addDependency.
         // This may happen if we were aborted
@@ -539,15 +659,23 @@ void
 FrameViewRequest::clearRenderedDependencies(const TreeRenderExecutionDataPtr& request)
 {
     QMutexLocker k(&_imp->lock);
-    PerLaunchRequestData& data = _imp->requestData[request];
+    PerLaunchRequestData& data = _imp->getLaunchData(request);
     data.renderedDependencies.clear();
 }
 
+std::list<FrameViewRequestPtr>
+FrameViewRequest::getRenderedDependencies(const TreeRenderExecutionDataPtr& request) const
+{
+    QMutexLocker k(&_imp->lock);
+    PerLaunchRequestData& data = _imp->getLaunchData(request);
+    return std::list<FrameViewRequestPtr>( data.renderedDependencies.begin(), data.renderedDependencies.end() );
+}
+
 int
 FrameViewRequest::getNumDependencies(const TreeRenderExecutionDataPtr& request) const
 {
     QMutexLocker k(&_imp->lock);
-    PerLaunchRequestData& data = _imp->requestData[request];
+    PerLaunchRequestData& data = _imp->getLaunchData(request);
     return data.dependencies.size();
 }
 
@@ -556,7 +684,7 @@ FrameViewRequest::addListener(const TreeRenderExecutionDataPtr& request, const F
 {
     assert(other);
     QMutexLocker k(&_imp->lock);
-    PerLaunchRequestData& data = _imp->requestData[request];
+    PerLaunchRequestData& data = _imp->getLaunchData(request);
     data.listeners.insert(other);
 }
 
@@ -565,8 +693,8 @@ FrameViewRequest::getListeners(const TreeRenderExecutionDataPtr& request) const
 {
     std::list<FrameViewRequestPtr> ret;
     QMutexLocker k(&_imp->lock);
-    PerLaunchRequestData& data = _imp->requestData[request];
-    for (std::set<FrameViewRequestWPtr>::const_iterator it = data.listeners.begin(); it != data.listeners.end(); ++it) {
+    PerLaunchRequestData& data = _imp->getLaunchData(request);
+    for (FrameViewRequestWSet::const_iterator it = data.listeners.begin(); it != data.listeners.end(); ++it) {
         FrameViewRequestPtr l = it->lock();
         if (l) {
             ret.push_back(l);
@@ -579,7 +707,7 @@ std::size_t
 FrameViewRequest::getNumListeners(const TreeRenderExecutionDataPtr& request) const
 {
     assert(!_imp->renderLock.tryLock());
-    PerLaunchRequestData& data = _imp->requestData[request];
+    PerLaunchRequestData& data = _imp->getLaunchData(request);
     return data.listeners.size();
 }
 
@@ -707,6 +835,21 @@ FrameViewRequest::setDistorsionStack(const Distortion2DStackPtr& stack)
     _imp->distortionStack = stack;
 }
 
+ColorTransformStackPtr
+FrameViewRequest::getColorTransformStack() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->colorTransformStack;
+}
+
+void
+FrameViewRequest::setColorTransformStack(const ColorTransformStackPtr& stack)
+{
+    assert(!_imp->renderLock.tryLock());
+    QMutexLocker k(&_imp->lock);
+    _imp->colorTransformStack = stack;
+}
+
 bool
 FrameViewRequest::getRoDAtEachMipMapLevel(std::vector<RectD>* canonicalRoDs, std::vector<RectI>* pixelRoDs) const
 {
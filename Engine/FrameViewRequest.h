@@ -333,6 +333,11 @@ public:
      **/
     void clearRenderedDependencies(const TreeRenderExecutionDataPtr& requestData);
 
+    /**
+     * @brief Returns the dependencies that were marked rendered with markDependencyAsRendered() and not cleared yet.
+     **/
+    std::list<FrameViewRequestPtr> getRenderedDependencies(const TreeRenderExecutionDataPtr& requestData) const;
+
     /**
      * @brief Get the number of dependencies left to render for this frame/view.
      * If this returns 0, then this frame/view can be rendered.
@@ -435,6 +440,14 @@ public:
     Distortion2DStackPtr getDistorsionStack() const;
     void setDistorsionStack(const Distortion2DStackPtr& stack);
 
+    /**
+     * @brief The stack of color transforms concatenated up to this request.
+     * If the request is pass-through, the stack still has to be applied onto the image of the request
+     * by the effect downstream, otherwise this request renders the stack itself.
+     **/
+    ColorTransformStackPtr getColorTransformStack() const;
+    void setColorTransformStack(const ColorTransformStackPtr& stack);
+
     /**
      * @brief The RoD of the associated effect at each mipmap level
      **/
@@ -461,6 +474,42 @@ public:
      **/
     void notifyRenderFinished(ActionRetCodeEnum stat);
 
+    /**
+     * @brief Called instead of notifyRenderFinished() when launchRender() returned eActionStatusPendingTiles:
+     * the render is set back to eFrameViewRequestStatusNotRendered so that it can be launched again once the tiles
+     * pending in another thread are rendered.
+     **/
+    void notifyRenderWaitingForPendingTiles();
+
+    /**
+     * @brief Returns true if a previous launch of the render returned eActionStatusPendingTiles. In that case
+     * the tiles state must be fetched again from the cache.
+     **/
+    bool isResumedAfterPendingTiles() const;
+
+    /**
+     * @brief When set, the inputs were not requested upstream for the whole RoI: the render window is rendered
+     * in horizontal stripes, each fetching the images of the inputs it needs while rendering, see EffectInstance::getImagePlane.
+     * The images upstream are then only allocated for one stripe at a time.
+     **/
+    void setStreamedRender(bool streamed);
+    bool isStreamedRender() const;
+
+    /**
+     * @brief When set, the image is rendered with OpenGL and should be cached: it is looked up and inserted in the
+     * GPU image cache instead of the tile cache, see GPUImageCache.
+     **/
+    void setGPUImageCacheEnabled(bool enabled);
+    bool isGPUImageCacheEnabled() const;
+
+    /**
+     * @brief When not 0, the RoI does not fit in a texture of the OpenGL context or in its VRAM budget: the render window
+     * is rendered with OpenGL in square tiles of this size, each rendered in a temporary texture and copied to the output
+     * image which is in RAM and cached in the tile cache.
+     **/
+    void setOpenGLRenderTileSize(int tileSize);
+    int getOpenGLRenderTileSize() const;
+
 private:
 
     friend class FrameViewRequestLocker;
@@ -474,6 +523,10 @@ class FrameViewRequestLocker
 {
     FrameViewRequestPtr request;
     bool locked;
+
+    // When the lock was taken while the LockProfiler is enabled, the time at which it was taken
+    bool profiled;
+    double lockTime;
 public:
 
     FrameViewRequestLocker(const FrameViewRequestPtr& request, bool doLock = true);
@@ -0,0 +1,189 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "GLProgramBinaryCache.h"
+
+#include <cstring> // memcmp
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include "Engine/AppManager.h"
+#include "Engine/Hash64.h"
+
+#define NATRON_GL_PROGRAM_BINARY_DIR_NAME "GLPrograms"
+
+// Increment when the layout of the files changes
+#define NATRON_GL_PROGRAM_BINARY_FILE_VERSION 1
+
+// Larger binaries are not cached: a file this large is most likely corrupted
+#define NATRON_GL_PROGRAM_BINARY_MAX_SIZE (64 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER
+
+static const char programBinaryMagic[4] = { 'N', 'G', 'P', 'B' };
+
+// Serializes the writes of this process, the temporary file names take care of the other processes
+static QMutex programBinaryWriteMutex;
+
+U64
+GLProgramBinaryCache::computeProgramKey(const std::string& driverID,
+                                        const std::string& vertexSource,
+                                        const std::string& fragmentSource)
+{
+    Hash64 hash;
+    hash.append<U32>(NATRON_GL_PROGRAM_BINARY_FILE_VERSION);
+    Hash64::appendQString(QString::fromUtf8( driverID.c_str() ), &hash);
+    Hash64::appendQString(QString::fromUtf8( vertexSource.c_str() ), &hash);
+
+    // Separate the sources so that moving code from one shader to the other changes the key
+    hash.append<U32>(0);
+    Hash64::appendQString(QString::fromUtf8( fragmentSource.c_str() ), &hash);
+    hash.computeHash();
+
+    return hash.value();
+}
+
+std::string
+GLProgramBinaryCache::getCacheDirectory()
+{
+    QString dirPath = QString::fromUtf8( appPTR->getCacheDirPath().c_str() ) + QLatin1Char('/') + QString::fromUtf8(NATRON_GL_PROGRAM_BINARY_DIR_NAME);
+
+    return dirPath.toStdString();
+}
+
+static std::string
+getProgramBinaryFilePath(const std::string& dirPath, U64 key)
+{
+    return dirPath + '/' + QString::number(key, 16).toStdString() + ".bin";
+}
+
+bool
+GLProgramBinaryCache::loadProgramBinary(U64 key,
+                                        U32* binaryFormat,
+                                        std::vector<char>* binary)
+{
+    return readProgramBinaryFile(getProgramBinaryFilePath(getCacheDirectory(), key), key, binaryFormat, binary);
+}
+
+void
+GLProgramBinaryCache::saveProgramBinary(U64 key,
+                                        U32 binaryFormat,
+                                        const std::vector<char>& binary)
+{
+    std::string dirPath = getCacheDirectory();
+    QDir().mkpath( QString::fromUtf8( dirPath.c_str() ) );
+    writeProgramBinaryFile(getProgramBinaryFilePath(dirPath, key), key, binaryFormat, binary);
+}
+
+bool
+GLProgramBinaryCache::readProgramBinaryFile(const std::string& filePath,
+                                            U64 key,
+                                            U32* binaryFormat,
+                                            std::vector<char>* binary)
+{
+    QFile file( QString::fromUtf8( filePath.c_str() ) );
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+
+    char magic[4];
+    U32 version;
+    U64 fileKey;
+    U64 size;
+    if ( (file.read(magic, sizeof(magic)) != sizeof(magic)) || (std::memcmp(magic, programBinaryMagic, sizeof(magic)) != 0) ) {
+        return false;
+    }
+    if ( (file.read( (char*)&version, sizeof(version) ) != sizeof(version)) || (version != NATRON_GL_PROGRAM_BINARY_FILE_VERSION) ) {
+        return false;
+    }
+    if ( (file.read( (char*)&fileKey, sizeof(fileKey) ) != sizeof(fileKey)) || (fileKey != key) ) {
+        return false;
+    }
+    if ( file.read( (char*)binaryFormat, sizeof(*binaryFormat) ) != sizeof(*binaryFormat) ) {
+        return false;
+    }
+    if ( (file.read( (char*)&size, sizeof(size) ) != sizeof(size)) || (size == 0) || (size > NATRON_GL_PROGRAM_BINARY_MAX_SIZE) ) {
+        return false;
+    }
+    binary->resize( (std::size_t)size );
+    if ( file.read(&(*binary)[0], (qint64)size) != (qint64)size ) {
+        binary->clear();
+
+        return false;
+    }
+
+    return true;
+} // readProgramBinaryFile
+
+bool
+GLProgramBinaryCache::writeProgramBinaryFile(const std::string& filePath,
+                                             U64 key,
+                                             U32 binaryFormat,
+                                             const std::vector<char>& binary)
+{
+    if ( binary.empty() || (binary.size() > NATRON_GL_PROGRAM_BINARY_MAX_SIZE) ) {
+        return false;
+    }
+
+    QMutexLocker k(&programBinaryWriteMutex);
+
+    // Write to a temporary file first so that another process never reads a partially written program
+    QString path = QString::fromUtf8( filePath.c_str() );
+    QString tmpPath = path + QString::fromUtf8(".tmp") + QString::number( QCoreApplication::applicationPid() );
+    {
+        QFile file(tmpPath);
+        if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            return false;
+        }
+        const U32 version = NATRON_GL_PROGRAM_BINARY_FILE_VERSION;
+        const U64 size = binary.size();
+        bool ok = file.write( programBinaryMagic, sizeof(programBinaryMagic) ) == sizeof(programBinaryMagic);
+        ok = ok && file.write( (const char*)&version, sizeof(version) ) == sizeof(version);
+        ok = ok && file.write( (const char*)&key, sizeof(key) ) == sizeof(key);
+        ok = ok && file.write( (const char*)&binaryFormat, sizeof(binaryFormat) ) == sizeof(binaryFormat);
+        ok = ok && file.write( (const char*)&size, sizeof(size) ) == sizeof(size);
+        ok = ok && file.write( &binary[0], (qint64)size ) == (qint64)size;
+        file.close();
+        if (!ok) {
+            QFile::remove(tmpPath);
+
+            return false;
+        }
+    }
+    QFile::remove(path);
+    if ( !QFile::rename(tmpPath, path) ) {
+        QFile::remove(tmpPath);
+
+        return false;
+    }
+
+    return true;
+} // writeProgramBinaryFile
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,86 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_GLProgramBinaryCache_h
+#define Engine_GLProgramBinaryCache_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief On-disk cache of the linked GLSL programs returned by glGetProgramBinary, used by GLShader.
+ * Compiling the internal shaders (fill, copy, mask mix, roto, ...) is expensive, in particular with OSMesa, and is
+ * done for each OpenGL context: with this cache only the first context ever created on a given driver compiles them.
+ *
+ * A program is identified by the driver that built it (vendor, renderer and version strings) and the sources of its
+ * shaders. Binaries are stored in the GLPrograms directory of the cache, one file per program. A binary that the driver
+ * rejects (e.g. after a driver update) is simply compiled again and replaced.
+ **/
+class GLProgramBinaryCache
+{
+public:
+
+    /**
+     * @brief Returns the key that identifies a program built by the given driver from the given sources
+     **/
+    static U64 computeProgramKey(const std::string& driverID,
+                                 const std::string& vertexSource,
+                                 const std::string& fragmentSource);
+
+    /**
+     * @brief Returns the directory where the programs are stored
+     **/
+    static std::string getCacheDirectory();
+
+    /**
+     * @brief Read the binary of the program with the given key from the cache directory.
+     * Returns false if the program is not in the cache.
+     **/
+    static bool loadProgramBinary(U64 key, U32* binaryFormat, std::vector<char>* binary);
+
+    /**
+     * @brief Write the binary of the program with the given key to the cache directory.
+     **/
+    static void saveProgramBinary(U64 key, U32 binaryFormat, const std::vector<char>& binary);
+
+    /**
+     * @brief Same as loadProgramBinary and saveProgramBinary for the given file. The key is stored in the file
+     * and checked when reading so that a truncated or foreign file is never given to the driver.
+     **/
+    static bool readProgramBinaryFile(const std::string& filePath, U64 key, U32* binaryFormat, std::vector<char>* binary);
+    static bool writeProgramBinaryFile(const std::string& filePath, U64 key, U32 binaryFormat, const std::vector<char>& binary);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_GLProgramBinaryCache_h
@@ -35,6 +35,7 @@
 #include "Global/GlobalDefines.h"
 #include "Global/GLIncludes.h"
 
+#include "Engine/GLProgramBinaryCache.h"
 #include "Engine/EngineFwd.h"
 
 NATRON_NAMESPACE_ENTER
@@ -94,6 +95,9 @@ public:
      * When done, the shader is ready to be used. Call bind() to activate the shader
      * and unbind() to deactivate it.
      * To set uniforms, call the setUniform function.
+     *
+     * If the driver supports program binaries, the shaders are compiled in link() only if the program
+     * is not in the GLProgramBinaryCache yet: compilation errors are then reported by link().
      **/
     GLShader()
     : _shaderID(0)
@@ -102,6 +106,9 @@ public:
     , _vertexAttached(false)
     , _fragmentAttached(false)
     , _firstTime(true)
+    , _useProgramBinaryCache(false)
+    , _vertexSource()
+    , _fragmentSource()
     {
 
     }
@@ -132,42 +139,20 @@ public:
                 return false;
             }
             _firstTime = false;
-
-        }
-
-        GLuint shader = 0;
-        if (type == eShaderTypeVertex) {
-            _vertexID = GL::CreateShader(GL_VERTEX_SHADER);
-
-            shader = _vertexID;
-        } else if (type == eShaderTypeFragment) {
-            _fragmentID = GL::CreateShader(GL_FRAGMENT_SHADER);
-
-            shader = _fragmentID;
-        } else {
-            assert(false);
+            _useProgramBinaryCache = isProgramBinarySupported();
         }
 
-        GL::ShaderSource(shader, 1, (const GLchar**)&src, 0);
-        GL::CompileShader(shader);
-        GLint isCompiled;
-        GL::GetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
-        if (isCompiled == GL_FALSE) {
-            if (error) {
-                getShaderInfoLog(shader, error);
+        if (_useProgramBinaryCache) {
+            // Compile in link() if the program is not in the cache
+            if (type == eShaderTypeVertex) {
+                _vertexSource = src;
+            } else {
+                _fragmentSource = src;
             }
-
-            return false;
+            return true;
         }
 
-        GL::AttachShader(_shaderID, shader);
-        if (type == eShaderTypeVertex) {
-            _vertexAttached = true;
-        } else {
-            _fragmentAttached = true;
-        }
-        
-        return true;
+        return compileAndAttachShader(type, src, error);
     }
 
     virtual void bind() OVERRIDE FINAL
@@ -177,6 +162,23 @@ public:
 
     virtual bool link(std::string* error = 0) OVERRIDE FINAL
     {
+        U64 programKey = 0;
+        if (_useProgramBinaryCache) {
+            programKey = GLProgramBinaryCache::computeProgramKey(getDriverID(), _vertexSource, _fragmentSource);
+            if ( loadProgramBinary(programKey) ) {
+                return true;
+            }
+
+            // Not in the cache or rejected by the driver: build it
+            if ( !_vertexSource.empty() && !compileAndAttachShader(eShaderTypeVertex, _vertexSource.c_str(), error) ) {
+                return false;
+            }
+            if ( !_fragmentSource.empty() && !compileAndAttachShader(eShaderTypeFragment, _fragmentSource.c_str(), error) ) {
+                return false;
+            }
+            GL::ProgramParameteri(_shaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
         GL::LinkProgram(_shaderID);
         GLint isLinked;
         GL::GetProgramiv(_shaderID, GL_LINK_STATUS, &isLinked);
@@ -187,7 +189,11 @@ public:
 
             return false;
         }
-        
+
+        if (_useProgramBinaryCache) {
+            saveProgramBinary(programKey);
+        }
+
         return true;
     }
 
@@ -248,6 +254,113 @@ public:
 
 private:
 
+    /**
+     * @brief Returns true if the current context can save and load program binaries
+     **/
+    static bool isProgramBinarySupported()
+    {
+        // The functions are not loaded if the GPU driver does not have the extension
+        if ( GL::isGPU() && !GLAD_GL_ARB_get_program_binary ) {
+            return false;
+        }
+        GLint nFormats = 0;
+        GL::GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+
+        // Without the extension (e.g. an older OSMesa), this is an invalid enum: clear the error
+        while (GL::GetError() != GL_NO_ERROR) {
+        }
+
+        return nFormats > 0;
+    }
+
+    /**
+     * @brief Identifies the driver of the current context: a binary may only be loaded by the driver that built it
+     **/
+    static std::string getDriverID()
+    {
+        std::string ret;
+        const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int i = 0; i < 3; ++i) {
+            const GLubyte* str = GL::GetString(names[i]);
+            if (str) {
+                ret.append( (const char*)str );
+            }
+            ret.push_back('\n');
+        }
+        ret.append( GL::isGPU() ? "GPU" : "CPU" );
+
+        return ret;
+    }
+
+    bool loadProgramBinary(U64 programKey)
+    {
+        U32 binaryFormat;
+        std::vector<char> binary;
+        if ( !GLProgramBinaryCache::loadProgramBinary(programKey, &binaryFormat, &binary) ) {
+            return false;
+        }
+        GL::ProgramBinary(_shaderID, (GLenum)binaryFormat, &binary[0], (GLsizei)binary.size());
+        GLint isLinked;
+        GL::GetProgramiv(_shaderID, GL_LINK_STATUS, &isLinked);
+
+        return isLinked != GL_FALSE;
+    }
+
+    void saveProgramBinary(U64 programKey)
+    {
+        GLint length = 0;
+        GL::GetProgramiv(_shaderID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+        std::vector<char> binary(length);
+        GLenum binaryFormat = 0;
+        GLsizei writtenLength = 0;
+        GL::GetProgramBinary(_shaderID, length, &writtenLength, &binaryFormat, &binary[0]);
+        if (writtenLength <= 0) {
+            return;
+        }
+        binary.resize(writtenLength);
+        GLProgramBinaryCache::saveProgramBinary(programKey, (U32)binaryFormat, binary);
+    }
+
+    bool compileAndAttachShader(ShaderTypeEnum type, const char* src, std::string* error)
+    {
+        GLuint shader = 0;
+        if (type == eShaderTypeVertex) {
+            _vertexID = GL::CreateShader(GL_VERTEX_SHADER);
+
+            shader = _vertexID;
+        } else if (type == eShaderTypeFragment) {
+            _fragmentID = GL::CreateShader(GL_FRAGMENT_SHADER);
+
+            shader = _fragmentID;
+        } else {
+            assert(false);
+        }
+
+        GL::ShaderSource(shader, 1, (const GLchar**)&src, 0);
+        GL::CompileShader(shader);
+        GLint isCompiled;
+        GL::GetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+        if (isCompiled == GL_FALSE) {
+            if (error) {
+                getShaderInfoLog(shader, error);
+            }
+
+            return false;
+        }
+
+        GL::AttachShader(_shaderID, shader);
+        if (type == eShaderTypeVertex) {
+            _vertexAttached = true;
+        } else {
+            _fragmentAttached = true;
+        }
+
+        return true;
+    }
+
     void getShaderInfoLog(GLuint shader,
                           std::string* error)
     {
@@ -265,6 +378,10 @@ private:
     GLuint _fragmentID;
     bool _vertexAttached, _fragmentAttached;
     bool _firstTime;
+
+    // When true, the shaders are compiled in link() only if the program is not in the GLProgramBinaryCache
+    bool _useProgramBinaryCache;
+    std::string _vertexSource, _fragmentSource;
 };
 
 NATRON_NAMESPACE_EXIT
@@ -25,29 +25,71 @@
 
 #include "GPUContextPool.h"
 
+#include <list>
 #include <set>
+#include <vector>
 #include <stdexcept>
 
 #include <QMutex>
 #include <QWaitCondition>
+#include <QtCore/QDebug>
 #include <QtCore/QThread>
 
 #include "Engine/AppManager.h"
+#include "Engine/GPUImageCache.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/Settings.h"
 
 #include "Global/GLIncludes.h"
 
 
+// The part of the VRAM of a GPU given to the renders, the rest is left to the viewers, the other applications and the driver
+#define NATRON_GL_VIDEO_MEMORY_BUDGET_PERCENT 75
+
 NATRON_NAMESPACE_ENTER
 
 
+// The OpenGL contexts created on one GPU
+struct GPUDeviceContexts
+{
+    GLRendererID rendererID;
+    std::vector<OSGLContextPtr> contexts;
+
+    // The index of the next context to hand out on this device
+    std::size_t nextContext;
+
+    // Set if a context could not be created on this device, in which case it is not used anymore
+    bool failed;
+
+    GPUDeviceContexts()
+    : rendererID()
+    , contexts()
+    , nextContext(0)
+    , failed(false)
+    {
+    }
+
+    // The number of renders currently holding a context of this device. The pool holds a reference to each
+    // context, each TreeRender holds one to its context for the whole frame.
+    long getNumActiveRenders() const
+    {
+        long ret = 0;
+        for (std::size_t i = 0; i < contexts.size(); ++i) {
+            ret += contexts[i].use_count() - 1;
+        }
+        return ret;
+    }
+};
+
 struct GPUContextPoolPrivate
 {
     mutable QMutex contextPoolMutex;
 
-    // protected by contextPoolMutex
-    std::set<OSGLContextPtr> glContextPool;
+    // The contexts of each GPU used for rendering, protected by contextPoolMutex
+    std::vector<GPUDeviceContexts> glDevices;
+
+    // The device to try first for the next render when devices are equally loaded
+    std::size_t nextGLDevice;
 
     OSGLContextWPtr lastUsedGLContext;
 
@@ -61,15 +103,59 @@ struct GPUContextPoolPrivate
 
     std::map<QThread*, OSGLContextAttacherWPtr> perThreadsActiveContext;
 
+    // The textures cached for the OpenGL contexts. Declared last so that it is destroyed first.
+    boost::scoped_ptr<GPUImageCache> imageCache;
+
     GPUContextPoolPrivate()
     : contextPoolMutex(QMutex::Recursive)
-    , glContextPool()
+    , glDevices()
+    , nextGLDevice(0)
     , lastUsedGLContext()
     , glShareContext()
     , cpuGLContextPool()
     , lastUsedCPUGLContext()
     , cpuGLShareContext()
+    , perThreadsActiveContext()
+    , imageCache( new GPUImageCache() )
+    {
+    }
+};
+
+/**
+ * @brief Removes the cached textures of the contexts dropped by the pool once the pool mutex is unlocked:
+ * releasing a texture attaches its context, which may be current to a thread waiting for the mutex.
+ * Declare it before the QMutexLocker.
+ **/
+class DroppedGLContexts
+{
+    GPUImageCache* _cache;
+    std::vector<OSGLContextPtr> _contexts;
+
+public:
+
+    DroppedGLContexts(GPUImageCache* cache)
+    : _cache(cache)
+    , _contexts()
+    {
+    }
+
+    ~DroppedGLContexts()
     {
+        for (std::size_t i = 0; i < _contexts.size(); ++i) {
+            _cache->removeContextEntries(_contexts[i]);
+        }
+    }
+
+    void add(const OSGLContextPtr& context)
+    {
+        _contexts.push_back(context);
+    }
+
+    void add(const std::vector<GPUDeviceContexts>& devices)
+    {
+        for (std::size_t i = 0; i < devices.size(); ++i) {
+            _contexts.insert( _contexts.end(), devices[i].contexts.begin(), devices[i].contexts.end() );
+        }
     }
 };
 
@@ -82,6 +168,25 @@ GPUContextPool::~GPUContextPool()
 {
 }
 
+GPUImageCache*
+GPUContextPool::getImageCache() const
+{
+    return _imp->imageCache.get();
+}
+
+std::size_t
+GPUContextPool::getVideoMemoryAllocated() const
+{
+    QMutexLocker k(&_imp->contextPoolMutex);
+    std::size_t ret = 0;
+    for (std::size_t i = 0; i < _imp->glDevices.size(); ++i) {
+        for (std::size_t j = 0; j < _imp->glDevices[i].contexts.size(); ++j) {
+            ret += _imp->glDevices[i].contexts[j]->getVideoMemoryAllocated();
+        }
+    }
+    return ret;
+}
+
 void
 GPUContextPool::registerContextForThread(const OSGLContextAttacherPtr& context)
 {
@@ -133,9 +238,34 @@ GPUContextPool::getThreadLocalContext() const
 void
 GPUContextPool::clear()
 {
+    DroppedGLContexts droppedContexts( _imp->imageCache.get() );
     QMutexLocker k(&_imp->contextPoolMutex);
 
-    _imp->glContextPool.clear();
+    droppedContexts.add(_imp->glDevices);
+    _imp->glDevices.clear();
+}
+
+static bool
+isSameRenderer(const GLRendererID& a, const GLRendererID& b)
+{
+    return a.renderID == b.renderID && a.rendererHandle == b.rendererHandle;
+}
+
+/**
+ * @brief Returns the VRAM that the renders on the given device may allocate, or 0 if it is unknown.
+ * The default renderer is the first one reported by the system.
+ **/
+static std::size_t
+getDeviceVideoMemoryBudget(const GLRendererID& rendererID)
+{
+    const bool isDefaultRenderer = (rendererID.renderID == -1) && !rendererID.rendererHandle;
+    const std::list<OpenGLRendererInfo>& renderers = appPTR->getOpenGLRenderers();
+    for (std::list<OpenGLRendererInfo>::const_iterator it = renderers.begin(); it != renderers.end(); ++it) {
+        if ( isDefaultRenderer || isSameRenderer(it->rendererID, rendererID) ) {
+            return it->maxMemBytes / 100 * NATRON_GL_VIDEO_MEMORY_BUDGET_PERCENT;
+        }
+    }
+    return 0;
 }
 
 OSGLContextPtr
@@ -144,6 +274,7 @@ GPUContextPool::getOrCreateOpenGLContext(bool retrieveLastContext, bool checkIfG
     if (checkIfGLLoaded && (!appPTR->isOpenGLLoaded() || !appPTR->getCurrentSettings()->isOpenGLRenderingEnabled())) {
         throw std::runtime_error("OpenGL rendering is disabled");
     }
+    DroppedGLContexts droppedContexts( _imp->imageCache.get() );
     QMutexLocker k(&_imp->contextPoolMutex);
 
     if (retrieveLastContext) {
@@ -157,39 +288,92 @@ GPUContextPool::getOrCreateOpenGLContext(bool retrieveLastContext, bool checkIfG
     OSGLContextPtr shareContext;// _imp->glShareContext.lock();
     OSGLContextPtr newContext;
     SettingsPtr settings =  appPTR->getCurrentSettings();
-    GLRendererID rendererID;
+    std::vector<GLRendererID> rendererIDs;
     if (settings) {
-        rendererID = settings->getActiveOpenGLRendererID();
+        settings->getOpenGLRenderersForRendering(&rendererIDs);
+    }
+    if ( rendererIDs.empty() ) {
+        rendererIDs.push_back( GLRendererID() );
+    }
+
+    // The contexts are created on each device used for rendering, the devices only change if the settings change
+    bool devicesChanged = _imp->glDevices.size() != rendererIDs.size();
+    for (std::size_t i = 0; !devicesChanged && i < rendererIDs.size(); ++i) {
+        devicesChanged = !isSameRenderer(_imp->glDevices[i].rendererID, rendererIDs[i]);
+    }
+    if (devicesChanged) {
+        droppedContexts.add(_imp->glDevices);
+        _imp->glDevices.clear();
+        _imp->glDevices.resize( rendererIDs.size() );
+        for (std::size_t i = 0; i < rendererIDs.size(); ++i) {
+            _imp->glDevices[i].rendererID = rendererIDs[i];
+        }
+        _imp->nextGLDevice = 0;
     }
 
     int maxContexts = settings ? std::max(settings->getMaxOpenGLContexts(), 1) : 1;
 
-    if ( (int)_imp->glContextPool.size() < maxContexts ) {
-        //  Create a new one
-        newContext = OSGLContext::create( FramebufferConfig(), shareContext.get(), true /*useGPU*/, -1, -1, rendererID );
-        _imp->glContextPool.insert(newContext);
-    } else {
-        while ((int)_imp->glContextPool.size() > maxContexts) {
-            _imp->glContextPool.erase(_imp->glContextPool.begin());
+    while (!newContext) {
+
+        // A whole frame is rendered with the same context: give it to the device that renders the fewest frames,
+        // cycle through the devices with the same load so that they all get to work
+        const std::size_t nDevices = _imp->glDevices.size();
+        int deviceIndex = -1;
+        long deviceLoad = 0;
+        for (std::size_t i = 0; i < nDevices; ++i) {
+            std::size_t index = (_imp->nextGLDevice + i) % nDevices;
+            const GPUDeviceContexts& device = _imp->glDevices[index];
+            if (device.failed) {
+                continue;
+            }
+            long load = device.getNumActiveRenders();
+            if ( (deviceIndex == -1) || (load < deviceLoad) ) {
+                deviceIndex = (int)index;
+                deviceLoad = load;
+            }
         }
-
-        // Cycle through all contexts for all renders
-        OSGLContextPtr lastContext = _imp->lastUsedGLContext.lock();
-        if (!lastContext) {
-            newContext = *_imp->glContextPool.begin();
-        } else {
-            std::set<OSGLContextPtr>::iterator foundLast = _imp->glContextPool.find(lastContext);
-            assert( foundLast != _imp->glContextPool.end() );
-            if ( foundLast == _imp->glContextPool.end() ) {
-                throw std::logic_error("No context to attach");
-            } else {
-                std::set<OSGLContextPtr>::iterator next = foundLast;
-                ++next;
-                if ( next == _imp->glContextPool.end() ) {
-                    next = _imp->glContextPool.begin();
+        if (deviceIndex == -1) {
+            throw std::runtime_error("Could not create an OpenGL context on any device");
+        }
+        _imp->nextGLDevice = (deviceIndex + 1) % nDevices;
+
+        GPUDeviceContexts& device = _imp->glDevices[deviceIndex];
+        if ( (int)device.contexts.size() < maxContexts ) {
+            //  Create a new one
+            try {
+                newContext = OSGLContext::create( FramebufferConfig(), shareContext.get(), true /*useGPU*/, -1, -1, device.rendererID );
+
+                // The contexts of a device share its memory
+                newContext->setVideoMemoryBudget( getDeviceVideoMemoryBudget(device.rendererID) / maxContexts );
+            } catch (const std::exception& e) {
+                if ( !device.contexts.empty() ) {
+                    // This device already has contexts, use them
+                    newContext = device.contexts[device.nextContext % device.contexts.size()];
+                    ++device.nextContext;
+                    break;
                 }
-                newContext = *next;
+                bool hasOtherDevice = false;
+                for (std::size_t i = 0; i < nDevices; ++i) {
+                    hasOtherDevice |= ( (int)i != deviceIndex ) && !_imp->glDevices[i].failed;
+                }
+                if (!hasOtherDevice) {
+                    throw;
+                }
+                // Keep rendering on the other devices
+                qDebug() << "Failed to create an OpenGL context on a GPU, it will not be used for rendering:" << e.what();
+                device.failed = true;
+                continue;
+            }
+            device.contexts.push_back(newContext);
+        } else {
+            while ((int)device.contexts.size() > maxContexts) {
+                droppedContexts.add( device.contexts.front() );
+                device.contexts.erase( device.contexts.begin() );
             }
+
+            // Cycle through all contexts of the device for all renders
+            newContext = device.contexts[device.nextContext % device.contexts.size()];
+            ++device.nextContext;
         }
     }
 
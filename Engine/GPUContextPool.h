@@ -49,6 +49,8 @@ public:
     /**
      * @brief Get an existing OpenGL context in the GPU pool or create a new one.
      * This function cycles through existing contexts so that each contexts gets to work.
+     * If the user enabled all GPUs in the settings, contexts are created on each GPU and the context
+     * is taken on the GPU with the fewest renders holding one of its contexts.
      * When exiting this function, the context is not necessarily current to the thread.
      * To make it current, create a OSGLContextAttacher object and call the attach() function.
      *
@@ -73,6 +75,17 @@ public:
      **/
     void clear();
 
+    /**
+     * @brief Returns the cache of the images rendered with the OpenGL contexts of this pool.
+     * The textures of a context are released when the pool drops the context.
+     **/
+    GPUImageCache* getImageCache() const;
+
+    /**
+     * @brief Returns the VRAM allocated by the renders in all the GPU contexts, in bytes. @see OSGLContext::getVideoMemoryAllocated
+     **/
+    std::size_t getVideoMemoryAllocated() const;
+
     /**
      * @brief If this thread currently has a bound OpenGL context, this returns a valid pointer to the object
      * that attached the context, otherwise NULL.
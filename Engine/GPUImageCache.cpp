@@ -0,0 +1,483 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "GPUImageCache.h"
+
+#include <list>
+#include <map>
+
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include "Engine/AppManager.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Hash64.h"
+#include "Engine/Image.h"
+#include "Engine/ImageCacheEntry.h"
+#include "Engine/ImageStorage.h"
+#include "Engine/Node.h"
+#include "Engine/OSGLContext.h"
+#include "Engine/Settings.h"
+
+NATRON_NAMESPACE_ENTER
+
+struct GPUImageCacheEntry
+{
+    U64 key;
+
+    // The context owning the texture. It is not held: it removes its entries before being destroyed
+    const OSGLContext* contextID;
+    ImagePtr image;
+
+    // The node that rendered the image, used to insert the image in the tile cache on eviction
+    NodeWPtr node;
+    GPUImageCacheEntryArgs args;
+
+    // The number of bytes of the texture
+    std::size_t size;
+
+    // True once the entry was evicted and its texture started reading back to RAM
+    bool readbackStarted;
+
+    GPUImageCacheEntry()
+    : key(0)
+    , contextID(NULL)
+    , image()
+    , node()
+    , args()
+    , size(0)
+    , readbackStarted(false)
+    {
+    }
+};
+
+typedef boost::shared_ptr<GPUImageCacheEntry> GPUImageCacheEntryPtr;
+typedef std::list<GPUImageCacheEntryPtr> GPUImageCacheEntryList;
+
+// Entries are identified by their key and the context that owns the texture
+typedef std::pair<U64, const OSGLContext*> GPUImageCacheEntryID;
+typedef std::map<GPUImageCacheEntryID, GPUImageCacheEntryList::iterator> GPUImageCacheEntriesMap;
+
+struct GPUImageCachePrivate
+{
+    // Protects all members
+    mutable QMutex lock;
+
+    // The cached entries, the most recently used first
+    GPUImageCacheEntryList lru;
+
+    // Iterators in lru
+    GPUImageCacheEntriesMap entries;
+
+    // Entries removed from lru because the budget was exceeded.
+    // They can only be read back when their context is current, hence they are sorted by context.
+    std::map<const OSGLContext*, GPUImageCacheEntryList> evictedEntries;
+
+    // The number of bytes of all textures, including the evicted ones not yet released
+    std::size_t size;
+
+    GPUImageCachePrivate()
+    : lock()
+    , lru()
+    , entries()
+    , evictedEntries()
+    , size(0)
+    {
+    }
+
+    void removeEntry(GPUImageCacheEntriesMap::iterator it);
+
+    void evictUntilSizeBelow(std::size_t maxSize);
+
+    void takeEvictedEntriesToRelease(const OSGLContextPtr& context, GPUImageCacheEntryList* entriesToRelease);
+};
+
+static std::size_t
+getTextureSize(const ImagePtr& image)
+{
+    // OpenGL textures are always RGBA float
+    return (std::size_t)image->getBounds().area() * 4 * sizeof(float);
+}
+
+U64
+GPUImageCache::makeKey(const GPUImageCacheEntryArgs& args)
+{
+    Hash64 hash;
+    hash.append(args.nodeTimeViewVariantHash);
+    Hash64::appendQString(QString::fromUtf8( args.plane.getPlaneID().c_str() ), &hash);
+    hash.append(args.proxyScale.x);
+    hash.append(args.proxyScale.y);
+    hash.append<U32>(args.mipMapLevel);
+    hash.append<U32>(args.isDraft ? 1 : 0);
+    hash.computeHash();
+
+    return hash.value();
+}
+
+bool
+GPUImageCache::isGPUImageCacheEnabled()
+{
+    SettingsPtr settings = appPTR->getCurrentSettings();
+
+    return settings && settings->getGPUImageCacheSize() > 0;
+}
+
+GPUImageCache::GPUImageCache()
+    : _imp( new GPUImageCachePrivate() )
+{
+}
+
+GPUImageCache::~GPUImageCache()
+{
+    // The contexts must have removed their entries before being destroyed
+    assert(_imp->lru.empty() && _imp->evictedEntries.empty());
+}
+
+void
+GPUImageCachePrivate::removeEntry(GPUImageCacheEntriesMap::iterator it)
+{
+    const GPUImageCacheEntryPtr& entry = *it->second;
+    assert(size >= entry->size);
+    size -= entry->size;
+    lru.erase(it->second);
+    entries.erase(it);
+}
+
+void
+GPUImageCachePrivate::evictUntilSizeBelow(std::size_t maxSize)
+{
+    // Evicted entries stay counted in the size until they are released: do not evict
+    // more cached entries to make up for them
+    while ( (size > maxSize) && !lru.empty() ) {
+        GPUImageCacheEntryPtr entry = lru.back();
+        GPUImageCacheEntriesMap::iterator found = entries.find( GPUImageCacheEntryID(entry->key, entry->contextID) );
+        assert( found != entries.end() );
+        if ( found == entries.end() ) {
+            lru.pop_back();
+            continue;
+        }
+        entries.erase(found);
+        lru.pop_back();
+
+        evictedEntries[entry->contextID].push_back(entry);
+    }
+}
+
+void
+GPUImageCachePrivate::takeEvictedEntriesToRelease(const OSGLContextPtr& context,
+                                                  GPUImageCacheEntryList* entriesToRelease)
+{
+    std::map<const OSGLContext*, GPUImageCacheEntryList>::iterator foundContext = evictedEntries.find( context.get() );
+    if ( foundContext == evictedEntries.end() ) {
+        return;
+    }
+
+    // The readback of an entry is started the first time its context is seen after the eviction, the entry is moved
+    // to the tile cache the next time, once the transfer most likely completed.
+    GPUImageCacheEntryList& contextEntries = foundContext->second;
+    for (GPUImageCacheEntryList::iterator it = contextEntries.begin(); it != contextEntries.end();) {
+        if ( !(*it)->readbackStarted ) {
+            (*it)->image->startGPUReadback();
+            (*it)->readbackStarted = true;
+            ++it;
+        } else {
+            assert(size >= (*it)->size);
+            size -= (*it)->size;
+            entriesToRelease->push_back(*it);
+            it = contextEntries.erase(it);
+        }
+    }
+    if ( contextEntries.empty() ) {
+        evictedEntries.erase(foundContext);
+    }
+}
+
+/**
+ * @brief Copies the texture of an evicted entry to RAM tiles inserted in the tile cache.
+ * Tiles already in the tile cache or being rendered by another thread are left untouched.
+ **/
+static void
+moveEntryToTileCache(const GPUImageCacheEntry& entry)
+{
+    NodePtr node = entry.node.lock();
+    if (!node) {
+        return;
+    }
+    EffectInstancePtr effect = node->getEffectInstance();
+    if (!effect) {
+        return;
+    }
+
+    Image::InitStorageArgs initArgs;
+    {
+        initArgs.bounds = entry.image->getBounds();
+        initArgs.perMipMapPixelRoD = entry.args.perMipMapPixelRoD;
+        initArgs.cachePolicy = eCacheAccessModeReadWrite;
+        initArgs.renderClone = effect;
+        initArgs.proxyScale = entry.args.proxyScale;
+        initArgs.mipMapLevel = entry.args.mipMapLevel;
+        initArgs.isDraft = entry.args.isDraft;
+        initArgs.nodeTimeViewVariantHash = entry.args.nodeTimeViewVariantHash;
+        initArgs.bufferFormat = entry.args.bufferFormat;
+        initArgs.bitdepth = entry.args.bitdepth;
+        initArgs.plane = entry.args.plane;
+        initArgs.storage = eStorageModeRAM;
+        initArgs.delayAllocation = true;
+    }
+    ImagePtr ramImage = Image::create(initArgs);
+    if (!ramImage) {
+        return;
+    }
+    ImageCacheEntryPtr cacheEntry = ramImage->getCacheEntry();
+    if (!cacheEntry) {
+        return;
+    }
+
+    bool hasUnrenderedTile, hasPendingTiles;
+    ActionRetCodeEnum stat = cacheEntry->fetchCachedTilesAndUpdateStatus(false /*readOnly*/, NULL, &hasUnrenderedTile, &hasPendingTiles);
+    if ( isFailureRetCode(stat) || !hasUnrenderedTile ) {
+        cacheEntry->markCacheTilesAsAborted();
+
+        return;
+    }
+
+    ramImage->ensureBuffersAllocated();
+
+    // This waits for the readback started on eviction
+    Image::CopyPixelsArgs copyArgs;
+    copyArgs.roi = initArgs.bounds;
+    stat = ramImage->copyPixels(*entry.image, copyArgs);
+    if ( isFailureRetCode(stat) ) {
+        cacheEntry->markCacheTilesAsAborted();
+    } else {
+        cacheEntry->markCacheTilesAsRendered();
+    }
+} // moveEntryToTileCache
+
+ImagePtr
+GPUImageCache::get(U64 key,
+                   const OSGLContextPtr& context,
+                   const RectI& roi)
+{
+    OSGLContextSaver contextSaver;
+    OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(context);
+    contextAttacher->attach();
+
+    ImagePtr ret;
+    GPUImageCacheEntryList entriesToRelease;
+    {
+        QMutexLocker k(&_imp->lock);
+
+        GPUImageCacheEntriesMap::iterator found = _imp->entries.find( GPUImageCacheEntryID( key, context.get() ) );
+        if ( found != _imp->entries.end() ) {
+            const GPUImageCacheEntryPtr& entry = *found->second;
+            if ( entry->image->getBounds().contains(roi) ) {
+                ret = entry->image;
+
+                // Move it to the front of the LRU
+                _imp->lru.splice(_imp->lru.begin(), _imp->lru, found->second);
+            }
+        }
+
+        // Forget about the entries evicted while the budget was adjusted in the settings
+        _imp->evictUntilSizeBelow( appPTR->getCurrentSettings()->getGPUImageCacheSize() );
+        _imp->takeEvictedEntriesToRelease(context, &entriesToRelease);
+    }
+
+    // Do not hold the lock while copying textures
+    for (GPUImageCacheEntryList::const_iterator it = entriesToRelease.begin(); it != entriesToRelease.end(); ++it) {
+        moveEntryToTileCache(**it);
+    }
+
+    return ret;
+} // get
+
+void
+GPUImageCache::insert(U64 key,
+                      const OSGLContextPtr& context,
+                      const ImagePtr& image,
+                      const NodePtr& node,
+                      const GPUImageCacheEntryArgs& args)
+{
+    assert( image && (image->getStorageMode() == eStorageModeGLTex) );
+
+    std::size_t maxSize = appPTR->getCurrentSettings()->getGPUImageCacheSize();
+
+    GPUImageCacheEntryPtr entry(new GPUImageCacheEntry);
+    entry->key = key;
+    entry->contextID = context.get();
+    entry->image = image;
+    entry->node = node;
+    entry->args = args;
+    entry->size = getTextureSize(image);
+
+    OSGLContextSaver contextSaver;
+    OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(context);
+    contextAttacher->attach();
+
+    GPUImageCacheEntryList entriesToRelease;
+    {
+        QMutexLocker k(&_imp->lock);
+
+        GPUImageCacheEntriesMap::iterator found = _imp->entries.find( GPUImageCacheEntryID( key, context.get() ) );
+        if ( found != _imp->entries.end() ) {
+            // The new image is the same as the cached one, but may cover a larger area
+            if ( (*found->second)->image == image ) {
+                return;
+            }
+            entriesToRelease.push_back(*found->second);
+            _imp->removeEntry(found);
+        }
+
+        // An image larger than the whole budget would evict everything else
+        if (entry->size <= maxSize) {
+            _imp->lru.push_front(entry);
+            _imp->entries[GPUImageCacheEntryID( key, context.get() )] = _imp->lru.begin();
+            _imp->size += entry->size;
+        }
+
+        _imp->evictUntilSizeBelow(maxSize);
+        _imp->takeEvictedEntriesToRelease(context, &entriesToRelease);
+    }
+
+    for (GPUImageCacheEntryList::const_iterator it = entriesToRelease.begin(); it != entriesToRelease.end(); ++it) {
+        if ( (*it)->readbackStarted ) {
+            moveEntryToTileCache(**it);
+        }
+    }
+} // insert
+
+bool
+GPUImageCache::isCachedImage(const ImagePtr& image) const
+{
+    if ( !image || (image->getStorageMode() != eStorageModeGLTex) ) {
+        return false;
+    }
+    QMutexLocker k(&_imp->lock);
+    for (GPUImageCacheEntryList::const_iterator it = _imp->lru.begin(); it != _imp->lru.end(); ++it) {
+        if ( (*it)->image == image ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+GPUImageCache::removeContextEntries(const OSGLContextPtr& context)
+{
+    // Release the textures after the lock: this attaches the context
+    GPUImageCacheEntryList entriesToRelease;
+    {
+        QMutexLocker k(&_imp->lock);
+        for (GPUImageCacheEntriesMap::iterator it = _imp->entries.begin(); it != _imp->entries.end();) {
+            if (it->first.second == context.get()) {
+                entriesToRelease.push_back(*it->second);
+                _imp->removeEntry(it++);
+            } else {
+                ++it;
+            }
+        }
+        std::map<const OSGLContext*, GPUImageCacheEntryList>::iterator foundContext = _imp->evictedEntries.find( context.get() );
+        if ( foundContext != _imp->evictedEntries.end() ) {
+            for (GPUImageCacheEntryList::const_iterator it = foundContext->second.begin(); it != foundContext->second.end(); ++it) {
+                _imp->size -= (*it)->size;
+                entriesToRelease.push_back(*it);
+            }
+            _imp->evictedEntries.erase(foundContext);
+        }
+    }
+}
+
+void
+GPUImageCache::freeContextMemory(const OSGLContextPtr& context,
+                                 std::size_t nBytes)
+{
+    OSGLContextSaver contextSaver;
+    OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(context);
+    contextAttacher->attach();
+
+    GPUImageCacheEntryList entriesToRelease;
+    {
+        QMutexLocker k(&_imp->lock);
+
+        // The evicted entries of the context first, whether or not their readback completed
+        std::size_t freedBytes = 0;
+        std::map<const OSGLContext*, GPUImageCacheEntryList>::iterator foundContext = _imp->evictedEntries.find( context.get() );
+        if ( foundContext != _imp->evictedEntries.end() ) {
+            for (GPUImageCacheEntryList::const_iterator it = foundContext->second.begin(); it != foundContext->second.end(); ++it) {
+                assert(_imp->size >= (*it)->size);
+                _imp->size -= (*it)->size;
+                freedBytes += (*it)->size;
+                entriesToRelease.push_back(*it);
+            }
+            _imp->evictedEntries.erase(foundContext);
+        }
+
+        // Then the least recently used entries of the context
+        GPUImageCacheEntryList::iterator it = _imp->lru.end();
+        while ( (freedBytes < nBytes) && ( it != _imp->lru.begin() ) ) {
+            --it;
+            if ( (*it)->contextID != context.get() ) {
+                continue;
+            }
+            GPUImageCacheEntryPtr entry = *it;
+            GPUImageCacheEntriesMap::iterator found = _imp->entries.find( GPUImageCacheEntryID(entry->key, entry->contextID) );
+            assert( found != _imp->entries.end() );
+            if ( found == _imp->entries.end() ) {
+                continue;
+            }
+            // removeEntry erases it from the LRU: move to the next entry first
+            ++it;
+            _imp->removeEntry(found);
+            freedBytes += entry->size;
+            entriesToRelease.push_back(entry);
+        }
+    }
+
+    for (GPUImageCacheEntryList::const_iterator it = entriesToRelease.begin(); it != entriesToRelease.end(); ++it) {
+        // This reads the texture back now if the readback was not started
+        moveEntryToTileCache(**it);
+
+        // Images are otherwise released in a separate thread: give the texture back to the context now
+        // if no render holds the image
+        if ( (*it)->image.use_count() == 1 ) {
+            GLImageStoragePtr storage = (*it)->image->getGLImageStorage();
+            if (storage) {
+                storage->deallocateMemory();
+            }
+        }
+    }
+} // freeContextMemory
+
+std::size_t
+GPUImageCache::getSize() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->size;
+}
+
+NATRON_NAMESPACE_EXIT
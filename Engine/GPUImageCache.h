@@ -0,0 +1,161 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_GPUImageCache_h
+#define Engine_GPUImageCache_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/ImagePlaneDesc.h"
+#include "Engine/RectI.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The arguments describing an image inserted in the GPU image cache.
+ * They are the same as the ones the tile cache uses to identify an image so that an evicted entry
+ * can be moved to the tile cache.
+ **/
+struct GPUImageCacheEntryArgs
+{
+    // The hash of the node at the time/view of the image, @see HashableObject::eComputeHashTypeTimeViewVariant
+    U64 nodeTimeViewVariantHash;
+
+    RenderScale proxyScale;
+    unsigned int mipMapLevel;
+    bool isDraft;
+    ImagePlaneDesc plane;
+
+    // The RoD of the image at each mipmap level, in pixel coordinates
+    std::vector<RectI> perMipMapPixelRoD;
+
+    // The format in which the node renders on the CPU: the tiles are converted to it when the entry is evicted
+    ImageBitDepthEnum bitdepth;
+    ImageBufferLayoutEnum bufferFormat;
+
+    GPUImageCacheEntryArgs()
+    : nodeTimeViewVariantHash(0)
+    , proxyScale(1.)
+    , mipMapLevel(0)
+    , isDraft(false)
+    , plane()
+    , perMipMapPixelRoD()
+    , bitdepth(eImageBitDepthFloat)
+    , bufferFormat(eImageBufferLayoutRGBAPackedFullRect)
+    {
+    }
+};
+
+/**
+ * @brief A cache of the images rendered with OpenGL, kept in the textures they were rendered to.
+ * The tile cache only holds images in RAM: without this cache an image rendered on the GPU is rendered again
+ * each time it is needed, or the node is rendered on the CPU to be cached.
+ *
+ * Entries are identified by the same fields as the tile cache entries. OpenGL contexts do not share their textures
+ * (@see GPUContextPool) hence an entry can only be found by the renders using the context it was rendered with.
+ * The textures have their own budget, set in the GPU page of the settings, and are evicted in least recently used order.
+ * An evicted texture is not thrown away: it starts reading back to RAM without waiting for the GPU and the next time its
+ * context is used by the cache, it is copied to tiles inserted in the tile cache.
+ *
+ * The functions taking a context make it current to the calling thread while they use its textures.
+ **/
+struct GPUImageCachePrivate;
+class GPUImageCache
+{
+public:
+
+    GPUImageCache();
+
+    ~GPUImageCache();
+
+    /**
+     * @brief Returns the key identifying the image with the given arguments in this cache
+     **/
+    static U64 makeKey(const GPUImageCacheEntryArgs& args);
+
+    /**
+     * @brief Returns true if the user gave the GPU image cache a budget
+     **/
+    static bool isGPUImageCacheEnabled();
+
+    /**
+     * @brief Returns the image with the given key rendered with the given context, if it covers at least the given
+     * rectangle. The entry becomes the most recently used.
+     **/
+    ImagePtr get(U64 key, const OSGLContextPtr& context, const RectI& roi);
+
+    /**
+     * @brief Inserts an image rendered with the given context. The image must be entirely rendered and must not be
+     * modified afterwards. This replaces any entry with the same key on this context and evicts the least recently used
+     * entries if the budget is exceeded.
+     **/
+    void insert(U64 key,
+                const OSGLContextPtr& context,
+                const ImagePtr& image,
+                const NodePtr& node,
+                const GPUImageCacheEntryArgs& args);
+
+    /**
+     * @brief Returns true if the given image is held by this cache, in which case it may be read concurrently and
+     * must not be modified.
+     **/
+    bool isCachedImage(const ImagePtr& image) const;
+
+    /**
+     * @brief Releases all the textures of the given context without moving them to the tile cache.
+     * This must be called before the context is destroyed.
+     **/
+    void removeContextEntries(const OSGLContextPtr& context);
+
+    /**
+     * @brief Called when the given context is short of VRAM: the entries of the context are moved to the tile cache
+     * right away, the least recently used first, until at least nBytes of textures were released.
+     * The textures of the images still used by a render are released once the render is done with them.
+     **/
+    void freeContextMemory(const OSGLContextPtr& context, std::size_t nBytes);
+
+    /**
+     * @brief Returns the number of bytes of textures held by this cache
+     **/
+    std::size_t getSize() const;
+
+private:
+
+    boost::scoped_ptr<GPUImageCachePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_GPUImageCache_h
@@ -28,7 +28,13 @@
 #include <cassert>
 #include <stdexcept>
 
+#include <QtCore/QMetaObject>
+
+#include "Engine/Hash64.h"
+#include "Engine/Image.h"
 #include "Engine/InputDescription.h"
+#include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -58,6 +64,127 @@ GroupOutput::createPlugin()
     return ret;
 }
 
+NodeGroupPtr
+GroupOutput::getFrozenGroup() const
+{
+    NodePtr node = getNode();
+    if (!node) {
+        return NodeGroupPtr();
+    }
+    NodeGroupPtr group = toNodeGroup( node->getGroup() );
+    if ( !group || !group->isSubGraphFrozen() ) {
+        return NodeGroupPtr();
+    }
+    return group;
+}
+
+void
+GroupOutput::appendToHash(const ComputeHashArgs& args, Hash64* hash)
+{
+    NodeGroupPtr frozenGroup = getFrozenGroup();
+    if (!frozenGroup) {
+        NoOpBase::appendToHash(args, hash);
+        return;
+    }
+
+    // The images of a frozen group only depend on the state of the sub-graph when it was frozen
+    Hash64::appendQString(QString::fromUtf8( getNode()->getPluginID().c_str() ), hash);
+    hash->append( frozenGroup->getFrozenSubGraphHash() );
+    if (args.hashType == HashableObject::eComputeHashTypeTimeViewVariant) {
+        hash->append( (double)roundImageTimeToEpsilon(args.time) );
+        hash->append( (int)args.view );
+    }
+} // appendToHash
+
+void
+GroupOutput::onHashCacheInvalidated()
+{
+    // The sub-graph changed: check once all hashes are invalidated whether the frozen images are now stale
+    if ( isRenderClone() ) {
+        return;
+    }
+    NodeGroupPtr frozenGroup = getFrozenGroup();
+    if (frozenGroup) {
+        QMetaObject::invokeMethod(frozenGroup.get(), "refreshFrozenSubGraphState", Qt::QueuedConnection);
+    }
+}
+
+bool
+GroupOutput::shouldCacheOutput(bool isFrameVaryingOrAnimated,
+                               int visitsCount) const
+{
+    // The images of a frozen group are always cached
+    if ( getFrozenGroup() ) {
+        return true;
+    }
+    return NoOpBase::shouldCacheOutput(isFrameVaryingOrAnimated, visitsCount);
+}
+
+CompressedTileFilePtr
+GroupOutput::getCompressedTileFile()
+{
+    NodeGroupPtr frozenGroup = getFrozenGroup();
+    if (!frozenGroup) {
+        return CompressedTileFilePtr();
+    }
+    return frozenGroup->getFrozenSubGraphFile();
+}
+
+ActionRetCodeEnum
+GroupOutput::isIdentity(TimeValue time,
+                        const RenderScale & scale,
+                        const RectI & roi,
+                        ViewIdx view,
+                        const ImagePlaneDesc& plane,
+                        TimeValue* inputTime,
+                        ViewIdx* inputView,
+                        int* inputNb,
+                        ImagePlaneDesc* inputPlane)
+{
+    if ( getFrozenGroup() ) {
+        *inputNb = -1;
+        return eActionStatusOK;
+    }
+    return NoOpBase::isIdentity(time, scale, roi, view, plane, inputTime, inputView, inputNb, inputPlane);
+}
+
+ActionRetCodeEnum
+GroupOutput::getFramesNeeded(TimeValue time,
+                             ViewIdx view,
+                             FramesNeededMap* results)
+{
+    // While frozen the sub-graph is not requested: images missing from the cache are rendered in render()
+    if ( getFrozenGroup() ) {
+        return eActionStatusOK;
+    }
+    return NoOpBase::getFramesNeeded(time, view, results);
+}
+
+ActionRetCodeEnum
+GroupOutput::render(const RenderActionArgs& args)
+{
+    // Only called while the group is frozen, when the images are neither in the cache nor in the file of the group
+    // (e.g: while the frozen images are being pre-rendered): render them from the sub-graph.
+    for (std::list<std::pair<ImagePlaneDesc, ImagePtr> >::const_iterator it = args.outputPlanes.begin(); it != args.outputPlanes.end(); ++it) {
+
+        GetImageInArgs inArgs(&args.mipMapLevel, &args.proxyScale, &args.roi, &args.backendType);
+        inArgs.inputNb = 0;
+        inArgs.plane = &it->first;
+        GetImageOutArgs outArgs;
+        if (!getImagePlane(inArgs, &outArgs)) {
+            return eActionStatusInputDisconnected;
+        }
+
+        Image::CopyPixelsArgs cpyArgs;
+        cpyArgs.roi = args.roi;
+        ActionRetCodeEnum stat = it->second->copyPixels(*outArgs.image, cpyArgs);
+        if (isFailureRetCode(stat)) {
+            return stat;
+        }
+    }
+    return eActionStatusOK;
+} // render
+
 
 NATRON_NAMESPACE_EXIT
 
@@ -76,6 +76,37 @@ public:
     {
         return true;
     }
+
+    /**
+     * @brief Returns the group containing this node if its sub-graph is frozen, otherwise NULL.
+     * While frozen, this node is no longer an identity: it renders the images stored when the group
+     * was frozen and does not request its input, see NodeGroup::isSubGraphFrozen()
+     **/
+    NodeGroupPtr getFrozenGroup() const;
+
+    virtual void appendToHash(const ComputeHashArgs& args, Hash64* hash) OVERRIDE FINAL;
+
+    virtual bool shouldCacheOutput(bool isFrameVaryingOrAnimated, int visitsCount) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+
+    virtual CompressedTileFilePtr getCompressedTileFile() OVERRIDE FINAL;
+
+private:
+
+    virtual void onHashCacheInvalidated() OVERRIDE FINAL;
+
+    virtual ActionRetCodeEnum isIdentity(TimeValue time,
+                                         const RenderScale & scale,
+                                         const RectI & roi,
+                                         ViewIdx view,
+                                         const ImagePlaneDesc& plane,
+                                         TimeValue* inputTime,
+                                         ViewIdx* inputView,
+                                         int* inputNb,
+                                         ImagePlaneDesc* inputPlane) OVERRIDE FINAL WARN_UNUSED_RETURN;
+
+    virtual ActionRetCodeEnum getFramesNeeded(TimeValue time, ViewIdx view, FramesNeededMap* results) OVERRIDE FINAL WARN_UNUSED_RETURN;
+
+    virtual ActionRetCodeEnum render(const RenderActionArgs& args) OVERRIDE FINAL WARN_UNUSED_RETURN;
 };
 
 
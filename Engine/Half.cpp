@@ -0,0 +1,175 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Half.h"
+
+#include "Engine/CPUInstructionSet.h"
+
+// The F16C kernels are compiled with a target attribute and selected at runtime
+#if (defined(__x86_64__) || defined(__i386__)) && ( ( defined(__GNUC__) && (__GNUC__ >= 8) ) || defined(__clang__) )
+#define NATRON_HALF_F16C
+#define NATRON_HALF_F16C_TARGET __attribute__( ( target("avx,f16c") ) )
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define NATRON_HALF_NEON
+#include <arm_neon.h>
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+#ifdef NATRON_HALF_F16C
+NATRON_HALF_F16C_TARGET
+static int
+convertRowToFloatF16C(const Half* src,
+                      float* dst,
+                      int n)
+{
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        _mm256_storeu_ps( dst + x, _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)(src + x) ) ) );
+    }
+    return x;
+}
+
+NATRON_HALF_F16C_TARGET
+static int
+convertRowFromFloatF16C(const float* src,
+                        Half* dst,
+                        int n)
+{
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        _mm_storeu_si128( (__m128i*)(dst + x), _mm256_cvtps_ph(_mm256_loadu_ps(src + x), _MM_FROUND_TO_NEAREST_INT) );
+    }
+    return x;
+}
+
+static bool
+detectHardwareConversion()
+{
+    return CPUInstructionSet::isHalfConversionSupported();
+}
+
+#elif defined(NATRON_HALF_NEON)
+
+static int
+convertRowToFloatNEON(const Half* src,
+                      float* dst,
+                      int n)
+{
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        vst1q_f32( dst + x, vcvt_f32_f16( vreinterpret_f16_u16( vld1_u16( (const uint16_t*)(src + x) ) ) ) );
+    }
+    return x;
+}
+
+static int
+convertRowFromFloatNEON(const float* src,
+                        Half* dst,
+                        int n)
+{
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        vst1_u16( (uint16_t*)(dst + x), vreinterpret_u16_f16( vcvt_f16_f32( vld1q_f32(src + x) ) ) );
+    }
+    return x;
+}
+
+static bool
+detectHardwareConversion()
+{
+    // Half precision conversions are part of ARMv8
+    return true;
+}
+
+#else
+
+static bool
+detectHardwareConversion()
+{
+    return false;
+}
+
+#endif
+
+static const bool hardwareConversionSupported = detectHardwareConversion();
+static bool hardwareConversionEnabled = hardwareConversionSupported;
+
+void
+Half::convertRowToFloat(const Half* src,
+                        float* dst,
+                        int n)
+{
+    int x = 0;
+    if (hardwareConversionEnabled) {
+#if defined(NATRON_HALF_F16C)
+        x = convertRowToFloatF16C(src, dst, n);
+#elif defined(NATRON_HALF_NEON)
+        x = convertRowToFloatNEON(src, dst, n);
+#endif
+    }
+    for (; x < n; ++x) {
+        dst[x] = src[x];
+    }
+}
+
+void
+Half::convertRowFromFloat(const float* src,
+                          Half* dst,
+                          int n)
+{
+    int x = 0;
+    if (hardwareConversionEnabled) {
+#if defined(NATRON_HALF_F16C)
+        x = convertRowFromFloatF16C(src, dst, n);
+#elif defined(NATRON_HALF_NEON)
+        x = convertRowFromFloatNEON(src, dst, n);
+#endif
+    }
+    for (; x < n; ++x) {
+        dst[x] = src[x];
+    }
+}
+
+bool
+Half::isHardwareConversionSupported()
+{
+    return hardwareConversionSupported;
+}
+
+bool
+Half::isHardwareConversionEnabled()
+{
+    return hardwareConversionEnabled;
+}
+
+void
+Half::setHardwareConversionEnabled(bool enabled)
+{
+    hardwareConversionEnabled = enabled && hardwareConversionSupported;
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,206 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_Half_h
+#define Engine_Half_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstring>
+#include <limits>
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A 16 bit floating point value (IEEE 754 binary16), used to store the pixels of eImageBitDepthHalf images.
+ * This has the layout of the half type of OpenEXR, which is also the one expected by OpenFX plug-ins for kOfxBitDepthHalf.
+ * There is no half arithmetic: values convert implicitly to and from float, rounding to the nearest even value,
+ * so that the image processing templates written for float work with it.
+ * Scan-lines should be converted with convertRowToFloat() and convertRowFromFloat() which use the F16C instructions on x86
+ * or NEON on ARM64 when available. They give the same results as the scalar conversions.
+ **/
+class Half
+{
+public:
+
+    // Not initialized, as the built-in types. Keep it trivial, so that Half buffers can be memcpy'ed and memset
+#if __cplusplus >= 201103L
+    Half() = default;
+#else
+    Half()
+    {
+    }
+#endif
+
+    Half(float f)
+    : _bits( fromFloat(f) )
+    {
+    }
+
+    operator float() const
+    {
+        return toFloat(_bits);
+    }
+
+    unsigned short bits() const
+    {
+        return _bits;
+    }
+
+    static Half fromBits(unsigned short bits)
+    {
+        Half h;
+        h._bits = bits;
+        return h;
+    }
+
+    static float toFloat(unsigned short bits)
+    {
+        const unsigned int sign = (unsigned int)(bits & 0x8000) << 16;
+        unsigned int exponent = (bits >> 10) & 0x1f;
+        unsigned int mantissa = bits & 0x3ff;
+        unsigned int ret;
+        if (exponent == 0x1f) {
+            // infinity or NaN, NaNs become quiet NaNs
+            ret = sign | 0x7f800000 | ( mantissa ? ( (mantissa | 0x200) << 13 ) : 0 );
+        } else if (exponent != 0) {
+            ret = sign | ( (exponent + 112) << 23 ) | (mantissa << 13);
+        } else if (mantissa == 0) {
+            ret = sign;
+        } else {
+            // denormal half, normal float
+            exponent = 113;
+            while ( !(mantissa & 0x400) ) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            ret = sign | (exponent << 23) | ( (mantissa & 0x3ff) << 13 );
+        }
+        float f;
+        std::memcpy( &f, &ret, sizeof(float) );
+        return f;
+    }
+
+    static unsigned short fromFloat(float f)
+    {
+        unsigned int x;
+        std::memcpy( &x, &f, sizeof(float) );
+        const unsigned int sign = (x >> 16) & 0x8000;
+        const unsigned int absx = x & 0x7fffffff;
+        if (absx >= 0x7f800000) {
+            // infinity or NaN, NaNs stay quiet NaNs
+            return (unsigned short)( sign | 0x7c00 | ( (absx > 0x7f800000) ? ( 0x200 | ( (absx >> 13) & 0x3ff ) ) : 0 ) );
+        }
+        if (absx >= 0x477ff000) {
+            // rounds to more than 65504, the largest half
+            return (unsigned short)(sign | 0x7c00);
+        }
+        if (absx < 0x38800000) {
+            // below 2^-14, the smallest normal half
+            if (absx < 0x33000000) {
+                // 2^-25 and below round to 0
+                return (unsigned short)sign;
+            }
+            const unsigned int mantissa = (absx & 0x7fffff) | 0x800000;
+            const int shift = 126 - (int)(absx >> 23);
+            unsigned int ret = mantissa >> shift;
+            const unsigned int remainder = mantissa & ( (1u << shift) - 1 );
+            const unsigned int halfway = 1u << (shift - 1);
+            if ( (remainder > halfway) || ( (remainder == halfway) && (ret & 1) ) ) {
+                ++ret;
+            }
+            return (unsigned short)(sign | ret);
+        }
+        unsigned int ret = ( ( (absx >> 23) - 112 ) << 10 ) | ( (absx >> 13) & 0x3ff );
+        const unsigned int remainder = absx & 0x1fff;
+        if ( (remainder > 0x1000) || ( (remainder == 0x1000) && (ret & 1) ) ) {
+            // may carry into the exponent, which is correct
+            ++ret;
+        }
+        return (unsigned short)(sign | ret);
+    }
+
+    /**
+     * @brief Convert n contiguous values.
+     **/
+    static void convertRowToFloat(const Half* src, float* dst, int n);
+    static void convertRowFromFloat(const float* src, Half* dst, int n);
+
+    /**
+     * @brief Whether the row conversions use the instructions of the CPU. They can be disabled to compare them
+     * with the scalar conversions in tests and benchmarks. This must not be called while conversions are running.
+     **/
+    static bool isHardwareConversionSupported();
+    static bool isHardwareConversionEnabled();
+    static void setHardwareConversionEnabled(bool enabled);
+
+private:
+
+    unsigned short _bits;
+};
+
+NATRON_NAMESPACE_EXIT
+
+// Same as the numeric_limits of the OpenEXR half, this is also what makes boost::math::isnan() work with Half
+namespace std {
+template <>
+class numeric_limits<NATRON_NAMESPACE::Half>
+{
+public:
+    static const bool is_specialized = true;
+    static NATRON_NAMESPACE::Half min() throw() { return NATRON_NAMESPACE::Half::fromBits(0x0400); }
+    static NATRON_NAMESPACE::Half max() throw() { return NATRON_NAMESPACE::Half::fromBits(0x7bff); }
+    static NATRON_NAMESPACE::Half lowest() throw() { return NATRON_NAMESPACE::Half::fromBits(0xfbff); }
+    static const int digits = 11;
+    static const int digits10 = 3;
+    static const bool is_signed = true;
+    static const bool is_integer = false;
+    static const bool is_exact = false;
+    static const int radix = 2;
+    static NATRON_NAMESPACE::Half epsilon() throw() { return NATRON_NAMESPACE::Half::fromBits(0x1400); }
+    static NATRON_NAMESPACE::Half round_error() throw() { return NATRON_NAMESPACE::Half::fromBits(0x3800); }
+    static const int min_exponent = -13;
+    static const int min_exponent10 = -4;
+    static const int max_exponent = 16;
+    static const int max_exponent10 = 4;
+    static const bool has_infinity = true;
+    static const bool has_quiet_NaN = true;
+    static const bool has_signaling_NaN = true;
+    static const float_denorm_style has_denorm = denorm_present;
+    static const bool has_denorm_loss = false;
+    static NATRON_NAMESPACE::Half infinity() throw() { return NATRON_NAMESPACE::Half::fromBits(0x7c00); }
+    static NATRON_NAMESPACE::Half quiet_NaN() throw() { return NATRON_NAMESPACE::Half::fromBits(0x7fff); }
+    static NATRON_NAMESPACE::Half signaling_NaN() throw() { return NATRON_NAMESPACE::Half::fromBits(0x7dff); }
+    static NATRON_NAMESPACE::Half denorm_min() throw() { return NATRON_NAMESPACE::Half::fromBits(0x0001); }
+    static const bool is_iec559 = false;
+    static const bool is_bounded = false;
+    static const bool is_modulo = false;
+    static const bool traps = true;
+    static const bool tinyness_before = false;
+    static const float_round_style round_style = round_to_nearest;
+};
+} // namespace std
+
+#endif // Engine_Half_h
@@ -25,13 +25,9 @@
 
 #include "Hash64.h"
 
-#include <algorithm>  // for std::for_each
 #include <cassert>
 #include <stdexcept>
 
-#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
-#include <boost/crc.hpp>
-#endif
 #include <QtCore/QString>
 
 #include "Engine/Node.h"
@@ -45,35 +41,54 @@ Hash64::computeHash()
     if (hashValid) {
         return;
     }
-    if ( node_values.empty() ) {
+    if (nValues == 0) {
         return;
     }
 
-    const unsigned char* data = reinterpret_cast<const unsigned char*>( &node_values.front() );
-    boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
-    crc_64.process_bytes(data, node_values.size() * sizeof(node_values[0]));
-    hash = crc_64.checksum();
+    // Finalize a copy of the state so that more values can be appended
+    U64 h = state + nValues * sizeof(U64);
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    hash = h;
     hashValid = true;
 }
 
 void
 Hash64::reset()
 {
-    node_values.clear();
     hash = 0;
+    state = getSeed();
+    nValues = 0;
     hashValid = false;
 }
 
 void
 Hash64::appendQString(const QString & str, Hash64* hash)
 {
-    std::size_t curSize = hash->node_values.size();
-    hash->node_values.resize(curSize + str.size());
-
-    int c = (int)curSize;
-    for (QString::const_iterator it = str.begin(); it != str.end(); ++it, ++c) {
-        hash->node_values[c] = toU64<unsigned short>(it->unicode());
+    // Pack 4 UTF-16 code units per value
+    const int size = str.size();
+    const QChar* data = str.constData();
+    int i = 0;
+    for (; i + 4 <= size; i += 4) {
+        hash->appendRaw( (U64)data[i].unicode() |
+                         ( (U64)data[i + 1].unicode() << 16 ) |
+                         ( (U64)data[i + 2].unicode() << 32 ) |
+                         ( (U64)data[i + 3].unicode() << 48 ) );
+    }
+    if (i < size) {
+        U64 last = 0;
+        for (int shift = 0; i < size; ++i, shift += 16) {
+            last |= (U64)data[i].unicode() << shift;
+        }
+        hash->appendRaw(last);
     }
+
+    // The length disambiguates strings that only differ by trailing null characters
+    // and consecutive strings with the same concatenation
+    hash->append<int>(size);
 }
 
 void
@@ -81,21 +96,16 @@ Hash64::appendCurve(const CurvePtr& curve, Hash64* hash)
 {
     KeyFrameSet keys = curve->getKeyFrames_mt_safe();
 
-    std::size_t curSize = hash->node_values.size();
-    hash->node_values.resize(curSize + 4 * keys.size());
-
-
-    int c = curSize;
-    for (KeyFrameSet::const_iterator it = keys.begin(); it!=keys.end(); ++it, c += 4) {
-        hash->node_values[c] = toU64((double)it->getTime());
+    for (KeyFrameSet::const_iterator it = keys.begin(); it!=keys.end(); ++it) {
+        hash->append((double)it->getTime());
         if (it->hasProperty(kKeyFramePropString)) {
             std::string value;
             it->getPropertySafe(kKeyFramePropString, 0, &value);
             appendQString(QString::fromUtf8(value.c_str()), hash);
         } else {
-            hash->node_values[c + 1] = toU64(it->getValue());
-            hash->node_values[c + 2] = toU64(it->getLeftDerivative());
-            hash->node_values[c + 3] = toU64(it->getRightDerivative());
+            hash->append(it->getValue());
+            hash->append(it->getLeftDerivative());
+            hash->append(it->getRightDerivative());
         }
 
     }
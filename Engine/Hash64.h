@@ -40,17 +40,28 @@
 
 NATRON_NAMESPACE_ENTER
 
-/*The hash of a Node is the checksum of the vector of data containing:
+// The version of the hash function. It seeds every hash so that hashes computed by different versions
+// of the function never match: increment it whenever the function or what is appended in it changes.
+#define NATRON_HASH64_VERSION 2
+
+/*The hash of a Node is the checksum of the data containing:
     - the values of the current knob for this node + the name of the node
     - the hash values for the  tree upstream
  */
 
+/**
+ * @brief A 64-bit non-cryptographic hash computed incrementally: each appended value is mixed
+ * right away into a fixed-size state so that hashing never allocates memory.
+ * The mixing function is the one of xxHash64 for 8-byte words, seeded with NATRON_HASH64_VERSION.
+ * It is sensitive to the order of the appended values.
+ **/
 class Hash64
 {
 public:
     Hash64()
     : hash(0)
-    , node_values()
+    , state(getSeed())
+    , nValues(0)
     , hashValid(false)
     {
     }
@@ -66,9 +77,13 @@ public:
 
     bool isEmpty() const
     {
-        return node_values.empty();
+        return nValues == 0;
     }
 
+    /**
+     * @brief Finalize the hash of all values appended so far. More values may be appended afterwards,
+     * in which case computeHash() must be called again.
+     **/
     void computeHash();
 
     void reset();
@@ -107,24 +122,24 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
     void insert(const std::vector<U64>& elements)
     {
-        std::size_t curSize = node_values.size();
-        node_values.resize(curSize + elements.size());
-
-        int c = curSize;
-        for (std::vector<U64>::const_iterator it = elements.begin(); it != elements.end(); ++it, ++c) {
-            node_values[c] = *it;
+        for (std::vector<U64>::const_iterator it = elements.begin(); it != elements.end(); ++it) {
+            appendRaw(*it);
         }
-        hashValid = false;
-
     }
 
     template<typename T>
     void append(T value)
     {
-        node_values.push_back( toU64(value) );
-        hashValid = false;
+        appendRaw( toU64(value) );
     }
 
+    void appendRaw(U64 value)
+    {
+        state ^= mixWord(value);
+        state = rotl(state, 27) * kPrime1 + kPrime4;
+        ++nValues;
+        hashValid = false;
+    }
 
     static void appendQString(const QString & str, Hash64* hash);
 
@@ -156,8 +171,36 @@ private:
         };
     };
 
+    static const U64 kPrime1 = 0x9E3779B185EBCA87ULL;
+    static const U64 kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    static const U64 kPrime3 = 0x165667B19E3779F9ULL;
+    static const U64 kPrime4 = 0x85EBCA77C2B2AE63ULL;
+    static const U64 kPrime5 = 0x27D4EB2F165667C5ULL;
+
+    static U64 rotl(U64 x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static U64 mixWord(U64 value)
+    {
+        return rotl(value * kPrime2, 31) * kPrime1;
+    }
+
+    static U64 getSeed()
+    {
+        return (U64)NATRON_HASH64_VERSION + kPrime5;
+    }
+
+    // The last value computed by computeHash()
     U64 hash;
-    std::vector<U64> node_values;
+
+    // The values appended so far, mixed
+    U64 state;
+
+    // How many values were appended
+    U64 nValues;
+
     bool hashValid;
 };
 
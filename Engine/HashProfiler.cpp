@@ -0,0 +1,255 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "HashProfiler.h"
+
+#include <algorithm> // max, sort
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+#include "Engine/ThreadStorage.h"
+#include "Engine/Timer.h"
+
+// The number of origins printed in the report
+#define NATRON_HASH_PROFILER_REPORT_ORIGINS 20
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class HashProfilerData
+{
+public:
+
+    QAtomicInt enabled;
+
+    // Gives the time of the computations and invalidations
+    TimeLapse clock;
+
+    // The depth of the hash computations on each thread
+    ThreadStorage<int> computationDepth;
+
+    // Protects stats and origins
+    QMutex lock;
+    HashProfiler::Stats stats;
+    std::map<std::string, HashProfiler::OriginStats> origins;
+
+    HashProfilerData()
+    : enabled()
+    , clock()
+    , computationDepth()
+    , lock()
+    , stats()
+    , origins()
+    {
+    }
+};
+
+HashProfilerData&
+getProfilerData()
+{
+    static HashProfilerData data;
+
+    return data;
+}
+
+bool
+compareTotalFanOut(const HashProfiler::OriginStats& a, const HashProfiler::OriginStats& b)
+{
+    return a.totalFanOut > b.totalFanOut;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+HashProfiler::setEnabled(bool enabled)
+{
+    getProfilerData().enabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+bool
+HashProfiler::isEnabled()
+{
+#if QT_VERSION < 0x050000
+    return (int)getProfilerData().enabled != 0;
+#else
+    return getProfilerData().enabled.loadAcquire() != 0;
+#endif
+}
+
+void
+HashProfiler::reset()
+{
+    HashProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.lock);
+    data.stats = Stats();
+    data.origins.clear();
+}
+
+double
+HashProfiler::getTime()
+{
+    return getProfilerData().clock.getTimeSinceCreation();
+}
+
+void
+HashProfiler::recordComputeCall(bool cacheHit)
+{
+    HashProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.lock);
+    ++data.stats.nComputeCalls;
+    if (cacheHit) {
+        ++data.stats.nComputeCacheHits;
+    }
+}
+
+bool
+HashProfiler::beginComputation()
+{
+    int& depth = getProfilerData().computationDepth.localData();
+    ++depth;
+
+    return depth == 1;
+}
+
+void
+HashProfiler::endComputation(bool topLevel,
+                             double time)
+{
+    HashProfilerData& data = getProfilerData();
+    int& depth = data.computationDepth.localData();
+    if (depth > 0) {
+        --depth;
+    }
+    if (!topLevel) {
+        return;
+    }
+    QMutexLocker k(&data.lock);
+    ++data.stats.nTopLevelComputations;
+    data.stats.totalComputeTime += time;
+    data.stats.maxComputeTime = std::max(data.stats.maxComputeTime, time);
+}
+
+void
+HashProfiler::recordFindCall(bool hit)
+{
+    HashProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.lock);
+    ++data.stats.nFindCalls;
+    if (hit) {
+        ++data.stats.nFindHits;
+    }
+}
+
+void
+HashProfiler::recordInvalidation(const std::string& origin,
+                                 std::size_t fanOut,
+                                 double time)
+{
+    HashProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.lock);
+    Stats& stats = data.stats;
+    ++stats.nInvalidations;
+    stats.totalFanOut += fanOut;
+    stats.maxFanOut = std::max(stats.maxFanOut, (U64)fanOut);
+    stats.totalInvalidationTime += time;
+    stats.maxInvalidationTime = std::max(stats.maxInvalidationTime, time);
+
+    OriginStats& originStats = data.origins[origin];
+    ++originStats.nInvalidations;
+    originStats.totalFanOut += fanOut;
+    originStats.maxFanOut = std::max(originStats.maxFanOut, (U64)fanOut);
+    originStats.totalTime += time;
+}
+
+void
+HashProfiler::getStats(Stats* stats)
+{
+    HashProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.lock);
+    *stats = data.stats;
+}
+
+void
+HashProfiler::getOrigins(std::vector<OriginStats>* origins)
+{
+    HashProfilerData& data = getProfilerData();
+    {
+        QMutexLocker k(&data.lock);
+        origins->clear();
+        for (std::map<std::string, OriginStats>::const_iterator it = data.origins.begin(); it != data.origins.end(); ++it) {
+            origins->push_back(it->second);
+            origins->back().name = it->first.empty() ? std::string("(unnamed)") : it->first;
+        }
+    }
+    std::stable_sort(origins->begin(), origins->end(), compareTotalFanOut);
+}
+
+std::string
+HashProfiler::getReport()
+{
+    Stats stats;
+    getStats(&stats);
+    std::vector<OriginStats> origins;
+    getOrigins(&origins);
+
+    // Times are printed in milliseconds
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    double computeHitPercent = stats.nComputeCalls > 0 ? stats.nComputeCacheHits * 100. / stats.nComputeCalls : 0.;
+    double findHitPercent = stats.nFindCalls > 0 ? stats.nFindHits * 100. / stats.nFindCalls : 0.;
+    double meanFanOut = stats.nInvalidations > 0 ? (double)stats.totalFanOut / stats.nInvalidations : 0.;
+    ss << "computeHash: " << stats.nComputeCalls << " calls, " << computeHitPercent << "% cached, "
+       << stats.nTopLevelComputations << " top-level computations taking " << stats.totalComputeTime * 1000.
+       << " ms (max " << stats.maxComputeTime * 1000. << " ms)\n";
+    ss << "findCachedHash: " << stats.nFindCalls << " calls, " << findHitPercent << "% found\n";
+    ss << "invalidateHashCache: " << stats.nInvalidations << " calls invalidating " << stats.totalFanOut
+       << " objects (mean " << meanFanOut << ", max " << stats.maxFanOut << ") in "
+       << stats.totalInvalidationTime * 1000. << " ms (max " << stats.maxInvalidationTime * 1000. << " ms)\n\n";
+
+    ss << std::left << std::setw(40) << "Invalidated from" << std::right
+       << std::setw(14) << "Invalidations"
+       << std::setw(14) << "Fan-out"
+       << std::setw(14) << "Mean"
+       << std::setw(14) << "Max"
+       << std::setw(14) << "Time (ms)" << '\n';
+    for (std::size_t i = 0; i < origins.size() && i < NATRON_HASH_PROFILER_REPORT_ORIGINS; ++i) {
+        const OriginStats& o = origins[i];
+        ss << std::left << std::setw(40) << o.name << std::right
+           << std::setw(14) << o.nInvalidations
+           << std::setw(14) << o.totalFanOut
+           << std::setw(14) << (o.nInvalidations > 0 ? (double)o.totalFanOut / o.nInvalidations : 0.)
+           << std::setw(14) << o.maxFanOut
+           << std::setw(14) << o.totalTime * 1000. << '\n';
+    }
+
+    return ss.str();
+} // getReport
+
+NATRON_NAMESPACE_EXIT
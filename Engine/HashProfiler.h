@@ -0,0 +1,151 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_HashProfiler_h
+#define Engine_HashProfiler_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Records the hash computations and invalidations of the HashableObjects, to find out whether interactive edits
+ * are slowed down by walking the graph of hashes. Profiling is disabled by default and can be enabled from the RenderStatsDialog.
+ *
+ * An invalidation is a call to HashableObject::invalidateHashCache(): its fan-out is the number of objects
+ * (nodes, knobs) whose hash cache it cleared. Invalidations are attributed to their origin, the object
+ * on which invalidateHashCache() was called, @see HashableObject::getHashProfilerName().
+ **/
+class HashProfiler
+{
+public:
+
+    struct Stats
+    {
+        // Calls of HashableObject::computeHash(), and how many found the hash in the cache
+        U64 nComputeCalls;
+        U64 nComputeCacheHits;
+
+        // Hash computations that are not nested in another computation, and their time in seconds,
+        // which includes the nested computations
+        U64 nTopLevelComputations;
+        double totalComputeTime;
+        double maxComputeTime;
+
+        // Calls of HashableObject::findCachedHash(), and how many found the hash
+        U64 nFindCalls;
+        U64 nFindHits;
+
+        // Calls of HashableObject::invalidateHashCache(), the number of objects they invalidated and their time in seconds
+        U64 nInvalidations;
+        U64 totalFanOut;
+        U64 maxFanOut;
+        double totalInvalidationTime;
+        double maxInvalidationTime;
+
+        Stats()
+        : nComputeCalls(0)
+        , nComputeCacheHits(0)
+        , nTopLevelComputations(0)
+        , totalComputeTime(0)
+        , maxComputeTime(0)
+        , nFindCalls(0)
+        , nFindHits(0)
+        , nInvalidations(0)
+        , totalFanOut(0)
+        , maxFanOut(0)
+        , totalInvalidationTime(0)
+        , maxInvalidationTime(0)
+        {
+        }
+    };
+
+    /**
+     * @brief The invalidations started from one object
+     **/
+    struct OriginStats
+    {
+        std::string name;
+        U64 nInvalidations;
+        U64 totalFanOut;
+        U64 maxFanOut;
+        double totalTime;
+
+        OriginStats()
+        : name()
+        , nInvalidations(0)
+        , totalFanOut(0)
+        , maxFanOut(0)
+        , totalTime(0)
+        {
+        }
+    };
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    static void reset();
+
+    /**
+     * @brief Returns a time in seconds, to time the computations and invalidations
+     **/
+    static double getTime();
+
+    static void recordComputeCall(bool cacheHit);
+
+    /**
+     * @brief Brackets the computation of a hash that was not in the cache. beginComputation() returns true
+     * if the computation is not nested in another one on this thread: only those are timed.
+     **/
+    static bool beginComputation();
+    static void endComputation(bool topLevel, double time);
+
+    static void recordFindCall(bool hit);
+
+    static void recordInvalidation(const std::string& origin, std::size_t fanOut, double time);
+
+    static void getStats(Stats* stats);
+
+    /**
+     * @brief Returns the origins of the invalidations, sorted by decreasing total fan-out
+     **/
+    static void getOrigins(std::vector<OriginStats>* origins);
+
+    /**
+     * @brief Returns the counters and a table of the origins with the largest invalidation cascades
+     **/
+    static std::string getReport();
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_HashProfiler_h
@@ -26,12 +26,56 @@
 #include "HashableObject.h"
 #include <list>
 #include <QMutex>
+#include <QtCore/QAtomicInt>
 
 #include "Engine/Hash64.h"
 #include "Engine/FrameViewRequest.h"
+#include "Engine/HashProfiler.h"
+#include "Engine/ThreadStorage.h"
 
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// Incremented whenever a hash is cached, an object is destroyed or a listener is added or removed:
+// the objects invalidated during an invalidation batch may then no longer be skipped.
+QAtomicInt hashGeneration;
+
+struct InvalidationBatchData
+{
+    // The number of nested batches on this thread
+    int depth;
+
+    // The value of hashGeneration when invalidatedObjects was cleared
+    int generation;
+
+    // The objects invalidated since the beginning of the batch. They all have an empty hash cache as long as the
+    // generation did not change. They are only used as keys and never dereferenced.
+    std::set<HashableObject*> invalidatedObjects;
+
+    InvalidationBatchData()
+    : depth(0)
+    , generation(0)
+    , invalidatedObjects()
+    {
+
+    }
+};
+
+ThreadStorage<InvalidationBatchData> invalidationBatches;
+
+int
+getHashGeneration()
+{
+#if QT_VERSION < 0x050000
+    return (int)hashGeneration;
+#else
+    return hashGeneration.loadAcquire();
+#endif
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 struct HashableObjectPrivate
 {
     // The list of other objects that need this hash as part of their result
@@ -104,7 +148,8 @@ HashableObject::HashableObject()
 
 HashableObject::~HashableObject()
 {
-
+    // This address may be reused by another object that must not be skipped by invalidation batches
+    hashGeneration.ref();
 }
 
 HashableObject::HashableObject(const HashableObject& other)
@@ -117,6 +162,7 @@ void
 HashableObject::addHashListener(const HashableObjectPtr& parent)
 {
     _imp->listeners.insert(parent);
+    hashGeneration.ref();
 }
 
 void
@@ -125,6 +171,7 @@ HashableObject::removeListener(const HashableObjectPtr& parent)
     for (std::set<HashableObjectWPtr>::iterator it = _imp->listeners.begin(); it != _imp->listeners.end(); ++it) {
         if (it->lock() == parent) {
             _imp->listeners.erase(it);
+            hashGeneration.ref();
             return;
         }
     }
@@ -134,6 +181,7 @@ void
 HashableObject::addHashDependency(const HashableObjectPtr& dep)
 {
     _imp->dependencies.insert(dep);
+    hashGeneration.ref();
 }
 
 bool
@@ -167,7 +215,11 @@ bool
 HashableObject::findCachedHash(const FindHashArgs& args, U64 *hash) const
 {
     QMutexLocker k(&_imp->hashCacheMutex);
-    return _imp->findCachedHashInternal(args, hash);
+    bool found = _imp->findCachedHashInternal(args, hash);
+    if ( HashProfiler::isEnabled() ) {
+        HashProfiler::recordFindCall(found);
+    }
+    return found;
 }
 
 
@@ -183,6 +235,7 @@ HashableObject::computeHash_noCache(const ComputeHashArgs& args, Hash64* hash)
 U64
 HashableObject::computeHash(const ComputeHashArgs& args)
 {
+    bool profiling = HashProfiler::isEnabled();
     {
         // Find a hash in the cache.
         QMutexLocker k(&_imp->hashCacheMutex);
@@ -193,10 +246,22 @@ HashableObject::computeHash(const ComputeHashArgs& args)
             findArgs.hashType = args.hashType;
             U64 hashValue;
             if (_imp->findCachedHashInternal(findArgs, &hashValue)) {
+                if (profiling) {
+                    HashProfiler::recordComputeCall(true);
+                }
                 return hashValue;
             }
         }
     }
+    bool topLevelComputation = false;
+    double startTime = 0.;
+    if (profiling) {
+        HashProfiler::recordComputeCall(false);
+        topLevelComputation = HashProfiler::beginComputation();
+        if (topLevelComputation) {
+            startTime = HashProfiler::getTime();
+        }
+    }
     {
         // Compute it
         Hash64 hash;
@@ -226,6 +291,11 @@ HashableObject::computeHash(const ComputeHashArgs& args)
                 _imp->timeViewVariantHashCache[fv] = hashValue;
                 break;
         }
+        hashGeneration.ref();
+
+        if (profiling) {
+            HashProfiler::endComputation(topLevelComputation, topLevelComputation ? HashProfiler::getTime() - startTime : 0.);
+        }
 
         return hashValue;
         
@@ -272,8 +342,68 @@ HashableObject::invalidateHashCacheInternal(std::set<HashableObject*>* invalidat
 void
 HashableObject::invalidateHashCache()
 {
-    std::set<HashableObject*> objs;
-    invalidateHashCacheInternal(&objs);
+    InvalidationBatchData* batch = 0;
+    if ( invalidationBatches.hasLocalData() ) {
+        batch = &invalidationBatches.localData();
+        if (batch->depth == 0) {
+            batch = 0;
+        }
+    }
+    bool profiling = HashProfiler::isEnabled();
+    double startTime = profiling ? HashProfiler::getTime() : 0.;
+    if (!batch) {
+        std::set<HashableObject*> objs;
+        invalidateHashCacheInternal(&objs);
+        if (profiling) {
+            HashProfiler::recordInvalidation(getHashProfilerName(), objs.size(), HashProfiler::getTime() - startTime);
+        }
+        return;
+    }
+
+    int generation = getHashGeneration();
+    if (generation != batch->generation) {
+        // The objects invalidated earlier in the batch may have a valid hash again
+        batch->invalidatedObjects.clear();
+        batch->generation = generation;
+    }
+    // Within a batch, the fan-out only counts the objects that were not already invalidated by the batch
+    std::size_t nInvalidatedBefore = batch->invalidatedObjects.size();
+    invalidateHashCacheInternal(&batch->invalidatedObjects);
+    if (profiling) {
+        HashProfiler::recordInvalidation(getHashProfilerName(), batch->invalidatedObjects.size() - nInvalidatedBefore, HashProfiler::getTime() - startTime);
+    }
+} // invalidateHashCache
+
+std::string
+HashableObject::getHashProfilerName() const
+{
+    return std::string();
+}
+
+void
+HashableObject::beginInvalidationBatch()
+{
+    InvalidationBatchData& batch = invalidationBatches.localData();
+    if (batch.depth == 0) {
+        batch.generation = getHashGeneration();
+    }
+    ++batch.depth;
+}
+
+void
+HashableObject::endInvalidationBatch()
+{
+    if ( !invalidationBatches.hasLocalData() ) {
+        return;
+    }
+    InvalidationBatchData& batch = invalidationBatches.localData();
+    if (batch.depth == 0) {
+        return;
+    }
+    --batch.depth;
+    if (batch.depth == 0) {
+        batch.invalidatedObjects.clear();
+    }
 }
 
 void
@@ -34,6 +34,7 @@
 #endif
 
 #include <set>
+#include <string>
 
 #include "Global/GlobalDefines.h"
 #include "Engine/TimeValue.h"
@@ -162,6 +163,24 @@ public:
      **/
     void invalidateHashCache();
 
+    /**
+     * @brief Starts an invalidation batch on the calling thread. Batches may be nested.
+     * Within a batch, invalidateHashCache() does not visit again the objects already invalidated earlier in the batch,
+     * as long as no hash was computed and no object was destroyed or (un)linked in the meantime.
+     * This avoids walking the same downstream objects again for each change when many values are set at once.
+     **/
+    static void beginInvalidationBatch();
+
+    /**
+     * @brief Ends the batch started by beginInvalidationBatch() on the calling thread.
+     **/
+    static void endInvalidationBatch();
+
+    /**
+     * @brief The name under which the HashProfiler reports the invalidations started from this object.
+     **/
+    virtual std::string getHashProfilerName() const;
+
 
 protected:
 
@@ -184,6 +203,24 @@ private:
 };
 
 
+/**
+ * @brief Brackets a scope in an invalidation batch, see HashableObject::beginInvalidationBatch()
+ **/
+class HashInvalidationBatch_RAII
+{
+public:
+
+    HashInvalidationBatch_RAII()
+    {
+        HashableObject::beginInvalidationBatch();
+    }
+
+    ~HashInvalidationBatch_RAII()
+    {
+        HashableObject::endInvalidationBatch();
+    }
+};
+
 NATRON_NAMESPACE_EXIT
 
 #endif // HASHABLEOBJECT_H
@@ -36,12 +36,27 @@
 #include "Global/FloatingPointExceptions.h"
 #endif
 #include "Engine/Image.h"
+#include "Engine/MultiThread.h"
 #include "Engine/Smooth1D.h"
 #include "Engine/Node.h"
 #include "Engine/TreeRender.h"
 #include "Engine/ViewerNode.h"
 #include "Engine/ViewerInstance.h"
 
+// SSE2 is always available on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_HISTOGRAM_SSE2
+#include <emmintrin.h>
+#endif
+
+// The histogram may be computed from a higher mipmap level than the viewer's one as long as there
+// are at least that many pixels per bin on average
+#define NATRON_HISTOGRAM_MIN_PIXELS_PER_BIN 256
+#define NATRON_HISTOGRAM_MAX_EXTRA_MIPMAP_LEVELS 3
+
+// Number of values binned at once, copied from the scan-line to a contiguous array
+#define NATRON_HISTOGRAM_ROW_CHUNK 256
+
 NATRON_NAMESPACE_ENTER
 
 struct HistogramRequest
@@ -236,52 +251,92 @@ HistogramCPUThread::getMostRecentlyProducedHistogram(std::vector<float>* histogr
 }
 
 
-template <int srcNComps, int mode>
-void
-computeHisto_internal(const HistogramRequest & request,
-                      const Image::CPUData& imageData,
-                      const RectI& roi,
-                      int upscale,
-                      std::vector<float> *histo)
+/**
+ * @brief Increments the bins of the given values. The bin index is computed as (v - vmin) * scale.
+ * Values out of [vmin, vmax[ (and NaNs) are not counted: their index is set to binsCount,
+ * which is an extra bin of the bins array that is never read.
+ **/
+static void
+binValues(const float* values,
+          int n,
+          float vmin,
+          float vmax,
+          float scale,
+          int binsCount,
+          unsigned int* bins)
 {
-    assert(histo);
-    histo->resize(request.binsCount * upscale);
-    std::fill(histo->begin(), histo->end(), 0.f);
-    double binSize = (request.vmax - request.vmin) / histo->size();
-
-    int pixelStride;
-    const float* src_pixels[4] = {NULL, NULL, NULL, NULL};
-    Image::getChannelPointers<float>((const float**)imageData.ptrs, roi.x1, roi.y1, imageData.bounds, imageData.nComps, (float**)src_pixels, &pixelStride);
-
-    // check that all pointers are OK
-    for (int c = 0; c < srcNComps; ++c) {
-        if (!src_pixels[c]) {
-            return;
+    const float maxIndex = (float)(binsCount - 1);
+    int x = 0;
+
+#ifdef NATRON_HISTOGRAM_SSE2
+    const __m128 vmin4 = _mm_set1_ps(vmin);
+    const __m128 vmax4 = _mm_set1_ps(vmax);
+    const __m128 scale4 = _mm_set1_ps(scale);
+    const __m128 maxIndex4 = _mm_set1_ps(maxIndex);
+    const __m128i outside4 = _mm_set1_epi32(binsCount);
+    for (; x + 4 <= n; x += 4) {
+        const __m128 v = _mm_loadu_ps(values + x);
+        const __m128i inside = _mm_castps_si128( _mm_and_ps( _mm_cmpge_ps(v, vmin4), _mm_cmplt_ps(v, vmax4) ) );
+        // clamp before the conversion, which would be undefined for out of range values
+        const __m128 t = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(v, vmin4), scale4), maxIndex4);
+        __m128i index = _mm_cvttps_epi32(t);
+        index = _mm_or_si128( _mm_and_si128(inside, index), _mm_andnot_si128(inside, outside4) );
+
+        int indices[4];
+        _mm_storeu_si128( (__m128i*)indices, index );
+        ++bins[indices[0]];
+        ++bins[indices[1]];
+        ++bins[indices[2]];
+        ++bins[indices[3]];
+    }
+#endif
+
+    for (; x < n; ++x) {
+        const float v = values[x];
+        if ( (vmin <= v) && (v < vmax) ) {
+            const int index = (int)std::min( (v - vmin) * scale, maxIndex );
+            assert(0 <= index && index < binsCount);
+            ++bins[index];
         }
     }
+} // binValues
 
-    for (int y = roi.y1; y < roi.y2; ++y) {
+template <int srcNComps, int mode>
+void
+computeHistoRow_internal(const float* src_pixels[4],
+                         int pixelStride,
+                         int width,
+                         float vmin,
+                         float vmax,
+                         float scale,
+                         int binsCount,
+                         unsigned int* bins)
+{
+    const float* pix[4] = {src_pixels[0], src_pixels[1], src_pixels[2], src_pixels[3]};
+    float values[NATRON_HISTOGRAM_ROW_CHUNK];
 
-        for (int x = roi.x1; x < roi.x2; ++x) {
+    for (int x = 0; x < width; x += NATRON_HISTOGRAM_ROW_CHUNK) {
+        const int n = std::min(NATRON_HISTOGRAM_ROW_CHUNK, width - x);
 
+        for (int i = 0; i < n; ++i) {
             float v;
             switch (mode) {
                 case 1: // A
                     if (srcNComps == 1) {
-                        v = *src_pixels[0];
+                        v = *pix[0];
                     } else if (srcNComps < 4) {
                         v = 1.;
                     } else {
-                        v = *src_pixels[3];
+                        v = *pix[3];
                     }
                     break;
                 case 2: { // Y
                     float tmpPix[3];
-                    for (int i = 0; i < 3; ++i) {
-                        if (src_pixels[i]) {
-                            tmpPix[i] = *src_pixels[i];
+                    for (int c = 0; c < 3; ++c) {
+                        if (pix[c]) {
+                            tmpPix[c] = *pix[c];
                         } else {
-                            tmpPix[i] = 0;
+                            tmpPix[c] = 0;
                         }
                     }
                     v = 0.299 * tmpPix[0] + 0.587 * tmpPix[1] + 0.114 * tmpPix[2];
@@ -290,76 +345,70 @@ computeHisto_internal(const HistogramRequest & request,
                     if (srcNComps == 1) {
                         v = 0;
                     } else {
-                        v = *src_pixels[0];
+                        v = *pix[0];
                     }
                     break;
                 case 4: // G
                     if (srcNComps < 2) {
                         v = 0;
                     } else {
-                        v = *src_pixels[1];
+                        v = *pix[1];
                     }
                     break;
                 case 5: // B
                     if (srcNComps < 3) {
                         v = 0;
                     } else {
-                        v = *src_pixels[3];
+                        v = *pix[2];
                     }
                     break;
                 default:
                     assert(false);
+                    v = 0;
                     break;
             } // switch (mode)
-
-            if ( (request.vmin <= v) && (v < request.vmax) ) {
-                int index = (int)( (v - request.vmin) / binSize );
-                assert( 0 <= index && index < (int)histo->size() );
-                (*histo)[index] += 1.f;
-            }
+            values[i] = v;
 
             for (int c = 0; c < srcNComps; ++c) {
-                if (src_pixels[c]) {
-                    src_pixels[c] += pixelStride;
+                if (pix[c]) {
+                    pix[c] += pixelStride;
                 }
             }
-        } // for each pixel along the lin
+        } // for each pixel of the chunk
 
-        // Remove what was done on the previous line and go to the next
-        for (int c = 0; c < srcNComps; ++c) {
-            if (src_pixels[c]) {
-                src_pixels[c] += ((imageData.bounds .width()- roi.width()) * pixelStride);
-            }
-        }
-    } // for each scan-line
-}
+        binValues(values, n, vmin, vmax, scale, binsCount, bins);
+    } // for each chunk of the scan-line
+} // computeHistoRow_internal
 
 template <int srcNComps>
 void
-computeHistoForNComps(const HistogramRequest & request,
-                      int mode,
-                      const Image::CPUData& imageData,
-                      const RectI& roi,
-                      int upscale,
-                      std::vector<float> *histo)
+computeHistoRowForNComps(int mode,
+                         const float* src_pixels[4],
+                         int pixelStride,
+                         int width,
+                         float vmin,
+                         float vmax,
+                         float scale,
+                         int binsCount,
+                         unsigned int* bins)
 {
 
     /// keep the mode parameter in sync with Histogram::DisplayModeEnum
     switch (mode) {
         case 1:     //< A
-            computeHisto_internal<srcNComps, 1>(request, imageData, roi, upscale, histo);
+            computeHistoRow_internal<srcNComps, 1>(src_pixels, pixelStride, width, vmin, vmax, scale, binsCount, bins);
             break;
         case 2:     //<Y
-            computeHisto_internal<srcNComps, 2>(request, imageData, roi, upscale, histo);
+            computeHistoRow_internal<srcNComps, 2>(src_pixels, pixelStride, width, vmin, vmax, scale, binsCount, bins);
             break;
         case 3:     //< R
-            computeHisto_internal<srcNComps, 3>(request, imageData, roi, upscale, histo);
+            computeHistoRow_internal<srcNComps, 3>(src_pixels, pixelStride, width, vmin, vmax, scale, binsCount, bins);
             break;
         case 4:     //< G
-            computeHisto_internal<srcNComps, 4>(request, imageData, roi, upscale, histo);
+            computeHistoRow_internal<srcNComps, 4>(src_pixels, pixelStride, width, vmin, vmax, scale, binsCount, bins);
             break;
         case 5:     //< B
-            computeHisto_internal<srcNComps, 5>(request, imageData, roi, upscale, histo);
+            computeHistoRow_internal<srcNComps, 5>(src_pixels, pixelStride, width, vmin, vmax, scale, binsCount, bins);
             break;
             
         default:
@@ -368,69 +417,140 @@ computeHistoForNComps(const HistogramRequest & request,
     }
 }
 
-
-static void
-computeHistogramStatic(const HistogramRequest & request,
-                       int mode,
-                       const Image::CPUData& imageData,
-                       const RectI& roi,
-                       FinishedHistogramPtr ret,
-                       int histogramIndex)
+/**
+ * @brief Computes up to 3 histograms of a float image in a single pass over the pixels.
+ * Each thread accumulates the scan-lines of its render window in its own bins, which are
+ * added to the result once the thread is done, so that threads do not contend on the bins.
+ **/
+class HistogramProcessor : public ImageMultiThreadProcessorBase
 {
-    const int upscale = 5;
-    std::vector<float> *histo = 0;
-
-    switch (histogramIndex) {
-    case 1:
-        histo = &ret->histogram1;
-        break;
-    case 2:
-        histo = &ret->histogram2;
-        break;
-    case 3:
-        histo = &ret->histogram3;
-        break;
-    default:
-        break;
+    Image::CPUData _imageData;
+    int _binsCount;
+    float _vmin, _vmax, _scale;
+    int _nHistograms;
+    int _modes[3];
+
+    QMutex _resultMutex;
+    std::vector<unsigned int> _result[3];
+
+public:
+
+    HistogramProcessor()
+    : ImageMultiThreadProcessorBase( EffectInstancePtr() )
+    , _imageData()
+    , _binsCount(0)
+    , _vmin(0)
+    , _vmax(0)
+    , _scale(0)
+    , _nHistograms(0)
+    , _resultMutex()
+    {
     }
-    assert(histo);
-    if (!histo) {
-        return;
+
+    virtual ~HistogramProcessor()
+    {
     }
 
-    // a histogram with upscale more bins
-    std::vector<float> histo_upscaled;
+    void setValues(const Image::CPUData& imageData,
+                   int binsCount,
+                   double vmin,
+                   double vmax,
+                   int nHistograms,
+                   const int modes[3])
+    {
+        assert(binsCount > 0 && vmax > vmin && nHistograms >= 1 && nHistograms <= 3);
+        _imageData = imageData;
+        _binsCount = binsCount;
+        _vmin = (float)vmin;
+        _vmax = (float)vmax;
+        _scale = (float)(binsCount / (vmax - vmin));
+        _nHistograms = nHistograms;
+        for (int i = 0; i < nHistograms; ++i) {
+            _modes[i] = modes[i];
+            _result[i].assign(binsCount, 0);
+        }
+    }
 
-    switch (imageData.nComps) {
-        case 1:
-            computeHistoForNComps<1>(request, mode, imageData, roi, upscale, &histo_upscaled);
-            break;
-        case 2:
-            computeHistoForNComps<2>(request, mode, imageData, roi, upscale, &histo_upscaled);
-            break;
-        case 3:
-            computeHistoForNComps<3>(request, mode, imageData, roi, upscale, &histo_upscaled);
-            break;
-        case 4:
-            computeHistoForNComps<4>(request, mode, imageData, roi, upscale, &histo_upscaled);
-            break;
+    const std::vector<unsigned int>& getResult(int histogramIndex) const
+    {
+        assert(histogramIndex >= 0 && histogramIndex < _nHistograms);
+        return _result[histogramIndex];
     }
 
+private:
 
-    ret->pixelsCount = roi.area();
+    virtual ActionRetCodeEnum multiThreadProcessImages(const RectI& renderWindow) OVERRIDE FINAL
+    {
+        // one extra bin that receives the values out of range
+        std::vector<unsigned int> localBins[3];
+        for (int i = 0; i < _nHistograms; ++i) {
+            localBins[i].assign(_binsCount + 1, 0);
+        }
+
+        for (int y = renderWindow.y1; y < renderWindow.y2; ++y) {
+            int pixelStride;
+            const float* src_pixels[4] = {NULL, NULL, NULL, NULL};
+            Image::getChannelPointers<float>((const float**)_imageData.ptrs, renderWindow.x1, y, _imageData.bounds, _imageData.nComps, (float**)src_pixels, &pixelStride);
+
+            // check that all pointers are OK
+            for (int c = 0; c < _imageData.nComps; ++c) {
+                if (!src_pixels[c]) {
+                    return eActionStatusFailed;
+                }
+            }
 
+            // all the histograms are computed from the same scan-line while it is in the cache
+            for (int i = 0; i < _nHistograms; ++i) {
+                unsigned int* bins = &localBins[i][0];
+                switch (_imageData.nComps) {
+                    case 1:
+                        computeHistoRowForNComps<1>(_modes[i], src_pixels, pixelStride, renderWindow.width(), _vmin, _vmax, _scale, _binsCount, bins);
+                        break;
+                    case 2:
+                        computeHistoRowForNComps<2>(_modes[i], src_pixels, pixelStride, renderWindow.width(), _vmin, _vmax, _scale, _binsCount, bins);
+                        break;
+                    case 3:
+                        computeHistoRowForNComps<3>(_modes[i], src_pixels, pixelStride, renderWindow.width(), _vmin, _vmax, _scale, _binsCount, bins);
+                        break;
+                    case 4:
+                        computeHistoRowForNComps<4>(_modes[i], src_pixels, pixelStride, renderWindow.width(), _vmin, _vmax, _scale, _binsCount, bins);
+                        break;
+                    default:
+                        return eActionStatusFailed;
+                }
+            }
+        } // for each scan-line
+
+        QMutexLocker k(&_resultMutex);
+        for (int i = 0; i < _nHistograms; ++i) {
+            for (int b = 0; b < _binsCount; ++b) {
+                _result[i][b] += localBins[i][b];
+            }
+        }
+        return eActionStatusOK;
+    } // multiThreadProcessImages
+};
+
+
+void
+HistogramCPUThread::smoothAndDownsampleHistogram(std::vector<float>* histo_upscaled,
+                                                 int upscale,
+                                                 int smoothingKernelSize,
+                                                 std::vector<float>* histo)
+{
+    assert(histo_upscaled && histo);
+    assert(upscale > 0 && histo_upscaled->size() % upscale == 0);
 
     double sigma = upscale;
-    if (request.smoothingKernelSize > 1) {
-        sigma *= request.smoothingKernelSize;
+    if (smoothingKernelSize > 1) {
+        sigma *= smoothingKernelSize;
     }
     // smooth the upscaled histogram
-    Smooth1D::iir_gaussianFilter1D(histo_upscaled, sigma);
+    Smooth1D::iir_gaussianFilter1D(*histo_upscaled, sigma);
 
     // downsample to obtain the final histogram
-    histo->resize(request.binsCount);
-    assert(histo_upscaled.size() == histo->size() * upscale);
-    std::vector<float>::const_iterator it_in = histo_upscaled.begin();
+    histo->resize(histo_upscaled->size() / upscale);
+    std::vector<float>::const_iterator it_in = histo_upscaled->begin();
     std::advance(it_in, (upscale - 1) / 2);
     std::vector<float>::iterator it_out = histo->begin();
     while ( it_out != histo->end() ) {
@@ -440,7 +560,94 @@ computeHistogramStatic(const HistogramRequest & request,
             std::advance (it_in, upscale);
         }
     }
-} // computeHistogramStatic
+} // smoothAndDownsampleHistogram
+
+int
+HistogramCPUThread::computeBins(const ImagePtr& image,
+                                const RectI& roi,
+                                int mode,
+                                int binsCount,
+                                double vmin,
+                                double vmax,
+                                std::vector<unsigned int> bins[3])
+{
+    Image::CPUData imageData;
+    image->getCPUData(&imageData);
+    if (imageData.bitDepth != eImageBitDepthFloat) {
+        return 0;
+    }
+
+    int nHistograms;
+    int modes[3] = {0, 0, 0};
+    if (mode == 0) { //< RGB
+        nHistograms = 3;
+        modes[0] = 3;
+        modes[1] = 4;
+        modes[2] = 5;
+    } else if (mode >= 1 && mode <= 5) {
+        nHistograms = 1;
+        modes[0] = mode;
+    } else {
+        assert(false); //< unknown case.
+        return 0;
+    }
+
+    HistogramProcessor processor;
+    processor.setValues(imageData, binsCount, vmin, vmax, nHistograms, modes);
+    processor.setRenderWindow(roi);
+    ActionRetCodeEnum stat = processor.process();
+    if (isFailureRetCode(stat)) {
+        return 0;
+    }
+    for (int i = 0; i < nHistograms; ++i) {
+        bins[i] = processor.getResult(i);
+    }
+    return nHistograms;
+} // computeBins
+
+static void
+computeHistogramsStatic(const HistogramRequest & request,
+                        const ImagePtr& image,
+                        const RectI& roi,
+                        FinishedHistogramPtr ret)
+{
+    const int upscale = 5;
+
+    ret->pixelsCount = roi.area();
+
+    std::vector<unsigned int> bins[3];
+    const int nHistograms = HistogramCPUThread::computeBins(image, roi, request.mode, request.binsCount * upscale, request.vmin, request.vmax, bins);
+
+    std::vector<float>* histos[3] = {&ret->histogram1, &ret->histogram2, &ret->histogram3};
+    for (int i = 0; i < nHistograms; ++i) {
+        // a histogram with upscale more bins
+        std::vector<float> histo_upscaled( bins[i].begin(), bins[i].end() );
+        HistogramCPUThread::smoothAndDownsampleHistogram(&histo_upscaled, upscale, request.smoothingKernelSize, histos[i]);
+    }
+} // computeHistogramsStatic
+
+/**
+ * @brief Returns the number of mipmap levels that can be added to the viewer's one to compute the
+ * histogram of the given canonical region: a histogram with few bins does not need the pixels of a large image.
+ * The higher levels are either already in the image cache or downscaled from the cached one.
+ **/
+static unsigned int
+getHistogramExtraMipMapLevels(const RectD& canonicalRoI,
+                              unsigned int mipMapLevel,
+                              int binsCount)
+{
+    if ( canonicalRoI.isNull() || canonicalRoI.isInfinite() ) {
+        return 0;
+    }
+    const double minPixelsCount = (double)binsCount * NATRON_HISTOGRAM_MIN_PIXELS_PER_BIN;
+    double pixelsCount = canonicalRoI.area() / (double)( 1 << (2 * mipMapLevel) );
+    unsigned int extraLevels = 0;
+    while (extraLevels < NATRON_HISTOGRAM_MAX_EXTRA_MIPMAP_LEVELS && pixelsCount / 4. >= minPixelsCount) {
+        pixelsCount /= 4.;
+        ++extraLevels;
+    }
+    return extraLevels;
+}
 
 void
 HistogramCPUThread::run()
@@ -486,6 +693,8 @@ HistogramCPUThread::run()
             args->treeRootEffect = treeRoot->getEffectInstance();
             args->provider = args->treeRootEffect;
             assert(args->treeRootEffect);
+            // The histogram must not take threads from the viewer renders
+            args->priority = eTreeRenderPriorityPreview;
             args->time = request.viewer->getTimelineCurrentTime();
             args->view = request.viewer->getCurrentRenderView();
             
@@ -497,6 +706,17 @@ HistogramCPUThread::run()
             } else {
                 args->mipMapLevel = request.viewer->getMipMapLevelFromZoomFactor();
             }
+
+            // When the panel is small, there is no need to bin every pixel of a large image
+            RectD canonicalRoI = request.roiParam;
+            if ( canonicalRoI.isNull() ) {
+                GetRegionOfDefinitionResultsPtr rodResults;
+                ActionRetCodeEnum stat = args->treeRootEffect->getRegionOfDefinition_public(args->time, RenderScale(1.), args->view, &rodResults);
+                if ( !isFailureRetCode(stat) ) {
+                    canonicalRoI = rodResults->getRoD();
+                }
+            }
+            args->mipMapLevel += getHistogramExtraMipMapLevels(canonicalRoI, args->mipMapLevel, request.binsCount);
             
             args->proxyScale = RenderScale(1.);
             args->canonicalRoI = request.roiParam;
@@ -557,23 +777,7 @@ HistogramCPUThread::run()
             roiPixels.intersect(imageData.bounds, &roiPixels);
         }
 
-        switch (request.mode) {
-        case 0:     //< RGB
-            computeHistogramStatic(request, 3, imageData, roiPixels, ret, 1);
-            computeHistogramStatic(request, 4, imageData, roiPixels, ret, 2);
-            computeHistogramStatic(request, 5, imageData, roiPixels, ret, 3);
-            break;
-        case 1:
-        case 2:
-        case 3:
-        case 4:
-        case 5:
-            computeHistogramStatic(request, request.mode, imageData, roiPixels, ret, 1);
-            break;
-        default:
-            assert(false);     //< unknown case.
-            break;
-        }
+        computeHistogramsStatic(request, image, roiPixels, ret);
 
 
         {
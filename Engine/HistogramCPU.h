@@ -94,6 +94,30 @@ public:
 
     void quitAnyComputation();
 
+    /**
+     * @brief Smooths a histogram computed with upscale bins for each final bin and downsamples it to the final bins.
+     * This is shared with the histograms computed on the GPU so that they look the same.
+     * @param histo_upscaled The upscaled histogram, it is smoothed in place
+     **/
+    static void smoothAndDownsampleHistogram(std::vector<float>* histo_upscaled,
+                                             int upscale,
+                                             int smoothingKernelSize,
+                                             std::vector<float>* histo);
+
+    /**
+     * @brief Computes the bins of the histograms of the given mode over the roi of a float RAM image,
+     * without smoothing them. The mode corresponds to the enum Histogram::DisplayModeEnum: the RGB mode
+     * computes 3 histograms in a single pass, the other modes a single one.
+     * @returns The number of histograms computed in bins, 0 on failure
+     **/
+    static int computeBins(const ImagePtr& image,
+                           const RectI& roi,
+                           int mode,
+                           int binsCount,
+                           double vmin,
+                           double vmax,
+                           std::vector<unsigned int> bins[3]);
+
 Q_SIGNALS:
 
     void histogramProduced();
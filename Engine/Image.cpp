@@ -113,6 +113,7 @@ Image::InitStorageArgs::InitStorageArgs()
 , textureTarget(GL_TEXTURE_2D)
 , externalBuffer()
 , delayAllocation(false)
+, zeroInitialized(false)
 {
 
 }
@@ -360,6 +361,30 @@ Image::getStorageMode() const
     return _imp->channels[0]->getStorageMode();
 }
 
+void
+Image::startGPUReadback()
+{
+    if (getStorageMode() != eStorageModeGLTex) {
+        return;
+    }
+    GLImageStoragePtr storage = toGLImageStorage(_imp->channels[0]);
+    if (storage) {
+        ImagePrivate::startGLTextureReadback(storage);
+    }
+}
+
+void
+Image::discardGPUReadback()
+{
+    if (getStorageMode() != eStorageModeGLTex) {
+        return;
+    }
+    GLImageStoragePtr storage = toGLImageStorage(_imp->channels[0]);
+    if (storage) {
+        ImagePrivate::discardGLTextureReadback(storage);
+    }
+}
+
 const RectI&
 Image::getBounds() const
 {
@@ -560,6 +585,7 @@ Image::ensureBounds(const RectI& roi,
         assert(mipmapLevel == initArgs.mipMapLevel);
         initArgs.proxyScale = getProxyScale();
         initArgs.renderClone = _imp->renderClone.lock();
+        initArgs.zeroInitialized = true;
         GLImageStoragePtr isGlEntry = getGLImageStorage();
         if (isGlEntry) {
             initArgs.textureTarget = isGlEntry->getGLTextureTarget();
@@ -573,9 +599,12 @@ Image::ensureBounds(const RectI& roi,
         float fillValue = isGlEntry ? 0 : std::numeric_limits<float>::quiet_NaN();
         ActionRetCodeEnum stat = tmpImage->fill(initArgs.bounds, fillValue, fillValue, fillValue, fillValue);
 */
-        ActionRetCodeEnum stat = tmpImage->fillBoundsZero();
-        if (isFailureRetCode(stat)) {
-            return stat;
+        // RAM buffers are already cleared to 0
+        if (isGlEntry) {
+            ActionRetCodeEnum stat = tmpImage->fillBoundsZero();
+            if (isFailureRetCode(stat)) {
+                return stat;
+            }
         }
 
     }
@@ -638,6 +667,9 @@ Image::getChannelPointers(const void* ptrs[4],
         case eImageBitDepthShort:
             getChannelPointers<unsigned short>((const unsigned short**)ptrs, x, y, bounds, nComps, (unsigned short**)outPtrs, pixelStride);
             break;
+        case eImageBitDepthHalf:
+            getChannelPointers<Half>((const Half**)ptrs, x, y, bounds, nComps, (Half**)outPtrs, pixelStride);
+            break;
         case eImageBitDepthFloat:
             getChannelPointers<float>((const float**)ptrs, x, y, bounds, nComps, (float**)outPtrs, pixelStride);
             break;
@@ -742,11 +774,46 @@ Image::isBitDepthConversionLossy(ImageBitDepthEnum from,
 }
 
 
+class DownscaleImageProcessor : public ImageMultiThreadProcessorBase
+{
+    Image::CPUData _srcTileData, _dstTileData;
+    unsigned int _downscaleLevels;
+
+public:
+
+    DownscaleImageProcessor(const EffectInstancePtr& renderClone)
+    : ImageMultiThreadProcessorBase(renderClone)
+    , _srcTileData()
+    , _dstTileData()
+    , _downscaleLevels(0)
+    {
+
+    }
+
+    virtual ~DownscaleImageProcessor()
+    {
+    }
+
+    void setValues(const Image::CPUData& srcTileData, const Image::CPUData& dstTileData, unsigned int downscaleLevels)
+    {
+        _srcTileData = srcTileData;
+        _dstTileData = dstTileData;
+        _downscaleLevels = downscaleLevels;
+    }
+
+private:
+
+    virtual ActionRetCodeEnum multiThreadProcessImages(const RectI& renderWindow) OVERRIDE FINAL
+    {
+        return ImagePrivate::downscaleImage((const void**)_srcTileData.ptrs, _srcTileData.nComps, _srcTileData.bitDepth, _srcTileData.bounds, _dstTileData.ptrs, _dstTileData.bounds, renderWindow, _downscaleLevels, _effect);
+    }
+};
+
 ImagePtr
 Image::downscaleMipMap(const RectI & roi, unsigned int downscaleLevels) const
 {
-    // If we don't have to downscale or this is an OpenGL texture there's nothing to do
-    if (downscaleLevels == 0 || getStorageMode() == eStorageModeGLTex) {
+    // If we don't have to downscale there's nothing to do
+    if (downscaleLevels == 0) {
         return boost::const_pointer_cast<Image>(shared_from_this());
     }
 
@@ -756,51 +823,88 @@ Image::downscaleMipMap(const RectI & roi, unsigned int downscaleLevels) const
         return ImagePtr();
     }
 
+    if (getStorageMode() == eStorageModeGLTex) {
+        return downscaleMipMapGL(roi, downscaleLevels);
+    }
+
+    // Downscale the smallest enclosing po2 rect as we need to render a minimum of the renderWindow.
+    // All levels are averaged in a single pass: the intermediate levels are not allocated.
     RectI dstRoI  = roi.downscalePowerOfTwoSmallestEnclosing(downscaleLevels);
     ImagePtr mipmapImage;
+    {
+        InitStorageArgs args;
+        args.bounds = dstRoI;
+        args.renderClone = _imp->renderClone.lock();
+        args.plane = _imp->plane;
+        args.bitdepth = getBitDepth();
+        args.proxyScale = getProxyScale();
+        args.mipMapLevel = getMipMapLevel() + downscaleLevels;
+        mipmapImage = Image::create(args);
+        if (!mipmapImage) {
+            return mipmapImage;
+        }
+    }
 
-    RectI previousLevelRoI = roi;
-    ImageConstPtr previousLevelImage = shared_from_this();
+    Image::CPUData srcTileData;
+    getCPUData(&srcTileData);
 
-    // Build all the mipmap levels until we reach the one we are interested in
-    for (unsigned int i = 0; i < downscaleLevels; ++i) {
+    Image::CPUData dstTileData;
+    mipmapImage->getCPUData(&dstTileData);
+
+    DownscaleImageProcessor processor(_imp->renderClone.lock());
+    processor.setValues(srcTileData, dstTileData, downscaleLevels);
+    processor.setRenderWindow(dstTileData.bounds);
+    ActionRetCodeEnum stat = processor.process();
+    if (isFailureRetCode(stat)) {
+        return ImagePtr();
+    }
+    return mipmapImage;
+
+} // downscaleMipMap
 
-        // Halve the smallest enclosing po2 rect as we need to render a minimum of the renderWindow
-        RectI halvedRoI = previousLevelRoI.downscalePowerOfTwoSmallestEnclosing(1);
+ImagePtr
+Image::downscaleMipMapGL(const RectI & roi, unsigned int downscaleLevels) const
+{
+    GLImageStoragePtr srcTexture = getGLImageStorage();
+    assert(srcTexture);
+    if (!srcTexture) {
+        return ImagePtr();
+    }
+
+    // Unlike on the CPU, each level is half the previous one: a shader sampling the block of 2^downscaleLevels pixels
+    // of each dst pixel would be limited by the texture cache. The intermediate levels are temporary textures.
+    RectI levelRoI = roi;
+    ImagePtr levelImage = boost::const_pointer_cast<Image>(shared_from_this());
+    for (unsigned int i = 0; i < downscaleLevels; ++i) {
 
-        // Allocate an image with half the size of the source image
+        RectI dstRoI = levelRoI.downscalePowerOfTwoSmallestEnclosing(1);
+        ImagePtr mipmapImage;
         {
             InitStorageArgs args;
-            args.bounds = halvedRoI;
+            args.bounds = dstRoI;
             args.renderClone = _imp->renderClone.lock();
-            args.plane = previousLevelImage->_imp->plane;
-            args.bitdepth = previousLevelImage->getBitDepth();
-            args.proxyScale = previousLevelImage->getProxyScale();
-            args.mipMapLevel = previousLevelImage->getMipMapLevel() + 1;
+            args.plane = _imp->plane;
+            args.bitdepth = getBitDepth();
+            args.bufferFormat = getBufferFormat();
+            args.storage = eStorageModeGLTex;
+            args.glContext = srcTexture->getOpenGLContext();
+            args.textureTarget = srcTexture->getGLTextureTarget();
+            args.proxyScale = getProxyScale();
+            args.mipMapLevel = getMipMapLevel() + i + 1;
             mipmapImage = Image::create(args);
             if (!mipmapImage) {
                 return mipmapImage;
             }
         }
 
-        Image::CPUData srcTileData;
-        previousLevelImage->getCPUData(&srcTileData);
-
-        Image::CPUData dstTileData;
-        mipmapImage->getCPUData(&dstTileData);
-
-        ActionRetCodeEnum stat = ImagePrivate::halveImage((const void**)srcTileData.ptrs, srcTileData.nComps, srcTileData.bitDepth, srcTileData.bounds, dstTileData.ptrs, dstTileData.bounds, _imp->renderClone.lock());
-        if (isFailureRetCode(stat)) {
-            return ImagePtr();
-        }
+        ImagePrivate::halveGLTexture(levelImage->getGLImageStorage(), mipmapImage->getGLImageStorage(), dstRoI);
 
-        // Switch for next pass
-        previousLevelRoI = halvedRoI;
-        previousLevelImage = mipmapImage;
-    } // for all downscale levels
-    return mipmapImage;
+        levelRoI = dstRoI;
+        levelImage = mipmapImage;
+    }
+    return levelImage;
 
-} // downscaleMipMap
+} // downscaleMipMapGL
 
 
 class CheckNaNsProcessor : public ImageMultiThreadProcessorBase
@@ -852,8 +956,10 @@ private:
 ActionRetCodeEnum
 Image::checkForNaNs(const RectI& roi, bool* foundNan)
 {
-    if (getBitDepth() != eImageBitDepthFloat) {
-        return eActionStatusFailed;
+    *foundNan = false;
+    if (getBitDepth() == eImageBitDepthByte || getBitDepth() == eImageBitDepthShort) {
+        // integer images cannot hold NaNs
+        return eActionStatusOK;
     }
     if (getStorageMode() == eStorageModeGLTex) {
         return eActionStatusFailed;
@@ -1092,6 +1198,144 @@ Image::copyUnProcessedChannels(const RectI& roi,
 
 } // copyUnProcessedChannels
 
+class CopyUnProcessedAndMaskMixProcessor : public ImageMultiThreadProcessorBase
+{
+    Image::CPUData _srcImgData, _maskImgData, _dstImgData;
+    std::bitset<4> _processChannels;
+    bool _copyUnProcessed;
+    bool _doMix;
+    double _mix;
+    bool _maskInvert;
+public:
+
+    CopyUnProcessedAndMaskMixProcessor(const EffectInstancePtr& renderClone)
+    : ImageMultiThreadProcessorBase(renderClone)
+    , _srcImgData()
+    , _maskImgData()
+    , _dstImgData()
+    , _processChannels()
+    , _copyUnProcessed(false)
+    , _doMix(false)
+    , _mix(0)
+    , _maskInvert(false)
+    {
+
+    }
+
+    virtual ~CopyUnProcessedAndMaskMixProcessor()
+    {
+    }
+
+    void setValues(const Image::CPUData& srcImgData,
+                   const Image::CPUData& maskImgData,
+                   const Image::CPUData& dstImgData,
+                   std::bitset<4> processChannels,
+                   bool copyUnProcessed,
+                   bool doMix,
+                   double mix,
+                   bool maskInvert)
+    {
+        _srcImgData = srcImgData;
+        _maskImgData = maskImgData;
+        _dstImgData = dstImgData;
+        _processChannels = processChannels;
+        _copyUnProcessed = copyUnProcessed;
+        _doMix = doMix;
+        _mix = mix;
+        _maskInvert = maskInvert;
+    }
+
+private:
+
+    virtual ActionRetCodeEnum multiThreadProcessImages(const RectI& renderWindow) OVERRIDE FINAL
+    {
+        return ImagePrivate::copyUnProcessedChannelsAndMaskMixCPU((const void**)_srcImgData.ptrs,
+                                                                  _srcImgData.bounds,
+                                                                  _srcImgData.nComps,
+                                                                  (const void**)_maskImgData.ptrs,
+                                                                  _maskImgData.bounds,
+                                                                  _dstImgData.ptrs,
+                                                                  _dstImgData.bitDepth,
+                                                                  _dstImgData.nComps,
+                                                                  _dstImgData.bounds,
+                                                                  _processChannels,
+                                                                  _copyUnProcessed,
+                                                                  _doMix,
+                                                                  _mix,
+                                                                  _maskInvert,
+                                                                  renderWindow,
+                                                                  _effect);
+    }
+};
+
+ActionRetCodeEnum
+Image::copyUnProcessedChannelsAndApplyMaskMix(const RectI& roi,
+                                              const std::bitset<4> processChannels,
+                                              const ImagePtr& originalImg,
+                                              const ImagePtr& maskImg,
+                                              bool masked,
+                                              bool maskInvert,
+                                              float mix)
+{
+    const bool copyUnProcessed = originalImg && canCallCopyUnProcessedChannels(processChannels);
+
+    // !masked && mix == 1: nothing to mix
+    const bool doMix = masked || (mix != 1);
+    if (!copyUnProcessed && !doMix) {
+        return eActionStatusOK;
+    }
+
+    if (getStorageMode() == eStorageModeGLTex) {
+        // Both operations are done by the same shader, reading and writing the output texture once
+        GLImageStoragePtr originalImageTexture, maskTexture, dstTexture;
+        if (originalImg) {
+            assert(originalImg->getStorageMode() == eStorageModeGLTex);
+            originalImageTexture = toGLImageStorage(originalImg->_imp->channels[0]);
+        }
+        if (maskImg && masked && doMix) {
+            assert(maskImg->getStorageMode() == eStorageModeGLTex);
+            maskTexture = toGLImageStorage(maskImg->_imp->channels[0]);
+        }
+        dstTexture = toGLImageStorage(_imp->channels[0]);
+
+        RectI realRoi;
+        if ( !roi.intersect(dstTexture->getBounds(), &realRoi) ) {
+            return eActionStatusOK;
+        }
+        ImagePrivate::copyUnProcessedChannelsAndMaskMixGL(originalImageTexture, maskTexture, dstTexture, processChannels, copyUnProcessed, doMix, mix, maskInvert, realRoi);
+        return eActionStatusOK;
+    }
+
+    // Mask must be alpha
+    assert( !masked || !maskImg || maskImg->getLayer().getNumComponents() == 1 );
+
+    // This function only works if original image and mask image have the same bitdepth as output
+    assert(!originalImg || (originalImg->getBitDepth() == getBitDepth()));
+    assert(!maskImg || (maskImg->getBitDepth() == getBitDepth()));
+
+    Image::CPUData srcImgData, maskImgData;
+    if (originalImg) {
+        originalImg->getCPUData(&srcImgData);
+    }
+
+    if (maskImg && doMix) {
+        maskImg->getCPUData(&maskImgData);
+        assert(maskImgData.nComps == 1);
+    }
+
+    Image::CPUData dstImgData;
+    getCPUData(&dstImgData);
+
+    RectI tileRoI;
+    roi.intersect(dstImgData.bounds, &tileRoI);
+
+    CopyUnProcessedAndMaskMixProcessor processor(_imp->renderClone.lock());
+    processor.setValues(srcImgData, maskImgData, dstImgData, processChannels, copyUnProcessed, doMix, mix, maskInvert);
+    processor.setRenderWindow(tileRoI);
+    return processor.process();
+
+} // copyUnProcessedChannelsAndApplyMaskMix
+
 class ApplyPixelShaderProcessor : public ImageMultiThreadProcessorBase
 {
     Image::CPUData  _dstImgData;
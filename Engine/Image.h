@@ -194,6 +194,13 @@ public:
         // Default - false
         bool delayAllocation;
 
+        // If set to true, the RAM buffers of the image are allocated cleared to 0, which is cheaper than calling
+        // fillBoundsZero() afterwards: large buffers are mapped from pages already cleared by the system.
+        // This has no effect on OpenGL textures, which must still be filled.
+        //
+        // Default - false
+        bool zeroInitialized;
+
         InitStorageArgs();
     };
 
@@ -378,6 +385,16 @@ public:
      **/
     ActionRetCodeEnum copyPixels(const Image& other, const CopyPixelsArgs& args);
 
+    /**
+     * @brief If this image is an OpenGL texture, start reading it to RAM without waiting for the GPU
+     * to finish its work. The next copyPixels() from this image to a RAM image only waits for the transfer
+     * if it is not done yet, instead of stalling the GL pipeline with a synchronous read.
+     * The texture must not be rendered to until then, otherwise call discardGPUReadback().
+     **/
+    void startGPUReadback();
+
+    void discardGPUReadback();
+
     /**
      * @brief Helper function to get string from a layer and bitdepth
      **/
@@ -606,14 +623,16 @@ public:
      * the downscaled data.
      * If downscaleLevels is 0, this will return this image.
      * The new image in output if created will have a packed RGBA full rect format.
+     * An OpenGL texture is downscaled on the GPU to a texture of the same context.
      * If the roi will be rounded to the closest enclosing rectangle that has
      * a multiple of 2 width and height.
      **/
     ImagePtr downscaleMipMap(const RectI & roi, unsigned int downscaleLevels) const;
 
     /**
-     * @brief Returns true if the image contains NaNs or infinite values, and fix them.
-     * Currently, no OpenGL implementation is provided.
+     * @brief Returns true if the image contains NaNs, and fix them.
+     * Scan-lines are first scanned with SIMD instructions and only those containing NaNs are written to.
+     * Byte and short images never contain NaNs. Currently, no OpenGL implementation is provided.
      */
     ActionRetCodeEnum checkForNaNs(const RectI& roi, bool* foundNan) WARN_UNUSED_RETURN;
 
@@ -641,6 +660,18 @@ public:
                       bool maskInvert,
                       float mix);
 
+    /**
+     * @brief Same as calling copyUnProcessedChannels() and then applyMaskMix(), but the image is walked only once,
+     * which is how the render of an effect is finalized.
+     **/
+    ActionRetCodeEnum copyUnProcessedChannelsAndApplyMaskMix(const RectI& roi,
+                                                             std::bitset<4> processChannels,
+                                                             const ImagePtr& originalImg,
+                                                             const ImagePtr& maskImg,
+                                                             bool masked,
+                                                             bool maskInvert,
+                                                             float mix);
+
     typedef void (*ImageCPUPixelShaderFloat)(const void* customData, int nComps, float* pixelsPtr[4]);
     typedef void (*ImageCPUPixelShaderShort)(const void* customData, int nComps, unsigned short* pixelsPtr[4]);
     typedef void (*ImageCPUPixelShaderByte)(const void* customData, int nComps, unsigned char* pixelsPtr[4]);
@@ -675,9 +706,22 @@ public:
     template <typename SRCPIX, typename DSTPIX>
     static DSTPIX convertPixelDepth(SRCPIX pix);
 
+    /**
+     * @brief Convert the pixel depth of n values with convertPixelDepth(), which are srcStride elements apart
+     * in src and dstStride elements apart in dst. This is vectorized when both strides are 1 and gives the
+     * same results as convertPixelDepth().
+     **/
+    template <typename SRCPIX, typename DSTPIX>
+    static void convertPixelDepthRow(const SRCPIX* src, int srcStride, DSTPIX* dst, int dstStride, int n);
+
 
 private:
 
+    /**
+     * @brief Implementation of downscaleMipMap for OpenGL textures: the levels are rendered by the context of the texture.
+     **/
+    ImagePtr downscaleMipMapGL(const RectI & roi, unsigned int downscaleLevels) const;
+
     friend struct ImagePrivate;
 
     boost::scoped_ptr<ImagePrivate> _imp;
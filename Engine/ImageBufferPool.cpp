@@ -0,0 +1,383 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ImageBufferPool.h"
+
+#include <cassert>
+#include <limits>
+#include <list>
+#include <map>
+
+#include <QMutex>
+#include <QtCore/QAtomicInt>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#endif
+
+#include "Engine/ThreadStorage.h"
+
+// Buffers smaller than this are not pooled
+#define NATRON_IMAGE_BUFFER_POOL_MIN_SIZE (256 * 1024)
+
+// Number of size classes between two powers of two
+#define NATRON_IMAGE_BUFFER_POOL_CLASSES_PER_OCTAVE 8
+
+// Number of buffers each thread keeps for itself
+#define NATRON_IMAGE_BUFFER_POOL_THREAD_CACHE_COUNT 2
+
+NATRON_NAMESPACE_ENTER
+
+typedef std::list<RamBuffer<char>*> RamBufferList;
+
+// The buffers kept by a single thread
+struct ImageBufferPoolThreadCache
+{
+    // Only contended when the pool is trimmed or the statistics are read
+    QMutex lock;
+    RamBufferList buffers;
+    std::size_t nBytes;
+    U64 nHits, nMisses;
+
+    ImageBufferPoolThreadCache()
+    : lock()
+    , buffers()
+    , nBytes(0)
+    , nHits(0)
+    , nMisses(0)
+    {
+
+    }
+
+    ~ImageBufferPoolThreadCache()
+    {
+        for (RamBufferList::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+            delete *it;
+        }
+    }
+};
+
+typedef boost::shared_ptr<ImageBufferPoolThreadCache> ImageBufferPoolThreadCachePtr;
+
+struct PooledBuffer
+{
+    RamBuffer<char>* buffer;
+
+    // Increases with each release, used to free the least recently released buffers first
+    U64 releaseIndex;
+};
+
+// Front is the least recently released buffer of the size class
+typedef std::map<std::size_t, std::list<PooledBuffer> > PooledBuffersMap;
+
+struct ImageBufferPoolPrivate
+{
+    // 1 if the maximum size is not 0: read without lock when releasing to a thread cache
+    QAtomicInt enabled;
+
+    // Protects maximumSize, buffers, nBytes, nextReleaseIndex
+    mutable QMutex lock;
+    std::size_t maximumSize;
+    PooledBuffersMap buffers;
+    std::size_t nBytes;
+    U64 nextReleaseIndex;
+
+    // The cache of each thread that ever used the pool
+    ThreadStorage<ImageBufferPoolThreadCachePtr> threadCache;
+
+    // Protects threadCaches
+    mutable QMutex threadCachesLock;
+    std::list<ImageBufferPoolThreadCachePtr> threadCaches;
+
+    ImageBufferPoolPrivate()
+    : enabled(0)
+    , lock()
+    , maximumSize(0)
+    , buffers()
+    , nBytes(0)
+    , nextReleaseIndex(0)
+    , threadCache()
+    , threadCachesLock()
+    , threadCaches()
+    {
+
+    }
+
+    ~ImageBufferPoolPrivate()
+    {
+        for (PooledBuffersMap::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+            for (std::list<PooledBuffer>::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+                delete it2->buffer;
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the cache of the caller thread, registering it on first use.
+     **/
+    ImageBufferPoolThreadCache* getThreadCache()
+    {
+        ImageBufferPoolThreadCachePtr& data = threadCache.localData();
+        if (!data) {
+            data = boost::make_shared<ImageBufferPoolThreadCache>();
+            QMutexLocker k(&threadCachesLock);
+            threadCaches.push_back(data);
+        }
+        return data.get();
+    }
+
+    /**
+     * @brief Moves to toFree idle buffers of the shared pool, the least recently released first,
+     * until nBytes were moved. Must be called with lock held. Returns the number of bytes moved.
+     **/
+    std::size_t takeLeastRecentlyReleased(std::size_t nBytes, RamBufferList* toFree)
+    {
+        std::size_t ret = 0;
+        while (ret < nBytes && !buffers.empty()) {
+            PooledBuffersMap::iterator oldest = buffers.end();
+            for (PooledBuffersMap::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+                assert(!it->second.empty());
+                if ( oldest == buffers.end() || it->second.front().releaseIndex < oldest->second.front().releaseIndex ) {
+                    oldest = it;
+                }
+            }
+            toFree->push_back(oldest->second.front().buffer);
+            ret += oldest->first;
+            this->nBytes -= oldest->first;
+            oldest->second.pop_front();
+            if ( oldest->second.empty() ) {
+                buffers.erase(oldest);
+            }
+        }
+        return ret;
+    }
+};
+
+ImageBufferPool::ImageBufferPool()
+: _imp(new ImageBufferPoolPrivate())
+{
+
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+
+}
+
+void
+ImageBufferPool::setMaximumSize(std::size_t size)
+{
+    std::size_t toTrim = 0;
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->maximumSize = size;
+        _imp->enabled.fetchAndStoreOrdered(size > 0 ? 1 : 0);
+        if (_imp->nBytes > size) {
+            toTrim = _imp->nBytes - size;
+        }
+    }
+    if (size == 0) {
+        clear();
+    } else if (toTrim > 0) {
+        trim(toTrim);
+    }
+}
+
+std::size_t
+ImageBufferPool::getMaximumSize() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->maximumSize;
+}
+
+std::size_t
+ImageBufferPool::getCurrentSize() const
+{
+    std::size_t ret;
+    {
+        QMutexLocker k(&_imp->lock);
+        ret = _imp->nBytes;
+    }
+    QMutexLocker k(&_imp->threadCachesLock);
+    for (std::list<ImageBufferPoolThreadCachePtr>::const_iterator it = _imp->threadCaches.begin(); it != _imp->threadCaches.end(); ++it) {
+        QMutexLocker k2(&(*it)->lock);
+        ret += (*it)->nBytes;
+    }
+    return ret;
+}
+
+std::size_t
+ImageBufferPool::getSizeClass(std::size_t nBytes)
+{
+    if (nBytes < NATRON_IMAGE_BUFFER_POOL_MIN_SIZE) {
+        return 0;
+    }
+
+    // Find the largest power of 2 lower or equal to nBytes and round up to the next multiple of the class step
+    std::size_t octave = NATRON_IMAGE_BUFFER_POOL_MIN_SIZE;
+    while (octave <= nBytes / 2) {
+        octave *= 2;
+    }
+    std::size_t step = octave / NATRON_IMAGE_BUFFER_POOL_CLASSES_PER_OCTAVE;
+    return ( (nBytes + step - 1) / step ) * step;
+}
+
+bool
+ImageBufferPool::takeBuffer(std::size_t nBytes, RamBuffer<char>* buffer)
+{
+    assert(!buffer->getData());
+    std::size_t sizeClass = getSizeClass(nBytes);
+    if ( !sizeClass || _imp->enabled.loadAcquire() == 0 ) {
+        return false;
+    }
+
+    ImageBufferPoolThreadCache* cache = _imp->getThreadCache();
+    {
+        QMutexLocker k(&cache->lock);
+        for (RamBufferList::iterator it = cache->buffers.begin(); it != cache->buffers.end(); ++it) {
+            if ( (*it)->size() == sizeClass ) {
+                buffer->swap(**it);
+                delete *it;
+                cache->buffers.erase(it);
+                cache->nBytes -= sizeClass;
+                ++cache->nHits;
+                return true;
+            }
+        }
+    }
+
+    RamBuffer<char>* found = 0;
+    {
+        QMutexLocker k(&_imp->lock);
+        PooledBuffersMap::iterator foundClass = _imp->buffers.find(sizeClass);
+        if ( foundClass != _imp->buffers.end() ) {
+            // Use the most recently released buffer, its pages are more likely to be resident
+            found = foundClass->second.back().buffer;
+            foundClass->second.pop_back();
+            if ( foundClass->second.empty() ) {
+                _imp->buffers.erase(foundClass);
+            }
+            _imp->nBytes -= sizeClass;
+        }
+    }
+    if (found) {
+        buffer->swap(*found);
+        delete found;
+    }
+
+    QMutexLocker k(&cache->lock);
+    if (found) {
+        ++cache->nHits;
+    } else {
+        ++cache->nMisses;
+    }
+    return found != 0;
+} // takeBuffer
+
+void
+ImageBufferPool::releaseBuffer(RamBuffer<char>* buffer)
+{
+    std::size_t size = buffer->size();
+    if ( !buffer->getData() || _imp->enabled.loadAcquire() == 0 || getSizeClass(size) != size ) {
+        buffer->clear();
+        return;
+    }
+
+    RamBuffer<char>* kept = new RamBuffer<char>;
+    kept->swap(*buffer);
+
+    ImageBufferPoolThreadCache* cache = _imp->getThreadCache();
+    {
+        QMutexLocker k(&cache->lock);
+        if (cache->buffers.size() < NATRON_IMAGE_BUFFER_POOL_THREAD_CACHE_COUNT) {
+            cache->buffers.push_back(kept);
+            cache->nBytes += size;
+            return;
+        }
+    }
+
+    {
+        QMutexLocker k(&_imp->lock);
+        if (_imp->nBytes + size <= _imp->maximumSize) {
+            PooledBuffer b = {kept, _imp->nextReleaseIndex++};
+            _imp->buffers[size].push_back(b);
+            _imp->nBytes += size;
+            return;
+        }
+    }
+
+    // The pool is full
+    delete kept;
+} // releaseBuffer
+
+void
+ImageBufferPool::trim(std::size_t nBytes)
+{
+    // Free the memory outside of the locks
+    RamBufferList toFree;
+    std::size_t freed;
+    {
+        QMutexLocker k(&_imp->lock);
+        freed = _imp->takeLeastRecentlyReleased(nBytes, &toFree);
+    }
+    if (freed < nBytes) {
+        QMutexLocker k(&_imp->threadCachesLock);
+        for (std::list<ImageBufferPoolThreadCachePtr>::const_iterator it = _imp->threadCaches.begin(); it != _imp->threadCaches.end() && freed < nBytes; ++it) {
+            QMutexLocker k2(&(*it)->lock);
+            while ( freed < nBytes && !(*it)->buffers.empty() ) {
+                RamBuffer<char>* b = (*it)->buffers.front();
+                (*it)->buffers.pop_front();
+                (*it)->nBytes -= b->size();
+                freed += b->size();
+                toFree.push_back(b);
+            }
+        }
+    }
+    for (RamBufferList::iterator it = toFree.begin(); it != toFree.end(); ++it) {
+        delete *it;
+    }
+} // trim
+
+void
+ImageBufferPool::clear()
+{
+    trim( std::numeric_limits<std::size_t>::max() );
+}
+
+void
+ImageBufferPool::getStats(U64* nHits, U64* nMisses) const
+{
+    *nHits = 0;
+    *nMisses = 0;
+    QMutexLocker k(&_imp->threadCachesLock);
+    for (std::list<ImageBufferPoolThreadCachePtr>::const_iterator it = _imp->threadCaches.begin(); it != _imp->threadCaches.end(); ++it) {
+        QMutexLocker k2(&(*it)->lock);
+        *nHits += (*it)->nHits;
+        *nMisses += (*it)->nMisses;
+    }
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,120 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_ImageBufferPool_h
+#define Engine_ImageBufferPool_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/RamBuffer.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A pool of recycled image buffers for RAMImageStorage.
+ * During playback the same buffer sizes are allocated and freed for every frame: instead of giving the memory
+ * back to the system, freed buffers are kept here by size class and handed out again, which avoids the page faults,
+ * zeroing and allocator lock contention of fresh allocations.
+ *
+ * Buffers are rounded up to a size class (8 classes per power of two) so that images of slightly different
+ * sizes share buffers. Small buffers are not pooled, the system allocator is good at them.
+ * Each thread keeps a few buffers in a local cache before going through the shared pool: a render thread
+ * freeing its temporary images reuses them for the next frame without taking the lock of the pool.
+ *
+ * The pool is bounded by a maximum size. The idle buffers count toward the tile cache budget and are released
+ * first when the caches are checked for memory (@see StorageDeleterThread) or when the system is short in RAM.
+ **/
+struct ImageBufferPoolPrivate;
+class ImageBufferPool
+{
+public:
+
+    ImageBufferPool();
+
+    ~ImageBufferPool();
+
+    /**
+     * @brief Set the maximum amount of RAM (in bytes) of idle buffers. 0 disables the pool and frees all buffers.
+     **/
+    void setMaximumSize(std::size_t size);
+
+    std::size_t getMaximumSize() const;
+
+    /**
+     * @brief Returns the number of bytes currently held by idle buffers
+     **/
+    std::size_t getCurrentSize() const;
+
+    /**
+     * @brief Returns the size of the buffer that must be allocated for nBytes so that it can be recycled,
+     * or 0 if buffers of this size are not pooled.
+     **/
+    static std::size_t getSizeClass(std::size_t nBytes);
+
+    /**
+     * @brief If an idle buffer of the size class of nBytes exists, swap it with the given buffer which must be empty
+     * and return true. The content of the buffer is undefined.
+     **/
+    bool takeBuffer(std::size_t nBytes, RamBuffer<char>* buffer);
+
+    /**
+     * @brief Keeps the memory of the given buffer for a later takeBuffer() call if its size is a size class and the pool
+     * has room for it, otherwise the memory is freed. In any case the buffer is empty in output.
+     **/
+    void releaseBuffer(RamBuffer<char>* buffer);
+
+    /**
+     * @brief Frees idle buffers, the least recently released first, until at least nBytes were freed.
+     * The buffers of the per-thread caches are freed last.
+     **/
+    void trim(std::size_t nBytes);
+
+    /**
+     * @brief Frees all idle buffers
+     **/
+    void clear();
+
+    /**
+     * @brief Returns the number of takeBuffer() calls that found a buffer (hits) and that did not (misses)
+     **/
+    void getStats(U64* nHits, U64* nMisses) const;
+
+private:
+
+    boost::scoped_ptr<ImageBufferPoolPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_ImageBufferPool_h
@@ -27,6 +27,7 @@
 
 #include "ImageCacheEntry.h"
 
+#include <algorithm> // min
 #include <map>
 
 #include <QThread>
@@ -39,6 +40,10 @@
 #include "Engine/AppManager.h"
 #include "Engine/Cache.h"
 #include "Engine/CacheEntryBase.h"
+#include "Engine/CacheStats.h"
+#include "Engine/CompressedTileFile.h"
+#include "Engine/CompressedTileStorage.h"
+#include "Engine/EffectInstance.h"
 #include "Engine/Hash64.h"
 #include "Engine/Node.h"
 #include "Engine/ImageCacheKey.h"
@@ -47,7 +52,11 @@
 #include "Engine/ImageCacheEntryProcessing.h"
 #include "Engine/ImageTilesState.h"
 #include "Engine/MultiThread.h"
+#include "Engine/RemoteTileCache.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/ThreadPoolMonitor.h"
+#include "Engine/TileArchive.h"
+#include "Engine/TraceRecorder.h"
 #include "Engine/TreeRenderQueueManager.h"
 #include "Engine/Timer.h"
 
@@ -57,6 +66,14 @@
 //#define TRACE_RENDERED_TILES
 //#define TRACE_TILES_STATUS_SHORT
 
+// Maximum time spent waiting for the remote tile cache to answer before rendering the tiles it did not return, in milliseconds
+#define NATRON_REMOTE_TILE_CACHE_FETCH_TIMEOUT_MS 200
+
+// While waiting for tiles pending in another render, check for abortion at least every 10 milliseconds
+// and do not poll the tiles state less often than every 200 milliseconds
+#define NATRON_PENDING_TILES_ABORT_CHECK_INTERVAL_MS 10
+#define NATRON_PENDING_TILES_MAX_POLL_INTERVAL_MS 200
+
 #if defined(TRACE_TILES_STATUS) || defined(TRACE_TILES_STATUS_SHORT)
 #include <QTextStream>
 #endif
@@ -400,7 +417,7 @@ struct ImageCacheEntryPrivate
 
         assert(nComps > 0);
         int tileSizeX, tileSizeY;
-        CacheBase::getTileSizePx(depth, &tileSizeX, &tileSizeY);
+        appPTR->getTileCache()->getTileSizePx(depth, &tileSizeX, &tileSizeY);
 
 #ifndef NDEBUG
         assert(perMipMapPixelRod[mipMapLevel].contains(roi));
@@ -478,6 +495,46 @@ struct ImageCacheEntryPrivate
      **/
     bool markCacheEntriesAsAbortedInternal();
 
+    /**
+     * @brief Notifies the TreeRenderQueueManager that the tiles this entry marked pending are no longer pending,
+     * so that the renders waiting for them are launched again. This must not be called under the lock.
+     **/
+    void notifyPendingTilesRendered();
+
+    /**
+     * @brief Mark the given tiles of the current mipmap level as rendered in the cache and copy them from our local buffers
+     * to the cache. The tiles must be in markedTiles. This must be called under the lock.
+     * @param isDraft Whether the tiles should be marked low quality.
+     * @param publishToRemoteCache If true and the tiles are not draft, they are also published to the RemoteTileCache.
+     **/
+    void markCacheTilesAsRenderedInternal(const TilesSet& tilesToMark, bool isDraft, bool publishToRemoteCache);
+
+    /**
+     * @brief If the tiles of the effect are exported with --export-cache, write the given tiles of the current mipmap level
+     * to the archive. The tiles must be rendered at full quality and their pointers valid.
+     **/
+    void exportTilesToArchive(const std::vector<boost::shared_ptr<TileData> >& tiles);
+
+    /**
+     * @brief For each tile we are expected to render, look-up in the CompressedTileStorage if it was evicted from the cache,
+     * then in the archives imported with --import-cache and in the RemoteTileCache.
+     * If so, the tile is copied to our local buffers and marked rendered in the cache, so it does not need to be rendered again.
+     * This must be called under the lock, after readAndUpdateStateMap.
+     **/
+    ActionRetCodeEnum restoreEvictedTiles() WARN_UNUSED_RETURN;
+
+    /**
+     * @brief If the effect stores its images compressed (a DiskCache node or the output of a frozen group), returns its file, otherwise NULL.
+     **/
+    CompressedTileFilePtr getDiskCacheNodeFile() const
+    {
+        EffectInstancePtr effectPtr = effect.lock();
+        if (!effectPtr) {
+            return CompressedTileFilePtr();
+        }
+        return effectPtr->getCompressedTileFile();
+    }
+
     /**
      * @brief Only relevant if the cache entry is persistent: update the cache from our local cache entry
      **/
@@ -1620,6 +1677,7 @@ ImageCacheEntryPrivate::fetchAndCopyCachedTiles()
 #else
                                                     &tilesAllocNeeded,
 #endif
+                                                    0 /*evictedTilesElementSize*/, // Downscaled tiles may be produced from low quality tiles
                                                     &fetchedExistingTiles, &allocatedTiles, &cacheData);
     boost::scoped_ptr<CacheDataLock_RAII> cacheDataDeleter(new CacheDataLock_RAII(tileCache, cacheData));
     if (!gotTiles) {
@@ -1673,6 +1731,9 @@ ImageCacheEntryPrivate::fetchAndCopyCachedTiles()
             case eImageBitDepthShort:
                 processor.reset(new DownscaleMipMapProcessor<unsigned short>(renderClone));
                 break;
+            case eImageBitDepthHalf:
+                processor.reset(new DownscaleMipMapProcessor<Half>(renderClone));
+                break;
             case eImageBitDepthFloat:
                 processor.reset(new DownscaleMipMapProcessor<float>(renderClone));
                 break;
@@ -1759,13 +1820,19 @@ ImageCacheEntryPrivate::fetchAndCopyCachedTiles()
     // Now add the tiles we just downscaled to our level to the list of tiles to copy
     tilesToCopy.insert(tilesToCopy.end(), perLevelTilesToDownscale[mipMapLevel].begin(), perLevelTilesToDownscale[mipMapLevel].end());
     
-    // Finally copy with multiple threads each tile from the cache
+    // Finally copy with multiple threads each tile from the cache.
+    // The tiles cannot be handed to the image without a copy: the pointers are only valid while cacheDataDeleter holds the
+    // tiles lock, which must not be held during a render since allocating tiles may need to grow the storage under the write lock,
+    // and an evicted entry gets its tiles freed even if an image still references it. Each tile is copied at most once per render:
+    // markCacheTilesAsRendered only copies back the tiles this render produced, never the ones fetched here.
     boost::scoped_ptr<CachePixelsTransferProcessorBase> processor;
     switch (bitdepth) {
         case eImageBitDepthByte:
             processor.reset(new CachePixelsTransferProcessor<false /*copyToCache*/, unsigned char>(renderClone));
             break;
         case eImageBitDepthShort:
+        case eImageBitDepthHalf:
+            // Half pixels are transferred as they are
             processor.reset(new CachePixelsTransferProcessor<false /*copyToCache*/, unsigned short>(renderClone));
             break;
         case eImageBitDepthFloat:
@@ -1777,6 +1844,10 @@ ImageCacheEntryPrivate::fetchAndCopyCachedTiles()
     processor->setValues(this, tilesToCopy);
     ActionRetCodeEnum stat = processor->launchThreadsBlocking();
 
+    // The tiles found in the cache are exported too, not only the ones rendered
+    if (!isDraftModeEnabled) {
+        exportTilesToArchive(tilesToCopy);
+    }
 
     // Release the tiles lock before calling updateCachedTilesStateMap which may try to take a write lock on an already taken read lock
     cacheDataDeleter.reset();
@@ -1798,6 +1869,14 @@ ImageCacheEntry::fetchCachedTilesAndUpdateStatus(bool readOnly, TileStateHeader*
     _imp->writeDebugStatus("fetchCachedTilesAndUpdateStatus", true);
 #endif
 
+    TraceSpan_RAII traceSpan(eTraceCategoryCache, "Cache look-up");
+    if ( traceSpan.isRecording() ) {
+        EffectInstancePtr effect = _imp->effect.lock();
+        if (effect) {
+            traceSpan.setDetail( effect->getScriptName_mt_safe() );
+        }
+    }
+
 
     // Protect all local structures against multiple threads using this object.
     {
@@ -1964,6 +2043,14 @@ ImageCacheEntry::fetchCachedTilesAndUpdateStatus(bool readOnly, TileStateHeader*
                 }
                 
             }
+
+            if (!_imp->updateStateMapReadOnly) {
+                // Tiles that we must render may have been evicted from the cache but still be in the compressed storage
+                ActionRetCodeEnum stat = _imp->restoreEvictedTiles();
+                if (isFailureRetCode(stat)) {
+                    return stat;
+                }
+            }
         } // _imp->cachePolicy = eCacheAccessModeNone
 
     } // locker
@@ -2043,24 +2130,47 @@ ImageCacheEntry::markCacheTilesAsAborted()
     // Make sure to call fetchCachedTilesAndUpdateStatus() first
     assert(_imp->internalCacheEntry);
 
-    // Protect all local structures against multiple threads using this object.
-    boost::unique_lock<boost::mutex> locker(_imp->lock);
+    bool didSomething;
+    {
+        // Protect all local structures against multiple threads using this object.
+        boost::unique_lock<boost::mutex> locker(_imp->lock);
 
-    bool didSomething = _imp->markCacheEntriesAsAbortedInternal();
+        didSomething = _imp->markCacheEntriesAsAbortedInternal();
+
+        if (didSomething && _imp->cachePolicy != eCacheAccessModeNone) {
+            // In persistent mode we have to actually copy the cache entry tiles state map to the cache
+            if (_imp->internalCacheEntry->isPersistent()) {
+                _imp->updateCachedTilesStateMap(_imp->markedTiles, false);
+            }
 
-    if (didSomething && _imp->cachePolicy != eCacheAccessModeNone) {
-        // In persistent mode we have to actually copy the cache entry tiles state map to the cache
-        if (_imp->internalCacheEntry->isPersistent()) {
-            _imp->updateCachedTilesStateMap(_imp->markedTiles, false);
         }
 
+        _imp->markedTiles.clear();
     }
 
-    _imp->markedTiles.clear();
-
+    // The renders waiting for these tiles have to render them instead
+    if (didSomething) {
+        _imp->notifyPendingTilesRendered();
+    }
 
 } // markCacheTilesAsAborted
 
+void
+ImageCacheEntryPrivate::notifyPendingTilesRendered()
+{
+    // Without caching the tiles are not shared: nobody can wait for them
+    if (cachePolicy == eCacheAccessModeNone || !key) {
+        return;
+    }
+    TreeRenderQueueManagerPtr manager;
+    if (appPTR) {
+        manager = appPTR->getTasksQueueManager();
+    }
+    if (manager) {
+        manager->notifyPendingTilesRendered( key->getHash() );
+    }
+} // notifyPendingTilesRendered
+
 bool
 ImageCacheEntryPrivate::markCacheEntriesAsAbortedInternal()
 {
@@ -2244,43 +2354,56 @@ ImageCacheEntry::markCacheTilesAsRendered()
     // Make sure to call fetchCachedTilesAndUpdateStatus() first
     assert(_imp->internalCacheEntry);
 
-    // Protect all local structures against multiple threads using this object.
-    boost::unique_lock<boost::mutex> locker(_imp->lock);
-    
-    if (_imp->markedTiles.empty()) {
-        return;
+    {
+        // Protect all local structures against multiple threads using this object.
+        boost::unique_lock<boost::mutex> locker(_imp->lock);
+
+        if (_imp->markedTiles.empty()) {
+            return;
+        }
+
+        // Copy the set since markCacheTilesAsRenderedInternal() removes the tiles from markedTiles
+        TilesSet tilesToMark = _imp->markedTiles[_imp->mipMapLevel];
+        _imp->markCacheTilesAsRenderedInternal(tilesToMark, _imp->isDraftModeEnabled, true /*publishToRemoteCache*/);
     }
 
+    // Launch again the renders of this process that were waiting for these tiles
+    _imp->notifyPendingTilesRendered();
+} // markCacheTilesAsRendered
+
+void
+ImageCacheEntryPrivate::markCacheTilesAsRenderedInternal(const TilesSet& tilesToMark, bool isDraft, bool publishToRemoteCache)
+{
     boost::scoped_ptr<boost::unique_lock<boost::shared_mutex> > writeLock;
-    if (!_imp->internalCacheEntry->isPersistent()) {
+    if (!internalCacheEntry->isPersistent()) {
         // In non-persistent mode, lock the cache entry since it's shared across threads.
         // In persistent mode the entry is copied in fromMemorySegment
-        ImageCacheEntryInternal<false>* nonPersistentLocalEntry = dynamic_cast<ImageCacheEntryInternal<false>* >(_imp->internalCacheEntry.get());
+        ImageCacheEntryInternal<false>* nonPersistentLocalEntry = dynamic_cast<ImageCacheEntryInternal<false>* >(internalCacheEntry.get());
         assert(nonPersistentLocalEntry);
         writeLock.reset(new boost::unique_lock<boost::shared_mutex>(nonPersistentLocalEntry->perMipMapTilesStateMutex));
     }
 
     // We should have gotten the state map from the cache in fetchCachedTilesAndUpdateStatus()
-    assert(!_imp->internalCacheEntry->perMipMapTilesState.empty());
+    assert(!internalCacheEntry->perMipMapTilesState.empty());
 
-    assert(!_imp->localTilesState.state->tiles.empty());
+    assert(!localTilesState.state->tiles.empty());
 
 
     // Read the cache map and update our local map
-    CacheBasePtr cache = _imp->internalCacheEntry->getCache();
+    CacheBasePtr cache = internalCacheEntry->getCache();
     bool hasModifiedTileMap = false;
 
 #if defined(TRACE_TILES_STATUS) || defined(TRACE_TILES_STATUS_SHORT)
-    _imp->writeDebugStatus("markCacheTilesAsRendered", true);
+    writeDebugStatus("markCacheTilesAsRendered", true);
 #endif
 
     std::vector<boost::shared_ptr<TileData> > tilesToCopy;
 
     {
 
-        TileStateHeader cacheStateMap = TileStateHeader(_imp->localTilesState.tileSizeX, _imp->localTilesState.tileSizeY, &_imp->internalCacheEntry->perMipMapTilesState[_imp->mipMapLevel]);
+        TileStateHeader cacheStateMap = TileStateHeader(localTilesState.tileSizeX, localTilesState.tileSizeY, &internalCacheEntry->perMipMapTilesState[mipMapLevel]);
 
-        for (TilesSet::iterator it = _imp->markedTiles[_imp->mipMapLevel].begin(); it != _imp->markedTiles[_imp->mipMapLevel].end(); ++it) {
+        for (TilesSet::const_iterator it = tilesToMark.begin(); it != tilesToMark.end(); ++it) {
 
             TileState* cacheTileState = cacheStateMap.getTileAt(it->tx, it->ty);
 
@@ -2288,25 +2411,25 @@ ImageCacheEntry::markCacheTilesAsRendered()
             // readAndUpdateStateMap
             // Mark it as eTileStatusRendered now
             assert(cacheTileState->status == eTileStatusPending);
-            cacheTileState->status = _imp->isDraftModeEnabled ? eTileStatusRenderedLowQuality : eTileStatusRenderedHighestQuality;
+            cacheTileState->status = isDraft ? eTileStatusRenderedLowQuality : eTileStatusRenderedHighestQuality;
 
 #ifdef TRACE_TILES_STATUS
 #ifdef TRACE_TILES_ONLY_PRINT_FIRST_TILE
             if (it->tx == 0 && it->ty == 0)
 #endif
-            qDebug() << QThread::currentThread() << _imp->effect.lock().get()  << _imp->effect.lock()->getScriptName_mt_safe().c_str() << _imp->image.lock()->getLayer().getPlaneLabel().c_str() << _imp->internalCacheEntry->getHashKey() <<  "marking " << it->tx << it->ty << "rendered at level" << _imp->mipMapLevel;
+            qDebug() << QThread::currentThread() << effect.lock().get()  << effect.lock()->getScriptName_mt_safe().c_str() << image.lock()->getLayer().getPlaneLabel().c_str() << internalCacheEntry->getHashKey() <<  "marking " << it->tx << it->ty << "rendered at level" << mipMapLevel;
 #endif
             hasModifiedTileMap = true;
 
 
-            TileState* localTileState = _imp->localTilesState.getTileAt(it->tx, it->ty);
+            TileState* localTileState = localTilesState.getTileAt(it->tx, it->ty);
             assert(localTileState->status == eTileStatusNotRendered);
             if (localTileState->status == eTileStatusNotRendered) {
 
                 localTileState->status = cacheTileState->status;
 
-                if (_imp->cachePolicy != eCacheAccessModeNone) {
-                    for (int c = 0; c < _imp->nComps; ++c) {
+                if (cachePolicy != eCacheAccessModeNone) {
+                    for (int c = 0; c < nComps; ++c) {
                         // Mark this tile in the list of tiles to copy
                         boost::shared_ptr<TileData> copy(new TileData);
                         copy->bounds = localTileState->bounds;
@@ -2319,19 +2442,29 @@ ImageCacheEntry::markCacheTilesAsRendered()
         }
     }
 
-    std::vector<TilesSet> tilesToUpdate = _imp->markedTiles;
-    _imp->markedTiles.clear();
+    std::vector<TilesSet> tilesToUpdate;
+    if (tilesToMark.size() == markedTiles[mipMapLevel].size()) {
+        tilesToUpdate = markedTiles;
+        markedTiles.clear();
+    } else {
+        tilesToUpdate.resize(mipMapLevel + 1);
+        tilesToUpdate[mipMapLevel] = tilesToMark;
+        for (TilesSet::const_iterator it = tilesToMark.begin(); it != tilesToMark.end(); ++it) {
+            markedTiles[mipMapLevel].erase(*it);
+        }
+    }
 
 #ifdef DEBUG
-    // Check that all tiles are marked either rendered or pending
-    RectI roiRounded = _imp->roi;
-    roiRounded.roundToTileSize(_imp->localTilesState.tileSizeX, _imp->localTilesState.tileSizeY);
-    for (int ty = roiRounded.y1; ty < roiRounded.y2; ty += _imp->localTilesState.tileSizeY) {
-        for (int tx = roiRounded.x1; tx < roiRounded.x2; tx += _imp->localTilesState.tileSizeX) {
+    // Check that all tiles are marked either rendered or pending, except the ones still left to render
+    RectI roiRounded = roi;
+    roiRounded.roundToTileSize(localTilesState.tileSizeX, localTilesState.tileSizeY);
+    for (int ty = roiRounded.y1; ty < roiRounded.y2; ty += localTilesState.tileSizeY) {
+        for (int tx = roiRounded.x1; tx < roiRounded.x2; tx += localTilesState.tileSizeX) {
 
-            assert(tx % _imp->localTilesState.tileSizeX == 0 && ty % _imp->localTilesState.tileSizeY == 0);
-            TileState* localTileState = _imp->localTilesState.getTileAt(tx, ty);
-            assert(localTileState->status == eTileStatusPending || localTileState->status == eTileStatusRenderedHighestQuality || localTileState->status == eTileStatusRenderedLowQuality);
+            assert(tx % localTilesState.tileSizeX == 0 && ty % localTilesState.tileSizeY == 0);
+            TileState* localTileState = localTilesState.getTileAt(tx, ty);
+            assert(localTileState->status == eTileStatusPending || localTileState->status == eTileStatusRenderedHighestQuality || localTileState->status == eTileStatusRenderedLowQuality ||
+                   !markedTiles.empty());
         }
     }
 #endif
@@ -2341,21 +2474,21 @@ ImageCacheEntry::markCacheTilesAsRendered()
     }
 
     // The following is only done when interacting with the cache: we copy our local buffers to the cache
-    if (_imp->cachePolicy == eCacheAccessModeNone) {
+    if (cachePolicy == eCacheAccessModeNone) {
         return;
     }
 
     // We are going to fetch data from the cache, ensure our local buffers are allocated
-    _imp->image.lock()->ensureBuffersAllocated();
+    image.lock()->ensureBuffersAllocated();
 
 
 #ifdef NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED
     std::size_t nTilesToAlloc = tilesToCopy.size();
 #else
-    U64 entryHash = _imp->internalCacheEntry->getHashKey();
+    U64 entryHash = internalCacheEntry->getHashKey();
     std::vector<TileHash> tilesAllocNeeded(tilesToCopy.size());
     for (std::size_t i = 0; i < tilesToCopy.size(); ++i) {
-        tilesAllocNeeded[i] = CacheBase::makeTileCacheIndex(tilesToCopy[i]->bounds.x1, tilesToCopy[i]->bounds.y1, _imp->mipMapLevel, tilesToCopy[i]->channel_i, entryHash);
+        tilesAllocNeeded[i] = CacheBase::makeTileCacheIndex(tilesToCopy[i]->bounds.x1, tilesToCopy[i]->bounds.y1, mipMapLevel, tilesToCopy[i]->channel_i, entryHash);
     }
 #endif
 
@@ -2363,12 +2496,13 @@ ImageCacheEntry::markCacheTilesAsRendered()
     // Allocate buffers for tiles
     std::vector<std::pair<TileInternalIndex, void*> > allocatedTiles;
     void* cacheData;
-    bool gotTiles = cache->retrieveAndLockTiles(_imp->internalCacheEntry, 0 /*existingTiles*/,
+    bool gotTiles = cache->retrieveAndLockTiles(internalCacheEntry, 0 /*existingTiles*/,
 #ifdef NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED
                                                 nTilesToAlloc,
 #else
                                                 &tilesAllocNeeded,
 #endif
+                                                isDraft ? 0 : getSizeOfForBitDepth(bitdepth),
                                                 NULL, &allocatedTiles, &cacheData);
 
 
@@ -2378,7 +2512,7 @@ ImageCacheEntry::markCacheTilesAsRendered()
     }
 
     // This is the tiles state at the mipmap level of interest in the cache
-    TileStateHeader cacheStateMap(_imp->localTilesState.tileSizeX, _imp->localTilesState.tileSizeY, &_imp->internalCacheEntry->perMipMapTilesState[_imp->mipMapLevel]);
+    TileStateHeader cacheStateMap(localTilesState.tileSizeX, localTilesState.tileSizeY, &internalCacheEntry->perMipMapTilesState[mipMapLevel]);
     assert(!cacheStateMap.state->tiles.empty());
 
     // Set the tile pointer to the tiles to copy
@@ -2390,25 +2524,27 @@ ImageCacheEntry::markCacheTilesAsRendered()
         assert(cache->checkTileIndex(tilesToCopy[i]->tileCache_i));
 #endif
         // update the tile indices
-        int tx = (int)std::floor((double)tilesToCopy[i]->bounds.x1 / _imp->localTilesState.tileSizeX) * _imp->localTilesState.tileSizeX;
-        int ty = (int)std::floor((double)tilesToCopy[i]->bounds.y1 / _imp->localTilesState.tileSizeY) * _imp->localTilesState.tileSizeY;
+        int tx = (int)std::floor((double)tilesToCopy[i]->bounds.x1 / localTilesState.tileSizeX) * localTilesState.tileSizeX;
+        int ty = (int)std::floor((double)tilesToCopy[i]->bounds.y1 / localTilesState.tileSizeY) * localTilesState.tileSizeY;
         TileState* cacheTileState = cacheStateMap.getTileAt(tx, ty);
         //assert(allocatedTiles[i].first.index != (U64)-1);
         cacheTileState->channelsTileStorageIndex[tilesToCopy[i]->channel_i] = allocatedTiles[i].first;
 
-        TileState* localTileState = _imp->localTilesState.getTileAt(tx, ty);
+        TileState* localTileState = localTilesState.getTileAt(tx, ty);
         localTileState->channelsTileStorageIndex[tilesToCopy[i]->channel_i] = allocatedTiles[i].first;
     }
 
-    EffectInstancePtr renderClone = _imp->effect.lock();
+    EffectInstancePtr renderClone = effect.lock();
 
     // Finally copy over multiple threads each tile
     boost::scoped_ptr<CachePixelsTransferProcessorBase> processor;
-    switch (_imp->bitdepth) {
+    switch (bitdepth) {
         case eImageBitDepthByte:
             processor.reset(new CachePixelsTransferProcessor<true /*copyToCache*/, unsigned char>(renderClone));
             break;
         case eImageBitDepthShort:
+        case eImageBitDepthHalf:
+            // Half pixels are transferred as they are
             processor.reset(new CachePixelsTransferProcessor<true /*copyToCache*/, unsigned short>(renderClone));
             break;
         case eImageBitDepthFloat:
@@ -2418,22 +2554,261 @@ ImageCacheEntry::markCacheTilesAsRendered()
             break;
     }
 
-    processor->setValues(_imp.get(), tilesToCopy);
+    processor->setValues(this, tilesToCopy);
     ActionRetCodeEnum stat = processor->launchThreadsBlocking();
 
     // We never abort when copying tiles to the cache since they are anyway already rendered.
     assert(stat == eActionStatusOK);
     (void)stat;
 
+    // Share the tiles rendered at full quality with the other machines using the same remote cache
+    if (publishToRemoteCache && !isDraft) {
+        RemoteTileCache* remoteCache = appPTR->getRemoteTileCache();
+        if ( remoteCache && remoteCache->isEnabled() ) {
+            const U64 imageHash = internalCacheEntry->getHashKey();
+            const std::size_t tileSizeBytes = cache->getTileSizeBytes();
+            const int elementSizeBytes = getSizeOfForBitDepth(bitdepth);
+            for (std::size_t i = 0; i < tilesToCopy.size(); ++i) {
+                TileHash tileHash = CacheBase::makeTileCacheIndex(tilesToCopy[i]->bounds.x1, tilesToCopy[i]->bounds.y1, mipMapLevel, tilesToCopy[i]->channel_i, imageHash);
+                remoteCache->publishTile(tileHash.index, tilesToCopy[i]->ptr, tileSizeBytes, elementSizeBytes);
+            }
+        }
+    }
+
+    // Store the tiles rendered at full quality in the compressed file of the DiskCache node. Tiles already in the file are skipped.
+    if (!isDraft) {
+        CompressedTileFilePtr diskCacheFile = getDiskCacheNodeFile();
+        if (diskCacheFile) {
+            const U64 imageHash = internalCacheEntry->getHashKey();
+            const std::size_t tileSizeBytes = cache->getTileSizeBytes();
+            const int elementSizeBytes = getSizeOfForBitDepth(bitdepth);
+            for (std::size_t i = 0; i < tilesToCopy.size(); ++i) {
+                TileHash tileHash = CacheBase::makeTileCacheIndex(tilesToCopy[i]->bounds.x1, tilesToCopy[i]->bounds.y1, mipMapLevel, tilesToCopy[i]->channel_i, imageHash);
+                diskCacheFile->writeTile(tileHash.index, tilesToCopy[i]->ptr, tileSizeBytes, elementSizeBytes);
+            }
+        }
+        // And in the archive exported with --export-cache
+        exportTilesToArchive(tilesToCopy);
+    }
+
     // We must delete the CacheDataLock_RAII now because updateCachedTilesStateMap may attempt to get a write lock on an already taken read lock
 
     cacheDataDeleter.reset();
 
     // In persistent mode we have to actually copy the cache entry tiles state map to the cache
-    if (_imp->internalCacheEntry->isPersistent()) {
-        _imp->updateCachedTilesStateMap(tilesToUpdate, false);
+    if (internalCacheEntry->isPersistent()) {
+        updateCachedTilesStateMap(tilesToUpdate, false);
     }
-} // markCacheTilesAsRendered
+} // markCacheTilesAsRenderedInternal
+
+void
+ImageCacheEntryPrivate::exportTilesToArchive(const std::vector<boost::shared_ptr<TileData> >& tiles)
+{
+    TileArchive* archive = appPTR->getTileArchive();
+    EffectInstancePtr effectPtr = effect.lock();
+    if ( tiles.empty() || !archive || !effectPtr || !archive->isExportingNode( effectPtr->getNode() ) ) {
+        return;
+    }
+    const U64 imageHash = internalCacheEntry->getHashKey();
+    const std::size_t tileSizeBytes = internalCacheEntry->getCache()->getTileSizeBytes();
+    const int elementSizeBytes = getSizeOfForBitDepth(bitdepth);
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        TileHash tileHash = CacheBase::makeTileCacheIndex(tiles[i]->bounds.x1, tiles[i]->bounds.y1, mipMapLevel, tiles[i]->channel_i, imageHash);
+        archive->exportTile(tileHash.index, tiles[i]->ptr, tileSizeBytes, elementSizeBytes);
+    }
+} // exportTilesToArchive
+
+ActionRetCodeEnum
+ImageCacheEntryPrivate::restoreEvictedTiles()
+{
+    if ( (cachePolicy == eCacheAccessModeNone) || (mipMapLevel >= markedTiles.size()) || markedTiles[mipMapLevel].empty() ) {
+        return eActionStatusOK;
+    }
+
+    CompressedTileStorage* compressedStorage = appPTR->getCompressedTileStorage();
+    if ( compressedStorage && !compressedStorage->isEnabled() ) {
+        compressedStorage = 0;
+    }
+    RemoteTileCache* remoteCache = appPTR->getRemoteTileCache();
+    if ( remoteCache && !remoteCache->isEnabled() ) {
+        remoteCache = 0;
+    }
+    TileArchive* importedTiles = appPTR->getTileArchive();
+    if ( importedTiles && !importedTiles->isEnabled() ) {
+        importedTiles = 0;
+    }
+    CompressedTileFilePtr diskCacheFile = getDiskCacheNodeFile();
+    if (!compressedStorage && !importedTiles && !remoteCache && !diskCacheFile) {
+        return eActionStatusOK;
+    }
+
+    U64 entryHash = internalCacheEntry->getHashKey();
+    const std::size_t tileSizeBytes = internalCacheEntry->getCache()->getTileSizeBytes();
+    CacheStats* cacheStats = appPTR->getCacheStats();
+    const U64 statsHolderID = key->getStatsHolderID();
+
+    // Local tiers are looked-up first, the remaining tiles are requested to the remote cache.
+    // The request is sent right away so that it is processed while we decompress the tiles found locally.
+    TilesSet diskCacheTiles, compressedTiles, archiveTiles, remoteTiles;
+    std::vector<U64> remoteHashes;
+    for (TilesSet::const_iterator it = markedTiles[mipMapLevel].begin(); it != markedTiles[mipMapLevel].end(); ++it) {
+
+        TileState* localTileState = localTilesState.getTileAt(it->tx, it->ty);
+        if (localTileState->status != eTileStatusNotRendered) {
+            continue;
+        }
+
+        // The hashes are the ones given in markCacheTilesAsRenderedInternal() when the tiles were allocated
+        TileHash channelHashes[4];
+        bool hasAllChannelsOnDisk = diskCacheFile.get() != 0;
+        bool hasAllChannels = compressedStorage != 0;
+        bool hasAllChannelsInArchives = importedTiles != 0;
+        for (int c = 0; c < nComps; ++c) {
+            channelHashes[c] = CacheBase::makeTileCacheIndex(localTileState->bounds.x1, localTileState->bounds.y1, mipMapLevel, c, entryHash);
+            if ( hasAllChannelsOnDisk && !diskCacheFile->hasTile(channelHashes[c].index) ) {
+                hasAllChannelsOnDisk = false;
+            }
+            if ( hasAllChannels && !compressedStorage->hasTile(channelHashes[c].index) ) {
+                hasAllChannels = false;
+            }
+            if ( hasAllChannelsInArchives && !importedTiles->hasTile(channelHashes[c].index) ) {
+                hasAllChannelsInArchives = false;
+            }
+        }
+        if (hasAllChannelsOnDisk) {
+            diskCacheTiles.insert(*it);
+            continue;
+        }
+        if (diskCacheFile && cacheStats) {
+            cacheStats->addLookup(statsHolderID, eCacheTierDiskCacheNode, false);
+        }
+        if (hasAllChannels) {
+            compressedTiles.insert(*it);
+            continue;
+        }
+        if (compressedStorage && cacheStats) {
+            cacheStats->addLookup(statsHolderID, eCacheTierCompressedTiles, false);
+        }
+        if (hasAllChannelsInArchives) {
+            archiveTiles.insert(*it);
+            continue;
+        }
+        if (importedTiles && cacheStats) {
+            cacheStats->addLookup(statsHolderID, eCacheTierImportedTiles, false);
+        }
+        if (remoteCache) {
+            remoteTiles.insert(*it);
+            for (int c = 0; c < nComps; ++c) {
+                remoteHashes.push_back(channelHashes[c].index);
+            }
+        }
+    }
+    if (remoteCache) {
+        remoteCache->prefetchTiles(remoteHashes, tileSizeBytes);
+    }
+
+    // The tiles found and their decompressed channels
+    TilesSet tilesToRestore;
+    std::vector<boost::shared_ptr<TileData> > tilesToCopy;
+    std::vector<boost::shared_ptr<std::vector<char> > > buffers;
+
+    const CacheTierEnum tiers[4] = {eCacheTierDiskCacheNode, eCacheTierCompressedTiles, eCacheTierImportedTiles, eCacheTierRemoteTiles};
+    const TilesSet* tiersTiles[4] = {&diskCacheTiles, &compressedTiles, &archiveTiles, &remoteTiles};
+    for (int tier_i = 0; tier_i < 4; ++tier_i) {
+        const CacheTierEnum tier = tiers[tier_i];
+        const bool isRemote = tier == eCacheTierRemoteTiles;
+        const TilesSet& tiles = *tiersTiles[tier_i];
+        if ( tiles.empty() ) {
+            continue;
+        }
+        if (isRemote) {
+            remoteCache->waitForTiles(remoteHashes, NATRON_REMOTE_TILE_CACHE_FETCH_TIMEOUT_MS);
+        }
+        for (TilesSet::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+            TileState* localTileState = localTilesState.getTileAt(it->tx, it->ty);
+
+            boost::shared_ptr<std::vector<char> > buffer( new std::vector<char>(nComps * tileSizeBytes) );
+            std::vector<boost::shared_ptr<TileData> > channelTasks(nComps);
+            bool hasAllChannels = true;
+            for (int c = 0; c < nComps; ++c) {
+                U64 channelHash = CacheBase::makeTileCacheIndex(localTileState->bounds.x1, localTileState->bounds.y1, mipMapLevel, c, entryHash).index;
+                channelTasks[c].reset(new TileData);
+                channelTasks[c]->ptr = &(*buffer)[c * tileSizeBytes];
+                channelTasks[c]->bounds = localTileState->bounds;
+                channelTasks[c]->channel_i = c;
+                bool gotChannel;
+                switch (tier) {
+                    case eCacheTierDiskCacheNode:
+                        gotChannel = diskCacheFile->readTile(channelHash, channelTasks[c]->ptr, tileSizeBytes);
+                        break;
+                    case eCacheTierImportedTiles:
+                        gotChannel = importedTiles->readTile(channelHash, channelTasks[c]->ptr, tileSizeBytes);
+                        break;
+                    case eCacheTierRemoteTiles:
+                        gotChannel = remoteCache->retrieveTile(channelHash, channelTasks[c]->ptr, tileSizeBytes);
+                        break;
+                    default:
+                        gotChannel = compressedStorage->retrieveTile(channelHash, channelTasks[c]->ptr, tileSizeBytes);
+                        break;
+                }
+                if (!gotChannel) {
+                    hasAllChannels = false;
+                    if (!isRemote) {
+                        break;
+                    }
+                    // Retrieve the other channels anyway so that they do not linger in the remote cache
+                }
+            }
+            if (cacheStats) {
+                cacheStats->addLookup(statsHolderID, tier, hasAllChannels);
+            }
+            if (!hasAllChannels) {
+                // Another thread took a channel in the meantime or the remote cache does not have the tile: it will be rendered
+                continue;
+            }
+            buffers.push_back(buffer);
+            tilesToCopy.insert( tilesToCopy.end(), channelTasks.begin(), channelTasks.end() );
+            tilesToRestore.insert(*it);
+        }
+    }
+
+    if ( tilesToRestore.empty() ) {
+        return eActionStatusOK;
+    }
+
+    // Copy the decompressed tiles to our local buffers
+    image.lock()->ensureBuffersAllocated();
+
+    EffectInstancePtr renderClone = effect.lock();
+    boost::scoped_ptr<CachePixelsTransferProcessorBase> processor;
+    switch (bitdepth) {
+        case eImageBitDepthByte:
+            processor.reset(new CachePixelsTransferProcessor<false /*copyToCache*/, unsigned char>(renderClone));
+            break;
+        case eImageBitDepthShort:
+        case eImageBitDepthHalf:
+            // Half pixels are transferred as they are
+            processor.reset(new CachePixelsTransferProcessor<false /*copyToCache*/, unsigned short>(renderClone));
+            break;
+        case eImageBitDepthFloat:
+            processor.reset(new CachePixelsTransferProcessor<false /*copyToCache*/, float>(renderClone));
+            break;
+        default:
+            return eActionStatusOK;
+    }
+
+    processor->setValues(this, tilesToCopy);
+    ActionRetCodeEnum stat = processor->launchThreadsBlocking();
+    if ( isFailureRetCode(stat) ) {
+        return stat;
+    }
+
+    // The tiles were rendered at full quality, otherwise they would not have been preserved on eviction, published or exported.
+    // This copies them back to the cache. They are not published again: they were published by whoever rendered them.
+    markCacheTilesAsRenderedInternal(tilesToRestore, false /*isDraft*/, false /*publishToRemoteCache*/);
+
+    return eActionStatusOK;
+} // restoreEvictedTiles
 
 bool
 ImageCacheEntry::waitForPendingTiles()
@@ -2462,38 +2837,63 @@ ImageCacheEntry::waitForPendingTiles()
     // and reserve it back when done waiting.
     RELEASE_THREAD_RAII();
 
+    TraceSpan_RAII traceSpan(eTraceCategoryWait, "Wait for pending tiles");
+    if ( traceSpan.isRecording() ) {
+        EffectInstancePtr effect = _imp->effect.lock();
+        if (effect) {
+            traceSpan.setDetail( effect->getScriptName_mt_safe() );
+        }
+    }
+
     std::size_t timeSpentWaitingForPendingEntryMS = 0;
     std::size_t timeToWaitMS = 40;
 
+    EffectInstancePtr effect = _imp->effect.lock();
+
+    double monitorStartTime = ThreadPoolMonitor::onPendingTilesWaitStarted();
 
     bool hasUnrenderedTile;
     bool hasPendingResults;
+    bool aborted = false;
 
     do {
         hasUnrenderedTile = false;
         hasPendingResults = false;
         ActionRetCodeEnum stat = fetchCachedTilesAndUpdateStatus(false, NULL, &hasUnrenderedTile, &hasPendingResults);
         if (isFailureRetCode(stat)) {
+            ThreadPoolMonitor::onPendingTilesWaitFinished(monitorStartTime);
             return true;
         }
 
         if (hasPendingResults) {
 
-            timeSpentWaitingForPendingEntryMS += timeToWaitMS;
-            CacheEntryLockerBase::sleep_milliseconds(timeToWaitMS);
+            // Sleep by small slices so that an abort is noticed quickly even when the time to wait has grown
+            std::size_t timeSleptMS = 0;
+            while (timeSleptMS < timeToWaitMS) {
+                aborted = effect && effect->isRenderAborted();
+                if (aborted) {
+                    break;
+                }
+                std::size_t sliceMS = std::min(timeToWaitMS - timeSleptMS, (std::size_t)NATRON_PENDING_TILES_ABORT_CHECK_INTERVAL_MS);
+                CacheEntryLockerBase::sleep_milliseconds(sliceMS);
+                timeSleptMS += sliceMS;
+            }
+            timeSpentWaitingForPendingEntryMS += timeSleptMS;
 
             // Increase the time to wait at the next iteration
-            timeToWaitMS *= 1.2;
+            timeToWaitMS = std::min( (std::size_t)(timeToWaitMS * 1.2), (std::size_t)NATRON_PENDING_TILES_MAX_POLL_INTERVAL_MS );
 
 
         }
 #ifdef DEBUG
-        if (timeSpentWaitingForPendingEntryMS > 5000) {
-            qDebug() << "WARNING:" << _imp->effect.lock()->getScriptName_mt_safe().c_str() << "stuck in waitForPendingTiles() for more than " << Timer::printAsTime(timeSpentWaitingForPendingEntryMS / 1000, false);
+        if (effect && timeSpentWaitingForPendingEntryMS > 5000) {
+            qDebug() << "WARNING:" << effect->getScriptName_mt_safe().c_str() << "stuck in waitForPendingTiles() for more than " << Timer::printAsTime(timeSpentWaitingForPendingEntryMS / 1000, false);
         }
 #endif
 
-    } while(hasPendingResults && !hasUnrenderedTile && !_imp->effect.lock()->isRenderAborted());
+    } while(hasPendingResults && !hasUnrenderedTile && !aborted && !(effect && effect->isRenderAborted()));
+
+    ThreadPoolMonitor::onPendingTilesWaitFinished(monitorStartTime);
 
 #if defined(TRACE_TILES_STATUS) || defined(TRACE_TILES_STATUS_SHORT)
     _imp->writeDebugStatus("waitForPendingTiles", false);
@@ -28,16 +28,26 @@
 
 #include "Global/Macros.h"
 
+#include <algorithm>
+
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/type_traits/is_same.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 
 #include "Engine/EngineFwd.h"
+#include "Engine/Half.h"
 #include "Engine/RectI.h"
 #include "Global/GlobalDefines.h"
 
+// SSE2 is always available on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_IMAGE_CACHE_ENTRY_PROCESSING_SSE2
+#include <emmintrin.h>
+#endif
+
 NATRON_NAMESPACE_ENTER
 
 class ImageCacheEntryProcessing
@@ -47,6 +57,87 @@ public:
     ImageCacheEntryProcessing();
 
 
+#ifdef NATRON_IMAGE_CACHE_ENTRY_PROCESSING_SSE2
+/**
+ * @brief Extract a channel of a packed RGBA float scan-line, 4 pixels at a time. The stores must not touch the other
+ * channels since they may be written concurrently by other threads, but the loads can read whole pixels.
+ **/
+static void copyChannelFromRGBAFloat(const float* src_pixels,
+                                     float* dst_pixels,
+                                     int width)
+{
+    int x = 0;
+    // The last pixel is left to the scalar loop: the loads of a channel other than the first one read the next pixel
+    for (; x + 4 < width; x += 4) {
+        __m128 p0 = _mm_loadu_ps(src_pixels + x * 4);
+        __m128 p1 = _mm_loadu_ps(src_pixels + x * 4 + 4);
+        __m128 p2 = _mm_loadu_ps(src_pixels + x * 4 + 8);
+        __m128 p3 = _mm_loadu_ps(src_pixels + x * 4 + 12);
+        _mm_storeu_ps( dst_pixels + x, _mm_movelh_ps( _mm_unpacklo_ps(p0, p1), _mm_unpacklo_ps(p2, p3) ) );
+    }
+    for (; x < width; ++x) {
+        dst_pixels[x] = src_pixels[x * 4];
+    }
+}
+#endif
+
+/**
+ * @brief Copy a strided channel to another one, the strides being known at compile time.
+ * This is used to transfer a channel between a planar tile of the cache and a packed image.
+ **/
+template <typename PIX, int srcXStride, int dstXStride>
+static void copyPixelsForStrides(const RectI& renderWindow,
+                                 const PIX* srcPixelsData,
+                                 int srcYStride,
+                                 PIX* dstPixelsData,
+                                 int dstYStride)
+{
+    const int width = renderWindow.width();
+    const PIX* src_pixels = srcPixelsData;
+    PIX* dst_pixels = dstPixelsData;
+    for (int y = renderWindow.y1; y < renderWindow.y2; ++y,
+         src_pixels += srcYStride,
+         dst_pixels += dstYStride) {
+#ifdef NATRON_IMAGE_CACHE_ENTRY_PROCESSING_SSE2
+        if (srcXStride == 4 && dstXStride == 1 && boost::is_same<PIX, float>::value) {
+            copyChannelFromRGBAFloat( (const float*)src_pixels, (float*)dst_pixels, width );
+            continue;
+        }
+#endif
+        for (int x = 0; x < width; ++x) {
+            assert( !(boost::math::isnan)(src_pixels[x * srcXStride]) ); // NaN check
+            dst_pixels[x * dstXStride] = src_pixels[x * srcXStride];
+        }
+    }
+} // copyPixelsForStrides
+
+template <typename PIX, int srcXStride>
+static void copyPixelsForSrcStride(const RectI& renderWindow,
+                                   const PIX* srcPixelsData,
+                                   int srcYStride,
+                                   PIX* dstPixelsData,
+                                   int dstXStride,
+                                   int dstYStride)
+{
+    switch (dstXStride) {
+        case 1:
+            copyPixelsForStrides<PIX, srcXStride, 1>(renderWindow, srcPixelsData, srcYStride, dstPixelsData, dstYStride);
+            break;
+        case 2:
+            copyPixelsForStrides<PIX, srcXStride, 2>(renderWindow, srcPixelsData, srcYStride, dstPixelsData, dstYStride);
+            break;
+        case 3:
+            copyPixelsForStrides<PIX, srcXStride, 3>(renderWindow, srcPixelsData, srcYStride, dstPixelsData, dstYStride);
+            break;
+        case 4:
+            copyPixelsForStrides<PIX, srcXStride, 4>(renderWindow, srcPixelsData, srcYStride, dstPixelsData, dstYStride);
+            break;
+        default:
+            assert(false);
+            break;
+    }
+}
+
 template <typename PIX>
 static void copyPixelsForDepth(const RectI& renderWindow,
                         const PIX* srcPixelsData,
@@ -60,29 +151,40 @@ static void copyPixelsForDepth(const RectI& renderWindow,
     PIX* dst_pixels = dstPixelsData;
 
     if (srcXStride == 1 && srcXStride == dstXStride) {
-        for (int y = renderWindow.y1; y < renderWindow.y2; ++y,
+        // If the scan-lines are contiguous in both buffers, e.g: a full tile copied to a planar image of the same width,
+        // a single memcpy is needed
+        const bool contiguous = srcYStride == renderWindow.width() && dstYStride == renderWindow.width();
+        const int nRows = contiguous ? 1 : renderWindow.height();
+        const std::size_t nBytesPerRow = renderWindow.width() * (contiguous ? renderWindow.height() : 1) * sizeof(PIX);
+        for (int y = 0; y < nRows; ++y,
              src_pixels += srcYStride,
              dst_pixels += dstYStride) {
 
-            memcpy(dst_pixels, src_pixels, renderWindow.width() * sizeof(PIX));
+            memcpy(dst_pixels, src_pixels, nBytesPerRow);
 #ifdef DEBUG
             const PIX* p = src_pixels;
-            for (int x = renderWindow.x1; x < renderWindow.x2; ++x, p += srcXStride) {
+            for (std::size_t i = 0; i < nBytesPerRow / sizeof(PIX); ++i, ++p) {
                 assert( !(boost::math::isnan)(*p) ); // NaN check
             }
 #endif
         }
     } else {
-        for (int y = renderWindow.y1; y < renderWindow.y2; ++y) {
-            for (int x = renderWindow.x1; x < renderWindow.x2; ++x,
-                 src_pixels += srcXStride,
-                 dst_pixels += dstXStride) {
-                assert( !(boost::math::isnan)(*src_pixels) ); // NaN check
-                *dst_pixels = *src_pixels;
-            }
-
-            dst_pixels += (dstYStride - renderWindow.width() * dstXStride);
-            src_pixels += (srcYStride - renderWindow.width() * srcXStride);
+        switch (srcXStride) {
+            case 1:
+                copyPixelsForSrcStride<PIX, 1>(renderWindow, srcPixelsData, srcYStride, dstPixelsData, dstXStride, dstYStride);
+                break;
+            case 2:
+                copyPixelsForSrcStride<PIX, 2>(renderWindow, srcPixelsData, srcYStride, dstPixelsData, dstXStride, dstYStride);
+                break;
+            case 3:
+                copyPixelsForSrcStride<PIX, 3>(renderWindow, srcPixelsData, srcYStride, dstPixelsData, dstXStride, dstYStride);
+                break;
+            case 4:
+                copyPixelsForSrcStride<PIX, 4>(renderWindow, srcPixelsData, srcYStride, dstPixelsData, dstXStride, dstYStride);
+                break;
+            default:
+                assert(false);
+                break;
         }
     }
 } // copyPixelsForDepth
@@ -101,6 +203,8 @@ static void copyPixels(const RectI& renderWindow,
             copyPixelsForDepth<char>(renderWindow, (const char*)srcPixelsData, srcXStride, srcYStride, (char*)dstPixelsData, dstXStride, dstYStride);
             break;
         case eImageBitDepthShort:
+        case eImageBitDepthHalf:
+            // Half pixels are copied as they are
             copyPixelsForDepth<unsigned short>(renderWindow, (const unsigned short*)srcPixelsData, srcXStride, srcYStride, (unsigned short*)dstPixelsData, dstXStride, dstYStride);
             break;
         case eImageBitDepthFloat:
@@ -295,6 +399,7 @@ static void repeatEdges(ImageBitDepthEnum depth,
             repeatEdgesForDepth<char>((char*)ptr, bounds, tileSizeX, tileSizeY);
             break;
         case eImageBitDepthShort:
+        case eImageBitDepthHalf:
             repeatEdgesForDepth<unsigned short>((unsigned short*)ptr, bounds, tileSizeX, tileSizeY);
             break;
         case eImageBitDepthFloat:
@@ -307,6 +412,141 @@ static void repeatEdges(ImageBitDepthEnum depth,
 
 
 
+#ifdef NATRON_IMAGE_CACHE_ENTRY_PROCESSING_SSE2
+/**
+ * @brief Halve 2 scan-lines of a planar tile, 16 bytes at a time.
+ * Returns the number of destination pixels processed, the remaining ones are left to the scalar loop.
+ * This gives the same result as the scalar code: the sum of 4 bytes fits in 16 bits and the division is truncated.
+ **/
+static int downscaleRowSSE2(const unsigned char* src_pixels,
+                            const unsigned char* src_pixels_next,
+                            unsigned char* dst_pixels,
+                            int width)
+{
+    const __m128i lowMask = _mm_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i a0 = _mm_loadu_si128( (const __m128i*)(src_pixels + x * 2) );
+        __m128i a1 = _mm_loadu_si128( (const __m128i*)(src_pixels + x * 2 + 16) );
+        __m128i b0 = _mm_loadu_si128( (const __m128i*)(src_pixels_next + x * 2) );
+        __m128i b1 = _mm_loadu_si128( (const __m128i*)(src_pixels_next + x * 2 + 16) );
+        __m128i sum0 = _mm_add_epi16( _mm_add_epi16( _mm_and_si128(a0, lowMask), _mm_srli_epi16(a0, 8) ),
+                                      _mm_add_epi16( _mm_and_si128(b0, lowMask), _mm_srli_epi16(b0, 8) ) );
+        __m128i sum1 = _mm_add_epi16( _mm_add_epi16( _mm_and_si128(a1, lowMask), _mm_srli_epi16(a1, 8) ),
+                                      _mm_add_epi16( _mm_and_si128(b1, lowMask), _mm_srli_epi16(b1, 8) ) );
+        _mm_storeu_si128( (__m128i*)(dst_pixels + x), _mm_packus_epi16( _mm_srli_epi16(sum0, 2), _mm_srli_epi16(sum1, 2) ) );
+    }
+    return x;
+}
+
+/**
+ * @brief Same as above for 16 bit tiles, 8 pixels at a time. The sums are done in 32 bits.
+ * SSE2 has no unsigned 32 to 16 bits saturated pack, so the values are offset in the signed range before packing.
+ **/
+static int downscaleRowSSE2(const unsigned short* src_pixels,
+                            const unsigned short* src_pixels_next,
+                            unsigned short* dst_pixels,
+                            int width)
+{
+    const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+    const __m128i offset32 = _mm_set1_epi32(0x8000);
+    const __m128i offset16 = _mm_set1_epi16( (short)0x8000 );
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i a0 = _mm_loadu_si128( (const __m128i*)(src_pixels + x * 2) );
+        __m128i a1 = _mm_loadu_si128( (const __m128i*)(src_pixels + x * 2 + 8) );
+        __m128i b0 = _mm_loadu_si128( (const __m128i*)(src_pixels_next + x * 2) );
+        __m128i b1 = _mm_loadu_si128( (const __m128i*)(src_pixels_next + x * 2 + 8) );
+        __m128i sum0 = _mm_add_epi32( _mm_add_epi32( _mm_and_si128(a0, lowMask), _mm_srli_epi32(a0, 16) ),
+                                      _mm_add_epi32( _mm_and_si128(b0, lowMask), _mm_srli_epi32(b0, 16) ) );
+        __m128i sum1 = _mm_add_epi32( _mm_add_epi32( _mm_and_si128(a1, lowMask), _mm_srli_epi32(a1, 16) ),
+                                      _mm_add_epi32( _mm_and_si128(b1, lowMask), _mm_srli_epi32(b1, 16) ) );
+        sum0 = _mm_sub_epi32(_mm_srli_epi32(sum0, 2), offset32);
+        sum1 = _mm_sub_epi32(_mm_srli_epi32(sum1, 2), offset32);
+        _mm_storeu_si128( (__m128i*)(dst_pixels + x), _mm_xor_si128(_mm_packs_epi32(sum0, sum1), offset16) );
+    }
+    return x;
+}
+
+/**
+ * @brief Same as above for float tiles, 4 pixels at a time. The scalar code sums in double precision,
+ * so do we: the result is identical.
+ **/
+static int downscaleRowSSE2(const float* src_pixels,
+                            const float* src_pixels_next,
+                            float* dst_pixels,
+                            int width)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128 a0 = _mm_loadu_ps(src_pixels + x * 2);
+        __m128 a1 = _mm_loadu_ps(src_pixels + x * 2 + 4);
+        __m128 b0 = _mm_loadu_ps(src_pixels_next + x * 2);
+        __m128 b1 = _mm_loadu_ps(src_pixels_next + x * 2 + 4);
+        __m128 aEven = _mm_shuffle_ps( a0, a1, _MM_SHUFFLE(2, 0, 2, 0) );
+        __m128 aOdd = _mm_shuffle_ps( a0, a1, _MM_SHUFFLE(3, 1, 3, 1) );
+        __m128 bEven = _mm_shuffle_ps( b0, b1, _MM_SHUFFLE(2, 0, 2, 0) );
+        __m128 bOdd = _mm_shuffle_ps( b0, b1, _MM_SHUFFLE(3, 1, 3, 1) );
+
+        __m128d sumLo = _mm_add_pd( _mm_add_pd( _mm_cvtps_pd(aEven), _mm_cvtps_pd(aOdd) ),
+                                    _mm_add_pd( _mm_cvtps_pd(bEven), _mm_cvtps_pd(bOdd) ) );
+        __m128d sumHi = _mm_add_pd( _mm_add_pd( _mm_cvtps_pd( _mm_movehl_ps(aEven, aEven) ), _mm_cvtps_pd( _mm_movehl_ps(aOdd, aOdd) ) ),
+                                    _mm_add_pd( _mm_cvtps_pd( _mm_movehl_ps(bEven, bEven) ), _mm_cvtps_pd( _mm_movehl_ps(bOdd, bOdd) ) ) );
+        __m128 lo = _mm_cvtpd_ps( _mm_mul_pd(sumLo, quarter) );
+        __m128 hi = _mm_cvtpd_ps( _mm_mul_pd(sumHi, quarter) );
+        _mm_storeu_ps( dst_pixels + x, _mm_movelh_ps(lo, hi) );
+    }
+    return x;
+}
+#endif // NATRON_IMAGE_CACHE_ENTRY_PROCESSING_SSE2
+
+/**
+ * @brief Halve 2 scan-lines of a planar tile into width destination pixels.
+ **/
+template <typename PIX>
+static void downscaleRowForDepth(const PIX* src_pixels,
+                                 const PIX* src_pixels_next,
+                                 PIX* dst_pixels,
+                                 int width)
+{
+    if (boost::is_same<PIX, Half>::value) {
+        // Halve the scan-lines converted to float, a chunk at a time: this is what the scalar loop does, vectorized
+        const int chunkSize = 128;
+        float srcBuf[chunkSize * 2], srcNextBuf[chunkSize * 2], dstBuf[chunkSize];
+        for (int x = 0; x < width; x += chunkSize) {
+            const int count = std::min(chunkSize, width - x);
+            Half::convertRowToFloat( (const Half*)src_pixels + x * 2, srcBuf, count * 2 );
+            Half::convertRowToFloat( (const Half*)src_pixels_next + x * 2, srcNextBuf, count * 2 );
+            downscaleRowForDepth<float>(srcBuf, srcNextBuf, dstBuf, count);
+            Half::convertRowFromFloat( dstBuf, (Half*)dst_pixels + x, count );
+        }
+        return;
+    }
+    int x = 0;
+#ifdef NATRON_IMAGE_CACHE_ENTRY_PROCESSING_SSE2
+    if (boost::is_same<PIX, unsigned char>::value) {
+        x = downscaleRowSSE2( (const unsigned char*)src_pixels, (const unsigned char*)src_pixels_next, (unsigned char*)dst_pixels, width );
+    } else if (boost::is_same<PIX, unsigned short>::value) {
+        x = downscaleRowSSE2( (const unsigned short*)src_pixels, (const unsigned short*)src_pixels_next, (unsigned short*)dst_pixels, width );
+    } else if (boost::is_same<PIX, float>::value) {
+        x = downscaleRowSSE2( (const float*)src_pixels, (const float*)src_pixels_next, (float*)dst_pixels, width );
+    }
+#endif
+    for (; x < width; ++x) {
+
+        assert( !(boost::math::isnan)(src_pixels[x * 2]) ); // NaN check
+        assert( !(boost::math::isnan)(src_pixels[x * 2 + 1]) ); // NaN check
+        assert( !(boost::math::isnan)(src_pixels_next[x * 2]) ); // NaN check
+        assert( !(boost::math::isnan)(src_pixels_next[x * 2 + 1]) ); // NaN check
+
+        double sum = (double)src_pixels[x * 2] + (double)src_pixels[x * 2 + 1];
+        sum += ( (double)src_pixels_next[x * 2] + (double)src_pixels_next[x * 2 + 1] );
+        sum /= 4;
+        dst_pixels[x] = (PIX)sum;
+    }
+} // downscaleRowForDepth
+
 template <typename PIX>
 static void downscaleMipMapForDepth(const PIX* srcTilesPtr[4],
                                     PIX* dstTilePtr,
@@ -356,25 +596,10 @@ static void downscaleMipMapForDepth(const PIX* srcTilesPtr[4],
             const PIX* src_pixels_next = srcTilesPtr[t_i] + tileSizeX;
 
             for (int y = 0; y < halfTileSizeY; ++y) {
-                for (int x = 0; x < halfTileSizeX; ++x) {
-                    
-                    assert( !(boost::math::isnan)(*src_pixels) ); // NaN check
-                    assert( !(boost::math::isnan)(*(src_pixels + 1)) ); // NaN check
-                    assert( !(boost::math::isnan)(*(src_pixels_next)) ); // NaN check
-                    assert( !(boost::math::isnan)(*(src_pixels_next + 1)) ); // NaN check
-
-                    double sum = (double)*src_pixels + (double)*(src_pixels + 1);
-                    sum += ((double)*src_pixels_next + (double)*(src_pixels_next + 1));
-                    sum /= 4;
-                    *dst_pixels = (PIX)sum;
-
-                    src_pixels_next += 2;
-                    src_pixels += 2;
-                    ++dst_pixels;
-                }
-                src_pixels += tileSizeX;
-                src_pixels_next += tileSizeX;
-                dst_pixels += halfTileSizeX;
+                downscaleRowForDepth<PIX>(src_pixels, src_pixels_next, dst_pixels, halfTileSizeX);
+                src_pixels += tileSizeX * 2;
+                src_pixels_next += tileSizeX * 2;
+                dst_pixels += tileSizeX;
             }
         }
     }
@@ -402,6 +627,9 @@ static void downscaleMipMap(ImageBitDepthEnum depth,
         case eImageBitDepthShort:
             downscaleMipMapForDepth<unsigned short>((const unsigned short**)srcTilesPtr, (unsigned short*)dstTilePtr, dstTileBounds, tileSizeX, tileSizeY);
             break;
+        case eImageBitDepthHalf:
+            downscaleMipMapForDepth<Half>((const Half**)srcTilesPtr, (Half*)dstTilePtr, dstTileBounds, tileSizeX, tileSizeY);
+            break;
         case eImageBitDepthFloat:
             downscaleMipMapForDepth<float>((const float**)srcTilesPtr, (float*)dstTilePtr, dstTileBounds, tileSizeX, tileSizeY);
             break;
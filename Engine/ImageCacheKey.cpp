@@ -98,12 +98,10 @@ ImageCacheKey::getUniqueID() const
 void
 ImageCacheKey::appendToHash(Hash64* hash) const
 {
-    std::vector<U64> elements(4);
-    elements[0] = Hash64::toU64(_imp->data.nodeTimeViewVariantHash);
-    elements[1] = Hash64::toU64(_imp->data.layerIDHash);
-    elements[2] = Hash64::toU64(_imp->data.proxyScale.x);
-    elements[3] = Hash64::toU64(_imp->data.proxyScale.y);
-    hash->insert(elements);
+    hash->append(_imp->data.nodeTimeViewVariantHash);
+    hash->append(_imp->data.layerIDHash);
+    hash->append(_imp->data.proxyScale.x);
+    hash->append(_imp->data.proxyScale.y);
 }
 
 
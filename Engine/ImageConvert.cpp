@@ -27,11 +27,13 @@
 
 #include <algorithm> // min, max
 #include <cassert>
+#include <cstring> // for memcpy
 #include <stdexcept>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/type_traits/is_same.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 
@@ -39,8 +41,15 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/AppManager.h"
 #include "Engine/Texture.h"
+#include "Engine/TraceRecorder.h"
 #include "Engine/Lut.h"
 
+// SSE2 is always available on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_IMAGE_CONVERT_SSE2
+#include <emmintrin.h>
+#endif
+
 NATRON_NAMESPACE_ENTER
 
 ///explicit template instantiations
@@ -110,6 +119,377 @@ Image::convertPixelDepth(float pix)
     return pix;
 }
 
+template <>
+Half
+Image::convertPixelDepth(unsigned char pix)
+{
+    return Half( Color::intToFloat<256>(pix) );
+}
+
+template <>
+Half
+Image::convertPixelDepth(unsigned short pix)
+{
+    return Half( Color::intToFloat<65536>(pix) );
+}
+
+template <>
+Half
+Image::convertPixelDepth(float pix)
+{
+    return Half(pix);
+}
+
+template <>
+Half
+Image::convertPixelDepth(Half pix)
+{
+    return pix;
+}
+
+template <>
+unsigned char
+Image::convertPixelDepth(Half pix)
+{
+    return (unsigned char)Color::floatToInt<256>(pix);
+}
+
+template <>
+unsigned short
+Image::convertPixelDepth(Half pix)
+{
+    return (unsigned short)Color::floatToInt<65536>(pix);
+}
+
+template <>
+float
+Image::convertPixelDepth(Half pix)
+{
+    return pix;
+}
+
+/**
+ * @brief Vectorized part of Image::convertPixelDepthRow() for contiguous values. Returns the number of values converted,
+ * the others are converted by the scalar loop. The results must be exactly those of convertPixelDepth().
+ **/
+template <typename SRCPIX, typename DSTPIX>
+static int
+convertPixelDepthSIMD(const SRCPIX* /*src*/,
+                      DSTPIX* /*dst*/,
+                      int /*n*/)
+{
+    return 0;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const unsigned char* src,
+                      unsigned char* dst,
+                      int n)
+{
+    memcpy(dst, src, n * sizeof(unsigned char));
+
+    return n;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const unsigned short* src,
+                      unsigned short* dst,
+                      int n)
+{
+    memcpy(dst, src, n * sizeof(unsigned short));
+
+    return n;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const float* src,
+                      float* dst,
+                      int n)
+{
+    memcpy(dst, src, n * sizeof(float));
+
+    return n;
+}
+
+#ifdef NATRON_IMAGE_CONVERT_SSE2
+
+template <>
+int
+convertPixelDepthSIMD(const unsigned char* src,
+                      float* dst,
+                      int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 maxValue = _mm_set1_ps(255.f);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128( (const __m128i*)(src + i) );
+        __m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+        for (int k = 0; k < 4; ++k) {
+            __m128i dwords = (k % 2) ? _mm_unpackhi_epi16(words[k / 2], zero) : _mm_unpacklo_epi16(words[k / 2], zero);
+            _mm_storeu_ps( dst + i + 4 * k, _mm_div_ps(_mm_cvtepi32_ps(dwords), maxValue) );
+        }
+    }
+
+    return i;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const unsigned short* src,
+                      float* dst,
+                      int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 maxValue = _mm_set1_ps(65535.f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i words = _mm_loadu_si128( (const __m128i*)(src + i) );
+        _mm_storeu_ps( dst + i, _mm_div_ps(_mm_cvtepi32_ps( _mm_unpacklo_epi16(words, zero) ), maxValue) );
+        _mm_storeu_ps( dst + i + 4, _mm_div_ps(_mm_cvtepi32_ps( _mm_unpackhi_epi16(words, zero) ), maxValue) );
+    }
+
+    return i;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const unsigned char* src,
+                      unsigned short* dst,
+                      int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        // (pix << 8) + pix
+        __m128i bytes = _mm_loadu_si128( (const __m128i*)(src + i) );
+        _mm_storeu_si128( (__m128i*)(dst + i), _mm_unpacklo_epi8(bytes, bytes) );
+        _mm_storeu_si128( (__m128i*)(dst + i + 8), _mm_unpackhi_epi8(bytes, bytes) );
+    }
+
+    return i;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const unsigned short* src,
+                      unsigned char* dst,
+                      int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(128);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i ints[4];
+        for (int k = 0; k < 2; ++k) {
+            __m128i words = _mm_loadu_si128( (const __m128i*)(src + i + 8 * k) );
+            // ( (pix + 128) - ( (pix + 128) >> 8 ) ) >> 8, which needs 32 bits
+            __m128i lo = _mm_add_epi32(_mm_unpacklo_epi16(words, zero), half);
+            __m128i hi = _mm_add_epi32(_mm_unpackhi_epi16(words, zero), half);
+            ints[2 * k] = _mm_srli_epi32(_mm_sub_epi32( lo, _mm_srli_epi32(lo, 8) ), 8);
+            ints[2 * k + 1] = _mm_srli_epi32(_mm_sub_epi32( hi, _mm_srli_epi32(hi, 8) ), 8);
+        }
+        _mm_storeu_si128( (__m128i*)(dst + i), _mm_packus_epi16( _mm_packs_epi32(ints[0], ints[1]), _mm_packs_epi32(ints[2], ints[3]) ) );
+    }
+
+    return i;
+}
+
+// Color::floatToInt<numvals>() on 4 floats. NaNs give 0 as with the scalar conversion.
+template <int numvals>
+static inline __m128i
+floatToIntSSE2(__m128 v)
+{
+    __m128i ret = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( v, _mm_set1_ps(numvals - 1) ), _mm_set1_ps(0.5f) ) );
+    __m128i isZero = _mm_castps_si128( _mm_or_ps( _mm_cmple_ps( v, _mm_setzero_ps() ), _mm_cmpunord_ps(v, v) ) );
+    __m128i isMax = _mm_castps_si128( _mm_cmpge_ps( v, _mm_set1_ps(1.f) ) );
+    ret = _mm_andnot_si128(_mm_or_si128(isZero, isMax), ret);
+
+    return _mm_or_si128( ret, _mm_and_si128( isMax, _mm_set1_epi32(numvals - 1) ) );
+}
+
+template <>
+int
+convertPixelDepthSIMD(const float* src,
+                      unsigned char* dst,
+                      int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i ints[4];
+        for (int k = 0; k < 4; ++k) {
+            ints[k] = floatToIntSSE2<256>( _mm_loadu_ps(src + i + 4 * k) );
+        }
+        _mm_storeu_si128( (__m128i*)(dst + i), _mm_packus_epi16( _mm_packs_epi32(ints[0], ints[1]), _mm_packs_epi32(ints[2], ints[3]) ) );
+    }
+
+    return i;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const float* src,
+                      unsigned short* dst,
+                      int n)
+{
+    // There is no unsigned saturated pack from 32 to 16 bits in SSE2: offset the values to pack them as signed values
+    const __m128i offset32 = _mm_set1_epi32(0x8000);
+    const __m128i offset16 = _mm_set1_epi16( (short)0x8000 );
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = _mm_sub_epi32(floatToIntSSE2<65536>( _mm_loadu_ps(src + i) ), offset32);
+        __m128i hi = _mm_sub_epi32(floatToIntSSE2<65536>( _mm_loadu_ps(src + i + 4) ), offset32);
+        _mm_storeu_si128( (__m128i*)(dst + i), _mm_xor_si128(_mm_packs_epi32(lo, hi), offset16) );
+    }
+
+    return i;
+}
+
+#endif // NATRON_IMAGE_CONVERT_SSE2
+
+template <typename SRCPIX, typename DSTPIX>
+void
+Image::convertPixelDepthRow(const SRCPIX* src,
+                            int srcStride,
+                            DSTPIX* dst,
+                            int dstStride,
+                            int n)
+{
+    int i = 0;
+    if (srcStride == 1 && dstStride == 1) {
+        i = convertPixelDepthSIMD<SRCPIX, DSTPIX>(src, dst, n);
+    }
+    for (; i < n; ++i) {
+        assert( !(boost::math::isnan)(src[i * srcStride]) ); // check for NaNs
+        dst[i * dstStride] = convertPixelDepth<SRCPIX, DSTPIX>(src[i * srcStride]);
+    }
+}
+
+template <>
+int
+convertPixelDepthSIMD(const Half* src,
+                      Half* dst,
+                      int n)
+{
+    memcpy(dst, src, n * sizeof(Half));
+
+    return n;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const Half* src,
+                      float* dst,
+                      int n)
+{
+    Half::convertRowToFloat(src, dst, n);
+
+    return n;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const float* src,
+                      Half* dst,
+                      int n)
+{
+    Half::convertRowFromFloat(src, dst, n);
+
+    return n;
+}
+
+/**
+ * @brief Half to and from the integer depths go through float, a chunk at a time, so that both steps are vectorized.
+ **/
+template <typename SRCPIX, typename DSTPIX>
+static int
+convertPixelDepthThroughFloat(const SRCPIX* src,
+                              DSTPIX* dst,
+                              int n)
+{
+    float buf[256];
+    for (int i = 0; i < n; i += 256) {
+        int count = std::min(256, n - i);
+        Image::convertPixelDepthRow<SRCPIX, float>(src + i, 1, buf, 1, count);
+        Image::convertPixelDepthRow<float, DSTPIX>(buf, 1, dst + i, 1, count);
+    }
+
+    return n;
+}
+
+template <>
+int
+convertPixelDepthSIMD(const unsigned char* src,
+                      Half* dst,
+                      int n)
+{
+    return convertPixelDepthThroughFloat(src, dst, n);
+}
+
+template <>
+int
+convertPixelDepthSIMD(const unsigned short* src,
+                      Half* dst,
+                      int n)
+{
+    return convertPixelDepthThroughFloat(src, dst, n);
+}
+
+template <>
+int
+convertPixelDepthSIMD(const Half* src,
+                      unsigned char* dst,
+                      int n)
+{
+    return convertPixelDepthThroughFloat(src, dst, n);
+}
+
+template <>
+int
+convertPixelDepthSIMD(const Half* src,
+                      unsigned short* dst,
+                      int n)
+{
+    return convertPixelDepthThroughFloat(src, dst, n);
+}
+
+template void Image::convertPixelDepthRow<unsigned char, unsigned char>(const unsigned char*, int, unsigned char*, int, int);
+template void Image::convertPixelDepthRow<unsigned char, unsigned short>(const unsigned char*, int, unsigned short*, int, int);
+template void Image::convertPixelDepthRow<unsigned char, float>(const unsigned char*, int, float*, int, int);
+template void Image::convertPixelDepthRow<unsigned short, unsigned char>(const unsigned short*, int, unsigned char*, int, int);
+template void Image::convertPixelDepthRow<unsigned short, unsigned short>(const unsigned short*, int, unsigned short*, int, int);
+template void Image::convertPixelDepthRow<unsigned short, float>(const unsigned short*, int, float*, int, int);
+template void Image::convertPixelDepthRow<float, unsigned char>(const float*, int, unsigned char*, int, int);
+template void Image::convertPixelDepthRow<float, unsigned short>(const float*, int, unsigned short*, int, int);
+template void Image::convertPixelDepthRow<float, float>(const float*, int, float*, int, int);
+template void Image::convertPixelDepthRow<unsigned char, Half>(const unsigned char*, int, Half*, int, int);
+template void Image::convertPixelDepthRow<unsigned short, Half>(const unsigned short*, int, Half*, int, int);
+template void Image::convertPixelDepthRow<float, Half>(const float*, int, Half*, int, int);
+template void Image::convertPixelDepthRow<Half, unsigned char>(const Half*, int, unsigned char*, int, int);
+template void Image::convertPixelDepthRow<Half, unsigned short>(const Half*, int, unsigned short*, int, int);
+template void Image::convertPixelDepthRow<Half, float>(const Half*, int, float*, int, int);
+template void Image::convertPixelDepthRow<Half, Half>(const Half*, int, Half*, int, int);
+
+// Converts a pixel of a float image to linear with the lut
+template <typename PIX>
+static float
+fromColorSpaceToLinearFloat(const Color::Lut* lut,
+                            PIX pix)
+{
+    return lut->fromColorSpaceFloatToLinearFloat(pix);
+}
+
+// Each half value has its own entry in the tables of the lut: this is exact and faster than the function
+template <>
+float
+fromColorSpaceToLinearFloat(const Color::Lut* lut,
+                            Half pix)
+{
+    return lut->fromColorSpaceHalfToLinearFloatFast(pix);
+}
+
 static const Color::Lut*
 lutFromColorspace(ViewerColorSpaceEnum cs)
 {
@@ -165,7 +545,7 @@ convertToFormatInternal_sameComps(const RectI & renderWindow,
             return eActionStatusAborted;
         }
 
-        if (srcMaxValue == dstMaxValue && !srcLut && !dstLut) {
+        if (boost::is_same<SRCPIX, DSTPIX>::value && !srcLut && !dstLut) {
             // Use memcpy when possible
 
             const SRCPIX* srcPixelPtrs[4] = {NULL, NULL, NULL, NULL};
@@ -184,14 +564,14 @@ convertToFormatInternal_sameComps(const RectI & renderWindow,
                     // Ok we are in coplanar mode, copy each channel individually
                     for (int c = 0; c < 4; ++c) {
                         if (srcPixelPtrs[c] && dstPixelPtrs[c]) {
-                            memcpy(dstPixelPtrs[c], srcPixelPtrs[c], nBytesToCopy);
+                            memcpy( (void*)dstPixelPtrs[c], (const void*)srcPixelPtrs[c], nBytesToCopy );
                         }
                     }
                 } else {
                     std::size_t nBytesToCopy = renderWindow.width() * nComp * srcDataSizeOf;
 
                     // In packed RGBA mode or single channel coplanar a single call to memcpy is needed per scan-line
-                    memcpy(dstPixelPtrs[0], srcPixelPtrs[0], nBytesToCopy);
+                    memcpy( (void*)dstPixelPtrs[0], (const void*)srcPixelPtrs[0], nBytesToCopy );
                 }
             } else {
                 // Different strides, copy manually
@@ -200,7 +580,7 @@ convertToFormatInternal_sameComps(const RectI & renderWindow,
                         const SRCPIX* src_pix = srcPixelPtrs[c];
                         DSTPIX* dst_pix = dstPixelPtrs[c];
                         for (int x = renderWindow.x1; x < renderWindow.x2; ++x) {
-                            // They are of the same bitdepth since srcMaxValue == dstMaxValue was checked above
+                            // They are of the same bitdepth since this was checked above
                             assert( !(boost::math::isnan)(*src_pix) ); // check for NaNs
                             *dst_pix = (DSTPIX)*src_pix;
                             src_pix += srcPixelStride;
@@ -210,6 +590,36 @@ convertToFormatInternal_sameComps(const RectI & renderWindow,
                 }
             }
 
+        } else if (!srcLut && !dstLut) {
+            // Only the bit depth changes: there is no error diffusion, convert whole scan-lines
+
+            const SRCPIX* srcPixelPtrs[4] = {NULL, NULL, NULL, NULL};
+            int srcPixelStride;
+            Image::getChannelPointers<SRCPIX>((const SRCPIX**)srcBufPtrs, renderWindow.x1, y, srcBounds, nComp, (SRCPIX**)srcPixelPtrs, &srcPixelStride);
+
+            DSTPIX* dstPixelPtrs[4] = {NULL, NULL, NULL, NULL};
+            int dstPixelStride;
+            Image::getChannelPointers<DSTPIX>((const DSTPIX**)dstBufPtrs, renderWindow.x1, y, dstBounds, nComp, (DSTPIX**)dstPixelPtrs, &dstPixelStride);
+
+            if (srcPixelStride == dstPixelStride && srcPixelStride == nComp && srcPixelPtrs[0] && dstPixelPtrs[0]) {
+                // In packed mode the scan-line is converted at once, whatever the number of components
+                Image::convertPixelDepthRow<SRCPIX, DSTPIX>(srcPixelPtrs[0], 1, dstPixelPtrs[0], 1, renderWindow.width() * nComp);
+            } else {
+                for (int c = 0; c < 4; ++c) {
+                    if (!dstPixelPtrs[c]) {
+                        continue;
+                    }
+                    if (srcPixelPtrs[c]) {
+                        Image::convertPixelDepthRow<SRCPIX, DSTPIX>(srcPixelPtrs[c], srcPixelStride, dstPixelPtrs[c], dstPixelStride, renderWindow.width());
+                    } else {
+                        const DSTPIX zero = Image::convertPixelDepth<SRCPIX, DSTPIX>(0);
+                        DSTPIX* dst_pix = dstPixelPtrs[c];
+                        for (int x = renderWindow.x1; x < renderWindow.x2; ++x, dst_pix += dstPixelStride) {
+                            *dst_pix = zero;
+                        }
+                    }
+                }
+            }
         } else {
             // Start of the line for error diffusion
             // coverity[dont_call]
@@ -262,7 +672,7 @@ convertToFormatInternal_sameComps(const RectI & renderWindow,
                                 } else if (srcMaxValue == 65535) {
                                     pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(sourcePixel);
                                 } else {
-                                    pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(sourcePixel);
+                                    pixFloat = fromColorSpaceToLinearFloat<SRCPIX>(srcLut, sourcePixel);
                                 }
                             } else {
                                 pixFloat = Image::convertPixelDepth<SRCPIX, float>(sourcePixel);
@@ -274,7 +684,7 @@ convertToFormatInternal_sameComps(const RectI & renderWindow,
                                                                 Color::floatToInt<0xff01>(pixFloat) );
                                 pix = error[k] >> 8;
                             } else if (dstMaxValue == 65535) {
-                                pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
+                                pix = dstLut ? (DSTPIX)dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
                                 Image::convertPixelDepth<float, DSTPIX>(pixFloat);
                             } else {
                                 if (dstLut) {
@@ -404,7 +814,7 @@ convertToFormatInternal(const RectI & renderWindow,
 
                     assert(dstPixelPtrs[k]);
 
-                    SRCPIX sourcePixel = srcPixelPtrs[k] ? *srcPixelPtrs[k] : 0;
+                    SRCPIX sourcePixel = srcPixelPtrs[k] ? *srcPixelPtrs[k] : (SRCPIX)0;
 
                     DSTPIX pix;
                     if (!srcLut && !dstLut) {
@@ -432,7 +842,7 @@ convertToFormatInternal(const RectI & renderWindow,
                             } else if (srcMaxValue == 65535) {
                                 pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(sourcePixel);
                             } else {
-                                pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(sourcePixel);
+                                pixFloat = fromColorSpaceToLinearFloat<SRCPIX>(srcLut, sourcePixel);
                             }
                         } else {
                             pixFloat = Image::convertPixelDepth<SRCPIX, float>(sourcePixel);
@@ -445,7 +855,7 @@ convertToFormatInternal(const RectI & renderWindow,
                                                             Color::floatToInt<0xff01>(pixFloat) );
                             pix = error[k] >> 8;
                         } else if (dstMaxValue == 65535) {
-                            pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
+                            pix = dstLut ? (DSTPIX)dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
                             Image::convertPixelDepth<float, DSTPIX>(pixFloat);
                         } else {
                             if (dstLut) {
@@ -555,21 +965,21 @@ convertToMonoImage(const RectI & renderWindow,
         Image::getChannelPointers<DSTPIX, 1>((const DSTPIX**)dstBufPtrs, renderWindow.x1, y, dstBounds, (DSTPIX**)dstPixelPtrs, &dstPixelStride);
 
 
+        if (alphaHandling == Image::eAlphaChannelHandlingFillFromChannel) {
+            assert(conversionChannel >= 0 && conversionChannel < srcNComps);
+            // Only the conversion channel is used
+            Image::convertPixelDepthRow<SRCPIX, DSTPIX>(srcPixelPtrs[conversionChannel], srcPixelStride, dstPixelPtrs[0], dstPixelStride, renderWindow.width());
+            continue;
+        }
         for (int x = renderWindow.x1; x < renderWindow.x2; ++x) {
             switch (alphaHandling) {
                 case Image::eAlphaChannelHandlingCreateFill0:
+                default:
                     pix = 0;
                     break;
                 case Image::eAlphaChannelHandlingCreateFill1:
                     pix = (DSTPIX)dstMaxValue;
                     break;
-                case Image::eAlphaChannelHandlingFillFromChannel:
-                    assert(conversionChannel >= 0 && conversionChannel < srcNComps);
-                    pix = Image::convertPixelDepth<SRCPIX, DSTPIX>(*srcPixelPtrs[conversionChannel]);
-                    // Only increment the conversion channel pointer, this is the only one we use
-                    srcPixelPtrs[conversionChannel] += srcPixelStride;
-                    break;
-                    
             }
             assert( !(boost::math::isnan)(pix) ); // Check for NaNs
             *dstPixelPtrs[0] = pix;
@@ -791,7 +1201,7 @@ convertToFormatInternalForSrcDepth(const RectI & renderWindow,
         case eImageBitDepthShort:
             return convertToFormatInternalForDstDepth<SRCPIX, srcMaxValue, unsigned short, 65535>(renderWindow, srcColorSpace, dstColorSpace, requiresUnpremult, conversionChannel, alphaHandling, monoConversion, srcBufPtrs, srcNComps, srcBounds, dstBufPtrs, dstNComps, dstBounds, renderClone);
         case eImageBitDepthHalf:
-            break;
+            return convertToFormatInternalForDstDepth<SRCPIX, srcMaxValue, Half, 1>(renderWindow, srcColorSpace, dstColorSpace, requiresUnpremult, conversionChannel, alphaHandling, monoConversion, srcBufPtrs, srcNComps, srcBounds, dstBufPtrs, dstNComps, dstBounds, renderClone);
         case eImageBitDepthFloat:
             return convertToFormatInternalForDstDepth<SRCPIX, srcMaxValue, float, 1>(renderWindow, srcColorSpace, dstColorSpace, requiresUnpremult, conversionChannel, alphaHandling, monoConversion, srcBufPtrs, srcNComps, srcBounds, dstBufPtrs, dstNComps, dstBounds, renderClone);
         case eImageBitDepthNone:
@@ -827,7 +1237,7 @@ ImagePrivate::convertCPUImage(const RectI & renderWindow,
         case eImageBitDepthShort:
             return convertToFormatInternalForSrcDepth<unsigned short, 65535>(renderWindow, srcColorSpace, dstColorSpace, requiresUnpremult, conversionChannel, alphaHandling, monoConversion, srcBufPtrs, srcNComps, srcBounds, dstBufPtrs, dstNComps, dstBitDepth, dstBounds, renderClone);
         case eImageBitDepthHalf:
-            break;
+            return convertToFormatInternalForSrcDepth<Half, 1>(renderWindow, srcColorSpace, dstColorSpace, requiresUnpremult, conversionChannel, alphaHandling, monoConversion, srcBufPtrs, srcNComps, srcBounds, dstBufPtrs, dstNComps, dstBitDepth, dstBounds, renderClone);
         case eImageBitDepthFloat:
             return convertToFormatInternalForSrcDepth<float, 1>(renderWindow, srcColorSpace, dstColorSpace, requiresUnpremult, conversionChannel, alphaHandling, monoConversion, srcBufPtrs, srcNComps, srcBounds, dstBufPtrs, dstNComps, dstBitDepth, dstBounds, renderClone);
         case eImageBitDepthNone:
@@ -906,6 +1316,94 @@ ImagePrivate::copyGLTexture(const GLTexturePtr& from,
     }
 }
 
+template <typename GL>
+void
+halveGLTextureInternal(const GLImageStoragePtr& srcTexture,
+                       const GLImageStoragePtr& dstTexture,
+                       const RectI& roi,
+                       const OSGLContextPtr& glContext)
+{
+    int target = srcTexture->getGLTextureTarget();
+    assert(target == dstTexture->getGLTextureTarget());
+
+    GLuint fboID = glContext->getOrCreateFBOId();
+    GL::Disable(GL_SCISSOR_TEST);
+    GL::BindFramebuffer(GL_FRAMEBUFFER, fboID);
+    GL::Enable(target);
+    GL::ActiveTexture(GL_TEXTURE0);
+
+    U32 dstTexID = dstTexture->getGLTextureID();
+    U32 srcTexID = srcTexture->getGLTextureID();
+
+    GL::BindTexture( target, dstTexID );
+    GL::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, dstTexID, 0 /*LoD*/);
+    glCheckFramebufferError(GL);
+
+    // Bilinear filtering at the shared corner of 2x2 src pixels averages them in a single fetch.
+    // On the edges, clamping samples the edge pixel twice, which gives the average of the pixels within the bounds.
+    GL::BindTexture( target, srcTexID );
+
+    GL::TexParameteri (target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    GL::TexParameteri (target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GL::TexParameteri (target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    GL::TexParameteri (target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    GLShaderBasePtr shader = glContext->getOrCreateCopyTexShader();
+    assert(shader);
+    shader->bind();
+    shader->setUniform("srcTex", 0);
+
+    OSGLContext::setupGLViewport<GL>(dstTexture->getBounds(), roi);
+
+    // The dst pixel x covers the src pixels 2x and 2x+1
+    const RectI srcBounds = srcTexture->getBounds();
+    const double srcTexX1 = (2 * roi.x1 - srcBounds.x1) / (double)srcBounds.width();
+    const double srcTexX2 = (2 * roi.x2 - srcBounds.x1) / (double)srcBounds.width();
+    const double srcTexY1 = (2 * roi.y1 - srcBounds.y1) / (double)srcBounds.height();
+    const double srcTexY2 = (2 * roi.y2 - srcBounds.y1) / (double)srcBounds.height();
+
+    GL::Begin(GL_POLYGON);
+    GL::TexCoord2d(srcTexX1, srcTexY1);
+    GL::Vertex2d(roi.x1, roi.y1);
+    GL::TexCoord2d(srcTexX2, srcTexY1);
+    GL::Vertex2d(roi.x2, roi.y1);
+    GL::TexCoord2d(srcTexX2, srcTexY2);
+    GL::Vertex2d(roi.x2, roi.y2);
+    GL::TexCoord2d(srcTexX1, srcTexY2);
+    GL::Vertex2d(roi.x1, roi.y2);
+    GL::End();
+
+    shader->unbind();
+    GL::BindTexture(target, 0);
+
+    glCheckError(GL);
+} // halveGLTextureInternal
+
+void
+ImagePrivate::halveGLTexture(const GLImageStoragePtr& srcTexture,
+                             const GLImageStoragePtr& dstTexture,
+                             const RectI& roi)
+{
+    OSGLContextPtr context = dstTexture->getOpenGLContext();
+    assert(context && srcTexture->getOpenGLContext() == context);
+
+    // Save the current context
+    OSGLContextSaver saveCurrentContext;
+
+    {
+        // Ensure this context is attached
+        OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(context);
+        contextAttacher->attach();
+
+        if (context->isGPUContext()) {
+            halveGLTextureInternal<GL_GPU>(srcTexture, dstTexture, roi, context);
+        } else {
+            halveGLTextureInternal<GL_CPU>(srcTexture, dstTexture, roi, context);
+        }
+    }
+} // halveGLTexture
+
 static void
 copyGLTextureWrapper(const GLImageStoragePtr& from,
               const GLImageStoragePtr& to,
@@ -930,6 +1428,7 @@ convertRGBAPackedCPUBufferToGLTextureInternal(const float* srcData,
                                               const GLTexturePtr& outTexture,
                                               const OSGLContextPtr& glContext)
 {
+    TraceSpan_RAII traceSpan(eTraceCategoryGPU, "Upload to texture");
 
     // The OpenGL context must be current to this thread.
     assert(appPTR->getGPUContextPool()->getThreadLocalContext()->getContext() == glContext);
@@ -1056,8 +1555,11 @@ convertGLTextureToRGBAPackedCPUBufferInternal(const GLTexturePtr& texture,
                                               float* outBuffer,
                                               const RectI& dstBounds,
                                               int dstNComps,
+                                              U32 readbackPBO,
                                               const OSGLContextPtr& glContext)
 {
+    TraceSpan_RAII traceSpan(eTraceCategoryGPU, "Read back texture");
+
     // The OpenGL context must be current to this thread.
     assert(appPTR->getGPUContextPool()->getThreadLocalContext()->getContext() == glContext);
 
@@ -1066,6 +1568,26 @@ convertGLTextureToRGBAPackedCPUBufferInternal(const GLTexturePtr& texture,
     assert(dstBounds == roi);
     assert(dstNComps == 4);
 
+    if (readbackPBO) {
+        // The texture was already read into a pixel pack buffer by startGLTextureReadback(): mapping it
+        // only waits for the end of the transfer if it is not finished yet.
+        assert(roi == texture->getBounds());
+        GL::BindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, readbackPBO);
+        const unsigned char* gpuData = (const unsigned char*)GL::MapBufferARB(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+        glCheckError(GL);
+        if (gpuData) {
+            memcpy( outBuffer, gpuData, (std::size_t)roi.area() * 4 * sizeof(float) );
+            GLboolean result = GL::UnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+            Q_UNUSED(result);
+        }
+        GL::BindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+        glCheckError(GL);
+        if (gpuData) {
+            return eActionStatusOK;
+        }
+        // Fallback on a synchronous read
+    }
+
     GLuint fboID = glContext->getOrCreateFBOId();
 
     int target = texture->getTexTarget();
@@ -1116,9 +1638,9 @@ ImagePrivate::convertGLTextureToRGBAPackedCPUBuffer(const GLTexturePtr& texture,
                                                     const OSGLContextPtr& glContext)
 {
     if (glContext->isGPUContext()) {
-        return convertGLTextureToRGBAPackedCPUBufferInternal<GL_GPU>(texture, roi, outBuffer, dstBounds, dstNComps, glContext);
+        return convertGLTextureToRGBAPackedCPUBufferInternal<GL_GPU>(texture, roi, outBuffer, dstBounds, dstNComps, 0, glContext);
     } else {
-        return convertGLTextureToRGBAPackedCPUBufferInternal<GL_CPU>(texture, roi, outBuffer, dstBounds, dstNComps, glContext);
+        return convertGLTextureToRGBAPackedCPUBufferInternal<GL_CPU>(texture, roi, outBuffer, dstBounds, dstNComps, 0, glContext);
     }
 
 }
@@ -1133,9 +1655,109 @@ convertGLTextureToRGBAPackedCPUBufferWrapper(const GLImageStoragePtr& texture,
 
     // This function only supports reading to a RGBA float buffer.
     assert(outBuffer->getNumComponents() == 4 && outBuffer->getBitDepth() == eImageBitDepthFloat);
+
+    // Use the asynchronous readback of the texture if any, it is consumed by this read
+    const U32 readbackPBO = texture->getPendingReadbackBuffer();
+    if ( readbackPBO && ( roi == texture->getBounds() ) ) {
+        ActionRetCodeEnum stat;
+        if ( glContext->isGPUContext() ) {
+            stat = convertGLTextureToRGBAPackedCPUBufferInternal<GL_GPU>(texture->getTexture(), roi, (float*)outBuffer->getData(), outBuffer->getBounds(), outBuffer->getNumComponents(), readbackPBO, glContext);
+        } else {
+            stat = convertGLTextureToRGBAPackedCPUBufferInternal<GL_CPU>(texture->getTexture(), roi, (float*)outBuffer->getData(), outBuffer->getBounds(), outBuffer->getNumComponents(), readbackPBO, glContext);
+        }
+        ImagePrivate::discardGLTextureReadback(texture);
+        return stat;
+    }
     return ImagePrivate::convertGLTextureToRGBAPackedCPUBuffer(texture->getTexture(), roi, (float*)outBuffer->getData(), outBuffer->getBounds(), outBuffer->getNumComponents(), glContext);
 }
 
+template <typename GL>
+static void
+startGLTextureReadbackInternal(const GLImageStoragePtr& storage,
+                               const OSGLContextPtr& glContext)
+{
+    TraceSpan_RAII traceSpan(eTraceCategoryGPU, "Start texture readback");
+
+    GLTexturePtr texture = storage->getTexture();
+    const RectI texBounds = texture->getBounds();
+    const int target = texture->getTexTarget();
+    const U32 texID = texture->getTexID();
+
+    GLuint pboID = storage->getPendingReadbackBuffer();
+    if (!pboID) {
+        GL::GenBuffers(1, &pboID);
+    }
+
+    GLint currentFBO, currentTex;
+    GL::GetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &currentFBO);
+    GL::GetIntegerv(GL_TEXTURE_BINDING_2D, &currentTex);
+
+    GL::BindFramebuffer( GL_FRAMEBUFFER, glContext->getOrCreateFBOId() );
+    GL::Enable(target);
+    GL::BindTexture(target, texID);
+    GL::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, texID, 0 /*LoD*/);
+    glCheckFramebufferError(GL);
+
+    // With a pixel pack buffer bound, glReadPixels queues the transfer after the drawing commands and returns immediately
+    GL::BindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, pboID);
+    GL::BufferDataARB(GL_PIXEL_PACK_BUFFER_ARB, (std::size_t)texBounds.area() * 4 * sizeof(float), 0, GL_STREAM_READ_ARB);
+    GL::ReadPixels(0, 0, texBounds.width(), texBounds.height(), texture->getFormat(), texture->getGLType(), 0);
+    GL::BindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+    GL::BindTexture(target, currentTex);
+    GL::BindFramebuffer(GL_FRAMEBUFFER, currentFBO);
+
+    // Submit the commands so that the transfer starts without waiting for it
+    GL::Flush();
+    glCheckError(GL);
+
+    storage->setPendingReadbackBuffer(pboID);
+} // startGLTextureReadbackInternal
+
+void
+ImagePrivate::startGLTextureReadback(const GLImageStoragePtr& storage)
+{
+    OSGLContextPtr glContext = storage->getOpenGLContext();
+    if ( !glContext || !storage->getTexture() ) {
+        return;
+    }
+
+    // Save the current context
+    OSGLContextSaver saveCurrentContext;
+    {
+        OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(glContext);
+        contextAttacher->attach();
+        if ( glContext->isGPUContext() ) {
+            startGLTextureReadbackInternal<GL_GPU>(storage, glContext);
+        } else {
+            startGLTextureReadbackInternal<GL_CPU>(storage, glContext);
+        }
+    }
+}
+
+void
+ImagePrivate::discardGLTextureReadback(const GLImageStoragePtr& storage)
+{
+    GLuint pboID = storage->getPendingReadbackBuffer();
+    OSGLContextPtr glContext = storage->getOpenGLContext();
+    if (!pboID || !glContext) {
+        return;
+    }
+
+    // Save the current context
+    OSGLContextSaver saveCurrentContext;
+    {
+        OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(glContext);
+        contextAttacher->attach();
+        if ( glContext->isGPUContext() ) {
+            GL_GPU::DeleteBuffers(1, &pboID);
+        } else {
+            GL_CPU::DeleteBuffers(1, &pboID);
+        }
+    }
+    storage->setPendingReadbackBuffer(0);
+}
+
 
 class CopyPixelsProcessor : public ImageMultiThreadProcessorBase
 {
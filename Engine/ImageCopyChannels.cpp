@@ -25,7 +25,9 @@
 
 #include "ImagePrivate.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
@@ -45,523 +47,192 @@ GCC_DIAG_OFF(unused-parameter)
 GCC_DIAG_OFF(unused-but-set-variable) // only on gcc >= 4.6
 #endif
 
-// NATRON_COPY_CHANNELS_UNPREMULT:
-// Repremult R G and B if output is premult and alpha was modified.
-// We do not consider it a good thing, since the user explicitly deselected the channels, and expects
-// to get the values from input instead.
-//#define NATRON_COPY_CHANNELS_UNPREMULT
-
 NATRON_NAMESPACE_ENTER
 
-template <typename PIX, int maxValue, int srcNComps, int dstNComps, bool doR, bool doG, bool doB, bool doA>
-static ActionRetCodeEnum
-copyUnProcessedChannels_templated(const void* originalImgPtrs[4],
-                                  const RectI& originalImgBounds,
-                                  void* dstImgPtrs[4],
-                                  const RectI& dstBounds,
-                                  const RectI& roi,
-                                  const EffectInstancePtr& renderClone)
+void
+ImagePrivate::makeCopyUnProcessedChannelsPlan(int originalImgNComps,
+                                              bool hasOriginalImg,
+                                              int dstImgNComps,
+                                              const std::bitset<4> processChannels,
+                                              CopyUnProcessedChannelsPlan* plan)
 {
-
-    PIX* dstPixelPtrs[4] = {NULL, NULL, NULL, NULL};
-    int dstPixelStride;
-    Image::getChannelPointers<PIX, dstNComps>((const PIX**)dstImgPtrs, roi.x1, roi.y1, dstBounds, (PIX**)dstPixelPtrs, &dstPixelStride);
-
-    PIX* srcPixelPtrs[4] = {NULL, NULL, NULL, NULL};
-    int srcPixelStride;
-    Image::getChannelPointers<PIX, srcNComps>((const PIX**)originalImgPtrs, roi.x1, roi.y1, originalImgBounds, (PIX**)srcPixelPtrs, &srcPixelStride);
-
-
-    const int dstRowElements = dstPixelStride * dstBounds.width();
-    const int srcRowElements = srcPixelStride * originalImgBounds.width();
-
-    for ( int y = roi.y1; y < roi.y2; ++y) {
-
-        if (renderClone && renderClone->isRenderAborted()) {
-            return eActionStatusAborted;
-        }
-
-        for (int x = roi.x1; x < roi.x2; ++x) {
-
-            // be opaque for anything that doesn't contain alpha
-            PIX srcA;
-            if (srcNComps > 0 && srcPixelPtrs[srcNComps - 1]) {
-                srcA = maxValue;
-            } else {
-                srcA = 0;
-            }
-            if ( srcNComps > 0 && ( (srcNComps == 1) || (srcNComps == 4) ) && srcPixelPtrs[srcNComps - 1] ) {
-                srcA = *srcPixelPtrs[srcNComps - 1];
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(srcA) ); // check for NaN
-#             endif
-            }
-
-#        ifdef NATRON_COPY_CHANNELS_UNPREMULT
-            assert(srcNComps == 1 || srcNComps == 4 || !originalPremult); // only A or RGBA can be premult
-            assert(dstNComps == 1 || dstNComps == 4 || !premult); // only A or RGBA can be premult
-
-            // Repremult R G and B if output is premult and alpha was modified.
-            // We do not consider it a good thing, since the user explicitly deselected the channels, and expects
-            // to get the values from input instead.
-#           define DOCHANNEL(c)                                                    \
-                if (srcNComps == 1 || !src_pixels || c >= srcNComps) {      \
-                    dst_pixels[c] = 0;                                      \
-                } \
-                else if (originalPremult) {                               \
-                    if (srcA == 0) {                                        \
-                        dst_pixels[c] = src_pixels[c];         /* don't try to unpremult, just copy */ \
-                    } \
-                    else if (premult) {                                   \
-                        if (doA) {                                          \
-                            dst_pixels[c] = src_pixels[c];         /* dst will have same alpha as src, just copy src */ \
-                        } \
-                        else {                                            \
-                            dst_pixels[c] = (src_pixels[c] / (float)srcA) * dstAorig;         /* dst keeps its alpha, unpremult src and repremult */ \
-                        }                                                   \
-                    } \
-                    else {                                                \
-                        dst_pixels[c] = (src_pixels[c] / (float)srcA) * maxValue;         /* dst is not premultiplied, unpremult src */ \
-                    }                                                       \
-                } \
-                else {                                                    \
-                    if (premult) {                                          \
-                        if (doA) {                                          \
-                            dst_pixels[c] = (src_pixels[c] * (1.f / maxValue)) * srcA;         /* dst will have same alpha as src, just premult src with its alpha */ \
-                        } \
-                        else {                                            \
-                            dst_pixels[c] = (src_pixels[c] * (1.f / maxValue)) * dstAorig;         /* dst keeps its alpha, premult src with dst's alpha */ \
-                        }                                                   \
-                    } \
-                    else {                                                \
-                        dst_pixels[c] = src_pixels[c];         /* neither src nor dst is not premultiplied */ \
-                    }                                                       \
-                }
-
-            PIX dstAorig = maxValue;
-#         else // !NATRON_COPY_CHANNELS_UNPREMULT
-
-            // Just copy the channels, after all if the user unchecked a channel,
-            // we do not want to change the values behind his back.
-            // Rather we display a warning in  the GUI.
-
-#           define DOCHANNEL(c) *dstPixelPtrs[c] = (c >= srcNComps || !srcPixelPtrs[c]) ? 0 : *srcPixelPtrs[c];
-
-#         endif // !NATRON_COPY_CHANNELS_UNPREMULT
-
-#             ifdef NATRON_COPY_CHANNELS_UNPREMULT
-            if ( (dstNComps == 1) || (dstNComps == 4) ) {
-                dstAorig = *dstPixelPtrs[dstNComps - 1];
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(dstAorig) ); // check for NaN
-#             endif
-            }
-#             endif // NATRON_COPY_CHANNELS_UNPREMULT
-
-            if (doR) {
-#             ifdef DEBUG
-                assert( !srcPixelPtrs[0] || !(boost::math::isnan)(*srcPixelPtrs[0]) ); // check for NaN
-                assert( !(boost::math::isnan)(*dstPixelPtrs[0]) ); // check for NaN
-#             endif
-
-                DOCHANNEL(0);
-
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(*dstPixelPtrs[0]) ); // check for NaN
-#             endif
-            }
-
-            if (doG) {
-#             ifdef DEBUG
-                assert( !srcPixelPtrs[1] || !(boost::math::isnan)(*srcPixelPtrs[1]) ); // check for NaN
-                assert( !(boost::math::isnan)(*dstPixelPtrs[1]) ); // check for NaN
-#             endif
-
-                DOCHANNEL(1);
-
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(*dstPixelPtrs[1]) ); // check for NaN
-#             endif
-            }
-
-            if (doB) {
-#             ifdef DEBUG
-                assert( !srcPixelPtrs[2] || !(boost::math::isnan)(*srcPixelPtrs[2]) ); // check for NaN
-                assert( !(boost::math::isnan)(*dstPixelPtrs[2]) ); // check for NaN
-#             endif
-
-                DOCHANNEL(2);
-
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(*dstPixelPtrs[2]) ); // check for NaN
-#             endif
-            }
-
-            if (doA) {
-
-#             ifdef NATRON_COPY_CHANNELS_UNPREMULT
-                if (premult) {
-                    if (dstAorig != 0) {
-                        // unpremult, then premult
-                        if ( (dstNComps >= 2) && !doR ) {
-                            dst_pixels[0] = (dst_pixels[0] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert( !(boost::math::isnan)(dst_pixels[0]) ); // check for NaN
-#                         endif
-                        }
-                        if ( (dstNComps >= 2) && !doG ) {
-                            dst_pixels[1] = (dst_pixels[1] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert( !(boost::math::isnan)(dst_pixels[1]) ); // check for NaN
-#                         endif
-                        }
-                        if ( (dstNComps >= 2) && !doB ) {
-                            dst_pixels[2] = (dst_pixels[2] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert( !(boost::math::isnan)(dst_pixels[2]) ); // check for NaN
-#                         endif
-                        }
-                    }
-                }
-#             endif // NATRON_COPY_CHANNELS_UNPREMULT
-
-                if ( (dstNComps == 1) || (dstNComps == 4) ) {
-#                 ifdef DEBUG
-                    assert( !(boost::math::isnan)(srcA) ); // check for NaN
-#                 endif
-                    *dstPixelPtrs[dstNComps - 1] = srcA;
-                }
-            } // doA
-
-            // increment pixel pointers
-            for (int c = 0; c < 4; ++c) {
-                if (srcPixelPtrs[c]) {
-                    srcPixelPtrs[c] += srcPixelStride;
-                }
-                if (dstPixelPtrs[c]) {
-                    dstPixelPtrs[c] += dstPixelStride;
-                }
-            }
-
-        } // for each pixel on a scan-line
-
-        // Remove what was done in the iteration and go to the next scan-line
-        for (int c = 0; c < 4; ++c) {
-            if (srcPixelPtrs[c]) {
-                srcPixelPtrs[c] += (srcRowElements - roi.width() * srcPixelStride);
-            }
-            if (dstPixelPtrs[c]) {
-                dstPixelPtrs[c] += (dstRowElements - roi.width() * dstPixelStride);
+    for (int k = 0; k < 4; ++k) {
+        plan->ops[k] = CopyUnProcessedChannelsPlan::eChannelOpKeep;
+        plan->srcChannels[k] = -1;
+    }
+    const bool hasSrc = hasOriginalImg && originalImgNComps > 0;
+
+    // Just copy the channels, after all if the user unchecked a channel,
+    // we do not want to change the values behind his back, e.g: by premultiplying them with the new alpha.
+    // Rather we display a warning in  the GUI.
+    if (dstImgNComps >= 2) {
+        for (int k = 0; k < std::min(dstImgNComps, 3); ++k) {
+            if (processChannels[k]) {
+                continue;
             }
-        }
-        
-    } // for each scan-line
-    return eActionStatusOK;
-} // copyUnProcessedChannels_templated
-
-
-
-template <typename PIX, int maxValue, int srcNComps, int dstNComps>
-static ActionRetCodeEnum
-copyUnProcessedChannels_nonTemplated(const void* originalImgPtrs[4],
-                                     const RectI& originalImgBounds,
-                                     void* dstImgPtrs[4],
-                                     const RectI& dstBounds,
-                                     const std::bitset<4> processChannels,
-                                     const RectI& roi,
-                                     const EffectInstancePtr& renderClone)
-{
-
-    const bool doR = !processChannels[0] && (dstNComps >= 2);
-    const bool doG = !processChannels[1] && (dstNComps >= 2);
-    const bool doB = !processChannels[2] && (dstNComps >= 3);
-    const bool doA = !processChannels[3] && (dstNComps == 1 || dstNComps == 4);
-
-    PIX* dstPixelPtrs[4] = {NULL, NULL, NULL, NULL};
-    int dstPixelStride;
-    Image::getChannelPointers<PIX, dstNComps>((const PIX**)dstImgPtrs, roi.x1, roi.y1, dstBounds, (PIX**)dstPixelPtrs, &dstPixelStride);
-
-    PIX* srcPixelPtrs[4] = {NULL, NULL, NULL, NULL};
-    int srcPixelStride;
-    Image::getChannelPointers<PIX, srcNComps>((const PIX**)originalImgPtrs, roi.x1, roi.y1, originalImgBounds, (PIX**)srcPixelPtrs, &srcPixelStride);
-
-
-    const int dstRowElements = dstPixelStride * dstBounds.width();
-    const int srcRowElements = srcPixelStride * originalImgBounds.width();
-
-
-    for ( int y = roi.y1; y < roi.y2; ++y) {
-
-        if (renderClone && renderClone->isRenderAborted()) {
-            return eActionStatusAborted;
-        }
-
-
-        for (int x = roi.x1; x < roi.x2; ++x) {
-
-            // Be opaque for anything that doesn't contain alpha
-            PIX srcA;
-            if (srcNComps > 0 && srcPixelPtrs[srcNComps - 1]) {
-                srcA = maxValue;
+            if (hasSrc && k < originalImgNComps) {
+                plan->ops[k] = CopyUnProcessedChannelsPlan::eChannelOpCopy;
+                plan->srcChannels[k] = k;
             } else {
-                srcA = 0;
-            }
-
-            if ( ( (srcNComps == 1) || (srcNComps == 4) ) && srcPixelPtrs[3] ) {
-                srcA = *srcPixelPtrs[srcNComps - 1];
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(srcA) ); // check for NaN
-#             endif
-            }
-#         ifdef NATRON_COPY_CHANNELS_UNPREMULT
-            PIX dstAorig = maxValue;
-#         endif
-            if ( (dstNComps == 1) || (dstNComps == 4) ) {
-#             ifdef NATRON_COPY_CHANNELS_UNPREMULT
-                dstAorig = *dst_pixels[dstNComps - 1];
-#              ifdef DEBUG
-                assert( !(boost::math::isnan)(dstAorig) ); // check for NaN
-#              endif
-#             endif
-            }
-            if (doR) {
-#             ifdef DEBUG
-                assert( !srcPixelPtrs[0] || !(boost::math::isnan)(*srcPixelPtrs[0]) ); // check for NaN
-                assert( !(boost::math::isnan)(*dstPixelPtrs[0]) ); // check for NaN
-#             endif
-
-                DOCHANNEL(0);
-
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(*dstPixelPtrs[0]) ); // check for NaN
-#             endif
-            }
-            if (doG) {
-#             ifdef DEBUG
-                assert( !srcPixelPtrs[1] || !(boost::math::isnan)(*srcPixelPtrs[1]) ); // check for NaN
-                assert( !(boost::math::isnan)(*dstPixelPtrs[1]) ); // check for NaN
-#             endif
-
-                DOCHANNEL(1);
-
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(*dstPixelPtrs[1]) ); // check for NaN
-#             endif
-            }
-            if (doB) {
-#             ifdef DEBUG
-                assert( !srcPixelPtrs[2] || !(boost::math::isnan)(*srcPixelPtrs[2]) ); // check for NaN
-                assert( !(boost::math::isnan)(*dstPixelPtrs[2]) ); // check for NaN
-#             endif
-
-                DOCHANNEL(2);
-
-#             ifdef DEBUG
-                assert( !(boost::math::isnan)(*dstPixelPtrs[2]) ); // check for NaN
-#             endif
-            }
-            if (doA) {
-#             ifdef NATRON_COPY_CHANNELS_UNPREMULT
-                if (premult) {
-                    if (dstAorig != 0) {
-                        // unpremult, then premult
-                        if ( (dstNComps >= 2) && !doR ) {
-                            dst_pixels[0] = (dst_pixels[0] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert( !(boost::math::isnan)(dst_pixels[0]) ); // check for NaN
-#                         endif
-                        }
-                        if ( (dstNComps >= 2) && !doG ) {
-                            dst_pixels[1] = (dst_pixels[1] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert( !(boost::math::isnan)(dst_pixels[1]) ); // check for NaN
-#                         endif
-                        }
-                        if ( (dstNComps >= 2) && !doB ) {
-                            dst_pixels[2] = (dst_pixels[2] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert( !(boost::math::isnan)(dst_pixels[2]) ); // check for NaN
-#                         endif
-                        }
-                    }
-                }
-#              endif // NATRON_COPY_CHANNELS_UNPREMULT
-                // coverity[dead_error_line]
-
-#              ifdef DEBUG
-                assert( !(boost::math::isnan)(srcA) ); // check for NaN
-#              endif
-                *dstPixelPtrs[dstNComps - 1] = srcA;
-            } // doA
-
-            // increment pixel pointers
-            for (int c = 0; c < 4; ++c) {
-                if (srcPixelPtrs[c]) {
-                    srcPixelPtrs[c] += srcPixelStride;
-                }
-                if (dstPixelPtrs[c]) {
-                    dstPixelPtrs[c] += dstPixelStride;
-                }
-            }
-        } // for each pixels in a scan-line
-
-        // Remove what was done in the iteration and go to the next scan-line
-        for (int c = 0; c < 4; ++c) {
-            if (srcPixelPtrs[c]) {
-                srcPixelPtrs[c] += (srcRowElements - roi.width() * srcPixelStride);
-            }
-            if (dstPixelPtrs[c]) {
-                dstPixelPtrs[c] += (dstRowElements - roi.width() * dstPixelStride);
+                plan->ops[k] = CopyUnProcessedChannelsPlan::eChannelOpZero;
             }
         }
-    } // for each scan-line
-    return eActionStatusOK;
-} // copyUnProcessedChannels_nonTemplated
-
-
-
-
-template <typename PIX, int maxValue, int srcNComps, int dstNComps>
-static ActionRetCodeEnum
-copyUnProcessedChannelsForDstComponents(const void* originalImgPtrs[4],
-                                        const RectI& originalImgBounds,
-                                        void* dstImgPtrs[4],
-                                        const RectI& dstBounds,
-                                        const std::bitset<4> processChannels,
-                                        const RectI& roi,
-                                        const EffectInstancePtr& renderClone)
+    }
+    if ( !processChannels[3] && (dstImgNComps == 1 || dstImgNComps == 4) ) {
+        const int k = dstImgNComps - 1;
+        if (!hasSrc) {
+            plan->ops[k] = CopyUnProcessedChannelsPlan::eChannelOpZero;
+        } else if (originalImgNComps == 1 || originalImgNComps == 4) {
+            plan->ops[k] = CopyUnProcessedChannelsPlan::eChannelOpCopy;
+            plan->srcChannels[k] = originalImgNComps - 1;
+        } else {
+            // be opaque for anything that doesn't contain alpha
+            plan->ops[k] = CopyUnProcessedChannelsPlan::eChannelOpOne;
+        }
+    }
+} // makeCopyUnProcessedChannelsPlan
+
+template <typename PIX>
+static void
+fillRowForDepth(PIX* dst,
+                int dstPixelStride,
+                PIX value,
+                int n)
 {
-
-    const bool doR = !processChannels[0] && (dstNComps >= 2);
-    const bool doG = !processChannels[1] && (dstNComps >= 2);
-    const bool doB = !processChannels[2] && (dstNComps >= 3);
-    const bool doA = !processChannels[3] && (dstNComps == 1 || dstNComps == 4);
-
-    if (dstNComps == 1) {
-        if (doA) {
-            return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, false, false, false, true>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone);     // RGB were processed, copy A
+    if (n <= 0) {
+        return;
+    }
+    if (dstPixelStride == 1) {
+        if (value == 0) {
+            memset(dst, 0, n * sizeof(PIX));
         } else {
-            return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, false, false, false, false>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone);     // RGBA were processed, only do premult
+            std::fill(dst, dst + n, value);
         }
     } else {
-        assert(2 <= dstNComps && dstNComps <= 4);
-        if (doR) {
-            if (doG) {
-                if ( (dstNComps >= 3) && doB ) {
-                    if ( (dstNComps >= 4) && doA ) {
-                        return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, true, true, true, true>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone); // none were processed, only do premult
-                    } else {
-                        return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, true, true, true, false>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone); // A was processed
-                    }
-                } else {
-                    if ( (dstNComps >= 4) && doA ) {
-                        return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, true, true, false, true>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone); // B was processed
-                    } else {
-                        return copyUnProcessedChannels_nonTemplated<PIX, maxValue, srcNComps, dstNComps>(/*true, true, false, false, */ originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone); // BA were processed (rare)
-                    }
-                }
-            } else {
-                if ( (dstNComps >= 3) && doB ) {
-                    if ( (dstNComps >= 4) && doA ) {
-                        return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, true, false, true, true>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone); // G was processed
-                    } else {
-                        return copyUnProcessedChannels_nonTemplated<PIX, maxValue, srcNComps, dstNComps>(/*true, false, true, false, */ originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone); // GA were processed (rare)
-                    }
-                } else {
-                    //if (dstNComps >= 4 && doA) {
-                    return copyUnProcessedChannels_nonTemplated<PIX, maxValue, srcNComps, dstNComps>(/*true, false, false, true, */ originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone);    // GB were processed (rare)
-                    //} else {
-                    //    copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*true, false, false, false, */processChannels, premult, roi, originalImage, originalPremult, ignorePremult); // GBA were processed (rare)
-                    //}
-                }
-            }
-        } else {
-            if (doG) {
-                if ( (dstNComps >= 3) && doB ) {
-                    if ( (dstNComps >= 4) && doA ) {
-                        return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, false, true, true, true>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone); // R was processed
-                    } else {
-                        return copyUnProcessedChannels_nonTemplated<PIX, maxValue, srcNComps, dstNComps>(/*false, true, true, false, */ originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone); // RA were processed (rare)
-                    }
-                } else {
-                    //if (dstNComps >= 4 && doA) {
-                    return copyUnProcessedChannels_nonTemplated<PIX, maxValue, srcNComps, dstNComps>(/*false, true, false, true, */ originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone);    // RB were processed (rare)
-                    //} else {
-                    //    copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*false, true, false, false, */originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi); // RBA were processed (rare)
-                    //}
-                }
-            } else {
-                if ( (dstNComps >= 3) && doB ) {
-                    //if (dstNComps >= 4 && doA) {
-                    return copyUnProcessedChannels_nonTemplated<PIX, maxValue, srcNComps, dstNComps>(/*false, false, true, true, */originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone);    // RG were processed (rare)
-                    //} else {
-                    //    copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*false, false, true, false, */originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi); // RGA were processed (rare)
-                    //}
+        for (int x = 0; x < n; ++x) {
+            dst[x * dstPixelStride] = value;
+        }
+    }
+}
+
+template <typename PIX, int maxValue>
+static void
+copyUnProcessedChannelsRowForDepth(const ImagePrivate::CopyUnProcessedChannelsPlan& plan,
+                                   const PIX* srcPixelPtrs[4],
+                                   int srcPixelStride,
+                                   int srcOffset,
+                                   int srcWidth,
+                                   PIX* dstPixelPtrs[4],
+                                   int dstPixelStride,
+                                   int width)
+{
+    for (int k = 0; k < 4; ++k) {
+        PIX* dst = dstPixelPtrs[k];
+        switch (plan.ops[k]) {
+            case ImagePrivate::CopyUnProcessedChannelsPlan::eChannelOpKeep:
+                break;
+            case ImagePrivate::CopyUnProcessedChannelsPlan::eChannelOpZero:
+                fillRowForDepth<PIX>(dst, dstPixelStride, 0, width);
+                break;
+            case ImagePrivate::CopyUnProcessedChannelsPlan::eChannelOpCopy:
+            case ImagePrivate::CopyUnProcessedChannelsPlan::eChannelOpOne: {
+                // Pixels outside of the original image are black and transparent
+                fillRowForDepth<PIX>(dst, dstPixelStride, 0, srcOffset);
+                PIX* dstCovered = dst + srcOffset * dstPixelStride;
+                if (plan.ops[k] == ImagePrivate::CopyUnProcessedChannelsPlan::eChannelOpOne) {
+                    fillRowForDepth<PIX>(dstCovered, dstPixelStride, (PIX)maxValue, srcWidth);
                 } else {
-                    if ( (dstNComps >= 4) && doA ) {
-                        return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, false, false, false, true>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone); // RGB were processed
+                    const PIX* src = srcPixelPtrs[plan.srcChannels[k]];
+                    assert(src || srcWidth == 0);
+                    if (srcPixelStride == 1 && dstPixelStride == 1) {
+                        if (srcWidth > 0) {
+                            memcpy(dstCovered, src, srcWidth * sizeof(PIX));
+                        }
                     } else {
-                        return copyUnProcessedChannels_templated<PIX, maxValue, srcNComps, dstNComps, false, false, false, false>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, roi, renderClone); // RGBA were processed
+                        for (int x = 0; x < srcWidth; ++x) {
+                            assert( !(boost::math::isnan)(src[x * srcPixelStride]) ); // check for NaN
+                            dstCovered[x * dstPixelStride] = src[x * srcPixelStride];
+                        }
                     }
                 }
-            }
+                fillRowForDepth<PIX>(dst + (srcOffset + srcWidth) * dstPixelStride, dstPixelStride, 0, width - srcOffset - srcWidth);
+            }   break;
         }
     }
-} // Image::copyUnProcessedChannelsForComponents
+} // copyUnProcessedChannelsRowForDepth
 
-template <typename PIX, int maxValue, int srcNComps>
-static ActionRetCodeEnum
-copyUnProcessedChannelsForSrcComps(const void* originalImgPtrs[4],
-                                   const RectI& originalImgBounds,
-                                   void* dstImgPtrs[4],
-                                   int dstImgNComps,
-                                   const RectI& dstBounds,
-                                   const std::bitset<4> processChannels,
-                                   const RectI& roi,
-                                   const EffectInstancePtr& renderClone)
+void
+ImagePrivate::copyUnProcessedChannelsRow(const CopyUnProcessedChannelsPlan& plan,
+                                         ImageBitDepthEnum bitDepth,
+                                         const void* srcPixelPtrs[4],
+                                         int srcPixelStride,
+                                         int srcOffset,
+                                         int srcWidth,
+                                         void* dstPixelPtrs[4],
+                                         int dstPixelStride,
+                                         int width)
 {
-    switch (dstImgNComps) {
-        case 1:
-            return copyUnProcessedChannelsForDstComponents<PIX, maxValue, srcNComps, 1>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone);
-        case 2:
-            return copyUnProcessedChannelsForDstComponents<PIX, maxValue, srcNComps, 2>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone);
-        case 3:
-            return copyUnProcessedChannelsForDstComponents<PIX, maxValue, srcNComps, 3>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone);
-        case 4:
-            return copyUnProcessedChannelsForDstComponents<PIX, maxValue, srcNComps, 4>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstBounds, processChannels, roi, renderClone);
-        default:
-            return eActionStatusFailed;
+    switch (bitDepth) {
+        case eImageBitDepthByte:
+            copyUnProcessedChannelsRowForDepth<unsigned char, 255>(plan, (const unsigned char**)srcPixelPtrs, srcPixelStride, srcOffset, srcWidth, (unsigned char**)dstPixelPtrs, dstPixelStride, width);
+            break;
+        case eImageBitDepthShort:
+            copyUnProcessedChannelsRowForDepth<unsigned short, 65535>(plan, (const unsigned short**)srcPixelPtrs, srcPixelStride, srcOffset, srcWidth, (unsigned short**)dstPixelPtrs, dstPixelStride, width);
+            break;
+        case eImageBitDepthFloat:
+            copyUnProcessedChannelsRowForDepth<float, 1>(plan, (const float**)srcPixelPtrs, srcPixelStride, srcOffset, srcWidth, (float**)dstPixelPtrs, dstPixelStride, width);
+            break;
+        case eImageBitDepthHalf:
+            copyUnProcessedChannelsRowForDepth<Half, 1>(plan, (const Half**)srcPixelPtrs, srcPixelStride, srcOffset, srcWidth, (Half**)dstPixelPtrs, dstPixelStride, width);
+            break;
+        case eImageBitDepthNone:
+            assert(false);
+            break;
     }
-}
+} // copyUnProcessedChannelsRow
 
-template <typename PIX, int maxValue>
+template <typename PIX>
 static ActionRetCodeEnum
 copyUnProcessedChannelsForDepth(const void* originalImgPtrs[4],
                                 const RectI& originalImgBounds,
                                 int originalImgNComps,
                                 void* dstImgPtrs[4],
+                                ImageBitDepthEnum dstImgBitDepth,
                                 int dstImgNComps,
                                 const RectI& dstBounds,
-                                const std::bitset<4> processChannels,
+                                const ImagePrivate::CopyUnProcessedChannelsPlan& plan,
                                 const RectI& roi,
                                 const EffectInstancePtr& renderClone)
 {
+    for (int y = roi.y1; y < roi.y2; ++y) {
 
-    switch (originalImgNComps) {
-        case 0:
-            return copyUnProcessedChannelsForSrcComps<PIX, maxValue, 0>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstImgNComps, dstBounds, processChannels, roi, renderClone);
-        case 1:
-            return copyUnProcessedChannelsForSrcComps<PIX, maxValue, 1>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstImgNComps, dstBounds, processChannels, roi, renderClone);
-        case 2:
-            return copyUnProcessedChannelsForSrcComps<PIX, maxValue, 2>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstImgNComps, dstBounds, processChannels, roi, renderClone);
-        case 3:
-            return copyUnProcessedChannelsForSrcComps<PIX, maxValue, 3>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstImgNComps, dstBounds, processChannels, roi, renderClone);
-        case 4:
-            return copyUnProcessedChannelsForSrcComps<PIX, maxValue, 4>(originalImgPtrs, originalImgBounds, dstImgPtrs, dstImgNComps,dstBounds, processChannels, roi, renderClone);
-        default:
-            return eActionStatusFailed;
+        if (renderClone && renderClone->isRenderAborted()) {
+            return eActionStatusAborted;
+        }
+
+        PIX* dstPixelPtrs[4];
+        int dstPixelStride;
+        Image::getChannelPointers<PIX>((const PIX**)dstImgPtrs, roi.x1, y, dstBounds, dstImgNComps, dstPixelPtrs, &dstPixelStride);
+
+        // The part of the scan-line covered by the original image: [srcOffset, srcOffset + srcWidth)
+        PIX* srcPixelPtrs[4] = {NULL, NULL, NULL, NULL};
+        int srcPixelStride = 0;
+        int srcOffset = 0;
+        int srcWidth = 0;
+        if (originalImgNComps > 0 && originalImgPtrs[0] && originalImgBounds.y1 <= y && y < originalImgBounds.y2) {
+            const int srcX1 = std::max(roi.x1, originalImgBounds.x1);
+            const int srcX2 = std::min(roi.x2, originalImgBounds.x2);
+            if (srcX1 < srcX2) {
+                srcOffset = srcX1 - roi.x1;
+                srcWidth = srcX2 - srcX1;
+                Image::getChannelPointers<PIX>((const PIX**)originalImgPtrs, srcX1, y, originalImgBounds, originalImgNComps, srcPixelPtrs, &srcPixelStride);
+            }
+        }
+
+        ImagePrivate::copyUnProcessedChannelsRow(plan, dstImgBitDepth, (const void**)srcPixelPtrs, srcPixelStride, srcOffset, srcWidth, (void**)dstPixelPtrs, dstPixelStride, roi.width());
     }
-} // Image::copyUnProcessedChannelsForDepth
+    return eActionStatusOK;
+} // copyUnProcessedChannelsForDepth
 
 ActionRetCodeEnum
 ImagePrivate::copyUnprocessedChannelsCPU(const void* originalImgPtrs[4],
@@ -575,15 +246,19 @@ ImagePrivate::copyUnprocessedChannelsCPU(const void* originalImgPtrs[4],
                                          const RectI& roi,
                                          const EffectInstancePtr& renderClone)
 {
+    // Decide once what to do with each channel, then do it a scan-line at a time
+    CopyUnProcessedChannelsPlan plan;
+    makeCopyUnProcessedChannelsPlan(originalImgNComps, originalImgPtrs[0] != NULL, dstImgNComps, processChannels, &plan);
+
     switch (dstImgBitDepth) {
         case eImageBitDepthByte:
-            return copyUnProcessedChannelsForDepth<unsigned char, 255>(originalImgPtrs, originalImgBounds, originalImgNComps, dstImgPtrs, dstImgNComps, dstBounds, processChannels, roi, renderClone);
+            return copyUnProcessedChannelsForDepth<unsigned char>(originalImgPtrs, originalImgBounds, originalImgNComps, dstImgPtrs, dstImgBitDepth, dstImgNComps, dstBounds, plan, roi, renderClone);
         case eImageBitDepthFloat:
-            return copyUnProcessedChannelsForDepth<float, 1>(originalImgPtrs, originalImgBounds, originalImgNComps, dstImgPtrs, dstImgNComps, dstBounds, processChannels, roi, renderClone);
+            return copyUnProcessedChannelsForDepth<float>(originalImgPtrs, originalImgBounds, originalImgNComps, dstImgPtrs, dstImgBitDepth, dstImgNComps, dstBounds, plan, roi, renderClone);
         case eImageBitDepthShort:
-            return copyUnProcessedChannelsForDepth<unsigned short, 65535>(originalImgPtrs, originalImgBounds, originalImgNComps, dstImgPtrs, dstImgNComps, dstBounds, processChannels, roi, renderClone);
-
+            return copyUnProcessedChannelsForDepth<unsigned short>(originalImgPtrs, originalImgBounds, originalImgNComps, dstImgPtrs, dstImgBitDepth, dstImgNComps, dstBounds, plan, roi, renderClone);
         case eImageBitDepthHalf:
+            return copyUnProcessedChannelsForDepth<Half>(originalImgPtrs, originalImgBounds, originalImgNComps, dstImgPtrs, dstImgBitDepth, dstImgNComps, dstBounds, plan, roi, renderClone);
         case eImageBitDepthNone:
             return eActionStatusFailed;
     }
@@ -591,7 +266,6 @@ ImagePrivate::copyUnprocessedChannelsCPU(const void* originalImgPtrs[4],
 }
 
 
-
 template <typename GL>
 void
 copyUnProcessedChannelsGLInternal(const GLImageStoragePtr& originalTexture,
@@ -23,7 +23,22 @@
 // ***** END PYTHON BLOCK *****
 
 #include "ImagePrivate.h"
+
+#include <algorithm>
+#include <cstring>
+
 #include "Engine/Texture.h"
+
+// SSE2 is always available on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_IMAGE_FILL_SSE2
+#include <emmintrin.h>
+#endif
+
+// Fills writing at least this many bytes in a thread use non-temporal stores: the pixels would not stay in the caches
+// anyway, and this avoids reading the destination cache lines only to overwrite them.
+#define NATRON_IMAGE_FILL_NON_TEMPORAL_THRESHOLD (4 * 1024 * 1024)
+
 NATRON_NAMESPACE_ENTER
 
 template <typename GL>
@@ -99,6 +114,73 @@ ImagePrivate::fillGL(const RectI & roi,
     // th old context will be restored when saveCurrentContext is destroyed
 } // fillGL
 
+/**
+ * @brief Copies nBytes from src to dst, or clears them to 0 if src is NULL.
+ * If nonTemporal is true, the 16-byte aligned part of dst is written with non-temporal stores:
+ * the caller must call endNonTemporalWrites() before the pixels are read by another thread.
+ **/
+static void
+writeRow(void* dst,
+         const void* src,
+         std::size_t nBytes,
+         bool nonTemporal)
+{
+#ifdef NATRON_IMAGE_FILL_SSE2
+    if (nonTemporal) {
+        unsigned char* d = (unsigned char*)dst;
+        const unsigned char* s = (const unsigned char*)src;
+
+        // Write the head with regular stores up to the first aligned address
+        const std::size_t head = std::min( nBytes, (16 - ( (std::size_t)d & 15 ) ) & 15 );
+        if (s) {
+            memcpy(d, s, head);
+            s += head;
+        } else {
+            memset(d, 0, head);
+        }
+        d += head;
+        nBytes -= head;
+
+        const __m128i zero = _mm_setzero_si128();
+        for (; nBytes >= 16; nBytes -= 16, d += 16) {
+            if (s) {
+                _mm_stream_si128( (__m128i*)d, _mm_loadu_si128( (const __m128i*)s ) );
+                s += 16;
+            } else {
+                _mm_stream_si128( (__m128i*)d, zero );
+            }
+        }
+
+        if (s) {
+            memcpy(d, s, nBytes);
+        } else {
+            memset(d, 0, nBytes);
+        }
+        return;
+    }
+#else
+    (void)nonTemporal;
+#endif
+    if (src) {
+        memcpy(dst, src, nBytes);
+    } else {
+        memset(dst, 0, nBytes);
+    }
+} // writeRow
+
+static void
+endNonTemporalWrites(bool nonTemporal)
+{
+#ifdef NATRON_IMAGE_FILL_SSE2
+    // non-temporal stores are weakly ordered
+    if (nonTemporal) {
+        _mm_sfence();
+    }
+#else
+    (void)nonTemporal;
+#endif
+}
+
 template <typename PIX>
 ActionRetCodeEnum
 fillCPUBlackForDepth(void* ptrs[4],
@@ -108,11 +190,13 @@ fillCPUBlackForDepth(void* ptrs[4],
                      const EffectInstancePtr& renderClone)
 {
     int dataSizeOf = sizeof(PIX);
-    
+    const bool nonTemporal = (std::size_t)roi.area() * nComps * dataSizeOf >= NATRON_IMAGE_FILL_NON_TEMPORAL_THRESHOLD;
+
     // memset for each scan-line
     for (int y = roi.y1; y < roi.y2; ++y) {
 
         if (renderClone && renderClone->isRenderAborted()) {
+            endNonTemporalWrites(nonTemporal);
             return eActionStatusAborted;
         }
 
@@ -138,7 +222,14 @@ fillCPUBlackForDepth(void* ptrs[4],
         if (contiguous) {
             // If all channels belong to the same buffer, use memset
             std::size_t rowSize = roi.width() * dstPixelStride * dataSizeOf;
-            memset(dstPixelPtrs[0], 0, rowSize);
+            writeRow(dstPixelPtrs[0], NULL, rowSize, nonTemporal);
+        } else if (dstPixelStride == 1) {
+            // Each channel has its own buffer: memset the scan-line of each of them
+            for (int i = 0; i < 4; ++i) {
+                if (dstPixelPtrs[i]) {
+                    writeRow(dstPixelPtrs[i], NULL, roi.width() * dataSizeOf, nonTemporal);
+                }
+            }
         } else {
             for (int i = 0; i < 4; ++i) {
                 if (dstPixelPtrs[i]) {
@@ -150,6 +241,7 @@ fillCPUBlackForDepth(void* ptrs[4],
         }
 
     }
+    endNonTemporalWrites(nonTemporal);
     return eActionStatusOK;
 }
 
@@ -162,15 +254,26 @@ fillCPUBlack(void* ptrs[4],
              const EffectInstancePtr& renderClone)
 {
     // memset the whole bounds at once if we can.
+    // For large buffers, memset already uses non-temporal stores.
     if (roi == bounds && !ptrs[1]) {
         std::size_t planeSize = nComps * bounds.area() * getSizeOfForBitDepth(bitDepth);
         memset(ptrs[0], 0, planeSize);
+    } else if (roi == bounds) {
+        // One plane per channel
+        std::size_t planeSize = bounds.area() * getSizeOfForBitDepth(bitDepth);
+        for (int c = 0; c < nComps; ++c) {
+            if (ptrs[c]) {
+                memset(ptrs[c], 0, planeSize);
+            }
+        }
     } else {
         switch (bitDepth) {
             case eImageBitDepthByte:
                 return fillCPUBlackForDepth<unsigned char>(ptrs, nComps, bounds, roi, renderClone);
             case eImageBitDepthShort:
                 return fillCPUBlackForDepth<unsigned short>(ptrs, nComps, bounds, roi, renderClone);
+            case eImageBitDepthHalf:
+                return fillCPUBlackForDepth<Half>(ptrs, nComps, bounds, roi, renderClone);
             case eImageBitDepthFloat:
                 return fillCPUBlackForDepth<float>(ptrs, nComps, bounds, roi, renderClone);
             default:
@@ -196,41 +299,83 @@ fillForDepthForComponents(void* ptrs[4],
     const float fillValue[4] = {
         nComps == 1 ? a * maxValue : r * maxValue, g * maxValue, b * maxValue, a * maxValue
     };
-
-    int nCompsPerBuffer = nComps;
-    if (nComps > 1 && ptrs[1]) {
-        nCompsPerBuffer = 1;
+    // Convert once: this is not free for Half
+    PIX fillPixel[4];
+    for (int c = 0; c < 4; ++c) {
+        fillPixel[c] = fillValue[c];
     }
 
+    if ( roi.isNull() ) {
+        return eActionStatusOK;
+    }
 
     // now we're safe: the image contains the area in roi
     PIX* dstPixelPtrs[4] = {NULL, NULL, NULL, NULL};
     int dstPixelStride;
     Image::getChannelPointers<PIX>((const PIX**)ptrs, roi.x1, roi.y1, bounds, nComps, (PIX**)dstPixelPtrs, &dstPixelStride);
 
-    std::size_t nElementsPerRow = nCompsPerBuffer * dstPixelStride;
+    // A scan-line of a buffer has a pixel stride of elements by pixel, in packed or planar mode
+    std::size_t nElementsPerRow = (std::size_t)bounds.width() * dstPixelStride;
 
+    const bool nonTemporal = (std::size_t)roi.area() * nComps * sizeof(PIX) >= NATRON_IMAGE_FILL_NON_TEMPORAL_THRESHOLD;
 
-    for (int y = roi.y1; y < roi.y2; ++y) {
-
-        if (renderClone && renderClone->isRenderAborted()) {
-            return eActionStatusAborted;
+    // In a packed buffer, all the channels of a scan-line are contiguous, otherwise each channel is
+    bool packed = dstPixelStride == nComps && dstPixelPtrs[0];
+    for (int c = 1; c < nComps; ++c) {
+        if (dstPixelPtrs[c] != dstPixelPtrs[0] + c) {
+            packed = false;
         }
+    }
 
+    // Only the first scan-line is filled pixel by pixel.
+    const PIX* firstRowPtrs[4] = {dstPixelPtrs[0], dstPixelPtrs[1], dstPixelPtrs[2], dstPixelPtrs[3]};
+    {
+        PIX* pix[4] = {dstPixelPtrs[0], dstPixelPtrs[1], dstPixelPtrs[2], dstPixelPtrs[3]};
         for (int x = roi.x1; x < roi.x2; ++x) {
             for (int c = 0; c < 4; ++c) {
-                if (dstPixelPtrs[c]) {
-                    *dstPixelPtrs[c] = fillValue[c];
-                    dstPixelPtrs[c] += dstPixelStride;
+                if (pix[c]) {
+                    *pix[c] = fillPixel[c];
+                    pix[c] += dstPixelStride;
                 }
             }
         }
+    }
+
+    // The next scan-lines are copies of the first one
+    for (int y = roi.y1 + 1; y < roi.y2; ++y) {
+
+        if (renderClone && renderClone->isRenderAborted()) {
+            endNonTemporalWrites(nonTemporal);
+            return eActionStatusAborted;
+        }
+
         for (int c = 0; c < 4; ++c) {
             if (dstPixelPtrs[c]) {
-                dstPixelPtrs[c] += nElementsPerRow - roi.width() * dstPixelStride;
+                dstPixelPtrs[c] += nElementsPerRow;
+            }
+        }
+
+        if (packed) {
+            writeRow(dstPixelPtrs[0], firstRowPtrs[0], (std::size_t)roi.width() * nComps * sizeof(PIX), nonTemporal);
+        } else if (dstPixelStride == 1) {
+            for (int c = 0; c < 4; ++c) {
+                if (dstPixelPtrs[c]) {
+                    writeRow(dstPixelPtrs[c], firstRowPtrs[c], (std::size_t)roi.width() * sizeof(PIX), nonTemporal);
+                }
+            }
+        } else {
+            PIX* pix[4] = {dstPixelPtrs[0], dstPixelPtrs[1], dstPixelPtrs[2], dstPixelPtrs[3]};
+            for (int x = roi.x1; x < roi.x2; ++x) {
+                for (int c = 0; c < 4; ++c) {
+                    if (pix[c]) {
+                        *pix[c] = fillPixel[c];
+                        pix[c] += dstPixelStride;
+                    }
+                }
             }
         }
     }
+    endNonTemporalWrites(nonTemporal);
     return eActionStatusOK;
 } // fillForDepthForComponents
 
@@ -287,6 +432,7 @@ ImagePrivate::fillCPU(void* ptrs[4],
         case eImageBitDepthShort:
             return fillForDepth<unsigned short, 65535>(ptrs, r, g, b, a, nComps, bounds, roi, renderClone);
         case eImageBitDepthHalf:
+            return fillForDepth<Half, 1>(ptrs, r, g, b, a, nComps, bounds, roi, renderClone);
         default:
             break;
     }
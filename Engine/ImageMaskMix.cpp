@@ -25,6 +25,21 @@
 
 #include "ImagePrivate.h"
 
+#include <algorithm>
+#include <vector>
+
+#if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <boost/type_traits/is_same.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#endif
+
+// SSE2 is always available on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_IMAGE_MASK_MIX_SSE2
+#include <emmintrin.h>
+#endif
+
 NATRON_NAMESPACE_ENTER
 
 template<int srcNComps, int dstNComps, typename PIX, int maxValue, bool masked, bool maskInvert>
@@ -66,7 +81,7 @@ applyMaskMixForMaskInvert(const void* originalImgPtrs[4],
                 for (int c = 0; c < dstNComps; ++c) {
                     float dstF = Image::convertPixelDepth<PIX, float>(*dstPixelPtrs[c]);
                     float srcF;
-                    if (*srcPixelPtrs[c]) {
+                    if (srcPixelPtrs[c]) {
                         srcF = Image::convertPixelDepth<PIX, float>(*srcPixelPtrs[c]);
                         srcPixelPtrs[c] += srcPixelStride;
                     } else {
@@ -98,7 +113,7 @@ applyMaskMixForMaskInvert(const void* originalImgPtrs[4],
                 for (int c = 0; c < dstNComps; ++c) {
                     float dstF = Image::convertPixelDepth<PIX, float>(*dstPixelPtrs[c]);
                     float srcF;
-                    if (*srcPixelPtrs[c]) {
+                    if (srcPixelPtrs[c]) {
                         srcF = Image::convertPixelDepth<PIX, float>(*srcPixelPtrs[c]);
                         srcPixelPtrs[c] += srcPixelStride;
                     } else {
@@ -176,6 +191,8 @@ applyMaskMixForDstComponents(const void* originalImgPtrs[4],
             return applyMaskMixForDepth<srcNComps, dstNComps, unsigned char, 255>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, mix, invertMask, bounds, roi, renderClone);
         case eImageBitDepthShort:
             return applyMaskMixForDepth<srcNComps, dstNComps, unsigned short, 65535>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, mix, invertMask, bounds, roi, renderClone);
+        case eImageBitDepthHalf:
+            return applyMaskMixForDepth<srcNComps, dstNComps, Half, 1>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, mix, invertMask, bounds, roi, renderClone);
         case eImageBitDepthFloat:
             return applyMaskMixForDepth<srcNComps, dstNComps, float, 1>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, mix, invertMask, bounds, roi, renderClone);
         default:
@@ -244,6 +261,294 @@ ImagePrivate::applyMaskMixCPU(const void* originalImgPtrs[4],
 
 }
 
+/**
+ * @brief Mix n contiguous values with the original image: dst = dst * alpha + (1 - alpha) * src, alpha being given
+ * for each pixel. A NULL src stands for black.
+ * This is the same operation as in applyMaskMixForMaskInvert and gives the same results.
+ **/
+static void
+mixRowPlanar(float* dst,
+             const float* src,
+             const float* alphas,
+             int n)
+{
+    int x = 0;
+#ifdef NATRON_IMAGE_MASK_MIX_SSE2
+    const __m128 one = _mm_set1_ps(1.f);
+    for (; x + 4 <= n; x += 4) {
+        __m128 a = _mm_loadu_ps(alphas + x);
+        __m128 d = _mm_loadu_ps(dst + x);
+        __m128 s = src ? _mm_loadu_ps(src + x) : _mm_setzero_ps();
+        _mm_storeu_ps( dst + x, _mm_add_ps( _mm_mul_ps(d, a), _mm_mul_ps(_mm_sub_ps(one, a), s) ) );
+    }
+#endif
+    for (; x < n; ++x) {
+        float srcF = src ? src[x] : 0.f;
+        dst[x] = dst[x] * alphas[x] + (1.f - alphas[x]) * srcF;
+    }
+}
+
+/**
+ * @brief Same as mixRowPlanar() for n packed RGBA pixels: the 4 channels of a pixel are mixed at once.
+ **/
+static void
+mixRowPackedRGBA(float* dst,
+                 const float* src,
+                 const float* alphas,
+                 int n)
+{
+    int x = 0;
+#ifdef NATRON_IMAGE_MASK_MIX_SSE2
+    const __m128 one = _mm_set1_ps(1.f);
+    for (; x < n; ++x) {
+        __m128 a = _mm_set1_ps(alphas[x]);
+        __m128 d = _mm_loadu_ps(dst + x * 4);
+        __m128 s = src ? _mm_loadu_ps(src + x * 4) : _mm_setzero_ps();
+        _mm_storeu_ps( dst + x * 4, _mm_add_ps( _mm_mul_ps(d, a), _mm_mul_ps(_mm_sub_ps(one, a), s) ) );
+    }
+#endif
+    for (; x < n; ++x) {
+        for (int c = 0; c < 4; ++c) {
+            float srcF = src ? src[x * 4 + c] : 0.f;
+            dst[x * 4 + c] = dst[x * 4 + c] * alphas[x] + (1.f - alphas[x]) * srcF;
+        }
+    }
+}
+
+template<typename PIX, int maxValue, int srcNComps, int dstNComps>
+static ActionRetCodeEnum
+copyUnProcessedChannelsAndMaskMixForComponents(const void* originalImgPtrs[4],
+                                               const RectI& originalImgBounds,
+                                               const void* maskImgPtrs[4],
+                                               const RectI& maskImgBounds,
+                                               void* dstImgPtrs[4],
+                                               const RectI& dstBounds,
+                                               const ImagePrivate::CopyUnProcessedChannelsPlan& plan,
+                                               ImageBitDepthEnum dstBitDepth,
+                                               bool doMix,
+                                               double mix,
+                                               bool maskInvert,
+                                               const RectI& roi,
+                                               const EffectInstancePtr& renderClone)
+{
+    const int width = roi.width();
+    const bool masked = maskImgPtrs[0] != NULL;
+    const bool isFloat = boost::is_same<PIX, float>::value;
+
+    // The scan-line of mix factors, the scan-lines converted to float for the integer formats
+    // and the layouts not handled by the kernels
+    std::vector<float> alphas, dstBuf, srcBuf;
+    if (doMix) {
+        alphas.resize(width, (float)mix);
+        dstBuf.resize(width * 4);
+        srcBuf.resize(width * 4);
+    }
+
+    for (int y = roi.y1; y < roi.y2; ++y) {
+
+        if (renderClone && renderClone->isRenderAborted()) {
+            return eActionStatusAborted;
+        }
+
+        PIX* dstPixelPtrs[4] = {NULL, NULL, NULL, NULL};
+        int dstPixelStride;
+        Image::getChannelPointers<PIX, dstNComps>((const PIX**)dstImgPtrs, roi.x1, y, dstBounds, (PIX**)dstPixelPtrs, &dstPixelStride);
+
+        // The part of the scan-line covered by the original image: [srcOffset, srcOffset + srcWidth)
+        int srcOffset = 0;
+        int srcWidth = 0;
+        PIX* srcPixelPtrs[4] = {NULL, NULL, NULL, NULL};
+        int srcPixelStride = 0;
+        if (srcNComps > 0 && originalImgPtrs[0] && originalImgBounds.y1 <= y && y < originalImgBounds.y2) {
+            const int srcX1 = std::max(roi.x1, originalImgBounds.x1);
+            const int srcX2 = std::min(roi.x2, originalImgBounds.x2);
+            if (srcX1 < srcX2) {
+                srcOffset = srcX1 - roi.x1;
+                srcWidth = srcX2 - srcX1;
+                Image::getChannelPointers<PIX, srcNComps>((const PIX**)originalImgPtrs, srcX1, y, originalImgBounds, (PIX**)srcPixelPtrs, &srcPixelStride);
+            }
+        }
+
+        // Copy the unprocessed channels from the original image
+        ImagePrivate::copyUnProcessedChannelsRow(plan, dstBitDepth, (const void**)srcPixelPtrs, srcPixelStride, srcOffset, srcWidth, (void**)dstPixelPtrs, dstPixelStride, width);
+
+        if (!doMix) {
+            continue;
+        }
+
+        if (masked) {
+            // figure the scale factor from the mask pixels
+            const float outsideMaskScale = maskInvert ? 1.f : 0.f;
+            const float outsideAlpha = mix * outsideMaskScale;
+            int maskX1 = roi.x1, maskX2 = roi.x1;
+            if (maskImgBounds.y1 <= y && y < maskImgBounds.y2) {
+                maskX1 = std::max(roi.x1, maskImgBounds.x1);
+                maskX2 = std::max( maskX1, std::min(roi.x2, maskImgBounds.x2) );
+            }
+            PIX* maskPixelPtrs[4] = {NULL, NULL, NULL, NULL};
+            int maskPixelStride = 0;
+            if (maskX1 < maskX2) {
+                Image::getChannelPointers<PIX, 1>((const PIX**)maskImgPtrs, maskX1, y, maskImgBounds, (PIX**)maskPixelPtrs, &maskPixelStride);
+            }
+            for (int x = roi.x1; x < roi.x2; ++x) {
+                if (x < maskX1 || x >= maskX2) {
+                    alphas[x - roi.x1] = outsideAlpha;
+                } else {
+                    float maskScale = maskPixelPtrs[0][(x - maskX1) * maskPixelStride] * (1.f / maxValue);
+                    if (maskInvert) {
+                        maskScale = 1.f - maskScale;
+                    }
+                    alphas[x - roi.x1] = mix * maskScale;
+                }
+            }
+        }
+
+        if (dstNComps == 4 && dstPixelStride == 4 && (srcWidth == 0 || (srcNComps == 4 && srcPixelStride == 4 && srcWidth == width))) {
+            // Packed RGBA: mix the whole scan-line at once
+            const int nValues = width * 4;
+            if (isFloat) {
+                mixRowPackedRGBA( (float*)dstPixelPtrs[0], srcWidth ? (const float*)srcPixelPtrs[0] : NULL, &alphas[0], width );
+            } else {
+                Image::convertPixelDepthRow<PIX, float>(dstPixelPtrs[0], 1, &dstBuf[0], 1, nValues);
+                if (srcWidth) {
+                    Image::convertPixelDepthRow<PIX, float>(srcPixelPtrs[0], 1, &srcBuf[0], 1, nValues);
+                }
+                mixRowPackedRGBA( &dstBuf[0], srcWidth ? &srcBuf[0] : NULL, &alphas[0], width );
+                Image::convertPixelDepthRow<float, PIX>(&dstBuf[0], 1, dstPixelPtrs[0], 1, nValues);
+            }
+            continue;
+        }
+
+        // Otherwise mix each channel separately
+        for (int k = 0; k < dstNComps; ++k) {
+            float* dstF;
+            if (isFloat && dstPixelStride == 1) {
+                dstF = (float*)dstPixelPtrs[k];
+            } else {
+                Image::convertPixelDepthRow<PIX, float>(dstPixelPtrs[k], dstPixelStride, &dstBuf[0], 1, width);
+                dstF = &dstBuf[0];
+            }
+            const float* srcF = NULL;
+            const PIX* src = k < srcNComps ? srcPixelPtrs[k] : NULL;
+            if (src) {
+                if (isFloat && srcPixelStride == 1 && srcWidth == width) {
+                    srcF = (const float*)src;
+                } else {
+                    std::fill(srcBuf.begin(), srcBuf.begin() + srcOffset, 0.f);
+                    Image::convertPixelDepthRow<PIX, float>(src, srcPixelStride, &srcBuf[srcOffset], 1, srcWidth);
+                    std::fill(srcBuf.begin() + srcOffset + srcWidth, srcBuf.begin() + width, 0.f);
+                    srcF = &srcBuf[0];
+                }
+            }
+            mixRowPlanar(dstF, srcF, &alphas[0], width);
+            if (dstF == &dstBuf[0]) {
+                Image::convertPixelDepthRow<float, PIX>(&dstBuf[0], 1, dstPixelPtrs[k], dstPixelStride, width);
+            }
+        }
+    } // for each scan-line
+    return eActionStatusOK;
+} // copyUnProcessedChannelsAndMaskMixForComponents
+
+template<typename PIX, int maxValue, int srcNComps>
+static ActionRetCodeEnum
+copyUnProcessedChannelsAndMaskMixForSrcComponents(const void* originalImgPtrs[4],
+                                                  const RectI& originalImgBounds,
+                                                  const void* maskImgPtrs[4],
+                                                  const RectI& maskImgBounds,
+                                                  void* dstImgPtrs[4],
+                                                  int dstImgNComps,
+                                                  const RectI& dstBounds,
+                                                  const ImagePrivate::CopyUnProcessedChannelsPlan& plan,
+                                                  ImageBitDepthEnum dstBitDepth,
+                                                  bool doMix,
+                                                  double mix,
+                                                  bool maskInvert,
+                                                  const RectI& roi,
+                                                  const EffectInstancePtr& renderClone)
+{
+    switch (dstImgNComps) {
+        case 1:
+            return copyUnProcessedChannelsAndMaskMixForComponents<PIX, maxValue, srcNComps, 1>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+        case 2:
+            return copyUnProcessedChannelsAndMaskMixForComponents<PIX, maxValue, srcNComps, 2>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+        case 3:
+            return copyUnProcessedChannelsAndMaskMixForComponents<PIX, maxValue, srcNComps, 3>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+        case 4:
+            return copyUnProcessedChannelsAndMaskMixForComponents<PIX, maxValue, srcNComps, 4>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+        default:
+            return eActionStatusFailed;
+    }
+}
+
+template<typename PIX, int maxValue>
+static ActionRetCodeEnum
+copyUnProcessedChannelsAndMaskMixForDepth(const void* originalImgPtrs[4],
+                                          const RectI& originalImgBounds,
+                                          int originalImgNComps,
+                                          const void* maskImgPtrs[4],
+                                          const RectI& maskImgBounds,
+                                          void* dstImgPtrs[4],
+                                          int dstImgNComps,
+                                          const RectI& dstBounds,
+                                          const ImagePrivate::CopyUnProcessedChannelsPlan& plan,
+                                          ImageBitDepthEnum dstBitDepth,
+                                          bool doMix,
+                                          double mix,
+                                          bool maskInvert,
+                                          const RectI& roi,
+                                          const EffectInstancePtr& renderClone)
+{
+    switch (originalImgNComps) {
+        case 1:
+            return copyUnProcessedChannelsAndMaskMixForSrcComponents<PIX, maxValue, 1>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+        case 2:
+            return copyUnProcessedChannelsAndMaskMixForSrcComponents<PIX, maxValue, 2>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+        case 3:
+            return copyUnProcessedChannelsAndMaskMixForSrcComponents<PIX, maxValue, 3>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+        case 4:
+            return copyUnProcessedChannelsAndMaskMixForSrcComponents<PIX, maxValue, 4>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+        default:
+            return copyUnProcessedChannelsAndMaskMixForSrcComponents<PIX, maxValue, 0>(originalImgPtrs, originalImgBounds, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstBitDepth, doMix, mix, maskInvert, roi, renderClone);
+    }
+}
+
+ActionRetCodeEnum
+ImagePrivate::copyUnProcessedChannelsAndMaskMixCPU(const void* originalImgPtrs[4],
+                                                   const RectI& originalImgBounds,
+                                                   int originalImgNComps,
+                                                   const void* maskImgPtrs[4],
+                                                   const RectI& maskImgBounds,
+                                                   void* dstImgPtrs[4],
+                                                   ImageBitDepthEnum dstImgBitDepth,
+                                                   int dstImgNComps,
+                                                   const RectI& dstBounds,
+                                                   const std::bitset<4> processChannels,
+                                                   bool copyUnProcessed,
+                                                   bool doMix,
+                                                   double mix,
+                                                   bool invertMask,
+                                                   const RectI& roi,
+                                                   const EffectInstancePtr& renderClone)
+{
+    // The channels of the output image to copy from the original image
+    CopyUnProcessedChannelsPlan plan;
+    makeCopyUnProcessedChannelsPlan(originalImgNComps, originalImgPtrs[0] != NULL, dstImgNComps, copyUnProcessed ? processChannels : std::bitset<4>().set(), &plan);
+
+    switch (dstImgBitDepth) {
+        case eImageBitDepthByte:
+            return copyUnProcessedChannelsAndMaskMixForDepth<unsigned char, 255>(originalImgPtrs, originalImgBounds, originalImgNComps, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstImgBitDepth, doMix, mix, invertMask, roi, renderClone);
+        case eImageBitDepthShort:
+            return copyUnProcessedChannelsAndMaskMixForDepth<unsigned short, 65535>(originalImgPtrs, originalImgBounds, originalImgNComps, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstImgBitDepth, doMix, mix, invertMask, roi, renderClone);
+        case eImageBitDepthHalf:
+            return copyUnProcessedChannelsAndMaskMixForDepth<Half, 1>(originalImgPtrs, originalImgBounds, originalImgNComps, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstImgBitDepth, doMix, mix, invertMask, roi, renderClone);
+        case eImageBitDepthFloat:
+            return copyUnProcessedChannelsAndMaskMixForDepth<float, 1>(originalImgPtrs, originalImgBounds, originalImgNComps, maskImgPtrs, maskImgBounds, dstImgPtrs, dstImgNComps, dstBounds, plan, dstImgBitDepth, doMix, mix, invertMask, roi, renderClone);
+        default:
+            assert(false);
+            return eActionStatusFailed;
+    }
+} // copyUnProcessedChannelsAndMaskMixCPU
+
 template <typename GL>
 void applyMaskMixGLInternal(const GLImageStoragePtr& originalTexture,
                             const GLImageStoragePtr& maskTexture,
@@ -317,6 +622,85 @@ void applyMaskMixGLInternal(const GLImageStoragePtr& originalTexture,
 
 } // applyMaskMixGLInternal
 
+template <typename GL>
+void copyUnProcessedChannelsAndMaskMixGLInternal(const GLImageStoragePtr& originalTexture,
+                                                 const GLImageStoragePtr& maskTexture,
+                                                 const GLImageStoragePtr& dstTexture,
+                                                 const std::bitset<4> processChannels,
+                                                 bool copyUnProcessed,
+                                                 bool doMix,
+                                                 double mix,
+                                                 bool maskInvert,
+                                                 const RectI& roi,
+                                                 const OSGLContextPtr& glContext)
+{
+    // The channels that are not processed are copied from the original image
+    std::bitset<4> copyChannels;
+    if (copyUnProcessed) {
+        copyChannels = ~processChannels;
+    }
+    GLShaderBasePtr shader = glContext->getOrCreatePostProcessShader(copyChannels, doMix, maskTexture.get() != 0, maskInvert);
+    assert(shader);
+    GLuint fboID = glContext->getOrCreateFBOId();
+
+    int target = dstTexture->getGLTextureTarget();
+    int dstTexID = dstTexture->getGLTextureID();
+    int originalTexID = originalTexture ? originalTexture->getGLTextureID() : 0;
+    int maskTexID = maskTexture ? maskTexture->getGLTextureID() : 0;
+
+    GL::BindFramebuffer(GL_FRAMEBUFFER, fboID);
+    GL::Enable(target);
+    GL::ActiveTexture(GL_TEXTURE0);
+    GL::BindTexture( target, dstTexID );
+
+    GL::TexParameteri (target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    GL::TexParameteri (target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GL::TexParameteri (target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    GL::TexParameteri (target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    GL::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, dstTexID, 0 /*LoD*/);
+    glCheckFramebufferError(GL);
+
+    GL::ActiveTexture(GL_TEXTURE1);
+    GL::BindTexture(target, originalTexID);
+
+    GL::TexParameteri (target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    GL::TexParameteri (target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GL::TexParameteri (target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    GL::TexParameteri (target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    GL::ActiveTexture(GL_TEXTURE2);
+    GL::BindTexture(target, maskTexID);
+
+    GL::TexParameteri (target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    GL::TexParameteri (target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GL::TexParameteri (target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    GL::TexParameteri (target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    const RectI& dstBounds = dstTexture->getBounds();
+    const RectI& srcBounds = originalTexture ? originalTexture->getBounds() : dstBounds;
+
+    shader->bind();
+    shader->setUniform("originalImageTex", 1);
+    shader->setUniform("maskImageTex", 2);
+    shader->setUniform("outputImageTex", 0);
+    shader->setUniform("mixValue", (float)mix);
+    OSGLContext::applyTextureMapping<GL>(srcBounds, dstBounds, roi);
+    shader->unbind();
+
+
+    GL::BindTexture(target, 0);
+    GL::ActiveTexture(GL_TEXTURE1);
+    GL::BindTexture(target, 0);
+    GL::ActiveTexture(GL_TEXTURE0);
+    GL::BindTexture(target, 0);
+    glCheckError(GL);
+
+} // copyUnProcessedChannelsAndMaskMixGLInternal
+
 void
 ImagePrivate::applyMaskMixGL(const GLImageStoragePtr& originalTexture,
                              const GLImageStoragePtr& maskTexture,
@@ -344,4 +728,34 @@ ImagePrivate::applyMaskMixGL(const GLImageStoragePtr& originalTexture,
     }
 }
 
+void
+ImagePrivate::copyUnProcessedChannelsAndMaskMixGL(const GLImageStoragePtr& originalTexture,
+                                                  const GLImageStoragePtr& maskTexture,
+                                                  const GLImageStoragePtr& dstTexture,
+                                                  const std::bitset<4> processChannels,
+                                                  bool copyUnProcessed,
+                                                  bool doMix,
+                                                  double mix,
+                                                  bool invertMask,
+                                                  const RectI& roi)
+{
+    OSGLContextPtr context = dstTexture->getOpenGLContext();
+    assert(context);
+
+    // Save the current context
+    OSGLContextSaver saveCurrentContext;
+
+    {
+        // Ensure this context is attached
+        OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(context);
+        contextAttacher->attach();
+
+        if (context->isGPUContext()) {
+            copyUnProcessedChannelsAndMaskMixGLInternal<GL_GPU>(originalTexture, maskTexture, dstTexture, processChannels, copyUnProcessed, doMix, mix, invertMask, roi, context);
+        } else {
+            copyUnProcessedChannelsAndMaskMixGLInternal<GL_CPU>(originalTexture, maskTexture, dstTexture, processChannels, copyUnProcessed, doMix, mix, invertMask, roi, context);
+        }
+    }
+}
+
 NATRON_NAMESPACE_EXIT
@@ -28,14 +28,20 @@
 #include <ofxNatron.h>
 
 #include <cassert>
+#include <list>
+#include <map>
 #include <sstream>
 #include <stdexcept>
 
+#include <QtCore/QMutex>
+
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
+#include "Global/GlobalDefines.h"
+
 #include "Serialization/NodeSerialization.h"
 
 
@@ -49,13 +55,126 @@ static const char* disparityComps[2] = {"X", "Y"};
 static const char* xyComps[2] = {"X", "Y"};
 
 
-ImagePlaneDesc::ImagePlaneDesc()
-    : _planeID("none")
+struct ImagePlaneDescData
+{
+    std::string planeID, planeLabel;
+    std::vector<std::string> channels;
+    std::string channelsLabel;
+
+    // The index of the planeID in the registry: the descriptions with the same planeID have the same index
+    int planeIndex;
+
+    // Equal for 2 descriptions if and only if they have the same planeID and the same number of channels,
+    // see ImagePlaneDesc::operator==
+    U64 identity;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class ImagePlaneDescRegistry
+{
+public:
+
+    ImagePlaneDescRegistry()
+    : lock()
+    , descriptions()
+    , descriptionsByKey()
+    , planeIndices()
+    {
+    }
+
+    const ImagePlaneDescData* intern(const std::string& planeID,
+                                     const std::string& planeLabel,
+                                     const std::string& channelsLabel,
+                                     const std::vector<std::string>& channels)
+    {
+        Key key;
+        key.planeID = planeID;
+        key.planeLabel = planeLabel;
+        key.channelsLabel = channelsLabel;
+        key.channels = channels;
+
+        QMutexLocker k(&lock);
+        DescriptionsMap::const_iterator found = descriptionsByKey.find(key);
+        if ( found != descriptionsByKey.end() ) {
+            return found->second;
+        }
+
+        int planeIndex;
+        std::map<std::string, int>::const_iterator foundPlane = planeIndices.find(planeID);
+        if ( foundPlane != planeIndices.end() ) {
+            planeIndex = foundPlane->second;
+        } else {
+            planeIndex = (int)planeIndices.size();
+            planeIndices.insert( std::make_pair(planeID, planeIndex) );
+        }
+
+        ImagePlaneDescData data;
+        data.planeID = planeID;
+        data.planeLabel = planeLabel;
+        data.channels = channels;
+        data.channelsLabel = channelsLabel;
+        data.planeIndex = planeIndex;
+        data.identity = ( (U64)planeIndex << 32 ) | (U64)channels.size();
+
+        // The elements of a std::list are not moved when inserting others
+        descriptions.push_back(data);
+        const ImagePlaneDescData* ret = &descriptions.back();
+        descriptionsByKey.insert( std::make_pair(key, ret) );
+        return ret;
+    }
+
+private:
+
+    struct Key
+    {
+        std::string planeID, planeLabel, channelsLabel;
+        std::vector<std::string> channels;
+
+        bool operator<(const Key& other) const
+        {
+            if (planeID != other.planeID) {
+                return planeID < other.planeID;
+            }
+            if (planeLabel != other.planeLabel) {
+                return planeLabel < other.planeLabel;
+            }
+            if (channelsLabel != other.channelsLabel) {
+                return channelsLabel < other.channelsLabel;
+            }
+            return channels < other.channels;
+        }
+    };
+
+    typedef std::map<Key, const ImagePlaneDescData*> DescriptionsMap;
+
+    QMutex lock;
+    std::list<ImagePlaneDescData> descriptions;
+    DescriptionsMap descriptionsByKey;
+    std::map<std::string, int> planeIndices;
+};
+
+ImagePlaneDescRegistry&
+getRegistry()
+{
+    // Never destroyed: ImagePlaneDesc objects with a static storage duration may still point to the descriptions
+    // while the program exits
+    static ImagePlaneDescRegistry* registry = new ImagePlaneDescRegistry;
+    return *registry;
+}
+
+const ImagePlaneDescData*
+getNoneData()
+{
+    static const ImagePlaneDescData* data = getRegistry().intern("none", "none", "none", std::vector<std::string>());
+    return data;
+}
 
-    , _planeLabel("none")
-    , _channels()
-    , _channelsLabel("none")
+NATRON_NAMESPACE_ANONYMOUS_EXIT
 
+
+ImagePlaneDesc::ImagePlaneDesc()
+    : _data( getNoneData() )
 {
 }
 
@@ -63,21 +182,9 @@ ImagePlaneDesc::ImagePlaneDesc(const std::string& planeID,
                                const std::string& planeLabel,
                                const std::string& channelsLabel,
                                const std::vector<std::string>& channels)
-: _planeID(planeID)
-, _planeLabel(planeLabel)
-, _channels(channels)
-, _channelsLabel(channelsLabel)
-{
-    if (planeLabel.empty()) {
-        // Plane label is the ID if empty
-        _planeLabel = _planeID;
-    }
-    if ( channelsLabel.empty() ) {
-        // Channels label is the concatenation of all channels
-        for (std::size_t i = 0; i < channels.size(); ++i) {
-            _channelsLabel.append(channels[i]);
-        }
-    }
+: _data(0)
+{
+    setData(planeID, planeLabel, channelsLabel, channels);
 }
 
 ImagePlaneDesc::ImagePlaneDesc(const std::string& planeName,
@@ -85,40 +192,25 @@ ImagePlaneDesc::ImagePlaneDesc(const std::string& planeName,
                                const std::string& channelsLabel,
                                const char** channels,
                                int count)
-: _planeID(planeName)
-, _planeLabel(planeLabel)
-, _channels()
-, _channelsLabel(channelsLabel)
+: _data(0)
 {
-    _channels.resize(count);
+    std::vector<std::string> channelsVec(count);
     for (int i = 0; i < count; ++i) {
-        _channels[i] = channels[i];
-    }
-
-    if (planeLabel.empty()) {
-        // Plane label is the ID if empty
-        _planeLabel = _planeID;
-    }
-    if ( channelsLabel.empty() ) {
-        // Channels label is the concatenation of all channels
-        for (std::size_t i = 0; i < _channels.size(); ++i) {
-            _channelsLabel.append(channels[i]);
-        }
+        channelsVec[i] = channels[i];
     }
+    setData(planeName, planeLabel, channelsLabel, channelsVec);
 }
 
 ImagePlaneDesc::ImagePlaneDesc(const ImagePlaneDesc& other)
+    : SERIALIZATION_NAMESPACE::SerializableObjectBase()
+    , _data(other._data)
 {
-    *this = other;
 }
 
 ImagePlaneDesc&
 ImagePlaneDesc::operator=(const ImagePlaneDesc& other)
 {
-    _planeID = other._planeID;
-    _planeLabel = other._planeLabel;
-    _channels = other._channels;
-    _channelsLabel = other._channelsLabel;
+    _data = other._data;
     return *this;
 }
 
@@ -126,6 +218,28 @@ ImagePlaneDesc::~ImagePlaneDesc()
 {
 }
 
+void
+ImagePlaneDesc::setData(const std::string& planeID,
+                        const std::string& planeLabel,
+                        const std::string& channelsLabel,
+                        const std::vector<std::string>& channels)
+{
+    // Plane label is the ID if empty
+    const std::string& label = planeLabel.empty() ? planeID : planeLabel;
+
+    if ( !channelsLabel.empty() ) {
+        _data = getRegistry().intern(planeID, label, channelsLabel, channels);
+        return;
+    }
+
+    // Channels label is the concatenation of all channels
+    std::string concatenatedChannels;
+    for (std::size_t i = 0; i < channels.size(); ++i) {
+        concatenatedChannels.append(channels[i]);
+    }
+    _data = getRegistry().intern(planeID, label, concatenatedChannels, channels);
+}
+
 bool
 ImagePlaneDesc::isColorPlane(const std::string& planeID)
 {
@@ -135,7 +249,7 @@ ImagePlaneDesc::isColorPlane(const std::string& planeID)
 bool
 ImagePlaneDesc::isColorPlane() const
 {
-    return ImagePlaneDesc::isColorPlane(_planeID);
+    return _data->planeIndex == ImagePlaneDesc::getRGBAComponents()._data->planeIndex;
 }
 
 
@@ -143,46 +257,48 @@ ImagePlaneDesc::isColorPlane() const
 bool
 ImagePlaneDesc::operator==(const ImagePlaneDesc& other) const
 {
-    if ( _channels.size() != other._channels.size() ) {
-        return false;
-    }
-    return _planeID == other._planeID;
+    return _data->identity == other._data->identity;
 }
 
 bool
 ImagePlaneDesc::operator<(const ImagePlaneDesc& other) const
 {
-    return _planeID < other._planeID;
+    // Keep the order of the planeIDs so that the maps of planes are sorted the same way regardless of the order
+    // in which the planes were interned
+    if (_data->planeIndex == other._data->planeIndex) {
+        return false;
+    }
+    return _data->planeID < other._data->planeID;
 }
 
 int
 ImagePlaneDesc::getNumComponents() const
 {
-    return (int)_channels.size();
+    return (int)_data->channels.size();
 }
 
 const std::string&
 ImagePlaneDesc::getPlaneID() const
 {
-    return _planeID;
+    return _data->planeID;
 }
 
 const std::string&
 ImagePlaneDesc::getPlaneLabel() const
 {
-    return _planeLabel;
+    return _data->planeLabel;
 }
 
 const std::string&
 ImagePlaneDesc::getChannelsLabel() const
 {
-    return _channelsLabel;
+    return _data->channelsLabel;
 }
 
 const std::vector<std::string>&
 ImagePlaneDesc::getChannels() const
 {
-    return _channels;
+    return _data->channels;
 }
 
 const ImagePlaneDesc&
@@ -266,10 +382,10 @@ ImagePlaneDesc::toSerialization(SERIALIZATION_NAMESPACE::SerializationObjectBase
     if (!s) {
         return;
     }
-    s->planeID = _planeID;
-    s->planeLabel = _planeLabel;
-    s->channelsLabel = _channelsLabel;
-    s->channelNames = _channels;
+    s->planeID = _data->planeID;
+    s->planeLabel = _data->planeLabel;
+    s->channelsLabel = _data->channelsLabel;
+    s->channelNames = _data->channels;
 }
 
 void
@@ -279,23 +395,19 @@ ImagePlaneDesc::fromSerialization(const SERIALIZATION_NAMESPACE::SerializationOb
     if (!s) {
         return;
     }
-    _planeID = s->planeID;
-    _planeLabel = s->planeLabel;
-    _channelsLabel = s->channelsLabel;
-    _channels = s->channelNames;
-
+    setData(s->planeID, s->planeLabel, s->channelsLabel, s->channelNames);
 }
 
 ChoiceOption
 ImagePlaneDesc::getChannelOption(int channelIndex) const
 {
-    if (channelIndex < 0 || channelIndex >= (int)_channels.size()) {
+    if (channelIndex < 0 || channelIndex >= (int)_data->channels.size()) {
         assert(false);
         return ChoiceOption("","","");
     }
     std::string optionID, optionLabel;
-    optionLabel += _planeLabel;
-    optionID += _planeID;
+    optionLabel += _data->planeLabel;
+    optionID += _data->planeID;
     if ( !optionLabel.empty() ) {
         optionLabel += '.';
     }
@@ -304,8 +416,8 @@ ImagePlaneDesc::getChannelOption(int channelIndex) const
     }
 
     // For the option label, append the name of the channel
-    optionLabel += _channels[channelIndex];
-    optionID += _channels[channelIndex];
+    optionLabel += _data->channels[channelIndex];
+    optionID += _data->channels[channelIndex];
 
     return ChoiceOption(optionID, optionLabel, "");
 }
@@ -313,11 +425,11 @@ ImagePlaneDesc::getChannelOption(int channelIndex) const
 ChoiceOption
 ImagePlaneDesc::getPlaneOption() const
 {
-    std::string optionLabel = _planeLabel + "." + _channelsLabel;
+    std::string optionLabel = _data->planeLabel + "." + _data->channelsLabel;
 
     // The option ID is always the name of the layer, this ensures for the Color plane that even if the components type changes, the choice stays
     // the same in the parameter.
-    return ChoiceOption(_planeID, optionLabel, "");
+    return ChoiceOption(_data->planeID, optionLabel, "");
 
 }
 
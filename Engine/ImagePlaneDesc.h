@@ -42,6 +42,8 @@
 
 NATRON_NAMESPACE_ENTER
 
+struct ImagePlaneDescData;
+
 #define kNatronColorPlaneID kFnOfxImagePlaneColour
 #define kNatronColorPlaneLabel "Color"
 
@@ -72,6 +74,10 @@ NATRON_NAMESPACE_ENTER
  * If empty, the channels label is set to the concatenation of all channels.
  * The channels are the unique identifier for each channel composing the plane.
  * The plane can only be composed from 1 to 4 (included) channels.
+ *
+ * The descriptions are interned in a global registry: an ImagePlaneDesc only holds a pointer to
+ * the shared strings, which are never freed, so that copying it does not allocate and comparing
+ * 2 planes compares integers.
  **/
 class ImagePlaneDesc : public SERIALIZATION_NAMESPACE::SerializableObjectBase
 {
@@ -252,9 +258,14 @@ public:
 
 
 private:
-    std::string _planeID, _planeLabel;
-    std::vector<std::string> _channels;
-    std::string _channelsLabel;
+
+    void setData(const std::string& planeID,
+                 const std::string& planeLabel,
+                 const std::string& channelsLabel,
+                 const std::vector<std::string>& channels);
+
+    // The interned description, shared by all the equal descriptions and never freed
+    const ImagePlaneDescData* _data;
 
 };
 
@@ -24,6 +24,8 @@
 
 #include "ImagePrivate.h"
 
+#include <algorithm>
+
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
@@ -35,6 +37,13 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/Hash64.h"
 #include "Engine/Node.h"
+#include "Engine/TreeRender.h"
+
+// SSE2 is always available on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_IMAGE_PRIVATE_SSE2
+#include <emmintrin.h>
+#endif
 
 NATRON_NAMESPACE_ENTER
 
@@ -109,8 +118,22 @@ ImagePrivate::initAndFetchFromCache(const Image::InitStorageArgs& args)
 
     EffectInstancePtr effect = renderClone.lock();
     std::string pluginID;
+    U64 cacheStatsHolderID = 0;
+    double computeCostHint = 0;
     if (effect) {
         pluginID = effect->getNode()->getPluginID();
+        cacheStatsHolderID = effect->getNode()->getCacheStatsHolderID();
+        computeCostHint = effect->getNode()->getRenderCostPerMB();
+    }
+
+    // The memory is charged to the node and the render that create the image
+    std::list<MemoryBudgetPtr> budgets;
+    if (effect) {
+        budgets.push_back( effect->getNode()->getMemoryBudget() );
+        TreeRenderPtr render = effect->getCurrentRender();
+        if (render) {
+            budgets.push_back( render->getMemoryBudget() );
+        }
     }
 
 
@@ -128,6 +151,7 @@ ImagePrivate::initAndFetchFromCache(const Image::InitStorageArgs& args)
                     a->glContext = args.glContext;
                     a->bounds = originalBounds;
                     a->bitDepth = bitdepth;
+                    a->budgets = budgets;
                     allocArgs = a;
                 }   break;
                 case eStorageModeRAM: {
@@ -136,6 +160,9 @@ ImagePrivate::initAndFetchFromCache(const Image::InitStorageArgs& args)
                     boost::shared_ptr<RAMAllocateMemoryArgs> a(new RAMAllocateMemoryArgs());
                     a->bitDepth = bitdepth;
                     a->bounds = originalBounds;
+                    a->zeroInitialized = args.zeroInitialized;
+                    a->budgets = budgets;
+                    a->cacheStatsHolderID = cacheStatsHolderID;
 
                     if (channelIndices[c] == -1) {
                         a->numComponents = (std::size_t)plane.getNumComponents();
@@ -181,6 +208,8 @@ ImagePrivate::initAndFetchFromCache(const Image::InitStorageArgs& args)
                                            layerID,
                                            args.proxyScale,
                                            pluginID));
+    key->setStatsHolderID(cacheStatsHolderID);
+    key->setComputeCostHint(computeCostHint);
 
 
     cacheEntry.reset(new ImageCacheEntry(_publicInterface->shared_from_this(),
@@ -342,108 +371,116 @@ ImagePrivate::checkIfCopyToTempImageIsNeeded(const Image& fromImage, const Image
     return eActionStatusOK;
 } // checkIfCopyToTempImageIsNeeded
 
-template <typename PIX, int maxValue, int nComps>
+/**
+ * @brief Integer pixels are summed in 64 bits so that large downscale factors do not overflow,
+ * float pixels are summed in float so that a single level gives the same result as halving the image.
+ **/
+template <typename PIX>
+struct DownscaleAccumulator
+{
+    typedef U64 type;
+};
+
+template <>
+struct DownscaleAccumulator<Half>
+{
+    typedef float type;
+};
+
+template <>
+struct DownscaleAccumulator<float>
+{
+    typedef float type;
+};
+
+template <typename PIX, int nComps>
 static ActionRetCodeEnum
-halveImageForInternal(const void* srcPtrs[4],
-                      const RectI& srcBounds,
-                      void* dstPtrs[4],
-                      const RectI& dstBounds,
-                      const EffectInstancePtr& renderClone)
+downscaleImageForInternal(const void* srcPtrs[4],
+                          const RectI& srcBounds,
+                          void* dstPtrs[4],
+                          const RectI& dstBounds,
+                          const RectI& renderWindow,
+                          unsigned int downscaleLevels,
+                          const EffectInstancePtr& renderClone)
 {
+    typedef typename DownscaleAccumulator<PIX>::type SUM;
 
-    PIX* dstPixelPtrs[4] = {NULL, NULL, NULL, NULL};
-    int dstPixelStride;
-    Image::getChannelPointers<PIX, nComps>((const PIX**)dstPtrs, dstBounds.x1, dstBounds.y1, dstBounds, (PIX**)dstPixelPtrs, &dstPixelStride);
+    // Each dst pixel is the average of a block of factor x factor src pixels
+    const int factor = 1 << downscaleLevels;
 
-    const PIX* srcPixelPtrs[4] = {NULL, NULL, NULL, NULL};
     int srcPixelStride;
-    Image::getChannelPointers<PIX, nComps>((const PIX**)srcPtrs, srcBounds.x1, srcBounds.y1, srcBounds, (PIX**)srcPixelPtrs, &srcPixelStride);
-
-    const int dstRowElementsCount = dstBounds.width() * dstPixelStride;
+    const PIX* srcOrigPtrs[4] = {NULL, NULL, NULL, NULL};
+    Image::getChannelPointers<PIX, nComps>((const PIX**)srcPtrs, srcBounds.x1, srcBounds.y1, srcBounds, (PIX**)srcOrigPtrs, &srcPixelStride);
     const int srcRowElementsCount = srcBounds.width() * srcPixelStride;
 
-
-    for (int y = dstBounds.y1; y < dstBounds.y2; ++y) {
+    for (int y = renderWindow.y1; y < renderWindow.y2; ++y) {
 
         if (renderClone && renderClone->isRenderAborted()) {
             return eActionStatusAborted;
         }
 
-        // The current dst row, at y, covers the src rows y*2 (thisRow) and y*2+1 (nextRow).
-        const int srcy = y * 2;
+        // The current dst row, at y, covers the src rows [y * factor, (y + 1) * factor), clipped to srcBounds
+        const int srcy1 = std::max(y * factor, srcBounds.y1);
+        const int srcy2 = std::min( (y + 1) * factor, srcBounds.y2 );
+        assert(srcy1 < srcy2);
 
-        // Check that we are within srcBounds.
-        const bool pickThisRow = srcBounds.y1 <= (srcy + 0) && (srcy + 0) < srcBounds.y2;
-        const bool pickNextRow = srcBounds.y1 <= (srcy + 1) && (srcy + 1) < srcBounds.y2;
+        PIX* dstPixelPtrs[4] = {NULL, NULL, NULL, NULL};
+        int dstPixelStride;
+        Image::getChannelPointers<PIX, nComps>((const PIX**)dstPtrs, renderWindow.x1, y, dstBounds, (PIX**)dstPixelPtrs, &dstPixelStride);
 
-        const int sumH = (int)pickNextRow + (int)pickThisRow;
-        assert(sumH == 1 || sumH == 2);
+        for (int x = renderWindow.x1; x < renderWindow.x2; ++x) {
 
-        for (int x = dstBounds.x1; x < dstBounds.x2; ++x) {
+            // Same for the columns
+            const int srcx1 = std::max(x * factor, srcBounds.x1);
+            const int srcx2 = std::min( (x + 1) * factor, srcBounds.x2 );
+            assert(srcx1 < srcx2);
 
-            // The current dst col, at y, covers the src cols x*2 (thisCol) and x*2+1 (nextCol).
-            const int srcx = x * 2;
-
-            // Check that we are within srcBounds.
-            const bool pickThisCol = srcBounds.x1 <= (srcx + 0) && (srcx + 0) < srcBounds.x2;
-            const bool pickNextCol = srcBounds.x1 <= (srcx + 1) && (srcx + 1) < srcBounds.x2;
-
-            const int sumW = (int)pickThisCol + (int)pickNextCol;
-            assert(sumW == 1 || sumW == 2);
-
-            const int sum = sumW * sumH;
-            assert(0 < sum && sum <= 4);
+            const int count = (srcx2 - srcx1) * (srcy2 - srcy1);
 
             for (int k = 0; k < nComps; ++k) {
 
-                // Averaged pixels are as such:
+                // Pixels are summed in scan-line order: for a single level this is (a + b) + c + d with
                 // a b
                 // c d
-
-                const PIX a = (pickThisCol && pickThisRow) ? *(srcPixelPtrs[k]) : 0;
-                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixelPtrs[k] + srcPixelStride) : 0;
-                const PIX c = (pickThisCol && pickNextRow) ? *(srcPixelPtrs[k] + srcRowElementsCount) : 0;
-                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixelPtrs[k] + srcRowElementsCount + srcPixelStride)  : 0;
-
-                assert( sumW == 2 || ( sumW == 1 && ( (a == 0 && c == 0) || (b == 0 && d == 0) ) ) );
-                assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
-
-                *dstPixelPtrs[k] = (a + b + c + d) / sum;
-
-                srcPixelPtrs[k] += srcPixelStride * 2;
+                SUM sum = 0;
+                const PIX* srcRow = srcOrigPtrs[k] + (srcy1 - srcBounds.y1) * srcRowElementsCount + (srcx1 - srcBounds.x1) * srcPixelStride;
+                for (int sy = srcy1; sy < srcy2; ++sy, srcRow += srcRowElementsCount) {
+                    const PIX* srcPix = srcRow;
+                    for (int sx = srcx1; sx < srcx2; ++sx, srcPix += srcPixelStride) {
+                        sum += *srcPix;
+                    }
+                }
+                *dstPixelPtrs[k] = (PIX)(sum / count);
                 dstPixelPtrs[k] += dstPixelStride;
             } // for each component
 
         } // for each pixels on the line
 
-        // Remove what was offset to the pointers during this scan-line and offset to the next
-        for (int k = 0; k < nComps; ++k) {
-            dstPixelPtrs[k] += (dstRowElementsCount - dstBounds.width() * dstPixelStride);
-            srcPixelPtrs[k] += ((srcRowElementsCount - dstBounds.width() * srcPixelStride) * 2);
-        }
     }  // for each scan line
     return eActionStatusOK;
-} // halveImageForInternal
+} // downscaleImageForInternal
 
 
-template <typename PIX, int maxValue>
+template <typename PIX>
 static ActionRetCodeEnum
-halveImageForDepth(const void* srcPtrs[4],
-                   int nComps,
-                   const RectI& srcBounds,
-                   void* dstPtrs[4],
-                   const RectI& dstBounds,
-                   const EffectInstancePtr& renderClone)
+downscaleImageForDepth(const void* srcPtrs[4],
+                       int nComps,
+                       const RectI& srcBounds,
+                       void* dstPtrs[4],
+                       const RectI& dstBounds,
+                       const RectI& renderWindow,
+                       unsigned int downscaleLevels,
+                       const EffectInstancePtr& renderClone)
 {
     switch (nComps) {
         case 1:
-            return halveImageForInternal<PIX, maxValue, 1>(srcPtrs, srcBounds, dstPtrs, dstBounds, renderClone);
+            return downscaleImageForInternal<PIX, 1>(srcPtrs, srcBounds, dstPtrs, dstBounds, renderWindow, downscaleLevels, renderClone);
         case 2:
-            return halveImageForInternal<PIX, maxValue, 2>(srcPtrs, srcBounds, dstPtrs, dstBounds, renderClone);
+            return downscaleImageForInternal<PIX, 2>(srcPtrs, srcBounds, dstPtrs, dstBounds, renderWindow, downscaleLevels, renderClone);
         case 3:
-            return halveImageForInternal<PIX, maxValue, 3>(srcPtrs, srcBounds, dstPtrs, dstBounds, renderClone);
+            return downscaleImageForInternal<PIX, 3>(srcPtrs, srcBounds, dstPtrs, dstBounds, renderWindow, downscaleLevels, renderClone);
         case 4:
-            return halveImageForInternal<PIX, maxValue, 4>(srcPtrs, srcBounds, dstPtrs, dstBounds, renderClone);
+            return downscaleImageForInternal<PIX, 4>(srcPtrs, srcBounds, dstPtrs, dstBounds, renderWindow, downscaleLevels, renderClone);
         default:
         return eActionStatusFailed;
     }
@@ -451,27 +488,98 @@ halveImageForDepth(const void* srcPtrs[4],
 
 
 ActionRetCodeEnum
-ImagePrivate::halveImage(const void* srcPtrs[4],
-                         int nComps,
-                         ImageBitDepthEnum bitDepth,
-                         const RectI& srcBounds,
-                         void* dstPtrs[4],
-                         const RectI& dstBounds,
-                         const EffectInstancePtr& renderClone)
+ImagePrivate::downscaleImage(const void* srcPtrs[4],
+                             int nComps,
+                             ImageBitDepthEnum bitDepth,
+                             const RectI& srcBounds,
+                             void* dstPtrs[4],
+                             const RectI& dstBounds,
+                             const RectI& renderWindow,
+                             unsigned int downscaleLevels,
+                             const EffectInstancePtr& renderClone)
 {
     switch ( bitDepth ) {
         case eImageBitDepthByte:
-            return halveImageForDepth<unsigned char, 255>(srcPtrs, nComps, srcBounds, dstPtrs, dstBounds, renderClone);
+            return downscaleImageForDepth<unsigned char>(srcPtrs, nComps, srcBounds, dstPtrs, dstBounds, renderWindow, downscaleLevels, renderClone);
         case eImageBitDepthShort:
-            return halveImageForDepth<unsigned short, 65535>(srcPtrs, nComps, srcBounds, dstPtrs, dstBounds, renderClone);
+            return downscaleImageForDepth<unsigned short>(srcPtrs, nComps, srcBounds, dstPtrs, dstBounds, renderWindow, downscaleLevels, renderClone);
+        case eImageBitDepthHalf:
+            return downscaleImageForDepth<Half>(srcPtrs, nComps, srcBounds, dstPtrs, dstBounds, renderWindow, downscaleLevels, renderClone);
         case eImageBitDepthFloat:
-            return halveImageForDepth<float, 1>(srcPtrs, nComps, srcBounds, dstPtrs, dstBounds, renderClone);
+            return downscaleImageForDepth<float>(srcPtrs, nComps, srcBounds, dstPtrs, dstBounds, renderWindow, downscaleLevels, renderClone);
             break;
         default:
         return eActionStatusFailed;
     }
-} // halveImage
+} // downscaleImage
+
+
+/**
+ * @brief Returns true if one of the n contiguous values is a NaN.
+ * This only reads the memory: scan-lines without NaNs, which are the common case, are never written to.
+ **/
+template <typename PIX>
+bool
+hasNaNs(const PIX* /*values*/,
+        std::size_t /*n*/)
+{
+    // integer depths cannot hold NaNs
+    return false;
+}
+
+template <>
+bool
+hasNaNs<float>(const float* values,
+               std::size_t n)
+{
+    std::size_t i = 0;
+#ifdef NATRON_IMAGE_PRIVATE_SSE2
+    __m128 nans = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        const __m128 v0 = _mm_loadu_ps(values + i);
+        const __m128 v1 = _mm_loadu_ps(values + i + 4);
+        nans = _mm_or_ps( nans, _mm_or_ps( _mm_cmpunord_ps(v0, v0), _mm_cmpunord_ps(v1, v1) ) );
+    }
+    if ( _mm_movemask_ps(nans) ) {
+        return true;
+    }
+#endif
+    for (; i < n; ++i) {
+        if ( (boost::math::isnan)(values[i]) ) {
+            return true;
+        }
+    }
+    return false;
+}
 
+template <>
+bool
+hasNaNs<Half>(const Half* values,
+              std::size_t n)
+{
+    // a half is a NaN if its exponent is all ones and its mantissa is not zero
+    const unsigned short* bits = (const unsigned short*)values;
+    std::size_t i = 0;
+#ifdef NATRON_IMAGE_PRIVATE_SSE2
+    const __m128i absMask = _mm_set1_epi16(0x7fff);
+    const __m128i infBits = _mm_set1_epi16(0x7c00);
+    __m128i nans = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_and_si128(_mm_loadu_si128( (const __m128i*)(bits + i) ), absMask);
+        // the absolute values are positive, a signed comparison is fine
+        nans = _mm_or_si128( nans, _mm_cmpgt_epi16(v, infBits) );
+    }
+    if ( _mm_movemask_epi8(nans) ) {
+        return true;
+    }
+#endif
+    for (; i < n; ++i) {
+        if ( (bits[i] & 0x7fff) > 0x7c00 ) {
+            return true;
+        }
+    }
+    return false;
+}
 
 template <typename PIX, int maxValue, int nComps>
 ActionRetCodeEnum
@@ -488,24 +596,42 @@ checkForNaNsInternal(void* ptrs[4],
     Image::getChannelPointers<PIX, nComps>((const PIX**)ptrs, roi.x1, roi.y1, bounds, (PIX**)dstPixelPtrs, &dstPixelStride);
     const int rowElementsCount = bounds.width() * dstPixelStride;
 
+    // Packed buffers are scanned with all their channels at once, mono-channel buffers one channel at a time
+    const bool packed = dstPixelStride == nComps;
+    assert(packed || dstPixelStride == 1);
+
     for (int y = roi.y1; y < roi.y2; ++y) {
         if (effect && effect->isRenderAborted()) {
             return eActionStatusAborted;
         }
-        for (int x = roi.x1; x < roi.x2; ++x) {
-            for (int k = 0; k < nComps; ++k) {
-                // we remove NaNs, but infinity values should pose no problem
-                // (if they do, please explain here which ones)
-                if ( (boost::math::isnan)(*dstPixelPtrs[k]) ) { // check for NaN
-                    *dstPixelPtrs[k] = 1.;
-                    *foundNan = true;
+
+        bool rowHasNaNs = false;
+        if (packed) {
+            rowHasNaNs = hasNaNs<PIX>(dstPixelPtrs[0], (std::size_t)roi.width() * nComps);
+        } else {
+            for (int k = 0; k < nComps && !rowHasNaNs; ++k) {
+                rowHasNaNs = hasNaNs<PIX>(dstPixelPtrs[k], roi.width());
+            }
+        }
+
+        if (rowHasNaNs) {
+            PIX* pix[4] = {dstPixelPtrs[0], dstPixelPtrs[1], dstPixelPtrs[2], dstPixelPtrs[3]};
+            for (int x = roi.x1; x < roi.x2; ++x) {
+                for (int k = 0; k < nComps; ++k) {
+                    // we remove NaNs, but infinity values should pose no problem
+                    // (if they do, please explain here which ones)
+                    if ( (boost::math::isnan)(*pix[k]) ) { // check for NaN
+                        *pix[k] = 1.;
+                        *foundNan = true;
+                    }
+                    pix[k] += dstPixelStride;
                 }
-                dstPixelPtrs[k] += dstPixelStride;
             }
         }
-        // Remove what was done at the previous scan-line and got to the next
+
+        // Go to the next scan-line
         for (int k = 0; k < nComps; ++k) {
-            dstPixelPtrs[k] += (rowElementsCount - roi.width() * dstPixelStride);
+            dstPixelPtrs[k] += rowElementsCount;
         }
     } // for each scan-line
     return eActionStatusOK;
@@ -552,8 +678,7 @@ ImagePrivate::checkForNaNs(void* ptrs[4],
         case eImageBitDepthShort:
             return checkForNaNsForDepth<unsigned short, 65535>(ptrs, nComps, bounds, roi, effect, foundNan);
         case eImageBitDepthHalf:
-            assert(false);
-            return eActionStatusFailed;
+            return checkForNaNsForDepth<Half, 1>(ptrs, nComps, bounds, roi, effect, foundNan);
         case eImageBitDepthFloat:
             return checkForNaNsForDepth<float, 1>(ptrs, nComps, bounds, roi, effect, foundNan);
         case eImageBitDepthNone:
@@ -35,6 +35,7 @@
 #include "Engine/CacheEntryKeyBase.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/GPUContextPool.h"
+#include "Engine/Half.h"
 #include "Engine/Image.h"
 #include "Engine/ImageStorage.h"
 #include "Engine/ImageCacheKey.h"
@@ -203,13 +204,19 @@ struct ImagePrivate
                                      const RectI& roi,
                                      const EffectInstancePtr& renderClone);
 
-    static ActionRetCodeEnum halveImage(const void* srcPtrs[4],
-                                        int nComps,
-                                        ImageBitDepthEnum bitdepth,
-                           const RectI& srcBounds,
-                           void* dstPtrs[4],
-                           const RectI& dstBounds,
-                           const EffectInstancePtr& renderClone);
+    /**
+     * @brief Downscale the renderWindow of the dst image by 2^downscaleLevels in a single pass: each dst pixel
+     * is the average of the src pixels of its block that are within srcBounds.
+     **/
+    static ActionRetCodeEnum downscaleImage(const void* srcPtrs[4],
+                                            int nComps,
+                                            ImageBitDepthEnum bitdepth,
+                                            const RectI& srcBounds,
+                                            void* dstPtrs[4],
+                                            const RectI& dstBounds,
+                                            const RectI& renderWindow,
+                                            unsigned int downscaleLevels,
+                                            const EffectInstancePtr& renderClone);
 
     static ActionRetCodeEnum checkForNaNs(void* ptrs[4],
                                           int nComps,
@@ -245,6 +252,52 @@ struct ImagePrivate
                                           const std::bitset<4> processChannels,
                                           const RectI& roi);
 
+    /**
+     * @brief What to do with each channel of the output image when copying the unprocessed channels from the original image.
+     * This is decided once for the whole image so that each channel is then handled a scan-line at a time.
+     **/
+    struct CopyUnProcessedChannelsPlan
+    {
+        enum ChannelOpEnum
+        {
+            // The channel was processed, leave it
+            eChannelOpKeep = 0,
+
+            // Copy the channel srcChannels[k] of the original image
+            eChannelOpCopy,
+
+            // Set the channel to 0
+            eChannelOpZero,
+
+            // Set the channel to the maximum value, e.g: the alpha of an original image without alpha
+            eChannelOpOne
+        };
+
+        ChannelOpEnum ops[4];
+        int srcChannels[4];
+    };
+
+    static void makeCopyUnProcessedChannelsPlan(int originalImgNComps,
+                                                bool hasOriginalImg,
+                                                int dstImgNComps,
+                                                const std::bitset<4> processChannels,
+                                                CopyUnProcessedChannelsPlan* plan);
+
+    /**
+     * @brief Apply the plan to a scan-line of width pixels. Only the pixels [srcOffset, srcOffset + srcWidth) of the
+     * scan-line are covered by the original image, the copied channels are set to 0 elsewhere.
+     * srcPixelPtrs point to the first covered pixel.
+     **/
+    static void copyUnProcessedChannelsRow(const CopyUnProcessedChannelsPlan& plan,
+                                           ImageBitDepthEnum bitDepth,
+                                           const void* srcPixelPtrs[4],
+                                           int srcPixelStride,
+                                           int srcOffset,
+                                           int srcWidth,
+                                           void* dstPixelPtrs[4],
+                                           int dstPixelStride,
+                                           int width);
+
     static ActionRetCodeEnum copyUnprocessedChannelsCPU(const void* originalImgPtrs[4],
                                            const RectI& originalImgBounds,
                                            int originalImgNComps,
@@ -256,11 +309,51 @@ struct ImagePrivate
                                                         const RectI& roi,
                                                         const EffectInstancePtr& renderClone);
 
+    static ActionRetCodeEnum copyUnProcessedChannelsAndMaskMixCPU(const void* originalImgPtrs[4],
+                                                                  const RectI& originalImgBounds,
+                                                                  int originalImgNComps,
+                                                                  const void* maskImgPtrs[4],
+                                                                  const RectI& maskImgBounds,
+                                                                  void* dstImgPtrs[4],
+                                                                  ImageBitDepthEnum dstImgBitDepth,
+                                                                  int dstImgNComps,
+                                                                  const RectI& dstBounds,
+                                                                  const std::bitset<4> processChannels,
+                                                                  bool copyUnProcessed,
+                                                                  bool doMix,
+                                                                  double mix,
+                                                                  bool invertMask,
+                                                                  const RectI& roi,
+                                                                  const EffectInstancePtr& renderClone);
+
+    /**
+     * @brief Same as copyUnprocessedChannelsGL followed by applyMaskMixGL, in a single pass
+     * @see OSGLContext::getOrCreatePostProcessShader
+     **/
+    static void copyUnProcessedChannelsAndMaskMixGL(const GLImageStoragePtr& originalTexture,
+                                                    const GLImageStoragePtr& maskTexture,
+                                                    const GLImageStoragePtr& dstTexture,
+                                                    const std::bitset<4> processChannels,
+                                                    bool copyUnProcessed,
+                                                    bool doMix,
+                                                    double mix,
+                                                    bool invertMask,
+                                                    const RectI& roi);
+
     static void copyGLTexture(const GLTexturePtr& from,
                               const GLTexturePtr& to,
                               const RectI& roi,
                               const OSGLContextPtr& glContext);
 
+    /**
+     * @brief Render the roi of dstTexture, given at half the scale of srcTexture, with a box filter: each dst pixel is the
+     * average of the 2x2 src pixels it covers that are within the bounds of srcTexture.
+     * Both textures must belong to the same context.
+     **/
+    static void halveGLTexture(const GLImageStoragePtr& srcTexture,
+                               const GLImageStoragePtr& dstTexture,
+                               const RectI& roi);
+
 
     static ActionRetCodeEnum convertRGBAPackedCPUBufferToGLTexture(const float* srcData,
                                                                    const RectI& srcBounds,
@@ -276,6 +369,14 @@ struct ImagePrivate
                                                                    int dstNComps,
                                                                    const OSGLContextPtr& glContext);
 
+    /**
+     * @brief Read the whole texture of the storage into a pixel pack buffer without waiting for the GPU.
+     * The next conversion of the texture to a CPU buffer maps this buffer instead of reading the texture.
+     **/
+    static void startGLTextureReadback(const GLImageStoragePtr& storage);
+
+    static void discardGLTextureReadback(const GLImageStoragePtr& storage);
+
     static ActionRetCodeEnum applyCPUPixelShader(const RectI& roi,
                                                  const void* customData, 
                                                  const EffectInstancePtr& renderClone,
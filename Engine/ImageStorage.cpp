@@ -26,20 +26,146 @@
 
 #include "ImageStorage.h"
 
+#include <algorithm>
+#include <cstring>
+#include <list>
+
 #include <QMutex>
 #include <QThread>
 #include <QCoreApplication>
 
 #include "Engine/AppManager.h"
 #include "Engine/Cache.h"
+#include "Engine/CacheStats.h"
+#include "Engine/ImageBufferPool.h"
+#include "Engine/MemoryInfo.h"
 #include "Engine/OSGLContext.h"
+#include "Engine/OSGLFunctions.h"
 #include "Engine/RamBuffer.h"
 #include "Engine/Texture.h"
+#include "Engine/ThreadPlacement.h"
 
 
 NATRON_NAMESPACE_ENTER
 
 
+struct MemoryBudgetPrivate
+{
+    mutable QMutex lock;
+    std::size_t limit;
+
+    // RAM and OpenGL textures
+    std::size_t allocated, glAllocated;
+    std::size_t peak, glPeak;
+    mutable QMutex exceededRenderMutex;
+
+    MemoryBudgetPrivate()
+    : lock()
+    , limit(0)
+    , allocated(0)
+    , glAllocated(0)
+    , peak(0)
+    , glPeak(0)
+    , exceededRenderMutex(QMutex::Recursive)
+    {
+
+    }
+};
+
+MemoryBudget::MemoryBudget()
+: _imp(new MemoryBudgetPrivate())
+{
+
+}
+
+MemoryBudget::~MemoryBudget()
+{
+
+}
+
+void
+MemoryBudget::setLimit(std::size_t nBytes)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->limit = nBytes;
+}
+
+std::size_t
+MemoryBudget::getLimit() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->limit;
+}
+
+std::size_t
+MemoryBudget::getAllocatedBytes(StorageModeEnum storage) const
+{
+    QMutexLocker k(&_imp->lock);
+    return storage == eStorageModeGLTex ? _imp->glAllocated : _imp->allocated;
+}
+
+std::size_t
+MemoryBudget::getPeakAllocatedBytes(StorageModeEnum storage) const
+{
+    QMutexLocker k(&_imp->lock);
+    return storage == eStorageModeGLTex ? _imp->glPeak : _imp->peak;
+}
+
+void
+MemoryBudget::resetPeaks()
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->peak = _imp->allocated;
+    _imp->glPeak = _imp->glAllocated;
+}
+
+bool
+MemoryBudget::isExceeded() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->limit > 0 && _imp->allocated > _imp->limit;
+}
+
+void
+MemoryBudget::addAllocation(std::size_t nBytes, StorageModeEnum storage)
+{
+    QMutexLocker k(&_imp->lock);
+    if (storage == eStorageModeGLTex) {
+        _imp->glAllocated += nBytes;
+        _imp->glPeak = std::max(_imp->glPeak, _imp->glAllocated);
+    } else {
+        _imp->allocated += nBytes;
+        _imp->peak = std::max(_imp->peak, _imp->allocated);
+    }
+}
+
+void
+MemoryBudget::removeAllocation(std::size_t nBytes, StorageModeEnum storage)
+{
+    QMutexLocker k(&_imp->lock);
+    std::size_t& allocated = storage == eStorageModeGLTex ? _imp->glAllocated : _imp->allocated;
+    assert(allocated >= nBytes);
+    allocated -= std::min(nBytes, allocated);
+}
+
+QMutex*
+MemoryBudget::getExceededRenderMutex() const
+{
+    return &_imp->exceededRenderMutex;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+MemoryBudget&
+getProcessBudget()
+{
+    static MemoryBudget budget;
+
+    return budget;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 struct ImageStorageBasePrivate
 {
     bool allocated;
@@ -47,14 +173,42 @@ struct ImageStorageBasePrivate
     ImageBitDepthEnum bitdepth;
     boost::shared_ptr<AllocateMemoryArgs> allocArgs;
 
+    // The budgets the memory of this storage is charged to, in addition to the process budget, protected by allocatedLock
+    std::list<MemoryBudgetPtr> budgets;
+    std::size_t budgetedBytes;
+    StorageModeEnum budgetedStorage;
+
     ImageStorageBasePrivate()
     : allocated(false)
     , allocatedLock()
     , bitdepth()
     , allocArgs()
+    , budgets()
+    , budgetedBytes(0)
+    , budgetedStorage(eStorageModeRAM)
     {
 
     }
+
+    void releaseBudgets()
+    {
+        std::list<MemoryBudgetPtr> toRelease;
+        std::size_t nBytes;
+        StorageModeEnum storage;
+        {
+            QMutexLocker k(&allocatedLock);
+            toRelease.swap(budgets);
+            nBytes = budgetedBytes;
+            budgetedBytes = 0;
+            storage = budgetedStorage;
+        }
+        if (nBytes > 0) {
+            getProcessBudget().removeAllocation(nBytes, storage);
+        }
+        for (std::list<MemoryBudgetPtr>::const_iterator it = toRelease.begin(); it != toRelease.end(); ++it) {
+            (*it)->removeAllocation(nBytes, storage);
+        }
+    }
 };
 
 ImageStorageBase::ImageStorageBase()
@@ -65,7 +219,7 @@ ImageStorageBase::ImageStorageBase()
 
 ImageStorageBase::~ImageStorageBase()
 {
-
+    _imp->releaseBudgets();
 }
 
 ImageBitDepthEnum
@@ -128,13 +282,35 @@ ImageStorageBase::allocateMemory(const AllocateMemoryArgs& args)
     _imp->bitdepth = args.bitDepth;
     allocateMemoryImpl(args);
 
+    // RAM and textures are charged to the budgets, the limit of a budget only applies to RAM
+    std::size_t nBytes = 0;
+    StorageModeEnum storage = getStorageMode();
+    if ( (storage == eStorageModeRAM) || (storage == eStorageModeGLTex) ) {
+        nBytes = getBufferSize();
+        getProcessBudget().addAllocation(nBytes, storage);
+        for (std::list<MemoryBudgetPtr>::const_iterator it = args.budgets.begin(); it != args.budgets.end(); ++it) {
+            (*it)->addAllocation(nBytes, storage);
+        }
+    }
+
     {
         QMutexLocker k(&_imp->allocatedLock);
         _imp->allocated = true;
+        if (nBytes > 0) {
+            _imp->budgets = args.budgets;
+            _imp->budgetedBytes = nBytes;
+            _imp->budgetedStorage = storage;
+        }
     }
 
 }
 
+const MemoryBudget&
+ImageStorageBase::getProcessMemoryBudget()
+{
+    return getProcessBudget();
+}
+
 void
 ImageStorageBase::deallocateMemory()
 {
@@ -145,6 +321,8 @@ ImageStorageBase::deallocateMemory()
 
     deallocateMemoryImpl();
 
+    _imp->releaseBudgets();
+
 }
 
 
@@ -155,6 +333,9 @@ struct RAMImageStoragePrivate
     // Set if externalBuffer is not set
     boost::scoped_ptr<RamBuffer<char> > buffer;
 
+    // The size of the image in buffer, which may be larger, @see ImageBufferPool::getSizeClass
+    std::size_t bufferSize;
+
     // Set if buffer is not set
     void* externalBuffer;
     std::size_t externalBufferSize;
@@ -167,6 +348,7 @@ struct RAMImageStoragePrivate
 
     RAMImageStoragePrivate()
     : buffer()
+    , bufferSize(0)
     , externalBuffer(0)
     , externalBufferSize(0)
     , externalBufferFreeFunc(0)
@@ -188,7 +370,12 @@ RAMImageStorage::RAMImageStorage()
 
 RAMImageStorage::~RAMImageStorage()
 {
-
+    if (_imp->buffer) {
+        ImageBufferPool* pool = appPTR ? appPTR->getImageBufferPool() : 0;
+        if (pool) {
+            pool->releaseBuffer(_imp->buffer.get());
+        }
+    }
 }
 
 RectI
@@ -219,7 +406,8 @@ std::size_t
 RAMImageStorage::getBufferSize() const
 {
     if (_imp->buffer) {
-        return _imp->buffer->size();
+        // The buffer may be larger if it was allocated for the ImageBufferPool
+        return _imp->bufferSize;
     } else if (_imp->externalBuffer) {
         return _imp->externalBufferSize;
     } else {
@@ -277,8 +465,36 @@ RAMImageStorage::allocateMemoryImpl(const AllocateMemoryArgs& args)
 
         nBytes *= ramArgs->bounds.width();
         nBytes *= ramArgs->bounds.height();
+        _imp->bufferSize = nBytes;
+
+        // Large buffers are recycled through the pool: they are allocated at the size of their size class
+        ImageBufferPool* pool = appPTR ? appPTR->getImageBufferPool() : 0;
+        std::size_t sizeClass = pool ? ImageBufferPool::getSizeClass(nBytes) : 0;
+        bool recycled = false;
+        if (sizeClass) {
+            recycled = pool->takeBuffer(nBytes, _imp->buffer.get());
+            CacheStats* stats = appPTR->getCacheStats();
+            if (stats) {
+                stats->addLookup(ramArgs->cacheStatsHolderID, eCacheTierImageBufferPool, recycled);
+            }
+        }
+        if (recycled) {
+            if (ramArgs->zeroInitialized) {
+                std::memset(_imp->buffer->getData(), 0, nBytes);
+            }
+        } else {
+            std::size_t allocSize = sizeClass ? sizeClass : nBytes;
+            if (ramArgs->zeroInitialized) {
+                _imp->buffer->resizeZeroed(allocSize);
+            } else {
+                _imp->buffer->resize(allocSize);
+            }
+        }
 
-        _imp->buffer->resize(nBytes);
+        // When the render threads are bound to NUMA nodes, the pages should live on the node of the thread that renders them
+        if (ThreadPlacement::getPolicy() != eThreadPlacementPolicyNone) {
+            adviseNUMALocal(_imp->buffer->getData(), nBytes);
+        }
     }
 }
 
@@ -286,6 +502,11 @@ void
 RAMImageStorage::deallocateMemoryImpl()
 {
     if (_imp->buffer) {
+        ImageBufferPool* pool = appPTR ? appPTR->getImageBufferPool() : 0;
+        if (pool) {
+            // Keep the memory for another image of the same size class
+            pool->releaseBuffer(_imp->buffer.get());
+        }
         _imp->buffer.reset();
     } else if (_imp->externalBuffer) {
         if (_imp->externalBufferFreeFunc) {
@@ -303,7 +524,7 @@ RAMImageStorage::canSoftCopy(const ImageStorageBase& other)
         if (!isRamStorage->_imp->buffer.get() || !_imp->buffer.get()) {
             return false;
         }
-        return isRamStorage->_imp->buffer->size() == _imp->buffer->size();
+        return isRamStorage->_imp->bufferSize == _imp->bufferSize;
     } else {
         return false;
     }
@@ -327,12 +548,36 @@ struct GLImageStoragePrivate
     OSGLContextWPtr glContext;
     GLTexturePtr texture;
 
+    // The pixel pack buffer of a pending asynchronous readback of the texture
+    U32 readbackPBO;
+
+    // The size of readbackPBO accounted to the context
+    std::size_t readbackPBOBytes;
+
     GLImageStoragePrivate()
     : glContext()
     , texture()
+    , readbackPBO(0)
+    , readbackPBOBytes(0)
     {
 
     }
+
+    // The context must be current
+    void releaseReadbackBuffer(const OSGLContextPtr& context)
+    {
+        if (!readbackPBO) {
+            return;
+        }
+        if ( context->isGPUContext() ) {
+            GL_GPU::DeleteBuffers(1, &readbackPBO);
+        } else {
+            GL_CPU::DeleteBuffers(1, &readbackPBO);
+        }
+        readbackPBO = 0;
+        context->removeVideoMemoryAllocation(readbackPBOBytes);
+        readbackPBOBytes = 0;
+    }
 };
 
 
@@ -354,6 +599,8 @@ GLImageStorage::~GLImageStorage()
             if (context) {
                 attacher = OSGLContextAttacher::create(context);
                 attacher->attach();
+                _imp->releaseReadbackBuffer(context);
+                context->releasePooledTexture(_imp->texture);
             }
             _imp->texture.reset();
         }
@@ -421,6 +668,18 @@ GLImageStorage::allocateMemoryImpl(const AllocateMemoryArgs& args)
     glType = GL_FLOAT;
 
 
+    // Recycle a texture of the same size released by another image to avoid a glTexImage2D call
+    _imp->texture = glArgs->glContext->takePooledTexture(glArgs->textureTarget, glArgs->bounds.width(), glArgs->bounds.height(), internalFormat);
+    if (_imp->texture) {
+        _imp->texture->reuseForBounds(glArgs->bounds);
+        return;
+    }
+
+    // Make room before allocating: when the budget is exceeded the driver pages textures out or fails.
+    // The texture is allocated anyway, the renders check the budget before choosing OpenGL.
+    const std::size_t textureBytes = (std::size_t)glArgs->bounds.area() * 4 * sizeof(float);
+    glArgs->glContext->reserveVideoMemory(textureBytes);
+
     _imp->texture = boost::make_shared<Texture>(glArgs->textureTarget,
                                                 GL_NONE,
                                                 GL_NONE,
@@ -434,6 +693,9 @@ GLImageStorage::allocateMemoryImpl(const AllocateMemoryArgs& args)
 
     // This calls glTexImage2D and allocates a RGBA image
     _imp->texture->ensureTextureHasSize(glArgs->bounds, 0);
+
+    // Released by OSGLContext when the texture leaves the pool
+    glArgs->glContext->addVideoMemoryAllocation( _imp->texture->getSize() );
 }
 
 void
@@ -453,6 +715,8 @@ GLImageStorage::deallocateMemoryImpl()
         // Ensure the context is current to the thread
         OSGLContextAttacherPtr attacher = OSGLContextAttacher::create(glContext);
         attacher->attach();
+        _imp->releaseReadbackBuffer(glContext);
+        glContext->releasePooledTexture(_imp->texture);
         _imp->texture.reset();
     }
 
@@ -488,6 +752,27 @@ GLImageStorage::getGLTextureType() const
     return _imp->texture ? _imp->texture->getGLType() : 0;
 }
 
+U32
+GLImageStorage::getPendingReadbackBuffer() const
+{
+    return _imp->readbackPBO;
+}
+
+void
+GLImageStorage::setPendingReadbackBuffer(U32 pboID)
+{
+    _imp->readbackPBO = pboID;
+
+    // The buffer has the size of the texture
+    OSGLContextPtr context = _imp->glContext.lock();
+    std::size_t nBytes = pboID ? getBufferSize() : 0;
+    if ( context && (nBytes != _imp->readbackPBOBytes) ) {
+        context->removeVideoMemoryAllocation(_imp->readbackPBOBytes);
+        context->addVideoMemoryAllocation(nBytes);
+    }
+    _imp->readbackPBOBytes = nBytes;
+}
+
 
 
 
@@ -28,6 +28,13 @@
 
 #include "Global/Macros.h"
 
+#include <list>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
 #include "Global/GlobalDefines.h"
 
 #include "Engine/CacheEntryBase.h"
@@ -36,6 +43,63 @@
 
 NATRON_NAMESPACE_ENTER
 
+/**
+ * @brief Accounts for the memory allocated by the image storages charged to it, e.g. by a node or a render.
+ * RAM and OpenGL textures are accounted separately, along with the peak of each since the last call to resetPeaks().
+ * When the RAM limit is exceeded, the renders charged to this budget should reduce their memory usage.
+ * This class is thread-safe.
+ **/
+struct MemoryBudgetPrivate;
+class MemoryBudget
+{
+public:
+
+    MemoryBudget();
+
+    ~MemoryBudget();
+
+    /**
+     * @brief Set the maximum number of bytes that may be charged to this budget, 0 meaning unlimited
+     **/
+    void setLimit(std::size_t nBytes);
+
+    std::size_t getLimit() const;
+
+    /**
+     * @brief Returns the number of bytes currently charged to this budget for the given storage
+     **/
+    std::size_t getAllocatedBytes(StorageModeEnum storage = eStorageModeRAM) const;
+
+    /**
+     * @brief Returns the maximum number of bytes charged at once to this budget for the given storage
+     * since it was created or since the last call to resetPeaks()
+     **/
+    std::size_t getPeakAllocatedBytes(StorageModeEnum storage = eStorageModeRAM) const;
+
+    /**
+     * @brief Set the peaks to the number of bytes currently allocated
+     **/
+    void resetPeaks();
+
+    /**
+     * @brief Returns true if a limit is set and the allocated RAM exceeds it
+     **/
+    bool isExceeded() const;
+
+    void addAllocation(std::size_t nBytes, StorageModeEnum storage = eStorageModeRAM);
+
+    void removeAllocation(std::size_t nBytes, StorageModeEnum storage = eStorageModeRAM);
+
+    /**
+     * @brief Renders that exceed the budget are serialized on this mutex so that
+     * only one of them allocates memory at a time.
+     **/
+    QMutex* getExceededRenderMutex() const;
+
+private:
+
+    boost::scoped_ptr<MemoryBudgetPrivate> _imp;
+};
 
 /**
  * @brief Sub-class this class to pass custom args to the allocateMemory() function of
@@ -47,6 +111,7 @@ public:
 
     AllocateMemoryArgs()
     : bitDepth(eImageBitDepthNone)
+    , budgets()
     {
 
     }
@@ -59,6 +124,9 @@ public:
     // The bitdpeth of the memory buffer. This information is needed for the cache
     // in order to know what memory chunk is allocated
     ImageBitDepthEnum bitDepth;
+
+    // The budgets the memory of the buffer is charged to until it is deallocated
+    std::list<MemoryBudgetPtr> budgets;
 };
 
 
@@ -98,6 +166,11 @@ public:
      **/
     bool isAllocated() const;
 
+    /**
+     * @brief Returns the budget to which all the image storages of the process in RAM and in OpenGL textures are charged
+     **/
+    static const MemoryBudget& getProcessMemoryBudget();
+
     /**
      * @brief Set arguments to be passed to allocateMemory() later on.
      * Once allocateMemoryFromSetArgs the arguments will be removed.
@@ -176,6 +249,8 @@ public:
     , externalBuffer(0)
     , externalBufferSize(0)
     , externalBufferFreeFunc(0)
+    , zeroInitialized(false)
+    , cacheStatsHolderID(0)
     {
 
     }
@@ -201,6 +276,12 @@ public:
     // Ptr to a func to delete the external buffer
     ExternalBufferFreeFunction externalBufferFreeFunc;
 
+    // If true, the allocated buffer is cleared to 0. Ignored for external buffers.
+    bool zeroInitialized;
+
+    // The holder to which lookups in the ImageBufferPool are accounted, @see CacheStats
+    U64 cacheStatsHolderID;
+
 };
 
 /**
@@ -304,6 +385,13 @@ public:
 
     int getGLTextureType() const;
 
+    /**
+     * @brief The pixel pack buffer into which the whole texture is being read asynchronously, or 0 if none.
+     * The buffer belongs to this storage and is deleted with the texture. @see Image::startGPUReadback
+     **/
+    U32 getPendingReadbackBuffer() const;
+    void setPendingReadbackBuffer(U32 pboID);
+
 private:
 
     virtual void allocateMemoryImpl(const AllocateMemoryArgs& args) OVERRIDE FINAL;
@@ -193,124 +193,203 @@ ImageTilesState::getABCDRectangles(const RectI& srcBounds, const RectI& biggerBo
 
 } // getABCDRectangles
 
-RectI
-ImageTilesState::getMinimalBboxToRenderFromTilesState(const RectI& roi, const TileStateHeader& stateMap)
+// Returns the bits [begin, end[ of the word at wordIndex in a bit range
+static inline U64
+getRangeMask(int wordIndex, int begin, int end)
 {
-
-    if (stateMap.state->tiles.empty()) {
-        return RectI();
+    U64 mask = ~(U64)0;
+    if (wordIndex == begin / 64) {
+        mask &= ~(U64)0 << (begin % 64);
     }
+    if ( (wordIndex == (end - 1) / 64) && (end % 64 != 0) ) {
+        mask &= ~(U64)0 >> (64 - end % 64);
+    }
+    return mask;
+}
 
-    const RectI& imageBoundsRoundedToTileSize = stateMap.state->boundsRoundedToTileSize;
-
-    assert(imageBoundsRoundedToTileSize.contains(roi));
-
-    // The roi must be rounded to the tile size and clipped the pixel RoD
-    assert(roi.x1 % stateMap.tileSizeX == 0 || roi.x1 == stateMap.state->bounds.x1);
-    assert(roi.y1 % stateMap.tileSizeY == 0 || roi.y1 == stateMap.state->bounds.y1);
-    assert(roi.x2 % stateMap.tileSizeX == 0 || roi.x2 == stateMap.state->bounds.x2);
-    assert(roi.y2 % stateMap.tileSizeY == 0 || roi.y2 == stateMap.state->bounds.y2);
-
-    RectI roiRoundedToTileSize = roi;
-    roiRoundedToTileSize.roundToTileSize(stateMap.tileSizeX, stateMap.tileSizeY);
-
-    // Search for rendered lines from bottom to top
-    for (int y = roiRoundedToTileSize.y1; y < roiRoundedToTileSize.y2; y += stateMap.tileSizeY) {
-
-        bool hasTileUnrenderedOnLine = false;
-        for (int x = roiRoundedToTileSize.x1; x < roiRoundedToTileSize.x2; x += stateMap.tileSizeX) {
-            assert(x % stateMap.tileSizeX == 0 && y % stateMap.tileSizeY == 0);
-            const TileState* tile = stateMap.getTileAt(x, y);
-            if (tile->status == eTileStatusNotRendered) {
-                hasTileUnrenderedOnLine = true;
-                break;
-            }
-        }
-        if (!hasTileUnrenderedOnLine) {
-            roiRoundedToTileSize.y1 += stateMap.tileSizeY;
-        } else {
-            break;
+// Returns true if one of the bits in [begin, end[ is set
+static inline bool
+isAnyBitSet(const U64* words, int begin, int end)
+{
+    if (begin >= end) {
+        return false;
+    }
+    for (int w = begin / 64; w <= (end - 1) / 64; ++w) {
+        if ( words[w] & getRangeMask(w, begin, end) ) {
+            return true;
         }
     }
+    return false;
+}
 
-    // Search for rendered lines from top to bottom
-    for (int y = roiRoundedToTileSize.y2 - stateMap.tileSizeY; y >= roiRoundedToTileSize.y1; y -= stateMap.tileSizeY) {
+// Returns true if one of the bits in [begin, end[ is not set
+static inline bool
+isAnyBitCleared(const U64* words, int begin, int end)
+{
+    if (begin >= end) {
+        return false;
+    }
+    for (int w = begin / 64; w <= (end - 1) / 64; ++w) {
+        U64 mask = getRangeMask(w, begin, end);
+        if ( (words[w] & mask) != mask ) {
+            return true;
+        }
+    }
+    return false;
+}
 
-        bool hasTileUnrenderedOnLine = false;
-        for (int x = roiRoundedToTileSize.x1; x < roiRoundedToTileSize.x2; x += stateMap.tileSizeX) {
-            assert(x % stateMap.tileSizeX == 0 && y % stateMap.tileSizeY == 0);
-            const TileState* tile = stateMap.getTileAt(x, y);
+TileStatusBitmap::TileStatusBitmap(const TileStateHeader& stateMap, const RectI& roiRoundedToTileSize)
+: _nCols(0)
+, _nRows(0)
+, _wordsPerRow(0)
+, _wordsPerCol(0)
+, _rows()
+, _cols()
+{
+    if ( roiRoundedToTileSize.isNull() || stateMap.state->tiles.empty() ) {
+        return;
+    }
+    assert(stateMap.state->boundsRoundedToTileSize.contains(roiRoundedToTileSize));
+    _nCols = roiRoundedToTileSize.width() / stateMap.tileSizeX;
+    _nRows = roiRoundedToTileSize.height() / stateMap.tileSizeY;
+    _wordsPerRow = (_nCols + 63) / 64;
+    _wordsPerCol = (_nRows + 63) / 64;
+    _rows.resize(_nRows * _wordsPerRow);
+    _cols.resize(_nCols * _wordsPerCol);
+
+    for (int r = 0; r < _nRows; ++r) {
+        // The tiles of a row are contiguous in the state map
+        const TileState* tile = stateMap.getTileAt(roiRoundedToTileSize.x1, roiRoundedToTileSize.y1 + r * stateMap.tileSizeY);
+        assert(tile);
+        U64* rowWords = &_rows[r * _wordsPerRow];
+        for (int c = 0; c < _nCols; ++c, ++tile) {
             if (tile->status == eTileStatusNotRendered) {
-                hasTileUnrenderedOnLine = true;
-                break;
+                rowWords[c / 64] |= (U64)1 << (c % 64);
+                _cols[c * _wordsPerCol + r / 64] |= (U64)1 << (r % 64);
             }
         }
-        if (!hasTileUnrenderedOnLine) {
-            roiRoundedToTileSize.y2 -= stateMap.tileSizeY;
-        } else {
-            break;
-        }
     }
+}
+
+bool
+TileStatusBitmap::rowHasUnrenderedTile(int row, int col1, int col2) const
+{
+    assert(row >= 0 && row < _nRows && col1 >= 0 && col2 <= _nCols);
+    return isAnyBitSet(&_rows[row * _wordsPerRow], col1, col2);
+}
+
+bool
+TileStatusBitmap::rowHasRenderedTile(int row, int col1, int col2) const
+{
+    assert(row >= 0 && row < _nRows && col1 >= 0 && col2 <= _nCols);
+    return isAnyBitCleared(&_rows[row * _wordsPerRow], col1, col2);
+}
 
-    // Avoid making roiRoundedToTileSize.width() iterations for nothing
-    if (roiRoundedToTileSize.isNull()) {
-        return roiRoundedToTileSize;
+bool
+TileStatusBitmap::columnHasUnrenderedTile(int col, int row1, int row2) const
+{
+    assert(col >= 0 && col < _nCols && row1 >= 0 && row2 <= _nRows);
+    return isAnyBitSet(&_cols[col * _wordsPerCol], row1, row2);
+}
+
+bool
+TileStatusBitmap::columnHasRenderedTile(int col, int row1, int row2) const
+{
+    assert(col >= 0 && col < _nCols && row1 >= 0 && row2 <= _nRows);
+    return isAnyBitCleared(&_cols[col * _wordsPerCol], row1, row2);
+}
+
+// A rectangle of tiles in the columns [c1, c2[ and rows [r1, r2[ of a TileStatusBitmap
+struct TileRange
+{
+    int c1, r1, c2, r2;
+
+    bool isNull() const
+    {
+        return c1 >= c2 || r1 >= r2;
     }
+};
 
+// Shrinks the range to the bounding box of its unrendered tiles
+static void
+shrinkToUnrenderedTiles(const TileStatusBitmap& bitmap, TileRange* range)
+{
+    // Search for rendered lines from bottom to top
+    while ( range->r1 < range->r2 && !bitmap.rowHasUnrenderedTile(range->r1, range->c1, range->c2) ) {
+        ++range->r1;
+    }
 
-    // Search for rendered columns from left to right
-    for (int x = roiRoundedToTileSize.x1; x < roiRoundedToTileSize.x2; x += stateMap.tileSizeX) {
+    // Search for rendered lines from top to bottom
+    while ( range->r1 < range->r2 && !bitmap.rowHasUnrenderedTile(range->r2 - 1, range->c1, range->c2) ) {
+        --range->r2;
+    }
 
-        bool hasTileUnrenderedOnCol = false;
-        for (int y = roiRoundedToTileSize.y1; y < roiRoundedToTileSize.y2; y += stateMap.tileSizeY) {
-            assert(x % stateMap.tileSizeX == 0 && y % stateMap.tileSizeY == 0);
-            const TileState* tile = stateMap.getTileAt(x, y);
-            if (tile->status == eTileStatusNotRendered) {
-                hasTileUnrenderedOnCol = true;
-                break;
-            }
-        }
-        if (!hasTileUnrenderedOnCol) {
-            roiRoundedToTileSize.x1 += stateMap.tileSizeX;
-        } else {
-            break;
-        }
+    // Avoid making width iterations for nothing
+    if ( range->isNull() ) {
+        return;
     }
 
-    // Avoid making roiRoundedToTileSize.width() iterations for nothing
-    if (roiRoundedToTileSize.isNull()) {
-        return roiRoundedToTileSize;
+    // Search for rendered columns from left to right
+    while ( range->c1 < range->c2 && !bitmap.columnHasUnrenderedTile(range->c1, range->r1, range->r2) ) {
+        ++range->c1;
     }
 
     // Search for rendered columns from right to left
-    for (int x = roiRoundedToTileSize.x2 - stateMap.tileSizeX; x >= roiRoundedToTileSize.x1; x -= stateMap.tileSizeX) {
+    while ( range->c1 < range->c2 && !bitmap.columnHasUnrenderedTile(range->c2 - 1, range->r1, range->r2) ) {
+        --range->c2;
+    }
+}
 
-        bool hasTileUnrenderedOnCol = false;
-        for (int y = roiRoundedToTileSize.y1; y < roiRoundedToTileSize.y2; y += stateMap.tileSizeY) {
-            assert(x % stateMap.tileSizeX == 0 && y % stateMap.tileSizeY == 0);
-            const TileState* tile = stateMap.getTileAt(x, y);
-            if (tile->status == eTileStatusNotRendered) {
-                hasTileUnrenderedOnCol = true;
-                break;
-            }
-        }
-        if (!hasTileUnrenderedOnCol) {
-            roiRoundedToTileSize.x2 -= stateMap.tileSizeX;
-        } else {
-            break;
-        }
+// Converts a range of tiles of the bitmap built over roiRoundedToTileSize to pixels, clipped to the bounds of the image
+static RectI
+tileRangeToPixels(const TileRange& range, const RectI& roiRoundedToTileSize, const TileStateHeader& stateMap)
+{
+    if ( range.isNull() ) {
+        return RectI();
     }
+    RectI rect;
+    rect.x1 = roiRoundedToTileSize.x1 + range.c1 * stateMap.tileSizeX;
+    rect.x2 = roiRoundedToTileSize.x1 + range.c2 * stateMap.tileSizeX;
+    rect.y1 = roiRoundedToTileSize.y1 + range.r1 * stateMap.tileSizeY;
+    rect.y2 = roiRoundedToTileSize.y1 + range.r2 * stateMap.tileSizeY;
 
     // Intersect the result to the bounds (because the tiles are rounded to tile size)
     RectI ret;
-    roiRoundedToTileSize.intersect(stateMap.state->bounds, &ret);
+    rect.intersect(stateMap.state->bounds, &ret);
     return ret;
+}
+
+RectI
+ImageTilesState::getMinimalBboxToRenderFromTilesState(const RectI& roi, const TileStateHeader& stateMap)
+{
+
+    if (stateMap.state->tiles.empty()) {
+        return RectI();
+    }
+
+    const RectI& imageBoundsRoundedToTileSize = stateMap.state->boundsRoundedToTileSize;
+
+    assert(imageBoundsRoundedToTileSize.contains(roi));
+    (void)imageBoundsRoundedToTileSize;
+
+    // The roi must be rounded to the tile size and clipped the pixel RoD
+    assert(roi.x1 % stateMap.tileSizeX == 0 || roi.x1 == stateMap.state->bounds.x1);
+    assert(roi.y1 % stateMap.tileSizeY == 0 || roi.y1 == stateMap.state->bounds.y1);
+    assert(roi.x2 % stateMap.tileSizeX == 0 || roi.x2 == stateMap.state->bounds.x2);
+    assert(roi.y2 % stateMap.tileSizeY == 0 || roi.y2 == stateMap.state->bounds.y2);
+
+    RectI roiRoundedToTileSize = roi;
+    roiRoundedToTileSize.roundToTileSize(stateMap.tileSizeX, stateMap.tileSizeY);
 
+    TileStatusBitmap bitmap(stateMap, roiRoundedToTileSize);
+    TileRange range = {0, 0, bitmap.getNumColumns(), bitmap.getNumRows()};
+    shrinkToUnrenderedTiles(bitmap, &range);
+    return tileRangeToPixels(range, roiRoundedToTileSize, stateMap);
 
 } // getMinimalBboxToRenderFromTilesState
 
 void
-ImageTilesState::getMinimalRectsToRenderFromTilesState(const RectI& roi, const TileStateHeader& stateMap, std::list<RectI>* rectsToRender)
+ImageTilesState::getMinimalRectsToRenderFromTilesState(const RectI& roi, const TileStateHeader& stateMap, RectIVec* rectsToRender)
 {
     if (stateMap.state->tiles.empty()) {
         return;
@@ -322,14 +401,19 @@ ImageTilesState::getMinimalRectsToRenderFromTilesState(const RectI& roi, const T
     assert(roi.x2 % stateMap.tileSizeX == 0 || roi.x2 == stateMap.state->bounds.x2);
     assert(roi.y2 % stateMap.tileSizeY == 0 || roi.y2 == stateMap.state->bounds.y2);
 
-    RectI bboxM = getMinimalBboxToRenderFromTilesState(roi, stateMap);
-    if (bboxM.isNull()) {
+    RectI roiRoundedToTileSize = roi;
+    roiRoundedToTileSize.roundToTileSize(stateMap.tileSizeX, stateMap.tileSizeY);
+
+    // All the searches below are done on the same snapshot of the tiles
+    TileStatusBitmap bitmap(stateMap, roiRoundedToTileSize);
+
+    // The smallest enclosing bounding box of the tiles to render
+    TileRange bboxM = {0, 0, bitmap.getNumColumns(), bitmap.getNumRows()};
+    shrinkToUnrenderedTiles(bitmap, &bboxM);
+    if ( bboxM.isNull() ) {
         return;
     }
 
-    // Round to the tile size because the tile states is only valid for tiles
-    bboxM.roundToTileSize(stateMap.tileSizeX, stateMap.tileSizeY);
-
     // optimization by Fred, Jan 31, 2014
     //
     // Now that we have the smallest enclosing bounding box,
@@ -353,152 +437,53 @@ ImageTilesState::getMinimalRectsToRenderFromTilesState(const RectI& roi, const T
 
     // First, find if there's an "A" rectangle, and push it to the result
     //find bottom
-    RectI bboxX = bboxM;
-    RectI bboxA = bboxX;
-    bboxA.y2 = bboxA.y1;
-    for (int y = bboxX.y1; y < bboxX.y2; y += stateMap.tileSizeY) {
-        bool hasRenderedTileOnLine = false;
-        for (int x = bboxX.x1; x < bboxX.x2; x += stateMap.tileSizeX) {
-            assert(x % stateMap.tileSizeX == 0 && y % stateMap.tileSizeY == 0);
-            const TileState* tile = stateMap.getTileAt(x, y);
-            if (tile->status != eTileStatusNotRendered) {
-                hasRenderedTileOnLine = true;
-                break;
-            }
-        }
-        if (hasRenderedTileOnLine) {
-            break;
-        } else {
-            bboxX.y1 += stateMap.tileSizeY;
-            bboxA.y2 = bboxX.y1;
-        }
+    TileRange bboxX = bboxM;
+    while ( bboxX.r1 < bboxX.r2 && !bitmap.rowHasRenderedTile(bboxX.r1, bboxX.c1, bboxX.c2) ) {
+        ++bboxX.r1;
     }
+    TileRange bboxA = {bboxM.c1, bboxM.r1, bboxM.c2, bboxX.r1};
     if ( !bboxA.isNull() ) { // empty boxes should not be pushed
-        // Ensure the bbox lies in the bounds since we rounded to tile size earlier
-        RectI bboxAIntersected;
-        bboxA.intersect(stateMap.state->bounds, &bboxAIntersected);
-        rectsToRender->push_back(bboxAIntersected);
+        rectsToRender->push_back( tileRangeToPixels(bboxA, roiRoundedToTileSize, stateMap) );
     }
 
     // Now, find the "B" rectangle
     //find top
-    RectI bboxB = bboxX;
-    bboxB.y1 = bboxB.y2;
-
-    for (int y = bboxX.y2 - stateMap.tileSizeY; y >= bboxX.y1; y -= stateMap.tileSizeY) {
-        bool hasRenderedTileOnLine = false;
-        for (int x = bboxX.x1; x < bboxX.x2; x += stateMap.tileSizeX) {
-            assert(x % stateMap.tileSizeX == 0 && y % stateMap.tileSizeY == 0);
-            const TileState* tile = stateMap.getTileAt(x, y);
-            if (tile->status != eTileStatusNotRendered) {
-                hasRenderedTileOnLine = true;
-                break;
-            }
-        }
-        if (hasRenderedTileOnLine) {
-            break;
-        } else {
-            bboxX.y2 -= stateMap.tileSizeY;
-            bboxB.y1 = bboxX.y2;
-        }
+    while ( bboxX.r1 < bboxX.r2 && !bitmap.rowHasRenderedTile(bboxX.r2 - 1, bboxX.c1, bboxX.c2) ) {
+        --bboxX.r2;
     }
-
+    TileRange bboxB = {bboxM.c1, bboxX.r2, bboxM.c2, bboxM.r2};
     if ( !bboxB.isNull() ) { // empty boxes should not be pushed
-        // Ensure the bbox lies in the bounds since we rounded to tile size earlier
-        RectI bboxBIntersected;
-        bboxB.intersect(stateMap.state->bounds, &bboxBIntersected);
-        rectsToRender->push_back(bboxBIntersected);
+        rectsToRender->push_back( tileRangeToPixels(bboxB, roiRoundedToTileSize, stateMap) );
     }
 
     //find left
-    RectI bboxC = bboxX;
-    bboxC.x2 = bboxC.x1;
-    if ( bboxX.y1 < bboxX.y2 ) {
-        for (int x = bboxX.x1; x < bboxX.x2; x += stateMap.tileSizeX) {
-            bool hasRenderedTileOnCol = false;
-            for (int y = bboxX.y1; y < bboxX.y2; y += stateMap.tileSizeY) {
-                assert(x % stateMap.tileSizeX == 0 && y % stateMap.tileSizeY == 0);
-                const TileState* tile = stateMap.getTileAt(x, y);
-                if (tile->status != eTileStatusNotRendered) {
-                    hasRenderedTileOnCol = true;
-                    break;
-                }
-
-            }
-            if (hasRenderedTileOnCol) {
-                break;
-            } else {
-                bboxX.x1 += stateMap.tileSizeX;
-                bboxC.x2 = bboxX.x1;
-            }
+    if (bboxX.r1 < bboxX.r2) {
+        while ( bboxX.c1 < bboxX.c2 && !bitmap.columnHasRenderedTile(bboxX.c1, bboxX.r1, bboxX.r2) ) {
+            ++bboxX.c1;
         }
     }
+    TileRange bboxC = {bboxM.c1, bboxX.r1, bboxX.c1, bboxX.r2};
     if ( !bboxC.isNull() ) { // empty boxes should not be pushed
-        // Ensure the bbox lies in the bounds since we rounded to tile size earlier
-        RectI bboxCIntersected;
-        bboxC.intersect(stateMap.state->bounds, &bboxCIntersected);
-        rectsToRender->push_back(bboxCIntersected);
+        rectsToRender->push_back( tileRangeToPixels(bboxC, roiRoundedToTileSize, stateMap) );
     }
 
     //find right
-    RectI bboxD = bboxX;
-    bboxD.x1 = bboxD.x2;
-    if ( bboxX.y1 < bboxX.y2 ) {
-        for (int x = bboxX.x2 - stateMap.tileSizeX; x >= bboxX.x1; x -= stateMap.tileSizeX) {
-            bool hasRenderedTileOnCol = false;
-            for (int y = bboxX.y1; y < bboxX.y2; y += stateMap.tileSizeY) {
-                assert(x % stateMap.tileSizeX == 0 && y % stateMap.tileSizeY == 0);
-                const TileState* tile = stateMap.getTileAt(x, y);
-                if (tile->status != eTileStatusNotRendered) {
-                    hasRenderedTileOnCol = true;
-                    break;
-                }
-            }
-            if (hasRenderedTileOnCol) {
-                break;
-            } else {
-                bboxX.x2 -= stateMap.tileSizeX;
-                bboxD.x1 = bboxX.x2;
-            }
+    if (bboxX.r1 < bboxX.r2) {
+        while ( bboxX.c1 < bboxX.c2 && !bitmap.columnHasRenderedTile(bboxX.c2 - 1, bboxX.r1, bboxX.r2) ) {
+            --bboxX.c2;
         }
     }
+    TileRange bboxD = {bboxX.c2, bboxX.r1, bboxM.c2, bboxX.r2};
     if ( !bboxD.isNull() ) { // empty boxes should not be pushed
-        // Ensure the bbox lies in the bounds since we rounded to tile size earlier
-        RectI bboxDIntersected;
-        bboxD.intersect(stateMap.state->bounds, &bboxDIntersected);
-        rectsToRender->push_back(bboxDIntersected);
+        rectsToRender->push_back( tileRangeToPixels(bboxD, roiRoundedToTileSize, stateMap) );
     }
 
-    assert( bboxA.bottom() == bboxM.bottom() );
-    assert( bboxA.left() == bboxM.left() );
-    assert( bboxA.right() == bboxM.right() );
-    assert( bboxA.top() == bboxX.bottom() );
-
-    assert( bboxB.top() == bboxM.top() );
-    assert( bboxB.left() == bboxM.left() );
-    assert( bboxB.right() == bboxM.right() );
-    assert( bboxB.bottom() == bboxX.top() );
-
-    assert( bboxC.top() == bboxX.top() );
-    assert( bboxC.left() == bboxM.left() );
-    assert( bboxC.right() == bboxX.left() );
-    assert( bboxC.bottom() == bboxX.bottom() );
-
-    assert( bboxD.top() == bboxX.top() );
-    assert( bboxD.left() == bboxX.right() );
-    assert( bboxD.right() == bboxM.right() );
-    assert( bboxD.bottom() == bboxX.bottom() );
-
     // get the bounding box of what's left (the X rectangle in the drawing above)
-    bboxX = getMinimalBboxToRenderFromTilesState(bboxX, stateMap);
-
+    shrinkToUnrenderedTiles(bitmap, &bboxX);
     if ( !bboxX.isNull() ) { // empty boxes should not be pushed
-        // Ensure the bbox lies in the bounds since we rounded to tile size earlier
-        RectI bboxXIntersected;
-        bboxX.intersect(stateMap.state->bounds, &bboxXIntersected);
-        rectsToRender->push_back(bboxXIntersected);
+        rectsToRender->push_back( tileRangeToPixels(bboxX, roiRoundedToTileSize, stateMap) );
     }
-    
+
 } // getMinimalRectsToRenderFromTilesState
 
 
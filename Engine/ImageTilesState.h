@@ -26,8 +26,11 @@
 #include <Python.h>
 // ***** END PYTHON BLOCK *****
 
+#include <vector>
+
 #include "Engine/EngineFwd.h"
 #include "Engine/RectI.h"
+#include "Engine/SmallVector.h"
 
 #include "IPCCommon.h"
 
@@ -47,6 +50,8 @@ GCC_DIAG_ON(unused-parameter)
 
 NATRON_NAMESPACE_ENTER
 
+// Rectangles to render: at most 5 are returned by ImageTilesState::getMinimalRectsToRenderFromTilesState, which fit inline
+typedef SmallVector<RectI, 5>::type RectIVec;
 
 struct TileInternalIndexImpl
 {
@@ -55,8 +60,8 @@ struct TileInternalIndexImpl
     // of storage: each file is of size NATRON_TILE_STORAGE_FILE_SIZE.
     U16 fileIndex;
 
-    // The index of the tile in the file: Since there are 256 buckets and each bucket has 256 tiles per file, the
-    // number of adressable tiles per bucket per file is 256
+    // The index of the tile in the file: Since there are 256 buckets and each bucket has at most 256 tiles per file
+    // (with the smallest tile size), the number of adressable tiles per bucket per file is 256
 #ifndef NATRON_CACHE_TILES_MEMORY_ALLOCATOR_CENTRALIZED
     U8 tileIndex;
 #else
@@ -210,6 +215,56 @@ public:
 };
 
 
+/**
+ * @brief A compact snapshot of the tiles of a TileStateHeader that are not rendered, over a rectangle of tiles.
+ * The TileState structs are large and spread in memory: scanning them for each row and each column is slow
+ * for very large images. The snapshot is built in a single pass and stores 1 bit per tile, both by row and by column,
+ * packed in 64-bit words so that a whole row or column of tiles is checked 64 tiles at a time.
+ * Tiles with a status of eTileStatusPending are treated as if they were rendered.
+ **/
+class TileStatusBitmap
+{
+public:
+
+    /**
+     * @brief Build the snapshot over the given rectangle which must be rounded to the tile size and contained in the
+     * rounded bounds of the state map
+     **/
+    TileStatusBitmap(const TileStateHeader& stateMap, const RectI& roiRoundedToTileSize);
+
+    int getNumColumns() const
+    {
+        return _nCols;
+    }
+
+    int getNumRows() const
+    {
+        return _nRows;
+    }
+
+    /**
+     * @brief Returns true if a tile of the given row within the columns [col1, col2[ is not rendered
+     **/
+    bool rowHasUnrenderedTile(int row, int col1, int col2) const;
+
+    /**
+     * @brief Returns true if a tile of the given row within the columns [col1, col2[ is rendered or pending
+     **/
+    bool rowHasRenderedTile(int row, int col1, int col2) const;
+
+    bool columnHasUnrenderedTile(int col, int row1, int row2) const;
+
+    bool columnHasRenderedTile(int col, int row1, int row2) const;
+
+private:
+
+    int _nCols, _nRows;
+    int _wordsPerRow, _wordsPerCol;
+
+    // Bit set if the tile is not rendered, row by row then column by column
+    std::vector<U64> _rows, _cols;
+};
+
 struct ImageTilesStatePrivate;
 
 /**
@@ -246,7 +301,7 @@ public:
      * CXXXXXXXXXXDDD
      * AAAAAAAAAAAAAA
      **/
-    static void getMinimalRectsToRenderFromTilesState(const RectI& roi, const TileStateHeader& stateMap, std::list<RectI>* rectsToRender);
+    static void getMinimalRectsToRenderFromTilesState(const RectI& roi, const TileStateHeader& stateMap, RectIVec* rectsToRender);
 
     /*
      Compute the rectangles (A,B,C,D) where to set the image to 0
@@ -0,0 +1,424 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "InteractiveLatency.h"
+
+#include <algorithm> // sort
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <sstream>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+#include "Engine/Timer.h"
+
+// An edit that did not get a render after this number of seconds did not affect the viewer: a new edit replaces it
+#define NATRON_INTERACTIVE_LATENCY_PENDING_TIMEOUT 1.
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct EditTimes
+{
+    // The time each stage was reached, or -1
+    double times[eInteractiveLatencyStageCount];
+
+    EditTimes()
+    {
+        for (int i = 0; i < eInteractiveLatencyStageCount; ++i) {
+            times[i] = -1.;
+        }
+    }
+};
+
+// A render of a viewer is identified by its scheduler and its age
+typedef std::pair<const void*, U64> RenderID;
+
+class InteractiveLatencyData
+{
+public:
+
+    QAtomicInt enabled;
+
+    TimeLapse clock;
+
+    // Protects all the members below
+    QMutex lock;
+
+    // The edit that is not attached to a render yet
+    bool hasPendingEdit;
+    EditTimes pendingEdit;
+
+    // The edits attached to a render that is not uploaded yet
+    std::map<RenderID, EditTimes> renders;
+
+    // The edits uploaded to the viewer that are not displayed yet
+    std::list<EditTimes> uploadedEdits;
+
+    // The most recent edits that were displayed, in a circular buffer
+    std::vector<EditTimes> samples;
+    std::size_t nextSample;
+
+    InteractiveLatencyData()
+    : enabled()
+    , clock()
+    , lock()
+    , hasPendingEdit(false)
+    , pendingEdit()
+    , renders()
+    , uploadedEdits()
+    , samples()
+    , nextSample(0)
+    {
+    }
+
+    double getTime() const
+    {
+        return clock.getTimeSinceCreation();
+    }
+
+    void addSample(const EditTimes& edit)
+    {
+        if (samples.size() < NATRON_INTERACTIVE_LATENCY_SAMPLES) {
+            samples.push_back(edit);
+        } else {
+            samples[nextSample] = edit;
+        }
+        nextSample = (nextSample + 1) % NATRON_INTERACTIVE_LATENCY_SAMPLES;
+    }
+};
+
+InteractiveLatencyData&
+getLatencyData()
+{
+    static InteractiveLatencyData data;
+
+    return data;
+}
+
+double
+getPercentile(const std::vector<double>& sortedValues, double percent)
+{
+    if ( sortedValues.empty() ) {
+        return 0.;
+    }
+    std::size_t rank = (std::size_t)std::ceil(sortedValues.size() * percent / 100.);
+    rank = std::max(rank, (std::size_t)1);
+
+    return sortedValues[std::min(rank, sortedValues.size()) - 1];
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+InteractiveLatency::setEnabled(bool enabled)
+{
+    getLatencyData().enabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+bool
+InteractiveLatency::isEnabled()
+{
+#if QT_VERSION < 0x050000
+    return (int)getLatencyData().enabled != 0;
+#else
+    return getLatencyData().enabled.loadAcquire() != 0;
+#endif
+}
+
+void
+InteractiveLatency::reset()
+{
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    data.hasPendingEdit = false;
+    data.renders.clear();
+    data.uploadedEdits.clear();
+    data.samples.clear();
+    data.nextSample = 0;
+}
+
+void
+InteractiveLatency::onKnobChanged()
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    double now = data.getTime();
+    if ( data.hasPendingEdit && (now - data.pendingEdit.times[eInteractiveLatencyStageKnobChanged] < NATRON_INTERACTIVE_LATENCY_PENDING_TIMEOUT) ) {
+        // The user is still waiting for the pending edit
+        return;
+    }
+    data.hasPendingEdit = true;
+    data.pendingEdit = EditTimes();
+    data.pendingEdit.times[eInteractiveLatencyStageKnobChanged] = now;
+}
+
+void
+InteractiveLatency::onHashInvalidated()
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    if ( data.hasPendingEdit && (data.pendingEdit.times[eInteractiveLatencyStageHashInvalidated] < 0) ) {
+        data.pendingEdit.times[eInteractiveLatencyStageHashInvalidated] = data.getTime();
+    }
+}
+
+void
+InteractiveLatency::onRenderRequested(const void* scheduler,
+                                      U64 renderAge)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    if (!data.hasPendingEdit) {
+        return;
+    }
+    data.pendingEdit.times[eInteractiveLatencyStageRenderRequested] = data.getTime();
+    data.renders[RenderID(scheduler, renderAge)] = data.pendingEdit;
+    data.hasPendingEdit = false;
+}
+
+void
+InteractiveLatency::onRenderStageReached(const void* scheduler,
+                                         U64 renderAge,
+                                         InteractiveLatencyStageEnum stage)
+{
+    assert(stage >= 0 && stage < eInteractiveLatencyStageCount);
+    if ( !isEnabled() ) {
+        return;
+    }
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    std::map<RenderID, EditTimes>::iterator found = data.renders.find( RenderID(scheduler, renderAge) );
+    if ( (found != data.renders.end()) && (found->second.times[stage] < 0) ) {
+        found->second.times[stage] = data.getTime();
+    }
+}
+
+void
+InteractiveLatency::onRenderDropped(const void* scheduler,
+                                    U64 renderAge)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    data.renders.erase( RenderID(scheduler, renderAge) );
+}
+
+void
+InteractiveLatency::onFrameUploaded(const void* scheduler,
+                                    U64 renderAge)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    std::map<RenderID, EditTimes>::iterator it = data.renders.lower_bound( RenderID(scheduler, 0) );
+    while ( it != data.renders.end() && (it->first.first == scheduler) && (it->first.second <= renderAge) ) {
+        if (it->first.second == renderAge) {
+            it->second.times[eInteractiveLatencyStageTextureUploaded] = data.getTime();
+            data.uploadedEdits.push_back(it->second);
+        }
+        // The older renders of this scheduler will not be displayed anymore
+        data.renders.erase(it++);
+    }
+}
+
+void
+InteractiveLatency::onFrameDisplayed()
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    if ( data.uploadedEdits.empty() ) {
+        return;
+    }
+    double now = data.getTime();
+    for (std::list<EditTimes>::iterator it = data.uploadedEdits.begin(); it != data.uploadedEdits.end(); ++it) {
+        it->times[eInteractiveLatencyStageDisplayed] = now;
+        data.addSample(*it);
+    }
+    data.uploadedEdits.clear();
+}
+
+void
+InteractiveLatency::getStats(std::vector<StageStats>* stats)
+{
+    std::vector<EditTimes> samples;
+    {
+        InteractiveLatencyData& data = getLatencyData();
+        QMutexLocker k(&data.lock);
+        samples = data.samples;
+    }
+
+    stats->resize(eInteractiveLatencyStageCount);
+    for (int i = 0; i < eInteractiveLatencyStageCount; ++i) {
+        StageStats& s = (*stats)[i];
+        s = StageStats();
+        s.name = getStageName( (InteractiveLatencyStageEnum)i );
+
+        std::vector<double> latencies;
+        double totalStepTime = 0;
+        U64 nSteps = 0;
+        for (std::size_t j = 0; j < samples.size(); ++j) {
+            const double* times = samples[j].times;
+            if (times[i] < 0) {
+                continue;
+            }
+            latencies.push_back(times[i] - times[eInteractiveLatencyStageKnobChanged]);
+
+            // The step starts at the last stage reached before this one
+            for (int p = i - 1; p >= 0; --p) {
+                if (times[p] >= 0) {
+                    totalStepTime += times[i] - times[p];
+                    ++nSteps;
+                    break;
+                }
+            }
+        }
+        std::sort( latencies.begin(), latencies.end() );
+        s.nSamples = latencies.size();
+        s.median = getPercentile(latencies, 50.);
+        s.p95 = getPercentile(latencies, 95.);
+        s.max = latencies.empty() ? 0. : latencies.back();
+        s.meanStepTime = nSteps > 0 ? totalStepTime / nSteps : 0.;
+    }
+} // getStats
+
+void
+InteractiveLatency::getHistogram(const std::vector<double>& upperBounds,
+                                 std::vector<U64>* counts)
+{
+    counts->clear();
+    counts->resize(upperBounds.size() + 1, 0);
+
+    InteractiveLatencyData& data = getLatencyData();
+    QMutexLocker k(&data.lock);
+    for (std::size_t i = 0; i < data.samples.size(); ++i) {
+        const double* times = data.samples[i].times;
+        double latency = times[eInteractiveLatencyStageDisplayed] - times[eInteractiveLatencyStageKnobChanged];
+        std::size_t bucket = std::lower_bound(upperBounds.begin(), upperBounds.end(), latency) - upperBounds.begin();
+        ++(*counts)[bucket];
+    }
+}
+
+std::string
+InteractiveLatency::getStageName(InteractiveLatencyStageEnum stage)
+{
+    switch (stage) {
+    case eInteractiveLatencyStageKnobChanged:
+        return "Knob changed";
+    case eInteractiveLatencyStageHashInvalidated:
+        return "Hash invalidated";
+    case eInteractiveLatencyStageRenderRequested:
+        return "Render requested";
+    case eInteractiveLatencyStageRenderStarted:
+        return "Render started";
+    case eInteractiveLatencyStageRenderFinished:
+        return "Render finished";
+    case eInteractiveLatencyStageTextureUploaded:
+        return "Texture uploaded";
+    case eInteractiveLatencyStageDisplayed:
+        return "Displayed";
+    case eInteractiveLatencyStageCount:
+        break;
+    }
+
+    return std::string();
+}
+
+std::string
+InteractiveLatency::getReport()
+{
+    std::vector<StageStats> stats;
+    getStats(&stats);
+
+    // Times are printed in milliseconds
+    std::stringstream ss;
+    ss << std::left << std::setw(18) << "Stage" << std::right
+       << std::setw(10) << "Edits"
+       << std::setw(16) << "Median (ms)"
+       << std::setw(16) << "95% (ms)"
+       << std::setw(16) << "Max (ms)"
+       << std::setw(16) << "Step (ms)" << '\n';
+    ss << std::fixed << std::setprecision(3);
+    for (std::size_t i = 1; i < stats.size(); ++i) {
+        const StageStats& s = stats[i];
+        ss << std::left << std::setw(18) << s.name << std::right
+           << std::setw(10) << s.nSamples
+           << std::setw(16) << s.median * 1000.
+           << std::setw(16) << s.p95 * 1000.
+           << std::setw(16) << s.max * 1000.
+           << std::setw(16) << s.meanStepTime * 1000. << '\n';
+    }
+
+    // The histogram of the total latency, in multiples of the duration of a frame at 60 fps
+    std::vector<double> upperBounds;
+    const double frameDuration = 1. / 60.;
+    for (int i = 1; i <= 32; i *= 2) {
+        upperBounds.push_back(i * frameDuration);
+    }
+    std::vector<U64> counts;
+    getHistogram(upperBounds, &counts);
+    U64 maxCount = 0;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        maxCount = std::max(maxCount, counts[i]);
+    }
+    ss << '\n' << "Edit to display latency of the last " << stats[eInteractiveLatencyStageDisplayed].nSamples << " edits:" << '\n';
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        std::stringstream range;
+        range << std::fixed << std::setprecision(0);
+        if ( i < upperBounds.size() ) {
+            range << "< " << upperBounds[i] * 1000. << " ms";
+        } else {
+            range << ">= " << upperBounds.back() * 1000. << " ms";
+        }
+        int barLength = maxCount > 0 ? (int)(counts[i] * 40 / maxCount) : 0;
+        ss << std::left << std::setw(12) << range.str() << std::right
+           << std::setw(8) << counts[i] << ' ' << std::string(barLength, '#') << '\n';
+    }
+
+    return ss.str();
+} // getReport
+
+NATRON_NAMESPACE_EXIT
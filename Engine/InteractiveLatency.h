@@ -0,0 +1,161 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_InteractiveLatency_h
+#define Engine_InteractiveLatency_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+// The statistics are computed on this number of the most recent edits
+#define NATRON_INTERACTIVE_LATENCY_SAMPLES 256
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The stages an edit of a knob by the user goes through until its result is on the screen
+ **/
+enum InteractiveLatencyStageEnum
+{
+    // The value of the knob changed: this is the origin of the latencies
+    eInteractiveLatencyStageKnobChanged = 0,
+
+    // The hash of the knob and its listeners was invalidated
+    eInteractiveLatencyStageHashInvalidated,
+
+    // The ViewerCurrentFrameRequestScheduler was asked to render the current frame
+    eInteractiveLatencyStageRenderRequested,
+
+    // The scheduler thread created the TreeRenders and launched them
+    eInteractiveLatencyStageRenderStarted,
+
+    // All the TreeRenders of the viewer inputs are finished
+    eInteractiveLatencyStageRenderFinished,
+
+    // The rendered images were uploaded to the viewer textures on the main thread
+    eInteractiveLatencyStageTextureUploaded,
+
+    // The viewer was painted with the textures and its buffers swapped
+    eInteractiveLatencyStageDisplayed,
+
+    eInteractiveLatencyStageCount
+};
+
+/**
+ * @brief Measures the latency between an edit of a knob by the user and the display of the viewer frame that reflects it,
+ * stage by stage, over the most recent edits. It is disabled by default and can be enabled from the RenderStatsDialog.
+ *
+ * The edits made while no render was requested yet are merged into the oldest one, since that is the one the user is waiting for.
+ * An edit is attached to the next render requested by a viewer, identified by the render age of its ViewerCurrentFrameRequestScheduler,
+ * and is dropped if that render is aborted or superseded by a more recent one before being displayed.
+ **/
+class InteractiveLatency
+{
+public:
+
+    struct StageStats
+    {
+        std::string name;
+
+        // The number of edits that reached this stage, among the most recent ones
+        U64 nSamples;
+
+        // The latency since the knob changed, in seconds
+        double median;
+        double p95;
+        double max;
+
+        // The mean time spent since the previous stage, in seconds
+        double meanStepTime;
+
+        StageStats()
+        : name()
+        , nSamples(0)
+        , median(0)
+        , p95(0)
+        , max(0)
+        , meanStepTime(0)
+        {
+        }
+    };
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    /**
+     * @brief Forgets all the edits, pending or measured
+     **/
+    static void reset();
+
+    static void onKnobChanged();
+
+    static void onHashInvalidated();
+
+    /**
+     * @brief Attaches the pending edit, if any, to the render of the given age of the given scheduler
+     **/
+    static void onRenderRequested(const void* scheduler, U64 renderAge);
+
+    static void onRenderStageReached(const void* scheduler, U64 renderAge, InteractiveLatencyStageEnum stage);
+
+    /**
+     * @brief The render failed, was aborted or is older than what is displayed: its edit will never be displayed
+     **/
+    static void onRenderDropped(const void* scheduler, U64 renderAge);
+
+    /**
+     * @brief The render was uploaded to the viewer. The renders of the scheduler older than renderAge are dropped.
+     **/
+    static void onFrameUploaded(const void* scheduler, U64 renderAge);
+
+    /**
+     * @brief Called by the viewer once painted: completes the measurement of the edits uploaded since the last call
+     **/
+    static void onFrameDisplayed();
+
+    static void getStats(std::vector<StageStats>* stats);
+
+    /**
+     * @brief Returns the number of recent edits whose total latency is below each of the given upper bounds in seconds,
+     * and above the previous one. The last count is the number of edits above the last bound.
+     **/
+    static void getHistogram(const std::vector<double>& upperBounds, std::vector<U64>* counts);
+
+    static std::string getStageName(InteractiveLatencyStageEnum stage);
+
+    /**
+     * @brief Returns a table of the latency of each stage followed by a histogram of the total latency
+     **/
+    static std::string getReport();
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_InteractiveLatency_h
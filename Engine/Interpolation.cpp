@@ -430,6 +430,23 @@ Interpolation::interpolate(double tcur,
                            double currentTime,
                            KeyframeTypeEnum interp,
                            KeyframeTypeEnum interpNext)
+{
+    CubicSegment segment;
+    computeCubicSegment(tcur, vcur, vcurDerivRight, vnextDerivLeft, tnext, vnext, interp, interpNext, &segment);
+
+    return evaluateCubicSegment(segment, currentTime);
+}
+
+void
+Interpolation::computeCubicSegment(double tcur,
+                                   const double vcur,              //start control point
+                                   const double vcurDerivRight, //being the derivative dv/dt at tcur
+                                   const double vnextDerivLeft, //being the derivative dv/dt at tnext
+                                   double tnext,
+                                   const double vnext,               //end control point
+                                   KeyframeTypeEnum interp,
+                                   KeyframeTypeEnum interpNext,
+                                   CubicSegment* segment)
 {
     double P0 = vcur;
     double P3 = vnext;
@@ -457,16 +474,18 @@ Interpolation::interpolate(double tcur,
         P3 = P0 + P0pr;
         tnext = tcur + 1;
     }
-    double c0, c1, c2, c3;
-    hermiteToCubicCoeffs(P0, P0pr, P3pl, P3, &c0, &c1, &c2, &c3);
+    hermiteToCubicCoeffs(P0, P0pr, P3pl, P3, &segment->c0, &segment->c1, &segment->c2, &segment->c3);
+    segment->tcur = tcur;
+    segment->tnext = tnext;
+} // computeCubicSegment
 
-    const double t = (currentTime - tcur) / (tnext - tcur);
-    double ret = cubicEval(c0, c1, c2, c3, t);
-
-    // cubicDerive: divide the result by (tnext-tcur)
+double
+Interpolation::evaluateCubicSegment(const CubicSegment& segment,
+                                    double currentTime)
+{
+    const double t = (currentTime - segment.tcur) / (segment.tnext - segment.tcur);
 
-    // cubicIntegrate: multiply the result by (tnext-tcur)
-    return ret;
+    return cubicEval(segment.c0, segment.c1, segment.c2, segment.c3, t);
 }
 
 /// derive at currentTime. The derivative is with respect to currentTime
@@ -51,6 +51,31 @@ double interpolate(double tcur, const double vcur, //start control point
                    KeyframeTypeEnum interp,
                    KeyframeTypeEnum interpNext) WARN_UNUSED_RETURN;
 
+/**
+ * @brief The cubic polynomial used by interpolate() between two control points, in the parametric
+ * time x = (currentTime - tcur) / (tnext - tcur).
+ **/
+struct CubicSegment
+{
+    double tcur, tnext;
+    double c0, c1, c2, c3;
+};
+
+/**
+ * @brief Computes the polynomial interpolating between the given control points, with the same arguments as interpolate(),
+ * so that the segment can be evaluated many times without computing it again.
+ **/
+void computeCubicSegment(double tcur, const double vcur, //start control point
+                         const double vcurDerivRight, //being the derivative dv/dt at tcur
+                         const double vnextDerivLeft, //being the derivative dv/dt at tnext
+                         double tnext, const double vnext, //end control point
+                         KeyframeTypeEnum interp,
+                         KeyframeTypeEnum interpNext,
+                         CubicSegment* segment);
+
+/// evaluate the segment at currentTime, this is the same as interpolate() with the arguments of the segment
+double evaluateCubicSegment(const CubicSegment& segment, double currentTime) WARN_UNUSED_RETURN;
+
 /// derive at currentTime. The derivative is with respect to currentTime
 double derive(double tcur, const double vcur, //start control point
               const double vcurDerivRight, //being the derivative dv/dt at tcur
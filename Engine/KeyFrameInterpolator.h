@@ -43,6 +43,15 @@ public:
 
     virtual KeyFrameInterpolatorPtr createCopy() const;
 
+    /**
+     * @brief Returns true if interpolate() only depends on the two keyframes surrounding t with the cubic polynomial
+     * of Interpolation::interpolate(), in which case the curve may evaluate precomputed segments instead.
+     **/
+    virtual bool isCubicInterpolation() const
+    {
+        return true;
+    }
+
     /**
      * @brief For a periodic curve, ensure t and the iterator point to keyframes in the periodic range
      **/
@@ -104,6 +113,11 @@ public:
 
     virtual KeyFrameInterpolatorPtr createCopy() const OVERRIDE;
 
+    virtual bool isCubicInterpolation() const OVERRIDE FINAL
+    {
+        return false;
+    }
+
     virtual KeyFrame interpolate(TimeValue t,
                                  KeyFrameSet::const_iterator itup,
                                  const KeyFrameSet& keyframes,
@@ -51,12 +51,15 @@
 #include "Engine/OverlayInteractBase.h"
 #include "Engine/LoadKnobsCompat.h"
 #include "Engine/Hash64.h"
+#include "Engine/InteractiveLatency.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/TreeRender.h"
 
 #include "Serialization/ProjectSerialization.h"
 
+// Maximum number of finished render clones kept by a holder to be re-used by later renders
+#define NATRON_RENDER_CLONES_POOL_MAX_SIZE 8
 
 SERIALIZATION_NAMESPACE_USING
 
@@ -528,16 +531,11 @@ KnobHelper::populate()
     KnobBoolBasePtr isBoolBase = toKnobBoolBase(thisKnob);
 
 
-    CurveTypeEnum curveType = getKeyFrameDataType();
-
+    // Animation curves are not created here but the first time they are needed, see getAnimationCurve()
     for (int i = 0; i < _imp->common->dimension; ++i) {
         KnobDimViewBasePtr data = createDimViewData();
         data->sharedKnobs.insert(KnobDimViewKey(thisKnob, DimIdx(i), ViewIdx(0)));
         _imp->common->perDimViewData[i][ViewIdx(0)] = data;
-
-        if ( canAnimate() ) {
-            data->animationCurve.reset(new Curve(curveType));
-        }
     }
 
     if (_imp->common->dimension > 4) {
@@ -614,7 +612,7 @@ KnobHelper::isAnimated(DimIdx dimension,
         return false;
     }
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
-    CurvePtr curve = getAnimationCurve(view_i, dimension);
+    CurvePtr curve = getAnimationCurveIfCreated(view_i, dimension);
     return curve ? curve->isAnimated() : false;
 }
 
@@ -627,14 +625,14 @@ KnobHelper::canSplitViews() const
 void
 KnobHelper::setExpressionsResultsCachingEnabled(bool enabled)
 {
-    QMutexLocker k(&_imp->common->expressionMutex);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
     _imp->common->enableExpressionCaching = enabled;
 }
 
 bool
 KnobHelper::isExpressionsResultsCachingEnabled() const
 {
-    QMutexLocker k(&_imp->common->expressionMutex);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
     return _imp->common->enableExpressionCaching;
 }
 
@@ -643,7 +641,7 @@ KnobDimViewBase::notifyCurveChanged()
 {
     KnobDimViewKeySet knobs;
     {
-        QMutexLocker k(&valueMutex);
+        ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
         knobs = sharedKnobs;
     }
     for (KnobDimViewKeySet::const_iterator it = knobs.begin(); it!=knobs.end(); ++it) {
@@ -940,6 +938,10 @@ KnobHelper::evaluateValueChangeInternal(DimSpec dimension,
         return true;
     }
 
+    if (reason == eValueChangedReasonUserEdited) {
+        InteractiveLatency::onKnobChanged();
+    }
+
     AppInstancePtr app = holder->getApp();
     bool didSomething;
     {
@@ -953,6 +955,9 @@ KnobHelper::evaluateValueChangeInternal(DimSpec dimension,
 
         // Invalidate the hash cache
         invalidateHashCache();
+        if (reason == eValueChangedReasonUserEdited) {
+            InteractiveLatency::onHashInvalidated();
+        }
 
         // Invalidate expression results
         clearExpressionsResults(dimension, view);
@@ -991,14 +996,14 @@ KnobHelper::refreshListenersAfterValueChangeInternal(TimeValue time, ViewIdx vie
 
     // Get all listeners via expressions
     {
-        QMutexLocker l(&_imp->common->expressionMutex);
+        ProfiledMutexLocker l(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         KnobDimViewKeySet& listeners = _imp->common->listeners[dimension][view];
         allListeners.insert(listeners.begin(), listeners.end());
     }
 
     // Get all listeners via shared values
     {
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         allListeners.insert(data->sharedKnobs.begin(), data->sharedKnobs.end());
     }
 
@@ -1310,7 +1315,7 @@ KnobHelper::hasAnimation() const
             KnobDimViewBasePtr value = getDataForDimView(DimIdx(i), *it);
             assert(value);
             {
-                QMutexLocker k(&value->valueMutex);
+                ProfiledMutexLocker k(&value->valueMutex, eLockProfilerSiteKnobValue);
                 if (value->animationCurve && value->animationCurve->getKeyFramesCount() > 0) {
                     return true;
                 }
@@ -1751,7 +1756,7 @@ KnobHelper::linkToInternal(const KnobIPtr & otherKnob, DimIdx thisDimension, Dim
     // Redirect each shared knob/dim/view to the other data
     KnobDimViewKeySet currentSharedKnobs;
     {
-        QMutexLocker k2(&thisData->valueMutex);
+        ProfiledMutexLocker k2(&thisData->valueMutex, eLockProfilerSiteKnobValue);
         currentSharedKnobs = thisData->sharedKnobs;
 
         // Nobody is referencing this data anymore: clear the sharedKnobs set
@@ -1775,7 +1780,7 @@ KnobHelper::linkToInternal(const KnobIPtr & otherKnob, DimIdx thisDimension, Dim
 
         // insert this shared knob to the sharedKnobs set of the other data
         {
-            QMutexLocker k2(&otherData->valueMutex);
+            ProfiledMutexLocker k2(&otherData->valueMutex, eLockProfilerSiteKnobValue);
             std::pair<KnobDimViewKeySet::iterator,bool> insertOk = otherData->sharedKnobs.insert(*it);
             assert(insertOk.second);
             (void)insertOk.second;
@@ -1787,7 +1792,7 @@ KnobHelper::linkToInternal(const KnobIPtr & otherKnob, DimIdx thisDimension, Dim
     {
         KnobDimViewKeySet sharedKnobs;
         {
-            QMutexLocker k2(&otherData->valueMutex);
+            ProfiledMutexLocker k2(&otherData->valueMutex, eLockProfilerSiteKnobValue);
             sharedKnobs = otherData->sharedKnobs;
         }
         for (KnobDimViewKeySet::const_iterator it = sharedKnobs.begin(); it!= sharedKnobs.end(); ++it) {
@@ -1906,7 +1911,7 @@ KnobHelper::unlinkInternal(DimIdx dimension, ViewIdx view, bool copyState)
         KnobDimViewKey thisKnobKey(thisKnob, dimension, view);
         {
             {
-                QMutexLocker k2(&currentData->second->valueMutex);
+                ProfiledMutexLocker k2(&currentData->second->valueMutex, eLockProfilerSiteKnobValue);
                 currentSharedKnobs = currentData->second->sharedKnobs;
 
                 assert(!currentData->second->sharedKnobs.empty());
@@ -2056,7 +2061,7 @@ KnobHelper::getSharedValues(DimIdx dimension, ViewIdx view, KnobDimViewKeySet* s
         return;
     }
     {
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         assert(!data->sharedKnobs.empty());
         *sharedKnobs = data->sharedKnobs;
     }
@@ -2083,7 +2088,7 @@ KnobHelper::getAnimationLevel(DimIdx dimension, TimeValue time, ViewIdx view) co
 
         CurvePtr c;
         if (canAnimate() && isAnimationEnabled()) {
-            c = getAnimationCurve(view, dimension);
+            c = getAnimationCurveIfCreated(view, dimension);
         }
 
         if (!c || !c->isAnimated()) {
@@ -2134,6 +2139,13 @@ KnobHelper::cloneValueInternal(const KnobIPtr& other, ViewIdx view, ViewIdx othe
     if (!thisData || !otherData) {
         return false;
     }
+
+    // Make sure the curve exists with the range of this knob before copying keyframes onto it
+    CurvePtr otherCurve = otherIsHelper->getAnimationCurveIfCreated(otherView, otherDimension);
+    if ( otherCurve && otherCurve->isAnimated() ) {
+        getAnimationCurve(view, dimension);
+    }
+
     KnobDimViewBase::CopyInArgs inArgs(*otherData);
     inArgs.keysToCopyOffset = offset;
     inArgs.keysToCopyRange = range;
@@ -2214,9 +2226,25 @@ KnobHelper::cloneExpressions(const KnobIPtr& other, ViewSetSpec view, ViewSetSpe
 bool
 KnobHelper::invalidateHashCacheInternal(std::set<HashableObject*>* invalidatedObjects)
 {
+    // Anything that changes the hash may change the values seen by the future render clones
+    invalidateValuesSnapshot();
     return HashableObject::invalidateHashCacheInternal(invalidatedObjects);
 }
 
+std::string
+KnobHelper::getHashProfilerName() const
+{
+    // Knobs are reported as <node>.<knob> so that their cascades can be attributed to the node
+    KnobHolderPtr holder = getHolder();
+    EffectInstancePtr effect = toEffectInstance(holder);
+    if (effect) {
+        return effect->getHashProfilerName() + "." + getName();
+    } else if (holder) {
+        return holder->getScriptName_mt_safe() + "." + getName();
+    }
+    return getName();
+}
+
 //The knob in parameter will "listen" to this knob. Hence this knob is a dependency of the knob in parameter.
 void
 KnobHelper::addListener(const DimIdx listenerDimension,
@@ -2244,7 +2272,7 @@ KnobHelper::addListener(const DimIdx listenerDimension,
 
     // Add the listener to the list
     {
-        QMutexLocker l(&_imp->common->expressionMutex);
+        ProfiledMutexLocker l(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         KnobDimViewKeySet& listenersSet = _imp->common->listeners[listenedToDimension][listenedToView];
         KnobDimViewKey d(listener, listenerDimension, listenerView);
         listenersSet.insert(d);
@@ -2257,7 +2285,7 @@ KnobHelper::addListener(const DimIdx listenerDimension,
     if (language == eExpressionLanguagePython) {
         // Add this knob as a dependency of the expression
         // For ExprTk this is already done in validateExprTkExpression
-        QMutexLocker k(&listenerIsHelper->_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&listenerIsHelper->_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         KnobExprPtr& expr = listenerIsHelper->_imp->common->expressions[listenerDimension][listenerView];
         if (expr) {
 
@@ -2283,7 +2311,7 @@ KnobHelper::getListeners(KnobDimViewKeySet& listeners, ListenersTypeFlags flags)
         for (int i = 0; i < nDims; ++i) {
 
             if ((flags & eListenersTypeExpression) || (flags & eListenersTypeAll)) {
-                QMutexLocker l(&_imp->common->expressionMutex);
+                ProfiledMutexLocker l(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
                 const KnobDimViewKeySet& thisDimViewExpressionListeners = _imp->common->listeners[i][*it];
                 listeners.insert(thisDimViewExpressionListeners.begin(), thisDimViewExpressionListeners.end());
             }
@@ -2931,7 +2959,8 @@ initializeValueSerializationStorage(const KnobIPtr& knob,
     }
 
     // Serialize curve
-    CurvePtr curve = knob->getAnimationCurve(view, dimension);
+    KnobHelperPtr isHelper = toKnobHelper(knob);
+    CurvePtr curve = isHelper ? isHelper->getAnimationCurveIfCreated(view, dimension) : knob->getAnimationCurve(view, dimension);
     if (curve && !gotValue) {
         curve->toSerialization(&serialization->_animationCurve);
         if (!serialization->_animationCurve.keys.empty()) {
@@ -3786,6 +3815,7 @@ static NodePtr findMasterNode(const NodeCollectionPtr& group,
             if (!nodeIsGroup) {
                 return NodePtr();
             }
+            nodeIsGroup->createDeferredSubGraph();
             return findMasterNode(nodeIsGroup, recursionLevel + 1, masterNodeName, allCreatedNodesInGroup);
         }
     } else {
@@ -4110,6 +4140,12 @@ struct KnobHolderCommonData
     mutable QMutex renderClonesMutex;
     RenderCloneMap renderClones;
 
+    // Render clones whose render is finished, kept to be rebound to a later render.
+    // They are only valid as long as the hash of the main instance is renderClonesPoolHash.
+    // Protected by renderClonesMutex
+    std::list<KnobHolderPtr> renderClonesPool;
+    U64 renderClonesPoolHash;
+
     KnobHolderCommonData()
     : app()
     , evaluationBlockedMutex(QMutex::Recursive)
@@ -4128,6 +4164,8 @@ struct KnobHolderCommonData
     , overlaySlaves()
     , renderClonesMutex()
     , renderClones()
+    , renderClonesPool()
+    , renderClonesPoolHash(0)
     {
 
     }
@@ -5022,9 +5060,11 @@ KnobHolder::endChanges(bool discardRendering)
     int evaluationBlocked;
     ValueChangedReasonEnum firstKnobReason;
 
+    bool wasBlocked;
     {
         QMutexLocker l(&_imp->common->evaluationBlockedMutex);
-        if (_imp->common->evaluationBlocked > 0) {
+        wasBlocked = _imp->common->evaluationBlocked > 0;
+        if (wasBlocked) {
             --_imp->common->evaluationBlocked;
         }
         evaluationBlocked = _imp->common->evaluationBlocked;
@@ -5045,6 +5085,10 @@ KnobHolder::endChanges(bool discardRendering)
         }
     }
 
+    // End the batch before rendering so that the hashes are up to date
+    if (wasBlocked) {
+        HashableObject::endInvalidationBatch();
+    }
 
 
     if (hasHadAnyChange) {
@@ -5128,8 +5172,13 @@ KnobHolder::beginChanges()
     /*
      * Start a begin/end block, actually blocking all evaluations (renders) but not value changed callback.
      */
-    QMutexLocker l(&_imp->common->evaluationBlockedMutex);
-    ++_imp->common->evaluationBlocked;
+    {
+        QMutexLocker l(&_imp->common->evaluationBlockedMutex);
+        ++_imp->common->evaluationBlocked;
+    }
+
+    // Setting many values in the bracket only walks once the objects depending on them
+    HashableObject::beginInvalidationBatch();
 }
 
 bool
@@ -5264,7 +5313,58 @@ KnobHolder::removeRenderClone(const TreeRenderPtr& render)
         }
     }
 
+    // Keep the clones around so that the next render does not have to create them again.
+    // Holders with items tables are not pooled since the items clones are bound to the render.
+    if (!isRenderClonePoolingSupported() || !_imp->common->knobsTables.empty()) {
+        return true;
+    }
+    U64 hash = computeHash(ComputeHashArgs());
+    std::list<KnobHolderPtr> outdatedClones;
+    for (std::list<KnobHolderPtr>::const_iterator it = clones.begin(); it != clones.end(); ++it) {
+        if (!*it || !(*it)->isRenderClone() || (*it)->_imp->knobs.size() != _imp->knobs.size()) {
+            continue;
+        }
+        (*it)->onRenderCloneReleased();
+        (*it)->_imp->currentRender = FrameViewRenderKey();
+
+        QMutexLocker locker(&_imp->common->renderClonesMutex);
+        if (_imp->common->renderClonesPoolHash != hash) {
+            outdatedClones.splice(outdatedClones.end(), _imp->common->renderClonesPool);
+            _imp->common->renderClonesPoolHash = hash;
+        }
+        if (_imp->common->renderClonesPool.size() < NATRON_RENDER_CLONES_POOL_MAX_SIZE) {
+            _imp->common->renderClonesPool.push_back(*it);
+        }
+    }
+
     return true;
+} // removeRenderClone
+
+void
+KnobHolder::clearRenderClonesPool()
+{
+    std::list<KnobHolderPtr> pool;
+    {
+        QMutexLocker locker(&_imp->common->renderClonesMutex);
+        pool.swap(_imp->common->renderClonesPool);
+    }
+    // The clones are destroyed outside of the mutex
+    pool.clear();
+}
+
+void
+KnobHolder::rebindRenderClone(const FrameViewRenderKey& key)
+{
+    assert(_imp->mainInstance);
+    _imp->currentRender = key;
+
+    // Register again the knobs in the render clones map, they were removed in removeRenderClone
+    KnobHolderPtr thisShared = shared_from_this();
+    for (std::size_t i = 0; i < _imp->knobs.size(); ++i) {
+        KnobHelperPtr k = toKnobHelper(_imp->knobs[i]);
+        QMutexLocker locker(&k->_imp->common->renderClonesMapMutex);
+        k->_imp->common->renderClonesMap[thisShared] = _imp->knobs[i];
+    }
 }
 
 KnobHolderPtr
@@ -5275,6 +5375,15 @@ KnobHolder::createRenderClone(const FrameViewRenderKey& key) const
         return boost::const_pointer_cast<KnobHolder>(thisShared);
     }
 
+    // The hash is computed before taking the lock since it may recurse on other holders
+    U64 hash = 0;
+    if (isRenderClonePoolingSupported()) {
+        hash = const_cast<KnobHolder*>(this)->computeHash(ComputeHashArgs());
+    }
+
+    // Outdated pooled clones are destroyed once the mutex is released
+    std::list<KnobHolderPtr> outdatedClones;
+
     QMutexLocker k(&_imp->common->renderClonesMutex);
     RenderCloneMap::iterator found = _imp->common->renderClones.find(key);
     if (found != _imp->common->renderClones.end()) {
@@ -5284,6 +5393,19 @@ KnobHolder::createRenderClone(const FrameViewRenderKey& key) const
         }
     }
 
+    // Re-use a clone of a previous render if the main instance did not change since then
+    if (!_imp->common->renderClonesPool.empty()) {
+        if (_imp->common->renderClonesPoolHash != hash) {
+            outdatedClones.swap(_imp->common->renderClonesPool);
+        } else {
+            KnobHolderPtr recycled = _imp->common->renderClonesPool.front();
+            _imp->common->renderClonesPool.pop_front();
+            key.render.lock()->registerRenderClone(recycled);
+            _imp->common->renderClones[key] = recycled;
+            recycled->rebindRenderClone(key);
+            return recycled;
+        }
+    }
 
     KnobHolderPtr copy = createRenderCopy(key);
     if (!copy) {
@@ -5541,6 +5663,9 @@ KnobHolder::appendToHash(const ComputeHashArgs& args, Hash64* hash)
         if (args.hashType == eComputeHashTypeOnlyMetadataSlaves && !(*it)->getIsMetadataSlave()) {
             continue;
         }
+        if (!isKnobPartOfHash(*it)) {
+            continue;
+        }
         U64 knobHash = (*it)->computeHash(args);
         hash->append(knobHash);
 
@@ -5554,6 +5679,12 @@ KnobHolder::isFullAnimationToHashEnabled() const
     return false;
 }
 
+bool
+KnobHolder::isKnobPartOfHash(const KnobIPtr& /*knob*/) const
+{
+    return true;
+}
+
 void
 KnobHolder::KnobHolderPrivate::pushUndoCommandInternal(const UndoCommandPtr& command)
 {
@@ -49,6 +49,7 @@
 #include "Engine/DimensionIdx.h"
 #include "Engine/HashableObject.h"
 #include "Engine/KnobFactory.h"
+#include "Engine/LockProfiler.h" // ProfiledMutexLocker for the knob mutexes
 #include "Engine/Variant.h"
 #include "Engine/ViewIdx.h"
 
@@ -1430,6 +1431,29 @@ public:
     virtual CurvePtr getAnimationCurve(ViewIdx idx, DimIdx dimension) const OVERRIDE ;
     //////////// End from AnimatingObjectI
 
+    /**
+     * @brief Animation curves are only created the first time getAnimationCurve() is called on a dimension/view
+     * since most knobs are never animated. This returns the curve without creating it: the result is NULL
+     * if the knob was never animated for this dimension/view.
+     **/
+    CurvePtr getAnimationCurveIfCreated(ViewIdx view, DimIdx dimension) const;
+
+    /**
+     * @brief Adds or modifies the given keyframes on the animation curve of the given dimension and view at once.
+     * Unlike setMultipleKeyFrames this does not go through the undo/redo stack and keyframes are not notified one by one.
+     * @param evaluate If true, the knob is evaluated and its GUI refreshed once for all keyframes. Otherwise
+     * the keyframes are immediately visible to getValueAtTime but nothing is notified: the caller must call
+     * evaluateAnimationChange() afterwards, which allows writing keyframes over several calls with a single notification.
+     * @returns True if any keyframe was added or modified
+     **/
+    bool addKeyFramesToCurve(ViewIdx view, DimIdx dimension, const std::list<KeyFrame>& keys, bool evaluate = true);
+
+    /**
+     * @brief Notifies that the animation of all dimensions and views of the knob changed, after calls to
+     * addKeyFramesToCurve with evaluate = false.
+     **/
+    void evaluateAnimationChange(TimeValue time, ValueChangedReasonEnum reason = eValueChangedReasonUserEdited);
+
 private:
 
     bool removeAnimationInternal(ViewIdx view, DimIdx dimension);
@@ -1456,6 +1480,19 @@ protected:
 
     void setExpressionInternal(DimIdx dimension, ViewIdx view, const std::string& expression, ExpressionLanguageEnum language, bool hasRetVariable, bool failIfInvalid);
 
+    /**
+     * @brief Returns the language the expression is evaluated with. This may differ from getExpressionLanguage()
+     * for Python expressions that were lowered to ExprTk, see lowerPythonExpressionToExprTk()
+     **/
+    ExpressionLanguageEnum getExpressionExecutionLanguage(ViewIdx view, DimIdx dimension) const;
+
+    /**
+     * @brief Returns whether the result of the expression at the given dimension/view may be memoized per time/view.
+     * Results are cleared when this knob or one of the knobs referenced by the expression changes: expressions
+     * calling functions of effects are not cached since they are not notified of the changes of these effects.
+     **/
+    bool canCacheExpressionResults(ViewIdx view, DimIdx dimension) const;
+
 private:
 
     void setLinkStatusInternal(DimIdx dimension, ViewIdx view, bool valid, const std::string& error);
@@ -1614,10 +1651,19 @@ public:
                                             KnobI::KnobDeclarationTypeEnum isUserKnob) OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool copyKnob(const KnobIPtr& other, ViewSetSpec view = ViewSetSpec::all(), DimSpec dimension = DimSpec::all(), ViewSetSpec otherView = ViewSetSpec::all(), DimSpec otherDimension = DimSpec::all(), const RangeD* range = 0, double offset = 0) OVERRIDE FINAL;
 
+protected:
+
+    /**
+     * @brief Called whenever something the values of the knob depend on changed, see Knob<T>::getOrCreateValuesSnapshot()
+     **/
+    virtual void invalidateValuesSnapshot() {}
+
 private:
 
     virtual bool invalidateHashCacheInternal(std::set<HashableObject*>* invalidatedObjects) OVERRIDE FINAL;
 
+    virtual std::string getHashProfilerName() const OVERRIDE FINAL;
+
 
     bool cloneValueInternal(const KnobIPtr& other, ViewIdx view, ViewIdx otherView, DimIdx dimension, DimIdx otherDimension, const RangeD* range, double offset);
     bool cloneValues(const KnobIPtr& other, ViewSetSpec view, ViewSetSpec otherView, DimSpec dimension, DimSpec otherDimension, const RangeD* range, double offset);
@@ -1658,6 +1704,15 @@ public:
     /// The expression must put its result in the Python variable named "ret"
     static ExpressionReturnValueTypeEnum evaluateExpression(const std::string& expr, ExpressionLanguageEnum language, double* retIsScalar, std::string* retIsString, std::string* error);
 
+    /**
+     * @brief Translates a single-line Python expression to the ExprTk dialect if it only uses constructs that have
+     * the same meaning in both languages: numbers, arithmetic operators, the frame variable, a few math functions and
+     * parameter values fetched with get(), getValue() or getValueAtTime(), e.g:
+     * thisNode.other.get() * 2 + frame => thisNode.other * 2 + frame
+     * @returns False if the expression cannot be lowered, in which case it must be evaluated by Python.
+     **/
+    static bool lowerPythonExpressionToExprTk(const std::string& pythonExpression, std::string* exprTkExpression);
+
 
     virtual bool getSharingMaster(DimIdx dimension, ViewIdx view, KnobDimViewKey* linkData) const OVERRIDE FINAL;
     virtual void getSharedValues(DimIdx dimension, ViewIdx view, KnobDimViewKeySet* sharedKnobs) const OVERRIDE FINAL;
@@ -1843,6 +1898,13 @@ public:
      **/
     virtual T getValueAtTime(TimeValue time, DimIdx dimension = DimIdx(0), ViewIdx view = ViewIdx(0), bool clampToMinMax = true)  WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Same as calling getValueAtTime for each of the n given times: values[i] is the value at times[i].
+     * If the value comes from the animation curve, the curve is evaluated for all times at once (see Curve::getValuesAt),
+     * which is much faster for many samples such as motion blur or curve drawing.
+     **/
+    void getValuesAtTimes(const TimeValue* times, T* values, int n, DimIdx dimension = DimIdx(0), ViewIdx view = ViewIdx(0), bool clampToMinMax = true);
+
     virtual bool getCurveKeyFrame(TimeValue time, DimIdx dimension, ViewIdx view, bool clampToMinMax, KeyFrame* key) OVERRIDE FINAL WARN_UNUSED_RETURN;
 
     /**
@@ -2078,6 +2140,14 @@ private:
 
     T clampToMinMax(const T& value, DimIdx dimension) const;
 
+    virtual void invalidateValuesSnapshot() OVERRIDE FINAL;
+
+    /**
+     * @brief Reads the value from the snapshot taken when this render clone was created.
+     * @returns False if the knob is not a render clone or if the value at this dimension/view is not static.
+     **/
+    bool getValueFromSnapshot(DimIdx dimension, ViewIdx view, bool clamp, T* ret) const;
+
 private:
 
     bool evaluateExpression(TimeValue time, ViewIdx view, DimIdx dimension, T* ret, std::string* error);
@@ -2143,6 +2213,31 @@ private:
 
     typedef std::map<DimTimeView, T, ValueDimTimeViewCompareLess> ValuesCacheMap;
 
+    struct SnapshotValue
+    {
+        // False if the value at this dimension/view has an expression or an animation
+        bool isStatic;
+        T value, clampedValue;
+    };
+
+    typedef std::map<ViewIdx, SnapshotValue> PerViewSnapshotValues;
+
+    /**
+     * @brief An immutable copy of the static values of the knob for each dimension and split view
+     **/
+    struct ValuesSnapshot
+    {
+        std::vector<PerViewSnapshotValues> values;
+    };
+
+    typedef boost::shared_ptr<const ValuesSnapshot> ValuesSnapshotPtr;
+
+    /**
+     * @brief Returns the snapshot of the current values of the knob, shared by all render clones
+     * created until the knob changes.
+     **/
+    ValuesSnapshotPtr getOrCreateValuesSnapshot() const;
+
 
     struct Data
     {
@@ -2159,6 +2254,12 @@ private:
         mutable QMutex expressionResultsMutex;
         PerDimensionExpressionCache expressionResults;
 
+        // Protects valuesSnapshot and valuesSnapshotRevision. No other mutex may be taken while holding it.
+        mutable QMutex valuesSnapshotMutex;
+        ValuesSnapshotPtr valuesSnapshot;
+        // Incremented whenever the snapshot is invalidated
+        unsigned int valuesSnapshotRevision;
+
         Data(int nDims)
         : defaultValueMutex()
         , defaultValues(nDims)
@@ -2169,6 +2270,9 @@ private:
         , displayMaxs(nDims)
         , expressionResultsMutex()
         , expressionResults()
+        , valuesSnapshotMutex()
+        , valuesSnapshot()
+        , valuesSnapshotRevision(0)
         {
 
         }
@@ -2178,6 +2282,10 @@ private:
     // consistant throughout a render.
     boost::scoped_ptr<ValuesCacheMap> _valuesCache;
 
+    // Used only on render clones: the values of the main instance when the clone was created.
+    // The snapshot is immutable and is read without locking.
+    ValuesSnapshotPtr _valuesSnapshot;
+
     // The Data pointer is shared accross the "main" instance and the render clones.
     boost::shared_ptr<Data> _data;
 
@@ -2542,6 +2650,13 @@ public:
      **/
     virtual bool isFullAnimationToHashEnabled() const;
 
+    /**
+     * @brief If this function returns false for a knob, its value is not appended to the hash of this KnobHolder
+     * even though it evaluates on change. This is useful when the value of a knob does not affect the result
+     * in some configurations of the holder.
+     **/
+    virtual bool isKnobPartOfHash(const KnobIPtr& knob) const;
+
     enum KnobItemsTablePositionEnum
     {
         // The table will be placed at the bottom of all pages
@@ -2705,6 +2820,12 @@ public:
      **/
     KnobHolderPtr getRenderClone(const FrameViewRenderKey& key) const;
 
+    /**
+     * @brief Release the render clones kept in the pool of this holder after their render finished.
+     * Can only be called on the main instance!
+     **/
+    void clearRenderClonesPool();
+
 protected:
 
 
@@ -2724,6 +2845,27 @@ protected:
         return KnobHolderPtr();
     }
 
+    /**
+     * @brief Returns true if the render clones of this holder may be pooled when their render is finished
+     * and re-used by a later render as long as the hash of the main instance did not change.
+     **/
+    virtual bool isRenderClonePoolingSupported() const
+    {
+        return false;
+    }
+
+    /**
+     * @brief Called on a render clone when it enters the pool of its main instance.
+     * Derived implementation should release any data specific to the finished render.
+     **/
+    virtual void onRenderCloneReleased() {}
+
+    /**
+     * @brief Called on a pooled render clone to bind it to a new render.
+     * Derived implementation should call base-class version
+     **/
+    virtual void rebindRenderClone(const FrameViewRenderKey& key);
+
     /**
      * @brief Implement to fetch knobs needed during any action called on a render thread.
      * Derived implementation should call base-class version
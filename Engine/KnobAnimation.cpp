@@ -52,9 +52,44 @@ CurvePtr KnobHelper::getAnimationCurve(ViewIdx view,
 
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
     KnobDimViewBasePtr dimViewData = getDataForDimView(dimension, view_i);
-    return dimViewData->animationCurve;
+    if (!dimViewData) {
+        return CurvePtr();
+    }
+
+    CurvePtr curve;
+    {
+        ProfiledMutexLocker k(&dimViewData->valueMutex, eLockProfilerSiteKnobValue);
+        if ( dimViewData->animationCurve || !canAnimate() ) {
+            return dimViewData->animationCurve;
+        }
+        // Create the curve the first time it is needed
+        curve.reset( new Curve( getKeyFrameDataType() ) );
+        dimViewData->animationCurve = curve;
+    }
+
+    // Apply the range of the knob to the new curve
+    const_cast<KnobHelper*>(this)->refreshCurveMinMaxInternal(view_i, dimension);
+
+    return curve;
 } // getCurve
 
+CurvePtr
+KnobHelper::getAnimationCurveIfCreated(ViewIdx view,
+                                       DimIdx dimension) const
+{
+    if ( (dimension < 0) || ( dimension >= _imp->common->dimension) ) {
+        throw std::invalid_argument("KnobHelper::getAnimationCurveIfCreated: dimension out of range");
+    }
+
+    ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
+    KnobDimViewBasePtr dimViewData = getDataForDimView(dimension, view_i);
+    if (!dimViewData) {
+        return CurvePtr();
+    }
+    ProfiledMutexLocker k(&dimViewData->valueMutex, eLockProfilerSiteKnobValue);
+    return dimViewData->animationCurve;
+} // getAnimationCurveIfCreated
+
 
 void
 KnobDimViewBase::deleteValuesAtTime(const std::list<double>& times)
@@ -319,7 +354,8 @@ KnobDimViewBase::copy(const CopyInArgs& inArgs, CopyOutArgs* outArgs)
         }
 
         const Curve* otherCurve = inArgs.other ? inArgs.other->animationCurve.get() : inArgs.otherCurve;
-        if (otherCurve) {
+        // Animation curves are created lazily: there is nothing to copy from an empty curve to a missing one
+        if ( otherCurve && (animationCurve || otherCurve->isAnimated()) ) {
             if (!animationCurve) {
                 animationCurve.reset(new Curve(otherCurve->getType()));
             }
@@ -360,6 +396,10 @@ KnobHelper::cloneCurve(ViewIdx view,
         return false;
     }
 
+    // Make sure the curve exists with the range of this knob before copying keyframes onto it
+    if ( curve.isAnimated() ) {
+        getAnimationCurve(view, dimension);
+    }
 
     KnobDimViewBase::CopyInArgs copyArgs(curve);
     copyArgs.keysToCopyRange = range;
@@ -373,6 +413,64 @@ KnobHelper::cloneCurve(ViewIdx view,
     return hasChanged;
 } // cloneCurve
 
+bool
+KnobHelper::addKeyFramesToCurve(ViewIdx view,
+                                DimIdx dimension,
+                                const std::list<KeyFrame>& keys,
+                                bool evaluate)
+{
+    if (dimension < 0 || dimension >= _imp->common->dimension) {
+        throw std::invalid_argument("KnobHelper::addKeyFramesToCurve: Dimension out of range");
+    }
+    if ( keys.empty() || !canAnimate() || !isAnimationEnabled() ) {
+        return false;
+    }
+
+    KnobDimViewBasePtr data = getDataForDimView(dimension, view);
+    if (!data) {
+        return false;
+    }
+    CurvePtr curve = getAnimationCurve(view, dimension);
+    if (!curve) {
+        return false;
+    }
+
+    // Refresh the derivatives once for all the keyframes instead of around each of them
+    curve->beginBulkEdit();
+    bool hasChanged = curve->setOrAddKeyframes(keys);
+    curve->endBulkEdit();
+    if (!hasChanged) {
+        return false;
+    }
+
+    KnobHolderPtr holder = getHolder();
+    if (holder) {
+        holder->setHasAnimation(true);
+    }
+    if (evaluate) {
+        data->notifyCurveChanged();
+        evaluateValueChange(dimension, keys.back().getTime(), view, eValueChangedReasonUserEdited);
+    }
+    return true;
+} // addKeyFramesToCurve
+
+void
+KnobHelper::evaluateAnimationChange(TimeValue time,
+                                    ValueChangedReasonEnum reason)
+{
+    std::list<ViewIdx> views = getViewsList();
+    int nDims = getNDimensions();
+    for (std::list<ViewIdx>::const_iterator it = views.begin(); it != views.end(); ++it) {
+        for (int i = 0; i < nDims; ++i) {
+            KnobDimViewBasePtr data = getDataForDimView(DimIdx(i), *it);
+            if (data) {
+                data->notifyCurveChanged();
+            }
+        }
+    }
+    evaluateValueChange(DimSpec::all(), time, ViewSetSpec::all(), reason);
+} // evaluateAnimationChange
+
 
 void
 KnobDimViewBase::setInterpolationAtTimes(const std::list<double>& times, KeyframeTypeEnum interpolation, std::vector<KeyFrame>* newKeys)
@@ -26,6 +26,7 @@
 #include "Knob.h"
 #include "KnobPrivate.h"
 
+#include <cctype> // isalpha, isalnum, isdigit
 #include <sstream> // stringstream
 #include <string>
 
@@ -374,6 +375,340 @@ extractAllOcurrences(const string& str,
     return true;
 }
 
+static bool lowerPythonRange(const string& expr, std::size_t begin, std::size_t end, string* out);
+
+static bool
+isPythonIdentifierStart(char c)
+{
+    return std::isalpha( (unsigned char)c ) || (c == '_');
+}
+
+static bool
+isPythonIdentifierChar(char c)
+{
+    return std::isalnum( (unsigned char)c ) || (c == '_');
+}
+
+/**
+ * @brief Converts a Python dimension index, e.g: the "1" of getValue(1), to a dimension in the ExprTk dialect
+ **/
+static bool
+lowerPythonDimension(const string& arg,
+                     string* dimension)
+{
+    std::size_t first = arg.find_first_not_of(' ');
+    std::size_t last = arg.find_last_not_of(' ');
+    if ( (first == string::npos) || (first != last) || (arg[first] < '0') || (arg[first] > '3') ) {
+        return false;
+    }
+    *dimension = arg[first];
+
+    return true;
+}
+
+/**
+ * @brief Lowers each comma separated argument of the call whose parenthesis are at openingPos and closingPos
+ **/
+static bool
+lowerPythonArguments(const string& expr,
+                     std::size_t openingPos,
+                     std::size_t closingPos,
+                     vector<string>* args)
+{
+    if ( expr.find_first_not_of(" \t", openingPos + 1) == closingPos ) {
+        // No argument
+        return true;
+    }
+    std::size_t argStart = openingPos + 1;
+    int level = 0;
+    for (std::size_t i = openingPos + 1; i <= closingPos; ++i) {
+        if (expr[i] == '(') {
+            ++level;
+        } else if ( (expr[i] == ')') && (i != closingPos) ) {
+            --level;
+        } else if ( (i == closingPos) || ( (expr[i] == ',') && (level == 0) ) ) {
+            string arg;
+            if ( !lowerPythonRange(expr, argStart, i, &arg) || ( arg.find_first_not_of(' ') == string::npos ) ) {
+                return false;
+            }
+            args->push_back(arg);
+            argStart = i + 1;
+        }
+    }
+
+    return true;
+} // lowerPythonArguments
+
+static void
+appendExprTkCall(const string& function,
+                 const vector<string>& args,
+                 string* out)
+{
+    out->append(function);
+    out->push_back('(');
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (i > 0) {
+            out->push_back(',');
+        }
+        out->append(args[i]);
+    }
+    out->push_back(')');
+}
+
+struct PythonMathFunction
+{
+    const char* pythonName;
+    const char* exprTkName;
+    std::size_t nArgs;
+};
+
+// The functions of the Python math module that have the same definition in ExprTk
+static const PythonMathFunction pythonMathFunctions[] = {
+    {"acos", "acos", 1},
+    {"asin", "asin", 1},
+    {"atan", "atan", 1},
+    {"atan2", "atan2", 2},
+    {"ceil", "ceil", 1},
+    {"cos", "cos", 1},
+    {"cosh", "cosh", 1},
+    {"exp", "exp", 1},
+    {"fabs", "abs", 1},
+    {"floor", "floor", 1},
+    {"hypot", "hypot", 2},
+    {"log", "log", 1},
+    {"log10", "log10", 1},
+    {"pow", "pow", 2},
+    {"sin", "sin", 1},
+    {"sinh", "sinh", 1},
+    {"sqrt", "sqrt", 1},
+    {"tan", "tan", 1},
+    {"tanh", "tanh", 1},
+    {0, 0, 0}
+};
+
+/**
+ * @brief Lowers the dotted name starting at *pos, and the call following it if any.
+ * On success *pos is set past the lowered characters.
+ **/
+static bool
+lowerPythonName(const string& expr,
+                std::size_t end,
+                std::size_t* pos,
+                string* out)
+{
+    vector<string> names;
+    std::size_t i = *pos;
+    for (;;) {
+        std::size_t nameStart = i;
+        while ( (i < end) && isPythonIdentifierChar(expr[i]) ) {
+            ++i;
+        }
+        names.push_back( expr.substr(nameStart, i - nameStart) );
+        if ( (i + 1 < end) && (expr[i] == '.') && isPythonIdentifierStart(expr[i + 1]) ) {
+            ++i;
+        } else {
+            break;
+        }
+    }
+
+    vector<string> args;
+    bool isCall = (i < end) && (expr[i] == '(');
+    if (isCall) {
+        std::size_t closing = getMatchingParenthesisPosition(i, '(', ')', expr);
+        if ( (closing == string::npos) || (closing >= end) || !lowerPythonArguments(expr, i, closing, &args) ) {
+            return false;
+        }
+        i = closing + 1;
+    }
+
+    if (names.size() == 1) {
+        if ( (names[0] == "frame") && !isCall ) {
+            out->append(names[0]);
+        } else if ( isCall && ( (names[0] == "abs" && args.size() == 1) || ( (names[0] == "min" || names[0] == "max") && args.size() >= 2 ) ) ) {
+            appendExprTkCall(names[0], args, out);
+        } else {
+            return false;
+        }
+        *pos = i;
+
+        return true;
+    }
+
+    if (names[0] == "math") {
+        if (names.size() != 2) {
+            return false;
+        }
+        if (!isCall) {
+            if (names[1] == "pi") {
+                out->append("3.14159265358979323846");
+            } else if (names[1] == "e") {
+                out->append("2.71828182845904523536");
+            } else {
+                return false;
+            }
+            *pos = i;
+
+            return true;
+        }
+        for (const PythonMathFunction* f = pythonMathFunctions; f->pythonName; ++f) {
+            if ( (names[1] == f->pythonName) && (args.size() == f->nArgs) ) {
+                appendExprTkCall(f->exprTkName, args, out);
+                *pos = i;
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Otherwise this must be a parameter value, e.g: thisNode.size.get()
+    // The project parameters are not under "app" in the ExprTk dialect
+    if ( !isCall || (names[0] == "app") ) {
+        return false;
+    }
+    string method = names.back();
+    names.pop_back();
+
+    string time, dimension;
+    if (method == "get") {
+        if ( args.size() > 1 ) {
+            return false;
+        }
+        if ( !args.empty() ) {
+            time = args[0];
+        }
+        // For multi-dimensional parameters get() returns a tuple whose elements are accessed either by index or attribute
+        if ( (i < end) && (expr[i] == '[') ) {
+            std::size_t closingBracket = expr.find(']', i);
+            if ( (closingBracket == string::npos) || (closingBracket >= end) || !lowerPythonDimension(expr.substr(i + 1, closingBracket - i - 1), &dimension) ) {
+                return false;
+            }
+            i = closingBracket + 1;
+        } else if ( (i + 1 < end) && (expr[i] == '.') ) {
+            std::size_t attrEnd = i + 1;
+            while ( (attrEnd < end) && isPythonIdentifierChar(expr[attrEnd]) ) {
+                ++attrEnd;
+            }
+            string attr = expr.substr(i + 1, attrEnd - i - 1);
+            if ( (attr.size() != 1) || ( string("xyzwrgba").find(attr) == string::npos ) ) {
+                return false;
+            }
+            dimension = attr;
+            i = attrEnd;
+        }
+    } else if (method == "getValue") {
+        // The dimension defaults to 0
+        dimension = "0";
+        if ( ( args.size() > 1 ) || ( (args.size() == 1) && !lowerPythonDimension(args[0], &dimension) ) ) {
+            return false;
+        }
+    } else if (method == "getValueAtTime") {
+        dimension = "0";
+        if ( args.empty() || (args.size() > 2) || ( (args.size() == 2) && !lowerPythonDimension(args[1], &dimension) ) ) {
+            return false;
+        }
+        time = args[0];
+    } else {
+        return false;
+    }
+
+    for (std::size_t n = 0; n < names.size(); ++n) {
+        if (n > 0) {
+            out->push_back('.');
+        }
+        // The parameter holding the expression is thisParam in Python and thisKnob in ExprTk
+        out->append(names[n] == "thisParam" ? string("thisKnob") : names[n]);
+    }
+    if ( !dimension.empty() ) {
+        out->push_back('.');
+        out->append(dimension);
+    }
+    if ( !time.empty() ) {
+        out->push_back('(');
+        out->append(time);
+        out->push_back(')');
+    }
+    *pos = i;
+
+    return true;
+} // lowerPythonName
+
+/**
+ * @brief Appends to out the translation to ExprTk of the Python expression between begin and end.
+ * @returns False if the expression uses a construct that does not exist in ExprTk or that does not have the same meaning.
+ **/
+static bool
+lowerPythonRange(const string& expr,
+                 std::size_t begin,
+                 std::size_t end,
+                 string* out)
+{
+    std::size_t i = begin;
+    while (i < end) {
+        char c = expr[i];
+        if ( (c == ' ') || (c == '\t') ) {
+            out->push_back(' ');
+            ++i;
+        } else if ( std::isdigit( (unsigned char)c ) || ( (c == '.') && (i + 1 < end) && std::isdigit( (unsigned char)expr[i + 1] ) ) ) {
+            std::size_t j = i;
+            while ( (j < end) && ( std::isdigit( (unsigned char)expr[j] ) || (expr[j] == '.') ) ) {
+                ++j;
+            }
+            if ( (j < end) && ( (expr[j] == 'e') || (expr[j] == 'E') ) ) {
+                ++j;
+                if ( (j < end) && ( (expr[j] == '+') || (expr[j] == '-') ) ) {
+                    ++j;
+                }
+                while ( (j < end) && std::isdigit( (unsigned char)expr[j] ) ) {
+                    ++j;
+                }
+            }
+            // Reject octal, hexadecimal, long and complex literals
+            if ( ( (j < end) && isPythonIdentifierChar(expr[j]) ) || ( (c == '0') && (j > i + 1) && std::isdigit( (unsigned char)expr[i + 1] ) ) ) {
+                return false;
+            }
+            out->append(expr, i, j - i);
+            i = j;
+        } else if ( (c == '+') || (c == '-') ) {
+            out->push_back(c);
+            ++i;
+        } else if ( (c == '*') || (c == '/') ) {
+            // The power operator does not have the same precedence and associativity in ExprTk and floor division does not exist
+            if ( (i + 1 < end) && (expr[i + 1] == c) ) {
+                return false;
+            }
+#if PY_MAJOR_VERSION < 3
+            // Python 2 divides integers with a floor division
+            if (c == '/') {
+                return false;
+            }
+#endif
+            out->push_back(c);
+            ++i;
+        } else if (c == '(') {
+            std::size_t closing = getMatchingParenthesisPosition(i, '(', ')', expr);
+            if ( (closing == string::npos) || (closing >= end) ) {
+                return false;
+            }
+            out->push_back('(');
+            if ( !lowerPythonRange(expr, i + 1, closing, out) ) {
+                return false;
+            }
+            out->push_back(')');
+            i = closing + 1;
+        } else if ( isPythonIdentifierStart(c) ) {
+            if ( !lowerPythonName(expr, end, &i, out) ) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+} // lowerPythonRange
+
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 
@@ -505,7 +840,7 @@ KnobHelperPrivate::parseListenersFromExpression(DimIdx dimension,
     string expressionCopy;
 
     {
-        QMutexLocker k(&common->expressionMutex);
+        ProfiledMutexLocker k(&common->expressionMutex, eLockProfilerSiteKnobExpression);
         ExprPerViewMap::const_iterator foundView = common->expressions[dimension].find(view);
         if ( foundView == common->expressions[dimension].end() ) {
             return;
@@ -736,6 +1071,47 @@ KnobHelperPrivate::validatePythonExpression(const string& expression,
 } // validatePythonExpression
 
 
+KnobExprPtr
+KnobHelperPrivate::lowerPythonExpression(const string& expression,
+                                         DimIdx dimension,
+                                         ViewIdx view,
+                                         bool hasRetVariable) const
+{
+    if ( dynamic_cast<const KnobStringBase*>(publicInterface) ) {
+        return KnobExprPtr();
+    }
+    string exprTkExpression;
+    if ( !hasRetVariable && KnobHelper::lowerPythonExpressionToExprTk(expression, &exprTkExpression) ) {
+        shared_ptr<KnobExprExprTk> obj(new KnobExprExprTk);
+        try {
+            string exprResult;
+            validateExprTkExpression(exprTkExpression, dimension, view, &exprResult, obj.get() );
+
+            // Keep the Python expression for the user interface and the serialization
+            obj->expressionString = expression;
+            obj->language = eExpressionLanguagePython;
+            obj->executionLanguage = eExpressionLanguageExprTk;
+
+            return obj;
+        } catch (const std::exception& /*e*/) {
+            // The parameters it references do not exist in the ExprTk dialect, evaluate with Python
+        }
+    }
+
+    KnobHolderPtr holder = publicInterface->getHolder();
+    EffectInstancePtr effect = toEffectInstance(holder);
+    QString knobName = QString::fromUtf8( publicInterface->getName().c_str() );
+    if (effect) {
+        knobName.prepend( QString::fromUtf8( effect->getNode()->getFullyQualifiedName().c_str() ) + QLatin1Char('.') );
+    }
+    appPTR->writeToErrorLog_mt_safe( knobName, QDateTime::currentDateTime(),
+                                     KnobHelper::tr("The expression \"%1\" cannot be converted to ExprTk and will be evaluated by Python, which prevents renders from running in parallel. "
+                                                    "Only numbers, arithmetic operators, frame, the math module and the get(), getValue() and getValueAtTime() functions of parameters can be converted.").arg( QString::fromUtf8( expression.c_str() ) ) );
+
+    return KnobExprPtr();
+} // lowerPythonExpression
+
+
 void
 KnobHelper::validateExpression(const string& expression,
                                ExpressionLanguageEnum language,
@@ -756,6 +1132,23 @@ KnobHelper::validateExpression(const string& expression,
 } // KnobHelper::validateExpression
 
 
+bool
+KnobHelper::lowerPythonExpressionToExprTk(const string& pythonExpression,
+                                          string* exprTkExpression)
+{
+    if ( pythonExpression.find('\n') != string::npos ) {
+        return false;
+    }
+    string ret;
+    if ( !lowerPythonRange(pythonExpression, 0, pythonExpression.size(), &ret) || ( ret.find_first_not_of(' ') == string::npos ) ) {
+        return false;
+    }
+    *exprTkExpression = ret;
+
+    return true;
+} // lowerPythonExpressionToExprTk
+
+
 NATRON_NAMESPACE_ANONYMOUS_ENTER
 
 struct ExprToReApply
@@ -781,7 +1174,7 @@ KnobHelper::checkInvalidLinks()
     
     vector<ExprToReApply> exprToReapply;
     {
-        QMutexLocker k(&_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         for (int i = 0; i < ndims; ++i) {
             for (PerViewInvalidLinkError::const_iterator it = _imp->common->linkErrors[i].begin(); it != _imp->common->linkErrors[i].end(); ++it) {
                 if ( it->second.empty() ) {
@@ -812,7 +1205,7 @@ KnobHelper::checkInvalidLinks()
     }
     {
 
-        QMutexLocker k(&_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         for (int i = 0;i < ndims; ++i) {
             for (PerViewInvalidLinkError::const_iterator it = _imp->common->linkErrors[i].begin(); it != _imp->common->linkErrors[i].end(); ++it) {
                 if (!it->second.empty()) {
@@ -838,7 +1231,7 @@ KnobHelper::isLinkValid(DimIdx dimension,
 
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
     {
-        QMutexLocker k(&_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         if (error) {
             PerViewInvalidLinkError::const_iterator foundView = _imp->common->linkErrors[dimension].find(view_i);
             if ( ( foundView != _imp->common->linkErrors[dimension].end() ) ) {
@@ -863,7 +1256,7 @@ KnobHelper::setLinkStatusInternal(DimIdx dimension,
     
     bool wasValid;
     {
-        QMutexLocker k(&_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         std::string& linkError = _imp->common->linkErrors[dimension][view];
         wasValid = linkError.empty();
         linkError = error;
@@ -877,7 +1270,7 @@ KnobHelper::setLinkStatusInternal(DimIdx dimension,
         {
             int ndims = getNDimensions();
             std::list<ViewIdx> views = getViewsList();
-            QMutexLocker k(&_imp->common->expressionMutex);
+            ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
             for (int i = 0; i < ndims; ++i) {
                 if (i != dimension) {
                     for (PerViewInvalidLinkError::const_iterator it = _imp->common->linkErrors[i].begin(); it != _imp->common->linkErrors[i].end(); ++it) {
@@ -961,8 +1354,17 @@ KnobHelper::setExpressionInternal(DimIdx dimension,
             expressionObj = obj;
             expressionObj->expressionString = expression;
             expressionObj->language = language;
+            expressionObj->executionLanguage = language;
             obj->modifiedExpression = _imp->validatePythonExpression(expression, dimension, view, hasRetVariable, &exprResult);
             obj->hasRet = hasRetVariable;
+
+            // The expression is valid Python: if it can also be expressed in the ExprTk dialect, evaluate it
+            // with ExprTk so that renders do not have to take the Python GIL.
+            // String parameters are excluded because the frame and view variables are strings for them in ExprTk.
+            KnobExprPtr loweredObj = _imp->lowerPythonExpression(expression, dimension, view, hasRetVariable);
+            if (loweredObj) {
+                expressionObj = loweredObj;
+            }
         }
         break;
         case eExpressionLanguageExprTk: {
@@ -970,6 +1372,7 @@ KnobHelper::setExpressionInternal(DimIdx dimension,
             expressionObj = obj;
             expressionObj->expressionString = expression;
             expressionObj->language = language;
+            expressionObj->executionLanguage = language;
             _imp->validateExprTkExpression( expression, dimension, view, &exprResult, obj.get() );
         }
         break;
@@ -983,7 +1386,7 @@ KnobHelper::setExpressionInternal(DimIdx dimension,
     }
 
     {
-        QMutexLocker k(&_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         _imp->common->expressions[dimension][view] = expressionObj;
     }
 
@@ -995,7 +1398,7 @@ KnobHelper::setExpressionInternal(DimIdx dimension,
         // Populate the listeners set so we can keep track of user links.
         // In python, the dependencies tracking is done by executing the expression itself unlike exprtk
         // where we have the dependencies list directly when compiling
-        switch (language) {
+        switch (expressionObj->executionLanguage) {
             case eExpressionLanguagePython: {
                 EXPR_RECURSION_LEVEL();
                 _imp->parseListenersFromExpression(dimension, view);
@@ -1149,7 +1552,7 @@ KnobHelper::getExpressionLanguage(Natron::ViewIdx view,
         throw std::invalid_argument("KnobHelper::getExpressionLanguage(): Dimension out of range");
     }
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
-    QMutexLocker k(&_imp->common->expressionMutex);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
     ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view_i);
     if ( foundView == _imp->common->expressions[dimension].end() ) {
         return eExpressionLanguageExprTk;
@@ -1162,6 +1565,43 @@ KnobHelper::getExpressionLanguage(Natron::ViewIdx view,
 }
 
 
+ExpressionLanguageEnum
+KnobHelper::getExpressionExecutionLanguage(ViewIdx view,
+                                           DimIdx dimension) const
+{
+    if ( (dimension < 0) || ( dimension >= (int)_imp->common->expressions.size() ) ) {
+        throw std::invalid_argument("KnobHelper::getExpressionExecutionLanguage(): Dimension out of range");
+    }
+    ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
+    ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view_i);
+    if ( ( foundView == _imp->common->expressions[dimension].end() ) || !foundView->second ) {
+        return eExpressionLanguageExprTk;
+    }
+
+    return foundView->second->executionLanguage;
+}
+
+bool
+KnobHelper::canCacheExpressionResults(ViewIdx view,
+                                      DimIdx dimension) const
+{
+    if ( (dimension < 0) || ( dimension >= (int)_imp->common->expressions.size() ) ) {
+        throw std::invalid_argument("KnobHelper::canCacheExpressionResults(): Dimension out of range");
+    }
+    ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
+    if (!_imp->common->enableExpressionCaching) {
+        return false;
+    }
+    ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view_i);
+    if ( ( foundView == _imp->common->expressions[dimension].end() ) || !foundView->second ) {
+        return true;
+    }
+    const KnobExprExprTk* isExprTk = dynamic_cast<const KnobExprExprTk*>( foundView->second.get() );
+    return !isExprTk || isExprTk->effectDependencies.empty();
+}
+
 bool
 KnobHelper::isExpressionUsingRetVariable(ViewIdx view,
                                          DimIdx dimension) const
@@ -1170,7 +1610,7 @@ KnobHelper::isExpressionUsingRetVariable(ViewIdx view,
         throw std::invalid_argument("KnobHelper::isExpressionUsingRetVariable(): Dimension out of range");
     }
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
-    QMutexLocker k(&_imp->common->expressionMutex);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
     ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view_i);
     if ( foundView == _imp->common->expressions[dimension].end() ) {
         return false;
@@ -1196,7 +1636,7 @@ KnobHelper::getExpressionDependencies(DimIdx dimension,
         throw std::invalid_argument("KnobHelper::getExpressionDependencies(): Dimension out of range");
     }
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
-    QMutexLocker k(&_imp->common->expressionMutex);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
     ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view_i);
     if ( ( foundView == _imp->common->expressions[dimension].end() ) || !foundView->second ) {
         return false;
@@ -1231,7 +1671,7 @@ KnobHelper::clearExpressionInternal(DimIdx dimension,
     KnobIPtr thisShared = shared_from_this();
     KnobDimViewKeySet dependencies;
     {
-        QMutexLocker k(&_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         ExprPerViewMap::iterator foundView = _imp->common->expressions[dimension].find(view);
         if ( ( foundView != _imp->common->expressions[dimension].end() ) && foundView->second ) {
             hadExpression = true;
@@ -1270,7 +1710,7 @@ KnobHelper::clearExpressionInternal(DimIdx dimension,
 
             // Remove from the other knob's listeners list
             {
-                QMutexLocker otherMastersLocker(&other->_imp->common->expressionMutex);
+                ProfiledMutexLocker otherMastersLocker(&other->_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
                 KnobDimViewKeySet& otherListeners = other->_imp->common->listeners[it->dimension][it->view];
                 KnobDimViewKeySet::iterator foundListener = otherListeners.find(listenerToRemoveKey);
                 if ( foundListener != otherListeners.end() ) {
@@ -1447,7 +1887,7 @@ KnobHelper::executePythonExpression(TimeValue time,
 
     string expr;
     {
-        QMutexLocker k(&_imp->common->expressionMutex);
+        ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
         ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view);
         if ( ( foundView == _imp->common->expressions[dimension].end() ) || !foundView->second ) {
             return false;
@@ -1519,7 +1959,7 @@ KnobHelper::getExpression(DimIdx dimension,
         throw std::invalid_argument("Knob::getExpression: Dimension out of range");
     }
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
-    QMutexLocker k(&_imp->common->expressionMutex);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
     ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view_i);
     if ( ( foundView == _imp->common->expressions[dimension].end() ) || !foundView->second ) {
         return string();
@@ -1535,7 +1975,7 @@ KnobHelper::hasExpression(DimIdx dimension, ViewIdx view) const
         throw std::invalid_argument("Knob::hasExpression: Dimension out of range");
     }
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
-    QMutexLocker k(&_imp->common->expressionMutex);
+    ProfiledMutexLocker k(&_imp->common->expressionMutex, eLockProfilerSiteKnobExpression);
     ExprPerViewMap::const_iterator foundView = _imp->common->expressions[dimension].find(view_i);
     if ( ( foundView == _imp->common->expressions[dimension].end() ) || !foundView->second ) {
         return false;
@@ -34,6 +34,10 @@
 #include <QtCore/QMutexLocker>
 #include <QtCore/QDebug>
 
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
 #include "Engine/EffectInstance.h"
 #include "Engine/Transform.h"
 #include "Engine/KnobTypes.h"
@@ -158,7 +162,7 @@ FileKnobDimView::setValueAndCheckIfChanged(const std::string& value)
     std::string str = value;
     KnobIPtr knob;
     {
-        QMutexLocker k(&valueMutex);
+        ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
         knob = sharedKnobs.begin()->knob.lock();
     }
 
@@ -178,7 +182,7 @@ FileKnobDimView::setKeyFrame(const KeyFrame& key, SetKeyFrameFlags flags)
 {
     KnobIPtr knob;
     {
-        QMutexLocker k(&valueMutex);
+        ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
         knob = sharedKnobs.begin()->knob.lock();
     }
 
@@ -201,7 +205,7 @@ FileKnobDimView::setKeyFrame(const KeyFrame& key, SetKeyFrameFlags flags)
 KnobDimViewBasePtr
 KnobFile::createDimViewData() const
 {
-    boost::shared_ptr<FileKnobDimView> ret(new FileKnobDimView);
+    boost::shared_ptr<FileKnobDimView> ret = boost::make_shared<FileKnobDimView>();
     return ret;
 }
 
@@ -628,7 +632,7 @@ KnobPath::setDefaultValuesWithoutApplying(const std::vector<std::string>& values
 KnobDimViewBasePtr
 KnobPath::createDimViewData() const
 {
-    boost::shared_ptr<FileKnobDimView> ret(new FileKnobDimView);
+    boost::shared_ptr<FileKnobDimView> ret = boost::make_shared<FileKnobDimView>();
     return ret;
 }
 
@@ -56,29 +56,29 @@ Knob<T>::getValueFromExpression(TimeValue time,
 
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
 
-    // Check for a cached expression result
-    // TODO
-
-    bool cachingEnabled = isExpressionsResultsCachingEnabled();
+    // Results are memoized per time and view so that the knobs referenced by the expression are evaluated
+    // once per frame even if they are read by many expressions. They are keyed by the view that was actually
+    // evaluated so that all the views that are not split share them and are cleared with them.
+    bool cachingEnabled = canCacheExpressionResults(view_i, dimension);
     bool exprWasValid = isLinkValid(dimension, view_i, 0);
     {
         EXPR_RECURSION_LEVEL();
 
-        TimeViewPair key = {time, view};
+        TimeViewPair key = {time, view_i};
 
         bool exprOk = false;
         if (cachingEnabled) {
             QMutexLocker k(&_data->expressionResultsMutex);
             assert(dimension < (int)_data->expressionResults.size());
-            typename ExpressionCache::const_iterator foundCached = _data->expressionResults[dimension][view].find(key);
-            if (foundCached != _data->expressionResults[dimension][view].end()) {
+            typename ExpressionCache::const_iterator foundCached = _data->expressionResults[dimension][view_i].find(key);
+            if (foundCached != _data->expressionResults[dimension][view_i].end()) {
                 exprOk = true;
                 *ret = foundCached->second;
             }
         }
         std::string error;
         if (!exprOk) {
-            if (getExpressionLanguage(view, dimension) == eExpressionLanguagePython) {
+            if (getExpressionExecutionLanguage(view, dimension) == eExpressionLanguagePython) {
                 EffectInstancePtr effect = toEffectInstance(getHolder());
                 if (effect) {
                     appPTR->setLastPythonAPICaller_TLS(effect);
@@ -88,7 +88,7 @@ Knob<T>::getValueFromExpression(TimeValue time,
             exprOk = evaluateExpression(time, view_i,  dimension, ret, &error);
             if (exprOk && cachingEnabled) {
                 QMutexLocker k(&_data->expressionResultsMutex);
-                _data->expressionResults[dimension][view].insert(std::make_pair(key, *ret));
+                _data->expressionResults[dimension][view_i].insert(std::make_pair(key, *ret));
             }
         }
         if (!exprOk) {
@@ -171,21 +171,19 @@ Knob<T>::getValueFromExpression_pod(TimeValue time,
 
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
     
-    // Check for a cached expression result
-    // Todo
-
-    bool cachingEnabled = isExpressionsResultsCachingEnabled();
+    // Results are memoized per time and view, see getValueFromExpression
+    bool cachingEnabled = canCacheExpressionResults(view_i, dimension);
     bool exprWasValid = isLinkValid(dimension, view_i, 0);
     {
         EXPR_RECURSION_LEVEL();
         std::string error;
         bool exprOk = false;
-        TimeViewPair key = {time, view};
+        TimeViewPair key = {time, view_i};
         if (cachingEnabled) {
             QMutexLocker k(&_data->expressionResultsMutex);
             assert(dimension < (int)_data->expressionResults.size());
-            typename ExpressionCache::const_iterator foundCached = _data->expressionResults[dimension][view].find(key);
-            if (foundCached != _data->expressionResults[dimension][view].end()) {
+            typename ExpressionCache::const_iterator foundCached = _data->expressionResults[dimension][view_i].find(key);
+            if (foundCached != _data->expressionResults[dimension][view_i].end()) {
                 exprOk = true;
                 *ret = (double)foundCached->second;
             }
@@ -194,7 +192,7 @@ Knob<T>::getValueFromExpression_pod(TimeValue time,
             exprOk = evaluateExpression_pod(time, view_i, dimension, ret, &error);
             if (exprOk && cachingEnabled) {
                 QMutexLocker k(&_data->expressionResultsMutex);
-                _data->expressionResults[dimension][view].insert(std::make_pair(key, (T)*ret));
+                _data->expressionResults[dimension][view_i].insert(std::make_pair(key, (T)*ret));
             }
         }
         if (!exprOk) {
@@ -229,7 +227,7 @@ Knob<T>::getValueInternal(TimeValue tlsCurrentTime,
         return T();
     }
     {
-        QMutexLocker k(&dataForDimView->valueMutex);
+        ProfiledMutexLocker k(&dataForDimView->valueMutex, eLockProfilerSiteKnobValue);
         if (clamp) {
             T ret = clampToMinMax(dataForDimView->value, dimension);
             if (_valuesCache) {
@@ -267,6 +265,14 @@ Knob<T>::getValue(DimIdx dimension,
 
 
 
+    // A render clone reads static values from its snapshot without locking
+    {
+        T ret;
+        if ( getValueFromSnapshot(dimension, view, clamp, &ret) ) {
+            return ret;
+        }
+    }
+
     // Figure out the view to read
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
 
@@ -351,7 +357,7 @@ Knob<T>::getCurveKeyFrame(TimeValue time,
 {
 
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
-    CurvePtr curve = getAnimationCurve(view_i, dimension);
+    CurvePtr curve = getAnimationCurveIfCreated(view_i, dimension);
 
     if ( curve && (curve->getKeyFramesCount() > 0) ) {
         //getValueAt already clamps to the range for us
@@ -403,6 +409,13 @@ Knob<T>::getValueAtTime(TimeValue time,
         throw std::invalid_argument("Knob::getValueAtTime: dimension out of range");
     }
 
+    // A static value is the same at any time
+    {
+        T ret;
+        if ( getValueFromSnapshot(dimension, view, clamp, &ret) ) {
+            return ret;
+        }
+    }
 
     // Figure out the view to read
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
@@ -455,6 +468,55 @@ Knob<T>::getValueAtTime(TimeValue time,
     return getValueInternal(time, dimension, view_i, clamp);
 } // getValueAtTime
 
+template<typename T>
+void
+Knob<T>::getValuesAtTimes(const TimeValue* times,
+                          T* values,
+                          int n,
+                          DimIdx dimension,
+                          ViewIdx view,
+                          bool clamp)
+{
+    if (n <= 0) {
+        return;
+    }
+    if  ( ( dimension >= getNDimensions() ) || (dimension < 0) ) {
+        throw std::invalid_argument("Knob::getValuesAtTimes: dimension out of range");
+    }
+
+    ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
+    CurvePtr curve = getAnimationCurveIfCreated(view_i, dimension);
+
+    // Values cached on render clones and expressions are handled by getValueAtTime
+    if ( _valuesCache || !curve || (curve->getKeyFramesCount() == 0) || !getExpression(dimension, view).empty() ) {
+        for (int i = 0; i < n; ++i) {
+            values[i] = getValueAtTime(times[i], dimension, view, clamp);
+        }
+        return;
+    }
+
+    std::vector<double> curveValues(n);
+    curve->getValuesAt(times, &curveValues[0], n, clamp);
+    for (int i = 0; i < n; ++i) {
+        values[i] = (T)curveValues[i];
+    }
+} // getValuesAtTimes
+
+template<>
+void
+KnobStringBase::getValuesAtTimes(const TimeValue* times,
+                                 std::string* values,
+                                 int n,
+                                 DimIdx dimension,
+                                 ViewIdx view,
+                                 bool clamp)
+{
+    // String curves may use a custom interpolation and return the string of the keyframe
+    for (int i = 0; i < n; ++i) {
+        values[i] = getValueAtTime(times[i], dimension, view, clamp);
+    }
+}
+
 
 template<typename T>
 double
@@ -475,8 +537,8 @@ Knob<T>::getDerivativeAtTime(TimeValue time,
 
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
 
-    CurvePtr curve  = getAnimationCurve(view_i, dimension);
-    if (curve->getKeyFramesCount() > 0) {
+    CurvePtr curve  = getAnimationCurveIfCreated(view_i, dimension);
+    if ( curve && (curve->getKeyFramesCount() > 0) ) {
         return curve->getDerivativeAt(time);
     } else {
         /*if the knob as no keys at this dimension, the derivative is 0.*/
@@ -551,8 +613,8 @@ Knob<T>::getIntegrateFromTimeToTime(TimeValue time1,
 
     ViewIdx view_i = checkIfViewExistsOrFallbackMainView(view);
 
-    CurvePtr curve  = getAnimationCurve(view_i, dimension);
-    if (curve->getKeyFramesCount() > 0) {
+    CurvePtr curve  = getAnimationCurveIfCreated(view_i, dimension);
+    if ( curve && (curve->getKeyFramesCount() > 0) ) {
         return curve->getIntegrateFromTo(time1, time2);
     } else {
         // if the knob as no keys at this dimension, the integral is trivial
@@ -38,6 +38,7 @@
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/make_shared.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 
@@ -156,7 +157,8 @@ template <typename T>
 void
 Knob<T>::refreshCurveMinMaxInternal(ViewIdx view, DimIdx dimension)
 {
-    CurvePtr curve = getAnimationCurve(view, dimension);
+    // Curves that were not created yet get the range when they are created
+    CurvePtr curve = getAnimationCurveIfCreated(view, dimension);
     if (!curve) {
         return;
     }
@@ -181,6 +183,7 @@ Knob<T>::setMinimum(const T& mini, DimSpec dimension)
             _data->minimums[dimension] = mini;
         }
     }
+    invalidateValuesSnapshot();
     refreshCurveMinMax(ViewSetSpec::all(), dimension);
     _signalSlotHandler->s_minMaxChanged(dimension);
 }
@@ -199,6 +202,7 @@ Knob<T>::setMaximum(const T& maxi, DimSpec dimension)
             _data->maximums[dimension] = maxi;
         }
     }
+    invalidateValuesSnapshot();
     refreshCurveMinMax(ViewSetSpec::all(), dimension);
     _signalSlotHandler->s_minMaxChanged(dimension);
 }
@@ -221,6 +225,7 @@ Knob<T>::setRange(const T& mini,
             _data->maximums[dimension] = maxi;
         }
     }
+    invalidateValuesSnapshot();
     refreshCurveMinMax(ViewSetSpec::all(), dimension);
     _signalSlotHandler->s_minMaxChanged(dimension);
 }
@@ -258,6 +263,7 @@ Knob<T>::setRangeAcrossDimensions(const std::vector<T> &minis,
         _data->minimums = minis;
         _data->maximums = maxis;
     }
+    invalidateValuesSnapshot();
     refreshCurveMinMax(ViewSetSpec::all(), DimSpec::all());
     _signalSlotHandler->s_minMaxChanged(DimSpec::all());
 }
@@ -515,7 +521,7 @@ Knob<T>::evaluateExpression(TimeValue time,
         throw std::invalid_argument("KnobHelper::evaluateExpression(): Dimension out of range");
     }
 
-    ExpressionLanguageEnum lang = getExpressionLanguage(view, dimension);
+    ExpressionLanguageEnum lang = getExpressionExecutionLanguage(view, dimension);
     switch (lang) {
         case eExpressionLanguagePython: {
             PythonGILLocker pgl;
@@ -556,7 +562,7 @@ Knob<T>::evaluateExpression_pod(TimeValue time,
         throw std::invalid_argument("KnobHelper::evaluateExpression_pod(): Dimension out of range");
     }
 
-    ExpressionLanguageEnum lang = getExpressionLanguage(view, dimension);
+    ExpressionLanguageEnum lang = getExpressionExecutionLanguage(view, dimension);
     switch (lang) {
         case eExpressionLanguagePython: {
             PythonGILLocker pgl;
@@ -846,7 +852,8 @@ template <typename T>
 KnobDimViewBasePtr
 Knob<T>::createDimViewData() const
 {
-    KnobDimViewBasePtr ret(new ValueKnobDimView<T>);
+    // A single allocation for the data and its reference count
+    KnobDimViewBasePtr ret = boost::make_shared<ValueKnobDimView<T> >();
     return ret;
 }
 
@@ -902,8 +909,8 @@ ValueKnobDimView<T>::copy(const CopyInArgs& inArgs, CopyOutArgs* outArgs)
     if (!inArgs.other) {
         return hasChanged;
     }
-    QMutexLocker k(&valueMutex);
-    QMutexLocker k2(&inArgs.other->valueMutex);
+    ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
+    ProfiledMutexLocker k2(&inArgs.other->valueMutex, eLockProfilerSiteKnobValue);
 
     hasChanged |= copyValueForTypeGuess(*inArgs.other, this);
     return hasChanged;
@@ -918,6 +925,7 @@ Knob<T>::populate()
 
     if (getHolder() && getHolder()->isRenderClone()) {
         _valuesCache.reset(new ValuesCacheMap);
+        _valuesSnapshot = getOrCreateValuesSnapshot();
     }
     int nDims = getNDimensions();
     _data->expressionResults.resize(nDims);
@@ -933,6 +941,90 @@ Knob<T>::populate()
     }
 }
 
+template<typename T>
+typename Knob<T>::ValuesSnapshotPtr
+Knob<T>::getOrCreateValuesSnapshot() const
+{
+    unsigned int revision;
+    {
+        QMutexLocker k(&_data->valuesSnapshotMutex);
+        if (_data->valuesSnapshot) {
+            return _data->valuesSnapshot;
+        }
+        revision = _data->valuesSnapshotRevision;
+    }
+
+    // Build the snapshot without holding the mutex: invalidateValuesSnapshot() may be called
+    // while the value mutexes are held.
+    boost::shared_ptr<ValuesSnapshot> snapshot(new ValuesSnapshot);
+    int nDims = getNDimensions();
+    snapshot->values.resize(nDims);
+    std::list<ViewIdx> views = getViewsList();
+    for (int i = 0; i < nDims; ++i) {
+        for (std::list<ViewIdx>::const_iterator it = views.begin(); it != views.end(); ++it) {
+            SnapshotValue& value = snapshot->values[i][*it];
+            value.isStatic = false;
+            if ( !getExpression(DimIdx(i), *it).empty() || isAnimated(DimIdx(i), *it) ) {
+                continue;
+            }
+            ValueKnobDimView<T>* dataForDimView = dynamic_cast<ValueKnobDimView<T>*>( getDataForDimView(DimIdx(i), *it).get() );
+            if (!dataForDimView) {
+                continue;
+            }
+            {
+                ProfiledMutexLocker k(&dataForDimView->valueMutex, eLockProfilerSiteKnobValue);
+                value.value = dataForDimView->value;
+            }
+            value.clampedValue = clampToMinMax(value.value, DimIdx(i));
+            value.isStatic = true;
+        }
+    }
+
+    QMutexLocker k(&_data->valuesSnapshotMutex);
+    // Do not share the snapshot if the knob changed in the meantime
+    if (revision == _data->valuesSnapshotRevision) {
+        _data->valuesSnapshot = snapshot;
+    }
+
+    return snapshot;
+} // getOrCreateValuesSnapshot
+
+template<typename T>
+void
+Knob<T>::invalidateValuesSnapshot()
+{
+    QMutexLocker k(&_data->valuesSnapshotMutex);
+    _data->valuesSnapshot.reset();
+    ++_data->valuesSnapshotRevision;
+}
+
+template<typename T>
+bool
+Knob<T>::getValueFromSnapshot(DimIdx dimension,
+                              ViewIdx view,
+                              bool clamp,
+                              T* ret) const
+{
+    if (!_valuesSnapshot) {
+        return false;
+    }
+    const PerViewSnapshotValues& values = _valuesSnapshot->values[dimension];
+    typename PerViewSnapshotValues::const_iterator found = values.find(view);
+    if ( found == values.end() ) {
+        // The view is not split, read the main view
+        found = values.find( ViewIdx(0) );
+        if ( found == values.end() ) {
+            return false;
+        }
+    }
+    if (!found->second.isStatic) {
+        return false;
+    }
+    *ret = clamp ? found->second.clampedValue : found->second.value;
+
+    return true;
+} // getValueFromSnapshot
+
 template<typename T>
 bool
 Knob<T>::isTypePOD() const
@@ -1072,7 +1164,7 @@ Knob<T>::copyValuesFromCurve(DimIdx dim, ViewIdx view)
     ValueKnobDimView<T>* dataType = dynamic_cast<ValueKnobDimView<T>*>(data.get());
     assert(dataType);
 
-    QMutexLocker l(&data->valueMutex);
+    ProfiledMutexLocker l(&data->valueMutex, eLockProfilerSiteKnobValue);
     dataType->value = v;
 
 } // copyValuesFromCurve
@@ -1085,7 +1177,7 @@ Knob<T>::copyValuesFromCurve(DimIdx dim, ViewIdx view)
 template <typename T>
 void handleAnimatedHashing(Knob<T>* knob, ViewIdx view, DimIdx dimension, Hash64* hash)
 {
-    CurvePtr curve = knob->getAnimationCurve(view, dimension);
+    CurvePtr curve = knob->getAnimationCurveIfCreated(view, dimension);
     assert(curve);
     Hash64::appendCurve(curve, hash);
 
@@ -1283,6 +1375,9 @@ Knob<T>::areDimensionsEqual(ViewIdx view)
             if (*dimCurve != *curve0) {
                 return false;
             }
+        } else if ( (dimCurve && dimCurve->isAnimated()) || (curve0 && curve0->isAnimated()) ) {
+            // Only one of the curves was created, they differ if it has keyframes
+            return false;
         }
 
 
@@ -26,6 +26,9 @@
 
 #include "KnobItemsTable.h"
 
+#include <algorithm> // max
+#include <map>
+#include <set>
 #include <sstream> // stringstream
 
 #include <QMutex>
@@ -52,6 +55,9 @@ struct ColumnHeader
     std::string tooltip;
 };
 
+// The items of a container (the top-level items of a table or the children of an item) by script-name
+typedef std::map<std::string, KnobTableItemWPtr> KnobTableItemsByNameMap;
+
 class KnobItemsTablesMetaTypesRegistration
 {
 public:
@@ -75,6 +81,7 @@ struct KnobItemsTableCommon
     KnobItemsTable::TableSelectionModeEnum selectionMode;
     std::vector<ColumnHeader> headers;
     std::vector<KnobTableItemPtr> topLevelItems;
+    KnobTableItemsByNameMap topLevelItemsByName;
     std::list<KnobTableItemWPtr> selectedItems;
     std::string iconsPath;
     bool uniformRowsHeight;
@@ -110,6 +117,7 @@ struct KnobItemsTableCommon
     , selectionMode(KnobItemsTable::eTableSelectionModeExtendedSelection)
     , headers()
     , topLevelItems()
+    , topLevelItemsByName()
     , selectedItems()
     , iconsPath()
     , uniformRowsHeight(false)
@@ -182,7 +190,35 @@ struct KnobItemsTablePrivate
         
     }
 
-    static KnobTableItemPtr getItemByScriptNameInternal(const std::string& name, const std::string& recurseName,  const std::vector<KnobTableItemPtr>& items);
+    static KnobTableItemPtr getItemByScriptNameInternal(const std::string& name, const std::string& recurseName, const KnobTableItem* parent, const KnobItemsTable* table);
+
+    /**
+     * @brief Inserts the item in the given container, the lock of the container must be held.
+     * This does not refresh the index of the items that were after the insertion position, see refreshIndicesInContainer.
+     **/
+    static void insertInContainer(int index, const KnobTableItemPtr& item, std::vector<KnobTableItemPtr>* container, KnobTableItemsByNameMap* names);
+
+    /**
+     * @brief Removes the items from the given container, the lock of the container must be held.
+     * @returns The index of the first removed item or -1 if none of them was in the container.
+     * This does not refresh the index of the items that were after the removed items, see refreshIndicesInContainer.
+     **/
+    static int removeFromContainer(const std::set<KnobTableItemPtr>& items, std::vector<KnobTableItemPtr>* container, KnobTableItemsByNameMap* names, std::list<KnobTableItemPtr>* removedItems);
+
+    /**
+     * @brief Refresh the index in parent of all items in the container from the given index, the lock of the container must be held.
+     **/
+    static void refreshIndicesInContainer(const std::vector<KnobTableItemPtr>& container, int firstIndex);
+
+    /**
+     * @brief Returns the index of the item in the container, the lock of the container must be held.
+     **/
+    static int findInContainer(const KnobTableItem* item, const std::vector<KnobTableItemPtr>& container);
+
+    /**
+     * @brief Must be called when the script-name of an item changes so that it can still be found by name in its container
+     **/
+    static void onItemScriptNameChanged(const KnobTableItemPtr& item, const std::string& oldName, const std::string& newName);
 
 };
 
@@ -209,6 +245,13 @@ struct KnobTableItemCommon
     // A list of children. This item holds a strong reference to them
     std::vector<KnobTableItemPtr> children;
 
+    // The children by script-name
+    KnobTableItemsByNameMap childrenByName;
+
+    // The index of this item in the children of its parent or in the top-level items of the model, or -1.
+    // This is protected by the lock of the container, i.e: the lock of the parent or the top-level items lock of the model.
+    int indexInParent;
+
     // The columns used by the item. If the column name empty, the column will be empty in the Gui
     std::vector<ColumnDesc> columns;
 
@@ -226,6 +269,8 @@ struct KnobTableItemCommon
     KnobTableItemCommon(const KnobItemsTablePtr& model)
     : parent()
     , children()
+    , childrenByName()
+    , indexInParent(-1)
     , columns()
     , model(model)
     , scriptName()
@@ -450,6 +495,142 @@ KnobItemsTable::getSelectionMode() const
     return _imp->common->selectionMode;
 }
 
+void
+KnobItemsTablePrivate::insertInContainer(int index,
+                                         const KnobTableItemPtr& item,
+                                         std::vector<KnobTableItemPtr>* container,
+                                         KnobTableItemsByNameMap* names)
+{
+    if (index < 0 || index >= (int)container->size()) {
+        index = (int)container->size();
+        container->push_back(item);
+    } else {
+        container->insert(container->begin() + index, item);
+    }
+    item->_imp->common->indexInParent = index;
+
+    std::string name = item->getScriptName_mt_safe();
+    if (!name.empty()) {
+        (*names)[name] = item;
+    }
+} // insertInContainer
+
+int
+KnobItemsTablePrivate::removeFromContainer(const std::set<KnobTableItemPtr>& items,
+                                           std::vector<KnobTableItemPtr>* container,
+                                           KnobTableItemsByNameMap* names,
+                                           std::list<KnobTableItemPtr>* removedItems)
+{
+    int firstIndex = -1;
+    if (items.size() == 1) {
+        // Do not go through all items of the container to remove a single item
+        firstIndex = findInContainer(items.begin()->get(), *container);
+        if (firstIndex != -1) {
+            container->erase(container->begin() + firstIndex);
+        }
+    } else {
+        // Remove all items in a single pass
+        std::size_t nKeptItems = 0;
+        for (std::size_t i = 0; i < container->size(); ++i) {
+            if (items.find((*container)[i]) != items.end()) {
+                if (firstIndex == -1) {
+                    firstIndex = (int)i;
+                }
+                continue;
+            }
+            if (nKeptItems != i) {
+                (*container)[nKeptItems] = (*container)[i];
+            }
+            ++nKeptItems;
+        }
+        container->resize(nKeptItems);
+    }
+    if (firstIndex == -1) {
+        return -1;
+    }
+
+    for (std::set<KnobTableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        if ((*it)->_imp->common->indexInParent == -1) {
+            continue;
+        }
+        // Only unregister the name if it is not used by another item
+        KnobTableItemsByNameMap::iterator foundName = names->find((*it)->getScriptName_mt_safe());
+        if (foundName != names->end() && foundName->second.lock() == *it) {
+            names->erase(foundName);
+        }
+        (*it)->_imp->common->indexInParent = -1;
+        removedItems->push_back(*it);
+    }
+    return firstIndex;
+} // removeFromContainer
+
+void
+KnobItemsTablePrivate::refreshIndicesInContainer(const std::vector<KnobTableItemPtr>& container, int firstIndex)
+{
+    for (std::size_t i = std::max(firstIndex, 0); i < container.size(); ++i) {
+        container[i]->_imp->common->indexInParent = (int)i;
+    }
+}
+
+int
+KnobItemsTablePrivate::findInContainer(const KnobTableItem* item, const std::vector<KnobTableItemPtr>& container)
+{
+    int index = item->_imp->common->indexInParent;
+    if (index == -1) {
+        return -1;
+    }
+    if (index < (int)container.size() && container[index].get() == item) {
+        return index;
+    }
+
+    // The index may not be refreshed yet while inserting multiple items or this is a render clone which is never
+    // in the container
+    for (std::size_t i = 0; i < container.size(); ++i) {
+        if (container[i].get() == item) {
+            return (int)i;
+        }
+    }
+    return -1;
+} // findInContainer
+
+static void
+renameItemInContainer(const KnobTableItemPtr& item,
+                      const std::string& oldName,
+                      const std::string& newName,
+                      const std::vector<KnobTableItemPtr>& container,
+                      KnobTableItemsByNameMap* names)
+{
+    if (KnobItemsTablePrivate::findInContainer(item.get(), container) == -1) {
+        return;
+    }
+    KnobTableItemsByNameMap::iterator foundName = names->find(oldName);
+    if (foundName != names->end() && foundName->second.lock() == item) {
+        names->erase(foundName);
+    }
+    if (!newName.empty()) {
+        (*names)[newName] = item;
+    }
+}
+
+void
+KnobItemsTablePrivate::onItemScriptNameChanged(const KnobTableItemPtr& item,
+                                               const std::string& oldName,
+                                               const std::string& newName)
+{
+    KnobTableItemPtr parent = item->getParent();
+    if (parent) {
+        QMutexLocker k(&parent->_imp->common->lock);
+        renameItemInContainer(item, oldName, newName, parent->_imp->common->children, &parent->_imp->common->childrenByName);
+    } else {
+        KnobItemsTablePtr model = item->getModel();
+        if (!model) {
+            return;
+        }
+        QMutexLocker k(&model->_imp->common->topLevelItemsLock);
+        renameItemInContainer(item, oldName, newName, model->_imp->common->topLevelItems, &model->_imp->common->topLevelItemsByName);
+    }
+}
+
 void
 KnobItemsTable::addItem(const KnobTableItemPtr& item, const KnobTableItemPtr& parent, TableChangeReasonEnum reason)
 {
@@ -474,13 +655,8 @@ KnobItemsTable::insertItem(int index, const KnobTableItemPtr& item, const KnobTa
     } else {
         {
             QMutexLocker k(&_imp->common->topLevelItemsLock);
-            if (index < 0 || index >= (int)_imp->common->topLevelItems.size()) {
-                _imp->common->topLevelItems.push_back(item);
-            } else {
-                std::vector<KnobTableItemPtr>::iterator it = _imp->common->topLevelItems.begin();
-                std::advance(it, index);
-                _imp->common->topLevelItems.insert(it, item);
-            }
+            KnobItemsTablePrivate::insertInContainer(index, item, &_imp->common->topLevelItems, &_imp->common->topLevelItemsByName);
+            KnobItemsTablePrivate::refreshIndicesInContainer(_imp->common->topLevelItems, item->_imp->common->indexInParent + 1);
         }
     }
 
@@ -497,6 +673,52 @@ KnobItemsTable::insertItem(int index, const KnobTableItemPtr& item, const KnobTa
     
 }
 
+void
+KnobItemsTable::insertItems(int index, const std::list<KnobTableItemPtr>& items, const KnobTableItemPtr& parent, TableChangeReasonEnum reason)
+{
+    std::list<KnobTableItemPtr> insertedItems;
+    for (std::list<KnobTableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        if (!*it) {
+            continue;
+        }
+
+        // The item must have been constructed with this model in parameter
+        assert((*it)->getModel().get() == this);
+
+        removeItem(*it, reason);
+
+        adjustNameForDuplicate(*it, parent);
+
+        int itemIndex = index < 0 ? -1 : index + (int)insertedItems.size();
+        if (parent) {
+            parent->insertChild(itemIndex, *it);
+        } else {
+            // The index of the items after the insertion position is refreshed once all items are inserted
+            QMutexLocker k(&_imp->common->topLevelItemsLock);
+            KnobItemsTablePrivate::insertInContainer(itemIndex, *it, &_imp->common->topLevelItems, &_imp->common->topLevelItemsByName);
+        }
+        insertedItems.push_back(*it);
+    }
+    if (insertedItems.empty()) {
+        return;
+    }
+    if (!parent && index >= 0) {
+        QMutexLocker k(&_imp->common->topLevelItemsLock);
+        KnobItemsTablePrivate::refreshIndicesInContainer(_imp->common->topLevelItems, index);
+    }
+
+    bool hasPythonPrefix = !getPythonPrefix().empty();
+    for (std::list<KnobTableItemPtr>::const_iterator it = insertedItems.begin(); it != insertedItems.end(); ++it) {
+        (*it)->ensureItemInitialized();
+        if (hasPythonPrefix) {
+            declareItemAsPythonField(*it);
+        }
+        (*it)->onItemInsertedInModel_recursive();
+    }
+
+    Q_EMIT itemsInserted(index, insertedItems, reason);
+} // insertItems
+
 
 void
 KnobItemsTable::removeItem(const KnobTableItemPtr& item, TableChangeReasonEnum reason)
@@ -507,15 +729,14 @@ KnobItemsTable::removeItem(const KnobTableItemPtr& item, TableChangeReasonEnum r
     if (parent) {
         removed = parent->removeChild(item);
     } else {
-        {
-            QMutexLocker k(&_imp->common->topLevelItemsLock);
-            for (std::vector<KnobTableItemPtr>::iterator it = _imp->common->topLevelItems.begin(); it != _imp->common->topLevelItems.end(); ++it) {
-                if (*it == item) {
-                    _imp->common->topLevelItems.erase(it);
-                    removed = true;
-                    break;
-                }
-            }
+        std::set<KnobTableItemPtr> items;
+        items.insert(item);
+        std::list<KnobTableItemPtr> removedItems;
+        QMutexLocker k(&_imp->common->topLevelItemsLock);
+        int firstIndex = KnobItemsTablePrivate::removeFromContainer(items, &_imp->common->topLevelItems, &_imp->common->topLevelItemsByName, &removedItems);
+        if (firstIndex != -1) {
+            KnobItemsTablePrivate::refreshIndicesInContainer(_imp->common->topLevelItems, firstIndex);
+            removed = true;
         }
     }
     if (removed) {
@@ -528,6 +749,44 @@ KnobItemsTable::removeItem(const KnobTableItemPtr& item, TableChangeReasonEnum r
     }
 }
 
+void
+KnobItemsTable::removeItems(const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum reason)
+{
+    std::list<KnobTableItemPtr> removedItems;
+
+    // Top-level items are all removed in a single pass
+    std::set<KnobTableItemPtr> topLevelItemsToRemove;
+    for (std::list<KnobTableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        if (!*it) {
+            continue;
+        }
+        KnobTableItemPtr parent = (*it)->getParent();
+        if (!parent) {
+            topLevelItemsToRemove.insert(*it);
+        } else if (parent->removeChild(*it)) {
+            removedItems.push_back(*it);
+        }
+    }
+    if (!topLevelItemsToRemove.empty()) {
+        QMutexLocker k(&_imp->common->topLevelItemsLock);
+        int firstIndex = KnobItemsTablePrivate::removeFromContainer(topLevelItemsToRemove, &_imp->common->topLevelItems, &_imp->common->topLevelItemsByName, &removedItems);
+        KnobItemsTablePrivate::refreshIndicesInContainer(_imp->common->topLevelItems, firstIndex);
+    }
+    if (removedItems.empty()) {
+        return;
+    }
+
+    Q_EMIT itemsRemoved(removedItems, reason);
+
+    bool hasPythonPrefix = !getPythonPrefix().empty();
+    for (std::list<KnobTableItemPtr>::const_iterator it = removedItems.begin(); it != removedItems.end(); ++it) {
+        if (hasPythonPrefix) {
+            removeItemAsPythonField(*it);
+        }
+        (*it)->onItemRemovedFromModel_recursive();
+    }
+} // removeItems
+
 void
 KnobItemsTable::resetModel(TableChangeReasonEnum reason)
 {
@@ -537,6 +796,10 @@ KnobItemsTable::resetModel(TableChangeReasonEnum reason)
         QMutexLocker k(&_imp->common->topLevelItemsLock);
         topLevelItems = _imp->common->topLevelItems;
         _imp->common->topLevelItems.clear();
+        _imp->common->topLevelItemsByName.clear();
+        for (std::size_t i = 0; i < topLevelItems.size(); ++i) {
+            topLevelItems[i]->_imp->common->indexInParent = -1;
+        }
     }
     for (std::size_t i = 0; i < topLevelItems.size(); ++i) {
         if (!getPythonPrefix().empty()) {
@@ -904,6 +1167,8 @@ KnobTableItem::setScriptName(const std::string& name)
         _imp->common->scriptName = nameToSet;
     }
 
+    KnobItemsTablePrivate::onItemScriptNameChanged(thisShared, currentName, nameToSet);
+
     model->declareItemAsPythonField(thisShared);
     
 }
@@ -951,13 +1216,8 @@ KnobTableItem::insertChild(int index, const KnobTableItemPtr& item)
 
     {
         QMutexLocker k(&_imp->common->lock);
-        if (index < 0 || index >= (int)_imp->common->children.size()) {
-            _imp->common->children.push_back(item);
-        } else {
-            std::vector<KnobTableItemPtr>::iterator it = _imp->common->children.begin();
-            std::advance(it, index);
-            _imp->common->children.insert(it, item);
-        }
+        KnobItemsTablePrivate::insertInContainer(index, item, &_imp->common->children, &_imp->common->childrenByName);
+        KnobItemsTablePrivate::refreshIndicesInContainer(_imp->common->children, item->_imp->common->indexInParent + 1);
     }
 
     {
@@ -979,13 +1239,14 @@ KnobTableItem::removeChild(const KnobTableItemPtr& item)
         model->removeItemAsPythonField(item);
     }
     {
+        std::set<KnobTableItemPtr> items;
+        items.insert(item);
+        std::list<KnobTableItemPtr> removedItems;
         QMutexLocker k(&_imp->common->lock);
-        for (std::vector<KnobTableItemPtr>::iterator it = _imp->common->children.begin(); it != _imp->common->children.end(); ++it) {
-            if (*it == item) {
-                _imp->common->children.erase(it);
-                removed = true;
-                break;
-            }
+        int firstIndex = KnobItemsTablePrivate::removeFromContainer(items, &_imp->common->children, &_imp->common->childrenByName, &removedItems);
+        if (firstIndex != -1) {
+            KnobItemsTablePrivate::refreshIndicesInContainer(_imp->common->children, firstIndex);
+            removed = true;
         }
     }
     return removed;
@@ -1053,30 +1314,17 @@ int
 KnobTableItem::getIndexInParent() const
 {
     KnobTableItemPtr parent = getParent();
-    int found = -1;
     if (parent) {
         QMutexLocker k(&parent->_imp->common->lock);
-        for (std::size_t i = 0; i < parent->_imp->common->children.size(); ++i) {
-            if (parent->_imp->common->children[i].get() == this) {
-                found = i;
-                break;
-            }
-        }
-
+        return KnobItemsTablePrivate::findInContainer(this, parent->_imp->common->children);
     } else {
         KnobItemsTablePtr table = _imp->common->model.lock();
         if (!table) {
             return -1;
         }
         QMutexLocker k(&table->_imp->common->topLevelItemsLock);
-        for (std::size_t i = 0; i < table->_imp->common->topLevelItems.size(); ++i) {
-            if (table->_imp->common->topLevelItems[i].get() == this) {
-                found = i;
-                break;
-            }
-        }
+        return KnobItemsTablePrivate::findInContainer(this, table->_imp->common->topLevelItems);
     }
-    return found;
 }
 
 std::vector<KnobTableItemPtr>
@@ -1396,9 +1644,11 @@ KnobTableItem::fromSerialization(const SERIALIZATION_NAMESPACE::SerializationObj
         return;
     }
     std::vector<std::string> projectViewNames = getApp()->getProject()->getProjectViewNames();
+    std::string oldScriptName, newScriptName;
     {
         QMutexLocker k(&_imp->common->lock);
         _imp->common->label = serialization->label;
+        oldScriptName = _imp->common->scriptName;
 
         // During D&D operations, this scriptname is in fact the fully qualified script-name of the item in the table
         // so that we can figure out its ancestors.
@@ -1411,7 +1661,10 @@ KnobTableItem::fromSerialization(const SERIALIZATION_NAMESPACE::SerializationObj
                 _imp->common->scriptName = serialization->scriptName;
             }
         }
-
+        newScriptName = _imp->common->scriptName;
+    }
+    if (newScriptName != oldScriptName) {
+        KnobItemsTablePrivate::onItemScriptNameChanged(toKnobTableItem(shared_from_this()), oldScriptName, newScriptName);
     }
 
     for (SERIALIZATION_NAMESPACE::KnobSerializationList::const_iterator it = serialization->knobs.begin(); it != serialization->knobs.end(); ++it) {
@@ -1452,24 +1705,36 @@ getItemNameAndRemainder_LeftToRight(const std::string& fullySpecifiedName,
 }
 
 KnobTableItemPtr
-KnobItemsTablePrivate::getItemByScriptNameInternal(const std::string& name, const std::string& recurseName, const std::vector<KnobTableItemPtr>& items) 
-{
-    for (std::vector<KnobTableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
-        if ( (*it)->getScriptName_mt_safe() == name ) {
-            if ( !recurseName.empty() ) {
-                if ((*it)->isItemContainer()) {
-                    std::string toFind;
-                    std::string subrecurseName;
-                    getItemNameAndRemainder_LeftToRight(recurseName, toFind, subrecurseName);
-                    return getItemByScriptNameInternal(toFind, subrecurseName, (*it)->getChildren());
-                }
-            } else {
-                return *it;
-            }
+KnobItemsTablePrivate::getItemByScriptNameInternal(const std::string& name,
+                                                  const std::string& recurseName,
+                                                  const KnobTableItem* parent,
+                                                  const KnobItemsTable* table)
+{
+    KnobTableItemPtr item;
+    if (parent) {
+        QMutexLocker k(&parent->_imp->common->lock);
+        KnobTableItemsByNameMap::const_iterator found = parent->_imp->common->childrenByName.find(name);
+        if (found != parent->_imp->common->childrenByName.end()) {
+            item = found->second.lock();
+        }
+    } else {
+        QMutexLocker k(&table->_imp->common->topLevelItemsLock);
+        KnobTableItemsByNameMap::const_iterator found = table->_imp->common->topLevelItemsByName.find(name);
+        if (found != table->_imp->common->topLevelItemsByName.end()) {
+            item = found->second.lock();
         }
     }
-    return KnobTableItemPtr();
-}
+    if ( !item || recurseName.empty() ) {
+        return item;
+    }
+    if ( !item->isItemContainer() ) {
+        return KnobTableItemPtr();
+    }
+    std::string toFind;
+    std::string subrecurseName;
+    getItemNameAndRemainder_LeftToRight(recurseName, toFind, subrecurseName);
+    return getItemByScriptNameInternal(toFind, subrecurseName, item.get(), table);
+} // getItemByScriptNameInternal
 
 KnobTableItemPtr
 KnobItemsTable::getItemByFullyQualifiedScriptName(const std::string& fullyQualifiedScriptNa) const
@@ -1478,22 +1743,19 @@ KnobItemsTable::getItemByFullyQualifiedScriptName(const std::string& fullyQualif
     std::string recurseName;
     getItemNameAndRemainder_LeftToRight(fullyQualifiedScriptNa, toFind, recurseName);
 
-    std::vector<KnobTableItemPtr> topLevel = getTopLevelItems();
-    return KnobItemsTablePrivate::getItemByScriptNameInternal(toFind, recurseName, topLevel);
+    return KnobItemsTablePrivate::getItemByScriptNameInternal(toFind, recurseName, 0, this);
 }
 
 KnobTableItemPtr
 KnobItemsTable::getTopLevelItemByScriptName(const std::string& scriptName) const
 {
-    std::vector<KnobTableItemPtr> topLevel = getTopLevelItems();
-    return KnobItemsTablePrivate::getItemByScriptNameInternal(scriptName, std::string(), topLevel);
+    return KnobItemsTablePrivate::getItemByScriptNameInternal(scriptName, std::string(), 0, this);
 }
 
 KnobTableItemPtr
 KnobTableItem::getChildItemByScriptName(const std::string& scriptName) const
 {
-    std::vector<KnobTableItemPtr> children = getChildren();
-    return KnobItemsTablePrivate::getItemByScriptNameInternal(scriptName, std::string(), children);
+    return KnobItemsTablePrivate::getItemByScriptNameInternal(scriptName, std::string(), this, 0);
 }
 
 bool
@@ -1845,30 +2107,26 @@ KnobItemsTable::endSelection(TableChangeReasonEnum reason)
 
         ++_imp->common->selectionRecursion;
 
-        // Remove from selection and unslave from master knobs
-        for (std::set<KnobTableItemPtr>::const_iterator it = _imp->common->itemsRemovedFromSelection.begin(); it != _imp->common->itemsRemovedFromSelection.end(); ++it) {
-            for (std::list<KnobTableItemWPtr>::iterator it2 = _imp->common->selectedItems.begin(); it2!= _imp->common->selectedItems.end(); ++it2) {
-                if ( it2->lock() == *it) {
-                    itemsRemoved.push_back(*it);
-                    _imp->common->selectedItems.erase(it2);
-                    didSomething = true;
-                    break;
+        // Remove from selection and unslave from master knobs.
+        // The selection is walked once rather than once per item so that selecting many items is not quadratic.
+        std::set<KnobTableItemPtr> selectedItemsSet;
+        for (std::list<KnobTableItemWPtr>::iterator it = _imp->common->selectedItems.begin(); it != _imp->common->selectedItems.end();) {
+            KnobTableItemPtr item = it->lock();
+            if ( item && (_imp->common->itemsRemovedFromSelection.find(item) != _imp->common->itemsRemovedFromSelection.end()) ) {
+                itemsRemoved.push_back(item);
+                it = _imp->common->selectedItems.erase(it);
+                didSomething = true;
+            } else {
+                if (item) {
+                    selectedItemsSet.insert(item);
                 }
-
+                ++it;
             }
-
         }
 
         // Add to selection (if not already selected) and slave to master knobs
         for (std::set<KnobTableItemPtr>::const_iterator it = _imp->common->newItemsInSelection.begin(); it != _imp->common->newItemsInSelection.end(); ++it) {
-            bool found = false;
-            for (std::list<KnobTableItemWPtr>::iterator it2 = _imp->common->selectedItems.begin(); it2!= _imp->common->selectedItems.end(); ++it2) {
-                if ( it2->lock() == *it) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
+            if ( selectedItemsSet.insert(*it).second ) {
                 itemsAdded.push_back(*it);
                 didSomething = true;
                 _imp->common->selectedItems.push_back(*it);
@@ -1971,6 +2229,10 @@ KnobItemsTable::declareItemsToPython()
 
     _imp->common->pythonPrefix = getTablePythonPrefix();
 
+    if ( !appPTR->isPythonInitialized() ) {
+        return;
+    }
+
     NodePtr node = getNode();
     if (!node) {
         return;
@@ -2005,6 +2267,9 @@ KnobItemsTable::getPythonPrefix() const
 void
 KnobItemsTable::removeItemAsPythonField(const KnobTableItemPtr& item)
 {
+    if ( !appPTR->isPythonInitialized() ) {
+        return;
+    }
     NodePtr node = getNode();
     if (!node) {
         return;
@@ -2033,6 +2298,9 @@ KnobItemsTable::removeItemAsPythonField(const KnobTableItemPtr& item)
 void
 KnobItemsTable::declareItemAsPythonField(const KnobTableItemPtr& item)
 {
+    if ( !appPTR->isPythonInitialized() ) {
+        return;
+    }
     NodePtr node = getNode();
     if (!node) {
         return;
@@ -2173,12 +2441,14 @@ KnobItemsTable::fromSerialization(const SERIALIZATION_NAMESPACE::SerializationOb
     // It would create errors because children would attempt to be declared to Python recursively before their parent.
     // Instead we manually call it once all items are deserialized.
     _imp->common->pythonPrefix.clear();
+    std::list<KnobTableItemPtr> items;
     for (std::list<SERIALIZATION_NAMESPACE::KnobTableItemSerializationPtr>::const_iterator it = serialization->items.begin(); it != serialization->items.end(); ++it) {
         KnobTableItemPtr item = createItemFromSerialization(*it);
         if (item) {
-            addItem(item, KnobTableItemPtr(), eTableChangeReasonInternal);
+            items.push_back(item);
         }
     }
+    insertItems(-1, items, KnobTableItemPtr(), eTableChangeReasonInternal);
     declareItemsToPython();
 }
 
@@ -367,6 +367,7 @@ private:
 
 
     friend class KnobItemsTable;
+    friend struct KnobItemsTablePrivate;
     boost::scoped_ptr<KnobTableItemPrivate> _imp;
 };
 
@@ -531,6 +532,13 @@ public:
      **/
     void insertItem(int index, const KnobTableItemPtr& item, const KnobTableItemPtr& parent, TableChangeReasonEnum reason);
 
+    /**
+     * @brief Same as calling insertItem for each item with an increasing index, except that the itemsInserted
+     * signal is emitted once for all items instead of the itemInserted signal for each item.
+     * Use this when adding many items at once, e.g when creating tracks or loading a project.
+     **/
+    void insertItems(int index, const std::list<KnobTableItemPtr>& items, const KnobTableItemPtr& parent, TableChangeReasonEnum reason);
+
     /**
      * @brief Returns a vector with all top level items in the model in order.
      **/
@@ -557,6 +565,12 @@ public:
      **/
     void removeItem(const KnobTableItemPtr& item, TableChangeReasonEnum reason);
 
+    /**
+     * @brief Same as calling removeItem for each item, except that the itemsRemoved signal is emitted once for
+     * all items instead of the itemRemoved signal for each item.
+     **/
+    void removeItems(const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum reason);
+
     /**
      * @brief Removes all top-level items (and their children). This will completely reset the model.
      **/
@@ -676,6 +690,8 @@ Q_SIGNALS:
     void selectionChanged(std::list<KnobTableItemPtr> addedToSelection, std::list<KnobTableItemPtr> removedFromSelection, TableChangeReasonEnum reason);
     void itemRemoved(KnobTableItemPtr, TableChangeReasonEnum);
     void itemInserted(int index, KnobTableItemPtr, TableChangeReasonEnum);
+    void itemsRemoved(std::list<KnobTableItemPtr>, TableChangeReasonEnum);
+    void itemsInserted(int index, std::list<KnobTableItemPtr>, TableChangeReasonEnum);
 
 protected:
 
@@ -73,12 +73,14 @@ AddItemsCommand::undo()
 {
     KnobItemsTablePtr model = _items.front().item->getModel();
 
-    model->beginEditSelection();
+    std::list<KnobTableItemPtr> items;
     for (std::list<ItemToAdd>::const_iterator it = _items.begin(); it != _items.end(); ++it) {
-        model->removeItem(it->item, eTableChangeReasonInternal);
+        items.push_back(it->item);
     }
+    model->beginEditSelection();
+    model->removeItems(items, eTableChangeReasonInternal);
     model->endEditSelection(eTableChangeReasonInternal);
-    model->getNode()->getApp()->triggerAutoSave();
+    model->getNode()->getApp()->triggerAutoSave( model->getNode() );
 }
 
 void
@@ -112,7 +114,7 @@ AddItemsCommand::redo()
     }
 
     model->endEditSelection(eTableChangeReasonInternal);
-    model->getNode()->getApp()->triggerAutoSave();
+    model->getNode()->getApp()->triggerAutoSave( model->getNode() );
     _isFirstRedo = false;
 }
 
@@ -151,7 +153,7 @@ RemoveItemsCommand::undo()
         model->addToSelection(it->item, eTableChangeReasonInternal);
     }
     model->endEditSelection(eTableChangeReasonInternal);
-    model->getNode()->getApp()->triggerAutoSave();
+    model->getNode()->getApp()->triggerAutoSave( model->getNode() );
 }
 
 void
@@ -176,16 +178,18 @@ RemoveItemsCommand::redo()
         }
     }
 
-    model->beginEditSelection();
-    model->clearSelection(eTableChangeReasonInternal);
+    std::list<KnobTableItemPtr> items;
     for (std::list<ItemToRemove>::const_iterator it = _items.begin(); it != _items.end(); ++it) {
-        model->removeItem(it->item, eTableChangeReasonInternal);
+        items.push_back(it->item);
     }
+    model->beginEditSelection();
+    model->clearSelection(eTableChangeReasonInternal);
+    model->removeItems(items, eTableChangeReasonInternal);
     if (nextItem) {
         model->addToSelection(nextItem, eTableChangeReasonInternal);
     }
     model->endEditSelection(eTableChangeReasonInternal);
-    model->getNode()->getApp()->triggerAutoSave();
+    model->getNode()->getApp()->triggerAutoSave( model->getNode() );
 }
 
 NATRON_NAMESPACE_EXIT
@@ -44,6 +44,7 @@
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/make_shared.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 
@@ -92,10 +93,14 @@ public:
     std::string modifiedExpression;
     ExpressionLanguageEnum language;
 
+    // The language the expression is evaluated with: a simple Python expression may be executed as ExprTk
+    ExpressionLanguageEnum executionLanguage;
+
     KnobExpr()
     : expressionString()
     , modifiedExpression()
     , language(eExpressionLanguageExprTk)
+    , executionLanguage(eExpressionLanguageExprTk)
     {}
 
     virtual ~KnobExpr() {}
@@ -133,8 +138,12 @@ public:
 
     typedef std::map<QThread*, ExpressionDataPtr> PerThreadDataMap;
 
+    // Unique to this expression: identifies it in the caches local to each thread, see getOrCreateThreadData()
+    const unsigned int generation;
+
     // Protects data
     mutable QMutex lock;
+    // Owns the expression compiled for each thread
     PerThreadDataMap data;
 
 
@@ -144,14 +153,17 @@ public:
     // effect dependencies mapped against their variable name in the expression
     std::map<std::string, EffectFunctionDependency> effectDependencies;
 
-    KnobExprExprTk()
-    {
-
-    }
+    KnobExprExprTk();
     
     virtual ~KnobExprExprTk() {}
 
     static ExpressionDataPtr createData();
+
+    /**
+     * @brief Returns the expression compiled for the current thread, creating an empty one if needed.
+     * Once a thread found its data, it is looked-up in a cache local to the thread without taking any lock.
+     **/
+    ExpressionDataPtr getOrCreateThreadData();
 };
 
 /**
@@ -456,7 +468,7 @@ struct KnobHelperPrivate
     : publicInterface(publicInterface_)
     , holder(holder_)
     , mainInstance()
-    , common(new CommonData)
+    , common( boost::make_shared<CommonData>() )
     {
         common->dimension = nDims;
         common->name = NATRON_PYTHON_NAMESPACE::makeNameScriptFriendly(scriptName);
@@ -499,6 +511,12 @@ struct KnobHelperPrivate
     std::string validatePythonExpression(const std::string& expression, DimIdx dimension, ViewIdx view, bool hasRetVariable, std::string* resultAsString) const;
     void validateExprTkExpression(const std::string& expression, DimIdx dimension, ViewIdx view, std::string* resultAsString, KnobExprExprTk* ret) const;
 
+    /**
+     * @brief Compiles the given valid Python expression as ExprTk if it can be lowered, see KnobHelper::lowerPythonExpressionToExprTk.
+     * Otherwise reports in the log that the expression will be evaluated by Python and returns NULL.
+     **/
+    KnobExprPtr lowerPythonExpression(const std::string& expression, DimIdx dimension, ViewIdx view, bool hasRetVariable) const;
+
 
 
     void parseListenersFromExpression(DimIdx dimension, ViewIdx view);
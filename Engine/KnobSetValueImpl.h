@@ -161,7 +161,7 @@ template <typename T>
 bool
 ValueKnobDimView<T>::setValueAndCheckIfChanged(const T& v)
 {
-    QMutexLocker k(&valueMutex);
+    ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
     if (value != v) {
         value = v;
         return true;
@@ -459,6 +459,8 @@ Knob<T>::setKeyFrame(const SetKeyFrameArgs& args, const KeyFrame & key)
 
                 KnobDimViewBasePtr data = getDataForDimView(DimIdx(i), *it);
                 assert(data);
+                // Create the animation curve if this is the first keyframe
+                getAnimationCurve(*it, DimIdx(i));
                 ValueChangedReturnCodeEnum addKeyRet = data->setKeyFrame(key, args.flags);
                 if (addKeyRet == eValueChangedReturnCodeKeyframeAdded) {
                     ret = addKeyRet;
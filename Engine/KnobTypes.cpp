@@ -40,6 +40,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/make_shared.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 
@@ -622,10 +623,10 @@ KnobDouble::hasModificationsVirtual(const KnobDimViewBasePtr& data, DimIdx dimen
     double defaultValue = getDefaultValue(dimension);
     if (_imp->defaultValuesAreNormalized) {
         double denormalizedDefaultValue = denormalize(dimension, TimeValue(0), defaultValue);
-        QMutexLocker k(&doubleData->valueMutex);
+        ProfiledMutexLocker k(&doubleData->valueMutex, eLockProfilerSiteKnobValue);
         return doubleData->value != denormalizedDefaultValue;
     } else {
-        QMutexLocker k(&doubleData->valueMutex);
+        ProfiledMutexLocker k(&doubleData->valueMutex, eLockProfilerSiteKnobValue);
         return doubleData->value != defaultValue;
     }
 }
@@ -755,7 +756,7 @@ ChoiceKnobDimView::getValueFromKeyFrame(const KeyFrame& k)
     std::string optionID;
     k.getPropertySafe(kKeyFramePropString, 0, &optionID);
     {
-        QMutexLocker k(&valueMutex);
+        ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
         for (std::size_t i = 0 ; i < menuOptions.size(); ++i) {
             if (optionID == menuOptions[i].id) {
                 return i;
@@ -772,7 +773,7 @@ ChoiceKnobDimView::makeKeyFrame(TimeValue time, const int& value)
 
     ChoiceOption activeEntry;
     {
-        QMutexLocker k(&valueMutex);
+        ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
         if (value >= 0 && value < (int)menuOptions.size()) {
             activeEntry = menuOptions[value];
         }
@@ -789,7 +790,7 @@ ChoiceKnobDimView::setValueAndCheckIfChanged(const int& v)
 {
     bool changed = ValueKnobDimView<int>::setValueAndCheckIfChanged(v);
 
-    QMutexLocker k(&valueMutex);
+    ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
     ChoiceOption newChoice;
     if (v >= 0 && v < (int)menuOptions.size()) {
         newChoice = menuOptions[v];
@@ -852,8 +853,8 @@ ChoiceKnobDimView::copy(const CopyInArgs& inArgs, CopyOutArgs* outArgs)
     const ChoiceKnobDimView* otherType = dynamic_cast<const ChoiceKnobDimView*>(inArgs.other);
     assert(otherType);
 
-    QMutexLocker k(&valueMutex);
-    QMutexLocker k2(&inArgs.other->valueMutex);
+    ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
+    ProfiledMutexLocker k2(&inArgs.other->valueMutex, eLockProfilerSiteKnobValue);
 
     menuOptions = otherType->menuOptions;
     separators = otherType->separators;
@@ -936,7 +937,7 @@ KnobChoice::setMissingEntryWarningEnabled(bool enabled)
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     data->showMissingEntryWarning = enabled;
 }
 
@@ -945,7 +946,7 @@ KnobChoice::isMissingEntryWarningEnabled() const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     return data->showMissingEntryWarning;
 }
 
@@ -954,7 +955,7 @@ KnobChoice::setColorForIndex(int index, const RGBAColourD& color)
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     data->menuColors[index] = color;
 }
 
@@ -963,7 +964,7 @@ KnobChoice::getColorForIndex(int index, RGBAColourD* color) const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     std::map<int, RGBAColourD>::const_iterator found = data->menuColors.find(index);
     if (found == data->menuColors.end()) {
         return false;
@@ -977,7 +978,7 @@ KnobChoice::setTextToFitHorizontally(const std::string& text)
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     data->textToFitHorizontally = text;
 }
 
@@ -986,7 +987,7 @@ KnobChoice::getTextToFitHorizontally() const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     return data->textToFitHorizontally;
 }
 
@@ -995,7 +996,7 @@ KnobChoice::setNewOptionCallback(ChoiceKnobDimView::KnobChoiceNewItemCallback ca
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     data->addNewChoiceCallback = callback;
 }
 
@@ -1004,7 +1005,7 @@ KnobChoice::getNewOptionCallback() const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     return data->addNewChoiceCallback;
 }
 
@@ -1013,7 +1014,7 @@ KnobChoice::setCascading(bool cascading)
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     data->isCascading = cascading;
 }
 
@@ -1022,7 +1023,7 @@ KnobChoice::isCascading() const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     return data->isCascading;
 }
 
@@ -1057,11 +1058,11 @@ KnobChoice::canLinkWith(const KnobIPtr & other, DimIdx thisDimension, ViewIdx th
     QString menuDifferentError = tr("You cannot link choice parameters with different menus. To overcome this, use an expression instead.");
     std::vector<ChoiceOption> thisOptions, otherOptions;
     {
-        QMutexLocker k(&thisData->valueMutex);
+        ProfiledMutexLocker k(&thisData->valueMutex, eLockProfilerSiteKnobValue);
         thisOptions = thisData->menuOptions;
     }
     {
-        QMutexLocker k(&otherData->valueMutex);
+        ProfiledMutexLocker k(&otherData->valueMutex, eLockProfilerSiteKnobValue);
         otherOptions = otherData->menuOptions;
     }
     if (thisOptions.size() != otherOptions.size()) {
@@ -1117,7 +1118,7 @@ KnobChoice::hasModificationsVirtual(const KnobDimViewBasePtr& data, DimIdx dimen
 
     ChoiceKnobDimViewPtr choiceData = toChoiceKnobDimView(data);
     assert(choiceData);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
 
 
     if (!isChoiceSelectionEqual<ChoiceOption, ChoiceOptionCompare>(choiceData->staticValueOption, defaultVal)) {
@@ -1149,7 +1150,7 @@ KnobChoice::restoreChoiceAfterMenuChanged()
         int found = -1;
         int foundDefValue = -1;
         {
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             for (std::size_t opt = 0; opt < data->staticValueOption.size(); ++opt) {
                 for (std::size_t i = 0; i < data->menuOptions.size(); ++i) {
                     if ( !data->staticValueOption[opt].id.empty() && data->menuOptions[i].id == data->staticValueOption[opt].id ) {
@@ -1236,7 +1237,7 @@ KnobChoice::populateChoices(const std::vector<ChoiceOption> &entries)
         }
 
 
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         sharedKnobs = data->sharedKnobs;
 
         data->menuOptions = entries;
@@ -1288,7 +1289,7 @@ KnobChoice::setShortcuts(const std::map<int, std::string>& shortcuts)
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     data->shortcuts = shortcuts;
 }
 
@@ -1297,7 +1298,7 @@ KnobChoice::getShortcuts() const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     return data->shortcuts;
 }
 
@@ -1306,7 +1307,7 @@ KnobChoice::setIcons(const std::map<int, std::string>& icons)
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     data->menuIcons = icons;
 
 }
@@ -1316,7 +1317,7 @@ KnobChoice::getIcons() const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     return data->menuIcons;
 }
 
@@ -1325,7 +1326,7 @@ KnobChoice::setSeparators(const std::vector<int>& separators)
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     data->separators = separators;
 }
 
@@ -1334,7 +1335,7 @@ KnobChoice::getSeparators() const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
     return data->separators;
 }
 
@@ -1357,7 +1358,7 @@ KnobChoice::resetChoices(ViewSetSpec view)
         }
         KnobDimViewKeySet sharedKnobs;
         {
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             sharedKnobs = data->sharedKnobs;
             data->menuOptions.clear();
         }
@@ -1404,7 +1405,7 @@ KnobChoice::appendChoice(const ChoiceOption& option,
         }
         KnobDimViewKeySet sharedKnobs;
         {
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             data->menuOptions.push_back(option);
             ChoiceOption& copiedOption = data->menuOptions.back();
 
@@ -1440,7 +1441,7 @@ KnobChoice::getEntries(ViewIdx view) const
         if (!data) {
             return std::vector<ChoiceOption>();
         }
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         return data->menuOptions;
     }
 
@@ -1455,7 +1456,7 @@ KnobChoice::isActiveEntryPresentInEntries(ViewIdx view) const
         if (!data) {
             return false;
         }
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         for (std::size_t opt = 0; opt < data->staticValueOption.size(); ++opt) {
             bool found = false;
             for (std::size_t i = 0; i < data->menuOptions.size(); ++i) {
@@ -1483,7 +1484,7 @@ KnobChoice::getEntry(int v, ViewIdx view) const
         if (!data) {
             return ChoiceOption("","","");
         }
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         if (v < 0 || (int)data->menuOptions.size() <= v ) {
             throw std::invalid_argument( std::string("KnobChoice::getEntry: index out of range") );
         }
@@ -1500,7 +1501,7 @@ KnobChoice::getNumEntries(ViewIdx view) const
         if (!data) {
             return false;
         }
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         return data->menuOptions.size();
     }
 }
@@ -1524,7 +1525,7 @@ KnobChoice::getCurrentEntriesAtTime_multi(TimeValue time, ViewIdx view)
     }
 
     {
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
 
         if (data->animationCurve && data->animationCurve->isAnimated()) {
             KeyFrame key = data->animationCurve->getValueAt(time);
@@ -1545,7 +1546,7 @@ KnobChoice::getCurrentEntriesAtTime_multi(TimeValue time, ViewIdx view)
         // Active entry was not set yet, give something based on the index and set the active entry
         int activeIndex = getValueAtTime(time, DimIdx(0), view_i);
         {
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             if ( activeIndex >= 0 && activeIndex < (int)data->menuOptions.size() ) {
                 if (data->staticValueOption.size() != 1) {
                     data->staticValueOption.resize(1);
@@ -1583,7 +1584,7 @@ KnobChoice::setActiveEntries_multi(const std::vector<ChoiceOption>& entries, Vie
         int matchedIndex;
         {
 
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             ChoiceOption matchedEntry;
             sharedKnobs = data->sharedKnobs;
             data->staticValueOption.clear();
@@ -1649,7 +1650,7 @@ KnobChoice::getHintToolTipFull() const
 {
     ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
     assert(data);
-    QMutexLocker k(&data->valueMutex);
+    ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
 
     int gothelp = 0;
     // list values that either have help or have label != id
@@ -1724,7 +1725,7 @@ KnobChoice::setValueFromID(const std::string & value, ViewSetSpec view, ValueCha
         }
         int index = -1;
         {
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             if (data->staticValueOption.size() != 1) {
                 data->staticValueOption.resize(1);
             }
@@ -1908,7 +1909,7 @@ KnobChoice::getDefaultEntriesID_multi() const
             if (!data) {
                 return std::vector<std::string>();
             }
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             if (defIndex < 0 || (int)data->menuOptions.size() <= defIndex ) {
                 return std::vector<std::string>();
             }
@@ -1945,7 +1946,7 @@ KnobChoice::onDefaultValueChanged(DimSpec /*dimension*/)
     assert(data);
     std::string optionID;
     {
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         if (defIndex >= 0 && defIndex < (int)data->menuOptions.size()) {
             optionID = data->menuOptions[defIndex].id;
         }
@@ -2028,7 +2029,7 @@ KnobChoice::setDefaultValueFromIDWithoutApplying(const std::string & value)
         {
             ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
             assert(data);
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             if (data->staticValueOption.size() != 1) {
                 data->staticValueOption.resize(1);
             }
@@ -2063,7 +2064,7 @@ KnobChoice::setDefaultValueFromID(const std::string & value)
         {
             ChoiceKnobDimViewPtr data = toChoiceKnobDimView(getDataForDimView(DimIdx(0), ViewIdx(0)));
             assert(data);
-            QMutexLocker k(&data->valueMutex);
+            ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
             if (data->staticValueOption.size() != 1) {
                 data->staticValueOption.resize(1);
             }
@@ -2079,7 +2080,7 @@ KnobChoice::setDefaultValueFromID(const std::string & value)
 KnobDimViewBasePtr
 KnobChoice::createDimViewData() const
 {
-    ChoiceKnobDimViewPtr ret(new ChoiceKnobDimView);
+    ChoiceKnobDimViewPtr ret = boost::make_shared<ChoiceKnobDimView>();
     return ret;
 }
 
@@ -3224,8 +3225,8 @@ ParametricKnobDimView::copy(const CopyInArgs& inArgs, CopyOutArgs* outArgs)
     const ParametricKnobDimView* otherType = dynamic_cast<const ParametricKnobDimView*>(inArgs.other);
     assert(otherType);
 
-    QMutexLocker k(&valueMutex);
-    QMutexLocker k2(&inArgs.other->valueMutex);
+    ProfiledMutexLocker k(&valueMutex, eLockProfilerSiteKnobValue);
+    ProfiledMutexLocker k2(&inArgs.other->valueMutex, eLockProfilerSiteKnobValue);
 
     if (otherType->parametricCurve) {
         if (!parametricCurve) {
@@ -3301,7 +3302,7 @@ KnobParametric::~KnobParametric()
 KnobDimViewBasePtr
 KnobParametric::createDimViewData() const
 {
-    ParametricKnobDimViewPtr ret(new ParametricKnobDimView);
+    ParametricKnobDimViewPtr ret = boost::make_shared<ParametricKnobDimView>();
     ret->parametricCurve.reset(new Curve(eCurveTypeDouble));
 
     // Using the same API for parametric curve control points management makes it easy with the API of Knob
@@ -3490,7 +3491,7 @@ KnobParametric::signalCurveChanged(DimSpec dimension, const KnobDimViewBasePtr&
 {
     KnobDimViewKeySet sharedKnobs;
     {
-        QMutexLocker k(&data->valueMutex);
+        ProfiledMutexLocker k(&data->valueMutex, eLockProfilerSiteKnobValue);
         sharedKnobs = data->sharedKnobs;
     }
     for (KnobDimViewKeySet::const_iterator it = sharedKnobs.begin(); it!=sharedKnobs.end(); ++it) {
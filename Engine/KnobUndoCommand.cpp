@@ -790,11 +790,53 @@ MultipleKnobEditsUndoCommand::mergeWith(const UndoCommandPtr &command)
         } else {
             // copy the other dimension of that knob which changed and set the dimension to -1 so
             // that subsequent calls to undo() and redo() clone all dimensions at once
-            foundExistinKnob->second.insert( foundExistinKnob->second.end(), otherIt->second.begin(), otherIt->second.end() );
+            std::list<ValueToSet>& values = foundExistinKnob->second;
+            for (std::list<ValueToSet>::const_iterator it = otherIt->second.begin(); it != otherIt->second.end(); ++it) {
+                if ( !values.empty() && canCoalesceEdits(values.back(), *it) ) {
+                    // e.g: a slider drag, keep only the last value and the old values of the first edit
+                    ValueToSet& last = values.back();
+                    last.newValue = it->newValue;
+                    if (last.setValueRetCode != eValueChangedReturnCodeKeyframeAdded) {
+                        last.setValueRetCode = it->setValueRetCode;
+                    }
+                } else {
+                    values.push_back(*it);
+                }
+            }
         }
     }
 
     return true;
+} // mergeWith
+
+bool
+MultipleKnobEditsUndoCommand::canCoalesceEdits(const ValueToSet& older, const ValueToSet& newer)
+{
+    if (older.dimension != newer.dimension || older.view != newer.view ||
+        older.setKeyFrame != newer.setKeyFrame || older.reason != newer.reason) {
+        return false;
+    }
+    // A keyframe set at another time does not overwrite the older one
+    if (older.setKeyFrame && older.newValue.getTime() != newer.newValue.getTime()) {
+        return false;
+    }
+    return true;
+}
+
+std::size_t
+MultipleKnobEditsUndoCommand::getMemorySize() const
+{
+    std::size_t ret = sizeof(*this) + getText().size();
+    for (ParamsMap::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        ret += sizeof(*it);
+        for (std::list<ValueToSet>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            ret += sizeof(ValueToSet);
+            for (PerDimViewKeyFramesMap::const_iterator it3 = it2->oldValues.begin(); it3 != it2->oldValues.end(); ++it3) {
+                ret += sizeof(*it3) + it3->second.size() * sizeof(KeyFrame);
+            }
+        }
+    }
+    return ret;
 }
 
 RestoreDefaultsCommand::RestoreDefaultsCommand(const std::list<KnobIPtr> & knobs,
@@ -82,6 +82,7 @@ public:
     , _valueChangedReturnCode(1)
     , _merge(true)
     , _firstRedoCalled(false)
+    , _timelineTime(knob->getHolder()->getTimelineCurrentTime())
     {
         assert(dimension >= 0 && dimension < knob->getNDimensions());
         _oldValue.push_back(oldValue);
@@ -218,6 +219,12 @@ private:
         return true;
     }
 
+    virtual std::size_t getMemorySize() const OVERRIDE FINAL
+    {
+        return sizeof(*this) + getText().size() + (_oldValue.size() + _newValue.size()) * sizeof(T) +
+               _valueChangedReturnCode.size() * sizeof(ValueChangedReturnCodeEnum);
+    }
+
 private:
 
     void refreshAnimationModuleSelectedKeyframe()
@@ -357,6 +364,15 @@ public:
     virtual void undo() OVERRIDE FINAL;
     virtual void redo() OVERRIDE FINAL;
     virtual bool mergeWith(const UndoCommandPtr& command) OVERRIDE FINAL;
+    virtual std::size_t getMemorySize() const OVERRIDE FINAL;
+
+private:
+
+    /**
+     * @brief Returns true if the newer edit only overwrites what the older edit set: in that case only the
+     * new value of the newer edit needs to be kept, the old values recorded by the older edit are enough to undo both.
+     **/
+    static bool canCoalesceEdits(const ValueToSet& older, const ValueToSet& newer);
 };
 
 struct PasteKnobClipBoardUndoCommandPrivate;
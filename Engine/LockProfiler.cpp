@@ -0,0 +1,284 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "LockProfiler.h"
+
+#include <algorithm> // max, stable_sort
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+#include "Engine/Timer.h"
+
+// Waits longer than 10 microseconds on locks that cannot be tried are counted as contended
+#define NATRON_LOCK_PROFILER_CONTENTION_THRESHOLD 1e-5
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class LockProfilerData
+{
+public:
+
+    QAtomicInt enabled;
+
+    // Gives the time of the wait and hold measurements
+    TimeLapse clock;
+
+    // Each site has its own mutex so that profiling does not serialize the sites.
+    QMutex siteMutex[eLockProfilerSiteCount];
+
+    // Protected by siteMutex
+    LockProfiler::SiteStats stats[eLockProfilerSiteCount];
+
+    LockProfilerData()
+    : enabled()
+    , clock()
+    {
+    }
+};
+
+LockProfilerData&
+getProfilerData()
+{
+    static LockProfilerData data;
+
+    return data;
+}
+
+bool
+compareTotalWaitTime(const LockProfiler::SiteStats& a, const LockProfiler::SiteStats& b)
+{
+    return a.totalWaitTime > b.totalWaitTime;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+LockProfiler::setEnabled(bool enabled)
+{
+    getProfilerData().enabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+bool
+LockProfiler::isEnabled()
+{
+#if QT_VERSION < 0x050000
+    return (int)getProfilerData().enabled != 0;
+#else
+    return getProfilerData().enabled.loadAcquire() != 0;
+#endif
+}
+
+void
+LockProfiler::reset()
+{
+    LockProfilerData& data = getProfilerData();
+    for (int i = 0; i < eLockProfilerSiteCount; ++i) {
+        QMutexLocker k(&data.siteMutex[i]);
+        data.stats[i] = SiteStats();
+    }
+}
+
+double
+LockProfiler::getTime()
+{
+    return getProfilerData().clock.getTimeSinceCreation();
+}
+
+double
+LockProfiler::getContentionThreshold()
+{
+    return NATRON_LOCK_PROFILER_CONTENTION_THRESHOLD;
+}
+
+void
+LockProfiler::recordAcquisition(LockProfilerSiteEnum site,
+                                bool contended,
+                                double waitTime)
+{
+    assert(site >= 0 && site < eLockProfilerSiteCount);
+    LockProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.siteMutex[site]);
+    SiteStats& stats = data.stats[site];
+    ++stats.nAcquisitions;
+    if (contended) {
+        ++stats.nContentions;
+    }
+    stats.totalWaitTime += waitTime;
+    stats.maxWaitTime = std::max(stats.maxWaitTime, waitTime);
+}
+
+void
+LockProfiler::recordRelease(LockProfilerSiteEnum site,
+                            double holdTime)
+{
+    assert(site >= 0 && site < eLockProfilerSiteCount);
+    LockProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.siteMutex[site]);
+    SiteStats& stats = data.stats[site];
+    ++stats.nReleases;
+    stats.totalHoldTime += holdTime;
+    stats.maxHoldTime = std::max(stats.maxHoldTime, holdTime);
+}
+
+void
+LockProfiler::getStats(std::vector<SiteStats>* stats)
+{
+    LockProfilerData& data = getProfilerData();
+    stats->resize(eLockProfilerSiteCount);
+    for (int i = 0; i < eLockProfilerSiteCount; ++i) {
+        {
+            QMutexLocker k(&data.siteMutex[i]);
+            (*stats)[i] = data.stats[i];
+        }
+        (*stats)[i].name = getSiteName( (LockProfilerSiteEnum)i );
+    }
+}
+
+std::string
+LockProfiler::getSiteName(LockProfilerSiteEnum site)
+{
+    switch (site) {
+    case eLockProfilerSiteFrameViewRequest:
+        return "FrameViewRequest";
+    case eLockProfilerSiteCache:
+        return "Cache";
+    case eLockProfilerSiteKnobValue:
+        return "Knob value";
+    case eLockProfilerSiteKnobExpression:
+        return "Knob expression";
+    case eLockProfilerSiteLut:
+        return "Lut";
+    case eLockProfilerSitePythonGIL:
+        return "Python GIL";
+    case eLockProfilerSiteCount:
+        break;
+    }
+
+    return std::string();
+}
+
+std::string
+LockProfiler::getReport()
+{
+    std::vector<SiteStats> stats;
+    getStats(&stats);
+    std::stable_sort(stats.begin(), stats.end(), compareTotalWaitTime);
+
+    // Times are printed in milliseconds
+    std::stringstream ss;
+    ss << std::left << std::setw(18) << "Lock site" << std::right
+       << std::setw(14) << "Acquisitions"
+       << std::setw(12) << "Contended"
+       << std::setw(10) << "%"
+       << std::setw(16) << "Wait (ms)"
+       << std::setw(16) << "Max wait (ms)"
+       << std::setw(16) << "Hold (ms)"
+       << std::setw(16) << "Max hold (ms)" << '\n';
+    ss << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < stats.size(); ++i) {
+        const SiteStats& s = stats[i];
+        double contentionPercent = s.nAcquisitions > 0 ? s.nContentions * 100. / s.nAcquisitions : 0.;
+        ss << std::left << std::setw(18) << s.name << std::right
+           << std::setw(14) << s.nAcquisitions
+           << std::setw(12) << s.nContentions
+           << std::setw(10) << contentionPercent
+           << std::setw(16) << s.totalWaitTime * 1000.
+           << std::setw(16) << s.maxWaitTime * 1000.;
+        if (s.nReleases > 0) {
+            ss << std::setw(16) << s.totalHoldTime * 1000.
+               << std::setw(16) << s.maxHoldTime * 1000.;
+        } else {
+            ss << std::setw(16) << "-"
+               << std::setw(16) << "-";
+        }
+        ss << '\n';
+    }
+
+    return ss.str();
+} // getReport
+
+ProfiledMutexLocker::ProfiledMutexLocker(QMutex* mutex,
+                                         LockProfilerSiteEnum site)
+: _mutex(mutex)
+, _site(site)
+, _locked(false)
+, _profiled(false)
+, _lockTime(0)
+{
+    relock();
+}
+
+ProfiledMutexLocker::~ProfiledMutexLocker()
+{
+    unlock();
+}
+
+void
+ProfiledMutexLocker::unlock()
+{
+    if (!_locked) {
+        return;
+    }
+    double holdTime = 0;
+    if (_profiled) {
+        holdTime = LockProfiler::getTime() - _lockTime;
+    }
+    _mutex->unlock();
+    _locked = false;
+    if (_profiled) {
+        LockProfiler::recordRelease(_site, holdTime);
+    }
+}
+
+void
+ProfiledMutexLocker::relock()
+{
+    if (_locked) {
+        return;
+    }
+    _profiled = LockProfiler::isEnabled();
+    if (!_profiled) {
+        _mutex->lock();
+        _locked = true;
+
+        return;
+    }
+    double startTime = LockProfiler::getTime();
+    bool contended = !_mutex->tryLock();
+    if (contended) {
+        _mutex->lock();
+    }
+    _locked = true;
+    _lockTime = LockProfiler::getTime();
+    LockProfiler::recordAcquisition(_site, contended, contended ? _lockTime - startTime : 0.);
+}
+
+NATRON_NAMESPACE_EXIT
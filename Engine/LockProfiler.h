@@ -0,0 +1,171 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_LockProfiler_h
+#define Engine_LockProfiler_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+class QMutex;
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The locks of the render engine that the LockProfiler instruments
+ **/
+enum LockProfilerSiteEnum
+{
+    // The lock of a FrameViewRequest, taken by the thread that renders it and by the threads that need its results
+    eLockProfilerSiteFrameViewRequest = 0,
+
+    // The locks of the cache: buckets, tiles storage and memory segments
+    eLockProfilerSiteCache,
+
+    // The mutex protecting the values of a knob
+    eLockProfilerSiteKnobValue,
+
+    // The mutex protecting the expressions of a knob
+    eLockProfilerSiteKnobExpression,
+
+    // The mutex protecting the initialization of the tables of a Lut
+    eLockProfilerSiteLut,
+
+    // The Python GIL (and the Natron GIL if enabled)
+    eLockProfilerSitePythonGIL,
+
+    eLockProfilerSiteCount
+};
+
+/**
+ * @brief Records the time threads spend waiting for and holding the locks of the render engine, for each lock site.
+ * Profiling is disabled by default: the instrumented lockers then only take the lock. It can be enabled
+ * from the RenderStatsDialog or with the --lock-profile command-line option, which prints the report
+ * once the renders are finished.
+ *
+ * An acquisition is contended when the lock was not available straight away. For locks that cannot be tried
+ * (the Python GIL and the cache locks) it is contended when taking it took longer than getContentionThreshold().
+ * Hold times are not recorded for the cache locks since they are released by the cache lock objects.
+ **/
+class LockProfiler
+{
+public:
+
+    struct SiteStats
+    {
+        std::string name;
+
+        // The number of times the lock was taken and how many times a thread had to wait for it
+        U64 nAcquisitions;
+        U64 nContentions;
+
+        // In seconds
+        double totalWaitTime;
+        double maxWaitTime;
+
+        // The number of times the lock was released with its hold time recorded, and the hold times in seconds
+        U64 nReleases;
+        double totalHoldTime;
+        double maxHoldTime;
+
+        SiteStats()
+        : name()
+        , nAcquisitions(0)
+        , nContentions(0)
+        , totalWaitTime(0)
+        , maxWaitTime(0)
+        , nReleases(0)
+        , totalHoldTime(0)
+        , maxHoldTime(0)
+        {
+        }
+    };
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    /**
+     * @brief Clears the statistics of all sites
+     **/
+    static void reset();
+
+    /**
+     * @brief Returns a time in seconds, to compute wait and hold times
+     **/
+    static double getTime();
+
+    /**
+     * @brief Waits longer than this number of seconds are considered contended for locks that cannot be tried
+     **/
+    static double getContentionThreshold();
+
+    static void recordAcquisition(LockProfilerSiteEnum site, bool contended, double waitTime);
+
+    static void recordRelease(LockProfilerSiteEnum site, double holdTime);
+
+    static void getStats(std::vector<SiteStats>* stats);
+
+    static std::string getSiteName(LockProfilerSiteEnum site);
+
+    /**
+     * @brief Returns a table of the statistics of each site, sorted by decreasing total wait time
+     **/
+    static std::string getReport();
+};
+
+/**
+ * @brief Same as QMutexLocker, recording the wait and hold times of the mutex in the LockProfiler when profiling is enabled
+ **/
+class ProfiledMutexLocker
+{
+public:
+
+    ProfiledMutexLocker(QMutex* mutex, LockProfilerSiteEnum site);
+
+    ~ProfiledMutexLocker();
+
+    void unlock();
+
+    void relock();
+
+private:
+
+    QMutex* _mutex;
+    LockProfilerSiteEnum _site;
+    bool _locked;
+
+    // True if the lock was taken while profiling was enabled: the hold time is recorded on unlock
+    bool _profiled;
+    double _lockTime;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_LockProfiler_h
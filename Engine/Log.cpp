@@ -27,71 +27,146 @@
 
 #ifdef NATRON_LOG
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdarg>
-#include <memory>
-#include <cstdlib>
+#include <cstring>
+#include <map>
 #include <string>
+#include <vector>
 #include <cassert>
 #include <stdexcept>
 
+#include <QtCore/QCoreApplication>
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
 #include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
 
 #include "Global/GlobalDefines.h"
 
+#include "Engine/BoundedRingBuffer.h"
+#include "Engine/Timer.h"
+
+// The number of records the threads can log before the writer thread writes them, the others are dropped
+#define NATRON_LOG_BUFFER_CAPACITY 4096
+
+// How long the writer thread waits for records when the buffer is empty
+#define NATRON_LOG_WRITER_INTERVAL_MS 20
+
 NATRON_NAMESPACE_ENTER
 
-// see second answer of http://stackoverflow.com/questions/2342162/stdstring-formatting-like-sprintf
-static
-std::string
-string_format(const std::string fmt,
-              ...)
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum LogRecordTypeEnum
 {
-    int size = ( (int)fmt.size() ) * 2 + 50;   // Use a rubric appropriate for your code
-    std::string str;
-    va_list ap;
-
-    while (1) {     // Maximum two passes on a POSIX system...
-        str.resize(size);
-        va_start(ap, fmt);
-        int n = vsnprintf( (char *)str.data(), size, fmt.c_str(), ap );
-        va_end(ap);
-        if ( (n > -1) && (n < size) ) {  // Everything worked
-            str.resize(n);
-
-            return str;
-        }
-        if (n > -1) { // Needed size returned
-            size = n + 1;   // For null char
-        } else {
-            size *= 2;      // Guess at a larger size (OS specific)
-        }
+    eLogRecordTypeBegin = 0,
+    eLogRecordTypePrint,
+    eLogRecordTypeEnd
+};
+
+// A record of fixed size, so that logging does not allocate. The strings are truncated.
+struct LogRecord
+{
+    LogRecordTypeEnum type;
+
+    // In seconds since the log was created
+    double time;
+    quintptr threadId;
+    char node[64];
+    char text[512];
+
+    LogRecord()
+    : type(eLogRecordTypePrint)
+    , time(0)
+    , threadId(0)
+    {
+        node[0] = '\0';
+        text[0] = '\0';
     }
+};
 
-    return str;
+void
+copyString(const std::string& str,
+           char* dst,
+           std::size_t dstSize)
+{
+    std::size_t len = std::min(str.size(), dstSize - 1);
+    std::memcpy(dst, str.c_str(), len);
+    dst[len] = '\0';
 }
 
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+class LogPrivate;
+
+class LogWriterThread
+    : public QThread
+{
+public:
+
+    LogWriterThread(LogPrivate* imp)
+    : QThread()
+    , _imp(imp)
+    {
+    }
+
+    virtual ~LogWriterThread()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    LogPrivate* _imp;
+};
+
 class LogPrivate
 {
 public:
 
+    TimeLapse clock;
+    BoundedRingBuffer<LogRecord> records;
+
+    // Protects the file and the state of the writer thread, the threads that log never take it
     mutable QMutex _lock;
+    QWaitCondition _drainedCond;
     QFile* _file;
     QTextStream* _stream;
-    int _beginsCount;
+    bool _mustQuit;
+    int _drainsCount;
+
+    // The functions begun by each thread and not ended yet, only used by the writer thread
+    std::map<quintptr, std::vector<std::string> > _nodesStacks;
+    int _droppedCountWritten;
+
+    LogWriterThread _writer;
 
     LogPrivate()
-        : _lock()
+        : clock()
+        , records(NATRON_LOG_BUFFER_CAPACITY)
+        , _lock()
+        , _drainedCond()
         , _file(NULL)
         , _stream(NULL)
-        , _beginsCount(0)
+        , _mustQuit(false)
+        , _drainsCount(0)
+        , _nodesStacks()
+        , _droppedCountWritten(0)
+        , _writer(this)
     {
+        _writer.start(QThread::LowPriority);
     }
 
     ~LogPrivate()
     {
+        {
+            QMutexLocker locker(&_lock);
+            _mustQuit = true;
+        }
+        _writer.wait();
         delete _stream;
         if (_file) {
             _file->close();
@@ -103,82 +178,151 @@ public:
     {
         QMutexLocker locker(&_lock);
 
+        openInternal(fileName);
+    }
+
+    void openInternal(const std::string & fileName)
+    {
+        // Must be locked
+        assert( !_lock.tryLock() );
         if (_file) {
             return;
         }
-        _file = new QFile( fileName.c_str() );
+        _file = new QFile( QString::fromUtf8( fileName.c_str() ) );
         _file->open(QIODevice::WriteOnly | QIODevice::Truncate);
         _stream = new QTextStream(_file);
     }
 
-    void beginFunction(const std::string & callerName,
-                       const std::string & function)
+    void push(LogRecordTypeEnum type,
+              const std::string& node,
+              const std::string& text)
+    {
+        LogRecord r;
+        initRecord(type, &r);
+        copyString(node, r.node, sizeof(r.node));
+        copyString(text, r.text, sizeof(r.text));
+        records.tryPush(r);
+    }
+
+    void initRecord(LogRecordTypeEnum type,
+                    LogRecord* r)
+    {
+        r->type = type;
+        r->time = clock.getTimeSinceCreation();
+        r->threadId = (quintptr)QThread::currentThreadId();
+    }
+
+    void flush()
     {
-        if (!_file) {
-            QString filename(NATRON_APPLICATION_NAME + QString("_log") + QString::number( QCoreApplication::instance()->applicationPid() ) + ".txt");
-            open( filename.toStdString() );
-        }
         QMutexLocker locker(&_lock);
-        _stream->operator <<("********************************************************************************\n");
-        for (int i = 0; i < _beginsCount; ++i) {
-            _stream->operator <<("    ");
+
+        // The drain running at the moment may have started before the call: wait for the next one to finish
+        const int drainsCount = _drainsCount;
+        while (_drainsCount < drainsCount + 2 && !_mustQuit) {
+            _drainedCond.wait(&_lock);
         }
-        _stream->operator <<("START ");
-        _stream->operator <<( callerName.c_str() );
-        _stream->operator <<("    ");
-        _stream->operator <<( function.c_str() );
-        _stream->operator <<('\n');
-        _stream->flush();
-        ++_beginsCount;
     }
 
-    void print(const std::string & log)
+    // Writes the records in the buffer, returns false if it was empty. Called by the writer thread.
+    bool drain()
     {
         QMutexLocker locker(&_lock);
 
-        assert(_file);
-        for (int i = 0; i < _beginsCount; ++i) {
-            _stream->operator <<("    ");
+        LogRecord r;
+        bool hasRecords = false;
+        while ( records.tryPop(&r) ) {
+            if (!_file) {
+                QString filename = QString::fromUtf8(NATRON_APPLICATION_NAME) + QString::fromUtf8("_log") + QString::number( QCoreApplication::applicationPid() ) + QString::fromUtf8(".txt");
+                openInternal( filename.toStdString() );
+            }
+            writeRecord(r);
+            hasRecords = true;
         }
-        QString str( log.c_str() );
-        for (int i = 0; i < str.size(); ++i) {
-            _stream->operator <<( str.at(i).toLatin1() );
-            if ( (i % 80 == 0) && (i != 0) ) { // format to 80 columns
-                /*Find closest word end and insert a new line*/
-                ++i;
-                while ( i < str.size() && str.at(i) != QChar(' ') ) {
-                    _stream->operator <<( str.at(i).toLatin1() );
-                    ++i;
-                }
-                _stream->operator <<('\n');
-                for (int i = 0; i < _beginsCount; ++i) {
-                    _stream->operator <<("    ");
+        const int droppedCount = records.getDroppedCount();
+        if ( _stream && (droppedCount != _droppedCountWritten) ) {
+            *_stream << "*** " << (droppedCount - _droppedCountWritten) << " records dropped because the log buffer was full ***\n";
+            _droppedCountWritten = droppedCount;
+        }
+        if (_stream && hasRecords) {
+            _stream->flush();
+        }
+        ++_drainsCount;
+        _drainedCond.wakeAll();
+
+        return hasRecords;
+    }
+
+    void writeRecord(const LogRecord& r)
+    {
+        std::vector<std::string>& nodesStack = _nodesStacks[r.threadId];
+        if ( (r.type == eLogRecordTypeEnd) && !nodesStack.empty() ) {
+            nodesStack.pop_back();
+        }
+
+        QString prefix = QString::number(r.time, 'f', 6) + QString::fromUtf8(" [0x") + QString::number( (qulonglong)r.threadId, 16 ) + QString::fromUtf8("] ");
+        for (std::size_t i = 0; i < nodesStack.size(); ++i) {
+            prefix += QString::fromUtf8("    ");
+        }
+
+        switch (r.type) {
+        case eLogRecordTypeBegin:
+            *_stream << "********************************************************************************\n";
+            *_stream << prefix << "START " << QString::fromUtf8(r.node) << "    " << QString::fromUtf8(r.text) << '\n';
+            nodesStack.push_back(r.node);
+            break;
+        case eLogRecordTypeEnd:
+            *_stream << prefix << "STOP " << QString::fromUtf8(r.node) << "    " << QString::fromUtf8(r.text) << '\n';
+            break;
+        case eLogRecordTypePrint: {
+            if ( !nodesStack.empty() ) {
+                prefix += QString::fromUtf8("[") + QString::fromUtf8( nodesStack.back().c_str() ) + QString::fromUtf8("] ");
+            }
+            // Format to 80 columns, breaking at the closest word end
+            const QString str = QString::fromUtf8(r.text);
+            int lineStart = 0;
+            while ( lineStart < str.size() ) {
+                int lineEnd = lineStart + 80;
+                if ( lineEnd < str.size() ) {
+                    while ( lineEnd < str.size() && str.at(lineEnd) != QChar::fromLatin1(' ') ) {
+                        ++lineEnd;
+                    }
+                } else {
+                    lineEnd = str.size();
                 }
+                *_stream << prefix << str.mid(lineStart, lineEnd - lineStart) << '\n';
+                lineStart = lineEnd + 1;
+            }
+            if ( str.isEmpty() ) {
+                *_stream << prefix << '\n';
             }
+            break;
+        }
         }
-        _stream->operator <<( log.c_str() );
-        _stream->operator <<('\n');
-        _stream->flush();
     }
 
-    void endFunction(const std::string & callerName,
-                     const std::string & function)
+    bool mustQuit() const
     {
         QMutexLocker locker(&_lock);
 
-        --_beginsCount;
-        for (int i = 0; i < _beginsCount; ++i) {
-            _stream->operator <<("    ");
-        }
-        _stream->operator <<("STOP ");
-        _stream->operator <<( callerName.c_str() );
-        _stream->operator <<("    ");
-        _stream->operator <<( function.c_str() );
-        _stream->operator <<('\n');
-        _stream->flush();
+        return _mustQuit;
     }
 };
 
+void
+LogWriterThread::run()
+{
+    for (;;) {
+        // Read the flag before draining so that the records logged before the quit request are written
+        const bool mustQuit = _imp->mustQuit();
+        if ( !_imp->drain() ) {
+            if (mustQuit) {
+                return;
+            }
+            msleep(NATRON_LOG_WRITER_INTERVAL_MS);
+        }
+    }
+}
+
 Log::Log()
     : Singleton<Log>(), _imp( new LogPrivate() )
 {
@@ -199,32 +343,48 @@ void
 Log::beginFunction(const std::string & callerName,
                    const std::string & function)
 {
-    Log::instance()->_imp->beginFunction(callerName, function);
+    Log::instance()->_imp->push(eLogRecordTypeBegin, callerName, function);
 }
 
 void
 Log::print(const std::string & log)
 {
-    Log::instance()->_imp->print(log);
+    Log::instance()->_imp->push( eLogRecordTypePrint, std::string(), log );
 }
 
 void
 Log::print(const char *format,
            ...)
 {
-    va_list args;
+    LogPrivate* imp = Log::instance()->_imp;
+    LogRecord r;
 
+    imp->initRecord(eLogRecordTypePrint, &r);
+    va_list args;
     va_start(args, format);
-    std::string str = string_format(format, args);
+    // Truncated to the size of the record
+    vsnprintf(r.text, sizeof(r.text), format, args);
     va_end(args);
-    Log::print(str);
+    imp->records.tryPush(r);
 }
 
 void
 Log::endFunction(const std::string & callerName,
                  const std::string & function)
 {
-    Log::instance()->_imp->endFunction(callerName, function);
+    Log::instance()->_imp->push(eLogRecordTypeEnd, callerName, function);
+}
+
+void
+Log::flush()
+{
+    Log::instance()->_imp->flush();
+}
+
+int
+Log::getDroppedRecordsCount()
+{
+    return Log::instance()->_imp->records.getDroppedCount();
 }
 
 NATRON_NAMESPACE_EXIT
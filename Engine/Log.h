@@ -38,6 +38,13 @@
 NATRON_NAMESPACE_ENTER
 
 class LogPrivate;
+
+/**
+ * @brief A debug log of the function calls, enabled by building with CONFIG+=log.
+ * The calling threads push fixed size records, with the thread, the node and the time, to a lock-free ring buffer
+ * which a background thread writes to the file: logging never blocks the render threads.
+ * When the buffer is full the records are dropped and counted, the number of dropped records is written to the file.
+ **/
 class Log
     : public Singleton<Log>
 {
@@ -58,6 +65,7 @@ public:
     /**
      * @brief Begins a new function in the log. It will print a new delimiter
      * and a START tag. This is used to bracket a call to print.
+     * The callerName, e.g: the name of the node, is the node of the records of the thread until endFunction is called.
      **/
     static void beginFunction(const std::string & callerName, const std::string & function);
 
@@ -79,6 +87,17 @@ public:
      * and a STOP tag. This is used to bracket a call to print.
      **/
     static void endFunction(const std::string & callerName, const std::string & function);
+
+    /**
+     * @brief Blocks until the records logged so far are written to the file
+     **/
+    static void flush();
+
+    /**
+     * @brief Returns the number of records dropped because the buffer was full
+     **/
+    static int getDroppedRecordsCount();
+
     static bool enabled()
     {
         return true;
@@ -132,6 +151,15 @@ public:
     {
     }
 
+    static void flush()
+    {
+    }
+
+    static int getDroppedRecordsCount()
+    {
+        return 0;
+    }
+
     static bool enabled()
     {
         return false;
@@ -29,9 +29,25 @@
 #include <algorithm> // min, max
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
+#include "Engine/CPUInstructionSet.h"
 #include "Engine/RectI.h"
 
+// SSE2 is always available on x86-64, AVX2 kernels are compiled with a target attribute and selected at runtime
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_LUT_SSE2
+#include <emmintrin.h>
+#if ( defined(__GNUC__) && ( (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) ) ) || defined(__clang__)
+#define NATRON_LUT_AVX2
+#define NATRON_LUT_AVX2_TARGET __attribute__( ( target("avx2") ) )
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define NATRON_LUT_NEON
+#include <arm_neon.h>
+#endif
+
 /*
  * The to_byte* and from_byte* functions implement and generalize the algorithm
  * described in:
@@ -129,6 +145,353 @@ index_to_float(const unsigned short i)
     return tmp.f;
 }
 
+///////////////////////
+/////////////////////////////////////////// CONVERSION KERNELS //////////////////////////////////////////////
+///////////////////////
+
+/*
+ * The parts of the conversions that do not depend on the error diffusion are done a whole scan-line at a time
+ * by the kernels below. There is one version per instruction set, the best one supported by the CPU is selected at
+ * runtime (@see getInstructionSet()). All versions must give exactly the same results as the scalar one, which is the
+ * reference: only use operations that are exactly rounded (no FMA, no reciprocal approximations).
+ */
+
+struct LutKernels
+{
+    /**
+     * @brief indices[i] = hipart(src[i]) for i in [0, n)
+     **/
+    void (*hipartRow)(const float* src, int n, unsigned short* indices);
+
+    /**
+     * @brief Same as hipartRow for nPixels 4-components pixels with the alpha in the last component, premultiplied by alpha:
+     * indices[4*i+c] = hipart(src[4*i+c] * src[4*i+3])
+     **/
+    void (*hipartPremultRow)(const float* src, int nPixels, unsigned short* indices);
+
+    /**
+     * @brief For nPixels 4-components 8-bit pixels with the alpha in the last component:
+     * normalized[4*i+c] = intToFloat<256>(src[4*i+c]) and indices[4*i+c] = floatToInt<256>(normalized[4*i+c] / normalized[4*i+3])
+     * if alpha is not 0, otherwise indices[4*i+c] = 0.
+     **/
+    void (*unpremultRow)(const unsigned char* src, int nPixels, unsigned char* indices, float* normalized);
+};
+
+static void
+hipartRow_scalar(const float* src,
+                 int n,
+                 unsigned short* indices)
+{
+    for (int i = 0; i < n; ++i) {
+        indices[i] = hipart(src[i]);
+    }
+}
+
+static void
+hipartPremultRow_scalar(const float* src,
+                        int nPixels,
+                        unsigned short* indices)
+{
+    for (int i = 0; i < nPixels; ++i, src += 4, indices += 4) {
+        const float a = src[3];
+        for (int c = 0; c < 4; ++c) {
+            indices[c] = hipart(src[c] * a);
+        }
+    }
+}
+
+static void
+unpremultRow_scalar(const unsigned char* src,
+                    int nPixels,
+                    unsigned char* indices,
+                    float* normalized)
+{
+    for (int i = 0; i < nPixels; ++i, src += 4, indices += 4, normalized += 4) {
+        for (int c = 0; c < 4; ++c) {
+            normalized[c] = intToFloat<256>(src[c]);
+        }
+        const float a = normalized[3];
+        for (int c = 0; c < 4; ++c) {
+            indices[c] = a > 0 ? (unsigned char)floatToInt<256>(normalized[c] / a) : 0;
+        }
+    }
+}
+
+static const LutKernels lutKernels_scalar = {
+    hipartRow_scalar, hipartPremultRow_scalar, unpremultRow_scalar
+};
+
+#ifdef NATRON_LUT_SSE2
+
+// Since the components of a float are in [-32768, 32767] once shifted arithmetically by 16 bits, packing them with
+// signed saturation leaves the bits of hipart() untouched.
+static void
+hipartRow_sse2(const float* src,
+               int n,
+               unsigned short* indices)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = _mm_srai_epi32(_mm_castps_si128( _mm_loadu_ps(src + i) ), 16);
+        __m128i hi = _mm_srai_epi32(_mm_castps_si128( _mm_loadu_ps(src + i + 4) ), 16);
+        _mm_storeu_si128( (__m128i*)(indices + i), _mm_packs_epi32(lo, hi) );
+    }
+    hipartRow_scalar(src + i, n - i, indices + i);
+}
+
+static void
+hipartPremultRow_sse2(const float* src,
+                      int nPixels,
+                      unsigned short* indices)
+{
+    int i = 0;
+    for (; i + 2 <= nPixels; i += 2) {
+        __m128 p0 = _mm_loadu_ps(src + 4 * i);
+        __m128 p1 = _mm_loadu_ps(src + 4 * i + 4);
+        p0 = _mm_mul_ps( p0, _mm_shuffle_ps( p0, p0, _MM_SHUFFLE(3, 3, 3, 3) ) );
+        p1 = _mm_mul_ps( p1, _mm_shuffle_ps( p1, p1, _MM_SHUFFLE(3, 3, 3, 3) ) );
+        __m128i lo = _mm_srai_epi32(_mm_castps_si128(p0), 16);
+        __m128i hi = _mm_srai_epi32(_mm_castps_si128(p1), 16);
+        _mm_storeu_si128( (__m128i*)(indices + 4 * i), _mm_packs_epi32(lo, hi) );
+    }
+    hipartPremultRow_scalar(src + 4 * i, nPixels - i, indices + 4 * i);
+}
+
+// floatToInt<256>() on 4 floats
+static inline __m128i
+floatToInt256_sse2(__m128 v)
+{
+    __m128i ret = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( v, _mm_set1_ps(255.f) ), _mm_set1_ps(0.5f) ) );
+    ret = _mm_andnot_si128(_mm_castps_si128( _mm_cmple_ps( v, _mm_setzero_ps() ) ), ret);
+    __m128i isOne = _mm_castps_si128( _mm_cmpge_ps( v, _mm_set1_ps(1.f) ) );
+
+    return _mm_or_si128( _mm_andnot_si128(isOne, ret), _mm_and_si128( isOne, _mm_set1_epi32(255) ) );
+}
+
+static void
+unpremultRow_sse2(const unsigned char* src,
+                  int nPixels,
+                  unsigned char* indices,
+                  float* normalized)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= nPixels; i += 4) {
+        __m128i bytes = _mm_loadu_si128( (const __m128i*)(src + 4 * i) );
+        __m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+        __m128i ints[4];
+        for (int k = 0; k < 4; ++k) {
+            __m128i dwords = (k % 2) ? _mm_unpackhi_epi16(words[k / 2], zero) : _mm_unpacklo_epi16(words[k / 2], zero);
+            __m128 v = _mm_div_ps( _mm_cvtepi32_ps(dwords), _mm_set1_ps(255.f) );
+            _mm_storeu_ps(normalized + 4 * (i + k), v);
+            __m128 a = _mm_shuffle_ps( v, v, _MM_SHUFFLE(3, 3, 3, 3) );
+            __m128 hasAlpha = _mm_cmpgt_ps( a, _mm_setzero_ps() );
+            // Divide by 1 where alpha is 0 to avoid floating point exceptions, the result is discarded anyway
+            __m128 safeA = _mm_or_ps( _mm_and_ps(hasAlpha, a), _mm_andnot_ps( hasAlpha, _mm_set1_ps(1.f) ) );
+            ints[k] = _mm_and_si128( _mm_castps_si128(hasAlpha), floatToInt256_sse2( _mm_div_ps(v, safeA) ) );
+        }
+        __m128i packed = _mm_packus_epi16( _mm_packs_epi32(ints[0], ints[1]), _mm_packs_epi32(ints[2], ints[3]) );
+        _mm_storeu_si128( (__m128i*)(indices + 4 * i), packed );
+    }
+    unpremultRow_scalar(src + 4 * i, nPixels - i, indices + 4 * i, normalized + 4 * i);
+}
+
+static const LutKernels lutKernels_sse2 = {
+    hipartRow_sse2, hipartPremultRow_sse2, unpremultRow_sse2
+};
+
+#endif // NATRON_LUT_SSE2
+
+#ifdef NATRON_LUT_AVX2
+
+// These are compiled for AVX2 whatever the compiler flags and only called when the CPU supports it.
+// _mm256_packs_epi32 packs within each 128-bit lane, hence the permutation.
+NATRON_LUT_AVX2_TARGET static void
+hipartRow_avx2(const float* src,
+               int n,
+               unsigned short* indices)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i lo = _mm256_srai_epi32(_mm256_castps_si256( _mm256_loadu_ps(src + i) ), 16);
+        __m256i hi = _mm256_srai_epi32(_mm256_castps_si256( _mm256_loadu_ps(src + i + 8) ), 16);
+        _mm256_storeu_si256( (__m256i*)(indices + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)) );
+    }
+    hipartRow_scalar(src + i, n - i, indices + i);
+}
+
+NATRON_LUT_AVX2_TARGET static void
+hipartPremultRow_avx2(const float* src,
+                      int nPixels,
+                      unsigned short* indices)
+{
+    int i = 0;
+    for (; i + 4 <= nPixels; i += 4) {
+        __m256 p0 = _mm256_loadu_ps(src + 4 * i);
+        __m256 p1 = _mm256_loadu_ps(src + 4 * i + 8);
+        p0 = _mm256_mul_ps( p0, _mm256_shuffle_ps( p0, p0, _MM_SHUFFLE(3, 3, 3, 3) ) );
+        p1 = _mm256_mul_ps( p1, _mm256_shuffle_ps( p1, p1, _MM_SHUFFLE(3, 3, 3, 3) ) );
+        __m256i lo = _mm256_srai_epi32(_mm256_castps_si256(p0), 16);
+        __m256i hi = _mm256_srai_epi32(_mm256_castps_si256(p1), 16);
+        _mm256_storeu_si256( (__m256i*)(indices + 4 * i), _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)) );
+    }
+    hipartPremultRow_scalar(src + 4 * i, nPixels - i, indices + 4 * i);
+}
+
+NATRON_LUT_AVX2_TARGET static void
+unpremultRow_avx2(const unsigned char* src,
+                  int nPixels,
+                  unsigned char* indices,
+                  float* normalized)
+{
+    int i = 0;
+    for (; i + 2 <= nPixels; i += 2) {
+        __m256 v = _mm256_div_ps( _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)(src + 4 * i) ) ) ), _mm256_set1_ps(255.f) );
+        _mm256_storeu_ps(normalized + 4 * i, v);
+        __m256 a = _mm256_shuffle_ps( v, v, _MM_SHUFFLE(3, 3, 3, 3) );
+        __m256 hasAlpha = _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GT_OQ);
+        // Divide by 1 where alpha is 0 to avoid floating point exceptions, the result is discarded anyway
+        __m256 rf = _mm256_div_ps( v, _mm256_blendv_ps(_mm256_set1_ps(1.f), a, hasAlpha) );
+        // floatToInt<256>()
+        __m256i ret = _mm256_cvttps_epi32( _mm256_add_ps( _mm256_mul_ps( rf, _mm256_set1_ps(255.f) ), _mm256_set1_ps(0.5f) ) );
+        ret = _mm256_castps_si256( _mm256_blendv_ps( _mm256_castsi256_ps(ret), _mm256_castsi256_ps( _mm256_set1_epi32(255) ), _mm256_cmp_ps(rf, _mm256_set1_ps(1.f), _CMP_GE_OQ) ) );
+        ret = _mm256_and_si256( ret, _mm256_castps_si256( _mm256_and_ps( hasAlpha, _mm256_cmp_ps(rf, _mm256_setzero_ps(), _CMP_GT_OQ) ) ) );
+        __m128i words = _mm_packs_epi32( _mm256_castsi256_si128(ret), _mm256_extracti128_si256(ret, 1) );
+        _mm_storel_epi64( (__m128i*)(indices + 4 * i), _mm_packus_epi16(words, words) );
+    }
+    unpremultRow_scalar(src + 4 * i, nPixels - i, indices + 4 * i, normalized + 4 * i);
+}
+
+static const LutKernels lutKernels_avx2 = {
+    hipartRow_avx2, hipartPremultRow_avx2, unpremultRow_avx2
+};
+
+#endif // NATRON_LUT_AVX2
+
+#ifdef NATRON_LUT_NEON
+
+static void
+hipartRow_neon(const float* src,
+               int n,
+               unsigned short* indices)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x4_t lo = vshrn_n_u32(vreinterpretq_u32_f32( vld1q_f32(src + i) ), 16);
+        uint16x4_t hi = vshrn_n_u32(vreinterpretq_u32_f32( vld1q_f32(src + i + 4) ), 16);
+        vst1q_u16( indices + i, vcombine_u16(lo, hi) );
+    }
+    hipartRow_scalar(src + i, n - i, indices + i);
+}
+
+static void
+hipartPremultRow_neon(const float* src,
+                      int nPixels,
+                      unsigned short* indices)
+{
+    int i = 0;
+    for (; i + 2 <= nPixels; i += 2) {
+        float32x4_t p0 = vld1q_f32(src + 4 * i);
+        float32x4_t p1 = vld1q_f32(src + 4 * i + 4);
+        p0 = vmulq_f32( p0, vdupq_n_f32( vgetq_lane_f32(p0, 3) ) );
+        p1 = vmulq_f32( p1, vdupq_n_f32( vgetq_lane_f32(p1, 3) ) );
+        uint16x4_t lo = vshrn_n_u32(vreinterpretq_u32_f32(p0), 16);
+        uint16x4_t hi = vshrn_n_u32(vreinterpretq_u32_f32(p1), 16);
+        vst1q_u16( indices + 4 * i, vcombine_u16(lo, hi) );
+    }
+    hipartPremultRow_scalar(src + 4 * i, nPixels - i, indices + 4 * i);
+}
+
+// The compiler may contract the multiply-add of floatToInt() in the scalar version on ARM, which would
+// make a NEON version of unpremultRow differ from it: use the scalar version.
+static const LutKernels lutKernels_neon = {
+    hipartRow_neon, hipartPremultRow_neon, unpremultRow_scalar
+};
+
+#endif // NATRON_LUT_NEON
+
+static LutInstructionSetEnum
+detectInstructionSet()
+{
+    // there are no AVX-512 kernels
+    const CPUInstructionSetEnum cpuInstructionSet = CPUInstructionSet::getSupportedInstructionSet();
+    (void)cpuInstructionSet;
+#if defined(NATRON_LUT_AVX2)
+    if (cpuInstructionSet == eCPUInstructionSetAVX2 || cpuInstructionSet == eCPUInstructionSetAVX512) {
+        return eLutInstructionSetAVX2;
+    }
+#endif
+#if defined(NATRON_LUT_SSE2)
+    return eLutInstructionSetSSE2;
+#elif defined(NATRON_LUT_NEON)
+    return eLutInstructionSetNEON;
+#else
+    return eLutInstructionSetScalar;
+#endif
+}
+
+static const LutInstructionSetEnum supportedInstructionSet = detectInstructionSet();
+static LutInstructionSetEnum currentInstructionSet = supportedInstructionSet;
+
+static const LutKernels&
+getKernels()
+{
+    switch (currentInstructionSet) {
+#ifdef NATRON_LUT_AVX2
+    case eLutInstructionSetAVX2:
+        return lutKernels_avx2;
+#endif
+#ifdef NATRON_LUT_SSE2
+    case eLutInstructionSetSSE2:
+        return lutKernels_sse2;
+#endif
+#ifdef NATRON_LUT_NEON
+    case eLutInstructionSetNEON:
+        return lutKernels_neon;
+#endif
+    default:
+        return lutKernels_scalar;
+    }
+}
+
+LutInstructionSetEnum
+getInstructionSet()
+{
+    return currentInstructionSet;
+}
+
+bool
+isInstructionSetSupported(LutInstructionSetEnum instructionSet)
+{
+    switch (instructionSet) {
+    case eLutInstructionSetScalar:
+        return true;
+    case eLutInstructionSetSSE2:
+#ifdef NATRON_LUT_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case eLutInstructionSetAVX2:
+        return supportedInstructionSet == eLutInstructionSetAVX2;
+    case eLutInstructionSetNEON:
+        return supportedInstructionSet == eLutInstructionSetNEON;
+    }
+
+    return false;
+}
+
+bool
+setInstructionSet(LutInstructionSetEnum instructionSet)
+{
+    if ( !isInstructionSetSupported(instructionSet) ) {
+        return false;
+    }
+    currentInstructionSet = instructionSet;
+
+    return true;
+}
+
 ///initialize the singleton
 LutManager LutManager::m_instance = LutManager();
 LutManager::LutManager()
@@ -367,6 +730,14 @@ Lut::fillTables() const
         int i = hipart(f);
         toFunc_hipart_to_uint8xx[i] = Color::charToUint8xx(b);
     }
+    // fill the half tables: every half value has its own entry, so these are exact
+    toFunc_half_to_float.resize(0x10000);
+    fromFunc_half_to_float.resize(0x10000);
+    for (int i = 0; i < 0x10000; ++i) {
+        float f = Half::toFloat( (unsigned short)i );
+        toFunc_half_to_float[i] = _toFunc(f);
+        fromFunc_half_to_float[i] = _fromFunc(f);
+    }
 }
 
 #ifdef DEAD_CODE
@@ -489,9 +860,16 @@ Lut::to_byte_packed(unsigned char* to,
 
     validate();
 
+    // The hipart of the pixels of a scan-line are computed at once by the kernels, only the error diffusion
+    // is done pixel per pixel
+    const int width = rect.x2 - rect.x1;
+    const bool mustPremult = inputHasAlpha && premult;
+    const LutKernels& kernels = getKernels();
+    std::vector<unsigned short> indices(width * inPackingSize);
+
     for (int y = rect.y1; y < rect.y2; ++y) {
         // coverity[dont_call]
-        int start = rand() % (rect.x2 - rect.x1) + rect.x1;
+        int start = rand() % width + rect.x1;
         unsigned error_r, error_g, error_b;
         error_r = error_g = error_b = 0x80;
         int srcY = y;
@@ -503,39 +881,44 @@ Lut::to_byte_packed(unsigned char* to,
         int dstY = dstBounds.y2 - y - 1;
         const float *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         unsigned char *dst_pixels = to + (dstY * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        if (mustPremult) {
+            kernels.hipartPremultRow(src_pixels + rect.x1 * inPackingSize, width, &indices[0]);
+        } else {
+            kernels.hipartRow(src_pixels + rect.x1 * inPackingSize, width * inPackingSize, &indices[0]);
+        }
         /* go forwards from starting point to end of line: */
         for (int x = start; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
+            int indexCol = (x - rect.x1) * inPackingSize;
             int outCol = x * outPackingSize;
-            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[indices[indexCol + inROffset]];
+            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[indices[indexCol + inGOffset]];
+            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[indices[indexCol + inBOffset]];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
             dst_pixels[outCol + outBOffset] = (unsigned char)(error_b >> 8);
             if (outputHasAlpha) {
                 // alpha is linear and should not be dithered
-                dst_pixels[outCol + outAOffset] = floatToInt<256>(a);
+                dst_pixels[outCol + outAOffset] = mustPremult ? floatToInt<256>(src_pixels[inCol + inAOffset]) : 255;
             }
         }
         /* go backwards from starting point to start of line: */
         error_r = error_g = error_b = 0x80;
         for (int x = start - 1; x >= rect.x1; --x) {
             int inCol = x * inPackingSize;
+            int indexCol = (x - rect.x1) * inPackingSize;
             int outCol = x * outPackingSize;
-            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[indices[indexCol + inROffset]];
+            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[indices[indexCol + inGOffset]];
+            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[indices[indexCol + inBOffset]];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
             dst_pixels[outCol + outBOffset] = (unsigned char)(error_b >> 8);
             if (outputHasAlpha) {
                 // alpha is linear and should not be dithered
-                dst_pixels[outCol + outAOffset] = floatToInt<256>(a);
+                dst_pixels[outCol + outAOffset] = mustPremult ? floatToInt<256>(src_pixels[inCol + inAOffset]) : 255;
             }
         }
     }
@@ -700,6 +1083,17 @@ Lut::from_byte_packed(float* to,
     outPackingSize = outputHasAlpha ? 4 : 3;
 
     validate();
+
+    // Unpremultiplying requires 3 divisions per pixel: they are done a whole scan-line at a time by the kernels
+    const int width = rect.x2 - rect.x1;
+    const bool mustUnpremult = inputHasAlpha && premult;
+    const LutKernels& kernels = getKernels();
+    std::vector<unsigned char> indices;
+    std::vector<float> normalized;
+    if (mustUnpremult) {
+        indices.resize(width * 4);
+        normalized.resize(width * 4);
+    }
     for (int y = rect.y1; y < rect.y2; ++y) {
         int srcY = y;
         if (invertY) {
@@ -708,21 +1102,20 @@ Lut::from_byte_packed(float* to,
 
         const unsigned char *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         float *dst_pixels = to + (y * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        if (mustUnpremult) {
+            assert(inPackingSize == 4 && inAOffset == 3);
+            kernels.unpremultRow(src_pixels + rect.x1 * inPackingSize, width, &indices[0], &normalized[0]);
+        }
         for (int x = rect.x1; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
-            if (inputHasAlpha && premult) {
-                float rf = 0., gf = 0., bf = 0.;
-                float a = Color::intToFloat<256>(src_pixels[inCol + inAOffset]);
-                if (a > 0) {
-                    rf = Color::intToFloat<256>(src_pixels[inCol + inROffset]) / a;
-                    gf = Color::intToFloat<256>(src_pixels[inCol + inGOffset]) / a;
-                    bf = Color::intToFloat<256>(src_pixels[inCol + inBOffset]) / a;
-                }
+            if (mustUnpremult) {
+                int indexCol = (x - rect.x1) * 4;
+                float a = normalized[indexCol + inAOffset];
                 // we may lose a bit of information, but hey, it's 8-bits anyway, who cares?
-                dst_pixels[outCol + outROffset] = fromColorSpaceUint8ToLinearFloatFast( Color::floatToInt<256>(rf) ) * a;
-                dst_pixels[outCol + outGOffset] = fromColorSpaceUint8ToLinearFloatFast( Color::floatToInt<256>(gf) ) * a;
-                dst_pixels[outCol + outBOffset] = fromColorSpaceUint8ToLinearFloatFast( Color::floatToInt<256>(bf) ) * a;
+                dst_pixels[outCol + outROffset] = fromColorSpaceUint8ToLinearFloatFast(indices[indexCol + inROffset]) * a;
+                dst_pixels[outCol + outGOffset] = fromColorSpaceUint8ToLinearFloatFast(indices[indexCol + inGOffset]) * a;
+                dst_pixels[outCol + outBOffset] = fromColorSpaceUint8ToLinearFloatFast(indices[indexCol + inBOffset]) * a;
                 if (outputHasAlpha) {
                     // alpha is linear
                     dst_pixels[outCol + outAOffset] = a;
@@ -32,15 +32,20 @@
 ///// This namespace is kept is synch with what can be found in openfx-io repository. It is used here in Natron for the viewer essentially.
 ///
 
+#include <cassert>
 #include <cmath>
 #include <map>
 #include <string>
+#include <vector>
 
 CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QAtomicInt>
 #include <QtCore/QMutex>
 CLANG_DIAG_ON(deprecated)
 
 #include "Engine/EngineFwd.h"
+#include "Engine/Half.h"
+#include "Engine/LockProfiler.h"
 
 
 NATRON_NAMESPACE_ENTER
@@ -68,6 +73,30 @@ typedef float (*fromColorSpaceFunctionV1)(float v);
 /* @brief Converts a float ranging in [0 - 1.f] in  linear color-space to the desired color-space to also ranging in [0 - 1.f]*/
 typedef float (*toColorSpaceFunctionV1)(float v);
 
+/// @enum The instruction sets that may be used by the packed conversions of the Lut class.
+/// All of them give exactly the same results.
+enum LutInstructionSetEnum
+{
+    eLutInstructionSetScalar = 0,
+    eLutInstructionSetSSE2,
+    eLutInstructionSetAVX2,
+    eLutInstructionSetNEON
+};
+
+/**
+ * @brief Returns the instruction set used by the conversions. By default this is the best one supported by the CPU,
+ * which is detected at startup.
+ **/
+LutInstructionSetEnum getInstructionSet();
+
+bool isInstructionSetSupported(LutInstructionSetEnum instructionSet);
+
+/**
+ * @brief Force the instruction set used by the conversions, e.g: to compare them in tests and benchmarks.
+ * This must not be called while conversions are running. Returns false if the CPU does not support it.
+ **/
+bool setInstructionSet(LutInstructionSetEnum instructionSet);
+
 
 // a Singleton that holds precomputed LUTs for the whole application.
 // The m_instance member is static and is thus built before the first call to Instance().
@@ -146,7 +175,10 @@ class Lut
     /// and never change afterwards
     mutable unsigned short toFunc_hipart_to_uint8xx[0x10000];         /// contains  2^16 = 65536 values between 0-255
     mutable float fromFunc_uint8_to_float[256];         /// values between 0-1.f
+    mutable std::vector<float> toFunc_half_to_float;         /// toFunc of each of the 2^16 half values, indexed by their bits
+    mutable std::vector<float> fromFunc_half_to_float;         /// fromFunc of each of the 2^16 half values, indexed by their bits
     mutable bool init_;         ///< false if the tables are not yet initialized
+    mutable QAtomicInt _initialized;         ///< set with release semantics once the tables are filled, read by validate() without locking
     mutable QMutex _lock;         ///< protects init_
 
     friend class LutManager;
@@ -157,7 +189,10 @@ class Lut
         : _name(name)
         , _fromFunc(fromFunc)
         , _toFunc(toFunc)
+        , toFunc_half_to_float()
+        , fromFunc_half_to_float()
         , init_(false)
+        , _initialized()
         , _lock()
     {
     }
@@ -188,15 +223,25 @@ public:
     }
 
     //Called by all public members
+    //Once the tables are filled this is a single atomic load: the many threads that convert at once do not contend on _lock
     void validate() const
     {
-        QMutexLocker g(&_lock);
+#if QT_VERSION < 0x050000
+        if ( (int)_initialized != 0 ) {
+#else
+        if (_initialized.loadAcquire() != 0) {
+#endif
+            return;
+        }
+
+        ProfiledMutexLocker g(&_lock, eLockProfilerSiteLut);
 
         if (init_) {
             return;
         }
         fillTables();
         init_ = true;
+        _initialized.fetchAndStoreRelease(1);
     }
 
     const std::string & getName() const
@@ -237,6 +282,29 @@ public:
      */
     float fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const;
 
+    /* @brief Converts a half in linear color-space using the look-up tables: this is a single look-up
+     * and gives exactly toColorSpaceFloatFromLinearFloat(v).
+     * A float may be rounded to a Half to use it, e.g for display, where the precision of half is enough.
+     * @return A float in the destination color-space.
+     */
+    float toColorSpaceFloatFromLinearHalfFast(Half v) const
+    {
+        assert(init_);
+
+        return toFunc_half_to_float[v.bits()];
+    }
+
+    /* @brief Converts a half in the destination color-space using the look-up tables: this is a single look-up
+     * and gives exactly fromColorSpaceFloatToLinearFloat(v).
+     * @return A float in linear color-space.
+     */
+    float fromColorSpaceHalfToLinearFloatFast(Half v) const
+    {
+        assert(init_);
+
+        return fromFunc_half_to_float[v.bits()];
+    }
+
 
     /////@TODO the following functions expects a float input buffer, one could extend it to cover all bitdepths.
 
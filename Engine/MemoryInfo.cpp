@@ -59,6 +59,10 @@
 #  elif defined(__linux__) || defined(__linux) || defined(linux) || defined(__gnu_linux__) || defined(__FreeBSD__)
 #    include <stdio.h>
 #    include <unistd.h>
+#    include <sys/mman.h>
+#    if !defined(__FreeBSD__)
+#      include <sys/syscall.h>
+#    endif
 #    if defined(__FreeBSD__)
 #      include <sys/sysctl.h>
 #      include <sys/types.h>
@@ -241,7 +245,6 @@ getPeakRSS( )
 }
 #endif // 0
 
-#if 0 // not used for now
 /**
  * Returns the current resident set size (physical memory use) measured
  * in bytes, or zero if the value cannot be determined on this OS.
@@ -298,7 +301,6 @@ getCurrentRSS( )
     return (size_t)0L;          /* Unsupported. */
 #endif
 } // getCurrentRSS
-#endif // 0
 
 
 std::size_t
@@ -313,6 +315,23 @@ getAmountFreePhysicalRAM()
 
     return statex.ullAvailPhys;
 #elif defined(__linux__) || defined(__linux) || defined(linux) || defined(__gnu_linux__)
+    // The free RAM does not account for the page cache that the kernel can reclaim, which includes
+    // the memory mapped tile storage: prefer the estimate of the available memory since Linux 3.14
+    {
+        FILE* f = fopen("/proc/meminfo", "r");
+        if (f) {
+            char line[256];
+            unsigned long long availableKiB = 0;
+            bool found = false;
+            while ( !found && fgets(line, sizeof(line), f) ) {
+                found = sscanf(line, "MemAvailable: %llu kB", &availableKiB) == 1;
+            }
+            fclose(f);
+            if (found) {
+                return (std::size_t)(availableKiB * 1024ULL);
+            }
+        }
+    }
     struct sysinfo memInfo;
     sysinfo (&memInfo);
     long long totalAvailableRAM = memInfo.freeram;
@@ -421,4 +440,115 @@ getAmountFreePhysicalRAM()
 #endif
 }
 
+#if defined(__linux__)
+// Returns the page aligned sub-range of the given range, or false if it does not contain any page
+static bool
+getPageAlignedRange(void* ptr, std::size_t size, void** alignedPtr, std::size_t* alignedSize)
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if ( (pageSize <= 0) || !ptr ) {
+        return false;
+    }
+    std::size_t begin = ( (std::size_t)ptr + pageSize - 1 ) & ~( (std::size_t)pageSize - 1 );
+    std::size_t end = ( (std::size_t)ptr + size ) & ~( (std::size_t)pageSize - 1 );
+    if (end <= begin) {
+        return false;
+    }
+    *alignedPtr = (void*)begin;
+    *alignedSize = end - begin;
+    return true;
+}
+#endif
+
+bool
+adviseHugePages(void* ptr,
+                std::size_t size)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    void* alignedPtr;
+    std::size_t alignedSize;
+    if ( !getPageAlignedRange(ptr, size, &alignedPtr, &alignedSize) ) {
+        return false;
+    }
+    return ::madvise(alignedPtr, alignedSize, MADV_HUGEPAGE) == 0;
+#else
+    // Windows large pages can only back memory that is not mapped to a file and
+    // the process must have the SeLockMemoryPrivilege: this is not worth it.
+    Q_UNUSED(ptr);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
+
+bool
+adviseNUMAInterleave(void* ptr,
+                     std::size_t size)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    // Find out the highest NUMA node of the system, the file contains a list of ranges, e.g: "0-3"
+    int maxNode = -1;
+    {
+        FILE* f = fopen("/sys/devices/system/node/possible", "r");
+        if (!f) {
+            return false;
+        }
+        int node;
+        int c;
+        while (fscanf(f, "%d", &node) == 1) {
+            maxNode = std::max(maxNode, node);
+            c = fgetc(f);
+            if ( (c != ',') && (c != '-') ) {
+                break;
+            }
+        }
+        fclose(f);
+    }
+    if (maxNode < 1) {
+        return false;
+    }
+
+    void* alignedPtr;
+    std::size_t alignedSize;
+    if ( !getPageAlignedRange(ptr, size, &alignedPtr, &alignedSize) ) {
+        return false;
+    }
+
+    // Select all nodes, the kernel keeps only those the process is allowed to allocate from.
+    // We do not use libnuma to avoid a dependency: MPOL_INTERLEAVE is defined in <linux/mempolicy.h>
+    const int mpolInterleave = 3;
+    const int bitsPerLong = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> nodeMask(maxNode / bitsPerLong + 1, 0);
+    for (int i = 0; i <= maxNode; ++i) {
+        nodeMask[i / bitsPerLong] |= 1UL << (i % bitsPerLong);
+    }
+    return ::syscall(SYS_mbind, alignedPtr, (unsigned long)alignedSize, mpolInterleave, &nodeMask[0], (unsigned long)maxNode + 2, 0U) == 0;
+#else
+    Q_UNUSED(ptr);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
+
+bool
+adviseNUMALocal(void* ptr,
+                std::size_t size)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    void* alignedPtr;
+    std::size_t alignedSize;
+    if ( !getPageAlignedRange(ptr, size, &alignedPtr, &alignedSize) ) {
+        return false;
+    }
+
+    // MPOL_PREFERRED with an empty node mask means local allocation on all kernels,
+    // unlike MPOL_LOCAL which requires Linux 3.8
+    const int mpolPreferred = 1;
+    return ::syscall(SYS_mbind, alignedPtr, (unsigned long)alignedSize, mpolPreferred, (unsigned long*)0, 0UL, 0U) == 0;
+#else
+    Q_UNUSED(ptr);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
+
 NATRON_NAMESPACE_EXIT
@@ -61,16 +61,41 @@ QString printAsRAM(U64 bytes);
  * determined on this OS.
  */
 std::size_t getPeakRSS( );
+#endif // 0
 
 /**
  * Returns the current resident set size (physical memory use) measured
  * in bytes, or zero if the value cannot be determined on this OS.
  */
 std::size_t getCurrentRSS( );
-#endif // 0
 
 std::size_t getAmountFreePhysicalRAM();
 
+/**
+ * @brief Hint the OS to back the given range of memory with huge pages to reduce TLB misses.
+ * On Linux, this is honoured by transparent huge pages for anonymous memory and, depending on the
+ * kernel and the file system, for memory mapped files (e.g: on tmpfs).
+ * Only the part of the range aligned on pages is affected.
+ * Returns false if the hint was not accepted or is not supported on this system.
+ **/
+bool adviseHugePages(void* ptr, std::size_t size);
+
+/**
+ * @brief Hint the OS to spread the pages of the given range of memory across all NUMA nodes
+ * the process may allocate from, so that threads running on any socket have the same average
+ * latency to access it. This only affects pages that were not touched yet.
+ * Returns false if the system has a single NUMA node or if this is not supported on this system.
+ **/
+bool adviseNUMAInterleave(void* ptr, std::size_t size);
+
+/**
+ * @brief Hint the OS to allocate each page of the given range of memory on the NUMA node of the thread
+ * that touches it first, even if the process was launched with another memory policy (e.g: with numactl --interleave).
+ * This only affects pages that were not touched yet.
+ * Returns false if this is not supported on this system.
+ **/
+bool adviseNUMALocal(void* ptr, std::size_t size);
+
 NATRON_NAMESPACE_EXIT
 
 #endif // ifndef Engine_MemoryInfo_h
@@ -0,0 +1,521 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "MemoryPressureMonitorThread.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtCore/QAtomicInt>
+
+#if defined(__NATRON_LINUX__)
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#elif defined(__NATRON_OSX__)
+#include <dispatch/dispatch.h>
+#elif defined(__NATRON_WIN32__)
+#include <windows.h>
+#endif
+
+#ifdef DEBUG
+#include "Global/FloatingPointExceptions.h"
+#endif
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/ImageBufferPool.h"
+#include "Engine/MemoryInfo.h"
+
+// Interval between 2 samples of the memory of the system, in milliseconds
+#define NATRON_MEMORY_PRESSURE_MONITOR_PERIOD_MS 1000
+
+// The budget of the tile cache is never shrunk below this
+#define NATRON_MEMORY_PRESSURE_MIN_CACHE_BUDGET (256ULL * 1024 * 1024)
+
+// The RAM left free for the other processes is a fraction of the total RAM, at least this amount
+#define NATRON_MEMORY_PRESSURE_MIN_RESERVED_RAM (512ULL * 1024 * 1024)
+
+// The budget grows back to the user maximum in this number of samples at most
+#define NATRON_MEMORY_PRESSURE_GROWTH_STEPS 8
+
+// Percentage of time in the last 10 seconds during which some (resp. all) tasks were stalled on memory,
+// from /proc/pressure/memory, beyond which the pressure is a warning (resp. critical)
+#define NATRON_MEMORY_PRESSURE_PSI_WARNING 10.
+#define NATRON_MEMORY_PRESSURE_PSI_CRITICAL 5.
+
+// The PSI trigger fires when tasks were stalled for 150ms within 2 seconds. Unprivileged processes may only
+// register triggers with a window multiple of 2 seconds.
+#define NATRON_MEMORY_PRESSURE_PSI_TRIGGER "some 150000 2000000"
+
+NATRON_NAMESPACE_ENTER
+
+struct MemoryPressureMonitorThreadPrivate
+{
+    // Protects the fields below and the maximum size of the tile cache
+    mutable QMutex lock;
+
+    bool enabled;
+    std::size_t userMaximum;
+    std::size_t effectiveBudget;
+
+    QWaitCondition wakeCond;
+    bool mustQuit;
+
+    // The last MemoryPressureLevelEnum, written by the thread or by the notifications of the system
+    QAtomicInt level;
+
+#if defined(__NATRON_LINUX__)
+    // The PSI trigger, -1 if not supported by the kernel
+    int psiTriggerFd;
+
+    // Written to wake up the thread when it waits on the trigger
+    int wakePipe[2];
+#elif defined(__NATRON_OSX__)
+    dispatch_source_t pressureSource;
+    dispatch_semaphore_t pressureSourceCanceled;
+#elif defined(__NATRON_WIN32__)
+    HANDLE lowMemoryNotification;
+#endif
+
+    MemoryPressureMonitorThreadPrivate()
+    : lock()
+    , enabled(true)
+    , userMaximum(0)
+    , effectiveBudget(0)
+    , wakeCond()
+    , mustQuit(false)
+    , level(MemoryPressureMonitorThread::eMemoryPressureLevelNormal)
+#if defined(__NATRON_LINUX__)
+    , psiTriggerFd(-1)
+#elif defined(__NATRON_OSX__)
+    , pressureSource(0)
+    , pressureSourceCanceled(0)
+#elif defined(__NATRON_WIN32__)
+    , lowMemoryNotification(0)
+#endif
+    {
+#if defined(__NATRON_LINUX__)
+        if (pipe(wakePipe) != 0) {
+            wakePipe[0] = wakePipe[1] = -1;
+        }
+#endif
+    }
+
+    ~MemoryPressureMonitorThreadPrivate()
+    {
+#if defined(__NATRON_LINUX__)
+        if (wakePipe[0] >= 0) {
+            close(wakePipe[0]);
+            close(wakePipe[1]);
+        }
+#endif
+    }
+
+    /**
+     * @brief Register to the memory pressure signals of the system, called from the thread
+     **/
+    void openSystemSignals();
+
+    void closeSystemSignals();
+
+    /**
+     * @brief Returns the pressure currently reported by the system
+     **/
+    MemoryPressureMonitorThread::MemoryPressureLevelEnum readSystemLevel();
+
+    /**
+     * @brief Waits for the given time or until the system signals memory pressure or the thread must quit.
+     * Returns true if the system signaled memory pressure.
+     **/
+    bool waitForSignal(int timeoutMs);
+
+    /**
+     * @brief Apply the given budget to the tile cache. The lock must be taken.
+     **/
+    void applyBudget(std::size_t budget);
+
+    /**
+     * @brief Sample the memory of the system and update the budget of the tile cache
+     **/
+    void update(bool signaled);
+};
+
+#if defined(__NATRON_OSX__)
+static void
+onMemoryPressureNotification(void* context)
+{
+    MemoryPressureMonitorThreadPrivate* imp = static_cast<MemoryPressureMonitorThreadPrivate*>(context);
+    unsigned long flags = dispatch_source_get_data(imp->pressureSource);
+    MemoryPressureMonitorThread::MemoryPressureLevelEnum level = MemoryPressureMonitorThread::eMemoryPressureLevelNormal;
+    if (flags & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+        level = MemoryPressureMonitorThread::eMemoryPressureLevelCritical;
+    } else if (flags & DISPATCH_MEMORYPRESSURE_WARN) {
+        level = MemoryPressureMonitorThread::eMemoryPressureLevelWarning;
+    }
+    imp->level.fetchAndStoreOrdered( (int)level );
+
+    // React right away instead of waiting for the next sample
+    QMutexLocker k(&imp->lock);
+    imp->wakeCond.wakeAll();
+}
+
+static void
+onMemoryPressureSourceCanceled(void* context)
+{
+    MemoryPressureMonitorThreadPrivate* imp = static_cast<MemoryPressureMonitorThreadPrivate*>(context);
+    dispatch_semaphore_signal(imp->pressureSourceCanceled);
+}
+#endif // __NATRON_OSX__
+
+void
+MemoryPressureMonitorThreadPrivate::openSystemSignals()
+{
+#if defined(__NATRON_LINUX__)
+    // Available since Linux 4.20 with CONFIG_PSI
+    psiTriggerFd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK);
+    if (psiTriggerFd >= 0) {
+        const char* trigger = NATRON_MEMORY_PRESSURE_PSI_TRIGGER;
+        if ( write( psiTriggerFd, trigger, strlen(trigger) + 1 ) < 0 ) {
+            close(psiTriggerFd);
+            psiTriggerFd = -1;
+        }
+    }
+#elif defined(__NATRON_OSX__)
+    pressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                            DISPATCH_MEMORYPRESSURE_NORMAL | DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                            dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+    if (pressureSource) {
+        pressureSourceCanceled = dispatch_semaphore_create(0);
+        dispatch_set_context(pressureSource, this);
+        dispatch_source_set_event_handler_f(pressureSource, onMemoryPressureNotification);
+        dispatch_source_set_cancel_handler_f(pressureSource, onMemoryPressureSourceCanceled);
+        dispatch_resume(pressureSource);
+    }
+#elif defined(__NATRON_WIN32__)
+    lowMemoryNotification = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+#endif
+} // openSystemSignals
+
+void
+MemoryPressureMonitorThreadPrivate::closeSystemSignals()
+{
+#if defined(__NATRON_LINUX__)
+    if (psiTriggerFd >= 0) {
+        close(psiTriggerFd);
+        psiTriggerFd = -1;
+    }
+#elif defined(__NATRON_OSX__)
+    if (pressureSource) {
+        // Make sure the notification handler is not running anymore before this object may be destroyed
+        dispatch_source_cancel(pressureSource);
+        dispatch_semaphore_wait(pressureSourceCanceled, DISPATCH_TIME_FOREVER);
+        dispatch_release(pressureSource);
+        dispatch_release(pressureSourceCanceled);
+        pressureSource = 0;
+        pressureSourceCanceled = 0;
+    }
+#elif defined(__NATRON_WIN32__)
+    if (lowMemoryNotification) {
+        CloseHandle(lowMemoryNotification);
+        lowMemoryNotification = 0;
+    }
+#endif
+}
+
+MemoryPressureMonitorThread::MemoryPressureLevelEnum
+MemoryPressureMonitorThreadPrivate::readSystemLevel()
+{
+#if defined(__NATRON_LINUX__)
+    FILE* f = fopen("/proc/pressure/memory", "r");
+    if (!f) {
+        return MemoryPressureMonitorThread::eMemoryPressureLevelNormal;
+    }
+    double someAvg10 = 0., fullAvg10 = 0.;
+    char line[256];
+    while ( fgets(line, sizeof(line), f) ) {
+        double avg10;
+        if (sscanf(line, "some avg10=%lf", &avg10) == 1) {
+            someAvg10 = avg10;
+        } else if (sscanf(line, "full avg10=%lf", &avg10) == 1) {
+            fullAvg10 = avg10;
+        }
+    }
+    fclose(f);
+    if (fullAvg10 >= NATRON_MEMORY_PRESSURE_PSI_CRITICAL) {
+        return MemoryPressureMonitorThread::eMemoryPressureLevelCritical;
+    } else if (someAvg10 >= NATRON_MEMORY_PRESSURE_PSI_WARNING) {
+        return MemoryPressureMonitorThread::eMemoryPressureLevelWarning;
+    }
+    return MemoryPressureMonitorThread::eMemoryPressureLevelNormal;
+#elif defined(__NATRON_OSX__)
+    // Updated by onMemoryPressureNotification
+    return (MemoryPressureMonitorThread::MemoryPressureLevelEnum)level.loadAcquire();
+#elif defined(__NATRON_WIN32__)
+    BOOL lowMemory = FALSE;
+    if ( lowMemoryNotification && QueryMemoryResourceNotification(lowMemoryNotification, &lowMemory) && lowMemory ) {
+        // The system signals low memory when it is already close to paging
+        return MemoryPressureMonitorThread::eMemoryPressureLevelCritical;
+    }
+    return MemoryPressureMonitorThread::eMemoryPressureLevelNormal;
+#else
+    return MemoryPressureMonitorThread::eMemoryPressureLevelNormal;
+#endif
+} // readSystemLevel
+
+bool
+MemoryPressureMonitorThreadPrivate::waitForSignal(int timeoutMs)
+{
+#if defined(__NATRON_LINUX__)
+    if (psiTriggerFd >= 0 && wakePipe[0] >= 0) {
+        struct pollfd fds[2];
+        fds[0].fd = psiTriggerFd;
+        fds[0].events = POLLPRI;
+        fds[0].revents = 0;
+        fds[1].fd = wakePipe[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, 2, timeoutMs) <= 0) {
+            return false;
+        }
+        if (fds[1].revents & POLLIN) {
+            char c;
+            if ( read(wakePipe[0], &c, 1) < 0 ) {
+                // The thread is woken up anyway
+            }
+        }
+        if ( fds[0].revents & (POLLERR | POLLHUP | POLLNVAL) ) {
+            // The trigger is not usable anymore, do not spin on it: sample periodically instead
+            close(psiTriggerFd);
+            psiTriggerFd = -1;
+            return false;
+        }
+        return (fds[0].revents & POLLPRI) != 0;
+    }
+#endif
+    QMutexLocker k(&lock);
+    if (!mustQuit) {
+        wakeCond.wait(&lock, timeoutMs);
+    }
+    return false;
+}
+
+void
+MemoryPressureMonitorThreadPrivate::applyBudget(std::size_t budget)
+{
+    effectiveBudget = budget;
+    CacheBasePtr tileCache = appPTR->getTileCache();
+    if (tileCache && tileCache->getMaximumCacheSize() != budget) {
+        // Shrinking the cache evicts the exceeding entries right away
+        tileCache->setMaximumCacheSize(budget);
+    }
+}
+
+void
+MemoryPressureMonitorThreadPrivate::update(bool signaled)
+{
+    CacheBasePtr tileCache = appPTR->getTileCache();
+    if (!tileCache) {
+        return;
+    }
+
+    MemoryPressureMonitorThread::MemoryState state;
+    state.level = readSystemLevel();
+    if ( signaled && (state.level == MemoryPressureMonitorThread::eMemoryPressureLevelNormal) ) {
+        state.level = MemoryPressureMonitorThread::eMemoryPressureLevelWarning;
+    }
+    level.fetchAndStoreOrdered( (int)state.level );
+
+    if (state.level != MemoryPressureMonitorThread::eMemoryPressureLevelNormal) {
+        // The idle buffers are the cheapest memory to give back, before evicting cached tiles
+        ImageBufferPool* pool = appPTR->getImageBufferPool();
+        if (pool) {
+            pool->clear();
+        }
+    }
+
+    state.totalRAM = getSystemTotalRAM();
+    state.freeRAM = getAmountFreePhysicalRAM();
+    state.processRSS = getCurrentRSS();
+    state.cacheSize = tileCache->getCurrentSize();
+
+    QMutexLocker k(&lock);
+    if (!enabled) {
+        return;
+    }
+    std::size_t budget = MemoryPressureMonitorThread::computeCacheBudget(userMaximum, effectiveBudget, state);
+    if (budget != effectiveBudget) {
+        applyBudget(budget);
+    }
+} // update
+
+MemoryPressureMonitorThread::MemoryPressureMonitorThread()
+: QThread()
+, _imp(new MemoryPressureMonitorThreadPrivate())
+{
+    setObjectName( QString::fromUtf8("MemoryPressureMonitor") );
+}
+
+MemoryPressureMonitorThread::~MemoryPressureMonitorThread()
+{
+
+}
+
+void
+MemoryPressureMonitorThread::setUserMaximumCacheSize(std::size_t size)
+{
+    QMutexLocker k(&_imp->lock);
+
+    // If the budget was not reduced, follow the user maximum, otherwise the budget grows back on its own
+    std::size_t budget = size;
+    if (_imp->enabled && _imp->effectiveBudget < _imp->userMaximum) {
+        budget = std::min(_imp->effectiveBudget, size);
+    }
+    _imp->userMaximum = size;
+    _imp->applyBudget(budget);
+}
+
+void
+MemoryPressureMonitorThread::setEnabled(bool enabled)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->enabled = enabled;
+    if (!enabled) {
+        _imp->applyBudget(_imp->userMaximum);
+    }
+}
+
+bool
+MemoryPressureMonitorThread::isEnabled() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->enabled;
+}
+
+std::size_t
+MemoryPressureMonitorThread::getEffectiveCacheSize() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->effectiveBudget;
+}
+
+MemoryPressureMonitorThread::MemoryPressureLevelEnum
+MemoryPressureMonitorThread::getPressureLevel() const
+{
+    return (MemoryPressureLevelEnum)_imp->level.loadAcquire();
+}
+
+std::size_t
+MemoryPressureMonitorThread::computeCacheBudget(std::size_t userMaximum,
+                                                std::size_t currentBudget,
+                                                const MemoryState& state)
+{
+    const std::size_t minBudget = std::min( userMaximum, (std::size_t)NATRON_MEMORY_PRESSURE_MIN_CACHE_BUDGET );
+
+    // Keep a part of the RAM free for the other processes, but not more than a quarter of the RAM on small systems
+    std::size_t reserved = std::max( (std::size_t)(state.totalRAM / 10), (std::size_t)NATRON_MEMORY_PRESSURE_MIN_RESERVED_RAM );
+    reserved = std::min( reserved, (std::size_t)(state.totalRAM / 4) );
+
+    std::size_t budget = std::min(currentBudget, userMaximum);
+
+    // The system is reclaiming memory: give back a part of what the cache holds
+    switch (state.level) {
+        case eMemoryPressureLevelCritical:
+            budget = std::min(budget, state.cacheSize / 2);
+            break;
+        case eMemoryPressureLevelWarning:
+            budget = std::min(budget, state.cacheSize - state.cacheSize / 4);
+            break;
+        case eMemoryPressureLevelNormal:
+            break;
+    }
+
+    if (state.freeRAM < reserved) {
+        // Free the missing RAM from the cache. The process cannot give back more than what it keeps resident.
+        std::size_t deficit = std::min(reserved - state.freeRAM, state.processRSS);
+        budget = std::min(budget, state.cacheSize > deficit ? state.cacheSize - deficit : 0);
+    } else if ( (state.level == eMemoryPressureLevelNormal) && (state.freeRAM > 2 * reserved) && (budget < userMaximum) ) {
+        // Memory is available again: grow back by steps, never using more than the RAM above the reserve,
+        // so that the budget does not oscillate when another process allocates in bursts
+        std::size_t step = std::max( userMaximum / NATRON_MEMORY_PRESSURE_GROWTH_STEPS, (std::size_t)NATRON_MEMORY_PRESSURE_MIN_CACHE_BUDGET );
+        step = std::min(step, state.freeRAM - 2 * reserved);
+        budget = userMaximum - budget > step ? budget + step : userMaximum;
+    }
+
+    return std::max(budget, minBudget);
+} // computeCacheBudget
+
+void
+MemoryPressureMonitorThread::quitThread()
+{
+    if ( !isRunning() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = true;
+        _imp->wakeCond.wakeAll();
+    }
+#if defined(__NATRON_LINUX__)
+    if (_imp->wakePipe[1] >= 0) {
+        char c = 0;
+        if ( write(_imp->wakePipe[1], &c, 1) < 0 ) {
+            // The thread wakes up at the next sample
+        }
+    }
+#endif
+    wait();
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = false;
+    }
+}
+
+void
+MemoryPressureMonitorThread::run()
+{
+#ifdef DEBUG
+    boost_adaptbx::floating_point::exception_trapping trap(boost_adaptbx::floating_point::exception_trapping::division_by_zero |
+                                                           boost_adaptbx::floating_point::exception_trapping::invalid |
+                                                           boost_adaptbx::floating_point::exception_trapping::overflow);
+#endif
+    _imp->openSystemSignals();
+    bool signaled = false;
+    for (;;) {
+        {
+            QMutexLocker k(&_imp->lock);
+            if (_imp->mustQuit) {
+                break;
+            }
+        }
+        _imp->update(signaled);
+        signaled = _imp->waitForSignal(NATRON_MEMORY_PRESSURE_MONITOR_PERIOD_MS);
+    }
+    _imp->closeSystemSignals();
+} // run
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,137 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_MemoryPressureMonitorThread_h
+#define Engine_MemoryPressureMonitorThread_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Adapts the budget of the tile cache to the memory used by the other processes of the system.
+ * The maximum size of the cache in the Preferences is an upper bound: when another application grabs memory,
+ * this thread lowers the effective maximum size of the tile cache (which evicts entries right away) so that the system
+ * never runs out of memory in the middle of a render. The budget grows back progressively to the user maximum once
+ * memory is available again.
+ *
+ * The thread samples the free RAM and the resident memory of the process every second and listens to the memory pressure
+ * signals of the operating system: Pressure Stall Information on Linux, memory pressure notifications on macOS
+ * and low memory resource notifications on Windows.
+ **/
+struct MemoryPressureMonitorThreadPrivate;
+class MemoryPressureMonitorThread
+: public QThread
+{
+
+public:
+
+    enum MemoryPressureLevelEnum
+    {
+        // The system has enough memory
+        eMemoryPressureLevelNormal = 0,
+
+        // The system is reclaiming memory: caches should be shrunk
+        eMemoryPressureLevelWarning,
+
+        // The system is about to run out of memory: caches should be released as much as possible
+        eMemoryPressureLevelCritical
+    };
+
+    /**
+     * @brief A sample of the memory of the system, in bytes
+     **/
+    struct MemoryState
+    {
+        U64 totalRAM;
+        std::size_t freeRAM;
+        std::size_t processRSS;
+
+        // The amount of memory currently used by the tile cache
+        std::size_t cacheSize;
+
+        MemoryPressureLevelEnum level;
+    };
+
+    MemoryPressureMonitorThread();
+
+    virtual ~MemoryPressureMonitorThread();
+
+    /**
+     * @brief Set the maximum size of the tile cache chosen by the user. The effective budget never exceeds it.
+     * This applies the budget to the tile cache right away.
+     **/
+    void setUserMaximumCacheSize(std::size_t size);
+
+    /**
+     * @brief If disabled, the tile cache always uses the user maximum size whatever the memory of the system
+     **/
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const;
+
+    /**
+     * @brief Returns the maximum size currently applied to the tile cache
+     **/
+    std::size_t getEffectiveCacheSize() const;
+
+    /**
+     * @brief Returns the last pressure level reported by the system
+     **/
+    MemoryPressureLevelEnum getPressureLevel() const;
+
+    /**
+     * @brief Returns the budget of the tile cache for the given state of the memory of the system.
+     * The budget shrinks immediately when the system is short in memory and grows back by steps when memory is available.
+     * The result is between a minimum budget and userMaximum.
+     **/
+    static std::size_t computeCacheBudget(std::size_t userMaximum,
+                                          std::size_t currentBudget,
+                                          const MemoryState& state);
+
+    void quitThread();
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    boost::scoped_ptr<MemoryPressureMonitorThreadPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_MemoryPressureMonitorThread_h
@@ -0,0 +1,325 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "MemoryTimelineRecorder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#ifdef DEBUG
+#include "Global/FloatingPointExceptions.h"
+#endif
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/CompressedTileStorage.h"
+#include "Engine/ImageBufferPool.h"
+#include "Engine/ImageStorage.h"
+#include "Engine/MemoryInfo.h"
+#include "Engine/StorageDeleterThread.h"
+#include "Engine/Timer.h"
+
+// When this number of samples is reached, every other sample is dropped and the interval is doubled
+#define NATRON_MEMORY_TIMELINE_MAX_SAMPLES 10000
+
+NATRON_NAMESPACE_ENTER
+
+struct MemoryTimelineRecorderPrivate
+{
+    // Protects all the fields below
+    mutable QMutex lock;
+
+    QWaitCondition wakeCond;
+    bool mustQuit;
+
+    bool recording;
+    int intervalMS;
+
+    // Gives the time of the samples since the recording started
+    TimeLapse clock;
+
+    std::vector<MemoryTimelineRecorder::Sample> samples;
+
+    MemoryTimelineRecorderPrivate()
+    : lock()
+    , wakeCond()
+    , mustQuit(false)
+    , recording(false)
+    , intervalMS(NATRON_MEMORY_TIMELINE_DEFAULT_INTERVAL_MS)
+    , clock()
+    , samples()
+    {
+    }
+
+    void addSample(const MemoryTimelineRecorder::Sample& sample)
+    {
+        // Private, should be locked
+        assert( !lock.tryLock() );
+
+        if (samples.size() >= NATRON_MEMORY_TIMELINE_MAX_SAMPLES) {
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < samples.size(); i += 2) {
+                samples[kept++] = samples[i];
+            }
+            samples.resize(kept);
+            intervalMS *= 2;
+        }
+        samples.push_back(sample);
+    }
+};
+
+MemoryTimelineRecorder::Sample::Sample()
+: time(0)
+, tileCacheBytes(0)
+, compressedTilesBytes(0)
+, generalPurposeCacheBytes(0)
+, imageBufferPoolBytes(0)
+, imagesRAMBytes(0)
+, imagesGLBytes(0)
+, deleterQueueLength(0)
+, processRSS(0)
+, freeRAM(0)
+{
+}
+
+MemoryTimelineRecorder::MemoryTimelineRecorder()
+: QThread()
+, _imp( new MemoryTimelineRecorderPrivate() )
+{
+    setObjectName( QString::fromUtf8("MemoryTimelineRecorder") );
+}
+
+MemoryTimelineRecorder::~MemoryTimelineRecorder()
+{
+    stopRecording();
+}
+
+void
+MemoryTimelineRecorder::startRecording(int intervalMS)
+{
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->samples.clear();
+        _imp->intervalMS = std::max(intervalMS, 1);
+        _imp->clock = TimeLapse();
+        _imp->recording = true;
+        _imp->wakeCond.wakeAll();
+    }
+    if ( !isRunning() ) {
+        start();
+    }
+}
+
+void
+MemoryTimelineRecorder::stopRecording()
+{
+    if ( !isRunning() ) {
+        QMutexLocker k(&_imp->lock);
+        _imp->recording = false;
+
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->recording = false;
+        _imp->mustQuit = true;
+        _imp->wakeCond.wakeAll();
+    }
+    wait();
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = false;
+    }
+}
+
+bool
+MemoryTimelineRecorder::isRecording() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->recording;
+}
+
+int
+MemoryTimelineRecorder::getIntervalMS() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->intervalMS;
+}
+
+void
+MemoryTimelineRecorder::getSamples(std::vector<Sample>* samples) const
+{
+    QMutexLocker k(&_imp->lock);
+    *samples = _imp->samples;
+}
+
+MemoryTimelineRecorder::Sample
+MemoryTimelineRecorder::takeSample()
+{
+    Sample sample;
+    CacheBasePtr tileCache = appPTR->getTileCache();
+    if (tileCache) {
+        sample.tileCacheBytes = tileCache->getCurrentSize();
+    }
+    CompressedTileStorage* compressedTiles = appPTR->getCompressedTileStorage();
+    if (compressedTiles) {
+        sample.compressedTilesBytes = compressedTiles->getCurrentSize();
+    }
+    CacheBasePtr generalPurposeCache = appPTR->getGeneralPurposeCache();
+    if (generalPurposeCache) {
+        sample.generalPurposeCacheBytes = generalPurposeCache->getCurrentSize();
+    }
+    ImageBufferPool* pool = appPTR->getImageBufferPool();
+    if (pool) {
+        sample.imageBufferPoolBytes = pool->getCurrentSize();
+    }
+    const MemoryBudget& imagesBudget = ImageStorageBase::getProcessMemoryBudget();
+    sample.imagesRAMBytes = imagesBudget.getAllocatedBytes(eStorageModeRAM);
+    sample.imagesGLBytes = imagesBudget.getAllocatedBytes(eStorageModeGLTex);
+    StorageDeleterThread* deleter = appPTR->getStorageDeleterThread();
+    if (deleter) {
+        sample.deleterQueueLength = deleter->getQueueSize();
+    }
+    sample.processRSS = getCurrentRSS();
+    sample.freeRAM = getAmountFreePhysicalRAM();
+
+    return sample;
+}
+
+bool
+MemoryTimelineRecorder::writeToFile(const std::string& filePath) const
+{
+    std::vector<Sample> samples;
+    getSamples(&samples);
+
+    std::ofstream ofile( filePath.c_str() );
+    if (!ofile) {
+        return false;
+    }
+    const std::string jsonExt(".json");
+    bool isJSON = filePath.size() >= jsonExt.size() && filePath.compare(filePath.size() - jsonExt.size(), jsonExt.size(), jsonExt) == 0;
+    ofile << (isJSON ? toJSON(samples) : toCSV(samples));
+
+    return bool(ofile);
+}
+
+std::string
+MemoryTimelineRecorder::toCSV(const std::vector<Sample>& samples)
+{
+    std::stringstream ss;
+    ss << "time,tile_cache_bytes,compressed_tiles_bytes,general_purpose_cache_bytes,image_buffer_pool_bytes,"
+       << "images_ram_bytes,images_gl_bytes,deleter_queue_length,process_rss_bytes,free_ram_bytes\n";
+    ss << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const Sample& s = samples[i];
+        ss << s.time << ','
+           << s.tileCacheBytes << ','
+           << s.compressedTilesBytes << ','
+           << s.generalPurposeCacheBytes << ','
+           << s.imageBufferPoolBytes << ','
+           << s.imagesRAMBytes << ','
+           << s.imagesGLBytes << ','
+           << s.deleterQueueLength << ','
+           << s.processRSS << ','
+           << s.freeRAM << '\n';
+    }
+
+    return ss.str();
+}
+
+std::string
+MemoryTimelineRecorder::toJSON(const std::vector<Sample>& samples)
+{
+    // One sample per line so that the file can be read incrementally
+    std::stringstream ss;
+    ss << "{\"samples\": [\n";
+    ss << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const Sample& s = samples[i];
+        ss << "{\"time\": " << s.time
+           << ", \"tile_cache_bytes\": " << s.tileCacheBytes
+           << ", \"compressed_tiles_bytes\": " << s.compressedTilesBytes
+           << ", \"general_purpose_cache_bytes\": " << s.generalPurposeCacheBytes
+           << ", \"image_buffer_pool_bytes\": " << s.imageBufferPoolBytes
+           << ", \"images_ram_bytes\": " << s.imagesRAMBytes
+           << ", \"images_gl_bytes\": " << s.imagesGLBytes
+           << ", \"deleter_queue_length\": " << s.deleterQueueLength
+           << ", \"process_rss_bytes\": " << s.processRSS
+           << ", \"free_ram_bytes\": " << s.freeRAM << '}';
+        if (i + 1 < samples.size()) {
+            ss << ',';
+        }
+        ss << '\n';
+    }
+    ss << "]}\n";
+
+    return ss.str();
+}
+
+void
+MemoryTimelineRecorder::run()
+{
+#ifdef DEBUG
+    boost_adaptbx::floating_point::exception_trapping trap(boost_adaptbx::floating_point::exception_trapping::division_by_zero |
+                                                           boost_adaptbx::floating_point::exception_trapping::invalid |
+                                                           boost_adaptbx::floating_point::exception_trapping::overflow);
+#endif
+    for (;;) {
+        bool recording;
+        {
+            QMutexLocker k(&_imp->lock);
+            if (_imp->mustQuit) {
+                break;
+            }
+            recording = _imp->recording;
+        }
+        if (recording) {
+            // Do not hold the lock while sampling, the caches take their own locks
+            Sample sample = takeSample();
+            QMutexLocker k(&_imp->lock);
+            if (_imp->recording) {
+                sample.time = _imp->clock.getTimeSinceCreation();
+                _imp->addSample(sample);
+            }
+        }
+        QMutexLocker k(&_imp->lock);
+        if (!_imp->mustQuit) {
+            if (_imp->recording) {
+                _imp->wakeCond.wait(&_imp->lock, _imp->intervalMS);
+            } else {
+                _imp->wakeCond.wait(&_imp->lock);
+            }
+        }
+    }
+} // run
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,138 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_MemoryTimelineRecorder_h
+#define Engine_MemoryTimelineRecorder_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+// The default interval between two samples
+#define NATRON_MEMORY_TIMELINE_DEFAULT_INTERVAL_MS 1000
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Samples the memory of the process at a regular interval while recording, so that the growth of the memory
+ * during a long render can be attributed to a cache or to a leak: the memory of the process that is not in the caches
+ * nor in the images allocated by the renders.
+ *
+ * The recording is started from the RenderStatsDialog, which graphs it, or with the --memory-timeline command-line option,
+ * which writes it when the application exits. To bound the memory of a long recording, when the maximum number of samples
+ * is reached every other sample is dropped and the interval is doubled.
+ **/
+struct MemoryTimelineRecorderPrivate;
+class MemoryTimelineRecorder
+: public QThread
+{
+public:
+
+    /**
+     * @brief A sample of the memory, in bytes
+     **/
+    struct Sample
+    {
+        // In seconds since the recording started
+        double time;
+
+        // The size of the caches
+        std::size_t tileCacheBytes;
+        std::size_t compressedTilesBytes;
+        std::size_t generalPurposeCacheBytes;
+        std::size_t imageBufferPoolBytes;
+
+        // The images allocated by the renders, @see ImageStorageBase::getProcessMemoryBudget()
+        std::size_t imagesRAMBytes;
+        std::size_t imagesGLBytes;
+
+        // The number of images waiting to be freed by the StorageDeleterThread
+        std::size_t deleterQueueLength;
+
+        std::size_t processRSS;
+        std::size_t freeRAM;
+
+        Sample();
+    };
+
+    MemoryTimelineRecorder();
+
+    virtual ~MemoryTimelineRecorder();
+
+    /**
+     * @brief Clears the samples and starts sampling every intervalMS milliseconds
+     **/
+    void startRecording(int intervalMS = NATRON_MEMORY_TIMELINE_DEFAULT_INTERVAL_MS);
+
+    /**
+     * @brief Stops sampling. The samples are kept until the next call to startRecording().
+     **/
+    void stopRecording();
+
+    bool isRecording() const;
+
+    /**
+     * @brief Returns the current interval between two samples, which grows when samples are dropped
+     **/
+    int getIntervalMS() const;
+
+    void getSamples(std::vector<Sample>* samples) const;
+
+    /**
+     * @brief Returns the memory as of now, time is 0
+     **/
+    static Sample takeSample();
+
+    /**
+     * @brief Writes the samples to a JSON file if the file path ends with .json, otherwise to a CSV file
+     **/
+    bool writeToFile(const std::string& filePath) const;
+
+    static std::string toCSV(const std::vector<Sample>& samples);
+
+    static std::string toJSON(const std::vector<Sample>& samples);
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    boost::scoped_ptr<MemoryTimelineRecorderPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_MemoryTimelineRecorder_h
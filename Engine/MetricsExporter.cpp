@@ -0,0 +1,415 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "MetricsExporter.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+#include <QtNetwork/QHostAddress>
+
+#include "qhttpserver.h"
+#include "qhttprequest.h"
+#include "qhttpresponse.h"
+
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/CacheStats.h"
+#include "Engine/GPUContextPool.h"
+#include "Engine/MemoryInfo.h"
+#include "Engine/Node.h"
+#include "Engine/RenderStats.h"
+
+// How often the metrics file is written
+#define NATRON_METRICS_FILE_INTERVAL_MS 10000
+
+NATRON_NAMESPACE_ENTER
+
+// Upper bounds in seconds of the buckets of the frame render time histogram
+static const double frameTimeBuckets[] = {
+    0.05, 0.1, 0.25, 0.5, 1., 2.5, 5., 10., 30., 60., 120., 300., 600.
+};
+static const int nFrameTimeBuckets = sizeof(frameTimeBuckets) / sizeof(frameTimeBuckets[0]);
+
+struct FrameTimeHistogram
+{
+    // Number of frames in each bucket, not cumulative. The last one is +Inf
+    std::vector<U64> buckets;
+    U64 count;
+    double sum;
+
+    FrameTimeHistogram()
+        : buckets(nFrameTimeBuckets + 1, 0)
+        , count(0)
+        , sum(0.)
+    {
+    }
+
+    void add(double timeSpent)
+    {
+        int i = 0;
+        while ( (i < nFrameTimeBuckets) && (timeSpent > frameTimeBuckets[i]) ) {
+            ++i;
+        }
+        ++buckets[i];
+        ++count;
+        sum += timeSpent;
+    }
+};
+
+struct WriterMetrics
+{
+    U64 framesRendered;
+    FrameTimeHistogram frameTimes;
+
+    WriterMetrics()
+        : framesRendered(0)
+        , frameTimes()
+    {
+    }
+};
+
+struct NodeMetrics
+{
+    std::string pluginID;
+    double timeSpentRendering;
+
+    NodeMetrics()
+        : pluginID()
+        , timeSpentRendering(0.)
+    {
+    }
+};
+
+struct MetricsExporterPrivate
+{
+    QHttpServer* server;
+    QTimer* fileTimer;
+    QString filename;
+
+    // Protects writers, nodes
+    mutable QMutex lock;
+
+    // Indexed by the script-name of the Write node
+    std::map<std::string, WriterMetrics> writers;
+
+    // Indexed by the fully qualified name of the node
+    std::map<std::string, NodeMetrics> nodes;
+
+    MetricsExporterPrivate()
+        : server(0)
+        , fileTimer(0)
+        , filename()
+        , lock()
+        , writers()
+        , nodes()
+    {
+    }
+};
+
+static QString
+escapeLabelValue(const std::string& value)
+{
+    QString ret = QString::fromUtf8( value.c_str() );
+
+    ret.replace( QLatin1Char('\\'), QLatin1String("\\\\") );
+    ret.replace( QLatin1Char('"'), QLatin1String("\\\"") );
+    ret.replace( QLatin1Char('\n'), QLatin1String("\\n") );
+
+    return ret;
+}
+
+static QString
+formatValue(double value)
+{
+    return QString::number(value, 'g', 15);
+}
+
+static QString
+formatValue(U64 value)
+{
+    return QString::number(value);
+}
+
+static void
+appendMetricHeader(const char* name,
+                   const char* type,
+                   const char* help,
+                   QString* report)
+{
+    *report += QString::fromUtf8("# HELP %1 %2\n# TYPE %1 %3\n").arg( QString::fromUtf8(name) ).arg( QString::fromUtf8(help) ).arg( QString::fromUtf8(type) );
+}
+
+static void
+appendSample(const char* name,
+             const QString& labels,
+             const QString& value,
+             QString* report)
+{
+    *report += QString::fromUtf8(name);
+    if ( !labels.isEmpty() ) {
+        *report += QLatin1Char('{') + labels + QLatin1Char('}');
+    }
+    *report += QLatin1Char(' ') + value + QLatin1Char('\n');
+}
+
+MetricsExporter::MetricsExporter()
+    : QObject()
+    , _imp( new MetricsExporterPrivate() )
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+bool
+MetricsExporter::start(int port,
+                       const QString& filename)
+{
+    if (port != -1) {
+        assert(!_imp->server);
+        _imp->server = new QHttpServer(this);
+        QObject::connect( _imp->server, SIGNAL(newRequest(QHttpRequest*,QHttpResponse*)), this, SLOT(onNewRequest(QHttpRequest*,QHttpResponse*)) );
+
+        // The metrics are read-only and scraped by a remote Prometheus server: listen on all the interfaces
+        if ( !_imp->server->listen(QHostAddress::Any, port) ) {
+            std::cerr << tr("Metrics: cannot listen on port %1.").arg(port).toStdString() << std::endl;
+
+            return false;
+        }
+    }
+
+    if ( !filename.isEmpty() ) {
+        _imp->filename = filename;
+        _imp->fileTimer = new QTimer(this);
+        _imp->fileTimer->setInterval(NATRON_METRICS_FILE_INTERVAL_MS);
+        QObject::connect( _imp->fileTimer, SIGNAL(timeout()), this, SLOT(writeFile()) );
+        _imp->fileTimer->start();
+        writeFile();
+    }
+
+    return true;
+}
+
+void
+MetricsExporter::stop()
+{
+    if (_imp->server) {
+        _imp->server->close();
+    }
+    if (_imp->fileTimer) {
+        _imp->fileTimer->stop();
+        writeFile();
+        _imp->filename.clear();
+    }
+}
+
+void
+MetricsExporter::addFrameRendered(const std::string& writerName,
+                                  const RenderStatsPtr& stats)
+{
+    double timeSpent = 0.;
+    std::map<NodePtr, NodeRenderStats> nodeStats;
+
+    if (stats) {
+        nodeStats = stats->getStats(&timeSpent);
+    }
+
+    QMutexLocker k(&_imp->lock);
+    WriterMetrics& writer = _imp->writers[writerName];
+    ++writer.framesRendered;
+    if (stats) {
+        writer.frameTimes.add(timeSpent);
+    }
+
+    // Only filled when the render stats are enabled
+    for (std::map<NodePtr, NodeRenderStats>::const_iterator it = nodeStats.begin(); it != nodeStats.end(); ++it) {
+        NodeMetrics& node = _imp->nodes[it->first->getFullyQualifiedName()];
+        if ( node.pluginID.empty() ) {
+            node.pluginID = it->first->getPluginID();
+        }
+        node.timeSpentRendering += it->second.getTotalTimeSpentRendering();
+    }
+}
+
+QString
+MetricsExporter::makeReport() const
+{
+    QString report;
+
+    appendMetricHeader("natron_info", "gauge", "Version of the application.", &report);
+    appendSample( "natron_info", QString::fromUtf8("version=\"%1\"").arg( QString::fromUtf8(NATRON_VERSION_STRING) ), QString::fromUtf8("1"), &report );
+
+    {
+        QMutexLocker k(&_imp->lock);
+
+        appendMetricHeader("natron_frames_rendered_total", "counter", "Frames written by each Write node.", &report);
+        for (std::map<std::string, WriterMetrics>::const_iterator it = _imp->writers.begin(); it != _imp->writers.end(); ++it) {
+            appendSample( "natron_frames_rendered_total", QString::fromUtf8("writer=\"%1\"").arg( escapeLabelValue(it->first) ), formatValue(it->second.framesRendered), &report );
+        }
+
+        appendMetricHeader("natron_frame_render_seconds", "histogram", "Time spent to render each frame written by a Write node.", &report);
+        for (std::map<std::string, WriterMetrics>::const_iterator it = _imp->writers.begin(); it != _imp->writers.end(); ++it) {
+            const QString writerLabel = QString::fromUtf8("writer=\"%1\"").arg( escapeLabelValue(it->first) );
+            const FrameTimeHistogram& histogram = it->second.frameTimes;
+            U64 cumulativeCount = 0;
+            for (int i = 0; i <= nFrameTimeBuckets; ++i) {
+                cumulativeCount += histogram.buckets[i];
+                const QString bound = (i < nFrameTimeBuckets) ? formatValue(frameTimeBuckets[i]) : QString::fromUtf8("+Inf");
+                appendSample( "natron_frame_render_seconds_bucket", writerLabel + QString::fromUtf8(",le=\"%1\"").arg(bound), formatValue(cumulativeCount), &report );
+            }
+            appendSample("natron_frame_render_seconds_sum", writerLabel, formatValue(histogram.sum), &report);
+            appendSample("natron_frame_render_seconds_count", writerLabel, formatValue(histogram.count), &report);
+        }
+
+        appendMetricHeader("natron_node_render_seconds_total", "counter", "Time spent rendering by each node, only for the renders with render statistics enabled.", &report);
+        for (std::map<std::string, NodeMetrics>::const_iterator it = _imp->nodes.begin(); it != _imp->nodes.end(); ++it) {
+            appendSample( "natron_node_render_seconds_total",
+                          QString::fromUtf8("node=\"%1\",plugin=\"%2\"").arg( escapeLabelValue(it->first) ).arg( escapeLabelValue(it->second.pluginID) ),
+                          formatValue(it->second.timeSpentRendering),
+                          &report );
+        }
+    }
+
+    {
+        CacheBasePtr caches[2] = { appPTR->getTileCache(), appPTR->getGeneralPurposeCache() };
+        const char* cacheNames[2] = { "tiles", "generalPurpose" };
+
+        appendMetricHeader("natron_cache_size_bytes", "gauge", "Memory used by each cache.", &report);
+        for (int i = 0; i < 2; ++i) {
+            if (caches[i]) {
+                appendSample( "natron_cache_size_bytes", QString::fromUtf8("cache=\"%1\"").arg( QString::fromUtf8(cacheNames[i]) ), formatValue( (U64)caches[i]->getCurrentSize() ), &report );
+            }
+        }
+        appendMetricHeader("natron_cache_max_size_bytes", "gauge", "Maximum size of each cache.", &report);
+        for (int i = 0; i < 2; ++i) {
+            if (caches[i]) {
+                appendSample( "natron_cache_max_size_bytes", QString::fromUtf8("cache=\"%1\"").arg( QString::fromUtf8(cacheNames[i]) ), formatValue( (U64)caches[i]->getMaximumCacheSize() ), &report );
+            }
+        }
+    }
+
+    CacheStats* cacheStats = appPTR->getCacheStats();
+    if (cacheStats) {
+        CacheNodeCounters counters;
+        cacheStats->getTotalCounters(&counters);
+
+        appendMetricHeader("natron_cache_lookups_total", "counter", "Lookups in each cache tier.", &report);
+        for (int i = 0; i < eCacheTierCount; ++i) {
+            appendSample( "natron_cache_lookups_total", QString::fromUtf8("tier=\"%1\"").arg( escapeLabelValue( CacheStats::getTierName( (CacheTierEnum)i ) ) ), formatValue(counters.tiers[i].nLookups), &report );
+        }
+        appendMetricHeader("natron_cache_hits_total", "counter", "Lookups which found the entry in each cache tier.", &report);
+        for (int i = 0; i < eCacheTierCount; ++i) {
+            appendSample( "natron_cache_hits_total", QString::fromUtf8("tier=\"%1\"").arg( escapeLabelValue( CacheStats::getTierName( (CacheTierEnum)i ) ) ), formatValue(counters.tiers[i].nHits), &report );
+        }
+        appendMetricHeader("natron_cache_hit_ratio", "gauge", "Ratio of the lookups which found the entry in each cache tier since the start.", &report);
+        for (int i = 0; i < eCacheTierCount; ++i) {
+            const CacheTierCounters& tier = counters.tiers[i];
+            appendSample( "natron_cache_hit_ratio", QString::fromUtf8("tier=\"%1\"").arg( escapeLabelValue( CacheStats::getTierName( (CacheTierEnum)i ) ) ), formatValue(tier.nLookups ? (double)tier.nHits / tier.nLookups : 0.), &report );
+        }
+        appendMetricHeader("natron_cache_evictions_total", "counter", "Entries evicted from each cache tier because it was full.", &report);
+        for (int i = 0; i < eCacheTierCount; ++i) {
+            appendSample( "natron_cache_evictions_total", QString::fromUtf8("tier=\"%1\"").arg( escapeLabelValue( CacheStats::getTierName( (CacheTierEnum)i ) ) ), formatValue(counters.tiers[i].nEvictions), &report );
+        }
+    }
+
+    {
+        QThreadPool* pool = QThreadPool::globalInstance();
+        appendMetricHeader("natron_thread_pool_active_threads", "gauge", "Threads of the render thread pool currently running a task.", &report);
+        appendSample( "natron_thread_pool_active_threads", QString(), formatValue( (U64)pool->activeThreadCount() ), &report );
+        appendMetricHeader("natron_thread_pool_max_threads", "gauge", "Maximum number of threads of the render thread pool.", &report);
+        appendSample( "natron_thread_pool_max_threads", QString(), formatValue( (U64)pool->maxThreadCount() ), &report );
+    }
+
+    appendMetricHeader("natron_process_resident_memory_bytes", "gauge", "Resident set size of the process.", &report);
+    appendSample( "natron_process_resident_memory_bytes", QString(), formatValue( (U64)getCurrentRSS() ), &report );
+    appendMetricHeader("natron_process_peak_resident_memory_bytes", "gauge", "Highest resident set size of the process since it started.", &report);
+    appendSample( "natron_process_peak_resident_memory_bytes", QString(), formatValue( (U64)getPeakRSS() ), &report );
+
+    GPUContextPool* gpuPool = appPTR->getGPUContextPool();
+    if (gpuPool) {
+        appendMetricHeader("natron_gpu_memory_allocated_bytes", "gauge", "Video memory allocated by the renders in the OpenGL contexts.", &report);
+        appendSample( "natron_gpu_memory_allocated_bytes", QString(), formatValue( (U64)gpuPool->getVideoMemoryAllocated() ), &report );
+    }
+
+    return report;
+} // makeReport
+
+void
+MetricsExporter::onNewRequest(QHttpRequest* request,
+                              QHttpResponse* response)
+{
+    QByteArray body;
+    int statusCode;
+
+    if ( ( request->method() == QHttpRequest::HTTP_GET ) && ( request->path() == QString::fromUtf8("/metrics") ) ) {
+        body = makeReport().toUtf8();
+        statusCode = 200;
+        response->setHeader( QString::fromUtf8("Content-Type"), QString::fromUtf8("text/plain; version=0.0.4; charset=utf-8") );
+    } else {
+        body = tr("Use GET /metrics.").toUtf8() + '\n';
+        statusCode = 404;
+        response->setHeader( QString::fromUtf8("Content-Type"), QString::fromUtf8("text/plain; charset=utf-8") );
+    }
+    response->setHeader( QString::fromUtf8("Content-Length"), QString::number( body.size() ) );
+    response->writeHead(statusCode);
+    response->end(body);
+}
+
+void
+MetricsExporter::writeFile()
+{
+    if ( _imp->filename.isEmpty() ) {
+        return;
+    }
+
+    // Write to a temporary file first so that the file is never read half written
+    const QString tmpFilename = _imp->filename + QString::fromUtf8(".tmp");
+    {
+        QFile file(tmpFilename);
+        if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            std::cerr << tr("Metrics: cannot write %1.").arg(tmpFilename).toStdString() << std::endl;
+
+            return;
+        }
+        file.write( makeReport().toUtf8() );
+    }
+    QFile::remove(_imp->filename);
+    if ( !QFile::rename(tmpFilename, _imp->filename) ) {
+        std::cerr << tr("Metrics: cannot write %1.").arg(_imp->filename).toStdString() << std::endl;
+    }
+}
+
+NATRON_NAMESPACE_EXIT
+
+NATRON_NAMESPACE_USING
+#include "moc_MetricsExporter.cpp"
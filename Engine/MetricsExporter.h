@@ -0,0 +1,105 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_MetricsExporter_h
+#define Engine_MetricsExporter_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#include <QtCore/QObject>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+class QHttpRequest;
+class QHttpResponse;
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Exports render metrics in the Prometheus text format, so that render farms can monitor the performance
+ * of all their machines. It is enabled with --metrics-port <port>, which serves the metrics on /metrics, and/or
+ * --metrics-file <path>, which writes them to a file every few seconds and on exit, e.g for the textfile collector
+ * of the node exporter. This works with both Natron and NatronRenderer.
+ *
+ * The renders of the Write nodes report each frame with addFrameRendered(). The other metrics (cache, threads,
+ * memory) are sampled when the report is made.
+ **/
+struct MetricsExporterPrivate;
+class MetricsExporter
+    : public QObject
+{
+    GCC_DIAG_SUGGEST_OVERRIDE_OFF
+    Q_OBJECT
+    GCC_DIAG_SUGGEST_OVERRIDE_ON
+
+public:
+
+    MetricsExporter();
+
+    virtual ~MetricsExporter();
+
+    /**
+     * @brief Serve the metrics on the given port if it is not -1, and write them to the given file if it is not empty.
+     * Returns false if the port cannot be bound.
+     **/
+    bool start(int port, const QString& filename);
+
+    /**
+     * @brief Stop serving the metrics and write the file a last time.
+     **/
+    void stop();
+
+    /**
+     * @brief Called by the render of a Write node once a frame is written. The stats may be NULL if the output
+     * node does not record them. If the render stats were enabled, the time spent by each node is accounted.
+     * This is thread-safe.
+     **/
+    void addFrameRendered(const std::string& writerName, const RenderStatsPtr& stats);
+
+    /**
+     * @brief Returns the metrics in the Prometheus text format.
+     **/
+    QString makeReport() const;
+
+public Q_SLOTS:
+
+    void onNewRequest(QHttpRequest* request, QHttpResponse* response);
+
+    void writeFile();
+
+private:
+
+    boost::scoped_ptr<MetricsExporterPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_MetricsExporter_h
@@ -25,8 +25,10 @@
 
 #include "MultiThread.h"
 
+#include <algorithm>
 #include <map>
 #include <list>
+#include <typeinfo>
 
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
@@ -54,6 +56,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/EffectInstance.h"
 #include "Engine/Node.h"
 #include "Engine/Settings.h"
+#include "Engine/Timer.h"
 #include "Engine/TLSHolder.h"
 #include "Engine/TreeRenderQueueManager.h"
 #include "Engine/EffectInstanceTLSData.h"
@@ -61,6 +64,16 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #define NATRON_USE_MULTITHREAD_V2
 
+// The time in seconds that a thread should spend processing one chunk of an ImageMultiThreadProcessorBase:
+// long enough for the atomic counter to be negligible, short enough to balance the threads
+#define NATRON_MULTITHREAD_CHUNK_SECONDS 0.001
+
+// The number of pixels of a chunk when the processor never ran
+#define NATRON_MULTITHREAD_CHUNK_DEFAULT_PIXELS 65536
+
+// Split in at least this many chunks per thread so that the threads can balance
+#define NATRON_MULTITHREAD_MIN_CHUNKS_PER_THREAD 4
+
 NATRON_NAMESPACE_ENTER
 
 struct MultiThreadThreadData
@@ -78,9 +91,15 @@ struct MultiThreadPrivate
     PerThreadMultiThreadDataMap threadsData;
     mutable QReadWriteLock threadsDataMutex;
 
+    // For each kind of ImageMultiThreadProcessorBase, the moving average of the time spent per pixel
+    mutable QMutex processorCostsMutex;
+    std::map<std::string, double> processorCostPerPixel;
+
     MultiThreadPrivate()
     : threadsData()
     , threadsDataMutex()
+    , processorCostsMutex()
+    , processorCostPerPixel()
     {
     }
 
@@ -673,6 +692,36 @@ MultiThread::isCurrentThreadSpawnedThread()
     return stat == eActionStatusOK;
 }
 
+double
+MultiThread::getProcessorCostPerPixel(const std::string& processorName)
+{
+    MultiThreadPrivate* imp = appPTR->getMultiThreadHandler()->_imp.get();
+    QMutexLocker k(&imp->processorCostsMutex);
+    std::map<std::string, double>::const_iterator found = imp->processorCostPerPixel.find(processorName);
+    if ( found == imp->processorCostPerPixel.end() ) {
+        return 0.;
+    }
+    return found->second;
+}
+
+void
+MultiThread::addProcessorCost(const std::string& processorName, double timeSpent, double nPixels)
+{
+    if (nPixels <= 0) {
+        return;
+    }
+    double costPerPixel = timeSpent / nPixels;
+    MultiThreadPrivate* imp = appPTR->getMultiThreadHandler()->_imp.get();
+    QMutexLocker k(&imp->processorCostsMutex);
+    std::map<std::string, double>::iterator found = imp->processorCostPerPixel.find(processorName);
+    if ( found == imp->processorCostPerPixel.end() ) {
+        imp->processorCostPerPixel.insert( std::make_pair(processorName, costPerPixel) );
+    } else {
+        // Same weighting as Node::addRenderCost: favor recent calls
+        found->second = 0.75 * found->second + 0.25 * costPerPixel;
+    }
+}
+
 MultiThreadProcessorBase::MultiThreadProcessorBase(const EffectInstancePtr& effect)
 :  _effect(effect)
 {
@@ -752,6 +801,14 @@ MultiThreadProcessorBase::launchThreadsNonBlocking(unsigned int nCPUs)
 
 ImageMultiThreadProcessorBase::ImageMultiThreadProcessorBase(const EffectInstancePtr& effect)
 : MultiThreadProcessorBase(effect)
+, _renderWindow()
+, _chunkRows(0)
+, _firstChunkY(0)
+, _nChunks(0)
+, _nextChunk()
+, _chunksTimeMutex()
+, _chunksProcessingTime(0.)
+, _dynamicSchedulingEnabled(true)
 {
 
 }
@@ -767,6 +824,12 @@ ImageMultiThreadProcessorBase::setRenderWindow(const RectI& renderWindow)
     _renderWindow = renderWindow;
 }
 
+void
+ImageMultiThreadProcessorBase::setDynamicSchedulingEnabled(bool enabled)
+{
+    _dynamicSchedulingEnabled = enabled;
+}
+
 
 void
 ImageMultiThreadProcessorBase::getThreadRange(unsigned int threadID, unsigned int nThreads, int ibegin, int iend, int* ibegin_range, int* iend_range)
@@ -793,6 +856,39 @@ ActionRetCodeEnum
 ImageMultiThreadProcessorBase::multiThreadFunction(unsigned int threadID,
                                                    unsigned int nThreads)
 {
+    if (_nChunks > 0) {
+        // Pull chunks of full scan-lines until there are none left
+        TimeLapse timer;
+        ActionRetCodeEnum stat = eActionStatusOK;
+        for (;;) {
+            // Check for abortion between chunks so that an aborted render stops processing shortly
+            if ( _effect && _effect->isRenderAborted() ) {
+                stat = eActionStatusAborted;
+                break;
+            }
+            int chunk = _nextChunk.fetchAndAddRelaxed(1);
+            if (chunk >= _nChunks) {
+                break;
+            }
+            RectI win = _renderWindow;
+            win.y1 = std::max(_renderWindow.y1, _firstChunkY + chunk * _chunkRows);
+            win.y2 = std::min(_renderWindow.y2, _firstChunkY + (chunk + 1) * _chunkRows);
+            stat = multiThreadProcessImages(win);
+            if (isFailureRetCode(stat)) {
+                break;
+            }
+        }
+        double timeSpent = timer.getTimeSinceCreation();
+        QMutexLocker k(&_chunksTimeMutex);
+        _chunksProcessingTime += timeSpent;
+
+        return stat;
+    }
+
+    if ( _effect && _effect->isRenderAborted() ) {
+        return eActionStatusAborted;
+    }
+
     // Each threads get a rectangular portion but full scan-lines
     RectI win = _renderWindow;
     getThreadRange(threadID, nThreads, _renderWindow.y1, _renderWindow.y2, &win.y1, &win.y2);
@@ -808,6 +904,9 @@ ImageMultiThreadProcessorBase::multiThreadFunction(unsigned int threadID,
 ActionRetCodeEnum
 ImageMultiThreadProcessorBase::process()
 {
+    if ( _effect && _effect->isRenderAborted() ) {
+        return eActionStatusAborted;
+    }
 
     // make sure there are at least 4096 pixels per CPU and at least 1 line par CPU
     unsigned int nCPUs = ( std::min(_renderWindow.x2 - _renderWindow.x1, 4096) *
@@ -818,8 +917,40 @@ ImageMultiThreadProcessorBase::process()
     nCPUs = std::max(1u, std::min( nCPUs, MultiThread::getNCPUsAvailable(_effect))) ;
 #endif
 
-    // call the base multi threading code
-    return launchThreadsBlocking(nCPUs);
+    _nChunks = 0;
+    const int width = _renderWindow.width();
+    const int height = _renderWindow.height();
+    if ( !_dynamicSchedulingEnabled || (nCPUs <= 1) || (width <= 0) || (height <= 1) ) {
+        return launchThreadsBlocking(nCPUs);
+    }
+
+    // Size the chunks so that each takes about NATRON_MULTITHREAD_CHUNK_SECONDS, from the previous calls of the same processor
+    const std::string processorName = typeid(*this).name();
+    const double costPerPixel = MultiThread::getProcessorCostPerPixel(processorName);
+    double chunkPixels = costPerPixel > 0. ? NATRON_MULTITHREAD_CHUNK_SECONDS / costPerPixel : NATRON_MULTITHREAD_CHUNK_DEFAULT_PIXELS;
+    int maxThreads = (int)std::min( nCPUs, (unsigned int)std::max(1, appPTR->getMaxThreadCount()) );
+    int maxChunkRows = std::max(1, height / (maxThreads * NATRON_MULTITHREAD_MIN_CHUNKS_PER_THREAD) );
+    int chunkRows = (int)std::max(1., std::min( (double)maxChunkRows, chunkPixels / width ) );
+
+    // Round down to a power of two and align the chunks on it, so that they do not straddle the tiles of the cache
+    int alignedRows = 1;
+    while (alignedRows * 2 <= chunkRows) {
+        alignedRows *= 2;
+    }
+    _chunkRows = alignedRows;
+    _firstChunkY = _renderWindow.y1 >= 0 ? (_renderWindow.y1 / _chunkRows) * _chunkRows : -( (-_renderWindow.y1 + _chunkRows - 1) / _chunkRows ) * _chunkRows;
+    _nChunks = (_renderWindow.y2 - _firstChunkY + _chunkRows - 1) / _chunkRows;
+    _nextChunk.fetchAndStoreRelaxed(0);
+    _chunksProcessingTime = 0.;
+
+    ActionRetCodeEnum stat = launchThreadsBlocking( std::min(nCPUs, (unsigned int)_nChunks) );
+
+    if ( !isFailureRetCode(stat) ) {
+        MultiThread::addProcessorCost( processorName, _chunksProcessingTime, (double)width * height );
+    }
+    _nChunks = 0;
+
+    return stat;
 
 }
 
@@ -32,6 +32,11 @@
 #include <boost/scoped_ptr.hpp>
 #endif
 
+#include <string>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
 #include "Global/GlobalDefines.h"
 #include "Engine/RectI.h"
 
@@ -143,6 +148,17 @@ public:
      **/
     static bool isCurrentThreadSpawnedThread();
 
+    /**
+     * @brief Returns the moving average of the time in seconds that the given kind of processor took to process one pixel,
+     * or 0 if it never ran. This is used to size the chunks pulled by the threads.
+     **/
+    static double getProcessorCostPerPixel(const std::string& processorName);
+
+    /**
+     * @brief Records the time spent by a processor to process the given number of pixels
+     **/
+    static void addProcessorCost(const std::string& processorName, double timeSpent, double nPixels);
+
    private:
 
     boost::scoped_ptr<MultiThreadPrivate> _imp;
@@ -187,10 +203,35 @@ private:
     
 };
 
+/**
+ * @brief Base class to process a render window with the threads of the MultiThread suite.
+ * By default the render window is split into chunks of scan-lines, aligned on power of two rows so that they match the tiles
+ * of the cache, which the threads pull from an atomic counter until there are none left. This balances the threads
+ * when the cost of the rows is uneven. The size of the chunks is tuned from the time the same kind of processor took
+ * in the previous calls.
+ * multiThreadProcessImages() may thus be called several times by the same thread.
+ **/
 class ImageMultiThreadProcessorBase : public MultiThreadProcessorBase
 {
     RectI _renderWindow;
 
+    // When using chunks: the number of rows of each chunk, the y coordinate of the first one and the number of chunks.
+    // If _nChunks is 0, each thread processes one contiguous band of the render window.
+    int _chunkRows;
+    int _firstChunkY;
+    int _nChunks;
+
+    // The index of the next chunk to process
+    QAtomicInt _nextChunk;
+
+    // Protects _chunksProcessingTime
+    QMutex _chunksTimeMutex;
+
+    // The sum of the time spent by the threads processing chunks
+    double _chunksProcessingTime;
+
+    bool _dynamicSchedulingEnabled;
+
 public:
 
     ImageMultiThreadProcessorBase(const EffectInstancePtr& effect);
@@ -203,6 +244,11 @@ public:
      **/
     void setRenderWindow(const RectI& renderWindow);
 
+    /**
+     * @brief If false, process() splits the render window statically into one band per thread. This is true by default.
+     **/
+    void setDynamicSchedulingEnabled(bool enabled);
+
     /**
      * @brief Launch the threads and render. This is a simple wrapper over launchThreads()
      * which set the appropriate number of threads given the render window
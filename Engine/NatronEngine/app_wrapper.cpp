@@ -560,6 +560,32 @@ static PyObject* Sbk_AppFunc_getProjectParam(PyObject* self, PyObject* pyArg)
         return 0;
 }
 
+static PyObject* Sbk_AppFunc_getRenderStatistics(PyObject* self)
+{
+    AppWrapper* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = (AppWrapper*)((::App*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_APP_IDX], (SbkObject*)self));
+    PyObject* pyResult = 0;
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // getRenderStatistics()const
+            QMap<QString, QVariant > cppResult = const_cast<const ::AppWrapper*>(cppSelf)->getRenderStatistics();
+            pyResult = Shiboken::Conversions::copyToPython(SbkNatronEngineTypeConverters[SBK_NATRONENGINE_QMAP_QSTRING_QVARIANT_IDX], &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+}
+
 static PyObject* Sbk_AppFunc_getViewIndex(PyObject* self, PyObject* pyArg)
 {
     AppWrapper* cppSelf = 0;
@@ -676,6 +702,32 @@ static PyObject* Sbk_AppFunc_getViewNames(PyObject* self)
     return pyResult;
 }
 
+static PyObject* Sbk_AppFunc_isRenderStatisticsEnabled(PyObject* self)
+{
+    AppWrapper* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = (AppWrapper*)((::App*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_APP_IDX], (SbkObject*)self));
+    PyObject* pyResult = 0;
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // isRenderStatisticsEnabled()const
+            bool cppResult = const_cast<const ::AppWrapper*>(cppSelf)->isRenderStatisticsEnabled();
+            pyResult = Shiboken::Conversions::copyToPython(Shiboken::Conversions::PrimitiveTypeConverter<bool>(), &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+}
+
 static PyObject* Sbk_AppFunc_loadProject(PyObject* self, PyObject* pyArg)
 {
     AppWrapper* cppSelf = 0;
@@ -1063,6 +1115,29 @@ static PyObject* Sbk_AppFunc_resetProject(PyObject* self)
     return pyResult;
 }
 
+static PyObject* Sbk_AppFunc_resetRenderStatistics(PyObject* self)
+{
+    AppWrapper* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = (AppWrapper*)((::App*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_APP_IDX], (SbkObject*)self));
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // resetRenderStatistics()
+            cppSelf->resetRenderStatistics();
+        }
+    }
+
+    if (PyErr_Occurred()) {
+        return 0;
+    }
+    Py_RETURN_NONE;
+}
+
 static PyObject* Sbk_AppFunc_saveProject(PyObject* self, PyObject* pyArg)
 {
     AppWrapper* cppSelf = 0;
@@ -1198,6 +1273,48 @@ static PyObject* Sbk_AppFunc_saveTempProject(PyObject* self, PyObject* pyArg)
         return 0;
 }
 
+static PyObject* Sbk_AppFunc_setRenderStatisticsEnabled(PyObject* self, PyObject* pyArg)
+{
+    AppWrapper* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = (AppWrapper*)((::App*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_APP_IDX], (SbkObject*)self));
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp;
+    SBK_UNUSED(pythonToCpp)
+
+    // Overloaded function decisor
+    // 0: setRenderStatisticsEnabled(bool)
+    if ((pythonToCpp = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<bool>(), (pyArg)))) {
+        overloadId = 0; // setRenderStatisticsEnabled(bool)
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_AppFunc_setRenderStatisticsEnabled_TypeError;
+
+    // Call function/method
+    {
+        bool cppArg0;
+        pythonToCpp(pyArg, &cppArg0);
+
+        if (!PyErr_Occurred()) {
+            // setRenderStatisticsEnabled(bool)
+            cppSelf->setRenderStatisticsEnabled(cppArg0);
+        }
+    }
+
+    if (PyErr_Occurred()) {
+        return 0;
+    }
+    Py_RETURN_NONE;
+
+    Sbk_AppFunc_setRenderStatisticsEnabled_TypeError:
+        const char* overloads[] = {"bool", 0};
+        Shiboken::setErrorAboutWrongArguments(pyArg, "NatronEngine.App.setRenderStatisticsEnabled", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_AppFunc_timelineGetLeftBound(PyObject* self)
 {
     AppWrapper* cppSelf = 0;
@@ -1369,18 +1486,22 @@ static PyMethodDef Sbk_App_methods[] = {
     {"createWriter", (PyCFunction)Sbk_AppFunc_createWriter, METH_VARARGS|METH_KEYWORDS},
     {"getAppID", (PyCFunction)Sbk_AppFunc_getAppID, METH_NOARGS},
     {"getProjectParam", (PyCFunction)Sbk_AppFunc_getProjectParam, METH_O},
+    {"getRenderStatistics", (PyCFunction)Sbk_AppFunc_getRenderStatistics, METH_NOARGS},
     {"getViewIndex", (PyCFunction)Sbk_AppFunc_getViewIndex, METH_O},
     {"getViewName", (PyCFunction)Sbk_AppFunc_getViewName, METH_O},
     {"getViewNames", (PyCFunction)Sbk_AppFunc_getViewNames, METH_NOARGS},
+    {"isRenderStatisticsEnabled", (PyCFunction)Sbk_AppFunc_isRenderStatisticsEnabled, METH_NOARGS},
     {"loadProject", (PyCFunction)Sbk_AppFunc_loadProject, METH_O},
     {"newProject", (PyCFunction)Sbk_AppFunc_newProject, METH_NOARGS},
     {"redrawViewer", (PyCFunction)Sbk_AppFunc_redrawViewer, METH_O},
     {"refreshViewer", (PyCFunction)Sbk_AppFunc_refreshViewer, METH_VARARGS|METH_KEYWORDS},
     {"render", (PyCFunction)Sbk_AppFunc_render, METH_VARARGS|METH_KEYWORDS},
     {"resetProject", (PyCFunction)Sbk_AppFunc_resetProject, METH_NOARGS},
+    {"resetRenderStatistics", (PyCFunction)Sbk_AppFunc_resetRenderStatistics, METH_NOARGS},
     {"saveProject", (PyCFunction)Sbk_AppFunc_saveProject, METH_O},
     {"saveProjectAs", (PyCFunction)Sbk_AppFunc_saveProjectAs, METH_O},
     {"saveTempProject", (PyCFunction)Sbk_AppFunc_saveTempProject, METH_O},
+    {"setRenderStatisticsEnabled", (PyCFunction)Sbk_AppFunc_setRenderStatisticsEnabled, METH_O},
     {"timelineGetLeftBound", (PyCFunction)Sbk_AppFunc_timelineGetLeftBound, METH_NOARGS},
     {"timelineGetRightBound", (PyCFunction)Sbk_AppFunc_timelineGetRightBound, METH_NOARGS},
     {"timelineGetTime", (PyCFunction)Sbk_AppFunc_timelineGetTime, METH_NOARGS},
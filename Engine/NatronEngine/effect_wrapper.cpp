@@ -552,6 +552,51 @@ static PyObject* Sbk_EffectFunc_getBitDepth(PyObject* self)
     return pyResult;
 }
 
+static PyObject* Sbk_EffectFunc_getCacheStatistic(PyObject* self, PyObject* pyArg)
+{
+    ::Effect* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::Effect*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_EFFECT_IDX], (SbkObject*)self));
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp;
+    SBK_UNUSED(pythonToCpp)
+
+    // Overloaded function decisor
+    // 0: getCacheStatistic(QString)const
+    if ((pythonToCpp = Shiboken::Conversions::isPythonToCppConvertible(SbkPySide_QtCoreTypeConverters[SBK_QSTRING_IDX], (pyArg)))) {
+        overloadId = 0; // getCacheStatistic(QString)const
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_EffectFunc_getCacheStatistic_TypeError;
+
+    // Call function/method
+    {
+        ::QString cppArg0 = ::QString();
+        pythonToCpp(pyArg, &cppArg0);
+
+        if (!PyErr_Occurred()) {
+            // getCacheStatistic(QString)const
+            double cppResult = const_cast<const ::Effect*>(cppSelf)->getCacheStatistic(cppArg0);
+            pyResult = Shiboken::Conversions::copyToPython(Shiboken::Conversions::PrimitiveTypeConverter<double>(), &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_EffectFunc_getCacheStatistic_TypeError:
+        const char* overloads[] = {"unicode", 0};
+        Shiboken::setErrorAboutWrongArguments(pyArg, "NatronEngine.Effect.getCacheStatistic", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_EffectFunc_getColor(PyObject* self)
 {
     ::Effect* cppSelf = 0;
@@ -885,6 +930,51 @@ static PyObject* Sbk_EffectFunc_getMaxInputCount(PyObject* self)
     return pyResult;
 }
 
+static PyObject* Sbk_EffectFunc_getMemoryStatistic(PyObject* self, PyObject* pyArg)
+{
+    ::Effect* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::Effect*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_EFFECT_IDX], (SbkObject*)self));
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp;
+    SBK_UNUSED(pythonToCpp)
+
+    // Overloaded function decisor
+    // 0: getMemoryStatistic(QString)const
+    if ((pythonToCpp = Shiboken::Conversions::isPythonToCppConvertible(SbkPySide_QtCoreTypeConverters[SBK_QSTRING_IDX], (pyArg)))) {
+        overloadId = 0; // getMemoryStatistic(QString)const
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_EffectFunc_getMemoryStatistic_TypeError;
+
+    // Call function/method
+    {
+        ::QString cppArg0 = ::QString();
+        pythonToCpp(pyArg, &cppArg0);
+
+        if (!PyErr_Occurred()) {
+            // getMemoryStatistic(QString)const
+            double cppResult = const_cast<const ::Effect*>(cppSelf)->getMemoryStatistic(cppArg0);
+            pyResult = Shiboken::Conversions::copyToPython(Shiboken::Conversions::PrimitiveTypeConverter<double>(), &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_EffectFunc_getMemoryStatistic_TypeError:
+        const char* overloads[] = {"unicode", 0};
+        Shiboken::setErrorAboutWrongArguments(pyArg, "NatronEngine.Effect.getMemoryStatistic", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_EffectFunc_getOutputFormat(PyObject* self)
 {
     ::Effect* cppSelf = 0;
@@ -1614,6 +1704,52 @@ static PyObject* Sbk_EffectFunc_removeParamFromViewerUI(PyObject* self, PyObject
         return 0;
 }
 
+static PyObject* Sbk_EffectFunc_resetCacheStatistics(PyObject* self)
+{
+    ::Effect* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::Effect*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_EFFECT_IDX], (SbkObject*)self));
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // resetCacheStatistics()
+            cppSelf->resetCacheStatistics();
+        }
+    }
+
+    if (PyErr_Occurred()) {
+        return 0;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* Sbk_EffectFunc_resetMemoryStatistics(PyObject* self)
+{
+    ::Effect* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::Effect*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_EFFECT_IDX], (SbkObject*)self));
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // resetMemoryStatistics()
+            cppSelf->resetMemoryStatistics();
+        }
+    }
+
+    if (PyErr_Occurred()) {
+        return 0;
+    }
+    Py_RETURN_NONE;
+}
+
 static PyObject* Sbk_EffectFunc_setColor(PyObject* self, PyObject* args)
 {
     ::Effect* cppSelf = 0;
@@ -1979,6 +2115,7 @@ static PyMethodDef Sbk_Effect_methods[] = {
     {"getAllItemsTable", (PyCFunction)Sbk_EffectFunc_getAllItemsTable, METH_NOARGS},
     {"getAvailableLayers", (PyCFunction)Sbk_EffectFunc_getAvailableLayers, METH_O},
     {"getBitDepth", (PyCFunction)Sbk_EffectFunc_getBitDepth, METH_NOARGS},
+    {"getCacheStatistic", (PyCFunction)Sbk_EffectFunc_getCacheStatistic, METH_O},
     {"getColor", (PyCFunction)Sbk_EffectFunc_getColor, METH_NOARGS},
     {"getContainerGroup", (PyCFunction)Sbk_EffectFunc_getContainerGroup, METH_NOARGS},
     {"getCurrentTime", (PyCFunction)Sbk_EffectFunc_getCurrentTime, METH_NOARGS},
@@ -1988,6 +2125,7 @@ static PyMethodDef Sbk_Effect_methods[] = {
     {"getItemsTable", (PyCFunction)Sbk_EffectFunc_getItemsTable, METH_O},
     {"getLabel", (PyCFunction)Sbk_EffectFunc_getLabel, METH_NOARGS},
     {"getMaxInputCount", (PyCFunction)Sbk_EffectFunc_getMaxInputCount, METH_NOARGS},
+    {"getMemoryStatistic", (PyCFunction)Sbk_EffectFunc_getMemoryStatistic, METH_O},
     {"getOutputFormat", (PyCFunction)Sbk_EffectFunc_getOutputFormat, METH_NOARGS},
     {"getParam", (PyCFunction)Sbk_EffectFunc_getParam, METH_O},
     {"getParams", (PyCFunction)Sbk_EffectFunc_getParams, METH_NOARGS},
@@ -2007,6 +2145,8 @@ static PyMethodDef Sbk_Effect_methods[] = {
     {"registerOverlay", (PyCFunction)Sbk_EffectFunc_registerOverlay, METH_VARARGS},
     {"removeOverlay", (PyCFunction)Sbk_EffectFunc_removeOverlay, METH_O},
     {"removeParamFromViewerUI", (PyCFunction)Sbk_EffectFunc_removeParamFromViewerUI, METH_O},
+    {"resetCacheStatistics", (PyCFunction)Sbk_EffectFunc_resetCacheStatistics, METH_NOARGS},
+    {"resetMemoryStatistics", (PyCFunction)Sbk_EffectFunc_resetMemoryStatistics, METH_NOARGS},
     {"setColor", (PyCFunction)Sbk_EffectFunc_setColor, METH_VARARGS},
     {"setLabel", (PyCFunction)Sbk_EffectFunc_setLabel, METH_O},
     {"setPagesOrder", (PyCFunction)Sbk_EffectFunc_setPagesOrder, METH_O},
@@ -168,6 +168,32 @@ static PyObject* Sbk_PyCoreApplicationFunc_getBuildNumber(PyObject* self)
     return pyResult;
 }
 
+static PyObject* Sbk_PyCoreApplicationFunc_getCacheStatistics(PyObject* self)
+{
+    ::PyCoreApplication* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::PyCoreApplication*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_PYCOREAPPLICATION_IDX], (SbkObject*)self));
+    PyObject* pyResult = 0;
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // getCacheStatistics()const
+            QMap<QString, QVariant > cppResult = const_cast<const ::PyCoreApplication*>(cppSelf)->getCacheStatistics();
+            pyResult = Shiboken::Conversions::copyToPython(SbkNatronEngineTypeConverters[SBK_NATRONENGINE_QMAP_QSTRING_QVARIANT_IDX], &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+}
+
 static PyObject* Sbk_PyCoreApplicationFunc_getInstance(PyObject* self, PyObject* pyArg)
 {
     ::PyCoreApplication* cppSelf = 0;
@@ -655,6 +681,32 @@ static PyObject* Sbk_PyCoreApplicationFunc_isMacOSX(PyObject* self)
     return pyResult;
 }
 
+static PyObject* Sbk_PyCoreApplicationFunc_isRenderTraceEnabled(PyObject* self)
+{
+    ::PyCoreApplication* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::PyCoreApplication*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_PYCOREAPPLICATION_IDX], (SbkObject*)self));
+    PyObject* pyResult = 0;
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // isRenderTraceEnabled()const
+            bool cppResult = const_cast<const ::PyCoreApplication*>(cppSelf)->isRenderTraceEnabled();
+            pyResult = Shiboken::Conversions::copyToPython(Shiboken::Conversions::PrimitiveTypeConverter<bool>(), &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+}
+
 static PyObject* Sbk_PyCoreApplicationFunc_isUnix(PyObject* self)
 {
     ::PyCoreApplication* cppSelf = 0;
@@ -707,6 +759,29 @@ static PyObject* Sbk_PyCoreApplicationFunc_isWindows(PyObject* self)
     return pyResult;
 }
 
+static PyObject* Sbk_PyCoreApplicationFunc_resetRenderTrace(PyObject* self)
+{
+    ::PyCoreApplication* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::PyCoreApplication*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_PYCOREAPPLICATION_IDX], (SbkObject*)self));
+
+    // Call function/method
+    {
+
+        if (!PyErr_Occurred()) {
+            // resetRenderTrace()
+            cppSelf->resetRenderTrace();
+        }
+    }
+
+    if (PyErr_Occurred()) {
+        return 0;
+    }
+    Py_RETURN_NONE;
+}
+
 static PyObject* Sbk_PyCoreApplicationFunc_setOnProjectCreatedCallback(PyObject* self, PyObject* pyArg)
 {
     ::PyCoreApplication* cppSelf = 0;
@@ -791,10 +866,98 @@ static PyObject* Sbk_PyCoreApplicationFunc_setOnProjectLoadedCallback(PyObject*
         return 0;
 }
 
+static PyObject* Sbk_PyCoreApplicationFunc_setRenderTraceEnabled(PyObject* self, PyObject* pyArg)
+{
+    ::PyCoreApplication* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::PyCoreApplication*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_PYCOREAPPLICATION_IDX], (SbkObject*)self));
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp;
+    SBK_UNUSED(pythonToCpp)
+
+    // Overloaded function decisor
+    // 0: setRenderTraceEnabled(bool)
+    if ((pythonToCpp = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<bool>(), (pyArg)))) {
+        overloadId = 0; // setRenderTraceEnabled(bool)
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_PyCoreApplicationFunc_setRenderTraceEnabled_TypeError;
+
+    // Call function/method
+    {
+        bool cppArg0;
+        pythonToCpp(pyArg, &cppArg0);
+
+        if (!PyErr_Occurred()) {
+            // setRenderTraceEnabled(bool)
+            cppSelf->setRenderTraceEnabled(cppArg0);
+        }
+    }
+
+    if (PyErr_Occurred()) {
+        return 0;
+    }
+    Py_RETURN_NONE;
+
+    Sbk_PyCoreApplicationFunc_setRenderTraceEnabled_TypeError:
+        const char* overloads[] = {"bool", 0};
+        Shiboken::setErrorAboutWrongArguments(pyArg, "NatronEngine.PyCoreApplication.setRenderTraceEnabled", overloads);
+        return 0;
+}
+
+static PyObject* Sbk_PyCoreApplicationFunc_writeRenderTrace(PyObject* self, PyObject* pyArg)
+{
+    ::PyCoreApplication* cppSelf = 0;
+    SBK_UNUSED(cppSelf)
+    if (!Shiboken::Object::isValid(self))
+        return 0;
+    cppSelf = ((::PyCoreApplication*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_PYCOREAPPLICATION_IDX], (SbkObject*)self));
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp;
+    SBK_UNUSED(pythonToCpp)
+
+    // Overloaded function decisor
+    // 0: writeRenderTrace(QString)const
+    if ((pythonToCpp = Shiboken::Conversions::isPythonToCppConvertible(SbkPySide_QtCoreTypeConverters[SBK_QSTRING_IDX], (pyArg)))) {
+        overloadId = 0; // writeRenderTrace(QString)const
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_PyCoreApplicationFunc_writeRenderTrace_TypeError;
+
+    // Call function/method
+    {
+        ::QString cppArg0 = ::QString();
+        pythonToCpp(pyArg, &cppArg0);
+
+        if (!PyErr_Occurred()) {
+            // writeRenderTrace(QString)const
+            bool cppResult = const_cast<const ::PyCoreApplication*>(cppSelf)->writeRenderTrace(cppArg0);
+            pyResult = Shiboken::Conversions::copyToPython(Shiboken::Conversions::PrimitiveTypeConverter<bool>(), &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_PyCoreApplicationFunc_writeRenderTrace_TypeError:
+        const char* overloads[] = {"unicode", 0};
+        Shiboken::setErrorAboutWrongArguments(pyArg, "NatronEngine.PyCoreApplication.writeRenderTrace", overloads);
+        return 0;
+}
+
 static PyMethodDef Sbk_PyCoreApplication_methods[] = {
     {"appendToNatronPath", (PyCFunction)Sbk_PyCoreApplicationFunc_appendToNatronPath, METH_O},
     {"getActiveInstance", (PyCFunction)Sbk_PyCoreApplicationFunc_getActiveInstance, METH_NOARGS},
     {"getBuildNumber", (PyCFunction)Sbk_PyCoreApplicationFunc_getBuildNumber, METH_NOARGS},
+    {"getCacheStatistics", (PyCFunction)Sbk_PyCoreApplicationFunc_getCacheStatistics, METH_NOARGS},
     {"getInstance", (PyCFunction)Sbk_PyCoreApplicationFunc_getInstance, METH_O},
     {"getNatronDevelopmentStatus", (PyCFunction)Sbk_PyCoreApplicationFunc_getNatronDevelopmentStatus, METH_NOARGS},
     {"getNatronPath", (PyCFunction)Sbk_PyCoreApplicationFunc_getNatronPath, METH_NOARGS},
@@ -811,10 +974,14 @@ static PyMethodDef Sbk_PyCoreApplication_methods[] = {
     {"isBackground", (PyCFunction)Sbk_PyCoreApplicationFunc_isBackground, METH_NOARGS},
     {"isLinux", (PyCFunction)Sbk_PyCoreApplicationFunc_isLinux, METH_NOARGS},
     {"isMacOSX", (PyCFunction)Sbk_PyCoreApplicationFunc_isMacOSX, METH_NOARGS},
+    {"isRenderTraceEnabled", (PyCFunction)Sbk_PyCoreApplicationFunc_isRenderTraceEnabled, METH_NOARGS},
     {"isUnix", (PyCFunction)Sbk_PyCoreApplicationFunc_isUnix, METH_NOARGS},
     {"isWindows", (PyCFunction)Sbk_PyCoreApplicationFunc_isWindows, METH_NOARGS},
+    {"resetRenderTrace", (PyCFunction)Sbk_PyCoreApplicationFunc_resetRenderTrace, METH_NOARGS},
     {"setOnProjectCreatedCallback", (PyCFunction)Sbk_PyCoreApplicationFunc_setOnProjectCreatedCallback, METH_O},
     {"setOnProjectLoadedCallback", (PyCFunction)Sbk_PyCoreApplicationFunc_setOnProjectLoadedCallback, METH_O},
+    {"setRenderTraceEnabled", (PyCFunction)Sbk_PyCoreApplicationFunc_setRenderTraceEnabled, METH_O},
+    {"writeRenderTrace", (PyCFunction)Sbk_PyCoreApplicationFunc_writeRenderTrace, METH_O},
 
     {0} // Sentinel
 };
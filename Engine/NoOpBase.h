@@ -54,7 +54,7 @@ protected: // derives from EffectInstance, parent of Backdrop, Dot, groupInput,
 
     NoOpBase(const EffectInstancePtr& mainInstance, const FrameViewRenderKey& key);
 
-private:
+protected:
 
     /**
      * @brief A NoOp is always an identity on its input.
@@ -67,7 +67,7 @@ private:
                                          TimeValue* inputTime,
                                          ViewIdx* inputView,
                                          int* inputNb,
-                                         ImagePlaneDesc* inputPlane) OVERRIDE FINAL WARN_UNUSED_RETURN;
+                                         ImagePlaneDesc* inputPlane) OVERRIDE WARN_UNUSED_RETURN;
 };
 
 
@@ -56,6 +56,7 @@
 #include "Engine/AppManager.h"
 #include "Engine/Backdrop.h"
 #include "Engine/Cache.h"
+#include "Engine/CacheStats.h"
 #include "Engine/Curve.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/DiskCacheNode.h"
@@ -125,6 +126,11 @@ Node::Node(const AppInstancePtr& app,
     if (plugin && QString::fromUtf8(plugin->getPluginID().c_str()).startsWith(QLatin1String("com.FXHOME.HitFilm"))) {
         _imp->requiresGLFinishBeforeRender = true;
     }
+
+    CacheStats* cacheStats = appPTR->getCacheStats();
+    if (cacheStats) {
+        _imp->cacheStatsHolderID = cacheStats->makeHolderID();
+    }
 }
 
 
@@ -134,6 +140,122 @@ Node::~Node()
     assert(!_imp->effect);
 }
 
+U64
+Node::getCacheStatsHolderID() const
+{
+    return _imp->cacheStatsHolderID;
+}
+
+void
+Node::getCacheStats(CacheNodeCounters* counters) const
+{
+    CacheStats* cacheStats = appPTR->getCacheStats();
+    if (!cacheStats) {
+        *counters = CacheNodeCounters();
+        return;
+    }
+    cacheStats->getCounters(_imp->cacheStatsHolderID, counters);
+}
+
+void
+Node::resetCacheStats()
+{
+    CacheStats* cacheStats = appPTR->getCacheStats();
+    if (cacheStats) {
+        cacheStats->resetCounters(_imp->cacheStatsHolderID);
+    }
+}
+
+static void
+addCostSample(double costPerMB, double* average)
+{
+    if (*average == 0) {
+        *average = costPerMB;
+    } else {
+        // The cost changes with the parameters: favor recent renders
+        *average = 0.75 * *average + 0.25 * costPerMB;
+    }
+}
+
+void
+Node::addRenderCost(double timeSpent, std::size_t nBytes, RenderBackendTypeEnum backend)
+{
+    if (nBytes == 0) {
+        return;
+    }
+    double costPerMB = timeSpent / ((double)nBytes / (1024. * 1024.));
+    QMutexLocker k(&_imp->renderCostMutex);
+    addCostSample(costPerMB, &_imp->renderCostPerMB);
+    assert(backend <= eRenderBackendTypeOSMesa);
+    addCostSample(costPerMB, &_imp->backendRenderCostPerMB[backend]);
+}
+
+double
+Node::getRenderCostPerMB() const
+{
+    QMutexLocker k(&_imp->renderCostMutex);
+    return _imp->renderCostPerMB;
+}
+
+double
+Node::getRenderCostPerMB(RenderBackendTypeEnum backend) const
+{
+    assert(backend <= eRenderBackendTypeOSMesa);
+    QMutexLocker k(&_imp->renderCostMutex);
+    return _imp->backendRenderCostPerMB[backend];
+}
+
+void
+Node::addTransferCost(double timeSpent, std::size_t nBytes)
+{
+    if (nBytes == 0) {
+        return;
+    }
+    double costPerMB = timeSpent / ((double)nBytes / (1024. * 1024.));
+    QMutexLocker k(&_imp->renderCostMutex);
+    addCostSample(costPerMB, &_imp->transferCostPerMB);
+}
+
+double
+Node::getTransferCostPerMB() const
+{
+    QMutexLocker k(&_imp->renderCostMutex);
+    return _imp->transferCostPerMB;
+}
+
+MemoryBudgetPtr
+Node::getMemoryBudget() const
+{
+    return _imp->memoryBudget;
+}
+
+PluginMemoryCachePtr
+Node::getPluginMemoryCache() const
+{
+    return _imp->pluginMemoryCache;
+}
+
+void
+Node::setSharedByConcurrentRenders(bool shared)
+{
+    QMutexLocker k(&_imp->concurrentRendersMutex);
+    if (shared) {
+        ++_imp->sharedByConcurrentRendersCount;
+    } else {
+        assert(_imp->sharedByConcurrentRendersCount > 0);
+        if (_imp->sharedByConcurrentRendersCount > 0) {
+            --_imp->sharedByConcurrentRendersCount;
+        }
+    }
+}
+
+bool
+Node::isSharedByConcurrentRenders() const
+{
+    QMutexLocker k(&_imp->concurrentRendersMutex);
+    return _imp->sharedByConcurrentRendersCount > 0;
+}
+
 bool
 Node::isGLFinishRequiredBeforeRender() const
 {
@@ -720,6 +720,70 @@ public:
      **/
     std::string getPluginID() const;
 
+    /**
+     * @brief Returns the identifier of this node in the CacheStats: cache entries keys produced by this
+     * node should have it set with CacheEntryKeyBase::setStatsHolderID()
+     **/
+    U64 getCacheStatsHolderID() const;
+
+    /**
+     * @brief Returns the cache statistics of this node, summed over all threads
+     **/
+    void getCacheStats(CacheNodeCounters* counters) const;
+
+    void resetCacheStats();
+
+    /**
+     * @brief Account for the time spent to render the given amount of bytes of images by this node.
+     * This is used to estimate the cost of the cache entries of this node, @see CacheEntryKeyBase::setComputeCostHint
+     * The cost is also accounted for the given backend so that the adaptive backend selection of the renders can
+     * compare the backends, @see getRenderCostPerMB(RenderBackendTypeEnum)
+     **/
+    void addRenderCost(double timeSpent, std::size_t nBytes, RenderBackendTypeEnum backend = eRenderBackendTypeCPU);
+
+    /**
+     * @brief Returns the average time spent by this node to render a MiB of image, 0 if it did not render anything yet.
+     **/
+    double getRenderCostPerMB() const;
+
+    /**
+     * @brief Same as getRenderCostPerMB() but only for the renders of this node done with the given backend.
+     **/
+    double getRenderCostPerMB(RenderBackendTypeEnum backend) const;
+
+    /**
+     * @brief Account for the time spent to move the given amount of bytes of images between the RAM and OpenGL textures
+     * for the renders of this node, in either direction.
+     **/
+    void addTransferCost(double timeSpent, std::size_t nBytes);
+
+    /**
+     * @brief Returns the average time spent to move a MiB of image between the RAM and OpenGL textures for this node,
+     * 0 if no transfer was done yet.
+     **/
+    double getTransferCostPerMB() const;
+
+    /**
+     * @brief Returns the budget the RAM of the images allocated by the renders of this node is charged to.
+     * Its limit is the Memory Budget parameter of the node, @see EffectInstance::getMemoryBudgetLimit
+     **/
+    MemoryBudgetPtr getMemoryBudget() const;
+
+    /**
+     * @brief Returns the cache of the memory allocated by the plug-in through the memory suite,
+     * so that its scratch buffers are reused across renders.
+     **/
+    PluginMemoryCachePtr getPluginMemoryCache() const;
+
+    /**
+     * @brief Called by the RenderQueue when Write nodes depending on this node start (shared = true)
+     * or stop (shared = false) rendering concurrently. While at least one such group of Write nodes
+     * renders, the output of this node is cached so that it is computed once per frame for all of them.
+     **/
+    void setSharedByConcurrentRenders(bool shared);
+
+    bool isSharedByConcurrentRenders() const;
+
 
     /**
      * @brief Forwarded to the live effect instance
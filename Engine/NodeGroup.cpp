@@ -35,11 +35,16 @@
 #include <limits>
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QMutex>
 #include <QtCore/QTextStream>
+#include <QtCore/QThread>
 
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
 #include "Engine/Bezier.h"
 #include "Engine/BezierCP.h"
+#include "Engine/CompressedTileFile.h"
 #include "Engine/Curve.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/GroupInput.h"
@@ -55,6 +60,7 @@
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
 #include "Engine/RenderEngine.h"
+#include "Engine/RenderQueue.h"
 #include "Engine/PrecompNode.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/Settings.h"
@@ -62,6 +68,7 @@
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerNode.h"
 #include "Engine/ViewerInstance.h"
+#include "Engine/WriteNode.h"
 
 #include "Serialization/NodeSerialization.h"
 
@@ -82,6 +89,14 @@ struct NodeCollectionPrivate
     // If true, the user did edit the subgraph
     bool wasGroupEditedByUser;
 
+    // Protects topology and topologyAge
+    mutable QMutex topologyMutex;
+
+    // Built lazily by getTopology(), reset by invalidateTopology()
+    mutable NodeCollectionTopologyConstPtr topology;
+
+    // Incremented by invalidateTopology(), so that a snapshot built while the graph changed is not kept
+    U64 topologyAge;
 
     NodeCollectionPrivate(const AppInstancePtr& app)
         : app(app)
@@ -91,12 +106,207 @@ struct NodeCollectionPrivate
         , graphEditedMutex()
         , isEditable(true)
         , wasGroupEditedByUser(false)
+        , topologyMutex()
+        , topology()
+        , topologyAge(0)
     {
     }
 
     NodePtr findNodeInternal(const std::string& name, const std::string& recurseName) const;
 };
 
+NodeCollectionTopology::NodeCollectionTopology(const NodesList& nodes)
+    : _nodes()
+    , _indices()
+    , _inputsOffsets()
+    , _inputs()
+    , _outputsOffsets()
+    , _outputs()
+    , _complete(true)
+{
+    const int nNodes = (int)nodes.size();
+
+    // Number the nodes in the order of the collection first
+    std::vector<NodePtr> listed;
+    listed.reserve(nNodes);
+    std::map<const Node*, int> listedIndices;
+    for (NodesList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        listedIndices.insert( std::make_pair( it->get(), (int)listed.size() ) );
+        listed.push_back(*it);
+    }
+
+    // Gather the inputs of each node, without duplicates
+    std::vector<std::vector<int> > listedInputs(nNodes);
+    std::vector<std::vector<int> > listedOutputs(nNodes);
+    for (int i = 0; i < nNodes; ++i) {
+        std::vector<NodeWPtr> inputs = listed[i]->getInputs_copy();
+        std::vector<int>& nodeInputs = listedInputs[i];
+        for (std::size_t j = 0; j < inputs.size(); ++j) {
+            NodePtr input = inputs[j].lock();
+            if (!input) {
+                continue;
+            }
+            std::map<const Node*, int>::const_iterator found = listedIndices.find( input.get() );
+            if ( found == listedIndices.end() ) {
+                // The input is not in this collection: the order cannot account for it
+                _complete = false;
+                continue;
+            }
+            if ( std::find(nodeInputs.begin(), nodeInputs.end(), found->second) == nodeInputs.end() ) {
+                nodeInputs.push_back(found->second);
+                listedOutputs[found->second].push_back(i);
+            }
+        }
+    }
+
+    // Kahn's algorithm: a node is ordered once all its inputs are
+    std::vector<int> order;
+    order.reserve(nNodes);
+    std::vector<int> inputsLeft(nNodes);
+    for (int i = 0; i < nNodes; ++i) {
+        inputsLeft[i] = (int)listedInputs[i].size();
+        if (inputsLeft[i] == 0) {
+            order.push_back(i);
+        }
+    }
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        const std::vector<int>& outputs = listedOutputs[order[i]];
+        for (std::size_t j = 0; j < outputs.size(); ++j) {
+            if (--inputsLeft[outputs[j]] == 0) {
+                order.push_back(outputs[j]);
+            }
+        }
+    }
+    if ( (int)order.size() < nNodes ) {
+        // There is a cycle: append the nodes that are part of it or downstream of it in the order of the collection
+        _complete = false;
+        for (int i = 0; i < nNodes; ++i) {
+            if (inputsLeft[i] > 0) {
+                order.push_back(i);
+            }
+        }
+    }
+
+    // Renumber the nodes in the topological order and flatten the adjacency lists
+    std::vector<int> position(nNodes);
+    for (int i = 0; i < nNodes; ++i) {
+        position[order[i]] = i;
+    }
+
+    _nodes.resize(nNodes);
+    _inputsOffsets.resize(nNodes + 1);
+    _outputsOffsets.resize(nNodes + 1);
+    _inputsOffsets[0] = 0;
+    _outputsOffsets[0] = 0;
+    for (int i = 0; i < nNodes; ++i) {
+        const int listedIndex = order[i];
+        _nodes[i] = listed[listedIndex];
+        _indices.insert( std::make_pair(listed[listedIndex].get(), i) );
+
+        const std::vector<int>& inputs = listedInputs[listedIndex];
+        for (std::size_t j = 0; j < inputs.size(); ++j) {
+            _inputs.push_back(position[inputs[j]]);
+        }
+        _inputsOffsets[i + 1] = (int)_inputs.size();
+
+        const std::vector<int>& outputs = listedOutputs[listedIndex];
+        for (std::size_t j = 0; j < outputs.size(); ++j) {
+            _outputs.push_back(position[outputs[j]]);
+        }
+        _outputsOffsets[i + 1] = (int)_outputs.size();
+    }
+}
+
+NodeCollectionTopology::~NodeCollectionTopology()
+{
+}
+
+NodePtr
+NodeCollectionTopology::getNode(int index) const
+{
+    assert(index >= 0 && index < (int)_nodes.size());
+
+    return _nodes[index].lock();
+}
+
+int
+NodeCollectionTopology::getIndex(const Node* node) const
+{
+    std::map<const Node*, int>::const_iterator found = _indices.find(node);
+
+    return found == _indices.end() ? -1 : found->second;
+}
+
+bool
+NodeCollectionTopology::isUpstream(int index, int upstream) const
+{
+    assert(index >= 0 && index < (int)_nodes.size() && upstream >= 0 && upstream < (int)_nodes.size());
+    if (_complete && upstream >= index) {
+        // The inputs always come first
+        return false;
+    }
+
+    std::vector<bool> marked(_nodes.size(), false);
+    std::vector<int> toVisit;
+    toVisit.push_back(index);
+    marked[index] = true;
+    while ( !toVisit.empty() ) {
+        const int current = toVisit.back();
+        toVisit.pop_back();
+        for (const int* it = getInputsBegin(current); it != getInputsEnd(current); ++it) {
+            if (*it == upstream) {
+                return true;
+            }
+            // When the order is complete, the nodes before upstream cannot lead to it
+            if ( marked[*it] || (_complete && *it < upstream) ) {
+                continue;
+            }
+            marked[*it] = true;
+            toVisit.push_back(*it);
+        }
+    }
+
+    return false;
+}
+
+void
+NodeCollectionTopology::getUpstreamNodes(int index,
+                                         std::vector<int>* upstreamNodes) const
+{
+    assert(index >= 0 && index < (int)_nodes.size());
+
+    std::vector<bool> marked(_nodes.size(), false);
+    std::vector<int> toVisit;
+    toVisit.push_back(index);
+    marked[index] = true;
+    while ( !toVisit.empty() ) {
+        const int current = toVisit.back();
+        toVisit.pop_back();
+        for (const int* it = getInputsBegin(current); it != getInputsEnd(current); ++it) {
+            if (!marked[*it]) {
+                marked[*it] = true;
+                toVisit.push_back(*it);
+            }
+        }
+    }
+
+    if (_complete) {
+        // All the inputs come before index
+        for (int i = index; i >= 0; --i) {
+            if (marked[i]) {
+                upstreamNodes->push_back(i);
+            }
+        }
+    } else {
+        upstreamNodes->push_back(index);
+        for (int i = (int)_nodes.size() - 1; i >= 0; --i) {
+            if (marked[i] && i != index) {
+                upstreamNodes->push_back(i);
+            }
+        }
+    }
+}
+
 NodeCollection::NodeCollection(const AppInstancePtr& app)
     : _imp( new NodeCollectionPrivate(app) )
 {
@@ -167,6 +377,7 @@ NodeCollection::addNode(const NodePtr& node)
         QMutexLocker k(&_imp->nodesMutex);
         _imp->nodes.push_back(node);
     }
+    invalidateTopology();
 }
 
 
@@ -177,14 +388,17 @@ NodeCollection::removeNode(const Node* node)
     if (!node) {
         return;
     }
-    QMutexLocker k(&_imp->nodesMutex);
-    for (NodesList::iterator it =_imp->nodes.begin(); it != _imp->nodes.end();++it) {
-        if ( it->get() == node ) {
-            _imp->nodes.erase(it);
-            break;
+    {
+        QMutexLocker k(&_imp->nodesMutex);
+        for (NodesList::iterator it =_imp->nodes.begin(); it != _imp->nodes.end();++it) {
+            if ( it->get() == node ) {
+                _imp->nodes.erase(it);
+                break;
+            }
         }
+        onNodeRemoved(node);
     }
-    onNodeRemoved(node);
+    invalidateTopology();
 }
 
 void
@@ -193,6 +407,37 @@ NodeCollection::removeNode(const NodePtr& node)
     removeNode(node.get());
 }
 
+NodeCollectionTopologyConstPtr
+NodeCollection::getTopology() const
+{
+    U64 age;
+    {
+        QMutexLocker k(&_imp->topologyMutex);
+        if (_imp->topology) {
+            return _imp->topology;
+        }
+        age = _imp->topologyAge;
+    }
+
+    // Build the snapshot without holding topologyMutex: invalidateTopology() is called by the nodes while they hold
+    // their inputs mutex, which the snapshot needs to read their inputs.
+    NodeCollectionTopologyConstPtr topology( new NodeCollectionTopology( getNodes() ) );
+
+    QMutexLocker k(&_imp->topologyMutex);
+    if (_imp->topologyAge == age) {
+        _imp->topology = topology;
+    }
+    return topology;
+}
+
+void
+NodeCollection::invalidateTopology()
+{
+    QMutexLocker k(&_imp->topologyMutex);
+    _imp->topology.reset();
+    ++_imp->topologyAge;
+}
+
 NodePtr
 NodeCollection::getLastNode(const std::string& pluginID) const
 {
@@ -417,6 +662,7 @@ NodeCollection::clearNodesInternal()
         QMutexLocker l(&_imp->nodesMutex);
         _imp->nodes.clear();
     }
+    invalidateTopology();
 
     nodesToDelete.clear();
 }
@@ -728,22 +974,31 @@ NodePtr
 NodeCollectionPrivate::findNodeInternal(const std::string& name,
                                         const std::string& recurseName) const
 {
-    QMutexLocker k(&nodesMutex);
+    NodeGroupPtr foundGroup;
+    {
+        QMutexLocker k(&nodesMutex);
 
-    for (NodesList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
-        if ( (*it)->getScriptName_mt_safe() == name ) {
-            if ( !recurseName.empty() ) {
-                NodeGroupPtr isGrp = (*it)->isEffectNodeGroup();
-                if (isGrp) {
-                    return isGrp->getNodeByFullySpecifiedName(recurseName);
+        for (NodesList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+            if ( (*it)->getScriptName_mt_safe() == name ) {
+                if ( !recurseName.empty() ) {
+                    foundGroup = (*it)->isEffectNodeGroup();
+                    if (foundGroup) {
+                        break;
+                    }
+                } else {
+                    return *it;
                 }
-            } else {
-                return *it;
             }
         }
     }
+    if (!foundGroup) {
+        return NodePtr();
+    }
 
-    return NodePtr();
+    // The node is looked-up in the group: its nodes must exist. This is done without the lock held
+    // because the nodes being created may look-up nodes in this collection.
+    foundGroup->createDeferredSubGraph();
+    return foundGroup->getNodeByFullySpecifiedName(recurseName);
 }
 
 NodePtr
@@ -1030,15 +1285,31 @@ NodeCollection::refreshTimeInvariantMetadataOnAllNodes_recursive()
     }
 }
 
+// The directory of the cache directory holding the images of the frozen groups
+#define NATRON_FROZEN_SUBGRAPH_DIR_NAME "FrozenGroups"
+
+#define kNatronPersistentWarningFrozenSubGraphStale "NatronPersistentWarningFrozenSubGraphStale"
+
 struct NodeGroupPrivate
 {
     NodeGroup* _publicInterface;
-    mutable QMutex nodesLock; // protects inputs & outputs
+    mutable QMutex nodesLock; // protects inputs & outputs & deferredNodes
     std::vector<NodeWPtr> inputs;
     NodesWList outputs;
     bool isDeactivatingGroup;
     bool isActivatingGroup;
 
+    // The serialization of all the nodes of the sub-graph when their creation was deferred, see loadSubGraph.
+    // Only the Input and Output nodes were created.
+    SERIALIZATION_NAMESPACE::NodeSerializationList deferredNodes;
+
+    // Protects frozenFile and frozenFileHash
+    QMutex frozenFileMutex;
+
+    // The file holding the frozen images, opened the first time it is needed for the hash frozenFileHash
+    CompressedTileFilePtr frozenFile;
+    U64 frozenFileHash;
+
     NodeGroupPrivate(NodeGroup* publicInterface)
     : _publicInterface(publicInterface)
     , nodesLock(QMutex::Recursive)
@@ -1046,7 +1317,10 @@ struct NodeGroupPrivate
     , outputs()
     , isDeactivatingGroup(false)
     , isActivatingGroup(false)
-
+    , deferredNodes()
+    , frozenFileMutex()
+    , frozenFile()
+    , frozenFileHash(0)
     {
     }
 
@@ -1505,6 +1779,228 @@ NodeGroup::setupInitialSubGraphState()
     }
 }
 
+static void restoreInputs(const NodePtr& node,
+                          const std::map<std::string, std::string>& inputsMap,
+                          const std::map<SERIALIZATION_NAMESPACE::NodeSerializationPtr, NodePtr>& createdNodes,
+                          const NodesList& allNodesInGroup,
+                          bool allowSearchInAllNodes,
+                          bool isMaskInputs);
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+bool
+isGroupInterfaceNode(const SERIALIZATION_NAMESPACE::NodeSerialization& serialization)
+{
+    return serialization._pluginID == PLUGINID_NATRON_INPUT || serialization._pluginID == PLUGINID_NATRON_OUTPUT;
+}
+
+/**
+ * @brief Returns true if any of the given nodes or their children may be rendered or displayed on their own:
+ * the creation of such nodes cannot be deferred.
+ **/
+bool
+containsOutputNodes(const SERIALIZATION_NAMESPACE::NodeSerializationList& serializedNodes)
+{
+    for (SERIALIZATION_NAMESPACE::NodeSerializationList::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+        const std::string& pluginID = (*it)->_pluginID;
+        if ( pluginID == PLUGINID_NATRON_WRITE ||
+             pluginID == PLUGINID_NATRON_VIEWER_GROUP ||
+             pluginID == PLUGINID_NATRON_VIEWER_INTERNAL ||
+             WriteNode::isBundledWriter(pluginID) ) {
+            return true;
+        }
+        if ( containsOutputNodes( (*it)->_children ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+bool
+NodeGroup::isSubGraphDeferred() const
+{
+    QMutexLocker k(&_imp->nodesLock);
+    return !_imp->deferredNodes.empty();
+}
+
+SERIALIZATION_NAMESPACE::NodeSerializationList
+NodeGroup::getDeferredSubGraph() const
+{
+    QMutexLocker k(&_imp->nodesLock);
+    return _imp->deferredNodes;
+}
+
+void
+NodeGroup::createDeferredSubGraph()
+{
+    if ( QThread::currentThread() != qApp->thread() ) {
+        return;
+    }
+    SERIALIZATION_NAMESPACE::NodeSerializationList serializedNodes;
+    {
+        // Clear the list first: the nodes being created look-up nodes of this group
+        QMutexLocker k(&_imp->nodesLock);
+        serializedNodes.swap(_imp->deferredNodes);
+    }
+    if ( serializedNodes.empty() ) {
+        return;
+    }
+
+    SERIALIZATION_NAMESPACE::NodeSerializationList nodesToCreate, interfaceNodes;
+    for (SERIALIZATION_NAMESPACE::NodeSerializationList::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+        if ( isGroupInterfaceNode(**it) ) {
+            interfaceNodes.push_back(*it);
+        } else {
+            nodesToCreate.push_back(*it);
+        }
+    }
+
+    // The Input nodes already exist: allow connecting to nodes that are not in the list
+    createNodesFromSerialization(nodesToCreate, eCreateNodesFromSerializationFlagsConnectToExternalNodes, 0);
+
+    // The Output nodes could not be connected when they were created
+    NodesList allNodesInGroup = getNodes();
+    std::map<SERIALIZATION_NAMESPACE::NodeSerializationPtr, NodePtr> noCreatedNodes;
+    for (SERIALIZATION_NAMESPACE::NodeSerializationList::const_iterator it = interfaceNodes.begin(); it != interfaceNodes.end(); ++it) {
+        NodePtr node = getNodeByName( (*it)->_nodeScriptName );
+        if (node) {
+            restoreInputs(node, (*it)->_inputs, noCreatedNodes, allNodesInGroup, true, false /*isMasks*/);
+            restoreInputs(node, (*it)->_masks, noCreatedNodes, allNodesInGroup, true, true /*isMasks*/);
+        }
+    }
+
+    // Sub-groups may have been deferred too if the project is still loading
+    createDeferredSubGraphsOfConnectedGroups();
+
+    TopologicallySortedNodesList sortedNodes;
+    extractTopologicallySortedTrees(true /*recurseOnSubGroups*/, &sortedNodes, 0);
+    for (TopologicallySortedNodesList::const_iterator it = sortedNodes.begin(); it != sortedNodes.end(); ++it) {
+        (*it)->node->getEffectInstance()->onMetadataChanged_nonRecursive_public();
+    }
+} // createDeferredSubGraph
+
+void
+NodeCollection::createDeferredSubGraphsOfConnectedGroups()
+{
+    NodesList nodes = getNodes();
+    for (NodesList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        NodeGroupPtr isGroup = (*it)->isEffectNodeGroup();
+        if (!isGroup) {
+            continue;
+        }
+        if ( !isGroup->isSubGraphDeferred() ) {
+            isGroup->createDeferredSubGraphsOfConnectedGroups();
+            continue;
+        }
+        OutputNodesMap outputs;
+        (*it)->getOutputs(outputs);
+        if ( !outputs.empty() ) {
+            isGroup->createDeferredSubGraph();
+        }
+    }
+} // createDeferredSubGraphsOfConnectedGroups
+
+bool
+NodeGroup::isSubGraphFrozen() const
+{
+    KnobBoolPtr freezeKnob = toKnobBool( getKnobByName(kNatronNodeKnobFreezeSubGraph) );
+    return freezeKnob && freezeKnob->getValue();
+}
+
+U64
+NodeGroup::getFrozenSubGraphHash() const
+{
+    KnobStringPtr hashKnob = toKnobString( getKnobByName(kNatronNodeKnobFrozenSubGraphHash) );
+    if (!hashKnob) {
+        return 0;
+    }
+    bool ok;
+    U64 hash = QString::fromUtf8( hashKnob->getValue().c_str() ).toULongLong(&ok, 16);
+    return ok ? hash : 0;
+}
+
+CompressedTileFilePtr
+NodeGroup::getFrozenSubGraphFile()
+{
+    U64 hash = getFrozenSubGraphHash();
+    if (!hash) {
+        return CompressedTileFilePtr();
+    }
+
+    QMutexLocker k(&_imp->frozenFileMutex);
+    if (!_imp->frozenFile || _imp->frozenFileHash != hash) {
+        // One file per frozen state of the group: the images of a previous state are not mixed with the current ones
+        QString dirPath = QString::fromUtf8( appPTR->getCacheDirPath().c_str() ) + QLatin1Char('/') + QString::fromUtf8(NATRON_FROZEN_SUBGRAPH_DIR_NAME);
+        QDir().mkpath(dirPath);
+        std::string filePath = dirPath.toStdString() + '/' + getNode()->getFullyQualifiedName() + '_' + QString::number(hash, 16).toStdString() + ".tiles";
+        CompressedTileFilePtr file = boost::make_shared<CompressedTileFile>();
+        if ( !file->open(filePath) ) {
+            return CompressedTileFilePtr();
+        }
+        _imp->frozenFile = file;
+        _imp->frozenFileHash = hash;
+    }
+    return _imp->frozenFile;
+} // getFrozenSubGraphFile
+
+void
+NodeGroup::onFreezeSubGraphChanged(bool preRender)
+{
+    NodePtr outputNode = getOutputNode();
+    if (!outputNode) {
+        return;
+    }
+    const bool frozen = isSubGraphFrozen();
+
+    if (frozen && preRender) {
+        // Identify the frozen images with the current state of the sub-graph
+        NodePtr outputNodeInput = getOutputNodeInput();
+        KnobStringPtr hashKnob = toKnobString( getKnobByName(kNatronNodeKnobFrozenSubGraphHash) );
+        if (outputNodeInput && hashKnob) {
+            U64 hash = outputNodeInput->getEffectInstance()->computeHash( HashableObject::ComputeHashArgs() );
+            hashKnob->setValue( QString::number(hash, 16).toStdString() );
+        }
+    }
+
+    // The hash of the Output node depends on the frozen state
+    outputNode->getEffectInstance()->invalidateHashCache();
+
+    refreshFrozenSubGraphState();
+
+    if (frozen && preRender) {
+        RenderQueue::RenderWork w;
+        w.renderLabel = tr("Freezing").toStdString();
+        w.treeRoot = outputNode;
+        w.frameStep = TimeValue(1.);
+        w.useRenderStats = false;
+        std::list<RenderQueue::RenderWork> works;
+        works.push_back(w);
+        getApp()->getRenderQueue()->renderNonBlocking(works);
+    }
+} // onFreezeSubGraphChanged
+
+void
+NodeGroup::refreshFrozenSubGraphState()
+{
+    NodePtr node = getNode();
+    if (!node) {
+        return;
+    }
+    NodePtr outputNodeInput = getOutputNodeInput();
+    if ( !isSubGraphFrozen() || !outputNodeInput ) {
+        node->clearPersistentMessage(kNatronPersistentWarningFrozenSubGraphStale);
+        return;
+    }
+    U64 hash = outputNodeInput->getEffectInstance()->computeHash( HashableObject::ComputeHashArgs() );
+    if ( hash == getFrozenSubGraphHash() ) {
+        node->clearPersistentMessage(kNatronPersistentWarningFrozenSubGraphStale);
+    } else {
+        node->setPersistentMessage( eMessageTypeWarning, kNatronPersistentWarningFrozenSubGraphStale, tr("The node-graph changed since it was frozen, the images are stale. Click \"%1\" to render them again.").arg( tr(kNatronNodeKnobUpdateFrozenSubGraphLabel) ).toStdString() );
+    }
+} // refreshFrozenSubGraphState
+
 void
 NodeGroup::loadSubGraph(const SERIALIZATION_NAMESPACE::NodeSerialization* projectSerialization,
                         const SERIALIZATION_NAMESPACE::NodeSerialization* pyPlugSerialization)
@@ -1527,8 +2023,28 @@ NodeGroup::loadSubGraph(const SERIALIZATION_NAMESPACE::NodeSerialization* projec
         //Clear any node created already in setupInitialSubGraphState()
         clearNodesBlocking();
 
-        // This will create internal nodes.
-        createNodesFromSerialization(projectSerialization->_children, eCreateNodesFromSerializationFlagsNone,  0);
+        // When loading a project, a plain group that cannot render on its own only creates its Input and Output nodes, which
+        // define its inputs. The other nodes are created when the group is connected, opened or queried, see createDeferredSubGraph.
+        bool deferSubGraph = getNode()->getPluginID() == PLUGINID_NATRON_GROUP &&
+                             getApp()->getProject()->isLoadingProject() &&
+                             appPTR->getCurrentSettings()->isGroupContentCreationDeferred() &&
+                             !containsOutputNodes(projectSerialization->_children);
+        if (deferSubGraph) {
+            SERIALIZATION_NAMESPACE::NodeSerializationList interfaceNodes;
+            for (SERIALIZATION_NAMESPACE::NodeSerializationList::const_iterator it = projectSerialization->_children.begin(); it != projectSerialization->_children.end(); ++it) {
+                if ( isGroupInterfaceNode(**it) ) {
+                    interfaceNodes.push_back(*it);
+                }
+            }
+            createNodesFromSerialization(interfaceNodes, eCreateNodesFromSerializationFlagsNone,  0);
+            if ( interfaceNodes.size() < projectSerialization->_children.size() ) {
+                QMutexLocker k(&_imp->nodesLock);
+                _imp->deferredNodes = projectSerialization->_children;
+            }
+        } else {
+            // This will create internal nodes.
+            createNodesFromSerialization(projectSerialization->_children, eCreateNodesFromSerializationFlagsNone,  0);
+        }
 
         // A group always appear edited
         setSubGraphEditedByUser(true);
@@ -1698,6 +2214,9 @@ NodeCollection::createNodesFromSerialization(const SERIALIZATION_NAMESPACE::Node
 
     NodeCollectionPtr thisShared = getThisShared();
 
+    // Do not refresh the graph for each node connected: metadata are refreshed once below
+    CreateNodesBatch_RAII createBatch( getApplication() );
+
     // When loading a Project, use the Group name to update the loading status to the user
     NodeGroupPtr isNodeGroup = toNodeGroup(thisShared);
 
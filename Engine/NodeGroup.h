@@ -29,7 +29,9 @@
 #include "Global/Macros.h"
 
 #include <list>
+#include <map>
 #include <set>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
@@ -55,6 +57,93 @@ NATRON_NAMESPACE_ENTER
 #define kNatronGroupInputIsOptionalParamName "optional"
 
 
+/**
+ * @brief An immutable snapshot of the connections between the nodes of a NodeCollection.
+ * The nodes are sorted so that each node comes after all its inputs, and the inputs and outputs of each node
+ * are stored as indices in that order, in contiguous arrays. The traversals of the graph can then mark the nodes
+ * in a bitmap instead of a set of pointers, and stop as soon as they reach nodes that come before what they look for.
+ * @see NodeCollection::getTopology()
+ **/
+class NodeCollectionTopology
+{
+public:
+
+    explicit NodeCollectionTopology(const NodesList& nodes);
+
+    ~NodeCollectionTopology();
+
+    int getNodesCount() const
+    {
+        return (int)_nodes.size();
+    }
+
+    /**
+     * @brief Returns the node at the given position in the order, or NULL if it was destroyed since.
+     **/
+    NodePtr getNode(int index) const;
+
+    /**
+     * @brief Returns the position of the node in the order, or -1 if the node is not in the collection.
+     **/
+    int getIndex(const Node* node) const;
+
+    /**
+     * @brief The positions of the inputs of the node at the given position, each input appearing once.
+     **/
+    const int* getInputsBegin(int index) const
+    {
+        return _inputs.empty() ? 0 : &_inputs[0] + _inputsOffsets[index];
+    }
+
+    const int* getInputsEnd(int index) const
+    {
+        return _inputs.empty() ? 0 : &_inputs[0] + _inputsOffsets[index + 1];
+    }
+
+    /**
+     * @brief The positions of the outputs of the node at the given position, each output appearing once.
+     **/
+    const int* getOutputsBegin(int index) const
+    {
+        return _outputs.empty() ? 0 : &_outputs[0] + _outputsOffsets[index];
+    }
+
+    const int* getOutputsEnd(int index) const
+    {
+        return _outputs.empty() ? 0 : &_outputs[0] + _outputsOffsets[index + 1];
+    }
+
+    /**
+     * @brief Returns false if a node of the collection has an input outside of the collection or if the graph has a cycle:
+     * the order is then only partial and the callers must walk the nodes inputs themselves.
+     **/
+    bool isComplete() const
+    {
+        return _complete;
+    }
+
+    /**
+     * @brief Returns true if the node at the position upstream is an input, direct or not, of the node at the position index.
+     **/
+    bool isUpstream(int index, int upstream) const;
+
+    /**
+     * @brief Appends to upstreamNodes the position of the given node and of all its inputs, direct or not,
+     * each once, in decreasing order, i.e: a node comes before its inputs.
+     **/
+    void getUpstreamNodes(int index, std::vector<int>* upstreamNodes) const;
+
+private:
+
+    std::vector<NodeWPtr> _nodes;
+    std::map<const Node*, int> _indices;
+
+    // The inputs of the node i are _inputs[_inputsOffsets[i]] to _inputs[_inputsOffsets[i + 1] - 1], same for the outputs
+    std::vector<int> _inputsOffsets, _inputs;
+    std::vector<int> _outputsOffsets, _outputs;
+    bool _complete;
+};
+
 struct NodeCollectionPrivate;
 
 class NodeCollection
@@ -100,6 +189,17 @@ public:
     void removeNode(const NodePtr& node);
     void removeNode(const Node* node);
 
+    /**
+     * @brief Returns the connections between the nodes of the collection. The snapshot is built on the first call
+     * and shared until a node is added, removed, connected or disconnected. MT-safe.
+     **/
+    NodeCollectionTopologyConstPtr getTopology() const;
+
+    /**
+     * @brief Drops the snapshot returned by getTopology(), called by the nodes whenever their inputs change. MT-safe.
+     **/
+    void invalidateTopology();
+
     /**
      * @brief Get the last node added with the given id
      **/
@@ -236,6 +336,13 @@ public:
      **/
     void refreshTimeInvariantMetadataOnAllNodes_recursive();
 
+    /**
+     * @brief Creates the sub-graph of the groups of this collection and sub-groups that were deferred
+     * when loading the project but that are connected to another node, hence may be rendered.
+     * @see NodeGroup::createDeferredSubGraph
+     **/
+    void createDeferredSubGraphsOfConnectedGroups();
+
     enum CreateNodesFromSerializationFlagsEnum
     {
         eCreateNodesFromSerializationFlagsNone = 0x0,
@@ -525,6 +632,59 @@ public:
     virtual void loadSubGraph(const SERIALIZATION_NAMESPACE::NodeSerialization* projectSerialization,
                               const SERIALIZATION_NAMESPACE::NodeSerialization* pyPlugSerialization);
 
+    /**
+     * @brief Returns true if the nodes of the sub-graph, except the Input and Output nodes, were not created yet
+     * when loading the project. Their serialization is kept until the group is opened, connected or queried.
+     **/
+    bool isSubGraphDeferred() const;
+
+    /**
+     * @brief Returns the serialization of all the nodes of the sub-graph if isSubGraphDeferred() is true.
+     **/
+    SERIALIZATION_NAMESPACE::NodeSerializationList getDeferredSubGraph() const;
+
+    /**
+     * @brief If isSubGraphDeferred() is true, creates the nodes of the sub-graph from their serialization.
+     * This does nothing if not called on the main thread.
+     **/
+    void createDeferredSubGraph();
+
+    /**
+     * @brief Returns true if the sub-graph of this group may be frozen, see isSubGraphFrozen()
+     **/
+    virtual bool isSubGraphFreezeSupported() const
+    {
+        return isSubGraphPersistent() && !isOutput();
+    }
+
+    /**
+     * @brief Returns true if the sub-graph is frozen: the Output node of the group renders the images
+     * stored when the group was frozen and the sub-graph and the nodes upstream are no longer rendered.
+     **/
+    bool isSubGraphFrozen() const;
+
+    /**
+     * @brief Returns the hash of the sub-graph when it was frozen, this identifies the frozen images.
+     **/
+    U64 getFrozenSubGraphHash() const;
+
+    /**
+     * @brief Returns the file of the cache directory in which the frozen images are stored compressed.
+     **/
+    CompressedTileFilePtr getFrozenSubGraphFile();
+
+    /**
+     * @brief Called when the freeze parameters changed. If preRender is true and the sub-graph is frozen,
+     * the current hash of the sub-graph is recorded and its output is pre-rendered over its frame range.
+     **/
+    void onFreezeSubGraphChanged(bool preRender);
+
+public Q_SLOTS:
+
+    /**
+     * @brief Shows a warning on the node if the sub-graph changed since it was frozen.
+     **/
+    void refreshFrozenSubGraphState();
 
 Q_SIGNALS:
 
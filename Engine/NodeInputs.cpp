@@ -35,6 +35,18 @@
 NATRON_NAMESPACE_ENTER
 
 
+/**
+ * @brief Drops the cached topology of the collection containing the node, called whenever its inputs change
+ **/
+static void
+invalidateGroupTopology(const Node* node)
+{
+    NodeCollectionPtr group = node->getGroup();
+    if (group) {
+        group->invalidateTopology();
+    }
+}
+
 /**
  * @brief Resolves links of the graph in the case of containers (that do not do any rendering but only contain nodes inside)
  * so that algorithms that cycle the tree from bottom to top
@@ -48,6 +60,13 @@ applyNodeRedirectionsUpstream(const NodePtr& node)
     }
     NodeGroupPtr isGrp = node->isEffectNodeGroup();
     if (isGrp) {
+        // A frozen group renders its images from its output node, which does not pull the sub-graph
+        if ( isGrp->isSubGraphFrozen() ) {
+            NodePtr outputNode = isGrp->getOutputNode();
+            if (outputNode) {
+                return outputNode;
+            }
+        }
         //The node is a group, instead jump directly to the output node input of the  group
         return applyNodeRedirectionsUpstream(isGrp->getOutputNodeInput());
     }
@@ -510,6 +529,7 @@ Node::removeInput(int inputNb)
             _imp->inputDescriptions.erase(it);
         }
     }
+    invalidateGroupTopology(this);
     ++_imp->hasModifiedInputsDescription;
     endInputEdition(true);
 }
@@ -524,6 +544,7 @@ Node::removeAllInputs()
         _imp->inputDescriptions.clear();
         _imp->inputIsRenderingCounter.clear();
     }
+    invalidateGroupTopology(this);
     ++_imp->hasModifiedInputsDescription;
     endInputEdition(true);
 }
@@ -645,6 +666,22 @@ Node::isNodeUpstreamInternal(const NodeConstPtr& input, std::set<NodeConstPtr>&
 bool
 Node::isNodeUpstream(const NodeConstPtr& input) const
 {
+    if (!input) {
+        return false;
+    }
+
+    // Walk the cached adjacency of the group when both nodes are in it, this is linear in the number of nodes
+    // between them instead of locking each node inputs and growing a set of pointers
+    NodeCollectionPtr group = getGroup();
+    NodeCollectionTopologyConstPtr topology = group ? group->getTopology() : NodeCollectionTopologyConstPtr();
+    if ( topology && topology->isComplete() ) {
+        int thisIndex = topology->getIndex(this);
+        int inputIndex = topology->getIndex( input.get() );
+        if ( (thisIndex != -1) && (inputIndex != -1) ) {
+            return topology->isUpstream(thisIndex, inputIndex);
+        }
+    }
+
     std::set<NodeConstPtr> markedNodes;
     return isNodeUpstreamInternal(input, markedNodes);
 }
@@ -980,7 +1017,14 @@ Node::connectOutput(const NodePtr& output, int outputInputIndex)
         }
         indices.push_back(outputInputIndex);
     }
+    invalidateGroupTopology(this);
     Q_EMIT outputsChanged();
+
+    // The group may now be rendered: create its nodes. When loading a project, this is done once all nodes are connected.
+    NodeGroupPtr isGroup = isEffectNodeGroup();
+    if ( isGroup && isGroup->isSubGraphDeferred() && !getApp()->getProject()->isLoadingProject() ) {
+        isGroup->createDeferredSubGraph();
+    }
 }
 
 bool
@@ -1025,6 +1069,10 @@ Node::disconnectOutput(const NodePtr& output, int outputInputIndex)
         }
     }
 
+    if (ret) {
+        invalidateGroupTopology(this);
+    }
+
     //Will just refresh the gui
     Q_EMIT outputsChanged();
 
@@ -1269,7 +1317,8 @@ Node::endInputEdition(bool triggerRender)
             Q_EMIT inputsDescriptionChanged();
         }
 
-        if (!getApp()->getProject()->isLoadingProject() && !getApp()->isCreatingNode()) {
+        // When creating a batch of nodes, the metadata are refreshed once at the end and viewers rendered once.
+        if (!getApp()->getProject()->isLoadingProject() && !getApp()->isCreatingNode() && !getApp()->isCreatingNodesBatch()) {
             bool hasChanged = !_imp->inputsModified.empty();
             _imp->inputsModified.clear();
 
@@ -762,7 +762,10 @@ Node::toSerialization(SERIALIZATION_NAMESPACE::SerializationObjectBase* serializ
 
     // For groups, serialize its children if the graph was edited
     NodeGroupPtr isGrp = isEffectNodeGroup();
-    if (isGrp && subGraphEdited) {
+    if (isGrp && subGraphEdited && isGrp->isSubGraphDeferred()) {
+        // The nodes were not created yet and could not have changed since they were loaded
+        serialization->_children = isGrp->getDeferredSubGraph();
+    } else if (isGrp && subGraphEdited) {
         NodesList nodes;
         isGrp->getActiveNodes(&nodes);
 
@@ -1732,6 +1735,12 @@ Node::destroyNode()
     // Free all memory used by the plug-in.
     _imp->effect->clearLastRenderedImage();
 
+    // Release the render clones kept for re-use, they hold a reference to the effect
+    _imp->effect->clearRenderClonesPool();
+
+    // The cache statistics of this node are no longer reachable
+    resetCacheStats();
+
 
     // Run on node deleted Python callback
     AppInstancePtr app = getApp();
@@ -1872,6 +1881,7 @@ Node::getClosestSupportedBitDepth(ImageBitDepthEnum depth)
 
     bool foundShort = false;
     bool foundByte = false;
+    bool foundHalf = false;
     bool foundFloat = false;
 
     std::list<ImageBitDepthEnum> bitdepths = getSupportedBitDepths();
@@ -1882,6 +1892,8 @@ Node::getClosestSupportedBitDepth(ImageBitDepthEnum depth)
             return depth;
         } else if (thisDepth == eImageBitDepthFloat) {
             foundFloat = true;
+        } else if (thisDepth == eImageBitDepthHalf) {
+            foundHalf = true;
         } else if (thisDepth == eImageBitDepthShort) {
             foundShort = true;
         } else if (thisDepth == eImageBitDepthByte) {
@@ -1890,6 +1902,8 @@ Node::getClosestSupportedBitDepth(ImageBitDepthEnum depth)
     }
     if (foundFloat) {
         return eImageBitDepthFloat;
+    } else if (foundHalf) {
+        return eImageBitDepthHalf;
     } else if (foundShort) {
         return eImageBitDepthShort;
     } else if (foundByte) {
@@ -1907,6 +1921,7 @@ Node::getBestSupportedBitDepth() const
 {
     bool foundShort = false;
     bool foundByte = false;
+    bool foundHalf = false;
 
     std::list<ImageBitDepthEnum> bitdepths = getSupportedBitDepths();
 
@@ -1921,6 +1936,7 @@ Node::getBestSupportedBitDepth() const
             foundShort = true;
             break;
             case eImageBitDepthHalf:
+            foundHalf = true;
             break;
 
             case eImageBitDepthFloat:
@@ -1932,7 +1948,9 @@ Node::getBestSupportedBitDepth() const
         }
     }
 
-    if (foundShort) {
+    if (foundHalf) {
+        return eImageBitDepthHalf;
+    } else if (foundShort) {
         return eImageBitDepthShort;
     } else if (foundByte) {
         return eImageBitDepthByte;
@@ -34,6 +34,8 @@
 #include "Engine/KnobItemsTable.h"
 #include "Engine/ImagePlaneDesc.h"
 #include "Engine/Image.h"
+#include "Engine/ImageStorage.h"
+#include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
 #include "Engine/Timer.h"
 #include "Engine/NodeGuiI.h"
@@ -87,6 +89,15 @@ NodePrivate::NodePrivate(Node* publicInterface,
 , streamWarnings()
 , requiresGLFinishBeforeRender(false)
 , lastTimeInvariantMetadataHashRefreshed(0)
+, cacheStatsHolderID(0)
+, renderCostMutex()
+, renderCostPerMB(0)
+, backendRenderCostPerMB()
+, transferCostPerMB(0)
+, memoryBudget(new MemoryBudget)
+, pluginMemoryCache(new PluginMemoryCache)
+, concurrentRendersMutex()
+, sharedByConcurrentRendersCount(0)
 , nodePositionCoords()
 , nodeSize()
 , nodeColor()
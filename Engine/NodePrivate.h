@@ -267,6 +267,27 @@ public:
     // Used in the implementation of EffectInstance::onMetadataChanged_recursive so we know if the metadata changed or not.
     U64 lastTimeInvariantMetadataHashRefreshed;
 
+    // Identifies this node in the CacheStats, never changes
+    U64 cacheStatsHolderID;
+
+    // Moving average of the time spent rendering by this node, in seconds per MiB of output, @see Node::addRenderCost
+    mutable QMutex renderCostMutex;
+    double renderCostPerMB;
+
+    // Same as renderCostPerMB for each backend, and the time spent per MiB to move images between RAM and OpenGL textures
+    double backendRenderCostPerMB[3];
+    double transferCostPerMB;
+
+    // The RAM of the images allocated by the renders of this node, @see Node::getMemoryBudget
+    MemoryBudgetPtr memoryBudget;
+
+    // The memory released by the plug-in, kept for the next renders, @see Node::getPluginMemoryCache
+    PluginMemoryCachePtr pluginMemoryCache;
+
+    // Number of groups of Write nodes rendering concurrently which depend on this node, @see Node::setSharedByConcurrentRenders
+    mutable QMutex concurrentRendersMutex;
+    int sharedByConcurrentRendersCount;
+
     // UI
     mutable QMutex nodeUIDataMutex;
     double nodePositionCoords[2]; // x,y  X=Y=INT_MIN if there is no position info
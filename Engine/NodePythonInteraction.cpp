@@ -597,6 +597,10 @@ Node::declareNodeVariableToPython(const std::string& nodeName)
 
     return;
 #endif
+    if ( !appPTR->isPythonInitialized() ) {
+        // The nodes are declared when Python is initialized, see AppManager::ensurePythonInitialized()
+        return;
+    }
     if (getScriptName_mt_safe().empty()) {
         return;
     }
@@ -640,6 +644,9 @@ Node::setNodeVariableToPython(const std::string& oldName,
 
     return;
 #endif
+    if ( !appPTR->isPythonInitialized() ) {
+        return;
+    }
     if (getScriptName_mt_safe().empty()) {
         return;
     }
@@ -662,6 +669,9 @@ Node::deleteNodeVariableToPython(const std::string& nodeName)
 
     return;
 #endif
+    if ( !appPTR->isPythonInitialized() ) {
+        return;
+    }
     if (getScriptName_mt_safe().empty()) {
         return;
     }
@@ -695,6 +705,9 @@ Node::declarePythonKnobs()
 
     return;
 #endif
+    if ( !appPTR->isPythonInitialized() ) {
+        return;
+    }
     if (getScriptName_mt_safe().empty()) {
         return;
     }
@@ -760,6 +773,9 @@ Node::removeParameterFromPython(const std::string& parameterName)
 
     return;
 #endif
+    if ( !appPTR->isPythonInitialized() ) {
+        return;
+    }
     if (getScriptName_mt_safe().empty()) {
         return;
     }
@@ -24,6 +24,9 @@
 
 #include "NodePrivate.h"
 
+#include <set>
+
+#include "Engine/Half.h"
 #include "Engine/Image.h"
 #include "Engine/Lut.h"
 #include "Engine/TreeRender.h"
@@ -200,8 +203,10 @@ static void renderPreviewInternal(const void* srcPtrs[4],
             renderPreviewForDepth<unsigned short, 65535>(srcPtrs, srcBounds, srcNComps, width, height, convertToSrgb, buf);
             break;
         }
-        case eImageBitDepthHalf:
+        case eImageBitDepthHalf: {
+            renderPreviewForDepth<Half, 1>(srcPtrs, srcBounds, srcNComps, width, height, convertToSrgb, buf);
             break;
+        }
         case eImageBitDepthFloat: {
             renderPreviewForDepth<float, 1>(srcPtrs, srcBounds, srcNComps , width, height, convertToSrgb, buf);
             break;
@@ -296,6 +301,7 @@ Node::makePreviewImage(TimeValue time,
         args->draftMode = false;
         args->playback = false;
         args->byPassCache = false;
+        args->priority = eTreeRenderPriorityPreview;
     }
 
     ImagePtr img;
@@ -370,9 +376,9 @@ Node::isRenderingPreview() const
 
 static void
 refreshPreviewsRecursivelyUpstreamInternal(const NodePtr& node,
-                                           std::list<NodePtr>& marked)
+                                           std::set<NodePtr>& marked)
 {
-    if ( std::find(marked.begin(), marked.end(), node) != marked.end() ) {
+    if ( !marked.insert(node).second ) {
         return;
     }
 
@@ -380,14 +386,12 @@ refreshPreviewsRecursivelyUpstreamInternal(const NodePtr& node,
         node->refreshPreviewImage();
     }
 
-    marked.push_back(node);
-
     std::vector<NodeWPtr> inputs = node->getInputs_copy();
 
     for (std::size_t i = 0; i < inputs.size(); ++i) {
         NodePtr input = inputs[i].lock();
         if (input) {
-            input->refreshPreviewsRecursivelyUpstream();
+            refreshPreviewsRecursivelyUpstreamInternal(input, marked);
         }
     }
 }
@@ -395,16 +399,33 @@ refreshPreviewsRecursivelyUpstreamInternal(const NodePtr& node,
 void
 Node::refreshPreviewsRecursivelyUpstream()
 {
-    std::list<NodePtr> marked;
+    // Use the cached adjacency of the group when it accounts for all the inputs
+    NodeCollectionPtr group = getGroup();
+    NodeCollectionTopologyConstPtr topology = group ? group->getTopology() : NodeCollectionTopologyConstPtr();
+    int thisIndex = ( topology && topology->isComplete() ) ? topology->getIndex(this) : -1;
+    if (thisIndex != -1) {
+        std::vector<int> upstreamNodes;
+        topology->getUpstreamNodes(thisIndex, &upstreamNodes);
+        for (std::size_t i = 0; i < upstreamNodes.size(); ++i) {
+            NodePtr node = topology->getNode(upstreamNodes[i]);
+            if ( node && node->isPreviewEnabled() ) {
+                node->refreshPreviewImage();
+            }
+        }
+
+        return;
+    }
+
+    std::set<NodePtr> marked;
 
     refreshPreviewsRecursivelyUpstreamInternal(shared_from_this(), marked);
 }
 
 static void
 refreshPreviewsRecursivelyDownstreamInternal(const NodePtr& node,
-                                             std::list<NodePtr>& marked)
+                                             std::set<NodePtr>& marked)
 {
-    if ( std::find(marked.begin(), marked.end(), node) != marked.end() ) {
+    if ( !marked.insert(node).second ) {
         return;
     }
 
@@ -412,12 +433,13 @@ refreshPreviewsRecursivelyDownstreamInternal(const NodePtr& node,
         node->refreshPreviewImage();
     }
 
-    marked.push_back(node);
-
+    // The outputs may be in other groups, share the marked nodes across them
     NodesList outputs;
     node->getOutputsWithGroupRedirection(outputs);
     for (NodesList::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
-        (*it)->refreshPreviewsRecursivelyDownstream();
+        if ( (*it)->getNodeGui() ) {
+            refreshPreviewsRecursivelyDownstreamInternal(*it, marked);
+        }
     }
 }
 
@@ -427,7 +449,7 @@ Node::refreshPreviewsRecursivelyDownstream()
     if ( !getNodeGui() ) {
         return;
     }
-    std::list<NodePtr> marked;
+    std::set<NodePtr> marked;
     refreshPreviewsRecursivelyDownstreamInternal(shared_from_this(), marked);
 }
 
@@ -24,6 +24,7 @@
 #include <smmintrin.h>
 #endif
 #include <cmath>
+#include <vector>
 
 #ifndef  SEEXPR_USE_SSE
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -111,7 +112,7 @@ uint32_t hashReduce(uint32_t index[d]) {
 
 //! Noise with d_in dimensional domain, 1 dimensional abcissa
 template <int d, class T, bool periodic>
-T noiseHelper(const T* X, const int* period = 0) {
+T noiseHelper(const T* X, const int* period = 0, NoiseLatticeCache<d>* cache = 0) {
     // find lattice index
     T weights[2][d];  // lower and upper weights
     int index[d];
@@ -127,16 +128,41 @@ T noiseHelper(const T* X, const int* period = 0) {
     }
     // compute function values propagated from zero from each node
     int num = 1 << d;
+
+    // hash to get representative gradient vector of each node, unless the cell is in the cache
+    unsigned char lookups[1 << d];
+    typename NoiseLatticeCache<d>::Entry* entry = 0;
+    bool cached = false;
+    if (cache) {
+        uint32_t h = 0;
+        for (int k = 0; k < d; k++) h = h * 2654435761U + (uint32_t)index[k];
+        entry = &cache->entries[(h * 2654435761U) >> 29];
+        cached = entry->valid;
+        for (int k = 0; k < d && cached; k++) cached = entry->index[k] == index[k];
+        if (cached) {
+            for (int dummy = 0; dummy < num; dummy++) lookups[dummy] = entry->lookup[dummy];
+        }
+    }
+    if (!cached) {
+        for (int dummy = 0; dummy < num; dummy++) {
+            int latticeIndex[d];
+            for (int k = 0; k < d; k++) latticeIndex[k] = index[k] + ((dummy & (1 << k)) != 0);
+            lookups[dummy] = hashReduceChar<d>(latticeIndex);
+        }
+        if (entry) {
+            entry->valid = true;
+            for (int k = 0; k < d; k++) entry->index[k] = index[k];
+            for (int dummy = 0; dummy < num; dummy++) entry->lookup[dummy] = lookups[dummy];
+        }
+    }
+
     T vals[1 << d];
     for (int dummy = 0; dummy < num; dummy++) {
-        int latticeIndex[d];
         int offset[d];
         for (int k = 0; k < d; k++) {
             offset[k] = ((dummy & (1 << k)) != 0);
-            latticeIndex[k] = index[k] + offset[k];
         }
-        // hash to get representative gradient vector
-        int lookup = hashReduceChar<d>(latticeIndex);
+        int lookup = lookups[dummy];
         T val = 0;
         for (int k = 0; k < d; k++) {
             double grad = NOISE_TABLES<d>::g[lookup][k];
@@ -182,21 +208,40 @@ void CellNoise(const T* in, T* out) {
     }
 }
 
-//! Noise with d_in dimensional domain, d_out dimensional abcissa
+//! Noise with d_in dimensional domain, d_out dimensional abcissa, optionally looking up the lattice cells in a cache
 template <int d_in, int d_out, class T>
-void Noise(const T* in, T* out) {
+void noiseImpl(const T* in, T* out, NoiseLatticeCache<d_in>* cache) {
     T P[d_in];
     for (int i = 0; i < d_in; i++) P[i] = in[i];
 
     int i = 0;
     while (1) {
-        out[i] = noiseHelper<d_in, T, false>(P);
+        out[i] = noiseHelper<d_in, T, false>(P, 0, cache);
         if (++i >= d_out) break;
         // coverity[dead_error_begin]
         for (int k = 0; k < d_out; k++) P[k] += (T)1000;
     }
 }
 
+//! Noise with d_in dimensional domain, d_out dimensional abcissa
+template <int d_in, int d_out, class T>
+void Noise(const T* in, T* out) {
+    noiseImpl<d_in, d_out, T>(in, out, 0);
+}
+
+template <int d_in, int d_out, class T>
+void NoiseCached(const T* in, T* out, NoiseLatticeCache<d_in>* cache) {
+    noiseImpl<d_in, d_out, T>(in, out, cache);
+}
+
+template <int d_in, int d_out, class T>
+void NoiseBatch(const T* in, T* out, int count) {
+    NoiseLatticeCache<d_in> cache;
+    for (int i = 0; i < count; i++) {
+        noiseImpl<d_in, d_out, T>(in + i * d_in, out + i * d_out, &cache);
+    }
+}
+
 //! Periodic Noise with d_in dimensional domain, d_out dimensional abcissa
 template <int d_in, int d_out, class T>
 void PNoise(const T* in, const int* period, T* out) {
@@ -214,8 +259,9 @@ void PNoise(const T* in, const int* period, T* out) {
 
 //! Noise with d_in dimensional domain, d_out dimensional abcissa
 //! If turbulence is true then Perlin's turbulence is computed
+//! caches holds the cache of each octave, the octaves beyond cachesCount are not cached
 template <int d_in, int d_out, bool turbulence, class T>
-void FBM(const T* in, T* out, int octaves, T lacunarity, T gain) {
+void fbmImpl(const T* in, T* out, int octaves, T lacunarity, T gain, NoiseLatticeCache<d_in>* caches, int cachesCount) {
     T P[d_in];
     for (int i = 0; i < d_in; i++) P[i] = in[i];
 
@@ -224,7 +270,7 @@ void FBM(const T* in, T* out, int octaves, T lacunarity, T gain) {
     int octave = 0;
     while (1) {
         T localResult[d_out];
-        Noise<d_in, d_out>(P, localResult);
+        noiseImpl<d_in, d_out, T>(P, localResult, octave < cachesCount ? &caches[octave] : 0);
         if (turbulence)
             for (int k = 0; k < d_out; k++) out[k] += fabs(localResult[k]) * scale;
         else
@@ -238,6 +284,45 @@ void FBM(const T* in, T* out, int octaves, T lacunarity, T gain) {
     }
 }
 
+template <int d_in, int d_out, bool turbulence, class T>
+void FBM(const T* in, T* out, int octaves, T lacunarity, T gain) {
+    fbmImpl<d_in, d_out, turbulence, T>(in, out, octaves, lacunarity, gain, 0, 0);
+}
+
+template <int d_in, int d_out, bool turbulence, class T>
+void FBMCached(const T* in, T* out, int octaves, T lacunarity, T gain, NoiseLatticeCache<d_in>* caches, int cachesCount) {
+    fbmImpl<d_in, d_out, turbulence, T>(in, out, octaves, lacunarity, gain, caches, cachesCount);
+}
+
+template <int d_in, int d_out, bool turbulence, class T>
+void FBMBatch(const T* in, T* out, int count, int octaves, T lacunarity, T gain) {
+    if (count <= 0) return;
+    std::vector<T> P(in, in + count * d_in);
+    for (int i = 0; i < count * d_out; i++) out[i] = 0;
+
+    // Going through all the positions for an octave before the next one keeps the lattice cells of the octave in the cache
+    NoiseLatticeCache<d_in> cache;
+    T scale = 1;
+    int octave = 0;
+    while (1) {
+        for (int i = 0; i < count; i++) {
+            T localResult[d_out];
+            noiseImpl<d_in, d_out, T>(&P[i * d_in], localResult, &cache);
+            T* sampleOut = out + i * d_out;
+            if (turbulence)
+                for (int k = 0; k < d_out; k++) sampleOut[k] += fabs(localResult[k]) * scale;
+            else
+                for (int k = 0; k < d_out; k++) sampleOut[k] += localResult[k] * scale;
+        }
+        if (++octave >= octaves) break;
+        scale *= gain;
+        for (int i = 0; i < count * d_in; i++) {
+            P[i] *= lacunarity;
+            P[i] += (T)1234;
+        }
+    }
+}
+
 // Explicit instantiations
 template void CellNoise<3, 1, double>(const double*, double*);
 template void CellNoise<3, 3, double>(const double*, double*);
@@ -254,6 +339,22 @@ template void FBM<3, 3, false, double>(const double*, double*, int, double, doub
 template void FBM<3, 3, true, double>(const double*, double*, int, double, double);
 template void FBM<4, 1, false, double>(const double*, double*, int, double, double);
 template void FBM<4, 3, false, double>(const double*, double*, int, double, double);
+template void NoiseCached<1, 1, double>(const double*, double*, NoiseLatticeCache<1>*);
+template void NoiseCached<2, 1, double>(const double*, double*, NoiseLatticeCache<2>*);
+template void NoiseCached<3, 1, double>(const double*, double*, NoiseLatticeCache<3>*);
+template void NoiseCached<4, 1, double>(const double*, double*, NoiseLatticeCache<4>*);
+template void NoiseCached<3, 3, double>(const double*, double*, NoiseLatticeCache<3>*);
+template void FBMCached<3, 1, false, double>(const double*, double*, int, double, double, NoiseLatticeCache<3>*, int);
+template void FBMCached<3, 1, true, double>(const double*, double*, int, double, double, NoiseLatticeCache<3>*, int);
+template void NoiseBatch<1, 1, double>(const double*, double*, int);
+template void NoiseBatch<2, 1, double>(const double*, double*, int);
+template void NoiseBatch<3, 1, double>(const double*, double*, int);
+template void NoiseBatch<4, 1, double>(const double*, double*, int);
+template void NoiseBatch<3, 3, double>(const double*, double*, int);
+template void FBMBatch<3, 1, false, double>(const double*, double*, int, int, double, double);
+template void FBMBatch<3, 1, true, double>(const double*, double*, int, int, double, double);
+template void FBMBatch<3, 3, false, double>(const double*, double*, int, int, double, double);
+template void FBMBatch<3, 3, true, double>(const double*, double*, int, int, double, double);
 NATRON_NAMESPACE_EXIT
 
 #ifdef MAINTEST
@@ -65,6 +65,48 @@ void FBM(const T* in, T* out, int octaves, T lacunarity, T gain);
 template <int d_in, int d_out, class T>
 void CellNoise(const T* in, T* out);
 
+//! The hashed gradients of the lattice cells last used by a noise function.
+//! The successive samples of a noise over time (e.g. noise(frame / 10) for each frame of a range or each motion blur
+//! sample) mostly fall in the same cells: with a cache the corners of a cell are hashed once instead of once per sample.
+template <int d>
+struct NoiseLatticeCache
+{
+    enum { kEntries = 8 };
+
+    struct Entry
+    {
+        bool valid;
+        int index[d];
+        unsigned char lookup[1 << d];
+    };
+
+    Entry entries[kEntries];
+
+    NoiseLatticeCache()
+    {
+        for (int i = 0; i < kEntries; ++i) {
+            entries[i].valid = false;
+        }
+    }
+};
+
+//! Same as Noise, the lattice cells are looked up in the cache first
+template <int d_in, int d_out, class T>
+void NoiseCached(const T* in, T* out, NoiseLatticeCache<d_in>* cache);
+
+//! Same as FBM, caches holds one cache per octave (at most 8)
+template <int d_in, int d_out, bool turbulence, class T>
+void FBMCached(const T* in, T* out, int octaves, T lacunarity, T gain, NoiseLatticeCache<d_in>* caches, int cachesCount);
+
+//! Noise at count positions: in holds count * d_in coordinates and out receives count * d_out values,
+//! the same as calling Noise for each position. The cells shared by consecutive positions are hashed once.
+template <int d_in, int d_out, class T>
+void NoiseBatch(const T* in, T* out, int count);
+
+//! FBM at count positions, see NoiseBatch. All the positions are evaluated one octave after the other.
+template <int d_in, int d_out, bool turbulence, class T>
+void FBMBatch(const T* in, T* out, int count, int octaves, T lacunarity, T gain);
+
 NATRON_NAMESPACE_EXIT
 
 #endif // NATRON_ENGINE_NOISE_H
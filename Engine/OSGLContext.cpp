@@ -25,6 +25,7 @@
 
 #include "OSGLContext.h"
 
+#include <algorithm> // min
 #include <stdexcept>
 #include <sstream> // stringstream
 #include <cstring> // strlen
@@ -49,9 +50,17 @@
 
 #include "Engine/AppManager.h"
 #include "Engine/GPUContextPool.h"
+#include "Engine/GPUImageCache.h"
+#include "Engine/Texture.h"
 
 #include "Global/GLIncludes.h"
 
+// Maximum amount of VRAM held by the idle textures of a context
+#define NATRON_GL_TEXTURE_POOL_MAX_BYTES (256 * 1024 * 1024)
+
+// Maximum number of idle textures kept by a context
+#define NATRON_GL_TEXTURE_POOL_MAX_COUNT 32
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -113,6 +122,22 @@ static const char* copyUnprocessedChannels_FragmentShader =
 "#endif\n"
 "}";
 
+// The per-pixel operations applied to the output of a render are composed in a single fragment shader,
+// see composePostProcessFragmentShader
+static const char* postProcess_FragmentShaderHeader =
+"uniform sampler2D originalImageTex;\n"
+"uniform sampler2D outputImageTex;\n"
+"uniform sampler2D maskImageTex;\n"
+"uniform float mixValue;\n"
+"\n"
+"void main() {\n"
+"   vec4 srcColor = texture2D(originalImageTex,gl_TexCoord[0].st);\n"
+"   vec4 color = texture2D(outputImageTex,gl_TexCoord[0].st);\n";
+
+static const char* postProcess_FragmentShaderFooter =
+"   gl_FragColor = color;\n"
+"}";
+
 static  const char* copyTex_FragmentShader =
 "uniform sampler2D srcTex;\n"
 "void main() {\n"
@@ -315,6 +340,19 @@ struct OSGLContextPrivate
     std::vector<GLShaderBasePtr> applyMaskMixShader;
     std::vector<GLShaderBasePtr> copyUnprocessedChannelsShader;
 
+    // One shader per combination of operations, see getOrCreatePostProcessShader
+    std::vector<GLShaderBasePtr> postProcessShader;
+
+    // Textures released by images, the least recently released first. Protected by texturePoolMutex
+    mutable QMutex texturePoolMutex;
+    std::list<GLTexturePtr> texturePool;
+    std::size_t texturePoolBytes;
+
+    // VRAM accounting, protected by videoMemoryMutex. See addVideoMemoryAllocation
+    mutable QMutex videoMemoryMutex;
+    std::size_t videoMemoryBytes;
+    std::size_t videoMemoryBudget;
+
     OSGLContextPrivate(bool useGPUContext)
         : useGPUContext(useGPUContext)
         , _platformContext()
@@ -334,6 +372,13 @@ struct OSGLContextPrivate
         , fillImageShader()
         , applyMaskMixShader(4)
         , copyUnprocessedChannelsShader(16)
+        , postProcessShader(128)
+        , texturePoolMutex()
+        , texturePool()
+        , texturePoolBytes(0)
+        , videoMemoryMutex()
+        , videoMemoryBytes(0)
+        , videoMemoryBudget(0)
     {
 
     }
@@ -413,6 +458,7 @@ OSGLContext::~OSGLContext()
             GL_CPU::DeleteFramebuffers(1, &_imp->fboID);
         }
     }
+    clearTexturePool();
 
 }
 
@@ -549,6 +595,133 @@ OSGLContext::getOrCreateFBOId()
     return _imp->fboID;
 }
 
+GLTexturePtr
+OSGLContext::takePooledTexture(U32 target,
+                               int width,
+                               int height,
+                               int internalFormat)
+{
+    QMutexLocker k(&_imp->texturePoolMutex);
+
+    // Use the most recently released texture, it is more likely to still be resident in VRAM
+    for (std::list<GLTexturePtr>::reverse_iterator it = _imp->texturePool.rbegin(); it != _imp->texturePool.rend(); ++it) {
+        if ( (*it)->getTexTarget() == (int)target && (*it)->w() == width && (*it)->h() == height && (*it)->getInternalFormat() == internalFormat ) {
+            GLTexturePtr ret = *it;
+            _imp->texturePoolBytes -= ret->getSize();
+            _imp->texturePool.erase( --(it.base()) );
+            return ret;
+        }
+    }
+    return GLTexturePtr();
+}
+
+void
+OSGLContext::releasePooledTexture(const GLTexturePtr& texture)
+{
+    assert(texture);
+    std::list<GLTexturePtr> toDelete;
+    {
+        QMutexLocker k(&_imp->texturePoolMutex);
+        if (texture->getSize() > NATRON_GL_TEXTURE_POOL_MAX_BYTES) {
+            // The caller deletes it
+            removeVideoMemoryAllocation( texture->getSize() );
+            return;
+        }
+        _imp->texturePool.push_back(texture);
+        _imp->texturePoolBytes += texture->getSize();
+
+        // Trim the least recently released textures
+        while ( _imp->texturePoolBytes > NATRON_GL_TEXTURE_POOL_MAX_BYTES || _imp->texturePool.size() > NATRON_GL_TEXTURE_POOL_MAX_COUNT ) {
+            _imp->texturePoolBytes -= _imp->texturePool.front()->getSize();
+            removeVideoMemoryAllocation( _imp->texturePool.front()->getSize() );
+            toDelete.push_back( _imp->texturePool.front() );
+            _imp->texturePool.pop_front();
+        }
+    }
+    // The textures are deleted here, with the context current
+}
+
+void
+OSGLContext::clearTexturePool()
+{
+    std::list<GLTexturePtr> toDelete;
+    {
+        QMutexLocker k(&_imp->texturePoolMutex);
+        toDelete.swap(_imp->texturePool);
+        removeVideoMemoryAllocation(_imp->texturePoolBytes);
+        _imp->texturePoolBytes = 0;
+    }
+}
+
+std::size_t
+OSGLContext::getTexturePoolSize() const
+{
+    QMutexLocker k(&_imp->texturePoolMutex);
+    return _imp->texturePoolBytes;
+}
+
+void
+OSGLContext::addVideoMemoryAllocation(std::size_t nBytes)
+{
+    QMutexLocker k(&_imp->videoMemoryMutex);
+    _imp->videoMemoryBytes += nBytes;
+}
+
+void
+OSGLContext::removeVideoMemoryAllocation(std::size_t nBytes)
+{
+    QMutexLocker k(&_imp->videoMemoryMutex);
+    assert(_imp->videoMemoryBytes >= nBytes);
+    _imp->videoMemoryBytes -= std::min(nBytes, _imp->videoMemoryBytes);
+}
+
+std::size_t
+OSGLContext::getVideoMemoryAllocated() const
+{
+    QMutexLocker k(&_imp->videoMemoryMutex);
+    return _imp->videoMemoryBytes;
+}
+
+void
+OSGLContext::setVideoMemoryBudget(std::size_t nBytes)
+{
+    QMutexLocker k(&_imp->videoMemoryMutex);
+    _imp->videoMemoryBudget = nBytes;
+}
+
+std::size_t
+OSGLContext::getVideoMemoryBudget() const
+{
+    QMutexLocker k(&_imp->videoMemoryMutex);
+    return _imp->videoMemoryBudget;
+}
+
+bool
+OSGLContext::reserveVideoMemory(std::size_t nBytes)
+{
+    const std::size_t budget = getVideoMemoryBudget();
+    if ( (budget == 0) || (getVideoMemoryAllocated() + nBytes <= budget) ) {
+        return true;
+    }
+
+    OSGLContextSaver saveCurrentContext;
+    OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create( shared_from_this() );
+    contextAttacher->attach();
+
+    // Idle textures hold no image: delete them first
+    clearTexturePool();
+    std::size_t allocated = getVideoMemoryAllocated();
+    if (allocated + nBytes <= budget) {
+        return true;
+    }
+
+    // The textures of the cached images are given back to the pool
+    appPTR->getGPUContextPool()->getImageCache()->freeContextMemory(shared_from_this(), allocated + nBytes - budget);
+    clearTexturePool();
+
+    return getVideoMemoryAllocated() + nBytes <= budget;
+} // reserveVideoMemory
+
 void
 OSGLContext::makeGPUContextCurrent()
 {
@@ -893,6 +1066,81 @@ getOrCreateCopyUnprocessedChannelsShaderInternal(bool doR,
 } // OSGLContext::getOrCreateCopyUnprocessedChannelsShader
 
 
+/**
+ * @brief Returns the code of a fragment shader applying the given operations in order: copying channels from the original
+ * image, then mixing with the original image, optionally by a mask. Each operation reads and writes the color variable
+ * so that the output texture is read and written only once.
+ **/
+static std::string
+composePostProcessFragmentShader(std::bitset<4> copyChannels,
+                                 bool doMix,
+                                 bool maskEnabled,
+                                 bool maskInvert)
+{
+    static const char* channelNames[4] = { "r", "g", "b", "a" };
+
+    std::string source(postProcess_FragmentShaderHeader);
+
+    for (int i = 0; i < 4; ++i) {
+        if (copyChannels[i]) {
+            source += std::string("   color.") + channelNames[i] + " = srcColor." + channelNames[i] + ";\n";
+        }
+    }
+
+    if (doMix) {
+        if (maskEnabled) {
+            source += "   float maskValue = texture2D(maskImageTex,gl_TexCoord[0].st).a;\n";
+            if (maskInvert) {
+                source += "   maskValue = 1.0 - maskValue;\n";
+            }
+            source += "   float alpha = mixValue * maskValue;\n";
+        } else {
+            source += "   float alpha = mixValue;\n";
+        }
+        source += "   color = color * alpha + (1.0 - alpha) * srcColor;\n";
+    }
+
+    source += postProcess_FragmentShaderFooter;
+
+    return source;
+} // composePostProcessFragmentShader
+
+template <typename GL>
+static boost::shared_ptr<GLShader<GL> >
+getOrCreatePostProcessShaderInternal(std::bitset<4> copyChannels,
+                                     bool doMix,
+                                     bool maskEnabled,
+                                     bool maskInvert)
+{
+    boost::shared_ptr<GLShader<GL> > shader = boost::make_shared<GLShader<GL> >();
+
+    std::string fragmentSource = composePostProcessFragmentShader(copyChannels, doMix, maskEnabled, maskInvert);
+
+#ifdef DEBUG
+    std::string error;
+    bool ok = shader->addShader(GLShader<GL>::eShaderTypeFragment, fragmentSource.c_str(), &error);
+    if (!ok) {
+        qDebug() << error.c_str();
+    }
+#else
+    bool ok = shader->addShader(GLShader<GL>::eShaderTypeFragment, fragmentSource.c_str(), 0);
+#endif
+    assert(ok);
+#ifdef DEBUG
+    ok = shader->link(&error);
+    if (!ok) {
+        qDebug() << error.c_str();
+    }
+#else
+    ok = shader->link();
+#endif
+    assert(ok);
+    Q_UNUSED(ok);
+
+    return shader;
+} // getOrCreatePostProcessShaderInternal
+
+
 GLShaderBasePtr
 OSGLContext::getOrCreateCopyTexShader()
 {
@@ -972,6 +1220,32 @@ OSGLContext::getOrCreateCopyUnprocessedChannelsShader(bool doR,
 
 }
 
+GLShaderBasePtr
+OSGLContext::getOrCreatePostProcessShader(std::bitset<4> copyChannels,
+                                          bool doMix,
+                                          bool maskEnabled,
+                                          bool maskInvert)
+{
+    // The mask is only read when mixing
+    maskEnabled &= doMix;
+    maskInvert &= maskEnabled;
+
+    // The combination identifies the shader
+    int index = (int)copyChannels.to_ulong() | int(doMix) << 4 | int(maskEnabled) << 5 | int(maskInvert) << 6;
+    assert( index < (int)_imp->postProcessShader.size() );
+
+    if (_imp->postProcessShader[index]) {
+        return _imp->postProcessShader[index];
+    }
+    if (_imp->useGPUContext) {
+        _imp->postProcessShader[index] = getOrCreatePostProcessShaderInternal<GL_GPU>(copyChannels, doMix, maskEnabled, maskInvert);
+    } else {
+        _imp->postProcessShader[index] = getOrCreatePostProcessShaderInternal<GL_CPU>(copyChannels, doMix, maskEnabled, maskInvert);
+    }
+
+    return _imp->postProcessShader[index];
+}
+
 
 OSGLContextAttacher::OSGLContextAttacher(const OSGLContextPtr& c)
 : _c(c)
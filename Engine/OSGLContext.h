@@ -33,6 +33,7 @@
 #include <boost/weak_ptr.hpp>
 #endif
 
+#include <bitset>
 #include <cstddef>
 #include <string>
 #include <vector>
@@ -47,6 +48,7 @@
 #include "Engine/GLShader.h"
 #include "Engine/RectI.h"
 #include "Global/GLIncludes.h"
+#include "Global/GlobalDefines.h"
 
 #include "Engine/EngineFwd.h"
 
@@ -125,6 +127,57 @@ public:
 
     unsigned int getOrCreateFBOId();
 
+    /**
+     * @brief Returns an idle texture of this context with the given size and format, or NULL if there is none.
+     * Creating and deleting textures for each image is expensive on most drivers and fragments VRAM:
+     * the textures of the images are recycled instead, @see GLImageStorage.
+     * The content of the returned texture is undefined.
+     **/
+    GLTexturePtr takePooledTexture(U32 target, int width, int height, int internalFormat);
+
+    /**
+     * @brief Keeps the given texture for a later call to takePooledTexture(). The least recently released textures
+     * are deleted when the pool is full, hence the context must be current.
+     **/
+    void releasePooledTexture(const GLTexturePtr& texture);
+
+    /**
+     * @brief Deletes all idle textures. The context must be current.
+     **/
+    void clearTexturePool();
+
+    /**
+     * @brief Returns the amount of VRAM held by idle textures, in bytes
+     **/
+    std::size_t getTexturePoolSize() const;
+
+    /**
+     * @brief Accounts the buffers allocated in this context by Natron, i.e the textures of the images,
+     * including the idle ones, and their pixel pack buffers.
+     **/
+    void addVideoMemoryAllocation(std::size_t nBytes);
+    void removeVideoMemoryAllocation(std::size_t nBytes);
+
+    /**
+     * @brief Returns the amount of VRAM accounted with addVideoMemoryAllocation(), in bytes
+     **/
+    std::size_t getVideoMemoryAllocated() const;
+
+    /**
+     * @brief The amount of VRAM the renders may allocate in this context, in bytes, or 0 if it is unknown in
+     * which case allocations are never refused.
+     **/
+    void setVideoMemoryBudget(std::size_t nBytes);
+    std::size_t getVideoMemoryBudget() const;
+
+    /**
+     * @brief Makes room to allocate nBytes in this context without exceeding the budget: idle textures are deleted,
+     * then the least recently used textures of the GPU image cache are moved to the tile cache.
+     * Returns false if the allocation would still exceed the budget.
+     * This makes the context current to the calling thread.
+     **/
+    bool reserveVideoMemory(std::size_t nBytes);
+
 
     // Helper functions used by platform dependent implementations
     static bool stringInExtensionString(const char* string, const char* extensions);
@@ -141,6 +194,17 @@ public:
                                                              bool doB,
                                                              bool doA);
 
+    /**
+     * @brief Returns a shader applying in a single pass the operations done on the output of a render:
+     * the given channels are copied from the original image, then if doMix is true the result is mixed with the original image,
+     * by a mask if maskEnabled is true. One shader is generated for each combination and then re-used.
+     * It has the same uniforms as the mask mix shader.
+     **/
+    GLShaderBasePtr getOrCreatePostProcessShader(std::bitset<4> copyChannels,
+                                                 bool doMix,
+                                                 bool maskEnabled,
+                                                 bool maskInvert);
+
 
 
     static void unsetCurrentContextNoRenderInternal(bool useGPU, OSGLContext* context);
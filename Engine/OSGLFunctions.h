@@ -617,6 +617,9 @@ class OSGLFunctions
     PFNGLBLITFRAMEBUFFERPROC _glBlitFramebuffer;
     PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC _glRenderbufferStorageMultisample;
     PFNGLFRAMEBUFFERTEXTURELAYERPROC _glFramebufferTextureLayer;
+    PFNGLGETPROGRAMBINARYPROC _glGetProgramBinary;
+    PFNGLPROGRAMBINARYPROC _glProgramBinary;
+    PFNGLPROGRAMPARAMETERIPROC _glProgramParameteri;
     PFNGLISRENDERBUFFEREXTPROC _glIsRenderbufferEXT;
     PFNGLBINDRENDERBUFFEREXTPROC _glBindRenderbufferEXT;
     PFNGLDELETERENDERBUFFERSEXTPROC _glDeleteRenderbuffersEXT;
@@ -4456,6 +4459,30 @@ public:
         getInstance()._glFramebufferTextureLayer(target, attachment, texture, level, layer);
     }
 
+    static void GetProgramBinary(GLuint program,
+                                   GLsizei bufSize,
+                                   GLsizei* length,
+                                   GLenum* binaryFormat,
+                                   void* binary)
+    {
+        getInstance()._glGetProgramBinary(program, bufSize, length, binaryFormat, binary);
+    }
+
+    static void ProgramBinary(GLuint program,
+                                GLenum binaryFormat,
+                                const void* binary,
+                                GLsizei length)
+    {
+        getInstance()._glProgramBinary(program, binaryFormat, binary, length);
+    }
+
+    static void ProgramParameteri(GLuint program,
+                                    GLenum pname,
+                                    GLint value)
+    {
+        getInstance()._glProgramParameteri(program, pname, value);
+    }
+
     static GLboolean IsRenderbufferEXT(GLuint renderbuffer)
     {
         return getInstance()._glIsRenderbufferEXT(renderbuffer);
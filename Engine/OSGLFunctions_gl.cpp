@@ -589,6 +589,9 @@ void OSGLFunctions<true>::load_functions() {
     _glBlitFramebuffer = glad_defined(glBlitFramebuffer);
     _glRenderbufferStorageMultisample = glad_defined(glRenderbufferStorageMultisample);
     _glFramebufferTextureLayer = glad_defined(glFramebufferTextureLayer);
+    _glGetProgramBinary = glad_defined(glGetProgramBinary);
+    _glProgramBinary = glad_defined(glProgramBinary);
+    _glProgramParameteri = glad_defined(glProgramParameteri);
     _glIsRenderbufferEXT = glad_defined(glIsRenderbufferEXT);
     _glBindRenderbufferEXT = glad_defined(glBindRenderbufferEXT);
     _glDeleteRenderbuffersEXT = glad_defined(glDeleteRenderbuffersEXT);
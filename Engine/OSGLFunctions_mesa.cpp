@@ -594,6 +594,9 @@ void OSGLFunctions<false>::load_functions() {
     _glBlitFramebuffer = (PFNGLBLITFRAMEBUFFERPROC)OSMesaGetProcAddress("glBlitFramebuffer");
     _glRenderbufferStorageMultisample = (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC)OSMesaGetProcAddress("glRenderbufferStorageMultisample");
     _glFramebufferTextureLayer = (PFNGLFRAMEBUFFERTEXTURELAYERPROC)OSMesaGetProcAddress("glFramebufferTextureLayer");
+    _glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)OSMesaGetProcAddress("glGetProgramBinary");
+    _glProgramBinary = (PFNGLPROGRAMBINARYPROC)OSMesaGetProcAddress("glProgramBinary");
+    _glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)OSMesaGetProcAddress("glProgramParameteri");
     _glIsRenderbufferEXT = (PFNGLISRENDERBUFFEREXTPROC)OSMesaGetProcAddress("glIsRenderbufferEXT");
     _glBindRenderbufferEXT = (PFNGLBINDRENDERBUFFEREXTPROC)OSMesaGetProcAddress("glBindRenderbufferEXT");
     _glDeleteRenderbuffersEXT = (PFNGLDELETERENDERBUFFERSEXTPROC)OSMesaGetProcAddress("glDeleteRenderbuffersEXT");
@@ -61,6 +61,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/EffectDescription.h"
+#include "Engine/ColorTransform.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/Distortion2D.h"
 #include "Engine/EffectInstanceTLSData.h"
@@ -79,6 +80,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoLayer.h"
 #include "Engine/TimeLine.h"
 #include "Engine/TLSHolder.h"
+#include "Engine/TraceRecorder.h"
 #include "Engine/Transform.h"
 #include "Engine/TreeRender.h"
 #include "Engine/UndoCommand.h"
@@ -360,6 +362,7 @@ OfxEffectInstance::describePlugin()
         effectDesc->setProperty(kEffectPropImageBufferLayout, eImageBufferLayoutRGBAPackedFullRect);
         effectDesc->setProperty(kEffectPropSupportsCanReturnDistortion, (bool)desc->getProps().getIntProperty(kOfxImageEffectPropCanDistort));
         effectDesc->setProperty(kEffectPropSupportsCanReturn3x3Transform, (bool)desc->getProps().getIntProperty(kFnOfxImageEffectCanTransform));
+        effectDesc->setProperty(kEffectPropSupportsCanReturnColorTransform, (bool)desc->getProps().getIntProperty(kNatronOfxImageEffectPropCanColorTransform));
         effectDesc->setProperty(kEffectPropSupportsTiles, (bool)desc->getProps().getIntProperty(kOfxImageEffectPropSupportsTiles));
         effectDesc->setProperty(kEffectPropSupportsMultiResolution, (bool)desc->getProps().getIntProperty(kOfxImageEffectPropSupportsMultiResolution));
         effectDesc->setProperty(kEffectPropTemporalImageAccess, (bool)desc->getProps().getIntProperty(kOfxImageEffectPropTemporalClipAccess));
@@ -1187,7 +1190,14 @@ OfxEffectInstance::getRegionOfDefinition(TimeValue time,
     ThreadIsActionCaller_RAII actionCaller(toOfxEffectInstance(shared_from_this()));
 
     OfxRectD ofxRod;
-    OfxStatus stat = _imp->common->effect->getRegionOfDefinitionAction(time, scale, view, ofxRod);
+    OfxStatus stat;
+    {
+        TraceSpan_RAII traceSpan(eTraceCategoryOFX, kOfxImageEffectActionGetRegionOfDefinition);
+        if ( traceSpan.isRecording() ) {
+            traceSpan.setDetail( getScriptName_mt_safe() );
+        }
+        stat = _imp->common->effect->getRegionOfDefinitionAction(time, scale, view, ofxRod);
+    }
     if (stat == kOfxStatFailed) {
         return eActionStatusFailed;
     }
@@ -1307,6 +1317,10 @@ OfxEffectInstance::getRegionsOfInterest(TimeValue time,
         rectToOfxRectD(renderWindow, &roi);
 
         assert(_imp->common->effect);
+        TraceSpan_RAII traceSpan(eTraceCategoryOFX, kOfxImageEffectActionGetRegionsOfInterest);
+        if ( traceSpan.isRecording() ) {
+            traceSpan.setDetail( getScriptName_mt_safe() );
+        }
         stat = _imp->common->effect->getRegionOfInterestAction( (OfxTime)time, scale, view,
                                                         roi, inputRois );
     }
@@ -1521,6 +1535,10 @@ OfxEffectInstance::isIdentity(TimeValue time,
 
         identityPlaneOfx = ImagePlaneDesc::mapPlaneToOFXPlaneString(plane);
         ThreadIsActionCaller_RAII actionCaller(toOfxEffectInstance(shared_from_this()));
+        TraceSpan_RAII traceSpan(eTraceCategoryOFX, kOfxImageEffectActionIsIdentity);
+        if ( traceSpan.isRecording() ) {
+            traceSpan.setDetail( getScriptName_mt_safe() );
+        }
         stat = _imp->common->effect->isIdentityAction(identityTimeOfx, field, ofxRoI, scale, identityViewOfx, identityPlaneOfx, inputclip);
         assert(stat != kOfxStatErrBadHandle);
         if (stat == kOfxStatFailed || stat == kOfxStatErrBadHandle) {
@@ -1724,6 +1742,11 @@ OfxEffectInstance::render(const RenderActionArgs& args)
 
         ThreadIsActionCaller_RAII actionCaller(toOfxEffectInstance(shared_from_this()));
 
+        // The readers and writers spend their render decoding and encoding files
+        TraceSpan_RAII traceSpan( (isReader() || isWriter()) ? eTraceCategoryIO : eTraceCategoryOFX, kOfxImageEffectActionRender );
+        if ( traceSpan.isRecording() ) {
+            traceSpan.setDetail( getScriptName_mt_safe() );
+        }
         stat = _imp->common->effect->renderAction((OfxTime)args.time,
                                           field,
                                           ofxRoI,
@@ -2154,6 +2177,8 @@ OfxEffectInstance::refreshDynamicProperties()
     desc.setProperty(kEffectPropSupportsMultiResolution, multiResSupport);
     desc.setProperty(kEffectPropSupportsCanReturnDistortion, distortionSupport);
     desc.setProperty(kEffectPropSupportsCanReturn3x3Transform, transformSupport);
+    // Only set on the descriptor, the instance cannot change it
+    desc.setProperty(kEffectPropSupportsCanReturnColorTransform, getCanColorTransform());
 
     updateProperties(desc);
 } // refreshDynamicProperties
@@ -2356,7 +2381,49 @@ OfxEffectInstance::getInverseDistortion(TimeValue time,
     }
 
     return eActionStatusOK;
-}
+} // getInverseDistortion
+
+ActionRetCodeEnum
+OfxEffectInstance::getColorTransform(TimeValue time,
+                                     ViewIdx view,
+                                     ColorTransform* transform)
+{
+    EffectInstanceTLSDataPtr tls = _imp->common->tlsData->getOrCreateTLSData();
+    if (tls->hasActionInStack(kNatronOfxImageEffectActionGetColorTransform)) {
+        return eActionStatusFailed;
+    }
+    EffectActionArgsSetter_RAII actionArgsTls(tls, kNatronOfxImageEffectActionGetColorTransform, time, view, RenderScale(1.)
+#ifdef DEBUG
+                                              , /*canSetValue*/ false
+                                              , /*canBeCalledRecursively*/ true
+#endif
+
+                                              );
+    ThreadIsActionCaller_RAII actionCaller(toOfxEffectInstance(shared_from_this()));
+
+    std::string clipName;
+    OfxStatus stat;
+    try {
+        stat = effectInstance()->getColorTransformAction( (OfxTime)time, view, clipName, transform );
+    } catch (...) {
+        return eActionStatusFailed;
+    }
+
+    if (stat == kOfxStatReplyDefault) {
+        return eActionStatusReplyDefault;
+    } else if (stat != kOfxStatOK) {
+        return eActionStatusFailed;
+    }
+
+    OFX::Host::ImageEffect::ClipInstance* clip = effectInstance()->getClip(clipName);
+    OfxClipInstance* natronClip = dynamic_cast<OfxClipInstance*>(clip);
+    if (!natronClip || natronClip->isOutput()) {
+        return eActionStatusFailed;
+    }
+    transform->inputNbToTransform = natronClip->getInputNb();
+
+    return eActionStatusOK;
+} // getColorTransform
 
 
 int
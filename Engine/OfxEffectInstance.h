@@ -234,6 +234,9 @@ public:
                                             bool draftRender,
                                             ViewIdx view,
                                             DistortionFunction2D* distortion) OVERRIDE FINAL WARN_UNUSED_RETURN;
+    virtual ActionRetCodeEnum getColorTransform(TimeValue time,
+                                                ViewIdx view,
+                                                ColorTransform* transform) OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual void onPropertiesChanged(const EffectDescription& description) OVERRIDE FINAL;
     virtual void refreshDynamicProperties() OVERRIDE FINAL;
 
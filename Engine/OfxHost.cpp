@@ -34,6 +34,7 @@
 #include <cctype> // tolower
 #include <algorithm> // transform, min, max
 #include <string>
+#include <vector>
 #include <cstring> // for std::memcpy, std::memset, std::strcmp
 
 CLANG_DIAG_OFF(deprecated)
@@ -42,18 +43,21 @@ CLANG_DIAG_OFF(deprecated-register) //'register' storage class specifier is depr
 CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QMutex>
 #include <QtCore/QThreadPool>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
 #include <QtCore/QTemporaryFile>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 CLANG_DIAG_ON(deprecated-register)
 CLANG_DIAG_ON(uninitialized)
 
 #ifdef OFX_SUPPORTS_MULTITHREAD
 #include <QtCore/QThread>
 #include <QtCore/QThreadStorage>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 // /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
@@ -782,6 +786,45 @@ getPluginShortcuts(const OFX::Host::ImageEffect::Descriptor& desc, std::list<Plu
     }
 } // getPluginShortcuts
 
+/**
+ * @brief Reads the whole binary of a plug-in so that its pages are in the file-system cache of the OS when the plug-in
+ * cache loads it. No code of the plug-in is run, which makes it safe to do from any thread.
+ **/
+static void
+prefetchPluginBinary(QString& filePath)
+{
+    QFile file(filePath);
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return;
+    }
+    std::vector<char> buffer(1024 * 1024);
+    while (file.read(&buffer[0], (qint64)buffer.size()) > 0) {
+    }
+}
+
+/**
+ * @brief Appends to files the binaries of the OpenFX bundles found in the given directory which were modified after the
+ * given time, or all of them if the time is invalid. Those are the ones the plug-in cache will load to describe them.
+ **/
+static void
+findPluginBinariesModifiedSince(const QString& dirPath,
+                                const QDateTime& time,
+                                QStringList* files)
+{
+    const QString bundleContents = QString::fromUtf8(".ofx.bundle/Contents/");
+    QDirIterator it(dirPath, QStringList() << QString::fromUtf8("*.ofx"), QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+    while ( it.hasNext() ) {
+        QString filePath = it.next();
+        if ( !filePath.contains(bundleContents) ) {
+            continue;
+        }
+        if ( time.isValid() && (it.fileInfo().lastModified() < time) ) {
+            continue;
+        }
+        files->push_back(filePath);
+    }
+}
+
 static inline
 QDebug operator<<(QDebug dbg, const std::list<std::string> &l)
 {
@@ -868,6 +911,27 @@ OfxHost::loadOFXPlugins()
     }
 
     qDebug() << "Load OFX Plugins: plugin path is" << pluginCache->getPluginPath();
+
+    // Loading the binaries of the plug-ins that are not in the cache is mostly bound by the reads from the disk,
+    // which can be very slow on a network file-system. Read them all concurrently beforehand: the plug-in cache
+    // still loads and describes them one after the other on the main thread, as some plug-ins require.
+    {
+        QDateTime cacheTime;
+        QFileInfo cacheInfo(ofxCacheFilePath);
+        if ( cacheInfo.exists() ) {
+            cacheTime = cacheInfo.lastModified();
+        }
+        QStringList binaries;
+        const std::list<std::string>& pluginPath = pluginCache->getPluginPath();
+        for (std::list<std::string>::const_iterator it = pluginPath.begin(); it != pluginPath.end(); ++it) {
+            findPluginBinariesModifiedSince(QString::fromUtf8( it->c_str() ), cacheTime, &binaries);
+        }
+        if (binaries.size() > 1) {
+            qDebug() << "Load OFX Plugins: prefetch" << binaries.size() << "plugin binaries...";
+            QtConcurrent::blockingMap(binaries, prefetchPluginBinary);
+            qDebug() << "Load OFX Plugins: prefetch plugin binaries... done!";
+        }
+    }
     qDebug() << "Load OFX Plugins: scan plugins...";
     pluginCache->scanPluginFiles();
     qDebug() << "Load OFX Plugins: scan plugins... done!";
@@ -53,6 +53,7 @@ CLANG_DIAG_ON(uninitialized)
 
 #include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
+#include "Engine/ColorTransform.h"
 #include "Engine/Format.h"
 #include "Engine/Knob.h"
 #include "Engine/KnobFactory.h"
@@ -1002,6 +1003,12 @@ OfxImageEffectInstance::progressEnd()
 bool
 OfxImageEffectInstance::progressUpdate(double t)
 {
+    // The return value tells the plug-in whether it should abandon processing.
+    OfxEffectInstancePtr curEffect = appPTR->getOFXCurrentEffect_TLS();
+    if ( curEffect && curEffect->isRenderAborted() ) {
+        return false;
+    }
+
     OfxEffectInstancePtr effect = getOfxEffectInstance();
 
     return effect->getApp()->progressUpdate(effect->getNode(), t);
@@ -1048,7 +1055,12 @@ OfxImageEffectInstance::timeLineGetBounds(double &t1,
 int
 OfxImageEffectInstance::abort()
 {
+    // Plug-ins poll this in their processing loops: it must stay cheap and return as soon as the render is aborted.
+    // The render clone is recovered from the TLS: it may be NULL if the plug-in calls this from a thread it spawned itself
     OfxEffectInstancePtr curEffect = appPTR->getOFXCurrentEffect_TLS();
+    if (!curEffect) {
+        return 0;
+    }
     return (int)curEffect->isRenderAborted();
 }
 
@@ -1295,6 +1307,79 @@ OfxImageEffectInstance::getClipPreferences_safe(NodeMetadata& defaultPrefs)
     } //if (st == kOfxStatOK)
 } // OfxImageEffectInstance::getClipPreferences_safe
 
+OfxStatus
+OfxImageEffectInstance::getColorTransformAction(OfxTime time,
+                                                ViewIdx view,
+                                                std::string& clipName,
+                                                ColorTransform* transform)
+{
+    static const OFX::Host::Property::PropSpec inStuff[] = {
+        { kOfxPropTime, OFX::Host::Property::eDouble, 1, true, "0" },
+        { kFnOfxImageEffectPropView, OFX::Host::Property::eInt, 1, true, "0" },
+        OFX::Host::Property::propSpecEnd
+    };
+    static const OFX::Host::Property::PropSpec outStuff[] = {
+        { kOfxPropName, OFX::Host::Property::eString, 1, false, "" },
+        { kNatronOfxImageEffectPropColorMatrix, OFX::Host::Property::eDouble, 20, false, "0" },
+        { kNatronOfxImageEffectPropColorLUT, OFX::Host::Property::eDouble, 0, false, "" },
+        { kNatronOfxImageEffectPropColorLUTRange, OFX::Host::Property::eDouble, 2, false, "0" },
+        { kNatronOfxImageEffectPropColorClamp, OFX::Host::Property::eInt, 2, false, "0" },
+        OFX::Host::Property::propSpecEnd
+    };
+
+    OFX::Host::Property::Set inArgs(inStuff);
+    OFX::Host::Property::Set outArgs(outStuff);
+
+    inArgs.setDoubleProperty(kOfxPropTime, time);
+    inArgs.setIntProperty(kFnOfxImageEffectPropView, (int)view);
+
+    // Default to identity
+    for (int i = 0; i < 4; ++i) {
+        outArgs.setDoubleProperty(kNatronOfxImageEffectPropColorMatrix, 1., i * 5 + i);
+    }
+    outArgs.setDoubleProperty(kNatronOfxImageEffectPropColorLUTRange, 1., 1);
+
+#       ifdef OFX_DEBUG_ACTIONS
+    std::cout << "OFX: " << (void*)this << "->" << kNatronOfxImageEffectActionGetColorTransform << "(" << time << "," << view << ")" << std::endl;
+#       endif
+    OfxStatus st = mainEntry(kNatronOfxImageEffectActionGetColorTransform,
+                             this->getHandle(),
+                             &inArgs,
+                             &outArgs);
+#       ifdef OFX_DEBUG_ACTIONS
+    std::cout << "OFX: " << (void*)this << "->" << kNatronOfxImageEffectActionGetColorTransform << "()->" << OFX::StatStr(st) << std::endl;
+#       endif
+
+    if (st != kOfxStatOK) {
+        return st;
+    }
+
+    clipName = outArgs.getStringProperty(kOfxPropName);
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            transform->matrix[i][j] = outArgs.getDoubleProperty(kNatronOfxImageEffectPropColorMatrix, i * 5 + j);
+        }
+        transform->offset[i] = outArgs.getDoubleProperty(kNatronOfxImageEffectPropColorMatrix, i * 5 + 4);
+    }
+
+    int lutDim = outArgs.getDimension(kNatronOfxImageEffectPropColorLUT);
+    if (lutDim > 0 && lutDim % 4 == 0) {
+        const int lutSize = lutDim / 4;
+        for (int c = 0; c < 4; ++c) {
+            transform->lut[c].resize(lutSize);
+            for (int i = 0; i < lutSize; ++i) {
+                transform->lut[c][i] = (float)outArgs.getDoubleProperty(kNatronOfxImageEffectPropColorLUT, c * lutSize + i);
+            }
+        }
+        transform->lutRangeMin = outArgs.getDoubleProperty(kNatronOfxImageEffectPropColorLUTRange, 0);
+        transform->lutRangeMax = outArgs.getDoubleProperty(kNatronOfxImageEffectPropColorLUTRange, 1);
+    }
+    transform->clampBlack = (bool)outArgs.getIntProperty(kNatronOfxImageEffectPropColorClamp, 0);
+    transform->clampWhite = (bool)outArgs.getIntProperty(kNatronOfxImageEffectPropColorClamp, 1);
+
+    return kOfxStatOK;
+} // OfxImageEffectInstance::getColorTransformAction
+
 bool
 OfxImageEffectInstance::updatePreferences_safe(double frameRate,
                                                const std::string& fielding,
@@ -1345,21 +1430,39 @@ OfxImageEffectInstance::isInAnalysis() const
 
 #endif
 
+// Descriptor properties of the Natron extensions that are not declared by the HostSupport library
+static void
+addNatronDescriptorProperties(OFX::Host::Property::Set& props)
+{
+    static const OFX::Host::Property::PropSpec natronDescriptorProps[] = {
+        { kNatronOfxImageEffectPropCanColorTransform, OFX::Host::Property::eInt, 1, false, "0" },
+        OFX::Host::Property::propSpecEnd
+    };
+
+    // The properties may have been copied from the root context descriptor
+    if (!props.fetchProperty(kNatronOfxImageEffectPropCanColorTransform)) {
+        props.addProperties(natronDescriptorProps);
+    }
+}
+
 OfxImageEffectDescriptor::OfxImageEffectDescriptor(OFX::Host::Plugin *plug)
     : OFX::Host::ImageEffect::Descriptor(plug)
 {
+    addNatronDescriptorProperties(getProps());
 }
 
 OfxImageEffectDescriptor::OfxImageEffectDescriptor(const std::string &bundlePath,
                                                    OFX::Host::Plugin *plug)
     : OFX::Host::ImageEffect::Descriptor(bundlePath, plug)
 {
+    addNatronDescriptorProperties(getProps());
 }
 
 OfxImageEffectDescriptor::OfxImageEffectDescriptor(const OFX::Host::ImageEffect::Descriptor &rootContext,
                                                    OFX::Host::Plugin *plugin)
     : OFX::Host::ImageEffect::Descriptor(rootContext, plugin)
 {
+    addNatronDescriptorProperties(getProps());
 }
 
 OFX::Host::Param::Descriptor *
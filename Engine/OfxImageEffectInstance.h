@@ -50,8 +50,67 @@ CLANG_DIAG_ON(unknown-pragmas)
 
 #include "Global/GlobalDefines.h"
 
+#include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
+/*
+ * Natron extension to let plug-ins describe their output as a per-pixel color transform of one of their input,
+ * so that chains of color effects may be concatenated and processed in a single pass by the host.
+ */
+
+/**
+ * @brief x1 int property on the image effect descriptor, set to 1 if the plug-in implements the
+ * kNatronOfxImageEffectActionGetColorTransform action.
+ * Default value - 0
+ **/
+#ifndef kNatronOfxImageEffectPropCanColorTransform
+#define kNatronOfxImageEffectPropCanColorTransform "NatronOfxImageEffectPropCanColorTransform"
+#endif
+
+/**
+ * @brief Action called to retrieve the color transform applied by the effect.
+ * inArgs: kOfxPropTime, kFnOfxImageEffectPropView
+ * outArgs: kOfxPropName (the name of the transformed clip), kNatronOfxImageEffectPropColorMatrix,
+ * kNatronOfxImageEffectPropColorLUT, kNatronOfxImageEffectPropColorLUTRange, kNatronOfxImageEffectPropColorClamp
+ * The plug-in must return kOfxStatReplyDefault if its output is not a color transform over the whole image (e.g: a mask is connected).
+ **/
+#ifndef kNatronOfxImageEffectActionGetColorTransform
+#define kNatronOfxImageEffectActionGetColorTransform "NatronOfxImageEffectActionGetColorTransform"
+#endif
+
+/**
+ * @brief x20 double: the row-major 4x5 matrix applied to the RGBA channels, the last column is the offset.
+ * Default value - identity
+ **/
+#ifndef kNatronOfxImageEffectPropColorMatrix
+#define kNatronOfxImageEffectPropColorMatrix "NatronOfxImageEffectPropColorMatrix"
+#endif
+
+/**
+ * @brief variable dimension double: per-channel look-up tables applied after the matrix, the 4 RGBA tables of
+ * the same size are appended one after the other. The tables are sampled uniformly over kNatronOfxImageEffectPropColorLUTRange.
+ * Default value - empty
+ **/
+#ifndef kNatronOfxImageEffectPropColorLUT
+#define kNatronOfxImageEffectPropColorLUT "NatronOfxImageEffectPropColorLUT"
+#endif
+
+/**
+ * @brief x2 double: the range of values covered by the look-up tables.
+ * Default value - (0, 1)
+ **/
+#ifndef kNatronOfxImageEffectPropColorLUTRange
+#define kNatronOfxImageEffectPropColorLUTRange "NatronOfxImageEffectPropColorLUTRange"
+#endif
+
+/**
+ * @brief x2 int: whether to clamp the result to 0 and to 1.
+ * Default value - (0, 0)
+ **/
+#ifndef kNatronOfxImageEffectPropColorClamp
+#define kNatronOfxImageEffectPropColorClamp "NatronOfxImageEffectPropColorClamp"
+#endif
+
 NATRON_NAMESPACE_ENTER
 
 class OfxImageEffectInstance
@@ -163,6 +222,14 @@ public:
      **/
     ActionRetCodeEnum getClipPreferences_safe(NodeMetadata& defaultPrefs);
 
+    /**
+     * @brief Calls the kNatronOfxImageEffectActionGetColorTransform action
+     **/
+    OfxStatus getColorTransformAction(OfxTime time,
+                                      ViewIdx view,
+                                      std::string& clipName,
+                                      ColorTransform* transform) WARN_UNUSED_RETURN;
+
     virtual OfxStatus createInstanceAction() OVERRIDE FINAL;
 
     /**
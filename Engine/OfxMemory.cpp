@@ -33,6 +33,8 @@ CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_ON(deprecated)
 
 #include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+#include "Engine/TreeRender.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -68,6 +70,15 @@ OfxMemory::alloc(size_t nBytes)
     deallocateMemory();
 
     PluginMemAllocateMemoryArgs args(nBytes);
+    EffectInstancePtr effect = _effect.lock();
+    if (effect) {
+        args.budgets.push_back( effect->getNode()->getMemoryBudget() );
+        TreeRenderPtr render = effect->getCurrentRender();
+        if (render) {
+            args.budgets.push_back( render->getMemoryBudget() );
+        }
+        args.cache = effect->getNode()->getPluginMemoryCache();
+    }
     try {
         allocateMemory(args);
     } catch (const std::bad_alloc &) {
@@ -685,6 +685,44 @@ static boost::shared_ptr<K> resolveRenderKnob(const KnobIPtr& originalKnob)
     return originalKnob->getCloneForHolder<K>(appPTR->getOFXCurrentEffect_TLS());
 }
 
+/**
+ * @brief Returns the value of the given string knob in the TLS of the param, the returned pointer is valid until the next call.
+ * Plug-ins fetch string params for each frame they render: on a render clone the value is only read
+ * and copied once for a given time and view and then returned from the TLS.
+ **/
+template <typename K>
+static const char*
+getStringValueFromTLS(const boost::shared_ptr<K>& knob,
+                      bool atCurrentTime,
+                      TimeValue time,
+                      OfxParamToKnob::OfxParamTLSData* tls)
+{
+    ViewIdx view = knob->getCurrentRenderView();
+    if (atCurrentTime) {
+        time = knob->getCurrentRenderTime();
+    }
+
+    KnobHolderPtr holder = knob->getHolder();
+    bool canCache = holder && holder->isRenderClone();
+    if ( canCache && (tls->strKnob.lock() == knob) && (tls->strTime == time) && (tls->strView == view) ) {
+        return tls->str.c_str();
+    }
+
+    if (atCurrentTime) {
+        tls->str = knob->getValue(DimIdx(0), view);
+    } else {
+        tls->str = knob->getValueAtTime(time, DimIdx(0), view);
+    }
+    if (canCache) {
+        tls->strKnob = knob;
+        tls->strTime = time;
+        tls->strView = view;
+    } else {
+        tls->strKnob.reset();
+    }
+    return tls->str.c_str();
+} // getStringValueFromTLS
+
 ////////////////////////// OfxPushButtonInstance /////////////////////////////////////////////////
 
 OfxPushButtonInstance::OfxPushButtonInstance(const OfxEffectInstancePtr& node,
@@ -4241,6 +4279,9 @@ OfxStringInstance::get(OfxTime time,
 OfxStatus
 OfxStringInstance::set(const char* str)
 {
+    // The value returned by getV() is not the knob value anymore
+    _imp->tlsData->getOrCreateTLSData()->strKnob.reset();
+
     KnobFilePtr fileKnob;
     KnobStringPtr strknob;
     KnobPathPtr pathKnob;
@@ -4277,6 +4318,8 @@ OfxStatus
 OfxStringInstance::set(OfxTime time,
                        const char* str)
 {
+    _imp->tlsData->getOrCreateTLSData()->strKnob.reset();
+
     assert( KnobString::canAnimateStatic() );
 
     KnobFilePtr fileKnob;
@@ -4312,17 +4355,38 @@ OfxStringInstance::set(OfxTime time,
 }
 
 OfxStatus
-OfxStringInstance::getV(va_list arg)
+OfxStringInstance::getVInternal(bool atCurrentTime,
+                                TimeValue time,
+                                const char** value)
 {
-    const char **value = va_arg(arg, const char **);
-    OfxStatus stat;
-    std::string& tls = _imp->tlsData->getOrCreateTLSData()->str;
+    OfxParamToKnob::OfxParamTLSData* tls = _imp->tlsData->getOrCreateTLSData().get();
 
-    stat = get(tls);
+    KnobFilePtr fileKnob = _imp->fileKnob.lock();
+    if (fileKnob) {
+        *value = getStringValueFromTLS(resolveRenderKnob<KnobFile>(fileKnob), atCurrentTime, time, tls);
+        return kOfxStatOK;
+    }
+    KnobStringPtr strknob = _imp->stringKnob.lock();
+    if (strknob) {
+        *value = getStringValueFromTLS(resolveRenderKnob<KnobString>(strknob), atCurrentTime, time, tls);
+        return kOfxStatOK;
+    }
+    KnobPathPtr pathKnob = _imp->pathKnob.lock();
+    if (pathKnob) {
+        *value = getStringValueFromTLS(resolveRenderKnob<KnobPath>(pathKnob), atCurrentTime, time, tls);
+        return kOfxStatOK;
+    }
+    tls->str.clear();
+    *value = tls->str.c_str();
+    return kOfxStatErrBadHandle;
+} // getVInternal
 
-    *value = tls.c_str();
+OfxStatus
+OfxStringInstance::getV(va_list arg)
+{
+    const char **value = va_arg(arg, const char **);
 
-    return stat;
+    return getVInternal(true, TimeValue(), value);
 }
 
 OfxStatus
@@ -4330,13 +4394,8 @@ OfxStringInstance::getV(OfxTime time,
                         va_list arg)
 {
     const char **value = va_arg(arg, const char **);
-    OfxStatus stat;
-    std::string& tls = _imp->tlsData->getOrCreateTLSData()->str;
 
-    stat = get( time, tls);
-    *value = tls.c_str();
-
-    return stat;
+    return getVInternal(false, TimeValue(time), value);
 }
 
 KnobIPtr
@@ -4799,6 +4858,8 @@ OfxCustomInstance::get(OfxTime time,
 OfxStatus
 OfxCustomInstance::set(const char* str)
 {
+    _imp->tlsData->getOrCreateTLSData()->strKnob.reset();
+
     KnobStringPtr knob = resolveRenderKnob<KnobString>(_imp->knob.lock());
     assert(knob);
     if (!knob) {
@@ -4815,6 +4876,7 @@ OfxCustomInstance::set(OfxTime time,
                        const char* str)
 {
     assert( KnobString::canAnimateStatic() );
+    _imp->tlsData->getOrCreateTLSData()->strKnob.reset();
     KnobStringPtr knob = resolveRenderKnob<KnobString>(_imp->knob.lock());
     assert(knob);
     if (!knob) {
@@ -4826,16 +4888,30 @@ OfxCustomInstance::set(OfxTime time,
     return kOfxStatOK;
 }
 
+OfxStatus
+OfxCustomInstance::getVInternal(bool atCurrentTime,
+                                TimeValue time,
+                                const char** value)
+{
+    OfxParamToKnob::OfxParamTLSData* tls = _imp->tlsData->getOrCreateTLSData().get();
+    KnobStringPtr knob = _imp->knob.lock();
+    assert(knob);
+    if (!knob) {
+        tls->str.clear();
+        *value = tls->str.c_str();
+        return kOfxStatErrBadHandle;
+    }
+    // This avoids calling the custom interpolation of the plug-in again for the same frame
+    *value = getStringValueFromTLS(resolveRenderKnob<KnobString>(knob), atCurrentTime, time, tls);
+    return kOfxStatOK;
+}
+
 OfxStatus
 OfxCustomInstance::getV(va_list arg)
 {
     const char **value = va_arg(arg, const char **);
-    std::string& s = _imp->tlsData->getOrCreateTLSData()->str;
-    OfxStatus stat = get(s);
 
-    *value = s.c_str();
-
-    return stat;
+    return getVInternal(true, TimeValue(), value);
 }
 
 OfxStatus
@@ -4843,12 +4919,8 @@ OfxCustomInstance::getV(OfxTime time,
                         va_list arg)
 {
     const char **value = va_arg(arg, const char **);
-    std::string& s = _imp->tlsData->getOrCreateTLSData()->str;
-    OfxStatus stat = get( time, s);
-
-    *value = s.c_str();
 
-    return stat;
+    return getVInternal(false, TimeValue(time), value);
 }
 
 KnobIPtr
@@ -133,6 +133,20 @@ public:
     {
         //only for string-param for now
         std::string str;
+
+        // The render clone knob, time and view str was read at. The values of a render clone do not change
+        // during the render so str is returned again without reading the knob.
+        KnobIWPtr strKnob;
+        TimeValue strTime;
+        ViewIdx strView;
+
+        OfxParamTLSData()
+        : str()
+        , strKnob()
+        , strTime()
+        , strView(0)
+        {
+        }
     };
 
     static std::string getParamLabel(OFX::Host::Param::Instance* param)
@@ -842,6 +856,8 @@ public:
 
 private:
 
+    OfxStatus getVInternal(bool atCurrentTime, TimeValue time, const char** value);
+
     boost::scoped_ptr<OfxStringInstancePrivate> _imp;
 };
 
@@ -905,6 +921,7 @@ private:
 
     void getCustomParamAtTime(double time, std::string &str) const;
 
+    OfxStatus getVInternal(bool atCurrentTime, TimeValue time, const char** value);
 
     boost::scoped_ptr<OfxCustomInstancePrivate> _imp;
 };
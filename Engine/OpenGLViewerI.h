@@ -133,6 +133,15 @@ public:
         // of the tree. This is used in turn by the timeline to update the cached frames line.
         ImageCacheKeyPtr viewerProcessNodeKey;
 
+        // If type is eTextureTransferTypeModify and this is not null, only the portion of the image
+        // within this rectangle (in pixel coordinates) changed and is uploaded to the existing texture.
+        // This avoids re-uploading the full image when a paint stroke only modified a small area of it.
+        RectI updateArea;
+
+        // If true, the image holds linear values and the viewer applies the gain, gamma, colorspace
+        // and channel selection of the viewer when drawing it. See Settings::isGPUDisplayTransformEnabled()
+        bool applyDisplayTransform;
+
         TextureTransferArgs()
         : type(eTextureTransferTypeReplace)
         , textureIndex(0)
@@ -145,6 +154,8 @@ public:
         , recenterViewer(false)
         , viewportCenter()
         , viewerProcessNodeKey()
+        , updateArea()
+        , applyDisplayTransform(false)
         {
 
         }
@@ -40,6 +40,8 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/algorithm/clamp.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QDateTime>
 #include <QtCore/QMetaType>
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
@@ -63,6 +65,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
+#include "Engine/ConcurrentFramesController.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/FrameViewRequest.h"
 #include "Engine/ImageCacheKey.h"
@@ -71,6 +74,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/KnobFile.h"
 #include "Engine/Node.h"
 #include "Engine/KnobItemsTable.h"
+#include "Engine/MemoryInfo.h"
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/ProcessFrameThread.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
@@ -195,6 +199,15 @@ struct OutputSchedulerThreadPrivate
 
     ProcessFrameThread processFrameThread;
 
+    // Adjusts the number of frames in flight during a sequence render, only used on the scheduler thread
+    ConcurrentFramesController framesController;
+    TimeLapse framesControllerTimer;
+
+    // The number of frames (and of renders, one per view) that may be in flight, as set by the framesController.
+    // 0 if not controlled, e.g: for a playback regulated at a given fps.
+    QAtomicInt maxConcurrentFrames;
+    QAtomicInt maxConcurrentRenders;
+
     OutputSchedulerThreadPrivate(const RenderEnginePtr& engine,
                                  OutputSchedulerThread* publicInterface,
                                  const NodePtr& effect)
@@ -219,11 +232,23 @@ struct OutputSchedulerThreadPrivate
         , sequentialRenderQueueMutex()
         , sequentialRenderQueue()
         , processFrameThread()
+        , framesController()
+        , framesControllerTimer()
+        , maxConcurrentFrames()
+        , maxConcurrentRenders()
     {
     }
 
     void validateRenderSequenceArgs(RenderSequenceArgs& args) const;
 
+    void startConcurrentFramesControl(int nViews);
+
+    void onFrameRenderedForConcurrentFramesControl(int nViews);
+
+    void setMaxConcurrentFrames(int nFrames, int nViews);
+
+    bool isMaxConcurrentFramesReached() const;
+
     void launchNextSequentialRender();
 
     /**
@@ -439,6 +464,94 @@ OutputSchedulerThread::requestMoreRenders()
     startFrameRenderFromLastStartedFrame();
 } // requestMoreRenders
 
+int
+OutputSchedulerThread::getMaxConcurrentRenders() const
+{
+#if QT_VERSION < 0x050000
+    return (int)_imp->maxConcurrentRenders;
+#else
+    return _imp->maxConcurrentRenders.loadAcquire();
+#endif
+}
+
+void
+OutputSchedulerThreadPrivate::setMaxConcurrentFrames(int nFrames,
+                                                     int nViews)
+{
+    maxConcurrentRenders.fetchAndStoreOrdered( nFrames * std::max(1, nViews) );
+    maxConcurrentFrames.fetchAndStoreOrdered(nFrames);
+}
+
+bool
+OutputSchedulerThreadPrivate::isMaxConcurrentFramesReached() const
+{
+#if QT_VERSION < 0x050000
+    int nFrames = (int)maxConcurrentFrames;
+#else
+    int nFrames = maxConcurrentFrames.loadAcquire();
+#endif
+    if (nFrames <= 0) {
+        return false;
+    }
+    QMutexLocker l(&launchedFramesMutex);
+
+    return (int)launchedFrames.size() >= nFrames;
+}
+
+void
+OutputSchedulerThreadPrivate::startConcurrentFramesControl(int nViews)
+{
+    // When the frames are regulated at a given fps, the throughput does not tell anything
+    if ( _publicInterface->isFPSRegulationNeeded() ) {
+        setMaxConcurrentFrames(0, nViews);
+
+        return;
+    }
+    framesControllerTimer.reset();
+    framesController.reset(QThreadPool::globalInstance()->maxThreadCount(), framesControllerTimer.getTimeSinceCreation(), getCurrentRSS(), getAmountFreePhysicalRAM(), getSystemTotalRAM());
+    setMaxConcurrentFrames(framesController.getNumConcurrentFrames(), nViews);
+}
+
+void
+OutputSchedulerThreadPrivate::onFrameRenderedForConcurrentFramesControl(int nViews)
+{
+    if ( _publicInterface->isFPSRegulationNeeded() ) {
+        return;
+    }
+    ConcurrentFramesController::Decision decision;
+    if ( !framesController.onFrameRendered(framesControllerTimer.getTimeSinceCreation(), getCurrentRSS(), getAmountFreePhysicalRAM(), &decision) ) {
+        return;
+    }
+    setMaxConcurrentFrames(decision.numFrames, nViews);
+
+    // Report the decision in the render log
+    QString reason;
+    switch (decision.reason) {
+    case ConcurrentFramesController::eChangeReasonProbe:
+        reason = OutputSchedulerThread::tr("measuring the throughput, currently %1 fps").arg(decision.throughput, 0, 'f', 2);
+        break;
+    case ConcurrentFramesController::eChangeReasonThroughputIncreased:
+        reason = OutputSchedulerThread::tr("the throughput increased from %1 to %2 fps").arg(decision.previousThroughput, 0, 'f', 2).arg(decision.throughput, 0, 'f', 2);
+        break;
+    case ConcurrentFramesController::eChangeReasonThroughputNotIncreased:
+        reason = OutputSchedulerThread::tr("the throughput did not increase: %1 fps instead of %2 fps").arg(decision.throughput, 0, 'f', 2).arg(decision.previousThroughput, 0, 'f', 2);
+        break;
+    case ConcurrentFramesController::eChangeReasonLowMemory:
+        reason = OutputSchedulerThread::tr("low memory, %1 available").arg( printAsRAM(decision.freeRAM) );
+        break;
+    case ConcurrentFramesController::eChangeReasonNone:
+        break;
+    }
+    NodePtr node = outputEffect.lock();
+    QString scriptName = node ? QString::fromUtf8( node->getScriptName_mt_safe().c_str() ) : QString();
+    QString message = OutputSchedulerThread::tr("%1 ==> Frames rendered in parallel: %2 -> %3 (%4)").arg(scriptName).arg(decision.previousNumFrames).arg(decision.numFrames).arg(reason);
+    if ( appPTR->isBackground() ) {
+        std::cout << message.toStdString() << std::endl;
+    } else {
+        appPTR->writeToErrorLog_mt_safe(scriptName, QDateTime::currentDateTime(), message);
+    }
+} // onFrameRenderedForConcurrentFramesControl
+
 void
 OutputSchedulerThread::startFrameRender(TimeValue startingFrame)
 {
@@ -699,6 +812,7 @@ OutputSchedulerThread::beginSequenceRender()
     TimeValue firstFrame, lastFrame;
     TimeValue frameStep;
     RenderDirectionEnum direction;
+    int nViews;
 
     {
         OutputSchedulerThreadStartArgsPtr args = getCurrentRunArgs();
@@ -708,6 +822,7 @@ OutputSchedulerThread::beginSequenceRender()
         frameStep = args->frameStep;
         startingFrame = args->startingFrame;
         direction = args->direction;
+        nViews = (int)args->viewsToRender.size();
     }
 
     _imp->runBeforeRenderCallback();
@@ -756,6 +871,8 @@ OutputSchedulerThread::beginSequenceRender()
         _imp->lastFrameRequested = startingFrame;
     }
 
+    _imp->startConcurrentFramesControl(nViews);
+
     startFrameRender(startingFrame);
 
 
@@ -767,6 +884,7 @@ OutputSchedulerThread::endSequenceRender()
     // Wait that all processFrames calls are finished
     _imp->processFrameThread.quitThread(true /*allowRestart*/, false /*abortTask*/);
     _imp->processFrameThread.waitForThreadToQuit_enforce_blocking();
+    onAllFramesProcessed();
 
     TimeValue firstFrame, lastFrame, frameStep;
 
@@ -918,6 +1036,7 @@ OutputSchedulerThread::threadLoopOnce(const GenericThreadStartArgsPtr &inArgs)
                 renderFinished = true;
             } else {
                 mustProcessFrame = true;
+                _imp->onFrameRenderedForConcurrentFramesControl( (int)args->viewsToRender.size() );
             }
         }
 
@@ -996,8 +1115,10 @@ OutputSchedulerThread::threadLoopOnce(const GenericThreadStartArgsPtr &inArgs)
                 _imp->expectedFrameToRender = nextFrameToRender;
             }
 
-
-            startFrameRenderFromLastStartedFrame();
+            // Replace the frame that was just rendered, unless the number of frames in flight was lowered
+            if ( !_imp->isMaxConcurrentFramesReached() ) {
+                startFrameRenderFromLastStartedFrame();
+            }
         }
 
         // Process the frame (for viewer playback this will upload the image to the OpenGL texture).
@@ -371,6 +371,12 @@ protected:
      **/
     virtual void aboutToStartRender() {}
 
+    /**
+     * @brief Callback when all frames of the sequence are processed, before waiting for the renders launched by the scheduler.
+     * Implementations that launch renders from other threads must make sure here that they will not launch any other.
+     **/
+    virtual void onAllFramesProcessed() {}
+
     /**
      * @brief Callback when stopRender() is called
      **/
@@ -381,6 +387,7 @@ protected:
 private:
     // Overriden from TreeRenderQueueProvider
     virtual void requestMoreRenders() OVERRIDE FINAL;
+    virtual int getMaxConcurrentRenders() const OVERRIDE FINAL;
 
     // Overriden from GenericSchedulerThread
     virtual void onWaitForAbortCompleted() OVERRIDE FINAL;
@@ -0,0 +1,235 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "OverlayDrawList.h"
+
+#include <cassert>
+
+#include "Global/GLIncludes.h"
+#include "Engine/OSGLFunctions.h"
+
+NATRON_NAMESPACE_ENTER
+
+OverlayDrawList::OverlayDrawList()
+: _batches()
+, _key(0)
+, _pointSize(1.f)
+, _lineWidth(1.f)
+, _stipple(false)
+, _stripBatch(-1)
+, _hasStripVertex(false)
+{
+    for (int i = 0; i < 4; ++i) {
+        _color[i] = 1.f;
+    }
+    _stripVertex[0] = _stripVertex[1] = 0.f;
+}
+
+OverlayDrawList::~OverlayDrawList()
+{
+}
+
+bool
+OverlayDrawList::beginRecording(U64 key)
+{
+    if ( (key != 0) && (key == _key) ) {
+        return false;
+    }
+    clear();
+    _key = key;
+    return true;
+}
+
+void
+OverlayDrawList::clear()
+{
+    _batches.clear();
+    _key = 0;
+    _stripBatch = -1;
+    _hasStripVertex = false;
+}
+
+bool
+OverlayDrawList::isEmpty() const
+{
+    return _batches.empty();
+}
+
+void
+OverlayDrawList::setColor(double r,
+                          double g,
+                          double b,
+                          double a)
+{
+    _color[0] = (float)r;
+    _color[1] = (float)g;
+    _color[2] = (float)b;
+    _color[3] = (float)a;
+}
+
+void
+OverlayDrawList::setPointSize(double size)
+{
+    _pointSize = (float)size;
+}
+
+void
+OverlayDrawList::setLineWidth(double width)
+{
+    _lineWidth = (float)width;
+}
+
+void
+OverlayDrawList::setLineStipple(bool enabled)
+{
+    _stipple = enabled;
+}
+
+OverlayDrawList::Batch*
+OverlayDrawList::getBatch(bool isPoints)
+{
+    float size = isPoints ? _pointSize : _lineWidth;
+    bool stipple = isPoints ? false : _stipple;
+
+    // There are only a few distinct states in an overlay: look for the batch from the most recent one
+    for (int i = (int)_batches.size() - 1; i >= 0; --i) {
+        Batch& b = _batches[i];
+        if ( (b.isPoints == isPoints) && (b.size == size) && (b.stipple == stipple) &&
+             (b.color[0] == _color[0]) && (b.color[1] == _color[1]) && (b.color[2] == _color[2]) && (b.color[3] == _color[3]) ) {
+            return &b;
+        }
+    }
+
+    Batch b;
+    b.isPoints = isPoints;
+    b.size = size;
+    b.stipple = stipple;
+    for (int i = 0; i < 4; ++i) {
+        b.color[i] = _color[i];
+    }
+    _batches.push_back(b);
+
+    return &_batches.back();
+}
+
+void
+OverlayDrawList::addPoint(double x,
+                          double y)
+{
+    Batch* b = getBatch(true);
+
+    b->vertices.push_back( (float)x );
+    b->vertices.push_back( (float)y );
+}
+
+void
+OverlayDrawList::addLine(double x1,
+                         double y1,
+                         double x2,
+                         double y2)
+{
+    Batch* b = getBatch(false);
+
+    b->vertices.push_back( (float)x1 );
+    b->vertices.push_back( (float)y1 );
+    b->vertices.push_back( (float)x2 );
+    b->vertices.push_back( (float)y2 );
+}
+
+void
+OverlayDrawList::beginLineStrip()
+{
+    // Resolve the batch once: the state cannot change within a strip. Store its index since adding batches
+    // may reallocate the vector.
+    Batch* b = getBatch(false);
+
+    _stripBatch = (int)(b - &_batches[0]);
+    _hasStripVertex = false;
+}
+
+void
+OverlayDrawList::addLineStripVertex(double x,
+                                    double y)
+{
+    assert(_stripBatch >= 0 && _stripBatch < (int)_batches.size());
+    if ( (_stripBatch < 0) || ( _stripBatch >= (int)_batches.size() ) ) {
+        return;
+    }
+    if (_hasStripVertex) {
+        std::vector<float>& vertices = _batches[_stripBatch].vertices;
+        vertices.push_back(_stripVertex[0]);
+        vertices.push_back(_stripVertex[1]);
+        vertices.push_back( (float)x );
+        vertices.push_back( (float)y );
+    }
+    _stripVertex[0] = (float)x;
+    _stripVertex[1] = (float)y;
+    _hasStripVertex = true;
+}
+
+void
+OverlayDrawList::endLineStrip()
+{
+    _stripBatch = -1;
+    _hasStripVertex = false;
+}
+
+void
+OverlayDrawList::draw() const
+{
+    if ( _batches.empty() ) {
+        return;
+    }
+
+    GLProtectAttrib<GL_GPU> a(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_LINE_BIT | GL_POINT_BIT);
+
+    GL_GPU::EnableClientState(GL_VERTEX_ARRAY);
+    for (int pass = 0; pass < 2; ++pass) {
+        bool drawPoints = pass == 1;
+        for (std::vector<Batch>::const_iterator it = _batches.begin(); it != _batches.end(); ++it) {
+            if ( (it->isPoints != drawPoints) || it->vertices.empty() ) {
+                continue;
+            }
+            GL_GPU::Color4f(it->color[0], it->color[1], it->color[2], it->color[3]);
+            if (drawPoints) {
+                GL_GPU::PointSize(it->size);
+            } else {
+                GL_GPU::LineWidth(it->size);
+                if (it->stipple) {
+                    GL_GPU::LineStipple(2, 0xAAAA);
+                    GL_GPU::Enable(GL_LINE_STIPPLE);
+                } else {
+                    GL_GPU::Disable(GL_LINE_STIPPLE);
+                }
+            }
+            GL_GPU::VertexPointer(2, GL_FLOAT, 0, &it->vertices[0]);
+            GL_GPU::DrawArrays(drawPoints ? GL_POINTS : GL_LINES, 0, (GLsizei)(it->vertices.size() / 2));
+        }
+    }
+    GL_GPU::DisableClientState(GL_VERTEX_ARRAY);
+    glCheckError(GL_GPU);
+} // draw
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,128 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_OverlayDrawList_h
+#define Engine_OverlayDrawList_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A retained list of the points and lines of an overlay interact.
+ *
+ * The primitives are grouped by drawing state (color, point size, line width, stipple) and each group is drawn
+ * with a single glDrawArrays call from a vertex array, instead of a glBegin/glEnd pair per element.
+ * The list remembers the key it was recorded with: an overlay computes a key from everything its primitives depend on
+ * (the time, the view, the hash of its items, the pixel scale for primitives sized in pixels...) and only records the
+ * list again when beginRecording() returns true. Line strips are stored as separate segments so that all the lines
+ * of the same state are drawn at once. Lines are drawn before points.
+ *
+ * The vertices are kept in client memory rather than in buffer objects: the interacts are not destroyed with the
+ * OpenGL context of the viewer current, so they could not release buffer objects safely.
+ **/
+class OverlayDrawList
+{
+public:
+
+    OverlayDrawList();
+
+    ~OverlayDrawList();
+
+    /**
+     * @brief Returns false if the list was already recorded with the given key, in which case it can be drawn as is.
+     * Otherwise clears the list and returns true: the caller must then add the primitives again.
+     * A key of 0 always clears the list.
+     **/
+    bool beginRecording(U64 key);
+
+    void clear();
+
+    bool isEmpty() const;
+
+    /**
+     * @brief The state applied to the primitives added after the call, as with the OpenGL functions of the same name
+     **/
+    void setColor(double r, double g, double b, double a = 1.);
+
+    void setPointSize(double size);
+
+    void setLineWidth(double width);
+
+    void setLineStipple(bool enabled);
+
+    void addPoint(double x, double y);
+
+    void addLine(double x1, double y1, double x2, double y2);
+
+    /**
+     * @brief Adds the segments between the consecutive vertices given to addLineStripVertex() until endLineStrip()
+     **/
+    void beginLineStrip();
+
+    void addLineStripVertex(double x, double y);
+
+    void endLineStrip();
+
+    /**
+     * @brief Draws the list in the current OpenGL context. The OpenGL state is preserved.
+     **/
+    void draw() const;
+
+private:
+
+    struct Batch
+    {
+        bool isPoints;
+        float size;
+        bool stipple;
+        float color[4];
+        std::vector<float> vertices;
+    };
+
+    Batch* getBatch(bool isPoints);
+
+    std::vector<Batch> _batches;
+    U64 _key;
+    float _color[4];
+    float _pointSize;
+    float _lineWidth;
+    bool _stipple;
+
+    // The batch and the previous vertex of the line strip being recorded
+    int _stripBatch;
+    bool _hasStripVertex;
+    float _stripVertex[2];
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_OverlayDrawList_h
@@ -0,0 +1,305 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "PixelInspectorThread.h"
+
+#include <cassert>
+#include <cmath> // floor
+#include <list>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "Engine/EffectInstance.h"
+#include "Engine/FrameViewRequest.h"
+#include "Engine/Image.h"
+#include "Engine/Node.h"
+#include "Engine/RectD.h"
+#include "Engine/TreeRender.h"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct PixelInspectorRequest
+{
+    NodePtr node;
+    TimeValue time;
+    ViewIdx view;
+    double x, y;
+    int cookie;
+
+    PixelInspectorRequest()
+    : node()
+    , time(0)
+    , view(0)
+    , x(0)
+    , y(0)
+    , cookie(0)
+    {
+    }
+};
+
+struct PixelInspectorResult
+{
+    PixelInspectorRequest request;
+    ImagePtr image;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+struct PixelInspectorThreadPrivate
+{
+    QWaitCondition requestCond;
+    QMutex requestMutex;
+    std::list<PixelInspectorRequest> requests;
+    QMutex producedMutex;
+    std::list<PixelInspectorResult> produced;
+    QWaitCondition mustQuitCond;
+    QMutex mustQuitMutex;
+    bool mustQuit;
+
+    PixelInspectorThreadPrivate()
+    : requestCond()
+    , requestMutex()
+    , requests()
+    , producedMutex()
+    , produced()
+    , mustQuitCond()
+    , mustQuitMutex()
+    , mustQuit(false)
+    {
+    }
+
+    static ImagePtr renderPixel(const PixelInspectorRequest& request);
+};
+
+PixelInspectorThread::PixelInspectorThread()
+: QThread()
+, _imp( new PixelInspectorThreadPrivate() )
+{
+}
+
+PixelInspectorThread::~PixelInspectorThread()
+{
+    quitAnyComputation();
+}
+
+void
+PixelInspectorThread::inspectPixel(const NodePtr& node,
+                                   TimeValue time,
+                                   ViewIdx view,
+                                   double x,
+                                   double y,
+                                   int cookie)
+{
+    /*Starting or waking-up the thread*/
+    bool mustQuit;
+    {
+        QMutexLocker quitLocker(&_imp->mustQuitMutex);
+        mustQuit = _imp->mustQuit;
+    }
+
+    PixelInspectorRequest request;
+    request.node = node;
+    request.time = time;
+    request.view = view;
+    request.x = x;
+    request.y = y;
+    request.cookie = cookie;
+
+    QMutexLocker locker(&_imp->requestMutex);
+    _imp->requests.push_back(request);
+    if (!isRunning() && !mustQuit) {
+        start(HighestPriority);
+    } else {
+        _imp->requestCond.wakeOne();
+    }
+}
+
+void
+PixelInspectorThread::quitAnyComputation()
+{
+    if ( isRunning() ) {
+        QMutexLocker l(&_imp->mustQuitMutex);
+        assert(!_imp->mustQuit);
+        _imp->mustQuit = true;
+
+        ///post a fake request to wakeup the thread
+        l.unlock();
+        inspectPixel(NodePtr(), TimeValue(0), ViewIdx(0), 0, 0, 0);
+        l.relock();
+        while (_imp->mustQuit) {
+            _imp->mustQuitCond.wait(&_imp->mustQuitMutex);
+        }
+    }
+}
+
+bool
+PixelInspectorThread::getMostRecentResult(ImagePtr* image,
+                                          NodePtr* node,
+                                          TimeValue* time,
+                                          double* x,
+                                          double* y,
+                                          int* cookie)
+{
+    assert(image && node && time && x && y && cookie);
+
+    QMutexLocker l(&_imp->producedMutex);
+    if ( _imp->produced.empty() ) {
+        return false;
+    }
+
+    const PixelInspectorResult& result = _imp->produced.back();
+    *image = result.image;
+    *node = result.request.node;
+    *time = result.request.time;
+    *x = result.request.x;
+    *y = result.request.y;
+    *cookie = result.request.cookie;
+    _imp->produced.clear();
+
+    return true;
+}
+
+ImagePtr
+PixelInspectorThreadPrivate::renderPixel(const PixelInspectorRequest& request)
+{
+    EffectInstancePtr effect = request.node->getEffectInstance();
+    if (!effect) {
+        return ImagePtr();
+    }
+
+    // The pixel containing the point at mipmap level 0
+    const double par = effect->getAspectRatio(-1);
+    RectD canonicalRoI;
+    canonicalRoI.x1 = std::floor(request.x / par) * par;
+    canonicalRoI.y1 = std::floor(request.y);
+    canonicalRoI.x2 = canonicalRoI.x1 + par;
+    canonicalRoI.y2 = canonicalRoI.y1 + 1.;
+
+    TreeRender::CtorArgsPtr args(new TreeRender::CtorArgs);
+    args->treeRootEffect = effect;
+    args->provider = effect;
+    // The picker must not take threads from the viewer renders
+    args->priority = eTreeRenderPriorityPreview;
+    args->time = request.time;
+    args->view = request.view;
+    args->mipMapLevel = 0;
+    args->proxyScale = RenderScale(1.);
+    args->canonicalRoI = canonicalRoI;
+    args->draftMode = false;
+    args->playback = false;
+    // Tiles already rendered, at any time by the viewer or another render, are read from the cache
+    args->byPassCache = false;
+
+    TreeRenderPtr render = TreeRender::create(args);
+    if (!render) {
+        return ImagePtr();
+    }
+    effect->launchRender(render);
+    ActionRetCodeEnum stat = effect->waitForRenderFinished(render);
+    if ( isFailureRetCode(stat) ) {
+        return ImagePtr();
+    }
+
+    ImagePtr image = render->getOutputRequest()->getRequestedScaleImagePlane();
+    if (!image) {
+        return image;
+    }
+
+    // The picker only reads RAM images
+    if (image->getStorageMode() != eStorageModeRAM) {
+        Image::InitStorageArgs initArgs;
+        initArgs.bounds = image->getBounds();
+        initArgs.bitdepth = image->getBitDepth();
+        initArgs.plane = image->getLayer();
+        initArgs.bufferFormat = eImageBufferLayoutRGBAPackedFullRect;
+        initArgs.mipMapLevel = image->getMipMapLevel();
+        initArgs.storage = eStorageModeRAM;
+        ImagePtr mappedImage = Image::create(initArgs);
+        if (!mappedImage) {
+            return ImagePtr();
+        }
+        Image::CopyPixelsArgs copyArgs;
+        copyArgs.roi = image->getBounds();
+        mappedImage->copyPixels(*image, copyArgs);
+        image = mappedImage;
+    }
+
+    return image;
+} // renderPixel
+
+void
+PixelInspectorThread::run()
+{
+    for (;; ) {
+        PixelInspectorRequest request;
+        {
+            QMutexLocker l(&_imp->requestMutex);
+            while ( _imp->requests.empty() ) {
+                _imp->requestCond.wait(&_imp->requestMutex);
+            }
+
+            ///get the last request
+            request = _imp->requests.back();
+
+            ///ignore all other requests pending
+            _imp->requests.clear();
+        }
+
+        {
+            QMutexLocker l(&_imp->mustQuitMutex);
+            if (_imp->mustQuit) {
+                _imp->mustQuit = false;
+                _imp->mustQuitCond.wakeOne();
+
+                return;
+            }
+        }
+
+        if (!request.node) {
+            continue;
+        }
+
+        PixelInspectorResult result;
+        result.request = request;
+        result.image = PixelInspectorThreadPrivate::renderPixel(request);
+        if (!result.image) {
+            continue;
+        }
+
+        {
+            QMutexLocker l(&_imp->producedMutex);
+            _imp->produced.push_back(result);
+        }
+        Q_EMIT pixelInspected();
+    }
+} // run
+
+NATRON_NAMESPACE_EXIT
+
+NATRON_NAMESPACE_USING
+#include "moc_PixelInspectorThread.cpp"
@@ -0,0 +1,113 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PIXELINSPECTORTHREAD_H
+#define NATRON_ENGINE_PIXELINSPECTORTHREAD_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+#include "Engine/TimeValue.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The pixels sampled by the viewer color picker come from the image rendered for the viewer, which is
+ * downscaled when the viewer displays a mipmap level. This thread renders the full resolution pixel under the
+ * picker in the background so that the picker never stalls the main thread on heavy trees.
+ *
+ * Only a small region around the pixel is rendered, reading the tiles that are already in the cache.
+ * Like HistogramCPUThread, only the most recent request is processed: requests posted while a render is running
+ * replace each other.
+ **/
+struct PixelInspectorThreadPrivate;
+class PixelInspectorThread
+: public QThread
+, public boost::enable_shared_from_this<PixelInspectorThread>
+{
+GCC_DIAG_SUGGEST_OVERRIDE_OFF
+    Q_OBJECT
+GCC_DIAG_SUGGEST_OVERRIDE_ON
+
+protected:
+
+    PixelInspectorThread();
+
+public:
+
+    static PixelInspectorThreadPtr create()
+    {
+        return PixelInspectorThreadPtr(new PixelInspectorThread);
+    }
+
+    virtual ~PixelInspectorThread();
+
+    /**
+     * @brief Requests the full resolution image of the given node around the given point, in canonical coordinates.
+     * @param cookie Identifies the request for the caller, it is returned with the result.
+     **/
+    void inspectPixel(const NodePtr& node,
+                      TimeValue time,
+                      ViewIdx view,
+                      double x,
+                      double y,
+                      int cookie);
+
+    /**
+     * @brief Returns the most recently rendered image and the parameters of its request.
+     * This should be called as a result of the pixelInspected signal reception.
+     * The image holds at least the pixel at (x,y) at mipmap level 0.
+     **/
+    bool getMostRecentResult(ImagePtr* image,
+                             NodePtr* node,
+                             TimeValue* time,
+                             double* x,
+                             double* y,
+                             int* cookie);
+
+    void quitAnyComputation();
+
+Q_SIGNALS:
+
+    void pixelInspected();
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+    boost::scoped_ptr<PixelInspectorThreadPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_PIXELINSPECTORTHREAD_H
@@ -0,0 +1,166 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "PlaybackFrameBuffer.h"
+
+#include <map>
+
+#include <QtCore/QMutex>
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct BufferedFrame
+{
+    U64 key;
+    RenderFrameResultsContainerPtr results;
+    std::size_t size;
+};
+
+typedef std::map<TimeValue, BufferedFrame> BufferedFramesMap;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+struct PlaybackFrameBufferPrivate
+{
+    // Protects all fields below
+    mutable QMutex lock;
+
+    BufferedFramesMap frames;
+
+    // The sum of the size of all frames
+    std::size_t size;
+
+    PlaybackFrameBufferPrivate()
+    : lock()
+    , frames()
+    , size(0)
+    {
+
+    }
+
+    void eraseFrame(BufferedFramesMap::iterator it)
+    {
+        assert(size >= it->second.size);
+        size -= it->second.size;
+        frames.erase(it);
+    }
+};
+
+PlaybackFrameBuffer::PlaybackFrameBuffer()
+: _imp(new PlaybackFrameBufferPrivate)
+{
+
+}
+
+PlaybackFrameBuffer::~PlaybackFrameBuffer()
+{
+
+}
+
+RenderFrameResultsContainerPtr
+PlaybackFrameBuffer::getFrame(TimeValue time, U64 key)
+{
+    QMutexLocker k(&_imp->lock);
+    BufferedFramesMap::iterator found = _imp->frames.find(time);
+    if (found == _imp->frames.end()) {
+        return RenderFrameResultsContainerPtr();
+    }
+    if (found->second.key != key) {
+        // Something changed since the frame was rendered, it will never be displayed again
+        _imp->eraseFrame(found);
+        return RenderFrameResultsContainerPtr();
+    }
+    return found->second.results;
+} // getFrame
+
+bool
+PlaybackFrameBuffer::insertFrame(TimeValue time,
+                                 U64 key,
+                                 const RenderFrameResultsContainerPtr& results,
+                                 std::size_t size,
+                                 std::size_t maxSize,
+                                 TimeValue firstFrame,
+                                 TimeValue lastFrame)
+{
+    QMutexLocker k(&_imp->lock);
+
+    // Replace the frame if it already exists
+    {
+        BufferedFramesMap::iterator found = _imp->frames.find(time);
+        if (found != _imp->frames.end()) {
+            _imp->eraseFrame(found);
+        }
+    }
+
+    // Make room by evicting the frames outside of the playback range
+    BufferedFramesMap::iterator it = _imp->frames.begin();
+    while (it != _imp->frames.end() && _imp->size + size > maxSize) {
+        if (it->first < firstFrame || it->first > lastFrame) {
+            BufferedFramesMap::iterator next = it;
+            ++next;
+            _imp->eraseFrame(it);
+            it = next;
+        } else {
+            ++it;
+        }
+    }
+
+    if (_imp->size + size > maxSize) {
+        return false;
+    }
+
+    BufferedFrame& frame = _imp->frames[time];
+    frame.key = key;
+    frame.results = results;
+    frame.size = size;
+    _imp->size += size;
+    return true;
+} // insertFrame
+
+void
+PlaybackFrameBuffer::clear()
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->frames.clear();
+    _imp->size = 0;
+}
+
+std::size_t
+PlaybackFrameBuffer::getSize() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->size;
+}
+
+int
+PlaybackFrameBuffer::getNumFrames() const
+{
+    QMutexLocker k(&_imp->lock);
+    return (int)_imp->frames.size();
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,107 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PLAYBACKFRAMEBUFFER_H
+#define NATRON_ENGINE_PLAYBACKFRAMEBUFFER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef> // std::size_t
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/TimeValue.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Holds the display-ready results of the frames rendered during playback so that the following
+ * loops over the same range step through them without rendering anything.
+ *
+ * Each frame is stored with a key identifying everything it depends on (the hash of the tree, the mipmap level,
+ * the region of interest...): a frame is only returned if its key matches the one of the frame about to be displayed.
+ * A frame with a different key is stale and is removed when looked-up.
+ *
+ * The buffer never holds more than the memory budget given for each insertion. When it is full, the frames outside of
+ * the playback range are evicted first. Frames inside of the range are never evicted to make room for other frames of
+ * the range: when looping over a range that does not fit, evicting them would just force them to be rendered again
+ * on the next loop. The first frames of the range are kept instead and only the following ones are rendered.
+ *
+ * This class is thread-safe.
+ **/
+struct PlaybackFrameBufferPrivate;
+class PlaybackFrameBuffer
+{
+public:
+
+    PlaybackFrameBuffer();
+
+    ~PlaybackFrameBuffer();
+
+    /**
+     * @brief Returns the results stored for the given time if they were produced with the given key, or NULL.
+     **/
+    RenderFrameResultsContainerPtr getFrame(TimeValue time, U64 key);
+
+    /**
+     * @brief Stores the results of the frame at the given time which take the given size in bytes.
+     * @param maxSize The memory budget of the buffer in bytes
+     * @param firstFrame, lastFrame The playback range
+     * @returns False if the frame could not fit in the budget.
+     **/
+    bool insertFrame(TimeValue time,
+                     U64 key,
+                     const RenderFrameResultsContainerPtr& results,
+                     std::size_t size,
+                     std::size_t maxSize,
+                     TimeValue firstFrame,
+                     TimeValue lastFrame);
+
+    /**
+     * @brief Removes all frames from the buffer
+     **/
+    void clear();
+
+    /**
+     * @brief Returns the memory held by the frames of the buffer, in bytes
+     **/
+    std::size_t getSize() const;
+
+    int getNumFrames() const;
+
+private:
+
+    boost::scoped_ptr<PlaybackFrameBufferPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_PLAYBACKFRAMEBUFFER_H
@@ -25,6 +25,8 @@
 
 #include "PluginMemory.h"
 
+#include <algorithm>
+#include <list>
 #include <vector>
 #include <cassert>
 #include <stdexcept>
@@ -34,21 +36,172 @@ CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_ON(deprecated)
 #include "Engine/AppManager.h"
 #include "Engine/Cache.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/RamBuffer.h"
 
 
 NATRON_NAMESPACE_ENTER
 
 
+// Number of buffers and bytes each node keeps for its plug-in
+#define NATRON_PLUGIN_MEMORY_CACHE_COUNT 4
+#define NATRON_PLUGIN_MEMORY_CACHE_MAX_SIZE (512 * 1024 * 1024)
+
+// Protects totalPluginMemoryBytes
+static QMutex totalPluginMemoryBytesMutex;
+
+// The bytes held for plug-ins, @see PluginMemory::getTotalPluginMemoryBytes
+static std::size_t totalPluginMemoryBytes = 0;
+
+static void
+addTotalPluginMemoryBytes(std::size_t nBytes)
+{
+    QMutexLocker k(&totalPluginMemoryBytesMutex);
+    totalPluginMemoryBytes += nBytes;
+}
+
+static void
+removeTotalPluginMemoryBytes(std::size_t nBytes)
+{
+    QMutexLocker k(&totalPluginMemoryBytesMutex);
+    assert(totalPluginMemoryBytes >= nBytes);
+    totalPluginMemoryBytes -= std::min(nBytes, totalPluginMemoryBytes);
+}
+
+/**
+ * @brief Gives back a buffer that is no longer held for plug-ins to the ImageBufferPool, or free it
+ **/
+static void
+releaseToImageBufferPool(RamBuffer<char>* buffer)
+{
+    removeTotalPluginMemoryBytes(buffer->size());
+    ImageBufferPool* pool = appPTR ? appPTR->getImageBufferPool() : 0;
+    if (pool) {
+        pool->releaseBuffer(buffer);
+    } else {
+        buffer->clear();
+    }
+}
+
+struct PluginMemoryCachePrivate
+{
+    mutable QMutex lock;
+    std::list<RamBuffer<char>*> buffers;
+    std::size_t nBytes;
+
+    PluginMemoryCachePrivate()
+    : lock()
+    , buffers()
+    , nBytes(0)
+    {
+
+    }
+};
+
+PluginMemoryCache::PluginMemoryCache()
+: _imp(new PluginMemoryCachePrivate())
+{
+
+}
+
+PluginMemoryCache::~PluginMemoryCache()
+{
+    clear();
+}
+
+bool
+PluginMemoryCache::takeBuffer(std::size_t sizeClass, RamBuffer<char>* buffer)
+{
+    assert(!buffer->getData());
+    QMutexLocker k(&_imp->lock);
+    for (std::list<RamBuffer<char>*>::iterator it = _imp->buffers.begin(); it != _imp->buffers.end(); ++it) {
+        if ( (*it)->size() == sizeClass ) {
+            buffer->swap(**it);
+            delete *it;
+            _imp->buffers.erase(it);
+            _imp->nBytes -= sizeClass;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+PluginMemoryCache::releaseBuffer(RamBuffer<char>* buffer)
+{
+    std::size_t size = buffer->size();
+    QMutexLocker k(&_imp->lock);
+    if ( _imp->buffers.size() >= NATRON_PLUGIN_MEMORY_CACHE_COUNT || _imp->nBytes + size > NATRON_PLUGIN_MEMORY_CACHE_MAX_SIZE ) {
+        return false;
+    }
+    RamBuffer<char>* kept = new RamBuffer<char>;
+    kept->swap(*buffer);
+    _imp->buffers.push_back(kept);
+    _imp->nBytes += size;
+    return true;
+}
+
+std::size_t
+PluginMemoryCache::getCurrentSize() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->nBytes;
+}
+
+void
+PluginMemoryCache::clear()
+{
+    std::list<RamBuffer<char>*> buffers;
+    {
+        QMutexLocker k(&_imp->lock);
+        buffers.swap(_imp->buffers);
+        _imp->nBytes = 0;
+    }
+    for (std::list<RamBuffer<char>*>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+        releaseToImageBufferPool(*it);
+        delete *it;
+    }
+}
+
 struct PluginMemory::Implementation
 {
     Implementation()
     : data()
+    , nBytes(0)
+    , cache()
     , mutex()
     {
     }
 
+    /**
+     * @brief Gives back the buffer to the cache of the node, or to the ImageBufferPool if it is full.
+     * Must be called with mutex locked.
+     **/
+    void releaseData()
+    {
+        if (!data.getData()) {
+            data.clear();
+            nBytes = 0;
+            return;
+        }
+        // Only buffers of a size class may be looked up again
+        PluginMemoryCachePtr nodeCache = cache.lock();
+        bool isSizeClass = ImageBufferPool::getSizeClass( data.size() ) == data.size();
+        if ( !nodeCache || !isSizeClass || !nodeCache->releaseBuffer(&data) ) {
+            releaseToImageBufferPool(&data);
+        }
+        assert(!data.getData());
+        nBytes = 0;
+    }
+
     RamBuffer<char> data;
+
+    // The size requested by the plug-in, data may be larger, @see ImageBufferPool::getSizeClass
+    std::size_t nBytes;
+
+    // The cache of the node that allocated the memory
+    PluginMemoryCacheWPtr cache;
+
     QMutex mutex;
 };
 
@@ -60,13 +213,14 @@ PluginMemory::PluginMemory()
 
 PluginMemory::~PluginMemory()
 {
-
+    QMutexLocker l(&_imp->mutex);
+    _imp->releaseData();
 }
 
 std::size_t
 PluginMemory::getBufferSize() const
 {
-    return _imp->data.size();
+    return _imp->nBytes;
 }
 
 void
@@ -76,15 +230,42 @@ PluginMemory::allocateMemoryImpl(const AllocateMemoryArgs& args)
     assert(thisArgs);
 
     QMutexLocker l(&_imp->mutex);
-    _imp->data.resize(thisArgs->_nBytes);
+    _imp->releaseData();
+    _imp->cache = thisArgs->cache;
+
+    if (thisArgs->_nBytes == 0) {
+        return;
+    }
+
+    // Look for a buffer released by a previous render of the node first, then in the shared pool.
+    // The memory of plug-ins is not cleared, as for a fresh allocation.
+    std::size_t sizeClass = ImageBufferPool::getSizeClass(thisArgs->_nBytes);
+    bool recycled = false;
+    if (sizeClass) {
+        if (thisArgs->cache) {
+            // The buffers of the node cache are already accounted
+            recycled = thisArgs->cache->takeBuffer(sizeClass, &_imp->data);
+        }
+        if (!recycled) {
+            ImageBufferPool* pool = appPTR ? appPTR->getImageBufferPool() : 0;
+            if ( pool && pool->takeBuffer(thisArgs->_nBytes, &_imp->data) ) {
+                addTotalPluginMemoryBytes(sizeClass);
+                recycled = true;
+            }
+        }
+    }
+    if (!recycled) {
+        _imp->data.resize(sizeClass ? sizeClass : thisArgs->_nBytes);
+        addTotalPluginMemoryBytes( _imp->data.size() );
+    }
+    _imp->nBytes = thisArgs->_nBytes;
 }
 
 void
 PluginMemory::deallocateMemoryImpl()
 {
     QMutexLocker l(&_imp->mutex);
-    _imp->data.clear();
-
+    _imp->releaseData();
 }
 
 
@@ -98,4 +279,11 @@ PluginMemory::getData()
     return _imp->data.getData();
 }
 
+std::size_t
+PluginMemory::getTotalPluginMemoryBytes()
+{
+    QMutexLocker k(&totalPluginMemoryBytesMutex);
+    return totalPluginMemoryBytes;
+}
+
 NATRON_NAMESPACE_EXIT
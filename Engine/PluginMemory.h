@@ -35,20 +35,67 @@
 
 #include "Global/GlobalDefines.h"
 #include "Engine/ImageStorage.h"
+#include "Engine/RamBuffer.h"
 
 #include "Engine/EngineFwd.h"
 
 NATRON_NAMESPACE_ENTER
 
+/**
+ * @brief The memory released by the plug-in of a node, kept so that the next renders of the same effect reuse it.
+ * Plug-ins such as denoisers or retimers allocate the same large scratch buffers for every tile and every frame:
+ * buffers are first looked up here, then in the ImageBufferPool. When this cache is full or cleared,
+ * its buffers are handed to the ImageBufferPool.
+ **/
+struct PluginMemoryCachePrivate;
+class PluginMemoryCache
+{
+public:
+
+    PluginMemoryCache();
+
+    ~PluginMemoryCache();
+
+    /**
+     * @brief If a buffer of exactly sizeClass bytes exists, swap it with the given buffer which must be empty
+     * and return true.
+     **/
+    bool takeBuffer(std::size_t sizeClass, RamBuffer<char>* buffer);
+
+    /**
+     * @brief Keeps the memory of the given buffer and return true, in which case the buffer is empty in output.
+     * Returns false if the cache is full.
+     **/
+    bool releaseBuffer(RamBuffer<char>* buffer);
+
+    /**
+     * @brief Returns the number of bytes held by the cache
+     **/
+    std::size_t getCurrentSize() const;
+
+    /**
+     * @brief Gives back all buffers to the ImageBufferPool
+     **/
+    void clear();
+
+private:
+
+    boost::scoped_ptr<PluginMemoryCachePrivate> _imp;
+};
+
 class PluginMemAllocateMemoryArgs : public AllocateMemoryArgs
 {
 public:
 
     std::size_t _nBytes;
 
+    // The cache of the node: the memory is looked up there and given back to it once deallocated
+    PluginMemoryCachePtr cache;
+
     PluginMemAllocateMemoryArgs(std::size_t nBytes)
     : AllocateMemoryArgs()
     , _nBytes(nBytes)
+    , cache()
     {
         bitDepth = eImageBitDepthByte;
     }
@@ -81,6 +128,12 @@ public:
         return eStorageModeRAM;
     }
 
+    /**
+     * @brief Returns the number of bytes held for plug-ins, either allocated or kept for reuse by the nodes.
+     * This memory is accounted in the budget of the tile cache, @see StorageDeleterThread
+     **/
+    static std::size_t getTotalPluginMemoryBytes();
+
 private:
 
     virtual void allocateMemoryImpl(const AllocateMemoryArgs& args) OVERRIDE FINAL;
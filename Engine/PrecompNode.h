@@ -82,6 +82,11 @@ public:
 
     virtual void setupInitialSubGraphState() OVERRIDE FINAL;
 
+    virtual bool isSubGraphFreezeSupported() const OVERRIDE FINAL WARN_UNUSED_RETURN
+    {
+        return true;
+    }
+
 public Q_SLOTS:
 
     void onPreRenderFinished();
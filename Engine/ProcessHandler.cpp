@@ -181,6 +181,18 @@ ProcessHandler::onDataWrittenToSocket()
             //The report does not have extended timer infos
             Q_EMIT frameRendered(str.toInt(), progressPercent);
         }
+    } else if ( str.startsWith( QString::fromUtf8(kFrameAvailableInCacheStringShort) ) ) {
+        str = str.remove( 0, QString::fromUtf8(kFrameAvailableInCacheStringShort).size() );
+
+        int view = 0;
+        int foundView = str.lastIndexOf( QString::fromUtf8(kViewStringShort) );
+        if (foundView != -1) {
+            view = str.mid( foundView + QString::fromUtf8(kViewStringShort).size() ).toInt();
+            str = str.mid(0, foundView);
+        }
+        if ( !str.isEmpty() ) {
+            Q_EMIT frameAvailableInCache(str.toInt(), view);
+        }
     } else if ( str.startsWith( QString::fromUtf8(kRenderingFinishedStringShort) ) ) {
         ///don't do anything
     } else if ( str.startsWith( QString::fromUtf8(kBgProcessServerCreatedShort) ) ) {
@@ -83,6 +83,10 @@ NATRON_NAMESPACE_ENTER
  *
  * NB: Message that are exchanged via this channel consists of exactly 1 line, i.e a
  * string terminated with the \n character.
+ *
+ * The pipe only carries notifications: when both processes share the persistent tile cache, the images rendered by the
+ * background process are read directly from the cache, the background process only notifies the frames it inserted with
+ * kFrameAvailableInCacheStringShort.
  **/
 class ProcessHandler
     : public QObject
@@ -177,6 +181,12 @@ Q_SIGNALS:
 
     void frameRendered(int frame, double progress);
 
+    /**
+     * @brief Emitted when the background process inserted the images of the given frame and view in the
+     * persistent tile cache shared with this process.
+     **/
+    void frameAvailableInCache(int frame, int view);
+
     void processCanceled();
 
     /**
@@ -82,6 +82,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/MemoryInfo.h" // isApplication32Bits
 #include "Engine/Node.h"
 #include "Engine/OutputSchedulerThread.h"
+#include "Engine/ProjectAutoSaveJournal.h"
 #include "Engine/ProjectPrivate.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/Settings.h"
@@ -189,6 +190,131 @@ public:
     }
 };
 
+// The script-names of the project and node parameters holding Python callbacks
+const char* pythonCallbackKnobNames[] = {
+    "afterProjectLoad", "beforeProjectSave", "beforeProjectClose",
+    "afterNodeCreated", "beforeNodeRemoval", "onParamChanged", "onInputChanged", "afterItemsSelectionChanged",
+    "beforeFrameRender", "beforeRender", "afterFrameRender", "afterRender",
+    kNatronNodeKnobPyPlugPluginCallbacksPythonScript,
+    0
+};
+
+bool
+knobRequiresPython(const SERIALIZATION_NAMESPACE::KnobSerializationBase& serializationBase)
+{
+    const SERIALIZATION_NAMESPACE::GroupKnobSerialization* isGroup = dynamic_cast<const SERIALIZATION_NAMESPACE::GroupKnobSerialization*>(&serializationBase);
+    if (isGroup) {
+        for (std::list<boost::shared_ptr<SERIALIZATION_NAMESPACE::KnobSerializationBase> >::const_iterator it = isGroup->_children.begin(); it != isGroup->_children.end(); ++it) {
+            if ( knobRequiresPython(**it) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+    const SERIALIZATION_NAMESPACE::KnobSerialization* serialization = dynamic_cast<const SERIALIZATION_NAMESPACE::KnobSerialization*>(&serializationBase);
+    if (!serialization) {
+        return false;
+    }
+    bool isCallback = false;
+    for (const char** name = pythonCallbackKnobNames; *name; ++name) {
+        if (serialization->_scriptName == *name) {
+            isCallback = true;
+            break;
+        }
+    }
+    for (SERIALIZATION_NAMESPACE::KnobSerialization::PerViewValueSerializationMap::const_iterator it = serialization->_values.begin(); it != serialization->_values.end(); ++it) {
+        for (SERIALIZATION_NAMESPACE::KnobSerialization::PerDimensionValueSerializationVec::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            if ( !it2->_expression.empty() && (it2->_expressionLanguage != kKnobSerializationExpressionLanguageExprtk) ) {
+                return true;
+            }
+            if ( isCallback && !it2->_value.isString.empty() ) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+} // knobRequiresPython
+
+bool
+knobsRequirePython(const SERIALIZATION_NAMESPACE::KnobSerializationList& knobs)
+{
+    for (SERIALIZATION_NAMESPACE::KnobSerializationList::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        if ( knobRequiresPython(**it) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+tableItemRequiresPython(const SERIALIZATION_NAMESPACE::KnobTableItemSerialization& item)
+{
+    if ( knobsRequirePython(item.knobs) ) {
+        return true;
+    }
+    for (std::list<SERIALIZATION_NAMESPACE::KnobTableItemSerializationPtr>::const_iterator it = item.children.begin(); it != item.children.end(); ++it) {
+        if ( tableItemRequiresPython(**it) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Returns true if the node has Python expressions or callbacks, or if its plug-in is not loaded: it may
+ * be a PyPlug written in Python.
+ **/
+bool
+nodeRequiresPython(const SERIALIZATION_NAMESPACE::NodeSerialization& node)
+{
+    QString pluginID = QString::fromUtf8( node._pluginID.c_str() );
+    if ( !appPTR->getPluginBinary(pluginID, -1, -1, false) &&
+         !appPTR->getPluginBinaryFromOldID(pluginID, node._pluginMajorVersion, node._pluginMinorVersion, false) ) {
+        return true;
+    }
+    if ( knobsRequirePython(node._knobsValues) ) {
+        return true;
+    }
+    for (std::list<boost::shared_ptr<SERIALIZATION_NAMESPACE::GroupKnobSerialization> >::const_iterator it = node._userPages.begin(); it != node._userPages.end(); ++it) {
+        if ( knobRequiresPython(**it) ) {
+            return true;
+        }
+    }
+    for (std::list<SERIALIZATION_NAMESPACE::KnobItemsTableSerializationPtr>::const_iterator it = node._tables.begin(); it != node._tables.end(); ++it) {
+        for (std::list<SERIALIZATION_NAMESPACE::KnobTableItemSerializationPtr>::const_iterator it2 = (*it)->items.begin(); it2 != (*it)->items.end(); ++it2) {
+            if ( tableItemRequiresPython(**it2) ) {
+                return true;
+            }
+        }
+    }
+    for (SERIALIZATION_NAMESPACE::NodeSerializationList::const_iterator it = node._children.begin(); it != node._children.end(); ++it) {
+        if ( nodeRequiresPython(**it) ) {
+            return true;
+        }
+    }
+
+    return false;
+} // nodeRequiresPython
+
+bool
+projectRequiresPython(const SERIALIZATION_NAMESPACE::ProjectSerialization& project)
+{
+    if ( knobsRequirePython(project._projectKnobs) ) {
+        return true;
+    }
+    for (SERIALIZATION_NAMESPACE::NodeSerializationList::const_iterator it = project._nodes.begin(); it != project._nodes.end(); ++it) {
+        if ( nodeRequiresPython(**it) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 bool
@@ -220,6 +346,7 @@ Project::loadProject(const QString & path,
                 }
                 if ( (ret == eStandardButtonNo) || (ret == eStandardButtonEscape) ) {
                     QFile::remove(realPath + autosaveFileName);
+                    ProjectAutoSaveJournal::removeJournal(realPath + autosaveFileName);
                 } else {
                     realName = autosaveFileName;
                     isAutoSave = true;
@@ -305,7 +432,8 @@ Project::loadProjectInternal(const QString & pathIn,
 
     bool ret = false;
     FStreamsSupport::ifstream ifile;
-    FStreamsSupport::open( &ifile, filePathOut.toStdString() );
+    // The project may be binary encoded, see SerializationBinary
+    FStreamsSupport::open( &ifile, filePathOut.toStdString(), std::ios_base::in | std::ios_base::binary );
     if (!ifile) {
         throw std::runtime_error( tr("Failed to open %1").arg(filePathOut).toStdString() );
     }
@@ -316,6 +444,16 @@ Project::loadProjectInternal(const QString & pathIn,
         // We must keep this boolean for bakcward compatilbility, versinioning cannot help us in that case...
         _imp->lastProjectLoaded.reset(new SERIALIZATION_NAMESPACE::ProjectSerialization);
         appPTR->loadProjectFromFileFunction(ifile, filePathOut.toStdString(), getApp(), _imp->lastProjectLoaded.get());
+        if (isAutoSave) {
+            // Replay the changes written after the full auto-save
+            ProjectAutoSaveJournal::applyRecords(filePathOut, _imp->lastProjectLoaded.get());
+        }
+
+        // With --lazy-python, initialize Python before creating the nodes if the project needs it:
+        // the render threads cannot initialize it.
+        if ( !appPTR->isPythonInitialized() && projectRequiresPython(*_imp->lastProjectLoaded) ) {
+            appPTR->ensurePythonInitialized();
+        }
 
         {
             FlagSetter __raii_loadingProjectInternal__(true, &_imp->isLoadingProjectInternal, &_imp->isLoadingProjectMutex);
@@ -432,8 +570,15 @@ Project::saveProject_imp(const QString & path,
 
             ///We just saved, remove the last auto-save which is now obsolete
             removeLastAutosave();
+            _imp->invalidateAutoSaveJournal();
 
             //}
+        } else if ( updateProjectProperties && _imp->writeAutoSaveJournal(&ret) ) {
+            // Only the nodes that changed were appended to the journal of the last auto-save
+            _imp->lastAutoSave = QDateTime::currentDateTime();
+            QString projectPath = QString::fromUtf8( _imp->getProjectPath().c_str() );
+            QString projectFilename = QString::fromUtf8( _imp->getProjectFilename().c_str() );
+            Q_EMIT projectNameChanged(projectPath + projectFilename, true);
         } else {
             if (updateProjectProperties) {
                 ///Replace the last auto-save with a more recent one
@@ -441,8 +586,15 @@ Project::saveProject_imp(const QString & path,
             }
 
             ret = saveProjectInternal(path, name, true, updateProjectProperties);
+
+            if (updateProjectProperties) {
+                _imp->onAutoSaveSnapshotWritten(ret);
+            }
         }
     } catch (const std::exception & e) {
+        if (autoS && updateProjectProperties) {
+            _imp->invalidateAutoSaveJournal();
+        }
         if (!autoS) {
             Dialogs::errorDialog( tr("Save").toStdString(), e.what() );
         } else {
@@ -533,8 +685,9 @@ Project::saveProjectInternal(const QString & path,
     tmpFilename.append( QString::number( time.toMSecsSinceEpoch() ) );
 
     {
+        const SERIALIZATION_NAMESPACE::SerializationFormatEnum format = appPTR->getCurrentSettings()->getProjectFileFormat();
         FStreamsSupport::ofstream ofile;
-        FStreamsSupport::open( &ofile, tmpFilename.toStdString() );
+        FStreamsSupport::open( &ofile, tmpFilename.toStdString(), format == SERIALIZATION_NAMESPACE::eSerializationFormatYAML ? std::ios_base::out : std::ios_base::out | std::ios_base::binary );
         if (!ofile) {
             throw std::runtime_error( tr("Failed to open file ").toStdString() + tmpFilename.toStdString() );
         }
@@ -553,7 +706,7 @@ Project::saveProjectInternal(const QString & path,
             SERIALIZATION_NAMESPACE::ProjectSerialization projectSerializationObj;
             toSerialization(&projectSerializationObj);
             appPTR->aboutToSaveProject(&projectSerializationObj);
-            SERIALIZATION_NAMESPACE::write(ofile, projectSerializationObj, NATRON_PROJECT_FILE_HEADER);
+            SERIALIZATION_NAMESPACE::write(ofile, projectSerializationObj, NATRON_PROJECT_FILE_HEADER, format);
         } catch (...) {
             if (!autoSave && updateProjectProperties) {
                 ///Reset the old project path in case of failure.
@@ -623,7 +776,7 @@ Project::autoSave()
 }
 
 void
-Project::triggerAutoSave()
+Project::triggerAutoSave(const NodePtr& changedNode)
 {
     ///Should only be called in the main-thread, that is upon user interaction.
     assert( QThread::currentThread() == qApp->thread() );
@@ -643,6 +796,8 @@ Project::triggerAutoSave()
         }
     }
 
+    _imp->markDirtyForAutoSave(changedNode);
+
     _imp->autoSaveTimer->start( appPTR->getCurrentSettings()->getAutoSaveDelayMS() );
 }
 
@@ -706,6 +861,9 @@ Project::findAutoSaveForProject(const QString& projectPath,
         if (suffixPos == -1) {
             continue;
         }
+        if ( ProjectAutoSaveJournal::isJournalFile(entry) ) {
+            continue;
+        }
         QString filename = projectPath + entry.left( suffixPos + ntpExt.size() );
         if ( (filename == projectAbsFilePath) && QFile::exists(filename) ) {
             *autoSaveFileName = entry;
@@ -1836,6 +1994,7 @@ Project::removeLastAutosave()
 
     if ( !filepath.isEmpty() ) {
         QFile::remove(filepath);
+        ProjectAutoSaveJournal::removeJournal(filepath);
     }
 
     /*
@@ -1849,6 +2008,7 @@ Project::removeLastAutosave()
     if ( QFile::exists(autoSaveFilePath) ) {
         QFile::remove(autoSaveFilePath);
     }
+    ProjectAutoSaveJournal::removeJournal(autoSaveFilePath);
 }
 
 void
@@ -1998,6 +2158,7 @@ Project::doResetEnd(bool aboutToQuit)
             _imp->autoSaveTimer->stop();
             _imp->additionalFormats.clear();
         }
+        _imp->invalidateAutoSaveJournal();
 
         Q_EMIT projectNameChanged(QString::fromUtf8(NATRON_PROJECT_UNTITLED), false);
         const KnobsVec & knobs = getKnobs();
@@ -2933,6 +3094,9 @@ Project::fromSerialization(const SERIALIZATION_NAMESPACE::SerializationObjectBas
     // Restore the nodes
     createNodesFromSerialization(serialization->_nodes, eCreateNodesFromSerializationFlagsNone, 0);
 
+    // Groups whose nodes were not created may be rendered if they are connected
+    createDeferredSubGraphsOfConnectedGroups();
+
     QDateTime time = QDateTime::currentDateTime();
     _imp->hasProjectBeenSavedByUser = true;
     _imp->ageSinceLastSave = time;
@@ -128,8 +128,10 @@ public:
 
     /**
      * @brief Same as autoSave() but the auto-save is run in a separate thread instead.
+     * @param changedNode If set, only this node changed: the auto-save may only write this node to the journal
+     * of the last auto-save, see ProjectAutoSaveJournal.
      **/
-    void triggerAutoSave();
+    void triggerAutoSave(const NodePtr& changedNode = NodePtr());
 
     /**
      * @brief Returns the path to where the auto save files are stored on disk.
@@ -0,0 +1,168 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ProjectAutoSaveJournal.h"
+
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include <QtCore/QFile>
+
+#include "Global/FStreamsSupport.h"
+
+#include "Serialization/NodeSerialization.h"
+#include "Serialization/ProjectSerialization.h"
+#include "Serialization/SerializationIO.h"
+
+// Each record starts with this tag, followed by the size of the key and the size of the data
+#define NATRON_AUTOSAVE_JOURNAL_RECORD_TAG "NatronAutoSaveJournalRecord"
+
+#define NATRON_AUTOSAVE_JOURNAL_EXT ".journal"
+
+NATRON_NAMESPACE_ENTER
+
+QString
+ProjectAutoSaveJournal::getJournalFilePath(const QString& autoSaveFilePath)
+{
+    return autoSaveFilePath + QString::fromUtf8(NATRON_AUTOSAVE_JOURNAL_EXT);
+}
+
+bool
+ProjectAutoSaveJournal::isJournalFile(const QString& fileName)
+{
+    return fileName.endsWith( QString::fromUtf8(NATRON_AUTOSAVE_JOURNAL_EXT) );
+}
+
+qint64
+ProjectAutoSaveJournal::appendRecords(const QString& autoSaveFilePath,
+                                      const std::list<Record>& records)
+{
+    // Encode everything first so that a failure does not leave a partial record
+    std::string data;
+    for (std::list<Record>::const_iterator it = records.begin(); it != records.end(); ++it) {
+        std::stringstream ss;
+        SERIALIZATION_NAMESPACE::write(ss, *it->second, std::string());
+        std::string nodeData = ss.str();
+
+        std::stringstream header;
+        header << NATRON_AUTOSAVE_JOURNAL_RECORD_TAG << ' ' << it->first.size() << ' ' << nodeData.size() << '\n';
+        data += header.str();
+        data += it->first;
+        data += nodeData;
+    }
+
+    std::string filePath = getJournalFilePath(autoSaveFilePath).toStdString();
+    FStreamsSupport::ofstream ofile;
+    FStreamsSupport::open( &ofile, filePath, std::ios_base::out | std::ios_base::app | std::ios_base::binary );
+    if (!ofile) {
+        throw std::runtime_error("Failed to open " + filePath);
+    }
+    ofile.write( data.c_str(), data.size() );
+    ofile.flush();
+    if (!ofile) {
+        throw std::runtime_error("Failed to write " + filePath);
+    }
+    return (qint64)ofile.tellp();
+} // appendRecords
+
+int
+ProjectAutoSaveJournal::applyRecords(const QString& autoSaveFilePath,
+                                     SERIALIZATION_NAMESPACE::ProjectSerialization* project)
+{
+    QString filePath = getJournalFilePath(autoSaveFilePath);
+    if ( !QFile::exists(filePath) ) {
+        return 0;
+    }
+    FStreamsSupport::ifstream ifile;
+    FStreamsSupport::open( &ifile, filePath.toStdString(), std::ios_base::in | std::ios_base::binary );
+    if (!ifile) {
+        return 0;
+    }
+
+    // The script-name in the snapshot of the nodes replaced so far: their serialization may have another name
+    std::map<std::string, SERIALIZATION_NAMESPACE::NodeSerializationList::iterator> replacedNodes;
+
+    int nRecords = 0;
+    std::string headerLine;
+    while ( std::getline(ifile, headerLine) ) {
+        std::istringstream header(headerLine);
+        std::string tag;
+        std::size_t keySize = 0, dataSize = 0;
+        header >> tag >> keySize >> dataSize;
+        if ( !header || (tag != NATRON_AUTOSAVE_JOURNAL_RECORD_TAG) ) {
+            break;
+        }
+        std::vector<char> buf(keySize + dataSize);
+        if ( !buf.empty() && !ifile.read( &buf[0], buf.size() ) ) {
+            // Truncated record
+            break;
+        }
+        std::string key(buf.begin(), buf.begin() + keySize);
+        SERIALIZATION_NAMESPACE::NodeSerializationPtr node = boost::make_shared<SERIALIZATION_NAMESPACE::NodeSerialization>();
+        try {
+            std::stringstream ss( std::string(buf.begin() + keySize, buf.end()) );
+            SERIALIZATION_NAMESPACE::read(std::string(), ss, node.get());
+        } catch (...) {
+            break;
+        }
+
+        std::map<std::string, SERIALIZATION_NAMESPACE::NodeSerializationList::iterator>::iterator found = replacedNodes.find(key);
+        if ( found != replacedNodes.end() ) {
+            *found->second = node;
+        } else {
+            SERIALIZATION_NAMESPACE::NodeSerializationList::iterator it = project->_nodes.begin();
+            for (; it != project->_nodes.end(); ++it) {
+                if ( (*it)->_nodeScriptName == key ) {
+                    break;
+                }
+            }
+            if ( it != project->_nodes.end() ) {
+                *it = node;
+            } else {
+                it = project->_nodes.insert(project->_nodes.end(), node);
+            }
+            replacedNodes.insert( std::make_pair(key, it) );
+        }
+        ++nRecords;
+    }
+    return nRecords;
+} // applyRecords
+
+void
+ProjectAutoSaveJournal::removeJournal(const QString& autoSaveFilePath)
+{
+    QString filePath = getJournalFilePath(autoSaveFilePath);
+    if ( QFile::exists(filePath) ) {
+        QFile::remove(filePath);
+    }
+}
+
+NATRON_NAMESPACE_EXIT
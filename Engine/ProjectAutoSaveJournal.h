@@ -0,0 +1,88 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PROJECTAUTOSAVEJOURNAL_H
+#define NATRON_ENGINE_PROJECTAUTOSAVEJOURNAL_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+#include <utility>
+
+#include <QtCore/QString>
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The journal of an auto-save: instead of writing the whole project each time, an auto-save only appends
+ * the serialization of the top-level nodes that changed since the last full auto-save (the snapshot) to a file
+ * next to it. When recovering, the snapshot is loaded and the nodes in the journal replace the ones of the snapshot.
+ *
+ * Each record is identified by the script-name the node had in the snapshot, so that a renamed node still replaces
+ * its original. A record that was partially written, e.g: because of a crash, is ignored as well as the following ones.
+ **/
+class ProjectAutoSaveJournal
+{
+public:
+
+    // The script-name of the node in the snapshot and its current serialization
+    typedef std::pair<std::string, SERIALIZATION_NAMESPACE::NodeSerializationPtr> Record;
+
+    /**
+     * @brief Returns the path of the journal of the given auto-save file
+     **/
+    static QString getJournalFilePath(const QString& autoSaveFilePath);
+
+    /**
+     * @brief Returns true if the given file name is the one of a journal
+     **/
+    static bool isJournalFile(const QString& fileName);
+
+    /**
+     * @brief Appends the given records to the journal of the given auto-save file.
+     * Throws a std::runtime_error upon failure.
+     * @returns The size of the journal after writing, in bytes.
+     **/
+    static qint64 appendRecords(const QString& autoSaveFilePath, const std::list<Record>& records);
+
+    /**
+     * @brief Replaces the nodes of the project by the ones in the journal of the given auto-save file, if any.
+     * Nodes that were not in the snapshot are appended.
+     * @returns The number of records applied.
+     **/
+    static int applyRecords(const QString& autoSaveFilePath, SERIALIZATION_NAMESPACE::ProjectSerialization* project);
+
+    /**
+     * @brief Removes the journal of the given auto-save file, if any.
+     **/
+    static void removeJournal(const QString& autoSaveFilePath);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_PROJECTAUTOSAVEJOURNAL_H
@@ -26,6 +26,7 @@
 #include "ProjectPrivate.h"
 
 #include <list>
+#include <set>
 #include <cassert>
 #include <stdexcept>
 #include <sstream> // stringstream
@@ -34,6 +35,7 @@
 #include <QtCore/QTimer>
 #include <QtCore/QDateTime>
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QDir>
 
 #include "Global/QtCompat.h"
@@ -44,8 +46,10 @@
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/Project.h"
+#include "Engine/ProjectAutoSaveJournal.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/Settings.h"
 #include "Engine/TimeLine.h"
@@ -94,6 +98,15 @@ ProjectPrivate::ProjectPrivate(Project* project)
     , isSavingProjectMutex()
     , isSavingProject(false)
     , autoSaveTimer()
+    , autoSaveFutures()
+    , autoSaveJournalMutex()
+    , autoSaveSnapshotFilePath()
+    , autoSaveSnapshotSize(0)
+    , autoSaveJournalSize(0)
+    , autoSaveJournalRecordsCount(0)
+    , autoSaveAllDirty(true)
+    , autoSaveDirtyNodes()
+    , autoSaveSnapshotNodeNames()
     , projectClosing(false)
     , tlsData()
 
@@ -269,6 +282,129 @@ ProjectPrivate::runOnProjectSaveCallback(const std::string& filename,
     return filename;
 } // ProjectPrivate::runOnProjectSaveCallback
 
+// Past this number of records in the journal, a full auto-save is written instead
+#define NATRON_AUTOSAVE_JOURNAL_MAX_RECORDS 64
+
+void
+ProjectPrivate::markDirtyForAutoSave(const NodePtr& node)
+{
+    QMutexLocker k(&autoSaveJournalMutex);
+    if (!node) {
+        autoSaveAllDirty = true;
+        return;
+    }
+
+    // The journal only contains top-level nodes: a change in a group changes its serialization
+    NodePtr topLevelNode = node;
+    NodeGroupPtr isGroup = toNodeGroup( topLevelNode->getGroup() );
+    while (isGroup) {
+        topLevelNode = isGroup->getNode();
+        isGroup = toNodeGroup( topLevelNode->getGroup() );
+    }
+    autoSaveDirtyNodes.push_back(topLevelNode);
+}
+
+bool
+ProjectPrivate::writeAutoSaveJournal(QString* filePath)
+{
+    NodesList dirtyNodes;
+    std::list<ProjectAutoSaveJournal::Record> records;
+    QString snapshotFilePath;
+    {
+        QMutexLocker k(&autoSaveJournalMutex);
+        bool fullAutoSaveNeeded = autoSaveSnapshotFilePath.isEmpty() ||
+                                  autoSaveAllDirty ||
+                                  autoSaveJournalRecordsCount >= NATRON_AUTOSAVE_JOURNAL_MAX_RECORDS ||
+                                  autoSaveJournalSize > autoSaveSnapshotSize;
+        snapshotFilePath = autoSaveSnapshotFilePath;
+
+        // The changes made from now on will be saved by the next auto-save
+        std::set<NodePtr> uniqueNodes;
+        for (NodesWList::const_iterator it = autoSaveDirtyNodes.begin(); it != autoSaveDirtyNodes.end(); ++it) {
+            NodePtr node = it->lock();
+            if ( node && uniqueNodes.insert(node).second ) {
+                dirtyNodes.push_back(node);
+            }
+        }
+        autoSaveDirtyNodes.clear();
+        autoSaveAllDirty = false;
+
+        if (fullAutoSaveNeeded) {
+            return false;
+        }
+
+        for (NodesList::const_iterator it = dirtyNodes.begin(); it != dirtyNodes.end(); ++it) {
+            std::string snapshotName;
+            std::list<std::pair<NodeWPtr, std::string> >::const_iterator found = autoSaveSnapshotNodeNames.begin();
+            for (; found != autoSaveSnapshotNodeNames.end(); ++found) {
+                if (found->first.lock() == *it) {
+                    break;
+                }
+            }
+            if ( found != autoSaveSnapshotNodeNames.end() ) {
+                snapshotName = found->second;
+            } else {
+                // The node was created after the snapshot
+                snapshotName = (*it)->getScriptName_mt_safe();
+                autoSaveSnapshotNodeNames.push_back( std::make_pair(*it, snapshotName) );
+            }
+            records.push_back( std::make_pair( snapshotName, SERIALIZATION_NAMESPACE::NodeSerializationPtr() ) );
+        }
+    }
+    if ( !QFile::exists(snapshotFilePath) ) {
+        return false;
+    }
+
+    // Serialize without the lock held so that the main-thread is never blocked on it
+    std::list<ProjectAutoSaveJournal::Record>::iterator recordIt = records.begin();
+    for (NodesList::const_iterator it = dirtyNodes.begin(); it != dirtyNodes.end(); ++it, ++recordIt) {
+        recordIt->second = boost::make_shared<SERIALIZATION_NAMESPACE::NodeSerialization>();
+        (*it)->toSerialization( recordIt->second.get() );
+    }
+
+    *filePath = snapshotFilePath;
+    if ( records.empty() ) {
+        return true;
+    }
+    try {
+        qint64 journalSize = ProjectAutoSaveJournal::appendRecords(snapshotFilePath, records);
+        QMutexLocker k(&autoSaveJournalMutex);
+        autoSaveJournalSize = journalSize;
+        autoSaveJournalRecordsCount += (int)records.size();
+    } catch (const std::exception& e) {
+        qDebug() << "Auto-save journal failure: " << e.what();
+        return false;
+    }
+    return true;
+} // writeAutoSaveJournal
+
+void
+ProjectPrivate::onAutoSaveSnapshotWritten(const QString& filePath)
+{
+    ProjectAutoSaveJournal::removeJournal(filePath);
+
+    NodesList nodes = _publicInterface->getNodes();
+    QMutexLocker k(&autoSaveJournalMutex);
+    autoSaveSnapshotFilePath = filePath;
+    autoSaveSnapshotSize = QFileInfo(filePath).size();
+    autoSaveJournalSize = 0;
+    autoSaveJournalRecordsCount = 0;
+    autoSaveSnapshotNodeNames.clear();
+    for (NodesList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        autoSaveSnapshotNodeNames.push_back( std::make_pair( *it, (*it)->getScriptName_mt_safe() ) );
+    }
+}
+
+void
+ProjectPrivate::invalidateAutoSaveJournal()
+{
+    QMutexLocker k(&autoSaveJournalMutex);
+    autoSaveSnapshotFilePath.clear();
+    autoSaveSnapshotNodeNames.clear();
+    autoSaveDirtyNodes.clear();
+    autoSaveAllDirty = true;
+}
+
 void
 ProjectPrivate::runOnProjectCloseCallback()
 {
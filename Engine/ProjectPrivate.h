@@ -106,6 +106,24 @@ public:
     bool isSavingProject; //< true when the project is saving
     boost::shared_ptr<QTimer> autoSaveTimer;
     std::list<boost::shared_ptr<QFutureWatcher<void> > > autoSaveFutures;
+
+    // Protects the fields below, used to write the journal of the auto-save, see ProjectAutoSaveJournal
+    mutable QMutex autoSaveJournalMutex;
+
+    // The last full auto-save next to which the journal is written. Empty if the next auto-save must be a full one.
+    QString autoSaveSnapshotFilePath;
+    qint64 autoSaveSnapshotSize;
+    qint64 autoSaveJournalSize;
+    int autoSaveJournalRecordsCount;
+
+    // True if something else than the nodes in autoSaveDirtyNodes changed since the last auto-save
+    bool autoSaveAllDirty;
+
+    // The top-level nodes that changed since the last auto-save
+    NodesWList autoSaveDirtyNodes;
+
+    // The script-name of the top-level nodes in the snapshot
+    std::list<std::pair<NodeWPtr, std::string> > autoSaveSnapshotNodeNames;
     mutable QMutex projectClosingMutex;
     bool projectClosing;
     boost::shared_ptr<TLSHolder<Project::ProjectTLSData> > tlsData;
@@ -136,6 +154,28 @@ public:
 
     void runOnProjectLoadCallback();
 
+    /**
+     * @brief Marks the given node as changed since the last auto-save, or the whole project if NULL.
+     **/
+    void markDirtyForAutoSave(const NodePtr& node);
+
+    /**
+     * @brief Appends the nodes that changed since the last auto-save to the journal of the last full auto-save.
+     * @returns False if a full auto-save must be written instead, in which case the changes are considered saved
+     * by the full auto-save.
+     **/
+    bool writeAutoSaveJournal(QString* filePath);
+
+    /**
+     * @brief Called once a full auto-save was written: the following auto-saves are appended to its journal
+     **/
+    void onAutoSaveSnapshotWritten(const QString& filePath);
+
+    /**
+     * @brief The next auto-save will be a full one
+     **/
+    void invalidateAutoSaveJournal();
+
     void setProjectFilename(const std::string& filename);
     std::string getProjectFilename() const;
 
@@ -42,6 +42,7 @@ GCC_DIAG_ON(unused-parameter)
 
 
 #include "Engine/AppInstance.h"
+#include "Engine/CacheStats.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/Project.h"
 #include "Engine/Node.h"
@@ -50,6 +51,7 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/Settings.h"
 #include "Engine/RenderQueue.h"
 #include "Engine/RenderEngine.h"
+#include "Engine/RenderStats.h"
 #include "Engine/ViewerNode.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/OutputSchedulerThread.h"
@@ -424,7 +426,7 @@ App::renderInternal(bool forceBlocking,
     w.firstFrame = TimeValue(firstFrame);
     w.lastFrame = TimeValue(lastFrame);
     w.frameStep = TimeValue(frameStep);
-    w.useRenderStats = false;
+    w.useRenderStats = getInternalApp()->getRenderStatsAccumulator()->isEnabled();
 
     std::list<RenderQueue::RenderWork> l;
     l.push_back(w);
@@ -472,7 +474,7 @@ App::renderInternal(bool forceBlocking,
         w.firstFrame = TimeValue(*itF);
         w.lastFrame = TimeValue(*itL);
         w.frameStep = TimeValue(*itS);
-        w.useRenderStats = false;
+        w.useRenderStats = getInternalApp()->getRenderStatsAccumulator()->isEnabled();
 
         l.push_back(w);
     }
@@ -616,6 +618,82 @@ App::getViewNames() const
     return ret;
 }
 
+void
+App::setRenderStatisticsEnabled(bool enabled)
+{
+    getInternalApp()->getRenderStatsAccumulator()->setEnabled(enabled);
+}
+
+bool
+App::isRenderStatisticsEnabled() const
+{
+    return getInternalApp()->getRenderStatsAccumulator()->isEnabled();
+}
+
+QVariantMap
+App::getRenderStatistics() const
+{
+    int framesCount;
+    double wallTime;
+    std::size_t ramPeak, glPeak;
+    RenderStatsAccumulator::NodeStatsMap nodes;
+    getInternalApp()->getRenderStatsAccumulator()->getStats(&framesCount, &wallTime, &ramPeak, &glPeak, &nodes);
+
+    QVariantMap ret;
+    ret[QString::fromUtf8("framesCount")] = framesCount;
+    ret[QString::fromUtf8("wallTime")] = wallTime;
+    ret[QString::fromUtf8("memoryPeakRAM")] = (qulonglong)ramPeak;
+    ret[QString::fromUtf8("memoryPeakGL")] = (qulonglong)glPeak;
+
+    QVariantMap nodesMap;
+    for (RenderStatsAccumulator::NodeStatsMap::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        const NodeRenderStats& stats = it->second.stats;
+        QVariantMap nodeMap;
+        nodeMap[QString::fromUtf8("pluginID")] = QString::fromUtf8( it->second.pluginID.c_str() );
+        nodeMap[QString::fromUtf8("framesCount")] = it->second.framesCount;
+        nodeMap[QString::fromUtf8("timeSpentRendering")] = stats.getTotalTimeSpentRendering();
+        nodeMap[QString::fromUtf8("timeSpentRenderingOpenGL")] = stats.getTimeSpentRendering(eRenderBackendTypeOpenGL);
+        nodeMap[QString::fromUtf8("timeSpentTransferring")] = stats.getTotalTimeSpentTransferring();
+
+        QVariantMap actionsMap;
+        for (int i = 0; i < eRenderStatsActionCount; ++i) {
+            RenderStatsActionEnum action = (RenderStatsActionEnum)i;
+            QVariantMap actionMap;
+            actionMap[QString::fromUtf8("calls")] = (qulonglong)stats.getActionCallsCount(action);
+            actionMap[QString::fromUtf8("totalTime")] = stats.getTotalTimeSpentInAction(action);
+            actionMap[QString::fromUtf8("meanTime")] = stats.getActionMeanTime(action);
+            actionMap[QString::fromUtf8("p95Time")] = stats.getActionTimePercentile(action, 95.);
+            actionsMap[QString::fromUtf8( NodeRenderStats::getActionName(action) )] = actionMap;
+        }
+        nodeMap[QString::fromUtf8("actions")] = actionsMap;
+
+        // The cache counters are only available while the node exists
+        NodePtr node = getInternalApp()->getNodeByFullySpecifiedName(it->first);
+        if (node) {
+            CacheNodeCounters counters;
+            node->getCacheStats(&counters);
+            std::map<std::string, double> values;
+            CacheStats::getCountersByName(counters, &values);
+            QVariantMap cacheMap;
+            for (std::map<std::string, double>::const_iterator it2 = values.begin(); it2 != values.end(); ++it2) {
+                cacheMap[QString::fromUtf8( it2->first.c_str() )] = it2->second;
+            }
+            nodeMap[QString::fromUtf8("cache")] = cacheMap;
+        }
+
+        nodesMap[QString::fromUtf8( it->first.c_str() )] = nodeMap;
+    }
+    ret[QString::fromUtf8("nodes")] = nodesMap;
+
+    return ret;
+} // App::getRenderStatistics
+
+void
+App::resetRenderStatistics()
+{
+    getInternalApp()->getRenderStatsAccumulator()->reset();
+}
+
 int
 App::getViewIndex(const QString& viewName) const
 {
@@ -34,6 +34,7 @@ CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QCoreApplication>
 #include <QtCore/QString>
+#include <QtCore/QVariant>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -341,6 +342,25 @@ public:
 
     void addProjectLayer(const ImageLayer& layer);
 
+    /**
+     * @brief When enabled, the renders of this project (viewers and App.render()) are profiled in depth and their
+     * statistics are accumulated until resetRenderStatistics() is called. Profiling slows down the renders a little.
+     **/
+    void setRenderStatisticsEnabled(bool enabled);
+    bool isRenderStatisticsEnabled() const;
+
+    /**
+     * @brief Returns the statistics accumulated while enabled, as a dict:
+     * framesCount, wallTime (in seconds), memoryPeakRAM and memoryPeakGL (the highest of a frame, in bytes) and nodes,
+     * a dict of the fully qualified node names to their statistics: pluginID, framesCount, timeSpentRendering,
+     * timeSpentRenderingOpenGL, timeSpentTransferring (in seconds), actions, a dict of the action names
+     * to their calls, totalTime, meanTime and p95Time, and cache, the cache counters of the node as returned by
+     * Effect.getCacheStatistic().
+     **/
+    QVariantMap getRenderStatistics() const;
+
+    void resetRenderStatistics();
+
     static Effect* createEffectFromNodeWrapper(const NodePtr& node);
 
     static App* createAppFromAppInstance(const AppInstancePtr& app);
@@ -29,8 +29,10 @@
 #include "Global/Macros.h"
 
 #include "Engine/AppManager.h"
+#include "Engine/CacheStats.h"
 #include "Engine/MemoryInfo.h" // isApplication32Bits
 #include "Engine/PyAppInstance.h"
+#include "Engine/TraceRecorder.h"
 
 
 #include "Engine/EngineFwd.h"
@@ -227,6 +229,52 @@ public:
     {
         appPTR->setOnProjectLoadedCallback( pythonFunctionName.toStdString() );
     }
+
+    /**
+     * @brief Returns the cache counters of the whole process since it started, as a dict of the
+     * counter names as accepted by Effect.getCacheStatistic() to their value
+     **/
+    inline QVariantMap getCacheStatistics() const
+    {
+        CacheNodeCounters counters;
+        appPTR->getCacheStats()->getTotalCounters(&counters);
+        std::map<std::string, double> values;
+        CacheStats::getCountersByName(counters, &values);
+
+        QVariantMap ret;
+        for (std::map<std::string, double>::const_iterator it = values.begin(); it != values.end(); ++it) {
+            ret[QString::fromUtf8( it->first.c_str() )] = it->second;
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief When enabled, the timeline of the renders is recorded in each thread, @see writeRenderTrace()
+     **/
+    inline void setRenderTraceEnabled(bool enabled)
+    {
+        TraceRecorder::setEnabled(enabled);
+    }
+
+    inline bool isRenderTraceEnabled() const
+    {
+        return TraceRecorder::isEnabled();
+    }
+
+    inline void resetRenderTrace()
+    {
+        TraceRecorder::reset();
+    }
+
+    /**
+     * @brief Writes the trace recorded so far in the trace-event JSON format of chrome://tracing and
+     * https://ui.perfetto.dev. Returns false if the file could not be written.
+     **/
+    inline bool writeRenderTrace(const QString& filePath) const
+    {
+        return TraceRecorder::writeTrace( filePath.toStdString() );
+    }
 };
 
 NATRON_PYTHON_NAMESPACE_EXIT;
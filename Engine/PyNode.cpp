@@ -48,6 +48,7 @@ GCC_DIAG_ON(unused-parameter)
 
 
 #include "Engine/Node.h"
+#include "Engine/CacheStats.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
 #include "Engine/AppInstance.h"
@@ -62,6 +63,7 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/TrackerHelper.h"
 
 #include "Engine/Hash64.h"
+#include "Engine/ImageStorage.h"
 
 NATRON_NAMESPACE_ENTER
 NATRON_PYTHON_NAMESPACE_ENTER
@@ -1692,6 +1694,80 @@ Effect::getPremult() const
     return effect->getPremult();
 }
 
+double
+Effect::getCacheStatistic(const QString& name) const
+{
+    NodePtr n = getInternalNode();
+
+    if (!n) {
+        PythonSetNullError();
+        return 0.;
+    }
+
+    CacheNodeCounters counters;
+    n->getCacheStats(&counters);
+    double value = 0.;
+    if ( !CacheStats::getCounterByName(counters, name.toStdString(), &value) ) {
+        PyErr_SetString(PyExc_ValueError, tr("%1: Unknown cache statistic").arg(name).toStdString().c_str());
+        return 0.;
+    }
+    return value;
+}
+
+void
+Effect::resetCacheStatistics()
+{
+    NodePtr n = getInternalNode();
+
+    if (!n) {
+        PythonSetNullError();
+        return;
+    }
+    n->resetCacheStats();
+}
+
+double
+Effect::getMemoryStatistic(const QString& name) const
+{
+    NodePtr n = getInternalNode();
+
+    if (!n) {
+        PythonSetNullError();
+        return 0.;
+    }
+
+    MemoryBudgetPtr budget = n->getMemoryBudget();
+    if (!budget) {
+        return 0.;
+    }
+    if ( name == QString::fromUtf8("ram") ) {
+        return (double)budget->getAllocatedBytes(eStorageModeRAM);
+    } else if ( name == QString::fromUtf8("ramPeak") ) {
+        return (double)budget->getPeakAllocatedBytes(eStorageModeRAM);
+    } else if ( name == QString::fromUtf8("gl") ) {
+        return (double)budget->getAllocatedBytes(eStorageModeGLTex);
+    } else if ( name == QString::fromUtf8("glPeak") ) {
+        return (double)budget->getPeakAllocatedBytes(eStorageModeGLTex);
+    }
+    PyErr_SetString(PyExc_ValueError, tr("%1: Unknown memory statistic").arg(name).toStdString().c_str());
+    return 0.;
+}
+
+void
+Effect::resetMemoryStatistics()
+{
+    NodePtr n = getInternalNode();
+
+    if (!n) {
+        PythonSetNullError();
+        return;
+    }
+    MemoryBudgetPtr budget = n->getMemoryBudget();
+    if (budget) {
+        budget->resetPeaks();
+    }
+}
+
 void
 Effect::setPagesOrder(const QStringList& pages)
 {
@@ -407,6 +407,23 @@ public:
     NATRON_NAMESPACE::ImageBitDepthEnum getBitDepth() const;
     NATRON_NAMESPACE::ImagePremultiplicationEnum getPremult() const;
 
+    /**
+     * @brief Returns a cache statistic of this node, named <tier>.<counter> where tier is one of
+     * tiles, compressedTiles, remoteTiles, generalPurpose and counter one of lookups, hits, misses, pendingWaits,
+     * pendingWaitTimeouts, evictions, reRenders, reRenderedBytes, reRenderTime (in seconds).
+     **/
+    double getCacheStatistic(const QString& name) const;
+
+    void resetCacheStatistics();
+
+    /**
+     * @brief Returns how much memory in bytes this node allocated for its images: one of
+     * ram, ramPeak, gl, glPeak. The peaks are the maximums since resetMemoryStatistics() was called.
+     **/
+    double getMemoryStatistic(const QString& name) const;
+
+    void resetMemoryStatistics();
+
     void setPagesOrder(const QStringList& pages);
 
     void insertParamInViewerUI(Param* param, int index = -1);
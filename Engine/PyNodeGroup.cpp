@@ -62,6 +62,10 @@ Group::getNode(const QString& fullySpecifiedName) const
         PythonSetNullError();
         return 0;
     }
+    NodeGroupPtr isGroup = toNodeGroup( _collection.lock() );
+    if (isGroup) {
+        isGroup->createDeferredSubGraph();
+    }
     NodePtr node = _collection.lock()->getNodeByFullySpecifiedName( fullySpecifiedName.toStdString() );
     if (node) {
         return App::createEffectFromNodeWrapper(node);
@@ -80,6 +84,10 @@ Group::getChildren() const
         return ret;
     }
 
+    NodeGroupPtr isGroup = toNodeGroup( _collection.lock() );
+    if (isGroup) {
+        isGroup->createDeferredSubGraph();
+    }
     NodesList nodes = _collection.lock()->getNodes();
 
     for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
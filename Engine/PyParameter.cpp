@@ -26,7 +26,9 @@
 #include "PyParameter.h"
 
 #include <cassert>
+#include <list>
 #include <stdexcept>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -1183,6 +1185,105 @@ AnimatedParam::getKeyTime(int index,
 
 }
 
+void
+AnimatedParam::getKeyFrames(int dimension,
+                            std::vector<double>* times,
+                            std::vector<double>* values,
+                            const QString& view) const
+{
+    KnobIPtr knob = getRenderCloneKnobInternal();
+    if (!knob) {
+        PythonSetNullError();
+        return;
+    }
+    if (dimension < 0 || dimension >= knob->getNDimensions()) {
+        PythonSetInvalidDimensionError(dimension);
+        return;
+    }
+    ViewIdx thisViewSpec;
+    if (!getViewIdxFromViewName(view, &thisViewSpec)) {
+        PythonSetInvalidViewName(view);
+        return;
+    }
+    CurvePtr curve = knob->getAnimationCurve(thisViewSpec, DimIdx(dimension));
+    if (!curve) {
+        return;
+    }
+
+    // Copy the keyframes once under the curve lock rather than querying them one by one
+    KeyFrameSet keys = curve->getKeyFrames_mt_safe();
+    times->reserve( keys.size() );
+    values->reserve( keys.size() );
+    for (KeyFrameSet::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        times->push_back( it->getTime() );
+        values->push_back( it->getValue() );
+    }
+}
+
+void
+AnimatedParam::setKeyFrames(const std::vector<double>& times,
+                            const std::vector<double>& values,
+                            int dimension,
+                            const QString& view)
+{
+    KnobHelperPtr knob = toKnobHelper( getInternalKnob() );
+    if (!knob) {
+        PythonSetNullError();
+        return;
+    }
+    if (times.size() != values.size()) {
+        PyErr_SetString(PyExc_ValueError, Param::tr("setKeyFrames: times and values must have the same size").toStdString().c_str());
+        return;
+    }
+    if (dimension != kPyParamDimSpecAll && (dimension < 0 || dimension >= knob->getNDimensions())) {
+        PythonSetInvalidDimensionError(dimension);
+        return;
+    }
+    ViewSetSpec thisViewSpec;
+    if (!getViewSetSpecFromViewName(view, &thisViewSpec)) {
+        PythonSetInvalidViewName(view);
+        return;
+    }
+    if ( times.empty() ) {
+        return;
+    }
+
+    std::list<KeyFrame> keys;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        keys.push_back( KeyFrame(times[i], values[i]) );
+    }
+
+    std::list<ViewIdx> views;
+    if ( thisViewSpec.isAll() ) {
+        views = knob->getViewsList();
+    } else {
+        views.push_back( ViewIdx( thisViewSpec.value() ) );
+    }
+    int firstDim = dimension == kPyParamDimSpecAll ? 0 : dimension;
+    int lastDim = dimension == kPyParamDimSpecAll ? knob->getNDimensions() - 1 : dimension;
+
+    bool hasChanged = false;
+    for (std::list<ViewIdx>::const_iterator it = views.begin(); it != views.end(); ++it) {
+        for (int i = firstDim; i <= lastDim; ++i) {
+            CurvePtr curve = knob->getAnimationCurve(*it, DimIdx(i));
+            if (!curve) {
+                continue;
+            }
+            CurveTypeEnum type = curve->getType();
+            if ( (type == eCurveTypeString) || (type == eCurveTypeChoice) || (type == eCurveTypeProperties) ) {
+                PyErr_SetString(PyExc_ValueError, Param::tr("setKeyFrames: the parameter does not have numeric keyframes").toStdString().c_str());
+                return;
+            }
+            hasChanged |= knob->addKeyFramesToCurve(*it, DimIdx(i), keys, false /*evaluate*/);
+        }
+    }
+
+    // Notify the change once for all keyframes
+    if (hasChanged) {
+        knob->evaluateAnimationChange( TimeValue( times.back() ) );
+    }
+} // setKeyFrames
+
 void
 AnimatedParam::deleteValueAtTime(double time,
                                  int dimension, const QString& view)
@@ -361,6 +361,22 @@ public:
      **/
     bool getKeyTime(int index, int dimension, double* time, const QString& view = QLatin1String(kPyParamViewIdxMain)) const;
 
+    /**
+     * @brief Set in 'times' and 'values' the time and value of all keyframes of the given dimension, by increasing time.
+     * This is much faster than calling getKeyTime and getValueAtTime for each keyframe.
+     * In Python this returns a tuple of 2 array.array('d'), which support the buffer protocol and can be wrapped
+     * by numpy.frombuffer without a copy.
+     **/
+    void getKeyFrames(int dimension, std::vector<double>* times, std::vector<double>* values, const QString& view = QLatin1String(kPyParamViewIdxMain)) const;
+
+    /**
+     * @brief Adds or modifies the keyframes at the given times with the given values at once, the parameter is evaluated
+     * only once for all keyframes. 'times' and 'values' must have the same size.
+     * In Python they may be any object supporting the buffer protocol with double items, such as a numpy array of float64,
+     * or any sequence of numbers.
+     **/
+    void setKeyFrames(const std::vector<double>& times, const std::vector<double>& values, int dimension = 0, const QString& view = QLatin1String(kPyParamViewSetSpecAll));
+
     /**
      * @brief Removes the keyframe at the given time and dimension if it matches any.
      **/
@@ -96,6 +96,26 @@ public:
         }
     }
 
+    /**
+     * @brief Same as resize() but the memory is cleared to 0. This is cheaper than resize() followed by a memset:
+     * large blocks are mapped from pages the system already cleared, and are only touched when written to.
+     **/
+    void resizeZeroed(U64 size)
+    {
+        if (size == 0) {
+            return;
+        }
+        count = size;
+        if (data) {
+            free(data);
+            data = 0;
+        }
+        data = (T*)calloc( size, sizeof(T) );
+        if (!data) {
+            throw std::bad_alloc();
+        }
+    }
+
     void resizeAndPreserve(U64 size)
     {
         if (size == 0 || size == count) {
@@ -48,6 +48,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/AppManager.h"
 #include "Engine/Node.h"
 #include "Engine/CreateNodeArgs.h"
+#include "Engine/FileReadAhead.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
 #include "Engine/Project.h"
@@ -78,6 +79,9 @@ NATRON_NAMESPACE_ENTER
 #define kParamFrameMode "frameMode"
 #define kParamTimeOffset "timeOffset"
 #define kParamStartingTime "startingTime"
+
+// How many frames following the one being rendered have their file read ahead
+#define NATRON_READ_NODE_READ_AHEAD_N_FRAMES 8
 #define kParamOriginalFrameRange kReaderParamNameOriginalFrameRange
 #define kParamFirstFrame "firstFrame"
 #define kParamLastFrame "lastFrame"
@@ -244,6 +248,17 @@ public:
 
     bool wasCreatedAsHiddenNode;
 
+    // Reads the files of the frames ahead of the ones being rendered
+    FileReadAhead readAhead;
+
+    // Protects hasReadAhead, lastReadAheadTime and readAheadDirection
+    QMutex readAheadMutex;
+
+    // The last time rendered by the embedded reader, if any, and the direction of the renders: 1 or -1
+    bool hasReadAhead;
+    TimeValue lastReadAheadTime;
+    int readAheadDirection;
+
 
     ReadNodePrivate(ReadNode* publicInterface)
     : _publicInterface(publicInterface)
@@ -260,6 +275,11 @@ public:
     , creatingReadNode(0)
     , lastPluginIDCreated()
     , wasCreatedAsHiddenNode(false)
+    , readAhead()
+    , readAheadMutex()
+    , hasReadAhead(false)
+    , lastReadAheadTime(0)
+    , readAheadDirection(1)
     {
     }
 
@@ -800,6 +820,44 @@ ReadNode::isVideoReader() const
     return p ? isVideoReader( p->getPluginID() ) : false;
 }
 
+void
+ReadNode::readAheadFromFrame(TimeValue time, ViewIdx view)
+{
+    int direction;
+    {
+        QMutexLocker k(&_imp->readAheadMutex);
+        if ( _imp->hasReadAhead && (time == _imp->lastReadAheadTime) ) {
+            // The files ahead of this frame were already queued, e.g: by another tile of the same frame
+            return;
+        }
+        if (_imp->hasReadAhead) {
+            _imp->readAheadDirection = time > _imp->lastReadAheadTime ? 1 : -1;
+        }
+        _imp->hasReadAhead = true;
+        _imp->lastReadAheadTime = time;
+        direction = _imp->readAheadDirection;
+    }
+
+    NodePtr p = getEmbeddedReader();
+    KnobFilePtr fileKnob = _imp->inputFileKnob.lock();
+    if ( !p || !fileKnob || isVideoReader( p->getPluginID() ) ) {
+        return;
+    }
+
+    // The reader reads the file at the time offset by its time offset parameter
+    double timeOffset = 0.;
+    KnobIntPtr timeOffsetKnob = toKnobInt( p->getKnobByName(kParamTimeOffset) );
+    if (timeOffsetKnob) {
+        timeOffset = timeOffsetKnob->getValue();
+    }
+
+    std::vector<std::string> filenames;
+    for (int i = 1; i <= NATRON_READ_NODE_READ_AHEAD_N_FRAMES; ++i) {
+        filenames.push_back( fileKnob->getValueAtTime(TimeValue(time + direction * i - timeOffset), DimIdx(0), view) );
+    }
+    _imp->readAhead.readAhead(filenames);
+} // readAheadFromFrame
+
 bool
 ReadNode::isGenerator() const
 {
@@ -963,6 +1021,9 @@ ReadNode::knobChanged(const KnobIPtr& k,
             assert(false);
         }
 
+        // The files read ahead may belong to another sequence
+        _imp->readAhead.clear();
+
         KnobFilePtr fileKnob = _imp->inputFileKnob.lock();
         assert(fileKnob);
         std::string filename = fileKnob->getRawFileName();
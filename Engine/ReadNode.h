@@ -88,6 +88,14 @@ public:
     void setEmbeddedReader(const NodePtr& node);
     static bool isVideoReader(const std::string& pluginID);
 
+    /**
+     * @brief Called by the embedded reader each time it renders the given time: reads the files of the
+     * NATRON_READ_NODE_READ_AHEAD_N_FRAMES next frames, in the direction the reader is being rendered, into the
+     * page cache of the operating system so that decoding them does not wait on the disk or the network.
+     * This is a no-op for video files.
+     **/
+    void readAheadFromFrame(TimeValue time, ViewIdx view);
+
     virtual bool isReader() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool isVideoReader() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool isGenerator() const OVERRIDE FINAL WARN_UNUSED_RETURN;
@@ -0,0 +1,629 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RemoteTileCache.h"
+
+#include <cassert>
+#include <list>
+#include <map>
+#include <cstring>
+#include <cstdio>
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDebug>
+#include <QtNetwork/QTcpSocket>
+
+#ifdef DEBUG
+#include "Global/FloatingPointExceptions.h"
+#endif
+#include "Engine/Hash64.h"
+#include "Engine/TileCompression.h"
+#include "Engine/Timer.h"
+
+// The default port of memcached
+#define NATRON_REMOTE_TILE_CACHE_DEFAULT_PORT 11211
+
+// Maximum number of tiles requested with a single get command
+#define NATRON_REMOTE_TILE_CACHE_MAX_KEYS_PER_GET 64
+
+// Maximum number of bytes of tiles waiting to be published. Beyond that, rendered tiles are not published.
+#define NATRON_REMOTE_TILE_CACHE_MAX_PENDING_BYTES (32 * 1024 * 1024)
+
+// Maximum number of bytes and number of tiles answered by the server that were not retrieved yet, e.g: because the
+// render thread stopped waiting. Beyond that, answers are forgotten.
+#define NATRON_REMOTE_TILE_CACHE_MAX_FETCHED_BYTES (64 * 1024 * 1024)
+#define NATRON_REMOTE_TILE_CACHE_MAX_FETCHED_TILES 16384
+
+// Default maximum size of an item stored by memcached: larger compressed tiles are not published
+#define NATRON_REMOTE_TILE_CACHE_MAX_VALUE_BYTES (1024 * 1024)
+
+// Time after which the connection is considered lost if the server does not answer, in milliseconds
+#define NATRON_REMOTE_TILE_CACHE_IO_TIMEOUT_MS 2000
+
+// Time to wait for the connection to the server, in milliseconds
+#define NATRON_REMOTE_TILE_CACHE_CONNECT_TIMEOUT_MS 1000
+
+// After a failure to connect, time before attempting again, in seconds
+#define NATRON_REMOTE_TILE_CACHE_RETRY_DELAY 10.
+
+NATRON_NAMESPACE_ENTER
+
+struct RemoteTileFetch
+{
+    // The key of the tile on the server
+    std::string key;
+
+    // True once the server answered for this tile
+    bool answered;
+
+    // The compressed tile, empty if the server does not have it
+    std::vector<U8> data;
+
+    RemoteTileFetch()
+    : key()
+    , answered(false)
+    , data()
+    {
+
+    }
+};
+
+typedef std::map<U64, RemoteTileFetch> RemoteTileFetchMap;
+
+struct RemoteTilePublish
+{
+    std::string key;
+    int elementSizeBytes;
+    std::vector<U8> data;
+};
+
+struct RemoteTileCachePrivate
+{
+    // Protects all fields below
+    mutable QMutex lock;
+
+    std::string host;
+    quint16 port;
+
+    // All tiles requested with prefetchTiles() that were not retrieved yet
+    RemoteTileFetchMap fetches;
+
+    // Sum of the size of the answered tiles in fetches
+    std::size_t fetchedBytes;
+
+    // Tiles of fetches that were not requested to the server yet
+    std::list<U64> fetchQueue;
+
+    // Tiles waiting to be published and the sum of their size
+    std::list<RemoteTilePublish> publishQueue;
+    std::size_t publishQueueBytes;
+
+    // True while the thread sends tiles taken from publishQueue
+    bool publishing;
+
+    // If true, publishTile() waits for the thread instead of dropping tiles
+    bool publishBlocking;
+
+    QWaitCondition noworkCond;
+
+    // Woken up each time the server answered
+    QWaitCondition answeredCond;
+
+    bool mustQuit;
+
+    RemoteTileCachePrivate()
+    : lock()
+    , host()
+    , port(NATRON_REMOTE_TILE_CACHE_DEFAULT_PORT)
+    , fetches()
+    , fetchedBytes(0)
+    , fetchQueue()
+    , publishQueue()
+    , publishQueueBytes(0)
+    , publishing(false)
+    , publishBlocking(false)
+    , noworkCond()
+    , answeredCond()
+    , mustQuit(false)
+    {
+
+    }
+
+    /**
+     * @brief Returns the key identifying the tile on the server. The lock does not need to be taken.
+     **/
+    static std::string makeKey(U64 tileHash, std::size_t tileSizeBytes)
+    {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "natron%d_%llu_%016llx", (int)NATRON_HASH64_VERSION, (unsigned long long)tileSizeBytes, (unsigned long long)tileHash);
+        return std::string(buf);
+    }
+
+    /**
+     * @brief Forget the answers that were not retrieved until the fetched tiles fit in NATRON_REMOTE_TILE_CACHE_MAX_FETCHED_BYTES
+     * and NATRON_REMOTE_TILE_CACHE_MAX_FETCHED_TILES. The lock must be taken.
+     **/
+    void forgetAnsweredTiles()
+    {
+        RemoteTileFetchMap::iterator it = fetches.begin();
+        while ( (fetchedBytes > NATRON_REMOTE_TILE_CACHE_MAX_FETCHED_BYTES || fetches.size() > NATRON_REMOTE_TILE_CACHE_MAX_FETCHED_TILES) && it != fetches.end() ) {
+            if (!it->second.answered) {
+                ++it;
+                continue;
+            }
+            assert(fetchedBytes >= it->second.data.size());
+            fetchedBytes -= it->second.data.size();
+            fetches.erase(it++);
+        }
+    }
+
+    /**
+     * @brief Mark all requests as answered without the tile so that no render thread waits anymore.
+     * The lock must be taken.
+     **/
+    void answerAllAsMissing()
+    {
+        for (std::list<U64>::const_iterator it = fetchQueue.begin(); it != fetchQueue.end(); ++it) {
+            RemoteTileFetchMap::iterator found = fetches.find(*it);
+            if ( found != fetches.end() ) {
+                found->second.answered = true;
+            }
+        }
+        fetchQueue.clear();
+        answeredCond.wakeAll();
+    }
+};
+
+RemoteTileCache::RemoteTileCache()
+: QThread()
+, _imp(new RemoteTileCachePrivate())
+{
+    setObjectName( QString::fromUtf8("RemoteTileCache") );
+}
+
+RemoteTileCache::~RemoteTileCache()
+{
+
+}
+
+void
+RemoteTileCache::setServer(const std::string& hostAndPort)
+{
+    std::string host = hostAndPort;
+    quint16 port = NATRON_REMOTE_TILE_CACHE_DEFAULT_PORT;
+    std::size_t foundColon = hostAndPort.find_last_of(':');
+    if (foundColon != std::string::npos) {
+        host = hostAndPort.substr(0, foundColon);
+        int portValue = QString::fromUtf8( hostAndPort.substr(foundColon + 1).c_str() ).toInt();
+        if ( (portValue > 0) && (portValue < 65536) ) {
+            port = (quint16)portValue;
+        }
+    }
+    host = QString::fromUtf8( host.c_str() ).trimmed().toStdString();
+
+    QMutexLocker k(&_imp->lock);
+    _imp->host = host;
+    _imp->port = port;
+    if ( host.empty() ) {
+        _imp->answerAllAsMissing();
+        _imp->publishQueue.clear();
+        _imp->publishQueueBytes = 0;
+    }
+}
+
+bool
+RemoteTileCache::isEnabled() const
+{
+    QMutexLocker k(&_imp->lock);
+    return !_imp->host.empty();
+}
+
+void
+RemoteTileCache::prefetchTiles(const std::vector<U64>& tileHashes, std::size_t tileSizeBytes)
+{
+    if ( tileHashes.empty() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->lock);
+        if ( _imp->host.empty() ) {
+            return;
+        }
+        for (std::vector<U64>::const_iterator it = tileHashes.begin(); it != tileHashes.end(); ++it) {
+            if ( _imp->fetches.find(*it) != _imp->fetches.end() ) {
+                // Already requested
+                continue;
+            }
+            RemoteTileFetch& fetch = _imp->fetches[*it];
+            fetch.key = RemoteTileCachePrivate::makeKey(*it, tileSizeBytes);
+            _imp->fetchQueue.push_back(*it);
+        }
+    }
+    if ( !isRunning() ) {
+        start();
+    } else {
+        QMutexLocker k(&_imp->lock);
+        _imp->noworkCond.wakeOne();
+    }
+} // prefetchTiles
+
+void
+RemoteTileCache::waitForTiles(const std::vector<U64>& tileHashes, int timeoutMS)
+{
+    TimeLapse timer;
+    QMutexLocker k(&_imp->lock);
+    for (;;) {
+        bool allAnswered = true;
+        for (std::vector<U64>::const_iterator it = tileHashes.begin(); it != tileHashes.end(); ++it) {
+            RemoteTileFetchMap::const_iterator found = _imp->fetches.find(*it);
+            if ( (found != _imp->fetches.end()) && !found->second.answered ) {
+                allAnswered = false;
+                break;
+            }
+        }
+        if (allAnswered) {
+            return;
+        }
+        int remainingMS = timeoutMS - (int)(timer.getTimeSinceCreation() * 1000.);
+        if (remainingMS <= 0) {
+            return;
+        }
+        _imp->answeredCond.wait(&_imp->lock, remainingMS);
+    }
+} // waitForTiles
+
+bool
+RemoteTileCache::hasTile(U64 tileHash) const
+{
+    QMutexLocker k(&_imp->lock);
+    RemoteTileFetchMap::const_iterator found = _imp->fetches.find(tileHash);
+    return found != _imp->fetches.end() && found->second.answered && !found->second.data.empty();
+}
+
+bool
+RemoteTileCache::retrieveTile(U64 tileHash, void* data, std::size_t tileSizeBytes)
+{
+    std::vector<U8> compressed;
+    {
+        QMutexLocker k(&_imp->lock);
+        RemoteTileFetchMap::iterator found = _imp->fetches.find(tileHash);
+        if ( (found == _imp->fetches.end()) || !found->second.answered ) {
+            return false;
+        }
+        compressed.swap(found->second.data);
+        assert(_imp->fetchedBytes >= compressed.size());
+        _imp->fetchedBytes -= compressed.size();
+        _imp->fetches.erase(found);
+    }
+
+    // Decompress outside of the lock. This fails if the tile does not have the requested size.
+    if ( compressed.empty() || !TileCompression::decompress(&compressed[0], compressed.size(), data, tileSizeBytes) ) {
+        return false;
+    }
+    return true;
+} // retrieveTile
+
+void
+RemoteTileCache::publishTile(U64 tileHash, const void* data, std::size_t tileSizeBytes, int elementSizeBytes)
+{
+    {
+        QMutexLocker k(&_imp->lock);
+        if ( _imp->host.empty() ) {
+            return;
+        }
+        while ( _imp->publishBlocking && !_imp->publishQueue.empty() && !_imp->mustQuit &&
+                (_imp->publishQueueBytes + tileSizeBytes > NATRON_REMOTE_TILE_CACHE_MAX_PENDING_BYTES) ) {
+            _imp->answeredCond.wait(&_imp->lock);
+        }
+        if (_imp->publishQueueBytes + tileSizeBytes > NATRON_REMOTE_TILE_CACHE_MAX_PENDING_BYTES) {
+            return;
+        }
+        _imp->publishQueue.push_back( RemoteTilePublish() );
+        RemoteTilePublish& tile = _imp->publishQueue.back();
+        tile.key = RemoteTileCachePrivate::makeKey(tileHash, tileSizeBytes);
+        tile.elementSizeBytes = elementSizeBytes;
+        tile.data.resize(tileSizeBytes);
+        std::memcpy(&tile.data[0], data, tileSizeBytes);
+        _imp->publishQueueBytes += tileSizeBytes;
+    }
+    if ( !isRunning() ) {
+        start();
+    } else {
+        QMutexLocker k(&_imp->lock);
+        _imp->noworkCond.wakeOne();
+    }
+} // publishTile
+
+void
+RemoteTileCache::quitThread()
+{
+    if ( !isRunning() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = true;
+        _imp->noworkCond.wakeOne();
+    }
+    wait();
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->mustQuit = false;
+    }
+}
+
+void
+RemoteTileCache::setPublishBlocking(bool blocking)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->publishBlocking = blocking;
+}
+
+bool
+RemoteTileCache::waitForPublished(int timeoutMS)
+{
+    TimeLapse timer;
+    QMutexLocker k(&_imp->lock);
+    while ( _imp->publishing || !_imp->publishQueue.empty() ) {
+        int remainingMS = timeoutMS - (int)(timer.getTimeSinceCreation() * 1000.);
+        if (remainingMS <= 0) {
+            return false;
+        }
+        _imp->answeredCond.wait(&_imp->lock, remainingMS);
+    }
+    return true;
+}
+
+bool
+RemoteTileCache::isWorking() const
+{
+    QMutexLocker k(&_imp->lock);
+    return !_imp->fetchQueue.empty() || !_imp->publishQueue.empty();
+}
+
+static bool
+writeAll(QTcpSocket& socket, const char* data, qint64 size)
+{
+    if (socket.write(data, size) != size) {
+        return false;
+    }
+    while (socket.bytesToWrite() > 0) {
+        if ( !socket.waitForBytesWritten(NATRON_REMOTE_TILE_CACHE_IO_TIMEOUT_MS) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+readLine(QTcpSocket& socket, QByteArray* line)
+{
+    while ( !socket.canReadLine() ) {
+        if ( !socket.waitForReadyRead(NATRON_REMOTE_TILE_CACHE_IO_TIMEOUT_MS) ) {
+            return false;
+        }
+    }
+    *line = socket.readLine();
+    while ( line->endsWith('\n') || line->endsWith('\r') ) {
+        line->chop(1);
+    }
+    return true;
+}
+
+static bool
+readBytes(QTcpSocket& socket, qint64 size, std::vector<U8>* data)
+{
+    data->resize(size);
+    qint64 nRead = 0;
+    while (nRead < size) {
+        if ( (socket.bytesAvailable() <= 0) && !socket.waitForReadyRead(NATRON_REMOTE_TILE_CACHE_IO_TIMEOUT_MS) ) {
+            return false;
+        }
+        qint64 n = socket.read( (char*)&(*data)[nRead], size - nRead );
+        if (n < 0) {
+            return false;
+        }
+        nRead += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Send the given tiles with "set <key> <flags> <exptime> <bytes> noreply": the server does not answer.
+ * Returns false if the connection was lost.
+ **/
+static bool
+publishTilesToServer(QTcpSocket& socket, const std::list<RemoteTilePublish>& tiles)
+{
+    std::vector<U8> compressed;
+    for (std::list<RemoteTilePublish>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+        TileCompression::compress(&it->data[0], it->data.size(), it->elementSizeBytes, &compressed);
+        if ( compressed.empty() || (compressed.size() > NATRON_REMOTE_TILE_CACHE_MAX_VALUE_BYTES) ) {
+            continue;
+        }
+        char header[128];
+        int headerSize = std::snprintf(header, sizeof(header), "set %s 0 0 %llu noreply\r\n", it->key.c_str(), (unsigned long long)compressed.size());
+        if ( !writeAll(socket, header, headerSize) ||
+             !writeAll(socket, (const char*)&compressed[0], compressed.size()) ||
+             !writeAll(socket, "\r\n", 2) ) {
+            return false;
+        }
+    }
+    return true;
+} // publishTilesToServer
+
+/**
+ * @brief Request the given keys with "get <key>*". The server answers "VALUE <key> <flags> <bytes>" followed by the data
+ * for each key it has, then "END". Returns false if the connection was lost or the server answered an error.
+ **/
+static bool
+fetchTilesFromServer(QTcpSocket& socket, const std::vector<std::string>& keys, std::map<std::string, std::vector<U8> >* found)
+{
+    if ( keys.empty() ) {
+        return true;
+    }
+    std::string command("get");
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        command += ' ';
+        command += keys[i];
+    }
+    command += "\r\n";
+    if ( !writeAll( socket, command.c_str(), (qint64)command.size() ) ) {
+        return false;
+    }
+
+    for (;;) {
+        QByteArray line;
+        if ( !readLine(socket, &line) ) {
+            return false;
+        }
+        if (line == "END") {
+            return true;
+        }
+        QList<QByteArray> fields = line.split(' ');
+        if ( (fields.size() < 4) || (fields[0] != "VALUE") ) {
+            // ERROR, CLIENT_ERROR or SERVER_ERROR
+            qDebug() << "RemoteTileCache: unexpected answer from the server:" << line;
+            return false;
+        }
+        bool ok;
+        qint64 size = fields[3].toLongLong(&ok);
+        if ( !ok || (size < 0) || (size > NATRON_REMOTE_TILE_CACHE_MAX_VALUE_BYTES) ) {
+            return false;
+        }
+        // The data is followed by \r\n
+        std::vector<U8> data;
+        if ( !readBytes(socket, size + 2, &data) ) {
+            return false;
+        }
+        data.resize(size);
+        (*found)[std::string( fields[1].constData(), fields[1].size() )].swap(data);
+    }
+} // fetchTilesFromServer
+
+void
+RemoteTileCache::run()
+{
+#ifdef DEBUG
+    boost_adaptbx::floating_point::exception_trapping trap(boost_adaptbx::floating_point::exception_trapping::division_by_zero |
+                                                           boost_adaptbx::floating_point::exception_trapping::invalid |
+                                                           boost_adaptbx::floating_point::exception_trapping::overflow);
+#endif
+
+    // The socket lives in this thread
+    boost::scoped_ptr<QTcpSocket> socket;
+    std::string connectedHost;
+    quint16 connectedPort = 0;
+    TimeLapse clock;
+    double retryTime = 0;
+
+    for (;;) {
+
+        std::vector<U64> hashes;
+        std::vector<std::string> keys;
+        std::list<RemoteTilePublish> tilesToPublish;
+        std::string host;
+        quint16 port;
+        {
+            QMutexLocker k(&_imp->lock);
+            while ( !_imp->mustQuit && _imp->fetchQueue.empty() && _imp->publishQueue.empty() ) {
+                _imp->noworkCond.wait(&_imp->lock);
+            }
+            if (_imp->mustQuit) {
+                // Tiles are not worth publishing if we are quitting
+                _imp->answerAllAsMissing();
+                _imp->publishQueue.clear();
+                _imp->publishQueueBytes = 0;
+                _imp->answeredCond.wakeAll();
+                return;
+            }
+            while ( !_imp->fetchQueue.empty() && (hashes.size() < NATRON_REMOTE_TILE_CACHE_MAX_KEYS_PER_GET) ) {
+                U64 hash = _imp->fetchQueue.front();
+                _imp->fetchQueue.pop_front();
+                RemoteTileFetchMap::const_iterator found = _imp->fetches.find(hash);
+                if ( found == _imp->fetches.end() ) {
+                    continue;
+                }
+                hashes.push_back(hash);
+                keys.push_back(found->second.key);
+            }
+            tilesToPublish.swap(_imp->publishQueue);
+            _imp->publishQueueBytes = 0;
+            _imp->publishing = !tilesToPublish.empty();
+            host = _imp->host;
+            port = _imp->port;
+        }
+
+        // (Re-)connect if needed
+        if ( socket && ( (socket->state() != QAbstractSocket::ConnectedState) || (host != connectedHost) || (port != connectedPort) ) ) {
+            socket.reset();
+        }
+        if ( !socket && !host.empty() && (clock.getTimeSinceCreation() >= retryTime) ) {
+            socket.reset(new QTcpSocket);
+            socket->connectToHost(QString::fromUtf8( host.c_str() ), port);
+            if ( socket->waitForConnected(NATRON_REMOTE_TILE_CACHE_CONNECT_TIMEOUT_MS) ) {
+                socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+                connectedHost = host;
+                connectedPort = port;
+            } else {
+                qDebug() << "RemoteTileCache: could not connect to" << host.c_str() << port << ":" << socket->errorString();
+                socket.reset();
+                retryTime = clock.getTimeSinceCreation() + NATRON_REMOTE_TILE_CACHE_RETRY_DELAY;
+            }
+        }
+
+        // Publish first, a tile that was just rendered may be requested by another machine
+        std::map<std::string, std::vector<U8> > foundTiles;
+        if (socket) {
+            if ( !publishTilesToServer(*socket, tilesToPublish) || !fetchTilesFromServer(*socket, keys, &foundTiles) ) {
+                qDebug() << "RemoteTileCache: lost the connection to" << host.c_str() << port;
+                socket.reset();
+                retryTime = clock.getTimeSinceCreation() + NATRON_REMOTE_TILE_CACHE_RETRY_DELAY;
+            }
+        }
+
+        {
+            QMutexLocker k(&_imp->lock);
+            for (std::size_t i = 0; i < hashes.size(); ++i) {
+                RemoteTileFetchMap::iterator found = _imp->fetches.find(hashes[i]);
+                if ( found == _imp->fetches.end() ) {
+                    continue;
+                }
+                found->second.answered = true;
+                std::map<std::string, std::vector<U8> >::iterator foundData = foundTiles.find(keys[i]);
+                if ( foundData != foundTiles.end() ) {
+                    found->second.data.swap(foundData->second);
+                    _imp->fetchedBytes += found->second.data.size();
+                }
+            }
+            _imp->forgetAnsweredTiles();
+            _imp->publishing = false;
+            _imp->answeredCond.wakeAll();
+        }
+    }
+} // run
+
+NATRON_NAMESPACE_EXIT
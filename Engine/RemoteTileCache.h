@@ -0,0 +1,136 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_RemoteTileCache_h
+#define Engine_RemoteTileCache_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief An optional tier of the tile cache shared by several machines, e.g: the nodes of a render farm.
+ * Tiles are identified by the hash produced by CacheBase::makeTileCacheIndex, which only depends on the content
+ * of the image, so that identical tiles are rendered once per farm instead of once per machine.
+ *
+ * The shared cache is any server speaking the memcached text protocol (memcached itself, or a compatible service).
+ * Tiles are compressed with TileCompression before they are sent. All network I/O happens in this thread:
+ * - Once a tile is rendered at full quality, it is copied and queued to be published with publishTile().
+ * - Tiles that must be rendered and that are not in the local caches are first requested with prefetchTiles(),
+ * which queues the request and returns immediately. The ImageCacheEntry then waits a short while for the answers with
+ * waitForTiles() before it renders the tiles that were not found. The local caches are always looked-up first.
+ *
+ * If the server cannot be reached, requests are answered as misses and the connection is retried a few seconds later.
+ **/
+struct RemoteTileCachePrivate;
+class RemoteTileCache
+: public QThread
+{
+
+public:
+
+    RemoteTileCache();
+
+    virtual ~RemoteTileCache();
+
+    /**
+     * @brief Set the address of the server as "host:port". If the port is omitted, the memcached default port is used.
+     * An empty string disables the remote cache.
+     **/
+    void setServer(const std::string& hostAndPort);
+
+    bool isEnabled() const;
+
+    /**
+     * @brief Queue a request for the given tiles to the server. This returns immediately.
+     * @param tileSizeBytes The size of a tile, @see CacheBase::getTileSizeBytes(). Tiles are only shared
+     * between machines using the same tile size.
+     **/
+    void prefetchTiles(const std::vector<U64>& tileHashes, std::size_t tileSizeBytes);
+
+    /**
+     * @brief Wait until the server answered for all given tiles, which must have been requested with prefetchTiles(),
+     * or until timeoutMS milliseconds elapsed.
+     **/
+    void waitForTiles(const std::vector<U64>& tileHashes, int timeoutMS);
+
+    /**
+     * @brief Returns true if the server answered that it has the tile. This does not block.
+     **/
+    bool hasTile(U64 tileHash) const;
+
+    /**
+     * @brief If the server returned the tile, decompress it to data which must be tileSizeBytes large and forget it.
+     * Returns false if the tile was not returned or if it does not have the requested size.
+     **/
+    bool retrieveTile(U64 tileHash, void* data, std::size_t tileSizeBytes);
+
+    /**
+     * @brief Copy the given tile and queue it to be published on the server. This is cheap, the tile is compressed
+     * and sent in this thread. If the thread is too far behind, the tile is dropped.
+     * @param elementSizeBytes The size of a pixel component in the tile, this drives the predictor of the codec.
+     **/
+    void publishTile(U64 tileHash, const void* data, std::size_t tileSizeBytes, int elementSizeBytes);
+
+    /**
+     * @brief If blocking, publishTile() waits for the thread to catch up instead of dropping the tile. This is used by
+     * the workers of a distributed render, whose tiles must all reach the server.
+     **/
+    void setPublishBlocking(bool blocking);
+
+    /**
+     * @brief Wait until all the queued tiles were sent to the server, or until timeoutMS milliseconds elapsed.
+     * Returns false on timeout.
+     **/
+    bool waitForPublished(int timeoutMS);
+
+    void quitThread();
+
+    bool isWorking() const;
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    boost::scoped_ptr<RemoteTileCachePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_RemoteTileCache_h
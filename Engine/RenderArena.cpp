@@ -0,0 +1,157 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderArena.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include <QMutex>
+#include <QThread>
+
+// Size of the blocks reserved from the heap
+#define NATRON_RENDER_ARENA_BLOCK_SIZE (64 * 1024)
+
+// Allocations larger than this get their own block
+#define NATRON_RENDER_ARENA_MAX_SMALL_ALLOCATION (NATRON_RENDER_ARENA_BLOCK_SIZE / 4)
+
+// Number of independently locked lanes
+#define NATRON_RENDER_ARENA_NUM_LANES 8
+
+// Alignment of all allocations, large enough for any fundamental type
+#define NATRON_RENDER_ARENA_ALIGNMENT 16
+
+NATRON_NAMESPACE_ENTER
+
+struct RenderArenaLane
+{
+    // Protects the lane
+    QMutex lock;
+
+    // All blocks reserved by this lane
+    std::vector<char*> blocks;
+
+    // Bump pointer in the current block and end of the current block
+    char* current;
+    char* end;
+
+    RenderArenaLane()
+    : lock()
+    , blocks()
+    , current(0)
+    , end(0)
+    {
+
+    }
+
+    ~RenderArenaLane()
+    {
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            std::free(blocks[i]);
+        }
+    }
+};
+
+struct RenderArenaPrivate
+{
+    RenderArenaLane lanes[NATRON_RENDER_ARENA_NUM_LANES];
+
+    // Protects reservedBytes
+    mutable QMutex reservedBytesLock;
+    std::size_t reservedBytes;
+
+    RenderArenaPrivate()
+    : reservedBytesLock()
+    , reservedBytes(0)
+    {
+
+    }
+
+    char* reserveBlock(RenderArenaLane& lane, std::size_t size)
+    {
+        char* block = static_cast<char*>(std::malloc(size));
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        lane.blocks.push_back(block);
+        QMutexLocker k(&reservedBytesLock);
+        reservedBytes += size;
+        return block;
+    }
+
+    RenderArenaLane& getLaneForCurrentThread()
+    {
+        // Threads are spread on the lanes by their address: neighbouring render threads are allocated
+        // at least a cache line apart so the low bits are dropped.
+        std::size_t key = reinterpret_cast<std::size_t>(QThread::currentThread()) >> 6;
+        return lanes[key % NATRON_RENDER_ARENA_NUM_LANES];
+    }
+};
+
+RenderArena::RenderArena()
+: _imp(new RenderArenaPrivate())
+{
+
+}
+
+RenderArena::~RenderArena()
+{
+
+}
+
+void*
+RenderArena::allocate(std::size_t nBytes)
+{
+    // Round up to the alignment so that the bump pointer stays aligned
+    nBytes = (nBytes + NATRON_RENDER_ARENA_ALIGNMENT - 1) & ~((std::size_t)NATRON_RENDER_ARENA_ALIGNMENT - 1);
+    if (nBytes == 0) {
+        nBytes = NATRON_RENDER_ARENA_ALIGNMENT;
+    }
+
+    RenderArenaLane& lane = _imp->getLaneForCurrentThread();
+    QMutexLocker k(&lane.lock);
+
+    if (nBytes > NATRON_RENDER_ARENA_MAX_SMALL_ALLOCATION) {
+        // Do not waste the remaining of the current block
+        return _imp->reserveBlock(lane, nBytes);
+    }
+
+    if (!lane.current || (std::size_t)(lane.end - lane.current) < nBytes) {
+        lane.current = _imp->reserveBlock(lane, NATRON_RENDER_ARENA_BLOCK_SIZE);
+        lane.end = lane.current + NATRON_RENDER_ARENA_BLOCK_SIZE;
+    }
+    void* ret = lane.current;
+    lane.current += nBytes;
+    return ret;
+} // allocate
+
+std::size_t
+RenderArena::getReservedBytes() const
+{
+    QMutexLocker k(&_imp->reservedBytesLock);
+    return _imp->reservedBytes;
+}
+
+NATRON_NAMESPACE_EXIT
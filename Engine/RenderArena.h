@@ -0,0 +1,193 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERARENA_H
+#define NATRON_ENGINE_RENDERARENA_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+struct RenderArenaPrivate;
+
+/**
+ * @brief A monotonic memory arena owned by a TreeRender.
+ * The many small bookkeeping objects created while building and executing the requests of a render
+ * (FrameViewRequest, their dependencies and listeners...) are allocated out of large blocks instead of
+ * going through the global heap: memory is never given back individually but released wholesale
+ * when the arena is destroyed, i.e: when the render and all objects allocated from it are gone.
+ * Allocations are dispatched on a few independently locked lanes so that render threads do not contend.
+ **/
+class RenderArena
+{
+public:
+
+    RenderArena();
+
+    ~RenderArena();
+
+    /**
+     * @brief Returns nBytes of uninitialized memory, aligned for any fundamental type.
+     **/
+    void* allocate(std::size_t nBytes);
+
+    /**
+     * @brief Returns the number of bytes reserved from the heap by the arena
+     **/
+    std::size_t getReservedBytes() const;
+
+private:
+
+    boost::scoped_ptr<RenderArenaPrivate> _imp;
+};
+
+/**
+ * @brief A STL compatible allocator allocating out of a RenderArena.
+ * Deallocation is a no-op when an arena is set. A default constructed allocator has no arena
+ * and uses the global heap so that containers may be used before being bound to a render.
+ * The allocator holds a strong reference to the arena so that it remains valid as long as a container uses it.
+ **/
+template <typename T>
+class RenderArenaAllocator
+{
+    template <typename U> friend class RenderArenaAllocator;
+
+public:
+
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef RenderArenaAllocator<U> other;
+    };
+
+    RenderArenaAllocator()
+    : _arena()
+    {
+    }
+
+    explicit RenderArenaAllocator(const RenderArenaPtr& arena)
+    : _arena(arena)
+    {
+    }
+
+    RenderArenaAllocator(const RenderArenaAllocator& other)
+    : _arena(other._arena)
+    {
+    }
+
+    template <typename U>
+    RenderArenaAllocator(const RenderArenaAllocator<U>& other)
+    : _arena(other._arena)
+    {
+    }
+
+    const RenderArenaPtr& getArena() const
+    {
+        return _arena;
+    }
+
+    pointer address(reference x) const
+    {
+        return &x;
+    }
+
+    const_pointer address(const_reference x) const
+    {
+        return &x;
+    }
+
+    pointer allocate(size_type n, const void* /*hint*/ = 0)
+    {
+        if (n > max_size()) {
+            throw std::bad_alloc();
+        }
+        if (_arena) {
+            return static_cast<pointer>(_arena->allocate(n * sizeof(T)));
+        }
+        return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(pointer p, size_type /*n*/)
+    {
+        // Memory allocated out of the arena is released with the arena
+        if (!_arena) {
+            ::operator delete(p);
+        }
+    }
+
+    size_type max_size() const
+    {
+        return std::numeric_limits<size_type>::max() / sizeof(T);
+    }
+
+    void construct(pointer p, const T& val)
+    {
+        new (static_cast<void*>(p)) T(val);
+    }
+
+    void destroy(pointer p)
+    {
+        p->~T();
+    }
+
+    template <typename U>
+    bool operator==(const RenderArenaAllocator<U>& other) const
+    {
+        return _arena == other._arena;
+    }
+
+    template <typename U>
+    bool operator!=(const RenderArenaAllocator<U>& other) const
+    {
+        return _arena != other._arena;
+    }
+
+private:
+
+    RenderArenaPtr _arena;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_RENDERARENA_H
@@ -0,0 +1,435 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderBatch.h"
+
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTimer>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/CLArgs.h"
+#include "Engine/MemoryInfo.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/RenderEngine.h"
+#include "Engine/RenderQueue.h"
+
+// Interval at which the renders are checked for completion and new projects are started
+#define NATRON_RENDER_BATCH_POLL_INTERVAL_MS 50
+
+NATRON_NAMESPACE_ENTER
+
+struct RenderBatchEntry
+{
+    // Line of the manifest, for the messages
+    int lineNumber;
+    CLArgs args;
+    QString projectFilename;
+
+    // Set while the project is rendering
+    AppInstancePtr app;
+    std::list<RenderQueue::RenderWork> works;
+    int numFailedRenders;
+
+    RenderBatchEntry()
+        : lineNumber(0)
+        , args()
+        , projectFilename()
+        , app()
+        , works()
+        , numFailedRenders(0)
+    {
+    }
+};
+
+typedef boost::shared_ptr<RenderBatchEntry> RenderBatchEntryPtr;
+
+struct RenderBatchPrivate
+{
+    RenderBatch* _publicInterface;
+    int maxConcurrentProjects;
+    std::size_t memoryBudget;
+    std::vector<RenderBatchEntryPtr> entries;
+
+    // The entries being rendered
+    std::list<RenderBatchEntryPtr> runningEntries;
+
+    RenderBatchPrivate(RenderBatch* publicInterface)
+        : _publicInterface(publicInterface)
+        , maxConcurrentProjects(1)
+        , memoryBudget(0)
+        , entries()
+        , runningEntries()
+    {
+    }
+
+    bool isUnderMemoryBudget() const;
+
+    /**
+     * @brief Loads the project of the entry, starts its renders and adds it to runningEntries.
+     * Returns false and prints an error on failure.
+     **/
+    bool startEntry(const RenderBatchEntryPtr& entry);
+
+    /**
+     * @brief Closes the project of an entry whose renders are finished. Returns false if any of them failed.
+     **/
+    bool finishEntry(const RenderBatchEntryPtr& entry);
+
+    static void closeProjectInstance(const AppInstancePtr& app);
+};
+
+RenderBatch::RenderBatch()
+    : QObject()
+    , _imp( new RenderBatchPrivate(this) )
+{
+}
+
+RenderBatch::~RenderBatch()
+{
+}
+
+void
+RenderBatch::setMaxConcurrentProjects(int count)
+{
+    _imp->maxConcurrentProjects = std::max(1, count);
+}
+
+void
+RenderBatch::setMemoryBudget(std::size_t bytes)
+{
+    _imp->memoryBudget = bytes;
+}
+
+bool
+RenderBatch::splitArguments(const QString& line,
+                            QStringList* arguments)
+{
+    QString current;
+    bool inArgument = false;
+    QChar quote;
+
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar c = line[i];
+        if ( !quote.isNull() ) {
+            if (c == quote) {
+                quote = QChar();
+            } else {
+                current += c;
+            }
+        } else if ( ( c == QLatin1Char('"') ) || ( c == QLatin1Char('\'') ) ) {
+            quote = c;
+            inArgument = true;
+        } else if ( c.isSpace() ) {
+            if (inArgument) {
+                arguments->push_back(current);
+                current.clear();
+                inArgument = false;
+            }
+        } else {
+            current += c;
+            inArgument = true;
+        }
+    }
+    if (inArgument) {
+        arguments->push_back(current);
+    }
+
+    return quote.isNull();
+}
+
+bool
+RenderBatch::loadManifest(const QString& filePath)
+{
+    QFile file(filePath);
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        std::cerr << tr("Cannot open the batch manifest %1.").arg(filePath).toStdString() << std::endl;
+
+        return false;
+    }
+    const QDir manifestDir = QFileInfo(filePath).absoluteDir();
+
+    _imp->entries.clear();
+    int lineNumber = 0;
+    while ( !file.atEnd() ) {
+        ++lineNumber;
+        const QString line = QString::fromUtf8( file.readLine() ).trimmed();
+        if ( line.isEmpty() || line.startsWith( QLatin1Char('#') ) ) {
+            continue;
+        }
+
+        QStringList arguments;
+        if ( !splitArguments(line, &arguments) ) {
+            std::cerr << tr("%1:%2: a quote is not closed.").arg(filePath).arg(lineNumber).toStdString() << std::endl;
+
+            return false;
+        }
+
+        // CLArgs expects the program as the first argument
+        arguments.push_front( QCoreApplication::applicationFilePath() );
+
+        RenderBatchEntryPtr entry = boost::make_shared<RenderBatchEntry>();
+        entry->lineNumber = lineNumber;
+        entry->args = CLArgs(arguments, true /*forceBackground*/);
+        if ( entry->args.getError() != 0 ) {
+            std::cerr << tr("%1:%2: invalid arguments.").arg(filePath).arg(lineNumber).toStdString() << std::endl;
+
+            return false;
+        }
+
+        QString projectFilename = entry->args.getScriptFilename();
+        if ( entry->args.isPythonScript() || !projectFilename.endsWith( QString::fromUtf8("." NATRON_PROJECT_FILE_EXT) ) ) {
+            std::cerr << tr("%1:%2: each line must give a %3 project (.%4).").arg(filePath).arg(lineNumber)
+                .arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ).arg( QString::fromUtf8(NATRON_PROJECT_FILE_EXT) ).toStdString() << std::endl;
+
+            return false;
+        }
+
+        // Relative paths are relative to the manifest, so that it can be moved with the projects
+        if ( QFileInfo(projectFilename).isRelative() ) {
+            projectFilename = manifestDir.absoluteFilePath(projectFilename);
+        }
+        if ( !QFileInfo(projectFilename).exists() ) {
+            std::cerr << tr("%1:%2: %3: No such file.").arg(filePath).arg(lineNumber).arg(projectFilename).toStdString() << std::endl;
+
+            return false;
+        }
+        entry->projectFilename = QFileInfo(projectFilename).canonicalFilePath();
+
+        if ( !entry->args.getPythonCommands().empty() || !entry->args.getDefaultOnProjectLoadedScript().isEmpty() ) {
+            std::cerr << tr("%1:%2: the -c and -l options are ignored in a batch manifest.").arg(filePath).arg(lineNumber).toStdString() << std::endl;
+        }
+
+        _imp->entries.push_back(entry);
+    }
+
+    if ( _imp->entries.empty() ) {
+        std::cerr << tr("The batch manifest %1 does not contain any render.").arg(filePath).toStdString() << std::endl;
+
+        return false;
+    }
+
+    return true;
+} // loadManifest
+
+bool
+RenderBatchPrivate::isUnderMemoryBudget() const
+{
+    if (memoryBudget == 0) {
+        return true;
+    }
+    const std::size_t rss = getCurrentRSS();
+
+    // 0 if it cannot be determined on this system
+    return (rss == 0) || (rss < memoryBudget);
+}
+
+void
+RenderBatchPrivate::closeProjectInstance(const AppInstancePtr& app)
+{
+    try {
+        app->getProject()->reset(true /*aboutToQuit*/, true /*blocking*/);
+    } catch (std::logic_error&) {
+        // ignore
+    }
+
+    try {
+        app->quitNow();
+    } catch (std::logic_error&) {
+        // ignore
+    }
+}
+
+bool
+RenderBatchPrivate::startEntry(const RenderBatchEntryPtr& entry)
+{
+    std::cout << RenderBatch::tr("Rendering %1 (line %2 of the manifest).").arg(entry->projectFilename).arg(entry->lineNumber).toStdString() << std::endl;
+
+    CLArgs emptyArgs;
+    AppInstancePtr app = appPTR->newBackgroundInstance(emptyArgs, true /*makeEmptyInstance*/);
+    if (!app) {
+        std::cerr << RenderBatch::tr("%1: cannot create an application instance.").arg(entry->projectFilename).toStdString() << std::endl;
+
+        return false;
+    }
+
+    QString error;
+    try {
+        if ( !app->loadProject( entry->projectFilename.toStdString() ) ) {
+            error = RenderBatch::tr("Project file loading failed.");
+        } else {
+            // Python commands of the project refer to this instance as "app"
+            appPTR->setAsTopLevelInstance( app->getAppID() );
+            app->setReadersFromCommandLineArgs(entry->args);
+            app->getRenderQueue()->createRenderRequestsFromCommandLineArgs(entry->args, entry->works);
+            if ( entry->works.empty() ) {
+                error = RenderBatch::tr("The project has no enabled Write node to render.");
+            }
+        }
+    } catch (const std::exception& e) {
+        error = QString::fromUtf8( e.what() );
+    }
+    if ( !error.isEmpty() ) {
+        std::cerr << RenderBatch::tr("%1: %2").arg(entry->projectFilename).arg(error).toStdString() << std::endl;
+        entry->works.clear();
+        closeProjectInstance(app);
+
+        return false;
+    }
+
+    entry->app = app;
+    entry->numFailedRenders = 0;
+    runningEntries.push_back(entry);
+    for (std::list<RenderQueue::RenderWork>::const_iterator it = entry->works.begin(); it != entry->works.end(); ++it) {
+        RenderEngine* engine = it->treeRoot->getRenderEngine().get();
+        QObject::connect( engine, SIGNAL(renderFinished(int)), _publicInterface, SLOT(onRenderFinished(int)), Qt::UniqueConnection );
+    }
+
+    // The renders are started by the events processed in RenderBatch::render()
+    app->getRenderQueue()->renderAsync(entry->works);
+
+    return true;
+} // startEntry
+
+bool
+RenderBatchPrivate::finishEntry(const RenderBatchEntryPtr& entry)
+{
+    for (std::list<RenderQueue::RenderWork>::const_iterator it = entry->works.begin(); it != entry->works.end(); ++it) {
+        RenderEngine* engine = it->treeRoot->getRenderEngine().get();
+        QObject::disconnect( engine, SIGNAL(renderFinished(int)), _publicInterface, SLOT(onRenderFinished(int)) );
+    }
+    entry->works.clear();
+
+    AppInstancePtr app = entry->app;
+    entry->app.reset();
+    closeProjectInstance(app);
+
+    if (entry->numFailedRenders > 0) {
+        std::cerr << RenderBatch::tr("%1: %2 render(s) failed or were aborted.").arg(entry->projectFilename).arg(entry->numFailedRenders).toStdString() << std::endl;
+
+        return false;
+    }
+    std::cout << RenderBatch::tr("%1: finished.").arg(entry->projectFilename).toStdString() << std::endl;
+
+    return true;
+}
+
+void
+RenderBatch::onRenderFinished(int retCode)
+{
+    if (retCode == 0) {
+        return;
+    }
+    RenderEngine* engine = qobject_cast<RenderEngine*>( sender() );
+    if (!engine) {
+        return;
+    }
+    NodePtr writer = engine->getOutput();
+    if (!writer) {
+        return;
+    }
+    AppInstancePtr app = writer->getApp();
+    for (std::list<RenderBatchEntryPtr>::const_iterator it = _imp->runningEntries.begin(); it != _imp->runningEntries.end(); ++it) {
+        if ( (*it)->app == app ) {
+            ++(*it)->numFailedRenders;
+            break;
+        }
+    }
+}
+
+bool
+RenderBatch::render()
+{
+    int numFailedProjects = 0;
+    std::size_t nextEntry = 0;
+
+    for (;;) {
+        // Start the next projects. The first one is always started, whatever the memory used.
+        while ( ( nextEntry < _imp->entries.size() ) && ( (int)_imp->runningEntries.size() < _imp->maxConcurrentProjects ) ) {
+            if ( !_imp->runningEntries.empty() && !_imp->isUnderMemoryBudget() ) {
+                break;
+            }
+            RenderBatchEntryPtr entry = _imp->entries[nextEntry++];
+            if ( !_imp->startEntry(entry) ) {
+                ++numFailedProjects;
+            }
+        }
+        if ( _imp->runningEntries.empty() ) {
+            // Nothing is rendering and there is nothing to start
+            break;
+        }
+
+        // Process the events so that the render queues start their queued renders and see the finished ones
+        {
+            QEventLoop loop;
+            QTimer::singleShot( NATRON_RENDER_BATCH_POLL_INTERVAL_MS, &loop, SLOT(quit()) );
+            loop.exec();
+        }
+
+        for (std::list<RenderBatchEntryPtr>::iterator it = _imp->runningEntries.begin(); it != _imp->runningEntries.end();) {
+            if ( (*it)->app->getRenderQueue()->hasActiveRenders() ) {
+                ++it;
+                continue;
+            }
+            RenderBatchEntryPtr entry = *it;
+            it = _imp->runningEntries.erase(it);
+            if ( !_imp->finishEntry(entry) ) {
+                ++numFailedProjects;
+            }
+        }
+    }
+
+    if (numFailedProjects > 0) {
+        std::cerr << tr("%1 of the %2 projects of the batch failed.").arg(numFailedProjects).arg( _imp->entries.size() ).toStdString() << std::endl;
+
+        return false;
+    }
+    std::cout << tr("All the %1 projects of the batch were rendered.").arg( _imp->entries.size() ).toStdString() << std::endl;
+
+    return true;
+} // render
+
+NATRON_NAMESPACE_EXIT
+
+NATRON_NAMESPACE_USING
+#include "moc_RenderBatch.cpp"
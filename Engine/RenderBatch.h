@@ -0,0 +1,112 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_RenderBatch_h
+#define Engine_RenderBatch_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Renders many projects in a single NatronRenderer process, started with --batch <manifest>: the plug-ins,
+ * Python and the caches are loaded once for all of them instead of once per process.
+ *
+ * Each non-empty line of the manifest which does not start with # holds the arguments of one NatronRenderer render:
+ * the project, the Write nodes, the frame ranges and the options -i, -o, -s, --concurrent-writers and --resume, e.g:
+ * -w Write1 1-10 /path/comp.ntp
+ * Arguments containing spaces are quoted with ' or ".
+ *
+ * Each project is loaded in its own background AppInstance, rendered, then closed. By default the projects are
+ * rendered one after the other. With --batch-jobs <n>, up to n projects render at the same time, sharing the threads
+ * and the caches; with --batch-memory <MB>, a project is not started while the memory used by the process is above
+ * the budget, unless no other project is rendering.
+ **/
+struct RenderBatchPrivate;
+class RenderBatch
+    : public QObject
+{
+    GCC_DIAG_SUGGEST_OVERRIDE_OFF
+    Q_OBJECT
+    GCC_DIAG_SUGGEST_OVERRIDE_ON
+
+public:
+
+    RenderBatch();
+
+    virtual ~RenderBatch();
+
+    /**
+     * @brief Set the number of projects rendering at the same time. The default is 1.
+     **/
+    void setMaxConcurrentProjects(int count);
+
+    /**
+     * @brief Set the memory used by the process above which no project is started while another one renders.
+     * 0 means no limit, which is the default.
+     **/
+    void setMemoryBudget(std::size_t bytes);
+
+    /**
+     * @brief Reads the renders of the given manifest. Returns false and prints an error if it cannot be read or if
+     * a line is invalid: no project is rendered in that case.
+     **/
+    bool loadManifest(const QString& filePath);
+
+    /**
+     * @brief Renders all the projects of the manifest and returns when they are finished.
+     * Returns false if any of them failed.
+     **/
+    bool render();
+
+    /**
+     * @brief Splits a line of the manifest into arguments, separated by white spaces, with the quotes removed.
+     * Returns false if a quote is not closed.
+     **/
+    static bool splitArguments(const QString& line, QStringList* arguments);
+
+public Q_SLOTS:
+
+    void onRenderFinished(int retCode);
+
+private:
+
+    boost::scoped_ptr<RenderBatchPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_RenderBatch_h
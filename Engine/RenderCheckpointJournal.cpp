@@ -0,0 +1,253 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderCheckpointJournal.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/KnobFile.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+
+#define kRenderCheckpointJournalHeader "# Natron render checkpoints 1"
+#define kRenderCheckpointJournalFile "file"
+#define kRenderCheckpointJournalFrame "frame"
+
+// Tolerance on the modification date of a written file, for file systems with a coarse time resolution
+#define NATRON_RENDER_CHECKPOINT_DATE_TOLERANCE_MS 2000
+
+NATRON_NAMESPACE_ENTER
+
+struct RenderCheckpointFile
+{
+    QString path;
+    qint64 size;
+    qint64 modificationMSecs;
+};
+
+struct RenderCheckpointJournalPrivate
+{
+    QString filePath;
+
+    // Files written before this date were not written by this render
+    qint64 creationMSecs;
+
+    // Protects the fields below and the journal file
+    mutable QMutex lock;
+
+    // The files of the frames committed by previous renders
+    std::map<int, std::list<RenderCheckpointFile> > completedFrames;
+
+    RenderCheckpointJournalPrivate(const QString& filePath)
+    : filePath(filePath)
+    , creationMSecs( QDateTime::currentMSecsSinceEpoch() )
+    , lock()
+    , completedFrames()
+    {
+
+    }
+
+    static int frameIndex(TimeValue time)
+    {
+        return (int)std::floor(time + 0.5);
+    }
+};
+
+static QString
+readJournalLine(QFile& file)
+{
+    QString line = QString::fromUtf8( file.readLine() );
+    if ( line.endsWith( QLatin1Char('\n') ) ) {
+        line.chop(1);
+    }
+
+    return line;
+}
+
+QString
+RenderCheckpointJournal::getJournalFilePath(const NodePtr& writer)
+{
+    if ( !writer || !writer->getEffectInstance()->isWriter() || writer->getEffectInstance()->isVideoWriter() ) {
+        return QString();
+    }
+    KnobFilePtr fileKnob = toKnobFile( writer->getKnobByName(kOfxImageEffectFileParamName) );
+    if (!fileKnob) {
+        return QString();
+    }
+    std::string pattern = fileKnob->getRawFileName();
+    if ( pattern.empty() ) {
+        return QString();
+    }
+    std::map<std::string, std::string> env;
+    writer->getApp()->getProject()->getEnvironmentVariables(env);
+    Project::expandVariable(env, pattern);
+
+    // A hidden file next to the images
+    QFileInfo info( QString::fromUtf8( pattern.c_str() ) );
+
+    return info.absoluteDir().filePath( QString::fromUtf8(".") + info.fileName() + QString::fromUtf8(".checkpoints") );
+}
+
+RenderCheckpointJournal::RenderCheckpointJournal(const QString& filePath)
+    : _imp( new RenderCheckpointJournalPrivate(filePath) )
+{
+}
+
+RenderCheckpointJournal::~RenderCheckpointJournal()
+{
+}
+
+bool
+RenderCheckpointJournal::load()
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->completedFrames.clear();
+
+    QFile file(_imp->filePath);
+    if ( !file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
+        return false;
+    }
+    if ( readJournalLine(file) != QString::fromUtf8(kRenderCheckpointJournalHeader) ) {
+        std::cerr << tr("%1 is not a render checkpoints file, it is ignored.").arg(_imp->filePath).toStdString() << std::endl;
+
+        return false;
+    }
+
+    // The files read since the last committed frame
+    std::map<int, std::list<RenderCheckpointFile> > pendingFrames;
+    while ( !file.atEnd() ) {
+        const QString line = readJournalLine(file);
+
+        // A line cut by a crash does not parse and its frame is never committed
+        const QStringList fields = line.split( QLatin1Char(' ') );
+        bool ok = fields.size() >= 2;
+        int frame = ok ? fields[1].toInt(&ok) : 0;
+        if (!ok) {
+            continue;
+        }
+        if ( (fields[0] == QString::fromUtf8(kRenderCheckpointJournalFile)) && (fields.size() >= 5) ) {
+            RenderCheckpointFile f;
+            bool sizeOk, dateOk;
+            f.size = fields[2].toLongLong(&sizeOk);
+            f.modificationMSecs = fields[3].toLongLong(&dateOk);
+            f.path = QStringList( fields.mid(4) ).join( QString::fromUtf8(" ") );
+            if (sizeOk && dateOk) {
+                pendingFrames[frame].push_back(f);
+            }
+        } else if ( fields[0] == QString::fromUtf8(kRenderCheckpointJournalFrame) ) {
+            std::map<int, std::list<RenderCheckpointFile> >::iterator found = pendingFrames.find(frame);
+            if ( found != pendingFrames.end() ) {
+                _imp->completedFrames[frame] = found->second;
+                pendingFrames.erase(found);
+            }
+        }
+    }
+
+    return true;
+} // load
+
+void
+RenderCheckpointJournal::clear()
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->completedFrames.clear();
+    QFile::remove(_imp->filePath);
+}
+
+bool
+RenderCheckpointJournal::addFrame(TimeValue time,
+                                  const std::list<QString>& files)
+{
+    const int frame = RenderCheckpointJournalPrivate::frameIndex(time);
+
+    QString lines;
+    for (std::list<QString>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        QFileInfo info(*it);
+        const qint64 modificationMSecs = info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0;
+        if ( !info.exists() || (info.size() <= 0) ||
+             (modificationMSecs + NATRON_RENDER_CHECKPOINT_DATE_TOLERANCE_MS < _imp->creationMSecs) ) {
+            std::cerr << tr("%1 was not written correctly, frame %2 is not checkpointed.").arg(*it).arg(frame).toStdString() << std::endl;
+
+            return false;
+        }
+        lines += QString::fromUtf8(kRenderCheckpointJournalFile " %1 %2 %3 %4\n").arg(frame).arg( info.size() ).arg(modificationMSecs).arg( info.absoluteFilePath() );
+    }
+    lines += QString::fromUtf8(kRenderCheckpointJournalFrame " %1\n").arg(frame);
+
+    QMutexLocker k(&_imp->lock);
+    QFile file(_imp->filePath);
+    const bool isNew = !file.exists();
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text) ) {
+        std::cerr << tr("Cannot write the render checkpoints to %1: %2").arg(_imp->filePath).arg( file.errorString() ).toStdString() << std::endl;
+
+        return false;
+    }
+    if (isNew) {
+        lines.prepend( QString::fromUtf8(kRenderCheckpointJournalHeader "\n") );
+    }
+
+    // Write the frame at once so that a crash leaves at most one incomplete frame
+    const QByteArray data = lines.toUtf8();
+    const bool ok = file.write(data) == data.size();
+    file.close();
+
+    return ok;
+} // addFrame
+
+bool
+RenderCheckpointJournal::isFrameCompleted(TimeValue time) const
+{
+    QMutexLocker k(&_imp->lock);
+
+    std::map<int, std::list<RenderCheckpointFile> >::const_iterator found = _imp->completedFrames.find( RenderCheckpointJournalPrivate::frameIndex(time) );
+    if ( found == _imp->completedFrames.end() ) {
+        return false;
+    }
+
+    // The files may have been removed or re-rendered since
+    for (std::list<RenderCheckpointFile>::const_iterator it = found->second.begin(); it != found->second.end(); ++it) {
+        QFileInfo info(it->path);
+        if ( !info.exists() || (info.size() != it->size) || (info.lastModified().toMSecsSinceEpoch() != it->modificationMSecs) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+NATRON_NAMESPACE_EXIT
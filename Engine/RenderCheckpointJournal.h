@@ -0,0 +1,102 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_RenderCheckpointJournal_h
+#define Engine_RenderCheckpointJournal_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QString>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/TimeValue.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The journal of the frames that a Write node fully wrote, so that a render that died in the middle of a
+ * frame range (e.g: a farm task on a preemptible machine) can be resumed with --resume instead of rendering the whole
+ * range again.
+ *
+ * The journal is a text file next to the images, named after the file pattern of the writer, e.g:
+ * /renders/.shot_####.exr.checkpoints. Each frame that was written adds a line per file with its size and
+ * modification date, then a line committing the frame: a frame is only completed if its commit line was written and
+ * if its files did not change since. Renders in background mode write the journal of the writers of image sequences.
+ **/
+struct RenderCheckpointJournalPrivate;
+class RenderCheckpointJournal
+{
+    Q_DECLARE_TR_FUNCTIONS(RenderCheckpointJournal)
+
+public:
+
+    /**
+     * @brief Returns the path of the journal of the given writer, or an empty string if it cannot be resumed,
+     * e.g: it writes a video file.
+     **/
+    static QString getJournalFilePath(const NodePtr& writer);
+
+    explicit RenderCheckpointJournal(const QString& filePath);
+
+    ~RenderCheckpointJournal();
+
+    /**
+     * @brief Read the frames completed by previous renders. Returns false if there is no journal.
+     **/
+    bool load();
+
+    /**
+     * @brief Remove the journal: the next frames are recorded from scratch.
+     **/
+    void clear();
+
+    /**
+     * @brief Check that the given files of a frame exist, are not empty and were written after this object was
+     * created, then record them and commit the frame. Returns false and records nothing if a file does not pass.
+     * This is thread-safe.
+     **/
+    bool addFrame(TimeValue time, const std::list<QString>& files);
+
+    /**
+     * @brief Returns true if the frame was committed by a previous render and its files are unchanged.
+     **/
+    bool isFrameCompleted(TimeValue time) const;
+
+private:
+
+    boost::scoped_ptr<RenderCheckpointJournalPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_RenderCheckpointJournal_h
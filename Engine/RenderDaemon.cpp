@@ -0,0 +1,1011 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderDaemon.h"
+
+#include <iostream>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPointer>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+#include <QtCore/QUrl>
+#include <QtNetwork/QHostAddress>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "qhttpserver.h"
+#include "qhttprequest.h"
+#include "qhttpresponse.h"
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/CLArgs.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/RenderEngine.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/RenderStats.h"
+
+// Number of projects kept loaded between jobs. The least recently used project is closed first.
+#define NATRON_RENDER_DAEMON_MAX_LOADED_PROJECTS 4
+
+// Number of finished jobs whose state can still be queried. The oldest are forgotten first.
+#define NATRON_RENDER_DAEMON_MAX_FINISHED_JOBS 100
+
+NATRON_NAMESPACE_ENTER
+
+enum RenderDaemonJobStateEnum
+{
+    eRenderDaemonJobStateQueued = 0,
+    eRenderDaemonJobStateRunning,
+    eRenderDaemonJobStateFinished,
+    eRenderDaemonJobStateFailed,
+    eRenderDaemonJobStateCancelled
+};
+
+static const char*
+getJobStateName(RenderDaemonJobStateEnum state)
+{
+    switch (state) {
+    case eRenderDaemonJobStateQueued:
+        return "queued";
+    case eRenderDaemonJobStateRunning:
+        return "running";
+    case eRenderDaemonJobStateFinished:
+        return "finished";
+    case eRenderDaemonJobStateFailed:
+        return "failed";
+    case eRenderDaemonJobStateCancelled:
+        return "cancelled";
+    }
+
+    return "";
+}
+
+struct RenderDaemonFrameTiming
+{
+    std::string writer;
+    int frame;
+
+    // The time in seconds spent by all the nodes to render the frame
+    double timeSpent;
+
+    // Only with render stats: the time spent by each node
+    std::list<std::pair<std::string, double> > nodesTimeSpent;
+};
+
+struct RenderDaemonWriterProgress
+{
+    int framesRendered;
+    double progress;
+
+    RenderDaemonWriterProgress()
+        : framesRendered(0)
+        , progress(0.)
+    {
+    }
+};
+
+struct RenderDaemonJob
+{
+    int id;
+    QString projectFilename;
+
+    // Empty to render all the Write nodes of the project
+    std::list<std::string> writers;
+
+    // Empty to render the frame range of each Write node
+    std::list<std::pair<int, std::pair<int, int> > > frameRanges;
+    bool enableRenderStats;
+
+    // Render the Write nodes at the same time, @see RenderQueue::RenderWork::renderConcurrently
+    bool renderConcurrently;
+
+    // Skip the frames written by the previous render, @see RenderQueue::RenderWork::resumeFromCheckpoints
+    bool resumeFromCheckpoints;
+
+    // Only for jobs submitted on /render: answered when the job is finished. Null if the client closed the connection.
+    QPointer<QHttpResponse> response;
+
+    RenderDaemonJobStateEnum state;
+    QString error;
+    bool cancelRequested;
+    QDateTime submissionTime, startTime, endTime;
+
+    // The Write nodes being rendered, to abort them
+    std::list<NodeWPtr> writerNodes;
+
+    std::map<std::string, RenderDaemonWriterProgress> writersProgress;
+    std::vector<RenderDaemonFrameTiming> frames;
+
+    QStringList log;
+
+    // Clients streaming the log, answered until the job is finished
+    std::list<QPointer<QHttpResponse> > logFollowers;
+
+    RenderDaemonJob()
+        : id(0)
+        , projectFilename()
+        , writers()
+        , frameRanges()
+        , enableRenderStats(false)
+        , renderConcurrently(false)
+        , resumeFromCheckpoints(false)
+        , response()
+        , state(eRenderDaemonJobStateQueued)
+        , error()
+        , cancelRequested(false)
+        , submissionTime()
+        , startTime()
+        , endTime()
+        , writerNodes()
+        , writersProgress()
+        , frames()
+        , log()
+        , logFollowers()
+    {
+    }
+
+    bool isDone() const
+    {
+        return state != eRenderDaemonJobStateQueued && state != eRenderDaemonJobStateRunning;
+    }
+};
+
+typedef boost::shared_ptr<RenderDaemonJob> RenderDaemonJobPtr;
+
+struct RenderDaemonLoadedProject
+{
+    QString filename;
+    QDateTime lastModified;
+    AppInstancePtr app;
+};
+
+struct RenderDaemonPrivate
+{
+    RenderDaemon* _publicInterface;
+    QHttpServer* server;
+
+    // All the jobs which can be queried, in submission order
+    std::list<RenderDaemonJobPtr> jobs;
+
+    // The jobs waiting to be rendered
+    std::list<RenderDaemonJobPtr> queue;
+
+    // The job being rendered, if any
+    RenderDaemonJobPtr currentJob;
+    int nextJobID;
+
+    // True while processQueuedJobs() is rendering a job
+    bool processingJobs;
+    bool quitRequested;
+
+    // Most recently used first
+    std::list<RenderDaemonLoadedProject> loadedProjects;
+
+    // Number of Write nodes of the current job whose render failed or was aborted
+    int numFailedRenders;
+
+    RenderDaemonPrivate(RenderDaemon* publicInterface)
+        : _publicInterface(publicInterface)
+        , server(0)
+        , jobs()
+        , queue()
+        , currentJob()
+        , nextJobID(1)
+        , processingJobs(false)
+        , quitRequested(false)
+        , loadedProjects()
+        , numFailedRenders(0)
+    {
+    }
+
+    RenderDaemonJobPtr getJob(int id) const;
+
+    /**
+     * @brief Parse the options of a job from the query items of the request. Returns false and a message on error.
+     **/
+    bool parseJobOptions(const QHttpRequest* request, RenderDaemonJob* job, QString* error) const;
+
+    void submitJob(const RenderDaemonJobPtr& job);
+
+    void cancelJob(const RenderDaemonJobPtr& job);
+
+    void appendToLog(const RenderDaemonJobPtr& job, const QString& message);
+
+    /**
+     * @brief Set the final state of the job, answer the clients waiting for it and forget the oldest finished jobs.
+     **/
+    void finishJob(const RenderDaemonJobPtr& job, RenderDaemonJobStateEnum state, const QString& error);
+
+    QString makeJobJSON(const RenderDaemonJob& job, bool withFrames) const;
+
+    /**
+     * @brief Returns the instance with the given project loaded, loading it if needed.
+     **/
+    AppInstancePtr getProjectInstance(const QString& filename, QString* error);
+
+    void closeProjectInstance(const AppInstancePtr& app);
+
+    bool runJob(const RenderDaemonJobPtr& job, QString* error);
+};
+
+static void
+parseQueryItems(const QUrl& url,
+                std::list<std::pair<QString, QString> >* items)
+{
+    // QUrl query accessors differ between Qt 4 and Qt 5, parse the encoded url
+    QByteArray encoded = url.toEncoded();
+    int queryStart = encoded.indexOf('?');
+
+    if (queryStart == -1) {
+        return;
+    }
+    QByteArray query = encoded.mid(queryStart + 1);
+    int fragmentStart = query.indexOf('#');
+    if (fragmentStart != -1) {
+        query.truncate(fragmentStart);
+    }
+
+    QList<QByteArray> pairs = query.split('&');
+    Q_FOREACH(const QByteArray &pair, pairs) {
+        if ( pair.isEmpty() ) {
+            continue;
+        }
+        int equal = pair.indexOf('=');
+        QByteArray key = (equal == -1) ? pair : pair.left(equal);
+        QByteArray value = (equal == -1) ? QByteArray() : pair.mid(equal + 1);
+        key.replace('+', ' ');
+        value.replace('+', ' ');
+        items->push_back( std::make_pair( QUrl::fromPercentEncoding(key), QUrl::fromPercentEncoding(value) ) );
+    }
+}
+
+static QString
+toJSONString(const QString& str)
+{
+    QString ret;
+
+    ret.reserve(str.size() + 2);
+    ret += QLatin1Char('"');
+    for (int i = 0; i < str.size(); ++i) {
+        const QChar c = str.at(i);
+        if ( c == QLatin1Char('"') ) {
+            ret += QLatin1String("\\\"");
+        } else if ( c == QLatin1Char('\\') ) {
+            ret += QLatin1String("\\\\");
+        } else if ( c == QLatin1Char('\n') ) {
+            ret += QLatin1String("\\n");
+        } else if ( c == QLatin1Char('\r') ) {
+            ret += QLatin1String("\\r");
+        } else if ( c == QLatin1Char('\t') ) {
+            ret += QLatin1String("\\t");
+        } else if (c.unicode() < 0x20) {
+            ret += QString::fromUtf8("\\u%1").arg( (int)c.unicode(), 4, 16, QLatin1Char('0') );
+        } else {
+            ret += c;
+        }
+    }
+    ret += QLatin1Char('"');
+
+    return ret;
+}
+
+static QString
+toJSONTime(const QDateTime& time)
+{
+    if ( !time.isValid() ) {
+        return QString::fromUtf8("null");
+    }
+
+    return toJSONString( time.toUTC().toString(Qt::ISODate) );
+}
+
+static void
+sendReply(QHttpResponse* response,
+          int statusCode,
+          const QString& contentType,
+          const QString& body)
+{
+    if (!response) {
+        return;
+    }
+    QByteArray data = body.toUtf8();
+    data.append('\n');
+    response->setHeader( QString::fromUtf8("Content-Type"), contentType + QString::fromUtf8("; charset=utf-8") );
+    response->setHeader( QString::fromUtf8("Content-Length"), QString::number( data.size() ) );
+    response->writeHead(statusCode);
+    response->end(data);
+}
+
+static void
+sendReply(QHttpResponse* response,
+          int statusCode,
+          const QString& message)
+{
+    sendReply(response, statusCode, QString::fromUtf8("text/plain"), message);
+}
+
+static void
+sendJSONReply(QHttpResponse* response,
+              int statusCode,
+              const QString& json)
+{
+    sendReply(response, statusCode, QString::fromUtf8("application/json"), json);
+}
+
+RenderDaemon::RenderDaemon()
+    : QObject()
+    , _imp( new RenderDaemonPrivate(this) )
+{
+}
+
+RenderDaemon::~RenderDaemon()
+{
+    stop();
+}
+
+bool
+RenderDaemon::start(const QString& host,
+                    int port)
+{
+    assert(!_imp->server);
+    _imp->server = new QHttpServer(this);
+    QObject::connect( _imp->server, SIGNAL(newRequest(QHttpRequest*,QHttpResponse*)), this, SLOT(onNewRequest(QHttpRequest*,QHttpResponse*)) );
+
+    // Jobs run projects, and thus Python code: by default only accept them from the local host
+    QHostAddress address(QHostAddress::LocalHost);
+    if ( !host.isEmpty() && !address.setAddress(host) ) {
+        std::cerr << tr("Render daemon: invalid address %1.").arg(host).toStdString() << std::endl;
+
+        return false;
+    }
+    if ( !_imp->server->listen(address, port) ) {
+        std::cerr << tr("Render daemon: cannot listen on port %1.").arg(port).toStdString() << std::endl;
+
+        return false;
+    }
+    std::cout << tr("Render daemon: waiting for jobs on %1:%2.").arg( address.toString() ).arg(port).toStdString() << std::endl;
+
+    return true;
+}
+
+void
+RenderDaemon::stop()
+{
+    if (_imp->server) {
+        _imp->server->close();
+    }
+    std::list<RenderDaemonJobPtr> queue;
+    queue.swap(_imp->queue);
+    for (std::list<RenderDaemonJobPtr>::iterator it = queue.begin(); it != queue.end(); ++it) {
+        _imp->finishJob( *it, eRenderDaemonJobStateCancelled, tr("The render daemon is stopping.") );
+    }
+
+    std::list<RenderDaemonLoadedProject> loadedProjects;
+    loadedProjects.swap(_imp->loadedProjects);
+    for (std::list<RenderDaemonLoadedProject>::iterator it = loadedProjects.begin(); it != loadedProjects.end(); ++it) {
+        _imp->closeProjectInstance(it->app);
+    }
+}
+
+void
+RenderDaemon::onNewRequest(QHttpRequest* request,
+                           QHttpResponse* response)
+{
+    const QString path = request->path();
+    const QHttpRequest::HttpMethod method = request->method();
+    const QStringList parts = path.split( QLatin1Char('/'), QString::SkipEmptyParts );
+
+    if ( path == QString::fromUtf8("/quit") ) {
+        if (method != QHttpRequest::HTTP_POST) {
+            sendReply( response, 405, tr("Use POST to stop the render daemon.") );
+
+            return;
+        }
+
+        // The job being rendered, if any, finishes first: the event loop only quits once it returns
+        _imp->quitRequested = true;
+        sendReply( response, 200, tr("The render daemon is stopping.") );
+        QTimer::singleShot( 0, QCoreApplication::instance(), SLOT(quit()) );
+
+        return;
+    }
+
+    if ( path == QString::fromUtf8("/render") ) {
+        if (method != QHttpRequest::HTTP_POST) {
+            sendReply( response, 405, tr("Use POST to submit a job.") );
+
+            return;
+        }
+        RenderDaemonJobPtr job = boost::make_shared<RenderDaemonJob>();
+        QString error;
+        if ( !_imp->parseJobOptions(request, job.get(), &error) ) {
+            sendReply(response, 400, error);
+
+            return;
+        }
+        if (_imp->quitRequested) {
+            sendReply( response, 503, tr("The render daemon is stopping.") );
+
+            return;
+        }
+
+        // Answered when the job is finished
+        job->response = response;
+        _imp->submitJob(job);
+
+        return;
+    }
+
+    if ( parts.isEmpty() || ( parts[0] != QString::fromUtf8("jobs") ) ) {
+        sendReply( response, 404, tr("Unknown request %1: use /render, /jobs or /quit.").arg(path) );
+
+        return;
+    }
+
+    if (parts.size() == 1) {
+        if (method == QHttpRequest::HTTP_GET) {
+            QStringList jobs;
+            for (std::list<RenderDaemonJobPtr>::const_iterator it = _imp->jobs.begin(); it != _imp->jobs.end(); ++it) {
+                jobs.push_back( _imp->makeJobJSON(**it, false /*withFrames*/) );
+            }
+            sendJSONReply( response, 200, QString::fromUtf8("{\"jobs\":[%1]}").arg( jobs.join( QString::fromUtf8(",") ) ) );
+        } else if (method == QHttpRequest::HTTP_POST) {
+            RenderDaemonJobPtr job = boost::make_shared<RenderDaemonJob>();
+            QString error;
+            if ( !_imp->parseJobOptions(request, job.get(), &error) ) {
+                sendJSONReply( response, 400, QString::fromUtf8("{\"error\":%1}").arg( toJSONString(error) ) );
+
+                return;
+            }
+            if (_imp->quitRequested) {
+                sendJSONReply( response, 503, QString::fromUtf8("{\"error\":%1}").arg( toJSONString( tr("The render daemon is stopping.") ) ) );
+
+                return;
+            }
+            _imp->submitJob(job);
+            sendJSONReply( response, 202, _imp->makeJobJSON(*job, false /*withFrames*/) );
+        } else {
+            sendReply( response, 405, tr("Use GET to list the jobs or POST to submit a job.") );
+        }
+
+        return;
+    }
+
+    bool isInt = false;
+    const int id = parts[1].toInt(&isInt);
+    RenderDaemonJobPtr job;
+    if (isInt) {
+        job = _imp->getJob(id);
+    }
+    if (!job) {
+        sendJSONReply( response, 404, QString::fromUtf8("{\"error\":%1}").arg( toJSONString( tr("No job %1.").arg(parts[1]) ) ) );
+
+        return;
+    }
+
+    if ( (parts.size() == 2) && (method == QHttpRequest::HTTP_GET) ) {
+        sendJSONReply( response, 200, _imp->makeJobJSON(*job, true /*withFrames*/) );
+    } else if ( ( (parts.size() == 2) && (method == QHttpRequest::HTTP_DELETE) ) ||
+                ( (parts.size() == 3) && ( parts[2] == QString::fromUtf8("cancel") ) && (method == QHttpRequest::HTTP_POST) ) ) {
+        if ( job->isDone() ) {
+            sendJSONReply( response, 409, QString::fromUtf8("{\"error\":%1}").arg( toJSONString( tr("Job %1 is already %2.").arg(job->id).arg( QString::fromUtf8( getJobStateName(job->state) ) ) ) ) );
+
+            return;
+        }
+        _imp->cancelJob(job);
+        sendJSONReply( response, 200, _imp->makeJobJSON(*job, false /*withFrames*/) );
+    } else if ( (parts.size() == 3) && ( parts[2] == QString::fromUtf8("log") ) && (method == QHttpRequest::HTTP_GET) ) {
+        // Without Content-Length, the response lasts until end() is called
+        response->setHeader( QString::fromUtf8("Content-Type"), QString::fromUtf8("text/plain; charset=utf-8") );
+        response->writeHead(200);
+        Q_FOREACH(const QString &line, job->log) {
+            response->write( line.toUtf8() + '\n' );
+        }
+        if ( job->isDone() ) {
+            response->end();
+        } else {
+            job->logFollowers.push_back(response);
+        }
+    } else {
+        sendReply( response, 404, tr("Unknown request %1: use /jobs/<id>, /jobs/<id>/log or /jobs/<id>/cancel.").arg(path) );
+    }
+} // onNewRequest
+
+void
+RenderDaemon::processQueuedJobs()
+{
+    if (_imp->processingJobs) {
+        // A job is rendering, the new job is picked up when it is finished
+        return;
+    }
+    _imp->processingJobs = true;
+    while ( !_imp->queue.empty() && !_imp->quitRequested ) {
+        RenderDaemonJobPtr job = _imp->queue.front();
+        _imp->queue.pop_front();
+
+        job->state = eRenderDaemonJobStateRunning;
+        job->startTime = QDateTime::currentDateTime();
+        _imp->currentJob = job;
+        _imp->appendToLog( job, tr("Started.") );
+
+        QString error;
+        bool ok = _imp->runJob(job, &error);
+        _imp->currentJob.reset();
+
+        if (job->cancelRequested) {
+            _imp->finishJob( job, eRenderDaemonJobStateCancelled, tr("The job was cancelled.") );
+        } else if (ok) {
+            _imp->finishJob( job, eRenderDaemonJobStateFinished, QString() );
+        } else {
+            _imp->finishJob(job, eRenderDaemonJobStateFailed, error);
+        }
+    }
+    _imp->processingJobs = false;
+}
+
+void
+RenderDaemon::onJobRenderFinished(int retCode)
+{
+    if (retCode != 0) {
+        ++_imp->numFailedRenders;
+    }
+}
+
+void
+RenderDaemon::onJobFrameStatsReported(int time,
+                                      RenderStatsPtr stats)
+{
+    RenderEngine* engine = qobject_cast<RenderEngine*>( sender() );
+    RenderDaemonJobPtr job = _imp->currentJob;
+
+    if (!engine || !job || !stats) {
+        return;
+    }
+    NodePtr writer = engine->getOutput();
+    if (!writer) {
+        return;
+    }
+
+    RenderDaemonFrameTiming timing;
+    timing.writer = writer->getScriptName_mt_safe();
+    timing.frame = time;
+    timing.timeSpent = 0.;
+    std::map<NodePtr, NodeRenderStats> nodeStats = stats->getStats(&timing.timeSpent);
+    if ( stats->isInDepthProfilingEnabled() ) {
+        for (std::map<NodePtr, NodeRenderStats>::const_iterator it = nodeStats.begin(); it != nodeStats.end(); ++it) {
+            timing.nodesTimeSpent.push_back( std::make_pair( it->first->getFullyQualifiedName(), it->second.getTotalTimeSpentRendering() ) );
+        }
+    }
+    job->frames.push_back(timing);
+}
+
+void
+RenderDaemon::onJobFrameRendered(int time,
+                                 double progress)
+{
+    RenderEngine* engine = qobject_cast<RenderEngine*>( sender() );
+    RenderDaemonJobPtr job = _imp->currentJob;
+
+    if (!engine || !job) {
+        return;
+    }
+    NodePtr writer = engine->getOutput();
+    if (!writer) {
+        return;
+    }
+    const std::string writerName = writer->getScriptName_mt_safe();
+    RenderDaemonWriterProgress& writerProgress = job->writersProgress[writerName];
+    ++writerProgress.framesRendered;
+    writerProgress.progress = progress;
+
+    // The stats of the frame are reported just before
+    QString message = tr("%1 ==> Frame %2 rendered, progress: %3%").arg( QString::fromUtf8( writerName.c_str() ) ).arg(time).arg(progress * 100., 0, 'f', 1);
+    for (std::vector<RenderDaemonFrameTiming>::reverse_iterator it = job->frames.rbegin(); it != job->frames.rend(); ++it) {
+        if ( (it->frame == time) && (it->writer == writerName) ) {
+            message += tr(", time: %1 s").arg(it->timeSpent, 0, 'f', 3);
+            break;
+        }
+    }
+    _imp->appendToLog(job, message);
+}
+
+RenderDaemonJobPtr
+RenderDaemonPrivate::getJob(int id) const
+{
+    for (std::list<RenderDaemonJobPtr>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+        if ( (*it)->id == id ) {
+            return *it;
+        }
+    }
+
+    return RenderDaemonJobPtr();
+}
+
+bool
+RenderDaemonPrivate::parseJobOptions(const QHttpRequest* request,
+                                     RenderDaemonJob* job,
+                                     QString* error) const
+{
+    std::list<std::pair<QString, QString> > items;
+
+    parseQueryItems(request->url(), &items);
+    for (std::list<std::pair<QString, QString> >::const_iterator it = items.begin(); it != items.end(); ++it) {
+        if ( it->first == QString::fromUtf8("project") ) {
+            job->projectFilename = it->second;
+        } else if ( it->first == QString::fromUtf8("writer") ) {
+            job->writers.push_back( it->second.toStdString() );
+        } else if ( it->first == QString::fromUtf8("frames") ) {
+            if ( !CLArgs::parseFrameRanges(it->second, &job->frameRanges) ) {
+                *error = RenderDaemon::tr("Invalid frame range: %1.").arg(it->second);
+
+                return false;
+            }
+        } else if ( it->first == QString::fromUtf8("stats") ) {
+            job->enableRenderStats = ( it->second == QString::fromUtf8("1") ) || ( it->second == QString::fromUtf8("true") );
+        } else if ( it->first == QString::fromUtf8("concurrent") ) {
+            job->renderConcurrently = ( it->second == QString::fromUtf8("1") ) || ( it->second == QString::fromUtf8("true") );
+        } else if ( it->first == QString::fromUtf8("resume") ) {
+            job->resumeFromCheckpoints = ( it->second == QString::fromUtf8("1") ) || ( it->second == QString::fromUtf8("true") );
+        } else {
+            *error = RenderDaemon::tr("Unknown job option: %1.").arg(it->first);
+
+            return false;
+        }
+    }
+    if ( job->projectFilename.isEmpty() ) {
+        *error = RenderDaemon::tr("The project of the job must be given with project=<project file path>.");
+
+        return false;
+    }
+
+    return true;
+}
+
+void
+RenderDaemonPrivate::submitJob(const RenderDaemonJobPtr& job)
+{
+    job->id = nextJobID++;
+    job->state = eRenderDaemonJobStateQueued;
+    job->submissionTime = QDateTime::currentDateTime();
+    jobs.push_back(job);
+    queue.push_back(job);
+    appendToLog( job, RenderDaemon::tr("Queued for %1.").arg(job->projectFilename) );
+
+    // Do not render from the request handler, which is called by the HTTP connection
+    QTimer::singleShot( 0, _publicInterface, SLOT(processQueuedJobs()) );
+}
+
+void
+RenderDaemonPrivate::cancelJob(const RenderDaemonJobPtr& job)
+{
+    if (job->state == eRenderDaemonJobStateQueued) {
+        for (std::list<RenderDaemonJobPtr>::iterator it = queue.begin(); it != queue.end(); ++it) {
+            if (*it == job) {
+                queue.erase(it);
+                break;
+            }
+        }
+        finishJob( job, eRenderDaemonJobStateCancelled, RenderDaemon::tr("The job was cancelled.") );
+
+        return;
+    }
+
+    // The job is finished by processQueuedJobs() once its renders are aborted
+    job->cancelRequested = true;
+    appendToLog( job, RenderDaemon::tr("Cancelling.") );
+    for (std::list<NodeWPtr>::const_iterator it = job->writerNodes.begin(); it != job->writerNodes.end(); ++it) {
+        NodePtr writer = it->lock();
+        if (writer) {
+            writer->getRenderEngine()->abortRenderingNoRestart();
+        }
+    }
+}
+
+void
+RenderDaemonPrivate::appendToLog(const RenderDaemonJobPtr& job,
+                                 const QString& message)
+{
+    const QString line = QString::fromUtf8("[%1] %2").arg( QDateTime::currentDateTime().toString( QString::fromUtf8("hh:mm:ss") ) ).arg(message);
+
+    job->log.push_back(line);
+    std::cout << RenderDaemon::tr("Render daemon: job %1: %2").arg(job->id).arg(message).toStdString() << std::endl;
+
+    const QByteArray data = line.toUtf8() + '\n';
+    for (std::list<QPointer<QHttpResponse> >::iterator it = job->logFollowers.begin(); it != job->logFollowers.end();) {
+        if (!*it) {
+            // The client closed the connection
+            it = job->logFollowers.erase(it);
+        } else {
+            (*it)->write(data);
+            ++it;
+        }
+    }
+}
+
+void
+RenderDaemonPrivate::finishJob(const RenderDaemonJobPtr& job,
+                               RenderDaemonJobStateEnum state,
+                               const QString& error)
+{
+    job->state = state;
+    job->error = error;
+    job->endTime = QDateTime::currentDateTime();
+    job->writerNodes.clear();
+
+    switch (state) {
+    case eRenderDaemonJobStateFinished:
+        appendToLog( job, RenderDaemon::tr("Finished.") );
+        sendReply( job->response, 200, RenderDaemon::tr("Job %1 finished.").arg(job->id) );
+        break;
+    case eRenderDaemonJobStateCancelled:
+        appendToLog( job, RenderDaemon::tr("Cancelled: %1").arg(error) );
+        sendReply( job->response, 500, RenderDaemon::tr("Job %1 cancelled: %2").arg(job->id).arg(error) );
+        break;
+    default:
+        appendToLog( job, RenderDaemon::tr("Failed: %1").arg(error) );
+        sendReply( job->response, 500, RenderDaemon::tr("Job %1 failed: %2").arg(job->id).arg(error) );
+        break;
+    }
+
+    for (std::list<QPointer<QHttpResponse> >::iterator it = job->logFollowers.begin(); it != job->logFollowers.end(); ++it) {
+        if (*it) {
+            (*it)->end();
+        }
+    }
+    job->logFollowers.clear();
+
+    int numFinishedJobs = 0;
+    for (std::list<RenderDaemonJobPtr>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+        if ( (*it)->isDone() ) {
+            ++numFinishedJobs;
+        }
+    }
+    for (std::list<RenderDaemonJobPtr>::iterator it = jobs.begin(); it != jobs.end() && numFinishedJobs > NATRON_RENDER_DAEMON_MAX_FINISHED_JOBS;) {
+        if ( (*it)->isDone() ) {
+            it = jobs.erase(it);
+            --numFinishedJobs;
+        } else {
+            ++it;
+        }
+    }
+} // finishJob
+
+QString
+RenderDaemonPrivate::makeJobJSON(const RenderDaemonJob& job,
+                                 bool withFrames) const
+{
+    QStringList fields;
+
+    fields.push_back( QString::fromUtf8("\"id\":%1").arg(job.id) );
+    fields.push_back( QString::fromUtf8("\"state\":%1").arg( toJSONString( QString::fromUtf8( getJobStateName(job.state) ) ) ) );
+    fields.push_back( QString::fromUtf8("\"project\":%1").arg( toJSONString(job.projectFilename) ) );
+    fields.push_back( QString::fromUtf8("\"error\":%1").arg( job.error.isEmpty() ? QString::fromUtf8("null") : toJSONString(job.error) ) );
+    fields.push_back( QString::fromUtf8("\"submitted\":%1").arg( toJSONTime(job.submissionTime) ) );
+    fields.push_back( QString::fromUtf8("\"started\":%1").arg( toJSONTime(job.startTime) ) );
+    fields.push_back( QString::fromUtf8("\"ended\":%1").arg( toJSONTime(job.endTime) ) );
+
+    QStringList writers;
+    for (std::map<std::string, RenderDaemonWriterProgress>::const_iterator it = job.writersProgress.begin(); it != job.writersProgress.end(); ++it) {
+        writers.push_back( QString::fromUtf8("%1:{\"framesRendered\":%2,\"progress\":%3}")
+                           .arg( toJSONString( QString::fromUtf8( it->first.c_str() ) ) )
+                           .arg(it->second.framesRendered)
+                           .arg(it->second.progress) );
+    }
+    fields.push_back( QString::fromUtf8("\"writers\":{%1}").arg( writers.join( QString::fromUtf8(",") ) ) );
+
+    if (withFrames) {
+        QStringList frames;
+        for (std::vector<RenderDaemonFrameTiming>::const_iterator it = job.frames.begin(); it != job.frames.end(); ++it) {
+            QString frame = QString::fromUtf8("{\"writer\":%1,\"frame\":%2,\"time\":%3")
+                            .arg( toJSONString( QString::fromUtf8( it->writer.c_str() ) ) )
+                            .arg(it->frame)
+                            .arg(it->timeSpent);
+            if ( !it->nodesTimeSpent.empty() ) {
+                QStringList nodes;
+                for (std::list<std::pair<std::string, double> >::const_iterator it2 = it->nodesTimeSpent.begin(); it2 != it->nodesTimeSpent.end(); ++it2) {
+                    nodes.push_back( QString::fromUtf8("%1:%2").arg( toJSONString( QString::fromUtf8( it2->first.c_str() ) ) ).arg(it2->second) );
+                }
+                frame += QString::fromUtf8(",\"nodes\":{%1}").arg( nodes.join( QString::fromUtf8(",") ) );
+            }
+            frame += QLatin1Char('}');
+            frames.push_back(frame);
+        }
+        fields.push_back( QString::fromUtf8("\"frames\":[%1]").arg( frames.join( QString::fromUtf8(",") ) ) );
+    }
+
+    return QString::fromUtf8("{%1}").arg( fields.join( QString::fromUtf8(",") ) );
+} // makeJobJSON
+
+AppInstancePtr
+RenderDaemonPrivate::getProjectInstance(const QString& filename,
+                                        QString* error)
+{
+    QFileInfo info(filename);
+
+    if ( !info.exists() ) {
+        *error = RenderDaemon::tr("%1: No such file.").arg(filename);
+
+        return AppInstancePtr();
+    }
+    if ( info.suffix() != QString::fromUtf8(NATRON_PROJECT_FILE_EXT) ) {
+        *error = RenderDaemon::tr("%1 is not a %2 project (.%3).").arg(filename).arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ).arg( QString::fromUtf8(NATRON_PROJECT_FILE_EXT) );
+
+        return AppInstancePtr();
+    }
+
+    const QString canonicalFilename = info.canonicalFilePath();
+    const QDateTime lastModified = info.lastModified();
+    for (std::list<RenderDaemonLoadedProject>::iterator it = loadedProjects.begin(); it != loadedProjects.end(); ++it) {
+        if (it->filename != canonicalFilename) {
+            continue;
+        }
+        if (it->lastModified == lastModified) {
+            RenderDaemonLoadedProject loaded = *it;
+            loadedProjects.erase(it);
+            loadedProjects.push_front(loaded);
+
+            return loaded.app;
+        }
+
+        // The file was saved since it was loaded
+        AppInstancePtr outdatedApp = it->app;
+        loadedProjects.erase(it);
+        closeProjectInstance(outdatedApp);
+        break;
+    }
+
+    while ( (int)loadedProjects.size() >= NATRON_RENDER_DAEMON_MAX_LOADED_PROJECTS ) {
+        AppInstancePtr leastRecentlyUsedApp = loadedProjects.back().app;
+        loadedProjects.pop_back();
+        closeProjectInstance(leastRecentlyUsedApp);
+    }
+
+    CLArgs args;
+    AppInstancePtr app = appPTR->newBackgroundInstance(args, true /*makeEmptyInstance*/);
+    if (!app) {
+        *error = RenderDaemon::tr("Cannot create an application instance.");
+
+        return AppInstancePtr();
+    }
+
+    AppInstancePtr loadedApp;
+    try {
+        loadedApp = app->loadProject( canonicalFilename.toStdString() );
+    } catch (const std::exception& e) {
+        *error = QString::fromUtf8( e.what() );
+    }
+    if (!loadedApp) {
+        if ( error->isEmpty() ) {
+            *error = RenderDaemon::tr("Project file loading failed.");
+        }
+        closeProjectInstance(app);
+
+        return AppInstancePtr();
+    }
+
+    RenderDaemonLoadedProject project;
+    project.filename = canonicalFilename;
+    project.lastModified = lastModified;
+    project.app = app;
+    loadedProjects.push_front(project);
+
+    return app;
+} // getProjectInstance
+
+void
+RenderDaemonPrivate::closeProjectInstance(const AppInstancePtr& app)
+{
+    try {
+        app->getProject()->reset(true /*aboutToQuit*/, true /*blocking*/);
+    } catch (std::logic_error&) {
+        // ignore
+    }
+
+    try {
+        app->quitNow();
+    } catch (std::logic_error&) {
+        // ignore
+    }
+}
+
+bool
+RenderDaemonPrivate::runJob(const RenderDaemonJobPtr& job,
+                            QString* error)
+{
+    AppInstancePtr app = getProjectInstance(job->projectFilename, error);
+
+    if (!app) {
+        return false;
+    }
+    if (job->cancelRequested) {
+        return false;
+    }
+
+    // Python commands of the project refer to this instance as "app"
+    appPTR->setAsTopLevelInstance( app->getAppID() );
+
+    RenderQueuePtr queue = app->getRenderQueue();
+    std::list<RenderQueue::RenderWork> works;
+    try {
+        queue->createRenderRequestsFromCommandLineArgs(job->enableRenderStats, job->writers, job->frameRanges, works);
+    } catch (const std::exception& e) {
+        *error = QString::fromUtf8( e.what() );
+
+        return false;
+    }
+    if ( works.empty() ) {
+        *error = RenderDaemon::tr("The project has no enabled Write node to render.");
+
+        return false;
+    }
+
+    numFailedRenders = 0;
+    for (std::list<RenderQueue::RenderWork>::iterator it = works.begin(); it != works.end(); ++it) {
+        it->renderConcurrently = job->renderConcurrently;
+        it->resumeFromCheckpoints = job->resumeFromCheckpoints;
+        RenderEngine* engine = it->treeRoot->getRenderEngine().get();
+        job->writerNodes.push_back(it->treeRoot);
+        job->writersProgress[it->treeRoot->getScriptName_mt_safe()] = RenderDaemonWriterProgress();
+        QObject::connect( engine, SIGNAL(renderFinished(int)), _publicInterface, SLOT(onJobRenderFinished(int)), Qt::UniqueConnection );
+        QObject::connect( engine, SIGNAL(frameStatsReported(int,RenderStatsPtr)), _publicInterface, SLOT(onJobFrameStatsReported(int,RenderStatsPtr)), Qt::UniqueConnection );
+        QObject::connect( engine, SIGNAL(frameRendered(int,double)), _publicInterface, SLOT(onJobFrameRendered(int,double)), Qt::UniqueConnection );
+    }
+
+    queue->renderBlocking(works);
+
+    for (std::list<RenderQueue::RenderWork>::const_iterator it = works.begin(); it != works.end(); ++it) {
+        RenderEngine* engine = it->treeRoot->getRenderEngine().get();
+        QObject::disconnect( engine, SIGNAL(renderFinished(int)), _publicInterface, SLOT(onJobRenderFinished(int)) );
+        QObject::disconnect( engine, SIGNAL(frameStatsReported(int,RenderStatsPtr)), _publicInterface, SLOT(onJobFrameStatsReported(int,RenderStatsPtr)) );
+        QObject::disconnect( engine, SIGNAL(frameRendered(int,double)), _publicInterface, SLOT(onJobFrameRendered(int,double)) );
+    }
+    job->writerNodes.clear();
+
+    if (numFailedRenders > 0) {
+        *error = RenderDaemon::tr("%1 render(s) failed or were aborted.").arg(numFailedRenders);
+
+        return false;
+    }
+
+    return true;
+} // runJob
+
+NATRON_NAMESPACE_EXIT
+
+NATRON_NAMESPACE_USING
+#include "moc_RenderDaemon.cpp"
@@ -0,0 +1,113 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_RenderDaemon_h
+#define Engine_RenderDaemon_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <QtCore/QObject>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+class QHttpRequest;
+class QHttpResponse;
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A render daemon started with NatronRenderer --daemon <port>. The process stays alive with the plug-ins,
+ * Python and the cache loaded, and receives render jobs over HTTP, by default on the local host only, so that
+ * short farm tasks do not pay the startup of the renderer each time.
+ *
+ * A job is a POST on /render with the project file, the Write nodes and the frame ranges as query items,
+ * e.g: /render?project=/path/comp.ntp&writer=Write1&frames=1-10. The answer is sent when the render is finished,
+ * with the status 200 if all the Write nodes rendered successfully. A POST on /quit stops the daemon.
+ *
+ * Jobs can also be submitted with a POST on /jobs, which answers right away with the id of the job. The farm manager
+ * then polls the state of the jobs in JSON:
+ * - GET /jobs: the state of all the jobs.
+ * - GET /jobs/<id>: the state, progress and error of a job, with the time spent to render each frame and, if
+ * render stats were requested, the time spent by each node.
+ * - GET /jobs/<id>/log: the log of a job. If the job is not finished, the answer is streamed until it is.
+ * - POST /jobs/<id>/cancel (or DELETE /jobs/<id>): removes a queued job or aborts the render of a running job.
+ *
+ * Jobs are rendered one after the other in the main thread. Each project is loaded in its own background
+ * AppInstance, and the most recently used ones are kept loaded: a job on a project which is already loaded only
+ * renders. A project is loaded again if its file was modified since.
+ **/
+struct RenderDaemonPrivate;
+class RenderDaemon
+    : public QObject
+{
+    GCC_DIAG_SUGGEST_OVERRIDE_OFF
+    Q_OBJECT
+    GCC_DIAG_SUGGEST_OVERRIDE_ON
+
+public:
+
+    RenderDaemon();
+
+    virtual ~RenderDaemon();
+
+    /**
+     * @brief Listen for jobs on the given port. If host is empty, only connections from the local host are accepted.
+     * Returns false if the port cannot be bound.
+     **/
+    bool start(const QString& host, int port);
+
+    /**
+     * @brief Stop listening, fail the queued jobs and close the loaded projects.
+     **/
+    void stop();
+
+public Q_SLOTS:
+
+    void onNewRequest(QHttpRequest* request, QHttpResponse* response);
+
+    /**
+     * @brief Render the queued jobs. This is a no-op if called while a job is rendering, which happens
+     * because the render processes the events of the main thread.
+     **/
+    void processQueuedJobs();
+
+    void onJobRenderFinished(int retCode);
+
+    void onJobFrameStatsReported(int time, RenderStatsPtr stats);
+
+    void onJobFrameRendered(int time, double progress);
+
+private:
+
+    boost::scoped_ptr<RenderDaemonPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_RenderDaemon_h
@@ -36,16 +36,22 @@
 
 
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
 #include "Engine/CurrentFrameRequestScheduler.h"
 #include "Engine/DefaultRenderScheduler.h"
 #include "Engine/OutputSchedulerThread.h"
+#include "Engine/PlaybackFrameBuffer.h"
 #include "Engine/Node.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
+#include "Engine/ImageStorage.h"
+#include "Engine/MemoryInfo.h"
 #include "Engine/Project.h"
 #include "Engine/Timer.h"
 #include "Engine/RenderStats.h"
+#include "Engine/Settings.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
+#include "Engine/ViewerCacheWarmer.h"
 #include "Engine/ViewerDisplayScheduler.h"
 #include "Engine/ViewerNode.h"
 
@@ -66,6 +72,12 @@ struct RenderEnginePrivate
     PlaybackModeEnum pbMode;
     ViewerCurrentFrameRequestSchedulerPtr currentFrameScheduler;
 
+    // Renders frames ahead of the playhead when idle, created lazily
+    ViewerCacheWarmerPtr cacheWarmer;
+
+    // The display-ready frames of the viewer kept during playback. Never changes after construction
+    PlaybackFrameBufferPtr playbackBuffer;
+
     // Only used on the main-thread
     boost::scoped_ptr<RenderEngineWatcher> engineWatcher;
     struct RefreshRequest
@@ -90,9 +102,18 @@ struct RenderEnginePrivate
     , pbModeMutex()
     , pbMode(ePlaybackModeLoop)
     , currentFrameScheduler()
+    , cacheWarmer()
+    , playbackBuffer(new PlaybackFrameBuffer)
     , refreshQueue()
     {
     }
+
+    void abortCacheWarming()
+    {
+        if (cacheWarmer) {
+            cacheWarmer->abortThreadedTask(false);
+        }
+    }
 };
 
 
@@ -124,6 +145,7 @@ RenderEngine::~RenderEngine()
     // All renders should be finished
     assert(!_imp->scheduler || !_imp->scheduler->hasTreeRendersLaunched());
     assert(!_imp->currentFrameScheduler || !_imp->currentFrameScheduler->hasTreeRendersLaunched());
+    assert(!_imp->cacheWarmer || !_imp->cacheWarmer->hasTreeRendersLaunched());
 }
 
 
@@ -152,6 +174,7 @@ RenderEngine::renderFrameRange(bool isBlocking,
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->onAbortRequested(true);
     }
+    _imp->abortCacheWarming();
 
     setPlaybackAutoRestartEnabled(true);
 
@@ -172,6 +195,7 @@ RenderEngine::renderFromCurrentFrame(bool enableRenderStats,
 {
     // We are going to start playback, abort any current viewer refresh
     _imp->currentFrameScheduler->onAbortRequested(true);
+    _imp->abortCacheWarming();
 
     setPlaybackAutoRestartEnabled(true);
 
@@ -244,6 +268,8 @@ RenderEngine::renderCurrentFrameNowInternal(bool enableRenderStats)
 {
     assert( QThread::currentThread() == qApp->thread() );
 
+    // The frames ahead of the playhead are no longer relevant if the user scrubbed or changed a parameter
+    _imp->abortCacheWarming();
 
     // If the scheduler is already doing playback, continue it
     if (_imp->scheduler) {
@@ -277,6 +303,56 @@ RenderEngine::renderCurrentFrameNowInternal(bool enableRenderStats)
     _imp->currentFrameScheduler->renderCurrentFrame(enableRenderStats);
 }
 
+void
+RenderEngine::warmCacheFromCurrentFrame()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    if ( !appPTR->getCurrentSettings()->isCacheWarmingEnabled() || isDoingSequentialRender() ) {
+        return;
+    }
+    NodePtr output = getOutput();
+    if (!output) {
+        return;
+    }
+    ViewerNodePtr viewerNode = output->isEffectViewerNode();
+    if ( !viewerNode || !viewerNode->isViewerUIVisible() ) {
+        return;
+    }
+
+    // Do not warm the cache while the user is interacting: the frames rendered would be outdated right away
+    AppInstancePtr app = output->getApp();
+    if ( app->isDraftRenderEnabled() || app->getActiveRotoDrawingStroke() || viewerNode->isDoingPartialUpdates() ) {
+        return;
+    }
+
+    RenderDirectionEnum direction = eRenderDirectionForward;
+    {
+        QMutexLocker k(&_imp->schedulerCreationLock);
+        if (_imp->scheduler) {
+            std::vector<ViewIdx> lastViews;
+            _imp->scheduler->getLastRunArgs(&direction, &lastViews);
+        }
+    }
+
+    std::vector<ViewIdx> viewsToRender;
+    {
+        int viewsCount = viewerNode->getRenderViewsCount();
+        viewsToRender.push_back( viewsCount > 0 ? viewerNode->getCurrentRenderView() : ViewIdx(0) );
+    }
+
+    if (!_imp->cacheWarmer) {
+        _imp->cacheWarmer = ViewerCacheWarmer::create(shared_from_this(), output);
+    }
+    _imp->cacheWarmer->warmCache(viewerNode->getTimelineCurrentTime(), direction, getDesiredFPS(), viewsToRender);
+} // warmCacheFromCurrentFrame
+
+PlaybackFrameBufferPtr
+RenderEngine::getPlaybackFrameBuffer() const
+{
+    return _imp->playbackBuffer;
+}
+
 
 
 void
@@ -305,6 +381,10 @@ RenderEngine::quitEngine(bool allowRestarts)
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->quitThread(allowRestarts);
     }
+
+    if (_imp->cacheWarmer) {
+        _imp->cacheWarmer->quitThread(allowRestarts);
+    }
 }
 
 void
@@ -317,6 +397,10 @@ RenderEngine::waitForEngineToQuit_not_main_thread()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_not_main_thread();
     }
+
+    if (_imp->cacheWarmer) {
+        _imp->cacheWarmer->waitForThreadToQuit_not_main_thread();
+    }
 }
 
 void
@@ -340,6 +424,10 @@ RenderEngine::waitForEngineToQuit_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_enforce_blocking();
     }
+
+    if (_imp->cacheWarmer) {
+        _imp->cacheWarmer->waitForThreadToQuit_enforce_blocking();
+    }
 }
 
 bool
@@ -351,6 +439,10 @@ RenderEngine::abortRenderingInternal(bool keepOldestRender)
         ret |= _imp->currentFrameScheduler->abortThreadedTask(keepOldestRender);
     }
 
+    if ( _imp->cacheWarmer && _imp->cacheWarmer->isWorking() ) {
+        ret |= _imp->cacheWarmer->abortThreadedTask(false);
+    }
+
     if ( _imp->scheduler && _imp->scheduler->isWorking() ) {
         //If any playback active, abort it
         ret |= _imp->scheduler->abortThreadedTask(keepOldestRender);
@@ -393,6 +485,9 @@ RenderEngine::waitForAbortToComplete_not_main_thread()
     if (_imp->scheduler) {
         _imp->scheduler->waitForAbortToComplete_not_main_thread();
     }
+    if (_imp->cacheWarmer) {
+        _imp->cacheWarmer->waitForAbortToComplete_not_main_thread();
+    }
 }
 
 void
@@ -405,6 +500,10 @@ RenderEngine::waitForAbortToComplete_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForAbortToComplete_enforce_blocking();
     }
+
+    if (_imp->cacheWarmer) {
+        _imp->cacheWarmer->waitForAbortToComplete_enforce_blocking();
+    }
 }
 
 void
@@ -452,8 +551,12 @@ RenderEngine::hasThreadsAlive() const
     if (_imp->currentFrameScheduler) {
         currentFrameSchedulerRunning = _imp->currentFrameScheduler->hasThreadsAlive();
     }
+    bool cacheWarmerRunning = false;
+    if (_imp->cacheWarmer) {
+        cacheWarmerRunning = _imp->cacheWarmer->hasThreadsAlive();
+    }
 
-    return schedulerRunning || currentFrameSchedulerRunning;
+    return schedulerRunning || currentFrameSchedulerRunning || cacheWarmerRunning;
 }
 
 bool
@@ -469,6 +572,11 @@ RenderEngine::hasActiveRender() const
             return true;
         }
     }
+    if (_imp->cacheWarmer) {
+        if (_imp->cacheWarmer->hasTreeRendersLaunched()) {
+            return true;
+        }
+    }
     return false;
 }
 
@@ -522,6 +630,15 @@ RenderEngine::reportStats(TimeValue time,
     if (!stats) {
         return;
     }
+
+    // When the stats are collected for Python, they are returned there instead of written next to the output
+    RenderStatsAccumulator* accumulator = getOutput()->getApp()->getRenderStatsAccumulator();
+    if ( accumulator->isEnabled() ) {
+        accumulator->addFrame(*stats);
+
+        return;
+    }
+
     std::string filename;
     NodePtr output = getOutput();
     KnobIPtr fileKnob = output->getKnobByName(kOfxImageEffectFileParamName);
@@ -559,9 +676,34 @@ RenderEngine::reportStats(TimeValue time,
     std::map<NodePtr, NodeRenderStats > statsMap = stats->getStats(&wallTime);
 
     ofile << "Time spent to render frame (wall clock time): " << Timer::printAsTime(wallTime, false).toStdString() << std::endl;
+    std::size_t ramPeak, glPeak;
+    if ( stats->getMemoryPeak(&ramPeak, &glPeak) ) {
+        ofile << "Peak memory allocated by the nodes: " << printAsRAM(ramPeak).toStdString() << " (OpenGL textures: " << printAsRAM(glPeak).toStdString() << ")" << std::endl;
+    }
     for (std::map<NodePtr, NodeRenderStats >::const_iterator it = statsMap.begin(); it != statsMap.end(); ++it) {
         ofile << "------------------------------- " << it->first->getScriptName_mt_safe() << "------------------------------- " << std::endl;
         ofile << "Time spent rendering: " << Timer::printAsTime(it->second.getTotalTimeSpentRendering(), false).toStdString() << std::endl;
+        double glTime = it->second.getTimeSpentRendering(eRenderBackendTypeOpenGL);
+        if (glTime > 0) {
+            ofile << "Time spent rendering with OpenGL: " << Timer::printAsTime(glTime, false).toStdString() << std::endl;
+        }
+        double transferTime = it->second.getTotalTimeSpentTransferring();
+        if (transferTime > 0) {
+            ofile << "Time spent transferring images between RAM and OpenGL: " << Timer::printAsTime(transferTime, false).toStdString() << std::endl;
+        }
+        for (int i = 0; i < eRenderStatsActionCount; ++i) {
+            RenderStatsActionEnum action = (RenderStatsActionEnum)i;
+            U64 nCalls = it->second.getActionCallsCount(action);
+            if (nCalls > 0) {
+                ofile << "Time spent in " << NodeRenderStats::getActionName(action) << ": " << nCalls << " calls, mean "
+                      << Timer::printAsTime(it->second.getActionMeanTime(action), false).toStdString() << ", 95th percentile "
+                      << Timer::printAsTime(it->second.getActionTimePercentile(action, 95.), false).toStdString() << std::endl;
+            }
+        }
+        MemoryBudgetPtr budget = it->first->getMemoryBudget();
+        if (budget) {
+            ofile << "Peak memory allocated: " << printAsRAM( budget->getPeakAllocatedBytes(eStorageModeRAM) ).toStdString() << std::endl;
+        }
     }
 } // reportStats
 
@@ -592,6 +734,8 @@ void
 ViewerRenderEngine::reportStats(TimeValue time,
                                 const RenderStatsPtr& stats)
 {
+    getOutput()->getApp()->getRenderStatsAccumulator()->addFrame(*stats);
+
     ViewerNodePtr viewer = getOutput()->isEffectViewerNode();
     double wallTime = 0.;
     std::map<NodePtr, NodeRenderStats > statsMap = stats->getStats(&wallTime);
@@ -102,6 +102,19 @@ public:
      **/
     void renderCurrentFrameNow();
 
+    /**
+     * @brief Render in the background the frames following the current frame in the last playback direction so that
+     * they are cached when playback starts. Any other render request aborts it.
+     * This does nothing if disabled in the settings or if a playback is running.
+     **/
+    void warmCacheFromCurrentFrame();
+
+    /**
+     * @brief Returns the buffer holding the display-ready frames of the viewer rendered by the playback and
+     * the cache warming, see PlaybackFrameBuffer.
+     **/
+    PlaybackFrameBufferPtr getPlaybackFrameBuffer() const;
+
 private:
 
     void renderCurrentFrameInternal(bool enableStats);
@@ -212,6 +225,9 @@ public:
     void s_frameRendered(int time,
                          double progress) { Q_EMIT frameRendered(time, progress); }
 
+    void s_frameStatsReported(int time,
+                              const RenderStatsPtr& stats) { Q_EMIT frameStatsReported(time, stats); }
+
     void s_renderStarted(bool forward) { Q_EMIT renderStarted(forward); }
 
     void s_renderFinished(int retCode) { Q_EMIT renderFinished(retCode); }
@@ -261,6 +277,12 @@ Q_SIGNALS:
      **/
     void frameRendered(int time, double progress);
 
+    /**
+     * @brief Emitted before frameRendered with the time spent by the nodes to render the frame.
+     * This is only emitted by the renders of Write nodes.
+     **/
+    void frameStatsReported(int time, RenderStatsPtr stats);
+
 
     /**
      * @brief Emitted when the stopRender() function is called
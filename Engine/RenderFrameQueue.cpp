@@ -0,0 +1,477 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderFrameQueue.h"
+
+#include <algorithm> // max, nth_element
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTimer>
+#include <QtNetwork/QHostInfo>
+
+#include "Engine/AppInstance.h"
+#include "Engine/Node.h"
+#include "Engine/RenderEngine.h"
+#include "Engine/Timer.h"
+
+// Interval at which the renders of the claimed frames are checked for completion
+#define NATRON_FRAME_QUEUE_RENDER_POLL_INTERVAL_MS 50
+
+// Interval at which the queue is checked while the last frames are rendered by other hosts
+#define NATRON_FRAME_QUEUE_WAIT_INTERVAL_MS 5000
+
+// A frame is re-issued once it is claimed for this many times the median render time of a frame...
+#define NATRON_FRAME_QUEUE_STRAGGLER_FACTOR 3.
+
+// ... and at least this number of seconds
+#define NATRON_FRAME_QUEUE_MIN_STRAGGLER_SECONDS 60
+
+// Until a frame was rendered, a frame is only re-issued once it is claimed for this number of seconds
+#define NATRON_FRAME_QUEUE_STALE_CLAIM_SECONDS 3600
+
+// A frame is claimed at most this number of times, the first claim included
+#define NATRON_FRAME_QUEUE_MAX_CLAIMS 3
+
+NATRON_NAMESPACE_ENTER
+
+enum RenderFrameQueueFrameStateEnum
+{
+    // Not claimed by this process, it may be claimed by others
+    eRenderFrameQueueFrameStateUnknown = 0,
+
+    // The frame has a done file
+    eRenderFrameQueueFrameStateDone,
+
+    // This process failed to render the frame, it does not claim it again
+    eRenderFrameQueueFrameStateFailed
+};
+
+struct RenderFrameQueueFrame
+{
+    // Index of the writer in RenderFrameQueuePrivate::writers
+    std::size_t writerIndex;
+    TimeValue time;
+    RenderFrameQueueFrameStateEnum state;
+
+    RenderFrameQueueFrame()
+        : writerIndex(0)
+        , time(0)
+        , state(eRenderFrameQueueFrameStateUnknown)
+    {
+    }
+};
+
+struct RenderFrameQueueWriter
+{
+    RenderQueue::RenderWork work;
+    QDir dir;
+};
+
+struct RenderFrameQueuePrivate
+{
+    QString directoryPath;
+    int batchSize;
+    AppInstancePtr app;
+    std::vector<RenderFrameQueueWriter> writers;
+
+    // The frames of all the writers, in the order they are claimed
+    std::vector<RenderFrameQueueFrame> frames;
+
+    // Frames before this index were claimed, by this process or by others
+    std::size_t firstUnclaimedFrame;
+
+    // The render times in seconds read from the done files
+    std::vector<double> renderTimes;
+
+    // The writers whose render failed in the current batch, set by onRenderFinished()
+    std::set<NodePtr> failedWriters;
+
+    RenderFrameQueuePrivate(const QString& directoryPath)
+        : directoryPath(directoryPath)
+        , batchSize(1)
+        , app()
+        , writers()
+        , frames()
+        , firstUnclaimedFrame(0)
+        , renderTimes()
+        , failedWriters()
+    {
+    }
+
+    QString getFramePath(const RenderFrameQueueFrame& frame, const QString& suffix) const
+    {
+        const QString frameName = QString::number( (int)std::floor(frame.time + 0.5) );
+
+        return writers[frame.writerIndex].dir.absoluteFilePath(frameName + suffix);
+    }
+
+    QString getClaimPath(const RenderFrameQueueFrame& frame, int claimIndex) const
+    {
+        return getFramePath( frame, QString::fromUtf8(".claim") + QString::number(claimIndex) );
+    }
+
+    /**
+     * @brief Returns true if the frame has a done file, and if so records its render time and marks it done
+     **/
+    bool checkFrameDone(RenderFrameQueueFrame& frame);
+
+    /**
+     * @brief Creates the claim directory with the given index. Returns false if it exists, i.e: another process
+     * made that claim.
+     **/
+    bool claimFrame(const RenderFrameQueueFrame& frame, int claimIndex) const;
+
+    int getClaimsCount(const RenderFrameQueueFrame& frame) const;
+
+    /**
+     * @brief Returns the number of seconds after which a claimed frame is re-issued
+     **/
+    double getStragglerTime() const;
+
+    /**
+     * @brief Claims up to batchSize frames that no process claimed yet
+     **/
+    void claimNewFrames(std::vector<std::size_t>* batch);
+
+    /**
+     * @brief Claims up to batchSize frames that were claimed for too long. pendingFrames is set to true if some
+     * frames are still rendered by other processes and may have to be re-issued later.
+     **/
+    void reissueFrames(std::vector<std::size_t>* batch, bool* pendingFrames);
+
+    /**
+     * @brief Renders the given frames, then marks them done or failed
+     **/
+    void renderFrames(const std::vector<std::size_t>& batch);
+};
+
+RenderFrameQueue::RenderFrameQueue(const QString& directoryPath)
+    : QObject()
+    , _imp( new RenderFrameQueuePrivate(directoryPath) )
+{
+}
+
+RenderFrameQueue::~RenderFrameQueue()
+{
+}
+
+void
+RenderFrameQueue::setBatchSize(int framesCount)
+{
+    _imp->batchSize = std::max(1, framesCount);
+}
+
+bool
+RenderFrameQueuePrivate::checkFrameDone(RenderFrameQueueFrame& frame)
+{
+    if (frame.state == eRenderFrameQueueFrameStateDone) {
+        return true;
+    }
+    QFile doneFile( getFramePath( frame, QString::fromUtf8(".done") ) );
+    if ( !doneFile.exists() ) {
+        return false;
+    }
+    frame.state = eRenderFrameQueueFrameStateDone;
+    if ( doneFile.open(QIODevice::ReadOnly | QIODevice::Text) ) {
+        bool ok = false;
+        double renderTime = QString::fromUtf8( doneFile.readAll().trimmed().constData() ).toDouble(&ok);
+        if (ok && (renderTime >= 0)) {
+            renderTimes.push_back(renderTime);
+        }
+    }
+
+    return true;
+}
+
+bool
+RenderFrameQueuePrivate::claimFrame(const RenderFrameQueueFrame& frame,
+                                    int claimIndex) const
+{
+    // mkdir fails if the directory exists: only one process makes each claim
+    const QString claimPath = getClaimPath(frame, claimIndex);
+    if ( !QDir().mkdir(claimPath) ) {
+        return false;
+    }
+
+    // Tell who claimed the frame, for the humans looking at the queue
+    QFile ownerFile( QDir(claimPath).absoluteFilePath( QString::fromUtf8("owner") ) );
+    if ( ownerFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate) ) {
+        QString owner = QHostInfo::localHostName() + QLatin1Char(' ') + QString::number( (qint64)QCoreApplication::applicationPid() ) + QLatin1Char('\n');
+        ownerFile.write( owner.toUtf8() );
+    }
+
+    return true;
+}
+
+int
+RenderFrameQueuePrivate::getClaimsCount(const RenderFrameQueueFrame& frame) const
+{
+    int count = 0;
+    while ( QFileInfo( getClaimPath(frame, count) ).exists() ) {
+        ++count;
+    }
+
+    return count;
+}
+
+double
+RenderFrameQueuePrivate::getStragglerTime() const
+{
+    if ( renderTimes.empty() ) {
+        return NATRON_FRAME_QUEUE_STALE_CLAIM_SECONDS;
+    }
+    std::vector<double> times = renderTimes;
+    std::nth_element( times.begin(), times.begin() + times.size() / 2, times.end() );
+    const double median = times[times.size() / 2];
+
+    return std::max(median * NATRON_FRAME_QUEUE_STRAGGLER_FACTOR, (double)NATRON_FRAME_QUEUE_MIN_STRAGGLER_SECONDS);
+}
+
+void
+RenderFrameQueuePrivate::claimNewFrames(std::vector<std::size_t>* batch)
+{
+    while ( ( firstUnclaimedFrame < frames.size() ) && ( (int)batch->size() < batchSize ) ) {
+        const std::size_t i = firstUnclaimedFrame++;
+        if ( checkFrameDone(frames[i]) ) {
+            continue;
+        }
+        if ( claimFrame(frames[i], 0) ) {
+            batch->push_back(i);
+        }
+    }
+}
+
+void
+RenderFrameQueuePrivate::reissueFrames(std::vector<std::size_t>* batch,
+                                       bool* pendingFrames)
+{
+    *pendingFrames = false;
+
+    const double stragglerTime = getStragglerTime();
+    const QDateTime now = QDateTime::currentDateTime();
+    for (std::size_t i = 0; i < firstUnclaimedFrame; ++i) {
+        RenderFrameQueueFrame& frame = frames[i];
+        if ( (frame.state == eRenderFrameQueueFrameStateFailed) || checkFrameDone(frame) ) {
+            continue;
+        }
+        const int claimsCount = getClaimsCount(frame);
+        if (claimsCount == 0) {
+            // Cannot happen unless the queue was modified by hand: treat it as a new frame
+            if ( ( (int)batch->size() < batchSize ) && claimFrame(frame, 0) ) {
+                batch->push_back(i);
+            } else {
+                *pendingFrames = true;
+            }
+            continue;
+        }
+        const QDateTime claimTime = QFileInfo( getClaimPath(frame, claimsCount - 1) ).lastModified();
+        if ( claimTime.secsTo(now) < stragglerTime ) {
+            *pendingFrames = true;
+            continue;
+        }
+        if (claimsCount >= NATRON_FRAME_QUEUE_MAX_CLAIMS) {
+            // All the hosts that claimed it failed to render it in time: give up
+            continue;
+        }
+        if ( ( (int)batch->size() < batchSize ) && claimFrame(frame, claimsCount) ) {
+            std::cout << RenderFrameQueue::tr("%1: re-issuing frame %2, claimed %3 seconds ago.")
+                .arg( QString::fromUtf8( writers[frame.writerIndex].work.treeRoot->getScriptName_mt_safe().c_str() ) )
+                .arg( (int)std::floor(frame.time + 0.5) )
+                .arg( claimTime.secsTo(now) ).toStdString() << std::endl;
+            batch->push_back(i);
+        } else {
+            *pendingFrames = true;
+        }
+    }
+} // reissueFrames
+
+void
+RenderFrameQueuePrivate::renderFrames(const std::vector<std::size_t>& batch)
+{
+    // Consecutive frames of the same writer are rendered by a single work
+    std::list<RenderQueue::RenderWork> works;
+    std::size_t lastWriterIndex = 0;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        const RenderFrameQueueFrame& frame = frames[batch[i]];
+        const RenderQueue::RenderWork& writerWork = writers[frame.writerIndex].work;
+        if ( !works.empty() && (lastWriterIndex == frame.writerIndex) && ( (double)works.back().lastFrame + (double)writerWork.frameStep == (double)frame.time ) ) {
+            works.back().lastFrame = frame.time;
+            continue;
+        }
+        RenderQueue::RenderWork w = writerWork;
+        w.firstFrame = frame.time;
+        w.lastFrame = frame.time;
+
+        // The journal must not be cleared by each batch: it is shared by the hosts rendering the writer
+        w.resumeFromCheckpoints = true;
+        works.push_back(w);
+        lastWriterIndex = frame.writerIndex;
+    }
+
+    failedWriters.clear();
+    TimeLapse timer;
+    app->getRenderQueue()->renderAsync(works);
+    while ( app->getRenderQueue()->hasActiveRenders() ) {
+        QEventLoop loop;
+        QTimer::singleShot( NATRON_FRAME_QUEUE_RENDER_POLL_INTERVAL_MS, &loop, SLOT(quit()) );
+        loop.exec();
+    }
+    const double renderTime = timer.getTimeSinceCreation() / batch.size();
+
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        RenderFrameQueueFrame& frame = frames[batch[i]];
+        if ( failedWriters.find(writers[frame.writerIndex].work.treeRoot) != failedWriters.end() ) {
+            frame.state = eRenderFrameQueueFrameStateFailed;
+            continue;
+        }
+        // The first render of a re-issued frame to finish marks it done
+        if ( !checkFrameDone(frame) ) {
+            QFile doneFile( getFramePath( frame, QString::fromUtf8(".done") ) );
+            if ( doneFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate) ) {
+                doneFile.write( QString::number(renderTime).toUtf8() + '\n' );
+            }
+            frame.state = eRenderFrameQueueFrameStateDone;
+            renderTimes.push_back(renderTime);
+        }
+    }
+} // renderFrames
+
+bool
+RenderFrameQueue::render(const AppInstancePtr& app,
+                         const std::list<RenderQueue::RenderWork>& works)
+{
+    _imp->app = app;
+    _imp->writers.clear();
+    _imp->frames.clear();
+    _imp->firstUnclaimedFrame = 0;
+    _imp->renderTimes.clear();
+
+    QDir queueDir(_imp->directoryPath);
+    for (std::list<RenderQueue::RenderWork>::const_iterator it = works.begin(); it != works.end(); ++it) {
+        RenderFrameQueueWriter writer;
+        writer.work = *it;
+        if ( !app->getRenderQueue()->validateRenderWork(&writer.work) ) {
+            return false;
+        }
+        const QString writerName = QString::fromUtf8( writer.work.treeRoot->getFullyQualifiedName().c_str() );
+        if ( !queueDir.mkpath(writerName) ) {
+            std::cerr << tr("Could not create the directory %1.").arg( queueDir.absoluteFilePath(writerName) ).toStdString() << std::endl;
+
+            return false;
+        }
+        writer.dir = QDir( queueDir.absoluteFilePath(writerName) );
+        _imp->writers.push_back(writer);
+
+        const RenderQueue::RenderWork& w = writer.work;
+        for (double time = w.firstFrame; (w.frameStep > 0) ? (time <= w.lastFrame) : (time >= w.lastFrame); time += w.frameStep) {
+            RenderFrameQueueFrame frame;
+            frame.writerIndex = _imp->writers.size() - 1;
+            frame.time = TimeValue(time);
+            _imp->frames.push_back(frame);
+        }
+    }
+
+    for (std::size_t i = 0; i < _imp->writers.size(); ++i) {
+        RenderEngine* engine = _imp->writers[i].work.treeRoot->getRenderEngine().get();
+        QObject::connect( engine, SIGNAL(renderFinished(int)), this, SLOT(onRenderFinished(int)), Qt::UniqueConnection );
+    }
+
+    int renderedFramesCount = 0;
+    for (;;) {
+        std::vector<std::size_t> batch;
+        _imp->claimNewFrames(&batch);
+        if ( batch.empty() ) {
+            bool pendingFrames;
+            _imp->reissueFrames(&batch, &pendingFrames);
+            if ( batch.empty() ) {
+                if (!pendingFrames) {
+                    break;
+                }
+                // Other hosts are rendering the last frames: wait in case one of them has to be re-issued
+                QEventLoop loop;
+                QTimer::singleShot( NATRON_FRAME_QUEUE_WAIT_INTERVAL_MS, &loop, SLOT(quit()) );
+                loop.exec();
+                continue;
+            }
+        }
+        _imp->renderFrames(batch);
+        renderedFramesCount += (int)batch.size();
+    }
+
+    for (std::size_t i = 0; i < _imp->writers.size(); ++i) {
+        RenderEngine* engine = _imp->writers[i].work.treeRoot->getRenderEngine().get();
+        QObject::disconnect( engine, SIGNAL(renderFinished(int)), this, SLOT(onRenderFinished(int)) );
+    }
+
+    int failedFramesCount = 0;
+    int missingFramesCount = 0;
+    for (std::size_t i = 0; i < _imp->frames.size(); ++i) {
+        if (_imp->frames[i].state == eRenderFrameQueueFrameStateFailed) {
+            ++failedFramesCount;
+        } else if ( !_imp->checkFrameDone(_imp->frames[i]) ) {
+            ++missingFramesCount;
+        }
+    }
+    std::cout << tr("%1 of the %2 frames of the queue were rendered by this process.").arg(renderedFramesCount).arg( _imp->frames.size() ).toStdString() << std::endl;
+    if (missingFramesCount > 0) {
+        std::cerr << tr("%1 frames were claimed %2 times without being rendered.").arg(missingFramesCount).arg(NATRON_FRAME_QUEUE_MAX_CLAIMS).toStdString() << std::endl;
+    }
+    if (failedFramesCount > 0) {
+        std::cerr << tr("%1 frames failed to render.").arg(failedFramesCount).toStdString() << std::endl;
+    }
+    _imp->app.reset();
+
+    return (failedFramesCount == 0) && (missingFramesCount == 0);
+} // render
+
+void
+RenderFrameQueue::onRenderFinished(int retCode)
+{
+    if (retCode == 0) {
+        return;
+    }
+    RenderEngine* engine = qobject_cast<RenderEngine*>( sender() );
+    if (!engine) {
+        return;
+    }
+    NodePtr writer = engine->getOutput();
+    if (writer) {
+        _imp->failedWriters.insert(writer);
+    }
+}
+
+NATRON_NAMESPACE_EXIT
+
+NATRON_NAMESPACE_USING
+#include "moc_RenderFrameQueue.cpp"
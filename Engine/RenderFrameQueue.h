@@ -0,0 +1,101 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_RenderFrameQueue_h
+#define Engine_RenderFrameQueue_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/RenderQueue.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Renders the frames of the Write nodes with NatronRenderer processes on several hosts pulling them from a
+ * work queue in a directory shared by all of them, e.g: on NFS (--frame-queue <dir>), instead of each process
+ * rendering a fixed frame range: fast hosts render more frames than slow ones.
+ *
+ * All the processes are started with the same project, Write nodes and frame ranges. A frame is claimed by the
+ * process that creates its claim directory in the queue, which is atomic even on NFS. A process claims a few frames
+ * at a time (--frame-queue-batch), renders them, then marks them as done with their render time.
+ *
+ * When no frame is left to claim, the frames claimed for much longer than the median render time of a frame are
+ * re-issued: the host rendering them is a straggler, or died. The process that re-issues a frame renders it again and
+ * the first render to finish marks it done. A process returns once all the frames are done, or were re-issued too
+ * many times.
+ *
+ * The queue holds a directory per writer, named after its script-name, with <frame>.claim<n> directories for each
+ * claim of a frame and a <frame>.done file once it is written. The clocks of the hosts must be synchronized.
+ * The frames that the checkpoint journal of a writer records as completed are not rendered again,
+ * @see RenderCheckpointJournal.
+ **/
+struct RenderFrameQueuePrivate;
+class RenderFrameQueue
+    : public QObject
+{
+    GCC_DIAG_SUGGEST_OVERRIDE_OFF
+    Q_OBJECT
+    GCC_DIAG_SUGGEST_OVERRIDE_ON
+
+public:
+
+    explicit RenderFrameQueue(const QString& directoryPath);
+
+    virtual ~RenderFrameQueue();
+
+    /**
+     * @brief Set the number of frames claimed at a time. The default is 1.
+     **/
+    void setBatchSize(int framesCount);
+
+    /**
+     * @brief Renders the frames of the given works pulled from the queue and returns when none is left.
+     * Returns false if the queue cannot be used or if the render of a frame failed.
+     **/
+    bool render(const AppInstancePtr& app, const std::list<RenderQueue::RenderWork>& works);
+
+public Q_SLOTS:
+
+    void onRenderFinished(int retCode);
+
+private:
+
+    boost::scoped_ptr<RenderFrameQueuePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_RenderFrameQueue_h
@@ -24,24 +24,32 @@
 
 #include "RenderQueue.h"
 
+#include <iostream>
+#include <map>
+#include <set>
+
 #include <QCoreApplication>
 #include <QWaitCondition>
 #include <QMutex>
 
 #include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
+#include "Engine/Cache.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/CLArgs.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
 #include "Engine/GroupOutput.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/ProcessHandler.h"
 #include "Engine/Project.h"
 #include "Engine/Settings.h"
+#include "Engine/RenderCheckpointJournal.h"
 #include "Engine/RenderEngine.h"
+#include "Engine/TimeLine.h"
 
 
 NATRON_NAMESPACE_ENTER
@@ -52,6 +60,18 @@ struct RenderQueueItem
     QString sequenceName;
     QString savePath;
     ProcessHandlerPtr process;
+
+    // Items with the same non-zero group ID start together and render concurrently
+    int groupID;
+
+    RenderQueueItem()
+    : work()
+    , sequenceName()
+    , savePath()
+    , process()
+    , groupID(0)
+    {
+    }
 };
 
 struct RenderQueuePrivate
@@ -66,6 +86,11 @@ struct RenderQueuePrivate
     QWaitCondition activeRendersNotEmptyCond;
     std::list<RenderQueueItem> renderQueue, activeRenders;
 
+    // The nodes upstream of several writers of each group of concurrent renders, marked with
+    // Node::setSharedByConcurrentRenders until the last writer of the group is finished
+    std::map<int, std::list<NodeWPtr> > groupsSharedNodes;
+    int nextGroupID;
+
     RenderQueuePrivate(RenderQueue* publicInterface, const AppInstancePtr& app)
     : _publicInterface(publicInterface)
     , app(app)
@@ -73,6 +98,8 @@ struct RenderQueuePrivate
     , activeRendersNotEmptyCond()
     , renderQueue()
     , activeRenders()
+    , groupsSharedNodes()
+    , nextGroupID(1)
     {
 
     }
@@ -105,6 +132,13 @@ struct RenderQueuePrivate
      **/
     bool validateRenderOptions(RenderQueue::RenderWork& w);
 
+    /**
+     * @brief Remove from the works that resume a previous render the frames completed according to the checkpoint
+     * journal of their writer, which may split a frame range in several works. The journal of the other works is
+     * cleared since their frames are rendered again.
+     **/
+    void applyCheckpoints(const std::list<RenderQueue::RenderWork>& writers, std::list<RenderQueue::RenderWork>* works);
+
     /**
      * @brief Get a label indicating the status of the render
      **/
@@ -115,6 +149,19 @@ struct RenderQueuePrivate
      **/
     void renderInternal(const RenderQueueItem& writerWork);
 
+    /**
+     * @brief Launch the render of the given items, which are either a single item or all the items of a group.
+     * For a group, the nodes shared by its writers are marked so that they are cached.
+     **/
+    void renderItems(const std::list<RenderQueueItem>& items);
+
+    /**
+     * @brief Pops the next item of the queue, with the items of its group if any. Must be called under renderQueueMutex.
+     **/
+    void takeNextQueuedItems(std::list<RenderQueueItem>* items);
+
+    static void getUpstreamNodes(const NodePtr& node, std::set<NodePtr>* nodes);
+
 
     AppInstancePtr getApp() const
     {
@@ -202,9 +249,77 @@ RenderQueuePrivate::validateRenderOptions(RenderQueue::RenderWork& w)
 } // validateRenderOptions
 
 
+bool
+RenderQueue::validateRenderWork(RenderWork* work)
+{
+    return _imp->validateRenderOptions(*work);
+}
+
 void
-RenderQueuePrivate::dispatchQueue(bool doBlockingRender, const std::list<RenderQueue::RenderWork>& writers)
+RenderQueuePrivate::applyCheckpoints(const std::list<RenderQueue::RenderWork>& writers,
+                                     std::list<RenderQueue::RenderWork>* works)
 {
+    std::set<NodePtr> clearedWriters;
+    for (std::list<RenderQueue::RenderWork>::const_iterator it = writers.begin(); it != writers.end(); ++it) {
+        const QString journalPath = RenderCheckpointJournal::getJournalFilePath(it->treeRoot);
+        if ( journalPath.isEmpty() ) {
+            works->push_back(*it);
+            continue;
+        }
+        RenderCheckpointJournal journal(journalPath);
+        if (!it->resumeFromCheckpoints) {
+            // Several frame ranges of the same writer are dispatched together, before any frame is rendered
+            if ( clearedWriters.insert(it->treeRoot).second ) {
+                journal.clear();
+            }
+            works->push_back(*it);
+            continue;
+        }
+
+        RenderQueue::RenderWork w = *it;
+        if ( !journal.load() || !validateRenderOptions(w) ) {
+            works->push_back(w);
+            continue;
+        }
+
+        // Each run of frames that were not completed becomes a work
+        int framesCount = 0;
+        int completedCount = 0;
+        RenderQueue::RenderWork run = w;
+        bool inRun = false;
+        for (double frame = w.firstFrame; (w.frameStep > 0) ? (frame <= w.lastFrame) : (frame >= w.lastFrame); frame += w.frameStep) {
+            ++framesCount;
+            if ( journal.isFrameCompleted( TimeValue(frame) ) ) {
+                ++completedCount;
+                if (inRun) {
+                    works->push_back(run);
+                    inRun = false;
+                }
+            } else {
+                if (!inRun) {
+                    run.firstFrame = TimeValue(frame);
+                    inRun = true;
+                }
+                run.lastFrame = TimeValue(frame);
+            }
+        }
+        if (inRun) {
+            works->push_back(run);
+        }
+        if (completedCount > 0) {
+            std::cout << RenderQueue::tr("%1: resuming the render, %2 of the %3 frames were already written.")
+                .arg( QString::fromUtf8( w.treeRoot->getScriptName_mt_safe().c_str() ) )
+                .arg(completedCount)
+                .arg(framesCount).toStdString() << std::endl;
+        }
+    }
+} // applyCheckpoints
+
+void
+RenderQueuePrivate::dispatchQueue(bool doBlockingRender, const std::list<RenderQueue::RenderWork>& inWriters)
+{
+    std::list<RenderQueue::RenderWork> writers;
+    applyCheckpoints(inWriters, &writers);
     if ( writers.empty() ) {
         return;
     }
@@ -217,6 +332,9 @@ RenderQueuePrivate::dispatchQueue(bool doBlockingRender, const std::list<RenderQ
     // If enabled, we launch the render in a separate process launching NatronRenderer
     const bool renderInSeparateProcess = appPTR->getCurrentSettings()->isRenderInSeparatedProcessEnabled();
 
+    // If enabled, all the writers render concurrently, otherwise only those which asked for it
+    const bool renderWritersConcurrently = appPTR->getCurrentSettings()->isRenderWritersConcurrentlyEnabled();
+
     // When launching in a separate process, make a temporary save file that we pass to NatronRenderer
     QString savePath;
     if (renderInSeparateProcess) {
@@ -244,6 +362,7 @@ RenderQueuePrivate::dispatchQueue(bool doBlockingRender, const std::list<RenderQ
         if (renderInSeparateProcess) {
             item.process = boost::make_shared<ProcessHandler>(savePath, item.work.treeRoot);
             QObject::connect( item.process.get(), SIGNAL(processFinished(int)), _publicInterface, SLOT(onBackgroundRenderProcessFinished()) );
+            QObject::connect( item.process.get(), SIGNAL(frameAvailableInCache(int,int)), _publicInterface, SLOT(onBackgroundRenderFrameAvailableInCache(int,int)) );
         } else {
             QObject::connect(item.work.treeRoot->getRenderEngine().get(), SIGNAL(renderFinished(int)), _publicInterface, SLOT(onQueuedRenderFinished(int)), Qt::UniqueConnection);
         }
@@ -263,26 +382,57 @@ RenderQueuePrivate::dispatchQueue(bool doBlockingRender, const std::list<RenderQ
         return;
     }
 
+    // Group the writers rendering concurrently, they are queued before the other writers
+    {
+        std::list<RenderQueueItem> concurrentItems, otherItems;
+        std::set<NodePtr> concurrentWriters;
+        for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+            // A writer rendering several frame ranges renders them one after the other
+            if ( (renderWritersConcurrently || it->work.renderConcurrently) && concurrentWriters.insert(it->work.treeRoot).second ) {
+                concurrentItems.push_back(*it);
+            } else {
+                otherItems.push_back(*it);
+            }
+        }
+        if (concurrentItems.size() > 1) {
+            int groupID;
+            {
+                QMutexLocker k(&renderQueueMutex);
+                groupID = nextGroupID++;
+            }
+            for (std::list<RenderQueueItem>::iterator it = concurrentItems.begin(); it != concurrentItems.end(); ++it) {
+                it->groupID = groupID;
+            }
+            itemsToQueue.clear();
+            itemsToQueue.insert( itemsToQueue.end(), concurrentItems.begin(), concurrentItems.end() );
+            itemsToQueue.insert( itemsToQueue.end(), otherItems.begin(), otherItems.end() );
+        }
+    }
+
     if (!isQueuingEnabled) {
         // Just launch everything
+        std::list<RenderQueueItem> groupItems;
+        for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+            if (it->groupID != 0) {
+                groupItems.push_back(*it);
+            }
+        }
+        renderItems(groupItems);
         for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
-            renderInternal(*it);
+            if (it->groupID == 0) {
+                renderInternal(*it);
+            }
         }
     } else {
         QMutexLocker k(&renderQueueMutex);
+        renderQueue.insert( renderQueue.end(), itemsToQueue.begin(), itemsToQueue.end() );
         if ( !activeRenders.empty() ) {
-            renderQueue.insert( renderQueue.end(), itemsToQueue.begin(), itemsToQueue.end() );
-
             return;
         } else {
-            std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin();
-            const RenderQueueItem& firstWork = *it;
-            ++it;
-            for (; it != itemsToQueue.end(); ++it) {
-                renderQueue.push_back(*it);
-            }
+            std::list<RenderQueueItem> firstItems;
+            takeNextQueuedItems(&firstItems);
             k.unlock();
-            renderInternal(firstWork);
+            renderItems(firstItems);
         }
     }
     if (doBlockingRender) {
@@ -406,7 +556,13 @@ RenderQueue::createRenderRequestsFromCommandLineArgs(const CLArgs& cl, std::list
             writerArgs.push_back(wArgs);
         }
     }
-    _imp->createRenderRequestsFromCommandLineArgsInternal(cl.getFrameRanges(), cl.areRenderStatsEnabled(), writerArgs, requests);
+    std::list<RenderQueue::RenderWork> clRequests;
+    _imp->createRenderRequestsFromCommandLineArgsInternal(cl.getFrameRanges(), cl.areRenderStatsEnabled(), writerArgs, clRequests);
+    for (std::list<RenderQueue::RenderWork>::iterator it = clRequests.begin(); it != clRequests.end(); ++it) {
+        it->renderConcurrently = cl.isRenderWritersConcurrentlyEnabled();
+        it->resumeFromCheckpoints = cl.isResumeRenderEnabled();
+    }
+    requests.insert( requests.end(), clRequests.begin(), clRequests.end() );
 }
 
 
@@ -461,6 +617,20 @@ RenderQueue::renderNonBlocking(const std::list<RenderWork>& writers)
     _imp->dispatchQueue(blocking, writers);
 }
 
+void
+RenderQueue::renderAsync(const std::list<RenderWork>& writers)
+{
+    _imp->dispatchQueue(false /*blocking*/, writers);
+}
+
+bool
+RenderQueue::hasActiveRenders() const
+{
+    QMutexLocker k(&_imp->renderQueueMutex);
+
+    return !_imp->activeRenders.empty() || !_imp->renderQueue.empty();
+}
+
 void
 RenderQueuePrivate::renderInternal(const RenderQueueItem& w)
 {
@@ -479,6 +649,84 @@ RenderQueuePrivate::renderInternal(const RenderQueueItem& w)
 }
 
 
+void
+RenderQueuePrivate::getUpstreamNodes(const NodePtr& node,
+                                     std::set<NodePtr>* nodes)
+{
+    if ( !node || !nodes->insert(node).second ) {
+        return;
+    }
+    int nInputs = node->getNInputs();
+    for (int i = 0; i < nInputs; ++i) {
+        getUpstreamNodes(node->getInput(i), nodes);
+    }
+
+    // The image of a group is rendered by the nodes inside
+    NodeGroupPtr isGroup = toNodeGroup( node->getEffectInstance() );
+    if (isGroup) {
+        getUpstreamNodes(isGroup->getOutputNodeInput(), nodes);
+    }
+}
+
+void
+RenderQueuePrivate::takeNextQueuedItems(std::list<RenderQueueItem>* items)
+{
+    if ( renderQueue.empty() ) {
+        return;
+    }
+    const int groupID = renderQueue.front().groupID;
+    items->push_back( renderQueue.front() );
+    renderQueue.pop_front();
+    if (groupID == 0) {
+        return;
+    }
+    for (std::list<RenderQueueItem>::iterator it = renderQueue.begin(); it != renderQueue.end();) {
+        if (it->groupID == groupID) {
+            items->push_back(*it);
+            it = renderQueue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void
+RenderQueuePrivate::renderItems(const std::list<RenderQueueItem>& items)
+{
+    if ( items.empty() ) {
+        return;
+    }
+
+    // Renders in other processes cannot share the images of this process
+    const int groupID = items.front().groupID;
+    if ( (groupID != 0) && (items.size() > 1) && !items.front().process ) {
+        // Count how many writers of the group depend on each node
+        std::map<NodePtr, int> writersCount;
+        for (std::list<RenderQueueItem>::const_iterator it = items.begin(); it != items.end(); ++it) {
+            std::set<NodePtr> upstreamNodes;
+            getUpstreamNodes(it->work.treeRoot, &upstreamNodes);
+            for (std::set<NodePtr>::const_iterator it2 = upstreamNodes.begin(); it2 != upstreamNodes.end(); ++it2) {
+                ++writersCount[*it2];
+            }
+        }
+        std::list<NodeWPtr> sharedNodes;
+        for (std::map<NodePtr, int>::const_iterator it = writersCount.begin(); it != writersCount.end(); ++it) {
+            if (it->second > 1) {
+                it->first->setSharedByConcurrentRenders(true);
+                sharedNodes.push_back(it->first);
+            }
+        }
+        QMutexLocker k(&renderQueueMutex);
+        groupsSharedNodes[groupID] = sharedNodes;
+    }
+
+    // All the writers are started before any frame is rendered so that they pull the shared nodes
+    // at the same frames: the cache computes each image once and the other renders wait for it
+    for (std::list<RenderQueueItem>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        renderInternal(*it);
+    }
+} // renderItems
+
 void
 RenderQueue::onQueuedRenderFinished(int /*retCode*/)
 {
@@ -508,6 +756,27 @@ RenderQueue::onBackgroundRenderProcessFinished()
     }
 }
 
+void
+RenderQueue::onBackgroundRenderFrameAvailableInCache(int frame,
+                                                     int /*view*/)
+{
+    // The background process may only share the cache with us if it is persistent
+    CacheBasePtr cache = appPTR->getTileCache();
+    if ( !cache || !cache->isPersistent() ) {
+        return;
+    }
+    AppInstancePtr app = _imp->getApp();
+    if (!app) {
+        return;
+    }
+
+    // Other frames will be read from the cache when the user seeks to them
+    if (app->getTimeLine()->currentFrame() != frame) {
+        return;
+    }
+    app->renderAllViewers();
+}
+
 void
 RenderQueue::removeRenderFromQueue(const NodePtr& writer)
 {
@@ -524,31 +793,57 @@ RenderQueue::removeRenderFromQueue(const NodePtr& writer)
 void
 RenderQueuePrivate::startNextQueuedRender(const NodePtr& finishedWriter)
 {
-    RenderQueueItem nextWork;
+    std::list<RenderQueueItem> nextItems;
 
     // Do not make the process die under the mutex otherwise we may deadlock
     ProcessHandlerPtr processDying;
+    std::list<NodeWPtr> nodesNoLongerShared;
     {
         QMutexLocker k(&renderQueueMutex);
+        int finishedGroupID = 0;
         for (std::list<RenderQueueItem>::iterator it = activeRenders.begin(); it != activeRenders.end(); ++it) {
             if (it->work.treeRoot == finishedWriter) {
                 processDying = it->process;
+                finishedGroupID = it->groupID;
                 activeRenders.erase(it);
                 activeRendersNotEmptyCond.wakeAll();
                 break;
             }
         }
-        if ( !renderQueue.empty() ) {
-            nextWork = renderQueue.front();
-            renderQueue.pop_front();
-        } else {
-            return;
+
+        if (finishedGroupID != 0) {
+            bool groupFinished = true;
+            for (std::list<RenderQueueItem>::const_iterator it = activeRenders.begin(); it != activeRenders.end(); ++it) {
+                if (it->groupID == finishedGroupID) {
+                    groupFinished = false;
+                    break;
+                }
+            }
+            if (groupFinished) {
+                std::map<int, std::list<NodeWPtr> >::iterator found = groupsSharedNodes.find(finishedGroupID);
+                if ( found != groupsSharedNodes.end() ) {
+                    nodesNoLongerShared.swap(found->second);
+                    groupsSharedNodes.erase(found);
+                }
+            }
+        }
+
+        // The next item starts once the renders of the current one, which may be a group, are all finished
+        if ( activeRenders.empty() ) {
+            takeNextQueuedItems(&nextItems);
         }
     }
     processDying.reset();
 
-    renderInternal(nextWork);
-}
+    for (std::list<NodeWPtr>::const_iterator it = nodesNoLongerShared.begin(); it != nodesNoLongerShared.end(); ++it) {
+        NodePtr node = it->lock();
+        if (node) {
+            node->setSharedByConcurrentRenders(false);
+        }
+    }
+
+    renderItems(nextItems);
+} // startNextQueuedRender
 
 
 
@@ -79,6 +79,15 @@ public:
         // True if this request is a restart of a previous request
         bool isRestart;
 
+        // True if this writer renders at the same time as the other writers passed to the same
+        // renderBlocking/renderNonBlocking call which have it set. This is also enabled for all
+        // writers by the "Render Write nodes concurrently" setting.
+        bool renderConcurrently;
+
+        // True if the frames that the previous render of this writer wrote, according to its checkpoint journal,
+        // must not be rendered again, @see RenderCheckpointJournal. Otherwise the journal is cleared.
+        bool resumeFromCheckpoints;
+
         RenderWork()
         : treeRoot()
         , renderLabel()
@@ -87,6 +96,8 @@ public:
         , frameStep(INT_MIN)
         , useRenderStats(false)
         , isRestart(false)
+        , renderConcurrently(false)
+        , resumeFromCheckpoints(false)
         {
         }
 
@@ -103,6 +114,8 @@ public:
         , frameStep(frameStep)
         , useRenderStats(useRenderStats)
         , isRestart(false)
+        , renderConcurrently(false)
+        , resumeFromCheckpoints(false)
         {
         }
     };
@@ -132,8 +145,17 @@ public:
      **/
     void createRenderRequestsFromCommandLineArgs(const CLArgs& cl, std::list<RenderWork>& requests);
 
+    /**
+     * @brief Set the frame range, the frame step and the label of the given work if they were left to their
+     * default value. Returns false and reports an error if the work is invalid.
+     **/
+    bool validateRenderWork(RenderWork* work);
+
     /**
      * @brief Queues the given write nodes to render. This function will block until all renders are finished.
+     * The writers with RenderWork::renderConcurrently set start together, as a single item of the queue:
+     * the nodes upstream of several of them are cached while they render so that these nodes are computed
+     * once per frame, @see Node::setSharedByConcurrentRenders
      **/
     void renderBlocking(const std::list<RenderWork>& writers);
 
@@ -142,6 +164,17 @@ public:
      **/
     void renderNonBlocking(const std::list<RenderWork>& writers);
 
+    /**
+     * @brief Same as renderNonBlocking() but also returns immediately in background mode. The caller must process the
+     * events of the main thread until hasActiveRenders() returns false, so that the queued renders are started.
+     **/
+    void renderAsync(const std::list<RenderWork>& writers);
+
+    /**
+     * @brief Returns true while a render of the queue is running or queued
+     **/
+    bool hasActiveRenders() const;
+
     /**
      * @brief Remove from the render queue a render that was not yet started. This is useful for the GUI
      * if the user wants to cancel a render request.
@@ -161,6 +194,12 @@ public Q_SLOTS:
      **/
     void onBackgroundRenderProcessFinished();
 
+    /**
+     * @brief Called when a render in another process inserted the images of a frame in the tile cache shared
+     * with this process. The viewers displaying this frame are refreshed: they read the images from the cache.
+     **/
+    void onBackgroundRenderFrameAvailableInCache(int frame, int view);
+
 private:
 
     boost::scoped_ptr<RenderQueuePrivate> _imp;
@@ -25,27 +25,79 @@
 
 #include "RenderStats.h"
 
+#include <algorithm>
 #include <bitset>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
+#include <vector>
 
 #include <QtCore/QMutex>
 
+#include "Engine/EffectInstance.h"
 #include "Engine/Node.h"
 #include "Engine/Timer.h"
+#include "Engine/TreeRender.h"
 #include "Engine/RectI.h"
 #include "Engine/RectD.h"
 
 NATRON_NAMESPACE_ENTER
 
+struct ActionTimes
+{
+    U64 nCalls;
+    double totalTime;
+    double maxTime;
+
+    // The number of calls per bucket, see getActionTimeBucket()
+    U64 histogram[NATRON_RENDER_STATS_ACTION_TIME_BUCKETS];
+
+    ActionTimes()
+    : nCalls(0)
+    , totalTime(0)
+    , maxTime(0)
+    , histogram()
+    {
+
+    }
+};
+
+static int
+getActionTimeBucket(double time)
+{
+    double us = time * 1e6;
+    if (us <= 1.) {
+        return 0;
+    }
+    int bucket = (int)std::ceil(std::log(us) / std::log(2.) * 4.);
+    return std::min(std::max(bucket, 0), NATRON_RENDER_STATS_ACTION_TIME_BUCKETS - 1);
+}
+
+static double
+getActionTimeBucketUpperBound(int bucket)
+{
+    return std::pow(2., bucket / 4.) * 1e-6;
+}
+
 struct NodeRenderStatsPrivate
 {
     //The accumulated time spent in the EffectInstance::renderHandler function
     double totalTimeSpentRendering;
 
+    // The part of totalTimeSpentRendering spent with each backend
+    double timeSpentRenderingPerBackend[3];
+
+    // The time spent converting images between RAM and OpenGL textures
+    double totalTimeSpentTransferring;
+
+    // The calls of the other actions
+    ActionTimes actions[eRenderStatsActionCount];
 
     NodeRenderStatsPrivate()
     : totalTimeSpentRendering(0)
+    , timeSpentRenderingPerBackend()
+    , totalTimeSpentTransferring(0)
+    , actions()
     {
 
     }
@@ -70,12 +122,21 @@ void
 NodeRenderStats::operator=(const NodeRenderStats& other)
 {
     _imp->totalTimeSpentRendering = other._imp->totalTimeSpentRendering;
+    for (int i = 0; i < 3; ++i) {
+        _imp->timeSpentRenderingPerBackend[i] = other._imp->timeSpentRenderingPerBackend[i];
+    }
+    _imp->totalTimeSpentTransferring = other._imp->totalTimeSpentTransferring;
+    for (int i = 0; i < eRenderStatsActionCount; ++i) {
+        _imp->actions[i] = other._imp->actions[i];
+    }
 }
 
 void
-NodeRenderStats::addTimeSpentRendering(double time)
+NodeRenderStats::addTimeSpentRendering(double time, RenderBackendTypeEnum backend)
 {
+    assert(backend <= eRenderBackendTypeOSMesa);
     _imp->totalTimeSpentRendering += time;
+    _imp->timeSpentRenderingPerBackend[backend] += time;
 }
 
 double
@@ -84,6 +145,101 @@ NodeRenderStats::getTotalTimeSpentRendering() const
     return _imp->totalTimeSpentRendering;
 }
 
+double
+NodeRenderStats::getTimeSpentRendering(RenderBackendTypeEnum backend) const
+{
+    assert(backend <= eRenderBackendTypeOSMesa);
+    return _imp->timeSpentRenderingPerBackend[backend];
+}
+
+void
+NodeRenderStats::addTimeSpentTransferring(double time)
+{
+    _imp->totalTimeSpentTransferring += time;
+}
+
+double
+NodeRenderStats::getTotalTimeSpentTransferring() const
+{
+    return _imp->totalTimeSpentTransferring;
+}
+
+void
+NodeRenderStats::addActionCall(RenderStatsActionEnum action, double time)
+{
+    assert(action >= 0 && action < eRenderStatsActionCount);
+    ActionTimes& times = _imp->actions[action];
+    ++times.nCalls;
+    times.totalTime += time;
+    times.maxTime = std::max(times.maxTime, time);
+    ++times.histogram[getActionTimeBucket(time)];
+}
+
+U64
+NodeRenderStats::getActionCallsCount(RenderStatsActionEnum action) const
+{
+    assert(action >= 0 && action < eRenderStatsActionCount);
+    return _imp->actions[action].nCalls;
+}
+
+double
+NodeRenderStats::getTotalTimeSpentInAction(RenderStatsActionEnum action) const
+{
+    assert(action >= 0 && action < eRenderStatsActionCount);
+    return _imp->actions[action].totalTime;
+}
+
+double
+NodeRenderStats::getActionMeanTime(RenderStatsActionEnum action) const
+{
+    assert(action >= 0 && action < eRenderStatsActionCount);
+    const ActionTimes& times = _imp->actions[action];
+    if (times.nCalls == 0) {
+        return 0.;
+    }
+    return times.totalTime / times.nCalls;
+}
+
+double
+NodeRenderStats::getActionTimePercentile(RenderStatsActionEnum action, double percent) const
+{
+    assert(action >= 0 && action < eRenderStatsActionCount);
+    const ActionTimes& times = _imp->actions[action];
+    if (times.nCalls == 0) {
+        return 0.;
+    }
+    U64 rank = (U64)std::ceil(times.nCalls * percent / 100.);
+    U64 count = 0;
+    for (int i = 0; i < NATRON_RENDER_STATS_ACTION_TIME_BUCKETS; ++i) {
+        count += times.histogram[i];
+        if (count >= rank) {
+            // The upper bound of the last bucket is not a bound, and no call took longer than the max anyway
+            return std::min(getActionTimeBucketUpperBound(i), times.maxTime);
+        }
+    }
+    return times.maxTime;
+}
+
+void
+NodeRenderStats::accumulate(const NodeRenderStats& other)
+{
+    _imp->totalTimeSpentRendering += other._imp->totalTimeSpentRendering;
+    for (int i = 0; i < 3; ++i) {
+        _imp->timeSpentRenderingPerBackend[i] += other._imp->timeSpentRenderingPerBackend[i];
+    }
+    _imp->totalTimeSpentTransferring += other._imp->totalTimeSpentTransferring;
+    for (int i = 0; i < eRenderStatsActionCount; ++i) {
+        ActionTimes& times = _imp->actions[i];
+        const ActionTimes& otherTimes = other._imp->actions[i];
+        times.nCalls += otherTimes.nCalls;
+        times.totalTime += otherTimes.totalTime;
+        times.maxTime = std::max(times.maxTime, otherTimes.maxTime);
+        for (int j = 0; j < NATRON_RENDER_STATS_ACTION_TIME_BUCKETS; ++j) {
+            times.histogram[j] += otherTimes.histogram[j];
+        }
+    }
+}
+
 
 struct RenderStatsPrivate
 {
@@ -98,12 +254,22 @@ struct RenderStatsPrivate
     typedef std::map<NodeWPtr, NodeRenderStats > NodeInfosMap;
     NodeInfosMap nodeInfos;
 
+    // Time it took for the render to go idle once aborted, or -1 if it was not aborted
+    double abortLatency;
+
+    // Peak of the memory allocated for the render, valid if hasMemoryPeak is true
+    bool hasMemoryPeak;
+    std::size_t ramPeak, glPeak;
 
     RenderStatsPrivate()
         : lock()
         , totalTimeSpentForFrameTimer()
         , doNodesProfiling(false)
         , nodeInfos()
+        , abortLatency(-1.)
+        , hasMemoryPeak(false)
+        , ramPeak(0)
+        , glPeak(0)
     {
     }
 
@@ -154,14 +320,56 @@ RenderStats::isInDepthProfilingEnabled() const
 
 
 void
-RenderStats::addRenderInfosForNode(const NodePtr& node, double timeSpent)
+RenderStats::addRenderInfosForNode(const NodePtr& node, double timeSpent, RenderBackendTypeEnum backend)
 {
     QMutexLocker k(&_imp->lock);
 
     assert(_imp->doNodesProfiling);
 
     NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
-    stats.addTimeSpentRendering(timeSpent);
+    stats.addTimeSpentRendering(timeSpent, backend);
+}
+
+void
+RenderStats::addTransferInfosForNode(const NodePtr& node, double timeSpent)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addTimeSpentTransferring(timeSpent);
+}
+
+const char*
+NodeRenderStats::getActionName(RenderStatsActionEnum action)
+{
+    switch (action) {
+    case eRenderStatsActionGetRegionOfDefinition:
+        return "getRegionOfDefinition";
+    case eRenderStatsActionIsIdentity:
+        return "isIdentity";
+    case eRenderStatsActionGetFramesNeeded:
+        return "getFramesNeeded";
+    case eRenderStatsActionGetTimeInvariantMetadata:
+        return "getTimeInvariantMetadata";
+    case eRenderStatsActionGetComponents:
+        return "getComponents";
+    case eRenderStatsActionCount:
+        break;
+    }
+    return "";
+}
+
+void
+RenderStats::addActionInfosForNode(const NodePtr& node, RenderStatsActionEnum action, double timeSpent)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addActionCall(action, timeSpent);
 }
 
 std::map<NodePtr, NodeRenderStats >
@@ -182,4 +390,177 @@ RenderStats::getStats(double *totalTimeSpent) const
     return ret;
 }
 
+void
+RenderStats::setAbortLatency(double latency)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->abortLatency = latency;
+}
+
+bool
+RenderStats::getAbortLatency(double* latency) const
+{
+    QMutexLocker k(&_imp->lock);
+    if (_imp->abortLatency < 0) {
+        return false;
+    }
+    *latency = _imp->abortLatency;
+    return true;
+}
+
+void
+RenderStats::setMemoryPeak(std::size_t ramBytes, std::size_t glBytes)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->hasMemoryPeak = true;
+    _imp->ramPeak = ramBytes;
+    _imp->glPeak = glBytes;
+}
+
+bool
+RenderStats::getMemoryPeak(std::size_t* ramBytes, std::size_t* glBytes) const
+{
+    QMutexLocker k(&_imp->lock);
+    if (!_imp->hasMemoryPeak) {
+        return false;
+    }
+    *ramBytes = _imp->ramPeak;
+    *glBytes = _imp->glPeak;
+    return true;
+}
+
+struct RenderStatsAccumulatorPrivate
+{
+    mutable QMutex lock;
+    bool enabled;
+    int framesCount;
+    double wallTime;
+    std::size_t ramPeak, glPeak;
+    RenderStatsAccumulator::NodeStatsMap nodes;
+
+    RenderStatsAccumulatorPrivate()
+        : lock()
+        , enabled(false)
+        , framesCount(0)
+        , wallTime(0)
+        , ramPeak(0)
+        , glPeak(0)
+        , nodes()
+    {
+    }
+};
+
+RenderStatsAccumulator::NodeStats::NodeStats()
+    : pluginID()
+    , framesCount(0)
+    , stats()
+{
+}
+
+RenderStatsAccumulator::RenderStatsAccumulator()
+    : _imp( new RenderStatsAccumulatorPrivate() )
+{
+}
+
+RenderStatsAccumulator::~RenderStatsAccumulator()
+{
+}
+
+void
+RenderStatsAccumulator::setEnabled(bool enabled)
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->enabled = enabled;
+}
+
+bool
+RenderStatsAccumulator::isEnabled() const
+{
+    QMutexLocker k(&_imp->lock);
+    return _imp->enabled;
+}
+
+void
+RenderStatsAccumulator::addFrame(const RenderStats& stats)
+{
+    double wallTime = 0.;
+    std::map<NodePtr, NodeRenderStats > frameStats = stats.getStats(&wallTime);
+    std::size_t ramPeak = 0, glPeak = 0;
+    stats.getMemoryPeak(&ramPeak, &glPeak);
+
+    // Get the names outside of the lock, they take the lock of the node
+    std::vector<std::pair<std::string, std::string> > names;
+    for (std::map<NodePtr, NodeRenderStats >::const_iterator it = frameStats.begin(); it != frameStats.end(); ++it) {
+        names.push_back( std::make_pair( it->first->getFullyQualifiedName(), it->first->getPluginID() ) );
+    }
+
+    QMutexLocker k(&_imp->lock);
+    if (!_imp->enabled) {
+        return;
+    }
+    ++_imp->framesCount;
+    _imp->wallTime += wallTime;
+    _imp->ramPeak = std::max(_imp->ramPeak, ramPeak);
+    _imp->glPeak = std::max(_imp->glPeak, glPeak);
+    std::size_t i = 0;
+    for (std::map<NodePtr, NodeRenderStats >::const_iterator it = frameStats.begin(); it != frameStats.end(); ++it, ++i) {
+        NodeStats& nodeStats = _imp->nodes[names[i].first];
+        nodeStats.pluginID = names[i].second;
+        ++nodeStats.framesCount;
+        nodeStats.stats.accumulate(it->second);
+    }
+}
+
+void
+RenderStatsAccumulator::getStats(int* framesCount,
+                                 double* wallTime,
+                                 std::size_t* ramPeak,
+                                 std::size_t* glPeak,
+                                 NodeStatsMap* nodes) const
+{
+    QMutexLocker k(&_imp->lock);
+    *framesCount = _imp->framesCount;
+    *wallTime = _imp->wallTime;
+    *ramPeak = _imp->ramPeak;
+    *glPeak = _imp->glPeak;
+    *nodes = _imp->nodes;
+}
+
+void
+RenderStatsAccumulator::reset()
+{
+    QMutexLocker k(&_imp->lock);
+    _imp->framesCount = 0;
+    _imp->wallTime = 0;
+    _imp->ramPeak = 0;
+    _imp->glPeak = 0;
+    _imp->nodes.clear();
+}
+
+RenderStatsActionTimer_RAII::RenderStatsActionTimer_RAII(const EffectInstance* effect, RenderStatsActionEnum action)
+    : _stats()
+    , _node()
+    , _action(action)
+    , _timer()
+{
+    TreeRenderPtr render = effect->getCurrentRender();
+    if (!render) {
+        return;
+    }
+    RenderStatsPtr stats = render->getStatsObject();
+    if (!stats || !stats->isInDepthProfilingEnabled()) {
+        return;
+    }
+    _stats = stats;
+    _node = effect->getNode();
+    _timer.reset(new TimeLapse);
+}
+
+RenderStatsActionTimer_RAII::~RenderStatsActionTimer_RAII()
+{
+    if (_timer && _node) {
+        _stats->addActionInfosForNode(_node, _action, _timer->getTimeSinceCreation());
+    }
+}
+
 NATRON_NAMESPACE_EXIT
@@ -28,6 +28,7 @@
 
 #include "Global/Macros.h"
 
+#include <cstddef>
 #include <list>
 #include <map>
 #include <set>
@@ -48,8 +49,24 @@
 
 #include "Engine/EngineFwd.h"
 
+// The action times are counted in buckets of a quarter of a power of 2 microseconds, up to about 2^24 us
+#define NATRON_RENDER_STATS_ACTION_TIME_BUCKETS 96
+
 NATRON_NAMESPACE_ENTER
 
+/**
+ * @brief The actions other than render whose calls are timed for each node when in-depth profiling is enabled
+ **/
+enum RenderStatsActionEnum
+{
+    eRenderStatsActionGetRegionOfDefinition = 0,
+    eRenderStatsActionIsIdentity,
+    eRenderStatsActionGetFramesNeeded,
+    eRenderStatsActionGetTimeInvariantMetadata,
+    eRenderStatsActionGetComponents,
+    eRenderStatsActionCount
+};
+
 /**
  * @brief Holds render infos for one frame for one node. Not MT-safe: MT-safety is handled by RenderStats.
  **/
@@ -66,9 +83,45 @@ public:
 
     void operator=(const NodeRenderStats& other);
 
-    void addTimeSpentRendering(double time);
+    void addTimeSpentRendering(double time, RenderBackendTypeEnum backend);
     double getTotalTimeSpentRendering() const;
 
+    /**
+     * @brief Returns the time spent rendering with the given backend, included in getTotalTimeSpentRendering()
+     **/
+    double getTimeSpentRendering(RenderBackendTypeEnum backend) const;
+
+    /**
+     * @brief The time spent to move images of this node between the RAM and OpenGL textures
+     **/
+    void addTimeSpentTransferring(double time);
+    double getTotalTimeSpentTransferring() const;
+
+    /**
+     * @brief Account for one call of the given action that took the given time in seconds
+     **/
+    void addActionCall(RenderStatsActionEnum action, double time);
+
+    U64 getActionCallsCount(RenderStatsActionEnum action) const;
+    double getTotalTimeSpentInAction(RenderStatsActionEnum action) const;
+    double getActionMeanTime(RenderStatsActionEnum action) const;
+
+    /**
+     * @brief Returns the time in seconds below which are the given percentage of the calls of the action.
+     * This is the upper bound of a histogram bucket, so it is accurate to about 20%.
+     **/
+    double getActionTimePercentile(RenderStatsActionEnum action, double percent) const;
+
+    /**
+     * @brief Adds the render times and the action calls of other to these stats, e.g. to accumulate several frames
+     **/
+    void accumulate(const NodeRenderStats& other);
+
+    /**
+     * @brief Returns the name of the action as it appears in the reports, e.g. "getRegionOfDefinition"
+     **/
+    static const char* getActionName(RenderStatsActionEnum action);
+
 
 private:
 
@@ -93,15 +146,114 @@ public:
 
     bool isInDepthProfilingEnabled() const;
 
-    void addRenderInfosForNode(const NodePtr& node, double timeSpent);
+    void addRenderInfosForNode(const NodePtr& node, double timeSpent, RenderBackendTypeEnum backend);
+
+    /**
+     * @brief Account for the time spent by the given node to convert images between the RAM and OpenGL textures.
+     **/
+    void addTransferInfosForNode(const NodePtr& node, double timeSpent);
+
+    /**
+     * @brief Account for one call of the given action by the given node that took timeSpent seconds.
+     **/
+    void addActionInfosForNode(const NodePtr& node, RenderStatsActionEnum action, double timeSpent);
 
     std::map<NodePtr, NodeRenderStats > getStats(double *totalTimeSpent) const;
 
+    /**
+     * @brief Set when the render of the frame was aborted: this is the time in seconds it took to go idle after the abort.
+     **/
+    void setAbortLatency(double latency);
+
+    /**
+     * @brief Returns true if the render of the frame was aborted, in which case the time it took to go idle is returned in latency.
+     **/
+    bool getAbortLatency(double* latency) const;
+
+    /**
+     * @brief Set when the render of the frame is finished: this is the peak of the memory in bytes allocated by all nodes
+     * for this render, in RAM and in OpenGL textures.
+     **/
+    void setMemoryPeak(std::size_t ramBytes, std::size_t glBytes);
+
+    /**
+     * @brief Returns true if the memory peak of the render was recorded
+     **/
+    bool getMemoryPeak(std::size_t* ramBytes, std::size_t* glBytes) const;
+
 private:
 
     boost::scoped_ptr<RenderStatsPrivate> _imp;
 };
 
+/**
+ * @brief Accumulates the stats of the frames rendered with in-depth profiling across renders, e.g. for the Python API.
+ * Nodes are identified by their fully qualified name so that the stats do not hold them. This class is MT-safe.
+ **/
+struct RenderStatsAccumulatorPrivate;
+class RenderStatsAccumulator
+{
+public:
+
+    struct NodeStats
+    {
+        std::string pluginID;
+
+        // The number of frames in which the node rendered or was called
+        int framesCount;
+        NodeRenderStats stats;
+
+        NodeStats();
+    };
+
+    typedef std::map<std::string, NodeStats> NodeStatsMap;
+
+    RenderStatsAccumulator();
+
+    ~RenderStatsAccumulator();
+
+    /**
+     * @brief When enabled, the renders are requested with in-depth profiling and their stats are accumulated.
+     **/
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    /**
+     * @brief Adds the stats of a frame render, if enabled
+     **/
+    void addFrame(const RenderStats& stats);
+
+    /**
+     * @brief Returns the stats accumulated since the last reset: the number of frames, the sum of their wall-clock times
+     * and the highest memory peak of a frame
+     **/
+    void getStats(int* framesCount, double* wallTime, std::size_t* ramPeak, std::size_t* glPeak, NodeStatsMap* nodes) const;
+
+    void reset();
+
+private:
+
+    boost::scoped_ptr<RenderStatsAccumulatorPrivate> _imp;
+};
+
+/**
+ * @brief Times an action call of an effect for the lifetime of this object and accounts for it in the stats of the render
+ * the effect belongs to. Nothing is recorded if the effect is not a render clone or the render does not have in-depth profiling enabled.
+ **/
+class RenderStatsActionTimer_RAII
+{
+    RenderStatsPtr _stats;
+    NodePtr _node;
+    RenderStatsActionEnum _action;
+    TimeLapsePtr _timer;
+
+public:
+
+    RenderStatsActionTimer_RAII(const EffectInstance* effect, RenderStatsActionEnum action);
+
+    ~RenderStatsActionTimer_RAII();
+};
+
 NATRON_NAMESPACE_EXIT
 
 
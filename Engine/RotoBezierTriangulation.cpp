@@ -33,6 +33,11 @@
 
 #include "libtess.h"
 
+#include "Engine/BezierCP.h"
+#include "Engine/Hash64.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Transform.h"
+
 using boost::uintptr_t;
 using std::size_t;
 using std::vector;
@@ -917,6 +922,31 @@ static void computeInternalPolygon(PolygonCSGData& data, bool clockWise, RotoBez
         }
     }
 
+    // Merge all primitives into a single list of triangles
+    {
+        std::vector<unsigned int>& merged = outArgs->internalShapeMergedTriangles;
+        merged.clear();
+        for (std::size_t i = 0; i < outArgs->internalShapeTriangles.size(); ++i) {
+            merged.insert(merged.end(), outArgs->internalShapeTriangles[i].begin(), outArgs->internalShapeTriangles[i].end());
+        }
+        for (std::size_t i = 0; i < outArgs->internalShapeTriangleFans.size(); ++i) {
+            const std::vector<unsigned int>& fan = outArgs->internalShapeTriangleFans[i];
+            for (std::size_t j = 2; j < fan.size(); ++j) {
+                merged.push_back(fan[0]);
+                merged.push_back(fan[j - 1]);
+                merged.push_back(fan[j]);
+            }
+        }
+        for (std::size_t i = 0; i < outArgs->internalShapeTriangleStrips.size(); ++i) {
+            const std::vector<unsigned int>& strip = outArgs->internalShapeTriangleStrips[i];
+            for (std::size_t j = 2; j < strip.size(); ++j) {
+                // Keep the orientation of the triangles of the strip
+                merged.push_back(strip[(j % 2) ? j - 1 : j - 2]);
+                merged.push_back(strip[(j % 2) ? j - 2 : j - 1]);
+                merged.push_back(strip[j]);
+            }
+        }
+    }
 
 } // computeInternalPolygon
 
@@ -1188,14 +1218,14 @@ RotoBezierTriangulation::tesselate(const BezierPtr& bezier,
 #ifndef NDEBUG
     RectD featherBbox;
 #endif
-    bezier->evaluateFeatherPointsAtTime(true /*applyFeatherDistance*/, time, view, scale, Bezier::eDeCasteljauAlgorithmIterative, -1, 1., &featherPolygonOrig,
+    bezier->evaluateFeatherPointsAtTime(true /*applyFeatherDistance*/, time, view, scale, Bezier::eDeCasteljauAlgorithmRecursive, -1, 1., &featherPolygonOrig,
 #ifndef NDEBUG
                                         &featherBbox
 #else
                                         0
 #endif
                                         );
-    bezier->evaluateAtTime(time, view, scale, Bezier::eDeCasteljauAlgorithmIterative, -1, 1., &bezierPolygonOrig,
+    bezier->evaluateAtTime(time, view, scale, Bezier::eDeCasteljauAlgorithmRecursive, -1, 1., &bezierPolygonOrig,
 #ifndef NDEBUG
                            &data.bezierBbox
 #else
@@ -1233,4 +1263,50 @@ RotoBezierTriangulation::tesselate(const BezierPtr& bezier,
 
 
 
+U64
+RotoBezierTriangulation::getTesselationHash(const BezierPtr& bezier,
+                                            TimeValue time,
+                                            ViewIdx view,
+                                            const RenderScale& scale)
+{
+    Hash64 hash;
+
+    hash.append(scale.x);
+    hash.append(scale.y);
+    hash.append(bezier->isOpenBezier());
+    hash.append(bezier->isCurveFinished(view));
+
+    Transform::Matrix3x3 transform;
+    bezier->getTransformAtTime(time, view, &transform);
+    for (int i = 0; i < 9; ++i) {
+        hash.append(transform.m[i]);
+    }
+
+    KnobDoublePtr featherKnob = bezier->getFeatherKnob();
+    hash.append(featherKnob ? featherKnob->getValueAtTime(time) : 0.);
+
+    std::list<BezierCPPtr> cps = bezier->getControlPoints(view);
+    std::list<BezierCPPtr> fps = bezier->getFeatherPoints(view);
+    hash.append(cps.size());
+    hash.append(fps.size());
+    for (int list = 0; list < 2; ++list) {
+        const std::list<BezierCPPtr>& points = list == 0 ? cps : fps;
+        for (std::list<BezierCPPtr>::const_iterator it = points.begin(); it != points.end(); ++it) {
+            double x, y, lx, ly, rx, ry;
+            (*it)->getPositionAtTime(time, &x, &y);
+            (*it)->getLeftBezierPointAtTime(time, &lx, &ly);
+            (*it)->getRightBezierPointAtTime(time, &rx, &ry);
+            hash.append(x);
+            hash.append(y);
+            hash.append(lx);
+            hash.append(ly);
+            hash.append(rx);
+            hash.append(ry);
+        }
+    }
+
+    hash.computeHash();
+    return hash.value();
+} // getTesselationHash
+
 NATRON_NAMESPACE_EXIT
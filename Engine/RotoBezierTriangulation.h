@@ -79,6 +79,9 @@ public:
 
         // The actual primitives to render. They correspond to GL_TRIANGLES, GL_TRIANGLE_FAN, GL_TRIANGLE_STRIP
         std::vector<std::vector<unsigned int> > internalShapeTriangles, internalShapeTriangleFans, internalShapeTriangleStrips;
+
+        // All the primitives above converted to GL_TRIANGLES so that the internal shape can be rendered with a single draw call
+        std::vector<unsigned int> internalShapeMergedTriangles;
     
     };
 
@@ -87,6 +90,14 @@ public:
      **/
     static void tesselate(const BezierPtr& bezier, TimeValue time, ViewIdx view, const RenderScale& scale, PolygonData* outArgs);
 
+    /**
+     * @brief Returns a hash of everything tesselate() reads from the given Bezier at the given view and time and scale:
+     * tesselate() produces the same triangulation for two calls with the same hash.
+     * Unlike the hash of the Bezier, this does not depend on the knobs that only affect the rendering (color, opacity...) nor on the time
+     * if the shape is not animated.
+     **/
+    static U64 getTesselationHash(const BezierPtr& bezier, TimeValue time, ViewIdx view, const RenderScale& scale);
+
 };
 
 NATRON_NAMESPACE_EXIT
@@ -26,6 +26,7 @@
 #include "RotoDrawableItem.h"
 
 #include <algorithm> // min, max
+#include <cmath>
 #include <sstream>
 #include <locale>
 #include <limits>
@@ -75,6 +76,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #define kRotoDrawableItemRightClickMenuPlanarTrackParam "planarTrack"
 #define kRotoDrawableItemRightClickMenuPlanarTrackParamLabel "Planar-Track"
 
+// The number of intervals of the shutter range along which the motion of an item is measured for adaptive motion-blur
+#define ROTO_MOTION_BLUR_ADAPTIVE_PROBES 4
+
+// With adaptive motion-blur, the distance travelled by an item between 2 samples, in pixels at full resolution
+#define ROTO_MOTION_BLUR_ADAPTIVE_PIXELS_PER_SAMPLE 1.
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -133,6 +140,8 @@ public:
     // Motion blur
     KnobChoiceWPtr motionBlurTypeKnob;
     KnobIntWPtr motionBlurAmount;
+    KnobBoolWPtr motionBlurAdaptive;
+    KnobIntWPtr motionBlurMinSamples;
     KnobDoubleWPtr motionBlurShutter;
     KnobChoiceWPtr motionBlurShutterType;
     KnobDoubleWPtr motionBlurCustomShutter;
@@ -527,6 +536,8 @@ RotoDrawableItem::createNodes(bool connectNodes)
             assert(ok);
             ok = _imp->maskNode->getKnobByName(kRotoClipToFormatParam)->linkTo(rotoPaintEffect->getClipToFormatKnob());
             assert(ok);
+            ok = _imp->maskNode->getKnobByName(kRotoDraftCoarseMasksParam)->linkTo(rotoPaintEffect->getDraftCoarseMasksKnob());
+            assert(ok);
 
             (void)ok;
         }
@@ -1368,6 +1379,75 @@ RotoDrawableItem::getMotionBlurSettings(const TimeValue time,
             break;
     }
 
+    KnobBoolPtr adaptiveKnob = _imp->motionBlurAdaptive.lock();
+    if (*divisions > 1 && adaptiveKnob && adaptiveKnob->getValueAtTime(time, DimIdx(0), view)) {
+        int minDivisions = _imp->motionBlurMinSamples.lock()->getValueAtTime(time, DimIdx(0), view);
+        *divisions = getAdaptiveMotionBlurDivisions(view, *range, std::max(1, std::min(minDivisions, *divisions)), *divisions);
+    }
+
+} // getMotionBlurSettings
+
+int
+RotoDrawableItem::getAdaptiveMotionBlurDivisions(ViewIdx view,
+                                                 const RangeD& range,
+                                                 int minDivisions,
+                                                 int maxDivisions) const
+{
+    // Follow the reference points along the shutter interval to measure how far they travel
+    std::vector<Point> prevPoints, points;
+    std::vector<double> distances;
+    for (int i = 0; i <= ROTO_MOTION_BLUR_ADAPTIVE_PROBES; ++i) {
+        TimeValue t(range.min + (range.max - range.min) * i / ROTO_MOTION_BLUR_ADAPTIVE_PROBES);
+        points.clear();
+        getMotionBlurReferencePoints(t, view, &points);
+        if ( points.empty() || (i > 0 && points.size() != prevPoints.size()) ) {
+            // The item cannot be followed, do not degrade the motion-blur
+            return maxDivisions;
+        }
+        if (i == 0) {
+            distances.resize(points.size(), 0.);
+        } else {
+            for (std::size_t j = 0; j < points.size(); ++j) {
+                double dx = points[j].x - prevPoints[j].x;
+                double dy = points[j].y - prevPoints[j].y;
+                distances[j] += std::sqrt(dx * dx + dy * dy);
+            }
+        }
+        prevPoints.swap(points);
+    }
+
+    double maxDistance = 0.;
+    for (std::size_t j = 0; j < distances.size(); ++j) {
+        maxDistance = std::max(maxDistance, distances[j]);
+    }
+
+    // One sample per pixel travelled at full resolution
+    double nSamples = std::ceil(maxDistance / ROTO_MOTION_BLUR_ADAPTIVE_PIXELS_PER_SAMPLE) + 1;
+    if ( nSamples >= maxDivisions ) {
+        return maxDivisions;
+    }
+    return std::max(minDivisions, (int)nSamples);
+} // getAdaptiveMotionBlurDivisions
+
+void
+RotoDrawableItem::getMotionBlurReferencePoints(TimeValue time,
+                                               ViewIdx view,
+                                               std::vector<Point>* points) const
+{
+    RectD bbox = getBoundingBox(time, view);
+    if ( bbox.isNull() ) {
+        return;
+    }
+    Point p;
+    p.x = bbox.x1;
+    p.y = bbox.y1;
+    points->push_back(p);
+    p.x = bbox.x2;
+    points->push_back(p);
+    p.y = bbox.y2;
+    points->push_back(p);
+    p.x = bbox.x1;
+    points->push_back(p);
 }
 
 RectD
@@ -1464,6 +1544,8 @@ RotoDrawableItem::fetchRenderCloneKnobs()
     if (type == eRotoStrokeTypeSolid) {
         _imp->motionBlurTypeKnob = getKnobByNameAndType<KnobChoice>(kRotoMotionBlurModeParam);
         _imp->motionBlurAmount = getKnobByNameAndType<KnobInt>(kRotoPerShapeMotionBlurParam);
+        _imp->motionBlurAdaptive = getKnobByNameAndType<KnobBool>(kRotoPerShapeMotionBlurAdaptiveParam);
+        _imp->motionBlurMinSamples = getKnobByNameAndType<KnobInt>(kRotoPerShapeMotionBlurMinSamplesParam);
         _imp->motionBlurShutter = getKnobByNameAndType<KnobDouble>(kRotoPerShapeShutterParam);
         _imp->motionBlurShutterType = getKnobByNameAndType<KnobChoice>(kRotoPerShapeShutterOffsetTypeParam);
         _imp->motionBlurCustomShutter = getKnobByNameAndType<KnobDouble>(kRotoPerShapeShutterCustomOffsetParam);
@@ -1636,6 +1718,8 @@ RotoDrawableItem::initializeKnobs()
         }
 
         _imp->motionBlurAmount = createDuplicateOfTableKnob<KnobInt>(kRotoPerShapeMotionBlurParam);
+        _imp->motionBlurAdaptive = createDuplicateOfTableKnob<KnobBool>(kRotoPerShapeMotionBlurAdaptiveParam);
+        _imp->motionBlurMinSamples = createDuplicateOfTableKnob<KnobInt>(kRotoPerShapeMotionBlurMinSamplesParam);
         _imp->motionBlurShutter = createDuplicateOfTableKnob<KnobDouble>(kRotoPerShapeShutterParam);
         _imp->motionBlurShutterType = createDuplicateOfTableKnob<KnobChoice>(kRotoPerShapeShutterOffsetTypeParam);
         _imp->motionBlurCustomShutter = createDuplicateOfTableKnob<KnobDouble>(kRotoPerShapeShutterCustomOffsetParam);
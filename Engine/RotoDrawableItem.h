@@ -31,6 +31,7 @@
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
@@ -190,11 +191,22 @@ public:
     KnobChoicePtr getMotionBlurModeKnob() const;
 
 
+    /**
+     * @brief Returns the shutter range and the number of motion-blur samples of the item at the given time.
+     * When adaptive samples are enabled, the number of samples depends on how far the item moves during the shutter range.
+     **/
     void getMotionBlurSettings(const TimeValue time,
                                ViewIdx view,
                                RangeD* range,
                                int* divisions) const;
 
+    /**
+     * @brief Returns points of the item in canonical coordinates, transform applied, that are followed along the shutter range
+     * to measure how far the item moves. The same points must be returned at all times.
+     * The default implementation returns the corners of the bounding box.
+     **/
+    virtual void getMotionBlurReferencePoints(TimeValue time, ViewIdx view, std::vector<Point>* points) const;
+
     void setKeyframeOnAllTransformParameters(TimeValue time);
 
     virtual RectD getBoundingBox(TimeValue time, ViewIdx view) const = 0;
@@ -247,6 +259,8 @@ private:
 
     virtual void onItemInsertedInModel() OVERRIDE FINAL;
 
+    int getAdaptiveMotionBlurDivisions(ViewIdx view, const RangeD& range, int minDivisions, int maxDivisions) const;
+
     boost::scoped_ptr<RotoDrawableItemPrivate> _imp;
 };
 
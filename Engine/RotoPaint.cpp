@@ -1125,11 +1125,34 @@ RotoPaint::initMotionBlurPageKnobs()
         param->setDefaultValue(1);
         param->setRange(1, INT_MAX);
         param->setDisplayRange(1, 10);
+        param->setAddNewLine(false);
         mbPage->addKnob(param);
         _imp->knobsTable->addPerItemKnobMaster(param);
         _imp->motionBlurKnob = param;
     }
 
+    {
+        KnobBoolPtr param = createKnob<KnobBool>(kRotoPerShapeMotionBlurAdaptiveParam);
+        param->setLabel(tr(kRotoMotionBlurAdaptiveParamLabel));
+        param->setHintToolTip( tr(kRotoMotionBlurAdaptiveParamHint) );
+        param->setDefaultValue(false);
+        mbPage->addKnob(param);
+        _imp->knobsTable->addPerItemKnobMaster(param);
+        _imp->motionBlurAdaptiveKnob = param;
+    }
+
+    {
+        KnobIntPtr param = createKnob<KnobInt>(kRotoPerShapeMotionBlurMinSamplesParam);
+        param->setLabel(tr(kRotoMotionBlurMinSamplesParamLabel));
+        param->setHintToolTip( tr(kRotoMotionBlurMinSamplesParamHint) );
+        param->setDefaultValue(1);
+        param->setRange(1, INT_MAX);
+        param->setDisplayRange(1, 10);
+        mbPage->addKnob(param);
+        _imp->knobsTable->addPerItemKnobMaster(param);
+        _imp->motionBlurMinSamplesKnob = param;
+    }
+
     {
         KnobDoublePtr param = createKnob<KnobDouble>(kRotoPerShapeShutterParam);
         param->setLabel(tr(kRotoShutterParamLabel));
@@ -2855,6 +2878,12 @@ RotoPaint::getClipToFormatKnob() const
     return _imp->clipToFormatKnob.lock();
 }
 
+KnobBoolPtr
+RotoPaint::getDraftCoarseMasksKnob() const
+{
+    return _imp->draftCoarseMasksKnob.lock();
+}
+
 
 void
 RotoPaint::initializeKnobs()
@@ -3001,6 +3030,14 @@ RotoPaint::initializeKnobs()
             generalPage->addKnob(param);
             _imp->clipToFormatKnob = param;
         }
+        {
+            KnobBoolPtr param = createKnob<KnobBool>(kRotoDraftCoarseMasksParam);
+            param->setLabel(tr(kRotoDraftCoarseMasksParamLabel));
+            param->setHintToolTip(tr(kRotoDraftCoarseMasksParamHint));
+            param->setDefaultValue(false);
+            generalPage->addKnob(param);
+            _imp->draftCoarseMasksKnob = param;
+        }
         {
             KnobIntPtr param = createKnob<KnobInt>(kRotoFormatSize, 2);
             param->setSecret(true);
@@ -3373,6 +3410,8 @@ RotoPaintPrivate::refreshMotionBlurKnobsVisibility()
     }
     RotoMotionBlurModeEnum mbType = (RotoMotionBlurModeEnum)motionBlurTypeKnob.lock()->getValue();
     motionBlurKnob.lock()->setSecret(mbType != eRotoMotionBlurModePerShape);
+    motionBlurAdaptiveKnob.lock()->setSecret(mbType != eRotoMotionBlurModePerShape);
+    motionBlurMinSamplesKnob.lock()->setSecret(mbType != eRotoMotionBlurModePerShape);
     shutterKnob.lock()->setSecret(mbType != eRotoMotionBlurModePerShape);
     shutterTypeKnob.lock()->setSecret(mbType != eRotoMotionBlurModePerShape);
     customOffsetKnob.lock()->setSecret(mbType != eRotoMotionBlurModePerShape);
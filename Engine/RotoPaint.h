@@ -58,6 +58,13 @@ NATRON_NAMESPACE_ENTER
 #define kRotoClipToFormatParamLabel "Clip To Format"
 #define kRotoClipToFormatParamHint "When checked, the output image size is clipped to the format, unless no source is connected and the Output Format is set to Default"
 
+#define kRotoDraftCoarseMasksParam "draftCoarseMasks"
+#define kRotoDraftCoarseMasksParamLabel "Coarse Masks In Draft"
+#define kRotoDraftCoarseMasksParamHint "When checked, shapes rendered in draft mode (e.g. while scrubbing the timeline or moving points) " \
+"are first rasterized at a lower resolution: only the parts of the image close to the edges and the feather are rasterized at full resolution, " \
+"the interior and the exterior of the shapes are filled from the low resolution image. This is much faster on large images, " \
+"but details smaller than a few pixels may be missing until the full quality image is rendered. This is only used by the Cairo renderer on CPU."
+
 
 #define kRotoOutputRodType "outputFormatType"
 #define kRotoOutputRodTypeLabel "Output Format"
@@ -386,7 +393,17 @@ enum RotoMotionBlurModeEnum
 #define kRotoGlobalMotionBlurParam "globalMotionBlur"
 #define kRotoMotionBlurParamLabel "Motion Blur"
 #define kRotoMotionBlurParamHint "The number of time samples used for blurring along the shutter time. Increase for better quality but slower rendering.\n" \
-"Set this parameter to 1 or the Shutter parameter to 0 to disable motion-blur."
+"Set this parameter to 1 or the Shutter parameter to 0 to disable motion-blur.\n" \
+"When Adaptive Samples is checked, this is the maximum number of samples of each shape."
+
+#define kRotoPerShapeMotionBlurAdaptiveParam "motionBlurAdaptive"
+#define kRotoMotionBlurAdaptiveParamLabel "Adaptive Samples"
+#define kRotoMotionBlurAdaptiveParamHint "When checked, the number of samples of each shape depends on how far it moves during the shutter time: " \
+"about one sample per pixel of motion, between Min Samples and the Motion Blur parameter. Static or slow shapes render much faster."
+
+#define kRotoPerShapeMotionBlurMinSamplesParam "motionBlurMinSamples"
+#define kRotoMotionBlurMinSamplesParamLabel "Min Samples"
+#define kRotoMotionBlurMinSamplesParamHint "When Adaptive Samples is checked, the number of samples used for a shape that barely moves during the shutter time."
 
 #define kRotoPerShapeShutterParam "motionBlurShutter"
 #define kRotoGlobalShutterParam "globalMotionBlurShutter"
@@ -554,6 +571,8 @@ public:
 
     KnobBoolPtr getClipToFormatKnob() const;
 
+    KnobBoolPtr getDraftCoarseMasksKnob() const;
+
     void refreshSourceKnobs(const RotoDrawableItemPtr& item);
 
     void getMergeChoices(std::vector<ChoiceOption>* aInput, std::vector<ChoiceOption>* maskInput) const;
@@ -35,6 +35,7 @@
 #include "Engine/MergingEnum.h"
 #include "Engine/Node.h"
 #include "Engine/OSGLFunctions.h"
+#include "Engine/Hash64.h"
 #include "Engine/OverlaySupport.h"
 #include "Engine/RotoPoint.h"
 #include "Engine/RotoStrokeItem.h"
@@ -98,7 +99,7 @@ void
 RotoPaintInteract::autoSaveAndRedraw()
 {
     redraw();
-    _imp->publicInterface->getApp()->triggerAutoSave();
+    _imp->publicInterface->getApp()->triggerAutoSave( _imp->publicInterface->getNode() );
 }
 
 bool
@@ -1812,6 +1813,19 @@ RotoPaintInteract::removeCurve(const RotoDrawableItemPtr& curve)
     _imp->knobsTable->removeItem(curve, eTableChangeReasonViewer);
 }
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// A selected control point whose tangents are drawn after the other control points
+struct SelectedCpToDraw
+{
+    BezierCPPtr cp;
+    double x, y;
+    Transform::Matrix3x3 transform;
+    double color[3];
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 void
 RotoPaintInteract::drawOverlay(TimeValue time,
                                const RenderScale & /*renderScale*/,
@@ -1839,6 +1853,50 @@ RotoPaintInteract::drawOverlay(TimeValue time,
 
         double cpWidth = kControlPointMidSize * 2;
         GL_GPU::PointSize(cpWidth);
+
+        // The curves only depend on the items, not on the viewport nor on the selected control points:
+        // evaluate them again only when one of the items changed.
+        U64 curvesKey;
+        {
+            HashableObject::ComputeHashArgs hashArgs;
+            hashArgs.time = time;
+            hashArgs.view = view;
+            hashArgs.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+
+            Hash64 hash;
+            hash.append( (double)time );
+            hash.append( (int)view );
+            hash.append(featherVisible);
+            hash.append(selectedTool == eRotoToolSelectAll);
+            for (std::list<RotoDrawableItemPtr>::const_iterator it = drawables.begin(); it != drawables.end(); ++it) {
+                if ( !(*it)->isGloballyActivated() ) {
+                    continue;
+                }
+                hash.append( (*it)->computeHash(hashArgs) );
+                hash.append( (*it)->isLockedRecursive() );
+                hash.append( _imp->knobsTable->isItemSelected(*it) );
+                KnobColorPtr overlayColorKnob = (*it)->getOverlayColorKnob();
+                for (int i = 0; i < 4; ++i) {
+                    hash.append( overlayColorKnob->getValue( DimIdx(i) ) );
+                }
+            }
+            hash.computeHash();
+            curvesKey = hash.value();
+        }
+        bool recordCurves = curvesDrawList.beginRecording(curvesKey);
+        if (recordCurves) {
+            curvesDrawList.setLineWidth(1.5);
+        }
+
+        // The control points are recorded on each redraw since they depend on the selection and the pixel scale,
+        // but they are still drawn with a few draw calls. The tangents of the selected points are drawn afterwards.
+        controlPointsDrawList.beginRecording(0);
+        controlPointsDrawList.setLineWidth(1.5);
+        controlPointsDrawList.setPointSize(cpWidth);
+
+        std::vector<SelectedCpToDraw> selectedCpsToDraw;
+        double cpColor[3] = {0.85, 0.67, 0.};
+
         for (std::list<RotoDrawableItemPtr>::const_iterator it = drawables.begin(); it != drawables.end(); ++it) {
 
             if ( !(*it)->isGloballyActivated() ) {
@@ -1854,7 +1912,7 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                 }
 
                 bool selected = _imp->knobsTable->isItemSelected(isStroke);
-                if (!selected) {
+                if (!selected || !recordCurves) {
                     continue;
                 }
 
@@ -1869,14 +1927,14 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                     overlayColor.b = overlayColorKnob->getValue( DimIdx(2) );
                     overlayColor.a = overlayColorKnob->getValue( DimIdx(3) );
                 }
-                GL_GPU::Color4d(overlayColor.r, overlayColor.g, overlayColor.b, overlayColor.a);
+                curvesDrawList.setColor(overlayColor.r, overlayColor.g, overlayColor.b, overlayColor.a);
 
                 for (std::list<std::list<std::pair<Point, double> > >::iterator itStroke = strokes.begin(); itStroke != strokes.end(); ++itStroke) {
-                    GL_GPU::Begin(GL_LINE_STRIP);
+                    curvesDrawList.beginLineStrip();
                     for (std::list<std::pair<Point, double> >::const_iterator it2 = itStroke->begin(); it2 != itStroke->end(); ++it2) {
-                        GL_GPU::Vertex2f(it2->first.x, it2->first.y);
+                        curvesDrawList.addLineStripVertex(it2->first.x, it2->first.y);
                     }
-                    GL_GPU::End();
+                    curvesDrawList.endLineStrip();
                 }
             } else if (isBezier) {
                 ///draw the bezier
@@ -1892,13 +1950,6 @@ RotoPaintInteract::drawOverlay(TimeValue time,
 #endif
                 bool finished = isBezier->isCurveFinished(view);
 
-                std::vector<ParametricPoint > points;
-                isBezier->evaluateAtTime(time, view, RenderScale(1.), Bezier::eDeCasteljauAlgorithmIterative, 100, 1., &points, NULL);
-                if (!points.empty() && finished) {
-                    // Repeat the last point so that we can use line strips
-                    points.push_back(points.front());
-                }
-
                 bool locked = (*it)->isLockedRecursive();
                 ColorRgbaD overlayColor(0.8, 0.8, 0.8, 1.);
                 if (!locked) {
@@ -1908,36 +1959,40 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                     overlayColor.b = overlayColorKnob->getValue( DimIdx(2) );
                     overlayColor.a = overlayColorKnob->getValue( DimIdx(3) );
                 }
-                GL_GPU::Color4d(overlayColor.r, overlayColor.g, overlayColor.b, overlayColor.a);
-
-                GL_GPU::Begin(GL_LINE_STRIP);
-                for (std::vector<ParametricPoint >::const_iterator it2 = points.begin(); it2 != points.end(); ++it2) {
-                    GL_GPU::Vertex2f(it2->x, it2->y);
-                }
-                GL_GPU::End();
 
-                ///draw the feather points
-                std::vector<ParametricPoint > featherPoints;
-                bool clockWise = isBezier->isClockwiseOriented(time, view);
-
-
-                if (featherVisible) {
-                    ///Draw feather only if visible (button is toggled in the user interface)
-                    isBezier->evaluateFeatherPointsAtTime(false /*applyFeatherDistance*/, time, view, RenderScale(1.), Bezier::eDeCasteljauAlgorithmIterative, 100, 1., &featherPoints, NULL);
-
-                    if ( !featherPoints.empty() && finished ) {
+                if (recordCurves) {
+                    std::vector<ParametricPoint > points;
+                    isBezier->evaluateAtTime(time, view, RenderScale(1.), Bezier::eDeCasteljauAlgorithmRecursive, -1, 1., &points, NULL);
+                    if (!points.empty() && finished) {
                         // Repeat the last point so that we can use line strips
-                        featherPoints.push_back(featherPoints.front());
-
+                        points.push_back(points.front());
+                    }
 
-                        GL_GPU::LineStipple(2, 0xAAAA);
-                        GL_GPU::Enable(GL_LINE_STIPPLE);
-                        GL_GPU::Begin(GL_LINE_STRIP);
-                        for (std::vector<ParametricPoint >::const_iterator it2 = featherPoints.begin(); it2 != featherPoints.end(); ++it2) {
-                            GL_GPU::Vertex2f(it2->x, it2->y);
+                    curvesDrawList.setColor(overlayColor.r, overlayColor.g, overlayColor.b, overlayColor.a);
+                    curvesDrawList.beginLineStrip();
+                    for (std::vector<ParametricPoint >::const_iterator it2 = points.begin(); it2 != points.end(); ++it2) {
+                        curvesDrawList.addLineStripVertex(it2->x, it2->y);
+                    }
+                    curvesDrawList.endLineStrip();
+
+                    ///draw the feather points
+                    if (featherVisible) {
+                        ///Draw feather only if visible (button is toggled in the user interface)
+                        std::vector<ParametricPoint > featherPoints;
+                        isBezier->evaluateFeatherPointsAtTime(false /*applyFeatherDistance*/, time, view, RenderScale(1.), Bezier::eDeCasteljauAlgorithmRecursive, -1, 1., &featherPoints, NULL);
+
+                        if ( !featherPoints.empty() && finished ) {
+                            // Repeat the last point so that we can use line strips
+                            featherPoints.push_back(featherPoints.front());
+
+                            curvesDrawList.setLineStipple(true);
+                            curvesDrawList.beginLineStrip();
+                            for (std::vector<ParametricPoint >::const_iterator it2 = featherPoints.begin(); it2 != featherPoints.end(); ++it2) {
+                                curvesDrawList.addLineStripVertex(it2->x, it2->y);
+                            }
+                            curvesDrawList.endLineStrip();
+                            curvesDrawList.setLineStipple(false);
                         }
-                        GL_GPU::End();
-                        GL_GPU::Disable(GL_LINE_STIPPLE);
                     }
                 }
 
@@ -1946,6 +2001,7 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                 if (selected && !locked) {
                     Transform::Matrix3x3 transform;
                     isBezier->getTransformAtTime(time, view, &transform);
+                    bool clockWise = isBezier->isClockwiseOriented(time, view);
 
                     const std::list<BezierCPPtr> & cps = isBezier->getControlPoints(view);
                     const std::list<BezierCPPtr> & featherPts = isBezier->getFeatherPoints(view);
@@ -1956,7 +2012,8 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                     }
 
 
-                    GL_GPU::Color3d(0.85, 0.67, 0.);
+                    controlPointsDrawList.setColor(0.85, 0.67, 0.);
+                    cpColor[0] = 0.85; cpColor[1] = 0.67; cpColor[2] = 0.;
 
                     std::list<BezierCPPtr>::const_iterator itF = featherPts.begin();
                     int index = 0;
@@ -2011,7 +2068,8 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                             ( ( firstSelectedCP->first == *it2) || ( firstSelectedCP->second == *it2) ) &&
                             ( selectedCps.size() == 1) &&
                             ( ( state == eEventStateDraggingSelectedControlPoints) || ( state == eEventStateDraggingControlPoint) ) ) {
-                            GL_GPU::Color3f(0., 1., 1.);
+                            controlPointsDrawList.setColor(0., 1., 1.);
+                            cpColor[0] = 0.; cpColor[1] = 1.; cpColor[2] = 1.;
                             colorChanged = true;
                         }
 
@@ -2019,38 +2077,49 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                              cpIt != selectedCps.end();
                              ++cpIt) {
                             ///if the control point is selected, draw its tangent handles
+                            const BezierCPPtr* handlesCp = 0;
+                            const BezierCPPtr* featherHandlesCp = 0;
                             if (cpIt->first == *it2) {
-                                drawSelectedCp(time, cpIt->first, x, y, transform);
-                                if (drawFeather) {
-                                    drawSelectedCp(time, cpIt->second, xF, yF, transform);
-                                }
-                                GL_GPU::Color3f(0.2, 1., 0.);
-                                colorChanged = true;
-                                break;
+                                handlesCp = &cpIt->first;
+                                featherHandlesCp = &cpIt->second;
                             } else if (cpIt->second == *it2) {
-                                drawSelectedCp(time, cpIt->second, x, y, transform);
+                                handlesCp = &cpIt->second;
+                                featherHandlesCp = &cpIt->first;
+                            }
+                            if (handlesCp) {
+                                SelectedCpToDraw toDraw;
+                                toDraw.cp = *handlesCp;
+                                toDraw.x = x;
+                                toDraw.y = y;
+                                toDraw.transform = transform;
+                                for (int i = 0; i < 3; ++i) {
+                                    toDraw.color[i] = cpColor[i];
+                                }
+                                selectedCpsToDraw.push_back(toDraw);
                                 if (drawFeather) {
-                                    drawSelectedCp(time, cpIt->first, xF, yF, transform);
+                                    toDraw.cp = *featherHandlesCp;
+                                    toDraw.x = xF;
+                                    toDraw.y = yF;
+                                    selectedCpsToDraw.push_back(toDraw);
                                 }
-                                GL_GPU::Color3f(0.2, 1., 0.);
+                                controlPointsDrawList.setColor(0.2, 1., 0.);
                                 colorChanged = true;
                                 break;
                             }
                         } // for(cpIt)
 
-                        GL_GPU::Begin(GL_POINTS);
-                        GL_GPU::Vertex2f(x,y);
-                        GL_GPU::End();
+                        controlPointsDrawList.addPoint(x, y);
 
                         if (colorChanged) {
-                            GL_GPU::Color3d(0.85, 0.67, 0.);
+                            controlPointsDrawList.setColor(0.85, 0.67, 0.);
+                            cpColor[0] = 0.85; cpColor[1] = 0.67; cpColor[2] = 0.;
                         }
 
                         if ( (firstSelectedCP->first == *itF)
                             && ( selectedCps.size() == 1) &&
                             ( ( state == eEventStateDraggingSelectedControlPoints) || ( state == eEventStateDraggingControlPoint) )
                             && !colorChanged ) {
-                            GL_GPU::Color3f(0.2, 1., 0.);
+                            controlPointsDrawList.setColor(0.2, 1., 0.);
                             colorChanged = true;
                         }
 
@@ -2068,18 +2137,16 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                         }
 
                         if (drawFeather) {
-                            GL_GPU::Begin(GL_POINTS);
-                            GL_GPU::Vertex2f(xF, yF);
-                            GL_GPU::End();
+                            controlPointsDrawList.addPoint(xF, yF);
 
 
                             if ( ( (state == eEventStateDraggingFeatherBar) &&
                                   ( ( *itF == featherBarBeingDragged.first) || ( *itF == featherBarBeingDragged.second) ) ) ||
                                 isHovered ) {
-                                GL_GPU::Color3f(0.2, 1., 0.);
+                                controlPointsDrawList.setColor(0.2, 1., 0.);
                                 colorChanged = true;
                             } else {
-                                GL_GPU::Color4d(overlayColor.r, overlayColor.g, overlayColor.b, overlayColor.a);
+                                controlPointsDrawList.setColor(overlayColor.r, overlayColor.g, overlayColor.b, overlayColor.a);
                             }
 
                             double beyondX, beyondY;
@@ -2092,13 +2159,13 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                             ///draw a link between the feather point and the control point.
                             ///Also extend that link of 20 pixels beyond the feather point.
 
-                            GL_GPU::Begin(GL_LINE_STRIP);
-                            GL_GPU::Vertex2f(x, y);
-                            GL_GPU::Vertex2f(xF, yF);
-                            GL_GPU::Vertex2f(beyondX, beyondY);
-                            GL_GPU::End();
+                            controlPointsDrawList.beginLineStrip();
+                            controlPointsDrawList.addLineStripVertex(x, y);
+                            controlPointsDrawList.addLineStripVertex(xF, yF);
+                            controlPointsDrawList.addLineStripVertex(beyondX, beyondY);
+                            controlPointsDrawList.endLineStrip();
 
-                            GL_GPU::Color3d(0.85, 0.67, 0.);
+                            controlPointsDrawList.setColor(0.85, 0.67, 0.);
                         } else if (featherVisible) {
                             ///if the feather point is identical to the control point
                             ///draw a small hint line that the user can drag to move the feather point
@@ -2118,25 +2185,22 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                                     if ( ( (state == eEventStateDraggingFeatherBar) &&
                                           ( ( *itF == featherBarBeingDragged.first) ||
                                            ( *itF == featherBarBeingDragged.second) ) ) || isHovered ) {
-                                              GL_GPU::Color3f(0.2, 1., 0.);
+                                              controlPointsDrawList.setColor(0.2, 1., 0.);
                                               colorChanged = true;
                                           } else {
-                                              GL_GPU::Color4d(overlayColor.r, overlayColor.g, overlayColor.b, overlayColor.a);
+                                              controlPointsDrawList.setColor(overlayColor.r, overlayColor.g, overlayColor.b, overlayColor.a);
                                           }
 
-                                    GL_GPU::Begin(GL_LINES);
-                                    GL_GPU::Vertex2f(x, y);
-                                    GL_GPU::Vertex2f(featherPoint.x, featherPoint.y);
-                                    GL_GPU::End();
+                                    controlPointsDrawList.addLine(x, y, featherPoint.x, featherPoint.y);
 
-                                    GL_GPU::Color3d(0.85, 0.67, 0.);
+                                    controlPointsDrawList.setColor(0.85, 0.67, 0.);
                                 }
                             }
                         } // isFeatherVisible()
 
 
                         if (colorChanged) {
-                            GL_GPU::Color3d(0.85, 0.67, 0.);
+                            controlPointsDrawList.setColor(0.85, 0.67, 0.);
                         }
 
                         // increment for next iteration
@@ -2153,9 +2217,16 @@ RotoPaintInteract::drawOverlay(TimeValue time,
                     } // for(it2)
                 } // if ( ( selected != selectedBeziers.end() ) && !locked ) {
             } // if (isBezier)
-            glCheckError(GL_GPU);
         } // for (std::list<RotoDrawableItemPtr>::const_iterator it = drawables.begin(); it != drawables.end(); ++it) {
 
+        curvesDrawList.draw();
+        controlPointsDrawList.draw();
+        for (std::vector<SelectedCpToDraw>::const_iterator it = selectedCpsToDraw.begin(); it != selectedCpsToDraw.end(); ++it) {
+            GL_GPU::Color3d(it->color[0], it->color[1], it->color[2]);
+            drawSelectedCp(time, it->cp, it->x, it->y, it->transform);
+        }
+        glCheckError(GL_GPU);
+
 
 
         if ( (_imp->nodeType == RotoPaint::eRotoPaintTypeRotoPaint || _imp->nodeType == RotoPaint::eRotoPaintTypeRoto) &&
@@ -41,6 +41,7 @@
 
 #include "Engine/BezierCP.h"
 #include "Engine/Bezier.h"
+#include "Engine/OverlayDrawList.h"
 #include "Engine/OverlayInteractBase.h"
 #ifdef ROTOPAINT_ENABLE_PLANARTRACKER
 #include "Engine/PlanarTrackerInteract.h"
@@ -657,6 +658,7 @@ public:
     KnobBoolWPtr premultKnob;
     KnobChoiceWPtr outputComponentsKnob;
     KnobBoolWPtr clipToFormatKnob;
+    KnobBoolWPtr draftCoarseMasksKnob;
     KnobChoiceWPtr outputRoDTypeKnob;
     KnobChoiceWPtr outputFormatKnob;
     KnobIntWPtr outputFormatSizeKnob;
@@ -706,6 +708,8 @@ public:
 
     KnobChoiceWPtr motionBlurTypeKnob;
     KnobIntWPtr motionBlurKnob, globalMotionBlurKnob;
+    KnobBoolWPtr motionBlurAdaptiveKnob;
+    KnobIntWPtr motionBlurMinSamplesKnob;
     KnobDoubleWPtr shutterKnob, globalShutterKnob;
     KnobChoiceWPtr shutterTypeKnob, globalShutterTypeKnob;
     KnobDoubleWPtr customOffsetKnob, globalCustomOffsetKnob;
@@ -806,6 +810,8 @@ public:
     virtual bool isBruteForcePreTrackEnabled() const OVERRIDE FINAL;
     virtual bool isNormalizeIntensitiesEnabled() const OVERRIDE FINAL;
     virtual double getPreBlurSigma() const OVERRIDE FINAL;
+    virtual int getNumPyramidLevels() const OVERRIDE FINAL;
+    virtual bool isGPUMatchingEnabled() const OVERRIDE FINAL;
     virtual RectD getNormalizationRoD(TimeValue time, ViewIdx view) const OVERRIDE FINAL;
     ////////////////////
 
@@ -961,6 +967,10 @@ public:
     bool lastTabletDownTriggeredEraser;
     QPointF mouseCenterOnSizeChange;
 
+    // The curves are recorded again only when an item changes, the control points on each redraw
+    OverlayDrawList curvesDrawList;
+    OverlayDrawList controlPointsDrawList;
+
 
     //////// Toolbar
     KnobPageWPtr toolbarPage;
@@ -31,6 +31,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
+#include <algorithm> // min, max
+#include <cmath>
+#include <cstring> // memset
+#include <limits>
+#include <vector>
+
 #include <QLineF>
 
 #include <cairo/cairo.h>
@@ -45,6 +51,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/RotoShapeRenderNode.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/MultiThread.h"
 
 //This will enable correct evaluation of Beziers
 //#define ROTO_USE_MESH_PATTERN_ONLY
@@ -1775,6 +1782,272 @@ RotoShapeRenderCairo::renderInternalShape_old_cairo(TimeValue time,
 } // RotoShapeRenderCairo::renderInternalShape_old_cairo
 
 
+#ifdef ROTO_CAIRO_RENDER_TRIANGLES_ONLY
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Rasterizes the triangulation of a filled Bezier into the destination image.
+ * Cairo renders on a single thread: each band of scan-lines processed by a thread is rendered on its own Cairo surface.
+ **/
+// The size, in pixels of the coarse image, of the blocks that are either filled from the coarse image or rasterized at full resolution
+#define ROTO_CAIRO_COARSE_BLOCK_SIZE 8
+
+class BezierCairoRasterizer : public ImageMultiThreadProcessorBase
+{
+    const RotoBezierTriangulation::PolygonData* _data;
+
+    // The bounding box of the triangulation in pixel coordinates
+    RectI _shapeBounds;
+    double _fallOff;
+    double _opacity;
+    Image::CPUData _dstImageData;
+    bool _accumulate;
+    int _nDivisions;
+    int _coarseMipMapLevels;
+
+public:
+
+    BezierCairoRasterizer(const EffectInstancePtr& renderClone)
+    : ImageMultiThreadProcessorBase(renderClone)
+    , _data(0)
+    , _shapeBounds()
+    , _fallOff(1.)
+    , _opacity(1.)
+    , _dstImageData()
+    , _accumulate(false)
+    , _nDivisions(0)
+    , _coarseMipMapLevels(0)
+    {
+    }
+
+    /**
+     * @brief If not 0, the shape is first rasterized that many mipmap levels lower, see renderCoarse()
+     **/
+    void setCoarseMipMapLevels(int levels)
+    {
+        _coarseMipMapLevels = levels;
+    }
+
+    virtual ~BezierCairoRasterizer()
+    {
+    }
+
+    void setValues(const RotoBezierTriangulation::PolygonData* data,
+                   double fallOff,
+                   double opacity,
+                   const Image::CPUData& dstImageData,
+                   bool accumulate,
+                   int nDivisions)
+    {
+        _data = data;
+        _fallOff = fallOff;
+        _opacity = opacity;
+        _dstImageData = dstImageData;
+        _accumulate = accumulate;
+        _nDivisions = nDivisions;
+
+        double xMin = std::numeric_limits<double>::infinity();
+        double yMin = std::numeric_limits<double>::infinity();
+        double xMax = -std::numeric_limits<double>::infinity();
+        double yMax = -std::numeric_limits<double>::infinity();
+        for (std::size_t i = 0; i < data->featherVertices.size(); ++i) {
+            const RotoBezierTriangulation::BezierVertex& v = data->featherVertices[i];
+            xMin = std::min(xMin, v.x);
+            xMax = std::max(xMax, v.x);
+            yMin = std::min(yMin, v.y);
+            yMax = std::max(yMax, v.y);
+        }
+        for (std::size_t i = 0; i < data->internalShapeVertices.size(); ++i) {
+            const Point& p = data->internalShapeVertices[i];
+            xMin = std::min(xMin, p.x);
+            xMax = std::max(xMax, p.x);
+            yMin = std::min(yMin, p.y);
+            yMax = std::max(yMax, p.y);
+        }
+        if (xMin > xMax || yMin > yMax) {
+            _shapeBounds.clear();
+        } else {
+            // Pad by a pixel for the mesh patches touching the edges of the pixels
+            _shapeBounds.set( (int)std::floor(xMin) - 1, (int)std::floor(yMin) - 1, (int)std::ceil(xMax) + 1, (int)std::ceil(yMax) + 1 );
+        }
+    }
+
+private:
+
+    /**
+     * @brief Creates the mesh pattern of the shape, or returns NULL on failure
+     **/
+    cairo_pattern_t* createMesh() const
+    {
+        cairo_pattern_t* mesh = cairo_pattern_create_mesh();
+        if (cairo_pattern_status(mesh) != CAIRO_STATUS_SUCCESS) {
+            cairo_pattern_destroy(mesh);
+            return 0;
+        }
+        RotoShapeRenderCairo::renderFeather_cairo(*_data, _fallOff, mesh);
+        RotoShapeRenderCairo::renderInternalShape_cairo(*_data, mesh);
+        return mesh;
+    }
+
+    static void setupContext(cairo_t* ctx)
+    {
+        cairo_set_fill_rule(ctx, CAIRO_FILL_RULE_WINDING);
+        // See renderMaskInternal_cairo
+        cairo_set_antialias(ctx, CAIRO_ANTIALIAS_NONE);
+        cairo_set_operator(ctx, CAIRO_OPERATOR_OVER);
+    }
+
+    /**
+     * @brief Rasterizes the shape onto the surface covering surfaceBounds by rasterizing it _coarseMipMapLevels mipmap levels lower first.
+     * The blocks of the coarse image that are entirely outside or inside of the shape are left empty or filled directly: only the other
+     * blocks, close to the edges or in the feather, are rasterized at full resolution.
+     * Details thinner than a coarse pixel may be missed in the filled blocks, this is why this is only used for draft renders.
+     **/
+    ActionRetCodeEnum renderCoarse(const RectI& surfaceBounds,
+                                   RotoShapeRenderCairo::CairoImageWrapper& imgWrapper)
+    {
+        const RectI coarseBounds = surfaceBounds.downscalePowerOfTwoSmallestEnclosing(_coarseMipMapLevels);
+        const int coarseWidth = coarseBounds.width();
+        const int coarseHeight = coarseBounds.height();
+        const int factor = 1 << _coarseMipMapLevels;
+
+        RotoShapeRenderCairo::CairoImageWrapper coarseWrapper;
+        coarseWrapper.cairoImg = cairo_image_surface_create(CAIRO_FORMAT_A8, coarseWidth, coarseHeight);
+        if (cairo_surface_status(coarseWrapper.cairoImg) != CAIRO_STATUS_SUCCESS) {
+            return eActionStatusFailed;
+        }
+        cairo_surface_set_device_offset(coarseWrapper.cairoImg, -coarseBounds.x1, -coarseBounds.y1);
+        coarseWrapper.ctx = cairo_create(coarseWrapper.cairoImg);
+        setupContext(coarseWrapper.ctx);
+        cairo_scale(coarseWrapper.ctx, 1. / factor, 1. / factor);
+
+        cairo_pattern_t* mesh = createMesh();
+        if (!mesh) {
+            return eActionStatusFailed;
+        }
+        cairo_set_source(coarseWrapper.ctx, mesh);
+        cairo_mask(coarseWrapper.ctx, mesh);
+        cairo_surface_flush(coarseWrapper.cairoImg);
+
+        const unsigned char* coarseData = cairo_image_surface_get_data(coarseWrapper.cairoImg);
+        const int coarseStride = cairo_image_surface_get_stride(coarseWrapper.cairoImg);
+        unsigned char* data = cairo_image_surface_get_data(imgWrapper.cairoImg);
+        const int stride = cairo_image_surface_get_stride(imgWrapper.cairoImg);
+
+        // Classify the blocks: the ones to rasterize at full resolution are merged in horizontal runs
+        std::vector<RectI> exactRuns;
+        for (int by = 0; by < coarseHeight; by += ROTO_CAIRO_COARSE_BLOCK_SIZE) {
+            RectI run;
+            for (int bx = 0; bx < coarseWidth; bx += ROTO_CAIRO_COARSE_BLOCK_SIZE) {
+                // Also look at the pixels around the block: an edge crossing a neighbouring coarse pixel may cover the border of the block
+                int x1 = std::max(0, bx - 1);
+                int x2 = std::min(coarseWidth, bx + ROTO_CAIRO_COARSE_BLOCK_SIZE + 1);
+                int y1 = std::max(0, by - 1);
+                int y2 = std::min(coarseHeight, by + ROTO_CAIRO_COARSE_BLOCK_SIZE + 1);
+                unsigned char minValue = 255, maxValue = 0;
+                for (int y = y1; y < y2; ++y) {
+                    const unsigned char* pix = coarseData + y * coarseStride;
+                    for (int x = x1; x < x2; ++x) {
+                        minValue = std::min(minValue, pix[x]);
+                        maxValue = std::max(maxValue, pix[x]);
+                    }
+                }
+
+                RectI block( (coarseBounds.x1 + bx) * factor,
+                             (coarseBounds.y1 + by) * factor,
+                             (coarseBounds.x1 + std::min(coarseWidth, bx + ROTO_CAIRO_COARSE_BLOCK_SIZE)) * factor,
+                             (coarseBounds.y1 + std::min(coarseHeight, by + ROTO_CAIRO_COARSE_BLOCK_SIZE)) * factor );
+                if ( !block.intersect(surfaceBounds, &block) ) {
+                    continue;
+                }
+
+                if ( (minValue == maxValue) && ( (maxValue == 0) || (maxValue == 255) ) ) {
+                    if (maxValue == 255) {
+                        for (int y = block.y1; y < block.y2; ++y) {
+                            std::memset(data + (y - surfaceBounds.y1) * stride + (block.x1 - surfaceBounds.x1), 255, block.width());
+                        }
+                    }
+                    if ( !run.isNull() ) {
+                        exactRuns.push_back(run);
+                        run.clear();
+                    }
+                } else if ( !run.isNull() && (run.x2 == block.x1) ) {
+                    run.x2 = block.x2;
+                } else {
+                    if ( !run.isNull() ) {
+                        exactRuns.push_back(run);
+                    }
+                    run = block;
+                }
+            }
+            if ( !run.isNull() ) {
+                exactRuns.push_back(run);
+            }
+        }
+        cairo_surface_mark_dirty(imgWrapper.cairoImg);
+
+        cairo_set_source(imgWrapper.ctx, mesh);
+        for (std::size_t i = 0; i < exactRuns.size(); ++i) {
+            const RectI& run = exactRuns[i];
+            cairo_save(imgWrapper.ctx);
+            cairo_rectangle(imgWrapper.ctx, run.x1, run.y1, run.width(), run.height());
+            cairo_clip(imgWrapper.ctx);
+            cairo_mask(imgWrapper.ctx, mesh);
+            cairo_restore(imgWrapper.ctx);
+        }
+        cairo_pattern_destroy(mesh);
+        return eActionStatusOK;
+    } // renderCoarse
+
+    virtual ActionRetCodeEnum multiThreadProcessImages(const RectI& renderWindow) OVERRIDE FINAL
+    {
+        // Pixels outside of the shape are left untouched: the image was cleared before the first sample and
+        // adding an empty sample does not change it. Only the division at the last motion-blur sample affects them.
+        RectI surfaceBounds = renderWindow;
+        if (_nDivisions == 0) {
+            if ( !renderWindow.intersect(_shapeBounds, &surfaceBounds) ) {
+                return eActionStatusOK;
+            }
+        }
+
+        RotoShapeRenderCairo::CairoImageWrapper imgWrapper;
+        imgWrapper.cairoImg = cairo_image_surface_create( CAIRO_FORMAT_A8, surfaceBounds.width(), surfaceBounds.height() );
+        if (cairo_surface_status(imgWrapper.cairoImg) != CAIRO_STATUS_SUCCESS) {
+            return eActionStatusFailed;
+        }
+        cairo_surface_set_device_offset(imgWrapper.cairoImg, -surfaceBounds.x1, -surfaceBounds.y1);
+        imgWrapper.ctx = cairo_create(imgWrapper.cairoImg);
+        setupContext(imgWrapper.ctx);
+
+        // The coarse image must have at least a few blocks to gain anything
+        const bool useCoarse = _coarseMipMapLevels > 0 && _nDivisions == 0 && !_accumulate &&
+                               std::min( surfaceBounds.width(), surfaceBounds.height() ) >= (ROTO_CAIRO_COARSE_BLOCK_SIZE << _coarseMipMapLevels);
+        if ( _shapeBounds.isNull() ) {
+            // Nothing to draw
+        } else if (useCoarse) {
+            ActionRetCodeEnum stat = renderCoarse(surfaceBounds, imgWrapper);
+            if ( isFailureRetCode(stat) ) {
+                return stat;
+            }
+        } else {
+            cairo_pattern_t* mesh = createMesh();
+            if (!mesh) {
+                return eActionStatusFailed;
+            }
+            RotoShapeRenderCairo::applyAndDestroyMask(imgWrapper.ctx, mesh);
+        }
+
+        cairo_surface_flush(imgWrapper.cairoImg);
+
+        // Each thread writes to distinct rows of the image
+        convertCairoImageToNatronImage_noColor(imgWrapper.cairoImg, 1, _dstImageData, surfaceBounds, _opacity, false /*inverted*/, _accumulate, _nDivisions);
+        return eActionStatusOK;
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+#endif // ROTO_CAIRO_RENDER_TRIANGLES_ONLY
+
 void
 RotoShapeRenderCairo::renderMaskInternal_cairo(const RotoDrawableItemPtr& rotoItem,
                                                const RectI & roi,
@@ -1789,7 +2062,9 @@ RotoShapeRenderCairo::renderMaskInternal_cairo(const RotoDrawableItemPtr& rotoIt
                                                const Point& lastCenterPointIn,
                                                const ImagePtr &dstImage,
                                                double* distToNextOut,
-                                               Point* lastCenterPointOut)
+                                               Point* lastCenterPointOut,
+                                               int coarseMipMapLevels,
+                                               const EffectInstancePtr& renderClone)
 {
 
     //NodePtr node = rotoItem->getContext()->getNode();
@@ -1831,7 +2106,7 @@ RotoShapeRenderCairo::renderMaskInternal_cairo(const RotoDrawableItemPtr& rotoIt
         } else if (isBezier && (isBezier->isOpenBezier() || !isBezier->isFillEnabled())) {
             std::vector<ParametricPoint> polygon;
 
-            isBezier->evaluateAtTime(t, view, scale, Bezier::eDeCasteljauAlgorithmIterative, -1, 1., &polygon, 0);
+            isBezier->evaluateAtTime(t, view, scale, Bezier::eDeCasteljauAlgorithmRecursive, -1, 1., &polygon, 0);
             std::list<std::pair<Point, double> > points;
             for (std::vector<ParametricPoint> ::iterator it = polygon.begin(); it != polygon.end(); ++it) {
                 Point p = {it->x, it->y};
@@ -1852,6 +2127,33 @@ RotoShapeRenderCairo::renderMaskInternal_cairo(const RotoDrawableItemPtr& rotoIt
         Image::CPUData imageData;
         dstImage->getCPUData(&imageData);
 
+        // When motion blur is enabled, divide by the number of samples for the last sample.
+        int nDivisionsToApply = nDivisions > 1 && d == nDivisions - 1 ? nDivisions : 0;
+
+        // Accumulate if there's more than one sample and we are not at the first sample.
+        bool doAccumulation = nDivisions > 1 && d > 0;
+
+#ifdef ROTO_CAIRO_RENDER_TRIANGLES_ONLY
+        if ( isBezier && !isDuringPainting && !isBezier->isOpenBezier() && isBezier->isFillEnabled() ) {
+            // Filled shapes do not depend on the pixels already rendered: rasterize the bands of the RoI concurrently.
+            // The shape is triangulated once on this thread since it reads the knobs of the render clone.
+            double fallOff = isBezier->getFeatherFallOffKnob()->getValueAtTime(t, DimIdx(0), view);
+            RotoBezierTriangulation::PolygonData data;
+            RotoBezierTriangulation::tesselate(isBezier, t, view, scale, &data);
+
+            BezierCairoRasterizer rasterizer(renderClone);
+            rasterizer.setValues(&data, fallOff, opacity, imageData, doAccumulation, nDivisionsToApply);
+            if (nDivisions <= 1) {
+                rasterizer.setCoarseMipMapLevels(coarseMipMapLevels);
+            }
+            rasterizer.setRenderWindow(roi);
+            if (rasterizer.process() != eActionStatusOK) {
+                return;
+            }
+            continue;
+        }
+#endif
+
 
 
         ////Allocate the cairo temporary buffer
@@ -1929,12 +2231,6 @@ RotoShapeRenderCairo::renderMaskInternal_cairo(const RotoDrawableItemPtr& rotoIt
         ///to ensure that all pending drawing operations are finished.
         cairo_surface_flush(imgWrapper.cairoImg);
 
-        // When motion blur is enabled, divide by the number of samples for the last sample.
-        int nDivisionsToApply = nDivisions > 1 && d == nDivisions - 1 ? nDivisions : 0;
-
-        // Accumulate if there's more than one sample and we are not at the first sample.
-        bool doAccumulation = nDivisions > 1 && d > 0;
-
         convertCairoImageToNatronImage_noColor(imgWrapper.cairoImg, srcNComps, imageData, roi, isBezier ? opacity : 1., false /*inverted*/, doAccumulation, nDivisionsToApply);
     } // for all divisions
 } // RotoShapeRenderNodePrivate::renderMaskInternal_cairo
@@ -39,6 +39,9 @@
 
 #include "Engine/EngineFwd.h"
 
+// The number of mipmap levels below the render scale at which filled shapes are first rasterized for draft renders
+#define ROTO_DRAFT_MASK_COARSE_MIPMAP_LEVELS 2
+
 NATRON_NAMESPACE_ENTER
 
 class RotoShapeRenderCairo
@@ -156,6 +159,9 @@ public:
 
     /**
      * @brief High level: renders the given roto item into the supplied image.
+     * Filled Beziers are rasterized by multiple threads, each on its own Cairo surface.
+     * @param coarseMipMapLevels If not 0, filled Beziers without motion-blur are first rasterized that many mipmap levels
+     * lower and only the parts of the image close to their edges are rasterized at full resolution: the result is approximate.
      **/
     static void renderMaskInternal_cairo(const RotoDrawableItemPtr& rotoItem,
                                          const RectI & roi,
@@ -170,7 +176,9 @@ public:
                                          const Point& lastCenterPointIn,
                                          const ImagePtr &dstImage,
                                          double* distToNextOut,
-                                         Point* lastCenterPointOut);
+                                         Point* lastCenterPointOut,
+                                         int coarseMipMapLevels,
+                                         const EffectInstancePtr& renderClone);
 
 
     static bool renderSmear_cairo(TimeValue time,
@@ -45,6 +45,9 @@
 #define M_PI        3.14159265358979323846264338327950288   /* pi             */
 #endif
 
+// The number of triangulations kept by each OpenGL context data, e.g: one for each sample of the motion-blur of the shape
+#define ROTO_TESSELATION_CACHE_SIZE 16
+
 NATRON_NAMESPACE_ENTER
 
 static const char* rotoRamp_FragmentShader =
@@ -252,6 +255,35 @@ RotoShapeRenderNodeOpenGLData::~RotoShapeRenderNodeOpenGLData()
 
 }
 
+RotoShapeRenderNodeOpenGLData::PolygonDataConstPtr
+RotoShapeRenderNodeOpenGLData::getOrCreateTesselation(const BezierPtr& bezier,
+                                                      TimeValue time,
+                                                      ViewIdx view,
+                                                      const RenderScale& scale)
+{
+    U64 hash = RotoBezierTriangulation::getTesselationHash(bezier, time, view, scale);
+    {
+        QMutexLocker k(&_tesselationCacheMutex);
+        for (TesselationCache::iterator it = _tesselationCache.begin(); it != _tesselationCache.end(); ++it) {
+            if (it->first == hash) {
+                PolygonDataConstPtr ret = it->second;
+                _tesselationCache.splice(_tesselationCache.begin(), _tesselationCache, it);
+                return ret;
+            }
+        }
+    }
+
+    boost::shared_ptr<RotoBezierTriangulation::PolygonData> data = boost::make_shared<RotoBezierTriangulation::PolygonData>();
+    RotoBezierTriangulation::tesselate(bezier, time, view, scale, data.get());
+
+    QMutexLocker k(&_tesselationCacheMutex);
+    _tesselationCache.push_front( std::make_pair(hash, data) );
+    while ( (int)_tesselationCache.size() > ROTO_TESSELATION_CACHE_SIZE ) {
+        _tesselationCache.pop_back();
+    }
+    return data;
+} // getOrCreateTesselation
+
 
 unsigned int
 RotoShapeRenderNodeOpenGLData::getOrCreateIBOID()
@@ -709,12 +741,15 @@ void renderBezier_gl_singleDrawElements(int nbVertices, int nbIds, int vboVertic
     GL::EnableClientState(GL_VERTEX_ARRAY);
     GL::VertexPointer(2, GL_FLOAT, 0, 0);
 
-    GL::BindBuffer(GL_ARRAY_BUFFER, vboColorsID);
-    if (uploadVertices) {
-        GL::BufferData(GL_ARRAY_BUFFER, nbVertices * 4 * sizeof(GLfloat), colorsData, GL_DYNAMIC_DRAW);
+    // The colors are optional
+    if (colorsData) {
+        GL::BindBuffer(GL_ARRAY_BUFFER, vboColorsID);
+        if (uploadVertices) {
+            GL::BufferData(GL_ARRAY_BUFFER, nbVertices * 4 * sizeof(GLfloat), colorsData, GL_DYNAMIC_DRAW);
+        }
+        GL::EnableClientState(GL_COLOR_ARRAY);
+        GL::ColorPointer(4, GL_FLOAT, 0, 0);
     }
-    GL::EnableClientState(GL_COLOR_ARRAY);
-    GL::ColorPointer(4, GL_FLOAT, 0, 0);
 
     GL::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
     GL::BufferData(GL_ELEMENT_ARRAY_BUFFER, nbIds * sizeof(GLuint), idsData, GL_DYNAMIC_DRAW);
@@ -722,29 +757,9 @@ void renderBezier_gl_singleDrawElements(int nbVertices, int nbIds, int vboVertic
 
     GL::DrawElements(primitiveType, nbIds, GL_UNSIGNED_INT, 0);
 
-    GL::DisableClientState(GL_COLOR_ARRAY);
-    GL::BindBuffer(GL_ARRAY_BUFFER, 0);
-    GL::DisableClientState(GL_VERTEX_ARRAY);
-
-    GL::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glCheckError(GL);
-
-}
-
-template <typename GL>
-void renderBezier_gl_multiDrawElements(int nbVertices, int vboVerticesID, unsigned int primitiveType, const void* verticesData, const int* perDrawCount, const void** perDrawIdsPtr, int drawCount, bool uploadVertices = true)
-{
-
-    GL::BindBuffer(GL_ARRAY_BUFFER, vboVerticesID);
-    if (uploadVertices) {
-        GL::BufferData(GL_ARRAY_BUFFER, nbVertices * 2 * sizeof(GLfloat), verticesData, GL_DYNAMIC_DRAW);
+    if (colorsData) {
+        GL::DisableClientState(GL_COLOR_ARRAY);
     }
-    GL::EnableClientState(GL_VERTEX_ARRAY);
-    GL::VertexPointer(2, GL_FLOAT, 0, 0);
-
-    GL::MultiDrawElements(primitiveType, perDrawCount, GL_UNSIGNED_INT, perDrawIdsPtr, drawCount);
-
-    GL::DisableClientState(GL_COLOR_ARRAY);
     GL::BindBuffer(GL_ARRAY_BUFFER, 0);
     GL::DisableClientState(GL_VERTEX_ARRAY);
 
@@ -961,8 +976,8 @@ renderBezier_gl_internal(const OSGLContextPtr& glContext,
 
 
         // Compute the feather triangles as well as the internal shape triangles.
-        RotoBezierTriangulation::PolygonData data;
-        RotoBezierTriangulation::tesselate(bezier, t, view, scale, &data);
+        RotoShapeRenderNodeOpenGLData::PolygonDataConstPtr dataPtr = glData->getOrCreateTesselation(bezier, t, view, scale);
+        const RotoBezierTriangulation::PolygonData& data = *dataPtr;
 
         // Tex parameters may not have been set yet in GPU mode if motion blur is disabled
         if (GL::isGPU() && !perSampleRenderTexture) {
@@ -1064,63 +1079,14 @@ renderBezier_gl_internal(const OSGLContextPtr& glContext,
             }
 
         }
-        bool hasUploadedVertices = false;
         {
-            // Render internal triangles
-            // Merge all set of GL_TRIANGLES into a single call of glMultiDrawElements
-            int drawCount = (int)data.internalShapeTriangles.size();
-
-            if (drawCount) {
-                std::vector<const void*> perDrawsIDVec(drawCount);
-                std::vector<int> perDrawCount(drawCount);
-                for (std::size_t i = 0; i < data.internalShapeTriangles.size(); ++i) {
-                    perDrawsIDVec[i] = (const void*)(&data.internalShapeTriangles[i][0]);
-                    perDrawCount[i] = (int)data.internalShapeTriangles[i].size();
-                }
-
-                renderBezier_gl_multiDrawElements<GL>(nbVertices, vboVerticesID, GL_TRIANGLES, (const void*)verticesArray.getData(), (const int*)&perDrawCount[0], (const void**)(&perDrawsIDVec[0]), drawCount);
-
-                hasUploadedVertices = true;
-
-            }
-
-
-        }
-        {
-            // Render internal triangle fans
-
-            int drawCount = (int)data.internalShapeTriangleFans.size();
-
-            if (drawCount) {
-                std::vector<const void*> perDrawsIDVec(drawCount);
-                std::vector<int> perDrawCount(drawCount);
-                for (std::size_t i = 0; i < data.internalShapeTriangleFans.size(); ++i) {
-                    perDrawsIDVec[i] = (const void*)(&data.internalShapeTriangleFans[i][0]);
-                    perDrawCount[i] = (int)data.internalShapeTriangleFans[i].size();
-                }
-                renderBezier_gl_multiDrawElements<GL>(nbVertices, vboVerticesID, GL_TRIANGLE_FAN, (const void*)verticesArray.getData(), (const int*)&perDrawCount[0], (const void**)(&perDrawsIDVec[0]), drawCount, !hasUploadedVertices);
-                hasUploadedVertices = true;
-            }
-
-        }
-        {
-            // Render internal triangle strips
-
-            int drawCount = (int)data.internalShapeTriangleStrips.size();
-
-            if (drawCount) {
-                std::vector<const void*> perDrawsIDVec(drawCount);
-                std::vector<int> perDrawCount(drawCount);
-                for (std::size_t i = 0; i < data.internalShapeTriangleStrips.size(); ++i) {
-                    perDrawsIDVec[i] = (const void*)(&data.internalShapeTriangleStrips[i][0]);
-                    perDrawCount[i] = (int)data.internalShapeTriangleStrips[i].size();
-                }
-                renderBezier_gl_multiDrawElements<GL>(nbVertices, vboVerticesID, GL_TRIANGLE_STRIP, (const void*)verticesArray.getData(), (const int*)&perDrawCount[0], (const void**)(&perDrawsIDVec[0]), drawCount, !hasUploadedVertices);
-                hasUploadedVertices = true;
+            // Render the internal triangles, fans and strips at once: for shapes with many small primitives
+            // the cost of each draw call dominates.
+            int nbIds = (int)data.internalShapeMergedTriangles.size();
+            if (nbIds) {
+                renderBezier_gl_singleDrawElements<GL>(nbVertices, nbIds, vboVerticesID, vboColorsID, iboID, GL_TRIANGLES, (const void*)verticesArray.getData(), 0 /*colorsData*/, (const void*)&data.internalShapeMergedTriangles[0]);
             }
-            
         }
-        Q_UNUSED(hasUploadedVertices);
         glCheckError(GL);
         motionBlurEndSample<GL>(nDivisions, d, accumShader, copyShader, target, perSampleRenderTexture, accumulationTexture, tmpAccumulationCpy, roi);
 
@@ -1814,7 +1780,7 @@ RotoShapeRenderGL::renderStroke_gl(const OSGLContextPtr& glContext,
             isStroke->evaluateStroke(scale, t, view, &strokes);
         } else if (isBezier && (isBezier->isOpenBezier() || !isBezier->isFillEnabled())) {
             std::vector<ParametricPoint> polygon;
-            isBezier->evaluateAtTime(t, view, scale, Bezier::eDeCasteljauAlgorithmIterative, -1, 1., &polygon, 0);
+            isBezier->evaluateAtTime(t, view, scale, Bezier::eDeCasteljauAlgorithmRecursive, -1, 1., &polygon, 0);
             std::list<std::pair<Point, double> > points;
             for (std::vector<ParametricPoint> ::iterator it = polygon.begin(); it != polygon.end(); ++it) {
                 Point p = {it->x, it->y};
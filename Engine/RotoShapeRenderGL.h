@@ -29,13 +29,17 @@
 #include "Global/Macros.h"
 
 #include <list>
+#include <utility>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #endif
 
+#include <QtCore/QMutex>
+
 #include "Global/GlobalDefines.h"
 #include "Engine/EffectOpenGLContextData.h"
+#include "Engine/RotoBezierTriangulation.h"
 #include "Engine/TimeValue.h"
 
 #include "Engine/EngineFwd.h"
@@ -88,6 +92,15 @@ class RotoShapeRenderNodeOpenGLData : public EffectOpenGLContextData
     GLShaderBasePtr _smearShader;
     GLShaderBasePtr _divideShader;
 
+    typedef boost::shared_ptr<const RotoBezierTriangulation::PolygonData> PolygonDataConstPtr;
+    typedef std::list<std::pair<U64, PolygonDataConstPtr> > TesselationCache;
+
+    // Protects _tesselationCache
+    QMutex _tesselationCacheMutex;
+
+    // The triangulations of the last shapes rendered, indexed by their tesselation hash. The most recently used is first.
+    TesselationCache _tesselationCache;
+
 public:
 
     void cleanup();
@@ -116,6 +129,12 @@ public:
 
     GLShaderBasePtr getOrCreateSmearShader();
 
+    /**
+     * @brief Returns the triangulation of the given Bezier at the given time/view/scale. It is only computed if the same
+     * shape was not triangulated recently, e.g: when other knobs of the item changed or when the frame is rendered again.
+     **/
+    PolygonDataConstPtr getOrCreateTesselation(const BezierPtr& bezier, TimeValue time, ViewIdx view, const RenderScale& scale);
+
     virtual ~RotoShapeRenderNodeOpenGLData();
     
 };
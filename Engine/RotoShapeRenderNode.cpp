@@ -25,6 +25,8 @@
 
 #include "RotoShapeRenderNode.h"
 
+#include <algorithm> // max
+
 #include <QDebug>
 #include <QThread>
 
@@ -46,6 +48,7 @@
 #include "Engine/RotoShapeRenderCairo.h"
 #include "Engine/RotoShapeRenderGL.h"
 #include "Engine/RotoPaint.h"
+#include "Engine/TreeRender.h"
 
 #ifdef ROTO_SHAPE_RENDER_ENABLE_CAIRO
 //#define ROTO_SHAPE_RENDER_CPU_USES_CAIRO
@@ -77,6 +80,10 @@ RotoShapeRenderNode::createPlugin()
     effectDesc->setProperty<bool>(kEffectPropSupportsMultiResolution, true);
     effectDesc->setProperty<bool>(kEffectPropTemporalImageAccess, true);
     ret->setProperty<bool>(kNatronPluginPropMultiPlanar, true);
+#ifdef ROTO_SHAPE_RENDER_CPU_USES_CAIRO
+    // Masks may be rasterized at a lower resolution in draft mode, see kRotoDraftCoarseMasksParam
+    ret->setProperty<bool>(kNatronPluginPropSupportsDraftRender, true);
+#endif
 
     ret->setProperty<ImageBitDepthEnum>(kNatronPluginPropOutputSupportedBitDepths, eImageBitDepthFloat, 0);
     ret->setProperty<std::bitset<4> >(kNatronPluginPropOutputSupportedComponents, std::bitset<4>(std::string("1111")));
@@ -143,6 +150,7 @@ RotoShapeRenderNode::fetchRenderCloneKnobs()
     assert(_imp->outputFormatSizeKnob.lock());
     _imp->outputFormatParKnob = toKnobDouble(getKnobByName(kRotoFormatPar));
     _imp->clipToFormatKnob = toKnobBool(getKnobByName(kRotoClipToFormatParam));
+    _imp->draftCoarseMasksKnob = toKnobBool(getKnobByName(kRotoDraftCoarseMasksParam));
 }
 
 void
@@ -210,6 +218,14 @@ RotoShapeRenderNode::initializeKnobs()
         page->addKnob(param);
         _imp->clipToFormatKnob = param;
     }
+    {
+        KnobBoolPtr param = createKnob<KnobBool>(kRotoDraftCoarseMasksParam);
+        param->setLabel(tr(kRotoDraftCoarseMasksParamLabel));
+        param->setHintToolTip(tr(kRotoDraftCoarseMasksParamHint));
+        param->setDefaultValue(false);
+        page->addKnob(param);
+        _imp->draftCoarseMasksKnob = param;
+    }
 }
 
 KnobHolderPtr
@@ -535,6 +551,135 @@ RotoShapeRenderNode::isIdentity(TimeValue time,
 
 
 
+/**
+ * @brief Renders the points of the stroke render clone on top of the content of the output image, as when painting
+ **/
+static void
+renderStrokeOnOutput(const RenderActionArgs& args,
+                     const RenderScale& combinedScale,
+                     const RotoStrokeItemPtr& stroke,
+                     const RotoShapeRenderNodeOpenGLDataPtr& glData,
+                     const EffectInstancePtr& renderClone,
+                     double distToNextIn,
+                     const Point& lastCenterIn,
+                     double* distToNextOut,
+                     Point* lastCenterOut)
+{
+    const std::pair<ImagePlaneDesc,ImagePtr>& outputPlane = args.outputPlanes.front();
+    RangeD range;
+    range.min = range.max = args.time;
+
+#ifdef ROTO_SHAPE_RENDER_CPU_USES_CAIRO
+    if (args.backendType == eRenderBackendTypeCPU) {
+        RotoShapeRenderCairo::renderMaskInternal_cairo(stroke, args.roi, outputPlane.first, args.time, args.view, range, 1, combinedScale, true /*isDuringPainting*/, distToNextIn, lastCenterIn, outputPlane.second, distToNextOut, lastCenterOut, 0 /*coarseMipMapLevels*/, renderClone);
+        return;
+    }
+#else
+    Q_UNUSED(renderClone);
+#endif
+    double opacity = stroke->getOpacityKnob() ? stroke->getOpacityKnob()->getValueAtTime(args.time, DimIdx(0), args.view) : 1.;
+    const bool doBuildUp = stroke->getBuildupKnob()->getValueAtTime(args.time, DimIdx(0), args.view);
+    RotoShapeRenderGL::renderStroke_gl(args.glContext, glData, args.roi, outputPlane.second, true /*isDuringPainting*/, distToNextIn, lastCenterIn, stroke, doBuildUp, opacity, args.time, args.view, range, 1, combinedScale, distToNextOut, lastCenterOut);
+} // renderStrokeOnOutput
+
+/**
+ * @brief Renders a stroke outside of painting: the rendering picks-up from the last image accumulated on the stroke
+ * by a previous render that is still valid, then the stroke is rendered in chunks of ROTO_STROKE_POINTS_PER_CHECKPOINT points
+ * and the images accumulated after the last chunks are kept on the stroke for the next renders.
+ * This way, when points are appended to a stroke or its last points are edited, only the end of the stroke is rendered again.
+ **/
+static ActionRetCodeEnum
+renderStrokeFromCheckpoints(const RenderActionArgs& args,
+                            const RenderScale& combinedScale,
+                            const RotoStrokeItemPtr& stroke,
+                            const RotoStrokeItemPtr& mainStroke,
+                            const RotoShapeRenderNodeOpenGLDataPtr& glData,
+                            const EffectInstancePtr& renderClone)
+{
+    const ImagePtr& dstImage = args.outputPlanes.front().second;
+    const RectI& dstBounds = dstImage->getBounds();
+
+    // Identify everything but the points the accumulated image depends on
+    U64 renderKey;
+    {
+        Hash64 hash;
+        hash.append(stroke->computeRenderKnobsHash(args.time, args.view));
+        hash.append(combinedScale.x);
+        hash.append(combinedScale.y);
+        hash.append(args.roi.x1);
+        hash.append(args.roi.y1);
+        hash.append(args.roi.x2);
+        hash.append(args.roi.y2);
+        hash.append(dstBounds.x1);
+        hash.append(dstBounds.y1);
+        hash.append(dstBounds.x2);
+        hash.append(dstBounds.y2);
+        hash.append((int)dstImage->getBitDepth());
+        hash.append(dstImage->getComponentsCount());
+        hash.append((int)args.backendType);
+        hash.computeHash();
+        renderKey = hash.value();
+    }
+
+    std::vector<RotoStrokeItem::Checkpoint> positions;
+    stroke->getCheckpointPositions(ROTO_STROKE_POINTS_PER_CHECKPOINT, &positions);
+
+    RotoStrokeItem::Checkpoint state;
+    int lastPosition = mainStroke->findCheckpoint(renderKey, positions, &state);
+    if (lastPosition != -1) {
+        // The output was cleared in render(), replace it with the accumulated image
+        Image::CopyPixelsArgs cpyArgs;
+        cpyArgs.roi = args.roi;
+        ActionRetCodeEnum stat = dstImage->copyPixels(*state.image, cpyArgs);
+        if (isFailureRetCode(stat)) {
+            return stat;
+        }
+    }
+
+    for (int i = lastPosition + 1; i < (int)positions.size(); ++i) {
+        RotoStrokeItem::Checkpoint& position = positions[i];
+
+        // Also render the last point rendered by the previous chunk so that the segment between the chunks is rendered
+        int firstPointIndex = position.subStrokeIndex == state.subStrokeIndex ? std::max(0, state.pointIndex) : 0;
+        stroke->setRenderCloneStrokeRange(position.subStrokeIndex, firstPointIndex, position.pointIndex);
+
+        renderStrokeOnOutput(args, combinedScale, stroke, glData, renderClone, state.distToNext, state.lastCenter, &position.distToNext, &position.lastCenter);
+        if (renderClone->isRenderAborted()) {
+            stroke->resetRenderCloneStrokeRange();
+            return eActionStatusAborted;
+        }
+        state = position;
+
+        // Only the last checkpoints are kept on the stroke: do not copy the image for the others
+        if (i < (int)positions.size() - ROTO_STROKE_MAX_CHECKPOINTS) {
+            continue;
+        }
+        Image::InitStorageArgs initArgs;
+        initArgs.bounds = dstBounds;
+        initArgs.bitdepth = dstImage->getBitDepth();
+        initArgs.plane = dstImage->getLayer();
+        initArgs.mipMapLevel = dstImage->getMipMapLevel();
+        initArgs.proxyScale = dstImage->getProxyScale();
+        // Textures are read back to a packed RGBA buffer
+        if (dstImage->getStorageMode() == eStorageModeRAM) {
+            initArgs.bufferFormat = dstImage->getBufferFormat();
+        }
+        position.image = Image::create(initArgs);
+        if (!position.image) {
+            continue;
+        }
+        Image::CopyPixelsArgs cpyArgs;
+        cpyArgs.roi = dstBounds;
+        ActionRetCodeEnum stat = position.image->copyPixels(*dstImage, cpyArgs);
+        if (isFailureRetCode(stat)) {
+            continue;
+        }
+        mainStroke->insertCheckpoint(renderKey, position);
+    }
+    stroke->resetRenderCloneStrokeRange();
+    return eActionStatusOK;
+} // renderStrokeFromCheckpoints
+
 ActionRetCodeEnum
 RotoShapeRenderNode::render(const RenderActionArgs& args)
 {
@@ -656,10 +801,28 @@ RotoShapeRenderNode::render(const RenderActionArgs& args)
                 divisions = 1;
             }
 
+            // Outside of painting, a stroke picks-up from the image accumulated by a previous render.
+            // The stroke is rendered in chunks as when painting, which cannot be done with motion-blur or a partially visible stroke.
+            if (isStroke && !isDuringPainting && divisions <= 1 && nonRenderStroke) {
+                KnobDoublePtr visiblePortionKnob = isStroke->getBrushVisiblePortionKnob();
+                if (visiblePortionKnob->getValueAtTime(args.time, DimIdx(0), args.view) == 0. &&
+                    visiblePortionKnob->getValueAtTime(args.time, DimIdx(1), args.view) == 1.) {
+                    return renderStrokeFromCheckpoints(args, combinedScale, isStroke, nonRenderStroke, glData, shared_from_this());
+                }
+            }
+
 #ifdef ROTO_SHAPE_RENDER_CPU_USES_CAIRO
             // When cairo is enabled, render with it for a CPU render
             if (args.backendType == eRenderBackendTypeCPU) {
-                RotoShapeRenderCairo::renderMaskInternal_cairo(rotoItem, args.roi, outputPlane.first, args.time, args.view, range, divisions, combinedScale, isDuringPainting, distNextIn, lastCenterIn, outputPlane.second, &distToNextOut, &lastCenterOut);
+                // In draft mode, filled shapes may be rasterized at full resolution only near their edges
+                int coarseMipMapLevels = 0;
+                if ( _imp->draftCoarseMasksKnob.lock()->getValue() ) {
+                    TreeRenderPtr render = getCurrentRender();
+                    if ( render && render->isDraftRender() ) {
+                        coarseMipMapLevels = ROTO_DRAFT_MASK_COARSE_MIPMAP_LEVELS;
+                    }
+                }
+                RotoShapeRenderCairo::renderMaskInternal_cairo(rotoItem, args.roi, outputPlane.first, args.time, args.view, range, divisions, combinedScale, isDuringPainting, distNextIn, lastCenterIn, outputPlane.second, &distToNextOut, &lastCenterOut, coarseMipMapLevels, shared_from_this());
                 if (isDuringPainting && isStroke) {
                     nonRenderStroke->updateStrokeData(lastCenterOut, distToNextOut, isStroke->getRenderCloneCurrentStrokeEndPointIndex());
                 }
@@ -52,6 +52,7 @@ public:
     KnobIntWPtr outputFormatSizeKnob;
     KnobDoubleWPtr outputFormatParKnob;
     KnobBoolWPtr clipToFormatKnob;
+    KnobBoolWPtr draftCoarseMasksKnob;
     
     // When drawing a smear with OSMesa we cannot use the output image directly
     // because the first draw done by OSMesa will clear the framebuffer instead
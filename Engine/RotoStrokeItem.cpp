@@ -134,6 +134,15 @@ struct RotoStrokeItemPrivate
     // contains the portion that was not rendered yet
     boost::scoped_ptr<std::map<TimeValue,U64> > renderCachedHash;
 
+    // On the render clone, the strokes before setRenderCloneStrokeRange() was called
+    boost::scoped_ptr<std::vector<StrokeCurves> > renderCloneFullStrokes;
+
+    // On the main instance, the images accumulated by the last renders outside of painting, sorted along the stroke.
+    // They are all rendered with checkpointsRenderKey.
+    mutable QMutex checkpointsMutex;
+    U64 checkpointsRenderKey;
+    std::list<RotoStrokeItem::Checkpoint> checkpoints;
+
     // While drawing the stroke, this is the bounding box of the points
     // used to render. Basically this is the bbox of the points extracted
     // in the copy ctor.
@@ -184,6 +193,10 @@ struct RotoStrokeItemPrivate
     , lastCenter()
     , renderCachedBbox()
     , renderCachedHash()
+    , renderCloneFullStrokes()
+    , checkpointsMutex()
+    , checkpointsRenderKey(0)
+    , checkpoints()
     , lastStrokeStepBbox()
     , lastPointIndexInSubStroke(-1)
     , pickupPointIndexInSubStroke(0)
@@ -1040,6 +1053,176 @@ RotoStrokeItem::isCurrentlyDrawing() const
     return _imp->isCurrentlyDrawing;
 }
 
+static void
+appendStrokeKeyFrame(const KeyFrame& key, Hash64* hash)
+{
+    hash->append((double)key.getTime());
+    hash->append(key.getValue());
+    hash->append(key.getLeftDerivative());
+    hash->append(key.getRightDerivative());
+}
+
+void
+RotoStrokeItem::getCheckpointPositions(int pointsPerCheckpoint, std::vector<Checkpoint>* positions) const
+{
+    assert(pointsPerCheckpoint > 0);
+    QMutexLocker k(&_imp->lock);
+    const std::vector<RotoStrokeItemPrivate::StrokeCurves>& strokes = _imp->renderCloneFullStrokes ? *_imp->renderCloneFullStrokes : _imp->strokes;
+
+    // The hash of a position covers all points before it, so that a checkpoint is invalidated by any change before it
+    // but not by the points appended after it.
+    Hash64 hash;
+    for (std::size_t i = 0; i < strokes.size(); ++i) {
+        KeyFrameSet xSet = strokes[i].xCurve->getKeyFrames_mt_safe();
+        KeyFrameSet ySet = strokes[i].yCurve->getKeyFrames_mt_safe();
+        KeyFrameSet pSet = strokes[i].pressureCurve->getKeyFrames_mt_safe();
+        assert( xSet.size() == ySet.size() && xSet.size() == pSet.size() );
+        if ( xSet.size() != ySet.size() || xSet.size() != pSet.size() ) {
+            return;
+        }
+
+        int nPoints = (int)xSet.size();
+        KeyFrameSet::const_iterator xIt = xSet.begin();
+        KeyFrameSet::const_iterator yIt = ySet.begin();
+        KeyFrameSet::const_iterator pIt = pSet.begin();
+        for (int p = 0; p < nPoints; ++p, ++xIt, ++yIt, ++pIt) {
+            appendStrokeKeyFrame(*xIt, &hash);
+            appendStrokeKeyFrame(*yIt, &hash);
+            appendStrokeKeyFrame(*pIt, &hash);
+            if ( ( (p + 1) % pointsPerCheckpoint == 0 ) || (p == nPoints - 1) ) {
+                hash.computeHash();
+                Checkpoint position;
+                position.subStrokeIndex = (int)i;
+                position.pointIndex = p;
+                position.strokesHash = hash.value();
+                positions->push_back(position);
+            }
+        }
+
+        // Separate the sub-strokes so that moving a point from one to the other changes the hash
+        hash.append(nPoints);
+    }
+} // getCheckpointPositions
+
+int
+RotoStrokeItem::findCheckpoint(U64 renderKey, const std::vector<Checkpoint>& positions, Checkpoint* checkpoint) const
+{
+    assert(!isRenderClone());
+    QMutexLocker k(&_imp->checkpointsMutex);
+    if (_imp->checkpoints.empty() || _imp->checkpointsRenderKey != renderKey) {
+        return -1;
+    }
+
+    // Pick-up from the checkpoint the furthest along the stroke
+    for (int i = (int)positions.size() - 1; i >= 0; --i) {
+        for (std::list<Checkpoint>::const_reverse_iterator it = _imp->checkpoints.rbegin(); it != _imp->checkpoints.rend(); ++it) {
+            if (it->subStrokeIndex == positions[i].subStrokeIndex &&
+                it->pointIndex == positions[i].pointIndex &&
+                it->strokesHash == positions[i].strokesHash) {
+                *checkpoint = *it;
+                return i;
+            }
+        }
+    }
+    return -1;
+} // findCheckpoint
+
+void
+RotoStrokeItem::insertCheckpoint(U64 renderKey, const Checkpoint& checkpoint)
+{
+    assert(!isRenderClone());
+    assert(checkpoint.image);
+    QMutexLocker k(&_imp->checkpointsMutex);
+    if (_imp->checkpointsRenderKey != renderKey) {
+        _imp->checkpoints.clear();
+        _imp->checkpointsRenderKey = renderKey;
+    }
+
+    // The checkpoints at or after this one were rendered from other points
+    std::list<Checkpoint>::iterator it = _imp->checkpoints.begin();
+    while ( it != _imp->checkpoints.end() &&
+            ( it->subStrokeIndex < checkpoint.subStrokeIndex ||
+              (it->subStrokeIndex == checkpoint.subStrokeIndex && it->pointIndex < checkpoint.pointIndex) ) ) {
+        ++it;
+    }
+    _imp->checkpoints.erase(it, _imp->checkpoints.end());
+    _imp->checkpoints.push_back(checkpoint);
+
+    while ((int)_imp->checkpoints.size() > ROTO_STROKE_MAX_CHECKPOINTS) {
+        _imp->checkpoints.pop_front();
+    }
+} // insertCheckpoint
+
+void
+RotoStrokeItem::setRenderCloneStrokeRange(int subStrokeIndex, int firstPointIndex, int lastPointIndex)
+{
+    assert(isRenderClone());
+    TimeValue time = getCurrentRenderTime();
+    ViewIdx view = getCurrentRenderView();
+
+    QMutexLocker k(&_imp->lock);
+    if (!_imp->renderCloneFullStrokes) {
+        // The bounding box and the hash must remain the ones of the full stroke
+        if (!_imp->renderCachedBbox) {
+            _imp->renderCachedBbox.reset(new std::map<TimeValue,RectD>);
+        }
+        if ( _imp->renderCachedBbox->find(time) == _imp->renderCachedBbox->end() ) {
+            _imp->renderCachedBbox->insert(std::make_pair(time, _imp->computeBoundingBox(time, view)));
+        }
+        if (!_imp->renderCachedHash) {
+            _imp->renderCachedHash.reset(new std::map<TimeValue,U64>);
+        }
+        if ( _imp->renderCachedHash->find(time) == _imp->renderCachedHash->end() ) {
+            _imp->renderCachedHash->insert(std::make_pair(time, _imp->computeHashFromStrokes()));
+        }
+        _imp->renderCloneFullStrokes.reset(new std::vector<RotoStrokeItemPrivate::StrokeCurves>(_imp->strokes));
+    }
+
+    const std::vector<RotoStrokeItemPrivate::StrokeCurves>& fullStrokes = *_imp->renderCloneFullStrokes;
+    assert(subStrokeIndex >= 0 && subStrokeIndex < (int)fullStrokes.size());
+    assert(firstPointIndex >= 0 && firstPointIndex <= lastPointIndex);
+    const RotoStrokeItemPrivate::StrokeCurves& originalStroke = fullStrokes[subStrokeIndex];
+    int nKeys = lastPointIndex - firstPointIndex + 1;
+
+    RotoStrokeItemPrivate::StrokeCurves strokeCopy;
+    strokeCopy.xCurve.reset(new Curve);
+    strokeCopy.yCurve.reset(new Curve);
+    strokeCopy.pressureCurve.reset(new Curve);
+    strokeCopy.xCurve->cloneIndexRange(*originalStroke.xCurve, firstPointIndex, nKeys);
+    strokeCopy.yCurve->cloneIndexRange(*originalStroke.yCurve, firstPointIndex, nKeys);
+    strokeCopy.pressureCurve->cloneIndexRange(*originalStroke.pressureCurve, firstPointIndex, nKeys);
+
+    _imp->strokes.clear();
+    _imp->strokes.push_back(strokeCopy);
+} // setRenderCloneStrokeRange
+
+void
+RotoStrokeItem::resetRenderCloneStrokeRange()
+{
+    assert(isRenderClone());
+    QMutexLocker k(&_imp->lock);
+    if (!_imp->renderCloneFullStrokes) {
+        return;
+    }
+    _imp->strokes = *_imp->renderCloneFullStrokes;
+    _imp->renderCloneFullStrokes.reset();
+}
+
+U64
+RotoStrokeItem::computeRenderKnobsHash(TimeValue time, ViewIdx view)
+{
+    ComputeHashArgs args;
+    args.time = time;
+    args.view = view;
+    args.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+
+    // Skip the strokes appended in appendToHash()
+    Hash64 hash;
+    RotoDrawableItem::appendToHash(args, &hash);
+    hash.computeHash();
+    return hash.value();
+}
+
 void
 RotoStrokeItem::copyItem(const KnobTableItem& other)
 {
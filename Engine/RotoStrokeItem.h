@@ -28,9 +28,11 @@
 
 #include "Global/Macros.h"
 
+#include <climits>
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
@@ -58,6 +60,13 @@ NATRON_NAMESPACE_ENTER
 // http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
 #define ROTO_PRESSURE_LEVELS 512
 
+// When rendering a stroke outside of painting, the accumulated image is saved every so many points
+// so that following renders of the same stroke with points appended to it pick-up from there.
+#define ROTO_STROKE_POINTS_PER_CHECKPOINT 32
+
+// The number of accumulated images kept on a stroke: only the last checkpoints of a render are kept.
+#define ROTO_STROKE_MAX_CHECKPOINTS 4
+
 /**
  * @class A base class for all items made by the roto context
  **/
@@ -182,6 +191,69 @@ public:
      **/
     bool isCurrentlyDrawing() const;
 
+    /**
+     * @brief The state of the stroke rendering algorithm after all points of the stroke up to a given point were rendered.
+     **/
+    struct Checkpoint
+    {
+        // The sub-stroke and the index of its last point rendered (included)
+        int subStrokeIndex, pointIndex;
+
+        // The hash of all points of the stroke up to the last point rendered (included)
+        U64 strokesHash;
+
+        // The state of the algorithm in RotoShapeRenderNodePrivate::renderStroke_generic to pick-up from
+        double distToNext;
+        Point lastCenter;
+
+        // The image accumulated so far, in RAM
+        ImagePtr image;
+
+        Checkpoint()
+        : subStrokeIndex(0)
+        , pointIndex(-1)
+        , strokesHash(0)
+        , distToNext(0)
+        , lastCenter()
+        , image()
+        {
+            lastCenter.x = lastCenter.y = INT_MIN;
+        }
+    };
+
+    /**
+     * @brief Returns the positions in the stroke where checkpoints can be taken: every pointsPerCheckpoint points
+     * and at the end of each sub-stroke. Only the position and strokesHash fields are set.
+     **/
+    void getCheckpointPositions(int pointsPerCheckpoint, std::vector<Checkpoint>* positions) const;
+
+    /**
+     * @brief Should be called on the main instance: returns the index in positions of the last position for which
+     * a checkpoint was rendered with the given key, or -1 if there is none. The checkpoint is set in checkpoint.
+     * @param renderKey Identifies everything but the points the image depends on (the knobs, the scale, the bounds...)
+     **/
+    int findCheckpoint(U64 renderKey, const std::vector<Checkpoint>& positions, Checkpoint* checkpoint) const;
+
+    /**
+     * @brief Should be called on the main instance: keeps the given checkpoint for the next renders.
+     * Checkpoints rendered with another key are removed, as well as checkpoints further along the stroke
+     * than this one since they can no longer be valid.
+     **/
+    void insertCheckpoint(U64 renderKey, const Checkpoint& checkpoint);
+
+    /**
+     * @brief Should only be called on the render clone: restrict the points to render to the range [firstPointIndex, lastPointIndex]
+     * of the given sub-stroke. resetRenderCloneStrokeRange() restores all points.
+     * The bounding box and the hash of the clone remain the ones of the full stroke.
+     **/
+    void setRenderCloneStrokeRange(int subStrokeIndex, int firstPointIndex, int lastPointIndex);
+    void resetRenderCloneStrokeRange();
+
+    /**
+     * @brief Returns the hash of the knobs of the item at the given time/view, without the points of the stroke
+     **/
+    U64 computeRenderKnobsHash(TimeValue time, ViewIdx view);
+
 
     virtual void copyItem(const KnobTableItem& other) OVERRIDE FINAL;
 
@@ -25,6 +25,7 @@
 
 #include "Settings.h"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <sstream>
@@ -45,18 +46,23 @@
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/Cache.h"
+#include "Engine/CacheFlusherThread.h"
+#include "Engine/CompressedTileStorage.h"
 #include "Global/FStreamsSupport.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/KeybindShortcut.h"
 #include "Engine/KnobFactory.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/MemoryInfo.h" // getSystemTotalRAM, isApplication32Bits, printAsRAM
+#include "Engine/MemoryPressureMonitorThread.h"
 #include "Engine/Node.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
+#include "Engine/RemoteTileCache.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/Utils.h"
 #include "Engine/ViewIdx.h"
@@ -117,6 +123,8 @@ public:
     KnobButtonPtr _testCrashReportButton;
 #endif
     KnobBoolPtr _autoSaveUnSavedProjects;
+    KnobChoicePtr _projectFileFormat;
+    KnobBoolPtr _deferGroupContentCreation;
     KnobPathPtr _fileDialogSavedPaths;
     KnobIntPtr _autoSaveDelay;
     KnobBoolPtr _saveSafetyMode;
@@ -126,22 +134,28 @@ public:
     // General/Threading
     KnobPagePtr _threadingPage;
     KnobIntPtr _numberOfThreads;
+    KnobChoicePtr _threadPlacementPolicy;
     KnobBoolPtr _renderInSeparateProcess;
     KnobBoolPtr _queueRenders;
+    KnobBoolPtr _renderWritersConcurrently;
 
     // General/Rendering
     KnobPagePtr _renderingPage;
     KnobBoolPtr _convertNaNValues;
     KnobBoolPtr _activateRGBSupport;
     KnobBoolPtr _activateTransformConcatenationSupport;
+    KnobIntPtr _streamingRenderStripeMPix;
 
     // General/GPU rendering
     KnobPagePtr _gpuPage;
     KnobStringPtr _openglRendererString;
     KnobChoicePtr _availableOpenGLRenderers;
+    KnobBoolPtr _useAllOpenGLRenderers;
     KnobChoicePtr _osmesaRenderers;
     KnobIntPtr _nOpenGLContexts;
     KnobChoicePtr _enableOpenGL;
+    KnobBoolPtr _adaptiveRenderBackend;
+    KnobIntPtr _gpuImageCacheSizeMB;
 
 
 
@@ -184,17 +198,56 @@ public:
 
     // The total disk space allowed for all Natron's caches
     KnobIntPtr _maxDiskCacheSizeGb;
+
+    // Shrink the tile cache when the system is low on memory
+    KnobBoolPtr _adaptiveCacheSize;
     KnobPathPtr _diskCachePath;
 
+    // The size of the tiles of the tile cache
+    KnobChoicePtr _tileSize;
+
+    // The RAM allowed for compressed tiles evicted from the tile cache
+    KnobIntPtr _compressedTilesCacheSizeMb;
+
+    // The RAM allowed for the idle image buffers kept for reuse
+    KnobIntPtr _imageBufferPoolSizeMb;
+
+    // Render frames ahead of the playhead of the viewer when idle
+    KnobBoolPtr _cacheWarming;
+
+    // The RAM allowed for the frames kept by the viewers during playback
+    KnobIntPtr _playbackBufferSizeMb;
+    KnobIntPtr _undoRedoMemoryMb;
+    KnobStringPtr _undoRedoMemoryUsage;
+
+    // The RAM allowed for the images allocated by a single render
+    KnobIntPtr _renderMemoryBudgetMb;
+
+    // When the tiles written to the disk cache are synced
+    KnobChoicePtr _cacheDurability;
+
+    // Which entries are evicted first when the caches are full
+    KnobChoicePtr _cacheEvictionPolicy;
+
+    // How the memory of the tile storage is backed
+    KnobBoolPtr _cacheHugePages;
+    KnobChoicePtr _cacheNUMAPolicy;
+
+    // The address of the tile cache server shared by several machines
+    KnobStringPtr _remoteTileCacheServer;
+
     // Viewer
     KnobPagePtr _viewersTab;
     KnobChoicePtr _texturesMode;
+    KnobBoolPtr _gpuDisplayTransform;
     KnobIntPtr _checkerboardTileSize;
     KnobColorPtr _checkerboardColor1;
     KnobColorPtr _checkerboardColor2;
     KnobBoolPtr _autoWipe;
     KnobBoolPtr _autoProxyWhenScrubbingTimeline;
     KnobChoicePtr _autoProxyLevel;
+    KnobIntPtr _autoProxyTargetLatency;
+    KnobBoolPtr _progressiveViewerRender;
     KnobIntPtr _maximumNodeViewerUIOpened;
     KnobBoolPtr _viewerKeys;
 
@@ -822,6 +875,38 @@ SettingsPrivate::initializeKnobsGeneral()
     _autoSaveUnSavedProjects->setDefaultValue(false);
     _generalTab->addKnob(_autoSaveUnSavedProjects);
 
+    _projectFileFormat = _publicInterface->createKnob<KnobChoice>("projectFileFormat");
+    _projectFileFormat->setLabel(tr("Project file format"));
+    {
+        std::vector<ChoiceOption> entries;
+        assert(entries.size() == (int)SERIALIZATION_NAMESPACE::eSerializationFormatYAML);
+        entries.push_back(ChoiceOption("yaml",
+                                       tr("YAML").toStdString(),
+                                       tr("Human readable text that can be edited and merged with any text tool.").toStdString()));
+        assert(entries.size() == (int)SERIALIZATION_NAMESPACE::eSerializationFormatBinary);
+        entries.push_back(ChoiceOption("binary",
+                                       tr("Binary").toStdString(),
+                                       tr("A binary encoding of the same content, much faster to load for large projects.").toStdString()));
+        assert(entries.size() == (int)SERIALIZATION_NAMESPACE::eSerializationFormatBinaryCompressed);
+        entries.push_back(ChoiceOption("compressedBinary",
+                                       tr("Compressed binary").toStdString(),
+                                       tr("Same as Binary but the file is also compressed, making it smaller at the cost of a slightly slower save and load.").toStdString()));
+        _projectFileFormat->populateChoices(entries);
+    }
+    _projectFileFormat->setHintToolTip( tr("The format in which projects and their auto-saves are written. "
+                                           "Projects in any format can always be opened, the format is detected when loading.") );
+    _projectFileFormat->setDefaultValue( (int)SERIALIZATION_NAMESPACE::eSerializationFormatYAML );
+    _generalTab->addKnob(_projectFileFormat);
+
+    _deferGroupContentCreation = _publicInterface->createKnob<KnobBool>("deferGroupContentCreation");
+    _deferGroupContentCreation->setLabel(tr("Create the content of groups on demand"));
+    _deferGroupContentCreation->setHintToolTip( tr("When checked, the nodes inside of the groups of a project being loaded are only created "
+                                                   "when the group is connected to another node, opened or its nodes are accessed from Python. "
+                                                   "Groups containing a Write or a Viewer node are always created entirely. "
+                                                   "This makes projects with many unused groups faster to load and use less memory.") );
+    _deferGroupContentCreation->setDefaultValue(true);
+    _generalTab->addKnob(_deferGroupContentCreation);
+
     _fileDialogSavedPaths = _publicInterface->createKnob<KnobPath>("fileDialogPaths");
     _fileDialogSavedPaths->setLabel(tr("File Dialog Paths"));
     _fileDialogSavedPaths->setHintToolTip(tr("These are the paths to directories visible in the favorite view of the file dialog"));
@@ -947,6 +1032,33 @@ SettingsPrivate::initializeKnobsThreading()
     _numberOfThreads->setDefaultValue(0);
     _threadingPage->addKnob(_numberOfThreads);
 
+    _threadPlacementPolicy = _publicInterface->createKnob<KnobChoice>("threadPlacementPolicy");
+    _threadPlacementPolicy->setLabel(tr("Render threads placement"));
+    {
+        std::vector<ChoiceOption> entries;
+        assert(entries.size() == (int)eThreadPlacementPolicyNone);
+        entries.push_back(ChoiceOption("none",
+                                       tr("None").toStdString(),
+                                       tr("The render threads may run on any processor core.").toStdString()));
+        assert(entries.size() == (int)eThreadPlacementPolicyNUMANode);
+        entries.push_back(ChoiceOption("numa",
+                                       tr("NUMA node").toStdString(),
+                                       tr("Each render thread runs on the cores of a single processor, the threads are spread evenly across the processors.").toStdString()));
+        assert(entries.size() == (int)eThreadPlacementPolicyCore);
+        entries.push_back(ChoiceOption("core",
+                                       tr("Core").toStdString(),
+                                       tr("Each render thread runs on a single processor core, the threads are spread evenly across the processors.").toStdString()));
+        _threadPlacementPolicy->populateChoices(entries);
+    }
+    _threadPlacementPolicy->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                               "On machines with several processor sockets, keeping each render thread on the same processor "
+                                               "ensures that the images it renders are allocated in the memory of that processor, "
+                                               "which is faster to access. This can also be set with the --thread-placement command-line option. "
+                                               "This has no effect on machines with a single processor and is currently only supported on Linux and Windows.") );
+    _threadPlacementPolicy->setDefaultValue((int)eThreadPlacementPolicyNone);
+    _knobsRequiringRestart.insert(_threadPlacementPolicy);
+    _threadingPage->addKnob(_threadPlacementPolicy);
+
 
     _renderInSeparateProcess = _publicInterface->createKnob<KnobBool>("renderNewProcess");
     _renderInSeparateProcess->setLabel(tr("Render in a separate process"));
@@ -959,6 +1071,15 @@ SettingsPrivate::initializeKnobsThreading()
     _queueRenders->setHintToolTip( tr("When checked, renders will be queued in the Progress Panel and will start only when all "
                                       "other prior tasks are done.") );
     _threadingPage->addKnob(_queueRenders);
+
+    _renderWritersConcurrently = _publicInterface->createKnob<KnobBool>("renderWritersConcurrently");
+    _renderWritersConcurrently->setLabel(tr("Render Write nodes concurrently"));
+    _renderWritersConcurrently->setHintToolTip( tr("When checked, the Write nodes launched by a same render request (such as "
+                                                   "Render All Writers or several -w options on the command line) render at the same "
+                                                   "time, sharing the threads and the cache, even if renders are queued. The nodes "
+                                                   "shared by several of these Write nodes are cached so that they are "
+                                                   "computed once per frame for all of them.") );
+    _threadingPage->addKnob(_renderWritersConcurrently);
 } // Settings::initializeKnobsThreading
 
 void
@@ -995,6 +1116,18 @@ SettingsPrivate::initializeKnobsRendering()
                                                                "transformations.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _activateTransformConcatenationSupport->setDefaultValue(true);
     _renderingPage->addKnob(_activateTransformConcatenationSupport);
+
+    _streamingRenderStripeMPix = _publicInterface->createKnob<KnobInt>("streamingRenderStripeMPix");
+    _streamingRenderStripeMPix->setLabel(tr("Streaming render stripe size (MPix)"));
+    _streamingRenderStripeMPix->disableSlider();
+    _streamingRenderStripeMPix->setRange(0, INT_MAX);
+    _streamingRenderStripeMPix->setHintToolTip( tr("When the node at the bottom of a render supports tiles and renders an area larger than this many megapixels, "
+                                                   "it is rendered in horizontal stripes of at most this size, one after the other. "
+                                                   "The nodes upstream then only render the area needed by the current stripe and their images are released "
+                                                   "between stripes, so that the memory used does not grow with the size of the output format. "
+                                                   "Set to 0 to disable.") );
+    _streamingRenderStripeMPix->setDefaultValue(64);
+    _renderingPage->addKnob(_streamingRenderStripeMPix);
 }
 
 void
@@ -1002,12 +1135,17 @@ SettingsPrivate::populateOpenGLRenderers(const std::list<OpenGLRendererInfo>& re
 {
     if ( renderers.empty() ) {
         _availableOpenGLRenderers->setSecret(true);
+        _useAllOpenGLRenderers->setSecret(true);
         _nOpenGLContexts->setSecret(true);
         _enableOpenGL->setSecret(true);
+        _adaptiveRenderBackend->setSecret(true);
+        _gpuImageCacheSizeMB->setSecret(true);
     } else {
 
         _nOpenGLContexts->setSecret(false);
         _enableOpenGL->setSecret(false);
+        _adaptiveRenderBackend->setSecret(false);
+        _gpuImageCacheSizeMB->setSecret(false);
 
         std::vector<ChoiceOption> entries( renderers.size() );
         int i = 0;
@@ -1017,6 +1155,7 @@ SettingsPrivate::populateOpenGLRenderers(const std::list<OpenGLRendererInfo>& re
         }
         _availableOpenGLRenderers->populateChoices(entries);
         _availableOpenGLRenderers->setSecret(renderers.size() == 1);
+        _useAllOpenGLRenderers->setSecret(renderers.size() == 1);
     }
 
 #ifdef HAVE_OSMESA
@@ -1057,6 +1196,22 @@ Settings::isOpenGLRenderingEnabled() const
     return enableOpenGL == eEnableOpenGLEnabled || (enableOpenGL == eEnableOpenGLDisabledIfBackground && !appPTR->isBackground());
 }
 
+bool
+Settings::isAdaptiveRenderBackendEnabled() const
+{
+    return !_imp->_adaptiveRenderBackend->getIsSecret() && _imp->_adaptiveRenderBackend->getValue();
+}
+
+std::size_t
+Settings::getGPUImageCacheSize() const
+{
+    if ( _imp->_gpuImageCacheSizeMB->getIsSecret() ) {
+        return 0;
+    }
+
+    return (std::size_t)std::max(_imp->_gpuImageCacheSizeMB->getValue(), 0) * 1024 * 1024;
+}
+
 int
 Settings::getMaxOpenGLContexts() const
 {
@@ -1086,6 +1241,26 @@ Settings::getActiveOpenGLRendererID() const
     return GLRendererID();
 }
 
+void
+Settings::getOpenGLRenderersForRendering(std::vector<GLRendererID>* renderers) const
+{
+    renderers->clear();
+    if ( _imp->_useAllOpenGLRenderers->getIsSecret() || !_imp->_useAllOpenGLRenderers->getValue() ) {
+        renderers->push_back( getActiveOpenGLRendererID() );
+        return;
+    }
+
+    // Start with the active renderer so that it gets the first renders
+    const GLRendererID activeRenderer = getActiveOpenGLRendererID();
+    renderers->push_back(activeRenderer);
+    const std::list<OpenGLRendererInfo>& infos = appPTR->getOpenGLRenderers();
+    for (std::list<OpenGLRendererInfo>::const_iterator it = infos.begin(); it != infos.end(); ++it) {
+        if ( (it->rendererID.renderID != activeRenderer.renderID) || (it->rendererID.rendererHandle != activeRenderer.rendererHandle) ) {
+            renderers->push_back(it->rendererID);
+        }
+    }
+}
+
 void
 SettingsPrivate::initializeKnobsGPU()
 {
@@ -1107,6 +1282,19 @@ SettingsPrivate::initializeKnobsGPU()
     _knobsRequiringRestart.insert(_availableOpenGLRenderers);
     _gpuPage->addKnob(_availableOpenGLRenderers);
 
+    _useAllOpenGLRenderers = _publicInterface->createKnob<KnobBool>("useAllOpenGLRenderers");
+    _useAllOpenGLRenderers->setLabel(tr("Use all GPUs"));
+    _useAllOpenGLRenderers->setHintToolTip( tr("When checked, OpenGL contexts are created on all the GPUs of the computer and each frame "
+                                               "is rendered on the GPU that has the fewest frames rendering, so that playback and sequence "
+                                               "renders of OpenGL plug-ins scale with the number of graphic cards. "
+                                               "The images of a frame stay on the GPU that rendered it. "
+                                               "When unchecked, only the OpenGL renderer selected above is used.") +
+                                            QLatin1Char('\n') +
+                                            tr("Changing this requires a restart of the application to take effect.") );
+    _useAllOpenGLRenderers->setDefaultValue(false);
+    _knobsRequiringRestart.insert(_useAllOpenGLRenderers);
+    _gpuPage->addKnob(_useAllOpenGLRenderers);
+
     _osmesaRenderers = _publicInterface->createKnob<KnobChoice>("cpuOpenGLRenderer");
     _osmesaRenderers->setLabel(tr("CPU OpenGL renderer"));
     _knobsRequiringRestart.insert(_osmesaRenderers);
@@ -1158,6 +1346,28 @@ SettingsPrivate::initializeKnobsGPU()
 #endif
     _gpuPage->addKnob(_enableOpenGL);
 
+    _adaptiveRenderBackend = _publicInterface->createKnob<KnobBool>("adaptiveRenderBackend");
+    _adaptiveRenderBackend->setLabel(tr("Choose GPU or CPU From Timings"));
+    _adaptiveRenderBackend->setHintToolTip( tr("When checked, plug-ins that can render both on the GPU and on the CPU are rendered "
+                                               "on the device that was the fastest for them so far, given the size of the area to render "
+                                               "and the time it takes to move their input and output images between the RAM and the GPU. "
+                                               "Each device is tried at least once per node. "
+                                               "When unchecked, the GPU is always used when possible.") );
+    _adaptiveRenderBackend->setDefaultValue(false);
+    _gpuPage->addKnob(_adaptiveRenderBackend);
+
+    _gpuImageCacheSizeMB = _publicInterface->createKnob<KnobInt>("gpuImageCacheSizeMB");
+    _gpuImageCacheSizeMB->setLabel(tr("GPU Image Cache Size (MiB)"));
+    _gpuImageCacheSizeMB->setRange(0, INT_MAX);
+    _gpuImageCacheSizeMB->setDisplayRange(0, 4096);
+    _gpuImageCacheSizeMB->setHintToolTip( tr("The amount of video memory used to keep the images rendered with OpenGL, so that they "
+                                             "are not rendered again when they are needed by another render. "
+                                             "When this size is exceeded, the least recently used images are moved to the image cache in RAM. "
+                                             "Set to 0 to disable: plug-ins that can render on the CPU are then rendered on the CPU "
+                                             "when their image should be cached.") );
+    _gpuImageCacheSizeMB->setDefaultValue(512);
+    _gpuPage->addKnob(_gpuImageCacheSizeMB);
+
 }
 
 void
@@ -1997,6 +2207,17 @@ SettingsPrivate::initializeKnobsViewers()
     _texturesMode->setDefaultValue(0);
     _viewersTab->addKnob(_texturesMode);
 
+    _gpuDisplayTransform = _publicInterface->createKnob<KnobBool>("gpuDisplayTransform");
+    _gpuDisplayTransform->setLabel(tr("Apply display transform on the GPU"));
+    _gpuDisplayTransform->setHintToolTip( tr("When checked and the viewer textures are 32-bit floating-point, the viewer uploads "
+                                             "linear images and applies the gain, gamma, display colorspace and R, G, B or luminance "
+                                             "channel selection when drawing them."
+                                             " Changing these viewer parameters then only redraws the viewer instead of re-processing "
+                                             "the image on the CPU, and the cached viewer images are shared across all their values."
+                                             " The alpha and matte channels as well as the auto-contrast are still processed by the CPU.") );
+    _gpuDisplayTransform->setDefaultValue(false);
+    _viewersTab->addKnob(_gpuDisplayTransform);
+
     _checkerboardTileSize = _publicInterface->createKnob<KnobInt>("checkerboardTileSize");
     _checkerboardTileSize->setLabel(tr("Checkerboard tile size (pixels)"));
     _checkerboardTileSize->setRange(1, INT_MAX);
@@ -2056,6 +2277,28 @@ SettingsPrivate::initializeKnobsViewers()
 
     _viewersTab->addKnob(_autoProxyLevel);
 
+    _autoProxyTargetLatency = _publicInterface->createKnob<KnobInt>("autoProxyTargetLatency");
+    _autoProxyTargetLatency->setLabel(tr("Auto-proxy target latency (ms)"));
+    _autoProxyTargetLatency->setHintToolTip( tr("When strictly positive, the proxy level used while interacting is chosen for each render "
+                                                "from the recent render times of the viewer so that a frame takes about this many milliseconds, "
+                                                "up to the auto-proxy level. The image is rendered at full resolution again once "
+                                                "the interaction stops.\n"
+                                                "When 0, the auto-proxy level is always used.") );
+    _autoProxyTargetLatency->setRange(0, INT_MAX);
+    _autoProxyTargetLatency->setDisplayRange(0, 500);
+    _autoProxyTargetLatency->setDefaultValue(0);
+
+    _viewersTab->addKnob(_autoProxyTargetLatency);
+
+    _progressiveViewerRender = _publicInterface->createKnob<KnobBool>("progressiveViewerRender");
+    _progressiveViewerRender->setLabel(tr("Progressive rendering"));
+    _progressiveViewerRender->setHintToolTip( tr("When checked and the recent renders of a viewer were slow, the viewer first renders "
+                                                 "and displays a low resolution image of the current frame, then finer ones "
+                                                 "until the full resolution image is displayed.") );
+    _progressiveViewerRender->setDefaultValue(true);
+
+    _viewersTab->addKnob(_progressiveViewerRender);
+
     _maximumNodeViewerUIOpened = _publicInterface->createKnob<KnobInt>("maxNodeUiOpened");
     _maximumNodeViewerUIOpened->setLabel(tr("Max. opened node viewer interface"));
     _maximumNodeViewerUIOpened->setRange(1, INT_MAX);
@@ -2170,7 +2413,7 @@ SettingsPrivate::initializeKnobsCaching()
     _maxDiskCacheSizeGb->disableSlider();
 
     // The disk should at least allow storage of 1000 tiles accross each bucket
-    std::size_t cacheMinSize = NATRON_TILE_SIZE_BYTES;
+    std::size_t cacheMinSize = CacheBase::getTileSizeBytes(NATRON_TILE_SIZE_PO2_MIN);
     cacheMinSize = (cacheMinSize * 1024 * 256) / (1024 * 1024 * 1024);
     _maxDiskCacheSizeGb->setRange(cacheMinSize, INT_MAX);
     _maxDiskCacheSizeGb->setHintToolTip( tr("The maximum Disk size that may be used by the Cache (in GiB)") );
@@ -2178,6 +2421,14 @@ SettingsPrivate::initializeKnobsCaching()
 
     _cachingTab->addKnob(_maxDiskCacheSizeGb);
 
+    _adaptiveCacheSize = _publicInterface->createKnob<KnobBool>("adaptiveCacheSize");
+    _adaptiveCacheSize->setLabel(tr("Adapt Cache Size to Memory Pressure"));
+    _adaptiveCacheSize->setHintToolTip( tr("When checked, the Cache uses less than its maximum size when other applications need memory, "
+                                           "so that the system does not run out of memory during a render. The Cache grows back "
+                                           "to its maximum size once memory is available again.") );
+    _adaptiveCacheSize->setDefaultValue(true);
+    _cachingTab->addKnob(_adaptiveCacheSize);
+
 
     _diskCachePath = _publicInterface->createKnob<KnobPath>("diskCachePath");
     _diskCachePath->setLabel(tr("Disk Cache Path (empty = default)"));
@@ -2197,6 +2448,199 @@ SettingsPrivate::initializeKnobsCaching()
 
     _cachingTab->addKnob(_diskCachePath);
 
+    _tileSize = _publicInterface->createKnob<KnobChoice>("tileSize");
+    _tileSize->setLabel(tr("Cache Tile Size"));
+    {
+        std::vector<ChoiceOption> tileSizes;
+        for (int po2 = NATRON_TILE_SIZE_PO2_MIN; po2 <= NATRON_TILE_SIZE_PO2_MAX; ++po2) {
+            int tx8, ty8, tx32, ty32;
+            CacheBase::getTileSizePx(po2, eImageBitDepthByte, &tx8, &ty8);
+            CacheBase::getTileSizePx(po2, eImageBitDepthFloat, &tx32, &ty32);
+            std::string id = QString::number(tx8).toStdString();
+            std::string label = tr("%1x%2 (%3x%4 float)").arg(tx8).arg(ty8).arg(tx32).arg(ty32).toStdString();
+            tileSizes.push_back( ChoiceOption(id, label, "") );
+        }
+        _tileSize->populateChoices(tileSizes);
+    }
+    _tileSize->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application and wipes the disk cache.\n"
+                                  "The size in pixels of the tiles in which cached images are split, for 8-bit images. "
+                                  "Tiles of 16-bit images have half as many rows and tiles of floating-point images "
+                                  "have half as many rows and columns. Large tiles reduce the overhead of the Cache "
+                                  "when working on large images whereas small tiles waste less memory on small images.") );
+    _tileSize->setDefaultValue(NATRON_TILE_SIZE_PO2_DEFAULT - NATRON_TILE_SIZE_PO2_MIN);
+    _knobsRequiringRestart.insert(_tileSize);
+
+    _cachingTab->addKnob(_tileSize);
+
+    _compressedTilesCacheSizeMb = _publicInterface->createKnob<KnobInt>("compressedTilesCacheMb");
+    _compressedTilesCacheSizeMb->setLabel(tr("Evicted Tiles RAM Cache Size (MiB)"));
+    _compressedTilesCacheSizeMb->disableSlider();
+    _compressedTilesCacheSizeMb->setRange(0, INT_MAX);
+    _compressedTilesCacheSizeMb->setHintToolTip( tr("When the Cache is full, the least recently used images are evicted from it. "
+                                                    "Their tiles are then compressed without loss and kept in RAM up to this amount (in MiB), "
+                                                    "so that they do not have to be rendered again if the image is needed again, e.g: when "
+                                                    "scrubbing back through a sequence. Set to 0 to disable.") );
+    _compressedTilesCacheSizeMb->setDefaultValue(512);
+
+    _cachingTab->addKnob(_compressedTilesCacheSizeMb);
+
+    _imageBufferPoolSizeMb = _publicInterface->createKnob<KnobInt>("imageBufferPoolMb");
+    _imageBufferPoolSizeMb->setLabel(tr("Image Buffers Pool Size (MiB)"));
+    _imageBufferPoolSizeMb->disableSlider();
+    _imageBufferPoolSizeMb->setRange(0, INT_MAX);
+    _imageBufferPoolSizeMb->setHintToolTip( tr("The memory of the images freed after a render is kept up to this amount (in MiB) "
+                                               "to be reused by the next images of similar size, e.g: for the next frame during playback. "
+                                               "This avoids the cost of allocating and clearing memory for every frame. "
+                                               "This memory is released first when the Cache is full or when the system is low on RAM. "
+                                               "Set to 0 to disable.") );
+    _imageBufferPoolSizeMb->setDefaultValue(1024);
+    _cachingTab->addKnob(_imageBufferPoolSizeMb);
+
+    _cacheWarming = _publicInterface->createKnob<KnobBool>("cacheWarming");
+    _cacheWarming->setLabel(tr("Render Ahead of the Playhead"));
+    _cacheWarming->setHintToolTip( tr("When checked, once the Viewer is done rendering the current frame, %1 renders in the background "
+                                      "the frames following the playhead in the last playback direction, as long as the Cache has room for them. "
+                                      "Playback can then start at real-time speed. These renders are aborted as soon as another render "
+                                      "is requested, e.g: when scrubbing the timeline.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
+    _cacheWarming->setDefaultValue(true);
+
+    _cachingTab->addKnob(_cacheWarming);
+
+    _playbackBufferSizeMb = _publicInterface->createKnob<KnobInt>("playbackBufferMb");
+    _playbackBufferSizeMb->setLabel(tr("Playback Buffer Size (MiB)"));
+    _playbackBufferSizeMb->disableSlider();
+    _playbackBufferSizeMb->setRange(0, INT_MAX);
+    _playbackBufferSizeMb->setHintToolTip( tr("During playback, each Viewer keeps the frames it displayed, ready to be drawn, up to this amount of RAM (in MiB). "
+                                              "When looping over the same frame range, these frames are displayed again without rendering anything "
+                                              "so that playback runs at a stable speed. A frame is rendered again if anything it depends on changed. "
+                                              "If the range does not fit, only its first frames are kept. Set to 0 to disable.") );
+    _playbackBufferSizeMb->setDefaultValue(1024);
+
+    _cachingTab->addKnob(_playbackBufferSizeMb);
+
+    _undoRedoMemoryMb = _publicInterface->createKnob<KnobInt>("undoRedoMemoryMb");
+    _undoRedoMemoryMb->setLabel(tr("Undo/Redo Memory Budget (MiB)"));
+    _undoRedoMemoryMb->disableSlider();
+    _undoRedoMemoryMb->setRange(1, INT_MAX);
+    _undoRedoMemoryMb->setHintToolTip( tr("The amount of RAM (in MiB) that the undo/redo history of all panels may use. "
+                                          "When an action makes the history exceed this budget, the undo/redo history of the panel "
+                                          "on which the action was made is cleared.") );
+    _undoRedoMemoryMb->setDefaultValue(256);
+    _cachingTab->addKnob(_undoRedoMemoryMb);
+
+    _undoRedoMemoryUsage = _publicInterface->createKnob<KnobString>("undoRedoMemoryUsage");
+    _undoRedoMemoryUsage->setLabel(tr("Undo/Redo Memory Used"));
+    _undoRedoMemoryUsage->setHintToolTip( tr("The RAM currently used by the undo/redo history of all panels") );
+    _undoRedoMemoryUsage->setAsLabel();
+    _undoRedoMemoryUsage->setDefaultValue( printAsRAM(0).toStdString() );
+    _cachingTab->addKnob(_undoRedoMemoryUsage);
+
+    _renderMemoryBudgetMb = _publicInterface->createKnob<KnobInt>("renderMemoryBudgetMb");
+    _renderMemoryBudgetMb->setLabel(tr("Render Memory Budget (MiB)"));
+    _renderMemoryBudgetMb->disableSlider();
+    _renderMemoryBudgetMb->setRange(0, INT_MAX);
+    _renderMemoryBudgetMb->setHintToolTip( tr("The amount of RAM (in MiB) that the images allocated by a single render may use. "
+                                              "When a render exceeds this budget, the nodes it renders are rendered one image at a time "
+                                              "instead of concurrently, so that fewer images are held in memory at once. "
+                                              "Each node may also have its own budget in its Node tab. Set to 0 to disable.") );
+    _renderMemoryBudgetMb->setDefaultValue(0);
+    _cachingTab->addKnob(_renderMemoryBudgetMb);
+
+    _cacheDurability = _publicInterface->createKnob<KnobChoice>("diskCacheDurability");
+    _cacheDurability->setLabel(tr("Disk Cache Durability"));
+    {
+        std::vector<ChoiceOption> entries;
+        assert(entries.size() == (int)eCacheDurabilityNone);
+        entries.push_back(ChoiceOption("none",
+                                       tr("None").toStdString(),
+                                       tr("Images written to the disk cache are saved whenever the operating system decides to. "
+                                          "Images rendered shortly before a crash may be lost.").toStdString()));
+        assert(entries.size() == (int)eCacheDurabilityPeriodic);
+        entries.push_back(ChoiceOption("periodic",
+                                       tr("Periodic").toStdString(),
+                                       tr("Images written to the disk cache are saved every few seconds.").toStdString()));
+        assert(entries.size() == (int)eCacheDurabilityOnIdle);
+        entries.push_back(ChoiceOption("onIdle",
+                                       tr("On Idle").toStdString(),
+                                       tr("Images written to the disk cache are saved once rendering stops for a second.").toStdString()));
+        _cacheDurability->populateChoices(entries);
+    }
+    _cacheDurability->setHintToolTip( tr("Controls when the images written to the disk cache are saved to the disk, in a separate thread "
+                                         "so that renders never wait for the disk. When many images are rendered, they are saved "
+                                         "right away regardless of this setting.") );
+    _cacheDurability->setDefaultValue((int)eCacheDurabilityOnIdle);
+
+    _cachingTab->addKnob(_cacheDurability);
+
+    _cacheEvictionPolicy = _publicInterface->createKnob<KnobChoice>("cacheEvictionPolicy");
+    _cacheEvictionPolicy->setLabel(tr("Cache Eviction Policy"));
+    {
+        std::vector<ChoiceOption> entries;
+        assert(entries.size() == (int)eCacheEvictionPolicyLRU);
+        entries.push_back(ChoiceOption("lru",
+                                       tr("Least Recently Used").toStdString(),
+                                       tr("When the cache is full, the images that were not used for the longest time are evicted first.").toStdString()));
+        assert(entries.size() == (int)eCacheEvictionPolicyCostAware);
+        entries.push_back(ChoiceOption("costAware",
+                                       tr("Cost Aware").toStdString(),
+                                       tr("When the cache is full, images that were not used for a long time are evicted first, "
+                                          "but the images that took long to render are kept longer than the ones that are cheap "
+                                          "to render again.").toStdString()));
+        _cacheEvictionPolicy->populateChoices(entries);
+    }
+    _cacheEvictionPolicy->setHintToolTip( tr("Controls which images are removed from the caches when they are full. "
+                                             "The render time of an image is estimated from the time its node took to "
+                                             "render previous images.") );
+    _cacheEvictionPolicy->setDefaultValue((int)eCacheEvictionPolicyCostAware);
+
+    _cachingTab->addKnob(_cacheEvictionPolicy);
+
+    _cacheHugePages = _publicInterface->createKnob<KnobBool>("cacheHugePages");
+    _cacheHugePages->setLabel(tr("Use Huge Pages for the Cache"));
+    _cacheHugePages->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                        "When checked, the operating system is asked to back the memory of the image cache "
+                                        "with huge pages, which makes copying tiles faster. This is mostly effective when "
+                                        "the cache is not persistent or is located on a RAM disk (tmpfs). "
+                                        "Currently only supported on Linux, where transparent huge pages must be enabled.") );
+    _cacheHugePages->setDefaultValue(false);
+    _knobsRequiringRestart.insert(_cacheHugePages);
+
+    _cachingTab->addKnob(_cacheHugePages);
+
+    _cacheNUMAPolicy = _publicInterface->createKnob<KnobChoice>("cacheNUMAPolicy");
+    _cacheNUMAPolicy->setLabel(tr("Cache NUMA Policy"));
+    {
+        std::vector<ChoiceOption> entries;
+        assert(entries.size() == (int)eCacheNUMAPolicyDefault);
+        entries.push_back(ChoiceOption("default",
+                                       tr("Default").toStdString(),
+                                       tr("The memory of the cache is allocated on the processor of the thread that first writes to it.").toStdString()));
+        assert(entries.size() == (int)eCacheNUMAPolicyInterleave);
+        entries.push_back(ChoiceOption("interleave",
+                                       tr("Interleave").toStdString(),
+                                       tr("The memory of the cache is spread evenly across all processors.").toStdString()));
+        _cacheNUMAPolicy->populateChoices(entries);
+    }
+    _cacheNUMAPolicy->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                         "On machines with several processor sockets, controls on which processor's memory "
+                                         "the image cache lives. Interleaving avoids that all render threads compete for the memory "
+                                         "of a single processor. This has no effect on machines with a single processor and is "
+                                         "currently only supported on Linux, for a cache that is not persistent or located on a RAM disk (tmpfs).") );
+    _cacheNUMAPolicy->setDefaultValue((int)eCacheNUMAPolicyDefault);
+    _knobsRequiringRestart.insert(_cacheNUMAPolicy);
+
+    _cachingTab->addKnob(_cacheNUMAPolicy);
+
+    _remoteTileCacheServer = _publicInterface->createKnob<KnobString>("remoteTileCacheServer");
+    _remoteTileCacheServer->setLabel(tr("Remote Tile Cache Server"));
+    _remoteTileCacheServer->setHintToolTip( tr("The address (host:port) of a memcached server shared by several machines, e.g: the nodes of "
+                                               "a render farm. Images rendered by any of them are published on the server and the tiles that the "
+                                               "other machines would have to render are fetched from it instead, when their local cache does not have them. "
+                                               "If the port is omitted, 11211 is used. Leave empty to disable. "
+                                               "This parameter can be overriden by the value of the environment variable %1.").arg( QString::fromUtf8(NATRON_REMOTE_TILE_CACHE_ENV_VAR) ) );
+
+    _cachingTab->addKnob(_remoteTileCacheServer);
+
 
 } // Settings::initializeKnobsCaching
 
@@ -2574,6 +3018,9 @@ Settings::loadSettingsFromFile(LoadSettingsType loadType)
             if (_imp->_texturesMode) {
                 _imp->_texturesMode->setSecret(true);
             }
+            if (_imp->_gpuDisplayTransform) {
+                _imp->_gpuDisplayTransform->setSecret(true);
+            }
         }
 
     }
@@ -2772,15 +3219,32 @@ SettingsPrivate::restoreNumThreads()
 void
 SettingsPrivate::refreshCacheSize()
 {
-    CacheBasePtr tileCache = appPTR->getTileCache();
-    if (tileCache) {
-        tileCache->setMaximumCacheSize(_publicInterface->getTileCacheSize());
+    // The budget of the tile cache may be lowered when the system is low on memory
+    MemoryPressureMonitorThread* memoryMonitor = appPTR->getMemoryPressureMonitor();
+    if (memoryMonitor) {
+        memoryMonitor->setEnabled(_publicInterface->isAdaptiveCacheSizeEnabled());
+        memoryMonitor->setUserMaximumCacheSize(_publicInterface->getTileCacheSize());
+    } else {
+        CacheBasePtr tileCache = appPTR->getTileCache();
+        if (tileCache) {
+            tileCache->setMaximumCacheSize(_publicInterface->getTileCacheSize());
+        }
     }
 
     CacheBasePtr cache = appPTR->getGeneralPurposeCache();
     if (cache) {
         cache->setMaximumCacheSize(_publicInterface->getGeneralPurposeCacheSize());
     }
+
+    CompressedTileStorage* compressedTiles = appPTR->getCompressedTileStorage();
+    if (compressedTiles) {
+        compressedTiles->setMaximumSize(_publicInterface->getCompressedTileStorageSize());
+    }
+
+    ImageBufferPool* bufferPool = appPTR->getImageBufferPool();
+    if (bufferPool) {
+        bufferPool->setMaximumSize(_publicInterface->getImageBufferPoolSize());
+    }
 }
 
 std::size_t
@@ -2802,6 +3266,61 @@ Settings::getTileCacheSize() const
     return maxDiskBytes;
 }
 
+bool
+Settings::isAdaptiveCacheSizeEnabled() const
+{
+    return _imp->_adaptiveCacheSize->getValue();
+}
+
+std::size_t
+Settings::getCompressedTileStorageSize() const
+{
+    std::size_t kb = 1024;
+    std::size_t mb = kb * kb;
+    return (std::size_t)_imp->_compressedTilesCacheSizeMb->getValue() * mb;
+}
+
+std::size_t
+Settings::getImageBufferPoolSize() const
+{
+    std::size_t kb = 1024;
+    std::size_t mb = kb * kb;
+    return (std::size_t)_imp->_imageBufferPoolSizeMb->getValue() * mb;
+}
+
+std::size_t
+Settings::getPlaybackBufferSize() const
+{
+    std::size_t kb = 1024;
+    std::size_t mb = kb * kb;
+    return (std::size_t)_imp->_playbackBufferSizeMb->getValue() * mb;
+}
+
+std::size_t
+Settings::getUndoRedoMemoryBudget() const
+{
+    std::size_t kb = 1024;
+    std::size_t mb = kb * kb;
+    return (std::size_t)_imp->_undoRedoMemoryMb->getValue() * mb;
+}
+
+std::size_t
+Settings::getRenderMemoryBudget() const
+{
+    std::size_t kb = 1024;
+    std::size_t mb = kb * kb;
+    return (std::size_t)_imp->_renderMemoryBudgetMb->getValue() * mb;
+}
+
+void
+Settings::setUndoRedoMemoryUsage(std::size_t bytes)
+{
+    std::string usage = printAsRAM(bytes).toStdString();
+    if (usage != _imp->_undoRedoMemoryUsage->getValue()) {
+        _imp->_undoRedoMemoryUsage->setValue(usage);
+    }
+}
+
 bool
 Settings::onKnobValueChanged(const KnobIPtr& k,
                              ValueChangedReasonEnum reason,
@@ -2812,10 +3331,29 @@ Settings::onKnobValueChanged(const KnobIPtr& k,
     Q_EMIT settingChanged(k, reason);
     bool ret = true;
 
-    if ( k == _imp->_maxDiskCacheSizeGb ) {
+    if ( k == _imp->_maxDiskCacheSizeGb || k == _imp->_adaptiveCacheSize || k == _imp->_compressedTilesCacheSizeMb || k == _imp->_imageBufferPoolSizeMb ) {
         _imp->refreshCacheSize();
     }  else if ( k == _imp->_numberOfThreads ) {
         _imp->restoreNumThreads();
+    } else if ( k == _imp->_cacheDurability ) {
+        CacheFlusherThread* flusher = appPTR->getCacheFlusherThread();
+        if (flusher) {
+            flusher->setDurability( getCacheDurability() );
+        }
+    } else if ( k == _imp->_remoteTileCacheServer ) {
+        RemoteTileCache* remoteCache = appPTR->getRemoteTileCache();
+        if (remoteCache) {
+            remoteCache->setServer( getRemoteTileCacheServer() );
+        }
+    } else if ( k == _imp->_cacheEvictionPolicy ) {
+        CacheBasePtr tileCache = appPTR->getTileCache();
+        if (tileCache) {
+            tileCache->setEvictionPolicy( getCacheEvictionPolicy() );
+        }
+        CacheBasePtr cache = appPTR->getGeneralPurposeCache();
+        if (cache) {
+            cache->setEvictionPolicy( getCacheEvictionPolicy() );
+        }
     } else if ( k == _imp->_ocioConfigKnob ) {
         if (_imp->_ocioConfigKnob->getCurrentEntry().id == NATRON_CUSTOM_OCIO_CONFIG_NAME) {
             _imp->_customOcioConfigFile->setEnabled(true);
@@ -2835,12 +3373,13 @@ Settings::onKnobValueChanged(const KnobIPtr& k,
         appPTR->onQueueRendersChanged( _imp->_queueRenders->getValue() );
     } else if ( ( k == _imp->_checkerboardTileSize ) || ( k == _imp->_checkerboardColor1 ) || ( k == _imp->_checkerboardColor2 ) ) {
         appPTR->onCheckerboardSettingsChanged();
-    } else if ( k == _imp->_texturesMode &&  !_imp->_restoringSettings) {
+    } else if ( (k == _imp->_texturesMode || k == _imp->_gpuDisplayTransform) &&  !_imp->_restoringSettings) {
         appPTR->clearAllCaches();
     } else if ( ( k == _imp->_hideOptionalInputsAutomatically ) && !_imp->_restoringSettings && (reason == eValueChangedReasonUserEdited) ) {
         appPTR->toggleAutoHideGraphInputs();
     } else if ( k == _imp->_autoProxyWhenScrubbingTimeline ) {
         _imp->_autoProxyLevel->setSecret( !_imp->_autoProxyWhenScrubbingTimeline->getValue() );
+        _imp->_autoProxyTargetLatency->setSecret( !_imp->_autoProxyWhenScrubbingTimeline->getValue() );
     }  else if ( k == _imp->_hostName ) {
         ChoiceOption hostName = _imp->_hostName->getCurrentEntry();
         bool isCustom = hostName.id == NATRON_CUSTOM_HOST_NAME_ENTRY;
@@ -2910,6 +3449,22 @@ Settings::getViewersBitDepth() const
     }
 }
 
+KnobBoolPtr
+Settings::getGPUDisplayTransformKnob() const
+{
+    return _imp->_gpuDisplayTransform;
+}
+
+bool
+Settings::isGPUDisplayTransformEnabled() const
+{
+    // The display transform can only be deferred to the viewer if it receives linear floating-point textures
+    if (getViewersBitDepth() != eImageBitDepthFloat) {
+        return false;
+    }
+    return _imp->_gpuDisplayTransform->getValue();
+}
+
 int
 Settings::getCheckerboardTileSize() const
 {
@@ -2958,6 +3513,18 @@ Settings::getAutoProxyMipMapLevel() const
     return (unsigned int)_imp->_autoProxyLevel->getValue() + 1;
 }
 
+double
+Settings::getAutoProxyTargetLatency() const
+{
+    return _imp->_autoProxyTargetLatency->getValue() / 1000.;
+}
+
+bool
+Settings::isProgressiveViewerRenderEnabled() const
+{
+    return _imp->_progressiveViewerRender->getValue();
+}
+
 int
 Settings::getMaxOpenedNodesViewerContext() const
 {
@@ -2979,12 +3546,59 @@ Settings::getDiskCachePath() const
     return _imp->_diskCachePath->getValue();
 }
 
+int
+Settings::getTileSizePo2() const
+{
+    return NATRON_TILE_SIZE_PO2_MIN + std::max(0, std::min(_imp->_tileSize->getValue(), NATRON_TILE_SIZE_PO2_MAX - NATRON_TILE_SIZE_PO2_MIN));
+}
+
 bool
 Settings::isAggressiveCachingEnabled() const
 {
     return _imp->_aggressiveCaching->getValue();
 }
 
+bool
+Settings::isCacheWarmingEnabled() const
+{
+    return _imp->_cacheWarming->getValue();
+}
+
+CacheDurabilityEnum
+Settings::getCacheDurability() const
+{
+    return (CacheDurabilityEnum)_imp->_cacheDurability->getValue();
+}
+
+CacheEvictionPolicyEnum
+Settings::getCacheEvictionPolicy() const
+{
+    return (CacheEvictionPolicyEnum)_imp->_cacheEvictionPolicy->getValue();
+}
+
+bool
+Settings::isCacheHugePagesEnabled() const
+{
+    return _imp->_cacheHugePages->getValue();
+}
+
+CacheNUMAPolicyEnum
+Settings::getCacheNUMAPolicy() const
+{
+    return (CacheNUMAPolicyEnum)_imp->_cacheNUMAPolicy->getValue();
+}
+
+std::string
+Settings::getRemoteTileCacheServer() const
+{
+    // The environment variable makes it easy to configure all the nodes of a render farm
+    QByteArray envVar = qgetenv(NATRON_REMOTE_TILE_CACHE_ENV_VAR);
+    if ( !envVar.isEmpty() ) {
+        return std::string( envVar.constData() );
+    }
+    return _imp->_remoteTileCacheServer->getValue();
+}
+
 bool
 Settings::getColorPickerLinear() const
 {
@@ -3003,6 +3617,12 @@ Settings::setNumberOfThreads(int threadsNb)
     _imp->_numberOfThreads->setValue(threadsNb);
 }
 
+ThreadPlacementPolicyEnum
+Settings::getThreadPlacementPolicy() const
+{
+    return (ThreadPlacementPolicyEnum)_imp->_threadPlacementPolicy->getValue();
+}
+
 bool
 Settings::isAutoPreviewOnForNewProjects() const
 {
@@ -3330,6 +3950,18 @@ Settings::isAutoSaveEnabledForUnsavedProjects() const
     return _imp->_autoSaveUnSavedProjects->getValue();
 }
 
+SERIALIZATION_NAMESPACE::SerializationFormatEnum
+Settings::getProjectFileFormat() const
+{
+    return (SERIALIZATION_NAMESPACE::SerializationFormatEnum)_imp->_projectFileFormat->getValue();
+}
+
+bool
+Settings::isGroupContentCreationDeferred() const
+{
+    return _imp->_deferGroupContentCreation->getValue();
+}
+
 bool
 Settings::isSnapToNodeEnabled() const
 {
@@ -3620,6 +4252,12 @@ Settings::isTransformConcatenationEnabled() const
     return _imp->_activateTransformConcatenationSupport->getValue();
 }
 
+std::size_t
+Settings::getStreamingRenderStripeSize() const
+{
+    return (std::size_t)_imp->_streamingRenderStripeMPix->getValue() * 1024 * 1024;
+}
+
 bool
 Settings::useInputAForMergeAutoConnect() const
 {
@@ -4170,6 +4808,12 @@ Settings::isRenderQueuingEnabled() const
     return _imp->_queueRenders->getValue();
 }
 
+bool
+Settings::isRenderWritersConcurrentlyEnabled() const
+{
+    return _imp->_renderWritersConcurrently->getValue();
+}
+
 bool
 Settings::isFileDialogEnabledForNewWriters() const
 {
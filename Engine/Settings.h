@@ -128,12 +128,46 @@ public:
 
     std::size_t getTileCacheSize() const;
 
+    /**
+     * @brief Returns whether the budget of the tile cache is lowered when the system is low on memory, @see MemoryPressureMonitorThread
+     **/
+    bool isAdaptiveCacheSizeEnabled() const;
+
+    std::size_t getCompressedTileStorageSize() const;
+
+    /**
+     * @brief Returns the maximum amount of RAM (in bytes) of the idle buffers kept for reuse, @see ImageBufferPool
+     **/
+    std::size_t getImageBufferPoolSize() const;
+
+    /**
+     * @brief Returns the RAM allowed for the display-ready frames kept by each viewer during playback, in bytes
+     **/
+    std::size_t getPlaybackBufferSize() const;
+
+    /**
+     * @brief Returns the RAM allowed for the undo/redo history of all panels, in bytes
+     **/
+    std::size_t getUndoRedoMemoryBudget() const;
+
+    /**
+     * @brief Returns the RAM allowed for the images allocated by a single render in bytes, 0 if unlimited
+     **/
+    std::size_t getRenderMemoryBudget() const;
+
+    /**
+     * @brief Reports the RAM currently used by the undo/redo history of all panels in the preferences
+     **/
+    void setUndoRedoMemoryUsage(std::size_t bytes);
+
     bool getColorPickerLinear() const;
 
     int getNumberOfThreads() const;
 
     void setNumberOfThreads(int threadsNb);
 
+    ThreadPlacementPolicyEnum getThreadPlacementPolicy() const;
+
     void populateSystemFonts(const std::vector<std::string>& fonts);
     
     bool doesKnobChangeRequireRestart(const KnobIPtr& knob);
@@ -185,6 +219,8 @@ public:
 
     void setRenderQueuingEnabled(bool enabled);
 
+    bool isRenderWritersConcurrentlyEnabled() const;
+
     void restoreAllSettingsToDefaults();
 
     void restorePageToDefaults(const KnobPagePtr& tab);
@@ -195,6 +231,10 @@ public:
 
     bool isAutoSaveEnabledForUnsavedProjects() const;
 
+    SERIALIZATION_NAMESPACE::SerializationFormatEnum getProjectFileFormat() const;
+
+    bool isGroupContentCreationDeferred() const;
+
     bool isSnapToNodeEnabled() const;
 
     bool isCheckForUpdatesEnabled() const;
@@ -257,12 +297,18 @@ public:
     // "Viewers" pane
     KnobChoicePtr getViewerBitDepthKnob() const;
     ImageBitDepthEnum getViewersBitDepth() const;
+    KnobBoolPtr getGPUDisplayTransformKnob() const;
+    bool isGPUDisplayTransformEnabled() const;
     int getCheckerboardTileSize() const;
     void getCheckerboardColor1(double* r, double* g, double* b, double* a) const;
     void getCheckerboardColor2(double* r, double* g, double* b, double* a) const;
     bool isAutoWipeEnabled() const;
     bool isAutoProxyEnabled() const;
     unsigned int getAutoProxyMipMapLevel() const;
+
+    // In seconds, 0 if the auto-proxy level is not adaptive
+    double getAutoProxyTargetLatency() const;
+    bool isProgressiveViewerRenderEnabled() const;
     int getMaxOpenedNodesViewerContext() const;
     bool isViewerKeysEnabled() const;
     ///////////////////////////////////////////////////////
@@ -271,6 +317,11 @@ public:
 
     bool isTransformConcatenationEnabled() const;
 
+    /**
+     * @brief Returns the maximum number of pixels of a stripe of a streaming render, 0 if streaming renders are disabled
+     **/
+    std::size_t getStreamingRenderStripeSize() const;
+
     bool useInputAForMergeAutoConnect() const;
 
     /**
@@ -285,6 +336,26 @@ public:
 
     bool isAggressiveCachingEnabled() const;
 
+    /**
+     * @brief Returns the tile size of the tile cache, @see CacheBase::getTileSizePo2()
+     **/
+    int getTileSizePo2() const;
+
+    bool isCacheWarmingEnabled() const;
+
+    CacheDurabilityEnum getCacheDurability() const;
+
+    CacheEvictionPolicyEnum getCacheEvictionPolicy() const;
+
+    bool isCacheHugePagesEnabled() const;
+
+    CacheNUMAPolicyEnum getCacheNUMAPolicy() const;
+
+    /**
+     * @brief Returns the host:port of the remote tile cache server, or an empty string if it is disabled
+     **/
+    std::string getRemoteTileCacheServer() const;
+
     bool isAutoTurboEnabled() const;
 
     void setAutoTurboModeEnabled(bool e);
@@ -371,10 +442,28 @@ public:
 
     GLRendererID getActiveOpenGLRendererID() const;
 
+    /**
+     * @brief Returns the OpenGL renderers onto which OpenGL renders are distributed, the active renderer first.
+     * This is only the active renderer unless the user enabled all GPUs.
+     **/
+    void getOpenGLRenderersForRendering(std::vector<GLRendererID>* renderers) const;
+
     bool isOpenGLRenderingEnabled() const;
 
+    /**
+     * @brief When true, plug-ins rendering both with OpenGL and on the CPU use the backend that rendered them the fastest so far,
+     * @see EffectInstance::Implementation::resolveRenderBackend
+     **/
+    bool isAdaptiveRenderBackendEnabled() const;
+
     GLRendererID getOpenGLCPUDriver() const;
 
+    /**
+     * @brief Returns the number of bytes of textures the GPU image cache may hold, 0 if OpenGL renders are not cached
+     * @see GPUImageCache
+     **/
+    std::size_t getGPUImageCacheSize() const;
+
     int getMaxOpenGLContexts() const;
 
     bool isDriveLetterToUNCPathConversionEnabled() const;
@@ -0,0 +1,66 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_SMALLVECTOR_H
+#define NATRON_ENGINE_SMALLVECTOR_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/version.hpp>
+#if BOOST_VERSION >= 105800
+#define NATRON_HAS_SMALL_VECTOR
+GCC_DIAG_OFF(unused-parameter)
+#include <boost/container/small_vector.hpp>
+GCC_DIAG_ON(unused-parameter)
+#endif
+#endif
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A vector that stores its first N elements inline and only allocates on the heap beyond.
+ * This is for the containers of the render paths that are filled on each call and usually hold
+ * only a few elements, e.g. the rectangles to render.
+ * Use SmallVector<T, N>::type. With a boost older than 1.58 this is a std::vector.
+ **/
+template <typename T, std::size_t N>
+struct SmallVector
+{
+#ifdef NATRON_HAS_SMALL_VECTOR
+    typedef boost::container::small_vector<T, N> type;
+#else
+    typedef std::vector<T> type;
+#endif
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_SMALLVECTOR_H
@@ -0,0 +1,225 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "StartupProfiler.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <QtCore/QMutex>
+
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class StartupProfilerData
+{
+public:
+
+    QMutex mutex;
+
+    // Protected by mutex
+    bool enabled;
+
+    TimeLapse clock;
+
+    // The time of the clock when profiling was enabled, the phases start times are relative to it
+    double enabledTime;
+
+    // All the phases, in the order they were started
+    std::vector<StartupProfiler::PhaseStats> phases;
+
+    // The indices in phases of the running phases, the last one being the innermost
+    std::vector<std::size_t> runningPhases;
+
+    StartupProfilerData()
+    : mutex()
+    , enabled(false)
+    , clock()
+    , enabledTime(0)
+    , phases()
+    , runningPhases()
+    {
+    }
+
+    double getTime() const
+    {
+        return clock.getTimeSinceCreation() - enabledTime;
+    }
+};
+
+StartupProfilerData&
+getProfilerData()
+{
+    static StartupProfilerData data;
+
+    return data;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+StartupProfiler::setEnabled(bool enabled)
+{
+    StartupProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.mutex);
+
+    if (enabled && !data.enabled) {
+        data.enabledTime = data.clock.getTimeSinceCreation();
+        data.phases.clear();
+        data.runningPhases.clear();
+    }
+    data.enabled = enabled;
+}
+
+bool
+StartupProfiler::isEnabled()
+{
+    StartupProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.mutex);
+
+    return data.enabled;
+}
+
+void
+StartupProfiler::beginPhase(const std::string& name)
+{
+    StartupProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.mutex);
+
+    if (!data.enabled) {
+        return;
+    }
+    PhaseStats phase;
+    phase.name = name;
+    phase.depth = (int)data.runningPhases.size();
+    phase.startTime = data.getTime();
+    data.runningPhases.push_back( data.phases.size() );
+    data.phases.push_back(phase);
+}
+
+void
+StartupProfiler::endPhase()
+{
+    StartupProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.mutex);
+
+    if ( !data.enabled || data.runningPhases.empty() ) {
+        return;
+    }
+    PhaseStats& phase = data.phases[data.runningPhases.back()];
+    phase.duration = data.getTime() - phase.startTime;
+    data.runningPhases.pop_back();
+}
+
+void
+StartupProfiler::getPhases(std::vector<PhaseStats>* phases)
+{
+    StartupProfilerData& data = getProfilerData();
+    QMutexLocker k(&data.mutex);
+
+    *phases = data.phases;
+}
+
+std::string
+StartupProfiler::getReport()
+{
+    std::vector<PhaseStats> phases;
+    getPhases(&phases);
+
+    double totalTime;
+    {
+        StartupProfilerData& data = getProfilerData();
+        QMutexLocker k(&data.mutex);
+        totalTime = data.getTime();
+    }
+
+    // Times are printed in milliseconds
+    std::stringstream ss;
+    ss << std::left << std::setw(48) << "Startup phase" << std::right
+       << std::setw(14) << "Start (ms)"
+       << std::setw(14) << "Time (ms)"
+       << std::setw(10) << "%" << '\n';
+    ss << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < phases.size(); ++i) {
+        const PhaseStats& p = phases[i];
+        ss << std::left << std::setw(48) << ( std::string(p.depth * 2, ' ') + p.name ) << std::right
+           << std::setw(14) << p.startTime * 1000.;
+        if (p.duration >= 0) {
+            ss << std::setw(14) << p.duration * 1000.
+               << std::setw(10) << (totalTime > 0 ? p.duration * 100. / totalTime : 0.);
+        } else {
+            ss << std::setw(14) << "-"
+               << std::setw(10) << "-";
+        }
+        ss << '\n';
+    }
+    ss << std::left << std::setw(48) << "Total" << std::right
+       << std::setw(14) << 0.
+       << std::setw(14) << totalTime * 1000.
+       << std::setw(10) << 100. << '\n';
+
+    return ss.str();
+} // getReport
+
+void
+StartupProfiler::finish()
+{
+    {
+        StartupProfilerData& data = getProfilerData();
+        QMutexLocker k(&data.mutex);
+        if (!data.enabled) {
+            return;
+        }
+        const double time = data.getTime();
+        for (std::size_t i = 0; i < data.runningPhases.size(); ++i) {
+            PhaseStats& phase = data.phases[data.runningPhases[i]];
+            phase.duration = time - phase.startTime;
+        }
+        data.runningPhases.clear();
+    }
+    std::cout << getReport() << std::endl;
+    setEnabled(false);
+}
+
+StartupPhase_RAII::StartupPhase_RAII(const std::string& name)
+: _profiled( StartupProfiler::isEnabled() )
+{
+    if (_profiled) {
+        StartupProfiler::beginPhase(name);
+    }
+}
+
+StartupPhase_RAII::~StartupPhase_RAII()
+{
+    if (_profiled) {
+        StartupProfiler::endPhase();
+    }
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,119 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_StartupProfiler_h
+#define Engine_StartupProfiler_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Records the time spent in each phase of the launch of the application: OpenGL, Python, settings,
+ * caches, plug-ins, fonts, project... Profiling is enabled with the --startup-profile command-line option
+ * and the report is printed by finish(), once the project is loaded and before it is rendered.
+ *
+ * Phases may be nested: a phase started while another one is running is a sub-phase of it.
+ * Phases must be started and ended from the main thread.
+ **/
+class StartupProfiler
+{
+public:
+
+    struct PhaseStats
+    {
+        std::string name;
+
+        // The number of phases this phase is nested in
+        int depth;
+
+        // In seconds, since profiling was enabled
+        double startTime;
+
+        // In seconds, -1 while the phase is running
+        double duration;
+
+        PhaseStats()
+        : name()
+        , depth(0)
+        , startTime(0)
+        , duration(-1)
+        {
+        }
+    };
+
+    /**
+     * @brief Enabling profiling starts the clock of the launch
+     **/
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    static void beginPhase(const std::string& name);
+
+    /**
+     * @brief Ends the last phase started
+     **/
+    static void endPhase();
+
+    static void getPhases(std::vector<PhaseStats>* phases);
+
+    /**
+     * @brief Returns the phases in the order they were started with their duration, sub-phases being indented
+     **/
+    static std::string getReport();
+
+    /**
+     * @brief Ends the running phases, prints the report and disables profiling. This does nothing if profiling
+     * is not enabled, so that only the first call prints the report.
+     **/
+    static void finish();
+};
+
+/**
+ * @brief Records a phase of the launch for the lifetime of this object when startup profiling is enabled
+ **/
+class StartupPhase_RAII
+{
+public:
+
+    StartupPhase_RAII(const std::string& name);
+
+    ~StartupPhase_RAII();
+
+private:
+
+    // True if the phase was started: it is not ended if profiling was enabled in the meantime
+    bool _profiled;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_StartupProfiler_h
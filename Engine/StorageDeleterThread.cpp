@@ -34,7 +34,10 @@
 #endif
 #include "Engine/AppManager.h"
 #include "Engine/Cache.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/ImageStorage.h"
+#include "Engine/MemoryInfo.h"
+#include "Engine/PluginMemory.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -117,6 +120,33 @@ StorageDeleterThread::checkCachesMemory()
     }
 }
 
+void
+StorageDeleterThread::trimImageBufferPool()
+{
+    ImageBufferPool* pool = appPTR->getImageBufferPool();
+    if (!pool) {
+        return;
+    }
+    std::size_t pooledBytes = pool->getCurrentSize();
+    if (pooledBytes == 0) {
+        return;
+    }
+
+    // The system is short in RAM: idle buffers are the cheapest memory to give back
+    if (getAmountFreePhysicalRAM() < pooledBytes) {
+        pool->clear();
+        return;
+    }
+
+    // Idle buffers count toward the budget of the tile cache: release them before evicting cached tiles
+    CacheBasePtr tileCache = appPTR->getTileCache();
+    std::size_t maxSize = tileCache->getMaximumCacheSize();
+    std::size_t curSize = tileCache->getCurrentSize() + PluginMemory::getTotalPluginMemoryBytes();
+    if (maxSize > 0 && curSize + pooledBytes > maxSize) {
+        pool->trim(curSize + pooledBytes - maxSize);
+    }
+} // trimImageBufferPool
+
 void
 StorageDeleterThread::quitThread()
 {
@@ -146,6 +176,14 @@ StorageDeleterThread::isWorking() const
     return !_imp->entriesQueue.empty();
 }
 
+std::size_t
+StorageDeleterThread::getQueueSize() const
+{
+    QMutexLocker k(&_imp->entriesQueueMutex);
+
+    return _imp->entriesQueue.size();
+}
+
 void
 StorageDeleterThread::run()
 {
@@ -194,8 +232,11 @@ StorageDeleterThread::run()
                     front->deallocateMemory();
                 //}
             } else if (evictRequest > 0) {
+                trimImageBufferPool();
                 appPTR->getGeneralPurposeCache()->evictLRUEntries(0);
-                appPTR->getTileCache()->evictLRUEntries(0);
+
+                // The memory held by plug-ins is accounted in the tile cache budget
+                appPTR->getTileCache()->evictLRUEntries( PluginMemory::getTotalPluginMemoryBytes() );
             }
      
         } // front. After this scope, the image is guarenteed to be freed
@@ -27,6 +27,7 @@
 
 #include "Global/Macros.h"
 
+#include <cstddef>
 #include <list>
 
 #include <QtCore/QThread>
@@ -65,10 +66,20 @@ public:
 
     bool isWorking() const;
 
+    /**
+     * @brief Returns the number of storages waiting to be deleted
+     **/
+    std::size_t getQueueSize() const;
+
 private:
 
     virtual void run() OVERRIDE FINAL;
 
+    /**
+     * @brief Releases the idle buffers of the ImageBufferPool when the caches are over budget or the system is low on RAM
+     **/
+    void trimImageBufferPool();
+
     boost::scoped_ptr<StorageDeleterThreadPrivate> _imp;
 };
 
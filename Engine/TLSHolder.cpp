@@ -37,10 +37,234 @@
 #include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
 #include <QtCore/QDebug>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
 
 
 NATRON_NAMESPACE_ENTER
 
+#ifdef NATRON_TLS_NATIVE_SLOTS
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// Allocates the indices of the slots of the holders
+class TLSSlotIndices
+{
+public:
+
+    QMutex lock;
+    std::vector<int> freeIndices;
+    int indicesCount;
+    U64 nextSerial;
+
+    TLSSlotIndices()
+    : lock()
+    , freeIndices()
+    , indicesCount(0)
+    , nextSerial(1)
+    {
+    }
+};
+
+TLSSlotIndices&
+getSlotIndices()
+{
+    // Never destroyed: holders with a static storage duration may be destroyed after it
+    static TLSSlotIndices* indices = new TLSSlotIndices;
+    return *indices;
+}
+
+QAtomicInt&
+getNativeSlotsEnabledFlag()
+{
+    static QAtomicInt enabled(1);
+    return enabled;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+/**
+ * @brief The slots of a thread, indexed by TLSHolderBase::_slotIndex
+ **/
+class TLSNativeSlots
+{
+public:
+
+    struct Slot
+    {
+        // The serial of the holder that set the value, 0 if the slot is empty
+        U64 serial;
+        boost::shared_ptr<void> value;
+        TLSHolderBaseConstWPtr holder;
+
+        Slot()
+        : serial(0)
+        , value()
+        , holder()
+        {
+        }
+    };
+
+    // The thread the data was created for, the key of the maps of the holders
+    const QThread* thread;
+    std::vector<Slot> slots;
+
+    TLSNativeSlots()
+    : thread(0)
+    , slots()
+    {
+    }
+
+    ~TLSNativeSlots()
+    {
+        // The thread exits: remove its data from the holders that still exist
+        std::vector<Slot> toClean;
+        toClean.swap(slots);
+        for (std::size_t i = 0; i < toClean.size(); ++i) {
+            if (!toClean[i].serial || !thread) {
+                continue;
+            }
+            TLSHolderBaseConstPtr holder = toClean[i].holder.lock();
+            if (holder) {
+                bool isEmpty = holder->cleanupPerThreadData(thread);
+                Q_UNUSED(isEmpty);
+            }
+        }
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+thread_local TLSNativeSlots nativeSlots;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+TLSHolderBase::TLSHolderBase()
+    : _slotIndex(0)
+    , _slotSerial(0)
+{
+    TLSSlotIndices& indices = getSlotIndices();
+    QMutexLocker k(&indices.lock);
+
+    if ( !indices.freeIndices.empty() ) {
+        _slotIndex = indices.freeIndices.back();
+        indices.freeIndices.pop_back();
+    } else {
+        _slotIndex = indices.indicesCount++;
+    }
+    _slotSerial = indices.nextSerial++;
+}
+
+TLSHolderBase::~TLSHolderBase()
+{
+    TLSSlotIndices& indices = getSlotIndices();
+    QMutexLocker k(&indices.lock);
+
+    indices.freeIndices.push_back(_slotIndex);
+}
+
+void
+TLSHolderBase::setNativeSlotsEnabled(bool enabled)
+{
+    getNativeSlotsEnabledFlag().fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+bool
+TLSHolderBase::isNativeSlotsEnabled()
+{
+#if QT_VERSION < 0x050000
+    return (int)getNativeSlotsEnabledFlag() != 0;
+#else
+    return getNativeSlotsEnabledFlag().loadAcquire() != 0;
+#endif
+}
+
+void
+TLSHolderBase::clearNativeSlots()
+{
+    // Only release the references, the data in the maps of the holders is cleaned-up by the caller
+    std::vector<TLSNativeSlots::Slot>().swap(nativeSlots.slots);
+}
+
+const boost::shared_ptr<void>*
+TLSHolderBase::findNativeSlot() const
+{
+    if ( !isNativeSlotsEnabled() ) {
+        return 0;
+    }
+    const std::vector<TLSNativeSlots::Slot>& slots = nativeSlots.slots;
+    if ( _slotIndex >= (int)slots.size() ) {
+        return 0;
+    }
+    const TLSNativeSlots::Slot& slot = slots[_slotIndex];
+    if (slot.serial != _slotSerial) {
+        return 0;
+    }
+    return &slot.value;
+}
+
+void
+TLSHolderBase::setNativeSlot(const boost::shared_ptr<void>& value,
+                             const QThread* curThread) const
+{
+    if ( !isNativeSlotsEnabled() ) {
+        return;
+    }
+    TLSNativeSlots& threadSlots = nativeSlots;
+    if (threadSlots.thread != curThread) {
+        // The slots of a thread are only used for one QThread
+        std::vector<TLSNativeSlots::Slot>().swap(threadSlots.slots);
+        threadSlots.thread = curThread;
+    }
+    if ( _slotIndex >= (int)threadSlots.slots.size() ) {
+        threadSlots.slots.resize(_slotIndex + 1);
+    }
+    TLSNativeSlots::Slot& slot = threadSlots.slots[_slotIndex];
+    slot.serial = _slotSerial;
+    slot.value = value;
+    slot.holder = shared_from_this();
+}
+
+#else // !NATRON_TLS_NATIVE_SLOTS
+
+TLSHolderBase::TLSHolderBase()
+{
+}
+
+TLSHolderBase::~TLSHolderBase()
+{
+}
+
+void
+TLSHolderBase::setNativeSlotsEnabled(bool /*enabled*/)
+{
+}
+
+bool
+TLSHolderBase::isNativeSlotsEnabled()
+{
+    return false;
+}
+
+void
+TLSHolderBase::clearNativeSlots()
+{
+}
+
+const boost::shared_ptr<void>*
+TLSHolderBase::findNativeSlot() const
+{
+    return 0;
+}
+
+void
+TLSHolderBase::setNativeSlot(const boost::shared_ptr<void>& /*value*/,
+                             const QThread* /*curThread*/) const
+{
+}
+
+#endif // NATRON_TLS_NATIVE_SLOTS
+
 
 AppTLS::AppTLS()
     : _objectMutex()
@@ -195,6 +419,8 @@ AppTLS::cleanupTLSForThread()
         _object->objects = newObjects;
 #endif
     }
+
+    TLSHolderBase::clearNativeSlots();
 } // AppTLS::cleanupTLSForThread
 
 template class TLSHolder<EffectInstanceTLSData>;
@@ -52,6 +52,12 @@
 
 #define NATRON_TLS_DISABLE_COPY
 
+// The data of the current thread is cached in slots of the compiler thread-local storage, see TLSHolderBase::findNativeSlot.
+// Define NATRON_TLS_DISABLE_NATIVE_SLOTS if the toolchain has no support for thread_local.
+#if !defined(NATRON_TLS_DISABLE_NATIVE_SLOTS) && ( __cplusplus >= 201103L || ( defined(_MSC_VER) && _MSC_VER >= 1900 ) )
+#define NATRON_TLS_NATIVE_SLOTS
+#endif
+
 
 NATRON_NAMESPACE_ENTER
 
@@ -66,13 +72,40 @@ public:
     // TODO: enable_shared_from_this
     // constructors should be privatized in any class that derives from boost::enable_shared_from_this<>
 
-    TLSHolderBase() {}
+    TLSHolderBase();
 
 public:
-    virtual ~TLSHolderBase() {}
+    virtual ~TLSHolderBase();
+
+    /**
+     * @brief When enabled, the data of the current thread is looked up in a slot of the compiler thread-local storage
+     * without taking any lock, the maps of the holders are only searched the first time a thread uses a holder.
+     * This is enabled by default if Natron was built with NATRON_TLS_NATIVE_SLOTS.
+     **/
+    static void setNativeSlotsEnabled(bool enabled);
+
+    static bool isNativeSlotsEnabled();
+
+    /**
+     * @brief Releases the slots of the current thread. They are also released when the thread exits.
+     **/
+    static void clearNativeSlots();
 
 protected:
 
+    /**
+     * @brief Returns the data of the current thread cached by setNativeSlot(), or NULL if there is none
+     * or if the native slots are disabled.
+     **/
+    const boost::shared_ptr<void>* findNativeSlot() const;
+
+    /**
+     * @brief Caches the data of the current thread, which is curThread. When the thread exits, cleanupPerThreadData() is called
+     * for curThread if this holder still exists.
+     **/
+    void setNativeSlot(const boost::shared_ptr<void>& value, const QThread* curThread) const;
+
+
     /**
      * @brief Returns true if cleanupPerThreadData would do anything OR would return true.
      * It does not return the same value as cleanupPerThreadData, since cleanupPerThreadData
@@ -93,6 +126,19 @@ protected:
      **/
     virtual void copyTLS(const QThread* fromThread, const QThread* toThread) const = 0;
 #endif
+
+private:
+
+    friend class TLSNativeSlots;
+
+#ifdef NATRON_TLS_NATIVE_SLOTS
+    // The index of the slot of this holder in the thread-local storage of each thread
+    int _slotIndex;
+
+    // Unique for the lifetime of the application: the index is reused once the holder is destroyed
+    // and the slots of the threads may still hold data of the previous holder
+    U64 _slotSerial;
+#endif
 };
 
 
@@ -122,14 +122,30 @@ template <typename T>
 boost::shared_ptr<T>
 TLSHolder<T>::getTLSData() const
 {
+    // Fast path: the data was already found once for this thread
+    const boost::shared_ptr<void>* slot = findNativeSlot();
+    if (slot) {
+        return boost::static_pointer_cast<T>(*slot);
+    }
+
     QThread* curThread  = QThread::currentThread();
-    return getTLSDataForThread(curThread);
+    boost::shared_ptr<T> ret = getTLSDataForThread(curThread);
+    if (ret) {
+        setNativeSlot(ret, curThread);
+    }
+    return ret;
 }
 
 template <typename T>
 boost::shared_ptr<T>
 TLSHolder<T>::getOrCreateTLSData() const
 {
+    // Fast path: the data was already found or created once for this thread
+    const boost::shared_ptr<void>* slot = findNativeSlot();
+    if (slot) {
+        return boost::static_pointer_cast<T>(*slot);
+    }
+
     QThread* curThread  = QThread::currentThread();
 
     //This thread might be registered by a spawner thread, copy the TLS and attempt to find the TLS for this holder.
@@ -151,10 +167,14 @@ TLSHolder<T>::getOrCreateTLSData() const
         typename ThreadDataMap::const_iterator found = perThreadDataCRef.find(curThread);
         if ( found != perThreadDataCRef.end() ) {
             assert(found->second.value);
-
-            return found->second.value;
+            ret = found->second.value;
         }
     }
+    if (ret) {
+        setNativeSlot(ret, curThread);
+
+        return ret;
+    }
 
     //getOrCreateTLSData() has never been called on the thread, lookup the TLS
     ThreadData data;
@@ -166,6 +186,7 @@ TLSHolder<T>::getOrCreateTLSData() const
         perThreadData.insert( std::make_pair(curThread, data) );
     }
     assert(data.value);
+    setNativeSlot(data.value, curThread);
     return data.value;
 }
 
@@ -28,6 +28,8 @@
 
 #include "Global/Macros.h"
 
+#include <cassert>
+
 #include "Global/GlobalDefines.h"
 #include "Engine/RectI.h"
 
@@ -89,10 +91,10 @@ public:
         case eImageBitDepthFloat:
 
             return sizeof(float);
+        case eImageBitDepthShort:
         case eImageBitDepthHalf:
 
-            // Fixme when we support half
-            return sizeof(float);
+            return sizeof(unsigned short);
         case eImageBitDepthNone:
         default:
 
@@ -117,6 +119,17 @@ public:
      */
     bool ensureTextureHasSize(const RectI & bounds, const unsigned char* originalRAMBuffer);
 
+    /**
+     * @brief Moves the texture to the given bounds which must have the same size as the current bounds,
+     * without reallocating the texture buffer. The content of the texture is left as is.
+     * This is used to reuse a pooled texture, @see OSGLContext::takePooledTexture
+     **/
+    void reuseForBounds(const RectI & bounds)
+    {
+        assert(bounds.width() == _bounds.width() && bounds.height() == _bounds.height());
+        _bounds = bounds;
+    }
+
     /**
      * @brief Update the texture with the currently bound PBO across the given rectangle.
      * @param bounds The bounds of the texture, if the texture does not match these bounds, it will be reallocated
@@ -0,0 +1,272 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ThreadPlacement.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+
+#if defined(__NATRON_WIN32__)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QThread>
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+#if defined(__linux__)
+// Parses a list of ranges as found in /sys/devices/system/node, e.g: "0-7,16-23"
+bool
+readRangeList(const char* filePath, std::vector<int>* values)
+{
+    FILE* f = std::fopen(filePath, "r");
+    if (!f) {
+        return false;
+    }
+    int first;
+    while (std::fscanf(f, "%d", &first) == 1) {
+        int last = first;
+        int c = std::fgetc(f);
+        if (c == '-') {
+            if (std::fscanf(f, "%d", &last) != 1) {
+                break;
+            }
+            c = std::fgetc(f);
+        }
+        for (int i = first; i <= last; ++i) {
+            values->push_back(i);
+        }
+        if (c != ',') {
+            break;
+        }
+    }
+    std::fclose(f);
+
+    return true;
+}
+#endif
+
+class NUMATopology
+{
+public:
+
+    // For each NUMA node that has CPUs this process may run on, the list of these CPUs
+    std::vector<std::vector<int> > nodes;
+
+    NUMATopology()
+    : nodes()
+    {
+#if defined(__linux__)
+        cpu_set_t allowedCPUs;
+        CPU_ZERO(&allowedCPUs);
+        bool hasAllowedCPUs = sched_getaffinity(0, sizeof(cpu_set_t), &allowedCPUs) == 0;
+
+        std::vector<int> nodeIndices;
+        readRangeList("/sys/devices/system/node/online", &nodeIndices);
+        for (std::size_t i = 0; i < nodeIndices.size(); ++i) {
+            char filePath[128];
+            std::snprintf(filePath, sizeof(filePath), "/sys/devices/system/node/node%d/cpulist", nodeIndices[i]);
+            std::vector<int> nodeCPUs;
+            readRangeList(filePath, &nodeCPUs);
+            std::vector<int> cpus;
+            for (std::size_t j = 0; j < nodeCPUs.size(); ++j) {
+                if ( (nodeCPUs[j] < CPU_SETSIZE) && ( !hasAllowedCPUs || CPU_ISSET(nodeCPUs[j], &allowedCPUs) ) ) {
+                    cpus.push_back(nodeCPUs[j]);
+                }
+            }
+            // Nodes with memory but no CPU cannot run threads
+            if ( !cpus.empty() ) {
+                nodes.push_back(cpus);
+            }
+        }
+#endif
+        if ( nodes.empty() ) {
+            // Consider the whole machine as a single node
+            int nCPUs = std::max(1, QThread::idealThreadCount());
+#if defined(__NATRON_WIN32__)
+            // Without processor groups, a thread can only be bound to the first 64 CPUs
+            nCPUs = std::min(nCPUs, (int)sizeof(DWORD_PTR) * 8);
+#endif
+            std::vector<int> cpus(nCPUs);
+            for (int i = 0; i < nCPUs; ++i) {
+                cpus[i] = i;
+            }
+            nodes.push_back(cpus);
+        }
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+static const NUMATopology&
+getTopology()
+{
+    static NUMATopology topology;
+
+    return topology;
+}
+
+static QAtomicInt placementPolicy( (int)eThreadPlacementPolicyNone );
+
+// Incremented for each thread that gets placed, the threads are spread in turn on each node
+static QAtomicInt nextPlacementSlot;
+
+static bool
+bindCurrentThreadToCPUs(const std::vector<int>& cpus)
+{
+    if ( cpus.empty() ) {
+        return false;
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        CPU_SET(cpus[i], &set);
+    }
+
+    // A pid of 0 is the calling thread
+    return sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+#elif defined(__NATRON_WIN32__)
+    DWORD_PTR mask = 0;
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        mask |= (DWORD_PTR)1 << cpus[i];
+    }
+
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    // macOS only supports affinity hints between threads, not binding to CPUs
+    return false;
+#endif
+}
+
+void
+ThreadPlacement::setPolicy(ThreadPlacementPolicyEnum policy)
+{
+    // Detect the topology now rather than in the first thread pool thread
+    (void)getTopology();
+    placementPolicy.fetchAndStoreOrdered( (int)policy );
+}
+
+ThreadPlacementPolicyEnum
+ThreadPlacement::getPolicy()
+{
+#if QT_VERSION < 0x050000
+    return (ThreadPlacementPolicyEnum)(int)placementPolicy;
+#else
+    return (ThreadPlacementPolicyEnum)placementPolicy.loadAcquire();
+#endif
+}
+
+int
+ThreadPlacement::getNumNUMANodes()
+{
+    return (int)getTopology().nodes.size();
+}
+
+const std::vector<int>&
+ThreadPlacement::getNUMANodeCPUs(int node)
+{
+    const NUMATopology& topology = getTopology();
+
+    assert(node >= 0 && node < (int)topology.nodes.size());
+
+    return topology.nodes[node];
+}
+
+bool
+ThreadPlacement::applyToCurrentThread()
+{
+    ThreadPlacementPolicyEnum policy = getPolicy();
+    if (policy == eThreadPlacementPolicyNone) {
+        return false;
+    }
+    const NUMATopology& topology = getTopology();
+    const int nNodes = (int)topology.nodes.size();
+    const int slot = nextPlacementSlot.fetchAndAddRelaxed(1);
+    const std::vector<int>& nodeCPUs = topology.nodes[slot % nNodes];
+
+    switch (policy) {
+    case eThreadPlacementPolicyNUMANode:
+
+        return bindCurrentThreadToCPUs(nodeCPUs);
+    case eThreadPlacementPolicyCore: {
+        // The kernel lists the first hardware thread of each core first, so the cores are used before their siblings
+        std::vector<int> cpu( 1, nodeCPUs[(slot / nNodes) % nodeCPUs.size()] );
+
+        return bindCurrentThreadToCPUs(cpu);
+    }
+    case eThreadPlacementPolicyNone:
+        break;
+    }
+
+    return false;
+} // applyToCurrentThread
+
+std::string
+ThreadPlacement::getPolicyName(ThreadPlacementPolicyEnum policy)
+{
+    switch (policy) {
+    case eThreadPlacementPolicyNone:
+
+        return "none";
+    case eThreadPlacementPolicyNUMANode:
+
+        return "numa";
+    case eThreadPlacementPolicyCore:
+
+        return "core";
+    }
+
+    return std::string();
+}
+
+bool
+ThreadPlacement::getPolicyFromName(const std::string& name,
+                                   ThreadPlacementPolicyEnum* policy)
+{
+    std::string lowerName = name;
+    for (std::size_t i = 0; i < lowerName.size(); ++i) {
+        lowerName[i] = (char)std::tolower( (unsigned char)lowerName[i] );
+    }
+    for (int i = eThreadPlacementPolicyNone; i <= eThreadPlacementPolicyCore; ++i) {
+        if ( lowerName == getPolicyName( (ThreadPlacementPolicyEnum)i ) ) {
+            *policy = (ThreadPlacementPolicyEnum)i;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+NATRON_NAMESPACE_EXIT
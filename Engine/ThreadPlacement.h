@@ -0,0 +1,86 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_ThreadPlacement_h
+#define Engine_ThreadPlacement_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Global/Enums.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Places the threads of the global thread pool on the CPUs of the machine.
+ * On machines with several NUMA nodes (e.g: processor sockets), a thread that moves to another node
+ * accesses the memory it allocated through the interconnect, which is much slower. When a placement policy
+ * is set, each new thread pool thread calls applyToCurrentThread() before running any task: the threads are
+ * bound in turn to each NUMA node, so that the memory they first touch stays local to them.
+ *
+ * The topology is only detected on Linux, the other systems are considered as a single NUMA node.
+ * Binding threads is supported on Linux and Windows.
+ **/
+class ThreadPlacement
+{
+public:
+
+    /**
+     * @brief Set the policy applied to the threads created from now on. The AppManager sets it
+     * from the settings or the --thread-placement command-line option, before the first render.
+     **/
+    static void setPolicy(ThreadPlacementPolicyEnum policy);
+
+    static ThreadPlacementPolicyEnum getPolicy();
+
+    /**
+     * @brief Returns the number of NUMA nodes this process may run on, at least 1.
+     **/
+    static int getNumNUMANodes();
+
+    /**
+     * @brief Returns the CPUs of the given NUMA node that this process may run on.
+     **/
+    static const std::vector<int>& getNUMANodeCPUs(int node);
+
+    /**
+     * @brief Binds the calling thread to the next slot of the placement policy.
+     * Returns false if there is no policy or if the thread could not be bound.
+     **/
+    static bool applyToCurrentThread();
+
+    static std::string getPolicyName(ThreadPlacementPolicyEnum policy);
+
+    /**
+     * @brief Returns the policy with the given name (case insensitive), as printed by getPolicyName().
+     **/
+    static bool getPolicyFromName(const std::string& name, ThreadPlacementPolicyEnum* policy);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_ThreadPlacement_h
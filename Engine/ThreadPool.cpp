@@ -34,6 +34,7 @@
 #include <QtCore/QThreadPool>
 
 #include "Engine/Node.h"
+#include "Engine/ThreadPlacement.h"
 #include "Engine/TreeRender.h"
 
 NATRON_NAMESPACE_ENTER
@@ -139,6 +140,15 @@ public:
     virtual bool isThreadPoolThread() const { return true; }
 
     virtual ~ThreadPoolThread() {}
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        // Bind the thread before it runs any task so that the memory it first touches is on its NUMA node
+        ThreadPlacement::applyToCurrentThread();
+        QThreadPoolThread::run();
+    }
 };
 
 NATRON_NAMESPACE_ANONYMOUS_EXIT
@@ -0,0 +1,581 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ThreadPoolMonitor.h"
+
+#include <algorithm> // max, sort
+#include <cmath> // ceil
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+#include "Engine/ThreadStorage.h"
+#include "Engine/Timer.h"
+#include "Engine/TraceRecorder.h"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct WorkerData
+{
+    std::string threadName;
+    U64 nTasks;
+    double firstSeenTime;
+    double busyTime;
+    double releasedTime;
+
+    // The tasks the worker is running and since when it runs them
+    int runningTasks;
+    double busySince;
+
+    WorkerData()
+    : threadName()
+    , nTasks(0)
+    , firstSeenTime(0)
+    , busyTime(0)
+    , releasedTime(0)
+    , runningTasks(0)
+    , busySince(0)
+    {
+    }
+};
+
+// The releases of a thread that are counted, in the order they were made
+struct ThreadState
+{
+    std::vector<double> releaseStartTimes;
+};
+
+class ThreadPoolMonitorData
+{
+public:
+
+    QAtomicInt enabled;
+
+    TimeLapse clock;
+
+    ThreadStorage<ThreadState> threadState;
+
+    // Protects all the members below
+    QMutex lock;
+
+    double resetTime;
+
+    ThreadPoolMonitor::Gauges gauges, maxGauges;
+
+    // The integrals of the gauges over time since the reset
+    double lastChangeTime;
+    double queuedArea, runningArea, waitingForTilesArea, releasedArea;
+
+    U64 nTasks;
+    double totalQueueLatency, maxQueueLatency;
+
+    // The queue latencies of the most recent tasks, in a circular buffer
+    std::vector<double> recentQueueLatencies;
+    std::size_t nextQueueLatency;
+
+    double totalWaitingForTilesTime, totalReleasedTime;
+
+    std::map<QThread*, WorkerData> workers;
+
+    ThreadPoolMonitorData()
+    : enabled()
+    , clock()
+    , threadState()
+    , lock()
+    , resetTime(0)
+    , gauges()
+    , maxGauges()
+    , lastChangeTime(0)
+    , queuedArea(0)
+    , runningArea(0)
+    , waitingForTilesArea(0)
+    , releasedArea(0)
+    , nTasks(0)
+    , totalQueueLatency(0)
+    , maxQueueLatency(0)
+    , recentQueueLatencies()
+    , nextQueueLatency(0)
+    , totalWaitingForTilesTime(0)
+    , totalReleasedTime(0)
+    , workers()
+    {
+    }
+
+    /**
+     * @brief Accumulates the gauges up to now, before they change. Must be called under lock.
+     **/
+    void integrateGauges(double now)
+    {
+        double dt = std::max(0., now - lastChangeTime);
+        queuedArea += gauges.queued * dt;
+        runningArea += gauges.running * dt;
+        waitingForTilesArea += gauges.waitingForTiles * dt;
+        releasedArea += gauges.released * dt;
+        lastChangeTime = now;
+    }
+
+    /**
+     * @brief Must be called under lock after the gauges changed
+     **/
+    void updateMaximumGauges()
+    {
+        maxGauges.queued = std::max(maxGauges.queued, gauges.queued);
+        maxGauges.running = std::max(maxGauges.running, gauges.running);
+        maxGauges.waitingForTiles = std::max(maxGauges.waitingForTiles, gauges.waitingForTiles);
+        maxGauges.released = std::max(maxGauges.released, gauges.released);
+    }
+
+    /**
+     * @brief Returns the worker of the calling thread. Must be called under lock.
+     **/
+    WorkerData& getCurrentWorker(double now)
+    {
+        QThread* thread = QThread::currentThread();
+        std::map<QThread*, WorkerData>::iterator found = workers.find(thread);
+        if ( found != workers.end() ) {
+            return found->second;
+        }
+        WorkerData& worker = workers[thread];
+        worker.firstSeenTime = now;
+        if ( qApp && (thread == qApp->thread()) ) {
+            worker.threadName = "Main thread";
+        } else if ( thread && !thread->objectName().isEmpty() ) {
+            worker.threadName = thread->objectName().toStdString();
+        } else {
+            std::stringstream ss;
+            ss << "Thread " << (void*)thread;
+            worker.threadName = ss.str();
+        }
+        return worker;
+    }
+};
+
+ThreadPoolMonitorData&
+getMonitorData()
+{
+    static ThreadPoolMonitorData data;
+
+    return data;
+}
+
+/**
+ * @brief Records the gauges as a counter of the trace, outside of the lock of the monitor
+ **/
+void
+recordTraceCounter(const ThreadPoolMonitor::Gauges& gauges)
+{
+    if ( !TraceRecorder::isEnabled() ) {
+        return;
+    }
+    std::vector<std::pair<const char*, double> > values;
+    values.push_back( std::make_pair("queued", (double)gauges.queued) );
+    values.push_back( std::make_pair("running", (double)gauges.running) );
+    values.push_back( std::make_pair("waiting for tiles", (double)gauges.waitingForTiles) );
+    values.push_back( std::make_pair("released", (double)gauges.released) );
+    TraceRecorder::recordCounter("Thread pool", values, TraceRecorder::getTime());
+}
+
+double
+getPercentile(const std::vector<double>& sortedValues, double percent)
+{
+    if ( sortedValues.empty() ) {
+        return 0.;
+    }
+    std::size_t rank = (std::size_t)std::ceil(sortedValues.size() * percent / 100.);
+    rank = std::max(rank, (std::size_t)1);
+
+    return sortedValues[std::min(rank, sortedValues.size()) - 1];
+}
+
+bool
+compareWorkerBusyTime(const ThreadPoolMonitor::WorkerStats& a, const ThreadPoolMonitor::WorkerStats& b)
+{
+    return a.busyTime > b.busyTime;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+ThreadPoolMonitor::setEnabled(bool enabled)
+{
+    getMonitorData().enabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+bool
+ThreadPoolMonitor::isEnabled()
+{
+#if QT_VERSION < 0x050000
+    return (int)getMonitorData().enabled != 0;
+#else
+    return getMonitorData().enabled.loadAcquire() != 0;
+#endif
+}
+
+void
+ThreadPoolMonitor::reset()
+{
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    QMutexLocker k(&data.lock);
+    data.resetTime = now;
+    data.maxGauges = data.gauges;
+    data.lastChangeTime = now;
+    data.queuedArea = data.runningArea = data.waitingForTilesArea = data.releasedArea = 0;
+    data.nTasks = 0;
+    data.totalQueueLatency = data.maxQueueLatency = 0;
+    data.recentQueueLatencies.clear();
+    data.nextQueueLatency = 0;
+    data.totalWaitingForTilesTime = data.totalReleasedTime = 0;
+
+    // Keep the workers that run tasks so that their current tasks are accounted for when they finish
+    for (std::map<QThread*, WorkerData>::iterator it = data.workers.begin(); it != data.workers.end();) {
+        WorkerData& worker = it->second;
+        if (worker.runningTasks == 0) {
+            data.workers.erase(it++);
+        } else {
+            worker.nTasks = 0;
+            worker.firstSeenTime = now;
+            worker.busyTime = worker.releasedTime = 0;
+            worker.busySince = now;
+            ++it;
+        }
+    }
+}
+
+double
+ThreadPoolMonitor::getTime()
+{
+    return getMonitorData().clock.getTimeSinceCreation();
+}
+
+double
+ThreadPoolMonitor::onTaskQueued()
+{
+    if ( !isEnabled() ) {
+        return -1.;
+    }
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    Gauges gauges;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+        ++data.gauges.queued;
+        data.updateMaximumGauges();
+        gauges = data.gauges;
+    }
+    recordTraceCounter(gauges);
+
+    return now;
+}
+
+void
+ThreadPoolMonitor::onTaskDropped(double queueTime)
+{
+    if (queueTime < 0) {
+        return;
+    }
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    Gauges gauges;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+        --data.gauges.queued;
+        gauges = data.gauges;
+    }
+    recordTraceCounter(gauges);
+}
+
+double
+ThreadPoolMonitor::onTaskStarted(double queueTime)
+{
+    if (queueTime < 0) {
+        return -1.;
+    }
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    double latency = std::max(0., now - queueTime);
+    Gauges gauges;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+        --data.gauges.queued;
+        ++data.gauges.running;
+        data.updateMaximumGauges();
+        gauges = data.gauges;
+
+        ++data.nTasks;
+        data.totalQueueLatency += latency;
+        data.maxQueueLatency = std::max(data.maxQueueLatency, latency);
+        if (data.recentQueueLatencies.size() < NATRON_THREAD_POOL_MONITOR_LATENCY_SAMPLES) {
+            data.recentQueueLatencies.push_back(latency);
+        } else {
+            data.recentQueueLatencies[data.nextQueueLatency] = latency;
+        }
+        data.nextQueueLatency = (data.nextQueueLatency + 1) % NATRON_THREAD_POOL_MONITOR_LATENCY_SAMPLES;
+
+        WorkerData& worker = data.getCurrentWorker(now);
+        ++worker.nTasks;
+        if (worker.runningTasks == 0) {
+            worker.busySince = now;
+        }
+        ++worker.runningTasks;
+    }
+    recordTraceCounter(gauges);
+
+    return now;
+}
+
+void
+ThreadPoolMonitor::onTaskFinished(double startTime)
+{
+    if (startTime < 0) {
+        return;
+    }
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    Gauges gauges;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+        --data.gauges.running;
+        gauges = data.gauges;
+
+        WorkerData& worker = data.getCurrentWorker(now);
+        if (worker.runningTasks > 0) {
+            --worker.runningTasks;
+            if (worker.runningTasks == 0) {
+                worker.busyTime += std::max(0., now - worker.busySince);
+            }
+        }
+    }
+    recordTraceCounter(gauges);
+}
+
+void
+ThreadPoolMonitor::onThreadReleased()
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    data.threadState.localData().releaseStartTimes.push_back(now);
+    Gauges gauges;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+        ++data.gauges.released;
+        data.updateMaximumGauges();
+        gauges = data.gauges;
+    }
+    recordTraceCounter(gauges);
+}
+
+void
+ThreadPoolMonitor::onThreadReserved()
+{
+    ThreadPoolMonitorData& data = getMonitorData();
+    if ( !data.threadState.hasLocalData() ) {
+        return;
+    }
+    std::vector<double>& releaseStartTimes = data.threadState.localData().releaseStartTimes;
+    if ( releaseStartTimes.empty() ) {
+        // The thread was released while monitoring was disabled
+        return;
+    }
+    double now = getTime();
+    double releasedTime = std::max(0., now - releaseStartTimes.back());
+    releaseStartTimes.pop_back();
+    Gauges gauges;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+        --data.gauges.released;
+        gauges = data.gauges;
+        data.totalReleasedTime += releasedTime;
+        data.getCurrentWorker(now).releasedTime += releasedTime;
+    }
+    recordTraceCounter(gauges);
+}
+
+double
+ThreadPoolMonitor::onPendingTilesWaitStarted()
+{
+    if ( !isEnabled() ) {
+        return -1.;
+    }
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    Gauges gauges;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+        ++data.gauges.waitingForTiles;
+        data.updateMaximumGauges();
+        gauges = data.gauges;
+    }
+    recordTraceCounter(gauges);
+
+    return now;
+}
+
+void
+ThreadPoolMonitor::onPendingTilesWaitFinished(double startTime)
+{
+    if (startTime < 0) {
+        return;
+    }
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    Gauges gauges;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+        --data.gauges.waitingForTiles;
+        gauges = data.gauges;
+        data.totalWaitingForTilesTime += std::max(0., now - startTime);
+    }
+    recordTraceCounter(gauges);
+}
+
+void
+ThreadPoolMonitor::getGauges(Gauges* gauges)
+{
+    ThreadPoolMonitorData& data = getMonitorData();
+    QMutexLocker k(&data.lock);
+    *gauges = data.gauges;
+}
+
+void
+ThreadPoolMonitor::getStats(Stats* stats)
+{
+    ThreadPoolMonitorData& data = getMonitorData();
+    double now = getTime();
+    std::vector<double> latencies;
+    {
+        QMutexLocker k(&data.lock);
+        data.integrateGauges(now);
+
+        *stats = Stats();
+        stats->duration = std::max(0., now - data.resetTime);
+        stats->nTasks = data.nTasks;
+        stats->meanQueueLatency = data.nTasks > 0 ? data.totalQueueLatency / data.nTasks : 0.;
+        stats->maxQueueLatency = data.maxQueueLatency;
+        latencies = data.recentQueueLatencies;
+
+        stats->current = data.gauges;
+        stats->maximum = data.maxGauges;
+        if (stats->duration > 0) {
+            stats->meanQueued = data.queuedArea / stats->duration;
+            stats->meanRunning = data.runningArea / stats->duration;
+            stats->meanWaitingForTiles = data.waitingForTilesArea / stats->duration;
+            stats->meanReleased = data.releasedArea / stats->duration;
+        }
+        stats->totalWaitingForTilesTime = data.totalWaitingForTilesTime;
+        stats->totalReleasedTime = data.totalReleasedTime;
+
+        for (std::map<QThread*, WorkerData>::const_iterator it = data.workers.begin(); it != data.workers.end(); ++it) {
+            const WorkerData& worker = it->second;
+            WorkerStats w;
+            w.threadName = worker.threadName;
+            w.nTasks = worker.nTasks;
+            w.lifeTime = std::max(0., now - worker.firstSeenTime);
+            w.busyTime = worker.busyTime;
+            if (worker.runningTasks > 0) {
+                // Count the tasks in progress
+                w.busyTime += std::max(0., now - worker.busySince);
+            }
+            w.releasedTime = worker.releasedTime;
+            stats->totalBusyTime += w.busyTime;
+            stats->workers.push_back(w);
+        }
+    }
+    stats->maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+    std::sort( latencies.begin(), latencies.end() );
+    stats->p95QueueLatency = getPercentile(latencies, 95.);
+    std::stable_sort(stats->workers.begin(), stats->workers.end(), compareWorkerBusyTime);
+} // getStats
+
+std::string
+ThreadPoolMonitor::getReport()
+{
+    Stats stats;
+    getStats(&stats);
+
+    // Times are printed in milliseconds
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    double capacity = stats.duration * std::max(1, stats.maxThreadCount);
+    ss << "Duration: " << stats.duration * 1000. << " ms, " << stats.maxThreadCount << " threads, utilization "
+       << (capacity > 0 ? stats.totalBusyTime * 100. / capacity : 0.) << "%\n";
+    ss << "Tasks: " << stats.nTasks << ", queue latency mean " << stats.meanQueueLatency * 1000.
+       << " ms, p95 " << stats.p95QueueLatency * 1000. << " ms, max " << stats.maxQueueLatency * 1000. << " ms\n";
+    ss << "Threads blocked: " << stats.totalWaitingForTilesTime * 1000. << " ms waiting for pending tiles, "
+       << stats.totalReleasedTime * 1000. << " ms released to the pool\n\n";
+
+    ss << std::left << std::setw(20) << "" << std::right
+       << std::setw(12) << "Current"
+       << std::setw(12) << "Mean"
+       << std::setw(12) << "Max" << '\n';
+    ss << std::left << std::setw(20) << "Queued tasks" << std::right
+       << std::setw(12) << stats.current.queued << std::setw(12) << stats.meanQueued << std::setw(12) << stats.maximum.queued << '\n';
+    ss << std::left << std::setw(20) << "Running tasks" << std::right
+       << std::setw(12) << stats.current.running << std::setw(12) << stats.meanRunning << std::setw(12) << stats.maximum.running << '\n';
+    ss << std::left << std::setw(20) << "Waiting for tiles" << std::right
+       << std::setw(12) << stats.current.waitingForTiles << std::setw(12) << stats.meanWaitingForTiles << std::setw(12) << stats.maximum.waitingForTiles << '\n';
+    ss << std::left << std::setw(20) << "Released threads" << std::right
+       << std::setw(12) << stats.current.released << std::setw(12) << stats.meanReleased << std::setw(12) << stats.maximum.released << "\n\n";
+
+    ss << std::left << std::setw(40) << "Worker" << std::right
+       << std::setw(10) << "Tasks"
+       << std::setw(14) << "Busy (ms)"
+       << std::setw(14) << "Released (ms)"
+       << std::setw(14) << "Idle (ms)"
+       << std::setw(10) << "Busy %" << '\n';
+    for (std::size_t i = 0; i < stats.workers.size(); ++i) {
+        const WorkerStats& w = stats.workers[i];
+        ss << std::left << std::setw(40) << w.threadName << std::right
+           << std::setw(10) << w.nTasks
+           << std::setw(14) << w.busyTime * 1000.
+           << std::setw(14) << w.releasedTime * 1000.
+           << std::setw(14) << std::max(0., w.lifeTime - w.busyTime) * 1000.
+           << std::setw(10) << (w.lifeTime > 0 ? w.busyTime * 100. / w.lifeTime : 0.) << '\n';
+    }
+
+    return ss.str();
+} // getReport
+
+NATRON_NAMESPACE_EXIT
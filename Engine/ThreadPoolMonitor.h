@@ -0,0 +1,209 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_ThreadPoolMonitor_h
+#define Engine_ThreadPoolMonitor_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+// The percentiles of the queue latency are computed on this number of the most recent tasks
+#define NATRON_THREAD_POOL_MONITOR_LATENCY_SAMPLES 4096
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Measures how the render tasks use the global thread pool, to tell whether renders are bound by the CPU
+ * or by waits: the time each worker spends running tasks, how long the tasks stay queued before a thread runs them,
+ * and how many threads are given back to the pool while blocked, in ReleaseTPThread_RAII or in
+ * ImageCacheEntry::waitForPendingTiles().
+ *
+ * It is disabled by default and can be enabled from the RenderStatsDialog. While the TraceRecorder is enabled,
+ * the queue depth and the number of running, waiting and released threads are also recorded as counters of the trace.
+ *
+ * The tasks, waits and releases that begin while monitoring is disabled are not counted: the functions that begin
+ * them return a negative time, which must be passed to the function that ends them.
+ **/
+class ThreadPoolMonitor
+{
+public:
+
+    struct WorkerStats
+    {
+        std::string threadName;
+        U64 nTasks;
+
+        // In seconds, since the first task the worker ran after the monitor was reset
+        double lifeTime;
+
+        // The time spent running tasks, of which the time the thread was released to the pool while blocked
+        double busyTime;
+        double releasedTime;
+
+        WorkerStats()
+        : threadName()
+        , nTasks(0)
+        , lifeTime(0)
+        , busyTime(0)
+        , releasedTime(0)
+        {
+        }
+    };
+
+    /**
+     * @brief The number of tasks or threads in each state
+     **/
+    struct Gauges
+    {
+        // Tasks queued in the thread pool that no thread runs yet
+        int queued;
+
+        // Tasks running
+        int running;
+
+        // Threads in ImageCacheEntry::waitForPendingTiles()
+        int waitingForTiles;
+
+        // Thread pool threads released to the pool while blocked
+        int released;
+
+        Gauges()
+        : queued(0)
+        , running(0)
+        , waitingForTiles(0)
+        , released(0)
+        {
+        }
+    };
+
+    struct Stats
+    {
+        // In seconds, since the monitor was reset
+        double duration;
+
+        int maxThreadCount;
+
+        U64 nTasks;
+
+        // The time between the queuing of a task and its start, in seconds
+        double meanQueueLatency;
+        double p95QueueLatency;
+        double maxQueueLatency;
+
+        // The current values, the maximum values and the averages over time since the monitor was reset
+        Gauges current;
+        Gauges maximum;
+        double meanQueued;
+        double meanRunning;
+        double meanWaitingForTiles;
+        double meanReleased;
+
+        // The sums over all threads of the time spent in each state, in seconds
+        double totalBusyTime;
+        double totalWaitingForTilesTime;
+        double totalReleasedTime;
+
+        std::vector<WorkerStats> workers;
+
+        Stats()
+        : duration(0)
+        , maxThreadCount(0)
+        , nTasks(0)
+        , meanQueueLatency(0)
+        , p95QueueLatency(0)
+        , maxQueueLatency(0)
+        , current()
+        , maximum()
+        , meanQueued(0)
+        , meanRunning(0)
+        , meanWaitingForTiles(0)
+        , meanReleased(0)
+        , totalBusyTime(0)
+        , totalWaitingForTilesTime(0)
+        , totalReleasedTime(0)
+        , workers()
+        {
+        }
+    };
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    /**
+     * @brief Clears the statistics. The tasks, waits and releases in progress are still counted in the current values.
+     **/
+    static void reset();
+
+    /**
+     * @brief Returns the time in seconds since the monitor was created
+     **/
+    static double getTime();
+
+    /**
+     * @brief Call before handing a task to the thread pool. Returns the time at which it was queued, or a negative
+     * value if monitoring is disabled.
+     **/
+    static double onTaskQueued();
+
+    /**
+     * @brief Call when a task that was queued will not be run
+     **/
+    static void onTaskDropped(double queueTime);
+
+    /**
+     * @brief Call when a thread starts running a task with the time returned by onTaskQueued(). Returns the start time
+     * to pass to onTaskFinished(), which is negative if the task is not monitored.
+     **/
+    static double onTaskStarted(double queueTime);
+    static void onTaskFinished(double startTime);
+
+    /**
+     * @brief Call when the calling thread pool thread is released to the pool and when it reserves it back,
+     * @see TreeRenderQueueManager::releaseTask()
+     **/
+    static void onThreadReleased();
+    static void onThreadReserved();
+
+    /**
+     * @brief Brackets a wait in ImageCacheEntry::waitForPendingTiles()
+     **/
+    static double onPendingTilesWaitStarted();
+    static void onPendingTilesWaitFinished(double startTime);
+
+    static void getGauges(Gauges* gauges);
+
+    static void getStats(Stats* stats);
+
+    static std::string getReport();
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_ThreadPoolMonitor_h
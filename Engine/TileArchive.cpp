@@ -0,0 +1,416 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TileArchive.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/CompressedTileFile.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/TreeRender.h"
+
+#define NATRON_TILE_ARCHIVE_IMPORT_DIR "ImportedTiles"
+
+NATRON_NAMESPACE_ENTER
+
+struct TileArchivePrivate
+{
+    // Protects importedArchives, which is read by all the render threads looking for tiles
+    mutable QReadWriteLock importedArchivesLock;
+    std::vector<CompressedTileFilePtr> importedArchives;
+
+    // True once the archives of the import directory were opened, protected by importedArchivesLock
+    bool importedArchivesLoaded;
+
+    // Protects the export
+    mutable QMutex exportMutex;
+    CompressedTileFilePtr exportedArchive;
+    std::list<NodeWPtr> exportedNodes;
+
+    TileArchivePrivate()
+    : importedArchivesLock()
+    , importedArchives()
+    , importedArchivesLoaded(false)
+    , exportMutex()
+    , exportedArchive()
+    , exportedNodes()
+    {
+
+    }
+
+    /**
+     * @brief Opens the archive at the given path and adds it to the imported archives, replacing an opened archive
+     * with the same path. Returns false if the file does not contain any tile.
+     * The write lock of importedArchivesLock must be taken.
+     **/
+    bool openImportedArchive_locked(const QString& filePath);
+
+    /**
+     * @brief Opens the archives of the import directory the first time the imported archives are needed
+     **/
+    void ensureImportedArchivesLoaded();
+};
+
+TileArchive::TileArchive()
+    : _imp( new TileArchivePrivate() )
+{
+}
+
+TileArchive::~TileArchive()
+{
+    endExport();
+}
+
+QString
+TileArchive::getImportDirectoryPath()
+{
+    QString path = QString::fromUtf8( appPTR->getCacheDirPath().c_str() );
+    if ( !path.endsWith( QLatin1Char('/') ) ) {
+        path += QLatin1Char('/');
+    }
+    path += QString::fromUtf8(NATRON_TILE_ARCHIVE_IMPORT_DIR);
+
+    return path;
+}
+
+bool
+TileArchivePrivate::openImportedArchive_locked(const QString& filePath)
+{
+    CompressedTileFilePtr archive = boost::make_shared<CompressedTileFile>();
+    // A file that is not a tile file is truncated by open(): it is removed below
+    if ( !archive->open( filePath.toStdString() ) || (archive->getNumTiles() == 0) ) {
+        archive->close();
+
+        return false;
+    }
+
+    for (std::vector<CompressedTileFilePtr>::iterator it = importedArchives.begin(); it != importedArchives.end(); ++it) {
+        if ( (*it)->getFilePath() == archive->getFilePath() ) {
+            (*it)->close();
+            importedArchives.erase(it);
+            break;
+        }
+    }
+    importedArchives.push_back(archive);
+
+    return true;
+}
+
+void
+TileArchivePrivate::ensureImportedArchivesLoaded()
+{
+    {
+        QReadLocker k(&importedArchivesLock);
+        if (importedArchivesLoaded) {
+            return;
+        }
+    }
+
+    QWriteLocker k(&importedArchivesLock);
+    if (importedArchivesLoaded) {
+        return;
+    }
+    importedArchivesLoaded = true;
+
+    QDir dir( TileArchive::getImportDirectoryPath() );
+    if ( !dir.exists() ) {
+        return;
+    }
+    QStringList files = dir.entryList(QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+    Q_FOREACH(const QString& file, files) {
+        QString filePath = dir.absoluteFilePath(file);
+        if ( !openImportedArchive_locked(filePath) ) {
+            QFile::remove(filePath);
+        }
+    }
+}
+
+bool
+TileArchive::importArchive(const QString& filePath)
+{
+    QFileInfo info(filePath);
+    if ( !info.exists() ) {
+        std::cerr << tr("%1: No such file.").arg(filePath).toStdString() << std::endl;
+
+        return false;
+    }
+
+    // Open the previously imported archives first so that the archive replaced by the copy is closed below
+    _imp->ensureImportedArchivesLoaded();
+
+    QDir dir( getImportDirectoryPath() );
+    if ( !dir.exists() && !dir.mkpath( QString::fromUtf8(".") ) ) {
+        std::cerr << tr("Could not create the directory %1.").arg( dir.absolutePath() ).toStdString() << std::endl;
+
+        return false;
+    }
+
+    // Never open the file given by the user directly: open() truncates a file that is not a tile file
+    const QString importedPath = dir.absoluteFilePath( info.fileName() );
+    if ( info.absoluteFilePath() != QFileInfo(importedPath).absoluteFilePath() ) {
+        {
+            // Close the archive replaced by the copy
+            QWriteLocker k(&_imp->importedArchivesLock);
+            for (std::vector<CompressedTileFilePtr>::iterator it = _imp->importedArchives.begin(); it != _imp->importedArchives.end(); ++it) {
+                if ( QString::fromUtf8( (*it)->getFilePath().c_str() ) == importedPath ) {
+                    (*it)->close();
+                    _imp->importedArchives.erase(it);
+                    break;
+                }
+            }
+        }
+        QFile::remove(importedPath);
+        if ( !QFile::copy(filePath, importedPath) ) {
+            std::cerr << tr("Could not copy %1 to %2.").arg(filePath).arg(importedPath).toStdString() << std::endl;
+
+            return false;
+        }
+    }
+
+    bool opened;
+    {
+        QWriteLocker k(&_imp->importedArchivesLock);
+        opened = _imp->openImportedArchive_locked(importedPath);
+    }
+    if (!opened) {
+        QFile::remove(importedPath);
+        std::cerr << tr("%1 is not a cache archive or does not contain any tile.").arg(filePath).toStdString() << std::endl;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool
+TileArchive::isEnabled() const
+{
+    _imp->ensureImportedArchivesLoaded();
+
+    QReadLocker k(&_imp->importedArchivesLock);
+
+    return !_imp->importedArchives.empty();
+}
+
+bool
+TileArchive::hasTile(U64 tileHash) const
+{
+    _imp->ensureImportedArchivesLoaded();
+
+    QReadLocker k(&_imp->importedArchivesLock);
+    for (std::size_t i = 0; i < _imp->importedArchives.size(); ++i) {
+        if ( _imp->importedArchives[i]->hasTile(tileHash) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+TileArchive::readTile(U64 tileHash,
+                      void* data,
+                      std::size_t tileSizeBytes) const
+{
+    _imp->ensureImportedArchivesLoaded();
+
+    QReadLocker k(&_imp->importedArchivesLock);
+    for (std::size_t i = 0; i < _imp->importedArchives.size(); ++i) {
+        if ( _imp->importedArchives[i]->readTile(tileHash, data, tileSizeBytes) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+TileArchive::beginExport(const QString& filePath,
+                         const std::list<NodePtr>& nodes)
+{
+    CompressedTileFilePtr archive = boost::make_shared<CompressedTileFile>();
+    if ( !archive->open( filePath.toStdString() ) ) {
+        std::cerr << tr("Could not open %1 for writing.").arg(filePath).toStdString() << std::endl;
+
+        return false;
+    }
+    archive->clear();
+
+    QMutexLocker k(&_imp->exportMutex);
+    if (_imp->exportedArchive) {
+        _imp->exportedArchive->close();
+    }
+    _imp->exportedArchive = archive;
+    _imp->exportedNodes.clear();
+    for (std::list<NodePtr>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        _imp->exportedNodes.push_back(*it);
+    }
+
+    return true;
+}
+
+bool
+TileArchive::isExportingNode(const NodePtr& node) const
+{
+    QMutexLocker k(&_imp->exportMutex);
+    if (!_imp->exportedArchive || !node) {
+        return false;
+    }
+    for (std::list<NodeWPtr>::const_iterator it = _imp->exportedNodes.begin(); it != _imp->exportedNodes.end(); ++it) {
+        if (it->lock() == node) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+TileArchive::exportTile(U64 tileHash,
+                        const void* data,
+                        std::size_t tileSizeBytes,
+                        int elementSizeBytes)
+{
+    CompressedTileFilePtr archive;
+    {
+        QMutexLocker k(&_imp->exportMutex);
+        archive = _imp->exportedArchive;
+    }
+    if (archive) {
+        archive->writeTile(tileHash, data, tileSizeBytes, elementSizeBytes);
+    }
+}
+
+std::size_t
+TileArchive::endExport()
+{
+    CompressedTileFilePtr archive;
+    {
+        QMutexLocker k(&_imp->exportMutex);
+        archive = _imp->exportedArchive;
+        _imp->exportedArchive.reset();
+        _imp->exportedNodes.clear();
+    }
+    if (!archive) {
+        return 0;
+    }
+    std::size_t nTiles = archive->getNumTiles();
+    archive->close();
+
+    return nTiles;
+}
+
+bool
+TileArchive::exportNodes(const AppInstancePtr& app,
+                         const QString& filePath,
+                         const QStringList& nodeNames,
+                         const std::list<std::pair<int, std::pair<int, int> > >& frameRanges)
+{
+    std::list<NodePtr> nodes;
+    Q_FOREACH(const QString& nodeName, nodeNames) {
+        NodePtr node = app->getNodeByFullySpecifiedName( nodeName.toStdString() );
+        if (!node) {
+            std::cerr << tr("%1 does not belong to the project file. Please enter a valid node script-name.").arg(nodeName).toStdString() << std::endl;
+
+            return false;
+        }
+        nodes.push_back(node);
+    }
+
+    std::list<std::pair<int, std::pair<int, int> > > ranges = frameRanges;
+    if ( ranges.empty() ) {
+        TimeValue first, last;
+        app->getProject()->getFrameRange(&first, &last);
+        ranges.push_back( std::make_pair( 1, std::make_pair( (int)first, (int)last ) ) );
+    }
+
+    TileArchive* archive = appPTR->getTileArchive();
+    if ( !archive->beginExport(filePath, nodes) ) {
+        return false;
+    }
+
+    bool ok = true;
+    const int viewsCount = app->getProject()->getProjectViewsCount();
+    for (std::list<NodePtr>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        EffectInstancePtr effect = (*it)->getEffectInstance();
+        for (std::list<std::pair<int, std::pair<int, int> > >::const_iterator range = ranges.begin(); range != ranges.end(); ++range) {
+            const int step = (range->first == 0) ? 1 : std::abs(range->first);
+            for (int frame = range->second.first; frame <= range->second.second; frame += step) {
+                for (int view = 0; view < viewsCount; ++view) {
+
+                    // Same arguments as the render of a writer, so that the renders of the farm look-up the same tiles.
+                    // The RoI is left empty to render the whole RoD.
+                    TreeRender::CtorArgsPtr args(new TreeRender::CtorArgs);
+                    args->provider = effect;
+                    args->treeRootEffect = effect;
+                    args->time = TimeValue(frame);
+                    args->view = ViewIdx(view);
+                    args->mipMapLevel = 0;
+                    args->proxyScale = RenderScale(1.);
+                    args->draftMode = false;
+                    args->playback = true;
+                    args->byPassCache = false;
+
+                    TreeRenderPtr render = TreeRender::create(args);
+                    ActionRetCodeEnum stat = eActionStatusFailed;
+                    if (render) {
+                        effect->launchRender(render);
+                        effect->waitForRenderFinished(render);
+                        stat = render->getStatus();
+                    }
+                    if ( isFailureRetCode(stat) ) {
+                        std::cerr << tr("Failed to render frame %1 of %2.").arg(frame)
+                            .arg( QString::fromUtf8( (*it)->getScriptName_mt_safe().c_str() ) ).toStdString() << std::endl;
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+
+    std::size_t nTiles = archive->endExport();
+    std::cout << tr("%1 tiles exported to %2.").arg(nTiles).arg(filePath).toStdString() << std::endl;
+
+    return ok;
+} // exportNodes
+
+NATRON_NAMESPACE_EXIT
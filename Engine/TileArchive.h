@@ -0,0 +1,143 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_TileArchive_h
+#define Engine_TileArchive_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <utility>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Portable archives of cache tiles, used to seed the caches of the render nodes of a farm with the tiles of
+ * expensive upstream nodes (plate denoise, lens distortion...) computed once.
+ *
+ * An archive is a CompressedTileFile: the tiles are compressed and identified by the hash given by
+ * CacheBase::makeTileCacheIndex(), which only depends on the content of the tile and not on the cache that
+ * held it. The same project on another machine thus produces the same hashes.
+ *
+ * Exporting (--export-cache): the given nodes are rendered at full resolution for the given frames and each tile
+ * of their images at full quality, whether it was rendered, fetched from the persistent tile cache or restored from
+ * another tier, is appended to the archive.
+ *
+ * Importing (--import-cache): the archive is copied to the ImportedTiles directory next to the persistent tile
+ * cache. The imported archives are a tier of the tile cache, looked-up before rendering a tile as the compressed
+ * storage and the remote tile cache are. A tile found there is copied to the tile cache, so that the persistent
+ * cache fills up with the imported tiles as the renders use them. The archives are opened on the first look-up
+ * rather than on startup, so that launches which render nothing do not pay for it.
+ *
+ * This class is thread-safe.
+ **/
+struct TileArchivePrivate;
+class TileArchive
+{
+    Q_DECLARE_TR_FUNCTIONS(TileArchive)
+
+public:
+
+    TileArchive();
+
+    ~TileArchive();
+
+    /**
+     * @brief Returns the directory in which the imported archives are stored
+     **/
+    static QString getImportDirectoryPath();
+
+    /**
+     * @brief Copies the archive at the given path to the import directory and opens it, replacing an archive
+     * previously imported with the same file name. Returns false and prints an error if the file is not an archive.
+     **/
+    bool importArchive(const QString& filePath);
+
+    /**
+     * @brief Returns true if at least one imported archive is opened
+     **/
+    bool isEnabled() const;
+
+    /**
+     * @brief Returns true if a tile with the given hash is in one of the imported archives
+     **/
+    bool hasTile(U64 tileHash) const;
+
+    /**
+     * @brief If the tile is in one of the imported archives, decompress it to data which must be tileSizeBytes large.
+     **/
+    bool readTile(U64 tileHash, void* data, std::size_t tileSizeBytes) const;
+
+    /**
+     * @brief Starts exporting the tiles of the given nodes to the archive at the given path, which is truncated.
+     **/
+    bool beginExport(const QString& filePath, const std::list<NodePtr>& nodes);
+
+    /**
+     * @brief Returns true if the tiles of the given node are exported
+     **/
+    bool isExportingNode(const NodePtr& node) const;
+
+    /**
+     * @brief Appends the given tile to the archive being exported. This does nothing if it is already in the archive.
+     **/
+    void exportTile(U64 tileHash, const void* data, std::size_t tileSizeBytes, int elementSizeBytes);
+
+    /**
+     * @brief Flushes and closes the archive being exported. Returns the number of tiles it holds.
+     **/
+    std::size_t endExport();
+
+    /**
+     * @brief Renders the nodes of the given app with the given script-names for the given frame ranges
+     * (a list of step, (first, last)) and writes their tiles to the archive at the given path.
+     * If frameRanges is empty, the frame range of the project is used.
+     **/
+    static bool exportNodes(const AppInstancePtr& app,
+                            const QString& filePath,
+                            const QStringList& nodeNames,
+                            const std::list<std::pair<int, std::pair<int, int> > >& frameRanges);
+
+private:
+
+    boost::scoped_ptr<TileArchivePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_TileArchive_h
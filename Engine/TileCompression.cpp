@@ -0,0 +1,420 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TileCompression.h"
+
+#include <cassert>
+#include <cstring>
+
+// Header of a compressed buffer:
+// [0] [1] : magic
+// [2]     : version
+// [3]     : mode in the low 4 bits, element size of the predictor in the high 4 bits
+// [4..7]  : uncompressed size, little endian
+#define NATRON_TILE_COMPRESSION_MAGIC_0 'N'
+#define NATRON_TILE_COMPRESSION_MAGIC_1 'T'
+#define NATRON_TILE_COMPRESSION_VERSION 1
+#define NATRON_TILE_COMPRESSION_HEADER_SIZE 8
+
+// Minimum match length of the LZ stage
+#define NATRON_TILE_COMPRESSION_MIN_MATCH 4
+
+// Maximum distance of a match, offsets are encoded on 16 bits
+#define NATRON_TILE_COMPRESSION_MAX_OFFSET 65535
+
+#define NATRON_TILE_COMPRESSION_HASH_LOG 12
+
+NATRON_NAMESPACE_ENTER
+
+namespace TileCompression {
+
+enum CompressionModeEnum
+{
+    // The data is stored as-is, the codec could not shrink it
+    eCompressionModeStored = 0,
+
+    // LZ only
+    eCompressionModeLZ,
+
+    // Delta predictor + byte planes, then LZ
+    eCompressionModePredictedLZ
+};
+
+static inline U32
+read32(const U8* p)
+{
+    U32 ret;
+    std::memcpy(&ret, p, sizeof(U32));
+    return ret;
+}
+
+static inline U32
+hashSequence(U32 sequence)
+{
+    return (sequence * 2654435761U) >> (32 - NATRON_TILE_COMPRESSION_HASH_LOG);
+}
+
+static inline void
+writeLength(std::size_t length, U8** op)
+{
+    while (length >= 255) {
+        *(*op)++ = 255;
+        length -= 255;
+    }
+    *(*op)++ = (U8)length;
+}
+
+static inline bool
+readLength(const U8** ip, const U8* iend, std::size_t maxLength, std::size_t* length)
+{
+    U8 s;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        s = *(*ip)++;
+        *length += s;
+        if (*length > maxLength) {
+            return false;
+        }
+    } while (s == 255);
+    return true;
+}
+
+static void
+writeSequence(const U8* literals, std::size_t nLiterals, std::size_t offset, std::size_t matchLength, bool hasMatch, U8** op)
+{
+    U8* token = (*op)++;
+    *token = (U8)( (nLiterals >= 15 ? 15 : nLiterals) << 4 );
+    if (nLiterals >= 15) {
+        writeLength(nLiterals - 15, op);
+    }
+    if (nLiterals) {
+        std::memcpy(*op, literals, nLiterals);
+        *op += nLiterals;
+    }
+    if (!hasMatch) {
+        return;
+    }
+    *(*op)++ = (U8)(offset & 0xFF);
+    *(*op)++ = (U8)( (offset >> 8) & 0xFF );
+
+    std::size_t matchCode = matchLength - NATRON_TILE_COMPRESSION_MIN_MATCH;
+    *token |= (U8)(matchCode >= 15 ? 15 : matchCode);
+    if (matchCode >= 15) {
+        writeLength(matchCode - 15, op);
+    }
+} // writeSequence
+
+/**
+ * @brief Greedy single probe LZ77: returns the number of bytes written to dst which must be at least
+ * getMaxCompressedSize(srcSize) - NATRON_TILE_COMPRESSION_HEADER_SIZE bytes large.
+ **/
+static std::size_t
+lzCompress(const U8* src, std::size_t srcSize, U8* dst)
+{
+    const U8* ip = src;
+    const U8* anchor = src;
+    const U8* iend = src + srcSize;
+    U8* op = dst;
+
+    if (srcSize > NATRON_TILE_COMPRESSION_MIN_MATCH) {
+
+        // Positions are stored + 1 so that 0 means empty
+        U32 hashTable[1 << NATRON_TILE_COMPRESSION_HASH_LOG];
+        std::memset(hashTable, 0, sizeof(hashTable));
+
+        const U8* matchLimit = iend - NATRON_TILE_COMPRESSION_MIN_MATCH;
+
+        // When no match is found for a while, skip bytes faster: incompressible data then costs little
+        unsigned int searchCount = 0;
+        while (ip <= matchLimit) {
+            U32 sequence = read32(ip);
+            U32 h = hashSequence(sequence);
+            U32 ref = hashTable[h];
+            hashTable[h] = (U32)(ip - src) + 1;
+
+            if ( ref && ( (std::size_t)(ip - src) - (ref - 1) <= NATRON_TILE_COMPRESSION_MAX_OFFSET ) && (read32(src + ref - 1) == sequence) ) {
+                const U8* match = src + ref - 1;
+
+                // Extend backwards over the pending literals
+                while (ip > anchor && match > src && ip[-1] == match[-1]) {
+                    --ip;
+                    --match;
+                }
+
+                const U8* matchEnd = ip + NATRON_TILE_COMPRESSION_MIN_MATCH;
+                const U8* refEnd = match + NATRON_TILE_COMPRESSION_MIN_MATCH;
+                while (matchEnd < iend && *matchEnd == *refEnd) {
+                    ++matchEnd;
+                    ++refEnd;
+                }
+
+                writeSequence(anchor, ip - anchor, ip - match, matchEnd - ip, true, &op);
+                ip = matchEnd;
+                anchor = ip;
+                searchCount = 0;
+            } else {
+                ip += 1 + (searchCount++ >> 6);
+            }
+        }
+    }
+
+    // Last literals, without a match
+    writeSequence(anchor, iend - anchor, 0, 0, false, &op);
+
+    return op - dst;
+} // lzCompress
+
+static bool
+lzDecompress(const U8* src, std::size_t srcSize, U8* dst, std::size_t dstSize)
+{
+    const U8* ip = src;
+    const U8* iend = src + srcSize;
+    U8* op = dst;
+    U8* oend = dst + dstSize;
+
+    for (;;) {
+        if (ip >= iend) {
+            return false;
+        }
+        U8 token = *ip++;
+
+        std::size_t nLiterals = token >> 4;
+        if ( (nLiterals == 15) && !readLength(&ip, iend, dstSize, &nLiterals) ) {
+            return false;
+        }
+        if ( ( nLiterals > (std::size_t)(iend - ip) ) || ( nLiterals > (std::size_t)(oend - op) ) ) {
+            return false;
+        }
+        std::memcpy(op, ip, nLiterals);
+        ip += nLiterals;
+        op += nLiterals;
+
+        if (ip == iend) {
+            // The last sequence has no match
+            return op == oend;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        std::size_t offset = (std::size_t)ip[0] | ( (std::size_t)ip[1] << 8 );
+        ip += 2;
+        if ( (offset == 0) || ( offset > (std::size_t)(op - dst) ) ) {
+            return false;
+        }
+
+        std::size_t matchLength = token & 15;
+        if ( (matchLength == 15) && !readLength(&ip, iend, dstSize, &matchLength) ) {
+            return false;
+        }
+        matchLength += NATRON_TILE_COMPRESSION_MIN_MATCH;
+        if ( matchLength > (std::size_t)(oend - op) ) {
+            return false;
+        }
+
+        // The match may overlap the output, copy byte per byte
+        const U8* match = op - offset;
+        for (std::size_t i = 0; i < matchLength; ++i) {
+            op[i] = match[i];
+        }
+        op += matchLength;
+    }
+} // lzDecompress
+
+template <typename T>
+static void
+applyPredictor(const U8* src, std::size_t srcSize, U8* dst)
+{
+    const std::size_t nElements = srcSize / sizeof(T);
+    T prev = 0;
+    for (std::size_t i = 0; i < nElements; ++i) {
+        T value;
+        std::memcpy(&value, src + i * sizeof(T), sizeof(T));
+        T delta = (T)(value - prev);
+        prev = value;
+        for (std::size_t b = 0; b < sizeof(T); ++b) {
+            dst[b * nElements + i] = (U8)( delta >> (b * 8) );
+        }
+    }
+    // Trailing bytes that do not form a full element are kept as-is
+    std::size_t tail = srcSize - nElements * sizeof(T);
+    if (tail) {
+        std::memcpy(dst + nElements * sizeof(T), src + nElements * sizeof(T), tail);
+    }
+}
+
+template <typename T>
+static void
+revertPredictor(const U8* src, std::size_t srcSize, U8* dst)
+{
+    const std::size_t nElements = srcSize / sizeof(T);
+    T prev = 0;
+    for (std::size_t i = 0; i < nElements; ++i) {
+        T delta = 0;
+        for (std::size_t b = 0; b < sizeof(T); ++b) {
+            delta |= (T)( (T)src[b * nElements + i] << (b * 8) );
+        }
+        T value = (T)(prev + delta);
+        prev = value;
+        std::memcpy(dst + i * sizeof(T), &value, sizeof(T));
+    }
+    std::size_t tail = srcSize - nElements * sizeof(T);
+    if (tail) {
+        std::memcpy(dst + nElements * sizeof(T), src + nElements * sizeof(T), tail);
+    }
+}
+
+std::size_t
+getMaxCompressedSize(std::size_t srcSize)
+{
+    return NATRON_TILE_COMPRESSION_HEADER_SIZE + srcSize + srcSize / 255 + 16;
+}
+
+void
+compress(const void* src, std::size_t srcSize, int elementSizeBytes, std::vector<U8>* dst)
+{
+    assert(dst);
+    assert( (U64)srcSize <= (U64)0xFFFFFFFF );
+
+    const U8* srcBytes = (const U8*)src;
+
+    dst->resize( getMaxCompressedSize(srcSize) );
+    U8* out = &(*dst)[0];
+
+    out[0] = NATRON_TILE_COMPRESSION_MAGIC_0;
+    out[1] = NATRON_TILE_COMPRESSION_MAGIC_1;
+    out[2] = NATRON_TILE_COMPRESSION_VERSION;
+    out[4] = (U8)(srcSize & 0xFF);
+    out[5] = (U8)( (srcSize >> 8) & 0xFF );
+    out[6] = (U8)( (srcSize >> 16) & 0xFF );
+    out[7] = (U8)( (srcSize >> 24) & 0xFF );
+
+    // The predictor only helps when neighbour elements span several bytes: 8-bit data goes straight to the LZ stage
+    CompressionModeEnum mode = eCompressionModeLZ;
+    std::vector<U8> predicted;
+    const U8* lzInput = srcBytes;
+    if ( (elementSizeBytes == 2) || (elementSizeBytes == 4) ) {
+        mode = eCompressionModePredictedLZ;
+        predicted.resize(srcSize);
+        if (srcSize) {
+            if (elementSizeBytes == 2) {
+                applyPredictor<U16>(srcBytes, srcSize, &predicted[0]);
+            } else {
+                applyPredictor<U32>(srcBytes, srcSize, &predicted[0]);
+            }
+            lzInput = &predicted[0];
+        }
+    } else {
+        elementSizeBytes = 1;
+    }
+
+    std::size_t compressedSize = lzCompress(lzInput, srcSize, out + NATRON_TILE_COMPRESSION_HEADER_SIZE);
+    if (compressedSize >= srcSize) {
+        // Not worth it, store the data
+        mode = eCompressionModeStored;
+        elementSizeBytes = 1;
+        if (srcSize) {
+            std::memcpy(out + NATRON_TILE_COMPRESSION_HEADER_SIZE, srcBytes, srcSize);
+        }
+        compressedSize = srcSize;
+    }
+    out[3] = (U8)( (U8)mode | (U8)(elementSizeBytes << 4) );
+    dst->resize(NATRON_TILE_COMPRESSION_HEADER_SIZE + compressedSize);
+} // compress
+
+static bool
+readHeader(const U8* src, std::size_t srcSize, std::size_t* uncompressedSize)
+{
+    if ( !src || (srcSize < NATRON_TILE_COMPRESSION_HEADER_SIZE) ) {
+        return false;
+    }
+    if ( (src[0] != NATRON_TILE_COMPRESSION_MAGIC_0) || (src[1] != NATRON_TILE_COMPRESSION_MAGIC_1) || (src[2] != NATRON_TILE_COMPRESSION_VERSION) ) {
+        return false;
+    }
+    *uncompressedSize = (std::size_t)src[4] | ( (std::size_t)src[5] << 8 ) | ( (std::size_t)src[6] << 16 ) | ( (std::size_t)src[7] << 24 );
+    return true;
+}
+
+std::size_t
+getDecompressedSize(const U8* src, std::size_t srcSize)
+{
+    std::size_t ret = 0;
+    if ( !readHeader(src, srcSize, &ret) ) {
+        return 0;
+    }
+    return ret;
+}
+
+bool
+decompress(const U8* src, std::size_t srcSize, void* dst, std::size_t dstSize)
+{
+    std::size_t uncompressedSize;
+    if ( !readHeader(src, srcSize, &uncompressedSize) || (uncompressedSize != dstSize) ) {
+        return false;
+    }
+
+    const U8* payload = src + NATRON_TILE_COMPRESSION_HEADER_SIZE;
+    const std::size_t payloadSize = srcSize - NATRON_TILE_COMPRESSION_HEADER_SIZE;
+    CompressionModeEnum mode = (CompressionModeEnum)(src[3] & 0x0F);
+    int elementSizeBytes = src[3] >> 4;
+    U8* out = (U8*)dst;
+
+    switch (mode) {
+    case eCompressionModeStored:
+        if (payloadSize != dstSize) {
+            return false;
+        }
+        if (dstSize) {
+            std::memcpy(out, payload, dstSize);
+        }
+        return true;
+    case eCompressionModeLZ:
+        return lzDecompress(payload, payloadSize, out, dstSize);
+    case eCompressionModePredictedLZ: {
+        if ( (elementSizeBytes != 2) && (elementSizeBytes != 4) ) {
+            return false;
+        }
+        std::vector<U8> predicted(dstSize);
+        if ( dstSize && !lzDecompress(payload, payloadSize, &predicted[0], dstSize) ) {
+            return false;
+        }
+        if (dstSize) {
+            if (elementSizeBytes == 2) {
+                revertPredictor<U16>(&predicted[0], dstSize, out);
+            } else {
+                revertPredictor<U32>(&predicted[0], dstSize, out);
+            }
+        }
+        return true;
+    }
+    }
+    return false;
+} // decompress
+
+} // namespace TileCompression
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,78 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_TILECOMPRESSION_H
+#define NATRON_ENGINE_TILECOMPRESSION_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Lossless codec used to keep tiles evicted from the tile cache in RAM, see CompressedTileStorage.
+ *
+ * The codec is a byte oriented LZ77 coder with the same sequence layout as LZ4 blocks (token, literals, 16-bit offset, match)
+ * but with its own framing. Before coding, an optional predictor is applied on the buffer: each element of elementSizeBytes bytes
+ * is replaced by its (wrapping integer) difference with the previous element and the result is split in byte planes.
+ * On smooth float images this turns the highly correlated exponent bytes into long runs of zeroes that the LZ stage collapses.
+ * The predictor is purely integer so the round trip is bit exact, including for NaNs and denormals.
+ **/
+namespace TileCompression {
+
+/**
+ * @brief Returns the maximum size of the buffer produced by compress() for an input of the given size.
+ **/
+std::size_t getMaxCompressedSize(std::size_t srcSize);
+
+/**
+ * @brief Compress srcSize bytes of src into dst. dst is resized to the compressed size.
+ * @param elementSizeBytes The size of a pixel component: 1 for 8-bit, 2 for 16-bit and 4 for 32-bit float tiles.
+ * Any other value disables the predictor.
+ * Inputs larger than 4GiB are not supported.
+ **/
+void compress(const void* src, std::size_t srcSize, int elementSizeBytes, std::vector<U8>* dst);
+
+/**
+ * @brief Returns the size of the uncompressed data encoded in the given buffer, or 0 if the buffer is not valid.
+ **/
+std::size_t getDecompressedSize(const U8* src, std::size_t srcSize);
+
+/**
+ * @brief Decompress the buffer produced by compress() into dst which must be dstSize bytes large.
+ * The input is fully bounds checked: this returns false if the buffer is corrupted or if dstSize does not match
+ * the uncompressed size.
+ **/
+bool decompress(const U8* src, std::size_t srcSize, void* dst, std::size_t dstSize) WARN_UNUSED_RETURN;
+
+} // namespace TileCompression
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_TILECOMPRESSION_H
@@ -109,6 +109,15 @@ double getTimeElapsed(const TimestampVal& start, const TimestampVal& end, double
 #endif
 }
 
+TimestampVal addTimeToTimestamp(const TimestampVal& timestamp, double seconds, double frequency)
+{
+#ifdef HAVE_CXX11_CHRONO
+    return timestamp + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(seconds));
+#else
+    return timestamp + seconds * frequency;
+#endif
+}
+
 static double getTimeElapsedClamped(const TimestampVal& start, const TimestampVal& end, double frequency = 1.)
 {
     return std::min(0., getTimeElapsed(start, end, frequency));
@@ -91,6 +91,11 @@ double getPerformanceFrequency();
  **/
 double getTimeElapsed(const TimestampVal& start, const TimestampVal& end, double frequency = 1.);
 
+/**
+ * @brief Returns the timestamp that is the given number of seconds after timestamp.
+ **/
+TimestampVal addTimeToTimestamp(const TimestampVal& timestamp, double seconds, double frequency = 1.);
+
 class Timer
     : public QObject
 {
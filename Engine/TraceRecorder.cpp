@@ -0,0 +1,381 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TraceRecorder.h"
+
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <vector>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/ThreadStorage.h"
+#include "Engine/Timer.h"
+
+// The spans recorded by a thread past this number are dropped, so that a forgotten recording does not use all the memory
+#define NATRON_TRACE_RECORDER_MAX_SPANS_PER_THREAD 1000000
+
+// Likewise for the values of the counters
+#define NATRON_TRACE_RECORDER_MAX_COUNTER_VALUES 1000000
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct TraceSpan
+{
+    const char* name;
+    std::string detail;
+    TraceCategoryEnum category;
+    double startTime;
+    double duration;
+};
+
+// The spans of a single thread
+struct TraceThreadBuffer
+{
+    // Only contended when the trace is written or reset
+    QMutex lock;
+    std::vector<TraceSpan> spans;
+    std::size_t nDroppedSpans;
+
+    // Identifies the thread in the trace
+    int threadIndex;
+    std::string threadName;
+
+    TraceThreadBuffer()
+    : lock()
+    , spans()
+    , nDroppedSpans(0)
+    , threadIndex(0)
+    , threadName()
+    {
+    }
+};
+
+typedef boost::shared_ptr<TraceThreadBuffer> TraceThreadBufferPtr;
+
+struct TraceCounterValues
+{
+    const char* name;
+    std::vector<std::pair<const char*, double> > values;
+    double time;
+};
+
+class TraceRecorderData
+{
+public:
+
+    QAtomicInt enabled;
+
+    // Gives the start time of the spans
+    TimeLapse clock;
+
+    ThreadStorage<TraceThreadBufferPtr> threadBuffer;
+
+    // Protects threadBuffers. The buffers of the threads that ended are kept until the trace is written
+    QMutex threadBuffersLock;
+    std::list<TraceThreadBufferPtr> threadBuffers;
+
+    // Protects counters and nDroppedCounters
+    QMutex countersLock;
+    std::vector<TraceCounterValues> counters;
+    std::size_t nDroppedCounters;
+
+    TraceRecorderData()
+    : enabled()
+    , clock()
+    , threadBuffer()
+    , threadBuffersLock()
+    , threadBuffers()
+    , countersLock()
+    , counters()
+    , nDroppedCounters(0)
+    {
+    }
+
+    TraceThreadBuffer* getThreadBuffer()
+    {
+        TraceThreadBufferPtr& buffer = threadBuffer.localData();
+        if (!buffer) {
+            buffer = boost::make_shared<TraceThreadBuffer>();
+            QThread* thread = QThread::currentThread();
+            if ( qApp && (thread == qApp->thread()) ) {
+                buffer->threadName = "Main thread";
+            } else if ( thread && !thread->objectName().isEmpty() ) {
+                buffer->threadName = thread->objectName().toStdString();
+            }
+            QMutexLocker k(&threadBuffersLock);
+            buffer->threadIndex = (int)threadBuffers.size() + 1;
+            if ( buffer->threadName.empty() ) {
+                buffer->threadName = "Thread " + QString::number(buffer->threadIndex).toStdString();
+            }
+            threadBuffers.push_back(buffer);
+        }
+        return buffer.get();
+    }
+};
+
+TraceRecorderData&
+getRecorderData()
+{
+    static TraceRecorderData data;
+
+    return data;
+}
+
+void
+writeJSONString(const std::string& str,
+                std::ostream& os)
+{
+    os << '"';
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        const char c = str[i];
+        if ( (c == '"') || (c == '\\') ) {
+            os << '\\' << c;
+        } else if ( (unsigned char)c < 0x20 ) {
+            os << ' ';
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+TraceRecorder::setEnabled(bool enabled)
+{
+    getRecorderData().enabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+bool
+TraceRecorder::isEnabled()
+{
+#if QT_VERSION < 0x050000
+    return (int)getRecorderData().enabled != 0;
+#else
+    return getRecorderData().enabled.loadAcquire() != 0;
+#endif
+}
+
+void
+TraceRecorder::reset()
+{
+    TraceRecorderData& data = getRecorderData();
+    QMutexLocker k(&data.threadBuffersLock);
+    for (std::list<TraceThreadBufferPtr>::iterator it = data.threadBuffers.begin(); it != data.threadBuffers.end(); ++it) {
+        QMutexLocker l(&(*it)->lock);
+        (*it)->spans.clear();
+        (*it)->nDroppedSpans = 0;
+    }
+    QMutexLocker l(&data.countersLock);
+    data.counters.clear();
+    data.nDroppedCounters = 0;
+}
+
+double
+TraceRecorder::getTime()
+{
+    return getRecorderData().clock.getTimeSinceCreation();
+}
+
+void
+TraceRecorder::recordSpan(TraceCategoryEnum category,
+                          const char* name,
+                          const std::string& detail,
+                          double startTime,
+                          double duration)
+{
+    assert(category >= 0 && category < eTraceCategoryCount);
+    TraceThreadBuffer* buffer = getRecorderData().getThreadBuffer();
+    QMutexLocker k(&buffer->lock);
+    if (buffer->spans.size() >= NATRON_TRACE_RECORDER_MAX_SPANS_PER_THREAD) {
+        ++buffer->nDroppedSpans;
+
+        return;
+    }
+    TraceSpan span;
+    span.name = name;
+    span.detail = detail;
+    span.category = category;
+    span.startTime = startTime;
+    span.duration = duration;
+    buffer->spans.push_back(span);
+}
+
+void
+TraceRecorder::recordCounter(const char* name,
+                             const std::vector<std::pair<const char*, double> >& values,
+                             double time)
+{
+    TraceRecorderData& data = getRecorderData();
+    QMutexLocker k(&data.countersLock);
+    if (data.counters.size() >= NATRON_TRACE_RECORDER_MAX_COUNTER_VALUES) {
+        ++data.nDroppedCounters;
+
+        return;
+    }
+    TraceCounterValues counter;
+    counter.name = name;
+    counter.values = values;
+    counter.time = time;
+    data.counters.push_back(counter);
+}
+
+std::size_t
+TraceRecorder::getSpansCount()
+{
+    TraceRecorderData& data = getRecorderData();
+    std::size_t ret = 0;
+    QMutexLocker k(&data.threadBuffersLock);
+    for (std::list<TraceThreadBufferPtr>::iterator it = data.threadBuffers.begin(); it != data.threadBuffers.end(); ++it) {
+        QMutexLocker l(&(*it)->lock);
+        ret += (*it)->spans.size();
+    }
+    return ret;
+}
+
+std::string
+TraceRecorder::getCategoryName(TraceCategoryEnum category)
+{
+    switch (category) {
+    case eTraceCategoryRender:
+        return "render";
+    case eTraceCategoryCache:
+        return "cache";
+    case eTraceCategoryWait:
+        return "wait";
+    case eTraceCategoryOFX:
+        return "ofx";
+    case eTraceCategoryGPU:
+        return "gpu";
+    case eTraceCategoryIO:
+        return "io";
+    case eTraceCategoryCount:
+        break;
+    }
+
+    return std::string();
+}
+
+bool
+TraceRecorder::writeTrace(const std::string& filePath)
+{
+    std::ofstream ofile( filePath.c_str() );
+    if ( !ofile.good() ) {
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    std::size_t nDroppedSpans = 0;
+    bool first = true;
+
+    // Times are in microseconds in the trace-event format
+    ofile << std::fixed << std::setprecision(3);
+    ofile << "{\"traceEvents\": [";
+
+    TraceRecorderData& data = getRecorderData();
+    QMutexLocker k(&data.threadBuffersLock);
+    for (std::list<TraceThreadBufferPtr>::iterator it = data.threadBuffers.begin(); it != data.threadBuffers.end(); ++it) {
+        QMutexLocker l(&(*it)->lock);
+        const TraceThreadBuffer& buffer = **it;
+        nDroppedSpans += buffer.nDroppedSpans;
+
+        // Names the track of the thread
+        ofile << (first ? "\n" : ",\n");
+        first = false;
+        ofile << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": " << buffer.threadIndex << ", \"args\": {\"name\": ";
+        writeJSONString(buffer.threadName, ofile);
+        ofile << "}}";
+
+        for (std::size_t i = 0; i < buffer.spans.size(); ++i) {
+            const TraceSpan& span = buffer.spans[i];
+            ofile << ",\n{\"name\": ";
+            writeJSONString(span.detail.empty() ? std::string(span.name) : std::string(span.name) + ' ' + span.detail, ofile);
+            ofile << ", \"cat\": \"" << getCategoryName(span.category) << "\", \"ph\": \"X\", \"ts\": " << span.startTime * 1e6
+                  << ", \"dur\": " << span.duration * 1e6 << ", \"pid\": " << pid << ", \"tid\": " << buffer.threadIndex << "}";
+        }
+    }
+    k.unlock();
+
+    std::size_t nDroppedCounters;
+    {
+        QMutexLocker l(&data.countersLock);
+        nDroppedCounters = data.nDroppedCounters;
+        for (std::size_t i = 0; i < data.counters.size(); ++i) {
+            const TraceCounterValues& counter = data.counters[i];
+            ofile << (first ? "\n" : ",\n");
+            first = false;
+            ofile << "{\"name\": ";
+            writeJSONString(counter.name, ofile);
+            ofile << ", \"ph\": \"C\", \"ts\": " << counter.time * 1e6 << ", \"pid\": " << pid << ", \"args\": {";
+            for (std::size_t j = 0; j < counter.values.size(); ++j) {
+                if (j > 0) {
+                    ofile << ", ";
+                }
+                writeJSONString(counter.values[j].first, ofile);
+                ofile << ": " << counter.values[j].second;
+            }
+            ofile << "}}";
+        }
+    }
+    ofile << "\n],\n";
+    ofile << "\"displayTimeUnit\": \"ms\",\n";
+    ofile << "\"otherData\": {\"version\": \"" << NATRON_VERSION_STRING << "\", \"droppedSpans\": " << nDroppedSpans << ", \"droppedCounterValues\": " << nDroppedCounters << "}\n";
+    ofile << "}\n";
+
+    return ofile.good();
+} // writeTrace
+
+TraceSpan_RAII::TraceSpan_RAII(TraceCategoryEnum category,
+                               const char* name)
+    : _category(category)
+    , _name(name)
+    , _detail()
+    , _recording( TraceRecorder::isEnabled() )
+    , _startTime(_recording ? TraceRecorder::getTime() : 0.)
+{
+}
+
+TraceSpan_RAII::~TraceSpan_RAII()
+{
+    if (_recording) {
+        TraceRecorder::recordSpan(_category, _name, _detail, _startTime, TraceRecorder::getTime() - _startTime);
+    }
+}
+
+NATRON_NAMESPACE_EXIT
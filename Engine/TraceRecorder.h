@@ -0,0 +1,156 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_TraceRecorder_h
+#define Engine_TraceRecorder_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The kinds of spans the TraceRecorder records, shown as categories in the trace viewer
+ **/
+enum TraceCategoryEnum
+{
+    // The render of a FrameViewRequest by a FrameViewRenderRunnable
+    eTraceCategoryRender = 0,
+
+    // The look-ups of the tiles of an image in the cache
+    eTraceCategoryCache,
+
+    // The waits for the tiles pending in other threads or processes
+    eTraceCategoryWait,
+
+    // The OpenFX actions
+    eTraceCategoryOFX,
+
+    // The transfers of images to and from the OpenGL textures
+    eTraceCategoryGPU,
+
+    // The render actions of the Read and Write nodes, which decode and encode files
+    eTraceCategoryIO,
+
+    eTraceCategoryCount
+};
+
+/**
+ * @brief Records the timeline of the renders: which thread ran which render, cache look-up, wait, OpenFX action,
+ * GPU transfer and I/O, and when. The trace is written in the trace-event JSON format, which chrome://tracing
+ * and Perfetto (https://ui.perfetto.dev) display as one track per thread.
+ *
+ * Recording is disabled by default: a span then only checks a flag. It can be enabled from the RenderStatsDialog
+ * or with the --trace <file> command-line option, which writes the trace when the application exits.
+ * Each thread records its spans in its own buffer, so that recording threads do not contend.
+ * The counters are shown as graphs above the threads.
+ **/
+class TraceRecorder
+{
+public:
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    /**
+     * @brief Discards the spans recorded so far
+     **/
+    static void reset();
+
+    /**
+     * @brief Returns the time in seconds since the recorder was created, which spans start at
+     **/
+    static double getTime();
+
+    /**
+     * @brief Records a span of the caller thread. The name must be a string literal, the detail is appended to it
+     * in the trace, e.g the name of the node.
+     **/
+    static void recordSpan(TraceCategoryEnum category, const char* name, const std::string& detail, double startTime, double duration);
+
+    /**
+     * @brief Records the values of a counter of the process at the given time, e.g the number of tasks queued.
+     * Each value is a series of the counter. The name and the names of the series must be string literals.
+     **/
+    static void recordCounter(const char* name, const std::vector<std::pair<const char*, double> >& values, double time);
+
+    static std::size_t getSpansCount();
+
+    static std::string getCategoryName(TraceCategoryEnum category);
+
+    /**
+     * @brief Writes the spans recorded so far in the trace-event JSON format. Returns false if the file cannot be written.
+     **/
+    static bool writeTrace(const std::string& filePath);
+};
+
+/**
+ * @brief Records a span of the caller thread for the lifetime of this object when the TraceRecorder is enabled
+ **/
+class TraceSpan_RAII
+{
+public:
+
+    TraceSpan_RAII(TraceCategoryEnum category, const char* name);
+
+    ~TraceSpan_RAII();
+
+    /**
+     * @brief True if the span is recorded: the caller may then build its detail
+     **/
+    bool isRecording() const
+    {
+        return _recording;
+    }
+
+    void setDetail(const std::string& detail)
+    {
+        _detail = detail;
+    }
+
+    void setCategory(TraceCategoryEnum category)
+    {
+        _category = category;
+    }
+
+private:
+
+    TraceCategoryEnum _category;
+    const char* _name;
+    std::string _detail;
+    bool _recording;
+    double _startTime;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_TraceRecorder_h
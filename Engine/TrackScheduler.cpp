@@ -29,23 +29,38 @@
 #define TRACKER_MAX_TRACKS_FOR_PARTIAL_VIEWER_UPDATE 8
 #define NATRON_TRACKER_REPORT_PROGRESS_DELTA_MS 200
 
+// How many frames a marker may be ahead of the slowest marker
+#define TRACKER_PIPELINE_MAX_FRAMES_AHEAD 4
+
+// How often the scheduler checks for abortion while the markers are tracked
+#define TRACKER_PIPELINE_WAIT_TIMEOUT_MS 50
+
+// How many frames beyond the ones the markers may already be tracking are rendered ahead into the Cache
+#define TRACKER_PREFETCH_N_FRAMES 8
+
+#include <algorithm>
+#include <list>
+#include <vector>
+
 #include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
 
 
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
+#include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
 #include <QtCore/QCoreApplication>
-#include <QFuture>
-#include <QFutureWatcher>
-#include <QtConcurrentMap>
+#include <QtConcurrentRun>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
 #include "Engine/KnobTypes.h"
 #include "Engine/TimeLine.h"
 #include "Engine/TrackArgs.h"
+#include "Engine/TrackerFramePrefetcher.h"
 #include "Engine/TLSHolder.h"
 #include "Engine/Timer.h"
 #include "Engine/Node.h"
@@ -57,6 +72,220 @@ CLANG_DIAG_ON(uninitialized)
 
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Tracks all markers over a sequence of frames without waiting for all markers at each frame.
+ * Each marker is tracked frame after frame by tasks of the global thread pool, so that a marker does not wait for the slowest one
+ * and the frames needed by the markers ahead are fetched while the others are still being matched.
+ * A marker may be at most TRACKER_PIPELINE_MAX_FRAMES_AHEAD frames ahead of the slowest marker, so that the images fetched by the
+ * frame accessor shared by the markers are still needed by the other markers.
+ * A marker only tracks a frame once a marker succeeded at the previous frame: when all markers fail at a frame, tracking stops
+ * at that frame as when all markers wait for each other at each frame.
+ * A task is never blocked waiting for other markers: a marker that cannot advance is resumed by the task that unblocks it.
+ **/
+class TrackPipeline
+: public boost::enable_shared_from_this<TrackPipeline>
+{
+public:
+
+    TrackPipeline(const TrackerParamsProviderBasePtr& paramsProvider,
+                  const TrackArgsBasePtr& args,
+                  int firstFrame,
+                  int frameStep,
+                  int nFrames)
+    : _paramsProvider(paramsProvider)
+    , _args(args)
+    , _firstFrame(firstFrame)
+    , _frameStep(frameStep)
+    , _nFrames(nFrames)
+    , _numTracks( args->getNumTracks() )
+    , _lock()
+    , _cond()
+    , _nextFrame(_numTracks, 0)
+    , _running(_numTracks, false)
+    , _nFinished(nFrames, 0)
+    , _nSucceeded(nFrames, 0)
+    , _nFramesFinished(0)
+    , _stopFrame(nFrames)
+    , _nRunning(0)
+    , _aborted(false)
+    {
+    }
+
+    /**
+     * @brief Launches the tracking of the first frame for all markers
+     **/
+    void start()
+    {
+        QMutexLocker k(&_lock);
+        launchEligibleSteps();
+    }
+
+    /**
+     * @brief Waits until more than nFramesKnown frames are finished by all markers, the tracking ended or the timeout expired.
+     * @param finished[out] Set to true if no marker can track any frame anymore
+     * @returns The number of frames finished by all markers from the first frame
+     **/
+    int waitForFrames(int nFramesKnown, unsigned long timeoutMS, bool* finished)
+    {
+        QMutexLocker k(&_lock);
+        if ( (_nFramesFinished <= nFramesKnown) && (_nRunning > 0) ) {
+            _cond.wait(&_lock, timeoutMS);
+        }
+        *finished = _nRunning == 0;
+        return _nFramesFinished;
+    }
+
+    /**
+     * @brief Returns true if at least one marker succeeded at the given frame index
+     **/
+    bool hasSucceeded(int frameIndex) const
+    {
+        QMutexLocker k(&_lock);
+        return _nSucceeded[frameIndex] > 0;
+    }
+
+    /**
+     * @brief No frame is launched after this call, running steps are finished. Blocks until they are.
+     **/
+    void abortAndWait()
+    {
+        QMutexLocker k(&_lock);
+        _aborted = true;
+        while (_nRunning > 0) {
+            _cond.wait(&_lock);
+        }
+    }
+
+private:
+
+    int getFrame(int frameIndex) const
+    {
+        return _firstFrame + frameIndex * _frameStep;
+    }
+
+    // Must be called with _lock held
+    bool canTrack(int trackIndex) const
+    {
+        if (_aborted || _running[trackIndex]) {
+            return false;
+        }
+        int frameIndex = _nextFrame[trackIndex];
+        if ( (frameIndex >= _stopFrame) || (frameIndex >= _nFramesFinished + TRACKER_PIPELINE_MAX_FRAMES_AHEAD) ) {
+            return false;
+        }
+        return frameIndex == 0 || _nSucceeded[frameIndex - 1] > 0;
+    }
+
+    // Must be called with _lock held
+    void launchEligibleSteps()
+    {
+        for (int i = 0; i < _numTracks; ++i) {
+            if ( canTrack(i) ) {
+                _running[i] = true;
+                ++_nRunning;
+                QtConcurrent::run( boost::bind(&TrackPipeline::runStep, shared_from_this(), i) );
+            }
+        }
+    }
+
+    void runStep(int trackIndex)
+    {
+        int frameIndex;
+        {
+            QMutexLocker k(&_lock);
+            frameIndex = _nextFrame[trackIndex];
+        }
+
+        bool ret = _paramsProvider->trackStepFunctor( trackIndex, _args, getFrame(frameIndex) );
+
+        QMutexLocker k(&_lock);
+        ++_nFinished[frameIndex];
+        if (ret) {
+            ++_nSucceeded[frameIndex];
+        }
+        _nextFrame[trackIndex] = frameIndex + 1;
+        _running[trackIndex] = false;
+        while ( (_nFramesFinished < _stopFrame) && (_nFinished[_nFramesFinished] == _numTracks) ) {
+            // We don't have any successful track, stop
+            if (_nSucceeded[_nFramesFinished] == 0) {
+                _stopFrame = _nFramesFinished + 1;
+            }
+            ++_nFramesFinished;
+        }
+
+        // This marker and the ones waiting for this frame may advance
+        launchEligibleSteps();
+        --_nRunning;
+        _cond.wakeAll();
+    } // runStep
+
+    TrackerParamsProviderBasePtr _paramsProvider;
+    TrackArgsBasePtr _args;
+    const int _firstFrame, _frameStep, _nFrames, _numTracks;
+
+    // Protects all fields below
+    mutable QMutex _lock;
+
+    // Signaled each time a step finishes
+    QWaitCondition _cond;
+
+    // For each marker, the index of the next frame to track and whether a step is launched for it
+    std::vector<int> _nextFrame;
+    std::vector<bool> _running;
+
+    // For each frame index, the number of markers which tracked it and the number of those which succeeded
+    std::vector<int> _nFinished, _nSucceeded;
+
+    // The number of frames, from the first, tracked by all markers
+    int _nFramesFinished;
+
+    // No marker tracks a frame index beyond this one
+    int _stopFrame;
+
+    // The number of steps launched and not finished
+    int _nRunning;
+    bool _aborted;
+};
+
+/**
+ * @brief Asks the prefetcher to render the frames that the markers will need after the ones they may already be tracking,
+ * up to TRACKER_PREFETCH_N_FRAMES frames ahead. nFramesPrefetched is the number of frames from the first already requested.
+ * Only the search windows of the markers at the last frame tracked by all markers are rendered, grown by
+ * a quarter of their size on each side to account for the motion over the next frames.
+ **/
+static void
+prefetchFramesAhead(const TrackerFramePrefetcherPtr& prefetcher,
+                    const NodePtr& sourceNode,
+                    const TrackArgsBasePtr& args,
+                    int firstFrame,
+                    int frameStep,
+                    int nFrames,
+                    int nFramesTracked,
+                    int* nFramesPrefetched)
+{
+    const int firstIndex = std::max(*nFramesPrefetched, nFramesTracked + TRACKER_PIPELINE_MAX_FRAMES_AHEAD);
+    const int lastIndex = std::min(nFrames, nFramesTracked + TRACKER_PIPELINE_MAX_FRAMES_AHEAD + TRACKER_PREFETCH_N_FRAMES);
+    if (firstIndex >= lastIndex) {
+        return;
+    }
+
+    std::list<RectD> searchWindows;
+    args->getRedrawAreasNeeded(TimeValue(firstFrame + std::max(nFramesTracked - 1, 0) * frameStep), &searchWindows);
+    for (std::list<RectD>::iterator it = searchWindows.begin(); it != searchWindows.end(); ++it) {
+        it->addPaddingPercentage(0.25, 0.25);
+    }
+
+    std::vector<int> frames;
+    for (int i = firstIndex; i < lastIndex; ++i) {
+        frames.push_back(firstFrame + i * frameStep);
+    }
+    prefetcher->prefetchFrames(sourceNode, frames, searchWindows);
+    *nFramesPrefetched = lastIndex;
+} // prefetchFramesAhead
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 struct TrackSchedulerPrivate
 {
@@ -143,10 +372,6 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
     TrackerParamsProviderBasePtr paramsProvider = _imp->paramsProvider.lock();
 
     const int numTracks = args->getNumTracks();
-    std::vector<int> trackIndexes(numTracks);
-    for (std::size_t i = 0; i < trackIndexes.size(); ++i) {
-        trackIndexes[i] = i;
-    }
 
     paramsProvider->beginTrackSequence(args);
 
@@ -157,105 +382,107 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
     timeval lastProgressUpdateTime;
     gettimeofday(&lastProgressUpdateTime, 0);
 
-    bool allTrackFailed = false;
     {
         ///Use RAII style for setting the isDoingPartialUpdates flag so we're sure it gets removed
         IsTrackingFlagSetter_RAII __istrackingflag__(this, frameStep, viewer, doPartialUpdates);
 
         if ( (frameStep == 0) || ( (frameStep > 0) && (start >= end) ) || ( (frameStep < 0) && (start <= end) ) ) {
             // Invalid range
-            cur = end;
+            framesCount = 0;
         }
 
+        ///Track all markers in parallel using the global thread pool
+        boost::shared_ptr<TrackPipeline> pipeline = boost::make_shared<TrackPipeline>(paramsProvider, args, start, frameStep, framesCount);
+        pipeline->start();
+
+        // Render the frames ahead of the markers while they are tracked
+        NodePtr sourceNode = paramsProvider->getSourceImageNode();
+        TrackerFramePrefetcherPtr prefetcher;
+        int nFramesPrefetched = 0;
+        if (sourceNode) {
+            prefetcher = TrackerFramePrefetcher::create();
+            prefetchFramesAhead(prefetcher, sourceNode, args, start, frameStep, framesCount, 0, &nFramesPrefetched);
+        }
+
+        int nFramesReported = 0;
+        bool finished = false;
+        while (!finished) {
+            int nFramesTracked = pipeline->waitForFrames(nFramesReported, TRACKER_PIPELINE_WAIT_TIMEOUT_MS, &finished);
+
+            // Report the frames tracked by all markers since the last iteration
+            const int nFramesReportedBefore = nFramesReported;
+            bool allTrackFailed = false;
+            for (; nFramesReported < nFramesTracked; ++nFramesReported) {
+                lastValidFrame = start + nFramesReported * frameStep;
 
-        while (cur != end) {
-            ///Launch parallel thread for each track using the global thread pool
-            QFuture<bool> future = QtConcurrent::mapped( trackIndexes,
-                                                        boost::bind(&TrackerParamsProviderBase::trackStepFunctor,
-                                                                    paramsProvider.get(),
-                                                                    _1,
-                                                                    args,
-                                                                    cur) );
-            future.waitForFinished();
-
-            allTrackFailed = true;
-            for (QFuture<bool>::const_iterator it = future.begin(); it != future.end(); ++it) {
-                if ( (*it) ) {
-                    allTrackFailed = false;
+                // We don't have any successful track, stop
+                if ( !pipeline->hasSucceeded(nFramesReported) ) {
+                    allTrackFailed = true;
                     break;
                 }
             }
-
-
-
-            lastValidFrame = cur;
-
-
-
-            // We don't have any successful track, stop
             if (allTrackFailed) {
                 break;
             }
 
+            if (nFramesReported > nFramesReportedBefore) {
+                cur = start + nFramesReported * frameStep;
 
-
-            cur += frameStep;
-
-            double progress;
-            if (frameStep > 0) {
-                progress = (double)(cur - start) / framesCount;
-            } else {
-                progress = (double)(start - cur) / framesCount;
-            }
-
-            bool isUpdateViewerOnTrackingEnabled = paramsProvider->getUpdateViewer();
-            bool isCenterViewerEnabled = paramsProvider->getCenterOnTrack();
-            bool enoughTimePassedToReportProgress;
-            {
-                timeval now;
-                gettimeofday(&now, 0);
-                double dt =  now.tv_sec  - lastProgressUpdateTime.tv_sec +
-                (now.tv_usec - lastProgressUpdateTime.tv_usec) * 1e-6f;
-                dt *= 1000; // switch to MS
-                enoughTimePassedToReportProgress = dt > NATRON_TRACKER_REPORT_PROGRESS_DELTA_MS;
-                if (enoughTimePassedToReportProgress) {
-                    lastProgressUpdateTime = now;
+                if (prefetcher) {
+                    prefetchFramesAhead(prefetcher, sourceNode, args, start, frameStep, framesCount, nFramesReported, &nFramesPrefetched);
                 }
-            }
-
 
-            ///Ok all tracks are finished now for this frame, refresh viewer if needed
-            if (isUpdateViewerOnTrackingEnabled && viewer) {
-                //This will not refresh the viewer since when tracking, renderCurrentFrame()
-                //is not called on viewers, see Gui::onTimeChanged
-                timeline->seekFrame(cur, true, EffectInstancePtr(), eTimelineChangeReasonOtherSeek);
+                double progress = (double)nFramesReported / framesCount;
+
+                bool isUpdateViewerOnTrackingEnabled = paramsProvider->getUpdateViewer();
+                bool isCenterViewerEnabled = paramsProvider->getCenterOnTrack();
+                bool enoughTimePassedToReportProgress;
+                {
+                    timeval now;
+                    gettimeofday(&now, 0);
+                    double dt =  now.tv_sec  - lastProgressUpdateTime.tv_sec +
+                    (now.tv_usec - lastProgressUpdateTime.tv_usec) * 1e-6f;
+                    dt *= 1000; // switch to MS
+                    enoughTimePassedToReportProgress = dt > NATRON_TRACKER_REPORT_PROGRESS_DELTA_MS;
+                    if (enoughTimePassedToReportProgress) {
+                        lastProgressUpdateTime = now;
+                    }
+                }
 
-                if (enoughTimePassedToReportProgress) {
-                    if (doPartialUpdates) {
-                        std::list<RectD> updateRects;
 
-                        double unionPx = 0;
-                        args->getRedrawAreasNeeded(TimeValue(cur), &updateRects);
-                        for (std::list<RectD>::const_iterator it = updateRects.begin(); it != updateRects.end(); ++it) {
-                            unionPx += it->area();
-                        }
-                        double totalPx = args->getFormatHeight() * args->getFormatWidth();
-                        if (totalPx > 0 && unionPx / totalPx >= 0.5) {
-                            // If the update areas cover more than half the image, redraw it all as usual
-                            viewer->clearPartialUpdateParams();
+                ///Ok all tracks are finished now for this frame, refresh viewer if needed
+                if (isUpdateViewerOnTrackingEnabled && viewer) {
+                    //This will not refresh the viewer since when tracking, renderCurrentFrame()
+                    //is not called on viewers, see Gui::onTimeChanged
+                    timeline->seekFrame(cur, true, EffectInstancePtr(), eTimelineChangeReasonOtherSeek);
+
+                    if (enoughTimePassedToReportProgress) {
+                        if (doPartialUpdates) {
+                            std::list<RectD> updateRects;
+
+                            double unionPx = 0;
+                            args->getRedrawAreasNeeded(TimeValue(cur), &updateRects);
+                            for (std::list<RectD>::const_iterator it = updateRects.begin(); it != updateRects.end(); ++it) {
+                                unionPx += it->area();
+                            }
+                            double totalPx = args->getFormatHeight() * args->getFormatWidth();
+                            if (totalPx > 0 && unionPx / totalPx >= 0.5) {
+                                // If the update areas cover more than half the image, redraw it all as usual
+                                viewer->clearPartialUpdateParams();
+                            } else {
+                                viewer->setPartialUpdateParams(updateRects, isCenterViewerEnabled);
+                            }
                         } else {
-                            viewer->setPartialUpdateParams(updateRects, isCenterViewerEnabled);
+                            viewer->clearPartialUpdateParams();
                         }
-                    } else {
-                        viewer->clearPartialUpdateParams();
+                        Q_EMIT renderCurrentFrameForViewer(viewer);
                     }
-                    Q_EMIT renderCurrentFrameForViewer(viewer);
                 }
-            }
 
-            if (enoughTimePassedToReportProgress) {
-                ///Notify we progressed of 1 frame
-                Q_EMIT trackingProgress(progress);
+                if (enoughTimePassedToReportProgress) {
+                    ///Notify we progressed
+                    Q_EMIT trackingProgress(progress);
+                }
             }
 
             // Check for abortion
@@ -263,7 +490,16 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
             if ( (state == eThreadStateAborted) || (state == eThreadStateStopped) ) {
                 break;
             }
-        } // while (cur != end) {
+        } // while (!finished)
+
+        // Wait for the markers being tracked before ending the sequence
+        pipeline->abortAndWait();
+
+        // The frames ahead are not needed anymore
+        if (prefetcher) {
+            prefetcher->quitThread(false);
+            prefetcher->waitForThreadToQuit_not_main_thread();
+        }
     } // IsTrackingFlagSetter_RAII
 
     paramsProvider->endTrackSequence(args);
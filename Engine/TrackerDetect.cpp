@@ -24,6 +24,15 @@
 
 #include "TrackerDetect.h"
 
+#include <algorithm> // std::stable_sort
+#include <cstring> // memcpy
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/bind.hpp>
+#endif
+
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
 #include "Engine/RectI.h"
 #include "Engine/Image.h"
 #include "Engine/KnobItemsTable.h"
@@ -39,6 +48,12 @@ GCC_DIAG_OFF(maybe-uninitialized)
 GCC_DIAG_ON(unused-function)
 GCC_DIAG_ON(unused-parameter)
 
+// The size of the tiles in which features are detected in parallel, in pixels
+#define TRACKER_DETECT_TILE_SIZE 512
+
+// The tiles are extended by this many pixels so that the detectors have the pixels they need around the features of the tile
+#define TRACKER_DETECT_TILE_OVERLAP 16
+
 NATRON_NAMESPACE_ENTER
 
 TrackerDetect::DetectionArgs::DetectionArgs()
@@ -85,14 +100,96 @@ static void libmvFeatureToNatronFeature(const libmv::Feature& mvFeature, Tracker
     feature->size = mvFeature.size;
 }
 
-void TrackerDetect::detectFeatures(const ImagePtr& image, const RectI& roi, const DetectionArgs& args, std::vector<Feature>* features)
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct DetectionTile
+{
+    // The features of the tile are in these bounds, in the coordinates of the image
+    RectI bounds;
+
+    std::vector<TrackerDetect::Feature> features;
+};
+
+struct FeatureCompareScoreGreater
+{
+    bool operator() (const TrackerDetect::Feature& lhs,
+                     const TrackerDetect::Feature& rhs) const
+    {
+        return lhs.score > rhs.score;
+    }
+};
+
+/**
+ * @brief Detects the features of the tile on the tile extended by TRACKER_DETECT_TILE_OVERLAP.
+ * Features closer than min_distance to a better feature of the tile are already removed.
+ **/
+void
+detectTile(const MvFloatImage* image,
+           const libmv::DetectOptions* options,
+           int margin,
+           TrackerDetect::DetectionListener* listener,
+           DetectionTile& tile)
+{
+    const int width = image->Width();
+    const int height = image->Height();
+
+    RectI extendedBounds = tile.bounds;
+    extendedBounds.x1 = std::max(0, extendedBounds.x1 - TRACKER_DETECT_TILE_OVERLAP);
+    extendedBounds.y1 = std::max(0, extendedBounds.y1 - TRACKER_DETECT_TILE_OVERLAP);
+    extendedBounds.x2 = std::min(width, extendedBounds.x2 + TRACKER_DETECT_TILE_OVERLAP);
+    extendedBounds.y2 = std::min(height, extendedBounds.y2 + TRACKER_DETECT_TILE_OVERLAP);
+
+    MvFloatImage tileImage( extendedBounds.height(), extendedBounds.width() );
+    for (int y = extendedBounds.y1; y < extendedBounds.y2; ++y) {
+        memcpy( tileImage.Data() + (y - extendedBounds.y1) * extendedBounds.width(),
+                image->Data() + y * width + extendedBounds.x1,
+                extendedBounds.width() * sizeof(float) );
+    }
+
+    libmv::vector<libmv::Feature> detectedFeatures;
+    libmv::Detect(tileImage, *options, &detectedFeatures);
+
+    for (int i = 0; i < detectedFeatures.size(); ++i) {
+        const libmv::Feature& mvFeature = detectedFeatures[i];
+        int x = (int)mvFeature.x + extendedBounds.x1;
+        int y = (int)mvFeature.y + extendedBounds.y1;
+
+        // Features in the overlap belong to the neighbour tiles
+        if ( !tile.bounds.contains(x, y) ) {
+            continue;
+        }
+        // No features are detected within the margin of the image
+        if ( (x < margin) || (x >= width - margin) || (y < margin) || (y >= height - margin) ) {
+            continue;
+        }
+        libmv::Feature imageFeature = mvFeature;
+        imageFeature.x += extendedBounds.x1;
+        imageFeature.y += extendedBounds.y1;
+
+        TrackerDetect::Feature feature;
+        libmvFeatureToNatronFeature(imageFeature, &feature);
+        tile.features.push_back(feature);
+    }
+
+    if ( listener && !tile.features.empty() ) {
+        listener->onFeaturesDetected(tile.features);
+    }
+} // detectTile
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void TrackerDetect::detectFeatures(const ImagePtr& image,
+                                   const RectI& roi,
+                                   const DetectionArgs& args,
+                                   std::vector<Feature>* features,
+                                   DetectionListener* listener)
 {
     if (!image) {
         return;
     }
     bool enabledChannels[3] = {true,true,true};
 
-    MvFloatImage libmvImage;
+    MvFloatImage libmvImage( roi.height(), roi.width() );
     ActionRetCodeEnum stat = TrackerFrameAccessor::natronImageToLibMvFloatImage(enabledChannels, *image, roi, false /*dstFromAlpha*/, libmvImage);
     if (isFailureRetCode(stat)) {
         return;
@@ -101,14 +198,60 @@ void TrackerDetect::detectFeatures(const ImagePtr& image, const RectI& roi, cons
     libmv::DetectOptions options;
     natronDetectionArgsToLibMvOptions(args, &options);
 
-    libmv::vector<libmv::Feature> detected_features;
-    libmv::Detect(libmvImage, options, &detected_features);
+    if (options.type == libmv::DetectOptions::MORAVEC) {
+        // The Moravec detector selects the features from the histogram of the scores of the whole image, it cannot be split
+        libmv::vector<libmv::Feature> detected_features;
+        libmv::Detect(libmvImage, options, &detected_features);
 
-    features->resize(detected_features.size());
-    for (int i = 0; i < detected_features.size(); ++i) {
-        const libmv::Feature& mvFeature = detected_features[i];
-        libmvFeatureToNatronFeature(mvFeature,&(*features)[i]);
+        features->resize(detected_features.size());
+        for (int i = 0; i < detected_features.size(); ++i) {
+            const libmv::Feature& mvFeature = detected_features[i];
+            libmvFeatureToNatronFeature(mvFeature,&(*features)[i]);
+        }
+        if ( listener && !features->empty() ) {
+            listener->onFeaturesDetected(*features);
+        }
+        return;
     }
-}
+
+    // Detect features in tiles on the thread pool, the margin is applied to the whole image
+    options.margin = 0;
+    std::vector<DetectionTile> tiles;
+    for (int y = 0; y < roi.height(); y += TRACKER_DETECT_TILE_SIZE) {
+        for (int x = 0; x < roi.width(); x += TRACKER_DETECT_TILE_SIZE) {
+            DetectionTile tile;
+            tile.bounds.x1 = x;
+            tile.bounds.y1 = y;
+            tile.bounds.x2 = std::min(x + TRACKER_DETECT_TILE_SIZE, roi.width());
+            tile.bounds.y2 = std::min(y + TRACKER_DETECT_TILE_SIZE, roi.height());
+            tiles.push_back(tile);
+        }
+    }
+    QtConcurrent::blockingMap( tiles, boost::bind(&detectTile, &libmvImage, &options, args.margin, listener, _1) );
+
+    // Merge the tiles: like the detectors do within a tile, features closer than min_distance to a better feature are removed
+    std::vector<Feature> allFeatures;
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        allFeatures.insert( allFeatures.end(), tiles[i].features.begin(), tiles[i].features.end() );
+    }
+    std::stable_sort( allFeatures.begin(), allFeatures.end(), FeatureCompareScoreGreater() );
+
+    const double minDistanceSquared = (double)args.min_distance * args.min_distance;
+    features->clear();
+    for (std::size_t i = 0; i < allFeatures.size(); ++i) {
+        const Feature& a = allFeatures[i];
+        bool ok = true;
+        for (std::size_t j = 0; j < features->size(); ++j) {
+            const Feature& b = (*features)[j];
+            if ( (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) < minDistanceSquared ) {
+                ok = false;
+                break;
+            }
+        }
+        if (ok) {
+            features->push_back(a);
+        }
+    }
+} // detectFeatures
 
 NATRON_NAMESPACE_EXIT
@@ -105,7 +105,36 @@ namespace TrackerDetect
     };
 
 
-    void detectFeatures(const ImagePtr& image, const RectI& roi, const DetectionArgs& args, std::vector<Feature>* features);
+    /**
+     * @brief Receives the features as they are detected, to display them before the detection is finished.
+     **/
+    class DetectionListener
+    {
+    public:
+
+        DetectionListener() {}
+
+        virtual ~DetectionListener() {}
+
+        /**
+         * @brief Called with the features of a part of the image as soon as they are detected. These features may
+         * still be removed from the final result because they are too close to a better feature of a neighbour part.
+         * This is called from the threads of the thread pool, possibly concurrently.
+         **/
+        virtual void onFeaturesDetected(const std::vector<Feature>& features) = 0;
+    };
+
+    /**
+     * @brief Detects the features of the image in the given roi. The FAST and Harris detectors work on tiles
+     * in parallel on the thread pool and the features of all tiles are then merged so that no feature is closer than
+     * min_distance to a better one. The Moravec detector selects features globally and runs on the whole image.
+     * @param listener If non-null, it is given the features of each tile as soon as they are detected.
+     **/
+    void detectFeatures(const ImagePtr& image,
+                        const RectI& roi,
+                        const DetectionArgs& args,
+                        std::vector<Feature>* features,
+                        DetectionListener* listener = 0);
 
 } // namespace TrackerDetect
 
@@ -25,6 +25,8 @@
 
 #include "TrackerFrameAccessor.h"
 
+#include <map>
+
 #include <boost/utility.hpp>
 
 GCC_DIAG_OFF(unused-function)
@@ -41,11 +43,15 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/TimeLine.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/FrameViewRequest.h"
+#include "Engine/Half.h"
 #include "Engine/MultiThread.h"
 #include "Engine/Image.h"
 #include "Engine/TreeRender.h"
 #include "Engine/Node.h"
 
+// The memory that may be held by the converted images that are not used by libmv anymore, in bytes
+#define TRACKER_FRAME_ACCESSOR_CACHE_MAX_UNUSED_BYTES (128 * 1024 * 1024)
+
 NATRON_NAMESPACE_ENTER
 
 NATRON_NAMESPACE_ANONYMOUS_ENTER
@@ -102,11 +108,17 @@ struct FrameAccessorCacheEntry
     // If null, this is the full image
     RectI bounds;
     unsigned int referenceCount;
+
+    // When the reference count drops to 0, the entry is kept until it is evicted: this is the order of its last release
+    U64 lastReleaseAge;
 };
 
 
 typedef std::multimap<FrameAccessorCacheKey, FrameAccessorCacheEntry, CacheKey_compare_less > FrameAccessorCache;
 
+// The entries not referenced by libmv, sorted from the least recently released
+typedef std::map<U64, FrameAccessorCache::iterator> FrameAccessorUnusedEntries;
+
 
 class ConvertToLibMVImageProcessorBase : public ImageMultiThreadProcessorBase
 {
@@ -284,6 +296,9 @@ natronImageToLibMvFloatImageForNComps(bool enabledChannels[3],
         case eImageBitDepthShort:
             proc.reset(new ConvertToLibMVImageProcessor<srcNComps, unsigned short, 65535>(renderClone));
             break;
+        case eImageBitDepthHalf:
+            proc.reset(new ConvertToLibMVImageProcessor<srcNComps, Half, 1>(renderClone));
+            break;
         case eImageBitDepthFloat:
             proc.reset(new ConvertToLibMVImageProcessor<srcNComps, float, 1>(renderClone));
             break;
@@ -329,8 +344,19 @@ struct TrackerFrameAccessorPrivate
     NodePtr sourceImageProvider, maskImageProvider;
     ImagePlaneDesc maskImagePlane;
     int maskPlaneIndex;
+
+    // Protects cache, unusedEntries, unusedEntriesSize and releaseAge
     mutable QMutex cacheMutex;
+
+    // The converted images, shared by all markers. Since the enabled channels are the same for all requests
+    // of the accessor, they are not part of the key.
     FrameAccessorCache cache;
+
+    // The entries of the cache that are not used by libmv, they are evicted in LRU order
+    FrameAccessorUnusedEntries unusedEntries;
+    std::size_t unusedEntriesSize;
+    U64 releaseAge;
+
     bool enabledChannels[3];
     int formatHeight;
 
@@ -346,11 +372,56 @@ struct TrackerFrameAccessorPrivate
         , maskPlaneIndex(maskPlaneIndex)
         , cacheMutex()
         , cache()
+        , unusedEntries()
+        , unusedEntriesSize(0)
+        , releaseAge(0)
         , enabledChannels()
         , formatHeight(formatHeight)
     {
         memcpy(this->enabledChannels, enabledChannels, sizeof(bool) * 3);
     }
+
+    /**
+     * @brief Increments the reference count of the entry, removing it from the unused entries if needed.
+     * Must be called with cacheMutex held.
+     **/
+    void refEntry(FrameAccessorCache::iterator it)
+    {
+        if (it->second.referenceCount == 0) {
+            FrameAccessorUnusedEntries::iterator found = unusedEntries.find(it->second.lastReleaseAge);
+            assert(found != unusedEntries.end());
+            if (found != unusedEntries.end()) {
+                unusedEntries.erase(found);
+                unusedEntriesSize -= it->second.image->MemorySizeInBytes();
+            }
+        }
+        ++it->second.referenceCount;
+    }
+
+    /**
+     * @brief Decrements the reference count of the entry. An entry that is not used anymore is kept
+     * until the unused entries exceed TRACKER_FRAME_ACCESSOR_CACHE_MAX_UNUSED_BYTES.
+     * Must be called with cacheMutex held.
+     **/
+    void unrefEntry(FrameAccessorCache::iterator it)
+    {
+        assert(it->second.referenceCount > 0);
+        --it->second.referenceCount;
+        if (it->second.referenceCount > 0) {
+            return;
+        }
+        it->second.lastReleaseAge = ++releaseAge;
+        unusedEntries.insert( std::make_pair(it->second.lastReleaseAge, it) );
+        unusedEntriesSize += it->second.image->MemorySizeInBytes();
+
+        // Evict the least recently released entries
+        while ( (unusedEntriesSize > TRACKER_FRAME_ACCESSOR_CACHE_MAX_UNUSED_BYTES) && !unusedEntries.empty() ) {
+            FrameAccessorCache::iterator toErase = unusedEntries.begin()->second;
+            unusedEntriesSize -= toErase->second.image->MemorySizeInBytes();
+            unusedEntries.erase( unusedEntries.begin() );
+            cache.erase(toErase);
+        }
+    }
 };
 
 TrackerFrameAccessor::TrackerFrameAccessor(const NodePtr& sourceImageProvider,
@@ -465,7 +536,10 @@ TrackerFrameAccessor::GetImageInternal(std::list<mv::FrameAccessor::GetImageArgs
              */
 
             if (args.region) {
-                convertLibMVRegionToRectI(*args.region, _imp->formatHeight, &allRenders[i].roi);
+                // The region is in full resolution coordinates, convert it to the pixel coordinates of the downscaled image
+                RectI fullScaleRoI;
+                convertLibMVRegionToRectI(*args.region, _imp->formatHeight, &fullScaleRoI);
+                allRenders[i].roi = fullScaleRoI.downscalePowerOfTwoSmallestEnclosing( (unsigned int)args.downscale );
 
                 QMutexLocker k(&_imp->cacheMutex);
                 std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = _imp->cache.equal_range(allRenders[i].key);
@@ -481,7 +555,7 @@ TrackerFrameAccessor::GetImageInternal(std::list<mv::FrameAccessor::GetImageArgs
                         // EDIT: fixed libmv
                         args.destination = it->second.image.get();
                         //destination->CopyFrom<float>(*it->second.image);
-                        ++it->second.referenceCount;
+                        _imp->refEntry(it);
 
                         args.destinationKey = (mv::FrameAccessor::Key)it->second.image.get();
                         break;
@@ -489,6 +563,11 @@ TrackerFrameAccessor::GetImageInternal(std::list<mv::FrameAccessor::GetImageArgs
                 }
             }
 
+            if (args.destination) {
+                // Found in the cache, no need to render
+                continue;
+            }
+
             NodePtr sourceNode;
             switch (args.sourceType) {
                 case eGetImageTypeSource:
@@ -510,7 +589,7 @@ TrackerFrameAccessor::GetImageInternal(std::list<mv::FrameAccessor::GetImageArgs
 
             // Convert roi to canonical coordinates
             RectD roiCanonical;
-            allRenders[i].roi.toCanonical_noClipping(0, 1., &roiCanonical);
+            allRenders[i].roi.toCanonical_noClipping( (unsigned int)args.downscale, 1., &roiCanonical );
 
 
             TreeRender::CtorArgsPtr renderArgs(new TreeRender::CtorArgs);
@@ -600,6 +679,7 @@ TrackerFrameAccessor::GetImageInternal(std::list<mv::FrameAccessor::GetImageArgs
         entry.image.reset( new MvFloatImage( roi.height(), roi.width() ) );
         entry.bounds = roi;
         entry.referenceCount = 1;
+        entry.lastReleaseAge = 0;
 
         stat = natronImageToLibMvFloatImage(_imp->enabledChannels,
                                      *sourceImage,
@@ -648,12 +728,8 @@ TrackerFrameAccessor::ReleaseImage(Key key)
 
     for (FrameAccessorCache::iterator it = _imp->cache.begin(); it != _imp->cache.end(); ++it) {
         if (it->second.image.get() == imgKey) {
-            --it->second.referenceCount;
-            if (!it->second.referenceCount) {
-                _imp->cache.erase(it);
-
-                return;
-            }
+            _imp->unrefEntry(it);
+            return;
         }
     }
 }
@@ -0,0 +1,241 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TrackerFramePrefetcher.h"
+
+#include <QMutex>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+#include "Engine/TreeRender.h"
+
+NATRON_NAMESPACE_ENTER
+
+class TrackerFramePrefetcherStartArgs : public GenericThreadStartArgs
+{
+public:
+
+    TrackerFramePrefetcherStartArgs()
+    : GenericThreadStartArgs()
+    , sourceNode()
+    , frames()
+    , canonicalRoIs()
+    {
+
+    }
+
+    virtual ~TrackerFramePrefetcherStartArgs()
+    {
+
+    }
+
+    NodePtr sourceNode;
+    std::vector<int> frames;
+    std::list<RectD> canonicalRoIs;
+};
+
+struct TrackerFramePrefetcherPrivate
+{
+    // Protects currentRenders
+    mutable QMutex currentRendersMutex;
+
+    // The renders of the regions of the frame being prefetched, if any
+    std::list<TreeRenderPtr> currentRenders;
+
+    TrackerFramePrefetcherPrivate()
+    : currentRendersMutex()
+    , currentRenders()
+    {
+
+    }
+};
+
+TrackerFramePrefetcher::TrackerFramePrefetcher()
+: _imp( new TrackerFramePrefetcherPrivate() )
+{
+    setThreadName("TrackerFramePrefetcher");
+}
+
+TrackerFramePrefetcher::~TrackerFramePrefetcher()
+{
+
+}
+
+void
+TrackerFramePrefetcher::prefetchFrames(const NodePtr& sourceNode,
+                                       const std::vector<int>& frames,
+                                       const std::list<RectD>& canonicalRoIs)
+{
+    if ( !sourceNode || frames.empty() ) {
+        return;
+    }
+
+    boost::shared_ptr<TrackerFramePrefetcherStartArgs> args = boost::make_shared<TrackerFramePrefetcherStartArgs>();
+    args->sourceNode = sourceNode;
+    args->frames = frames;
+    args->canonicalRoIs = canonicalRoIs;
+    mergeRegions(&args->canonicalRoIs);
+    if ( args->canonicalRoIs.empty() ) {
+        return;
+    }
+    startTask(args);
+}
+
+void
+TrackerFramePrefetcher::mergeRegions(std::list<RectD>* rects)
+{
+    for (std::list<RectD>::iterator it = rects->begin(); it != rects->end();) {
+        if ( it->isNull() ) {
+            it = rects->erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Merge pairs until no pair can be merged: a merged rectangle may now be merged with one it was too far from
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (std::list<RectD>::iterator it = rects->begin(); it != rects->end() && !merged; ++it) {
+            std::list<RectD>::iterator other = it;
+            for (++other; other != rects->end(); ++other) {
+                RectD bbox = *it;
+                bbox.merge(*other);
+                if ( bbox.area() <= it->area() + other->area() ) {
+                    *it = bbox;
+                    rects->erase(other);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+} // mergeRegions
+
+void
+TrackerFramePrefetcher::onAbortRequested(bool /*keepOldestRender*/)
+{
+    std::list<TreeRenderPtr> renders;
+    {
+        QMutexLocker k(&_imp->currentRendersMutex);
+        renders = _imp->currentRenders;
+    }
+    for (std::list<TreeRenderPtr>::const_iterator it = renders.begin(); it != renders.end(); ++it) {
+        (*it)->setRenderAborted();
+    }
+}
+
+void
+TrackerFramePrefetcher::onWaitForThreadToQuit()
+{
+    waitForAllTreeRenders();
+}
+
+void
+TrackerFramePrefetcher::onWaitForAbortCompleted()
+{
+    waitForAllTreeRenders();
+}
+
+GenericSchedulerThread::ThreadStateEnum
+TrackerFramePrefetcher::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
+{
+    TrackerFramePrefetcherStartArgs* args = dynamic_cast<TrackerFramePrefetcherStartArgs*>(inArgs.get());
+    assert(args);
+
+    EffectInstancePtr effect = args->sourceNode ? args->sourceNode->getEffectInstance() : EffectInstancePtr();
+    if (!effect) {
+        return resolveState();
+    }
+
+    for (std::vector<int>::const_iterator it = args->frames.begin(); it != args->frames.end(); ++it) {
+
+        ThreadStateEnum state = resolveState();
+        if (state != eThreadStateActive) {
+            return state;
+        }
+
+        // Render at full scale, as the frame accessor does for the finest level of the tracker: the results are only
+        // used to fill the Cache.
+        std::list<TreeRenderPtr> renders;
+        for (std::list<RectD>::const_iterator it2 = args->canonicalRoIs.begin(); it2 != args->canonicalRoIs.end(); ++it2) {
+            TreeRender::CtorArgsPtr renderArgs(new TreeRender::CtorArgs);
+            renderArgs->treeRootEffect = effect;
+            renderArgs->provider = shared_from_this();
+            renderArgs->time = TimeValue(*it);
+            renderArgs->mipMapLevel = 0;
+            renderArgs->canonicalRoI = *it2;
+
+            TreeRenderPtr render = TreeRender::create(renderArgs);
+            if (render) {
+                renders.push_back(render);
+            }
+        }
+        if ( renders.empty() ) {
+            break;
+        }
+
+        {
+            QMutexLocker k(&_imp->currentRendersMutex);
+            _imp->currentRenders = renders;
+        }
+
+        for (std::list<TreeRenderPtr>::const_iterator it2 = renders.begin(); it2 != renders.end(); ++it2) {
+            launchRender(*it2);
+        }
+
+        // An abort may have been requested before the renders were registered
+        if ( isBeingAborted() ) {
+            for (std::list<TreeRenderPtr>::const_iterator it2 = renders.begin(); it2 != renders.end(); ++it2) {
+                (*it2)->setRenderAborted();
+            }
+        }
+
+        bool failed = false;
+        for (std::list<TreeRenderPtr>::const_iterator it2 = renders.begin(); it2 != renders.end(); ++it2) {
+            ActionRetCodeEnum stat = waitForRenderFinished(*it2);
+            if ( isFailureRetCode(stat) ) {
+                failed = true;
+            }
+        }
+
+        {
+            QMutexLocker k(&_imp->currentRendersMutex);
+            _imp->currentRenders.clear();
+        }
+
+        if (failed) {
+            break;
+        }
+    }
+
+    return resolveState();
+} // threadLoopOnce
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,120 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_TRACKERFRAMEPREFETCHER_H
+#define NATRON_ENGINE_TRACKERFRAMEPREFETCHER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <list>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+#include "Engine/GenericSchedulerThread.h"
+#include "Engine/RectD.h"
+#include "Engine/TreeRenderQueueProvider.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Renders the source frames that the tracker is about to need into the Cache while the markers are
+ * tracked on the previous frames, so that the frame accessor of the tracker finds them there instead of waiting
+ * for the upstream tree to render.
+ *
+ * Only the given regions of each frame are rendered, e.g: the search windows of the markers, so that the upstream tree
+ * does not render the whole frame when the markers are spread out.
+ * Frames are rendered one after the other in the order they are given. Renders launched by this class have the
+ * lowest priority (see TreeRenderQueueProvider::getRenderPriority()): they never delay the renders the tracker
+ * is waiting for. Call abortThreadedTask() or quitThread() to cancel the ongoing prefetch.
+ **/
+struct TrackerFramePrefetcherPrivate;
+class TrackerFramePrefetcher
+: public GenericSchedulerThread
+, public TreeRenderQueueProvider
+, public boost::enable_shared_from_this<TrackerFramePrefetcher>
+{
+protected:
+
+    TrackerFramePrefetcher();
+
+    virtual TreeRenderQueueProviderConstPtr getThisTreeRenderQueueProviderShared() const OVERRIDE FINAL
+    {
+        return shared_from_this();
+    }
+
+public:
+
+    static TrackerFramePrefetcherPtr create()
+    {
+        return TrackerFramePrefetcherPtr(new TrackerFramePrefetcher());
+    }
+
+    virtual ~TrackerFramePrefetcher();
+
+    /**
+     * @brief Render the given frames of the source node, in order, over the given regions in canonical coordinates.
+     * The regions are merged with mergeRegions() first.
+     * The frames of a previous call that are not rendered yet are still rendered before these ones.
+     **/
+    void prefetchFrames(const NodePtr& sourceNode,
+                        const std::vector<int>& frames,
+                        const std::list<RectD>& canonicalRoIs);
+
+    /**
+     * @brief Replaces in place rectangles by the rectangle enclosing them as long as it is not larger than their
+     * combined area: overlapping or close rectangles are rendered at once while distant rectangles stay separate.
+     * Empty rectangles are removed.
+     **/
+    static void mergeRegions(std::list<RectD>* rects);
+
+    virtual TreeRenderPriorityEnum getRenderPriority() const OVERRIDE FINAL
+    {
+        return eTreeRenderPriorityCacheWarming;
+    }
+
+    virtual void onWaitForAbortCompleted() OVERRIDE FINAL;
+    virtual void onWaitForThreadToQuit() OVERRIDE FINAL;
+    virtual void onAbortRequested(bool keepOldestRender) OVERRIDE FINAL;
+
+private:
+
+    virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const OVERRIDE FINAL
+    {
+        return eTaskQueueBehaviorProcessInOrder;
+    }
+
+    virtual ThreadStateEnum threadLoopOnce(const GenericThreadStartArgsPtr& inArgs) OVERRIDE FINAL;
+
+    boost::scoped_ptr<TrackerFramePrefetcherPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_TRACKERFRAMEPREFETCHER_H
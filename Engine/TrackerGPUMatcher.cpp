@@ -0,0 +1,368 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TrackerGPUMatcher.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutex>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include "Engine/AppManager.h"
+#include "Engine/GLShader.h"
+#include "Engine/GPUContextPool.h"
+#include "Engine/OSGLContext.h"
+#include "Engine/OSGLFunctions.h"
+#include "Engine/RectI.h"
+#include "Engine/Texture.h"
+
+NATRON_NAMESPACE_ENTER
+
+// Each fragment is a position of the top-left corner of the pattern in the search image.
+// The red channel of the pattern texture is the pattern, the green channel is the mask.
+static const char* bruteTranslationSAD_FragmentShader =
+"uniform sampler2D searchTex;\n"
+"uniform sampler2D patternTex;\n"
+"uniform float searchWidth;\n"
+"uniform float searchHeight;\n"
+"uniform int patternWidth;\n"
+"uniform int patternHeight;\n"
+"uniform float maskSum;\n"
+"uniform int normalizeIntensities;\n"
+"\n"
+"void main() {\n"
+"   vec2 origin = floor(gl_FragCoord.xy);\n"
+"   vec2 searchSize = vec2(searchWidth, searchHeight);\n"
+"   vec2 patternSize = vec2(float(patternWidth), float(patternHeight));\n"
+"   float inverseSearchMean = 1.0;\n"
+"   if (normalizeIntensities != 0) {\n"
+"       float blockSum = 0.0;\n"
+"       for (int y = 0; y < patternHeight; ++y) {\n"
+"           for (int x = 0; x < patternWidth; ++x) {\n"
+"               vec2 p = vec2(float(x), float(y)) + 0.5;\n"
+"               float mask = texture2D(patternTex, p / patternSize).g;\n"
+"               blockSum += mask * texture2D(searchTex, (origin + p) / searchSize).r;\n"
+"           }\n"
+"       }\n"
+"       inverseSearchMean = maskSum / blockSum;\n"
+"   }\n"
+"   float sad = 0.0;\n"
+"   for (int y = 0; y < patternHeight; ++y) {\n"
+"       for (int x = 0; x < patternWidth; ++x) {\n"
+"           vec2 p = vec2(float(x), float(y)) + 0.5;\n"
+"           vec2 patternAndMask = texture2D(patternTex, p / patternSize).rg;\n"
+"           float search = texture2D(searchTex, (origin + p) / searchSize).r;\n"
+"           sad += patternAndMask.g * abs(patternAndMask.r - search * inverseSearchMean);\n"
+"       }\n"
+"   }\n"
+"   gl_FragColor = vec4(sad, 0.0, 0.0, 1.0);\n"
+"}";
+
+struct TrackerGPUMatcherPrivate
+{
+    OSGLContextPtr glContext;
+
+    // Protects all fields below: the textures are re-used by all searches
+    QMutex lock;
+
+    GLShaderBasePtr shader;
+
+    // True if the shader failed to compile, searches are then done on the CPU
+    bool shaderFailed;
+
+    GLTexturePtr searchTexture, patternTexture, sadTexture;
+
+    // The RGBA buffers uploaded to the textures
+    std::vector<float> searchBuffer, patternBuffer;
+
+    // The sums of absolute differences read back from the GPU
+    std::vector<float> sadBuffer;
+
+    TrackerGPUMatcherPrivate(const OSGLContextPtr& glContext)
+    : glContext(glContext)
+    , lock()
+    , shader()
+    , shaderFailed(false)
+    , searchTexture()
+    , patternTexture()
+    , sadTexture()
+    , searchBuffer()
+    , patternBuffer()
+    , sadBuffer()
+    {
+    }
+
+    template <typename GL>
+    bool ensureGLObjects();
+
+    template <typename GL>
+    bool findBestTranslation(const float *pattern,
+                             const float *mask,
+                             int patternWidth,
+                             int patternHeight,
+                             double maskSum,
+                             bool useNormalizedIntensities,
+                             const libmv::FloatImage &searchImage,
+                             int *bestC,
+                             int *bestR);
+};
+
+TrackerGPUMatcher::TrackerGPUMatcher(const OSGLContextPtr& glContext)
+: libmv::BruteTranslationMatcher()
+, _imp(new TrackerGPUMatcherPrivate(glContext))
+{
+}
+
+TrackerGPUMatcherPtr
+TrackerGPUMatcher::create()
+{
+    OSGLContextPtr glContext;
+    try {
+        glContext = appPTR->getGPUContextPool()->getOrCreateOpenGLContext();
+    } catch (const std::exception& e) {
+        qDebug() << "TrackerGPUMatcher: OpenGL is not available:" << e.what();
+        return TrackerGPUMatcherPtr();
+    }
+    if (!glContext || !glContext->isGPUContext()) {
+        return TrackerGPUMatcherPtr();
+    }
+    return TrackerGPUMatcherPtr( new TrackerGPUMatcher(glContext) );
+}
+
+TrackerGPUMatcher::~TrackerGPUMatcher()
+{
+    // The OpenGL objects must be deleted with their context attached
+    OSGLContextSaver saveCurrentContext;
+    {
+        OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(_imp->glContext);
+        contextAttacher->attach();
+        _imp->shader.reset();
+        _imp->searchTexture.reset();
+        _imp->patternTexture.reset();
+        _imp->sadTexture.reset();
+    }
+}
+
+static GLTexturePtr
+createFloatTexture()
+{
+    int format, internalFormat, glType;
+    Texture::getRecommendedTexParametersForRGBAFloatTexture(&format, &internalFormat, &glType);
+    return boost::make_shared<Texture>(GL_TEXTURE_2D, GL_NEAREST, GL_NEAREST, GL_CLAMP_TO_EDGE, eImageBitDepthFloat, format, internalFormat, glType, true /*useOpenGL*/);
+}
+
+/**
+ * @brief Uploads the buffer to the texture, which must have exactly the given bounds since it is sampled with normalized coordinates
+ **/
+static void
+uploadTexture(const GLTexturePtr& texture, const RectI& bounds, const std::vector<float>& buffer)
+{
+    // This reallocates and fills the texture if its size changed, otherwise it is filled below
+    if ( !texture->ensureTextureHasSize(bounds, (const unsigned char*)&buffer[0]) ) {
+        texture->fillOrAllocateTexture(bounds, 0, (const unsigned char*)&buffer[0]);
+    }
+}
+
+template <typename GL>
+bool
+TrackerGPUMatcherPrivate::ensureGLObjects()
+{
+    if (shaderFailed) {
+        return false;
+    }
+    if (!shader) {
+        boost::shared_ptr<GLShader<GL> > glShader = boost::make_shared<GLShader<GL> >();
+#ifdef DEBUG
+        std::string error;
+        bool ok = glShader->addShader(GLShader<GL>::eShaderTypeFragment, bruteTranslationSAD_FragmentShader, &error);
+        if (!ok) {
+            qDebug() << error.c_str();
+        }
+        ok = glShader->link(&error);
+        if (!ok) {
+            qDebug() << error.c_str();
+        }
+#else
+        bool ok = glShader->addShader(GLShader<GL>::eShaderTypeFragment, bruteTranslationSAD_FragmentShader, 0);
+        ok = ok && glShader->link();
+#endif
+        if (!ok) {
+            shaderFailed = true;
+            return false;
+        }
+        shader = glShader;
+    }
+    if (!searchTexture) {
+        searchTexture = createFloatTexture();
+        patternTexture = createFloatTexture();
+        sadTexture = createFloatTexture();
+    }
+    return true;
+} // ensureGLObjects
+
+template <typename GL>
+bool
+TrackerGPUMatcherPrivate::findBestTranslation(const float *pattern,
+                                              const float *mask,
+                                              int patternWidth,
+                                              int patternHeight,
+                                              double maskSum,
+                                              bool useNormalizedIntensities,
+                                              const libmv::FloatImage &searchImage,
+                                              int *bestC,
+                                              int *bestR)
+{
+    const int searchWidth = searchImage.Width();
+    const int searchHeight = searchImage.Height();
+
+    // Same positions as the CPU search
+    const int nCols = searchWidth - patternWidth;
+    const int nRows = searchHeight - patternHeight;
+    if (nCols <= 0 || nRows <= 0) {
+        return false;
+    }
+    if ( (searchWidth > glContext->getMaxOpenGLWidth()) || (searchHeight > glContext->getMaxOpenGLHeight()) ) {
+        return false;
+    }
+
+    if ( !ensureGLObjects<GL>() ) {
+        return false;
+    }
+
+    // Upload the search image and the pattern with its mask
+    searchBuffer.resize(searchWidth * searchHeight * 4);
+    for (int y = 0; y < searchHeight; ++y) {
+        float* dst = &searchBuffer[y * searchWidth * 4];
+        for (int x = 0; x < searchWidth; ++x, dst += 4) {
+            dst[0] = searchImage(y, x, 0);
+            dst[1] = dst[2] = 0.f;
+            dst[3] = 1.f;
+        }
+    }
+    patternBuffer.resize(patternWidth * patternHeight * 4);
+    for (int i = 0; i < patternWidth * patternHeight; ++i) {
+        float* dst = &patternBuffer[i * 4];
+        dst[0] = pattern[i];
+        dst[1] = mask[i];
+        dst[2] = 0.f;
+        dst[3] = 1.f;
+    }
+
+    const RectI searchBounds(0, 0, searchWidth, searchHeight);
+    const RectI patternBounds(0, 0, patternWidth, patternHeight);
+    const RectI sadBounds(0, 0, nCols, nRows);
+    uploadTexture(searchTexture, searchBounds, searchBuffer);
+    uploadTexture(patternTexture, patternBounds, patternBuffer);
+    sadTexture->ensureTextureHasSize(sadBounds, 0);
+
+    // Compute the sum of absolute differences of all positions
+    GLuint fboID = glContext->getOrCreateFBOId();
+    GL::BindFramebuffer(GL_FRAMEBUFFER, fboID);
+    GL::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, sadTexture->getTexTarget(), sadTexture->getTexID(), 0 /*LoD*/);
+    glCheckFramebufferError(GL);
+
+    GL::ActiveTexture(GL_TEXTURE0);
+    GL::BindTexture( searchTexture->getTexTarget(), searchTexture->getTexID() );
+    GL::ActiveTexture(GL_TEXTURE1);
+    GL::BindTexture( patternTexture->getTexTarget(), patternTexture->getTexID() );
+
+    shader->bind();
+    shader->setUniform("searchTex", 0);
+    shader->setUniform("patternTex", 1);
+    shader->setUniform("searchWidth", (float)searchWidth);
+    shader->setUniform("searchHeight", (float)searchHeight);
+    shader->setUniform("patternWidth", patternWidth);
+    shader->setUniform("patternHeight", patternHeight);
+    shader->setUniform("maskSum", (float)maskSum);
+    shader->setUniform("normalizeIntensities", (int)useNormalizedIntensities);
+
+    OSGLContext::setupGLViewport<GL>(sadBounds, sadBounds);
+    GL::Begin(GL_POLYGON);
+    GL::Vertex2d(sadBounds.x1, sadBounds.y1);
+    GL::Vertex2d(sadBounds.x2, sadBounds.y1);
+    GL::Vertex2d(sadBounds.x2, sadBounds.y2);
+    GL::Vertex2d(sadBounds.x1, sadBounds.y2);
+    GL::End();
+    shader->unbind();
+    glCheckError(GL);
+
+    sadBuffer.resize(nCols * nRows);
+    GL::PixelStorei(GL_PACK_ALIGNMENT, 1);
+    GL::ReadPixels(0, 0, nCols, nRows, GL_RED, GL_FLOAT, (GLvoid*)&sadBuffer[0]);
+    glCheckError(GL);
+
+    GL::BindTexture(patternTexture->getTexTarget(), 0);
+    GL::ActiveTexture(GL_TEXTURE0);
+    GL::BindTexture(searchTexture->getTexTarget(), 0);
+    GL::BindFramebuffer(GL_FRAMEBUFFER, 0);
+    glCheckError(GL);
+
+    // Row r of the texture is row r of the search image
+    int bestIndex = -1;
+    float bestSAD = 0.f;
+    for (int i = 0; i < nCols * nRows; ++i) {
+        // NaN sums (e.g. a null block when normalizing) are never the best
+        if ( (sadBuffer[i] == sadBuffer[i]) && (bestIndex == -1 || sadBuffer[i] < bestSAD) ) {
+            bestIndex = i;
+            bestSAD = sadBuffer[i];
+        }
+    }
+    if (bestIndex == -1) {
+        return false;
+    }
+    *bestC = bestIndex % nCols;
+    *bestR = bestIndex / nCols;
+    return true;
+} // findBestTranslation
+
+bool
+TrackerGPUMatcher::FindBestTranslation(const float *pattern,
+                                       const float *mask,
+                                       int pattern_width,
+                                       int pattern_height,
+                                       double mask_sum,
+                                       bool use_normalized_intensities,
+                                       const libmv::FloatImage &search_image,
+                                       int *best_c,
+                                       int *best_r)
+{
+    QMutexLocker k(&_imp->lock);
+
+    // Save the current context
+    OSGLContextSaver saveCurrentContext;
+
+    // Ensure this context is attached
+    OSGLContextAttacherPtr contextAttacher = OSGLContextAttacher::create(_imp->glContext);
+    contextAttacher->attach();
+
+    return _imp->findBestTranslation<GL_GPU>(pattern, mask, pattern_width, pattern_height, mask_sum, use_normalized_intensities, search_image, best_c, best_r);
+} // FindBestTranslation
+
+NATRON_NAMESPACE_EXIT
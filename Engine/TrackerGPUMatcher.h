@@ -0,0 +1,85 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_TRACKERGPUMATCHER_H
+#define NATRON_ENGINE_TRACKERGPUMATCHER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+GCC_DIAG_OFF(unused-function)
+GCC_DIAG_OFF(unused-parameter)
+#include <libmv/tracking/track_region.h>
+GCC_DIAG_ON(unused-function)
+GCC_DIAG_ON(unused-parameter)
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Runs the brute-force translation search of the libmv region tracker in an OpenGL fragment shader:
+ * the sum of absolute differences of all the positions of the pattern in the search area are computed in a single draw.
+ * The refinement of the position is still done by libmv on the CPU.
+ * A single OpenGL context is used for the lifetime of the matcher, the markers tracked concurrently take turns on it.
+ * It is safe to call FindBestTranslation from multiple threads.
+ **/
+struct TrackerGPUMatcherPrivate;
+class TrackerGPUMatcher
+    : public libmv::BruteTranslationMatcher
+{
+    TrackerGPUMatcher(const OSGLContextPtr& glContext);
+
+public:
+
+    /**
+     * @brief Returns NULL if OpenGL rendering is not available.
+     **/
+    static TrackerGPUMatcherPtr create();
+
+    virtual ~TrackerGPUMatcher();
+
+    virtual bool FindBestTranslation(const float *pattern,
+                                     const float *mask,
+                                     int pattern_width,
+                                     int pattern_height,
+                                     double mask_sum,
+                                     bool use_normalized_intensities,
+                                     const libmv::FloatImage &search_image,
+                                     int *best_c,
+                                     int *best_r) OVERRIDE FINAL WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<TrackerGPUMatcherPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_TRACKERGPUMATCHER_H
@@ -38,6 +38,7 @@
 #include "Engine/TrackArgs.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/TrackMarker.h"
+#include "Engine/TrackerGPUMatcher.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -227,6 +228,14 @@ TrackerHelper::trackMarkers(const std::list<TrackMarkerPtr>& markers,
      Get the global parameters for the LivMV track: pre-blur sigma, No iterations, normalized intensities, etc...
      */
     _imp->beginLibMVOptionsForTrack(&mvOptions);
+    const int numPyramidLevels = provider->getNumPyramidLevels();
+
+    // The GPU matcher is shared by all markers
+    TrackerGPUMatcherPtr gpuMatcher;
+    if ( mvOptions.use_brute_initialization && provider->isGPUMatchingEnabled() ) {
+        gpuMatcher = TrackerGPUMatcher::create();
+        mvOptions.brute_matcher = gpuMatcher.get();
+    }
 
     /*
      For the given markers, do the following:
@@ -402,6 +411,8 @@ TrackerHelper::trackMarkers(const std::list<TrackMarkerPtr>& markers,
 
 
         t->mvOptions = mvOptions;
+        t->mvNumPyramidLevels = numPyramidLevels;
+        t->gpuMatcher = gpuMatcher;
         trackAndOptions.push_back(t);
     }
     
@@ -44,6 +44,10 @@
 #include <omp.h>
 #endif
 
+// The keyframes set on the knobs of a marker while tracking are notified (which invalidates hashes and refreshes the GUI)
+// only once every this many frames
+#define TRACKER_EVALUATE_KEYFRAMES_EVERY_N_FRAMES 10
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -63,7 +67,48 @@ TrackerHelperPrivate::TrackerHelperPrivate(TrackerHelper* publicInterface,
 
 
 /**
- * @brief Set keyframes on knobs from Marker data
+ * @brief Writes a keyframe at the given time on each dimension of the knob without notifying it,
+ * see TrackerHelperPrivate::evaluateTrackedKeyframes
+ **/
+static void
+addTrackedKeyframe(const KnobDoublePtr& knob,
+                   TimeValue time,
+                   const std::vector<double>& values)
+{
+    std::list<ViewIdx> views = knob->getViewsList();
+    for (std::list<ViewIdx>::const_iterator it = views.begin(); it != views.end(); ++it) {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            std::list<KeyFrame> keys;
+            keys.push_back( knob->makeKeyFrame(time, values[i], DimIdx(i), *it) );
+            knob->addKeyFramesToCurve(*it, DimIdx(i), keys, false /*evaluate*/);
+        }
+    }
+}
+
+void
+TrackerHelperPrivate::evaluateTrackedKeyframes(const TrackMarkerAndOptionsPtr& options)
+{
+    if (!options->nFramesNotEvaluated) {
+        return;
+    }
+    const TrackMarkerPtr& natronMarker = options->natronMarker;
+    TimeValue time = options->lastFrameNotEvaluated;
+
+    natronMarker->getErrorKnob()->evaluateAnimationChange(time);
+    natronMarker->getCenterKnob()->evaluateAnimationChange(time);
+    if (options->mvOptions.mode != libmv::TrackRegionOptions::TRANSLATION) {
+        natronMarker->getPatternTopLeftKnob()->evaluateAnimationChange(time);
+        natronMarker->getPatternTopRightKnob()->evaluateAnimationChange(time);
+        natronMarker->getPatternBtmLeftKnob()->evaluateAnimationChange(time);
+        natronMarker->getPatternBtmRightKnob()->evaluateAnimationChange(time);
+    }
+    options->nFramesNotEvaluated = 0;
+} // evaluateTrackedKeyframes
+
+/**
+ * @brief Set keyframes on knobs from Marker data.
+ * The keyframes are immediately visible to the next tracking steps but they are notified in batches of
+ * TRACKER_EVALUATE_KEYFRAMES_EVERY_N_FRAMES frames: notifying each frame costs more than tracking it.
  **/
 void
 TrackerHelperPrivate::setKnobKeyframesFromMarker(int /*formatHeight*/,
@@ -76,14 +121,16 @@ TrackerHelperPrivate::setKnobKeyframesFromMarker(int /*formatHeight*/,
     TimeValue time(mvMarker.frame);
     KnobDoublePtr errorKnob = natronMarker->getErrorKnob();
 
-    if (result) {
-        double corr = result->correlation;
-        if (corr != corr) {
-            corr = 1.;
+    {
+        std::vector<double> values(1, 0.);
+        if (result) {
+            double corr = result->correlation;
+            if (corr != corr) {
+                corr = 1.;
+            }
+            values[0] = 1. - corr;
         }
-        errorKnob->setValueAtTime(TimeValue(time), 1. - corr);
-    } else {
-        errorKnob->setValueAtTime(TimeValue(time), 0.);
+        addTrackedKeyframe(errorKnob, time, values);
     }
 
     Point center;
@@ -107,7 +154,7 @@ TrackerHelperPrivate::setKnobKeyframesFromMarker(int /*formatHeight*/,
         // Blender also adds 0.5 to coordinates
         values[0] = center.x + 0.5;
         values[1] = center.y + 0.5;
-        centerKnob->setValueAtTimeAcrossDimensions(TimeValue(time), values);
+        addTrackedKeyframe(centerKnob, time, values);
     }
 
 
@@ -146,10 +193,10 @@ TrackerHelperPrivate::setKnobKeyframesFromMarker(int /*formatHeight*/,
     // When tracking translation only, do not set a keyframe if a keyframe was not set already to avoid
     // creating an animation curve with constant data.
     if (options->mvOptions.mode != libmv::TrackRegionOptions::TRANSLATION) {
-        pntTopLeftKnob->setValueAtTimeAcrossDimensions(time, topLeftValues);
-        pntTopRightKnob->setValueAtTimeAcrossDimensions(time, topRightValues);
-        pntBtmLeftKnob->setValueAtTimeAcrossDimensions(time, btmLeftValues);
-        pntBtmRightKnob->setValueAtTimeAcrossDimensions(time, btmRightValues);
+        addTrackedKeyframe(pntTopLeftKnob, time, topLeftValues);
+        addTrackedKeyframe(pntTopRightKnob, time, topRightValues);
+        addTrackedKeyframe(pntBtmLeftKnob, time, btmLeftValues);
+        addTrackedKeyframe(pntBtmRightKnob, time, btmRightValues);
     } else {
         pntTopLeftKnob->setValueAcrossDimensions(topLeftValues);
         pntTopRightKnob->setValueAcrossDimensions(topRightValues);
@@ -158,6 +205,12 @@ TrackerHelperPrivate::setKnobKeyframesFromMarker(int /*formatHeight*/,
 
     }
 
+    options->lastFrameNotEvaluated = time;
+    ++options->nFramesNotEvaluated;
+    if (options->nFramesNotEvaluated >= TRACKER_EVALUATE_KEYFRAMES_EVERY_N_FRAMES) {
+        evaluateTrackedKeyframes(options);
+    }
+
 } // TrackerHelperPrivate::setKnobKeyframesFromMarker
 
 /// Converts a Natron track marker to the one used in LibMV. This is expensive: many calls to getValue are made
@@ -456,7 +509,7 @@ TrackerHelperPrivate::trackStepLibMV(int trackIndex,
 
         // Do the actual tracking
         libmv::TrackRegionResult result;
-        bool trackOk = autoTrack->TrackMarker(&track->mvMarker, &result,  &track->mvState, &track->mvOptions);
+        bool trackOk = autoTrack->TrackMarker(&track->mvMarker, &result,  &track->mvState, &track->mvOptions, track->mvNumPyramidLevels);
         if (!result.is_usable()) {
             trackOk = false;
         }
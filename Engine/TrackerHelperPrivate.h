@@ -72,7 +72,30 @@ public:
     TrackMarkerPtr natronMarker;
     mv::Marker mvMarker;
     mv::TrackRegionOptions mvOptions;
+    int mvNumPyramidLevels;
     mv::KalmanFilterState mvState;
+
+    // Referenced by mvOptions.brute_matcher if the pre-track is done on the GPU
+    TrackerGPUMatcherPtr gpuMatcher;
+
+    // The number of frames whose keyframes were written to the knobs of the marker but not notified yet,
+    // see TrackerHelperPrivate::evaluateTrackedKeyframes
+    int nFramesNotEvaluated;
+
+    // The last of these frames
+    TimeValue lastFrameNotEvaluated;
+
+    TrackMarkerAndOptions()
+    : natronMarker()
+    , mvMarker()
+    , mvOptions()
+    , mvNumPyramidLevels(1)
+    , mvState()
+    , gpuMatcher()
+    , nFramesNotEvaluated(0)
+    , lastFrameNotEvaluated(0)
+    {
+    }
 };
 
 
@@ -133,6 +156,12 @@ public:
                                            const libmv::TrackRegionResult* result,
                                            const TrackMarkerAndOptionsPtr& options);
 
+    /**
+     * @brief The keyframes set by setKnobKeyframesFromMarker are only notified every few frames, this notifies the
+     * remaining ones. This must be called once tracking of the marker is done.
+     **/
+    static void evaluateTrackedKeyframes(const TrackMarkerAndOptionsPtr& options);
+
     static bool trackStepLibMV(int trackIndex, const TrackArgs& args, int time);
     static bool trackStepTrackerPM(const TrackMarkerPMPtr& tracker, const TrackArgs& args, int time);
 
@@ -928,6 +928,27 @@ TrackerNode::initializeTrackingPageKnobs(const KnobPagePtr& trackingPage)
         trackingPage->addKnob(param);
         _imp->preBlurSigma = param;
     }
+    {
+        KnobIntPtr param = createKnob<KnobInt>(kTrackerParamPyramidLevels);
+        param->setLabel(tr(kTrackerParamPyramidLevelsLabel));
+        param->setHintToolTip( tr(kTrackerParamPyramidLevelsHint) );
+        param->setAnimationEnabled(false);
+        param->setRange(1, 4);
+        param->setDefaultValue(1);
+        param->setEvaluateOnChange(false);
+        trackingPage->addKnob(param);
+        _imp->pyramidLevels = param;
+    }
+    {
+        KnobBoolPtr param = createKnob<KnobBool>(kTrackerParamUseGPUMatching);
+        param->setLabel(tr(kTrackerParamUseGPUMatchingLabel));
+        param->setHintToolTip( tr(kTrackerParamUseGPUMatchingHint) );
+        param->setDefaultValue(false);
+        param->setAnimationEnabled(false);
+        param->setEvaluateOnChange(false);
+        trackingPage->addKnob(param);
+        _imp->useGPUMatching = param;
+    }
 
     {
         KnobSeparatorPtr  param = createKnob<KnobSeparator>(kTrackerParamPerTrackParamsSeparator, 3);
@@ -1912,6 +1933,8 @@ TrackerNodePrivate::refreshVisibilityFromTransformTypeInternal(TrackerTransformN
     bruteForcePreTrack.lock()->setSecret(usePM);
     useNormalizedIntensities.lock()->setSecret(usePM);
     preBlurSigma.lock()->setSecret(usePM);
+    pyramidLevels.lock()->setSecret(usePM);
+    useGPUMatching.lock()->setSecret(usePM);
 
     patternMatchingScore.lock()->setSecret(!usePM);
 
@@ -2010,6 +2033,7 @@ TrackerNodePrivate::endTrackSequence(const TrackArgsBasePtr& args)
     const std::vector<TrackMarkerAndOptionsPtr>& tracks = trackerArgs->getTracks();
 
     for (std::size_t i = 0; i < tracks.size(); ++i) {
+        TrackerHelperPrivate::evaluateTrackedKeyframes(tracks[i]);
         tracks[i]->natronMarker->notifyTrackingEnded();
     }
 
@@ -2123,6 +2147,18 @@ TrackerNodePrivate::getPreBlurSigma() const
     return preBlurSigma.lock()->getValue();
 }
 
+int
+TrackerNodePrivate::getNumPyramidLevels() const
+{
+    return pyramidLevels.lock()->getValue();
+}
+
+bool
+TrackerNodePrivate::isGPUMatchingEnabled() const
+{
+    return useGPUMatching.lock()->getValue();
+}
+
 RectD
 TrackerNodePrivate::getNormalizationRoD(TimeValue time, ViewIdx view) const
 {
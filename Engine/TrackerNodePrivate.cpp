@@ -32,6 +32,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/AppInstance.h"
+#include "Engine/Hash64.h"
 #include "Engine/Image.h"
 #include "Engine/Lut.h"
 #include "Engine/Node.h"
@@ -1966,6 +1967,78 @@ TrackerNodeInteract::drawOverlay(TimeValue time,
         Point selectedSearchBtmLeft;
         Point selectedSearchTopRight;
 
+        // The markers that are not selected are only drawn as a cross: record them again only when one of them changed
+        // or the viewport was zoomed, since the crosses are sized in pixels, and draw them all at once.
+        {
+            HashableObject::ComputeHashArgs hashArgs;
+            hashArgs.time = time;
+            hashArgs.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+
+            Hash64 hash;
+            hash.append( (double)time );
+            hash.append(pixelScaleX);
+            hash.append(pixelScaleY);
+            for (int i = 0; i < 3; ++i) {
+                hash.append(markerColor[i]);
+            }
+            std::vector<TrackMarkerPtr> unselectedMarkers;
+            for (std::vector<TrackMarkerPtr>::iterator it = allMarkers.begin(); it != allMarkers.end(); ++it) {
+                bool isSelected = std::find(selectedMarkers.begin(), selectedMarkers.end(), *it) != selectedMarkers.end();
+                if (isSelected && !trackingPageSecret) {
+                    continue;
+                }
+                unselectedMarkers.push_back(*it);
+                hash.append( (*it)->computeHash(hashArgs) );
+                hash.append( (*it)->isEnabled(time) );
+            }
+            hash.computeHash();
+
+            // The shadow is recorded with unselectedMarkersDrawList
+            if ( unselectedMarkersDrawList.beginRecording( hash.value() ) ) {
+                unselectedMarkersShadowDrawList.clear();
+                unselectedMarkersDrawList.setLineWidth(1.5);
+                unselectedMarkersDrawList.setPointSize(POINT_SIZE);
+                unselectedMarkersShadowDrawList.setLineWidth(1.5);
+                unselectedMarkersShadowDrawList.setPointSize(POINT_SIZE);
+                unselectedMarkersShadowDrawList.setColor(0., 0., 0., 1.);
+
+                for (std::vector<TrackMarkerPtr>::iterator it = unselectedMarkers.begin(); it != unselectedMarkers.end(); ++it) {
+                    double factor = (*it)->isEnabled(time) ? 1. : 0.5;
+                    unselectedMarkersDrawList.setColor(markerColor[0] * factor, markerColor[1] * factor, markerColor[2] * factor, 1.);
+
+                    KnobDoublePtr centerKnob = (*it)->getCenterKnob();
+                    double x = centerKnob->getValueAtTime(time, DimIdx(0));
+                    double y = centerKnob->getValueAtTime(time, DimIdx(1));
+
+                    for (int l = 0; l < 2; ++l) {
+                        OverlayDrawList& list = (l == 0) ? unselectedMarkersShadowDrawList : unselectedMarkersDrawList;
+                        list.addPoint(x, y);
+                        list.addLine(x - CROSS_SIZE * pixelScaleX, y, x + CROSS_SIZE * pixelScaleX, y);
+                        list.addLine(x, y - CROSS_SIZE * pixelScaleY, x, y + CROSS_SIZE * pixelScaleY);
+                    }
+                }
+            }
+
+            if ( !unselectedMarkersDrawList.isEmpty() ) {
+                GL_GPU::Enable(GL_LINE_SMOOTH);
+                GL_GPU::Hint(GL_LINE_SMOOTH_HINT, GL_DONT_CARE);
+                for (int l = 0; l < 2; ++l) {
+                    // shadow (uses GL_PROJECTION)
+                    GL_GPU::MatrixMode(GL_PROJECTION);
+                    int direction = (l == 0) ? 1 : -1;
+                    // translate (1,-1) pixels
+                    GL_GPU::Translated(direction * pixelScaleX / 256, -direction * pixelScaleY / 256, 0);
+                    GL_GPU::MatrixMode(GL_MODELVIEW);
+
+                    if (l == 0) {
+                        unselectedMarkersShadowDrawList.draw();
+                    } else {
+                        unselectedMarkersDrawList.draw();
+                    }
+                }
+            }
+        }
+
         for (std::vector<TrackMarkerPtr>::iterator it = allMarkers.begin(); it != allMarkers.end(); ++it) {
             bool isEnabled = (*it)->isEnabled(time);
 
@@ -1997,44 +2070,8 @@ TrackerNodeInteract::drawOverlay(TimeValue time,
 
             // When the tracking page is secret, still show markers, but as if deselected
             if (!isSelected || trackingPageSecret) {
-                ///Draw a custom interact, indicating the track isn't selected
-                GL_GPU::Enable(GL_LINE_SMOOTH);
-                GL_GPU::Hint(GL_LINE_SMOOTH_HINT, GL_DONT_CARE);
-                GL_GPU::LineWidth(1.5f);
-
-                for (int l = 0; l < 2; ++l) {
-                    // shadow (uses GL_PROJECTION)
-                    GL_GPU::MatrixMode(GL_PROJECTION);
-                    int direction = (l == 0) ? 1 : -1;
-                    // translate (1,-1) pixels
-                    GL_GPU::Translated(direction * pixelScaleX / 256, -direction * pixelScaleY / 256, 0);
-                    GL_GPU::MatrixMode(GL_MODELVIEW);
-
-                    if (l == 0) {
-                        GL_GPU::Color4d(0., 0., 0., 1.);
-                    } else {
-                        GL_GPU::Color4f(thisMarkerColor[0], thisMarkerColor[1], thisMarkerColor[2], 1.);
-                    }
-
-
-                    double x = centerKnob->getValueAtTime(time, DimIdx(0));
-                    double y = centerKnob->getValueAtTime(time, DimIdx(1));
-
-                    GL_GPU::PointSize(POINT_SIZE);
-                    GL_GPU::Begin(GL_POINTS);
-                    GL_GPU::Vertex2d(x, y);
-                    GL_GPU::End();
-
-                    GL_GPU::Begin(GL_LINES);
-                    GL_GPU::Vertex2d(x - CROSS_SIZE * pixelScaleX, y);
-                    GL_GPU::Vertex2d(x + CROSS_SIZE * pixelScaleX, y);
-
-
-                    GL_GPU::Vertex2d(x, y - CROSS_SIZE * pixelScaleY);
-                    GL_GPU::Vertex2d(x, y + CROSS_SIZE * pixelScaleY);
-                    GL_GPU::End();
-                }
-                GL_GPU::PointSize(1.);
+                // Drawn with unselectedMarkersDrawList above
+                continue;
             } else { // if (isSelected) {
                 GL_GPU::Enable(GL_LINE_SMOOTH);
                 GL_GPU::Hint(GL_LINE_SMOOTH_HINT, GL_DONT_CARE);
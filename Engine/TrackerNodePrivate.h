@@ -30,6 +30,7 @@
 
 #include <map>
 #include <set>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
@@ -46,6 +47,7 @@
 #include "Engine/KnobTypes.h"
 #include "Engine/RectI.h"
 #include "Engine/KnobItemsTable.h"
+#include "Engine/OverlayDrawList.h"
 #include "Engine/OverlayInteractBase.h"
 #include "Engine/TrackerNode.h"
 #include "Engine/Texture.h"
@@ -281,6 +283,18 @@ NATRON_NAMESPACE_ENTER
 #define kTrackerParamPreBlurSigmaLabel "Pre-blur Sigma"
 #define kTrackerParamPreBlurSigmaHint "The size in pixels of the blur kernel used to both smooth the image and take the image derivative."
 
+#define kTrackerParamPyramidLevels "pyramidLevels"
+#define kTrackerParamPyramidLevelsLabel "Pyramid Levels"
+#define kTrackerParamPyramidLevelsHint "The number of resolution levels used to track each marker coarse-to-fine. " \
+"With more than 1 level, the search area is only searched on images downscaled by 2^(levels - 1) and the position is then refined " \
+"at each finer level in a small area around it, which is much faster for large search areas and fast motions. " \
+"Fewer levels are used for small patterns. 1 means that images are only tracked at full resolution."
+
+#define kTrackerParamUseGPUMatching "useGPUMatching"
+#define kTrackerParamUseGPUMatchingLabel "GPU Brute-Force Pre-track"
+#define kTrackerParamUseGPUMatchingHint "When OpenGL rendering is enabled, do the brute-force pre-track on the GPU. " \
+"This is much faster for large search areas. The refinement is still done on the CPU."
+
 
 #define kTrackerParamAutoKeyEnabled "autoKeyEnabled"
 #define kTrackerParamAutoKeyEnabledLabel "Animate Enabled"
@@ -594,7 +608,10 @@ struct SolveRequest
     CornerPinSolverWatcher cpWatcher;
     TransformSolverWatcher tWatcher;
     TimeValue refTime;
-    std::set<TimeValue> keyframes;
+
+    // Sorted by increasing time. This is a random access container so that QtConcurrent hands each thread
+    // a window of consecutive frames and reports the progress, which it does not do for a std::set.
+    std::vector<TimeValue> keyframes;
     int jitterPeriod;
     bool jitterAdd;
     bool robustModel;
@@ -629,6 +646,8 @@ public:
     KnobIntWPtr maxIterations;
     KnobBoolWPtr bruteForcePreTrack, useNormalizedIntensities;
     KnobDoubleWPtr preBlurSigma;
+    KnobIntWPtr pyramidLevels;
+    KnobBoolWPtr useGPUMatching;
     KnobSeparatorWPtr perTrackParamsSeparator;
     KnobBoolWPtr activateTrack;
     KnobBoolWPtr autoKeyEnabled;
@@ -784,6 +803,8 @@ public:
     virtual bool isBruteForcePreTrackEnabled() const OVERRIDE FINAL;
     virtual bool isNormalizeIntensitiesEnabled() const OVERRIDE FINAL;
     virtual double getPreBlurSigma() const OVERRIDE FINAL;
+    virtual int getNumPyramidLevels() const OVERRIDE FINAL;
+    virtual bool isGPUMatchingEnabled() const OVERRIDE FINAL;
     virtual RectD getNormalizationRoD(TimeValue time, ViewIdx view) const OVERRIDE FINAL;
     ////////////////////
 
@@ -891,6 +912,9 @@ public:
     TrackerDrawStateEnum hoverState;
     TrackMarkerPtr interactMarker, hoverMarker;
 
+    // The crosses of the markers that are not selected and their shadow
+    OverlayDrawList unselectedMarkersDrawList, unselectedMarkersShadowDrawList;
+
     typedef std::map<TimeValue, GLTexturePtr> KeyFrameTexIDs;
     typedef std::map<boost::weak_ptr<TrackMarker>, KeyFrameTexIDs> TrackKeysMap;
     TrackKeysMap trackTextures;
@@ -374,7 +374,7 @@ TrackerNodePrivate::solveTransformParams()
     lastSolveRequest.jitterPeriod = jitterPer;
     lastSolveRequest.jitterAdd = jitterAdd;
     lastSolveRequest.allMarkers = markers;
-    lastSolveRequest.keyframes = keyframes;
+    lastSolveRequest.keyframes.assign( keyframes.begin(), keyframes.end() );
     lastSolveRequest.robustModel = robust;
     lastSolveRequest.maxFittingError = maxFittingError;
 
@@ -804,7 +804,7 @@ TrackerNodePrivate::computeCornerParamsFromTracks()
     {
         int nKeys = (int)lastSolveRequest.keyframes.size();
         int keyIndex = 0;
-        for (std::set<double>::const_iterator it = lastSolveRequest.keyframes.begin(); it != lastSolveRequest.keyframes.end(); ++it, ++keyIndex) {
+        for (std::vector<TimeValue>::const_iterator it = lastSolveRequest.keyframes.begin(); it != lastSolveRequest.keyframes.end(); ++it, ++keyIndex) {
             CornerPinData data = tracker->computeCornerPinParamsFromTracksAtTime(lastSolveRequest.refTime, *it, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, thisShared, lastSolveRequest.allMarkers);
             if (data.valid) {
                 validResults.push_back(data);
@@ -1008,7 +1008,7 @@ TrackerNodePrivate::computeTransformParamsFromTracks()
     {
         int nKeys = lastSolveRequest.keyframes.size();
         int keyIndex = 0;
-        for (std::set<double>::const_iterator it = lastSolveRequest.keyframes.begin(); it != lastSolveRequest.keyframes.end(); ++it, ++keyIndex) {
+        for (std::vector<TimeValue>::const_iterator it = lastSolveRequest.keyframes.begin(); it != lastSolveRequest.keyframes.end(); ++it, ++keyIndex) {
             TransformData data = tracker->computeTransformParamsFromTracksAtTime(lastSolveRequest.refTime, *it, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, thisShared, center.lock(), lastSolveRequest.allMarkers);
             if (data.valid) {
                 validResults.push_back(data);
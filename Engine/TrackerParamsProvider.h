@@ -153,6 +153,17 @@ public:
      **/
     virtual double getPreBlurSigma() const = 0;
 
+    /**
+     * @brief Returns the number of levels of the image pyramid used to track coarse-to-fine, 1 meaning
+     * that images are only tracked at full resolution.
+     **/
+    virtual int getNumPyramidLevels() const = 0;
+
+    /**
+     * @brief Should the brute-force pre-track be done with OpenGL when available ?
+     **/
+    virtual bool isGPUMatchingEnabled() const = 0;
+
     /**
      * @brief Returns the rectangle used to normalize coordinates for the given time/view
      **/
@@ -25,7 +25,13 @@
 
 #include "TreeRender.h"
 
+#include <algorithm>
 #include <set>
+#include <deque>
+#include <vector>
+#include <list>
+#include <map>
+#include <QtCore/QAtomicInt>
 #include <QtCore/QThread>
 #include <QMutex>
 #include <QTimer>
@@ -36,21 +42,31 @@
 #include "Global/FloatingPointExceptions.h"
 #endif
 #include "Engine/Image.h"
+#include "Engine/ImageCacheEntry.h"
+#include "Engine/ImageCacheKey.h"
+#include "Engine/ImageStorage.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/FrameViewRequest.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/GroupInput.h"
+#include "Engine/Hash64.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
+#include "Engine/RenderArena.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
 #include "Engine/Timer.h"
+#include "Engine/TraceRecorder.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/ThreadPoolMonitor.h"
 #include "Engine/TreeRenderQueueManager.h"
 #include "Engine/TLSHolder.h"
 
 //#define TRACE_RENDER_DEPENDENCIES
 
+// The cost in seconds added for each request on a path, so that the longest path wins among nodes that were never rendered
+#define NATRON_CRITICAL_PATH_REQUEST_COST 1e-6
+
 NATRON_NAMESPACE_ENTER
 
 typedef std::set<AbortableThread*> ThreadSet;
@@ -63,6 +79,170 @@ enum TreeRenderStateEnum
 
 typedef std::set<FrameViewRequestPtr> DependencyFreeRenderSet;
 
+/**
+ * @brief The requests that the tasks run by one worker thread made dependency-free.
+ * The worker pops from the back the request it unblocked last, so that it renders it while the images
+ * of its inputs are still in the cache of its CPU. Other threads steal from the front.
+ * Each deque has its own lock, so that finishing a task and picking the next one does not go through
+ * a lock shared by all the threads.
+ **/
+class RenderTaskDeque
+{
+    QMutex _lock;
+    std::deque<FrameViewRequestPtr> _requests;
+
+public:
+
+    RenderTaskDeque()
+    : _lock()
+    , _requests()
+    {
+    }
+
+    void pushBack(const FrameViewRequestPtr& request)
+    {
+        QMutexLocker k(&_lock);
+        _requests.push_back(request);
+    }
+
+    bool popBack(FrameViewRequestPtr* request)
+    {
+        QMutexLocker k(&_lock);
+        if ( _requests.empty() ) {
+            return false;
+        }
+        *request = _requests.back();
+        _requests.pop_back();
+
+        return true;
+    }
+
+    bool popFront(FrameViewRequestPtr* request)
+    {
+        QMutexLocker k(&_lock);
+        if ( _requests.empty() ) {
+            return false;
+        }
+        *request = _requests.front();
+        _requests.pop_front();
+
+        return true;
+    }
+
+    std::size_t size()
+    {
+        QMutexLocker k(&_lock);
+        return _requests.size();
+    }
+};
+
+typedef boost::shared_ptr<RenderTaskDeque> RenderTaskDequePtr;
+
+/**
+ * @brief Identifies the output of a render clone: two render clones with the same frame/view hash
+ * at the same time and view produce the same images.
+ **/
+struct EquivalentRenderCloneKey
+{
+    U64 hash;
+    TimeValue time;
+    ViewIdx view;
+};
+
+struct EquivalentRenderCloneKey_Compare
+{
+    bool operator() (const EquivalentRenderCloneKey& lhs, const EquivalentRenderCloneKey& rhs) const
+    {
+        if (lhs.hash < rhs.hash) {
+            return true;
+        } else if (lhs.hash > rhs.hash) {
+            return false;
+        }
+        if (lhs.time < rhs.time) {
+            return true;
+        } else if (lhs.time > rhs.time) {
+            return false;
+        }
+        return lhs.view < rhs.view;
+    }
+};
+
+typedef std::map<EquivalentRenderCloneKey, EffectInstanceWPtr, EquivalentRenderCloneKey_Compare> EquivalentRenderClonesMap;
+
+/**
+ * @brief Identifies the arguments of an action called on a rectangle of the image, see getMemoizedRegionsOfInterest()
+ **/
+struct MemoizedActionKey
+{
+    U64 hash;
+    TimeValue time;
+    ViewIdx view;
+    double scaleX, scaleY;
+    double x1, y1, x2, y2;
+    ImagePlaneDesc plane;
+};
+
+struct MemoizedActionKey_Compare
+{
+    bool operator() (const MemoizedActionKey& lhs, const MemoizedActionKey& rhs) const
+    {
+#define COMPARE_MEMBER(member) \
+    if (lhs.member < rhs.member) { \
+        return true; \
+    } else if (rhs.member < lhs.member) { \
+        return false; \
+    }
+        COMPARE_MEMBER(hash)
+        COMPARE_MEMBER(time)
+        COMPARE_MEMBER(view)
+        COMPARE_MEMBER(scaleX)
+        COMPARE_MEMBER(scaleY)
+        COMPARE_MEMBER(x1)
+        COMPARE_MEMBER(y1)
+        COMPARE_MEMBER(x2)
+        COMPARE_MEMBER(y2)
+#undef COMPARE_MEMBER
+        return lhs.plane < rhs.plane;
+    }
+};
+
+typedef std::map<MemoizedActionKey, RoIMap, MemoizedActionKey_Compare> MemoizedRegionsOfInterestMap;
+typedef std::map<MemoizedActionKey, IsIdentityResultsPtr, MemoizedActionKey_Compare> MemoizedIdentityMap;
+
+struct MemoizedConvertedImage
+{
+    // The source is checked on look-up: a new image may be allocated at the address of a released one
+    ImageWPtr source;
+    ImageWPtr converted;
+};
+
+typedef std::map<MemoizedActionKey, MemoizedConvertedImage, MemoizedActionKey_Compare> MemoizedConvertedImagesMap;
+
+static MemoizedActionKey
+makeMemoizedActionKey(U64 hash,
+                      TimeValue time,
+                      ViewIdx view,
+                      const RenderScale& scale,
+                      double x1,
+                      double y1,
+                      double x2,
+                      double y2,
+                      const ImagePlaneDesc& plane)
+{
+    MemoizedActionKey key;
+    key.hash = hash;
+    key.time = time;
+    key.view = view;
+    key.scaleX = scale.x;
+    key.scaleY = scale.y;
+    key.x1 = x1;
+    key.y1 = y1;
+    key.x2 = x2;
+    key.y2 = y2;
+    key.plane = plane;
+    return key;
+}
+
 struct TreeRenderPrivate
 {
 
@@ -80,6 +260,25 @@ struct TreeRenderPrivate
     mutable QMutex renderClonesMutex;
     std::list<KnobHolderPtr> renderClones;
 
+    // The first render clone requested for each frame/view hash, see getEquivalentRenderClone()
+    mutable QMutex equivalentRenderClonesMutex;
+    EquivalentRenderClonesMap equivalentRenderClones;
+
+    // Results of the actions called on a rectangle of the image, see getMemoizedRegionsOfInterest()
+    mutable QMutex memoizedActionsMutex;
+    MemoizedRegionsOfInterestMap memoizedRegionsOfInterest;
+    MemoizedIdentityMap memoizedIdentity;
+
+    // The conversions of the input images, see getMemoizedConvertedImage()
+    mutable QMutex memoizedConvertedImagesMutex;
+    MemoizedConvertedImagesMap memoizedConvertedImages;
+
+    // The RAM of the images allocated by this render
+    MemoryBudgetPtr memoryBudget;
+
+    // The arena the bookkeeping of the requests of this render is allocated from
+    RenderArenaPtr arena;
+
     // The request output results
     FrameViewRequestPtr outputRequest;
 
@@ -107,6 +306,16 @@ struct TreeRenderPrivate
     bool handleNaNs;
     bool useConcatenations;
 
+    // The maximum number of pixels of a stripe of a streamed render, 0 if disabled
+    std::size_t streamingStripeSize;
+
+    // Measures the latency of the render, from its creation to the end of its main execution
+    TimeLapse creationTime;
+
+    // The time elapsed on creationTime when setRenderAborted() was first called or -1 if not aborted yet,
+    // protected by abortTimeMutex
+    mutable QMutex abortTimeMutex;
+    double abortTime;
 
     TreeRenderPrivate(TreeRender* publicInterface)
     : _publicInterface(publicInterface)
@@ -115,6 +324,15 @@ struct TreeRenderPrivate
     , state(eActionStatusOK)
     , renderClonesMutex()
     , renderClones()
+    , equivalentRenderClonesMutex()
+    , equivalentRenderClones()
+    , memoizedActionsMutex()
+    , memoizedRegionsOfInterest()
+    , memoizedIdentity()
+    , memoizedConvertedImagesMutex()
+    , memoizedConvertedImages()
+    , memoryBudget(new MemoryBudget)
+    , arena(new RenderArena)
     , outputRequest()
     , extraRequestedResults()
     , extraRequestedResultsMutex()
@@ -125,6 +343,10 @@ struct TreeRenderPrivate
     , aborted()
     , handleNaNs(true)
     , useConcatenations(true)
+    , streamingStripeSize(0)
+    , creationTime()
+    , abortTimeMutex()
+    , abortTime(-1.)
     {
         aborted.fetchAndStoreAcquire(0);
 
@@ -175,6 +397,9 @@ TreeRender::CtorArgs::CtorArgs()
 , playback(false)
 , byPassCache(false)
 , preventConcurrentTreeRenders(false)
+, priority(eTreeRenderPriorityInteractive)
+, batch()
+, renderGroup(0)
 {
 
 }
@@ -265,7 +490,23 @@ TreeRender::isRenderAborted() const
 void
 TreeRender::setRenderAborted()
 {
-    _imp->aborted.fetchAndAddAcquire(1);
+    if (_imp->aborted.fetchAndAddAcquire(1) == 0) {
+        // Only the first abort counts for the abort latency
+        double time = _imp->creationTime.getTimeSinceCreation();
+        QMutexLocker k(&_imp->abortTimeMutex);
+        _imp->abortTime = time;
+    }
+}
+
+double
+TreeRender::getTimeSinceAbort() const
+{
+    double time = _imp->creationTime.getTimeSinceCreation();
+    QMutexLocker k(&_imp->abortTimeMutex);
+    if (_imp->abortTime < 0) {
+        return 0.;
+    }
+    return std::max(0., time - _imp->abortTime);
 }
 
 bool
@@ -300,6 +541,18 @@ TreeRender::isConcatenationEnabled() const
     return _imp->useConcatenations;
 }
 
+std::size_t
+TreeRender::getStreamingStripeSize() const
+{
+    return _imp->streamingStripeSize;
+}
+
+TreeRenderBatchPtr
+TreeRender::getBatch() const
+{
+    return _imp->ctorArgs->batch;
+}
+
 TreeRenderQueueProviderConstPtr
 TreeRender::getProvider() const
 {
@@ -330,6 +583,36 @@ TreeRender::isConcurrentRendersAllowed() const
     return !_imp->ctorArgs->preventConcurrentTreeRenders;
 }
 
+U64
+TreeRender::getRenderGroup() const
+{
+    return _imp->ctorArgs->renderGroup;
+}
+
+U64
+TreeRender::createRenderGroup()
+{
+    static QAtomicInt lastGroup;
+    return (U64)(unsigned int)lastGroup.fetchAndAddOrdered(1) + 1;
+}
+
+TreeRenderPriorityEnum
+TreeRender::getPriority() const
+{
+    TreeRenderPriorityEnum ret = _imp->ctorArgs->priority;
+    if (_imp->ctorArgs->provider) {
+        ret = std::max( ret, _imp->ctorArgs->provider->getRenderPriority() );
+    }
+
+    return ret;
+}
+
+double
+TreeRender::getTimeSinceCreation() const
+{
+    return _imp->creationTime.getTimeSinceCreation();
+}
+
 const RenderScale&
 TreeRender::getProxyScale() const
 {
@@ -355,6 +638,169 @@ TreeRender::registerRenderClone(const KnobHolderPtr& holder)
     _imp->renderClones.push_back(holder);
 }
 
+EffectInstancePtr
+TreeRender::getEquivalentRenderClone(const EffectInstancePtr& renderClone)
+{
+    assert(renderClone && renderClone->isRenderClone());
+
+    // Each node must render at least once, and the images of the sampled nodes are fetched from their own clone
+    if ( isByPassCacheEnabled() || _imp->ctorArgs->activeRotoDrawableItem || isExtraResultsRequestedForNode( renderClone->getNode() ) ) {
+        return renderClone;
+    }
+
+    EquivalentRenderCloneKey key;
+    key.time = renderClone->getCurrentRenderTime();
+    key.view = renderClone->getCurrentRenderView();
+    {
+        HashableObject::ComputeHashArgs args;
+        args.time = key.time;
+        args.view = key.view;
+        args.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+        key.hash = renderClone->computeHash(args);
+    }
+    if (key.hash == 0) {
+        return renderClone;
+    }
+
+    QMutexLocker k(&_imp->equivalentRenderClonesMutex);
+    std::pair<EquivalentRenderClonesMap::iterator, bool> ret = _imp->equivalentRenderClones.insert( std::make_pair( key, EffectInstanceWPtr(renderClone) ) );
+    if (ret.second) {
+        return renderClone;
+    }
+    EffectInstancePtr existingClone = ret.first->second.lock();
+    if (!existingClone) {
+        ret.first->second = renderClone;
+        return renderClone;
+    }
+    return existingClone;
+} // getEquivalentRenderClone
+
+bool
+TreeRender::getMemoizedRegionsOfInterest(U64 hash,
+                                         TimeValue time,
+                                         ViewIdx view,
+                                         const RenderScale& scale,
+                                         const RectD& renderWindow,
+                                         RoIMap* results) const
+{
+    MemoizedActionKey key = makeMemoizedActionKey(hash, time, view, scale, renderWindow.x1, renderWindow.y1, renderWindow.x2, renderWindow.y2, ImagePlaneDesc());
+    QMutexLocker k(&_imp->memoizedActionsMutex);
+    MemoizedRegionsOfInterestMap::const_iterator found = _imp->memoizedRegionsOfInterest.find(key);
+    if ( found == _imp->memoizedRegionsOfInterest.end() ) {
+        return false;
+    }
+    *results = found->second;
+    return true;
+}
+
+void
+TreeRender::setMemoizedRegionsOfInterest(U64 hash,
+                                         TimeValue time,
+                                         ViewIdx view,
+                                         const RenderScale& scale,
+                                         const RectD& renderWindow,
+                                         const RoIMap& results)
+{
+    MemoizedActionKey key = makeMemoizedActionKey(hash, time, view, scale, renderWindow.x1, renderWindow.y1, renderWindow.x2, renderWindow.y2, ImagePlaneDesc());
+    QMutexLocker k(&_imp->memoizedActionsMutex);
+    _imp->memoizedRegionsOfInterest[key] = results;
+}
+
+IsIdentityResultsPtr
+TreeRender::getMemoizedIdentity(U64 hash,
+                                TimeValue time,
+                                ViewIdx view,
+                                const RenderScale& scale,
+                                const RectI& renderWindow,
+                                const ImagePlaneDesc& plane) const
+{
+    MemoizedActionKey key = makeMemoizedActionKey(hash, time, view, scale, renderWindow.x1, renderWindow.y1, renderWindow.x2, renderWindow.y2, plane);
+    QMutexLocker k(&_imp->memoizedActionsMutex);
+    MemoizedIdentityMap::const_iterator found = _imp->memoizedIdentity.find(key);
+    if ( found == _imp->memoizedIdentity.end() ) {
+        return IsIdentityResultsPtr();
+    }
+    return found->second;
+}
+
+void
+TreeRender::setMemoizedIdentity(U64 hash,
+                                TimeValue time,
+                                ViewIdx view,
+                                const RenderScale& scale,
+                                const RectI& renderWindow,
+                                const ImagePlaneDesc& plane,
+                                const IsIdentityResultsPtr& results)
+{
+    MemoizedActionKey key = makeMemoizedActionKey(hash, time, view, scale, renderWindow.x1, renderWindow.y1, renderWindow.x2, renderWindow.y2, plane);
+    QMutexLocker k(&_imp->memoizedActionsMutex);
+    _imp->memoizedIdentity[key] = results;
+}
+
+static MemoizedActionKey
+makeConvertedImageKey(const ImagePtr& source,
+                      U64 hash,
+                      const RectI& bounds,
+                      const ImagePlaneDesc& plane)
+{
+    Hash64 sourceHash;
+    sourceHash.append(hash);
+    sourceHash.append( (U64)source.get() );
+    sourceHash.computeHash();
+    return makeMemoizedActionKey(sourceHash.value(), TimeValue(0.), ViewIdx(0), RenderScale(1.), bounds.x1, bounds.y1, bounds.x2, bounds.y2, plane);
+}
+
+ImagePtr
+TreeRender::getMemoizedConvertedImage(const ImagePtr& source,
+                                      U64 hash,
+                                      const RectI& bounds,
+                                      const ImagePlaneDesc& plane) const
+{
+    MemoizedActionKey key = makeConvertedImageKey(source, hash, bounds, plane);
+    QMutexLocker k(&_imp->memoizedConvertedImagesMutex);
+    MemoizedConvertedImagesMap::iterator found = _imp->memoizedConvertedImages.find(key);
+    if ( found == _imp->memoizedConvertedImages.end() ) {
+        return ImagePtr();
+    }
+    ImagePtr converted = found->second.converted.lock();
+    if ( !converted || (found->second.source.lock() != source) ) {
+        _imp->memoizedConvertedImages.erase(found);
+        return ImagePtr();
+    }
+    return converted;
+}
+
+ImagePtr
+TreeRender::setMemoizedConvertedImage(const ImagePtr& source,
+                                      U64 hash,
+                                      const RectI& bounds,
+                                      const ImagePlaneDesc& plane,
+                                      const ImagePtr& converted)
+{
+    MemoizedActionKey key = makeConvertedImageKey(source, hash, bounds, plane);
+    QMutexLocker k(&_imp->memoizedConvertedImagesMutex);
+    MemoizedConvertedImage& entry = _imp->memoizedConvertedImages[key];
+    ImagePtr existing = entry.converted.lock();
+    if ( existing && (entry.source.lock() == source) ) {
+        return existing;
+    }
+    entry.source = source;
+    entry.converted = converted;
+    return converted;
+}
+
+MemoryBudgetPtr
+TreeRender::getMemoryBudget() const
+{
+    return _imp->memoryBudget;
+}
+
+RenderArenaPtr
+TreeRender::getArena() const
+{
+    return _imp->arena;
+}
+
 void
 TreeRenderPrivate::fetchOpenGLContext(const TreeRender::CtorArgsPtr& inArgs)
 {
@@ -440,6 +886,13 @@ TreeRenderPrivate::init(const TreeRender::CtorArgsPtr& inArgs)
     SettingsPtr settings = appPTR->getCurrentSettings();
     handleNaNs = settings && settings->isNaNHandlingEnabled();
     useConcatenations = settings && settings->isTransformConcatenationEnabled();
+    if (settings) {
+        memoryBudget->setLimit( settings->getRenderMemoryBudget() );
+        // The images of the sampled nodes and of the painted strokes are needed for the whole RoI
+        if ( inArgs->extraNodesToSample.empty() && !inArgs->activeRotoDrawableItem ) {
+            streamingStripeSize = settings->getStreamingRenderStripeSize();
+        }
+    }
     
     // Initialize all requested extra nodes to a null result
     for (std::list<NodePtr>::const_iterator it = inArgs->extraNodesToSample.begin(); it != inArgs->extraNodesToSample.end(); ++it) {
@@ -571,6 +1024,16 @@ struct TreeRenderExecutionDataPrivate
     // Instead we explicitly manage them and ensure they do not hold any external strong refs.
     std::set<FrameViewRenderRunnablePtr> launchedRunnables;
 
+    // For each request of the execution, the estimated time in seconds of the longest path from the request to the output request,
+    // including the request itself. Protected by dependencyFreeRendersMutex
+    std::map<const FrameViewRequest*, double> criticalPathCosts;
+
+    // Protects workerDeques. It is only taken when a worker starts or stops and when looking for a task to steal.
+    mutable QMutex workerDequesMutex;
+
+    // The deques of the workers currently running tasks of this execution
+    std::list<RenderTaskDequePtr> workerDeques;
+
     // If true, anything that request new images to be rendered from within the execution should create a new TreeRender
     // instead. See discussion in @FrameViewRequest: this is to overcome thread-safety for host frame-threading effects.
     bool createTreeRenderIfUnrenderedImage;
@@ -586,14 +1049,56 @@ struct TreeRenderExecutionDataPrivate
     , plane()
     , outputRequest()
     , launchedRunnables()
+    , criticalPathCosts()
+    , workerDequesMutex()
+    , workerDeques()
     , createTreeRenderIfUnrenderedImage(createTreeRenderIfUnrenderedImage)
     {
         
     }
 
-    void onTaskFinished(const FrameViewRequestPtr& request, ActionRetCodeEnum stat);
+    /**
+     * @brief Marks the request as rendered. If workerDeque is not NULL, the requests that it made dependency-free are pushed
+     * to it instead of being added to dependencyFreeRenders, so that the calling worker renders them next.
+     * If notifyManager is false, the TreeRenderQueueManager thread is only notified when the execution is finished.
+     **/
+    void onTaskFinished(const FrameViewRequestPtr& request, ActionRetCodeEnum stat, RenderTaskDeque* workerDeque, bool notifyManager);
 
-    void removeDependencyLinkFromRequest(const FrameViewRequestPtr& request);
+    void removeDependencyLinkFromRequest(const FrameViewRequestPtr& request, std::list<FrameViewRequestPtr>* unblockedRequests);
+
+    /**
+     * @brief Returns the estimated time to render the request and the longest chain of its listeners up to the output request,
+     * from the time the nodes took to render in the previous frames. This is the upward rank of HEFT schedulers.
+     **/
+    double getCriticalPathCost(const FrameViewRequestPtr& request);
+
+    /**
+     * @brief Removes the dependency-free request with the longest critical path from dependencyFreeRenders.
+     **/
+    FrameViewRequestPtr takeCriticalDependencyFreeRender();
+
+    /**
+     * @brief Takes a request to render, first from the dependency-free set and then from the front of the deque of another worker.
+     **/
+    bool takeAvailableTask(const RenderTaskDeque* thiefDeque, FrameViewRequestPtr* request);
+
+    bool stealTask(const RenderTaskDeque* thiefDeque, FrameViewRequestPtr* request);
+
+    /**
+     * @brief Moves the given request and the requests left in the deque of a worker back to the dependency-free set,
+     * when the worker gives its thread back to a render of a higher priority class.
+     **/
+    void requeueWorkerTasks(const FrameViewRequestPtr& request, RenderTaskDeque* workerDeque);
+
+    /**
+     * @brief Called when the render of the request returned eActionStatusPendingTiles: the TreeRenderQueueManager adds it back
+     * to dependencyFreeRenders once the tiles pending in its image are rendered.
+     **/
+    void parkRequestOnPendingTiles(const FrameViewRequestPtr& request);
+
+    RenderTaskDequePtr registerWorkerDeque();
+
+    void unregisterWorkerDeque(const RenderTaskDequePtr& workerDeque);
 
 
 };
@@ -657,7 +1162,8 @@ TreeRenderExecutionData::addTaskToRender(const FrameViewRequestPtr& render)
 }
 
 void
-TreeRenderExecutionDataPrivate::removeDependencyLinkFromRequest(const FrameViewRequestPtr& request)
+TreeRenderExecutionDataPrivate::removeDependencyLinkFromRequest(const FrameViewRequestPtr& request,
+                                                                std::list<FrameViewRequestPtr>* unblockedRequests)
 {
     assert(!dependencyFreeRendersMutex.tryLock());
 
@@ -673,15 +1179,105 @@ TreeRenderExecutionDataPrivate::removeDependencyLinkFromRequest(const FrameViewR
 #ifdef TRACE_RENDER_DEPENDENCIES
                 qDebug() << thisShared.get() << "Adding" << (*it)->getEffect()->getScriptName_mt_safe().c_str() << (*it)->getPlaneDesc().getPlaneLabel().c_str()  << "(" << it->get() << ") to the dependency-free list";
 #endif
-                dependencyFreeRenders->insert(*it);
+                if (unblockedRequests) {
+                    unblockedRequests->push_back(*it);
+                } else {
+                    dependencyFreeRenders->insert(*it);
+                }
             }
         }
     }
 
+    // The worker renders the request at the back of its deque next: put the one with the longest critical path there
+    if ( unblockedRequests && (unblockedRequests->size() > 1) ) {
+        std::vector<std::pair<double, FrameViewRequestPtr> > sortedRequests;
+        for (std::list<FrameViewRequestPtr>::const_iterator it = unblockedRequests->begin(); it != unblockedRequests->end(); ++it) {
+            sortedRequests.push_back( std::make_pair(getCriticalPathCost(*it), *it) );
+        }
+        std::sort( sortedRequests.begin(), sortedRequests.end() );
+        unblockedRequests->clear();
+        for (std::size_t i = 0; i < sortedRequests.size(); ++i) {
+            unblockedRequests->push_back(sortedRequests[i].second);
+        }
+    }
+}
+
+static double
+estimateRequestRenderCost(const FrameViewRequestPtr& request)
+{
+    // Requests that are rendered already or pass-through do not cost anything
+    FrameViewRequest::FrameViewRequestStatusEnum status = request->getStatus();
+    if ( (status == FrameViewRequest::eFrameViewRequestStatusRendered) || (status == FrameViewRequest::eFrameViewRequestStatusPassThrough) ) {
+        return 0.;
+    }
+    EffectInstancePtr effect = request->getEffect();
+    NodePtr node;
+    if (effect) {
+        node = effect->getNode();
+    }
+    double costPerMB = node ? node->getRenderCostPerMB() : 0.;
+    if (costPerMB == 0.) {
+        return NATRON_CRITICAL_PATH_REQUEST_COST;
+    }
+
+    // The bit depth is not known before rendering: assume float
+    const RenderScale scale = EffectInstance::getCombinedScale( request->getMipMapLevel(), request->getProxyScale() );
+    const double nPixels = request->getCurrentRoI().area() * scale.x * scale.y;
+    const double nMB = nPixels * request->getPlaneDesc().getNumComponents() * sizeof(float) / (1024. * 1024.);
+
+    return costPerMB * nMB + NATRON_CRITICAL_PATH_REQUEST_COST;
+}
+
+double
+TreeRenderExecutionDataPrivate::getCriticalPathCost(const FrameViewRequestPtr& request)
+{
+    assert(!dependencyFreeRendersMutex.tryLock());
+
+    std::map<const FrameViewRequest*, double>::const_iterator found = criticalPathCosts.find( request.get() );
+    if ( found != criticalPathCosts.end() ) {
+        return found->second;
+    }
+
+    // The listeners of a request are the requests of the nodes downstream that use its image
+    double longestListenerPath = 0.;
+    std::list<FrameViewRequestPtr> listeners = request->getListeners( _publicInterface->shared_from_this() );
+    for (std::list<FrameViewRequestPtr>::const_iterator it = listeners.begin(); it != listeners.end(); ++it) {
+        longestListenerPath = std::max( longestListenerPath, getCriticalPathCost(*it) );
+    }
+
+    double cost = estimateRequestRenderCost(request) + longestListenerPath;
+    criticalPathCosts[request.get()] = cost;
+
+    return cost;
+}
+
+FrameViewRequestPtr
+TreeRenderExecutionDataPrivate::takeCriticalDependencyFreeRender()
+{
+    assert(!dependencyFreeRendersMutex.tryLock());
+    assert( !dependencyFreeRenders->empty() );
+
+    DependencyFreeRenderSet::iterator critical = dependencyFreeRenders->begin();
+    double criticalCost = getCriticalPathCost(*critical);
+    DependencyFreeRenderSet::iterator it = critical;
+    for (++it; it != dependencyFreeRenders->end(); ++it) {
+        double cost = getCriticalPathCost(*it);
+        if (cost > criticalCost) {
+            critical = it;
+            criticalCost = cost;
+        }
+    }
+    FrameViewRequestPtr ret = *critical;
+    dependencyFreeRenders->erase(critical);
+
+    return ret;
 }
 
 void
-TreeRenderExecutionDataPrivate::onTaskFinished(const FrameViewRequestPtr& request, ActionRetCodeEnum requestStatus)
+TreeRenderExecutionDataPrivate::onTaskFinished(const FrameViewRequestPtr& request,
+                                               ActionRetCodeEnum requestStatus,
+                                               RenderTaskDeque* workerDeque,
+                                               bool notifyManager)
 {
 
 
@@ -692,7 +1288,7 @@ TreeRenderExecutionDataPrivate::onTaskFinished(const FrameViewRequestPtr& reques
 
     TreeRenderPtr render = treeRender.lock();
 
-
+    std::list<FrameViewRequestPtr> unblockedRequests;
     {
         QMutexLocker k(&dependencyFreeRendersMutex);
 
@@ -701,9 +1297,14 @@ TreeRenderExecutionDataPrivate::onTaskFinished(const FrameViewRequestPtr& reques
         }
 
         // For each frame/view that depend on this frame, remove it from the dependencies list.
-        removeDependencyLinkFromRequest(request);
+        removeDependencyLinkFromRequest(request, workerDeque ? &unblockedRequests : 0);
 
     }
+
+    // Push the unblocked requests once the execution lock is released: the last one pushed is the one the worker renders next
+    for (std::list<FrameViewRequestPtr>::const_iterator it = unblockedRequests.begin(); it != unblockedRequests.end(); ++it) {
+        workerDeque->pushBack(*it);
+    }
     
     // If the results for this node were requested by the caller, insert them
     assert(render);
@@ -712,11 +1313,90 @@ TreeRenderExecutionDataPrivate::onTaskFinished(const FrameViewRequestPtr& reques
     }
 
     bool wasLastTaskRemaining = (request == sharedData->getOutputRequest());
-    appPTR->getTasksQueueManager()->notifyTaskInRenderFinished(sharedData, wasLastTaskRemaining, isRunningInThreadPoolThread());
+    appPTR->getTasksQueueManager()->notifyTaskInRenderFinished(sharedData, wasLastTaskRemaining, (notifyManager || wasLastTaskRemaining) && isRunningInThreadPoolThread());
 
 
 } // onTaskFinished
 
+bool
+TreeRenderExecutionDataPrivate::takeAvailableTask(const RenderTaskDeque* thiefDeque,
+                                                  FrameViewRequestPtr* request)
+{
+    {
+        QMutexLocker k(&dependencyFreeRendersMutex);
+        if ( dependencyFreeRenders && !dependencyFreeRenders->empty() ) {
+            *request = takeCriticalDependencyFreeRender();
+
+            return true;
+        }
+    }
+
+    return stealTask(thiefDeque, request);
+}
+
+bool
+TreeRenderExecutionDataPrivate::stealTask(const RenderTaskDeque* thiefDeque,
+                                          FrameViewRequestPtr* request)
+{
+    QMutexLocker k(&workerDequesMutex);
+    for (std::list<RenderTaskDequePtr>::const_iterator it = workerDeques.begin(); it != workerDeques.end(); ++it) {
+        // Steal the oldest request of the worker: it is the one whose inputs are the least likely to be still in its cache
+        if ( ( it->get() != thiefDeque ) && (*it)->popFront(request) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+TreeRenderExecutionDataPrivate::requeueWorkerTasks(const FrameViewRequestPtr& request,
+                                                   RenderTaskDeque* workerDeque)
+{
+    QMutexLocker k(&dependencyFreeRendersMutex);
+    dependencyFreeRenders->insert(request);
+    FrameViewRequestPtr leftRequest;
+    while ( workerDeque->popFront(&leftRequest) ) {
+        dependencyFreeRenders->insert(leftRequest);
+    }
+}
+
+void
+TreeRenderExecutionDataPrivate::parkRequestOnPendingTiles(const FrameViewRequestPtr& request)
+{
+    // The request waits on the cache entry of the image that the effect renders, see launchRenderInternal()
+    ImagePtr image = request->getFullscaleImagePlane();
+    ImageCacheEntryPtr cacheEntry;
+    if (image) {
+        cacheEntry = image->getCacheEntry();
+    }
+    ImageCacheKeyPtr key;
+    if (cacheEntry) {
+        key = cacheEntry->getCacheKey();
+    }
+    appPTR->getTasksQueueManager()->parkRequestOnPendingTiles(_publicInterface->shared_from_this(), request, key ? key->getHash() : 0);
+}
+
+RenderTaskDequePtr
+TreeRenderExecutionDataPrivate::registerWorkerDeque()
+{
+    RenderTaskDequePtr ret = boost::make_shared<RenderTaskDeque>();
+    QMutexLocker k(&workerDequesMutex);
+    workerDeques.push_back(ret);
+
+    return ret;
+}
+
+void
+TreeRenderExecutionDataPrivate::unregisterWorkerDeque(const RenderTaskDequePtr& workerDeque)
+{
+    QMutexLocker k(&workerDequesMutex);
+    std::list<RenderTaskDequePtr>::iterator found = std::find(workerDeques.begin(), workerDeques.end(), workerDeque);
+    if ( found != workerDeques.end() ) {
+        workerDeques.erase(found);
+    }
+}
+
 struct FrameViewRenderRunnable::Implementation
 {
 
@@ -725,9 +1405,13 @@ struct FrameViewRenderRunnable::Implementation
     FrameViewRequestPtr request;
     //TreeRenderPrivate* _imp;
 
+    // When the runnable was handed to the thread pool, negative if it is not monitored
+    double queueTime;
+
     Implementation(const TreeRenderExecutionDataPtr& sharedData, const FrameViewRequestPtr& request)
     : sharedData(sharedData)
     , request(request)
+    , queueTime(-1.)
     {
 
     }
@@ -761,6 +1445,14 @@ FrameViewRenderRunnable::create(const TreeRenderExecutionDataPtr& sharedData, co
 
 FrameViewRenderRunnable::~FrameViewRenderRunnable()
 {
+    // The runnable was queued but never run
+    ThreadPoolMonitor::onTaskDropped(_imp->queueTime);
+}
+
+void
+FrameViewRenderRunnable::setQueued()
+{
+    _imp->queueTime = ThreadPoolMonitor::onTaskQueued();
 }
 
 void
@@ -771,22 +1463,89 @@ FrameViewRenderRunnable::run()
                                                            boost_adaptbx::floating_point::exception_trapping::invalid |
                                                            boost_adaptbx::floating_point::exception_trapping::overflow);
 #endif
+    double monitorStartTime = ThreadPoolMonitor::onTaskStarted(_imp->queueTime);
+    _imp->queueTime = -1.;
+
     TreeRenderExecutionDataPtr sharedData = _imp->sharedData.lock();
 
-    // Check the status of the execution tasks because another concurrent render might have failed
-    ActionRetCodeEnum stat = sharedData->getStatus();
+    // Tasks run on the TreeRenderQueueManager thread (pass-through requests or failed executions) only finish their own request
+    // and leave the requests they unblock to the manager.
+    // Tasks run in the thread-pool keep on rendering the requests they unblock on the same thread, then steal from the other
+    // workers of the execution before giving their thread back.
+    // Workers of a render give their thread back at the end of a task if a render of a higher priority class is queued.
+    const bool isWorker = isRunningInThreadPoolThread();
+    RenderTaskDequePtr workerDeque;
+    TreeRenderPriorityEnum priority = eTreeRenderPriorityInteractive;
+    if (isWorker) {
+        workerDeque = sharedData->_imp->registerWorkerDeque();
+        TreeRenderPtr render = sharedData->getTreeRender();
+        if (render) {
+            priority = render->getPriority();
+        }
+    }
+
+    FrameViewRequestPtr request = _imp->request;
+    bool managerNotified = true;
+    while (request) {
 
-    if (!isFailureRetCode(stat)) {
+        // Check the status of the execution tasks because another concurrent render might have failed
+        ActionRetCodeEnum stat = sharedData->getStatus();
+
+        if (!isFailureRetCode(stat)) {
+            EffectInstancePtr renderClone = request->getEffect();
 #ifdef TRACE_RENDER_DEPENDENCIES
-        qDebug() << sharedData.get() << "Launching render of" << renderClone->getScriptName_mt_safe().c_str() << request->getPlaneDesc().getPlaneLabel().c_str();
+            qDebug() << sharedData.get() << "Launching render of" << renderClone->getScriptName_mt_safe().c_str() << request->getPlaneDesc().getPlaneLabel().c_str();
 #endif
-        EffectInstancePtr renderClone = _imp->request->getEffect();
-        stat = renderClone->launchNodeRender(sharedData, _imp->request);
+            TraceSpan_RAII traceSpan(eTraceCategoryRender, "Render");
+            if ( traceSpan.isRecording() ) {
+                traceSpan.setDetail( renderClone->getScriptName_mt_safe() + ' ' + request->getPlaneDesc().getPlaneLabel() );
+            }
+            // Workers do not wait for tiles that are pending in other threads: the request is parked and launched again
+            // once they are rendered, while this thread renders other requests.
+            stat = renderClone->launchNodeRender(sharedData, request, isWorker /*allowPendingTilesRetCode*/);
+        }
+
+        if (!workerDeque) {
+            sharedData->_imp->onTaskFinished(request, stat, 0, true);
+            break;
+        }
+
+        if (stat == eActionStatusPendingTiles) {
+            // The request is not finished: nothing is unblocked
+            sharedData->_imp->parkRequestOnPendingTiles(request);
+            managerNotified = false;
+        } else {
+            // The manager thread only needs to be woken up if this worker unblocked more requests than the one it is going to render next,
+            // so that idle threads may steal them. Otherwise this thread stays busy and nothing changed for the manager.
+            sharedData->_imp->onTaskFinished(request, stat, workerDeque.get(), false);
+            managerNotified = workerDeque->size() > 1;
+            if (managerNotified) {
+                appPTR->getTasksQueueManager()->notifyTaskInRenderFinished(sharedData, false, true);
+            }
+        }
+
+        request.reset();
+        if ( !workerDeque->popBack(&request) ) {
+            sharedData->_imp->takeAvailableTask(workerDeque.get(), &request);
+        }
+
+        if ( request && appPTR->getTasksQueueManager()->isHigherPriorityRenderQueued(priority) ) {
+            sharedData->_imp->requeueWorkerTasks(request, workerDeque.get());
+            request.reset();
+            managerNotified = false;
+        }
     }
 
-    sharedData->_imp->onTaskFinished(_imp->request, stat);
+    if (workerDeque) {
+        sharedData->_imp->unregisterWorkerDeque(workerDeque);
 
+        // This thread is given back to the thread-pool: let the manager launch more tasks
+        if (!managerNotified) {
+            appPTR->getTasksQueueManager()->notifyTaskInRenderFinished(sharedData, false, true);
+        }
+    }
 
+    ThreadPoolMonitor::onTaskFinished(monitorStartTime);
 } // run
 
 TreeRenderExecutionDataPtr
@@ -938,11 +1697,17 @@ TreeRenderExecutionData::executeAvailableTasks(int nTasksToLaunch)
 
     int nTasksStarted = 0;
 
-    // Launch all dependency-free tasks in parallel
-    while ((nTasksRemaining == -1 || nTasksRemaining > 0) && _imp->dependencyFreeRenders->size() > 0) {
+    // Launch all dependency-free tasks in parallel, the ones with the longest critical path first so that the most expensive branch
+    // of the tree starts as soon as possible. When there are none left, steal the requests that the running workers
+    // unblocked but did not get to yet.
+    while (nTasksRemaining == -1 || nTasksRemaining > 0) {
 
-        FrameViewRequestPtr request = *_imp->dependencyFreeRenders->begin();
-        _imp->dependencyFreeRenders->erase(_imp->dependencyFreeRenders->begin());
+        FrameViewRequestPtr request;
+        if ( !_imp->dependencyFreeRenders->empty() ) {
+            request = _imp->takeCriticalDependencyFreeRender();
+        } else if ( !_imp->stealTask(0, &request) ) {
+            break;
+        }
 #ifdef TRACE_RENDER_DEPENDENCIES
         qDebug() << this <<  "Queuing " << request->getEffect()->getScriptName_mt_safe().c_str() << " in task pool";
 #endif
@@ -952,6 +1717,7 @@ TreeRenderExecutionData::executeAvailableTasks(int nTasksToLaunch)
             // Only launch the runnable in a separate thread if its actually going to do any rendering.
             runnable->setAutoDelete(false);
             _imp->launchedRunnables.insert(runnable);
+            runnable->setQueued();
             threadPool->start(runnable.get());
 
             --nTasksRemaining;
@@ -38,7 +38,9 @@
 #include <QRunnable>
 
 
+#include "Engine/FrameViewRequest.h"
 #include "Engine/ImagePlaneDesc.h"
+#include "Engine/TreeRenderQueueProvider.h"
 #include "Engine/TimeValue.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/RectD.h"
@@ -91,7 +93,8 @@ public:
     bool isNewTreeRenderUponUnrenderedImageEnabled() const;
 
     /**
-     * @brief Starts tasks that are available for rendering and queue them in the thread pool
+     * @brief Starts tasks that are available for rendering and queue them in the thread pool.
+     * When no dependency-free task is left, tasks are stolen from the workers that are already rendering this execution.
      * @param launchAllTasksPossible A boolean indicating how many tasks to start. If -1 is passed, all available tasks
      * should be started.
      * @returns The number of parallel tasks that were queued.
@@ -114,6 +117,8 @@ typedef boost::shared_ptr<FrameViewRenderRunnable> FrameViewRenderRunnablePtr;
 /**
  * @brief A runnable that executes the render of 1 node (FrameViewRequest) within a TreeRenderExecutionData. 
  * Once rendered, this task will make tasks that depend on this task's results available for render.
+ * When run in the thread pool, the runnable renders the tasks it made available itself on the same thread,
+ * then steals tasks from the other workers of the execution, until there is nothing left to render.
  **/
 class FrameViewRenderRunnable
     : public QRunnable
@@ -131,6 +136,12 @@ public:
 
     virtual ~FrameViewRenderRunnable();
 
+    /**
+     * @brief Must be called right before the runnable is handed to the thread pool, to measure how long it stays queued
+     * @see ThreadPoolMonitor
+     **/
+    void setQueued();
+
     virtual void run() OVERRIDE FINAL;
 
 private:
@@ -217,6 +228,20 @@ public:
         // mouse move event renders are processed in order.
         bool preventConcurrentTreeRenders;
 
+        // The priority class of this render. The render gets the lowest of this priority and
+        // the one of the provider, see TreeRenderQueueProvider::getRenderPriority()
+        TreeRenderPriorityEnum priority;
+
+        // If this render is one frame of a frame range render, this holds the results of the
+        // time-invariant subgraphs of the tree that are shared by all frames of the range.
+        TreeRenderBatchPtr batch;
+
+        // If not 0, the renders with the same group, created with createRenderGroup(), are scheduled as one render:
+        // e.g: the A and B inputs of the viewer in wipe and compare modes share the threads instead of being rendered
+        // one after the other. The nodes upstream of both are computed once: the second render waits for the
+        // tiles pending in the cache.
+        U64 renderGroup;
+
         CtorArgs();
     };
 
@@ -269,6 +294,26 @@ public:
      **/
     bool isConcurrentRendersAllowed() const;
 
+    /**
+     * @brief Returns the priority class of this render: the lowest of the one of the CtorArgs and the one of the provider
+     **/
+    TreeRenderPriorityEnum getPriority() const;
+
+    /**
+     * @brief Returns renderGroup from the CtorArgs
+     **/
+    U64 getRenderGroup() const;
+
+    /**
+     * @brief Returns a new render group for CtorArgs::renderGroup, never 0
+     **/
+    static U64 createRenderGroup();
+
+    /**
+     * @brief Returns the time elapsed in seconds since this render was created
+     **/
+    double getTimeSinceCreation() const;
+
     /**
      * @brief The proxy scale requested
      **/
@@ -289,6 +334,12 @@ public:
      **/
     void setRenderAborted();
 
+    /**
+     * @brief Returns the time elapsed in seconds since setRenderAborted() was first called, or 0 if the render is not aborted.
+     * When called once the render is finished, this is the time the render took to react to the abort.
+     **/
+    double getTimeSinceAbort() const;
+
     /**
      * @brief Returns whether this render is part of a playback render or just a single render
      **/
@@ -314,6 +365,17 @@ public:
      **/
     bool isConcatenationEnabled() const;
 
+    /**
+     * @brief Returns the maximum number of pixels of a stripe when the root of an execution renders in stripes,
+     * 0 if streaming is disabled. @see FrameViewRequest::isStreamedRender
+     **/
+    std::size_t getStreamingStripeSize() const;
+
+    /**
+     * @brief Returns the batch passed in the CtorArgs if this render is one frame of a frame range render
+     **/
+    TreeRenderBatchPtr getBatch() const;
+
 
     /**
      * @brief Returns the request of the given node if it was requested in the
@@ -366,6 +428,58 @@ public:
      **/
     void registerRenderClone(const KnobHolderPtr& holder);
 
+    /**
+     * @brief Returns the render clone of this render that produces the same images as the given render clone,
+     * that is the first clone requested with the same frame/view hash at the same time and view.
+     * Branches that were duplicated in the graph (copy/paste, clones, PyPlugs) are then requested only once:
+     * the requests of their nodes are shared and have the requests of each branch as listeners.
+     * If there is no such clone, the given clone is registered and returned.
+     **/
+    EffectInstancePtr getEquivalentRenderClone(const EffectInstancePtr& renderClone);
+
+    /**
+     * @brief Returns the budget the RAM of the images allocated by this render is charged to.
+     * Its limit is the render memory budget of the preferences.
+     **/
+    MemoryBudgetPtr getMemoryBudget() const;
+
+    /**
+     * @brief Returns the arena the requests of this render and their bookkeeping are allocated from.
+     * It is released once the render and all its requests are destroyed.
+     **/
+    RenderArenaPtr getArena() const;
+
+    /**
+     * @brief The regions of interest of an effect only depend on its frame/view hash, the time, view, scale and render window:
+     * the results of the getRegionsOfInterest action are memoized for the whole render so that the requests of the same effect
+     * over several rectangles (tiles, identity sub-rectangles, shared branches) only call the plug-in once.
+     * Returns false if the results were not memoized yet.
+     **/
+    bool getMemoizedRegionsOfInterest(U64 hash, TimeValue time, ViewIdx view, const RenderScale& scale, const RectD& renderWindow, RoIMap* results) const;
+    void setMemoizedRegionsOfInterest(U64 hash, TimeValue time, ViewIdx view, const RenderScale& scale, const RectD& renderWindow, const RoIMap& results);
+
+    /**
+     * @brief Same as getMemoizedRegionsOfInterest() for the isIdentity action called on a sub-rectangle of the image,
+     * which is not cached in the global actions cache. Returns NULL if the results were not memoized yet.
+     **/
+    IsIdentityResultsPtr getMemoizedIdentity(U64 hash, TimeValue time, ViewIdx view, const RenderScale& scale, const RectI& renderWindow, const ImagePlaneDesc& plane) const;
+    void setMemoizedIdentity(U64 hash, TimeValue time, ViewIdx view, const RenderScale& scale, const RectI& renderWindow, const ImagePlaneDesc& plane, const IsIdentityResultsPtr& results);
+
+    /**
+     * @brief The conversion of an input image to the format an effect asks for (bounds, plane, bit depth, layout)
+     * made in getImagePlane(), identified by the source image and a hash of the conversion arguments.
+     * The converted image is only held weakly: it is shared by the threads and tiles that fetch it while it is in use,
+     * e.g. with the host frame threading, and released with the last of them.
+     * Returns NULL if the source image was not converted yet or if the converted image was released.
+     **/
+    ImagePtr getMemoizedConvertedImage(const ImagePtr& source, U64 hash, const RectI& bounds, const ImagePlaneDesc& plane) const;
+
+    /**
+     * @brief Memoizes the given converted image, unless another thread memoized a conversion in the meantime:
+     * returns the image that should be used.
+     **/
+    ImagePtr setMemoizedConvertedImage(const ImagePtr& source, U64 hash, const RectI& bounds, const ImagePlaneDesc& plane, const ImagePtr& converted);
+
 
 private:
 
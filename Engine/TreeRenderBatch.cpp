@@ -0,0 +1,337 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TreeRenderBatch.h"
+
+#include <list>
+#include <map>
+#include <set>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include "Engine/EffectInstance.h"
+#include "Engine/FrameViewRequest.h"
+#include "Engine/Image.h"
+#include "Engine/ImagePlaneDesc.h"
+#include "Engine/Node.h"
+#include "Engine/RectI.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief The image of a time-invariant subgraph root for a given view/scale/plane
+ **/
+struct SharedResult
+{
+    ViewIdx view;
+    unsigned int mipMapLevel;
+    RenderScale proxyScale;
+    ImagePlaneDesc plane;
+
+    // The hash of the root the image was rendered with
+    U64 hash;
+
+    ImagePtr requestedScaleImage, fullScaleImage;
+};
+
+typedef std::list<SharedResult> SharedResultsList;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+struct TreeRenderBatchPrivate
+{
+    TimeValue firstFrame, lastFrame;
+
+    // The roots of the time-invariant subgraphs, this is only written to in create()
+    std::set<NodePtr> timeInvariantRoots;
+
+    // Protects sharedResults
+    mutable QMutex sharedResultsMutex;
+    std::map<NodePtr, SharedResultsList> sharedResults;
+
+    mutable QAtomicInt nSharedResultsReused;
+
+    TreeRenderBatchPrivate(TimeValue firstFrame, TimeValue lastFrame)
+    : firstFrame(firstFrame)
+    , lastFrame(lastFrame)
+    , timeInvariantRoots()
+    , sharedResultsMutex()
+    , sharedResults()
+    , nSharedResultsReused()
+    {
+
+    }
+
+    bool analyseTimeInvariance(const NodePtr& node, std::map<NodePtr, bool>* visitedNodes);
+
+    static SharedResultsList::iterator findResult(SharedResultsList& results,
+                                                  ViewIdx view,
+                                                  const FrameViewRequestPtr& request,
+                                                  U64 hash);
+
+    static U64 getRenderCloneHash(const EffectInstancePtr& renderClone);
+};
+
+struct TreeRenderBatch::MakeSharedEnabler: public TreeRenderBatch
+{
+    MakeSharedEnabler(TimeValue firstFrame, TimeValue lastFrame) : TreeRenderBatch(firstFrame, lastFrame) {
+    }
+};
+
+TreeRenderBatch::TreeRenderBatch(TimeValue firstFrame, TimeValue lastFrame)
+: _imp(new TreeRenderBatchPrivate(firstFrame, lastFrame))
+{
+
+}
+
+TreeRenderBatch::~TreeRenderBatch()
+{
+
+}
+
+bool
+TreeRenderBatchPrivate::analyseTimeInvariance(const NodePtr& node, std::map<NodePtr, bool>* visitedNodes)
+{
+    std::map<NodePtr, bool>::const_iterator found = visitedNodes->find(node);
+    if (found != visitedNodes->end()) {
+        return found->second;
+    }
+
+    // Mark the node as time variant while visiting its inputs so that a cycle cannot be considered time-invariant
+    (*visitedNodes)[node] = false;
+
+    EffectInstancePtr effect = node->getEffectInstance();
+    if (!effect) {
+        return false;
+    }
+
+    // A writer produces a different file at each frame
+    bool isTimeInvariant = !effect->isWriter() && !effect->isFrameVarying() && !effect->getHasAnimation();
+
+    // The inputs are visited even if this node is time variant to find the time-invariant subgraphs upstream.
+    std::list<NodePtr> timeInvariantInputs;
+    int nInputs = node->getNInputs();
+    for (int i = 0; i < nInputs; ++i) {
+        NodePtr input = node->getInput(i);
+        if (!input) {
+            continue;
+        }
+        if (analyseTimeInvariance(input, visitedNodes)) {
+            timeInvariantInputs.push_back(input);
+        } else {
+            isTimeInvariant = false;
+        }
+    }
+
+    if (!isTimeInvariant) {
+        // The time-invariant inputs of a time variant node are the roots of time-invariant subgraphs
+        timeInvariantRoots.insert(timeInvariantInputs.begin(), timeInvariantInputs.end());
+    }
+
+    (*visitedNodes)[node] = isTimeInvariant;
+    return isTimeInvariant;
+} // analyseTimeInvariance
+
+TreeRenderBatchPtr
+TreeRenderBatch::create(const EffectInstancePtr& treeRoot, TimeValue firstFrame, TimeValue lastFrame)
+{
+    if (!treeRoot || firstFrame >= lastFrame) {
+        return TreeRenderBatchPtr();
+    }
+    TreeRenderBatchPtr ret = boost::make_shared<TreeRenderBatch::MakeSharedEnabler>(firstFrame, lastFrame);
+
+    std::map<NodePtr, bool> visitedNodes;
+    ret->_imp->analyseTimeInvariance(treeRoot->getNode(), &visitedNodes);
+    if (ret->_imp->timeInvariantRoots.empty()) {
+        return TreeRenderBatchPtr();
+    }
+    return ret;
+} // create
+
+TimeValue
+TreeRenderBatch::getFirstFrame() const
+{
+    return _imp->firstFrame;
+}
+
+TimeValue
+TreeRenderBatch::getLastFrame() const
+{
+    return _imp->lastFrame;
+}
+
+int
+TreeRenderBatch::getNumTimeInvariantSubgraphs() const
+{
+    return (int)_imp->timeInvariantRoots.size();
+}
+
+bool
+TreeRenderBatch::isTimeInvariantSubgraphRoot(const NodePtr& node) const
+{
+    return _imp->timeInvariantRoots.find(node) != _imp->timeInvariantRoots.end();
+}
+
+SharedResultsList::iterator
+TreeRenderBatchPrivate::findResult(SharedResultsList& results,
+                                   ViewIdx view,
+                                   const FrameViewRequestPtr& request,
+                                   U64 hash)
+{
+    const RenderScale& proxyScale = request->getProxyScale();
+    for (SharedResultsList::iterator it = results.begin(); it != results.end(); ++it) {
+        if (it->view == view &&
+            it->hash == hash &&
+            it->mipMapLevel == request->getMipMapLevel() &&
+            it->proxyScale.x == proxyScale.x &&
+            it->proxyScale.y == proxyScale.y &&
+            it->plane == request->getPlaneDesc()) {
+            return it;
+        }
+    }
+    return results.end();
+} // findResult
+
+U64
+TreeRenderBatchPrivate::getRenderCloneHash(const EffectInstancePtr& renderClone)
+{
+    // This is the same hash as the one identifying the image in the cache
+    HashableObject::ComputeHashArgs args;
+    args.time = renderClone->getCurrentRenderTime();
+    args.view = renderClone->getCurrentRenderView();
+    args.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+    return renderClone->computeHash(args);
+}
+
+bool
+TreeRenderBatch::getSharedResult(const EffectInstancePtr& renderClone,
+                                 const FrameViewRequestPtr& request,
+                                 const RectI& roiPixels) const
+{
+    NodePtr node = renderClone->getNode();
+    if (!isTimeInvariantSubgraphRoot(node)) {
+        return false;
+    }
+
+    U64 hash = TreeRenderBatchPrivate::getRenderCloneHash(renderClone);
+
+    ImagePtr requestedScaleImage, fullScaleImage;
+    {
+        QMutexLocker k(&_imp->sharedResultsMutex);
+        std::map<NodePtr, SharedResultsList>::iterator foundNode = _imp->sharedResults.find(node);
+        if (foundNode == _imp->sharedResults.end()) {
+            return false;
+        }
+        SharedResultsList::iterator found = TreeRenderBatchPrivate::findResult(foundNode->second, renderClone->getCurrentRenderView(), request, hash);
+        if (found == foundNode->second.end() || !found->requestedScaleImage->getBounds().contains(roiPixels)) {
+            return false;
+        }
+        requestedScaleImage = found->requestedScaleImage;
+        fullScaleImage = found->fullScaleImage;
+    }
+
+    request->setRequestedScaleImagePlane(requestedScaleImage);
+    request->setFullscaleImagePlane(fullScaleImage);
+    _imp->nSharedResultsReused.ref();
+    return true;
+} // getSharedResult
+
+void
+TreeRenderBatch::setSharedResult(const EffectInstancePtr& renderClone,
+                                 const FrameViewRequestPtr& request)
+{
+    NodePtr node = renderClone->getNode();
+    if (!isTimeInvariantSubgraphRoot(node)) {
+        return;
+    }
+
+    ImagePtr requestedScaleImage = request->getRequestedScaleImagePlane();
+    ImagePtr fullScaleImage = request->getFullscaleImagePlane();
+    if (!requestedScaleImage || !fullScaleImage) {
+        return;
+    }
+
+    // OpenGL textures belong to the context of the render that created them, only share images in RAM
+    if (requestedScaleImage->getStorageMode() != eStorageModeRAM) {
+        return;
+    }
+
+    U64 hash = TreeRenderBatchPrivate::getRenderCloneHash(renderClone);
+
+    QMutexLocker k(&_imp->sharedResultsMutex);
+    SharedResultsList& results = _imp->sharedResults[node];
+    SharedResultsList::iterator found = TreeRenderBatchPrivate::findResult(results, renderClone->getCurrentRenderView(), request, hash);
+    if (found != results.end()) {
+        // Never replace an image: other renders may still be reading it and isSharedImage() must remain true for it
+        return;
+    }
+
+    SharedResult result;
+    result.view = renderClone->getCurrentRenderView();
+    result.mipMapLevel = request->getMipMapLevel();
+    result.proxyScale = request->getProxyScale();
+    result.plane = request->getPlaneDesc();
+    result.hash = hash;
+    result.requestedScaleImage = requestedScaleImage;
+    result.fullScaleImage = fullScaleImage;
+    results.push_back(result);
+} // setSharedResult
+
+bool
+TreeRenderBatch::isSharedImage(const ImagePtr& image) const
+{
+    if (!image) {
+        return false;
+    }
+    QMutexLocker k(&_imp->sharedResultsMutex);
+    for (std::map<NodePtr, SharedResultsList>::const_iterator it = _imp->sharedResults.begin(); it != _imp->sharedResults.end(); ++it) {
+        for (SharedResultsList::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            if (it2->requestedScaleImage == image || it2->fullScaleImage == image) {
+                return true;
+            }
+        }
+    }
+    return false;
+} // isSharedImage
+
+int
+TreeRenderBatch::getNumSharedResultsReused() const
+{
+#if QT_VERSION < 0x050000
+    return (int)_imp->nSharedResultsReused;
+#else
+    return _imp->nSharedResultsReused.loadAcquire();
+#endif
+}
+
+NATRON_NAMESPACE_EXIT
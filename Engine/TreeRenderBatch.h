@@ -0,0 +1,120 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_TREERENDERBATCH_H
+#define NATRON_ENGINE_TREERENDERBATCH_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/TimeValue.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+
+/**
+ * @brief Shares the results of the time-invariant parts of a tree across all the TreeRenders of a frame range.
+ *
+ * The tree is analysed once when the batch is created: a node is time-invariant if it is not frame varying,
+ * has no animation and all its inputs are time-invariant. The time-invariant nodes feeding a time-variant node
+ * are the roots of the subgraphs that produce the same image at every frame of the range.
+ *
+ * The first render of the range that produces the image of such a root gives it to the batch. Subsequent renders
+ * reuse that image directly: their request of the root is marked rendered without looking-up the cache and without
+ * visiting the subgraph upstream, so that only the time-variant parts of the tree are rendered for each frame.
+ * An image is only reused if the hash of the root at the frame matches the one it was rendered with and if it
+ * covers the region requested, otherwise the root is rendered normally.
+ **/
+struct TreeRenderBatchPrivate;
+class TreeRenderBatch
+{
+    // used by boost::make_shared
+    struct MakeSharedEnabler;
+
+    TreeRenderBatch(TimeValue firstFrame, TimeValue lastFrame);
+
+public:
+
+    /**
+     * @brief Analyses the tree upstream of the given effect for the frame range [firstFrame, lastFrame].
+     * Returns NULL if the tree has no time-invariant subgraph to share.
+     **/
+    static TreeRenderBatchPtr create(const EffectInstancePtr& treeRoot, TimeValue firstFrame, TimeValue lastFrame);
+
+    ~TreeRenderBatch();
+
+    TimeValue getFirstFrame() const;
+
+    TimeValue getLastFrame() const;
+
+    /**
+     * @brief Returns the number of time-invariant subgraphs found in the tree
+     **/
+    int getNumTimeInvariantSubgraphs() const;
+
+    /**
+     * @brief Returns true if the given node is the root of a time-invariant subgraph
+     **/
+    bool isTimeInvariantSubgraphRoot(const NodePtr& node) const;
+
+    /**
+     * @brief If a previous render of the batch produced the image of the given request and that image covers
+     * the given pixel RoI (at the mipmap level of the request), set it on the request and return true.
+     * @param renderClone The render clone of the root for the frame/view of the request
+     **/
+    bool getSharedResult(const EffectInstancePtr& renderClone,
+                         const FrameViewRequestPtr& request,
+                         const RectI& roiPixels) const;
+
+    /**
+     * @brief Gives the image of the given rendered request to the batch so that subsequent renders of the range may reuse it.
+     **/
+    void setSharedResult(const EffectInstancePtr& renderClone,
+                         const FrameViewRequestPtr& request);
+
+    /**
+     * @brief Returns true if the given image is held by the batch. Such an image is read by multiple renders
+     * concurrently and must never be modified.
+     **/
+    bool isSharedImage(const ImagePtr& image) const;
+
+    /**
+     * @brief Returns how many requests reused an image of the batch instead of being rendered
+     **/
+    int getNumSharedResultsReused() const;
+
+private:
+
+    boost::scoped_ptr<TreeRenderBatchPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_TREERENDERBATCH_H
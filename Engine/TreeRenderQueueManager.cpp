@@ -27,9 +27,12 @@
 
 #include "TreeRenderQueueManager.h"
 
+#include <algorithm>
+
 #include <QMutex>
 #include <QWaitCondition>
 #include <QThreadPool>
+#include <QAtomicInt>
 
 #include <QtConcurrentRun>
 
@@ -38,8 +41,16 @@
 #endif
 #include "Engine/AppManager.h"
 #include "Engine/FrameViewRequest.h"
+#include "Engine/ImageStorage.h"
+#include "Engine/RenderStats.h"
+#include "Engine/Timer.h"
 #include "Engine/TreeRender.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/ThreadPoolMonitor.h"
+
+// Renders waiting for tiles pending in another process are not notified when they are rendered: the manager thread
+// launches them again after this delay
+#define NATRON_PENDING_TILES_POLL_INTERVAL_MS 40
 
 NATRON_NAMESPACE_ENTER;
 
@@ -69,22 +80,39 @@ typedef boost::shared_ptr<PerProviderRenders> PerProviderRendersPtr;
 
 typedef std::map<TreeRenderQueueProviderConstWPtr, PerProviderRendersPtr> PerProviderRendersMap;
 
+struct ParkedRequest
+{
+    TreeRenderExecutionDataPtr execution;
+    FrameViewRequestPtr request;
+
+    // The time at which the request was parked, relative to the creation of the manager
+    double parkTime;
+};
+
+// The requests waiting for pending tiles, keyed by the hash of the cache entry
+typedef std::multimap<U64, ParkedRequest> ParkedRequestsMap;
+
 class LaunchRenderRunnable : public QRunnable
 {
     TreeRenderPtr render;
     TreeRenderQueueManager::Implementation* imp;
 
+    // When the runnable was handed to the thread pool, negative if it is not monitored
+    double queueTime;
+
 public:
 
     LaunchRenderRunnable(const TreeRenderPtr& render, TreeRenderQueueManager::Implementation* imp)
     : render(render)
     , imp(imp)
+    , queueTime( ThreadPoolMonitor::onTaskQueued() )
     {
 
     }
 
     virtual ~LaunchRenderRunnable() {
-
+        // The runnable was queued but never run
+        ThreadPoolMonitor::onTaskDropped(queueTime);
     }
 
 private:
@@ -130,6 +158,31 @@ struct TreeRenderQueueManager::Implementation
     // True when somebody called quitThread()
     bool mustQuit;
 
+    // The number of executions in the executionQueue for each priority class. This is read by the workers at the end of
+    // each task without taking executionQueueMutex.
+    QAtomicInt numQueuedExecutions[eTreeRenderPriorityCount];
+
+    // Protects latencyStats and totalLatency
+    mutable QMutex latencyStatsMutex;
+    TreeRenderQueueManager::RenderLatencyStats latencyStats[eTreeRenderPriorityCount];
+    double totalLatency[eTreeRenderPriorityCount];
+
+    // Protected by latencyStatsMutex
+    TreeRenderQueueManager::AbortLatencyStats abortLatencyStats;
+    double totalAbortLatency;
+
+    // Protects parkedRequests
+    QMutex parkedRequestsMutex;
+
+    // The renders that returned eActionStatusPendingTiles, waiting for other threads or processes to render the pending tiles
+    ParkedRequestsMap parkedRequests;
+
+    // The number of parked requests. This is read without taking parkedRequestsMutex each time tiles are marked rendered.
+    QAtomicInt numParkedRequests;
+
+    // Gives the park time of the requests
+    TimeLapse parkedRequestsClock;
+
     Implementation(TreeRenderQueueManager* publicInterface)
     : _publicInterface(publicInterface)
     , executionQueueMutex()
@@ -142,8 +195,18 @@ struct TreeRenderQueueManager::Implementation
     , mustQuitMutex()
     , mustQuitCond()
     , mustQuit(false)
+    , latencyStatsMutex()
+    , abortLatencyStats()
+    , totalAbortLatency(0.)
+    , parkedRequestsMutex()
+    , parkedRequests()
+    , numParkedRequests()
+    , parkedRequestsClock()
     {
-
+        for (int i = 0; i < eTreeRenderPriorityCount; ++i) {
+            numQueuedExecutions[i].fetchAndStoreOrdered(0);
+            totalLatency[i] = 0.;
+        }
     }
 
     /**
@@ -176,6 +239,19 @@ struct TreeRenderQueueManager::Implementation
     void notifyManagerThreadForModifications();
 
     void notifyManagerThreadForModifications_nolock();
+
+    bool hasParkedRequests() const;
+
+    /**
+     * @brief Puts the given parked requests back in the queue of their execution and wakes up the manager thread
+     **/
+    void resumeParkedRequests(const std::list<ParkedRequest>& requests);
+
+    /**
+     * @brief Resumes the requests that are parked for more than NATRON_PENDING_TILES_POLL_INTERVAL_MS, in case the tiles
+     * they wait for are rendered by another process.
+     **/
+    void resumeExpiredParkedRequests();
 };
 
 
@@ -267,6 +343,7 @@ TreeRenderQueueManager::releaseTask()
 {
     if (isRunningInThreadPoolThread()) {
         QThreadPool::globalInstance()->releaseThread();
+        ThreadPoolMonitor::onThreadReleased();
 
         // We are making a thread available, notify the manager which may be able to load more renders.
         _imp->notifyManagerThreadForModifications();
@@ -278,6 +355,7 @@ void
 TreeRenderQueueManager::reserveTask()
 {
     if (isRunningInThreadPoolThread()) {
+        ThreadPoolMonitor::onThreadReserved();
         QThreadPool::globalInstance()->reserveThread();
     }
 }
@@ -516,6 +594,7 @@ TreeRenderQueueManager::Implementation::appendTreeRenderExecution(const TreeRend
     {
         QMutexLocker k(&executionQueueMutex);
         executionQueue.push_back(render);
+        numQueuedExecutions[render->getTreeRender()->getPriority()].fetchAndAddOrdered(1);
 
         if (!_publicInterface->isRunning()) {
             _publicInterface->start();
@@ -570,10 +649,50 @@ TreeRenderQueueManager::Implementation::onTaskRenderFinished(const TreeRenderExe
             // The execution may no longer be in the exeuction queue if it has a failed status because in that case we did not exit early
             // in the if condition at the start of the function.
             executionQueue.erase(found);
+            numQueuedExecutions[render->getTreeRender()->getPriority()].fetchAndAddOrdered(-1);
         }
         notifyManagerThreadForModifications_nolock();
     }
 
+    if (render->isTreeMainExecution()) {
+        TreeRenderPtr treeRender = render->getTreeRender();
+        const TreeRenderPriorityEnum priority = treeRender->getPriority();
+        const double latency = treeRender->getTimeSinceCreation();
+        QMutexLocker k(&latencyStatsMutex);
+        RenderLatencyStats& stats = latencyStats[priority];
+        totalLatency[priority] += latency;
+        ++stats.nRenders;
+        stats.averageLatency = totalLatency[priority] / stats.nRenders;
+        stats.maxLatency = std::max(stats.maxLatency, latency);
+    }
+
+    if (render->isTreeMainExecution()) {
+        TreeRenderPtr treeRender = render->getTreeRender();
+        if (treeRender->isRenderAborted()) {
+            // The render is idle: measure how long it took to react to the abort
+            const double abortLatency = treeRender->getTimeSinceAbort();
+            RenderStatsPtr renderStats = treeRender->getStatsObject();
+            if (renderStats) {
+                renderStats->setAbortLatency(abortLatency);
+            }
+            QMutexLocker k(&latencyStatsMutex);
+            totalAbortLatency += abortLatency;
+            ++abortLatencyStats.nAbortedRenders;
+            abortLatencyStats.averageLatency = totalAbortLatency / abortLatencyStats.nAbortedRenders;
+            abortLatencyStats.maxLatency = std::max(abortLatencyStats.maxLatency, abortLatency);
+            abortLatencyStats.lastLatency = abortLatency;
+        }
+
+        // Record how much memory was allocated at most by the nodes for this render
+        RenderStatsPtr renderStats = treeRender->getStatsObject();
+        if (renderStats) {
+            MemoryBudgetPtr budget = treeRender->getMemoryBudget();
+            if (budget) {
+                renderStats->setMemoryPeak( budget->getPeakAllocatedBytes(eStorageModeRAM), budget->getPeakAllocatedBytes(eStorageModeGLTex) );
+            }
+        }
+    }
+
 
     if (render->isTreeMainExecution()) {
         TreeRenderPtr treeRender = render->getTreeRender();
@@ -629,6 +748,85 @@ TreeRenderQueueManager::notifyTaskInRenderFinished(const TreeRenderExecutionData
     
 } // notifyTaskInRenderFinished
 
+void
+TreeRenderQueueManager::parkRequestOnPendingTiles(const TreeRenderExecutionDataPtr& render,
+                                                  const FrameViewRequestPtr& request,
+                                                  U64 entryHash)
+{
+    ParkedRequest parked;
+    parked.execution = render;
+    parked.request = request;
+    QMutexLocker k(&_imp->parkedRequestsMutex);
+    parked.parkTime = _imp->parkedRequestsClock.getTimeSinceCreation();
+    _imp->parkedRequests.insert( std::make_pair(entryHash, parked) );
+    _imp->numParkedRequests.fetchAndAddOrdered(1);
+} // parkRequestOnPendingTiles
+
+void
+TreeRenderQueueManager::notifyPendingTilesRendered(U64 entryHash)
+{
+    if ( !_imp->hasParkedRequests() ) {
+        return;
+    }
+    std::list<ParkedRequest> requests;
+    {
+        QMutexLocker k(&_imp->parkedRequestsMutex);
+        std::pair<ParkedRequestsMap::iterator, ParkedRequestsMap::iterator> range = _imp->parkedRequests.equal_range(entryHash);
+        for (ParkedRequestsMap::iterator it = range.first; it != range.second; ++it) {
+            requests.push_back(it->second);
+        }
+        _imp->parkedRequests.erase(range.first, range.second);
+        _imp->numParkedRequests.fetchAndAddOrdered( -(int)requests.size() );
+    }
+    _imp->resumeParkedRequests(requests);
+} // notifyPendingTilesRendered
+
+bool
+TreeRenderQueueManager::Implementation::hasParkedRequests() const
+{
+#if QT_VERSION < 0x050000
+    return (int)numParkedRequests > 0;
+#else
+    return numParkedRequests.loadAcquire() > 0;
+#endif
+}
+
+void
+TreeRenderQueueManager::Implementation::resumeParkedRequests(const std::list<ParkedRequest>& requests)
+{
+    if ( requests.empty() ) {
+        return;
+    }
+    for (std::list<ParkedRequest>::const_iterator it = requests.begin(); it != requests.end(); ++it) {
+        it->execution->addTaskToRender(it->request);
+    }
+    notifyManagerThreadForModifications();
+}
+
+void
+TreeRenderQueueManager::Implementation::resumeExpiredParkedRequests()
+{
+    if ( !hasParkedRequests() ) {
+        return;
+    }
+    std::list<ParkedRequest> requests;
+    {
+        QMutexLocker k(&parkedRequestsMutex);
+        const double expiredParkTime = parkedRequestsClock.getTimeSinceCreation() - NATRON_PENDING_TILES_POLL_INTERVAL_MS / 1000.;
+        ParkedRequestsMap::iterator it = parkedRequests.begin();
+        while ( it != parkedRequests.end() ) {
+            if (it->second.parkTime <= expiredParkTime) {
+                requests.push_back(it->second);
+                parkedRequests.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+        numParkedRequests.fetchAndAddOrdered( -(int)requests.size() );
+    }
+    resumeParkedRequests(requests);
+}
+
 void
 TreeRenderQueueManager::quitThread()
 {
@@ -666,8 +864,19 @@ TreeRenderQueueManager::Implementation::launchMoreTasks()
         // We are checking the queue now on the manager thread, refresh the activity check count to 0.
         activityCheckCount = 0;
 
+        // Order the executions by priority class, keeping the request order within a class, so that the renders
+        // of a class only get the threads that are left over by the renders of the higher classes.
+        std::list<TreeRenderExecutionDataWPtr> perClassQueues[eTreeRenderPriorityCount];
         for (std::list<TreeRenderExecutionDataPtr>::iterator it = executionQueue.begin(); it != executionQueue.end(); ++it) {
-            queue.push_back(*it);
+            TreeRenderPtr render;
+            if (*it) {
+                render = (*it)->getTreeRender();
+            }
+            TreeRenderPriorityEnum priority = render ? render->getPriority() : eTreeRenderPriorityInteractive;
+            perClassQueues[priority].push_back(*it);
+        }
+        for (int i = 0; i < eTreeRenderPriorityCount; ++i) {
+            queue.splice(queue.end(), perClassQueues[i]);
         }
     }
 
@@ -700,12 +909,49 @@ TreeRenderQueueManager::Implementation::launchMoreTasks()
     const int maxParallelTasks = QThreadPool::globalInstance()->maxThreadCount();
     const int maxTasksToLaunch = std::max(1, maxParallelTasks  - QThreadPool::globalInstance()->activeThreadCount());
 
-    // Start as many concurrent renders as we can on the first task: this is the oldest task that was requested by the user
-    int nTasksLaunched = firstRenderExecution->executeAvailableTasks(-1);
-
     // A TreeRender may not allow rendering of concurrent TreeRenders (e.g: when drawing, to ensure renders are processed in order)
     const bool allowConcurrentRenders = firstRenderTree->isConcurrentRendersAllowed();
 
+    // The executions of the renders of the same group as the first render, e.g: the A and B inputs of the viewer,
+    // are launched as if they were part of the first render
+    std::list<TreeRenderExecutionDataPtr> groupExecutions;
+    const U64 renderGroup = firstRenderTree->getRenderGroup();
+    if (allowConcurrentRenders && renderGroup != 0) {
+        std::list<TreeRenderExecutionDataWPtr>::iterator it = queue.begin();
+        ++it; // skip the first execution
+        for (; it != queue.end(); ++it) {
+            TreeRenderExecutionDataPtr renderExecution = it->lock();
+            if (!renderExecution) {
+                continue;
+            }
+            TreeRenderPtr renderTree = renderExecution->getTreeRender();
+            if ( renderTree && (renderTree != firstRenderTree) && (renderTree->getRenderGroup() == renderGroup) ) {
+                groupExecutions.push_back(renderExecution);
+            }
+        }
+    }
+
+    // Start as many concurrent renders as we can on the first task: this is the oldest task of the highest class.
+    // If only previews or cache warming renders are queued, keep a thread available for a render that the user might request.
+    int firstRenderMaxTasks = -1;
+    if (firstRenderTree->getPriority() >= eTreeRenderPriorityPreview) {
+        firstRenderMaxTasks = std::max(1, maxTasksToLaunch - 1);
+    }
+    int nTasksLaunched;
+    if ( groupExecutions.empty() ) {
+        nTasksLaunched = firstRenderExecution->executeAvailableTasks(firstRenderMaxTasks);
+    } else {
+        // Share the threads evenly between the renders of the group: a render that has less tasks available than its share
+        // leaves the remaining threads to the next ones
+        const int maxGroupTasks = firstRenderMaxTasks == -1 ? maxTasksToLaunch : firstRenderMaxTasks;
+        int nRendersLeft = (int)groupExecutions.size() + 1;
+        nTasksLaunched = firstRenderExecution->executeAvailableTasks( std::max(1, maxGroupTasks / nRendersLeft) );
+        for (std::list<TreeRenderExecutionDataPtr>::const_iterator it = groupExecutions.begin(); it != groupExecutions.end(); ++it) {
+            --nRendersLeft;
+            nTasksLaunched += (*it)->executeAvailableTasks( std::max(1, (maxGroupTasks - nTasksLaunched) / nRendersLeft) );
+        }
+    }
+
 
     // If we've got remaining threads, cycle through other execution trees in the queue to launch other tasks
     // until we reach the max threads count
@@ -725,6 +971,10 @@ TreeRenderQueueManager::Implementation::launchMoreTasks()
             // This tree render may not allow concurrent executions.
             continue;
         }
+        if ( std::find(groupExecutions.begin(), groupExecutions.end(), renderExecution) != groupExecutions.end() ) {
+            // Already launched with the first render
+            continue;
+        }
 
 
         // Launch tasks in non priority render. Launch at most 1 parallel task in these render to let a chance to the first render in the queue
@@ -738,14 +988,19 @@ TreeRenderQueueManager::Implementation::launchMoreTasks()
     // If we still have threads idle and the last request is playback, fetch more renders for that provider
     if (allowConcurrentRenders && firstRenderTree->isPlayback() && !provider->isWaitingForAllTreeRenders() && nTasksLaunched < maxTasksToLaunch) {
 
-        // If more than maxThreadsCount renders are finished or launched, do not launch more for this provider
+        // If more than maxThreadsCount renders are finished or launched, do not launch more for this provider,
+        // unless the provider controls how many renders it keeps in flight
+        int maxProviderRenders = provider->getMaxConcurrentRenders();
+        if (maxProviderRenders <= 0) {
+            maxProviderRenders = maxParallelTasks;
+        }
         bool providerMaxQueueReached = true;
         {
             QMutexLocker k(&perProviderRendersMutex);
             PerProviderRendersMap::iterator foundProvider = perProviderRenders.find(provider);
             // The provider may no longer be in the queue, because the executionQueue might be already empty since we made a copy of it.
             if (foundProvider != perProviderRenders.end()) {
-                providerMaxQueueReached = ((int)foundProvider->second->finishedRenders.size() >= maxParallelTasks || (int)foundProvider->second->queuedRenders.size() >= maxParallelTasks);
+                providerMaxQueueReached = ((int)foundProvider->second->finishedRenders.size() >= maxProviderRenders || (int)foundProvider->second->queuedRenders.size() >= maxProviderRenders);
             }
         }
 
@@ -767,6 +1022,9 @@ LaunchRenderRunnable::run()
                                                            boost_adaptbx::floating_point::exception_trapping::invalid |
                                                            boost_adaptbx::floating_point::exception_trapping::overflow);
 #endif
+    double monitorStartTime = ThreadPoolMonitor::onTaskStarted(queueTime);
+    queueTime = -1.;
+
     TreeRenderExecutionDataPtr execData = render->createMainExecutionData();
 
     if (isFailureRetCode(execData->getStatus())) {
@@ -778,6 +1036,8 @@ LaunchRenderRunnable::run()
         // Notify the manager thread there may be tasks to render in the queue
         imp->notifyManagerThreadForModifications();
     }
+
+    ThreadPoolMonitor::onTaskFinished(monitorStartTime);
 }
 
 void
@@ -806,15 +1066,64 @@ TreeRenderQueueManager::run()
         // Launch tasks if possible
         _imp->launchMoreTasks();
 
+        // Relaunch the renders that are waiting for too long for pending tiles, in case nobody in this process will notify them
+        _imp->resumeExpiredParkedRequests();
         
         // Try to sleep
         QMutexLocker k(&_imp->executionQueueMutex);
         while (_imp->canSleep()) {
-            _imp->activityChangedCond.wait(&_imp->executionQueueMutex);
+            if ( _imp->hasParkedRequests() ) {
+                // Wake up to poll the parked renders
+                if ( !_imp->activityChangedCond.wait(&_imp->executionQueueMutex, NATRON_PENDING_TILES_POLL_INTERVAL_MS) ) {
+                    break;
+                }
+            } else {
+                _imp->activityChangedCond.wait(&_imp->executionQueueMutex);
+            }
         }
     } // for(;;)
 } // run
 
+bool
+TreeRenderQueueManager::isHigherPriorityRenderQueued(TreeRenderPriorityEnum priority) const
+{
+    for (int i = 0; i < (int)priority; ++i) {
+#if QT_VERSION < 0x050000
+        if ( (int)_imp->numQueuedExecutions[i] > 0 ) {
+#else
+        if ( _imp->numQueuedExecutions[i].loadAcquire() > 0 ) {
+#endif
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+TreeRenderQueueManager::getRenderLatencyStats(TreeRenderPriorityEnum priority,
+                                              RenderLatencyStats* stats) const
+{
+    assert(priority >= 0 && priority < eTreeRenderPriorityCount);
+    QMutexLocker k(&_imp->latencyStatsMutex);
+    *stats = _imp->latencyStats[priority];
+}
+
+void
+TreeRenderQueueManager::getAbortLatencyStats(AbortLatencyStats* stats) const
+{
+    QMutexLocker k(&_imp->latencyStatsMutex);
+    *stats = _imp->abortLatencyStats;
+}
+
+void
+TreeRenderQueueManager::resetAbortLatencyStats()
+{
+    QMutexLocker k(&_imp->latencyStatsMutex);
+    _imp->abortLatencyStats = AbortLatencyStats();
+    _imp->totalAbortLatency = 0.;
+}
+
 bool
 TreeRenderQueueManager::Implementation::canSleep() const
 {
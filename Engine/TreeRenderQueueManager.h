@@ -69,6 +69,61 @@ public:
      **/
     void getRenderIndex(const TreeRenderPtr& render, int* index, int* numRenders) const;
 
+    /**
+     * @brief Returns true if an execution of a render of a higher priority class than the given one is in the queue.
+     * The workers of lower priority renders check this at the end of each task to give their thread back.
+     * This does not take any lock.
+     **/
+    bool isHigherPriorityRenderQueued(TreeRenderPriorityEnum priority) const;
+
+    struct RenderLatencyStats
+    {
+        // The number of renders of the class that finished
+        int nRenders;
+
+        // The average and maximum time in seconds between the creation of a render and the end of its main execution
+        double averageLatency;
+        double maxLatency;
+
+        RenderLatencyStats()
+        : nRenders(0)
+        , averageLatency(0.)
+        , maxLatency(0.)
+        {
+        }
+    };
+
+    /**
+     * @brief Returns the latency of the renders of the given priority class that finished since the application started
+     **/
+    void getRenderLatencyStats(TreeRenderPriorityEnum priority, RenderLatencyStats* stats) const;
+
+    struct AbortLatencyStats
+    {
+        // The number of aborted renders that finished
+        int nAbortedRenders;
+
+        // The average, maximum and last time in seconds between the abort of a render and the end of its main execution
+        double averageLatency;
+        double maxLatency;
+        double lastLatency;
+
+        AbortLatencyStats()
+        : nAbortedRenders(0)
+        , averageLatency(0.)
+        , maxLatency(0.)
+        , lastLatency(0.)
+        {
+        }
+    };
+
+    /**
+     * @brief Returns how fast the aborted renders reacted to the abort since the application started or since
+     * resetAbortLatencyStats() was called. This is also recorded on the RenderStats of each aborted render.
+     **/
+    void getAbortLatencyStats(AbortLatencyStats* stats) const;
+    void resetAbortLatencyStats();
+
 private:
 
 
@@ -122,6 +177,12 @@ private:
      **/
     void reserveTask();
 
+    /**
+     * @brief Called when the tiles of the cache entry with the given hash that were pending are marked rendered or aborted.
+     * The renders that returned eActionStatusPendingTiles while waiting for them are put back in the queue of their execution.
+     **/
+    void notifyPendingTilesRendered(U64 entryHash);
+
 private:
 
     virtual void run() OVERRIDE FINAL;
@@ -132,6 +193,12 @@ private:
      **/
     void notifyTaskInRenderFinished(const TreeRenderExecutionDataPtr& render, bool isExecutionFinished, bool isRunningInThreadPoolThread);
 
+    /**
+     * @brief Executed on a thread-pool thread when a FrameViewRenderRunnable returned eActionStatusPendingTiles for the given request:
+     * the request is put back in the queue of its execution when the tiles pending in the cache entry with the given hash are rendered.
+     **/
+    void parkRequestOnPendingTiles(const TreeRenderExecutionDataPtr& render, const FrameViewRequestPtr& request, U64 entryHash);
+
     friend class TreeRenderExecutionData;
     friend struct TreeRenderExecutionDataPrivate;
     friend class ReleaseTPThread_RAII;
@@ -42,6 +42,31 @@
 
 NATRON_NAMESPACE_ENTER;
 
+/**
+ * @brief The priority classes of the renders, from the highest to the lowest.
+ * The TreeRenderQueueManager gives the threads to the renders of the highest class first, and the
+ * renders of a lower class give their thread back at the end of a task whenever a render of a higher class is queued.
+ **/
+enum TreeRenderPriorityEnum
+{
+    // Renders of the viewer following a user interaction, e.g: dragging a slider
+    eTreeRenderPriorityInteractive = 0,
+
+    // Viewer playback
+    eTreeRenderPriorityPlayback,
+
+    // Renders of Writers on disk
+    eTreeRenderPriorityBackgroundWrite,
+
+    // Node previews and histograms
+    eTreeRenderPriorityPreview,
+
+    // Renders warming up the cache ahead of the playhead
+    eTreeRenderPriorityCacheWarming,
+
+    eTreeRenderPriorityCount
+};
+
 /**
  * @brief Common interface shared between TreeRenderQueueProvider and TreeRenderQueueManager
  * for launching renders. This exists so that the user is only tempted to call functions on the 
@@ -126,6 +151,25 @@ public:
     bool isWaitingForAllTreeRenders() const;
     ///
 
+    /**
+     * @brief Returns the priority class of the renders launched by this provider.
+     * A TreeRender may lower it further with TreeRender::CtorArgs::priority.
+     **/
+    virtual TreeRenderPriorityEnum getRenderPriority() const
+    {
+        return eTreeRenderPriorityInteractive;
+    }
+
+    /**
+     * @brief Returns the maximum number of renders of this provider that may be launched or finished but not
+     * yet waited for before requestMoreRenders() stops being called, or 0 to use the number of threads of the thread pool.
+     * This is called on the TreeRenderQueueManager thread.
+     **/
+    virtual int getMaxConcurrentRenders() const
+    {
+        return 0;
+    }
+
 protected:
 
     /**
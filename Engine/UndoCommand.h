@@ -28,6 +28,7 @@
 
 #include "Global/Macros.h"
 
+#include <cstddef> // std::size_t
 #include <string>
 
 #include "Engine/EngineFwd.h"
@@ -76,6 +77,15 @@ public:
     {
         return false;
     }
+
+    /**
+     * @brief Returns an estimate of the memory held by this action in bytes, this is used to bound
+     * the memory taken by the undo/redo stacks.
+     **/
+    virtual std::size_t getMemorySize() const
+    {
+        return sizeof(UndoCommand) + _text.size();
+    }
 };
 
 NATRON_NAMESPACE_EXIT
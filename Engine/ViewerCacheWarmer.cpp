@@ -0,0 +1,293 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ViewerCacheWarmer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QMutex>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/Node.h"
+#include "Engine/OutputSchedulerThread.h"
+#include "Engine/RenderEngine.h"
+#include "Engine/ViewerDisplayScheduler.h"
+#include "Engine/ViewerNode.h"
+
+// How many seconds of playback are rendered ahead of the playhead
+#define NATRON_CACHE_WARMING_LOOKAHEAD_SECONDS 2.
+
+NATRON_NAMESPACE_ENTER
+
+class ViewerCacheWarmerStartArgs : public GenericThreadStartArgs
+{
+public:
+
+    ViewerCacheWarmerStartArgs()
+    : GenericThreadStartArgs()
+    , startTime(0)
+    , direction(eRenderDirectionForward)
+    , fps(24.)
+    , viewsToRender()
+    {
+
+    }
+
+    virtual ~ViewerCacheWarmerStartArgs()
+    {
+
+    }
+
+    TimeValue startTime;
+    RenderDirectionEnum direction;
+    double fps;
+    std::vector<ViewIdx> viewsToRender;
+};
+
+struct ViewerCacheWarmerPrivate
+{
+    RenderEngineWPtr renderEngine;
+    NodeWPtr viewer;
+
+    // Protects currentRender
+    mutable QMutex currentRenderMutex;
+
+    // The frame being warmed, if any
+    RenderFrameResultsContainerPtr currentRender;
+
+    ViewerCacheWarmerPrivate(const RenderEnginePtr& renderEngine, const NodePtr& viewer)
+    : renderEngine(renderEngine)
+    , viewer(viewer)
+    , currentRenderMutex()
+    , currentRender()
+    {
+
+    }
+
+    /**
+     * @brief Returns the frame following frame in the playback direction, honoring the playback mode
+     * of the engine. Returns false if there's no such frame.
+     **/
+    bool getNextFrame(TimeValue first, TimeValue last, PlaybackModeEnum pbMode, TimeValue* frame, RenderDirectionEnum* direction) const;
+};
+
+ViewerCacheWarmer::ViewerCacheWarmer(const RenderEnginePtr& renderEngine, const NodePtr& viewer)
+: _imp( new ViewerCacheWarmerPrivate(renderEngine, viewer) )
+{
+
+}
+
+ViewerCacheWarmer::~ViewerCacheWarmer()
+{
+
+}
+
+void
+ViewerCacheWarmer::warmCache(TimeValue startTime,
+                             RenderDirectionEnum direction,
+                             double fps,
+                             const std::vector<ViewIdx>& viewsToRender)
+{
+    if ( (fps <= 0) || viewsToRender.empty() ) {
+        return;
+    }
+
+    boost::shared_ptr<ViewerCacheWarmerStartArgs> args = boost::make_shared<ViewerCacheWarmerStartArgs>();
+    args->startTime = startTime;
+    args->direction = direction;
+    args->fps = fps;
+    args->viewsToRender = viewsToRender;
+
+    // Frames ahead of an older playhead position are not interesting anymore
+    abortThreadedTask(false);
+    startTask(args);
+}
+
+bool
+ViewerCacheWarmer::hasThreadsAlive() const
+{
+    QMutexLocker k(&_imp->currentRenderMutex);
+    return (bool)_imp->currentRender;
+}
+
+void
+ViewerCacheWarmer::onAbortRequested(bool /*keepOldestRender*/)
+{
+    RenderFrameResultsContainerPtr render;
+    {
+        QMutexLocker k(&_imp->currentRenderMutex);
+        render = _imp->currentRender;
+    }
+    if (render) {
+        render->abortRenders();
+    }
+}
+
+void
+ViewerCacheWarmer::onWaitForThreadToQuit()
+{
+    waitForAllTreeRenders();
+}
+
+void
+ViewerCacheWarmer::onWaitForAbortCompleted()
+{
+    waitForAllTreeRenders();
+}
+
+bool
+ViewerCacheWarmerPrivate::getNextFrame(TimeValue first,
+                                       TimeValue last,
+                                       PlaybackModeEnum pbMode,
+                                       TimeValue* frame,
+                                       RenderDirectionEnum* direction) const
+{
+    if (first >= last) {
+        return false;
+    }
+    double next = *direction == eRenderDirectionForward ? *frame + 1 : *frame - 1;
+    if ( (next >= first) && (next <= last) ) {
+        *frame = TimeValue(next);
+        return true;
+    }
+    switch (pbMode) {
+        case ePlaybackModeLoop:
+            *frame = *direction == eRenderDirectionForward ? first : last;
+            return true;
+        case ePlaybackModeBounce:
+            *direction = *direction == eRenderDirectionForward ? eRenderDirectionBackward : eRenderDirectionForward;
+            *frame = TimeValue(*direction == eRenderDirectionForward ? *frame + 1 : *frame - 1);
+            return true;
+        case ePlaybackModeOnce:
+        default:
+            return false;
+    }
+} // getNextFrame
+
+GenericSchedulerThread::ThreadStateEnum
+ViewerCacheWarmer::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
+{
+    ViewerCacheWarmerStartArgs* args = dynamic_cast<ViewerCacheWarmerStartArgs*>(inArgs.get());
+    assert(args);
+
+    NodePtr viewerNode = _imp->viewer.lock();
+    RenderEnginePtr engine = _imp->renderEngine.lock();
+    CacheBasePtr cache = appPTR->getTileCache();
+    if (!viewerNode || !engine || !cache) {
+        return resolveState();
+    }
+    ViewerNodePtr viewer = viewerNode->isEffectViewerNode();
+    if (!viewer) {
+        return resolveState();
+    }
+
+    // Same frame range as the one used by the ViewerDisplayScheduler for playback
+    TimeValue first, last;
+    {
+        ViewerNodePtr leadViewer = viewer->getApp()->getLastViewerUsingTimeline();
+        int left, right;
+        (leadViewer ? leadViewer : viewer)->getTimelineBounds(&left, &right);
+        first = TimeValue(left);
+        last = TimeValue(right);
+    }
+    const PlaybackModeEnum pbMode = engine->getPlaybackMode();
+    const int nFramesAhead = std::min( (int)std::ceil(args->fps * NATRON_CACHE_WARMING_LOOKAHEAD_SECONDS), (int)(last - first) );
+
+    TimeValue frame = args->startTime;
+    RenderDirectionEnum direction = args->direction;
+
+    // The amount of memory taken in the Cache by the last frame that was not cached yet
+    std::size_t lastFrameCost = 0;
+
+    for (int i = 0; i < nFramesAhead; ++i) {
+
+        ThreadStateEnum state = resolveState();
+        if (state != eThreadStateActive) {
+            return state;
+        }
+
+        if ( !_imp->getNextFrame(first, last, pbMode, &frame, &direction) ) {
+            break;
+        }
+
+        // Only warm the Cache with what it can hold without evicting anything: evicting frames to make room
+        // for other frames ahead would defeat the purpose.
+        const std::size_t maxSize = cache->getMaximumCacheSize();
+        const std::size_t sizeBefore = cache->getCurrentSize();
+        const std::size_t freeBudget = maxSize > sizeBefore ? maxSize - sizeBefore : 0;
+        if ( (freeBudget == 0) || (freeBudget <= lastFrameCost) ) {
+            break;
+        }
+
+        RenderFrameResultsContainerPtr results;
+        ActionRetCodeEnum stat = ViewerDisplayScheduler::createFrameRenderResultsGeneric(viewer, shared_from_this(), frame, false /*isPlayback*/, RotoStrokeItemPtr(), args->viewsToRender, false /*enableRenderStats*/, 0 /*minMipMapLevel*/, &results);
+        if ( isFailureRetCode(stat) ) {
+            break;
+        }
+
+        {
+            QMutexLocker k(&_imp->currentRenderMutex);
+            _imp->currentRender = results;
+        }
+
+        results->launchRenders();
+
+        // An abort may have been requested before the render was registered
+        if ( isBeingAborted() ) {
+            results->abortRenders();
+        }
+
+        stat = results->waitForRendersFinished();
+
+        {
+            QMutexLocker k(&_imp->currentRenderMutex);
+            _imp->currentRender.reset();
+        }
+
+        if ( isFailureRetCode(stat) ) {
+            break;
+        }
+
+        // The frame is display-ready: playback will not have to render it at all
+        ViewerDisplayScheduler::addFrameToPlaybackBuffer(viewer, engine->getPlaybackFrameBuffer(), results);
+
+        // If the frame was already cached, the size does not change: keep the cost of the last frame actually rendered
+        const std::size_t sizeAfter = cache->getCurrentSize();
+        if (sizeAfter > sizeBefore) {
+            lastFrameCost = sizeAfter - sizeBefore;
+        }
+    }
+
+    return resolveState();
+} // threadLoopOnce
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,115 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_VIEWERCACHEWARMER_H
+#define NATRON_ENGINE_VIEWERCACHEWARMER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+#include "Engine/GenericSchedulerThread.h"
+#include "Engine/TimeValue.h"
+#include "Engine/TreeRenderQueueProvider.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Renders the frames that are ahead of the playhead of a viewer while it is idle so that they are in the Cache
+ * when playback starts: the first pass of the playback can then run at real-time speed.
+ *
+ * Frames are rendered one after the other in the playback direction, for up to NATRON_CACHE_WARMING_LOOKAHEAD_SECONDS
+ * of playback at the given fps, and as long as the tile cache has room for them (CacheBase::getMaximumCacheSize() minus
+ * CacheBase::getCurrentSize()): the warmer never makes the Cache evict images on its own.
+ *
+ * Renders launched by this class have the lowest priority (see TreeRenderQueueProvider::getRenderPriority()) and
+ * the RenderEngine aborts them whenever the user requests a new render, e.g: when scrubbing the timeline.
+ **/
+struct ViewerCacheWarmerPrivate;
+class ViewerCacheWarmer
+: public GenericSchedulerThread
+, public TreeRenderQueueProvider
+, public boost::enable_shared_from_this<ViewerCacheWarmer>
+{
+protected:
+
+    ViewerCacheWarmer(const RenderEnginePtr& renderEngine, const NodePtr& viewer);
+
+    virtual TreeRenderQueueProviderConstPtr getThisTreeRenderQueueProviderShared() const OVERRIDE FINAL
+    {
+        return shared_from_this();
+    }
+
+public:
+
+    static ViewerCacheWarmerPtr create(const RenderEnginePtr& renderEngine, const NodePtr& viewer)
+    {
+        return ViewerCacheWarmerPtr(new ViewerCacheWarmer(renderEngine, viewer));
+    }
+
+    virtual ~ViewerCacheWarmer();
+
+    /**
+     * @brief Abort any ongoing warming and start rendering the frames following startTime in the given direction.
+     * @param fps The playback speed, this drives how many frames are rendered ahead.
+     **/
+    void warmCache(TimeValue startTime,
+                   RenderDirectionEnum direction,
+                   double fps,
+                   const std::vector<ViewIdx>& viewsToRender);
+
+    virtual TreeRenderPriorityEnum getRenderPriority() const OVERRIDE FINAL
+    {
+        return eTreeRenderPriorityCacheWarming;
+    }
+
+    bool hasThreadsAlive() const;
+
+    virtual void onWaitForAbortCompleted() OVERRIDE FINAL;
+    virtual void onWaitForThreadToQuit() OVERRIDE FINAL;
+    virtual void onAbortRequested(bool keepOldestRender) OVERRIDE FINAL;
+
+private:
+
+    virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const OVERRIDE FINAL
+    {
+        return eTaskQueueBehaviorSkipToMostRecent;
+    }
+
+    virtual ThreadStateEnum threadLoopOnce(const GenericThreadStartArgsPtr& inArgs) OVERRIDE FINAL;
+
+    boost::scoped_ptr<ViewerCacheWarmerPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_VIEWERCACHEWARMER_H
@@ -25,13 +25,17 @@
 #include "ViewerDisplayScheduler.h"
 
 #include "Engine/AppInstance.h"
+#include "Engine/CacheEntryBase.h"
+#include "Engine/Hash64.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Image.h"
 #include "Engine/ImageCacheEntry.h"
 #include "Engine/Node.h"
+#include "Engine/PlaybackFrameBuffer.h"
 #include "Engine/RenderEngine.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
+#include "Engine/Timer.h"
 #include "Engine/TreeRender.h"
 #include "Engine/ViewerNode.h"
 #include "Engine/ViewerInstance.h"
@@ -40,49 +44,6 @@ NATRON_NAMESPACE_ENTER
 
 NATRON_NAMESPACE_ANONYMOUS_ENTER
 
-static unsigned
-getViewerMipMapLevel(const ViewerNodePtr& viewer, bool draftModeEnabled, bool fullFrameProcessing)
-{
-
-
-    if (fullFrameProcessing) {
-        return 0;
-    }
-
-    unsigned int mipMapLevel = 0;
-
-    const double zoomFactor = viewer->getUIZoomFactor();
-
-    int downcale_i = viewer->getDownscaleMipMapLevelKnobIndex();
-
-
-    assert(downcale_i >= 0);
-    if (downcale_i > 0) {
-        mipMapLevel = downcale_i;
-    } else {
-        mipMapLevel = viewer->getMipMapLevelFromZoomFactor();
-    }
-
-    // If draft mode is enabled, compute the mipmap level according to the auto-proxy setting in the preferences
-    if ( draftModeEnabled && appPTR->getCurrentSettings()->isAutoProxyEnabled() ) {
-        unsigned int autoProxyLevel = appPTR->getCurrentSettings()->getAutoProxyMipMapLevel();
-        if (zoomFactor > 1) {
-            //Decrease draft mode at each inverse mipmaplevel level taken
-            unsigned int invLevel = Image::getLevelFromScale(1. / zoomFactor);
-            if (invLevel < autoProxyLevel) {
-                autoProxyLevel -= invLevel;
-            } else {
-                autoProxyLevel = 0;
-            }
-        }
-        mipMapLevel = (unsigned int)std::max( (int)mipMapLevel, (int)autoProxyLevel );
-
-    }
-
-    return mipMapLevel;
-} // getViewerMipMapLevel
-
-
 static ImagePtr
 convertImageForViewerDisplay(const RectI& bounds,
                              bool forceCopy,
@@ -123,6 +84,70 @@ convertImageForViewerDisplay(const RectI& bounds,
     return mappedImage;
 } // convertImageForViewerDisplay
 
+static void
+getPlaybackFrameRange(const ViewerNodePtr& viewer, TimeValue* first, TimeValue* last)
+{
+    ViewerNodePtr leadViewer = viewer->getApp()->getLastViewerUsingTimeline();
+    ViewerNodePtr v = leadViewer ? leadViewer : viewer;
+    assert(v);
+    int left, right;
+    v->getTimelineBounds(&left, &right);
+    *first = TimeValue(left);
+    *last = TimeValue(right);
+}
+
+/**
+ * @brief Computes the key identifying everything the frame rendered by the viewer at the given time depends on.
+ * Returns false if the frame cannot be kept in the playback buffer.
+ **/
+static bool
+computePlaybackBufferKey(const ViewerNodePtr& viewer,
+                         TimeValue time,
+                         const std::vector<ViewIdx>& viewsToRender,
+                         U64* key)
+{
+    // Partial updates only render a portion of the frame
+    if ( viewer->isDoingPartialUpdates() ) {
+        return false;
+    }
+
+    bool fullFrameProcessing = viewer->isFullFrameProcessingEnabled();
+    bool draftModeEnabled = viewer->getApp()->isDraftRenderEnabled();
+    unsigned int mipMapLevel = ViewerDisplayScheduler::getViewerMipMapLevel(viewer, draftModeEnabled, fullFrameProcessing);
+
+    Hash64 hash;
+    hash.append(mipMapLevel);
+    hash.append(fullFrameProcessing);
+    hash.append(draftModeEnabled);
+    hash.append( (int)viewer->getCurrentOperator() );
+    hash.append( viewer->getCurrentAInput() == viewer->getCurrentBInput() );
+
+    for (int i = 0; i < 2; ++i) {
+        hash.append( viewer->isViewerPaused(i) );
+        ViewerInstancePtr viewerProcess = viewer->getViewerProcessNode(i);
+        if (!fullFrameProcessing) {
+            RectD roi = viewerProcess->getViewerRoI();
+            hash.append(roi.x1);
+            hash.append(roi.y1);
+            hash.append(roi.x2);
+            hash.append(roi.y2);
+        }
+
+        // The hash of the viewer process node covers its parameters and the tree upstream
+        for (std::size_t view_i = 0; view_i < viewsToRender.size(); ++view_i) {
+            HashableObject::ComputeHashArgs args;
+            args.time = time;
+            args.view = viewsToRender[view_i];
+            args.hashType = HashableObject::eComputeHashTypeTimeViewVariant;
+            hash.append( (int)viewsToRender[view_i] );
+            hash.append( viewerProcess->computeHash(args) );
+        }
+    }
+    hash.computeHash();
+    *key = hash.value();
+    return true;
+} // computePlaybackBufferKey
+
 
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
@@ -145,6 +170,9 @@ ViewerRenderFrameSubResult::waitForResultsReady(const TreeRenderQueueProviderPtr
 void
 ViewerRenderFrameSubResult::launchRenders(const TreeRenderQueueProviderPtr& provider)
 {
+    if ( !renderTimeViewer.expired() ) {
+        renderTimer = boost::make_shared<TimeLapse>();
+    }
     for (int i = 0; i < 2; ++i) {
         if (perInputsData[i].render) {
             provider->launchRender(perInputsData[i].render);
@@ -213,13 +241,7 @@ ViewerDisplayScheduler::getFrameRangeToRender(TimeValue &first,
                                               TimeValue &last) const
 {
     ViewerNodePtr isViewer = getOutputNode()->isEffectViewerNode();
-    ViewerNodePtr leadViewer = isViewer->getApp()->getLastViewerUsingTimeline();
-    ViewerNodePtr v = leadViewer ? leadViewer : isViewer;
-    assert(v);
-    int left, right;
-    v->getTimelineBounds(&left, &right);
-    first = TimeValue(left);
-    last = TimeValue(right);
+    getPlaybackFrameRange(isViewer, &first, &last);
 }
 
 
@@ -246,6 +268,7 @@ static ActionRetCodeEnum createFrameRenderResultsForView(const ViewerNodePtr& vi
     results->frames.push_back(subResult);
     subResult->view = view;
     subResult->stats = stats;
+    subResult->mipMapLevel = mipMapLevel;
 
     if (partialUpdateRoIParam) {
         subResult->textureTransferType = OpenGLViewerI::TextureTransferArgs::eTextureTransferTypeOverlay;
@@ -254,8 +277,16 @@ static ActionRetCodeEnum createFrameRenderResultsForView(const ViewerNodePtr& vi
         subResult->textureTransferType = OpenGLViewerI::TextureTransferArgs::eTextureTransferTypeModify;
     } else {
         subResult->textureTransferType = OpenGLViewerI::TextureTransferArgs::eTextureTransferTypeReplace;
+
+        // The renders of the whole viewport made while interacting give the latency used to pick the draft mipmap level
+        if (!isPlayback) {
+            subResult->renderTimeViewer = viewer;
+        }
     }
 
+    // The A and B inputs are scheduled as one render so that they are rendered concurrently
+    const U64 renderGroup = TreeRender::createRenderGroup();
+
     for (int viewerInputIndex = 0; viewerInputIndex < 2; ++viewerInputIndex) {
         subResult->perInputsData[viewerInputIndex].retCode = eActionStatusFailed;
         if (viewerInputIndex == 1 && (viewerBEqualsViewerA || viewerBlend == eViewerCompositingOperatorNone)) {
@@ -270,6 +301,7 @@ static ActionRetCodeEnum createFrameRenderResultsForView(const ViewerNodePtr& vi
         }
         ViewerInstancePtr viewerProcess = viewer->getViewerProcessNode(viewerInputIndex);
         subResult->perInputsData[viewerInputIndex].viewerProcessNode = viewerProcess->getNode();
+        subResult->perInputsData[viewerInputIndex].displayTransformAppliedByViewer = viewerProcess->isDisplayTransformAppliedByViewer();
 
 
 
@@ -304,6 +336,7 @@ static ActionRetCodeEnum createFrameRenderResultsForView(const ViewerNodePtr& vi
         initArgs->playback = isPlayback;
         initArgs->byPassCache = byPassCache;
         initArgs->preventConcurrentTreeRenders = (activeDrawingStroke || partialUpdateRoIParam);
+        initArgs->renderGroup = renderGroup;
         if (!isPlayback && subResult->textureTransferType == OpenGLViewerI::TextureTransferArgs::eTextureTransferTypeReplace && !activeDrawingStroke) {
             subResult->perInputsData[viewerInputIndex].colorPickerNode = viewerInputIndex == 0 ? viewer->getCurrentAInput() : viewer->getCurrentBInput();
             if (subResult->perInputsData[viewerInputIndex].colorPickerNode) {
@@ -328,6 +361,51 @@ static ActionRetCodeEnum createFrameRenderResultsForView(const ViewerNodePtr& vi
     return eActionStatusOK;
 } // createFrameRenderResultsForView
 
+unsigned int
+ViewerDisplayScheduler::getViewerMipMapLevel(const ViewerNodePtr& viewer, bool draftModeEnabled, bool fullFrameProcessing)
+{
+    if (fullFrameProcessing) {
+        return 0;
+    }
+
+    unsigned int mipMapLevel = 0;
+
+    const double zoomFactor = viewer->getUIZoomFactor();
+
+    int downcale_i = viewer->getDownscaleMipMapLevelKnobIndex();
+
+
+    assert(downcale_i >= 0);
+    if (downcale_i > 0) {
+        mipMapLevel = downcale_i;
+    } else {
+        mipMapLevel = viewer->getMipMapLevelFromZoomFactor();
+    }
+
+    // If draft mode is enabled, compute the mipmap level according to the auto-proxy setting in the preferences
+    if ( draftModeEnabled && appPTR->getCurrentSettings()->isAutoProxyEnabled() ) {
+        unsigned int autoProxyLevel = appPTR->getCurrentSettings()->getAutoProxyMipMapLevel();
+        double targetLatency = appPTR->getCurrentSettings()->getAutoProxyTargetLatency();
+        if (zoomFactor > 1) {
+            //Decrease draft mode at each inverse mipmaplevel level taken
+            unsigned int invLevel = Image::getLevelFromScale(1. / zoomFactor);
+            if (invLevel < autoProxyLevel) {
+                autoProxyLevel -= invLevel;
+            } else {
+                autoProxyLevel = 0;
+            }
+        }
+        if (targetLatency > 0) {
+            // The auto-proxy level is the coarsest level: use the finest level at which the tree is expected to render in time
+            mipMapLevel = viewer->getAdaptiveDraftMipMapLevel( targetLatency, mipMapLevel, std::max(mipMapLevel, autoProxyLevel) );
+        } else {
+            mipMapLevel = (unsigned int)std::max( (int)mipMapLevel, (int)autoProxyLevel );
+        }
+    }
+
+    return mipMapLevel;
+} // getViewerMipMapLevel
+
 ActionRetCodeEnum
 ViewerDisplayScheduler::createFrameRenderResultsGeneric(const ViewerNodePtr& viewer,
                                                         const TreeRenderQueueProviderPtr& provider,
@@ -336,6 +414,7 @@ ViewerDisplayScheduler::createFrameRenderResultsGeneric(const ViewerNodePtr& vie
                                                         const RotoStrokeItemPtr& activeDrawingStroke,
                                                         const std::vector<ViewIdx>& viewsToRender,
                                                         bool enableRenderStats,
+                                                        unsigned int minMipMapLevel,
                                                         RenderFrameResultsContainerPtr* future)
 {
     // A global statistics object for this frame render if requested
@@ -349,6 +428,9 @@ ViewerDisplayScheduler::createFrameRenderResultsGeneric(const ViewerNodePtr& vie
     bool fullFrameProcessing = viewer->isFullFrameProcessingEnabled();
     bool draftModeEnabled = viewer->getApp()->isDraftRenderEnabled();
     unsigned int mipMapLevel = getViewerMipMapLevel(viewer, draftModeEnabled, fullFrameProcessing);
+    // A coarser level than the one of the viewer renders a preview that must not be kept for playback
+    bool isCoarserThanViewer = minMipMapLevel > mipMapLevel;
+    mipMapLevel = std::max(mipMapLevel, minMipMapLevel);
     bool byPassCache = viewer->isRenderWithoutCacheEnabledAndTurnOff();
     ViewerCompositingOperatorEnum viewerBlend = viewer->getCurrentOperator();
     bool viewerBEqualsViewerA = viewer->getCurrentAInput() == viewer->getCurrentBInput();
@@ -359,6 +441,11 @@ ViewerDisplayScheduler::createFrameRenderResultsGeneric(const ViewerNodePtr& vie
     results->time = time;
     results->recenterViewer = viewer->getViewerCenterPoint(&results->viewerCenter);
 
+    // The key is computed before rendering so that a change made while rendering does not get attached to the frame
+    if ( !byPassCache && !activeDrawingStroke && !enableRenderStats && !isCoarserThanViewer && appPTR->getCurrentSettings()->getPlaybackBufferSize() > 0 ) {
+        results->canBeBufferedForPlayback = computePlaybackBufferKey(viewer, time, viewsToRender, &results->playbackBufferKey);
+    }
+
     std::list<RectD> rois;
     if (!viewer->isDoingPartialUpdates()) {
         rois.push_back(RectD());
@@ -394,7 +481,24 @@ ViewerDisplayScheduler::createFrameRenderResults(TimeValue time, const std::vect
 
     ViewerNodePtr viewer = toViewerNode(getOutputNode()->getEffectInstance());
     assert(viewer);
-    return createFrameRenderResultsGeneric(viewer, shared_from_this(), time, true /*isPlayback*/, RotoStrokeItemPtr(), viewsToRender, enableRenderStats, results);
+
+    // If the frame was already displayed and nothing changed since, display it again without rendering anything
+    PlaybackFrameBufferPtr buffer = getEngine()->getPlaybackFrameBuffer();
+    U64 key;
+    if ( !enableRenderStats && appPTR->getCurrentSettings()->getPlaybackBufferSize() > 0 && computePlaybackBufferKey(viewer, time, viewsToRender, &key) ) {
+        RenderFrameResultsContainerPtr bufferedResults = buffer->getFrame(time, key);
+        if (bufferedResults) {
+            // The sub-results have no render left: waiting for them and processing them is immediate
+            ViewerRenderFrameResultsContainerPtr viewerResults(new ViewerRenderFrameResultsContainer(shared_from_this()));
+            viewerResults->time = time;
+            viewerResults->recenterViewer = viewer->getViewerCenterPoint(&viewerResults->viewerCenter);
+            viewerResults->frames = bufferedResults->frames;
+            *results = viewerResults;
+            return eActionStatusOK;
+        }
+    }
+
+    return createFrameRenderResultsGeneric(viewer, shared_from_this(), time, true /*isPlayback*/, RotoStrokeItemPtr(), viewsToRender, enableRenderStats, 0 /*minMipMapLevel*/, results);
 } // createFrameRenderResults
 
 void
@@ -423,6 +527,11 @@ ViewerRenderFrameSubResult::onTreeRenderFinished(int inputIndex)
         return;
     }
 
+    ViewerNodePtr viewer = renderTimeViewer.lock();
+    if (viewer && renderTimer) {
+        viewer->reportRenderTime( mipMapLevel, renderTimer->getTimeSinceCreation() );
+    }
+
 
     // Find the key of the image and store it so that in the gui
     // we can later on re-use this key to check the cache for the timeline's cache line
@@ -450,6 +559,10 @@ ViewerRenderFrameSubResult::onTreeRenderFinished(int inputIndex)
         bool strokeAreaSet = inputData.render->getRotoPaintActiveStrokeUpdateArea(&strokeArea);
         if (strokeAreaSet) {
             imageConvertRoI = strokeArea;
+
+            // The image may not be copied to imageConvertRoI if it is already in a format suitable for the viewer:
+            // remember which part changed so that only that part of the texture gets uploaded.
+            inputData.textureUpdateArea = strokeArea;
         }
     }
 
@@ -522,6 +635,8 @@ ViewerDisplayScheduler::processFramesResults(const ViewerNodePtr& viewer,const R
             upload.colorPickerImage = inputData.colorPickerImage;
             upload.colorPickerInputImage = inputData.colorPickerInputImage;
             upload.viewerProcessImageKey = inputData.viewerProcessImageKey;
+            upload.updateArea = inputData.textureUpdateArea;
+            upload.applyDisplayTransform = inputData.displayTransformAppliedByViewer;
 
             if (inputData.retCode == eActionStatusAborted || (inputData.retCode == eActionStatusOK && !upload.image)) {
                 // If aborted or no image was rendered but the result was OK (one of the reasons could be the caller requested a RoI outside of the bounds of the image), don't transfer any texture, just redraw the viewer.
@@ -558,9 +673,68 @@ ViewerDisplayScheduler::processFrame(const ProcessFrameArgsBase& args)
 
 
 void
-ViewerDisplayScheduler::onFrameProcessed(const ProcessFrameArgsBase& /*args*/)
+ViewerDisplayScheduler::addFrameToPlaybackBuffer(const ViewerNodePtr& viewer,
+                                                 const PlaybackFrameBufferPtr& buffer,
+                                                 const RenderFrameResultsContainerPtr& results)
+{
+    ViewerRenderFrameResultsContainerPtr viewerResults = boost::dynamic_pointer_cast<ViewerRenderFrameResultsContainer>(results);
+    if (!viewer || !buffer || !viewerResults || !viewerResults->canBeBufferedForPlayback || viewerResults->frames.empty()) {
+        return;
+    }
+
+    const std::size_t maxSize = appPTR->getCurrentSettings()->getPlaybackBufferSize();
+    if (maxSize == 0) {
+        buffer->clear();
+        return;
+    }
+
+    // Keep a copy of the sub-results without what is not needed for playback, e.g: the color picker images
+    ViewerRenderFrameResultsContainerPtr bufferedResults(new ViewerRenderFrameResultsContainer(TreeRenderQueueProviderPtr()));
+    bufferedResults->time = viewerResults->time;
+    std::size_t size = 0;
+    for (std::list<RenderFrameSubResultPtr>::const_iterator it = viewerResults->frames.begin(); it != viewerResults->frames.end(); ++it) {
+        const ViewerRenderFrameSubResult* viewerObject = dynamic_cast<const ViewerRenderFrameSubResult*>(it->get());
+        assert(viewerObject);
+        if (viewerObject->textureTransferType != OpenGLViewerI::TextureTransferArgs::eTextureTransferTypeReplace) {
+            return;
+        }
+        ViewerRenderFrameSubResultPtr subResult(new ViewerRenderFrameSubResult);
+        subResult->view = viewerObject->view;
+        subResult->textureTransferType = viewerObject->textureTransferType;
+        subResult->copyInputBFromA = viewerObject->copyInputBFromA;
+        for (int i = 0; i < 2; ++i) {
+            const PerViewerInputRenderData& inputData = viewerObject->perInputsData[i];
+
+            // Only keep frames that were entirely rendered. Inputs that were not rendered (paused or not displayed) have no viewer process node.
+            if ( inputData.viewerProcessNode && (inputData.render || inputData.retCode != eActionStatusOK) ) {
+                return;
+            }
+            PerViewerInputRenderData& bufferedData = subResult->perInputsData[i];
+            bufferedData.viewerProcessImage = inputData.viewerProcessImage;
+            bufferedData.retCode = inputData.retCode;
+            bufferedData.viewerProcessImageKey = inputData.viewerProcessImageKey;
+            bufferedData.viewerProcessNode = inputData.viewerProcessNode;
+            bufferedData.displayTransformAppliedByViewer = inputData.displayTransformAppliedByViewer;
+
+            // When copied from A, B shares the image of A
+            if (inputData.viewerProcessImage && (i == 0 || !viewerObject->copyInputBFromA)) {
+                const RectI& bounds = inputData.viewerProcessImage->getBounds();
+                size += (std::size_t)bounds.area() * inputData.viewerProcessImage->getComponentsCount() * getSizeOfForBitDepth( inputData.viewerProcessImage->getBitDepth() );
+            }
+        }
+        bufferedResults->frames.push_back(subResult);
+    }
+
+    TimeValue first, last;
+    getPlaybackFrameRange(viewer, &first, &last);
+    buffer->insertFrame(viewerResults->time, viewerResults->playbackBufferKey, bufferedResults, size, maxSize, first, last);
+} // addFrameToPlaybackBuffer
+
+void
+ViewerDisplayScheduler::onFrameProcessed(const ProcessFrameArgsBase& args)
 {
-    // Do nothing
+    ViewerNodePtr isViewer = getOutputNode()->isEffectViewerNode();
+    addFrameToPlaybackBuffer(isViewer, getEngine()->getPlaybackFrameBuffer(), args.results);
 } // onFrameProcessed
 
 
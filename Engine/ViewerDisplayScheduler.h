@@ -47,6 +47,12 @@ struct PerViewerInputRenderData
     NodePtr colorPickerNode;
     NodePtr colorPickerInputNode;
 
+    // If not null, only this portion (in pixel coordinates) of viewerProcessImage changed since the last upload
+    RectI textureUpdateArea;
+
+    // True if viewerProcessImage is linear and the viewer applies the display transform when drawing it
+    bool displayTransformAppliedByViewer;
+
     PerViewerInputRenderData()
     : render()
     , viewerProcessImage()
@@ -57,6 +63,8 @@ struct PerViewerInputRenderData
     , viewerProcessNode()
     , colorPickerNode()
     , colorPickerInputNode()
+    , textureUpdateArea()
+    , displayTransformAppliedByViewer(false)
     {
 
     }
@@ -72,6 +80,9 @@ public:
     , textureTransferType(OpenGLViewerI::TextureTransferArgs::eTextureTransferTypeReplace)
     , copyInputBFromA(false)
     , perInputsData()
+    , mipMapLevel(0)
+    , renderTimeViewer()
+    , renderTimer()
     {
 
     }
@@ -91,6 +102,13 @@ public:
     OpenGLViewerI::TextureTransferArgs::TypeEnum textureTransferType;
     bool copyInputBFromA;
     PerViewerInputRenderData perInputsData[2];
+    unsigned int mipMapLevel;
+
+    // If set, the time taken by the renders is reported to this viewer, see ViewerNode::reportRenderTime()
+    ViewerNodeWPtr renderTimeViewer;
+
+    // Started when the renders are launched
+    TimeLapsePtr renderTimer;
 };
 
 class ViewerRenderFrameResultsContainer : public RenderFrameResultsContainer
@@ -101,6 +119,8 @@ public:
     : RenderFrameResultsContainer(provider)
     , recenterViewer(0)
     , viewerCenter()
+    , canBeBufferedForPlayback(false)
+    , playbackBufferKey(0)
     {
 
     }
@@ -109,6 +129,10 @@ public:
 
     bool recenterViewer;
     Point viewerCenter;
+
+    // True if the frame may be kept in the PlaybackFrameBuffer once rendered, under playbackBufferKey
+    bool canBeBufferedForPlayback;
+    U64 playbackBufferKey;
 };
 
 typedef boost::shared_ptr<ViewerRenderFrameSubResult> ViewerRenderFrameSubResultPtr;
@@ -141,9 +165,16 @@ public:
      **/
     static bool processFramesResults(const ViewerNodePtr& viewer,const RenderFrameResultsContainerPtr& results);
 
+    /**
+     * @brief Returns the mipmap level at which the viewer renders, from its downscale parameter, its zoom factor
+     * and the auto-proxy preferences if draft mode is enabled.
+     **/
+    static unsigned int getViewerMipMapLevel(const ViewerNodePtr& viewer, bool draftModeEnabled, bool fullFrameProcessing);
+
     /**
      * @brief Generic function for the viewer to launch a render. Used by CurrentFrameRequestScheduler and
-     * ViewerDisplayScheduler
+     * ViewerDisplayScheduler.
+     * @param minMipMapLevel If greater than the level of the viewer, the frame is rendered at this coarser level instead.
      **/
     static ActionRetCodeEnum createFrameRenderResultsGeneric(const ViewerNodePtr& viewer,
                                                        const TreeRenderQueueProviderPtr& provider,
@@ -152,8 +183,18 @@ public:
                                                        const RotoStrokeItemPtr& activeDrawingStroke,
                                                        const std::vector<ViewIdx>& viewsToRender,
                                                        bool enableRenderStats,
+                                                       unsigned int minMipMapLevel,
                                                        RenderFrameResultsContainerPtr* results) ;
 
+    /**
+     * @brief Keeps the given rendered results in the playback buffer so that they can be displayed again
+     * during playback without being rendered. This does nothing if they were not rendered successfully or
+     * if they cannot be buffered (e.g: partial updates).
+     **/
+    static void addFrameToPlaybackBuffer(const ViewerNodePtr& viewer,
+                                         const PlaybackFrameBufferPtr& buffer,
+                                         const RenderFrameResultsContainerPtr& results);
+
 private:
 
     virtual ProcessFrameArgsBasePtr createProcessFrameArgs(const OutputSchedulerThreadStartArgsPtr& runArgs, const RenderFrameResultsContainerPtr& results) OVERRIDE FINAL;
@@ -175,6 +216,11 @@ private:
 
     virtual TimeValue getLastRenderedTime() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual void onRenderStopped(bool aborted) OVERRIDE FINAL;
+
+    virtual TreeRenderPriorityEnum getRenderPriority() const OVERRIDE FINAL
+    {
+        return eTreeRenderPriorityPlayback;
+    }
 };
 
 
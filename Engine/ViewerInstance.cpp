@@ -42,6 +42,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/NodeMetadata.h"
 #include "Engine/Node.h"
 #include "Engine/InputDescription.h"
+#include "Engine/Half.h"
 #include "Engine/Hash64.h"
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/KnobTypes.h"
@@ -121,6 +122,10 @@ struct ViewerInstancePrivate
 
     void setDisplayChannelsFromLayer(const std::list<ImagePlaneDesc>& availableLayers);
 
+    bool isDisplayTransformAppliedByViewer() const;
+
+    DisplayChannelsEnum getProcessedDisplayChannels() const;
+
 };
 
 
@@ -198,6 +203,39 @@ ViewerInstance::~ViewerInstance()
 {
 }
 
+bool
+ViewerInstancePrivate::isDisplayTransformAppliedByViewer() const
+{
+    if ( !appPTR->getCurrentSettings()->isGPUDisplayTransformEnabled() ) {
+        return false;
+    }
+
+    // The auto-contrast needs the min/max of the image
+    if ( autoContrastKnob.lock()->getValue() ) {
+        return false;
+    }
+
+    // The alpha and matte channels need the alpha channel which is not part of the RGB image we output
+    DisplayChannelsEnum channels = (DisplayChannelsEnum)displayChannels.lock()->getValue();
+    return channels != eDisplayChannelsA && channels != eDisplayChannelsMatte;
+} // isDisplayTransformAppliedByViewer
+
+DisplayChannelsEnum
+ViewerInstancePrivate::getProcessedDisplayChannels() const
+{
+    // When the viewer applies the display transform, it selects the R, G, B or luminance channels itself from the RGB image
+    if ( isDisplayTransformAppliedByViewer() ) {
+        return eDisplayChannelsRGB;
+    }
+    return (DisplayChannelsEnum)displayChannels.lock()->getValue();
+}
+
+bool
+ViewerInstance::isDisplayTransformAppliedByViewer() const
+{
+    return _imp->isDisplayTransformAppliedByViewer();
+}
+
 ViewerNodePtr
 ViewerInstance::getViewerNodeGroup() const
 {
@@ -441,7 +479,7 @@ ViewerInstance::isIdentity(TimeValue time,
             return stat;
         }
     }
-    DisplayChannelsEnum displayChannels = (DisplayChannelsEnum)_imp->displayChannels.lock()->getValue();
+    DisplayChannelsEnum displayChannels = _imp->getProcessedDisplayChannels();
 
     if (displayChannels != eDisplayChannelsRGB) {
         // If we need to apply channel operations, we are not identity
@@ -449,12 +487,15 @@ ViewerInstance::isIdentity(TimeValue time,
         return eActionStatusOK;
     }
 
-    if (_imp->gainKnob.lock()->getValue() != 1.) {
+    // The gain and gamma are applied by the viewer
+    const bool displayTransformAppliedByViewer = _imp->isDisplayTransformAppliedByViewer();
+
+    if (!displayTransformAppliedByViewer && _imp->gainKnob.lock()->getValue() != 1.) {
         *inputNb = -1;
         return eActionStatusOK;
     }
 
-    if (_imp->gammaKnob.lock()->getValue() != 1.) {
+    if (!displayTransformAppliedByViewer && _imp->gammaKnob.lock()->getValue() != 1.) {
         *inputNb = -1;
         return eActionStatusOK;
     }
@@ -480,8 +521,28 @@ ViewerInstance::appendToHash(const ComputeHashArgs& args, Hash64* hash)
     // so make sure it is part of the hash.
     appPTR->getCurrentSettings()->getViewerBitDepthKnob()->appendToHash(args, hash);
 
+    // Whether the display transform is applied by the viewer changes the output of render()
+    appPTR->getCurrentSettings()->getGPUDisplayTransformKnob()->appendToHash(args, hash);
+    hash->append( (U64)_imp->isDisplayTransformAppliedByViewer() );
+
 }
 
+bool
+ViewerInstance::isKnobPartOfHash(const KnobIPtr& knob) const
+{
+    // When the viewer applies the display transform, the image we output does not depend on these parameters:
+    // this lets the viewer re-use the same cached image when they change.
+    if ( _imp->isDisplayTransformAppliedByViewer() ) {
+        if ( knob == _imp->gainKnob.lock() ||
+             knob == _imp->gammaKnob.lock() ||
+             knob == _imp->outputColorspace.lock() ||
+             knob == _imp->displayChannels.lock() ) {
+            return false;
+        }
+    }
+    return EffectInstance::isKnobPartOfHash(knob);
+} // isKnobPartOfHash
+
 ActionRetCodeEnum
 ViewerInstance::getTimeInvariantMetadata(NodeMetadata& metadata)
 {
@@ -594,7 +655,7 @@ ViewerInstancePrivate::getChannelOptions(TimeValue time, ImagePlaneDesc* rgbLaye
 ImagePlaneDesc
 ViewerInstancePrivate::getComponentsFromDisplayChannels(const ImagePlaneDesc& alphaLayer) const
 {
-    DisplayChannelsEnum outputChannels = (DisplayChannelsEnum)displayChannels.lock()->getValue();
+    DisplayChannelsEnum outputChannels = getProcessedDisplayChannels();
     switch (outputChannels) {
         case eDisplayChannelsA:
         case eDisplayChannelsR:
@@ -952,6 +1013,7 @@ findAutoContrastVminVmax(const Image::CPUData& colorImage,
         case eImageBitDepthFloat:
             return findAutoContrastVminVmaxForDepth<float, 1>(colorImage, renderArgs, channels, roi, ret);
         case eImageBitDepthHalf:
+            return findAutoContrastVminVmaxForDepth<Half, 1>(colorImage, renderArgs, channels, roi, ret);
         case eImageBitDepthNone:
             return eActionStatusFailed;
         case eImageBitDepthShort:
@@ -1323,6 +1385,7 @@ applyViewerProcess8bit(const RenderViewerArgs& args, const RectI & roi)
         case eImageBitDepthShort:
             return applyViewerProcess8bitForDepth<unsigned short, 65535>(args, roi);
         case eImageBitDepthHalf:
+            return applyViewerProcess8bitForDepth<Half, 1>(args, roi);
         case eImageBitDepthNone:
             return eActionStatusFailed;
     }
@@ -1371,8 +1434,10 @@ applyViewerProcess32bit_Generic(const RenderViewerArgs& args, const RectI & roi)
             genericViewerProcessFunctor<PIX, maxValue, srcNComps, channels>(args, color_pixels, alpha_pixels, tmpPix, &alphaMatteValue);
 
             if (args.dstColorspace) {
+                // The precision of half is enough for display: the conversion is then a single look-up
+                // instead of an evaluation of the transfer function
                 for (int i = 0; i < 3; ++i) {
-                    tmpPix[i] = args.dstColorspace->toColorSpaceFloatFromLinearFloat(tmpPix[i]);
+                    tmpPix[i] = args.dstColorspace->toColorSpaceFloatFromLinearHalfFast( Half(tmpPix[i]) );
                 }
             }
 
@@ -1453,6 +1518,7 @@ applyViewerProcess32bit(const RenderViewerArgs& args, const RectI & roi)
         case eImageBitDepthShort:
             return applyViewerProcess32bitForDepth<unsigned short, 65535>(args, roi);
         case eImageBitDepthHalf:
+            return applyViewerProcess32bitForDepth<Half, 1>(args, roi);
         case eImageBitDepthNone:
             return eActionStatusFailed;
     }
@@ -1525,7 +1591,8 @@ ViewerInstance::render(const RenderActionArgs& args)
     }
 #endif
 
-    DisplayChannelsEnum displayChannels = (DisplayChannelsEnum)_imp->displayChannels.lock()->getValue();
+    DisplayChannelsEnum displayChannels = _imp->getProcessedDisplayChannels();
+    const bool displayTransformAppliedByViewer = _imp->isDisplayTransformAppliedByViewer();
 
 
     // Fetch the color and alpha image
@@ -1606,14 +1673,19 @@ ViewerInstance::render(const RenderActionArgs& args)
     assert(colorImage->getBounds().contains(args.roi));
     assert(dstImage->getBounds().contains(args.roi));
 
-    renderViewerArgs.gamma = _imp->gammaKnob.lock()->getValue();
+    // When the viewer applies the display transform, output linear values
+    renderViewerArgs.gamma = displayTransformAppliedByViewer ? 1. : _imp->gammaKnob.lock()->getValue();
 
     RamBuffer<float> gammaLut;
     ViewerInstancePrivate::buildGammaLut(renderViewerArgs.gamma, &gammaLut);
     renderViewerArgs.gammaLut = gammaLut.getData();
 
     bool doAutoContrast = _imp->autoContrastKnob.lock()->getValue();
-    if (!doAutoContrast) {
+    if (displayTransformAppliedByViewer) {
+        assert(!doAutoContrast);
+        renderViewerArgs.gain = 1.;
+        renderViewerArgs.offset = 0;
+    } else if (!doAutoContrast) {
         renderViewerArgs.gain = _imp->gainKnob.lock()->getValue();
         renderViewerArgs.gain = std::pow(2, renderViewerArgs.gain);
         renderViewerArgs.offset = 0;
@@ -1644,7 +1716,11 @@ ViewerInstance::render(const RenderActionArgs& args)
     }
 
     renderViewerArgs.srcColorspace = lutFromColorspace(getApp()->getDefaultColorSpaceForBitDepth(getBitDepth(0)));
-    renderViewerArgs.dstColorspace = lutFromColorspace((ViewerColorSpaceEnum)_imp->outputColorspace.lock()->getValue());
+    if (displayTransformAppliedByViewer) {
+        renderViewerArgs.dstColorspace = 0;
+    } else {
+        renderViewerArgs.dstColorspace = lutFromColorspace((ViewerColorSpaceEnum)_imp->outputColorspace.lock()->getValue());
+    }
 
 
     ViewerProcessor processor(shared_from_this());
@@ -140,6 +140,12 @@ public:
 
     RectD getViewerRoI();
 
+    /**
+     * @brief Returns true if this node outputs linear images and lets the viewer apply the gain, gamma,
+     * display colorspace and channel selection when drawing them (see Settings::isGPUDisplayTransformEnabled()).
+     **/
+    bool isDisplayTransformAppliedByViewer() const;
+
 private:
 
     virtual void initializeKnobs() OVERRIDE FINAL;
@@ -173,6 +179,8 @@ private:
 
     virtual void appendToHash(const ComputeHashArgs& args, Hash64* hash) OVERRIDE;
 
+    virtual bool isKnobPartOfHash(const KnobIPtr& knob) const OVERRIDE FINAL;
+
     virtual bool knobChanged(const KnobIPtr& knob,
                              ValueChangedReasonEnum reason,
                              ViewSetSpec view,
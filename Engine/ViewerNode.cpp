@@ -678,6 +678,18 @@ ViewerNode::getColorspace() const
     return (ViewerColorSpaceEnum)_imp->colorspaceKnob.lock()->getValue();
 }
 
+double
+ViewerNode::getGain() const
+{
+    return _imp->gainSliderKnob.lock()->getValue();
+}
+
+double
+ViewerNode::getGamma() const
+{
+    return _imp->gammaSliderKnob.lock()->getValue();
+}
+
 OpenGLViewerI*
 ViewerNode::getUiContext() const
 {
@@ -1065,6 +1077,39 @@ ViewerNode::getMipMapLevelFromZoomFactor() const
     return zoomFactor >= 1 ? 0 : (int)-std::ceil(std::log(zoomFactor) / M_LN2);
 }
 
+void
+ViewerNode::reportRenderTime(unsigned int mipMapLevel, double seconds)
+{
+    // Each mipmap level has a quarter of the pixels of the previous one
+    double fullResTime = seconds * (double)(1 << (2 * mipMapLevel));
+
+    QMutexLocker k(&_imp->renderTimeMutex);
+    if (_imp->fullResRenderTimeAverage < 0) {
+        _imp->fullResRenderTimeAverage = fullResTime;
+    } else {
+        // Weigh the last render more so that the level follows the changes of the tree quickly
+        _imp->fullResRenderTimeAverage = 0.5 * _imp->fullResRenderTimeAverage + 0.5 * fullResTime;
+    }
+}
+
+unsigned int
+ViewerNode::getAdaptiveDraftMipMapLevel(double targetSeconds, unsigned int minLevel, unsigned int maxLevel) const
+{
+    double fullResTime;
+    {
+        QMutexLocker k(&_imp->renderTimeMutex);
+        fullResTime = _imp->fullResRenderTimeAverage;
+    }
+    if (fullResTime < 0 || targetSeconds <= 0) {
+        return minLevel;
+    }
+    unsigned int level = minLevel;
+    while ( level < maxLevel && (fullResTime / (double)(1 << (2 * level)) > targetSeconds) ) {
+        ++level;
+    }
+    return level;
+}
+
 void
 ViewerNode::updateViewer(const UpdateViewerArgs& args)
 {
@@ -1096,6 +1141,8 @@ ViewerNode::updateViewer(const UpdateViewerArgs& args)
             transferArgs.recenterViewer = args.recenterViewer;
             transferArgs.viewportCenter = args.viewerCenter;
             transferArgs.viewerProcessNodeKey = it->viewerProcessImageKey;
+            transferArgs.updateArea = it->updateArea;
+            transferArgs.applyDisplayTransform = it->applyDisplayTransform;
             transferArgs.type = args.type;
             uiContext->transferBufferFromRAMtoGPU(transferArgs);
         }
@@ -183,6 +183,13 @@ public:
 
     ViewerColorSpaceEnum getColorspace() const;
 
+    /**
+     * @brief Returns the gain of the viewer, in f-stops
+     **/
+    double getGain() const;
+
+    double getGamma() const;
+
     void setRefreshButtonDown(bool down);
 
     bool isViewersSynchroEnabled() const;
@@ -256,6 +263,18 @@ public:
     
     unsigned int getMipMapLevelFromZoomFactor() const;
 
+    /**
+     * @brief Records how long a render of the tree of this viewer took at the given mipmap level.
+     * This is used by getAdaptiveDraftMipMapLevel().
+     **/
+    void reportRenderTime(unsigned int mipMapLevel, double seconds);
+
+    /**
+     * @brief Returns the lowest mipmap level, at least minLevel and at most maxLevel, at which a render of the tree of this viewer
+     * is expected to take less than targetSeconds given the recent render times. Returns minLevel if no render time was recorded yet.
+     **/
+    unsigned int getAdaptiveDraftMipMapLevel(double targetSeconds, unsigned int minLevel, unsigned int maxLevel) const;
+
     struct UpdateViewerArgs
     {
         TimeValue time;
@@ -273,6 +292,23 @@ public:
 
             // The hash of the viewer process node
             ImageCacheKeyPtr viewerProcessImageKey;
+
+            // If not null, only this portion of the image is uploaded to the texture, see OpenGLViewerI::TextureTransferArgs
+            RectI updateArea;
+
+            // If true, the image is linear and the viewer must apply the display transform, see OpenGLViewerI::TextureTransferArgs
+            bool applyDisplayTransform;
+
+            TextureUpload()
+            : image()
+            , colorPickerImage()
+            , colorPickerInputImage()
+            , viewerProcessImageKey()
+            , updateArea()
+            , applyDisplayTransform(false)
+            {
+
+            }
         };
         std::list<TextureUpload> viewerUploads[2];
         bool recenterViewer;
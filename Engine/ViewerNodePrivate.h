@@ -528,6 +528,11 @@ struct ViewerNodePrivate
     // True if during tracking, protected by partialUpdatesMutex
     bool isDoingPartialUpdates;
 
+    // Moving average of the time in seconds a render of the tree would take at mipmap level 0, estimated
+    // from the renders at any level. Negative if no render was recorded yet. Protected by renderTimeMutex
+    mutable QMutex renderTimeMutex;
+    double fullResRenderTimeAverage;
+
     ViewerNodePrivate(ViewerNode* publicInterface)
     : _publicInterface(publicInterface)
     , uiContext(0)
@@ -542,6 +547,8 @@ struct ViewerNodePrivate
     , viewportCenter()
     , viewportCenterSet(false)
     , isDoingPartialUpdates(false)
+    , renderTimeMutex()
+    , fullResRenderTimeAverage(-1.)
     {
 
     }
@@ -149,7 +149,11 @@ enum ActionRetCodeEnum
     eActionStatusOutOfMemory,
 
     // The operation completed with default implementation
-    eActionStatusReplyDefault
+    eActionStatusReplyDefault,
+
+    // The render rendered everything it could but some tiles are being rendered by another thread or process.
+    // The render is not finished: it should be launched again once the pending tiles are rendered.
+    eActionStatusPendingTiles
 };
 
 inline bool isFailureRetCode(ActionRetCodeEnum code)
@@ -162,6 +166,7 @@ inline bool isFailureRetCode(ActionRetCodeEnum code)
             return true;
         case eActionStatusOK:
         case eActionStatusReplyDefault:
+        case eActionStatusPendingTiles:
             return false;
     }
     return true;
@@ -622,6 +627,56 @@ enum CacheAccessModeEnum
     eCacheAccessModeWriteOnly
 };
 
+enum CacheEvictionPolicyEnum
+{
+    // The least recently used entries are evicted first
+    eCacheEvictionPolicyLRU = 0,
+
+    // Entries that were expensive to compute compared to the memory they take
+    // are kept longer than the least recently used ones
+    eCacheEvictionPolicyCostAware
+};
+
+enum CacheDurabilityEnum
+{
+    // Tiles of the persistent cache are written to disk whenever the
+    // operating system decides to
+    eCacheDurabilityNone = 0,
+
+    // Tiles written to the persistent cache are synced to disk at a regular interval
+    eCacheDurabilityPeriodic,
+
+    // Tiles written to the persistent cache are synced to disk once no tile
+    // was written for a while
+    eCacheDurabilityOnIdle
+};
+
+enum CacheNUMAPolicyEnum
+{
+    // Pages of the tile storage are allocated on the NUMA node of the thread that touches them first
+    eCacheNUMAPolicyDefault = 0,
+
+    // Pages of the tile storage are spread across all NUMA nodes
+    eCacheNUMAPolicyInterleave,
+
+    // Pages of the tile storage are allocated on the NUMA node of the thread that touches them first,
+    // even if the process was launched with another memory policy. This is not a user choice: it is
+    // used instead of eCacheNUMAPolicyDefault when the render threads are pinned.
+    eCacheNUMAPolicyLocal
+};
+
+enum ThreadPlacementPolicyEnum
+{
+    // The render threads may run on any CPU
+    eThreadPlacementPolicyNone = 0,
+
+    // Each render thread is bound to the CPUs of a NUMA node, the threads are spread evenly across the nodes
+    eThreadPlacementPolicyNUMANode,
+
+    // Each render thread is pinned to a single CPU, the threads are spread evenly across the NUMA nodes
+    eThreadPlacementPolicyCore
+};
+
 enum ImageBufferLayoutEnum
 {
     // This will make an image with an internal storage composed
@@ -104,6 +104,12 @@ typedef OfxRangeD RangeD;
 
 #define kAbortRenderingStringShort "-a"
 
+// Sent by a background render sharing the persistent tile cache with the main process when the image of a frame
+// was inserted in the cache, followed by the frame and kViewStringShort + the view
+#define kFrameAvailableInCacheStringShort "-c"
+
+#define kViewStringShort "-v"
+
 #define kBgProcessServerCreatedShort "--bg_server_created"
 
 #define kNodeGraphObjectName "nodeGraph"
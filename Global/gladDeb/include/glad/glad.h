@@ -9,6 +9,7 @@
     Extensions:
         GL_APPLE_vertex_array_object,
         GL_ARB_framebuffer_object,
+        GL_ARB_get_program_binary,
         GL_ARB_pixel_buffer_object,
         GL_ARB_texture_float,
         GL_ARB_vertex_array_object,
@@ -19,9 +20,9 @@
     Omit khrplatform: True
 
     Commandline:
-        --profile="compatibility" --api="gl=2.0" --generator="c-debug" --spec="gl" --omit-khrplatform --extensions="GL_APPLE_vertex_array_object,GL_ARB_framebuffer_object,GL_ARB_pixel_buffer_object,GL_ARB_texture_float,GL_ARB_vertex_array_object,GL_ARB_vertex_buffer_object,GL_EXT_framebuffer_object"
+        --profile="compatibility" --api="gl=2.0" --generator="c-debug" --spec="gl" --omit-khrplatform --extensions="GL_APPLE_vertex_array_object,GL_ARB_framebuffer_object,GL_ARB_get_program_binary,GL_ARB_pixel_buffer_object,GL_ARB_texture_float,GL_ARB_vertex_array_object,GL_ARB_vertex_buffer_object,GL_EXT_framebuffer_object"
     Online:
-        http://glad.dav1d.de/#profile=compatibility&language=c-debug&specification=gl&loader=on&api=gl%3D2.0&extensions=GL_APPLE_vertex_array_object&extensions=GL_ARB_framebuffer_object&extensions=GL_ARB_pixel_buffer_object&extensions=GL_ARB_texture_float&extensions=GL_ARB_vertex_array_object&extensions=GL_ARB_vertex_buffer_object&extensions=GL_EXT_framebuffer_object
+        http://glad.dav1d.de/#profile=compatibility&language=c-debug&specification=gl&loader=on&api=gl%3D2.0&extensions=GL_APPLE_vertex_array_object&extensions=GL_ARB_framebuffer_object&extensions=GL_ARB_get_program_binary&extensions=GL_ARB_pixel_buffer_object&extensions=GL_ARB_texture_float&extensions=GL_ARB_vertex_array_object&extensions=GL_ARB_vertex_buffer_object&extensions=GL_EXT_framebuffer_object
 */
 
 
@@ -3330,6 +3331,10 @@ GLAPI PFNGLVERTEXATTRIBPOINTERPROC glad_debug_glVertexAttribPointer;
 #define GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE 0x8D56
 #define GL_MAX_SAMPLES 0x8D57
 #define GL_INDEX 0x8222
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
 #define GL_PIXEL_PACK_BUFFER_ARB 0x88EB
 #define GL_PIXEL_UNPACK_BUFFER_ARB 0x88EC
 #define GL_PIXEL_PACK_BUFFER_BINDING_ARB 0x88ED
@@ -3541,6 +3546,22 @@ GLAPI PFNGLFRAMEBUFFERTEXTURELAYERPROC glad_glFramebufferTextureLayer;
 GLAPI PFNGLFRAMEBUFFERTEXTURELAYERPROC glad_debug_glFramebufferTextureLayer;
 #define glFramebufferTextureLayer glad_debug_glFramebufferTextureLayer
 #endif
+#ifndef GL_ARB_get_program_binary
+#define GL_ARB_get_program_binary 1
+GLAPI int GLAD_GL_ARB_get_program_binary;
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+GLAPI PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary;
+GLAPI PFNGLGETPROGRAMBINARYPROC glad_debug_glGetProgramBinary;
+#define glGetProgramBinary glad_debug_glGetProgramBinary
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+GLAPI PFNGLPROGRAMBINARYPROC glad_glProgramBinary;
+GLAPI PFNGLPROGRAMBINARYPROC glad_debug_glProgramBinary;
+#define glProgramBinary glad_debug_glProgramBinary
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+GLAPI PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri;
+GLAPI PFNGLPROGRAMPARAMETERIPROC glad_debug_glProgramParameteri;
+#define glProgramParameteri glad_debug_glProgramParameteri
+#endif
 #ifndef GL_ARB_pixel_buffer_object
 #define GL_ARB_pixel_buffer_object 1
 GLAPI int GLAD_GL_ARB_pixel_buffer_object;
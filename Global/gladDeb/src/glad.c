@@ -9,6 +9,7 @@
     Extensions:
         GL_APPLE_vertex_array_object,
         GL_ARB_framebuffer_object,
+        GL_ARB_get_program_binary,
         GL_ARB_pixel_buffer_object,
         GL_ARB_texture_float,
         GL_ARB_vertex_array_object,
@@ -19,9 +20,9 @@
     Omit khrplatform: True
 
     Commandline:
-        --profile="compatibility" --api="gl=2.0" --generator="c-debug" --spec="gl" --omit-khrplatform --extensions="GL_APPLE_vertex_array_object,GL_ARB_framebuffer_object,GL_ARB_pixel_buffer_object,GL_ARB_texture_float,GL_ARB_vertex_array_object,GL_ARB_vertex_buffer_object,GL_EXT_framebuffer_object"
+        --profile="compatibility" --api="gl=2.0" --generator="c-debug" --spec="gl" --omit-khrplatform --extensions="GL_APPLE_vertex_array_object,GL_ARB_framebuffer_object,GL_ARB_get_program_binary,GL_ARB_pixel_buffer_object,GL_ARB_texture_float,GL_ARB_vertex_array_object,GL_ARB_vertex_buffer_object,GL_EXT_framebuffer_object"
     Online:
-        http://glad.dav1d.de/#profile=compatibility&language=c-debug&specification=gl&loader=on&api=gl%3D2.0&extensions=GL_APPLE_vertex_array_object&extensions=GL_ARB_framebuffer_object&extensions=GL_ARB_pixel_buffer_object&extensions=GL_ARB_texture_float&extensions=GL_ARB_vertex_array_object&extensions=GL_ARB_vertex_buffer_object&extensions=GL_EXT_framebuffer_object
+        http://glad.dav1d.de/#profile=compatibility&language=c-debug&specification=gl&loader=on&api=gl%3D2.0&extensions=GL_APPLE_vertex_array_object&extensions=GL_ARB_framebuffer_object&extensions=GL_ARB_get_program_binary&extensions=GL_ARB_pixel_buffer_object&extensions=GL_ARB_texture_float&extensions=GL_ARB_vertex_array_object&extensions=GL_ARB_vertex_buffer_object&extensions=GL_EXT_framebuffer_object
 */
 
 #include <stdio.h>
@@ -4660,6 +4661,7 @@ int GLAD_GL_ARB_texture_float;
 int GLAD_GL_ARB_vertex_array_object;
 int GLAD_GL_ARB_vertex_buffer_object;
 int GLAD_GL_ARB_pixel_buffer_object;
+int GLAD_GL_ARB_get_program_binary;
 int GLAD_GL_APPLE_vertex_array_object;
 PFNGLBINDVERTEXARRAYAPPLEPROC glad_glBindVertexArrayAPPLE;
 void APIENTRY glad_debug_impl_glBindVertexArrayAPPLE(GLuint arg0) {    
@@ -4857,6 +4859,30 @@ void APIENTRY glad_debug_impl_glFramebufferTextureLayer(GLenum arg0, GLenum arg1
     
 }
 PFNGLFRAMEBUFFERTEXTURELAYERPROC glad_debug_glFramebufferTextureLayer = glad_debug_impl_glFramebufferTextureLayer;
+PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary;
+void APIENTRY glad_debug_impl_glGetProgramBinary(GLuint arg0, GLsizei arg1, GLsizei * arg2, GLenum * arg3, void * arg4) {    
+    _pre_call_callback("glGetProgramBinary", (void*)glGetProgramBinary, 5, arg0, arg1, arg2, arg3, arg4);
+     glad_glGetProgramBinary(arg0, arg1, arg2, arg3, arg4);
+    _post_call_callback("glGetProgramBinary", (void*)glGetProgramBinary, 5, arg0, arg1, arg2, arg3, arg4);
+    
+}
+PFNGLGETPROGRAMBINARYPROC glad_debug_glGetProgramBinary = glad_debug_impl_glGetProgramBinary;
+PFNGLPROGRAMBINARYPROC glad_glProgramBinary;
+void APIENTRY glad_debug_impl_glProgramBinary(GLuint arg0, GLenum arg1, const void * arg2, GLsizei arg3) {    
+    _pre_call_callback("glProgramBinary", (void*)glProgramBinary, 4, arg0, arg1, arg2, arg3);
+     glad_glProgramBinary(arg0, arg1, arg2, arg3);
+    _post_call_callback("glProgramBinary", (void*)glProgramBinary, 4, arg0, arg1, arg2, arg3);
+    
+}
+PFNGLPROGRAMBINARYPROC glad_debug_glProgramBinary = glad_debug_impl_glProgramBinary;
+PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri;
+void APIENTRY glad_debug_impl_glProgramParameteri(GLuint arg0, GLenum arg1, GLint arg2) {    
+    _pre_call_callback("glProgramParameteri", (void*)glProgramParameteri, 3, arg0, arg1, arg2);
+     glad_glProgramParameteri(arg0, arg1, arg2);
+    _post_call_callback("glProgramParameteri", (void*)glProgramParameteri, 3, arg0, arg1, arg2);
+    
+}
+PFNGLPROGRAMPARAMETERIPROC glad_debug_glProgramParameteri = glad_debug_impl_glProgramParameteri;
 PFNGLBINDVERTEXARRAYPROC glad_glBindVertexArray;
 void APIENTRY glad_debug_impl_glBindVertexArray(GLuint arg0) {    
     _pre_call_callback("glBindVertexArray", (void*)glBindVertexArray, 1, arg0);
@@ -5716,6 +5742,12 @@ static void load_GL_ARB_framebuffer_object(GLADloadproc load) {
 	glad_glRenderbufferStorageMultisample = (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC)load("glRenderbufferStorageMultisample");
 	glad_glFramebufferTextureLayer = (PFNGLFRAMEBUFFERTEXTURELAYERPROC)load("glFramebufferTextureLayer");
 }
+static void load_GL_ARB_get_program_binary(GLADloadproc load) {
+	if(!GLAD_GL_ARB_get_program_binary) return;
+	glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+	glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+	glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+}
 static void load_GL_ARB_vertex_array_object(GLADloadproc load) {
 	if(!GLAD_GL_ARB_vertex_array_object) return;
 	glad_glBindVertexArray = (PFNGLBINDVERTEXARRAYPROC)load("glBindVertexArray");
@@ -5761,6 +5793,7 @@ static int find_extensionsGL(void) {
 	if (!get_exts()) return 0;
 	GLAD_GL_APPLE_vertex_array_object = has_ext("GL_APPLE_vertex_array_object");
 	GLAD_GL_ARB_framebuffer_object = has_ext("GL_ARB_framebuffer_object");
+	GLAD_GL_ARB_get_program_binary = has_ext("GL_ARB_get_program_binary");
 	GLAD_GL_ARB_pixel_buffer_object = has_ext("GL_ARB_pixel_buffer_object");
 	GLAD_GL_ARB_texture_float = has_ext("GL_ARB_texture_float");
 	GLAD_GL_ARB_vertex_array_object = has_ext("GL_ARB_vertex_array_object");
@@ -5836,6 +5869,7 @@ int gladLoadGLLoader(GLADloadproc load) {
 	if (!find_extensionsGL()) return 0;
 	load_GL_APPLE_vertex_array_object(load);
 	load_GL_ARB_framebuffer_object(load);
+	load_GL_ARB_get_program_binary(load);
 	load_GL_ARB_vertex_array_object(load);
 	load_GL_ARB_vertex_buffer_object(load);
 	load_GL_EXT_framebuffer_object(load);
@@ -9,6 +9,7 @@
     Extensions:
         GL_APPLE_vertex_array_object,
         GL_ARB_framebuffer_object,
+        GL_ARB_get_program_binary,
         GL_ARB_pixel_buffer_object,
         GL_ARB_texture_float,
         GL_ARB_vertex_array_object,
@@ -19,9 +20,9 @@
     Omit khrplatform: True
 
     Commandline:
-        --profile="compatibility" --api="gl=2.0" --generator="c" --spec="gl" --omit-khrplatform --extensions="GL_APPLE_vertex_array_object,GL_ARB_framebuffer_object,GL_ARB_pixel_buffer_object,GL_ARB_texture_float,GL_ARB_vertex_array_object,GL_ARB_vertex_buffer_object,GL_EXT_framebuffer_object"
+        --profile="compatibility" --api="gl=2.0" --generator="c" --spec="gl" --omit-khrplatform --extensions="GL_APPLE_vertex_array_object,GL_ARB_framebuffer_object,GL_ARB_get_program_binary,GL_ARB_pixel_buffer_object,GL_ARB_texture_float,GL_ARB_vertex_array_object,GL_ARB_vertex_buffer_object,GL_EXT_framebuffer_object"
     Online:
-        http://glad.dav1d.de/#profile=compatibility&language=c&specification=gl&loader=on&api=gl%3D2.0&extensions=GL_APPLE_vertex_array_object&extensions=GL_ARB_framebuffer_object&extensions=GL_ARB_pixel_buffer_object&extensions=GL_ARB_texture_float&extensions=GL_ARB_vertex_array_object&extensions=GL_ARB_vertex_buffer_object&extensions=GL_EXT_framebuffer_object
+        http://glad.dav1d.de/#profile=compatibility&language=c&specification=gl&loader=on&api=gl%3D2.0&extensions=GL_APPLE_vertex_array_object&extensions=GL_ARB_framebuffer_object&extensions=GL_ARB_get_program_binary&extensions=GL_ARB_pixel_buffer_object&extensions=GL_ARB_texture_float&extensions=GL_ARB_vertex_array_object&extensions=GL_ARB_vertex_buffer_object&extensions=GL_EXT_framebuffer_object
 */
 
 #include <stdio.h>
@@ -799,6 +800,7 @@ int GLAD_GL_ARB_texture_float;
 int GLAD_GL_ARB_vertex_array_object;
 int GLAD_GL_ARB_vertex_buffer_object;
 int GLAD_GL_ARB_pixel_buffer_object;
+int GLAD_GL_ARB_get_program_binary;
 int GLAD_GL_APPLE_vertex_array_object;
 PFNGLBINDVERTEXARRAYAPPLEPROC glad_glBindVertexArrayAPPLE;
 PFNGLDELETEVERTEXARRAYSAPPLEPROC glad_glDeleteVertexArraysAPPLE;
@@ -824,6 +826,9 @@ PFNGLGENERATEMIPMAPPROC glad_glGenerateMipmap;
 PFNGLBLITFRAMEBUFFERPROC glad_glBlitFramebuffer;
 PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC glad_glRenderbufferStorageMultisample;
 PFNGLFRAMEBUFFERTEXTURELAYERPROC glad_glFramebufferTextureLayer;
+PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary;
+PFNGLPROGRAMBINARYPROC glad_glProgramBinary;
+PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri;
 PFNGLBINDVERTEXARRAYPROC glad_glBindVertexArray;
 PFNGLDELETEVERTEXARRAYSPROC glad_glDeleteVertexArrays;
 PFNGLGENVERTEXARRAYSPROC glad_glGenVertexArrays;
@@ -1452,6 +1457,12 @@ static void load_GL_ARB_framebuffer_object(GLADloadproc load) {
 	glad_glRenderbufferStorageMultisample = (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC)load("glRenderbufferStorageMultisample");
 	glad_glFramebufferTextureLayer = (PFNGLFRAMEBUFFERTEXTURELAYERPROC)load("glFramebufferTextureLayer");
 }
+static void load_GL_ARB_get_program_binary(GLADloadproc load) {
+	if(!GLAD_GL_ARB_get_program_binary) return;
+	glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+	glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+	glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+}
 static void load_GL_ARB_vertex_array_object(GLADloadproc load) {
 	if(!GLAD_GL_ARB_vertex_array_object) return;
 	glad_glBindVertexArray = (PFNGLBINDVERTEXARRAYPROC)load("glBindVertexArray");
@@ -1497,6 +1508,7 @@ static int find_extensionsGL(void) {
 	if (!get_exts()) return 0;
 	GLAD_GL_APPLE_vertex_array_object = has_ext("GL_APPLE_vertex_array_object");
 	GLAD_GL_ARB_framebuffer_object = has_ext("GL_ARB_framebuffer_object");
+	GLAD_GL_ARB_get_program_binary = has_ext("GL_ARB_get_program_binary");
 	GLAD_GL_ARB_pixel_buffer_object = has_ext("GL_ARB_pixel_buffer_object");
 	GLAD_GL_ARB_texture_float = has_ext("GL_ARB_texture_float");
 	GLAD_GL_ARB_vertex_array_object = has_ext("GL_ARB_vertex_array_object");
@@ -1572,6 +1584,7 @@ int gladLoadGLLoader(GLADloadproc load) {
 	if (!find_extensionsGL()) return 0;
 	load_GL_APPLE_vertex_array_object(load);
 	load_GL_ARB_framebuffer_object(load);
+	load_GL_ARB_get_program_binary(load);
 	load_GL_ARB_vertex_array_object(load);
 	load_GL_ARB_vertex_buffer_object(load);
 	load_GL_EXT_framebuffer_object(load);
@@ -25,7 +25,12 @@
 
 #include "AnimItemBase.h"
 
+#include <map>
 #include <stdexcept>
+#include <utility>
+
+#include <QtCore/QThread>
+#include <QtCore/QCoreApplication>
 
 #include "Engine/AnimatingObjectI.h"
 #include "Engine/Curve.h"
@@ -40,9 +45,13 @@ public:
     AnimItemBase* publicInterface;
     AnimationModuleBaseWPtr model;
 
+    // The merged keyframes of each dimension/view, see getMergedKeyframesCached()
+    std::map<std::pair<int, int>, KeyFrameSet> mergedKeyframesCache;
+
     AnimItemBasePrivate(AnimItemBase* publicInterface, const AnimationModuleBasePtr& model)
     : publicInterface(publicInterface)
     , model(model)
+    , mergedKeyframesCache()
     {
 
     }
@@ -176,6 +185,26 @@ AnimItemBase::getKeyframes(DimSpec dimension, ViewSetSpec viewSpec, GetKeyframes
     }
 } // getKeyframes
 
+const KeyFrameSet&
+AnimItemBase::getMergedKeyframesCached(DimSpec dimension, ViewSetSpec view) const
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+
+    std::pair<std::map<std::pair<int, int>, KeyFrameSet>::iterator, bool> ret = _imp->mergedKeyframesCache.insert( std::make_pair( std::make_pair( (int)dimension, (int)view ), KeyFrameSet() ) );
+    if (ret.second) {
+        getKeyframes(dimension, view, eGetKeyframesTypeMerged, &ret.first->second);
+    }
+
+    return ret.first->second;
+}
+
+void
+AnimItemBase::invalidateKeyframesCache()
+{
+    _imp->mergedKeyframesCache.clear();
+}
+
 void
 AnimItemBase::getKeyframes(DimSpec dimension, ViewSetSpec viewSpec, AnimItemDimViewKeyFramesMap *result) const
 {
@@ -200,6 +200,18 @@ public:
      **/
     void getKeyframes(DimSpec dimension, ViewSetSpec view, AnimItemDimViewKeyFramesMap *result) const;
 
+    /**
+     * @brief Same as getKeyframes with eGetKeyframesTypeMerged, except that the result is kept for each dimension/view
+     * until invalidateKeyframesCache() is called. This is used to draw the rows of the dope sheet without querying the curves
+     * each time the view is redrawn. May only be called on the main thread.
+     **/
+    const KeyFrameSet& getMergedKeyframesCached(DimSpec dimension, ViewSetSpec view) const;
+
+    /**
+     * @brief Must be called when the keyframes of a curve of the item, its views or its visible dimensions change
+     **/
+    void invalidateKeyframesCache();
+
     /**
      * @brief Returns the views available in the item.
      **/
@@ -28,6 +28,7 @@
 #include <algorithm> // min, max
 #include <limits>
 #include <stdexcept>
+#include <vector>
 
 // Qt includes
 #include <QApplication>
@@ -357,18 +358,9 @@ AnimationModuleViewPrivate::drawDopeSheetScale() const
 
 
 void
-AnimationModuleViewPrivate::drawDopeSheetTreeItemRecursive(QTreeWidgetItem* item,  std::list<NodeAnimPtr>* nodesRowsOrdered) const
+AnimationModuleViewPrivate::drawDopeSheetTreeItem(QTreeWidgetItem* item,  std::list<NodeAnimPtr>* nodesRowsOrdered) const
 {
     assert(item);
-    if ( item->isHidden() ) {
-        return;
-    }
-
-    QTreeWidgetItem* parentItem = item->parent();
-    if (parentItem && !parentItem->isExpanded()) {
-        return;
-    }
-
     AnimatedItemTypeEnum type = (AnimatedItemTypeEnum)item->data(0, QT_ROLE_CONTEXT_TYPE).toInt();
     void* ptr = item->data(0, QT_ROLE_CONTEXT_ITEM_POINTER).value<void*>();
     assert(ptr);
@@ -408,14 +400,7 @@ AnimationModuleViewPrivate::drawDopeSheetTreeItemRecursive(QTreeWidgetItem* item
     } else if (isTableItemAnim) {
         drawDopeSheetTableItemRow(item, isTableItemAnim, type, dimension, view);
     }
-
-    int nChildren = item->childCount();
-    for (int i = 0; i < nChildren; ++i) {
-        QTreeWidgetItem* child = item->child(i);
-        drawDopeSheetTreeItemRecursive(child, nodesRowsOrdered);
-    }
-
-} // drawDopeSheetTreeItemRecursive
+} // drawDopeSheetTreeItem
 
 void
 AnimationModuleViewPrivate::drawDopeSheetRows() const
@@ -427,14 +412,27 @@ AnimationModuleViewPrivate::drawDopeSheetRows() const
         GL_GPU::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         std::list<NodeAnimPtr> nodesAnimOrdered;
-        int nTopLevelTreeItems = treeView->topLevelItemCount();
-        for (int i = 0; i < nTopLevelTreeItems; ++i) {
-            QTreeWidgetItem* topLevelItem = treeView->topLevelItem(i);
-            if (!topLevelItem) {
-                continue;
+
+        // Only draw the rows that are visible in the tree view: a project may have thousands of animated knobs
+        QTreeWidgetItem* firstVisibleItem = treeView->itemAt(0, 0);
+        if (firstVisibleItem) {
+
+            // The rows of the parents are drawn first, because the overlay of a node covers the rows of its children
+            std::vector<QTreeWidgetItem*> parentItems;
+            for (QTreeWidgetItem* parent = firstVisibleItem->parent(); parent; parent = parent->parent()) {
+                parentItems.push_back(parent);
+            }
+            for (std::vector<QTreeWidgetItem*>::reverse_iterator it = parentItems.rbegin(); it != parentItems.rend(); ++it) {
+                drawDopeSheetTreeItem(*it, &nodesAnimOrdered);
+            }
+
+            double viewportBottom = std::max( (double)treeView->viewport()->height(), dopeSheetZoomContext.screenHeight() );
+            for (QTreeWidgetItem* item = firstVisibleItem; item; item = treeView->itemBelow(item)) {
+                if (treeView->visualItemRect(item).top() > viewportBottom) {
+                    break;
+                }
+                drawDopeSheetTreeItem(item, &nodesAnimOrdered);
             }
-            drawDopeSheetTreeItemRecursive(topLevelItem, &nodesAnimOrdered);
-            
         }
 
         // Draw node rows separations
@@ -679,8 +677,7 @@ AnimationModuleViewPrivate::drawDopeSheetKeyframes(QTreeWidgetItem* treeItem, co
     double singleSelectedTime;
     bool hasSingleKfTimeSelected = selectModel->hasSingleKeyFrameTimeSelected(&singleSelectedTime);
 
-    KeyFrameSet dimViewKeys;
-    item->getKeyframes(dimension, view, AnimItemBase::eGetKeyframesTypeMerged, &dimViewKeys);
+    const KeyFrameSet& dimViewKeys = item->getMergedKeyframesCached(dimension, view);
 
     QRectF nameItemRect = treeView->visualItemRect(treeItem);
     QRectF rowRect = nameItemRectToRowRect(nameItemRect);
@@ -707,9 +704,17 @@ AnimationModuleViewPrivate::drawDopeSheetKeyframes(QTreeWidgetItem* treeItem, co
     }
 
 
-    for (KeyFrameSet::const_iterator it = dimViewKeys.begin(); it != dimViewKeys.end(); ++it) {
+    // Only draw the keyframes whose texture intersects the visible time range
+    double keyframeTexHalfWidth = TO_DPIX( getKeyframeTextureSize() ) / 2. * dopeSheetZoomContext.screenPixelWidth();
+    double visibleRight = dopeSheetZoomContext.right() + keyframeTexHalfWidth;
+    KeyFrameSet::const_iterator firstVisibleKey = dimViewKeys.lower_bound( KeyFrame(dopeSheetZoomContext.left() - keyframeTexHalfWidth, 0.) );
+
+    for (KeyFrameSet::const_iterator it = firstVisibleKey; it != dimViewKeys.end(); ++it) {
 
         const TimeValue keyTime = it->getTime();
+        if (keyTime > visibleRight) {
+            break;
+        }
         RectD zoomKfRect = getKeyFrameBoundingRectCanonical(dopeSheetZoomContext, keyTime, rowCenterYCanonical);
 
         bool isKeyFrameSelected = selectModel->isKeyframeSelected(item, dimension, view, TimeValue(keyTime));
@@ -747,15 +752,7 @@ AnimationModuleViewPrivate::drawDopeSheetKeyframes(QTreeWidgetItem* treeItem, co
     } // for all keyframes
 
     // Draw selection highlight
-    bool itemSelected = false;
-    QList<QTreeWidgetItem*> selectedItems = animModel->getEditor()->getTreeView()->selectedItems();
-    for (QList<QTreeWidgetItem*>::const_iterator it = selectedItems.begin(); it!=selectedItems.end(); ++it) {
-        if (*it == treeItem) {
-            itemSelected = true;
-            break;
-        }
-    }
-    if (itemSelected) {
+    if ( treeItem->isSelected() ) {
         GL_GPU::Color4f(selectionColorRGB[0], selectionColorRGB[1], selectionColorRGB[2], 0.15);
 
         GL_GPU::Begin(GL_POLYGON);
@@ -165,7 +165,7 @@ public:
 
     void drawDopeSheetRows() const;
 
-    void drawDopeSheetTreeItemRecursive(QTreeWidgetItem* item, std::list<NodeAnimPtr>* nodesRowsOrdered) const;
+    void drawDopeSheetTreeItem(QTreeWidgetItem* item, std::list<NodeAnimPtr>* nodesRowsOrdered) const;
 
     void drawDopeSheetNodeRow(QTreeWidgetItem* treeItem, const NodeAnimPtr& item) const;
     void drawDopeSheetKnobRow(QTreeWidgetItem* treeItem, const KnobAnimPtr& item, DimSpec dimension, ViewSetSpec view) const;
@@ -26,6 +26,7 @@
 #include "CachedFramesThread.h"
 
 #include <map>
+#include <set>
 #include <QMutex>
 #include <QWaitCondition>
 
@@ -36,6 +37,7 @@
 
 #include "Engine/Cache.h"
 #include "Engine/CacheEntryKeyBase.h"
+#include "Engine/FrameViewRequest.h"
 #include "Engine/Node.h"
 #include "Engine/ImageCacheKey.h"
 #include "Engine/ImageCacheEntry.h"
@@ -51,6 +53,75 @@
 
 NATRON_NAMESPACE_ENTER
 
+// For a persistent cache, entries evicted by other processes are not notified to the listener: every so many refreshes
+// all frames are looked-up again in the cache.
+#define NATRON_CACHED_FRAMES_PERSISTENT_CACHE_CHECK_INTERVAL 25
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Records the entries removed from the tile cache between 2 refreshes so that the refresh
+ * only has to look-up the cache for the frames that were never checked before.
+ **/
+class CachedFramesCacheListener : public CacheListener
+{
+    QMutex _lock;
+    std::set<U64> _removedEntries;
+    bool _cleared;
+
+public:
+
+    CachedFramesCacheListener()
+    : CacheListener()
+    , _lock()
+    , _removedEntries()
+    , _cleared(false)
+    {
+
+    }
+
+    virtual ~CachedFramesCacheListener()
+    {
+
+    }
+
+    virtual void onCacheEntryInserted(U64 hash) OVERRIDE FINAL
+    {
+        // The entry was rendered again since it was removed
+        QMutexLocker k(&_lock);
+        _removedEntries.erase(hash);
+    }
+
+    virtual void onCacheEntryRemoved(U64 hash) OVERRIDE FINAL
+    {
+        QMutexLocker k(&_lock);
+        _removedEntries.insert(hash);
+    }
+
+    virtual void onCacheCleared() OVERRIDE FINAL
+    {
+        QMutexLocker k(&_lock);
+        _removedEntries.clear();
+        _cleared = true;
+    }
+
+    /**
+     * @brief Returns the events received since the last call
+     **/
+    void takeEvents(std::set<U64>* removedEntries, bool* cleared)
+    {
+        QMutexLocker k(&_lock);
+        removedEntries->swap(_removedEntries);
+        _removedEntries.clear();
+        *cleared = _cleared;
+        _cleared = false;
+    }
+};
+
+typedef boost::shared_ptr<CachedFramesCacheListener> CachedFramesCacheListenerPtr;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 struct CachedFramesThread::Implementation
 {
     ViewerTab* viewer;
@@ -58,6 +129,16 @@ struct CachedFramesThread::Implementation
     QMutex cachedFramesMutex;
     std::list<TimeValue> cachedFrames;
 
+    // Registered to the tile cache for the lifetime of the thread
+    CachedFramesCacheListenerPtr cacheListener;
+
+    // The hash of the cache entry of each frame that was found in the cache. Frames in this map are only looked-up again
+    // in the cache if their entry changes. Only accessed by the thread.
+    std::map<FrameViewPair, U64, FrameView_compare_less> checkedFrames;
+
+    // Counts refreshes to periodically look-up all frames again in a persistent cache
+    int nRefreshesSinceFullCheck;
+
     QMutex mustQuitMutex;
     QWaitCondition mustQuitCond;
     bool mustQuit;
@@ -69,6 +150,9 @@ struct CachedFramesThread::Implementation
     : viewer(viewer)
     , cachedFramesMutex()
     , cachedFrames()
+    , cacheListener(new CachedFramesCacheListener)
+    , checkedFrames()
+    , nRefreshesSinceFullCheck(0)
     , mustQuitMutex()
     , mustQuitCond()
     , mustQuit(false)
@@ -100,11 +184,19 @@ CachedFramesThread::CachedFramesThread(ViewerTab* viewer)
 
     TimeLineGui* timeline = viewer->getTimeLineGui();
     QObject::connect(this, SIGNAL(cachedFramesRefreshed()), timeline, SLOT(update()));
+
+    CacheBasePtr cache = appPTR->getTileCache();
+    if (cache) {
+        cache->registerListener(_imp->cacheListener);
+    }
 }
 
 CachedFramesThread::~CachedFramesThread()
 {
-
+    CacheBasePtr cache = appPTR->getTileCache();
+    if (cache) {
+        cache->unregisterListener(_imp->cacheListener);
+    }
 }
 
 
@@ -149,7 +241,21 @@ CachedFramesThread::Implementation::refreshCachedFramesInternal()
     }
     // For all frames in the map:
     // 1) Check the hash is still valid at that frame
-    // 2) Check if the cache still has a tile entry for this frame
+    // 2) Check if the cache still has a tile entry for this frame: the cache is only looked-up for frames that were not
+    // checked before, for the others the entries removed from the cache were notified to the listener.
+
+    std::set<U64> removedEntries;
+    bool cacheCleared;
+    cacheListener->takeEvents(&removedEntries, &cacheCleared);
+
+    CacheBasePtr cache = appPTR->getTileCache();
+    if (cacheCleared) {
+        // Some frames may have been rendered again since the cache was cleared, look them all up
+        checkedFrames.clear();
+    } else if ( cache && cache->isPersistent() && (++nRefreshesSinceFullCheck >= NATRON_CACHED_FRAMES_PERSISTENT_CACHE_CHECK_INTERVAL) ) {
+        checkedFrames.clear();
+        nRefreshesSinceFullCheck = 0;
+    }
 
 
     std::set<TimeValue> existingCachedFrames;
@@ -160,6 +266,7 @@ CachedFramesThread::Implementation::refreshCachedFramesInternal()
             existingCachedFrames.insert(*it);
         }
     }
+    std::map<FrameViewPair, U64, FrameView_compare_less> updatedCheckedFrames;
     bool hasChanged = false;
     for (ViewerCachedImagesMap::const_iterator it = framesDisplayed.begin(); it != framesDisplayed.end(); ++it) {
 
@@ -169,10 +276,15 @@ CachedFramesThread::Implementation::refreshCachedFramesInternal()
         // Check if it is still cached
         {
             U64 hash = it->second->getHash();
-            bool isCached = appPTR->getTileCache()->hasCacheEntryForHash(hash);
+            std::map<FrameViewPair, U64, FrameView_compare_less>::const_iterator foundChecked = checkedFrames.find(it->first);
+            bool isCached;
+            if ( foundChecked != checkedFrames.end() && foundChecked->second == hash ) {
+                isCached = removedEntries.find(hash) == removedEntries.end();
+            } else {
+                isCached = cache && cache->hasCacheEntryForHash(hash);
+            }
             if (!isCached) {
                 isValid = false;
-
             }
         }
 
@@ -196,6 +308,7 @@ CachedFramesThread::Implementation::refreshCachedFramesInternal()
         if (!isValid) {
             viewer->getViewer()->removeViewerProcessHashAtTime(it->first.time, it->first.view);
         } else {
+            updatedCheckedFrames[it->first] = it->second->getHash();
             updatedCachedFrames.insert(it->first.time);
             std::set<TimeValue>::iterator found = existingCachedFrames.find(it->first.time);
             if (found == existingCachedFrames.end()) {
@@ -206,6 +319,8 @@ CachedFramesThread::Implementation::refreshCachedFramesInternal()
 
     }
 
+    checkedFrames.swap(updatedCheckedFrames);
+
     if (!hasChanged) {
         // Check if we removed a keyframe that existed
         for (std::set<TimeValue>::iterator it = existingCachedFrames.begin(); it != existingCachedFrames.end(); ++it) {
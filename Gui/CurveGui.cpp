@@ -80,6 +80,16 @@ struct CurveGuiPrivate
     double color[4]; // the color that must be used to draw the curve
     int lineWidth; // its thickness
 
+    // The polyline sampled from the keyframes by drawCurve(), in curve coordinates.
+    // It is sampled again only when the curve or the visible area of the widget change.
+    std::vector<float> sampledVertices;
+    bool sampledVerticesValid;
+    U64 sampledCurveRevision;
+    QPointF sampledBtmLeft, sampledTopRight;
+
+    // The vertices passed to the GPU by drawLineStrip(), kept to avoid re-allocating them on each redraw
+    std::vector<float> lineStripVertices;
+
     CurveGuiPrivate(AnimationModuleView *curveWidget,
                     const AnimItemBasePtr& item, DimIdx dimension, ViewIdx view)
     : curveWidget(curveWidget)
@@ -89,6 +99,12 @@ struct CurveGuiPrivate
     , internalCurve()
     , color()
     , lineWidth(1.)
+    , sampledVertices()
+    , sampledVerticesValid(false)
+    , sampledCurveRevision(0)
+    , sampledBtmLeft()
+    , sampledTopRight()
+    , lineStripVertices()
     {
 
         QColor tmpColor;
@@ -104,6 +120,11 @@ struct CurveGuiPrivate
         assert(internalCurve.lock());
 
     }
+
+    bool isSampledCurveValid(U64 curveRevision, const QPointF& btmLeft, const QPointF& topRight) const
+    {
+        return sampledVerticesValid && sampledCurveRevision == curveRevision && sampledBtmLeft == btmLeft && sampledTopRight == topRight;
+    }
 };
 
 CurveGui::CurveGui(AnimationModuleView *curveWidget,
@@ -419,15 +440,21 @@ CurveGui::nextPointForSegment(const double x, // < in curve coordinates
 
 
 
+/**
+ * @brief Draws the given vertices with a single draw call. The parts of the curve outside of the visible area
+ * are skipped. lineStrip is only used as storage for the vertices actually drawn.
+ **/
 static void
 drawLineStrip(const std::vector<float>& vertices,
               const QPointF& btmLeft,
-              const QPointF& topRight)
+              const QPointF& topRight,
+              std::vector<float>* lineStrip)
 {
     if (vertices.empty()) {
         return;
     }
-    GL_GPU::Begin(GL_LINE_STRIP);
+    lineStrip->clear();
+    lineStrip->reserve(vertices.size() + 2);
 
     bool prevVisible = true;
     bool prevTooAbove = false;
@@ -451,15 +478,24 @@ drawLineStrip(const std::vector<float>& vertices,
             //At least draw the previous point otherwise this will draw a line between the last previous point and this point
             //Draw them 10000 units further so that we're sure we don't see half of a pixel of a line remaining
             if (previousWasTooAbove) {
-                GL_GPU::Vertex2f(vertices[i - 2], vertices[i - 1] + 100000);
+                lineStrip->push_back(vertices[i - 2]);
+                lineStrip->push_back(vertices[i - 1] + 100000);
             } else if (previousWasTooBelow) {
-                GL_GPU::Vertex2f(vertices[i - 2], vertices[i - 1] - 100000);
+                lineStrip->push_back(vertices[i - 2]);
+                lineStrip->push_back(vertices[i - 1] - 100000);
             }
         }
-        GL_GPU::Vertex2f(vertices[i], vertices[i + 1]);
+        lineStrip->push_back(vertices[i]);
+        lineStrip->push_back(vertices[i + 1]);
     }
 
-    GL_GPU::End();
+    if (lineStrip->empty()) {
+        return;
+    }
+    GL_GPU::EnableClientState(GL_VERTEX_ARRAY);
+    GL_GPU::VertexPointer(2, GL_FLOAT, 0, &lineStrip->front());
+    GL_GPU::DrawArrays(GL_LINE_STRIP, 0, (GLsizei)(lineStrip->size() / 2));
+    GL_GPU::DisableClientState(GL_VERTEX_ARRAY);
 }
 
 class KeyFrameWithStringTimePredicate
@@ -492,7 +528,7 @@ CurveGui::drawCurve(int curveIndex,
         return;
     }
 
-    std::vector<float> vertices, exprVertices;
+    std::vector<float> constantVertices, exprVertices;
     const double widgetWidth = _imp->curveWidget->width();
     KeyFrameSet keyframes;
     bool hasDrawnExpr = false;
@@ -519,10 +555,16 @@ CurveGui::drawCurve(int curveIndex,
     bool isPeriodic = false;
     std::pair<double,double> parametricRange = std::make_pair(-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity());
 
-    keyframes = getInternalCurve()->getKeyFrames_mt_safe();
-    isPeriodic = getInternalCurve()->isCurvePeriodic();
-    parametricRange = getInternalCurve()->getXRange();
+    CurvePtr curve = getInternalCurve();
+
+    // Read the revision before the keyframes: if the curve changes in-between, the vertices will be sampled again on the next redraw
+    const U64 curveRevision = curve->getRevision();
+    keyframes = curve->getKeyFrames_mt_safe();
+    isPeriodic = curve->isCurvePeriodic();
+    parametricRange = curve->getXRange();
 
+    // The vertices of a curve without keyframes depend on the knob value and are not cached, but there are only 2 of them.
+    const std::vector<float>* vertices = &constantVertices;
     if ( keyframes.empty() ) {
         // Add a horizontal line for constant knobs, except string knobs.
         KnobIPtr isKnob = boost::dynamic_pointer_cast<KnobI>(item->getInternalAnimItem());
@@ -531,13 +573,17 @@ CurveGui::drawCurve(int curveIndex,
             KnobStringBasePtr isString = boost::dynamic_pointer_cast<KnobStringBase>(isKnob);
             if (!isString) {
                 double value = evaluate(false, 0);
-                vertices.push_back(btmLeft.x() + 1);
-                vertices.push_back(value);
-                vertices.push_back(topRight.x() - 1);
-                vertices.push_back(value);
+                constantVertices.push_back(btmLeft.x() + 1);
+                constantVertices.push_back(value);
+                constantVertices.push_back(topRight.x() - 1);
+                constantVertices.push_back(value);
             }
         }
+    } else if ( _imp->isSampledCurveValid(curveRevision, btmLeft, topRight) ) {
+        vertices = &_imp->sampledVertices;
     } else {
+        vertices = &_imp->sampledVertices;
+        _imp->sampledVertices.clear();
         try {
             double x1 = 0;
             double x2;
@@ -556,8 +602,8 @@ CurveGui::drawCurve(int curveIndex,
                     y = x1Key.getValue();
                 }
 
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+                _imp->sampledVertices.push_back( (float)x );
+                _imp->sampledVertices.push_back( (float)y );
                 nextPointForSegment(x, keyframes, isPeriodic, parametricRange.first, parametricRange.second,  &lastUpperIt, &x2, &x1Key, &isX1AKey);
                 x1 = x2;
             }
@@ -565,15 +611,19 @@ CurveGui::drawCurve(int curveIndex,
             {
                 double x = _imp->curveWidget->toZoomCoordinates(x1, 0).x();
                 double y = evaluate(false, x);
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+                _imp->sampledVertices.push_back( (float)x );
+                _imp->sampledVertices.push_back( (float)y );
             }
         } catch (...) {
         }
+        _imp->sampledVerticesValid = true;
+        _imp->sampledCurveRevision = curveRevision;
+        _imp->sampledBtmLeft = btmLeft;
+        _imp->sampledTopRight = topRight;
     }
 
     // No Expr curve or no vertices for the curve, don't draw anything else
-    if (exprVertices.empty() && vertices.empty()) {
+    if ( exprVertices.empty() && vertices->empty() ) {
         return;
     }
 
@@ -636,11 +686,11 @@ CurveGui::drawCurve(int curveIndex,
         GL_GPU::LineWidth(1.5);
         glCheckError(GL_GPU);
         if (hasDrawnExpr) {
-            drawLineStrip(exprVertices, btmLeft, topRight);
+            drawLineStrip(exprVertices, btmLeft, topRight, &_imp->lineStripVertices);
             GL_GPU::LineStipple(2, 0xAAAA);
             GL_GPU::Enable(GL_LINE_STIPPLE);
         }
-        drawLineStrip(vertices, btmLeft, topRight);
+        drawLineStrip(*vertices, btmLeft, topRight, &_imp->lineStripVertices);
         if (hasDrawnExpr) {
             GL_GPU::Disable(GL_LINE_STIPPLE);
         }
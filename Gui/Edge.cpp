@@ -33,6 +33,7 @@
 #include <QPainter>
 #include <QApplication>
 #include <QGraphicsScene>
+#include <QStyleOption>
 
 #include "Gui/NodeGui.h"
 #include "Gui/NodeGraph.h"
@@ -58,6 +59,7 @@
 #define ARROW_SIZE_CONNECTED 14
 #define ARROW_SIZE_DISCONNECTED 10
 #define ARROW_HEAD_ANGLE ( (2 * M_PI) / 15 ) // 24 degrees opening angle is a nice thin arrow
+#define ARROW_SIZE_MIN_PX 3 // below this size on screen, arrow heads and bend points are not drawn
 
 // number of offset pixels from the arrow that determine if a click is contained in the arrow or not
 #define kGraphicalContainerOffset 10
@@ -743,7 +745,10 @@ Edge::paint(QPainter *painter,
             const QStyleOptionGraphicsItem * /*options*/,
             QWidget * /*parent*/)
 {
-    bool antialias = appPTR->getCurrentSettings()->isNodeGraphAntiAliasingEnabled();
+    // When zoomed out, only draw the line, without antialiasing
+    const double levelOfDetail = QStyleOptionGraphicsItem::levelOfDetailFromTransform( painter->worldTransform() );
+    const bool drawDetails = ARROW_SIZE_CONNECTED * levelOfDetail >= ARROW_SIZE_MIN_PX;
+    bool antialias = drawDetails && appPTR->getCurrentSettings()->isNodeGraphAntiAliasingEnabled();
 
     if (!antialias) {
         painter->setRenderHint(QPainter::Antialiasing, false);
@@ -785,6 +790,10 @@ Edge::paint(QPainter *painter,
 
     painter->drawLine( line() );
 
+    if (!drawDetails) {
+        return;
+    }
+
     myPen.setStyle(Qt::SolidLine);
     painter->setPen(myPen);
 
@@ -956,7 +965,9 @@ LinkArrow::paint(QPainter *painter,
         return;
     }
 
-    bool antialias = appPTR->getCurrentSettings()->isNodeGraphAntiAliasingEnabled();
+    const double levelOfDetail = QStyleOptionGraphicsItem::levelOfDetailFromTransform( painter->worldTransform() );
+    const bool drawDetails = ARROW_SIZE_CONNECTED * levelOfDetail >= ARROW_SIZE_MIN_PX;
+    bool antialias = drawDetails && appPTR->getCurrentSettings()->isNodeGraphAntiAliasingEnabled();
 
     if (!antialias) {
         painter->setRenderHint(QPainter::Antialiasing, false);
@@ -969,7 +980,7 @@ LinkArrow::paint(QPainter *painter,
     QLineF l = line();
     painter->drawLine(l);
 
-    if (_arrowVisible) {
+    if (_arrowVisible && drawDetails) {
         myPen.setStyle(Qt::SolidLine);
         painter->setPen(myPen);
 
@@ -130,6 +130,7 @@ SOURCES += \
     GuiGLContext.cpp \
     GuiPrivate.cpp \
     Histogram.cpp \
+    HistogramGPU.cpp \
     InfoViewerWidget.cpp \
     KnobAnim.cpp \
     KnobGui.cpp \
@@ -281,6 +282,7 @@ HEADERS += \
     GuiMacros.h \
     GuiPrivate.h \
     Histogram.h \
+    HistogramGPU.h \
     InfoViewerWidget.h \
     KnobAnim.h \
     KnobGui.h \
@@ -47,6 +47,7 @@
 
 #include "Engine/CLArgs.h"
 #include "Engine/CreateNodeArgs.h"
+#include "Engine/Half.h"
 #include "Engine/Image.h"
 #include "Engine/Lut.h" // floatToInt, LutManager
 #include "Engine/Node.h"
@@ -669,6 +670,9 @@ Gui::debugImage(const ImagePtr& image,
         case eImageBitDepthShort:
             debugImageInternal<unsigned short>(roi, imageData, output);
             break;
+        case eImageBitDepthHalf:
+            debugImageInternal<Half>(roi, imageData, output);
+            break;
         default:
             return;
     }
@@ -46,6 +46,7 @@
 #include "Engine/NodeGroup.h"
 #include "Engine/Plugin.h"
 #include "Engine/ProcessHandler.h"
+#include "Engine/ProjectAutoSaveJournal.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/Settings.h"
 #include "Engine/DiskCacheNode.h"
@@ -446,7 +447,7 @@ GuiAppInstance::findAndTryLoadUntitledAutoSave()
         searchStr.append( QString::fromUtf8(NATRON_PROJECT_FILE_EXT) );
         searchStr.append( QString::fromUtf8(".autosave") );
         int suffixPos = entry.indexOf(searchStr);
-        if (suffixPos == -1) {
+        if ( (suffixPos == -1) || ProjectAutoSaveJournal::isJournalFile(entry) ) {
             continue;
         }
 
@@ -1010,7 +1011,7 @@ GuiAppInstance::setDraftRenderEnabled(bool b)
 bool
 GuiAppInstance::isRenderStatsActionChecked() const
 {
-    return _imp->_gui->areRenderStatsEnabled();
+    return _imp->_gui->areRenderStatsEnabled() || AppInstance::isRenderStatsActionChecked();
 }
 
 bool
@@ -45,6 +45,7 @@ CLANG_DIAG_ON(uninitialized)
 #endif
 
 #include "Engine/Settings.h"
+#include "Engine/StartupProfiler.h"
 #include "Engine/EffectInstance.h" // PLUGINID_OFX_*
 #include "Engine/PluginActionShortcut.h"
 #include "Gui/QtEnumConvert.h"
@@ -878,6 +879,8 @@ GuiApplicationManager::initGui(const CLArgs& args)
 #endif
 #endif
 
+    StartupProfiler::beginPhase("Fonts and icons");
+
     //load custom fonts
     QString fontResource = QString::fromUtf8(":/Resources/Fonts/%1.ttf");
     QStringList fontFilenames;
@@ -947,6 +950,8 @@ GuiApplicationManager::initGui(const CLArgs& args)
     }
     getCurrentSettings()->populateSystemFonts(systemFonts);
 
+    StartupProfiler::endPhase();
+
     _imp->createColorPickerCursor();
     _imp->createLinkToCursor();
     _imp->createLinkMultCursor();
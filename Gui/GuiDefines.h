@@ -41,6 +41,7 @@
 
 #define NATRON_PREVIEW_WIDTH 64
 #define NATRON_PREVIEW_HEIGHT 38
+#define NATRON_PREVIEW_REFRESH_DELAY_MS 300 // after the last change, before the preview is computed
 
 #define NODE_WIDTH 80
 #define NODE_HEIGHT 30
@@ -83,6 +83,7 @@ class QStyleOptionViewItem;
 class QTabWidget;
 class QTextBrowser;
 class QTextCharFormat;
+class QTimer;
 class QToolBar;
 class QToolButton;
 class QTreeWidget;
@@ -130,7 +131,7 @@ class Gui;
 class GuiAppInstance;
 class GuiGLContext;
 class Histogram;
-class Histogram;
+class HistogramGPU;
 class HostOverlay;
 class InfoViewerWidget;
 class KeybindRecorder;
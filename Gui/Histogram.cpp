@@ -26,6 +26,7 @@
 #include "Histogram.h"
 
 #include <algorithm> // min, max
+#include <cmath> // exp, cos, sin
 #include <stdexcept>
 
 #include <QHBoxLayout>
@@ -61,6 +62,7 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 #include "Gui/GuiApplicationManager.h"
 #include "Gui/GuiDefines.h"
 #include "Gui/GuiMacros.h"
+#include "Gui/HistogramGPU.h"
 #include "Gui/Menu.h"
 #include "Gui/NodeGraph.h"
 #include "Gui/Shaders.h"
@@ -74,6 +76,24 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 #include "Serialization/WorkspaceSerialization.h"
 
 
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288   /* pi             */
+#endif
+
+// The histogram computed on the GPU has that many bins for each displayed bin, as the CPU one
+#define NATRON_HISTOGRAM_GPU_UPSCALE 5
+
+// The range of values displayed by the waveform
+#define NATRON_WAVEFORM_MIN -0.1
+#define NATRON_WAVEFORM_MAX 1.1
+
+// The maximum size of the waveform and vectorscope, in bins
+#define NATRON_SCOPE_MAX_SIZE 1024
+
+// Brightness of the waveform and vectorscope: a bin receiving that many times the average count of a bin is
+// displayed with 63% of the full brightness
+#define NATRON_SCOPE_INTENSITY 2.
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -103,11 +123,14 @@ public:
         , viewerCurrentInputGroup(NULL)
         , modeActions(0)
         , modeMenu(NULL)
+        , scopeActions(0)
+        , scopeMenu(NULL)
         , fullImage(NULL)
         , filterActions(0)
         , filterMenu(NULL)
         , widget(widget)
         , mode(Histogram::eDisplayModeRGB)
+        , scope(Histogram::eScopeTypeHistogram)
         , oldClick()
         , zoomCtx(0.000001, 1000000.)
         , state(eEventStateNone)
@@ -123,6 +146,7 @@ public:
         , bValueStr()
         , filterSize(0)
         , histogramThread(HistogramCPUThread::create())
+        , cpuHistogramPending(false)
         , histogram1()
         , histogram2()
         , histogram3()
@@ -132,6 +156,12 @@ public:
         , binsCount(0)
         , mipMapLevel(0)
         , hasImage(false)
+        , scopeData()
+        , scopeWidth(0)
+        , scopeHeight(0)
+        , scopePixelsCount(0)
+        , scopeTextureID(0)
+        , scopeTextureDirty(false)
         , sizeH()
         , showViewerPicker(false)
         , viewerPickerColor()
@@ -155,6 +185,10 @@ public:
 
     void drawHistogramCPU();
 
+    bool computeScopeGPU(ViewerTab* viewer, int textureIndex, double vmin, double vmax);
+
+    void drawScope();
+
     //////////////////////////////////
     // data members
 
@@ -168,11 +202,14 @@ public:
     QActionGroup* viewerCurrentInputGroup;
     QActionGroup* modeActions;
     Menu* modeMenu;
+    QActionGroup* scopeActions;
+    Menu* scopeMenu;
     QAction* fullImage;
     QActionGroup* filterActions;
     Menu* filterMenu;
     Histogram* widget;
     Histogram::DisplayModeEnum mode;
+    Histogram::ScopeTypeEnum scope;
     QPoint oldClick; /// the last click pressed, in widget coordinates [ (0,0) == top left corner ]
     mutable QMutex zoomContextMutex;
     ZoomContext zoomCtx;
@@ -189,6 +226,9 @@ public:
 
     HistogramCPUThreadPtr histogramThread;
 
+    // True if the CPU histogram was requested since the last histogram computed on the GPU
+    bool cpuHistogramPending;
+
     ///up to 3 histograms (in the RGB) case. FOr all other cases just histogram1 is used.
     std::vector<float> histogram1;
     std::vector<float> histogram2;
@@ -199,6 +239,15 @@ public:
     unsigned int mipMapLevel;
     bool hasImage;
 
+    // The counts of the waveform or vectorscope computed on the GPU, see HistogramGPU::computeScope
+    std::vector<float> scopeData;
+    int scopeWidth, scopeHeight;
+    unsigned int scopePixelsCount;
+
+    // The texture displaying scopeData, in the context of this widget
+    GLuint scopeTextureID;
+    bool scopeTextureDirty;
+
     QSize sizeH;
     bool showViewerPicker;
     std::vector<double> viewerPickerColor;
@@ -255,6 +304,39 @@ Histogram::Histogram(const std::string& scriptName,
     _imp->viewerCurrentInputGroup->addAction(inputBAction);
     _imp->viewerCurrentInputMenu->addAction(inputBAction);
 
+    _imp->scopeMenu = new Menu(tr("Scope"), _imp->rightClickMenu);
+    _imp->rightClickMenu->addAction( _imp->scopeMenu->menuAction() );
+
+    _imp->scopeActions = new QActionGroup(_imp->scopeMenu);
+    QAction* histogramAction = new QAction(_imp->scopeActions);
+    histogramAction->setText( tr("Histogram") );
+    histogramAction->setData( (int)eScopeTypeHistogram );
+    histogramAction->setCheckable(true);
+    histogramAction->setChecked(true);
+    _imp->scopeActions->addAction(histogramAction);
+
+    QAction* waveformAction = new QAction(_imp->scopeActions);
+    waveformAction->setText( tr("Waveform") );
+    waveformAction->setData( (int)eScopeTypeWaveform );
+    waveformAction->setCheckable(true);
+    waveformAction->setChecked(false);
+    _imp->scopeActions->addAction(waveformAction);
+
+    QAction* vectorscopeAction = new QAction(_imp->scopeActions);
+    vectorscopeAction->setText( tr("Vectorscope") );
+    vectorscopeAction->setData( (int)eScopeTypeVectorscope );
+    vectorscopeAction->setCheckable(true);
+    vectorscopeAction->setChecked(false);
+    _imp->scopeActions->addAction(vectorscopeAction);
+
+    {
+        QList<QAction*> scopeActions = _imp->scopeActions->actions();
+        for (int i = 0; i < scopeActions.size(); ++i) {
+            _imp->scopeMenu->addAction( scopeActions.at(i) );
+        }
+    }
+    QObject::connect( _imp->scopeActions, SIGNAL(triggered(QAction*)), this, SLOT(onScopeTypeChanged(QAction*)) );
+
     _imp->modeMenu = new Menu(tr("Display mode"), _imp->rightClickMenu);
     //_imp->modeMenu->setFont( QFont(appFont,appFontSize) );
     _imp->rightClickMenu->addAction( _imp->modeMenu->menuAction() );
@@ -345,6 +427,9 @@ Histogram::~Histogram()
     // always running in the main thread
     assert( qApp && qApp->thread() == QThread::currentThread() );
     makeCurrent();
+    if ( _imp->scopeTextureID && appPTR->isOpenGLLoaded() ) {
+        GL_GPU::DeleteTextures(1, &_imp->scopeTextureID);
+    }
 }
 
 int
@@ -509,6 +594,17 @@ Histogram::onDisplayModeChanged(QAction* action)
     computeHistogramAndRefresh();
 }
 
+void
+Histogram::onScopeTypeChanged(QAction* action)
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+
+    _imp->scope = (Histogram::ScopeTypeEnum)action->data().toInt();
+    _imp->hasImage = false;
+    computeHistogramAndRefresh();
+}
+
 void
 Histogram::initializeGL()
 {
@@ -574,6 +670,19 @@ Histogram::paintGL()
         GL_GPU::Clear(GL_COLOR_BUFFER_BIT);
         glCheckErrorIgnoreOSXBug(GL_GPU);
 
+        if (_imp->scope != eScopeTypeHistogram) {
+            // The waveform and vectorscope have their own fixed axes
+            if (_imp->hasImage) {
+                _imp->drawScope();
+                _imp->drawWarnings();
+            } else {
+                _imp->drawMissingImage();
+            }
+            glCheckError(GL_GPU);
+
+            return;
+        }
+
         _imp->drawScale();
         glCheckError(GL_GPU);
 
@@ -972,6 +1081,27 @@ Histogram::computeHistogramAndRefresh(bool forceEvenIfNotVisible)
     double vmin = btmLeft.x();
     double vmax = topRight.x();
     assert(vmax > vmin);
+
+    // Scopes are computed on the GPU from the texture of the viewer, which only holds the part of the image it displays:
+    // the histogram of the full image is always computed on the CPU.
+    if ( (_imp->scope != eScopeTypeHistogram) || !fullImage ) {
+        if ( _imp->computeScopeGPU(viewer, textureIndex, vmin, vmax) ) {
+            QPointF oldClick_opengl = _imp->zoomCtx.toZoomCoordinates( _imp->oldClick.x(), _imp->oldClick.y() );
+            _imp->updatePicker( oldClick_opengl.x() );
+            update();
+
+            return;
+        }
+        if (_imp->scope != eScopeTypeHistogram) {
+            // The waveform and vectorscope have no CPU implementation
+            _imp->hasImage = false;
+            update();
+
+            return;
+        }
+    }
+
+    _imp->cpuHistogramPending = true;
     _imp->histogramThread->computeHistogram(_imp->mode, viewer->getInternalNode(), textureIndex, roiParam, width(), vmin, vmax, _imp->filterSize);
 
     QPointF oldClick_opengl = _imp->zoomCtx.toZoomCoordinates( _imp->oldClick.x(), _imp->oldClick.y() );
@@ -987,6 +1117,11 @@ Histogram::onCPUHistogramComputed()
     // always running in the main thread
     assert( qApp && qApp->thread() == QThread::currentThread() );
 
+    if (!_imp->cpuHistogramPending) {
+        // A more recent histogram was computed on the GPU meanwhile
+        return;
+    }
+
     int mode;
     bool success = _imp->histogramThread->getMostRecentlyProducedHistogram(&_imp->histogram1, &_imp->histogram2, &_imp->histogram3, &_imp->binsCount, &_imp->pixelsCount, &mode, &_imp->vmin, &_imp->vmax, &_imp->mipMapLevel);
     assert(success);
@@ -1439,6 +1574,211 @@ HistogramPrivate::drawHistogramCPU()
     glCheckError(GL_GPU);
 } // drawHistogramCPU
 
+bool
+HistogramPrivate::computeScopeGPU(ViewerTab* viewer,
+                                  int textureIndex,
+                                  double vmin,
+                                  double vmax)
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+    assert(viewer);
+
+    HistogramGPURequest request;
+    request.scope = (int)scope;
+    request.mode = (int)mode;
+    switch (scope) {
+    case Histogram::eScopeTypeHistogram:
+        request.vmin = vmin;
+        request.vmax = vmax;
+        request.width = widget->width() * NATRON_HISTOGRAM_GPU_UPSCALE;
+        request.height = 1;
+        break;
+    case Histogram::eScopeTypeWaveform:
+        request.vmin = NATRON_WAVEFORM_MIN;
+        request.vmax = NATRON_WAVEFORM_MAX;
+        request.width = std::min(widget->width(), NATRON_SCOPE_MAX_SIZE);
+        request.height = std::min(widget->height(), NATRON_SCOPE_MAX_SIZE);
+        break;
+    case Histogram::eScopeTypeVectorscope:
+        request.width = std::min(std::min( widget->width(), widget->height() ), NATRON_SCOPE_MAX_SIZE);
+        request.height = request.width;
+        break;
+    }
+    if ( (request.width <= 0) || (request.height <= 0) ) {
+        return false;
+    }
+
+    // The viewer makes its own context current, restore ours if this is called while drawing
+    const bool wasCurrent = QGLContext::currentContext() == widget->context();
+    std::vector<float> data;
+    unsigned int count = 0;
+    unsigned int imageMipMapLevel = 0;
+    bool ok = viewer->getViewer()->computeScopeGPU(textureIndex, &request, &data, &count, &imageMipMapLevel);
+    if (wasCurrent) {
+        widget->makeCurrent();
+    }
+    if (!ok || !count) {
+        return false;
+    }
+
+    if (scope == Histogram::eScopeTypeHistogram) {
+        // Smooth the histogram as the CPU one so that they look the same
+        std::vector<float>* histos[3] = {&histogram1, &histogram2, &histogram3};
+        const int nHistograms = (mode == Histogram::eDisplayModeRGB) ? 3 : 1;
+        for (int i = 0; i < 3; ++i) {
+            if (i >= nHistograms) {
+                histos[i]->clear();
+                continue;
+            }
+            std::vector<float> histo_upscaled(request.width);
+            for (int x = 0; x < request.width; ++x) {
+                histo_upscaled[x] = data[x * 4 + i];
+            }
+            HistogramCPUThread::smoothAndDownsampleHistogram(&histo_upscaled, NATRON_HISTOGRAM_GPU_UPSCALE, filterSize, histos[i]);
+        }
+        binsCount = widget->width();
+        pixelsCount = count;
+        this->vmin = vmin;
+        this->vmax = vmax;
+    } else {
+        scopeData.swap(data);
+        scopeWidth = request.width;
+        scopeHeight = request.height;
+        scopePixelsCount = count;
+        scopeTextureDirty = true;
+    }
+    mipMapLevel = imageMipMapLevel;
+    cpuHistogramPending = false;
+    hasImage = true;
+
+    return true;
+} // computeScopeGPU
+
+void
+HistogramPrivate::drawScope()
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+    assert( QGLContext::currentContext() == widget->context() );
+
+    if ( scopeData.empty() || !scopePixelsCount ) {
+        return;
+    }
+
+    glCheckError(GL_GPU);
+    {
+        GLProtectAttrib<GL_GPU> a(GL_TRANSFORM_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT | GL_LINE_BIT);
+        GLProtectMatrix<GL_GPU> p(GL_PROJECTION);
+        GL_GPU::LoadIdentity();
+        GL_GPU::Ortho(0, widget->width(), 0, widget->height(), 1, -1);
+        GLProtectMatrix<GL_GPU> m(GL_MODELVIEW);
+        GL_GPU::LoadIdentity();
+
+        if (!scopeTextureID) {
+            GL_GPU::GenTextures(1, &scopeTextureID);
+            scopeTextureDirty = true;
+        }
+        GL_GPU::BindTexture(GL_TEXTURE_2D, scopeTextureID);
+        if (scopeTextureDirty) {
+            // Map the counts to a brightness that does not saturate too quickly
+            const double gain = (double)scopeWidth * scopeHeight / (NATRON_SCOPE_INTENSITY * scopePixelsCount);
+            const bool rgb = (scope == Histogram::eScopeTypeWaveform) && (mode == Histogram::eDisplayModeRGB);
+            std::vector<unsigned char> pixels(scopeWidth * scopeHeight * 4);
+            for (std::size_t i = 0; i < pixels.size(); i += 4) {
+                for (int c = 0; c < 3; ++c) {
+                    const float count = scopeData[rgb ? i + c : i];
+                    pixels[i + c] = (unsigned char)(255. * ( 1. - std::exp(-count * gain) ) + 0.5);
+                }
+                pixels[i + 3] = 255;
+            }
+            GL_GPU::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            GL_GPU::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            GL_GPU::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            GL_GPU::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            GL_GPU::TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, scopeWidth, scopeHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels.front());
+            scopeTextureDirty = false;
+        }
+
+        // The waveform fills the widget, the vectorscope is a centered square
+        double x1 = 0, y1 = 0, x2 = widget->width(), y2 = widget->height();
+        if (scope == Histogram::eScopeTypeVectorscope) {
+            const double size = std::min(x2, y2);
+            x1 = (x2 - size) / 2.;
+            y1 = (y2 - size) / 2.;
+            x2 = x1 + size;
+            y2 = y1 + size;
+        }
+
+        GL_GPU::Enable(GL_TEXTURE_2D);
+        GL_GPU::Color4f(1., 1., 1., 1.);
+        GL_GPU::Begin(GL_QUADS);
+        GL_GPU::TexCoord2d(0., 0.);
+        GL_GPU::Vertex2d(x1, y1);
+        GL_GPU::TexCoord2d(1., 0.);
+        GL_GPU::Vertex2d(x2, y1);
+        GL_GPU::TexCoord2d(1., 1.);
+        GL_GPU::Vertex2d(x2, y2);
+        GL_GPU::TexCoord2d(0., 1.);
+        GL_GPU::Vertex2d(x1, y2);
+        GL_GPU::End();
+        GL_GPU::BindTexture(GL_TEXTURE_2D, 0);
+        GL_GPU::Disable(GL_TEXTURE_2D);
+        glCheckErrorIgnoreOSXBug(GL_GPU);
+
+        GL_GPU::Enable(GL_BLEND);
+        GL_GPU::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GL_GPU::Color4f(_baseAxisColor.redF(), _baseAxisColor.greenF(), _baseAxisColor.blueF(), 0.5);
+        if (scope == Histogram::eScopeTypeWaveform) {
+            // Lines at 0, 25%, 50%, 75% and 100%
+            GL_GPU::Begin(GL_LINES);
+            for (int i = 0; i <= 4; ++i) {
+                const double y = y1 + (y2 - y1) * (i / 4. - NATRON_WAVEFORM_MIN) / (NATRON_WAVEFORM_MAX - NATRON_WAVEFORM_MIN);
+                GL_GPU::Vertex2d(x1, y);
+                GL_GPU::Vertex2d(x2, y);
+            }
+            GL_GPU::End();
+        } else {
+            // The circle of the maximum chroma, the axes and the targets of the 75% color bars
+            const double cx = (x1 + x2) / 2.;
+            const double cy = (y1 + y2) / 2.;
+            const double radius = (x2 - x1) / 2.;
+            const int nSegments = 64;
+            GL_GPU::Begin(GL_LINE_LOOP);
+            for (int i = 0; i < nSegments; ++i) {
+                const double angle = 2. * M_PI * i / nSegments;
+                GL_GPU::Vertex2d( cx + radius * std::cos(angle), cy + radius * std::sin(angle) );
+            }
+            GL_GPU::End();
+            GL_GPU::Begin(GL_LINES);
+            GL_GPU::Vertex2d(x1, cy);
+            GL_GPU::Vertex2d(x2, cy);
+            GL_GPU::Vertex2d(cx, y1);
+            GL_GPU::Vertex2d(cx, y2);
+            GL_GPU::End();
+
+            const double targets[6][3] = {
+                {0.75, 0., 0.}, {0.75, 0.75, 0.}, {0., 0.75, 0.}, {0., 0.75, 0.75}, {0., 0., 0.75}, {0.75, 0., 0.75}
+            };
+            const double targetSize = radius * 0.04;
+            for (int i = 0; i < 6; ++i) {
+                // Same as the vectorscope shader: Rec. 709 Cb and Cr mapped to [-1,1]
+                const double y = 0.2126 * targets[i][0] + 0.7152 * targets[i][1] + 0.0722 * targets[i][2];
+                const double tx = cx + radius * 2. * (targets[i][2] - y) / 1.8556;
+                const double ty = cy + radius * 2. * (targets[i][0] - y) / 1.5748;
+                GL_GPU::Begin(GL_LINE_LOOP);
+                GL_GPU::Vertex2d(tx - targetSize, ty - targetSize);
+                GL_GPU::Vertex2d(tx + targetSize, ty - targetSize);
+                GL_GPU::Vertex2d(tx + targetSize, ty + targetSize);
+                GL_GPU::Vertex2d(tx - targetSize, ty + targetSize);
+                GL_GPU::End();
+            }
+        }
+        glCheckErrorIgnoreOSXBug(GL_GPU);
+    } // GLProtectAttrib a(GL_TRANSFORM_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT | GL_LINE_BIT);
+    glCheckError(GL_GPU);
+} // drawScope
+
 
 void
 Histogram::renderText(double x,
@@ -71,6 +71,13 @@ public:
         eDisplayModeB
     };
 
+    enum ScopeTypeEnum
+    {
+        eScopeTypeHistogram = 0,
+        eScopeTypeWaveform,
+        eScopeTypeVectorscope
+    };
+
     Histogram(const std::string& scriptName,
               Gui* gui,
               const QGLWidget* shareWidget = NULL);
@@ -102,6 +109,8 @@ public Q_SLOTS:
 
     void onDisplayModeChanged(QAction*);
 
+    void onScopeTypeChanged(QAction*);
+
     void onFilterChanged(QAction*);
 
     void onCurrentViewerChanged(QAction*);
@@ -0,0 +1,304 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "HistogramGPU.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cmath> // sqrt, ceil
+
+#include <QtCore/QDebug>
+#include "Global/GLIncludes.h" //!<must be included before QGLWidget
+#include <QtOpenGL/QGLWidget>
+#include <QtOpenGL/QGLShaderProgram>
+#include "Global/GLObfuscate.h" //!<must be included after QGLWidget
+
+#include "Engine/OSGLFunctions.h"
+#include "Engine/RectI.h"
+#include "Engine/Texture.h"
+
+#include "Gui/GuiApplicationManager.h"
+#include "Gui/Shaders.h"
+
+// Textures with more pixels are subsampled: a scope does not need every pixel of a large image
+#define NATRON_HISTOGRAM_GPU_MAX_SAMPLES (1024 * 1024)
+
+NATRON_NAMESPACE_ENTER
+
+struct HistogramGPUPrivate
+{
+    boost::scoped_ptr<QGLShaderProgram> shader;
+    bool shaderFailed;
+
+    // The floating point frame buffer in which the points are accumulated
+    GLuint fboID;
+    GLuint targetTextureID;
+    int targetWidth, targetHeight;
+
+    // A vertex for each sampled texel, holding its column and row in the sampling grid
+    GLuint vboID;
+    int gridWidth, gridHeight;
+
+    HistogramGPUPrivate()
+    : shader()
+    , shaderFailed(false)
+    , fboID(0)
+    , targetTextureID(0)
+    , targetWidth(0)
+    , targetHeight(0)
+    , vboID(0)
+    , gridWidth(0)
+    , gridHeight(0)
+    {
+    }
+
+    bool ensureShader();
+
+    bool ensureTarget(int width, int height);
+
+    void ensureGrid(int width, int height);
+};
+
+HistogramGPU::HistogramGPU()
+: _imp(new HistogramGPUPrivate)
+{
+}
+
+HistogramGPU::~HistogramGPU()
+{
+    // deleteGLResources() must have been called with the context current
+    assert(!_imp->fboID && !_imp->targetTextureID && !_imp->vboID);
+}
+
+bool
+HistogramGPU::isSupported()
+{
+    // Requires floating point textures and frame buffer objects, as the GPU rendering does
+    return appPTR->isOpenGLLoaded() &&
+           appPTR->hasOpenGLForRequirements(eOpenGLRequirementsTypeRendering) &&
+           QGLShaderProgram::hasOpenGLShaderPrograms();
+}
+
+bool
+HistogramGPUPrivate::ensureShader()
+{
+    if (shader) {
+        return true;
+    }
+    if (shaderFailed) {
+        return false;
+    }
+    shader.reset( new QGLShaderProgram( QGLContext::currentContext() ) );
+    if ( !shader->addShaderFromSourceCode(QGLShader::Vertex, histogramGPUScatter_vert) ||
+         !shader->addShaderFromSourceCode(QGLShader::Fragment, histogramGPUScatter_frag) ||
+         !shader->link() ) {
+        qDebug() << qPrintable( shader->log() );
+        shader.reset();
+        // Do not try again at each frame
+        shaderFailed = true;
+        return false;
+    }
+    return true;
+} // ensureShader
+
+bool
+HistogramGPUPrivate::ensureTarget(int width,
+                                  int height)
+{
+    if (!fboID) {
+        GL_GPU::GenFramebuffers(1, &fboID);
+    }
+    if (!targetTextureID) {
+        GL_GPU::GenTextures(1, &targetTextureID);
+        targetWidth = targetHeight = 0;
+    }
+
+    GL_GPU::BindFramebuffer(GL_FRAMEBUFFER, fboID);
+    if ( (targetWidth != width) || (targetHeight != height) ) {
+        int format, internalFormat, glType;
+        Texture::getRecommendedTexParametersForRGBAFloatTexture(&format, &internalFormat, &glType);
+
+        GL_GPU::BindTexture(GL_TEXTURE_2D, targetTextureID);
+        GL_GPU::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        GL_GPU::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        GL_GPU::TexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, glType, 0);
+        GL_GPU::BindTexture(GL_TEXTURE_2D, 0);
+        GL_GPU::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targetTextureID, 0);
+        targetWidth = width;
+        targetHeight = height;
+    }
+    glCheckError(GL_GPU);
+
+    return GL_GPU::CheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+} // ensureTarget
+
+void
+HistogramGPUPrivate::ensureGrid(int width,
+                                int height)
+{
+    if (vboID && (gridWidth == width) && (gridHeight == height)) {
+        return;
+    }
+    if (!vboID) {
+        GL_GPU::GenBuffers(1, &vboID);
+    }
+
+    std::vector<GLfloat> vertices(width * height * 2);
+    std::vector<GLfloat>::iterator it = vertices.begin();
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            *it = (GLfloat)x;
+            ++it;
+            *it = (GLfloat)y;
+            ++it;
+        }
+    }
+    GL_GPU::BindBuffer(GL_ARRAY_BUFFER, vboID);
+    GL_GPU::BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices.front(), GL_STATIC_DRAW);
+    GL_GPU::BindBuffer(GL_ARRAY_BUFFER, 0);
+    gridWidth = width;
+    gridHeight = height;
+} // ensureGrid
+
+bool
+HistogramGPU::computeScope(const HistogramGPURequest& request,
+                           const GLTexturePtr& texture,
+                           std::vector<float>* data,
+                           unsigned int* pixelsCount)
+{
+    assert(QGLContext::currentContext());
+    assert(data && pixelsCount);
+
+    if ( !texture || (request.width <= 0) || (request.height <= 0) || (request.vmax <= request.vmin) ) {
+        return false;
+    }
+    const RectI& bounds = texture->getBounds();
+    const int texWidth = bounds.width();
+    const int texHeight = bounds.height();
+    if ( (texWidth <= 0) || (texHeight <= 0) || !_imp->ensureShader() ) {
+        return false;
+    }
+
+    // Sample one texel every stride texels in each direction
+    const double stride = std::max( 1., std::sqrt( (double)texWidth * texHeight / NATRON_HISTOGRAM_GPU_MAX_SAMPLES ) );
+    const int gridWidth = std::max(1, (int)std::ceil(texWidth / stride));
+    const int gridHeight = std::max(1, (int)std::ceil(texHeight / stride));
+
+    GLint prevFramebuffer = 0;
+    GL_GPU::GetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFramebuffer);
+    bool ok;
+    {
+        GLProtectAttrib<GL_GPU> a(GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_POINT_BIT | GL_TEXTURE_BIT);
+
+        _imp->ensureGrid(gridWidth, gridHeight);
+        ok = _imp->ensureTarget(request.width, request.height);
+        if (ok) {
+            GL_GPU::Viewport(0, 0, request.width, request.height);
+            GL_GPU::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            GL_GPU::ClearColor(0, 0, 0, 0);
+            GL_GPU::Clear(GL_COLOR_BUFFER_BIT);
+
+            GL_GPU::Disable(GL_DEPTH_TEST);
+            GL_GPU::Disable(GL_POINT_SMOOTH);
+            GL_GPU::PointSize(1.);
+            GL_GPU::Enable(GL_BLEND);
+            GL_GPU::BlendEquation(GL_FUNC_ADD);
+            GL_GPU::BlendFunc(GL_ONE, GL_ONE);
+
+            GL_GPU::ActiveTexture(GL_TEXTURE0);
+            GL_GPU::BindTexture( GL_TEXTURE_2D, texture->getTexID() );
+
+            _imp->shader->bind();
+            _imp->shader->setUniformValue("Tex", (GLint)0);
+            _imp->shader->setUniformValue("texSize", (GLfloat)texWidth, (GLfloat)texHeight);
+            _imp->shader->setUniformValue("stride", (GLfloat)stride);
+            _imp->shader->setUniformValue("scope", (GLint)request.scope);
+            _imp->shader->setUniformValue("vmin", (GLfloat)request.vmin);
+            _imp->shader->setUniformValue("vmax", (GLfloat)request.vmax);
+            _imp->shader->setUniformValue("applyDisplayTransform", (GLint)request.applyDisplayTransform);
+            _imp->shader->setUniformValue("gain", (GLfloat)request.gain);
+            _imp->shader->setUniformValue("gamma", (GLfloat)request.gamma);
+            _imp->shader->setUniformValue("lut", (GLint)request.lut);
+            _imp->shader->setUniformValue("channels", (GLint)request.channels);
+
+            GL_GPU::BindBuffer(GL_ARRAY_BUFFER, _imp->vboID);
+            GL_GPU::EnableClientState(GL_VERTEX_ARRAY);
+            GL_GPU::VertexPointer(2, GL_FLOAT, 0, 0);
+
+            // In the RGB mode, each channel is accumulated in its own component by a separate pass.
+            // The vectorscope uses all channels at once and ignores the mode.
+            const int modeR = 3; // Histogram::eDisplayModeR, followed by G and B
+            const bool rgbPasses = (request.mode == 0) && (request.scope != 2);
+            const int nPasses = rgbPasses ? 3 : 1;
+            for (int i = 0; i < nPasses; ++i) {
+                if (rgbPasses) {
+                    GL_GPU::ColorMask(i == 0, i == 1, i == 2, GL_FALSE);
+                    _imp->shader->setUniformValue("mode", (GLint)(modeR + i));
+                } else {
+                    GL_GPU::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
+                    _imp->shader->setUniformValue("mode", (GLint)request.mode);
+                }
+                GL_GPU::DrawArrays(GL_POINTS, 0, gridWidth * gridHeight);
+            }
+
+            GL_GPU::DisableClientState(GL_VERTEX_ARRAY);
+            GL_GPU::BindBuffer(GL_ARRAY_BUFFER, 0);
+            _imp->shader->release();
+            GL_GPU::BindTexture(GL_TEXTURE_2D, 0);
+
+            data->resize(request.width * request.height * 4);
+            GL_GPU::ReadPixels(0, 0, request.width, request.height, GL_RGBA, GL_FLOAT, &data->front());
+            *pixelsCount = gridWidth * gridHeight;
+        }
+    } // GLProtectAttrib a(GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_POINT_BIT | GL_TEXTURE_BIT);
+    GL_GPU::BindFramebuffer(GL_FRAMEBUFFER, prevFramebuffer);
+    glCheckError(GL_GPU);
+
+    return ok;
+} // computeScope
+
+void
+HistogramGPU::deleteGLResources()
+{
+    assert(QGLContext::currentContext());
+    _imp->shader.reset();
+    if (_imp->fboID) {
+        GL_GPU::DeleteFramebuffers(1, &_imp->fboID);
+        _imp->fboID = 0;
+    }
+    if (_imp->targetTextureID) {
+        GL_GPU::DeleteTextures(1, &_imp->targetTextureID);
+        _imp->targetTextureID = 0;
+    }
+    if (_imp->vboID) {
+        GL_GPU::DeleteBuffers(1, &_imp->vboID);
+        _imp->vboID = 0;
+    }
+    _imp->targetWidth = _imp->targetHeight = 0;
+    _imp->gridWidth = _imp->gridHeight = 0;
+}
+
+NATRON_NAMESPACE_EXIT
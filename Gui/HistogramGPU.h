@@ -0,0 +1,124 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_GUI_HISTOGRAMGPU_H
+#define NATRON_GUI_HISTOGRAMGPU_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+#include "Gui/GuiFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The parameters of a scope computed by HistogramGPU
+ **/
+struct HistogramGPURequest
+{
+    int scope; //< corresponds to the enum Histogram::ScopeTypeEnum
+    int mode; //< corresponds to the enum Histogram::DisplayModeEnum
+
+    // The range of the values accumulated: the x range of the histogram, the y range of the waveform
+    double vmin, vmax;
+
+    // The size of the produced scope: the number of bins of the histogram (height is 1)
+    int width, height;
+
+    // If true, the texture is linear and the display transform of the viewer is applied to its values first
+    bool applyDisplayTransform;
+    double gain, gamma;
+    int lut; //< corresponds to the enum ViewerColorSpaceEnum
+    int channels; //< corresponds to the enum DisplayChannelsEnum
+
+    HistogramGPURequest()
+    : scope(0)
+    , mode(0)
+    , vmin(0.)
+    , vmax(1.)
+    , width(0)
+    , height(0)
+    , applyDisplayTransform(false)
+    , gain(1.)
+    , gamma(1.)
+    , lut(0)
+    , channels(1)
+    {
+    }
+};
+
+/**
+ * @class Computes the histogram, waveform and vectorscope of a texture on the GPU.
+ *
+ * Each texel (or one texel every few ones for large textures) is a point whose vertex shader fetches the texel and
+ * moves it to the scope bin it falls in. Points are then accumulated by additive blending in a floating point
+ * frame buffer that is read back. This only requires OpenGL 2 and floating point textures, unlike compute shaders.
+ *
+ * All functions must be called with the OpenGL context owning the texture current. The GPU resources are
+ * created lazily and must be released with deleteGLResources() while that context is still current.
+ **/
+struct HistogramGPUPrivate;
+class HistogramGPU
+{
+public:
+
+    HistogramGPU();
+
+    ~HistogramGPU();
+
+    /**
+     * @brief Returns true if the current OpenGL context can compute scopes.
+     **/
+    static bool isSupported();
+
+    /**
+     * @brief Computes a scope of the given texture.
+     * @param data The RGBA counts of each bin of the scope, width * height * 4 values, row by row from the bottom.
+     * In the RGB display mode each channel holds the counts of that channel.
+     * @param pixelsCount The number of texels accumulated in the scope
+     * @returns False if the scope could not be computed
+     **/
+    bool computeScope(const HistogramGPURequest& request,
+                      const GLTexturePtr& texture,
+                      std::vector<float>* data,
+                      unsigned int* pixelsCount);
+
+    void deleteGLResources();
+
+private:
+
+    boost::scoped_ptr<HistogramGPUPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_GUI_HISTOGRAMGPU_H
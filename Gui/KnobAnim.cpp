@@ -307,12 +307,14 @@ KnobAnim::destroyAndRecreate()
 void
 KnobAnim::onKnobAvailableViewsChanged()
 {
+    invalidateKeyframesCache();
     destroyAndRecreate();
 }
 
 void
 KnobAnim::onInternalKnobDimensionsVisibilityChanged(ViewSetSpec /*view*/)
 {
+    invalidateKeyframesCache();
     ++_imp->nDimVisibilityRequestsPending;
     Q_EMIT s_refreshDimensionsVisibilityLater();
 }
@@ -664,6 +666,7 @@ void
 KnobAnim::onCurveAnimationChangedInternally(ViewSetSpec /*view*/,
                                            DimSpec /*dimension*/)
 {
+    invalidateKeyframesCache();
 
     AnimationModulePtr model = toAnimationModule(getModel());
     if (!model) {
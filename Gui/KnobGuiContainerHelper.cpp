@@ -44,6 +44,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobItemsTable.h"
 #include "Engine/Node.h"
+#include "Engine/Settings.h"
 
 #include "Gui/KnobGui.h"
 #include "Gui/ClickableLabel.h"
@@ -1279,6 +1280,13 @@ KnobGuiContainerHelper::pushUndoCommand(QUndoCommand* cmd)
     //We may be in a situation where the command was not pushed because the stack was cleared
     if (!_imp->clearedStackDuringPush) {
         _imp->cmdBeingPushed = 0;
+
+        // QUndoStack cannot drop its oldest commands: when the history goes over budget, clear the one of this panel
+        SettingsPtr settings = appPTR->getCurrentSettings();
+        if ( UndoCommand_qt::getTotalMemorySize() > settings->getUndoRedoMemoryBudget() ) {
+            _imp->undoStack->clear();
+        }
+        settings->setUndoRedoMemoryUsage( UndoCommand_qt::getTotalMemorySize() );
     }
     refreshUndoRedoButtonsEnabledNess( _imp->undoStack->canUndo(), _imp->undoStack->canRedo() );
 }
@@ -649,6 +649,8 @@ KnobItemsTableGui::KnobItemsTableGui(const KnobItemsTablePtr& table, DockablePan
     connect(table.get(), SIGNAL(selectionChanged(std::list<KnobTableItemPtr>,std::list<KnobTableItemPtr>,TableChangeReasonEnum)), this, SLOT(onModelSelectionChanged(std::list<KnobTableItemPtr>,std::list<KnobTableItemPtr>,TableChangeReasonEnum)));
     connect(table.get(), SIGNAL(itemRemoved(KnobTableItemPtr,TableChangeReasonEnum)), this, SLOT(onModelItemRemoved( KnobTableItemPtr,TableChangeReasonEnum)));
     connect(table.get(), SIGNAL(itemInserted(int,KnobTableItemPtr,TableChangeReasonEnum)), this, SLOT(onModelItemInserted(int,KnobTableItemPtr,TableChangeReasonEnum)));
+    connect(table.get(), SIGNAL(itemsRemoved(std::list<KnobTableItemPtr>,TableChangeReasonEnum)), this, SLOT(onModelItemsRemoved(std::list<KnobTableItemPtr>,TableChangeReasonEnum)));
+    connect(table.get(), SIGNAL(itemsInserted(int,std::list<KnobTableItemPtr>,TableChangeReasonEnum)), this, SLOT(onModelItemsInserted(int,std::list<KnobTableItemPtr>,TableChangeReasonEnum)));
 
 
 
@@ -1993,6 +1995,26 @@ KnobItemsTableGui::onModelItemInserted(int /*index*/, const KnobTableItemPtr& it
 
 }
 
+void
+KnobItemsTableGui::onModelItemsRemoved(const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum reason)
+{
+    for (std::list<KnobTableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        onModelItemRemoved(*it, reason);
+    }
+}
+
+void
+KnobItemsTableGui::onModelItemsInserted(int index, const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum reason)
+{
+    int itemIndex = index;
+    for (std::list<KnobTableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        onModelItemInserted(itemIndex, *it, reason);
+        if (itemIndex >= 0) {
+            ++itemIndex;
+        }
+    }
+}
+
 void
 KnobItemsTableGuiPrivate::createItemsVecRecursive(const std::vector<KnobTableItemPtr>& items)
 {
@@ -96,6 +96,8 @@ public Q_SLOTS:
     void onModelSelectionChanged(const std::list<KnobTableItemPtr>& addedToSelection, const std::list<KnobTableItemPtr>& removedFromSelection, TableChangeReasonEnum reason);
     void onModelItemRemoved(const KnobTableItemPtr& item, TableChangeReasonEnum reason);
     void onModelItemInserted(int index, const KnobTableItemPtr& item, TableChangeReasonEnum reason);
+    void onModelItemsRemoved(const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum reason);
+    void onModelItemsInserted(int index, const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum reason);
 
     void onItemLabelChanged(const QString& label, TableChangeReasonEnum reason);
     void onItemIconChanged(TableChangeReasonEnum reason);
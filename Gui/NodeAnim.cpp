@@ -300,6 +300,8 @@ NodeAnim::initializeTableItems()
 
         connect(internalTable.get(), SIGNAL(itemRemoved(KnobTableItemPtr,TableChangeReasonEnum)), this, SLOT(onTableItemRemoved(KnobTableItemPtr,TableChangeReasonEnum)));
         connect(internalTable.get(), SIGNAL(itemInserted(int,KnobTableItemPtr,TableChangeReasonEnum)), this, SLOT(onTableItemInserted(int,KnobTableItemPtr,TableChangeReasonEnum)));
+        connect(internalTable.get(), SIGNAL(itemsRemoved(std::list<KnobTableItemPtr>,TableChangeReasonEnum)), this, SLOT(onTableItemsRemoved(std::list<KnobTableItemPtr>,TableChangeReasonEnum)));
+        connect(internalTable.get(), SIGNAL(itemsInserted(int,std::list<KnobTableItemPtr>,TableChangeReasonEnum)), this, SLOT(onTableItemsInserted(int,std::list<KnobTableItemPtr>,TableChangeReasonEnum)));
 
         NodeAnimPtr thisShared = shared_from_this();
 
@@ -403,6 +405,26 @@ NodeAnim::onTableItemInserted(int index, const KnobTableItemPtr& item, TableChan
     _imp->insertItem(index, item, reason);
 }
 
+void
+NodeAnim::onTableItemsRemoved(const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum reason)
+{
+    for (std::list<KnobTableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        _imp->removeItem(*it, reason);
+    }
+}
+
+void
+NodeAnim::onTableItemsInserted(int index, const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum reason)
+{
+    int itemIndex = index;
+    for (std::list<KnobTableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        _imp->insertItem(itemIndex, *it, reason);
+        if (itemIndex >= 0) {
+            ++itemIndex;
+        }
+    }
+}
+
 
 void
 NodeAnim::onNodeLabelChanged(const QString &/*oldName*/, const QString& newName)
@@ -93,6 +93,10 @@ public Q_SLOTS:
     
     void onTableItemInserted(int index, const KnobTableItemPtr& item, TableChangeReasonEnum);
 
+    void onTableItemsRemoved(const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum);
+
+    void onTableItemsInserted(int index, const std::list<KnobTableItemPtr>& items, TableChangeReasonEnum);
+
 private:
 
 
@@ -269,6 +269,18 @@ NodeGraph::resizeEvent(QResizeEvent* e)
     QGraphicsView::resizeEvent(e);
 }
 
+void
+NodeGraph::showEvent(QShowEvent* e)
+{
+    QGraphicsView::showEvent(e);
+
+    // The nodes of a group may not have been created when loading the project
+    NodeGroupPtr isGroup = toNodeGroup( getGroup() );
+    if ( isGroup && isGroup->isSubGraphDeferred() && getGui() && !getGui()->getApp()->getProject()->isLoadingProjectInternal() ) {
+        isGroup->createDeferredSubGraph();
+    }
+}
+
 void
 NodeGraph::paintEvent(QPaintEvent* e)
 {
@@ -364,9 +376,6 @@ NodeGraph::visibleWidgetRect() const
 void
 NodeGraph::createNodeGui(const NodePtr & node, const CreateNodeArgs& args)
 {
-    // Save current selection
-    NodesGuiList selectedNodes = getSelectedNodes();
-
     // Create the correct node gui class according to type
     NodeGuiPtr node_ui;
     {
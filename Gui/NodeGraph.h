@@ -278,6 +278,7 @@ private:
     virtual void mouseMoveEvent(QMouseEvent* e) OVERRIDE FINAL;
     virtual void mouseDoubleClickEvent(QMouseEvent* e) OVERRIDE FINAL;
     virtual void resizeEvent(QResizeEvent* e) OVERRIDE FINAL;
+    virtual void showEvent(QShowEvent* e) OVERRIDE FINAL;
     virtual void paintEvent(QPaintEvent* e) OVERRIDE FINAL;
     virtual void wheelEvent(QWheelEvent* e) OVERRIDE FINAL;
     virtual void focusInEvent(QFocusEvent* e) OVERRIDE FINAL;
@@ -298,6 +299,11 @@ private:
 
     void getNodesWithinViewportRect(const QRect& rect, std::set<NodeGuiPtr>* nodes) const;
 
+    /**
+     * @brief Returns the nodes intersecting the given rect in scene coordinates and the nodes of the edges intersecting it
+     **/
+    void getNodesNearbySceneRect(const QRectF& rect, std::set<NodeGuiPtr>* nodes) const;
+
     NearbyItemEnum hasItemNearbyMouse(const QPoint& mousePosViewport,
                                       NodeGuiPtr* node,
                                       Edge** edge);
@@ -34,6 +34,7 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QMouseEvent>
 #include <QtCore/QString>
 #include <QAction>
+#include <QGraphicsScene>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
@@ -108,6 +109,33 @@ NodeGraph::getNodesWithinViewportRect(const QRect& rect,
     }
 }
 
+void
+NodeGraph::getNodesNearbySceneRect(const QRectF& rect,
+                                   std::set<NodeGuiPtr>* nodes) const
+{
+    // The scene indexes its items spatially: only the items around the rect are visited
+    QList<QGraphicsItem*> nearbyItems = scene()->items(rect, Qt::IntersectsItemBoundingRect);
+    for (QList<QGraphicsItem*>::Iterator it = nearbyItems.begin(); it != nearbyItems.end(); ++it) {
+        NodeGuiPtr n = isNodeGuiChild(*it);
+        if (n) {
+            nodes->insert(n);
+            continue;
+        }
+        // Edges are not children of their node, but their nodes are nearby too
+        Edge* edge = isEdgeChild(*it);
+        if (edge) {
+            NodeGuiPtr source = edge->getSource();
+            if (source) {
+                nodes->insert(source);
+            }
+            NodeGuiPtr dest = edge->getDest();
+            if (dest) {
+                nodes->insert(dest);
+            }
+        }
+    }
+}
+
 NodeGraph::NearbyItemEnum
 NodeGraph::hasItemNearbyMouse(const QPoint& mousePosViewport,
                               NodeGuiPtr* node,
@@ -97,8 +97,9 @@ NodeGraph::checkForHints(bool shiftdown,
     NodePtr selectedNodeInternalNode = selectedNode->getNode();
     bool selectedNodeIsReader = selectedNodeInternalNode->getEffectInstance()->isReader() || selectedNodeInternalNode->getNInputs() == 0;
     Edge* edge = 0;
+    // Only the nodes and edges around the selected node can be hinted
     std::set<NodeGuiPtr> nodesWithinRect;
-    getNodesWithinViewportRect(visibleWidgetRect(), &nodesWithinRect);
+    getNodesNearbySceneRect(selectedNodeBbox, &nodesWithinRect);
 
     {
         for (std::set<NodeGuiPtr>::iterator it = nodesWithinRect.begin(); it != nodesWithinRect.end(); ++it) {
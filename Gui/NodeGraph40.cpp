@@ -29,6 +29,10 @@
 #include <sstream> // stringstream
 #include <stdexcept>
 
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
 #include <QApplication>
 #include <QClipboard>
 #include <QDebug>
@@ -62,6 +66,79 @@
 #include "Global/QtCompat.h"
 
 NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+typedef boost::shared_ptr<SERIALIZATION_NAMESPACE::NodeClipBoard> NodeClipBoardPtr;
+
+/**
+ * @brief The data put on the system clipboard by NodeGraph::copySelectedNodes(). It keeps the serialization of the
+ * copied nodes so that pasting in this process does not encode them to YAML and parse them back: the text is only
+ * encoded if another application (or another process of Natron) asks for it.
+ **/
+class NodeClipBoardMimeData
+    : public QMimeData
+{
+public:
+
+    explicit NodeClipBoardMimeData(const NodeClipBoardPtr& clipboard)
+        : QMimeData()
+        , _clipboard(clipboard)
+        , _text()
+        , _textEncoded(false)
+    {
+    }
+
+    virtual ~NodeClipBoardMimeData()
+    {
+    }
+
+    const NodeClipBoardPtr& getClipBoard() const
+    {
+        return _clipboard;
+    }
+
+    virtual QStringList formats() const OVERRIDE FINAL
+    {
+        return QStringList() << QLatin1String("text/plain");
+    }
+
+    virtual bool hasFormat(const QString& mimeType) const OVERRIDE FINAL
+    {
+        return mimeType == QLatin1String("text/plain");
+    }
+
+protected:
+
+    virtual QVariant retrieveData(const QString& mimeType,
+                                  QVariant::Type /*type*/) const OVERRIDE FINAL
+    {
+        if ( mimeType != QLatin1String("text/plain") ) {
+            return QVariant();
+        }
+        if (!_textEncoded) {
+            _textEncoded = true;
+            std::ostringstream ss;
+            try {
+                SERIALIZATION_NAMESPACE::write(ss, *_clipboard, NATRON_CLIPBOARD_HEADER);
+            } catch (...) {
+                qDebug() << "Failed to copy selection to system clipboard";
+            }
+            _text = QByteArray( ss.str().c_str() );
+        }
+
+        return QVariant(_text);
+    }
+
+private:
+
+    NodeClipBoardPtr _clipboard;
+    mutable QByteArray _text;
+    mutable bool _textEncoded;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 void
 NodeGraph::togglePreviewsForSelectedNodes()
 {
@@ -130,20 +207,10 @@ NodeGraph::copySelectedNodes()
         return;
     }
 
-    SERIALIZATION_NAMESPACE::NodeClipBoard cb;
-    _imp->copyNodesInternal(getSelectedNodes(), &cb.nodes);
-
-    std::ostringstream ss;
-
-    try {
-        SERIALIZATION_NAMESPACE::write(ss, cb, NATRON_CLIPBOARD_HEADER);
-    } catch (...) {
-        qDebug() << "Failed to copy selection to system clipboard";
-    }
+    NodeClipBoardPtr cb = boost::make_shared<SERIALIZATION_NAMESPACE::NodeClipBoard>();
+    _imp->copyNodesInternal(getSelectedNodes(), &cb->nodes);
 
-    QMimeData* mimedata = new QMimeData;
-    QByteArray data( ss.str().c_str() );
-    mimedata->setData(QLatin1String("text/plain"), data);
+    QMimeData* mimedata = new NodeClipBoardMimeData(cb);
     QClipboard* clipboard = QApplication::clipboard();
 
     //ownership is transferred to the clipboard
@@ -217,6 +284,23 @@ NodeGraph::pasteClipboard(const QPointF& pos)
 
     QClipboard* clipboard = QApplication::clipboard();
     const QMimeData* mimedata = clipboard->mimeData();
+    if (!mimedata) {
+        return false;
+    }
+
+    // If the nodes were copied by this process, paste their serialization directly
+    const NodeClipBoardMimeData* nodesMimeData = dynamic_cast<const NodeClipBoardMimeData*>(mimedata);
+    if (nodesMimeData) {
+        std::list<std::pair<NodePtr, SERIALIZATION_NAMESPACE::NodeSerializationPtr> > nodesToPaste;
+        const SERIALIZATION_NAMESPACE::NodeSerializationList& nodes = nodesMimeData->getClipBoard()->nodes;
+        for (SERIALIZATION_NAMESPACE::NodeSerializationList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+            // Pasting moves the nodes to the new position: copy them so that the clipboard can be pasted again
+            nodesToPaste.push_back( std::make_pair( NodePtr(), boost::make_shared<SERIALIZATION_NAMESPACE::NodeSerialization>(**it) ) );
+        }
+        _imp->pasteNodesInternal(nodesToPaste, position, NodeGraphPrivate::PasteNodesFlags(NodeGraphPrivate::ePasteNodesFlagRelativeToCentroid | NodeGraphPrivate::ePasteNodesFlagUseUndoCommand));
+
+        return true;
+    }
 
     // If this is a list of files, try to open them
     if ( mimedata->hasUrls() ) {
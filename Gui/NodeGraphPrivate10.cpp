@@ -32,6 +32,7 @@
 #include <QDebug>
 
 #include "Engine/CreateNodeArgs.h"
+#include "Engine/HashableObject.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
@@ -52,6 +53,34 @@
 
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Does not repaint the node graph while many nodes are created, it is repainted once at the end
+ **/
+class SuspendGraphUpdates_RAII
+{
+    QWidget* _viewport;
+    bool _wasEnabled;
+
+public:
+
+    explicit SuspendGraphUpdates_RAII(NodeGraph* graph)
+        : _viewport( graph->viewport() )
+        , _wasEnabled( _viewport->updatesEnabled() )
+    {
+        _viewport->setUpdatesEnabled(false);
+    }
+
+    ~SuspendGraphUpdates_RAII()
+    {
+        _viewport->setUpdatesEnabled(_wasEnabled);
+        _viewport->update();
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 
 void
 NodeGraphPrivate::pasteNodesInternal(const std::list<std::pair<NodePtr, SERIALIZATION_NAMESPACE::NodeSerializationPtr> >& originalNodes,
@@ -127,6 +156,11 @@ NodeGraphPrivate::pasteNodesInternal(const std::list<std::pair<NodePtr, SERIALIZ
     }
 
     
+    // Create all nodes in one batch: the hash of the nodes downstream of each new connection is invalidated once
+    // for the whole paste and the graph is repainted once the nodes are created
+    HashInvalidationBatch_RAII hashBatch;
+    SuspendGraphUpdates_RAII suspendUpdates(_publicInterface);
+
     // Create nodes
     NodesList createdNodes;
     group.lock()->createNodesFromSerialization(serializationList, NodeCollection::eCreateNodesFromSerializationFlagsNone, &createdNodes);
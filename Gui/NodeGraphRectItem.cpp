@@ -27,6 +27,7 @@
 #include "NodeGraphRectItem.h"
 
 #include <QPainter>
+#include <QStyleOption>
 
 NATRON_NAMESPACE_ENTER
 
@@ -42,7 +43,14 @@ NodeGraphRectItem::paint(QPainter *painter, const QStyleOptionGraphicsItem* /*op
 {
     painter->setPen(pen());
     painter->setBrush(brush());
-    painter->drawRoundedRect(rect(), _cornerRadiusPx, _cornerRadiusPx);
+
+    // When zoomed out the rounded corners are less than a pixel wide: a plain rectangle is much cheaper to draw
+    double cornerRadiusOnScreen = _cornerRadiusPx * QStyleOptionGraphicsItem::levelOfDetailFromTransform( painter->worldTransform() );
+    if (cornerRadiusOnScreen < 1.) {
+        painter->drawRect( rect() );
+    } else {
+        painter->drawRoundedRect(rect(), _cornerRadiusPx, _cornerRadiusPx);
+    }
 }
 
 NATRON_NAMESPACE_EXIT
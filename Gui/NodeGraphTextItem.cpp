@@ -29,6 +29,7 @@
 #include <stdexcept>
 
 #include <QtCore/QDebug>
+#include <QPainter>
 #include <QStyleOption>
 
 #include "Engine/Settings.h"
@@ -39,6 +40,7 @@
 #define NODEGRAPH_TEXT_ITEM_MIN_HEIGHT_PX 4
 #define NODEGRAPH_SIMPLE_TEXT_ITEM_MIN_HEIGHT_PX 6
 #define NODEGRAPH_PIXMAP_ITEM_MIN_HEIGHT_PX 10
+#define NODEGRAPH_ELLIPSE_ITEM_MIN_HEIGHT_PX 4
 
 NATRON_NAMESPACE_ENTER
 
@@ -56,6 +58,10 @@ NodeGraphTextItem::NodeGraphTextItem(NodeGraph* graph,
         f.setStyleStrategy(QFont::NoAntialias);
     }
     setFont(f);
+
+    // Laying out rich text is by far the most expensive part of drawing a node: keep it in a pixmap
+    // so that it is only drawn again when the text or the zoom changes.
+    setCacheMode(DeviceCoordinateCache);
 }
 
 NodeGraphTextItem::~NodeGraphTextItem()
@@ -74,9 +80,7 @@ NodeGraphTextItem::paint(QPainter *painter,
             isTooSmall = true;
         } else {
             QFontMetrics fm( font() );
-            QPoint topLeft = _graph->mapFromScene( mapToScene( QPointF(0, 0) ) );
-            QPoint btmLeft = _graph->mapFromScene( mapToScene( QPointF( 0, fm.height() ) ) );
-            int height = std::abs( btmLeft.y() - topLeft.y() );
+            double height = fm.height() * QStyleOptionGraphicsItem::levelOfDetailFromTransform( painter->worldTransform() );
             isTooSmall = height < NODEGRAPH_TEXT_ITEM_MIN_HEIGHT_PX;
         }
     }
@@ -118,9 +122,7 @@ NodeGraphSimpleTextItem::paint(QPainter *painter,
             isTooSmall = true;
         } else {
             QFontMetrics fm( font() );
-            QPoint topLeft = _graph->mapFromScene( mapToScene( QPointF(0, 0) ) );
-            QPoint btmLeft = _graph->mapFromScene( mapToScene( QPointF( 0, fm.height() ) ) );
-            int height = std::abs( btmLeft.y() - topLeft.y() );
+            double height = fm.height() * QStyleOptionGraphicsItem::levelOfDetailFromTransform( painter->worldTransform() );
             isTooSmall = height < NODEGRAPH_SIMPLE_TEXT_ITEM_MIN_HEIGHT_PX;
         }
     }
@@ -149,12 +151,37 @@ NodeGraphPixmapItem::paint(QPainter *painter,
     if ( _graph->isDoingNavigatorRender() ) {
         return;
     }
-    QRect br = _graph->mapFromScene( mapToScene( boundingRect() ).boundingRect() ).boundingRect();
-    int height = br.height();
+    double height = boundingRect().height() * QStyleOptionGraphicsItem::levelOfDetailFromTransform( painter->worldTransform() );
     if (height < NODEGRAPH_PIXMAP_ITEM_MIN_HEIGHT_PX) {
         return;
     }
     QGraphicsPixmapItem::paint(painter, option, widget);
 }
 
+NodeGraphEllipseItem::NodeGraphEllipseItem(NodeGraph* graph,
+                                           QGraphicsItem* parent)
+    : QGraphicsEllipseItem(parent)
+    , _graph(graph)
+{
+}
+
+NodeGraphEllipseItem::~NodeGraphEllipseItem()
+{
+}
+
+void
+NodeGraphEllipseItem::paint(QPainter *painter,
+                            const QStyleOptionGraphicsItem *option,
+                            QWidget *widget)
+{
+    if ( _graph->isDoingNavigatorRender() ) {
+        return;
+    }
+    double height = rect().height() * QStyleOptionGraphicsItem::levelOfDetailFromTransform( painter->worldTransform() );
+    if (height < NODEGRAPH_ELLIPSE_ITEM_MIN_HEIGHT_PX) {
+        return;
+    }
+    QGraphicsEllipseItem::paint(painter, option, widget);
+}
+
 NATRON_NAMESPACE_EXIT
@@ -86,6 +86,20 @@ public:
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) OVERRIDE FINAL;
 };
 
+class NodeGraphEllipseItem
+    : public QGraphicsEllipseItem
+{
+    NodeGraph* _graph;
+
+public:
+    NodeGraphEllipseItem(NodeGraph* graph,
+                         QGraphicsItem *parent);
+
+    virtual ~NodeGraphEllipseItem();
+
+    virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) OVERRIDE FINAL;
+};
+
 NATRON_NAMESPACE_EXIT
 
 
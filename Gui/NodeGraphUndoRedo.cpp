@@ -37,6 +37,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/GroupInput.h"
 #include "Engine/GroupOutput.h"
+#include "Engine/HashableObject.h"
 #include "Engine/Node.h"
 #include "Engine/Project.h"
 #include "Engine/RotoLayer.h"
@@ -146,6 +147,7 @@ AddMultipleNodesCommand::~AddMultipleNodesCommand()
 void
 AddMultipleNodesCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     _isUndone = true;
     std::list<ViewerInstancePtr> viewersToRefresh;
 
@@ -175,6 +177,7 @@ AddMultipleNodesCommand::undo()
 void
 AddMultipleNodesCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     _isUndone = false;
 
     NodesList createdNodes;
@@ -238,6 +241,7 @@ RemoveMultipleNodesCommand::~RemoveMultipleNodesCommand()
 void
 RemoveMultipleNodesCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
 
     SERIALIZATION_NAMESPACE::NodeSerializationList serializationList;
     for (std::list<NodeToRemove>::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
@@ -269,6 +273,7 @@ RemoveMultipleNodesCommand::undo()
 void
 RemoveMultipleNodesCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     _isRedone = true;
 
     for (std::list<NodeToRemove>::iterator it = _nodes.begin();
@@ -458,6 +463,7 @@ InsertNodeCommand::InsertNodeCommand(NodeGraph* graph,
 void
 InsertNodeCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     NodeGuiPtr oldSrc = _oldSrc.lock();
     NodeGuiPtr newSrc = _newSrc.lock();
     NodeGuiPtr dst = _dst.lock();
@@ -485,6 +491,7 @@ InsertNodeCommand::undo()
 void
 InsertNodeCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     NodeGuiPtr oldSrc = _oldSrc.lock();
     NodeGuiPtr newSrc = _newSrc.lock();
     NodeGuiPtr dst = _dst.lock();
@@ -619,6 +626,7 @@ DecloneMultipleNodesCommand::~DecloneMultipleNodesCommand()
 void
 DecloneMultipleNodesCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     for (std::list<NodeToDeclone>::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
         it->node.lock()->getNode()->linkToNode( it->master.lock());
     }
@@ -630,6 +638,7 @@ DecloneMultipleNodesCommand::undo()
 void
 DecloneMultipleNodesCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     for (std::list<NodeToDeclone>::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
         it->node.lock()->getNode()->unlinkAllKnobs();
     }
@@ -965,6 +974,7 @@ DisableNodesCommand::DisableNodesCommand(const std::list<NodeGuiPtr> & nodes,
 void
 DisableNodesCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     for (std::list<boost::weak_ptr<NodeGui> >::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
         it->lock()->getNode()->getEffectInstance()->setNodeDisabled(false);
     }
@@ -974,6 +984,7 @@ DisableNodesCommand::undo()
 void
 DisableNodesCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     for (std::list<boost::weak_ptr<NodeGui> >::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
         it->lock()->getNode()->getEffectInstance()->setNodeDisabled(true);
     }
@@ -993,6 +1004,7 @@ EnableNodesCommand::EnableNodesCommand(const std::list<NodeGuiPtr> & nodes,
 void
 EnableNodesCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     for (std::list<boost::weak_ptr<NodeGui> >::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
         it->lock()->getNode()->getEffectInstance()->setNodeDisabled(true);
     }
@@ -1002,6 +1014,7 @@ EnableNodesCommand::undo()
 void
 EnableNodesCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     for (std::list<boost::weak_ptr<NodeGui> >::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
         it->lock()->getNode()->getEffectInstance()->setNodeDisabled(false);
     }
@@ -1064,6 +1077,7 @@ ExtractNodeUndoRedoCommand::~ExtractNodeUndoRedoCommand()
 void
 ExtractNodeUndoRedoCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
 
     for (NodeCollection::TopologicallySortedNodesList::iterator it = _sortedNodes.begin(); it != _sortedNodes.end(); ++it) {
 
@@ -1095,6 +1109,7 @@ ExtractNodeUndoRedoCommand::undo()
 void
 ExtractNodeUndoRedoCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
 
     std::list<NodeCollection::TopologicalSortNodePtr> outputNodes;
     std::list<NodeCollection::TopologicalSortNodePtr> inputNodes;
@@ -1205,6 +1220,7 @@ GroupFromSelectionCommand::~GroupFromSelectionCommand()
 void
 GroupFromSelectionCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     std::list<NodeGuiPtr> nodesToSelect;
 
     NodeCollectionPtr oldGroup = _oldGroup.lock();
@@ -1255,6 +1271,7 @@ GroupFromSelectionCommand::undo()
 void
 GroupFromSelectionCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     // The group position will be at the centroid of all selected nodes
     RectD originalNodesBbox;
     bool originalNodesBboxSet = false;
@@ -1558,6 +1575,7 @@ InlineGroupCommand::~InlineGroupCommand()
 void
 InlineGroupCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
 
     AppInstancePtr app;
     for (std::list<InlinedGroup>::iterator it = _oldGroups.begin(); it != _oldGroups.end(); ++it) {
@@ -1633,6 +1651,7 @@ InlineGroupCommand::undo()
 void
 InlineGroupCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
 
     NodeCollectionPtr newGroup = _newGroup.lock();
     AppInstancePtr app;
@@ -1765,6 +1784,7 @@ RestoreNodeToDefaultCommand::~RestoreNodeToDefaultCommand()
 void
 RestoreNodeToDefaultCommand::undo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     for (std::list<NodeDefaults>::const_iterator it = _nodes.begin(); it!=_nodes.end(); ++it) {
         NodeGuiPtr node = it->node.lock();
         if (!node) {
@@ -1781,6 +1801,7 @@ RestoreNodeToDefaultCommand::undo()
 void
 RestoreNodeToDefaultCommand::redo()
 {
+    HashInvalidationBatch_RAII hashBatch;
     for (std::list<NodeDefaults>::const_iterator it = _nodes.begin(); it!=_nodes.end(); ++it) {
         NodeGuiPtr node = it->node.lock();
         if (!node) {
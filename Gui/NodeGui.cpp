@@ -181,6 +181,7 @@ NodeGui::NodeGui(QGraphicsItem *parent)
     , _previewData( NATRON_PREVIEW_HEIGHT * NATRON_PREVIEW_WIDTH * sizeof(unsigned int) )
     , _previewW(NATRON_PREVIEW_WIDTH)
     , _previewH(NATRON_PREVIEW_HEIGHT)
+    , _previewRefreshTimer(NULL)
     , _persistentMessage(NULL)
     , _stateIndicator(NULL)
     , _mergeHintActive(false)
@@ -207,6 +208,10 @@ NodeGui::NodeGui(QGraphicsItem *parent)
     , _passThroughIndicator()
     , identityStateSet(false)
 {
+    _previewRefreshTimer = new QTimer(this);
+    _previewRefreshTimer->setSingleShot(true);
+    _previewRefreshTimer->setInterval(NATRON_PREVIEW_REFRESH_DELAY_MS);
+    QObject::connect( _previewRefreshTimer, SIGNAL(timeout()), this, SLOT(updatePreviewNow()) );
 }
 
 NodeGui::~NodeGui()
@@ -251,8 +256,6 @@ NodeGui::initialize(NodeGraph* dag,
     QObject::connect( internalNode.get(), SIGNAL(labelChanged(QString,QString)), dag->getGui(), SLOT(onNodeNameChanged(QString,QString)) );
     QObject::connect( internalNode.get(), SIGNAL(keepInAnimationModuleKnobChanged()), this, SLOT(onKeepInAnimationModuleKnobChanged()) );
 
-    setCacheMode(DeviceCoordinateCache);
-
     if (internalNode->isOutputNode()) {
         QObject::connect ( internalNode->getRenderEngine().get(), SIGNAL(refreshAllKnobs()), _graph, SLOT(refreshAllKnobsGui()) );
     }
@@ -1012,13 +1015,15 @@ NodeGui::refreshPositionEnd(double x,
                             double y)
 {
     setPos(x, y);
-    if (_graph) {
+    if ( _graph && scene() ) {
+        // Only visit the nodes overlapping this one rather than all the nodes of the graph
         QRectF bbox = mapRectToScene( boundingRect() );
-        const NodesGuiList & allNodes = _graph->getAllActiveNodes();
+        QList<QGraphicsItem*> overlappingItems = scene()->items(bbox, Qt::IntersectsItemBoundingRect);
 
-        for (NodesGuiList::const_iterator it = allNodes.begin(); it != allNodes.end(); ++it) {
-            if ( (*it)->isVisible() && (it->get() != this) && (*it)->intersects(bbox) ) {
-                setAboveItem((*it).get());
+        for (QList<QGraphicsItem*>::const_iterator it = overlappingItems.begin(); it != overlappingItems.end(); ++it) {
+            NodeGui* node = dynamic_cast<NodeGui*>(*it);
+            if ( node && (node != this) && node->isVisible() && node->intersects(bbox) ) {
+                setAboveItem(node);
             }
         }
     }
@@ -1327,7 +1332,9 @@ NodeGui::updatePreviewImage()
         assert(thisShared);
 
         // Delay the preview: this enables to almost always have a cached image instead of running concurrently with the viewer render.
-        QTimer::singleShot(300, this, SLOT(updatePreviewNow()));
+        // While the user is interacting (e.g: dragging a slider), each change restarts the delay so that a single preview
+        // is computed once the interaction is over.
+        _previewRefreshTimer->start();
 
     }
 }
@@ -2528,7 +2535,8 @@ struct NodeGuiIndicatorPrivate
         , textItem(NULL)
         , gradStops(gradient)
     {
-        ellipse = new QGraphicsEllipseItem(parent);
+        // Not drawn when too small to be readable
+        ellipse = new NodeGraphEllipseItem(graph, parent);
         int ellipseRad = width / 2;
         QPoint ellipsePos(topLeft.x() + (width / 2) - ellipseRad, -ellipseRad);
         QRectF ellipseRect(ellipsePos.x(), ellipsePos.y(), width, height);
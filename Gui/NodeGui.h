@@ -562,6 +562,9 @@ private:
     mutable QMutex _previewDataMutex;
     std::vector<unsigned int> _previewData;
     int _previewW, _previewH;
+
+    // Restarted by each updatePreviewImage() call, the preview is computed once the edits stopped for a moment
+    QTimer* _previewRefreshTimer;
     QGraphicsSimpleTextItem* _persistentMessage;
     NodeGraphRectItem* _stateIndicator;
     bool _mergeHintActive;
@@ -25,11 +25,15 @@
 
 #include "PreviewThread.h"
 
+#include <algorithm>
 #include <list>
+#include <map>
 #include <vector>
 #include <stdexcept>
 #include <cstring> // for std::memcpy, std::memset
 
+#include <boost/make_shared.hpp>
+
 #include <QtCore/QWaitCondition>
 #include <QtCore/QMutex>
 
@@ -37,37 +41,70 @@
 #include "Gui/NodeGui.h"
 
 #include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
 
 
 NATRON_NAMESPACE_ENTER
 
-class ComputePreviewRequest
+/**
+ * @brief Tells the thread to compute the previews pending in PreviewThreadPrivate::pendingRequests.
+ * Only one is enqueued at a time: the requests made in the meantime join the same batch.
+ **/
+class ComputePreviewsBatchRequest
     : public GenericThreadStartArgs
 {
 public:
 
-    TimeValue time;
-    NodeGuiWPtr node;
-
-    ComputePreviewRequest()
+    ComputePreviewsBatchRequest()
         : GenericThreadStartArgs()
-        , time(0)
-        , node()
     {}
 
-    virtual ~ComputePreviewRequest()
+    virtual ~ComputePreviewsBatchRequest()
     {
     }
 };
 
-typedef boost::shared_ptr<ComputePreviewRequest> ComputePreviewRequestPtr;
+typedef boost::shared_ptr<ComputePreviewsBatchRequest> ComputePreviewsBatchRequestPtr;
+
+struct PendingPreview
+{
+    NodeGuiWPtr node;
+    TimeValue time;
+
+    // Where the node is in the graph, to compute the previews of the inputs first
+    NodeCollection* group;
+    int topologicalIndex;
+};
+
+static bool
+inputsFirst(const PendingPreview& a,
+            const PendingPreview& b)
+{
+    if (a.group != b.group) {
+        return a.group < b.group;
+    }
+
+    return a.topologicalIndex < b.topologicalIndex;
+}
 
 struct PreviewThreadPrivate
 {
     std::vector<unsigned int> data;
 
+    // Protects pendingRequests and batchEnqueued
+    QMutex pendingRequestsMutex;
+
+    // The previews to compute in the next batch, one per node: the most recent request of a node replaces the previous one
+    std::map<NodeGui*, PendingPreview> pendingRequests;
+
+    // True if a ComputePreviewsBatchRequest is enqueued and did not start yet
+    bool batchEnqueued;
+
     PreviewThreadPrivate()
         : data( NATRON_PREVIEW_HEIGHT * NATRON_PREVIEW_WIDTH * sizeof(unsigned int) )
+        , pendingRequestsMutex()
+        , pendingRequests()
+        , batchEnqueued(false)
     {
     }
 };
@@ -89,23 +126,75 @@ void
 PreviewThread::appendToQueue(const NodeGuiPtr& node,
                              TimeValue time)
 {
-    ComputePreviewRequestPtr r = boost::make_shared<ComputePreviewRequest>();
+    {
+        QMutexLocker k(&_imp->pendingRequestsMutex);
+        PendingPreview& request = _imp->pendingRequests[node.get()];
+        request.node = node;
+        request.time = time;
+        request.group = 0;
+        request.topologicalIndex = -1;
+        if (_imp->batchEnqueued) {
+            return;
+        }
+        _imp->batchEnqueued = true;
+    }
 
-    r->node = node;
-    r->time = time;
-    startTask(r);
+    if ( !startTask( boost::make_shared<ComputePreviewsBatchRequest>() ) ) {
+        QMutexLocker k(&_imp->pendingRequestsMutex);
+        _imp->batchEnqueued = false;
+    }
 }
 
 GenericSchedulerThread::ThreadStateEnum
 PreviewThread::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
 {
-    ComputePreviewRequestPtr args = boost::dynamic_pointer_cast<ComputePreviewRequest>(inArgs);
+    assert( boost::dynamic_pointer_cast<ComputePreviewsBatchRequest>(inArgs) );
+    Q_UNUSED(inArgs);
+
+    std::vector<PendingPreview> batch;
+    {
+        QMutexLocker k(&_imp->pendingRequestsMutex);
+        batch.reserve( _imp->pendingRequests.size() );
+        for (std::map<NodeGui*, PendingPreview>::const_iterator it = _imp->pendingRequests.begin(); it != _imp->pendingRequests.end(); ++it) {
+            batch.push_back(it->second);
+        }
+        _imp->pendingRequests.clear();
+        _imp->batchEnqueued = false;
+    }
+
+    // Compute the previews of the inputs before the previews of their outputs: each preview is cached, so
+    // the render of a preview downstream reads the images of the previews upstream from the cache
+    {
+        std::map<NodeCollection*, NodeCollectionTopologyConstPtr> topologies;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            NodeGuiPtr node = batch[i].node.lock();
+            NodePtr internalNode = node ? node->getNode() : NodePtr();
+            NodeCollectionPtr group = internalNode ? internalNode->getGroup() : NodeCollectionPtr();
+            if (!group) {
+                continue;
+            }
+            NodeCollectionTopologyConstPtr& topology = topologies[group.get()];
+            if (!topology) {
+                topology = group->getTopology();
+            }
+            batch[i].group = group.get();
+            batch[i].topologicalIndex = topology->getIndex( internalNode.get() );
+        }
+        std::stable_sort(batch.begin(), batch.end(), inputsFirst);
+    }
 
-    assert(args);
+    for (std::size_t i = 0; i < batch.size(); ++i) {
 
+        // Stop early if the thread is aborted or quit: the previews will be requested again
+        ThreadStateEnum state = resolveState();
+        if ( (state == eThreadStateAborted) || (state == eThreadStateStopped) ) {
+            return state;
+        }
 
-    NodeGuiPtr node = args->node.lock();
-    if (node) {
+        NodeGuiPtr node = batch[i].node.lock();
+        if (!node) {
+            continue;
+        }
 
         //process the request if valid
         int w = NATRON_PREVIEW_WIDTH;
@@ -115,17 +204,16 @@ PreviewThread::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
 #ifndef __NATRON_WIN32__
         std::memset( &_imp->data.front(), 0, _imp->data.size() * sizeof(unsigned int) );
 #else
-        for (std::size_t i = 0; i < _imp->data.size(); ++i) {
-            _imp->data[i] = qRgba(0, 0, 0, 255);
+        for (std::size_t j = 0; j < _imp->data.size(); ++j) {
+            _imp->data[j] = qRgba(0, 0, 0, 255);
         }
 #endif
         NodePtr internalNode = node->getNode();
         if (internalNode) {
-            bool ok = internalNode->makePreviewImage( args->time, w, h, &_imp->data.front() );
+            bool ok = internalNode->makePreviewImage( batch[i].time, w, h, &_imp->data.front() );
             Q_UNUSED(ok);
             node->copyPreviewImageBuffer(_imp->data, w, h);
         }
-
     }
 
     return eThreadStateActive;
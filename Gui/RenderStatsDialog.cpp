@@ -26,6 +26,7 @@
 #include "RenderStatsDialog.h"
 
 #include <bitset>
+#include <map>
 #include <stdexcept>
 
 #include <QtCore/QCoreApplication>
@@ -33,11 +34,27 @@
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QCheckBox>
+#include <QTextEdit>
+#include <QFont>
 #include <QItemSelectionModel>
+#include <QPainter>
+#include <QtCore/QDir>
 #include <QtCore/QRegExp>
-
+#include <QtCore/QTimer>
+
+#include "Engine/AppManager.h"
+#include "Engine/CacheStats.h"
+#include "Engine/ImageStorage.h"
+#include "Engine/InteractiveLatency.h"
+#include "Engine/HashProfiler.h"
+#include "Engine/LockProfiler.h"
+#include "Engine/ThreadPoolMonitor.h"
+#include "Engine/MemoryInfo.h"
+#include "Engine/MemoryTimelineRecorder.h"
 #include "Engine/Node.h"
 #include "Engine/Timer.h"
+#include "Engine/TraceRecorder.h"
+#include "Engine/TreeRenderQueueManager.h"
 #include "Engine/Utils.h" // convertFromPlainText
 #include "Engine/ViewIdx.h"
 
@@ -46,14 +63,23 @@
 #include "Gui/Label.h"
 #include "Gui/LineEdit.h"
 #include "Gui/NodeGui.h"
+#include "Gui/SequenceFileDialog.h"
 #include "Gui/TableModelView.h"
 
 
 #define COL_NAME 0
 #define COL_PLUGIN_ID 1
 #define COL_TIME 2
+// One column per RenderStatsActionEnum
+#define COL_ACTION_FIRST 3
+#define COL_CACHE_HITS 8
+#define COL_CACHE_MISSES 9
+#define COL_CACHE_EVICTIONS 10
+#define COL_CACHE_RERENDER_TIME 11
+#define COL_MEMORY 12
+#define COL_MEMORY_PEAK 13
 
-#define NUM_COLS 3
+#define NUM_COLS 14
 
 NATRON_NAMESPACE_ENTER
 
@@ -64,6 +90,7 @@ enum ItemsRoleEnum
     eItemsRoleIdentityTilesInfo = 102,
     eItemsRoleRenderedTilesNb = 103,
     eItemsRoleRenderedTilesInfo = 104,
+    eItemsRoleCacheValue = 105,
 };
 
 struct RowInfo
@@ -91,6 +118,18 @@ struct StatRowsCompare
         switch (_col) {
             case COL_TIME:
                 return lhs.item->getData(_col, (int)eItemsRoleTime ).toDouble() < rhs.item->getData(_col, (int)eItemsRoleTime ).toDouble();
+            case COL_ACTION_FIRST + eRenderStatsActionGetRegionOfDefinition:
+            case COL_ACTION_FIRST + eRenderStatsActionIsIdentity:
+            case COL_ACTION_FIRST + eRenderStatsActionGetFramesNeeded:
+            case COL_ACTION_FIRST + eRenderStatsActionGetTimeInvariantMetadata:
+            case COL_ACTION_FIRST + eRenderStatsActionGetComponents:
+            case COL_CACHE_HITS:
+            case COL_CACHE_MISSES:
+            case COL_CACHE_EVICTIONS:
+            case COL_CACHE_RERENDER_TIME:
+            case COL_MEMORY:
+            case COL_MEMORY_PEAK:
+                return lhs.item->getData(_col, (int)eItemsRoleCacheValue ).toDouble() < rhs.item->getData(_col, (int)eItemsRoleCacheValue ).toDouble();
             default:
                 return lhs.item->getText(_col) < rhs.item->getText(_col);
         }
@@ -107,11 +146,15 @@ class StatsTableModel
 
     std::vector<NodeWPtr> rows;
 
+    // The stats of each row accumulated over the frames, for the action columns
+    std::map<NodeWPtr, NodeRenderStats> accumulatedStats;
+
     struct MakeSharedEnabler;
 
     StatsTableModel(int cols)
     : TableModel(cols, eTableModelTypeTable)
     , rows()
+    , accumulatedStats()
     {
     }
 
@@ -124,6 +167,7 @@ public:
     {
         clear();
         rows.clear();
+        accumulatedStats.clear();
     }
 
     const std::vector<NodeWPtr>& getRows() const
@@ -131,6 +175,24 @@ public:
         return rows;
     }
 
+    void setCacheColumn(const TableItemPtr& item,
+                        int col,
+                        const QColor& c,
+                        bool hasColor,
+                        const QString& toolTip,
+                        double value,
+                        const QString& text)
+    {
+        item->setToolTip(col, NATRON_NAMESPACE::convertFromPlainText(toolTip, NATRON_NAMESPACE::WhiteSpaceNormal));
+        item->setFlags(col, Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        if (hasColor) {
+            item->setTextColor(col, Qt::black);
+            item->setBackgroundColor(col, c);
+        }
+        item->setData(col, (int)eItemsRoleCacheValue, value);
+        item->setText(col, text);
+    }
+
     void editNodeRow(const NodePtr& node,
                      const NodeRenderStats& stats)
     {
@@ -215,6 +277,55 @@ public:
             item->setText(COL_TIME, Timer::printAsTime(timeSoFar, false) );
         }
 
+        {
+            // The calls of the actions other than render, accumulated over the frames
+            NodeRenderStats& actionStats = accumulatedStats[node];
+            if (exists) {
+                actionStats.accumulate(stats);
+            } else {
+                actionStats = stats;
+            }
+            for (int i = 0; i < eRenderStatsActionCount; ++i) {
+                RenderStatsActionEnum action = (RenderStatsActionEnum)i;
+                U64 nCalls = actionStats.getActionCallsCount(action);
+                QString text;
+                if (nCalls > 0) {
+                    text = tr("%1 / %2 (%3 calls)")
+                           .arg( Timer::printAsTime(actionStats.getActionMeanTime(action), false) )
+                           .arg( Timer::printAsTime(actionStats.getActionTimePercentile(action, 95.), false) )
+                           .arg( (qulonglong)nCalls );
+                }
+                // Sort by the total time spent in the action
+                setCacheColumn(item, COL_ACTION_FIRST + i, c, nodeUi.get() != 0, tr("The mean and 95th percentile of the time spent by this node in the %1 action, and the number of calls that were not answered by the cache.").arg( QString::fromUtf8( NodeRenderStats::getActionName(action) ) ), actionStats.getTotalTimeSpentInAction(action), text);
+            }
+        }
+
+        {
+            // The cache counters are accumulated by the node itself since its creation, sum them across all cache tiers
+            CacheNodeCounters counters;
+            node->getCacheStats(&counters);
+            CacheTierCounters total;
+            for (int i = 0; i < eCacheTierCount; ++i) {
+                total += counters.tiers[i];
+            }
+            setCacheColumn(item, COL_CACHE_HITS, c, nodeUi.get() != 0, tr("The number of cache lookups of this node that found their entry, in any cache tier."), (double)total.nHits, QString::number((qulonglong)total.nHits));
+            setCacheColumn(item, COL_CACHE_MISSES, c, nodeUi.get() != 0, tr("The number of cache lookups of this node that did not find their entry and had to render it."), (double)total.nMisses, QString::number((qulonglong)total.nMisses));
+            setCacheColumn(item, COL_CACHE_EVICTIONS, c, nodeUi.get() != 0, tr("The number of entries of this node that were evicted from the cache to make room for others."), (double)total.nEvictions, QString::number((qulonglong)total.nEvictions));
+            setCacheColumn(item, COL_CACHE_RERENDER_TIME, c, nodeUi.get() != 0, tr("The time spent by this node rendering again entries that had been evicted from the cache shortly before."), total.reRenderTime, Timer::printAsTime(total.reRenderTime, false));
+        }
+
+        {
+            // The memory allocated by the node for its images, in RAM and OpenGL textures, across all renders
+            MemoryBudgetPtr budget = node->getMemoryBudget();
+            std::size_t allocated = 0, peak = 0;
+            if (budget) {
+                allocated = budget->getAllocatedBytes(eStorageModeRAM) + budget->getAllocatedBytes(eStorageModeGLTex);
+                peak = budget->getPeakAllocatedBytes(eStorageModeRAM) + budget->getPeakAllocatedBytes(eStorageModeGLTex);
+            }
+            setCacheColumn(item, COL_MEMORY, c, nodeUi.get() != 0, tr("The memory currently allocated by this node for its images, in RAM and OpenGL textures."), (double)allocated, printAsRAM(allocated));
+            setCacheColumn(item, COL_MEMORY_PEAK, c, nodeUi.get() != 0, tr("The maximum amount of memory allocated at once by this node for its images since the last reset."), (double)peak, printAsRAM(peak));
+        }
+
         if (!exists) {
             rows.push_back(node);
         }
@@ -271,6 +382,122 @@ StatsTableModel::create(int cols)
     return boost::make_shared<StatsTableModel::MakeSharedEnabler>(cols);
 }
 
+/**
+ * @brief Draws the samples of the MemoryTimelineRecorder as one curve per kind of memory, in MB over time
+ **/
+class MemoryTimelineGraph
+    : public QWidget
+{
+public:
+
+    MemoryTimelineGraph(QWidget* parent)
+        : QWidget(parent)
+        , _samples()
+    {
+        setMinimumHeight(TO_DPIY(150));
+    }
+
+    virtual ~MemoryTimelineGraph()
+    {
+    }
+
+    void setSamples(const std::vector<MemoryTimelineRecorder::Sample>& samples)
+    {
+        _samples = samples;
+        update();
+    }
+
+private:
+
+    enum CurveEnum
+    {
+        eCurveRSS = 0,
+        eCurveTileCache,
+        eCurveImagesRAM,
+        eCurveImagesGL,
+        eCurveFreeRAM,
+        eCurveCount
+    };
+
+    static std::size_t getCurveValue(const MemoryTimelineRecorder::Sample& sample, int curve)
+    {
+        switch (curve) {
+        case eCurveRSS:
+            return sample.processRSS;
+        case eCurveTileCache:
+            return sample.tileCacheBytes + sample.compressedTilesBytes;
+        case eCurveImagesRAM:
+            return sample.imagesRAMBytes;
+        case eCurveImagesGL:
+            return sample.imagesGLBytes;
+        case eCurveFreeRAM:
+        default:
+            return sample.freeRAM;
+        }
+    }
+
+    virtual void paintEvent(QPaintEvent* /*e*/) OVERRIDE FINAL
+    {
+        const QString curveNames[eCurveCount] = {
+            tr("Process"), tr("Tile cache"), tr("Images (RAM)"), tr("Images (GPU)"), tr("Free RAM")
+        };
+        static const Qt::GlobalColor curveColors[eCurveCount] = {
+            Qt::white, Qt::yellow, Qt::green, Qt::magenta, Qt::cyan
+        };
+
+        QPainter p(this);
+        p.fillRect( rect(), Qt::black );
+
+        const int margin = TO_DPIX(4);
+        const int legendHeight = fontMetrics().height() + margin;
+        QRect plot( margin, legendHeight + margin, width() - 2 * margin, height() - legendHeight - 2 * margin );
+
+        // The legend, with the last value of each curve
+        int x = margin;
+        for (int c = 0; c < eCurveCount; ++c) {
+            QString text = curveNames[c];
+            if ( !_samples.empty() ) {
+                text += QString::fromUtf8(": ") + printAsRAM( getCurveValue(_samples.back(), c) );
+            }
+            p.setPen(curveColors[c]);
+            p.drawText( x, fontMetrics().ascent() + margin / 2, text );
+            x += fontMetrics().width(text) + 3 * margin;
+        }
+
+        if ( (_samples.size() < 2) || (plot.width() <= 0) || (plot.height() <= 0) ) {
+            return;
+        }
+
+        std::size_t maxValue = 1;
+        for (std::size_t i = 0; i < _samples.size(); ++i) {
+            for (int c = 0; c < eCurveCount; ++c) {
+                maxValue = std::max( maxValue, getCurveValue(_samples[i], c) );
+            }
+        }
+        double startTime = _samples.front().time;
+        double duration = std::max(_samples.back().time - startTime, 1e-3);
+
+        p.setPen(Qt::darkGray);
+        p.drawRect(plot);
+        p.drawText( plot.left() + margin, plot.top() + fontMetrics().ascent(), printAsRAM(maxValue) );
+        p.drawText( plot.right() - fontMetrics().width( QString::fromUtf8("0000.0 sec") ), plot.bottom() - margin, tr("%1 sec").arg(duration, 0, 'f', 1) );
+
+        p.setRenderHint(QPainter::Antialiasing);
+        for (int c = 0; c < eCurveCount; ++c) {
+            QPolygonF curve;
+            for (std::size_t i = 0; i < _samples.size(); ++i) {
+                double px = plot.left() + (_samples[i].time - startTime) / duration * plot.width();
+                double py = plot.bottom() - (double)getCurveValue(_samples[i], c) / maxValue * plot.height();
+                curve.push_back( QPointF(px, py) );
+            }
+            p.setPen(curveColors[c]);
+            p.drawPolyline(curve);
+        }
+    } // paintEvent
+
+    std::vector<MemoryTimelineRecorder::Sample> _samples;
+};
+
 struct RenderStatsDialogPrivate
 {
     Gui* gui;
@@ -283,6 +510,8 @@ struct RenderStatsDialogPrivate
     Label* totalTimeSpentDescLabel;
     Label* totalTimeSpentValueLabel;
     double totalSpentTime;
+    Label* abortLatencyDescLabel;
+    Label* abortLatencyValueLabel;
     Button* resetButton;
     QWidget* filterContainer;
     QHBoxLayout* filterLayout;
@@ -295,6 +524,42 @@ struct RenderStatsDialogPrivate
     QCheckBox* useUnixWildcardsCheckbox;
     TableView* view;
     StatsTableModelPtr model;
+    QWidget* lockProfileContainer;
+    QHBoxLayout* lockProfileLayout;
+    Label* lockProfileLabel;
+    QCheckBox* lockProfileCheckbox;
+    Button* lockProfileRefreshButton;
+    QTextEdit* lockProfileReport;
+    QWidget* hashProfileContainer;
+    QHBoxLayout* hashProfileLayout;
+    Label* hashProfileLabel;
+    QCheckBox* hashProfileCheckbox;
+    Button* hashProfileRefreshButton;
+    QTextEdit* hashProfileReport;
+    QWidget* threadPoolContainer;
+    QHBoxLayout* threadPoolLayout;
+    Label* threadPoolLabel;
+    QCheckBox* threadPoolCheckbox;
+    Button* threadPoolRefreshButton;
+    QTextEdit* threadPoolReport;
+    QWidget* latencyContainer;
+    QHBoxLayout* latencyLayout;
+    Label* latencyLabel;
+    QCheckBox* latencyCheckbox;
+    Button* latencyRefreshButton;
+    QTextEdit* latencyReport;
+    QWidget* traceContainer;
+    QHBoxLayout* traceLayout;
+    Label* traceLabel;
+    QCheckBox* traceCheckbox;
+    Button* traceSaveButton;
+    QWidget* memoryTimelineContainer;
+    QHBoxLayout* memoryTimelineLayout;
+    Label* memoryTimelineLabel;
+    QCheckBox* memoryTimelineCheckbox;
+    Button* memoryTimelineSaveButton;
+    MemoryTimelineGraph* memoryTimelineGraph;
+    QTimer* memoryTimelineRefreshTimer;
 
     RenderStatsDialogPrivate(Gui* gui)
         : gui(gui)
@@ -307,6 +572,8 @@ struct RenderStatsDialogPrivate
         , totalTimeSpentDescLabel(0)
         , totalTimeSpentValueLabel(0)
         , totalSpentTime(0)
+        , abortLatencyDescLabel(0)
+        , abortLatencyValueLabel(0)
         , resetButton(0)
         , filterContainer(0)
         , filterLayout(0)
@@ -319,12 +586,50 @@ struct RenderStatsDialogPrivate
         , useUnixWildcardsCheckbox(0)
         , view(0)
         , model()
+        , lockProfileContainer(0)
+        , lockProfileLayout(0)
+        , lockProfileLabel(0)
+        , lockProfileCheckbox(0)
+        , lockProfileRefreshButton(0)
+        , lockProfileReport(0)
+        , hashProfileContainer(0)
+        , hashProfileLayout(0)
+        , hashProfileLabel(0)
+        , hashProfileCheckbox(0)
+        , hashProfileRefreshButton(0)
+        , hashProfileReport(0)
+        , threadPoolContainer(0)
+        , threadPoolLayout(0)
+        , threadPoolLabel(0)
+        , threadPoolCheckbox(0)
+        , threadPoolRefreshButton(0)
+        , threadPoolReport(0)
+        , latencyContainer(0)
+        , latencyLayout(0)
+        , latencyLabel(0)
+        , latencyCheckbox(0)
+        , latencyRefreshButton(0)
+        , latencyReport(0)
+        , traceContainer(0)
+        , traceLayout(0)
+        , traceLabel(0)
+        , traceCheckbox(0)
+        , traceSaveButton(0)
+        , memoryTimelineContainer(0)
+        , memoryTimelineLayout(0)
+        , memoryTimelineLabel(0)
+        , memoryTimelineCheckbox(0)
+        , memoryTimelineSaveButton(0)
+        , memoryTimelineGraph(0)
+        , memoryTimelineRefreshTimer(0)
     {
     }
 
     void editNodeRow(const NodePtr& node, const NodeRenderStats& stats);
 
     void updateVisibleRowsInternal(const QString& nameFilter, const QString& pluginIDFilter);
+
+    void updateAbortLatency();
 };
 
 RenderStatsDialog::RenderStatsDialog(Gui* gui)
@@ -376,6 +681,20 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
     _imp->globalInfosLayout->addWidget(_imp->totalTimeSpentDescLabel);
     _imp->globalInfosLayout->addWidget(_imp->totalTimeSpentValueLabel);
 
+    _imp->globalInfosLayout->addSpacing(10);
+
+    QString abortTt = NATRON_NAMESPACE::convertFromPlainText(tr("This is the time renders took to stop once aborted, for example "
+                                                                "because a parameter changed while rendering: last, average and maximum "
+                                                                "over all the renders aborted since the last reset."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->abortLatencyDescLabel = new Label(tr("Abort latency:"), _imp->globalInfosContainer);
+    _imp->abortLatencyDescLabel->setToolTip(abortTt);
+    _imp->abortLatencyValueLabel = new Label(_imp->globalInfosContainer);
+    _imp->abortLatencyValueLabel->setToolTip(abortTt);
+    _imp->updateAbortLatency();
+
+    _imp->globalInfosLayout->addWidget(_imp->abortLatencyDescLabel);
+    _imp->globalInfosLayout->addWidget(_imp->abortLatencyValueLabel);
+
     _imp->resetButton = new Button(tr("Reset"), _imp->globalInfosContainer);
     _imp->resetButton->setToolTip( tr("Clears the statistics.") );
     QObject::connect( _imp->resetButton, SIGNAL(clicked(bool)), this, SLOT(resetStats()) );
@@ -441,7 +760,18 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
     dimensionNames
     << tr("Node")
     << tr("Plugin ID")
-    << tr("Time Spent");
+    << tr("Time Spent")
+    << tr("Region of Definition")
+    << tr("Is Identity")
+    << tr("Frames Needed")
+    << tr("Metadata")
+    << tr("Components")
+    << tr("Cache Hits")
+    << tr("Cache Misses")
+    << tr("Cache Evictions")
+    << tr("Re-render Time")
+    << tr("Memory")
+    << tr("Peak Memory");
     _imp->model = StatsTableModel::create(dimensionNames.size());
     _imp->view->setTableModel(_imp->model);
 
@@ -466,6 +796,221 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
     QItemSelectionModel* selModel = _imp->view->selectionModel();
     QObject::connect( selModel, SIGNAL(selectionChanged(QItemSelection,QItemSelection)), this, SLOT(onKnobsTreeSelectionChanged(QItemSelection,QItemSelection)) );
     _imp->mainLayout->addWidget(_imp->view);
+
+    _imp->lockProfileContainer = new QWidget(this);
+    _imp->lockProfileLayout = new QHBoxLayout(_imp->lockProfileContainer);
+
+    QString lockTt = NATRON_NAMESPACE::convertFromPlainText(tr("When checked, the time the render threads spend waiting for and holding "
+                                                               "the locks of the render engine is recorded for each lock site.\n"
+                                                               "An acquisition is contended when the lock was not available straight away.\n"
+                                                               "Profiling slows down the renders a little: only enable it to look for bottlenecks. "
+                                                               "The Reset button also clears the lock statistics."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->lockProfileLabel = new Label(tr("Profile locks:"), _imp->lockProfileContainer);
+    _imp->lockProfileLabel->setToolTip(lockTt);
+    _imp->lockProfileCheckbox = new QCheckBox(_imp->lockProfileContainer);
+    _imp->lockProfileCheckbox->setChecked( LockProfiler::isEnabled() );
+    _imp->lockProfileCheckbox->setToolTip(lockTt);
+    QObject::connect( _imp->lockProfileCheckbox, SIGNAL(toggled(bool)), this, SLOT(onLockProfilingToggled(bool)) );
+
+    _imp->lockProfileLayout->addWidget(_imp->lockProfileLabel);
+    _imp->lockProfileLayout->addWidget(_imp->lockProfileCheckbox);
+
+    _imp->lockProfileRefreshButton = new Button(tr("Refresh"), _imp->lockProfileContainer);
+    _imp->lockProfileRefreshButton->setToolTip( tr("Updates the lock statistics.") );
+    QObject::connect( _imp->lockProfileRefreshButton, SIGNAL(clicked(bool)), this, SLOT(updateLockProfileReport()) );
+    _imp->lockProfileLayout->addWidget(_imp->lockProfileRefreshButton);
+
+    _imp->lockProfileLayout->addStretch();
+
+    _imp->mainLayout->addWidget(_imp->lockProfileContainer);
+
+    _imp->lockProfileReport = new QTextEdit(this);
+    _imp->lockProfileReport->setReadOnly(true);
+    _imp->lockProfileReport->setLineWrapMode(QTextEdit::NoWrap);
+    // The report is a table aligned with spaces
+    QFont monospaceFont(QString::fromUtf8("Courier"));
+    monospaceFont.setStyleHint(QFont::TypeWriter);
+    _imp->lockProfileReport->setFont(monospaceFont);
+    _imp->lockProfileReport->setVisible( LockProfiler::isEnabled() );
+    _imp->mainLayout->addWidget(_imp->lockProfileReport);
+    updateLockProfileReport();
+
+    _imp->hashProfileContainer = new QWidget(this);
+    _imp->hashProfileLayout = new QHBoxLayout(_imp->hashProfileContainer);
+
+    QString hashTt = NATRON_NAMESPACE::convertFromPlainText(tr("When checked, the computations of the hashes of the nodes and parameters "
+                                                               "and the invalidations of their hash cache are counted and timed.\n"
+                                                               "The fan-out of an invalidation is the number of nodes and parameters whose "
+                                                               "hash it cleared: the table lists the nodes and parameters whose edits cause "
+                                                               "the largest invalidation cascades.\n"
+                                                               "The Reset button also clears the hash statistics."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->hashProfileLabel = new Label(tr("Profile hashes:"), _imp->hashProfileContainer);
+    _imp->hashProfileLabel->setToolTip(hashTt);
+    _imp->hashProfileCheckbox = new QCheckBox(_imp->hashProfileContainer);
+    _imp->hashProfileCheckbox->setChecked( HashProfiler::isEnabled() );
+    _imp->hashProfileCheckbox->setToolTip(hashTt);
+    QObject::connect( _imp->hashProfileCheckbox, SIGNAL(toggled(bool)), this, SLOT(onHashProfilingToggled(bool)) );
+
+    _imp->hashProfileLayout->addWidget(_imp->hashProfileLabel);
+    _imp->hashProfileLayout->addWidget(_imp->hashProfileCheckbox);
+
+    _imp->hashProfileRefreshButton = new Button(tr("Refresh"), _imp->hashProfileContainer);
+    _imp->hashProfileRefreshButton->setToolTip( tr("Updates the hash statistics.") );
+    QObject::connect( _imp->hashProfileRefreshButton, SIGNAL(clicked(bool)), this, SLOT(updateHashProfileReport()) );
+    _imp->hashProfileLayout->addWidget(_imp->hashProfileRefreshButton);
+
+    _imp->hashProfileLayout->addStretch();
+
+    _imp->mainLayout->addWidget(_imp->hashProfileContainer);
+
+    _imp->hashProfileReport = new QTextEdit(this);
+    _imp->hashProfileReport->setReadOnly(true);
+    _imp->hashProfileReport->setLineWrapMode(QTextEdit::NoWrap);
+    _imp->hashProfileReport->setFont(monospaceFont);
+    _imp->hashProfileReport->setVisible( HashProfiler::isEnabled() );
+    _imp->mainLayout->addWidget(_imp->hashProfileReport);
+    updateHashProfileReport();
+
+    _imp->threadPoolContainer = new QWidget(this);
+    _imp->threadPoolLayout = new QHBoxLayout(_imp->threadPoolContainer);
+
+    QString threadPoolTt = NATRON_NAMESPACE::convertFromPlainText(tr("When checked, the use of the render threads is measured: the time each "
+                                                                     "thread spends running render tasks, how long the tasks stay queued before "
+                                                                     "a thread runs them, and how many threads are blocked waiting for tiles "
+                                                                     "rendered by other threads or released to the pool while waiting.\n"
+                                                                     "Threads that are mostly busy mean that the renders are bound by the CPU, "
+                                                                     "whereas long waits mean that more threads would not make them faster.\n"
+                                                                     "When a trace is recorded, these numbers are also recorded as counters of the trace.\n"
+                                                                     "The Reset button also clears the thread statistics."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->threadPoolLabel = new Label(tr("Monitor threads:"), _imp->threadPoolContainer);
+    _imp->threadPoolLabel->setToolTip(threadPoolTt);
+    _imp->threadPoolCheckbox = new QCheckBox(_imp->threadPoolContainer);
+    _imp->threadPoolCheckbox->setChecked( ThreadPoolMonitor::isEnabled() );
+    _imp->threadPoolCheckbox->setToolTip(threadPoolTt);
+    QObject::connect( _imp->threadPoolCheckbox, SIGNAL(toggled(bool)), this, SLOT(onThreadPoolMonitoringToggled(bool)) );
+
+    _imp->threadPoolLayout->addWidget(_imp->threadPoolLabel);
+    _imp->threadPoolLayout->addWidget(_imp->threadPoolCheckbox);
+
+    _imp->threadPoolRefreshButton = new Button(tr("Refresh"), _imp->threadPoolContainer);
+    _imp->threadPoolRefreshButton->setToolTip( tr("Updates the thread statistics.") );
+    QObject::connect( _imp->threadPoolRefreshButton, SIGNAL(clicked(bool)), this, SLOT(updateThreadPoolReport()) );
+    _imp->threadPoolLayout->addWidget(_imp->threadPoolRefreshButton);
+
+    _imp->threadPoolLayout->addStretch();
+
+    _imp->mainLayout->addWidget(_imp->threadPoolContainer);
+
+    _imp->threadPoolReport = new QTextEdit(this);
+    _imp->threadPoolReport->setReadOnly(true);
+    _imp->threadPoolReport->setLineWrapMode(QTextEdit::NoWrap);
+    _imp->threadPoolReport->setFont(monospaceFont);
+    _imp->threadPoolReport->setVisible( ThreadPoolMonitor::isEnabled() );
+    _imp->mainLayout->addWidget(_imp->threadPoolReport);
+    updateThreadPoolReport();
+
+    _imp->latencyContainer = new QWidget(this);
+    _imp->latencyLayout = new QHBoxLayout(_imp->latencyContainer);
+
+    QString latencyTt = NATRON_NAMESPACE::convertFromPlainText(tr("When checked, the time between an edit of a parameter and the display of "
+                                                                  "its result in the viewer is measured for each stage: the invalidation of the hash, "
+                                                                  "the render request, the start and end of the render, the upload of the textures "
+                                                                  "and the display.
+"
+                                                                  "The latencies are relative to the edit, over the last %1 edits. "
+                                                                  "The Reset button also clears them.").arg(NATRON_INTERACTIVE_LATENCY_SAMPLES), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->latencyLabel = new Label(tr("Measure interactive latency:"), _imp->latencyContainer);
+    _imp->latencyLabel->setToolTip(latencyTt);
+    _imp->latencyCheckbox = new QCheckBox(_imp->latencyContainer);
+    _imp->latencyCheckbox->setChecked( InteractiveLatency::isEnabled() );
+    _imp->latencyCheckbox->setToolTip(latencyTt);
+    QObject::connect( _imp->latencyCheckbox, SIGNAL(toggled(bool)), this, SLOT(onLatencyMeasurementToggled(bool)) );
+
+    _imp->latencyLayout->addWidget(_imp->latencyLabel);
+    _imp->latencyLayout->addWidget(_imp->latencyCheckbox);
+
+    _imp->latencyRefreshButton = new Button(tr("Refresh"), _imp->latencyContainer);
+    _imp->latencyRefreshButton->setToolTip( tr("Updates the latency statistics.") );
+    QObject::connect( _imp->latencyRefreshButton, SIGNAL(clicked(bool)), this, SLOT(updateLatencyReport()) );
+    _imp->latencyLayout->addWidget(_imp->latencyRefreshButton);
+
+    _imp->latencyLayout->addStretch();
+
+    _imp->mainLayout->addWidget(_imp->latencyContainer);
+
+    _imp->latencyReport = new QTextEdit(this);
+    _imp->latencyReport->setReadOnly(true);
+    _imp->latencyReport->setLineWrapMode(QTextEdit::NoWrap);
+    _imp->latencyReport->setFont(monospaceFont);
+    _imp->latencyReport->setVisible( InteractiveLatency::isEnabled() );
+    _imp->mainLayout->addWidget(_imp->latencyReport);
+    updateLatencyReport();
+
+    _imp->traceContainer = new QWidget(this);
+    _imp->traceLayout = new QHBoxLayout(_imp->traceContainer);
+
+    QString traceTt = NATRON_NAMESPACE::convertFromPlainText(tr("When checked, the timeline of the renders is recorded in each thread: "
+                                                                "the render of each node, the cache look-ups, the waits for pending images, "
+                                                                "the OpenFX actions, the GPU transfers and the file I/O.\n"
+                                                                "Save the trace to open it in chrome://tracing or https://ui.perfetto.dev. "
+                                                                "The Reset button also clears the trace."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->traceLabel = new Label(tr("Record trace:"), _imp->traceContainer);
+    _imp->traceLabel->setToolTip(traceTt);
+    _imp->traceCheckbox = new QCheckBox(_imp->traceContainer);
+    _imp->traceCheckbox->setChecked( TraceRecorder::isEnabled() );
+    _imp->traceCheckbox->setToolTip(traceTt);
+    QObject::connect( _imp->traceCheckbox, SIGNAL(toggled(bool)), this, SLOT(onTraceRecordingToggled(bool)) );
+
+    _imp->traceLayout->addWidget(_imp->traceLabel);
+    _imp->traceLayout->addWidget(_imp->traceCheckbox);
+
+    _imp->traceSaveButton = new Button(tr("Save Trace..."), _imp->traceContainer);
+    _imp->traceSaveButton->setToolTip( tr("Writes the trace recorded so far to a JSON file.") );
+    QObject::connect( _imp->traceSaveButton, SIGNAL(clicked(bool)), this, SLOT(onSaveTraceClicked()) );
+    _imp->traceLayout->addWidget(_imp->traceSaveButton);
+
+    _imp->traceLayout->addStretch();
+
+    _imp->mainLayout->addWidget(_imp->traceContainer);
+
+    _imp->memoryTimelineContainer = new QWidget(this);
+    _imp->memoryTimelineLayout = new QHBoxLayout(_imp->memoryTimelineContainer);
+
+    QString memoryTimelineTt = NATRON_NAMESPACE::convertFromPlainText(tr("When checked, the memory of %1 is sampled every second: the size of the caches, "
+                                                                         "the images allocated by the renders in RAM and on the GPU, the resident memory "
+                                                                         "of the process and the free RAM.\n"
+                                                                         "Memory of the process that grows while the caches and the images do not is likely a leak. "
+                                                                         "The Reset button also clears the samples.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->memoryTimelineLabel = new Label(tr("Record memory timeline:"), _imp->memoryTimelineContainer);
+    _imp->memoryTimelineLabel->setToolTip(memoryTimelineTt);
+    _imp->memoryTimelineCheckbox = new QCheckBox(_imp->memoryTimelineContainer);
+    _imp->memoryTimelineCheckbox->setChecked( appPTR->getMemoryTimelineRecorder()->isRecording() );
+    _imp->memoryTimelineCheckbox->setToolTip(memoryTimelineTt);
+    QObject::connect( _imp->memoryTimelineCheckbox, SIGNAL(toggled(bool)), this, SLOT(onMemoryTimelineToggled(bool)) );
+
+    _imp->memoryTimelineLayout->addWidget(_imp->memoryTimelineLabel);
+    _imp->memoryTimelineLayout->addWidget(_imp->memoryTimelineCheckbox);
+
+    _imp->memoryTimelineSaveButton = new Button(tr("Save Timeline..."), _imp->memoryTimelineContainer);
+    _imp->memoryTimelineSaveButton->setToolTip( tr("Writes the samples recorded so far to a CSV or JSON file.") );
+    QObject::connect( _imp->memoryTimelineSaveButton, SIGNAL(clicked(bool)), this, SLOT(onSaveMemoryTimelineClicked()) );
+    _imp->memoryTimelineLayout->addWidget(_imp->memoryTimelineSaveButton);
+
+    _imp->memoryTimelineLayout->addStretch();
+
+    _imp->mainLayout->addWidget(_imp->memoryTimelineContainer);
+
+    _imp->memoryTimelineGraph = new MemoryTimelineGraph(this);
+    _imp->memoryTimelineGraph->setVisible( _imp->memoryTimelineCheckbox->isChecked() );
+    _imp->mainLayout->addWidget(_imp->memoryTimelineGraph);
+
+    _imp->memoryTimelineRefreshTimer = new QTimer(this);
+    _imp->memoryTimelineRefreshTimer->setInterval(NATRON_MEMORY_TIMELINE_DEFAULT_INTERVAL_MS);
+    QObject::connect( _imp->memoryTimelineRefreshTimer, SIGNAL(timeout()), this, SLOT(updateMemoryTimelineGraph()) );
+    if ( _imp->memoryTimelineCheckbox->isChecked() ) {
+        _imp->memoryTimelineRefreshTimer->start();
+    }
+    updateMemoryTimelineGraph();
 }
 
 RenderStatsDialog::~RenderStatsDialog()
@@ -500,9 +1045,172 @@ RenderStatsDialog::onKnobsTreeSelectionChanged(const QItemSelection &selected,
 void
 RenderStatsDialog::resetStats()
 {
+    const std::vector<NodeWPtr>& rows = _imp->model->getRows();
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        NodePtr node = rows[i].lock();
+        MemoryBudgetPtr budget = node ? node->getMemoryBudget() : MemoryBudgetPtr();
+        if (budget) {
+            budget->resetPeaks();
+        }
+    }
     _imp->model->clearRows();
     _imp->totalTimeSpentValueLabel->setText( QString::fromUtf8("0.0 sec") );
     _imp->totalSpentTime = 0;
+    appPTR->getTasksQueueManager()->resetAbortLatencyStats();
+    _imp->updateAbortLatency();
+    LockProfiler::reset();
+    updateLockProfileReport();
+    HashProfiler::reset();
+    updateHashProfileReport();
+    ThreadPoolMonitor::reset();
+    updateThreadPoolReport();
+    InteractiveLatency::reset();
+    updateLatencyReport();
+    TraceRecorder::reset();
+    MemoryTimelineRecorder* memoryTimeline = appPTR->getMemoryTimelineRecorder();
+    if ( memoryTimeline->isRecording() ) {
+        memoryTimeline->startRecording( memoryTimeline->getIntervalMS() );
+    }
+    updateMemoryTimelineGraph();
+}
+
+void
+RenderStatsDialog::onLockProfilingToggled(bool enabled)
+{
+    LockProfiler::setEnabled(enabled);
+    _imp->lockProfileReport->setVisible(enabled);
+    updateLockProfileReport();
+}
+
+void
+RenderStatsDialog::onHashProfilingToggled(bool enabled)
+{
+    HashProfiler::setEnabled(enabled);
+    _imp->hashProfileReport->setVisible(enabled);
+    updateHashProfileReport();
+}
+
+void
+RenderStatsDialog::onThreadPoolMonitoringToggled(bool enabled)
+{
+    ThreadPoolMonitor::setEnabled(enabled);
+    _imp->threadPoolReport->setVisible(enabled);
+    updateThreadPoolReport();
+}
+
+void
+RenderStatsDialog::onLatencyMeasurementToggled(bool enabled)
+{
+    InteractiveLatency::setEnabled(enabled);
+    _imp->latencyReport->setVisible(enabled);
+    updateLatencyReport();
+}
+
+void
+RenderStatsDialog::onTraceRecordingToggled(bool enabled)
+{
+    TraceRecorder::setEnabled(enabled);
+}
+
+void
+RenderStatsDialog::onSaveTraceClicked()
+{
+    std::vector<std::string> filters;
+    filters.push_back("json");
+    SequenceFileDialog dialog(this, filters, false, SequenceFileDialog::eFileDialogModeSave, _imp->gui->getLastSaveProjectDirectory().toStdString(),
+                              _imp->gui, false);
+
+    if ( !dialog.exec() ) {
+        return;
+    }
+    QDir currentDir = dialog.currentDirectory();
+    _imp->gui->updateLastSavedProjectPath( currentDir.absolutePath() );
+
+    if ( !TraceRecorder::writeTrace( dialog.selectedFiles() ) ) {
+        Dialogs::errorDialog( tr("Operation failed").toStdString(), tr("Failure to save the file").toStdString() );
+    }
+}
+
+void
+RenderStatsDialog::onMemoryTimelineToggled(bool enabled)
+{
+    MemoryTimelineRecorder* memoryTimeline = appPTR->getMemoryTimelineRecorder();
+    if (enabled) {
+        memoryTimeline->startRecording();
+        _imp->memoryTimelineRefreshTimer->start();
+    } else {
+        memoryTimeline->stopRecording();
+        _imp->memoryTimelineRefreshTimer->stop();
+    }
+    _imp->memoryTimelineGraph->setVisible(enabled);
+    updateMemoryTimelineGraph();
+}
+
+void
+RenderStatsDialog::onSaveMemoryTimelineClicked()
+{
+    std::vector<std::string> filters;
+    filters.push_back("csv");
+    filters.push_back("json");
+    SequenceFileDialog dialog(this, filters, false, SequenceFileDialog::eFileDialogModeSave, _imp->gui->getLastSaveProjectDirectory().toStdString(),
+                              _imp->gui, false);
+
+    if ( !dialog.exec() ) {
+        return;
+    }
+    QDir currentDir = dialog.currentDirectory();
+    _imp->gui->updateLastSavedProjectPath( currentDir.absolutePath() );
+
+    if ( !appPTR->getMemoryTimelineRecorder()->writeToFile( dialog.selectedFiles() ) ) {
+        Dialogs::errorDialog( tr("Operation failed").toStdString(), tr("Failure to save the file").toStdString() );
+    }
+}
+
+void
+RenderStatsDialog::updateMemoryTimelineGraph()
+{
+    if ( !_imp->memoryTimelineCheckbox->isChecked() ) {
+        return;
+    }
+    std::vector<MemoryTimelineRecorder::Sample> samples;
+    appPTR->getMemoryTimelineRecorder()->getSamples(&samples);
+    _imp->memoryTimelineGraph->setSamples(samples);
+}
+
+void
+RenderStatsDialog::updateLockProfileReport()
+{
+    if ( !_imp->lockProfileCheckbox->isChecked() ) {
+        return;
+    }
+    _imp->lockProfileReport->setPlainText( QString::fromUtf8( LockProfiler::getReport().c_str() ) );
+}
+
+void
+RenderStatsDialog::updateHashProfileReport()
+{
+    if ( !_imp->hashProfileCheckbox->isChecked() ) {
+        return;
+    }
+    _imp->hashProfileReport->setPlainText( QString::fromUtf8( HashProfiler::getReport().c_str() ) );
+}
+
+void
+RenderStatsDialog::updateThreadPoolReport()
+{
+    if ( !_imp->threadPoolCheckbox->isChecked() ) {
+        return;
+    }
+    _imp->threadPoolReport->setPlainText( QString::fromUtf8( ThreadPoolMonitor::getReport().c_str() ) );
+}
+
+void
+RenderStatsDialog::updateLatencyReport()
+{
+    if ( !_imp->latencyCheckbox->isChecked() ) {
+        return;
+    }
+    _imp->latencyReport->setPlainText( QString::fromUtf8( InteractiveLatency::getReport().c_str() ) );
 }
 
 void
@@ -527,6 +1235,27 @@ RenderStatsDialog::addStats(int /*time*/,
         _imp->view->header()->setSortIndicator(COL_TIME, Qt::DescendingOrder);
         _imp->model->sort(COL_TIME, Qt::DescendingOrder);
     }
+    _imp->updateAbortLatency();
+    updateLockProfileReport();
+    updateHashProfileReport();
+    updateThreadPoolReport();
+    updateLatencyReport();
+}
+
+void
+RenderStatsDialogPrivate::updateAbortLatency()
+{
+    TreeRenderQueueManager::AbortLatencyStats stats;
+    appPTR->getTasksQueueManager()->getAbortLatencyStats(&stats);
+    if (stats.nAbortedRenders == 0) {
+        abortLatencyValueLabel->setText( RenderStatsDialog::tr("No render aborted") );
+        return;
+    }
+    abortLatencyValueLabel->setText( RenderStatsDialog::tr("%1 ms (average %2 ms, max %3 ms, %4 renders)")
+                                    .arg(stats.lastLatency * 1000., 0, 'f', 1)
+                                    .arg(stats.averageLatency * 1000., 0, 'f', 1)
+                                    .arg(stats.maxLatency * 1000., 0, 'f', 1)
+                                    .arg(stats.nAbortedRenders) );
 }
 
 void
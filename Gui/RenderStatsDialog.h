@@ -73,6 +73,25 @@ public Q_SLOTS:
     void onNameLineEditChanged(const QString& filter);
     void onIDLineEditChanged(const QString& filter);
 
+    void onLockProfilingToggled(bool enabled);
+    void updateLockProfileReport();
+
+    void onHashProfilingToggled(bool enabled);
+    void updateHashProfileReport();
+
+    void onThreadPoolMonitoringToggled(bool enabled);
+    void updateThreadPoolReport();
+
+    void onLatencyMeasurementToggled(bool enabled);
+    void updateLatencyReport();
+
+    void onTraceRecordingToggled(bool enabled);
+    void onSaveTraceClicked();
+
+    void onMemoryTimelineToggled(bool enabled);
+    void onSaveMemoryTimelineClicked();
+    void updateMemoryTimelineGraph();
+
 private:
 
     virtual void closeEvent(QCloseEvent * event) OVERRIDE FINAL;
@@ -78,6 +78,115 @@ const char* vertRGB =
     "\n"
 ;
 
+// The display transform of the viewer, shared by the shaders reading linear textures
+#define NATRON_DISPLAY_TRANSFORM_GLSL \
+    "uniform float gain;\n" \
+    "uniform float gamma;\n" \
+    "uniform int lut;\n" /* ViewerColorSpaceEnum */ \
+    "uniform int channels;\n" /* DisplayChannelsEnum */ \
+    "\n" \
+    "float linear_to_srgb(float c) {\n" \
+    "    return (c<=0.0031308) ? (12.92*c) : (((1.0+0.055)*pow(c,1.0/2.4))-0.055);\n" \
+    "}\n" \
+    "float linear_to_rec709(float c) {\n" \
+    "    return (c<0.018) ? (4.500*c) : (1.099*pow(c,0.45) - 0.099);\n" \
+    "}\n" \
+    "float apply_gamma(float c) {\n" \
+    "    if (gamma <= 0.0) {\n" \
+    "        return (c >= 1.0) ? 1.0 : 0.0;\n" \
+    "    }\n" \
+    "    return pow(clamp(c, 0.0, 1.0), 1.0/gamma);\n" \
+    "}\n" \
+    "vec4 display_transform(vec4 color_tmp) {\n" \
+    "    color_tmp.rgb = color_tmp.rgb * gain;\n" \
+    "    if (gamma != 1.0) {\n" \
+    "        color_tmp.r = apply_gamma(color_tmp.r);\n" \
+    "        color_tmp.g = apply_gamma(color_tmp.g);\n" \
+    "        color_tmp.b = apply_gamma(color_tmp.b);\n" \
+    "    }\n" \
+    "    if (channels == 0) { // luminance\n" \
+    "        color_tmp.rgb = vec3(0.299*color_tmp.r + 0.587*color_tmp.g + 0.114*color_tmp.b);\n" \
+    "    } else if (channels == 2) { // R\n" \
+    "        color_tmp.rgb = vec3(color_tmp.r);\n" \
+    "    } else if (channels == 3) { // G\n" \
+    "        color_tmp.rgb = vec3(color_tmp.g);\n" \
+    "    } else if (channels == 4) { // B\n" \
+    "        color_tmp.rgb = vec3(color_tmp.b);\n" \
+    "    }\n" \
+    "    if (lut == 1) { // sRGB\n" \
+    "        color_tmp.r = linear_to_srgb(color_tmp.r);\n" \
+    "        color_tmp.g = linear_to_srgb(color_tmp.g);\n" \
+    "        color_tmp.b = linear_to_srgb(color_tmp.b);\n" \
+    "    } else if (lut == 2) { // Rec 709\n" \
+    "        color_tmp.r = linear_to_rec709(color_tmp.r);\n" \
+    "        color_tmp.g = linear_to_rec709(color_tmp.g);\n" \
+    "        color_tmp.b = linear_to_rec709(color_tmp.b);\n" \
+    "    }\n" \
+    "    return color_tmp;\n" \
+    "}\n"
+
+const char* fragDisplayTransform =
+    "uniform sampler2D Tex;\n"
+    NATRON_DISPLAY_TRANSFORM_GLSL
+    "void main(){\n"
+    "    gl_FragColor = display_transform(texture2D(Tex,gl_TexCoord[0].st));\n"
+    "}\n"
+;
+
+/*Each vertex is a texel of the texture, moved to the bin of the scope it falls in.
+   The scope, mode and bin ranges are documented in HistogramGPU.
+ */
+const char* histogramGPUScatter_vert =
+    "#version 120\n"
+    "uniform sampler2D Tex;\n"
+    "uniform vec2 texSize;\n" // in pixels
+    "uniform float stride;\n" // distance between two sampled texels, in pixels
+    "uniform int scope;\n" // Histogram::ScopeTypeEnum
+    "uniform int mode;\n" // Histogram::DisplayModeEnum, R, G or B in the RGB mode
+    "uniform float vmin;\n"
+    "uniform float vmax;\n"
+    "uniform int applyDisplayTransform;\n"
+    NATRON_DISPLAY_TRANSFORM_GLSL
+    "void main()\n"
+    "{\n"
+    "    vec2 texel = min(gl_Vertex.xy * stride, texSize - 1.0) + 0.5;\n"
+    "    vec4 c = texture2DLod(Tex, texel / texSize, 0.0);\n"
+    "    if (applyDisplayTransform != 0) {\n"
+    "        c = display_transform(c);\n"
+    "    }\n"
+    "    float v;\n"
+    "    if (mode == 1) {\n" // A
+    "        v = c.a;\n"
+    "    } else if (mode == 2) {\n" // Y
+    "        v = 0.299 * c.r + 0.587 * c.g + 0.114 * c.b;\n"
+    "    } else if (mode == 3) {\n" // R
+    "        v = c.r;\n"
+    "    } else if (mode == 4) {\n" // G
+    "        v = c.g;\n"
+    "    } else {\n" // B
+    "        v = c.b;\n"
+    "    }\n"
+    "    float vNormalized = (v - vmin) / (vmax - vmin) * 2.0 - 1.0;\n"
+    "    vec2 pos;\n"
+    "    if (scope == 0) {\n" // histogram: out of range values are clipped
+    "        pos = vec2(vNormalized, 0.0);\n"
+    "    } else if (scope == 1) {\n" // waveform: the column of the texel and its value
+    "        pos = vec2(texel.x / texSize.x * 2.0 - 1.0, vNormalized);\n"
+    "    } else {\n" // vectorscope: the Rec. 709 chroma of the texel, Cb and Cr in [-0.5,0.5]
+    "        float y = 0.2126 * c.r + 0.7152 * c.g + 0.0722 * c.b;\n"
+    "        pos = vec2( (c.b - y) / 1.8556, (c.r - y) / 1.5748 ) * 2.0;\n"
+    "    }\n"
+    "    gl_Position = vec4(pos, 0.0, 1.0);\n"
+    "}\n"
+;
+
+const char* histogramGPUScatter_frag =
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = vec4(1.0);\n"
+    "}\n"
+;
+
 /*There's a black texture used for when the user disconnect the viewer
    It's not just a shader,because we still need coordinates feedback.
  */
@@ -33,6 +33,16 @@ NATRON_NAMESPACE_ENTER
 extern const char* fragRGB;
 extern const char* vertRGB;
 
+/*Applies the display transform of the viewer (gain, gamma, colorspace and channels) to a linear texture.
+   This is the GPU version of the processing done in ViewerInstance::render.
+ */
+extern const char* fragDisplayTransform;
+
+/*Used by HistogramGPU to accumulate the texels of a texture in the bins of a scope.
+ */
+extern const char* histogramGPUScatter_vert;
+extern const char* histogramGPUScatter_frag;
+
 /*There's a black texture used for when the user disconnect the viewer
    It's not just a shader,because we still need coordinates feedback.
  */
@@ -25,7 +25,9 @@
 
 #include "TextRenderer.h"
 
+#include <map>
 #include <stdexcept>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
@@ -51,7 +53,8 @@ CLANG_DIAG_ON(deprecated)
 NATRON_NAMESPACE_ENTER
 
 
-#define TEXTURE_SIZE 256
+// Large enough for all the glyphs of a font to fit in one texture, so that a text batch is drawn in a single call
+#define TEXTURE_SIZE 1024
 
 #define NATRON_TEXT_RENDERER_USE_CACHE
 
@@ -98,6 +101,19 @@ struct TextRendererPrivate
 typedef boost::shared_ptr<TextRendererPrivate> TextRendererPrivatePtr;
 typedef std::map<QFont, TextRendererPrivatePtr> FontRenderers;
 
+/**
+ * @brief The quads of the glyphs to draw from the same texture. The vertices are in clip coordinates
+ * so that glyphs queued with different transforms are drawn together.
+ **/
+struct GlyphQuads
+{
+    std::vector<GLfloat> vertices; // 4 components per vertex
+    std::vector<GLfloat> texCoords; // 2 components per vertex
+    std::vector<GLfloat> colors; // 4 components per vertex
+};
+
+typedef std::map<GLuint, GlyphQuads> GlyphBatch;
+
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 
@@ -179,10 +195,21 @@ TextRendererPrivate::createCharacter(QChar c)
         newTransparentTexture();
     }
 
-    GLuint texture = _usedTextures.back();
     GLsizei width = _fontMetrics.width(c);
     GLsizei height = _fontMetrics.height();
 
+    // Find room for the glyph, leaving a 1 pixel gap between glyphs so that linear filtering does not bleed
+    if (_xOffset + width > TEXTURE_SIZE) {
+        _xOffset = 0;
+        _yOffset += height + 1;
+    }
+    if (_yOffset + height > TEXTURE_SIZE) {
+        newTransparentTexture();
+        _xOffset = 0;
+        _yOffset = 0;
+    }
+    GLuint texture = _usedTextures.back();
+
     // render into a new transparent pixmap using QPainter
     QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
     image.fill(Qt::transparent);
@@ -228,15 +255,7 @@ TextRendererPrivate::createCharacter(QChar c)
     assert( retIt != _bitmapsCache.end() );
 #endif
 
-    _xOffset += width;
-    if (_xOffset + width >= TEXTURE_SIZE) {
-        _xOffset = 1;
-        _yOffset += height;
-    }
-    if (_yOffset + height >= TEXTURE_SIZE) {
-        newTransparentTexture();
-        _yOffset = 1;
-    }
+    _xOffset += width + 1;
 
 #ifdef NATRON_TEXT_RENDERER_USE_CACHE
 
@@ -247,14 +266,60 @@ TextRendererPrivate::createCharacter(QChar c)
 #endif
 } // createCharacter
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// out = a * b, matrices are column-major as in OpenGL
+static void
+multMatrix(const GLfloat* a,
+           const GLfloat* b,
+           GLfloat* out)
+{
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            GLfloat v = 0.f;
+            for (int k = 0; k < 4; ++k) {
+                v += a[k * 4 + row] * b[col * 4 + k];
+            }
+            out[col * 4 + row] = v;
+        }
+    }
+}
+
+static void
+appendVertex(const GLfloat* mvp,
+             float x,
+             float y,
+             float u,
+             float v,
+             const GLfloat* color,
+             GlyphQuads* quads)
+{
+    for (int row = 0; row < 4; ++row) {
+        quads->vertices.push_back(mvp[row] * x + mvp[4 + row] * y + mvp[12 + row]);
+    }
+    quads->texCoords.push_back(u);
+    quads->texCoords.push_back(v);
+    quads->colors.insert(quads->colors.end(), color, color + 4);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 struct TextRenderer::Implementation
 {
     Implementation()
         : renderers()
+        , batch()
+        , batchDepth(0)
     {
     }
 
+    void drawBatch();
+
     FontRenderers renderers;
+
+    // The glyphs queued since beginBatch()
+    GlyphBatch batch;
+    int batchDepth;
 };
 
 TextRenderer::TextRenderer()
@@ -266,6 +331,71 @@ TextRenderer::~TextRenderer()
 {
 }
 
+void
+TextRenderer::beginBatch()
+{
+    ++_imp->batchDepth;
+}
+
+void
+TextRenderer::endBatch()
+{
+    assert(_imp->batchDepth > 0);
+    if (_imp->batchDepth <= 0) {
+        return;
+    }
+    --_imp->batchDepth;
+    if (_imp->batchDepth == 0) {
+        _imp->drawBatch();
+    }
+}
+
+void
+TextRenderer::Implementation::drawBatch()
+{
+    if ( batch.empty() ) {
+        return;
+    }
+
+    glCheckError(GL_GPU);
+    GLuint savedTexture;
+    GL_GPU::GetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&savedTexture);
+    {
+        GLProtectAttrib<GL_GPU> a(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
+        GLProtectMatrix<GL_GPU> pr(GL_PROJECTION);
+        GL_GPU::LoadIdentity();
+        GLProtectMatrix<GL_GPU> mv(GL_MODELVIEW);
+        GL_GPU::LoadIdentity();
+
+        GL_GPU::Enable(GL_BLEND);
+        GL_GPU::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GL_GPU::Enable(GL_TEXTURE_2D);
+
+        GL_GPU::PushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+        GL_GPU::EnableClientState(GL_VERTEX_ARRAY);
+        GL_GPU::EnableClientState(GL_TEXTURE_COORD_ARRAY);
+        GL_GPU::EnableClientState(GL_COLOR_ARRAY);
+        // One draw call per texture, that is one per font in most cases
+        for (GlyphBatch::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+            const GlyphQuads& quads = it->second;
+            if ( quads.texCoords.empty() ) {
+                continue;
+            }
+            GL_GPU::BindTexture(GL_TEXTURE_2D, it->first);
+            GL_GPU::VertexPointer(4, GL_FLOAT, 0, &quads.vertices.front());
+            GL_GPU::TexCoordPointer(2, GL_FLOAT, 0, &quads.texCoords.front());
+            GL_GPU::ColorPointer(4, GL_FLOAT, 0, &quads.colors.front());
+            GL_GPU::DrawArrays(GL_QUADS, 0, (GLsizei)(quads.texCoords.size() / 2));
+            glCheckErrorIgnoreOSXBug(GL_GPU);
+        }
+        GL_GPU::PopClientAttrib();
+    } // GLProtectAttrib a(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
+    GL_GPU::BindTexture(GL_TEXTURE_2D, savedTexture);
+    glCheckError(GL_GPU);
+
+    batch.clear();
+} // drawBatch
+
 void
 TextRenderer::renderText(float x,
                          float y,
@@ -310,49 +440,32 @@ TextRenderer::renderText(float x,
         }
     }
 
-    GLuint savedTexture;
-    GL_GPU::GetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&savedTexture);
-    {
-        GLProtectAttrib<GL_GPU> a(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
-        GLProtectMatrix<GL_GPU> pr(GL_MODELVIEW);
-
-        GL_GPU::Enable(GL_BLEND);
-        GL_GPU::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        GL_GPU::Enable(GL_TEXTURE_2D);
-        GLuint texture = 0;
-
-        GL_GPU::Translatef(x, y, 0);
-        GL_GPU::Color4f( color.redF(), color.greenF(), color.blueF(), color.alphaF() );
-        for (int i = 0; i < text.length(); ++i) {
-            CharBitmap *c = p->createCharacter(text[i]);
-            if (!c) {
-                continue;
-            }
-            if (texture != c->texID) {
-                texture = c->texID;
-                GL_GPU::BindTexture(GL_TEXTURE_2D, texture);
-                assert( GL_GPU::IsTexture(texture) );
-            }
-            glCheckError(GL_GPU);
-            GL_GPU::Begin(GL_QUADS);
-            GL_GPU::TexCoord2f(c->xTexCoords[0], c->yTexCoords[0]);
-            GL_GPU::Vertex2f(0, 0);
-            GL_GPU::TexCoord2f(c->xTexCoords[1], c->yTexCoords[0]);
-            GL_GPU::Vertex2f(c->w * scalex, 0);
-            GL_GPU::TexCoord2f(c->xTexCoords[1], c->yTexCoords[1]);
-            GL_GPU::Vertex2f(c->w * scalex, c->h * scaley);
-            GL_GPU::TexCoord2f(c->xTexCoords[0], c->yTexCoords[1]);
-            GL_GPU::Vertex2f(0, c->h * scaley);
-            GL_GPU::End();
-            glCheckErrorIgnoreOSXBug(GL_GPU);
-            GL_GPU::Translatef(c->w * scalex, 0, 0);
-            glCheckError(GL_GPU);
+    // Queue the glyphs with the current transform so that they can be drawn after it changed
+    GLfloat modelview[16], projection[16], mvp[16];
+    GL_GPU::GetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    GL_GPU::GetFloatv(GL_PROJECTION_MATRIX, projection);
+    multMatrix(projection, modelview, mvp);
+
+    const GLfloat rgba[4] = { (GLfloat)color.redF(), (GLfloat)color.greenF(), (GLfloat)color.blueF(), (GLfloat)color.alphaF() };
+    for (int i = 0; i < text.length(); ++i) {
+        CharBitmap *c = p->createCharacter(text[i]);
+        if (!c) {
+            continue;
         }
-    } // GLProtectAttrib a(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
-    GL_GPU::BindTexture(GL_TEXTURE_2D, savedTexture);
-
+        GlyphQuads& quads = _imp->batch[c->texID];
+        float x2 = x + c->w * scalex;
+        float y2 = y + c->h * scaley;
+        appendVertex(mvp, x, y, c->xTexCoords[0], c->yTexCoords[0], rgba, &quads);
+        appendVertex(mvp, x2, y, c->xTexCoords[1], c->yTexCoords[0], rgba, &quads);
+        appendVertex(mvp, x2, y2, c->xTexCoords[1], c->yTexCoords[1], rgba, &quads);
+        appendVertex(mvp, x, y2, c->xTexCoords[0], c->yTexCoords[1], rgba, &quads);
+        x = x2;
+    }
     glCheckError(GL_GPU);
+
+    if (_imp->batchDepth == 0) {
+        _imp->drawBatch();
+    }
 } // renderText
 
 NATRON_NAMESPACE_EXIT
-
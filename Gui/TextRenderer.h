@@ -37,6 +37,12 @@
 
 NATRON_NAMESPACE_ENTER
 
+/**
+ * @brief Draws text with OpenGL from a texture atlas of the glyphs of each font.
+ * Text rendered between beginBatch() and endBatch() is queued and drawn in endBatch() with one draw call
+ * per atlas texture. Queued text is positioned with the transform that was current when it was rendered
+ * and is drawn over everything drawn in-between.
+ **/
 class TextRenderer
 {
 public:
@@ -54,6 +60,14 @@ public:
                     const QFont &font,
                     int flags = 0) const; //!< see http://doc.qt.io/qt-4.8/qpainter.html#drawText-10
 
+    /**
+     * @brief Starts queuing the text rendered with renderText(). Calls may be nested, the text is
+     * drawn when the outermost batch ends.
+     **/
+    void beginBatch();
+
+    void endBatch();
+
 private:
     struct Implementation;
     boost::scoped_ptr<Implementation> _imp;
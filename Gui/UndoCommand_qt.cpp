@@ -26,6 +26,8 @@
 
 #include "UndoCommand_qt.h"
 
+#include <cassert>
+
 #include "Engine/UndoCommand.h"
 
 #include "Global/GlobalDefines.h"
@@ -33,27 +35,55 @@
 
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// The sum of the memory size of all commands, only accessed on the main-thread
+std::size_t totalCommandsMemorySize = 0;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 UndoCommand_qt::UndoCommand_qt(const UndoCommandPtr& command)
 : QUndoCommand()
 , _command(command)
+, _memorySize(0)
 {
     setText( QString::fromUtf8( command->getText().c_str() ) );
+    refreshMemorySize();
 }
 
 UndoCommand_qt::~UndoCommand_qt()
 {
+    assert(totalCommandsMemorySize >= _memorySize);
+    totalCommandsMemorySize -= _memorySize;
+}
+
+void
+UndoCommand_qt::refreshMemorySize()
+{
+    assert(totalCommandsMemorySize >= _memorySize);
+    totalCommandsMemorySize -= _memorySize;
+    _memorySize = _command->getMemorySize();
+    totalCommandsMemorySize += _memorySize;
+}
+
+std::size_t
+UndoCommand_qt::getTotalMemorySize()
+{
+    return totalCommandsMemorySize;
 }
 
 void
 UndoCommand_qt::redo()
 {
     _command->redo();
+    refreshMemorySize();
 }
 
 void
 UndoCommand_qt::undo()
 {
     _command->undo();
+    refreshMemorySize();
 }
 
 int
@@ -71,7 +101,11 @@ UndoCommand_qt::mergeWith(const QUndoCommand* other)
         return false;
     }
 
-    return _command->mergeWith(o->_command);
+    if ( !_command->mergeWith(o->_command) ) {
+        return false;
+    }
+    refreshMemorySize();
+    return true;
 }
 
 
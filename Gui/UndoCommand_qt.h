@@ -27,6 +27,8 @@
 #include <Python.h>
 // ***** END PYTHON BLOCK *****
 
+#include <cstddef> // std::size_t
+
 #include <QUndoCommand>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
@@ -41,6 +43,9 @@ class UndoCommand_qt
 {
     boost::shared_ptr<UndoCommand> _command;
 
+    // The memory size of the command accounted in the total
+    std::size_t _memorySize;
+
 public:
 
     UndoCommand_qt(const UndoCommandPtr& command);
@@ -53,7 +58,18 @@ public:
 
     virtual int id() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     
-    virtual bool mergeWith(const QUndoCommand* other) OVERRIDE FINAL WARN_UNUSED_RETURN;};
+    virtual bool mergeWith(const QUndoCommand* other) OVERRIDE FINAL WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the memory held by all the commands alive in the undo/redo stacks, in bytes.
+     * Commands are only created and destroyed on the main-thread.
+     **/
+    static std::size_t getTotalMemorySize();
+
+private:
+
+    void refreshMemorySize();
+};
 
 NATRON_NAMESPACE_EXIT;
 
@@ -28,6 +28,7 @@
 
 #include <cassert>
 #include <algorithm> // min, max
+#include <cmath> // pow
 #include <cstring> // for std::memcpy, std::memset, std::strcmp, std::strchr, strlen
 #include <stdexcept>
 
@@ -55,6 +56,7 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 #include <QTreeWidget>
 #include <QTabBar>
 
+#include "Engine/InteractiveLatency.h"
 #include "Engine/Lut.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGuiI.h"
@@ -65,6 +67,7 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 #include "Engine/KnobTypes.h"
 #include "Engine/NodeMetadata.h"
 #include "Engine/OutputSchedulerThread.h"
+#include "Engine/PixelInspectorThread.h"
 #include "Engine/OSGLFunctions.h"
 #include "Engine/RenderEngine.h"
 #include "Engine/Settings.h"
@@ -97,6 +100,9 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 
 #define PERSISTENT_MESSAGE_LEFT_OFFSET_PIXELS 20
 
+// How long the picker must stay still before the full resolution pixel under it is rendered
+#define NATRON_PIXEL_INSPECTOR_DELAY_MS 300
+
 #ifndef M_PI
 #define M_PI        3.14159265358979323846264338327950288   /* pi             */
 #endif
@@ -132,12 +138,21 @@ ViewerGL::ViewerGL(ViewerTab* parent,
     QObject::connect( appPTR, SIGNAL(checkerboardSettingsChanged()), this, SLOT(onCheckerboardSettingsChanged()) );
     QObject::connect( this, SIGNAL(mustCallUpdateOnMainThread()), this, SLOT(update()));
     QObject::connect( this, SIGNAL(mustCallUpdateGLOnMainThread()), this, SLOT(updateGL()));
+
+    _imp->pixelInspectorTimer.setSingleShot(true);
+    _imp->pixelInspectorTimer.setInterval(NATRON_PIXEL_INSPECTOR_DELAY_MS);
+    QObject::connect( &_imp->pixelInspectorTimer, SIGNAL(timeout()), this, SLOT(onPixelInspectorTimeout()) );
 }
 
 ViewerGL::~ViewerGL()
 {
     // always running in the main thread
     assert( qApp && qApp->thread() == QThread::currentThread() );
+    for (int i = 0; i < 2; ++i) {
+        if (_imp->pixelInspectors[i]) {
+            _imp->pixelInspectors[i]->quitAnyComputation();
+        }
+    }
 }
 
 QSize
@@ -511,12 +526,16 @@ ViewerGL::paintGL()
 
                     GL_GPU::ActiveTexture(GL_TEXTURE0);
                     GL_GPU::BindTexture( GL_TEXTURE_2D, _imp->partialUpdateTextures[i].texture->getTexID() );
+                    bool shaderBound = _imp->bindDisplayTransformShader(_imp->partialUpdateTextures[i], 0);
                     GL_GPU::Begin(GL_POLYGON);
                     GL_GPU::TexCoord2d(0, 0); GL_GPU::Vertex2d(canonicalTexRect.x1, canonicalTexRect.y1);
                     GL_GPU::TexCoord2d(0, 1); GL_GPU::Vertex2d(canonicalTexRect.x1, canonicalTexRect.y2);
                     GL_GPU::TexCoord2d(1, 1); GL_GPU::Vertex2d(canonicalTexRect.x2, canonicalTexRect.y2);
                     GL_GPU::TexCoord2d(1, 0); GL_GPU::Vertex2d(canonicalTexRect.x2, canonicalTexRect.y1);
                     GL_GPU::End();
+                    if (shaderBound) {
+                        _imp->releaseDisplayTransformShader();
+                    }
                     GL_GPU::BindTexture(GL_TEXTURE_2D, 0);
 
                     glCheckError(GL_GPU);
@@ -546,6 +565,9 @@ ViewerGL::paintGL()
         }
         glCheckErrorAssert(GL_GPU);
     } // GLProtectAttrib a(GL_TRANSFORM_BIT);
+
+    // The buffers are swapped once paintGL returns
+    InteractiveLatency::onFrameDisplayed();
 } // paintGL
 
 void
@@ -592,6 +614,9 @@ ViewerGL::drawOverlay(unsigned int mipMapLevel,
         }
         ViewerCompositingOperatorEnum compOperator = viewerNode->getCurrentOperator();
 
+        // Overlays may render hundreds of labels (e.g. the names of tracker markers): they are all drawn
+        // at once on top of the overlays
+        _imp->textRenderer.beginBatch();
 
         for (int i = 0; i < 2; ++i) {
 
@@ -700,6 +725,8 @@ ViewerGL::drawOverlay(unsigned int mipMapLevel,
 
         glCheckErrorIgnoreOSXBug(GL_GPU);
 
+        _imp->textRenderer.endBatch();
+
         if (_imp->pickerState == ePickerStateRectangle) {
                 drawPickerRectangle();
         } else if (_imp->pickerState == ePickerStatePoint) {
@@ -1105,8 +1132,9 @@ ViewerGL::transferBufferFromRAMtoGPU(const TextureTransferArgs& args)
     GL_GPU::GetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING_ARB, &currentBoundPBO);
     glCheckError(GL_GPU);
 
-    // We use 2 PBOs to make use of asynchronous data uploading
-    GLuint pboId = getPboID(_imp->updateViewerPboIndex);
+    // We use a ring of NATRON_VIEWER_PBO_COUNT PBOs to make use of asynchronous data uploading
+    int pboIndex = _imp->updateViewerPboIndex;
+    GLuint pboId = getPboID(pboIndex);
 
     assert(args.textureIndex == 0 || args.textureIndex == 1);
 
@@ -1137,6 +1165,9 @@ ViewerGL::transferBufferFromRAMtoGPU(const TextureTransferArgs& args)
 
 
     GLTexturePtr tex;
+
+    // The portion of the image to upload to the texture
+    RectI uploadRect = imageData.bounds;
     {
         QMutexLocker displayDataLocker(&_imp->displayDataMutex);
         if (args.type == TextureTransferArgs::eTextureTransferTypeOverlay) {
@@ -1164,6 +1195,7 @@ ViewerGL::transferBufferFromRAMtoGPU(const TextureTransferArgs& args)
             info.time = args.time;
             info.isPartialImage = true;
             info.isVisible = true;
+            info.applyDisplayTransform = args.applyDisplayTransform;
             _imp->partialUpdateTextures.push_back(info);
 
             // Update time otherwise overlays won't refresh since we are not updating the displayTextures
@@ -1221,11 +1253,17 @@ ViewerGL::transferBufferFromRAMtoGPU(const TextureTransferArgs& args)
                         _imp->displayTextures[args.textureIndex].texture = tmpTex;
                         tex = tmpTex;
 
+                    } else if ( !args.updateArea.isNull() ) {
+                        // The texture already holds the rest of the image: only upload the area that changed
+                        if ( !imageData.bounds.intersect(args.updateArea, &uploadRect) ) {
+                            uploadRect.clear();
+                        }
                     }
                 }
 
 
                 _imp->displayTextures[args.textureIndex].isVisible = true;
+                _imp->displayTextures[args.textureIndex].applyDisplayTransform = args.applyDisplayTransform;
                 _imp->displayTextures[args.textureIndex].mipMapLevel = args.image->getMipMapLevel();
                 _imp->displayTextures[args.textureIndex].time = args.time;
             }
@@ -1249,7 +1287,7 @@ ViewerGL::transferBufferFromRAMtoGPU(const TextureTransferArgs& args)
         _imp->zoomCtx.translate(args.viewportCenter.x - curCenterX, args.viewportCenter.y - curCenterY);
     }
 
-    if (!args.image) {
+    if ( !args.image || uploadRect.isNull() ) {
         return;
     }
 
@@ -1258,15 +1296,24 @@ ViewerGL::transferBufferFromRAMtoGPU(const TextureTransferArgs& args)
 
     // Note that glMapBufferARB() causes sync issue.
     // If GPU is working with this buffer, glMapBufferARB() will wait(stall)
-    // until GPU to finish its job. To avoid waiting (idle), you can call
-    // first glBufferDataARB() with NULL pointer before glMapBufferARB().
-    // If you do that, the previous data in PBO will be discarded and
-    // glMapBufferARB() returns a new allocated pointer immediately
-    // even if GPU is still working with the previous data.
+    // until GPU to finish its job.
+    // With a ring of NATRON_VIEWER_PBO_COUNT buffers, the upload that last used this PBO
+    // was issued NATRON_VIEWER_PBO_COUNT - 1 uploads ago and has most likely completed,
+    // so the buffer storage is kept and re-used as long as it is large enough.
+    // It is only (re)allocated with glBufferDataARB() when the image grows, which also
+    // discards the previous data so that glMapBufferARB() does not wait for the GPU.
+    // Re-specifying the storage at each upload would make the driver allocate a new
+    // buffer every time, which is costly for large images.
     int dataSizeOf = getSizeOfForBitDepth(imageData.bitDepth);
-    std::size_t bytesCount = imageData.bounds.area() * imageData.nComps * dataSizeOf;
+    std::size_t bytesCount = uploadRect.area() * imageData.nComps * dataSizeOf;
     assert(bytesCount > 0);
-    GL_GPU::BufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, bytesCount, NULL, GL_DYNAMIC_DRAW_ARB);
+    if ( pboIndex >= (int)_imp->pboSizes.size() ) {
+        _imp->pboSizes.resize(pboIndex + 1, 0);
+    }
+    if (_imp->pboSizes[pboIndex] < bytesCount) {
+        GL_GPU::BufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, bytesCount, NULL, GL_DYNAMIC_DRAW_ARB);
+        _imp->pboSizes[pboIndex] = bytesCount;
+    }
 
     // map the buffer object into client's memory
     assert(QGLContext::currentContext() == context());
@@ -1275,10 +1322,22 @@ ViewerGL::transferBufferFromRAMtoGPU(const TextureTransferArgs& args)
     assert(ret);
     if (ret) {
         // update data directly on the mapped buffer
-        unsigned char* srcpixels = Image::pixelAtStatic(imageData.bounds.x1, imageData.bounds.y1, imageData.bounds, imageData.nComps, dataSizeOf, (unsigned char*)imageData.ptrs[0]);
+        unsigned char* srcpixels = Image::pixelAtStatic(uploadRect.x1, uploadRect.y1, imageData.bounds, imageData.nComps, dataSizeOf, (unsigned char*)imageData.ptrs[0]);
         assert(srcpixels);
         if (srcpixels) {
-            std::memcpy(ret, srcpixels, bytesCount);
+            if (uploadRect == imageData.bounds) {
+                std::memcpy(ret, srcpixels, bytesCount);
+            } else {
+                // The PBO holds the upload rectangle packed: copy it row by row
+                std::size_t dstRowBytes = uploadRect.width() * imageData.nComps * dataSizeOf;
+                std::size_t srcRowBytes = imageData.bounds.width() * imageData.nComps * dataSizeOf;
+                unsigned char* dstPixels = (unsigned char*)ret;
+                for (int y = uploadRect.y1; y < uploadRect.y2; ++y) {
+                    std::memcpy(dstPixels, srcpixels, dstRowBytes);
+                    dstPixels += dstRowBytes;
+                    srcpixels += srcRowBytes;
+                }
+            }
             GLboolean result = GL_GPU::UnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB); // release the mapped buffer
             assert(result == GL_TRUE);
             Q_UNUSED(result);
@@ -1289,14 +1348,14 @@ ViewerGL::transferBufferFromRAMtoGPU(const TextureTransferArgs& args)
     // copy pixels from PBO to texture object
     // using glBindTexture followed by glTexSubImage2D.
     // Use offset instead of pointer (last parameter is 0).
-    tex->fillOrAllocateTexture(imageData.bounds, 0, 0);
+    tex->fillOrAllocateTexture(uploadRect, 0, 0);
 
     // restore previously bound PBO
     GL_GPU::BindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, currentBoundPBO);
     //glBindTexture(GL_TEXTURE_2D, 0); // why should we bind texture 0?
     glCheckError(GL_GPU);
 
-    _imp->updateViewerPboIndex = (_imp->updateViewerPboIndex + 1) % 2;
+    _imp->updateViewerPboIndex = (_imp->updateViewerPboIndex + 1) % NATRON_VIEWER_PBO_COUNT;
 
 } // ViewerGL::transferBufferFromRAMtoGPU
 
@@ -1887,36 +1946,133 @@ ViewerGL::updateColorPicker(int textureIndex,
             }
         }
     }
+
+    // Any result of a pending inspection is now outdated
+    ++_imp->pixelInspectionCookie[textureIndex];
+    _imp->pixelInspectionPending[textureIndex] = false;
+
     if (!picked) {
         _imp->infoViewer[textureIndex]->setColorValid(false);
         if (textureIndex == 0) {
             setParametricParamsPickerColor(ColorRgba<double>(), false, false);
         }
     } else {
-        _imp->infoViewer[textureIndex]->setColorApproximated(mmLevel > 0);
-        _imp->infoViewer[textureIndex]->setColorValid(true);
-        if ( !_imp->infoViewer[textureIndex]->colorVisible() ) {
-            _imp->infoViewer[textureIndex]->showColorInfo();
+        setPickerColor(textureIndex, r, g, b, a, mmLevel > 0);
+
+        if (mmLevel > 0) {
+            // The picked image is downscaled: render the full resolution pixel once the picker stops moving
+            _imp->pixelInspectionPending[textureIndex] = true;
+            _imp->pixelInspectionPos[textureIndex] = imgPosCanonical;
+            _imp->pixelInspectionPickInput[textureIndex] = pickInput;
+            _imp->pixelInspectorTimer.start();
         }
-        _imp->infoViewer[textureIndex]->setColor(r, g, b, a);
+    }
+} // updateColorPicker
 
-        if (textureIndex == 0) {
-            ColorRgba<double> interactColor(r,g,b,a);
-            setParametricParamsPickerColor(interactColor, true, true);
+void
+ViewerGL::setPickerColor(int textureIndex,
+                         float r,
+                         float g,
+                         float b,
+                         float a,
+                         bool approximated)
+{
+    _imp->infoViewer[textureIndex]->setColorApproximated(approximated);
+    _imp->infoViewer[textureIndex]->setColorValid(true);
+    if ( !_imp->infoViewer[textureIndex]->colorVisible() ) {
+        _imp->infoViewer[textureIndex]->showColorInfo();
+    }
+    _imp->infoViewer[textureIndex]->setColor(r, g, b, a);
+
+    if (textureIndex == 0) {
+        ColorRgba<double> interactColor(r,g,b,a);
+        setParametricParamsPickerColor(interactColor, true, true);
+    }
+
+    std::vector<double> colorVec(4);
+    colorVec[0] = r;
+    colorVec[1] = g;
+    colorVec[2] = b;
+    colorVec[3] = a;
+    const std::list<Histogram*>& histograms = _imp->viewerTab->getGui()->getHistograms();
+    for (std::list<Histogram*>::const_iterator it = histograms.begin(); it != histograms.end(); ++it) {
+        if ( (*it)->getViewerTextureInputDisplayed() == textureIndex ) {
+            (*it)->setViewerCursor(colorVec);
         }
+    }
+} // setPickerColor
 
-        std::vector<double> colorVec(4);
-        colorVec[0] = r;
-        colorVec[1] = g;
-        colorVec[2] = b;
-        colorVec[3] = a;
-        for (std::list<Histogram*>::const_iterator it = histograms.begin(); it != histograms.end(); ++it) {
-            if ( (*it)->getViewerTextureInputDisplayed() == textureIndex ) {
-                (*it)->setViewerCursor(colorVec);
+void
+ViewerGL::onPixelInspectorTimeout()
+{
+    if ( (_imp->pickerState != ePickerStateInactive) || !_imp->viewerTab || !_imp->viewerTab->getGui() || _imp->viewerTab->getGui()->isGUIFrozen() ) {
+        return;
+    }
+    ViewerNodePtr viewerNode = getInternalNode();
+    if (!viewerNode) {
+        return;
+    }
+    for (int i = 0; i < 2; ++i) {
+        if (!_imp->pixelInspectionPending[i]) {
+            continue;
+        }
+        _imp->pixelInspectionPending[i] = false;
+
+        NodePtr node = i == 0 ? viewerNode->getCurrentAInput() : viewerNode->getCurrentBInput();
+        if (node && _imp->pixelInspectionPickInput[i]) {
+            node = node->getInput( node->getPreferredInput() );
+        }
+        if (!node) {
+            continue;
+        }
+
+        TimeValue time;
+        {
+            QMutexLocker k(&_imp->displayDataMutex);
+            if (!_imp->displayTextures[i].isVisible) {
+                continue;
             }
+            time = _imp->displayTextures[i].time;
         }
+
+        if (!_imp->pixelInspectors[i]) {
+            _imp->pixelInspectors[i] = PixelInspectorThread::create();
+            QObject::connect( _imp->pixelInspectors[i].get(), SIGNAL(pixelInspected()), this, SLOT(onPixelInspected()) );
+        }
+        const QPointF& pos = _imp->pixelInspectionPos[i];
+        _imp->pixelInspectors[i]->inspectPixel(node, time, viewerNode->getCurrentRenderView(), pos.x(), pos.y(), _imp->pixelInspectionCookie[i]);
     }
-} // updateColorPicker
+} // onPixelInspectorTimeout
+
+void
+ViewerGL::onPixelInspected()
+{
+    if ( (_imp->pickerState != ePickerStateInactive) || !_imp->viewerTab || !_imp->viewerTab->getGui() || _imp->viewerTab->getGui()->isGUIFrozen() ) {
+        return;
+    }
+    for (int i = 0; i < 2; ++i) {
+        if (!_imp->pixelInspectors[i]) {
+            continue;
+        }
+        ImagePtr image;
+        NodePtr node;
+        TimeValue time;
+        double x, y;
+        int cookie;
+        if ( !_imp->pixelInspectors[i]->getMostRecentResult(&image, &node, &time, &x, &y, &cookie) ) {
+            continue;
+        }
+        if ( !image || (cookie != _imp->pixelInspectionCookie[i]) ) {
+            // The picker moved or the viewer changed since the inspection was requested
+            continue;
+        }
+        float r, g, b, a;
+        bool linear = appPTR->getCurrentSettings()->getColorPickerLinear();
+        if ( getColorFromImage(image, x, y, linear, i, &r, &g, &b, &a) ) {
+            setPickerColor(i, r, g, b, a, false);
+        }
+    }
+} // onPixelInspected
 
 void
 ViewerGL::setParametricParamsPickerColor(const ColorRgba<double>& color, bool setColor, bool hasColor)
@@ -1977,7 +2133,7 @@ ViewerGL::checkIfViewPortRoIValidOrRenderForInput(int texIndex)
 
 
     int tx,ty;
-    CacheBase::getTileSizePx(_imp->displayTextures[texIndex].texture->getBitDepth(), &tx, &ty);
+    appPTR->getTileCache()->getTileSizePx(_imp->displayTextures[texIndex].texture->getBitDepth(), &tx, &ty);
 
 
     const RectI& texBounds = _imp->displayTextures[texIndex].texture->getBounds();
@@ -3218,6 +3374,54 @@ getColorAtSinglePixel(const Image::CPUData& image,
 
 } // getColorAtInternal
 
+bool
+ViewerGL::computeScopeGPU(int textureIndex,
+                          HistogramGPURequest* request,
+                          std::vector<float>* data,
+                          unsigned int* pixelsCount,
+                          unsigned int* mipMapLevel)
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+    assert(textureIndex == 0 || textureIndex == 1);
+    assert(request && data && pixelsCount && mipMapLevel);
+
+    if ( !appPTR->isOpenGLLoaded() || !isValid() ) {
+        return false;
+    }
+
+    GLTexturePtr texture;
+    {
+        QMutexLocker k(&_imp->displayDataMutex);
+        const TextureInfo& info = _imp->displayTextures[textureIndex];
+        if (!info.isVisible || !info.texture) {
+            return false;
+        }
+        texture = info.texture;
+        request->applyDisplayTransform = info.applyDisplayTransform;
+        *mipMapLevel = info.mipMapLevel;
+    }
+    if (request->applyDisplayTransform) {
+        // Same parameters as the ones of bindDisplayTransformShader
+        ViewerNodePtr viewerNode = getViewerTab()->getInternalNode();
+        request->gain = std::pow( 2., viewerNode->getGain() );
+        request->gamma = viewerNode->getGamma();
+        request->lut = (int)viewerNode->getColorspace();
+        request->channels = (int)viewerNode->getDisplayChannels(textureIndex);
+    }
+
+    // The texture belongs to the context of this viewer
+    makeCurrent();
+    if ( !HistogramGPU::isSupported() ) {
+        return false;
+    }
+    if (!_imp->histogramGPU) {
+        _imp->histogramGPU.reset(new HistogramGPU);
+    }
+
+    return _imp->histogramGPU->computeScope(*request, texture, data, pixelsCount);
+} // computeScopeGPU
+
 bool
 ViewerGL::getColorAt(double x,
                      double y,           // x and y in canonical coordinates
@@ -3250,6 +3454,24 @@ ViewerGL::getColorAt(double x,
         }
     }
 
+    *imgMmlevel = image->getMipMapLevel();
+
+    return getColorFromImage(image, x, y, forceLinear, textureIndex, r, g, b, a);
+} // getColorAt
+
+bool
+ViewerGL::getColorFromImage(const ImagePtr& image,
+                            double x,
+                            double y,           // x and y in canonical coordinates
+                            bool forceLinear,
+                            int textureIndex,
+                            float* r,
+                            float* g,
+                            float* b,
+                            float* a)
+{
+    assert(image && r && g && b && a);
+
     ViewerColorSpaceEnum srcCS = _imp->viewerTab->getGui()->getApp()->getDefaultColorSpaceForBitDepth(image->getBitDepth());
     const Color::Lut* dstColorSpace;
     const Color::Lut* srcColorSpace;
@@ -3275,8 +3497,7 @@ ViewerGL::getColorAt(double x,
     image->getCPUData(&imageData);
 
 
-    *imgMmlevel = image->getMipMapLevel();
-    double mipMapScale = 1. / ( 1 << *imgMmlevel );
+    double mipMapScale = 1. / ( 1 << image->getMipMapLevel() );
     RenderScale scale = image->getProxyScale();
     scale.x *= mipMapScale;
     scale.y *= mipMapScale;
@@ -3307,6 +3528,14 @@ ViewerGL::getColorAt(double x,
                                                                   dstColorSpace,
                                                                   r, g, b, a);
             break;
+        case eImageBitDepthHalf:
+            gotval = getColorAtSinglePixel<Half, 1>(imageData,
+                                                    xPixel, yPixel,
+                                                    forceLinear,
+                                                    srcColorSpace,
+                                                    dstColorSpace,
+                                                    r, g, b, a);
+            break;
         case eImageBitDepthFloat:
             gotval = getColorAtSinglePixel<float, 1>(imageData,
                                                      xPixel, yPixel,
@@ -3321,7 +3550,7 @@ ViewerGL::getColorAt(double x,
     }
 
     return gotval;
-} // getColorAt
+} // getColorFromImage
 
 template <typename PIX, int maxValue, int srcNComps>
 static
@@ -3493,6 +3722,8 @@ ViewerGL::getColorAtRect(const RectD &roi, // rectangle in canonical coordinates
             getColorAtRectForDepth<float, 1>(imageData, roiPixels, forceLinear, srcColorSpace, dstColorSpace, pixelSums);
             break;
         case eImageBitDepthHalf:
+            getColorAtRectForDepth<Half, 1>(imageData, roiPixels, forceLinear, srcColorSpace, dstColorSpace, pixelSums);
+            break;
         case eImageBitDepthNone:
             break;
     }
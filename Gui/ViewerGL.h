@@ -54,6 +54,8 @@ CLANG_DIAG_ON(uninitialized)
 
 NATRON_NAMESPACE_ENTER
 
+struct HistogramGPURequest;
+
 typedef std::map<FrameViewPair, ImageCacheKeyPtr, FrameView_compare_less> ViewerCachedImagesMap;
 
 /**
@@ -394,6 +396,20 @@ public:
                         bool forceLinear, int textureIndex, bool pickInput, float* r, float* g, float* b, float* a, unsigned int* mipMapLevel);
 
 
+    /**
+     * @brief Computes a scope of the image currently displayed in the given input on the GPU, from the texture
+     * of the viewer. The request range and size must be set, the display transform parameters are set by this function.
+     * This makes the context of the viewer current.
+     * @param data, pixelsCount See HistogramGPU::computeScope
+     * @param mipMapLevel The mipmap level of the displayed image
+     * @returns False if there is no image or if the GPU cannot compute scopes.
+     **/
+    bool computeScopeGPU(int textureIndex,
+                         HistogramGPURequest* request,
+                         std::vector<float>* data,
+                         unsigned int* pixelsCount,
+                         unsigned int* mipMapLevel);
+
     virtual unsigned int getCurrentRenderScale() const OVERRIDE FINAL;
 
     ///same as getMipMapLevel but with the zoomFactor taken into account
@@ -440,6 +456,18 @@ Q_SIGNALS:
 
     void mustCallUpdateGLOnMainThread();
 
+private Q_SLOTS:
+
+    /**
+     * @brief Called when the picker stayed still on a downscaled image: renders the full resolution pixel under it
+     **/
+    void onPixelInspectorTimeout();
+
+    /**
+     * @brief Replaces the approximated picker color by the full resolution one if the picker did not move
+     **/
+    void onPixelInspected();
+
 private:
     /**
      *@brief The paint function. That's where all the drawing is done.
@@ -477,6 +505,17 @@ private:
 
     void setParametricParamsPickerColor(const ColorRgba<double>& color, bool setColor, bool hasColor);
 
+    /**
+     * @brief Displays the color picked for the given input in the info bar, the parametric params and the histograms
+     **/
+    void setPickerColor(int textureIndex, float r, float g, float b, float a, bool approximated);
+
+    /**
+     * @brief Same as getColorAt but reads the given image, which must be in RAM
+     **/
+    bool getColorFromImage(const ImagePtr& image, double x, double y, bool forceLinear, int textureIndex,
+                           float* r, float* g, float* b, float* a) WARN_UNUSED_RETURN;
+
     int getMipMapLevelFromZoomFactor() const;
 
     bool checkIfViewPortRoIValidOrRenderForInput(int texIndex);
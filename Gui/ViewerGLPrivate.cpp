@@ -32,6 +32,7 @@
 #include <stdexcept>
 
 #include <QThread>
+#include <QtCore/QDebug>
 #include <QApplication> // qApp
 #include "Global/GLIncludes.h" //!<must be included before QGLWidget
 #include <QtOpenGL/QGLWidget>
@@ -48,6 +49,7 @@
 #include "Gui/Gui.h"
 #include "Gui/GuiApplicationManager.h" // appFont
 #include "Gui/Menu.h"
+#include "Gui/Shaders.h"
 #include "Gui/ViewerTab.h"
 
 #ifndef M_PI
@@ -70,6 +72,7 @@ ViewerGL::Implementation::Implementation(ViewerGL* this_,
                                          ViewerTab* parent)
     : _this(this_)
     , pboIds()
+    , pboSizes()
     , vboVerticesId(0)
     , vboTexturesId(0)
     , iboTriangleStripId(0)
@@ -99,10 +102,14 @@ ViewerGL::Implementation::Implementation(ViewerGL* this_,
     , currentViewerInfo_resolutionOverlay()
     , pickerState(ePickerStateInactive)
     , lastPickerPos()
+    , pixelInspectors()
+    , pixelInspectorTimer()
     , zoomCtx(0.01, 1024.)   // protected by mutex
     , selectionRectangle()
     , checkerboardTextureID(0)
     , checkerboardTileSize(0)
+    , displayTransformShader()
+    , histogramGPU()
     , savedTexture(0)
     , prevBoundTexture(0)
     , sizeH()
@@ -116,6 +123,11 @@ ViewerGL::Implementation::Implementation(ViewerGL* this_,
 {
     infoViewer[0] = 0;
     infoViewer[1] = 0;
+    for (int i = 0; i < 2; ++i) {
+        pixelInspectionPending[i] = false;
+        pixelInspectionPickInput[i] = false;
+        pixelInspectionCookie[i] = 0;
+    }
 
     assert( qApp && qApp->thread() == QThread::currentThread() );
     //menu->setFont( QFont(appFont,appFontSize) );
@@ -146,13 +158,18 @@ ViewerGL::Implementation::~Implementation()
         for (U32 i = 0; i < this->pboIds.size(); ++i) {
             GL_GPU::DeleteBuffers(1, &this->pboIds[i]);
         }
+        this->pboSizes.clear();
         glCheckError(GL_GPU);
         GL_GPU::DeleteBuffers(1, &this->vboVerticesId);
         GL_GPU::DeleteBuffers(1, &this->vboTexturesId);
         GL_GPU::DeleteBuffers(1, &this->iboTriangleStripId);
         glCheckError(GL_GPU);
         GL_GPU::DeleteTextures(1, &this->checkerboardTextureID);
+        if (histogramGPU) {
+            histogramGPU->deleteGLResources();
+        }
     }
+    displayTransformShader.reset();
 }
 
 //static const GLfloat renderingTextureCoordinates[32] = {
@@ -287,6 +304,7 @@ ViewerGL::Implementation::drawRenderingVAO(unsigned int mipMapLevel,
             GL_GPU::ActiveTexture(GL_TEXTURE0);
             GL_GPU::GetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&prevBoundTexture);
             GL_GPU::BindTexture( GL_TEXTURE_2D, displayTextures[textureIndex].texture->getTexID() );
+            bool shaderBound = bindDisplayTransformShader(displayTextures[textureIndex], textureIndex);
 
             GL_GPU::Begin(GL_POLYGON);
             for (int i = 0; i < polygonTexCoords.size(); ++i) {
@@ -297,6 +315,10 @@ ViewerGL::Implementation::drawRenderingVAO(unsigned int mipMapLevel,
             }
             GL_GPU::End();
 
+            if (shaderBound) {
+                releaseDisplayTransformShader();
+            }
+
             GL_GPU::BindTexture( GL_TEXTURE_2D, prevBoundTexture);
 
         } else {
@@ -373,6 +395,7 @@ ViewerGL::Implementation::drawRenderingVAO(unsigned int mipMapLevel,
         GL_GPU::GetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&prevBoundTexture);
         GL_GPU::BindTexture( GL_TEXTURE_2D, displayTextures[textureIndex].texture->getTexID() );
         glCheckError(GL_GPU);
+        bool shaderBound = bindDisplayTransformShader(displayTextures[textureIndex], textureIndex);
 
         GL_GPU::BindBuffer(GL_ARRAY_BUFFER, this->vboVerticesId);
         GL_GPU::BufferSubData(GL_ARRAY_BUFFER, 0, 32 * sizeof(GLfloat), vertices);
@@ -393,6 +416,10 @@ ViewerGL::Implementation::drawRenderingVAO(unsigned int mipMapLevel,
         GL_GPU::DrawElements(GL_TRIANGLE_STRIP, 28, GL_UNSIGNED_BYTE, 0);
         glCheckErrorIgnoreOSXBug(GL_GPU);
 
+        if (shaderBound) {
+            releaseDisplayTransformShader();
+        }
+
         GL_GPU::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         GL_GPU::DisableClientState(GL_VERTEX_ARRAY);
         GL_GPU::DisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -439,6 +466,51 @@ ViewerGL::Implementation::initializeGL()
     glCheckError(GL_GPU);
 }
 
+bool
+ViewerGL::Implementation::bindDisplayTransformShader(const TextureInfo& info, int textureIndex)
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+    assert( QGLContext::currentContext() == _this->context() );
+
+    if (!info.applyDisplayTransform) {
+        return false;
+    }
+
+    if (!displayTransformShader) {
+        displayTransformShader.reset( new QGLShaderProgram( _this->context() ) );
+        if ( !displayTransformShader->addShaderFromSourceCode(QGLShader::Vertex, vertRGB) ) {
+            qDebug() << qPrintable( displayTransformShader->log() );
+        }
+        if ( !displayTransformShader->addShaderFromSourceCode(QGLShader::Fragment, fragDisplayTransform) ) {
+            qDebug() << qPrintable( displayTransformShader->log() );
+        }
+        if ( !displayTransformShader->link() ) {
+            qDebug() << qPrintable( displayTransformShader->log() );
+        }
+    }
+    if ( !displayTransformShader->isLinked() || !displayTransformShader->bind() ) {
+        return false;
+    }
+
+    // Same parameters as the ones used by ViewerInstance::render when it applies the display transform itself
+    ViewerNodePtr viewerNode = _this->getViewerTab()->getInternalNode();
+    displayTransformShader->setUniformValue("Tex", (GLint)0);
+    displayTransformShader->setUniformValue( "gain", (GLfloat)std::pow( 2., viewerNode->getGain() ) );
+    displayTransformShader->setUniformValue( "gamma", (GLfloat)viewerNode->getGamma() );
+    displayTransformShader->setUniformValue( "lut", (GLint)viewerNode->getColorspace() );
+    displayTransformShader->setUniformValue( "channels", (GLint)viewerNode->getDisplayChannels(textureIndex) );
+
+    return true;
+} // bindDisplayTransformShader
+
+void
+ViewerGL::Implementation::releaseDisplayTransformShader()
+{
+    assert(displayTransformShader);
+    displayTransformShader->release();
+}
+
 bool
 ViewerGL::Implementation::initAndCheckGlExtensions()
 {
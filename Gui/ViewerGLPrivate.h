@@ -33,6 +33,7 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QSize>
+#include <QtCore/QTimer>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -40,11 +41,15 @@ CLANG_DIAG_ON(uninitialized)
 #include "Gui/TextRenderer.h"
 #include "Gui/ViewerGL.h"
 #include "Gui/GuiGLContext.h"
+#include "Gui/HistogramGPU.h"
 #include "Gui/ZoomContext.h"
 #include "Gui/GuiFwd.h"
 
 #define MAX_MIP_MAP_LEVELS 20
 
+// Number of PBOs used in a ring to upload textures to the viewer
+#define NATRON_VIEWER_PBO_COUNT 3
+
 NATRON_NAMESPACE_ENTER
 
 /*This class is the the core of the viewer : what displays images, overlays, etc...
@@ -89,6 +94,7 @@ struct TextureInfo
     , pixelAspectRatio(1.)
     , isPartialImage(false)
     , isVisible(false)
+    , applyDisplayTransform(false)
     {
     }
 
@@ -109,6 +115,9 @@ struct TextureInfo
 
     // false if this input is disconnected for the viewer
     bool isVisible;
+
+    // true if the texture is linear and must be drawn with the display transform shader
+    bool applyDisplayTransform;
 };
 
 struct ViewerGL::Implementation
@@ -123,6 +132,7 @@ struct ViewerGL::Implementation
     /////////////////////////////////////////////////////////
     // The following are only accessed from the main thread:
     std::vector<GLuint> pboIds; //!< PBO's id's used by the OpenGL context
+    std::vector<std::size_t> pboSizes; //!< The size in bytes of the storage allocated for each PBO
     GLuint vboVerticesId; //!< VBO holding the vertices for the texture mapping.
     GLuint vboTexturesId; //!< VBO holding texture coordinates.
     GLuint iboTriangleStripId; /*!< IBOs holding vertices indexes for triangle strip sets*/
@@ -162,6 +172,15 @@ struct ViewerGL::Implementation
     QPointF lastPickerPos;
     QRectF pickerRect;
 
+    // When the picker samples a downscaled image, the full resolution pixel is rendered in the background
+    // once the picker stays still for a moment
+    PixelInspectorThreadPtr pixelInspectors[2]; // created the first time an input is inspected
+    QTimer pixelInspectorTimer;
+    bool pixelInspectionPending[2];
+    QPointF pixelInspectionPos[2]; // in canonical coordinates
+    bool pixelInspectionPickInput[2];
+    int pixelInspectionCookie[2]; // incremented each time the picker is updated, to discard older results
+
     // projection info, only used by the main thread
     QPointF glShadow; //!< pixel size in projection coordinates - used to create shadow
 
@@ -173,6 +192,8 @@ struct ViewerGL::Implementation
     QRectF selectionRectangle;
     GLuint checkerboardTextureID;
     int checkerboardTileSize; // to avoid a call to getValue() of the settings at each draw
+    boost::scoped_ptr<QGLShaderProgram> displayTransformShader; // created the first time a linear texture is drawn
+    boost::scoped_ptr<HistogramGPU> histogramGPU; // created the first time a scope of this viewer is computed
     GLuint savedTexture; // @see saveOpenGLContext/restoreOpenGLContext
     GLuint prevBoundTexture;
     QSize sizeH;
@@ -232,6 +253,14 @@ public:
 
     void drawCheckerboardTexture(const QPolygonF& polygon);
 
+    /**
+     * @brief If the given texture is linear, bind the shader applying the current display transform
+     * of the given viewer input and return true. The caller must then call releaseDisplayTransformShader().
+     **/
+    bool bindDisplayTransformShader(const TextureInfo& info, int textureIndex);
+
+    void releaseDisplayTransformShader();
+
 
 private:
     /**
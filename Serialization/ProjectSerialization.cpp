@@ -25,14 +25,88 @@
 
 #include "ProjectSerialization.h"
 
+#include <stdexcept>
+#include <vector>
+
 #include <boost/make_shared.hpp>
 
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <yaml-cpp/yaml.h>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 SERIALIZATION_NAMESPACE_ENTER
 
+namespace {
+
+struct NodeDecodeTask
+{
+    YAML::Node node;
+    NodeSerializationPtr serialization;
+
+    // Exceptions cannot cross the threads of QtConcurrent: the message is rethrown by the loading thread
+    bool failed;
+    std::string error;
+
+    NodeDecodeTask()
+        : node()
+        , serialization()
+        , failed(false)
+        , error()
+    {
+    }
+};
+
+void
+decodeNodeTask(NodeDecodeTask& task)
+{
+    try {
+        task.serialization->decode(task.node);
+    } catch (const std::exception& e) {
+        task.failed = true;
+        task.error = e.what();
+    } catch (...) {
+        task.failed = true;
+        task.error = "Unknown error while decoding a node";
+    }
+}
+
+/**
+ * @brief Decodes the serialization of each node (with its knobs, curves, expressions and sub-graph) in a separate thread.
+ * The nodes sub-trees are disjoint and yaml-cpp only reads them, except the lazily computed size of the
+ * sequence that contains them, which is computed here before the threads start.
+ **/
+void
+decodeNodesConcurrently(const YAML::Node& nodes,
+                        std::list<NodeSerializationPtr>* serializations)
+{
+    const std::size_t nNodes = nodes.size();
+    std::vector<NodeDecodeTask> tasks(nNodes);
+    for (std::size_t i = 0; i < nNodes; ++i) {
+        tasks[i].node = nodes[i];
+        tasks[i].serialization = boost::make_shared<NodeSerialization>();
+    }
+
+    if (nNodes > 1) {
+        QtConcurrent::blockingMap(tasks, decodeNodeTask);
+    } else {
+        for (std::size_t i = 0; i < nNodes; ++i) {
+            decodeNodeTask(tasks[i]);
+        }
+    }
+
+    // Keep the order of the file: the nodes are created in that order
+    for (std::size_t i = 0; i < nNodes; ++i) {
+        if (tasks[i].failed) {
+            throw std::runtime_error(tasks[i].error);
+        }
+        serializations->push_back(tasks[i].serialization);
+    }
+}
+
+} // anon namespace
+
 
 void
 ProjectBeingLoadedInfo::encode(YAML::Emitter& em) const
@@ -125,12 +199,7 @@ void
 ProjectSerialization::decode(const YAML::Node& node)
 {
     if (node["Nodes"]) {
-        const YAML::Node& n = node["Nodes"];
-        for (std::size_t i = 0; i < n.size(); ++i) {
-            NodeSerializationPtr ns = boost::make_shared<NodeSerialization>();
-            ns->decode(n[i]);
-            _nodes.push_back(ns);
-        }
+        decodeNodesConcurrently(node["Nodes"], &_nodes);
     }
     if (node["Formats"]) {
         const YAML::Node& n = node["Formats"];
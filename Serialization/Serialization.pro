@@ -63,6 +63,7 @@ HEADERS += \
     RotoStrokeItemSerialization.h \
     SettingsSerialization.h \
     SerializationBase.h \
+    SerializationBinary.h \
     SerializationFwd.h \
     SerializationIO.h \
     SerializationCompat.h \
@@ -82,5 +83,6 @@ SOURCES += \
     RectDSerialization.cpp \
     RectISerialization.cpp \
     RotoStrokeItemSerialization.cpp \
+    SerializationBinary.cpp \
     SettingsSerialization.cpp \
     WorkspaceSerialization.cpp
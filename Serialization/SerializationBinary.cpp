@@ -0,0 +1,433 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "SerializationBinary.h"
+
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QtCore/QByteArray>
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <yaml-cpp/yaml.h>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
+// A YAML document can not start with a null character
+#define SERIALIZATION_BINARY_MAGIC "\0NTB"
+#define SERIALIZATION_BINARY_MAGIC_SIZE 4
+#define SERIALIZATION_BINARY_VERSION 1
+
+// The size of the header: the magic, the version, the flags and 2 reserved bytes
+#define SERIALIZATION_BINARY_HEADER_SIZE 8
+
+#define SERIALIZATION_BINARY_FLAG_COMPRESSED 0x1
+
+// Scalars up to this size are stored in the string table
+#define SERIALIZATION_BINARY_MAX_SHARED_SCALAR_SIZE 64
+
+SERIALIZATION_NAMESPACE_ENTER
+
+namespace SerializationBinary {
+
+namespace {
+
+enum NodeTagEnum
+{
+    eNodeTagNull = 0,
+
+    // A scalar that is added to the string table
+    eNodeTagSharedScalar,
+
+    // A scalar already in the string table, referenced by its index
+    eNodeTagScalarReference,
+
+    // A scalar that is not added to the string table
+    eNodeTagScalar,
+    eNodeTagSequence,
+    eNodeTagMap
+};
+
+// The YAML tag of a node is stored in the high bits of the byte holding its NodeTagEnum
+enum YAMLTagEnum
+{
+    // No tag, e.g: the nodes built by hand
+    eYAMLTagNone = 0,
+
+    // The tag of the plain scalars and of the untagged collections
+    eYAMLTagNonSpecific,
+
+    // The tag of the quoted scalars
+    eYAMLTagNonSpecificQuoted,
+
+    // Any other tag, e.g: the tag of local types written with YAML::LocalTag. It is followed by the tag string.
+    eYAMLTagOther
+};
+
+#define SERIALIZATION_BINARY_YAML_TAG_SHIFT 4
+#define SERIALIZATION_BINARY_NODE_TAG_MASK 0xF
+
+class Encoder
+{
+public:
+
+    Encoder()
+    : _data()
+    , _strings()
+    {
+    }
+
+    void encodeNode(const YAML::Node& node)
+    {
+        const std::string& tag = node.Tag();
+        YAMLTagEnum yamlTag;
+        if ( tag.empty() ) {
+            yamlTag = eYAMLTagNone;
+        } else if (tag == "?") {
+            yamlTag = eYAMLTagNonSpecific;
+        } else if (tag == "!") {
+            yamlTag = eYAMLTagNonSpecificQuoted;
+        } else {
+            yamlTag = eYAMLTagOther;
+        }
+        const std::size_t tagPos = _data.size();
+        _data.push_back(0);
+        if (yamlTag == eYAMLTagOther) {
+            writeSharedString(tag);
+        }
+
+        NodeTagEnum nodeTag;
+        switch ( node.Type() ) {
+        case YAML::NodeType::Scalar: {
+            const std::string& scalar = node.Scalar();
+            if (scalar.size() > SERIALIZATION_BINARY_MAX_SHARED_SCALAR_SIZE) {
+                nodeTag = eNodeTagScalar;
+                writeString(scalar);
+            } else {
+                nodeTag = writeSharedString(scalar);
+            }
+            break;
+        }
+        case YAML::NodeType::Sequence:
+            nodeTag = eNodeTagSequence;
+            writeUInt( node.size() );
+            for (YAML::const_iterator it = node.begin(); it != node.end(); ++it) {
+                encodeNode(*it);
+            }
+            break;
+        case YAML::NodeType::Map:
+            nodeTag = eNodeTagMap;
+            writeUInt( node.size() );
+            for (YAML::const_iterator it = node.begin(); it != node.end(); ++it) {
+                encodeNode(it->first);
+                encodeNode(it->second);
+            }
+            break;
+        case YAML::NodeType::Null:
+        case YAML::NodeType::Undefined:
+        default:
+            nodeTag = eNodeTagNull;
+            break;
+        }
+        _data[tagPos] = (char)( nodeTag | (yamlTag << SERIALIZATION_BINARY_YAML_TAG_SHIFT) );
+    } // encodeNode
+
+    const std::vector<char>& getData() const
+    {
+        return _data;
+    }
+
+private:
+
+    void writeUInt(std::size_t value)
+    {
+        // LEB128: 7 bits per byte, the high bit is set on all bytes but the last
+        do {
+            unsigned char byte = value & 0x7F;
+            value >>= 7;
+            if (value) {
+                byte |= 0x80;
+            }
+            _data.push_back( (char)byte );
+        } while (value);
+    }
+
+    void writeString(const std::string& str)
+    {
+        writeUInt( str.size() );
+        _data.insert( _data.end(), str.begin(), str.end() );
+    }
+
+    /**
+     * @brief Writes the string or its index if it is already in the string table.
+     * For tags, the returned NodeTagEnum is written before the string.
+     **/
+    NodeTagEnum writeSharedString(const std::string& str)
+    {
+        std::map<std::string, std::size_t>::iterator found = _strings.find(str);
+        if ( found != _strings.end() ) {
+            writeUInt(found->second << 1 | 1);
+            return eNodeTagScalarReference;
+        }
+        std::size_t index = _strings.size();
+        _strings.insert( std::make_pair(str, index) );
+        writeUInt(str.size() << 1);
+        _data.insert( _data.end(), str.begin(), str.end() );
+        return eNodeTagSharedScalar;
+    }
+
+    std::vector<char> _data;
+
+    // The index of each scalar in the string table
+    std::map<std::string, std::size_t> _strings;
+};
+
+class Decoder
+{
+public:
+
+    Decoder(const char* data, std::size_t size)
+    : _data(data)
+    , _size(size)
+    , _pos(0)
+    , _strings()
+    {
+    }
+
+    YAML::Node decodeNode()
+    {
+        unsigned char tags = readByte();
+        std::string tag;
+        switch (tags >> SERIALIZATION_BINARY_YAML_TAG_SHIFT) {
+        case eYAMLTagNone:
+            break;
+        case eYAMLTagNonSpecific:
+            tag = "?";
+            break;
+        case eYAMLTagNonSpecificQuoted:
+            tag = "!";
+            break;
+        case eYAMLTagOther:
+            tag = readSharedString();
+            break;
+        default:
+            throw std::runtime_error("Invalid binary serialization: unknown tag");
+        }
+
+        YAML::Node node;
+        switch (tags & SERIALIZATION_BINARY_NODE_TAG_MASK) {
+        case eNodeTagNull:
+            node = YAML::Node(YAML::NodeType::Null);
+            break;
+        case eNodeTagSharedScalar:
+        case eNodeTagScalarReference:
+            node = YAML::Node( readSharedString() );
+            break;
+        case eNodeTagScalar: {
+            std::pair<std::size_t, std::size_t> str = readString();
+            node = YAML::Node( std::string(_data + str.first, str.second) );
+            break;
+        }
+        case eNodeTagSequence: {
+            node = YAML::Node(YAML::NodeType::Sequence);
+            std::size_t n = readCount();
+            for (std::size_t i = 0; i < n; ++i) {
+                node.push_back( decodeNode() );
+            }
+            break;
+        }
+        case eNodeTagMap: {
+            node = YAML::Node(YAML::NodeType::Map);
+            std::size_t n = readCount();
+            for (std::size_t i = 0; i < n; ++i) {
+                YAML::Node key = decodeNode();
+                YAML::Node value = decodeNode();
+                node.force_insert(key, value);
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("Invalid binary serialization: unknown node");
+        }
+        if ( !tag.empty() ) {
+            node.SetTag(tag);
+        }
+        return node;
+    } // decodeNode
+
+    bool atEnd() const
+    {
+        return _pos == _size;
+    }
+
+private:
+
+    unsigned char readByte()
+    {
+        if (_pos >= _size) {
+            throw std::runtime_error("Invalid binary serialization: unexpected end of data");
+        }
+        return (unsigned char)_data[_pos++];
+    }
+
+    std::size_t readUInt()
+    {
+        std::size_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            unsigned char byte = readByte();
+            value |= (std::size_t)(byte & 0x7F) << shift;
+            if ( !(byte & 0x80) ) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Invalid binary serialization: bad integer");
+    }
+
+    // Each element takes at least one byte: this rejects corrupted counts before allocating anything
+    std::size_t readCount()
+    {
+        std::size_t n = readUInt();
+        if (n > _size - _pos) {
+            throw std::runtime_error("Invalid binary serialization: bad element count");
+        }
+        return n;
+    }
+
+    // Returns the offset and the size of the string in the buffer
+    std::pair<std::size_t, std::size_t> readString()
+    {
+        std::size_t size = readUInt();
+        if (size > _size - _pos) {
+            throw std::runtime_error("Invalid binary serialization: bad string size");
+        }
+        std::pair<std::size_t, std::size_t> ret(_pos, size);
+        _pos += size;
+        return ret;
+    }
+
+    // Reads a string written by Encoder::writeSharedString
+    std::string readSharedString()
+    {
+        std::size_t value = readUInt();
+        if (value & 1) {
+            std::size_t index = value >> 1;
+            if ( index >= _strings.size() ) {
+                throw std::runtime_error("Invalid binary serialization: bad string reference");
+            }
+            const std::pair<std::size_t, std::size_t>& str = _strings[index];
+            return std::string(_data + str.first, str.second);
+        }
+        std::size_t size = value >> 1;
+        if (size > _size - _pos) {
+            throw std::runtime_error("Invalid binary serialization: bad string size");
+        }
+        _strings.push_back( std::make_pair(_pos, size) );
+        _pos += size;
+        return std::string(_data + _pos - size, size);
+    }
+
+    const char* _data;
+    std::size_t _size;
+    std::size_t _pos;
+
+    // The offset and size in the buffer of the strings of the string table
+    std::vector<std::pair<std::size_t, std::size_t> > _strings;
+};
+
+} // anon namespace
+
+bool
+isBinaryEncoded(std::istream& stream)
+{
+    std::istream::pos_type pos = stream.tellg();
+    char magic[SERIALIZATION_BINARY_MAGIC_SIZE];
+    stream.read(magic, SERIALIZATION_BINARY_MAGIC_SIZE);
+    bool ret = stream.gcount() == SERIALIZATION_BINARY_MAGIC_SIZE && std::memcmp(magic, SERIALIZATION_BINARY_MAGIC, SERIALIZATION_BINARY_MAGIC_SIZE) == 0;
+    stream.clear();
+    stream.seekg(pos);
+    return ret;
+}
+
+void
+encode(const YAML::Node& node, bool compress, std::ostream& stream)
+{
+    Encoder encoder;
+    encoder.encodeNode(node);
+    const std::vector<char>& data = encoder.getData();
+
+    char header[SERIALIZATION_BINARY_HEADER_SIZE] = {0};
+    std::memcpy(header, SERIALIZATION_BINARY_MAGIC, SERIALIZATION_BINARY_MAGIC_SIZE);
+    header[SERIALIZATION_BINARY_MAGIC_SIZE] = SERIALIZATION_BINARY_VERSION;
+    header[SERIALIZATION_BINARY_MAGIC_SIZE + 1] = compress ? SERIALIZATION_BINARY_FLAG_COMPRESSED : 0;
+    stream.write(header, SERIALIZATION_BINARY_HEADER_SIZE);
+
+    if (compress) {
+        QByteArray compressed = qCompress( reinterpret_cast<const uchar*>( data.empty() ? 0 : &data[0] ), (int)data.size() );
+        stream.write( compressed.constData(), compressed.size() );
+    } else if ( !data.empty() ) {
+        stream.write( &data[0], data.size() );
+    }
+}
+
+YAML::Node
+decode(std::istream& stream)
+{
+    // Read everything in a single buffer, scalars are then built straight from it
+    std::vector<char> buffer( (std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>() );
+    if ( (buffer.size() < SERIALIZATION_BINARY_HEADER_SIZE) || (std::memcmp(&buffer[0], SERIALIZATION_BINARY_MAGIC, SERIALIZATION_BINARY_MAGIC_SIZE) != 0) ) {
+        throw std::runtime_error("Invalid binary serialization: bad header");
+    }
+    if (buffer[SERIALIZATION_BINARY_MAGIC_SIZE] != SERIALIZATION_BINARY_VERSION) {
+        throw std::runtime_error("Invalid binary serialization: unsupported version");
+    }
+    bool compressed = buffer[SERIALIZATION_BINARY_MAGIC_SIZE + 1] & SERIALIZATION_BINARY_FLAG_COMPRESSED;
+
+    const char* data = &buffer[0] + SERIALIZATION_BINARY_HEADER_SIZE;
+    std::size_t size = buffer.size() - SERIALIZATION_BINARY_HEADER_SIZE;
+    QByteArray uncompressed;
+    if (compressed) {
+        uncompressed = qUncompress( reinterpret_cast<const uchar*>(data), (int)size );
+        if ( uncompressed.isEmpty() ) {
+            throw std::runtime_error("Invalid binary serialization: bad compressed data");
+        }
+        data = uncompressed.constData();
+        size = uncompressed.size();
+    }
+
+    Decoder decoder(data, size);
+    YAML::Node node = decoder.decodeNode();
+    if ( !decoder.atEnd() ) {
+        throw std::runtime_error("Invalid binary serialization: trailing data");
+    }
+    return node;
+}
+
+} // namespace SerializationBinary
+
+SERIALIZATION_NAMESPACE_EXIT
@@ -0,0 +1,75 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef SERIALIZATIONBINARY_H
+#define SERIALIZATIONBINARY_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <istream>
+#include <ostream>
+
+#include "Global/Macros.h"
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <yaml-cpp/node/node.h>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
+#include "Serialization/SerializationFwd.h"
+
+SERIALIZATION_NAMESPACE_ENTER
+
+/**
+ * @brief A compact binary encoding of the YAML tree produced by the encode() function of the serialization objects.
+ * Loading a binary file skips the YAML scanner and parser which dominate the load time of large projects.
+ *
+ * The file starts with a magic number that can never start a YAML document, followed by the tree in depth-first order.
+ * Scalars are stored with their length. Short scalars, which are mostly names and numbers repeated all over a project,
+ * are stored once and then referenced by their index in a string table.
+ * When decoding, the file is read in a single buffer and the scalars are built straight from it.
+ * The whole tree may optionally be compressed.
+ **/
+namespace SerializationBinary {
+
+/**
+ * @brief Returns true if the data at the current position of the stream is binary encoded.
+ * The position of the stream is left unchanged.
+ **/
+bool isBinaryEncoded(std::istream& stream);
+
+/**
+ * @brief Writes the given tree to the stream
+ **/
+void encode(const YAML::Node& node, bool compress, std::ostream& stream);
+
+/**
+ * @brief Reads a tree written by encode() from the current position of the stream until its end.
+ * Throws a std::runtime_error if the data is not valid.
+ **/
+YAML::Node decode(std::istream& stream);
+
+} // namespace SerializationBinary
+
+SERIALIZATION_NAMESPACE_EXIT
+
+#endif // SERIALIZATIONBINARY_H
@@ -78,6 +78,21 @@ typedef boost::shared_ptr<RotoStrokeItemSerialization> RotoStrokeItemSerializati
 typedef std::list<NodeSerializationPtr> NodeSerializationList;
 typedef std::list<KnobSerializationPtr> KnobSerializationList;
 
+/**
+ * @brief The encoding of the files written by the write() function in SerializationIO.h
+ **/
+enum SerializationFormatEnum
+{
+    // Human readable YAML
+    eSerializationFormatYAML = 0,
+
+    // The YAML tree encoded with SerializationBinary, faster to load
+    eSerializationFormatBinary,
+
+    // Same as eSerializationFormatBinary but compressed
+    eSerializationFormatBinaryCompressed
+};
+
 SERIALIZATION_NAMESPACE_EXIT
 
 #ifndef YAML
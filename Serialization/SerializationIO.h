@@ -39,6 +39,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Serialization/SerializationFwd.h"
+#include "Serialization/SerializationBinary.h"
 #include "Serialization/WorkspaceSerialization.h"
 #include "Serialization/ProjectSerialization.h"
 #include "Serialization/NodeSerialization.h"
@@ -48,16 +49,23 @@ SERIALIZATION_NAMESPACE_ENTER
 /**
  * @brief Write any serialization object to a YAML encoded file.
  * @param header The given header string will be written on the first line of the file unless it is empty.
+ * @param format With a binary format, the stream should be opened in binary mode. The header is still written as text
+ * so that the file can be identified the same way.
  **/
 template <typename T>
-void write(std::ostream& stream, const T& obj, const std::string& header)
+void write(std::ostream& stream, const T& obj, const std::string& header, SerializationFormatEnum format = eSerializationFormatYAML)
 {
     if (!header.empty()) {
         stream << header.c_str() << std::endl;
     }
     YAML::Emitter em;
     obj.encode(em);
-    stream << em.c_str();
+    if (format == eSerializationFormatYAML) {
+        stream << em.c_str();
+    } else {
+        // The serialization objects can only encode to an emitter: parse its output back to get the tree
+        SerializationBinary::encode(YAML::Load( em.c_str() ), format == eSerializationFormatBinaryCompressed, stream);
+    }
 }
 
 class InvalidSerializationFileException : public std::exception
@@ -82,7 +90,8 @@ public:
 };
 
 /**
- * @brief Read any serialization object from a YAML encoded file. Upon failure an exception is thrown.
+ * @brief Read any serialization object from a YAML or binary encoded file. Upon failure an exception is thrown.
+ * The format is detected from the content of the file.
  * @param header The first line of the file is matched against the given header string.
  * If it does not match, this function throws a InvalidSerializationFileException exception
  * If header is empty, it does not check against the header.
@@ -120,11 +129,17 @@ void read(const std::string& header, std::istream& stream, T* obj)
             }
             // Since we called getline, we must reset the stream
             if (!skipFirstLine) {
+                // getline may have reached the end of a binary file
+                stream.clear();
                 stream.seekg(0);
             }
         }
     }
-    obj->decode(YAML::Load(stream));
+    if ( SerializationBinary::isBinaryEncoded(stream) ) {
+        obj->decode( SerializationBinary::decode(stream) );
+    } else {
+        obj->decode( YAML::Load(stream) );
+    }
 }
 
 SERIALIZATION_NAMESPACE_EXIT
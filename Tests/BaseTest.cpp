@@ -46,6 +46,7 @@ CLANG_DIAG_ON(unknown-pragmas)
 
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
 #include "Engine/Project.h"
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
@@ -291,3 +292,40 @@ TEST_F(BaseTest, SimpleNodeConnections) {
     disconnectNodes(generator, writer, false);
     connectNodes(generator, writer, 0, true);
 }
+
+///The cached topology of the project follows the connections
+TEST_F(BaseTest, NodeCollectionTopology) {
+    NodePtr generator = createNode(_generatorPluginID);
+    NodePtr writer = createNode(_writeOIIOPluginID);
+
+    ASSERT_TRUE(writer && generator);
+    NodeCollectionPtr group = writer->getGroup();
+    ASSERT_TRUE(group);
+
+    connectNodes(generator, writer, 0, true);
+    NodeCollectionTopologyConstPtr topology = group->getTopology();
+    ASSERT_TRUE(topology && topology->isComplete());
+    EXPECT_EQ( topology, group->getTopology() );
+
+    int generatorIndex = topology->getIndex( generator.get() );
+    int writerIndex = topology->getIndex( writer.get() );
+    ASSERT_TRUE(generatorIndex != -1 && writerIndex != -1);
+    EXPECT_LT(generatorIndex, writerIndex);
+    EXPECT_TRUE( topology->isUpstream(writerIndex, generatorIndex) );
+    EXPECT_FALSE( topology->isUpstream(generatorIndex, writerIndex) );
+    EXPECT_TRUE( writer->isNodeUpstream(generator) );
+    EXPECT_FALSE( generator->isNodeUpstream(writer) );
+
+    std::vector<int> upstreamNodes;
+    topology->getUpstreamNodes(writerIndex, &upstreamNodes);
+    ASSERT_EQ( (std::size_t)2, upstreamNodes.size() );
+    EXPECT_EQ(writerIndex, upstreamNodes[0]);
+    EXPECT_EQ(generatorIndex, upstreamNodes[1]);
+
+    // Disconnecting drops the snapshot
+    disconnectNodes(generator, writer, true);
+    NodeCollectionTopologyConstPtr disconnectedTopology = group->getTopology();
+    EXPECT_NE(topology, disconnectedTopology);
+    EXPECT_FALSE( disconnectedTopology->isUpstream( disconnectedTopology->getIndex( writer.get() ), disconnectedTopology->getIndex( generator.get() ) ) );
+    EXPECT_FALSE( writer->isNodeUpstream(generator) );
+}
@@ -0,0 +1,138 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+
+#include "Engine/BoundedRingBuffer.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(BoundedRingBuffer,
+     PushPopAndDrop)
+{
+    BoundedRingBuffer<int> buffer(5);
+    EXPECT_EQ(8, buffer.getCapacity());
+
+    int value = -1;
+    EXPECT_FALSE( buffer.tryPop(&value) );
+
+    // Wrap around the ring several times
+    for (int turn = 0; turn < 3; ++turn) {
+        for (int i = 0; i < 8; ++i) {
+            EXPECT_TRUE( buffer.tryPush(turn * 8 + i) );
+        }
+        // Full: the value is dropped
+        EXPECT_FALSE( buffer.tryPush(-1) );
+        EXPECT_EQ(turn + 1, buffer.getDroppedCount());
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_TRUE( buffer.tryPop(&value) );
+            EXPECT_EQ(turn * 8 + i, value);
+        }
+        EXPECT_FALSE( buffer.tryPop(&value) );
+    }
+}
+
+namespace {
+
+class ProducerThread
+    : public QThread
+{
+public:
+
+    ProducerThread(BoundedRingBuffer<int>* buffer,
+                   int producerIndex,
+                   int count)
+    : QThread()
+    , _buffer(buffer)
+    , _producerIndex(producerIndex)
+    , _count(count)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (int i = 0; i < _count; ++i) {
+            _buffer->tryPush(_producerIndex * _count + i);
+        }
+    }
+
+    BoundedRingBuffer<int>* _buffer;
+    int _producerIndex;
+    int _count;
+};
+
+} // anon
+
+TEST(BoundedRingBuffer,
+     MultipleProducers)
+{
+    const int producersCount = 4;
+    const int valuesPerProducer = 100000;
+    BoundedRingBuffer<int> buffer(1024);
+
+    std::vector<ProducerThread*> producers;
+    for (int i = 0; i < producersCount; ++i) {
+        producers.push_back( new ProducerThread(&buffer, i, valuesPerProducer) );
+        producers.back()->start();
+    }
+
+    // Each value is popped at most once and the values of a producer are popped in order
+    std::vector<int> lastValues(producersCount, -1);
+    int poppedCount = 0;
+    bool running = true;
+    while (running) {
+        running = false;
+        for (int i = 0; i < producersCount; ++i) {
+            if ( !producers[i]->isFinished() ) {
+                running = true;
+            }
+        }
+        int value;
+        while ( buffer.tryPop(&value) ) {
+            ASSERT_GE(value, 0);
+            ASSERT_LT(value, producersCount * valuesPerProducer);
+            const int producer = value / valuesPerProducer;
+            EXPECT_GT(value, lastValues[producer]);
+            lastValues[producer] = value;
+            ++poppedCount;
+        }
+    }
+    for (int i = 0; i < producersCount; ++i) {
+        producers[i]->wait();
+        delete producers[i];
+    }
+
+    // Every value was either popped or counted as dropped
+    EXPECT_EQ(producersCount * valuesPerProducer, poppedCount + buffer.getDroppedCount());
+}
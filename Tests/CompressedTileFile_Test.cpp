@@ -0,0 +1,91 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "Engine/CompressedTileFile.h"
+
+NATRON_NAMESPACE_USING
+
+static std::vector<float>
+makeTile(int seed)
+{
+    std::vector<float> tile(64 * 64);
+    for (int y = 0; y < 64; ++y) {
+        for (int x = 0; x < 64; ++x) {
+            tile[y * 64 + x] = 0.5f + 0.25f * std::sin( (x + seed) * 0.05f ) * std::cos(y * 0.07f);
+        }
+    }
+    return tile;
+}
+
+TEST(CompressedTileFile,
+     TilesPersistAcrossSessions)
+{
+    const std::string filePath = QDir::tempPath().toStdString() + "/NatronCompressedTileFileTest.tiles";
+    QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+
+    const std::size_t tileSizeBytes = 64 * 64 * sizeof(float);
+    std::vector<float> tile0 = makeTile(0), tile1 = makeTile(10);
+    {
+        CompressedTileFile file;
+        ASSERT_TRUE( file.open(filePath) );
+        file.writeTile(1, &tile0[0], tileSizeBytes, 4);
+        file.writeTile(2, &tile1[0], tileSizeBytes, 4);
+        // Writing a tile twice only stores it once
+        file.writeTile(1, &tile0[0], tileSizeBytes, 4);
+        EXPECT_EQ( file.getNumTiles(), (std::size_t)2 );
+        EXPECT_LT( file.getSize(), 2 * tileSizeBytes );
+    }
+    {
+        CompressedTileFile file;
+        ASSERT_TRUE( file.open(filePath) );
+        EXPECT_EQ( file.getNumTiles(), (std::size_t)2 );
+        EXPECT_TRUE( file.hasTile(1) );
+        EXPECT_FALSE( file.hasTile(3) );
+
+        std::vector<float> read(64 * 64);
+        EXPECT_TRUE( file.readTile(2, &read[0], tileSizeBytes) );
+        EXPECT_EQ( std::memcmp(&read[0], &tile1[0], tileSizeBytes), 0 );
+        EXPECT_TRUE( file.readTile(1, &read[0], tileSizeBytes) );
+        EXPECT_EQ( std::memcmp(&read[0], &tile0[0], tileSizeBytes), 0 );
+
+        // A tile of another size is not returned
+        EXPECT_FALSE( file.readTile(1, &read[0], tileSizeBytes / 2) );
+
+        file.clear();
+        EXPECT_EQ( file.getNumTiles(), (std::size_t)0 );
+        EXPECT_FALSE( file.readTile(1, &read[0], tileSizeBytes) );
+    }
+    QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+}
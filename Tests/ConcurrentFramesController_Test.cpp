@@ -0,0 +1,137 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+
+#include "Engine/ConcurrentFramesController.h"
+
+NATRON_NAMESPACE_USING
+
+// Renders nFramesToRender frames with a throughput depending on the number of frames in flight and
+// returns the number of frames the controller ends up with
+static int
+simulateRender(int maxFrames,
+               int nFramesToRender,
+               double (*throughputFunc)(int),
+               int* nChanges)
+{
+    const U64 totalRAM = 16ULL << 30;
+    ConcurrentFramesController controller;
+    controller.reset(maxFrames, 0., 0, totalRAM / 2, totalRAM);
+    double now = 0.;
+    *nChanges = 0;
+    for (int i = 0; i < nFramesToRender; ++i) {
+        now += 1. / throughputFunc( controller.getNumConcurrentFrames() );
+        ConcurrentFramesController::Decision decision;
+        if ( controller.onFrameRendered(now, 0, totalRAM / 2, &decision) ) {
+            EXPECT_GE(decision.numFrames, 1);
+            EXPECT_LE(decision.numFrames, maxFrames);
+            EXPECT_EQ( decision.numFrames, controller.getNumConcurrentFrames() );
+            ++*nChanges;
+        }
+    }
+
+    return controller.getNumConcurrentFrames();
+}
+
+// Scales with the frames until 12 frames in flight
+static double
+scalesAcrossFrames(int nFrames)
+{
+    return std::min(nFrames, 12);
+}
+
+// Already uses all the threads on the tiles of a single frame
+static double
+scalesAcrossTiles(int /*nFrames*/)
+{
+    return 4.;
+}
+
+// Thrashes with more than 5 frames in flight
+static double
+peaksAtFiveFrames(int nFrames)
+{
+    return 8. / ( 1. + std::abs(nFrames - 5) );
+}
+
+TEST(ConcurrentFramesController,
+     ConvergesToTheBestThroughput)
+{
+    int nChanges;
+    EXPECT_NEAR(simulateRender(16, 400, scalesAcrossFrames, &nChanges), 12, 1);
+    EXPECT_NEAR(simulateRender(16, 400, peaksAtFiveFrames, &nChanges), 5, 1);
+}
+
+TEST(ConcurrentFramesController,
+     UsesFewerFramesWhenTheThroughputDoesNotChange)
+{
+    int nChanges;
+    EXPECT_LE(simulateRender(16, 400, scalesAcrossTiles, &nChanges), 2);
+}
+
+TEST(ConcurrentFramesController,
+     ProbesLessOftenOnceConverged)
+{
+    int nChanges;
+    simulateRender(16, 400, peaksAtFiveFrames, &nChanges);
+    int nChangesLongRender;
+    simulateRender(16, 4000, peaksAtFiveFrames, &nChangesLongRender);
+    EXPECT_LT(nChangesLongRender, nChanges * 4);
+}
+
+TEST(ConcurrentFramesController,
+     DecreasesOnLowMemory)
+{
+    const U64 totalRAM = 16ULL << 30;
+    ConcurrentFramesController controller;
+    controller.reset(8, 0., 1ULL << 30, totalRAM / 2, totalRAM);
+    int nFrames = controller.getNumConcurrentFrames();
+    double now = 0.;
+    bool decreased = false;
+    for (int i = 0; i < 50 && !decreased; ++i) {
+        now += 0.1;
+        ConcurrentFramesController::Decision decision;
+        if ( controller.onFrameRendered(now, 4ULL << 30, totalRAM / 100, &decision) ) {
+            EXPECT_EQ(decision.reason, ConcurrentFramesController::eChangeReasonLowMemory);
+            EXPECT_EQ(decision.numFrames, nFrames - 1);
+            decreased = true;
+        }
+    }
+    EXPECT_TRUE(decreased);
+
+    // Never goes under 1 frame
+    for (int i = 0; i < 1000; ++i) {
+        now += 0.1;
+        ConcurrentFramesController::Decision decision;
+        controller.onFrameRendered(now, 4ULL << 30, totalRAM / 100, &decision);
+    }
+    EXPECT_EQ(controller.getNumConcurrentFrames(), 1);
+}
@@ -25,6 +25,10 @@
 
 #include "Global/Macros.h"
 
+#include <limits>
+#include <list>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <QtCore/QString>
@@ -125,3 +129,178 @@ TEST(Curve, Basic)
 }
 
 
+TEST(Curve, RevisionChangesWithTheCurve)
+{
+    Curve c;
+    U64 revision = c.getRevision();
+
+    EXPECT_TRUE( c.setOrAddKeyframe( KeyFrame(0., 10.) ) == eValueChangedReturnCodeKeyframeAdded );
+    EXPECT_NE( revision, c.getRevision() );
+    revision = c.getRevision();
+
+    EXPECT_TRUE( c.setOrAddKeyframe( KeyFrame(10., 20.) ) == eValueChangedReturnCodeKeyframeAdded );
+    revision = c.getRevision();
+
+    // Derivatives and interpolation changes are not notified to the listeners but change the curve values
+    (void)c.setKeyFrameDerivatives(1., 1., 0);
+    EXPECT_NE( revision, c.getRevision() );
+    revision = c.getRevision();
+
+    EXPECT_TRUE( c.setKeyFrameInterpolation(eKeyframeTypeConstant, TimeValue(0.)) );
+    EXPECT_NE( revision, c.getRevision() );
+    revision = c.getRevision();
+
+    // Reading the curve does not change it
+    (void)c.getValueAt(TimeValue(5.));
+    (void)c.getKeyFrames_mt_safe();
+    EXPECT_EQ( revision, c.getRevision() );
+
+    c.removeKeyFrameWithTime(TimeValue(10.));
+    EXPECT_NE( revision, c.getRevision() );
+    revision = c.getRevision();
+
+    c.clearKeyFrames();
+    EXPECT_NE( revision, c.getRevision() );
+}
+
+
+TEST(Curve, SegmentsFollowTheKeyframes)
+{
+    Curve c;
+    const int nKeys = 1000;
+    for (int i = 0; i < nKeys; ++i) {
+        c.setOrAddKeyframe( KeyFrame(i, i * i, 0., 0., eKeyframeTypeLinear) );
+    }
+
+    // Sequential, backward and random access must give the same values
+    for (int i = 0; i < nKeys - 1; ++i) {
+        EXPECT_DOUBLE_EQ( i * i, c.getValueAt(TimeValue(i)).getValue() );
+        EXPECT_DOUBLE_EQ( (i * i + (i + 1) * (i + 1)) / 2., c.getValueAt(TimeValue(i + 0.5)).getValue() );
+    }
+    for (int i = nKeys - 2; i >= 0; --i) {
+        EXPECT_DOUBLE_EQ( (i * i + (i + 1) * (i + 1)) / 2., c.getValueAt(TimeValue(i + 0.5)).getValue() );
+    }
+    for (int i = 0; i < 100; ++i) {
+        int k = (i * 7919) % nKeys;
+        EXPECT_DOUBLE_EQ( k * k, c.getValueAt(TimeValue(k)).getValue() );
+    }
+
+    // Before the first and after the last keyframe
+    EXPECT_DOUBLE_EQ( 0., c.getValueAt(TimeValue(-10.)).getValue() );
+    EXPECT_DOUBLE_EQ( (nKeys - 1) * (nKeys - 1), c.getValueAt(TimeValue(nKeys + 10.)).getValue() );
+
+    // Editing the curve must be reflected immediately
+    EXPECT_DOUBLE_EQ( 100., c.getValueAt(TimeValue(10.)).getValue() );
+    c.setOrAddKeyframe( KeyFrame(10., -5., 0., 0., eKeyframeTypeLinear) );
+    EXPECT_DOUBLE_EQ( -5., c.getValueAt(TimeValue(10.)).getValue() );
+    c.removeKeyFrameWithTime(TimeValue(10.));
+    EXPECT_DOUBLE_EQ( (81. + 121.) / 2., c.getValueAt(TimeValue(10.)).getValue() );
+
+    // Constant interpolation
+    EXPECT_TRUE( c.setKeyFrameInterpolation(eKeyframeTypeConstant, TimeValue(20.)) );
+    EXPECT_DOUBLE_EQ( 400., c.getValueAt(TimeValue(20.9)).getValue() );
+}
+
+TEST(Curve, GetValuesAtMatchesGetValueAt)
+{
+    Curve c;
+    c.setOrAddKeyframe( KeyFrame(0., 0.) );
+    c.setOrAddKeyframe( KeyFrame(10., 50., 0., 0., eKeyframeTypeLinear) );
+    c.setOrAddKeyframe( KeyFrame(20., -3., 0., 0., eKeyframeTypeConstant) );
+    c.setOrAddKeyframe( KeyFrame(30., 8.) );
+
+    // Unsorted times, including outside of the keyframes range
+    std::vector<TimeValue> times;
+    for (int i = 0; i < 64; ++i) {
+        times.push_back( TimeValue( -5. + ( (i * 37) % 64 ) * 0.7 ) );
+    }
+    std::vector<double> values( times.size() );
+    c.getValuesAt( &times[0], &values[0], (int)times.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ( c.getValueAt(times[i]).getValue(), values[i] );
+    }
+
+    // Integer curves are rounded
+    Curve intCurve(eCurveTypeInt);
+    intCurve.setOrAddKeyframe( KeyFrame(0., 0., 0., 0., eKeyframeTypeLinear) );
+    intCurve.setOrAddKeyframe( KeyFrame(10., 10., 0., 0., eKeyframeTypeLinear) );
+    intCurve.getValuesAt( &times[0], &values[0], (int)times.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ( intCurve.getValueAt(times[i]).getValue(), values[i] );
+    }
+
+    // Empty curves are 0
+    Curve empty;
+    empty.getValuesAt( &times[0], &values[0], (int)times.size() );
+    EXPECT_EQ( 0., values[0] );
+}
+
+TEST(Curve, SetOrAddKeyframesMatchesSetOrAddKeyframe)
+{
+    std::list<KeyFrame> keys;
+    for (int i = 0; i < 20; ++i) {
+        keys.push_back( KeyFrame(i * 2., (i * 13) % 7) );
+    }
+    // Replace a keyframe of the same batch
+    keys.push_back( KeyFrame(4., -1.) );
+
+    Curve c1, c2;
+    c1.setOrAddKeyframe( KeyFrame(3., 5.) );
+    c2.setOrAddKeyframe( KeyFrame(3., 5.) );
+    for (std::list<KeyFrame>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        c1.setOrAddKeyframe(*it);
+    }
+    EXPECT_TRUE( c2.setOrAddKeyframes(keys) );
+
+    KeyFrameSet ks1 = c1.getKeyFrames_mt_safe();
+    KeyFrameSet ks2 = c2.getKeyFrames_mt_safe();
+    ASSERT_EQ( ks1.size(), ks2.size() );
+    for (KeyFrameSet::const_iterator it1 = ks1.begin(), it2 = ks2.begin(); it1 != ks1.end(); ++it1, ++it2) {
+        EXPECT_EQ( *it1, *it2 );
+    }
+
+    // Setting the same keyframes again changes nothing
+    EXPECT_FALSE( c2.setOrAddKeyframes(keys) );
+
+    // Invalid values are ignored
+    std::list<KeyFrame> nanKeys;
+    nanKeys.push_back( KeyFrame( 100., std::numeric_limits<double>::quiet_NaN() ) );
+    EXPECT_FALSE( c2.setOrAddKeyframes(nanKeys) );
+    EXPECT_EQ( ks2.size(), c2.getKeyFrames_mt_safe().size() );
+}
+
+TEST(Curve, BulkEditRefreshesDerivativesAtTheEnd)
+{
+    const int nKeys = 2000;
+
+    Curve c1, c2;
+    c2.beginBulkEdit();
+    for (int i = 0; i < nKeys; ++i) {
+        KeyFrame k(i, (i * 13) % 7);
+        c1.setOrAddKeyframe(k);
+        c2.setOrAddKeyframe(k);
+    }
+    // Nested bulk edits refresh nothing until the outermost one ends
+    c2.beginBulkEdit();
+    c2.removeKeyFrameWithTime( TimeValue(nKeys / 2) );
+    c2.endBulkEdit();
+    c2.setOrAddKeyframe( KeyFrame(nKeys / 2, (nKeys / 2 * 13) % 7) );
+    c2.endBulkEdit();
+
+    // The smooth derivatives of a keyframe only depend on the values of its neighbours, except at the ends of the curve
+    KeyFrameSet ks1 = c1.getKeyFrames_mt_safe();
+    KeyFrameSet ks2 = c2.getKeyFrames_mt_safe();
+    ASSERT_EQ( ks1.size(), ks2.size() );
+    ASSERT_EQ( (std::size_t)nKeys, ks2.size() );
+    KeyFrameSet::const_iterator it1 = ks1.begin(), it2 = ks2.begin();
+    ++it1;
+    ++it2;
+    for (int i = 1; i < nKeys - 1; ++i, ++it1, ++it2) {
+        EXPECT_EQ( it1->getTime(), it2->getTime() );
+        EXPECT_DOUBLE_EQ( it1->getLeftDerivative(), it2->getLeftDerivative() );
+        EXPECT_DOUBLE_EQ( it1->getRightDerivative(), it2->getRightDerivative() );
+    }
+    for (double t = 1.; t < nKeys - 2; t += 0.75) {
+        EXPECT_DOUBLE_EQ( c1.getValueAt(TimeValue(t)).getValue(), c2.getValueAt(TimeValue(t)).getValue() );
+    }
+}
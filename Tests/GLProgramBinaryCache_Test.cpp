@@ -0,0 +1,84 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "Engine/GLProgramBinaryCache.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(GLProgramBinaryCache,
+     KeyDependsOnDriverAndSources)
+{
+    const std::string driver = "Vendor\nRenderer\n4.5";
+    const U64 key = GLProgramBinaryCache::computeProgramKey(driver, "", "void main() {}");
+
+    EXPECT_EQ( key, GLProgramBinaryCache::computeProgramKey(driver, "", "void main() {}") );
+    EXPECT_NE( key, GLProgramBinaryCache::computeProgramKey("Vendor\nRenderer\n4.6", "", "void main() {}") );
+    EXPECT_NE( key, GLProgramBinaryCache::computeProgramKey(driver, "", "void main() { }") );
+
+    // The same code in the vertex shader is another program
+    EXPECT_NE( key, GLProgramBinaryCache::computeProgramKey(driver, "void main() {}", "") );
+}
+
+TEST(GLProgramBinaryCache,
+     BinariesPersistInFiles)
+{
+    const std::string filePath = QDir::tempPath().toStdString() + "/NatronGLProgramBinaryCacheTest.bin";
+    QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+
+    std::vector<char> binary(1000);
+    for (std::size_t i = 0; i < binary.size(); ++i) {
+        binary[i] = (char)(i * 7);
+    }
+    const U64 key = 0x123456789ABCDEFULL;
+    ASSERT_TRUE( GLProgramBinaryCache::writeProgramBinaryFile(filePath, key, 0x8E21, binary) );
+
+    U32 format = 0;
+    std::vector<char> read;
+    EXPECT_TRUE( GLProgramBinaryCache::readProgramBinaryFile(filePath, key, &format, &read) );
+    EXPECT_EQ( format, (U32)0x8E21 );
+    EXPECT_TRUE( read == binary );
+
+    // Another program never gets this binary
+    EXPECT_FALSE( GLProgramBinaryCache::readProgramBinaryFile(filePath, key + 1, &format, &read) );
+
+    // A truncated file is rejected
+    {
+        QFile file( QString::fromUtf8( filePath.c_str() ) );
+        ASSERT_TRUE( file.open(QIODevice::ReadWrite) );
+        ASSERT_TRUE( file.resize(file.size() - 10) );
+    }
+    EXPECT_FALSE( GLProgramBinaryCache::readProgramBinaryFile(filePath, key, &format, &read) );
+
+    QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+    EXPECT_FALSE( GLProgramBinaryCache::readProgramBinaryFile(filePath, key, &format, &read) );
+}
@@ -0,0 +1,120 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <gtest/gtest.h>
+
+#if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <boost/math/special_functions/fpclassify.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#endif
+
+#include "Engine/Half.h"
+
+NATRON_NAMESPACE_USING
+
+static unsigned int
+floatBits(float f)
+{
+    unsigned int bits;
+    memcpy( &bits, &f, sizeof(float) );
+    return bits;
+}
+
+TEST(Half, SpecialValues) {
+    EXPECT_EQ( 0x0000, Half(0.f).bits() );
+    EXPECT_EQ( 0x8000, Half(-0.f).bits() );
+    EXPECT_EQ( 0x3c00, Half(1.f).bits() );
+    EXPECT_EQ( 0xc000, Half(-2.f).bits() );
+    EXPECT_EQ( 0x7bff, Half(65504.f).bits() );
+    // rounds to the largest half or overflows
+    EXPECT_EQ( 0x7bff, Half(65519.f).bits() );
+    EXPECT_EQ( 0x7c00, Half(65520.f).bits() );
+    EXPECT_EQ( 0x7c00, Half( std::numeric_limits<float>::infinity() ).bits() );
+    EXPECT_EQ( 0xfc00, Half( -std::numeric_limits<float>::infinity() ).bits() );
+    // smallest normal and denormal halves
+    EXPECT_EQ( 0x0400, Half(6.103515625e-05f).bits() );
+    EXPECT_EQ( 0x0001, Half(5.9604644775390625e-08f).bits() );
+    // ties round to even
+    EXPECT_EQ( 0x0000, Half(2.98023223876953125e-08f).bits() );
+    EXPECT_EQ( 0x3c00, Half(1.f + 1.f / 2048).bits() );
+    EXPECT_EQ( 0x3c02, Half(1.f + 3.f / 2048).bits() );
+
+    EXPECT_TRUE( (boost::math::isnan)( Half( std::numeric_limits<float>::quiet_NaN() ) ) );
+    EXPECT_TRUE( (boost::math::isnan)( (float)Half::fromBits(0x7c01) ) );
+    EXPECT_FALSE( (boost::math::isnan)( Half(1.f) ) );
+}
+
+// Every half converts to float and back to itself, except the NaNs which stay NaNs
+TEST(Half, RoundTrip) {
+    for (unsigned int i = 0; i < 0x10000; ++i) {
+        const unsigned short bits = (unsigned short)i;
+        const float f = Half::toFloat(bits);
+        if ( ( (bits & 0x7c00) == 0x7c00 ) && (bits & 0x3ff) ) {
+            EXPECT_TRUE( (boost::math::isnan)(f) );
+            EXPECT_TRUE( (boost::math::isnan)( Half(f) ) );
+        } else {
+            EXPECT_EQ( bits, Half::fromFloat(f) );
+        }
+    }
+}
+
+// The row conversions must give the same results with and without the instructions of the CPU
+TEST(Half, RowConversions) {
+    const int n = 0x10000 + 7;
+    std::vector<Half> halves(n);
+    std::vector<float> floats(n);
+    unsigned int seed = 1;
+    for (int i = 0; i < n; ++i) {
+        halves[i] = Half::fromBits( (unsigned short)i );
+        seed = seed * 1103515245 + 12345;
+        unsigned int bits = seed;
+        memcpy( &floats[i], &bits, sizeof(float) );
+    }
+
+    const bool wasEnabled = Half::isHardwareConversionEnabled();
+    std::vector<float> toFloat[2];
+    std::vector<Half> fromFloat[2];
+    for (int hw = 0; hw < 2; ++hw) {
+        Half::setHardwareConversionEnabled(hw != 0);
+        toFloat[hw].resize(n);
+        fromFloat[hw].resize(n);
+        Half::convertRowToFloat( &halves[0], &toFloat[hw][0], n );
+        Half::convertRowFromFloat( &floats[0], &fromFloat[hw][0], n );
+    }
+    Half::setHardwareConversionEnabled(wasEnabled);
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ( floatBits(toFloat[0][i]), floatBits(toFloat[1][i]) );
+        EXPECT_EQ( floatBits( Half::toFloat( halves[i].bits() ) ), floatBits(toFloat[0][i]) );
+        EXPECT_EQ( fromFloat[0][i].bits(), fromFloat[1][i].bits() );
+        EXPECT_EQ( Half::fromFloat(floats[i]), fromFloat[0][i].bits() );
+    }
+}
@@ -26,8 +26,11 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <vector>
 #include <gtest/gtest.h>
 
+#include <QtCore/QString>
+
 #include "Engine/Hash64.h"
 
 NATRON_NAMESPACE_USING
@@ -91,3 +94,88 @@ TEST(Hash64,
     EXPECT_NE(hash1, hash2);
 } // TEST
 
+
+TEST(Hash64,
+     Streaming)
+{
+    // Computing the hash does not prevent from appending more values
+    Hash64 hash1;
+    hash1.append<int>(1);
+    hash1.computeHash();
+    U64 firstValue = hash1.value();
+    hash1.computeHash();
+    EXPECT_EQ( firstValue, hash1.value() ) << "Computing twice the same hash gives the same value";
+
+    hash1.append<int>(2);
+    ASSERT_FALSE( hash1.valid() );
+    hash1.computeHash();
+    EXPECT_NE( firstValue, hash1.value() );
+
+    Hash64 hash2;
+    hash2.append<int>(1);
+    hash2.append<int>(2);
+    hash2.computeHash();
+    EXPECT_EQ( hash1.value(), hash2.value() ) << "Intermediate computations do not change the hash";
+
+    // Order matters
+    Hash64 hash3;
+    hash3.append<int>(2);
+    hash3.append<int>(1);
+    hash3.computeHash();
+    EXPECT_NE( hash2.value(), hash3.value() );
+
+    // insert() is the same as appending each element
+    std::vector<U64> elements;
+    elements.push_back( Hash64::toU64<int>(1) );
+    elements.push_back( Hash64::toU64<int>(2) );
+    Hash64 hash4;
+    hash4.insert(elements);
+    hash4.computeHash();
+    EXPECT_EQ( hash2.value(), hash4.value() );
+
+    // A reset hash is the same as a fresh one
+    hash4.reset();
+    ASSERT_TRUE( hash4.isEmpty() );
+    hash4.append<int>(1);
+    hash4.computeHash();
+    EXPECT_EQ( firstValue, hash4.value() );
+
+    // Zero is not ignored
+    Hash64 hash5;
+    hash5.append<int>(0);
+    hash5.computeHash();
+    Hash64 hash6;
+    hash6.append<int>(0);
+    hash6.append<int>(0);
+    hash6.computeHash();
+    EXPECT_NE( hash5.value(), hash6.value() );
+} // TEST
+
+TEST(Hash64,
+     QString)
+{
+    Hash64 hash1;
+    Hash64::appendQString(QString::fromUtf8("Blur1"), &hash1);
+    hash1.computeHash();
+
+    Hash64 hash2;
+    Hash64::appendQString(QString::fromUtf8("Blur1"), &hash2);
+    hash2.computeHash();
+    EXPECT_EQ( hash1.value(), hash2.value() );
+
+    Hash64 hash3;
+    Hash64::appendQString(QString::fromUtf8("Blur2"), &hash3);
+    hash3.computeHash();
+    EXPECT_NE( hash1.value(), hash3.value() );
+
+    // Strings are delimited
+    Hash64 hash4;
+    Hash64::appendQString(QString::fromUtf8("Blu"), &hash4);
+    Hash64::appendQString(QString::fromUtf8("r1"), &hash4);
+    hash4.computeHash();
+    EXPECT_NE( hash1.value(), hash4.value() );
+
+    Hash64 hash5;
+    Hash64::appendQString(QString(), &hash5);
+    ASSERT_FALSE( hash5.isEmpty() );
+} // TEST
@@ -0,0 +1,150 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "Engine/Hash64.h"
+#include "Engine/HashableObject.h"
+#include "Engine/HashProfiler.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+
+class NamedHashable
+    : public HashableObject
+{
+    std::string _name;
+    std::vector<boost::shared_ptr<NamedHashable> > _dependencies;
+
+public:
+
+    NamedHashable(const std::string& name)
+    : HashableObject()
+    , _name(name)
+    , _dependencies()
+    {
+    }
+
+    void addDependency(const boost::shared_ptr<NamedHashable>& dep)
+    {
+        _dependencies.push_back(dep);
+    }
+
+    virtual std::string getHashProfilerName() const OVERRIDE FINAL
+    {
+        return _name;
+    }
+
+private:
+
+    virtual void appendToHash(const ComputeHashArgs& args,
+                              Hash64* hash) OVERRIDE FINAL
+    {
+        for (std::size_t i = 0; i < _dependencies.size(); ++i) {
+            hash->append( _dependencies[i]->computeHash(args) );
+        }
+        hash->append( (U64)_name.size() );
+    }
+};
+
+typedef boost::shared_ptr<NamedHashable> NamedHashablePtr;
+
+}
+
+TEST(HashProfiler,
+     ComputationsAndInvalidations)
+{
+    HashProfiler::reset();
+    HashProfiler::setEnabled(true);
+
+    // input -> middle -> output: invalidating the input invalidates the 3 objects
+    NamedHashablePtr input = boost::make_shared<NamedHashable>("input");
+    NamedHashablePtr middle = boost::make_shared<NamedHashable>("middle");
+    NamedHashablePtr output = boost::make_shared<NamedHashable>("output");
+    middle->addDependency(input);
+    output->addDependency(middle);
+    input->addHashListener(middle);
+    middle->addHashListener(output);
+
+    HashableObject::ComputeHashArgs args;
+    U64 hash = output->computeHash(args);
+    // All the hashes are cached now
+    EXPECT_EQ( hash, output->computeHash(args) );
+
+    HashableObject::FindHashArgs findArgs;
+    findArgs.time = args.time;
+    findArgs.view = args.view;
+    findArgs.hashType = args.hashType;
+    U64 found = 0;
+    EXPECT_TRUE( middle->findCachedHash(findArgs, &found) );
+
+    input->invalidateHashCache();
+    output->invalidateHashCache();
+    EXPECT_FALSE( middle->findCachedHash(findArgs, &found) );
+
+    HashProfiler::setEnabled(false);
+
+    // Nothing is recorded while disabled
+    output->computeHash(args);
+    input->invalidateHashCache();
+
+    HashProfiler::Stats stats;
+    HashProfiler::getStats(&stats);
+    // 3 computations nested in a single top-level one, then a cache hit
+    EXPECT_EQ(4U, stats.nComputeCalls);
+    EXPECT_EQ(1U, stats.nComputeCacheHits);
+    EXPECT_EQ(1U, stats.nTopLevelComputations);
+    EXPECT_EQ(2U, stats.nFindCalls);
+    EXPECT_EQ(1U, stats.nFindHits);
+    EXPECT_EQ(2U, stats.nInvalidations);
+    EXPECT_EQ(4U, stats.totalFanOut);
+    EXPECT_EQ(3U, stats.maxFanOut);
+
+    // The largest cascade comes first
+    std::vector<HashProfiler::OriginStats> origins;
+    HashProfiler::getOrigins(&origins);
+    ASSERT_EQ(2U, origins.size());
+    EXPECT_EQ(std::string("input"), origins[0].name);
+    EXPECT_EQ(3U, origins[0].totalFanOut);
+    EXPECT_EQ(std::string("output"), origins[1].name);
+    EXPECT_EQ(1U, origins[1].totalFanOut);
+
+    std::string report = HashProfiler::getReport();
+    EXPECT_NE( std::string::npos, report.find("input") );
+
+    HashProfiler::reset();
+    HashProfiler::getStats(&stats);
+    EXPECT_EQ(0U, stats.nComputeCalls);
+    EXPECT_EQ(0U, stats.nInvalidations);
+}
@@ -0,0 +1,136 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include "Engine/ImageBufferPool.h"
+
+NATRON_NAMESPACE_USING
+
+static const std::size_t kMiB = 1024 * 1024;
+
+static void
+releaseNewBuffer(ImageBufferPool& pool, std::size_t nBytes)
+{
+    RamBuffer<char> buffer;
+    buffer.resize( ImageBufferPool::getSizeClass(nBytes) );
+    pool.releaseBuffer(&buffer);
+    EXPECT_FALSE( buffer.getData() );
+}
+
+TEST(ImageBufferPool,
+     RoundsLargeBuffersToSizeClasses)
+{
+    // Small buffers are not pooled
+    EXPECT_EQ( ImageBufferPool::getSizeClass(1000), (std::size_t)0 );
+
+    EXPECT_EQ( ImageBufferPool::getSizeClass(256 * 1024), (std::size_t)256 * 1024 );
+    EXPECT_EQ( ImageBufferPool::getSizeClass(256 * 1024 + 1), (std::size_t)(256 + 32) * 1024 );
+    EXPECT_EQ( ImageBufferPool::getSizeClass(kMiB + 1), kMiB + kMiB / 8 );
+
+    // A size class is its own class
+    const std::size_t sizes[] = {300 * 1024, 5 * kMiB + 17, 100 * kMiB - 1};
+    for (std::size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        std::size_t sizeClass = ImageBufferPool::getSizeClass(sizes[i]);
+        EXPECT_GE(sizeClass, sizes[i]);
+        EXPECT_LE(sizeClass, sizes[i] + sizes[i] / 8);
+        EXPECT_EQ(ImageBufferPool::getSizeClass(sizeClass), sizeClass);
+    }
+}
+
+TEST(ImageBufferPool,
+     RecyclesReleasedBuffers)
+{
+    ImageBufferPool pool;
+    pool.setMaximumSize(64 * kMiB);
+
+    RamBuffer<char> buffer;
+    buffer.resize( ImageBufferPool::getSizeClass(kMiB) );
+    const char* data = buffer.getData();
+    pool.releaseBuffer(&buffer);
+    EXPECT_EQ( pool.getCurrentSize(), kMiB );
+
+    RamBuffer<char> recycled;
+    EXPECT_TRUE( pool.takeBuffer(kMiB - 10, &recycled) );
+    EXPECT_EQ( recycled.getData(), data );
+    EXPECT_EQ( pool.getCurrentSize(), (std::size_t)0 );
+
+    RamBuffer<char> other;
+    EXPECT_FALSE( pool.takeBuffer(kMiB, &other) );
+
+    U64 nHits, nMisses;
+    pool.getStats(&nHits, &nMisses);
+    EXPECT_EQ( nHits, (U64)1 );
+    EXPECT_EQ( nMisses, (U64)1 );
+}
+
+TEST(ImageBufferPool,
+     DisabledPoolKeepsNothing)
+{
+    ImageBufferPool pool;
+    pool.setMaximumSize(0);
+    releaseNewBuffer(pool, kMiB);
+    EXPECT_EQ( pool.getCurrentSize(), (std::size_t)0 );
+
+    RamBuffer<char> buffer;
+    EXPECT_FALSE( pool.takeBuffer(kMiB, &buffer) );
+}
+
+TEST(ImageBufferPool,
+     TrimsIdleBuffers)
+{
+    ImageBufferPool pool;
+    pool.setMaximumSize(64 * kMiB);
+    for (int i = 0; i < 4; ++i) {
+        releaseNewBuffer(pool, kMiB);
+    }
+    EXPECT_EQ( pool.getCurrentSize(), 4 * kMiB );
+
+    pool.trim(kMiB);
+    EXPECT_EQ( pool.getCurrentSize(), 3 * kMiB );
+
+    // Shrinking the pool trims the shared buffers
+    pool.setMaximumSize(kMiB / 2);
+    EXPECT_LE( pool.getCurrentSize(), 2 * kMiB );
+
+    pool.clear();
+    EXPECT_EQ( pool.getCurrentSize(), (std::size_t)0 );
+}
+
+TEST(ImageBufferPool,
+     FreesBuffersWhenFull)
+{
+    ImageBufferPool pool;
+    pool.setMaximumSize(kMiB);
+    for (int i = 0; i < 10; ++i) {
+        releaseNewBuffer(pool, kMiB);
+    }
+
+    // The caller thread keeps a few buffers, the shared pool holds at most its maximum size
+    EXPECT_LE( pool.getCurrentSize(), 3 * kMiB );
+    EXPECT_GE( pool.getCurrentSize(), kMiB );
+}
@@ -0,0 +1,95 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/ImagePlaneDesc.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(ImagePlaneDesc, Interning) {
+    std::vector<std::string> channels;
+    channels.push_back("X");
+    channels.push_back("Y");
+    channels.push_back("Z");
+
+    ImagePlaneDesc a("P", "", "", channels);
+    ImagePlaneDesc b("P", "P", "XYZ", channels);
+    ImagePlaneDesc c("P", "Position", "", channels);
+
+    // The empty labels default to the ID and to the concatenated channels
+    EXPECT_EQ( std::string("P"), a.getPlaneLabel() );
+    EXPECT_EQ( std::string("XYZ"), a.getChannelsLabel() );
+    EXPECT_EQ( 3, a.getNumComponents() );
+
+    // The same description is shared
+    EXPECT_EQ( &a.getPlaneID(), &b.getPlaneID() );
+    EXPECT_TRUE(a == b);
+
+    // Only the ID and the number of channels matter for the comparisons
+    EXPECT_EQ( std::string("Position"), c.getPlaneLabel() );
+    EXPECT_TRUE(a == c);
+    EXPECT_FALSE(a < c);
+    EXPECT_FALSE(c < a);
+
+    channels.pop_back();
+    ImagePlaneDesc d("P", "", "", channels);
+    EXPECT_TRUE(a != d);
+    EXPECT_FALSE(a < d);
+    EXPECT_FALSE(d < a);
+
+    ImagePlaneDesc e("Q", "", "", channels);
+    EXPECT_TRUE(d != e);
+    EXPECT_TRUE(d < e);
+    EXPECT_FALSE(e < d);
+
+    ImagePlaneDesc copy(c);
+    EXPECT_TRUE(copy == c);
+    EXPECT_EQ( std::string("Position"), copy.getPlaneLabel() );
+    copy = e;
+    EXPECT_EQ( std::string("Q"), copy.getPlaneID() );
+}
+
+TEST(ImagePlaneDesc, Presets) {
+    EXPECT_EQ( 0, ImagePlaneDesc().getNumComponents() );
+    EXPECT_TRUE( ImagePlaneDesc() == ImagePlaneDesc::getNoneComponents() );
+    EXPECT_EQ( std::string("none"), ImagePlaneDesc().getChannelsLabel() );
+
+    EXPECT_TRUE( ImagePlaneDesc::getRGBAComponents().isColorPlane() );
+    EXPECT_TRUE( ImagePlaneDesc::getAlphaComponents().isColorPlane() );
+    EXPECT_FALSE( ImagePlaneDesc::getBackwardMotionComponents().isColorPlane() );
+    EXPECT_TRUE( ImagePlaneDesc::getRGBAComponents() != ImagePlaneDesc::getRGBComponents() );
+    EXPECT_TRUE( ImagePlaneDesc::getDisparityLeftComponents() != ImagePlaneDesc::getDisparityRightComponents() );
+
+    const char* rgba[4] = {"R", "G", "B", "A"};
+    ImagePlaneDesc color(kNatronColorPlaneID, kNatronColorPlaneLabel, "", rgba, 4);
+    EXPECT_TRUE( color == ImagePlaneDesc::getRGBAComponents() );
+    EXPECT_TRUE( ImagePlaneDesc::mapNCompsToColorPlane(4) == color );
+}
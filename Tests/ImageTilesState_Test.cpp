@@ -0,0 +1,211 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Engine/ImageTilesState.h"
+
+NATRON_NAMESPACE_USING
+
+static const int kTileSize = 16;
+
+// Randomly marks tiles as rendered or pending. Large images are used so that rows and columns span several 64-bit words
+static void
+fillRandomStatus(TileStateHeader* stateMap, int renderedPercent)
+{
+    for (std::size_t i = 0; i < stateMap->state->tiles.size(); ++i) {
+        int r = std::rand() % 100;
+        if (r < renderedPercent) {
+            stateMap->state->tiles[i].status = (r % 5 == 0) ? eTileStatusPending : eTileStatusRenderedHighestQuality;
+        } else {
+            stateMap->state->tiles[i].status = eTileStatusNotRendered;
+        }
+    }
+}
+
+// Marks the tiles intersecting rect as rendered
+static void
+setRendered(TileStateHeader* stateMap, const RectI& rect)
+{
+    for (std::size_t i = 0; i < stateMap->state->tiles.size(); ++i) {
+        TileState& tile = stateMap->state->tiles[i];
+        if ( tile.bounds.intersects(rect) ) {
+            tile.status = eTileStatusRenderedHighestQuality;
+        }
+    }
+}
+
+// The bounding box of the unrendered tiles, computed tile by tile
+static RectI
+getReferenceBbox(const RectI& roi, const TileStateHeader& stateMap)
+{
+    RectI ret;
+    bool found = false;
+    for (std::size_t i = 0; i < stateMap.state->tiles.size(); ++i) {
+        const TileState& tile = stateMap.state->tiles[i];
+        if ( (tile.status != eTileStatusNotRendered) || !tile.bounds.intersects(roi) ) {
+            continue;
+        }
+        if (!found) {
+            ret = tile.bounds;
+            found = true;
+        } else {
+            ret.merge(tile.bounds);
+        }
+    }
+    return ret;
+}
+
+static RectI
+makeRoi(const TileStateHeader& stateMap)
+{
+    const RectI& rounded = stateMap.state->boundsRoundedToTileSize;
+    int nCols = rounded.width() / kTileSize;
+    int nRows = rounded.height() / kTileSize;
+    int c1 = std::rand() % nCols;
+    int r1 = std::rand() % nRows;
+    RectI roi;
+    roi.x1 = rounded.x1 + c1 * kTileSize;
+    roi.y1 = rounded.y1 + r1 * kTileSize;
+    roi.x2 = rounded.x1 + (c1 + 1 + std::rand() % (nCols - c1) ) * kTileSize;
+    roi.y2 = rounded.y1 + (r1 + 1 + std::rand() % (nRows - r1) ) * kTileSize;
+
+    // The roi is clipped to the bounds of the image
+    RectI ret;
+    roi.intersect(stateMap.state->bounds, &ret);
+    return ret;
+}
+
+TEST(ImageTilesState,
+     MinimalBboxMatchesTileByTileSearch)
+{
+    std::srand(2018);
+    TileStateHeader stateMap;
+    stateMap.init( kTileSize, kTileSize, RectI(-37, 5, 2000, 1203) );
+
+    for (int i = 0; i < 200; ++i) {
+        fillRandomStatus( &stateMap, 80 + (i % 20) );
+        RectI roi = makeRoi(stateMap);
+        RectI bbox = ImageTilesState::getMinimalBboxToRenderFromTilesState(roi, stateMap);
+        RectI reference = getReferenceBbox(roi, stateMap);
+        EXPECT_EQ( bbox.isNull(), reference.isNull() );
+        if ( !reference.isNull() ) {
+            EXPECT_EQ(bbox, reference);
+        }
+    }
+
+    // Everything rendered
+    setRendered(&stateMap, stateMap.state->bounds);
+    EXPECT_TRUE( ImageTilesState::getMinimalBboxToRenderFromTilesState(stateMap.state->bounds, stateMap).isNull() );
+}
+
+TEST(ImageTilesState,
+     MinimalRectsCoverUnrenderedTiles)
+{
+    std::srand(2020);
+    TileStateHeader stateMap;
+    stateMap.init( kTileSize, kTileSize, RectI(3, -100, 1500, 1100) );
+
+    for (int i = 0; i < 200; ++i) {
+        fillRandomStatus( &stateMap, 90 + (i % 10) );
+        RectI roi = makeRoi(stateMap);
+        RectIVec rects;
+        ImageTilesState::getMinimalRectsToRenderFromTilesState(roi, stateMap, &rects);
+
+        RectI bbox = getReferenceBbox(roi, stateMap);
+        for (RectIVec::const_iterator it = rects.begin(); it != rects.end(); ++it) {
+            EXPECT_FALSE( it->isNull() );
+            EXPECT_TRUE( bbox.contains(*it) );
+            for (RectIVec::const_iterator it2 = rects.begin(); it2 != it; ++it2) {
+                EXPECT_FALSE( it->intersects(*it2) );
+            }
+        }
+
+        // Each unrendered tile of the roi is in one of the rectangles
+        for (std::size_t t = 0; t < stateMap.state->tiles.size(); ++t) {
+            const TileState& tile = stateMap.state->tiles[t];
+            if ( (tile.status != eTileStatusNotRendered) || !tile.bounds.intersects(roi) ) {
+                continue;
+            }
+            bool covered = false;
+            for (RectIVec::const_iterator it = rects.begin(); it != rects.end(); ++it) {
+                if ( it->contains(tile.bounds) ) {
+                    covered = true;
+                    break;
+                }
+            }
+            EXPECT_TRUE(covered);
+        }
+    }
+}
+
+TEST(ImageTilesState,
+     MinimalRectsFindsBordersAroundRenderedArea)
+{
+    // When zooming out, the rendered area is surrounded by the 4 rectangles to render
+    TileStateHeader stateMap;
+    const RectI bounds(0, 0, 100 * kTileSize, 80 * kTileSize);
+    stateMap.init(kTileSize, kTileSize, bounds);
+    const RectI rendered(10 * kTileSize, 20 * kTileSize, 70 * kTileSize, 60 * kTileSize);
+    setRendered(&stateMap, rendered);
+
+    RectIVec rects;
+    ImageTilesState::getMinimalRectsToRenderFromTilesState(bounds, stateMap, &rects);
+    ASSERT_EQ( rects.size(), (std::size_t)4 );
+
+    RectIVec::const_iterator it = rects.begin();
+    EXPECT_EQ( *it, RectI(0, 0, bounds.x2, rendered.y1) );
+    ++it;
+    EXPECT_EQ( *it, RectI(0, rendered.y2, bounds.x2, bounds.y2) );
+    ++it;
+    EXPECT_EQ( *it, RectI(0, rendered.y1, rendered.x1, rendered.y2) );
+    ++it;
+    EXPECT_EQ( *it, RectI(rendered.x2, rendered.y1, bounds.x2, rendered.y2) );
+}
+
+#ifdef NATRON_HAS_SMALL_VECTOR
+TEST(ImageTilesState,
+     MinimalRectsDoNotAllocate)
+{
+    // The rectangles to render are computed for each render of each node: they must be stored inline
+    TileStateHeader stateMap;
+    const RectI bounds(0, 0, 100 * kTileSize, 80 * kTileSize);
+    stateMap.init(kTileSize, kTileSize, bounds);
+    setRendered( &stateMap, RectI(10 * kTileSize, 20 * kTileSize, 70 * kTileSize, 60 * kTileSize) );
+
+    RectIVec rects;
+    const char* inlineStorageBegin = (const char*)&rects;
+    const char* inlineStorageEnd = (const char*)(&rects + 1);
+    ImageTilesState::getMinimalRectsToRenderFromTilesState(bounds, stateMap, &rects);
+    ASSERT_FALSE( rects.empty() );
+    const char* data = (const char*)&rects[0];
+    EXPECT_TRUE(data >= inlineStorageBegin && data < inlineStorageEnd);
+}
+#endif
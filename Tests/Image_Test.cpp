@@ -31,6 +31,7 @@
 #include "Engine/Image.h"
 #include "Engine/ImageCacheKey.h"
 #include "Engine/ImageCacheEntryProcessing.h"
+#include "Engine/ImagePrivate.h"
 #include "Engine/CacheEntryKeyBase.h"
 #include "Engine/ViewIdx.h"
 
@@ -312,3 +313,202 @@ TEST(ImageCacheEntryProcessing, RepeatEdgesGeneralCase) {
 #undef getBufAt
 
 
+
+// Transfer each channel of a packed image to a planar tile and back, as done by the ImageCacheEntry
+TEST(ImageCacheEntryProcessing, CopyPixelsStrides) {
+    RectI bounds(0, 0, 37, 9);
+    for (int nComps = 1; nComps <= 4; ++nComps) {
+        std::vector<float> packed(bounds.area() * nComps);
+        for (std::size_t i = 0; i < packed.size(); ++i) {
+            packed[i] = (float)i;
+        }
+        std::vector<float> copy(packed.size(), -1.f);
+        for (int c = 0; c < nComps; ++c) {
+            std::vector<float> tile(bounds.area(), -1.f);
+            ImageCacheEntryProcessing::copyPixelsForDepth<float>(bounds, &packed[c], nComps, bounds.width() * nComps, &tile[0], 1, bounds.width());
+            for (int i = 0; i < (int)bounds.area(); ++i) {
+                ASSERT_EQ(packed[i * nComps + c], tile[i]);
+            }
+            ImageCacheEntryProcessing::copyPixelsForDepth<float>(bounds, &tile[0], 1, bounds.width(), &copy[c], nComps, bounds.width() * nComps);
+        }
+        ASSERT_TRUE(copy == packed);
+    }
+}
+
+// The scan-line conversions must give the same result as the conversions of a single value
+TEST(Image, ConvertPixelDepthRow) {
+    std::vector<unsigned char> bytes(256 + 7);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = (unsigned char)i;
+    }
+    std::vector<unsigned short> shorts(65536 + 7);
+    for (std::size_t i = 0; i < shorts.size(); ++i) {
+        shorts[i] = (unsigned short)i;
+    }
+    std::vector<float> floats(2 * 65536 + 7);
+    for (std::size_t i = 0; i < floats.size(); ++i) {
+        floats[i] = i * (1.3f / 65536) - 0.15f;
+    }
+
+    std::vector<float> bytesToFloats(bytes.size());
+    Image::convertPixelDepthRow<unsigned char, float>(&bytes[0], 1, &bytesToFloats[0], 1, bytes.size());
+    std::vector<unsigned short> bytesToShorts(bytes.size());
+    Image::convertPixelDepthRow<unsigned char, unsigned short>(&bytes[0], 1, &bytesToShorts[0], 1, bytes.size());
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        ASSERT_EQ( (Image::convertPixelDepth<unsigned char, float>(bytes[i])), bytesToFloats[i] );
+        ASSERT_EQ( (Image::convertPixelDepth<unsigned char, unsigned short>(bytes[i])), bytesToShorts[i] );
+    }
+
+    std::vector<float> shortsToFloats(shorts.size());
+    Image::convertPixelDepthRow<unsigned short, float>(&shorts[0], 1, &shortsToFloats[0], 1, shorts.size());
+    std::vector<unsigned char> shortsToBytes(shorts.size());
+    Image::convertPixelDepthRow<unsigned short, unsigned char>(&shorts[0], 1, &shortsToBytes[0], 1, shorts.size());
+    for (std::size_t i = 0; i < shorts.size(); ++i) {
+        ASSERT_EQ( (Image::convertPixelDepth<unsigned short, float>(shorts[i])), shortsToFloats[i] );
+        ASSERT_EQ( (Image::convertPixelDepth<unsigned short, unsigned char>(shorts[i])), shortsToBytes[i] );
+    }
+
+    std::vector<unsigned char> floatsToBytes(floats.size());
+    Image::convertPixelDepthRow<float, unsigned char>(&floats[0], 1, &floatsToBytes[0], 1, floats.size());
+    std::vector<unsigned short> floatsToShorts(floats.size());
+    Image::convertPixelDepthRow<float, unsigned short>(&floats[0], 1, &floatsToShorts[0], 1, floats.size());
+    // Strided conversion, as from a packed image to a planar one
+    std::vector<unsigned short> floatsToShortsStrided(floats.size() / 3);
+    Image::convertPixelDepthRow<float, unsigned short>(&floats[1], 3, &floatsToShortsStrided[0], 1, floatsToShortsStrided.size());
+    for (std::size_t i = 0; i < floats.size(); ++i) {
+        ASSERT_EQ( (Image::convertPixelDepth<float, unsigned char>(floats[i])), floatsToBytes[i] );
+        ASSERT_EQ( (Image::convertPixelDepth<float, unsigned short>(floats[i])), floatsToShorts[i] );
+    }
+    for (std::size_t i = 0; i < floatsToShortsStrided.size(); ++i) {
+        ASSERT_EQ( (Image::convertPixelDepth<float, unsigned short>(floats[i * 3 + 1])), floatsToShortsStrided[i] );
+    }
+}
+
+template <typename PIX>
+static void
+checkDownscaleMipMapTile(PIX maxValue)
+{
+    // The half tile width is odd so that the vectorized loops leave a remainder to the scalar loop
+    const int tileSizeX = 70;
+    const int tileSizeY = 8;
+    std::vector<PIX> tiles[4];
+    const PIX* srcTilesPtr[4];
+    unsigned int seed = 1;
+    for (int t = 0; t < 4; ++t) {
+        tiles[t].resize(tileSizeX * tileSizeY);
+        for (std::size_t i = 0; i < tiles[t].size(); ++i) {
+            seed = seed * 1103515245 + 12345;
+            tiles[t][i] = (PIX)( ( (seed >> 8) % 65536 ) * (double)maxValue / 65535 );
+        }
+        srcTilesPtr[t] = &tiles[t][0];
+    }
+    std::vector<PIX> dstTile(tileSizeX * tileSizeY);
+    RectI dstTileBounds(0, 0, tileSizeX, tileSizeY);
+    ImageCacheEntryProcessing::downscaleMipMapForDepth<PIX>(srcTilesPtr, &dstTile[0], dstTileBounds, tileSizeX, tileSizeY);
+
+    for (int y = 0; y < tileSizeY; ++y) {
+        for (int x = 0; x < tileSizeX; ++x) {
+            const int t = (y / (tileSizeY / 2)) * 2 + x / (tileSizeX / 2);
+            const int sx = (x % (tileSizeX / 2)) * 2;
+            const int sy = (y % (tileSizeY / 2)) * 2;
+            const PIX* src = &tiles[t][sy * tileSizeX + sx];
+            double sum = (double)src[0] + (double)src[1];
+            sum += ( (double)src[tileSizeX] + (double)src[tileSizeX + 1] );
+            sum /= 4;
+            ASSERT_EQ( (PIX)sum, dstTile[y * tileSizeX + x] );
+        }
+    }
+}
+
+// The vectorized mipmap downscale must give the same result as the scalar code
+TEST(ImageCacheEntryProcessing, DownscaleMipMap) {
+    checkDownscaleMipMapTile<unsigned char>(255);
+    checkDownscaleMipMapTile<unsigned short>(65535);
+    checkDownscaleMipMapTile<float>(1.3f);
+    checkDownscaleMipMapTile<Half>( Half(4.f) );
+}
+
+template <typename PIX>
+static void
+checkCopyUnProcessedChannelsAndMaskMix(ImageBitDepthEnum depth, bool planar)
+{
+    RectI bounds(0, 0, 37, 11), roi(2, 1, 35, 10), maskBounds(5, -2, 30, 8);
+    const std::size_t nPixels = bounds.area();
+    std::vector<PIX> src[4], dst[4], ref[4];
+    void* srcPtrs[4] = {NULL, NULL, NULL, NULL};
+    void* dstPtrs[4] = {NULL, NULL, NULL, NULL};
+    void* refPtrs[4] = {NULL, NULL, NULL, NULL};
+    unsigned int seed = 1;
+    for (int i = 0; i < (planar ? 4 : 1); ++i) {
+        src[i].resize(planar ? nPixels : nPixels * 4);
+        dst[i].resize(src[i].size());
+        for (std::size_t j = 0; j < src[i].size(); ++j) {
+            seed = seed * 1103515245 + 12345;
+            src[i][j] = (PIX)( ( (seed >> 8) % 1000 ) / 999.f * (boost::is_same<PIX, float>::value ? 1.f : 65535.f) );
+            dst[i][j] = src[i][src[i].size() - 1 - j];
+        }
+        ref[i] = dst[i];
+        srcPtrs[i] = &src[i][0];
+        dstPtrs[i] = &dst[i][0];
+        refPtrs[i] = &ref[i][0];
+    }
+    std::vector<PIX> mask(maskBounds.area());
+    for (std::size_t j = 0; j < mask.size(); ++j) {
+        mask[j] = src[0][j];
+    }
+    const void* maskPtrs[4] = {&mask[0], NULL, NULL, NULL};
+
+    // RGB were processed, copy alpha then mask and mix
+    std::bitset<4> processChannels;
+    processChannels[0] = processChannels[1] = processChannels[2] = true;
+    ImagePrivate::copyUnprocessedChannelsCPU((const void**)srcPtrs, bounds, 4, refPtrs, depth, 4, bounds, processChannels, roi, EffectInstancePtr());
+    ImagePrivate::applyMaskMixCPU((const void**)srcPtrs, bounds, 4, maskPtrs, maskBounds, refPtrs, depth, 4, 0.7f, false, bounds, roi, EffectInstancePtr());
+
+    ImagePrivate::copyUnProcessedChannelsAndMaskMixCPU((const void**)srcPtrs, bounds, 4, maskPtrs, maskBounds, dstPtrs, depth, 4, bounds, processChannels, true, true, 0.7f, false, roi, EffectInstancePtr());
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(dst[i] == ref[i]);
+    }
+}
+
+// The fused kernel must give the same result as copyUnProcessedChannels followed by applyMaskMix
+TEST(Image, CopyUnProcessedChannelsAndMaskMix) {
+    checkCopyUnProcessedChannelsAndMaskMix<float>(eImageBitDepthFloat, false);
+    checkCopyUnProcessedChannelsAndMaskMix<float>(eImageBitDepthFloat, true);
+    checkCopyUnProcessedChannelsAndMaskMix<unsigned short>(eImageBitDepthShort, false);
+    checkCopyUnProcessedChannelsAndMaskMix<unsigned short>(eImageBitDepthShort, true);
+}
+
+TEST(Image, CopyUnProcessedChannelsPlan) {
+    typedef ImagePrivate::CopyUnProcessedChannelsPlan Plan;
+    Plan plan;
+
+    // Only alpha was processed: copy RGB
+    std::bitset<4> processChannels;
+    processChannels[3] = true;
+    ImagePrivate::makeCopyUnProcessedChannelsPlan(4, true, 4, processChannels, &plan);
+    for (int k = 0; k < 3; ++k) {
+        EXPECT_EQ(Plan::eChannelOpCopy, plan.ops[k]);
+        EXPECT_EQ(k, plan.srcChannels[k]);
+    }
+    EXPECT_EQ(Plan::eChannelOpKeep, plan.ops[3]);
+
+    // RGB were processed from a RGB image: alpha is opaque
+    processChannels.reset();
+    processChannels[0] = processChannels[1] = processChannels[2] = true;
+    ImagePrivate::makeCopyUnProcessedChannelsPlan(3, true, 4, processChannels, &plan);
+    EXPECT_EQ(Plan::eChannelOpKeep, plan.ops[0]);
+    EXPECT_EQ(Plan::eChannelOpOne, plan.ops[3]);
+
+    // Alpha output from an alpha image: the alpha is the first channel
+    processChannels.reset();
+    ImagePrivate::makeCopyUnProcessedChannelsPlan(1, true, 1, processChannels, &plan);
+    EXPECT_EQ(Plan::eChannelOpCopy, plan.ops[0]);
+    EXPECT_EQ(0, plan.srcChannels[0]);
+
+    // Without original image, the unprocessed channels are black and transparent
+    processChannels[0] = true;
+    ImagePrivate::makeCopyUnProcessedChannelsPlan(0, false, 4, processChannels, &plan);
+    EXPECT_EQ(Plan::eChannelOpKeep, plan.ops[0]);
+    EXPECT_EQ(Plan::eChannelOpZero, plan.ops[1]);
+    EXPECT_EQ(Plan::eChannelOpZero, plan.ops[3]);
+}
@@ -0,0 +1,109 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "Engine/InteractiveLatency.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(InteractiveLatency,
+     EditToDisplay)
+{
+    InteractiveLatency::reset();
+    InteractiveLatency::setEnabled(true);
+
+    int scheduler = 0;
+    int otherScheduler = 0;
+
+    // An edit displayed through all the stages
+    InteractiveLatency::onKnobChanged();
+    InteractiveLatency::onHashInvalidated();
+    InteractiveLatency::onRenderRequested(&scheduler, 1);
+    InteractiveLatency::onRenderStageReached(&scheduler, 1, eInteractiveLatencyStageRenderStarted);
+    InteractiveLatency::onRenderStageReached(&scheduler, 1, eInteractiveLatencyStageRenderFinished);
+    InteractiveLatency::onFrameUploaded(&scheduler, 1);
+    InteractiveLatency::onFrameDisplayed();
+
+    // An edit whose render is aborted is never displayed
+    InteractiveLatency::onKnobChanged();
+    InteractiveLatency::onRenderRequested(&scheduler, 2);
+    InteractiveLatency::onRenderDropped(&scheduler, 2);
+
+    // An edit superseded by a more recent render of the same viewer is dropped when the latter is uploaded
+    InteractiveLatency::onKnobChanged();
+    InteractiveLatency::onRenderRequested(&scheduler, 3);
+    InteractiveLatency::onKnobChanged();
+    InteractiveLatency::onRenderRequested(&scheduler, 4);
+    InteractiveLatency::onFrameUploaded(&scheduler, 4);
+
+    // The renders of another viewer are not affected
+    InteractiveLatency::onKnobChanged();
+    InteractiveLatency::onRenderRequested(&otherScheduler, 3);
+    InteractiveLatency::onFrameUploaded(&otherScheduler, 3);
+    InteractiveLatency::onFrameDisplayed();
+
+    // A render without an edit is not measured
+    InteractiveLatency::onRenderRequested(&scheduler, 5);
+    InteractiveLatency::onFrameUploaded(&scheduler, 5);
+    InteractiveLatency::onFrameDisplayed();
+
+    InteractiveLatency::setEnabled(false);
+
+    // Nothing is recorded while disabled
+    InteractiveLatency::onKnobChanged();
+    InteractiveLatency::onRenderRequested(&scheduler, 6);
+    InteractiveLatency::onFrameUploaded(&scheduler, 6);
+    InteractiveLatency::onFrameDisplayed();
+
+    std::vector<InteractiveLatency::StageStats> stats;
+    InteractiveLatency::getStats(&stats);
+    ASSERT_EQ( (std::size_t)eInteractiveLatencyStageCount, stats.size() );
+    EXPECT_EQ( (U64)3, stats[eInteractiveLatencyStageDisplayed].nSamples );
+    EXPECT_EQ( (U64)3, stats[eInteractiveLatencyStageTextureUploaded].nSamples );
+    EXPECT_EQ( (U64)1, stats[eInteractiveLatencyStageHashInvalidated].nSamples );
+    EXPECT_EQ( (U64)1, stats[eInteractiveLatencyStageRenderStarted].nSamples );
+
+    // The latencies grow along the stages
+    EXPECT_LE(stats[eInteractiveLatencyStageRenderRequested].max, stats[eInteractiveLatencyStageDisplayed].max);
+    EXPECT_LE(stats[eInteractiveLatencyStageDisplayed].median, stats[eInteractiveLatencyStageDisplayed].p95);
+
+    std::vector<double> upperBounds(1, 1000.);
+    std::vector<U64> counts;
+    InteractiveLatency::getHistogram(upperBounds, &counts);
+    ASSERT_EQ( (std::size_t)2, counts.size() );
+    EXPECT_EQ( (U64)3, counts[0] );
+    EXPECT_EQ( (U64)0, counts[1] );
+
+    EXPECT_FALSE( InteractiveLatency::getReport().empty() );
+
+    InteractiveLatency::reset();
+    InteractiveLatency::getStats(&stats);
+    EXPECT_EQ( (U64)0, stats[eInteractiveLatencyStageDisplayed].nSamples );
+}
@@ -0,0 +1,72 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Engine/Knob.h"
+
+NATRON_NAMESPACE_USING
+
+static std::string
+lower(const std::string& expr)
+{
+    std::string ret;
+    if ( !KnobHelper::lowerPythonExpressionToExprTk(expr, &ret) ) {
+        return "<not lowered>";
+    }
+    return ret;
+}
+
+TEST(KnobExpression,
+     LowersSimplePythonExpressions)
+{
+    EXPECT_EQ( lower("thisNode.other.get() * 2 + frame"), "thisNode.other * 2 + frame" );
+    EXPECT_EQ( lower("thisNode.size.get()[1]"), "thisNode.size.1" );
+    EXPECT_EQ( lower("thisNode.size.get().y"), "thisNode.size.y" );
+    EXPECT_EQ( lower("Blur1.size.getValue(1)"), "Blur1.size.1" );
+    EXPECT_EQ( lower("thisNode.size.getValue()"), "thisNode.size.0" );
+    EXPECT_EQ( lower("thisNode.size.getValueAtTime(frame - 1, 1)"), "thisNode.size.1(frame - 1)" );
+    EXPECT_EQ( lower("thisParam.get(frame + 1)"), "thisKnob(frame + 1)" );
+    EXPECT_EQ( lower("max(1, math.sqrt(frame))"), "max(1, sqrt(frame))" );
+    EXPECT_EQ( lower("math.fabs(-2.5e-1)"), "abs(-2.5e-1)" );
+}
+
+TEST(KnobExpression,
+     DoesNotLowerOtherPythonExpressions)
+{
+    EXPECT_EQ( lower("2 ** 3"), "<not lowered>" );
+    EXPECT_EQ( lower("frame // 2"), "<not lowered>" );
+    EXPECT_EQ( lower("1 if frame > 1 else 2"), "<not lowered>" );
+    EXPECT_EQ( lower("app.Blur1.size.get()"), "<not lowered>" );
+    EXPECT_EQ( lower("thisNode.size.get()[frame]"), "<not lowered>" );
+    EXPECT_EQ( lower("0x10"), "<not lowered>" );
+    EXPECT_EQ( lower("\"text\""), "<not lowered>" );
+    EXPECT_EQ( lower("ret = 1\nret += 1"), "<not lowered>" );
+    EXPECT_EQ( lower(""), "<not lowered>" );
+}
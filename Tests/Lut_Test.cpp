@@ -26,8 +26,17 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
 #include <gtest/gtest.h>
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include "Engine/Half.h"
 #include "Engine/Lut.h"
+#include "Engine/RectI.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 using namespace NATRON_NAMESPACE::Color;
@@ -52,3 +61,117 @@ TEST(Lut, IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+static const char*
+getInstructionSetName(LutInstructionSetEnum instructionSet)
+{
+    switch (instructionSet) {
+    case eLutInstructionSetScalar:
+        return "scalar";
+    case eLutInstructionSetSSE2:
+        return "SSE2";
+    case eLutInstructionSetAVX2:
+        return "AVX2";
+    case eLutInstructionSetNEON:
+        return "NEON";
+    }
+
+    return "";
+}
+
+// All instruction sets must give exactly the same result as the scalar version, including for values outside of [0, 1]
+TEST(Lut, PackedConversionsInstructionSets) {
+    const Lut* lut = LutManager::sRGBLut();
+    const LutInstructionSetEnum defaultInstructionSet = getInstructionSet();
+
+    // An odd width so that the kernels also process the remaining pixels of the scan-lines
+    RectI bounds(0, 0, 517, 13);
+    RectI rect(3, 1, 515, 12);
+    const int nPixels = bounds.width() * bounds.height();
+
+    std::vector<float> floatPixels(nPixels * 4);
+    std::vector<unsigned char> bytePixels(nPixels * 4);
+    srand(2018);
+    for (std::size_t i = 0; i < floatPixels.size(); ++i) {
+        floatPixels[i] = (rand() / (float)RAND_MAX) * 1.4f - 0.2f;
+        bytePixels[i] = (unsigned char)(rand() % 256);
+    }
+    floatPixels[4] = std::numeric_limits<float>::infinity();
+    floatPixels[9] = std::numeric_limits<float>::quiet_NaN();
+    floatPixels[14] = std::numeric_limits<float>::denorm_min();
+    for (std::size_t i = 3; i < bytePixels.size(); i += 36) {
+        bytePixels[i] = 0;
+    }
+
+    const PixelPackingEnum packings[4] = { ePixelPackingRGBA, ePixelPackingBGRA, ePixelPackingRGB, ePixelPackingBGR };
+    for (int p = 0; p < 4; ++p) {
+        for (int premult = 0; premult < 2; ++premult) {
+            std::vector<unsigned char> refBytes(nPixels * 4), bytes(nPixels * 4);
+            std::vector<float> refFloats(nPixels * 4), floats(nPixels * 4);
+
+            ASSERT_TRUE( setInstructionSet(eLutInstructionSetScalar) );
+            srand(p);
+            lut->to_byte_packed(&refBytes[0], &floatPixels[0], rect, bounds, bounds, packings[p], ePixelPackingRGBA, true, premult);
+            lut->from_byte_packed(&refFloats[0], &bytePixels[0], rect, bounds, bounds, packings[p], ePixelPackingRGBA, true, premult);
+
+            for (int i = eLutInstructionSetSSE2; i <= eLutInstructionSetNEON; ++i) {
+                if ( !setInstructionSet( (LutInstructionSetEnum)i ) ) {
+                    continue;
+                }
+                // The error diffusion starts at a random pixel on each scan-line
+                srand(p);
+                lut->to_byte_packed(&bytes[0], &floatPixels[0], rect, bounds, bounds, packings[p], ePixelPackingRGBA, true, premult);
+                lut->from_byte_packed(&floats[0], &bytePixels[0], rect, bounds, bounds, packings[p], ePixelPackingRGBA, true, premult);
+                EXPECT_EQ( 0, std::memcmp( &refBytes[0], &bytes[0], bytes.size() ) ) << getInstructionSetName( (LutInstructionSetEnum)i );
+                EXPECT_EQ( 0, std::memcmp( &refFloats[0], &floats[0], floats.size() * sizeof(float) ) ) << getInstructionSetName( (LutInstructionSetEnum)i );
+            }
+        }
+    }
+    setInstructionSet(defaultInstructionSet);
+}
+
+// Not a test, but prints the time taken by the conversions of a 4K frame with each instruction set
+TEST(Lut, PackedConversionsBenchmark) {
+    const Lut* lut = LutManager::sRGBLut();
+    const LutInstructionSetEnum defaultInstructionSet = getInstructionSet();
+
+    RectI bounds(0, 0, 3840, 2160);
+    const int nPixels = bounds.width() * bounds.height();
+    std::vector<float> floatPixels(nPixels * 4);
+    std::vector<unsigned char> bytePixels(nPixels * 4);
+    for (std::size_t i = 0; i < floatPixels.size(); ++i) {
+        floatPixels[i] = rand() / (float)RAND_MAX;
+        bytePixels[i] = (unsigned char)(rand() % 256);
+    }
+
+    for (int i = eLutInstructionSetScalar; i <= eLutInstructionSetNEON; ++i) {
+        if ( !setInstructionSet( (LutInstructionSetEnum)i ) ) {
+            continue;
+        }
+        TimeLapse timer;
+        lut->to_byte_packed(&bytePixels[0], &floatPixels[0], bounds, bounds, bounds, ePixelPackingRGBA, ePixelPackingBGRA, true, true);
+        double toByteTime = timer.getTimeElapsedReset();
+        lut->from_byte_packed(&floatPixels[0], &bytePixels[0], bounds, bounds, bounds, ePixelPackingBGRA, ePixelPackingRGBA, true, true);
+        double fromByteTime = timer.getTimeElapsedReset();
+        printf("Lut 4K premultiplied RGBA conversions (%s): to_byte_packed %.1f ms, from_byte_packed %.1f ms\n",
+               getInstructionSetName( (LutInstructionSetEnum)i ), toByteTime * 1000., fromByteTime * 1000.);
+    }
+    setInstructionSet(defaultInstructionSet);
+}
+
+// The half tables have an entry for each half value: they must give exactly the transfer functions
+TEST(Lut, HalfTables) {
+    const Lut* lut = LutManager::sRGBLut();
+    lut->validate();
+
+    for (int i = 0; i < 0x10000; ++i) {
+        const Half h = Half::fromBits( (unsigned short)i );
+        const float f = h;
+        if ( (boost::math::isnan)(f) ) {
+            EXPECT_TRUE( (boost::math::isnan)( lut->toColorSpaceFloatFromLinearHalfFast(h) ) == (boost::math::isnan)( lut->toColorSpaceFloatFromLinearFloat(f) ) );
+            continue;
+        }
+        EXPECT_EQ( lut->toColorSpaceFloatFromLinearFloat(f), lut->toColorSpaceFloatFromLinearHalfFast(h) ) << i;
+        EXPECT_EQ( lut->fromColorSpaceFloatToLinearFloat(f), lut->fromColorSpaceHalfToLinearFloatFast(h) ) << i;
+    }
+}
@@ -0,0 +1,110 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include "Engine/MemoryPressureMonitorThread.h"
+
+NATRON_NAMESPACE_USING
+
+static const std::size_t kMiB = 1024 * 1024;
+static const std::size_t kGiB = 1024 * kMiB;
+
+static MemoryPressureMonitorThread::MemoryState
+makeState(std::size_t freeRAM,
+          std::size_t cacheSize,
+          MemoryPressureMonitorThread::MemoryPressureLevelEnum level = MemoryPressureMonitorThread::eMemoryPressureLevelNormal)
+{
+    MemoryPressureMonitorThread::MemoryState state;
+    state.totalRAM = 16 * kGiB;
+    state.freeRAM = freeRAM;
+    state.processRSS = cacheSize + kGiB;
+    state.cacheSize = cacheSize;
+    state.level = level;
+    return state;
+}
+
+TEST(MemoryPressureMonitorThread,
+     KeepsUserMaximumWhenMemoryIsAvailable)
+{
+    EXPECT_EQ( MemoryPressureMonitorThread::computeCacheBudget( 8 * kGiB, 8 * kGiB, makeState(8 * kGiB, 4 * kGiB) ), 8 * kGiB );
+
+    // The budget never exceeds the user maximum
+    EXPECT_EQ( MemoryPressureMonitorThread::computeCacheBudget( 4 * kGiB, 8 * kGiB, makeState(8 * kGiB, 4 * kGiB) ), 4 * kGiB );
+}
+
+TEST(MemoryPressureMonitorThread,
+     ShrinksWhenFreeRAMIsLow)
+{
+    // A tenth of the RAM is kept free for the other processes
+    const std::size_t reserved = 16 * kGiB / 10;
+    const std::size_t freeRAM = kGiB;
+    const std::size_t cacheSize = 6 * kGiB;
+    std::size_t budget = MemoryPressureMonitorThread::computeCacheBudget( 8 * kGiB, 8 * kGiB, makeState(freeRAM, cacheSize) );
+    EXPECT_EQ( budget, cacheSize - (reserved - freeRAM) );
+
+    // The cache does not give back more than what the process keeps resident
+    MemoryPressureMonitorThread::MemoryState state = makeState(0, cacheSize);
+    state.processRSS = 512 * kMiB;
+    EXPECT_EQ( MemoryPressureMonitorThread::computeCacheBudget(8 * kGiB, 8 * kGiB, state), cacheSize - 512 * kMiB );
+}
+
+TEST(MemoryPressureMonitorThread,
+     ShrinksOnSystemPressure)
+{
+    const std::size_t cacheSize = 4 * kGiB;
+    EXPECT_EQ( MemoryPressureMonitorThread::computeCacheBudget( 8 * kGiB, 8 * kGiB, makeState(8 * kGiB, cacheSize, MemoryPressureMonitorThread::eMemoryPressureLevelWarning) ),
+               3 * kGiB );
+    EXPECT_EQ( MemoryPressureMonitorThread::computeCacheBudget( 8 * kGiB, 8 * kGiB, makeState(8 * kGiB, cacheSize, MemoryPressureMonitorThread::eMemoryPressureLevelCritical) ),
+               2 * kGiB );
+
+    // A small cache is not shrunk below the minimum budget
+    EXPECT_EQ( MemoryPressureMonitorThread::computeCacheBudget( 8 * kGiB, 8 * kGiB, makeState(0, 100 * kMiB, MemoryPressureMonitorThread::eMemoryPressureLevelCritical) ),
+               256 * kMiB );
+}
+
+TEST(MemoryPressureMonitorThread,
+     GrowsBackByStepsWhenMemoryIsFreed)
+{
+    const std::size_t userMaximum = 8 * kGiB;
+    std::size_t budget = kGiB;
+
+    // No growth while the system is under pressure
+    EXPECT_EQ( MemoryPressureMonitorThread::computeCacheBudget( userMaximum, budget, makeState(8 * kGiB, budget, MemoryPressureMonitorThread::eMemoryPressureLevelWarning) ),
+               budget - budget / 4 );
+
+    // No growth while the free RAM is close to the reserve
+    EXPECT_EQ( MemoryPressureMonitorThread::computeCacheBudget( userMaximum, budget, makeState(2 * kGiB, budget) ), budget );
+
+    std::size_t next = MemoryPressureMonitorThread::computeCacheBudget( userMaximum, budget, makeState(8 * kGiB, budget) );
+    EXPECT_EQ( next, budget + userMaximum / 8 );
+
+    for (int i = 0; i < 16; ++i) {
+        budget = MemoryPressureMonitorThread::computeCacheBudget( userMaximum, budget, makeState(8 * kGiB, budget) );
+    }
+    EXPECT_EQ( budget, userMaximum );
+}
@@ -0,0 +1,66 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "Engine/MemoryTimelineRecorder.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(MemoryTimelineRecorder,
+     Export)
+{
+    std::vector<MemoryTimelineRecorder::Sample> samples(2);
+    samples[0].tileCacheBytes = 1024;
+    samples[0].processRSS = 4096;
+    samples[1].time = 1.5;
+    samples[1].imagesGLBytes = 2048;
+    samples[1].deleterQueueLength = 3;
+
+    // A header line and one line per sample
+    std::string csv = MemoryTimelineRecorder::toCSV(samples);
+    EXPECT_EQ( 0u, csv.find("time,tile_cache_bytes,") );
+    EXPECT_NE( std::string::npos, csv.find("\n0.000,1024,0,0,0,0,0,0,4096,0\n") );
+    EXPECT_NE( std::string::npos, csv.find("\n1.500,0,0,0,0,0,2048,3,0,0\n") );
+
+    std::string json = MemoryTimelineRecorder::toJSON(samples);
+    EXPECT_EQ( 0u, json.find("{\"samples\": [") );
+    EXPECT_NE( std::string::npos, json.find("\"time\": 1.500") );
+    EXPECT_NE( std::string::npos, json.find("\"images_gl_bytes\": 2048") );
+    EXPECT_NE( std::string::npos, json.find("\"deleter_queue_length\": 3") );
+    EXPECT_NE( std::string::npos, json.find("]}") );
+}
+
+TEST(MemoryTimelineRecorder,
+     Empty)
+{
+    std::vector<MemoryTimelineRecorder::Sample> samples;
+    EXPECT_EQ( std::string("{\"samples\": [\n]}\n"), MemoryTimelineRecorder::toJSON(samples) );
+}
@@ -0,0 +1,89 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/Noise.h"
+
+NATRON_NAMESPACE_USING
+
+// Positions sampled like a noise over successive frames: consecutive positions share lattice cells
+static std::vector<double>
+makeSamplePositions(int count)
+{
+    std::vector<double> positions(count * 3);
+    for (int i = 0; i < count; ++i) {
+        positions[i * 3] = i / 10.;
+        positions[i * 3 + 1] = 0.5 - i / 37.;
+        positions[i * 3 + 2] = 3.2;
+    }
+    return positions;
+}
+
+TEST(Noise, BatchMatchesScalar)
+{
+    const int count = 200;
+    std::vector<double> positions = makeSamplePositions(count);
+
+    std::vector<double> batch(count * 3), scalar(count * 3);
+    NoiseBatch<3, 3, double>(&positions[0], &batch[0], count);
+    for (int i = 0; i < count; ++i) {
+        Noise<3, 3, double>(&positions[i * 3], &scalar[i * 3]);
+    }
+    for (int i = 0; i < count * 3; ++i) {
+        EXPECT_EQ(scalar[i], batch[i]);
+    }
+
+    std::vector<double> fbmBatch(count), fbmScalar(count);
+    FBMBatch<3, 1, true, double>(&positions[0], &fbmBatch[0], count, 6, 2., 0.5);
+    for (int i = 0; i < count; ++i) {
+        FBM<3, 1, true, double>(&positions[i * 3], &fbmScalar[i], 6, 2., 0.5);
+    }
+    for (int i = 0; i < count; ++i) {
+        EXPECT_EQ(fbmScalar[i], fbmBatch[i]);
+    }
+}
+
+TEST(Noise, CachedMatchesScalar)
+{
+    const int count = 200;
+    std::vector<double> positions = makeSamplePositions(count);
+
+    NoiseLatticeCache<3> cache;
+    NoiseLatticeCache<3> octaveCaches[8];
+    for (int i = 0; i < count; ++i) {
+        double cached, scalar;
+        NoiseCached<3, 1, double>(&positions[i * 3], &cached, &cache);
+        Noise<3, 1, double>(&positions[i * 3], &scalar);
+        EXPECT_EQ(scalar, cached);
+
+        FBMCached<3, 1, false, double>(&positions[i * 3], &cached, 6, 2., 0.5, octaveCaches, 8);
+        FBM<3, 1, false, double>(&positions[i * 3], &scalar, 6, 2., 0.5);
+        EXPECT_EQ(scalar, cached);
+    }
+}
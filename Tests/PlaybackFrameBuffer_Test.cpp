@@ -0,0 +1,93 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include "Engine/OutputSchedulerThread.h"
+#include "Engine/PlaybackFrameBuffer.h"
+
+NATRON_NAMESPACE_USING
+
+static RenderFrameResultsContainerPtr
+createResults(double time)
+{
+    RenderFrameResultsContainerPtr ret( new RenderFrameResultsContainer( TreeRenderQueueProviderPtr() ) );
+    ret->time = TimeValue(time);
+    return ret;
+}
+
+TEST(PlaybackFrameBuffer,
+     ReturnsFramesWithTheSameKey)
+{
+    PlaybackFrameBuffer buffer;
+    RenderFrameResultsContainerPtr frame = createResults(1);
+    EXPECT_TRUE( buffer.insertFrame(TimeValue(1), 42, frame, 100, 1000, TimeValue(1), TimeValue(10)) );
+    EXPECT_EQ( buffer.getFrame(TimeValue(1), 42), frame );
+    EXPECT_FALSE( buffer.getFrame(TimeValue(2), 42) );
+    EXPECT_EQ( buffer.getSize(), (std::size_t)100 );
+
+    // A frame looked-up with another key is stale and removed
+    EXPECT_FALSE( buffer.getFrame(TimeValue(1), 43) );
+    EXPECT_EQ( buffer.getNumFrames(), 0 );
+    EXPECT_EQ( buffer.getSize(), (std::size_t)0 );
+}
+
+TEST(PlaybackFrameBuffer,
+     ReplacesFramesAtTheSameTime)
+{
+    PlaybackFrameBuffer buffer;
+    buffer.insertFrame(TimeValue(1), 1, createResults(1), 100, 1000, TimeValue(1), TimeValue(10));
+    RenderFrameResultsContainerPtr frame = createResults(1);
+    EXPECT_TRUE( buffer.insertFrame(TimeValue(1), 2, frame, 200, 1000, TimeValue(1), TimeValue(10)) );
+    EXPECT_EQ( buffer.getNumFrames(), 1 );
+    EXPECT_EQ( buffer.getSize(), (std::size_t)200 );
+    EXPECT_EQ( buffer.getFrame(TimeValue(1), 2), frame );
+}
+
+TEST(PlaybackFrameBuffer,
+     KeepsTheFirstFramesOfTheRangeWhenFull)
+{
+    PlaybackFrameBuffer buffer;
+    for (int i = 1; i <= 10; ++i) {
+        bool inserted = buffer.insertFrame(TimeValue(i), i, createResults(i), 100, 500, TimeValue(1), TimeValue(10));
+        EXPECT_EQ(inserted, i <= 5);
+    }
+    EXPECT_EQ( buffer.getNumFrames(), 5 );
+    EXPECT_TRUE( buffer.getFrame(TimeValue(1), 1) );
+    EXPECT_FALSE( buffer.getFrame(TimeValue(6), 6) );
+
+    // The frames outside of the new range make room for the frames of the range
+    EXPECT_TRUE( buffer.insertFrame(TimeValue(20), 20, createResults(20), 200, 500, TimeValue(5), TimeValue(20)) );
+    EXPECT_FALSE( buffer.getFrame(TimeValue(1), 1) );
+    EXPECT_FALSE( buffer.getFrame(TimeValue(2), 2) );
+    EXPECT_TRUE( buffer.getFrame(TimeValue(5), 5) );
+    EXPECT_LE( buffer.getSize(), (std::size_t)500 );
+
+    buffer.clear();
+    EXPECT_EQ( buffer.getNumFrames(), 0 );
+    EXPECT_EQ( buffer.getSize(), (std::size_t)0 );
+}
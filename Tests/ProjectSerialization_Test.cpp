@@ -0,0 +1,82 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <yaml-cpp/yaml.h>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
+#include "Serialization/NodeSerialization.h"
+#include "Serialization/ProjectSerialization.h"
+
+static std::string
+makeProject(int nNodes,
+            bool withInvalidNode)
+{
+    std::stringstream ss;
+    ss << "Nodes:\n";
+    for (int i = 0; i < nNodes; ++i) {
+        if (withInvalidNode && i == nNodes / 2) {
+            // A node must be a map
+            ss << "  - [Blur" << i << "]\n";
+        } else {
+            ss << "  - {PluginID: net.sf.cimg.CImgBlur, Name: Blur" << i << "}\n";
+        }
+    }
+    ss << "Frame: 1\n";
+    ss << "NatronVersion: {Version: [3, 0, 0], Branch: master, Commit: 0, OS: Linux, Bits: 64}\n";
+    return ss.str();
+}
+
+TEST(ProjectSerialization,
+     DecodesNodesConcurrentlyInOrder)
+{
+    const int nNodes = 200;
+    SERIALIZATION_NAMESPACE::ProjectSerialization project;
+    project.decode( YAML::Load( makeProject(nNodes, false) ) );
+
+    ASSERT_EQ( (std::size_t)nNodes, project._nodes.size() );
+    int i = 0;
+    for (SERIALIZATION_NAMESPACE::NodeSerializationList::const_iterator it = project._nodes.begin(); it != project._nodes.end(); ++it, ++i) {
+        std::stringstream name;
+        name << "Blur" << i;
+        EXPECT_EQ( name.str(), (*it)->_nodeScriptName );
+        EXPECT_EQ( std::string("net.sf.cimg.CImgBlur"), (*it)->_pluginID );
+    }
+    EXPECT_EQ(1, project._timelineCurrent);
+}
+
+TEST(ProjectSerialization,
+     RethrowsNodeDecodingErrors)
+{
+    SERIALIZATION_NAMESPACE::ProjectSerialization project;
+    EXPECT_THROW( project.decode( YAML::Load( makeProject(16, true) ) ), std::exception );
+}
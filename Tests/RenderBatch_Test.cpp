@@ -0,0 +1,59 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "Engine/RenderBatch.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(RenderBatch,
+     SplitArguments)
+{
+    QStringList args;
+
+    ASSERT_TRUE( RenderBatch::splitArguments(QString::fromUtf8("  -w Write1\t1-10   comp.ntp "), &args) );
+    ASSERT_EQ(4, args.size());
+    EXPECT_EQ(QString::fromUtf8("-w"), args[0]);
+    EXPECT_EQ(QString::fromUtf8("Write1"), args[1]);
+    EXPECT_EQ(QString::fromUtf8("1-10"), args[2]);
+    EXPECT_EQ(QString::fromUtf8("comp.ntp"), args[3]);
+
+    // Quotes group the white spaces and are removed, the other kind of quote is kept
+    args.clear();
+    ASSERT_TRUE( RenderBatch::splitArguments(QString::fromUtf8("-i Read1 \"/plates/sh 010/plate.####.exr\" 'my \"comp\".ntp' ''"), &args) );
+    ASSERT_EQ(5, args.size());
+    EXPECT_EQ(QString::fromUtf8("/plates/sh 010/plate.####.exr"), args[2]);
+    EXPECT_EQ(QString::fromUtf8("my \"comp\".ntp"), args[3]);
+    EXPECT_TRUE( args[4].isEmpty() ) << "An empty quoted argument is kept";
+
+    args.clear();
+    EXPECT_FALSE( RenderBatch::splitArguments(QString::fromUtf8("-w Write1 \"comp.ntp"), &args) ) << "A quote is not closed";
+}
@@ -0,0 +1,110 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include "Engine/RenderStats.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(NodeRenderStats,
+     ActionTimes)
+{
+    NodeRenderStats stats;
+
+    EXPECT_EQ( (U64)0, stats.getActionCallsCount(eRenderStatsActionIsIdentity) );
+    EXPECT_EQ( 0., stats.getActionMeanTime(eRenderStatsActionIsIdentity) );
+    EXPECT_EQ( 0., stats.getActionTimePercentile(eRenderStatsActionIsIdentity, 95.) );
+
+    // 95 calls of 10us and 5 calls of 10ms
+    for (int i = 0; i < 95; ++i) {
+        stats.addActionCall(eRenderStatsActionGetRegionOfDefinition, 10e-6);
+    }
+    for (int i = 0; i < 5; ++i) {
+        stats.addActionCall(eRenderStatsActionGetRegionOfDefinition, 10e-3);
+    }
+    EXPECT_EQ( (U64)100, stats.getActionCallsCount(eRenderStatsActionGetRegionOfDefinition) );
+    EXPECT_NEAR( (95 * 10e-6 + 5 * 10e-3) / 100, stats.getActionMeanTime(eRenderStatsActionGetRegionOfDefinition), 1e-9 );
+
+    // The percentiles are accurate to a quarter of a power of 2
+    double p95 = stats.getActionTimePercentile(eRenderStatsActionGetRegionOfDefinition, 95.);
+    EXPECT_GE(p95, 10e-6);
+    EXPECT_LT(p95, 10e-6 * 1.2);
+    EXPECT_EQ( 10e-3, stats.getActionTimePercentile(eRenderStatsActionGetRegionOfDefinition, 99.) );
+
+    // The other actions are not affected
+    EXPECT_EQ( (U64)0, stats.getActionCallsCount(eRenderStatsActionGetFramesNeeded) );
+
+    // Accumulating another frame adds its calls
+    NodeRenderStats otherFrame;
+    for (int i = 0; i < 100; ++i) {
+        otherFrame.addActionCall(eRenderStatsActionGetRegionOfDefinition, 10e-3);
+    }
+    otherFrame.addTimeSpentRendering(1., eRenderBackendTypeCPU);
+    stats.accumulate(otherFrame);
+    EXPECT_EQ( (U64)200, stats.getActionCallsCount(eRenderStatsActionGetRegionOfDefinition) );
+    EXPECT_EQ( 10e-3, stats.getActionTimePercentile(eRenderStatsActionGetRegionOfDefinition, 95.) );
+    EXPECT_EQ( 1., stats.getTotalTimeSpentRendering() );
+
+    NodeRenderStats copy(stats);
+    EXPECT_EQ( (U64)200, copy.getActionCallsCount(eRenderStatsActionGetRegionOfDefinition) );
+}
+
+TEST(RenderStatsAccumulator,
+     Frames)
+{
+    RenderStatsAccumulator accumulator;
+    RenderStats frame(true);
+    frame.setMemoryPeak(1024, 0);
+
+    // Nothing is accumulated until enabled
+    accumulator.addFrame(frame);
+    int framesCount = -1;
+    double wallTime = -1.;
+    std::size_t ramPeak = 1, glPeak = 1;
+    RenderStatsAccumulator::NodeStatsMap nodes;
+    accumulator.getStats(&framesCount, &wallTime, &ramPeak, &glPeak, &nodes);
+    EXPECT_EQ(0, framesCount);
+    EXPECT_EQ( (std::size_t)0, ramPeak );
+
+    accumulator.setEnabled(true);
+    accumulator.addFrame(frame);
+    RenderStats otherFrame(true);
+    otherFrame.setMemoryPeak(512, 256);
+    accumulator.addFrame(otherFrame);
+    accumulator.getStats(&framesCount, &wallTime, &ramPeak, &glPeak, &nodes);
+    EXPECT_EQ(2, framesCount);
+    EXPECT_GE(wallTime, 0.);
+    EXPECT_EQ( (std::size_t)1024, ramPeak );
+    EXPECT_EQ( (std::size_t)256, glPeak );
+    EXPECT_TRUE( nodes.empty() );
+
+    accumulator.reset();
+    accumulator.getStats(&framesCount, &wallTime, &ramPeak, &glPeak, &nodes);
+    EXPECT_EQ(0, framesCount);
+    EXPECT_TRUE( accumulator.isEnabled() );
+}
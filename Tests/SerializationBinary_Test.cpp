@@ -0,0 +1,87 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <yaml-cpp/yaml.h>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
+#include "Serialization/SerializationBinary.h"
+
+static YAML::Node
+roundTrip(const YAML::Node& node, bool compress)
+{
+    std::stringstream ss;
+    SERIALIZATION_NAMESPACE::SerializationBinary::encode(node, compress, ss);
+    EXPECT_TRUE( SERIALIZATION_NAMESPACE::SerializationBinary::isBinaryEncoded(ss) );
+    return SERIALIZATION_NAMESPACE::SerializationBinary::decode(ss);
+}
+
+TEST(SerializationBinary,
+     RoundTripsTheTree)
+{
+    const std::string longScalar(1000, 'a');
+    YAML::Node node = YAML::Load("Name: Blur1\n"
+                                 "Values: [1, 2.5, ~, \"quoted\"]\n"
+                                 "Nodes:\n"
+                                 "  - {Name: Blur1, Inputs: [Read1]}\n"
+                                 "  - !Bezier {Name: Bezier1}\n"
+                                 "Long: " + longScalar + "\n");
+    for (int compress = 0; compress < 2; ++compress) {
+        YAML::Node decoded = roundTrip(node, (bool)compress);
+        ASSERT_TRUE( decoded.IsMap() );
+        EXPECT_EQ( decoded["Name"].as<std::string>(), std::string("Blur1") );
+        ASSERT_TRUE( decoded["Values"].IsSequence() );
+        ASSERT_EQ( decoded["Values"].size(), (std::size_t)4 );
+        EXPECT_EQ( decoded["Values"][0].as<int>(), 1 );
+        EXPECT_EQ( decoded["Values"][1].as<double>(), 2.5 );
+        EXPECT_EQ( decoded["Values"][2].Type(), node["Values"][2].Type() );
+        EXPECT_EQ( decoded["Values"][3].Tag(), std::string("!") );
+        EXPECT_EQ( decoded["Nodes"][0]["Inputs"][0].as<std::string>(), std::string("Read1") );
+        EXPECT_EQ( decoded["Nodes"][1].Tag(), std::string("!Bezier") );
+        EXPECT_EQ( decoded["Nodes"][1]["Name"].as<std::string>(), std::string("Bezier1") );
+        EXPECT_EQ( decoded["Long"].as<std::string>(), longScalar );
+    }
+}
+
+TEST(SerializationBinary,
+     RejectsInvalidData)
+{
+    std::stringstream yaml("Name: Blur1\n");
+    EXPECT_FALSE( SERIALIZATION_NAMESPACE::SerializationBinary::isBinaryEncoded(yaml) );
+
+    std::stringstream ss;
+    SERIALIZATION_NAMESPACE::SerializationBinary::encode(YAML::Load("{Name: Blur1, Values: [1, 2, 3]}"), false, ss);
+    std::string truncated = ss.str();
+    truncated.resize(truncated.size() - 2);
+    std::stringstream truncatedStream(truncated);
+    EXPECT_THROW( SERIALIZATION_NAMESPACE::SerializationBinary::decode(truncatedStream), std::runtime_error );
+}
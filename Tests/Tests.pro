@@ -49,12 +49,34 @@ SOURCES += \
     google-test/src/gtest-all.cc \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
+    Half_Test.cpp \
     Hash64_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
     KnobFile_Test.cpp \
     Curve_Test.cpp \
     Tracker_Test.cpp \
+    TileCompression_Test.cpp \
+    ConcurrentFramesController_Test.cpp \
+    PlaybackFrameBuffer_Test.cpp \
+    KnobExpression_Test.cpp \
+    CompressedTileFile_Test.cpp \
+    SerializationBinary_Test.cpp \
+    ImageBufferPool_Test.cpp \
+    MemoryPressureMonitorThread_Test.cpp \
+    MemoryTimelineRecorder_Test.cpp \
+    ImageTilesState_Test.cpp \
+    InteractiveLatency_Test.cpp \
+    GLProgramBinaryCache_Test.cpp \
+    HashProfiler_Test.cpp \
+    RenderBatch_Test.cpp \
+    RenderStats_Test.cpp \
+    ThreadPoolMonitor_Test.cpp \
+    TraceRecorder_Test.cpp \
+    ImagePlaneDesc_Test.cpp \
+    BoundedRingBuffer_Test.cpp \
+    Noise_Test.cpp \
+    ProjectSerialization_Test.cpp \
     wmain.cpp
 
 HEADERS += \
@@ -0,0 +1,112 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include "Engine/ThreadPoolMonitor.h"
+#include "Engine/TraceRecorder.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(ThreadPoolMonitor,
+     TasksAndWaits)
+{
+    ThreadPoolMonitor::setEnabled(false);
+    ThreadPoolMonitor::reset();
+
+    // Nothing is monitored while disabled
+    double ignoredQueueTime = ThreadPoolMonitor::onTaskQueued();
+    EXPECT_LT(ignoredQueueTime, 0.);
+
+    ThreadPoolMonitor::setEnabled(true);
+    TraceRecorder::reset();
+    TraceRecorder::setEnabled(true);
+
+    // A task queued while disabled is not counted when it runs
+    EXPECT_LT(ThreadPoolMonitor::onTaskStarted(ignoredQueueTime), 0.);
+
+    double queueTime = ThreadPoolMonitor::onTaskQueued();
+    ASSERT_GE(queueTime, 0.);
+    double droppedQueueTime = ThreadPoolMonitor::onTaskQueued();
+
+    ThreadPoolMonitor::Gauges gauges;
+    ThreadPoolMonitor::getGauges(&gauges);
+    EXPECT_EQ(2, gauges.queued);
+
+    ThreadPoolMonitor::onTaskDropped(droppedQueueTime);
+    double startTime = ThreadPoolMonitor::onTaskStarted(queueTime);
+    ASSERT_GE(startTime, 0.);
+
+    ThreadPoolMonitor::onThreadReleased();
+    double waitStartTime = ThreadPoolMonitor::onPendingTilesWaitStarted();
+    ThreadPoolMonitor::getGauges(&gauges);
+    EXPECT_EQ(0, gauges.queued);
+    EXPECT_EQ(1, gauges.running);
+    EXPECT_EQ(1, gauges.waitingForTiles);
+    EXPECT_EQ(1, gauges.released);
+
+    // Disabling does not prevent the monitored tasks and waits from ending
+    ThreadPoolMonitor::setEnabled(false);
+    ThreadPoolMonitor::onPendingTilesWaitFinished(waitStartTime);
+    ThreadPoolMonitor::onThreadReserved();
+    ThreadPoolMonitor::onTaskFinished(startTime);
+    TraceRecorder::setEnabled(false);
+
+    ThreadPoolMonitor::Stats stats;
+    ThreadPoolMonitor::getStats(&stats);
+    EXPECT_EQ(0, stats.current.running);
+    EXPECT_EQ(0, stats.current.waitingForTiles);
+    EXPECT_EQ(0, stats.current.released);
+    EXPECT_EQ(2, stats.maximum.queued);
+    EXPECT_EQ(1, stats.maximum.running);
+    EXPECT_EQ( (U64)1, stats.nTasks );
+    ASSERT_EQ( (std::size_t)1, stats.workers.size() );
+    EXPECT_EQ( (U64)1, stats.workers[0].nTasks );
+    EXPECT_LE(stats.workers[0].releasedTime, stats.workers[0].busyTime);
+    EXPECT_FALSE( ThreadPoolMonitor::getReport().empty() );
+
+    // The gauges are recorded as counters of the trace
+    const QString filePath = QDir::temp().filePath( QString::fromUtf8("ThreadPoolMonitor_Test.json") );
+    ASSERT_TRUE( TraceRecorder::writeTrace( filePath.toStdString() ) );
+    QFile file(filePath);
+    ASSERT_TRUE( file.open(QIODevice::ReadOnly) );
+    const QString trace = QString::fromUtf8( file.readAll() );
+    file.close();
+    QFile::remove(filePath);
+    EXPECT_TRUE( trace.contains( QString::fromUtf8("\"name\": \"Thread pool\", \"ph\": \"C\"") ) );
+    EXPECT_TRUE( trace.contains( QString::fromUtf8("\"waiting for tiles\": 1.000") ) );
+    TraceRecorder::reset();
+
+    ThreadPoolMonitor::reset();
+    ThreadPoolMonitor::getStats(&stats);
+    EXPECT_EQ( (U64)0, stats.nTasks );
+    EXPECT_TRUE( stats.workers.empty() );
+}
@@ -0,0 +1,136 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/TileCompression.h"
+
+NATRON_NAMESPACE_USING
+
+static bool
+roundTrip(const void* data, std::size_t size, int elementSizeBytes, std::size_t* compressedSize)
+{
+    std::vector<U8> compressed;
+    TileCompression::compress(data, size, elementSizeBytes, &compressed);
+    *compressedSize = compressed.size();
+    if (TileCompression::getDecompressedSize(&compressed[0], compressed.size()) != size) {
+        return false;
+    }
+    std::vector<U8> decompressed(size + 1);
+    if ( !TileCompression::decompress(&compressed[0], compressed.size(), &decompressed[0], size) ) {
+        return false;
+    }
+    return size == 0 || std::memcmp(data, &decompressed[0], size) == 0;
+}
+
+TEST(TileCompression,
+     FloatTileIsBitExact)
+{
+    // 64x64 float tile with a smooth gradient and a few special values
+    std::vector<float> tile(64 * 64);
+    for (int y = 0; y < 64; ++y) {
+        for (int x = 0; x < 64; ++x) {
+            tile[y * 64 + x] = 0.5f + 0.25f * std::sin(x * 0.05f) * std::cos(y * 0.07f);
+        }
+    }
+    tile[10] = std::numeric_limits<float>::quiet_NaN();
+    tile[11] = -0.f;
+    tile[12] = std::numeric_limits<float>::denorm_min();
+    tile[13] = std::numeric_limits<float>::infinity();
+
+    std::size_t compressedSize;
+    EXPECT_TRUE( roundTrip(&tile[0], tile.size() * sizeof(float), 4, &compressedSize) );
+    EXPECT_LT( compressedSize, tile.size() * sizeof(float) );
+}
+
+TEST(TileCompression,
+     ConstantTileIsSmall)
+{
+    std::vector<unsigned short> tile(128 * 64, 12000);
+    std::size_t compressedSize;
+    EXPECT_TRUE( roundTrip(&tile[0], tile.size() * sizeof(unsigned short), 2, &compressedSize) );
+    EXPECT_LT( compressedSize, (std::size_t)256 );
+}
+
+TEST(TileCompression,
+     RandomBuffers)
+{
+    srand(2000);
+    for (int i = 0; i < 200; ++i) {
+        // coverity[dont_call]
+        std::size_t size = rand() % 20000;
+        std::vector<U8> data(size + 1);
+        // coverity[dont_call]
+        bool compressible = rand() % 2;
+        for (std::size_t j = 0; j < size; ++j) {
+            // coverity[dont_call]
+            data[j] = compressible ? (U8)( (j / 13) % 7 ) : (U8)rand();
+        }
+        int elementSize = 1 << (i % 3);
+        std::size_t compressedSize;
+        EXPECT_TRUE( roundTrip(&data[0], size, elementSize, &compressedSize) );
+        EXPECT_LE( compressedSize, TileCompression::getMaxCompressedSize(size) );
+    }
+}
+
+TEST(TileCompression,
+     CorruptedInputIsRejected)
+{
+    std::vector<U8> data(16384);
+    for (std::size_t j = 0; j < data.size(); ++j) {
+        data[j] = (U8)( (j / 5) % 11 );
+    }
+    std::vector<U8> compressed;
+    TileCompression::compress(&data[0], data.size(), 1, &compressed);
+
+    std::vector<U8> decompressed( data.size() );
+
+    // Wrong output size
+    EXPECT_FALSE( TileCompression::decompress(&compressed[0], compressed.size(), &decompressed[0], data.size() - 1) );
+
+    // Truncated input
+    EXPECT_FALSE( TileCompression::decompress(&compressed[0], compressed.size() / 2, &decompressed[0], data.size()) );
+
+    // Bad magic
+    std::vector<U8> badMagic = compressed;
+    badMagic[0] = 0;
+    EXPECT_FALSE( TileCompression::decompress(&badMagic[0], badMagic.size(), &decompressed[0], data.size()) );
+
+    // Random bit flips in the payload must never read or write out of bounds
+    srand(2000);
+    for (int i = 0; i < 1000; ++i) {
+        std::vector<U8> corrupted = compressed;
+        // coverity[dont_call]
+        corrupted[8 + rand() % (corrupted.size() - 8)] ^= (U8)( 1 << (rand() % 8) );
+        (void)TileCompression::decompress(&corrupted[0], corrupted.size(), &decompressed[0], data.size());
+    }
+}
@@ -0,0 +1,73 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include "Engine/TraceRecorder.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(TraceRecorder,
+     WriteTrace)
+{
+    TraceRecorder::reset();
+
+    // Nothing is recorded while disabled
+    {
+        TraceSpan_RAII span(eTraceCategoryRender, "Render");
+        EXPECT_FALSE( span.isRecording() );
+    }
+    EXPECT_EQ( (std::size_t)0, TraceRecorder::getSpansCount() );
+
+    TraceRecorder::setEnabled(true);
+    {
+        TraceSpan_RAII span(eTraceCategoryOFX, "OfxImageEffectActionRender");
+        ASSERT_TRUE( span.isRecording() );
+        span.setDetail("Blur\"1\"");
+    }
+    TraceRecorder::setEnabled(false);
+    ASSERT_EQ( (std::size_t)1, TraceRecorder::getSpansCount() );
+
+    const QString filePath = QDir::temp().filePath( QString::fromUtf8("TraceRecorder_Test.json") );
+    ASSERT_TRUE( TraceRecorder::writeTrace( filePath.toStdString() ) );
+    QFile file(filePath);
+    ASSERT_TRUE( file.open(QIODevice::ReadOnly) );
+    const QString trace = QString::fromUtf8( file.readAll() );
+    file.close();
+    QFile::remove(filePath);
+
+    EXPECT_TRUE( trace.startsWith( QString::fromUtf8("{\"traceEvents\": [") ) );
+    EXPECT_TRUE( trace.contains( QString::fromUtf8("\"name\": \"thread_name\"") ) );
+    EXPECT_TRUE( trace.contains( QString::fromUtf8("\"name\": \"OfxImageEffectActionRender Blur\\\"1\\\"\", \"cat\": \"ofx\", \"ph\": \"X\"") ) ) << "The detail is escaped";
+
+    TraceRecorder::reset();
+    EXPECT_EQ( (std::size_t)0, TraceRecorder::getSpansCount() );
+}
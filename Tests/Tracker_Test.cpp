@@ -26,8 +26,11 @@
 #include "Global/Macros.h"
 
 #include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <list>
 #include <sstream> // stringstream
 
 #include <gtest/gtest.h>
@@ -38,11 +41,20 @@ GCC_DIAG_OFF(maybe-uninitialized)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <openMVG/robust_estimation/robust_estimator_Prosac.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+GCC_DIAG_OFF(unused-function)
+GCC_DIAG_OFF(unused-parameter)
+#include <libmv/autotrack/autotrack.h>
+#include <libmv/autotrack/frame_accessor.h>
+GCC_DIAG_ON(unused-function)
+GCC_DIAG_ON(unused-parameter)
 #if ( ( __GNUC__ * 100) + __GNUC_MINOR__) >= 408
 GCC_DIAG_ON(maybe-uninitialized)
 #endif
 
 #include "Engine/EngineFwd.h"
+#include "Engine/Curve.h"
+#include "Engine/Timer.h"
+#include "Engine/TrackerFramePrefetcher.h"
 #include "Engine/Transform.h"
 #include "Global/GlobalDefines.h"
 
@@ -472,3 +484,295 @@ TEST(ModelSearch, HomographyNPoints)
     }
     testHomography(x1);
 }
+
+// The synthetic sequence of the tracker benchmark is a value noise texture with this cell size in pixels,
+// translated by a constant sub-pixel motion per frame: the position of the markers is known at every frame.
+#define TRACKER_BENCHMARK_NOISE_CELL_SIZE 4
+#define TRACKER_BENCHMARK_MOTION_X 1.37
+#define TRACKER_BENCHMARK_MOTION_Y -0.83
+#define TRACKER_BENCHMARK_N_FRAMES 30
+
+static double
+benchmarkLatticeValue(int i,
+                      int j)
+{
+    unsigned int h = ( (unsigned int)i * 73856093u ) ^ ( (unsigned int)j * 19349663u );
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+
+    return (h & 0xFFFF) / 65535.;
+}
+
+static double
+benchmarkTexture(double x,
+                 double y)
+{
+    double fx = x / TRACKER_BENCHMARK_NOISE_CELL_SIZE;
+    double fy = y / TRACKER_BENCHMARK_NOISE_CELL_SIZE;
+    int ix = (int)std::floor(fx);
+    int iy = (int)std::floor(fy);
+    double tx = fx - ix;
+    double ty = fy - iy;
+    tx = tx * tx * (3. - 2. * tx);
+    ty = ty * ty * (3. - 2. * ty);
+    double v0 = benchmarkLatticeValue(ix, iy) * (1. - tx) + benchmarkLatticeValue(ix + 1, iy) * tx;
+    double v1 = benchmarkLatticeValue(ix, iy + 1) * (1. - tx) + benchmarkLatticeValue(ix + 1, iy + 1) * tx;
+
+    return v0 * (1. - ty) + v1 * ty;
+}
+
+/**
+ * @brief Serves the frames of the synthetic sequence to libmv like TrackerFrameAccessor does: the RGB pixels are
+ * first produced (the fetch stage) then converted to the single channel float image used by libmv (the convert stage).
+ **/
+class SyntheticFrameAccessor
+    : public mv::FrameAccessor
+{
+public:
+
+    SyntheticFrameAccessor()
+    : fetchTime(0)
+    , convertTime(0)
+    {
+    }
+
+    virtual ~SyntheticFrameAccessor()
+    {
+    }
+
+    virtual void GetImage(std::list<GetImageArgs>& imageRequests) OVERRIDE FINAL
+    {
+        for (std::list<GetImageArgs>::iterator it = imageRequests.begin(); it != imageRequests.end(); ++it) {
+            it->destination = 0;
+            it->destinationKey = 0;
+            if ( (it->sourceType != eGetImageTypeSource) || !it->region ) {
+                // No mask
+                continue;
+            }
+            TimeLapse timer;
+
+            const double scale = 1 << it->downscale;
+            const int x1 = (int)std::floor(it->region->min(0) / scale);
+            const int y1 = (int)std::floor(it->region->min(1) / scale);
+            const int x2 = (int)std::ceil(it->region->max(0) / scale);
+            const int y2 = (int)std::ceil(it->region->max(1) / scale);
+            const int width = x2 - x1;
+            const int height = y2 - y1;
+            const double offsetX = TRACKER_BENCHMARK_MOTION_X * it->frame;
+            const double offsetY = TRACKER_BENCHMARK_MOTION_Y * it->frame;
+
+            std::vector<float> rgb(width * height * 3);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    double v = benchmarkTexture( (x1 + x + 0.5) * scale - 0.5 - offsetX, (y1 + y + 0.5) * scale - 0.5 - offsetY );
+                    float* pix = &rgb[(y * width + x) * 3];
+                    pix[0] = (float)v;
+                    pix[1] = (float)(0.5 * v);
+                    pix[2] = (float)(1. - v);
+                }
+            }
+            fetchTime += timer.getTimeElapsedReset();
+
+            libmv::FloatImage* image = new libmv::FloatImage(height, width);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const float* pix = &rgb[(y * width + x) * 3];
+                    (*image)(y, x) = (pix[0] + pix[1] + pix[2]) / 3.f;
+                }
+            }
+            convertTime += timer.getTimeElapsedReset();
+
+            it->destination = image;
+            it->destinationKey = image;
+        }
+    }
+
+    virtual void ReleaseImage(Key key) OVERRIDE FINAL
+    {
+        delete (libmv::FloatImage*)key;
+    }
+
+    virtual bool GetClipDimensions(int /*clip*/,
+                                   int* width,
+                                   int* height) OVERRIDE FINAL
+    {
+        *width = 1920;
+        *height = 1080;
+
+        return true;
+    }
+
+    virtual int NumClips() OVERRIDE FINAL
+    {
+        return 1;
+    }
+
+    virtual int NumFrames(int /*clip*/) OVERRIDE FINAL
+    {
+        return TRACKER_BENCHMARK_N_FRAMES + 1;
+    }
+
+    // Cumulated time of each stage, in seconds
+    double fetchTime;
+    double convertTime;
+};
+
+struct TrackerBenchmarkResults
+{
+    double totalTime;
+    double fetchTime;
+    double convertTime;
+    double matchTime;
+    double writeBackTime;
+    double meanDrift;
+    double maxDrift;
+    int nFailures;
+};
+
+/**
+ * @brief Tracks nMarkers markers over the synthetic sequence like trackStepLibMV does: the reference of each frame is
+ * the previous frame and the results are written to curves, one keyframe per frame.
+ **/
+static TrackerBenchmarkResults
+runTrackerBenchmark(int nMarkers)
+{
+    SyntheticFrameAccessor accessor;
+    mv::AutoTrack autoTrack(&accessor);
+
+    mv::TrackRegionOptions options;
+    options.mode = mv::TrackRegionOptions::TRANSLATION;
+    options.minimum_correlation = 0.75;
+    options.max_iterations = 50;
+    options.use_brute_initialization = true;
+    options.use_normalized_intensities = false;
+    options.sigma = 0.9;
+
+    const double patternHalfSize = 10;
+    const double searchHalfSize = 30;
+    std::vector<mv::Marker> markers(nMarkers);
+    std::vector<Curve> centerCurvesX(nMarkers), centerCurvesY(nMarkers), errorCurves(nMarkers);
+    for (int i = 0; i < nMarkers; ++i) {
+        mv::Marker& m = markers[i];
+        m.clip = 0;
+        m.reference_clip = 0;
+        m.frame = 0;
+        m.reference_frame = 0;
+        m.track = i;
+        m.weight = 1.;
+        m.source = mv::Marker::MANUAL;
+        m.status = mv::Marker::UNKNOWN;
+        m.model_type = mv::Marker::POINT;
+        m.model_id = 0;
+        m.disabled_channels = 0;
+        m.center(0) = 150 + (i % 6) * 300;
+        m.center(1) = 150 + (i / 6) * 250;
+        m.patch.coordinates(0, 0) = m.center(0) - patternHalfSize;
+        m.patch.coordinates(0, 1) = m.center(1) + patternHalfSize;
+        m.patch.coordinates(1, 0) = m.center(0) + patternHalfSize;
+        m.patch.coordinates(1, 1) = m.center(1) + patternHalfSize;
+        m.patch.coordinates(2, 0) = m.center(0) + patternHalfSize;
+        m.patch.coordinates(2, 1) = m.center(1) - patternHalfSize;
+        m.patch.coordinates(3, 0) = m.center(0) - patternHalfSize;
+        m.patch.coordinates(3, 1) = m.center(1) - patternHalfSize;
+        m.search_region.min(0) = m.center(0) - searchHalfSize;
+        m.search_region.min(1) = m.center(1) - searchHalfSize;
+        m.search_region.max(0) = m.center(0) + searchHalfSize;
+        m.search_region.max(1) = m.center(1) + searchHalfSize;
+        autoTrack.AddMarker(m);
+    }
+    const std::vector<mv::Marker> initialMarkers = markers;
+
+    TrackerBenchmarkResults results;
+    results.fetchTime = results.convertTime = results.matchTime = results.writeBackTime = 0.;
+    results.meanDrift = results.maxDrift = 0.;
+    results.nFailures = 0;
+
+    TimeLapse totalTimer;
+    for (int frame = 1; frame <= TRACKER_BENCHMARK_N_FRAMES; ++frame) {
+        for (int i = 0; i < nMarkers; ++i) {
+            mv::Marker& m = markers[i];
+            m.frame = frame;
+            m.reference_frame = frame - 1;
+            m.source = mv::Marker::TRACKED;
+
+            TimeLapse timer;
+            libmv::TrackRegionResult result;
+            bool ok = autoTrack.TrackMarker(&m, &result, 0, &options) && result.is_usable();
+            results.matchTime += timer.getTimeElapsedReset();
+            if (!ok) {
+                ++results.nFailures;
+                continue;
+            }
+            autoTrack.AddMarker(m);
+
+            timer.reset();
+            centerCurvesX[i].setOrAddKeyframe( KeyFrame(frame, m.center(0) + 0.5) );
+            centerCurvesY[i].setOrAddKeyframe( KeyFrame(frame, m.center(1) + 0.5) );
+            errorCurves[i].setOrAddKeyframe( KeyFrame(frame, 1. - result.correlation) );
+            results.writeBackTime += timer.getTimeElapsedReset();
+
+            double dx = m.center(0) - ( initialMarkers[i].center(0) + TRACKER_BENCHMARK_MOTION_X * frame );
+            double dy = m.center(1) - ( initialMarkers[i].center(1) + TRACKER_BENCHMARK_MOTION_Y * frame );
+            double drift = std::sqrt(dx * dx + dy * dy);
+            results.meanDrift += drift;
+            results.maxDrift = std::max(results.maxDrift, drift);
+        }
+    }
+    results.totalTime = totalTimer.getTimeElapsedReset();
+
+    // TrackMarker fetches its images, only count the matching itself
+    results.fetchTime = accessor.fetchTime;
+    results.convertTime = accessor.convertTime;
+    results.matchTime -= results.fetchTime + results.convertTime;
+
+    int nTracked = nMarkers * TRACKER_BENCHMARK_N_FRAMES - results.nFailures;
+    if (nTracked > 0) {
+        results.meanDrift /= nTracked;
+    }
+
+    return results;
+} // runTrackerBenchmark
+
+// Prints the speed of each stage of tracking and the drift from the known motion for an increasing number of markers.
+// The sequence is deterministic and the markers are tracked on a single thread so that runs are comparable across builds.
+TEST(TrackerBenchmark, SyntheticTranslation)
+{
+    const int markerCounts[3] = {1, 4, 16};
+    for (int c = 0; c < 3; ++c) {
+        const int nMarkers = markerCounts[c];
+        TrackerBenchmarkResults r = runTrackerBenchmark(nMarkers);
+        const double nMarkerFrames = nMarkers * TRACKER_BENCHMARK_N_FRAMES;
+
+        printf("Tracker benchmark, %d markers x %d frames: %.1f frames/s, per marker and frame: fetch %.3f ms, convert %.3f ms, match %.3f ms, write-back %.4f ms; drift mean %.3f px, max %.3f px; %d failures\n",
+               nMarkers, TRACKER_BENCHMARK_N_FRAMES, TRACKER_BENCHMARK_N_FRAMES / r.totalTime,
+               r.fetchTime * 1000. / nMarkerFrames, r.convertTime * 1000. / nMarkerFrames,
+               r.matchTime * 1000. / nMarkerFrames, r.writeBackTime * 1000. / nMarkerFrames,
+               r.meanDrift, r.maxDrift, r.nFailures);
+
+        EXPECT_EQ(0, r.nFailures);
+        EXPECT_LT(r.maxDrift, 1.);
+    }
+}
+
+TEST(TrackerFramePrefetcher, MergeRegions)
+{
+    std::list<RectD> rects;
+    rects.push_back( RectD(0, 0, 100, 100) );
+    rects.push_back( RectD(30, 30, 130, 130) );  // overlaps the first one
+    rects.push_back( RectD(1000, 1000, 1100, 1100) );  // far from the others
+    rects.push_back( RectD(10, 10, 10, 20) );  // empty
+    TrackerFramePrefetcher::mergeRegions(&rects);
+
+    ASSERT_EQ( (std::size_t)2, rects.size() );
+    EXPECT_EQ( RectD(0, 0, 130, 130), rects.front() );
+    EXPECT_EQ( RectD(1000, 1000, 1100, 1100), rects.back() );
+
+    // Windows spread over the frame are not merged into a rectangle covering the whole frame
+    rects.clear();
+    rects.push_back( RectD(0, 0, 60, 60) );
+    rects.push_back( RectD(1860, 0, 1920, 60) );
+    rects.push_back( RectD(0, 1020, 60, 1080) );
+    rects.push_back( RectD(1860, 1020, 1920, 1080) );
+    TrackerFramePrefetcher::mergeRegions(&rects);
+    EXPECT_EQ( (std::size_t)4, rects.size() );
+}
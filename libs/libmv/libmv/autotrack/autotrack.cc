@@ -21,6 +21,9 @@
 // Author: mierle@gmail.com (Keir Mierle)
 
 #include "libmv/autotrack/autotrack.h"
+
+#include <algorithm>
+
 #include "libmv/autotrack/quad.h"
 #include "libmv/autotrack/frame_accessor.h"
 #include "libmv/autotrack/predict_tracks.h"
@@ -94,12 +97,15 @@ struct GetImageForMarkerArgs
 {
     const Marker* marker;
     FrameAccessor::GetImageTypeEnum sourceType;
+    // The image is downscaled by 2^downscale.
+    int downscale;
     FloatImage* image;
     FrameAccessor::Key key;
 
     GetImageForMarkerArgs()
     : marker(0)
     , sourceType(FrameAccessor::eGetImageTypeSource)
+    , downscale(0)
     , image(0)
     , key(0)
     {
@@ -136,7 +142,7 @@ void GetImageForMarker(std::list<GetImageForMarkerArgs>& args, FrameAccessor* fr
         access.frame = it->marker->frame;
         access.sourceType = it->sourceType;
         access.input_mode = FrameAccessor::MONO;
-        access.downscale = 0; // No downscale for now.
+        access.downscale = it->downscale;
         access.region = &regions[i];
         access.transform = needsTransform ? transform.get() : 0;
         access.destination = 0;
@@ -153,38 +159,78 @@ void GetImageForMarker(std::list<GetImageForMarkerArgs>& args, FrameAccessor* fr
     }
 }
 
-}  // namespace
+// The minimum size of the pattern, in pixels, at the coarsest pyramid level.
+const int kMinPyramidPatternSize = 8;
 
-bool AutoTrack::TrackMarker(Marker* tracked_marker,
-                            TrackRegionResult* result,
-                            KalmanFilterState* predictionState,
-                            const TrackRegionOptions* track_options) {
-    
-  // Try to predict the location of the second marker.
-    bool predicted_position;
-    if (predictionState) {
-        predicted_position = predictionState->PredictForward(tracked_marker->frame, tracked_marker);
-    } else {
-        predicted_position = PredictMarkerPosition(tracks_, tracked_marker);
-    }
-  if (predicted_position) {
-    LG << "Succesfully predicted!";
-  } else {
-    LG << "Prediction failed; trying to track anyway.";
+// The margin around the pattern, in pixels of the level, of the search
+// region used to refine the position found at the coarser level.
+const int kPyramidSearchMargin = 4;
+
+// Scales the coordinates of the marker to the given pyramid level. The search
+// region becomes the smallest region enclosing it at that level, which is the
+// region of the image returned by the frame accessor for that level.
+Marker DownscaleMarker(const Marker& marker, int downscale) {
+  Marker result = marker;
+  if (downscale == 0) {
+    return result;
+  }
+  const float scale = 1.0f / (1 << downscale);
+  result.center *= scale;
+  result.patch.coordinates *= scale;
+  Region rounded = marker.search_region.Rounded();
+  for (int i = 0; i < 2; ++i) {
+    result.search_region.min(i) = floor(rounded.min(i) * scale);
+    result.search_region.max(i) = ceil(rounded.max(i) * scale);
   }
+  return result;
+}
 
-  Marker reference_marker;
-  tracks_.GetMarker(tracked_marker->reference_clip,
-                    tracked_marker->reference_frame,
-                    tracked_marker->track,
-                    &reference_marker);
+// Returns how many pyramid levels can be used for the pattern of the marker so
+// that it is not smaller than kMinPyramidPatternSize at the coarsest level.
+int NumPyramidLevelsForMarker(const Marker& marker, int num_pyramid_levels) {
+  Vec2f patch_min = marker.patch.coordinates.colwise().minCoeff().transpose();
+  Vec2f patch_max = marker.patch.coordinates.colwise().maxCoeff().transpose();
+  int pattern_size = (int)std::min(patch_max(0) - patch_min(0),
+                                   patch_max(1) - patch_min(1));
+  int num_levels = 1;
+  while (num_levels < num_pyramid_levels &&
+         (pattern_size >> num_levels) >= kMinPyramidPatternSize) {
+    ++num_levels;
+  }
+  return num_levels;
+}
+
+// Sets the search region of the marker to its pattern expanded by
+// kPyramidSearchMargin pixels of the given pyramid level.
+void SetSearchRegionAroundPattern(Marker* marker, int downscale) {
+  const float margin = (float)(kPyramidSearchMargin << downscale);
+  Vec2f patch_min = marker->patch.coordinates.colwise().minCoeff().transpose();
+  Vec2f patch_max = marker->patch.coordinates.colwise().maxCoeff().transpose();
+  for (int i = 0; i < 2; ++i) {
+    marker->search_region.min(i) = patch_min(i) - margin;
+    marker->search_region.max(i) = patch_max(i) + margin;
+  }
+}
+
+// Tracks the marker against the reference marker on the images downscaled by
+// 2^downscale. The pattern and center of the tracked marker are updated, in
+// full resolution coordinates, but not its search region.
+// Returns false if the images could not be fetched.
+bool TrackMarkerAtLevel(FrameAccessor* frame_accessor,
+                        const Marker& reference_marker,
+                        Marker* tracked_marker,
+                        int downscale,
+                        const TrackRegionOptions& track_options,
+                        TrackRegionResult* result) {
+  Marker level_reference_marker = DownscaleMarker(reference_marker, downscale);
+  Marker level_tracked_marker = DownscaleMarker(*tracked_marker, downscale);
 
   // Convert markers into the format expected by TrackRegion.
   double x1[5], y1[5];
-  MarkerToArrays(reference_marker, x1, y1);
+  MarkerToArrays(level_reference_marker, x1, y1);
 
   double x2[5], y2[5];
-  MarkerToArrays(*tracked_marker, x2, y2);
+  MarkerToArrays(level_tracked_marker, x2, y2);
 
   // TODO(keir): Technically this could take a smaller slice from the source
   // image instead of taking one the size of the search window.
@@ -193,12 +239,14 @@ bool AutoTrack::TrackMarker(Marker* tracked_marker,
       GetImageForMarkerArgs args;
       args.marker = &reference_marker;
       args.sourceType = FrameAccessor::eGetImageTypeSource;
+      args.downscale = downscale;
       getImageArgs.push_back(args);
   }
   {
       GetImageForMarkerArgs args;
       args.marker = tracked_marker;
       args.sourceType = FrameAccessor::eGetImageTypeSource;
+      args.downscale = downscale;
       getImageArgs.push_back(args);
   }
   {
@@ -208,10 +256,11 @@ bool AutoTrack::TrackMarker(Marker* tracked_marker,
       GetImageForMarkerArgs args;
       args.marker = &reference_marker;
       args.sourceType = FrameAccessor::eGetImageTypeMask;
+      args.downscale = downscale;
       getImageArgs.push_back(args);
   }
 
-  GetImageForMarker(getImageArgs, frame_accessor_);
+  GetImageForMarker(getImageArgs, frame_accessor);
 
 
 
@@ -234,31 +283,31 @@ bool AutoTrack::TrackMarker(Marker* tracked_marker,
 
   if (!reference_key) {
     LG << "Couldn't get frame for reference marker: " << reference_marker;
+    if (reference_mask) {
+      frame_accessor->ReleaseImage(reference_mask_key);
+    }
+    if (tracked_key) {
+      frame_accessor->ReleaseImage(tracked_key);
+    }
     return false;
   }
 
 
   if (!tracked_key) {
-    frame_accessor_->ReleaseImage(reference_key);
+    frame_accessor->ReleaseImage(reference_key);
+    if (reference_mask) {
+      frame_accessor->ReleaseImage(reference_mask_key);
+    }
     LG << "Couldn't get frame for tracked marker: " << tracked_marker;
     return false;
   }
 
-
-  // Store original position befoer tracking, so we can claculate offset later.
-  Vec2f original_center = tracked_marker->center;
-
   // Do the tracking!
-  TrackRegionOptions local_track_region_options;
-  if (track_options) {
-    local_track_region_options = *track_options;
-  }
+  TrackRegionOptions local_track_region_options = track_options;
   if (reference_mask_key != NULL) {
     LG << "Using mask for reference marker: " << reference_marker;
     local_track_region_options.image1_mask = reference_mask;
   }
-  local_track_region_options.num_extra_points = 1;  // For center point.
-  local_track_region_options.attempt_refine_before_brute = predicted_position;
   TrackRegion(*reference_image,
               *tracked_image,
               x1, y1,
@@ -267,13 +316,106 @@ bool AutoTrack::TrackMarker(Marker* tracked_marker,
               result);
 
   // Copy results over the tracked marker.
-  Vec2f tracked_origin = tracked_marker->search_region.Rounded().min;
+  const float scale = (float)(1 << downscale);
+  Vec2f tracked_origin = level_tracked_marker.search_region.Rounded().min;
   for (int i = 0; i < 4; ++i) {
-    tracked_marker->patch.coordinates(i, 0) = x2[i] + tracked_origin[0];
-    tracked_marker->patch.coordinates(i, 1) = y2[i] + tracked_origin[1];
+    tracked_marker->patch.coordinates(i, 0) = (x2[i] + tracked_origin[0]) * scale;
+    tracked_marker->patch.coordinates(i, 1) = (y2[i] + tracked_origin[1]) * scale;
   }
-  tracked_marker->center(0) = x2[4] + tracked_origin[0];
-  tracked_marker->center(1) = y2[4] + tracked_origin[1];
+  tracked_marker->center(0) = (x2[4] + tracked_origin[0]) * scale;
+  tracked_marker->center(1) = (y2[4] + tracked_origin[1]) * scale;
+
+  // Release the images and masks from the accessor cache.
+  frame_accessor->ReleaseImage(reference_key);
+  frame_accessor->ReleaseImage(tracked_key);
+
+  if (reference_mask) {
+      frame_accessor->ReleaseImage(reference_mask_key);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool AutoTrack::TrackMarker(Marker* tracked_marker,
+                            TrackRegionResult* result,
+                            KalmanFilterState* predictionState,
+                            const TrackRegionOptions* track_options,
+                            int num_pyramid_levels) {
+    
+  // Try to predict the location of the second marker.
+    bool predicted_position;
+    if (predictionState) {
+        predicted_position = predictionState->PredictForward(tracked_marker->frame, tracked_marker);
+    } else {
+        predicted_position = PredictMarkerPosition(tracks_, tracked_marker);
+    }
+  if (predicted_position) {
+    LG << "Succesfully predicted!";
+  } else {
+    LG << "Prediction failed; trying to track anyway.";
+  }
+
+  Marker reference_marker;
+  tracks_.GetMarker(tracked_marker->reference_clip,
+                    tracked_marker->reference_frame,
+                    tracked_marker->track,
+                    &reference_marker);
+
+  // Store original position befoer tracking, so we can claculate offset later.
+  Vec2f original_center = tracked_marker->center;
+
+  TrackRegionOptions local_track_region_options;
+  if (track_options) {
+    local_track_region_options = *track_options;
+  }
+  local_track_region_options.num_extra_points = 1;  // For center point.
+  local_track_region_options.attempt_refine_before_brute = predicted_position;
+
+  // Track coarse-to-fine: the whole search region is only searched at the
+  // coarsest level, each finer level refines the position found at the coarser
+  // level in a small search region around it.
+  Marker level_marker = *tracked_marker;
+  int num_levels = NumPyramidLevelsForMarker(reference_marker, num_pyramid_levels);
+  bool coarse_track_ok = true;
+  for (int level = num_levels - 1; level > 0 && coarse_track_ok; --level) {
+    if (level < num_levels - 1) {
+      SetSearchRegionAroundPattern(&level_marker, level);
+    }
+    TrackRegionOptions level_options = local_track_region_options;
+    level_options.attempt_refine_before_brute =
+        level < num_levels - 1 || predicted_position;
+    coarse_track_ok = TrackMarkerAtLevel(frame_accessor_,
+                                         reference_marker,
+                                         &level_marker,
+                                         level,
+                                         level_options,
+                                         result) &&
+                      result->is_usable();
+  }
+  if (num_levels > 1) {
+    if (coarse_track_ok) {
+      SetSearchRegionAroundPattern(&level_marker, 0);
+      local_track_region_options.attempt_refine_before_brute = true;
+    } else {
+      // Fallback to the whole search region at full resolution.
+      LG << "Coarse tracking failed for marker: " << *tracked_marker;
+      level_marker = *tracked_marker;
+    }
+  }
+
+  if (!TrackMarkerAtLevel(frame_accessor_,
+                          reference_marker,
+                          &level_marker,
+                          0,
+                          local_track_region_options,
+                          result)) {
+    return false;
+  }
+
+  // Copy results over the tracked marker.
+  tracked_marker->patch = level_marker.patch;
+  tracked_marker->center = level_marker.center;
   Vec2f delta = tracked_marker->center - original_center;
   tracked_marker->search_region.Offset(delta);
   tracked_marker->source = Marker::TRACKED;
@@ -281,14 +423,6 @@ bool AutoTrack::TrackMarker(Marker* tracked_marker,
   tracked_marker->reference_clip  = reference_marker.clip;
   tracked_marker->reference_frame = reference_marker.frame;
 
-  // Release the images and masks from the accessor cache.
-  frame_accessor_->ReleaseImage(reference_key);
-  frame_accessor_->ReleaseImage(tracked_key);
-
-  if (reference_mask) {
-      frame_accessor_->ReleaseImage(reference_mask_key);
-  }
-
   // Update the kalman filter with the new measurement
   if (predictionState && result->is_usable()) {
     predictionState->Update(*tracked_marker);
@@ -89,10 +89,17 @@ class AutoTrack {
 
   // Find the marker for the track in the frame indicated by the marker.
   // Caller maintains ownership of *result and *tracked_marker.
+  //
+  // If num_pyramid_levels is greater than 1, the marker is tracked
+  // coarse-to-fine: the search region is only searched on the images
+  // downscaled by 2^(num_pyramid_levels - 1), each finer level refines the
+  // position in a small region around it. Fewer levels are used if the pattern
+  // would get too small.
   bool TrackMarker(Marker* tracked_marker,
                    TrackRegionResult* result,
                    KalmanFilterState* predictionState = NULL,
-                   const TrackRegionOptions* track_options=NULL);
+                   const TrackRegionOptions* track_options=NULL,
+                   int num_pyramid_levels = 1);
 
   // Wrapper around Tracks API; however these may add additional processing.
   void AddMarker(const Marker& tracked_marker);
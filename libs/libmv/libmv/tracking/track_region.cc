@@ -142,7 +142,8 @@ TrackRegionOptions::TrackRegionOptions()
       num_extra_points(0),
       regularization_coefficient(0.0),
       minimum_corner_shift_tolerance_pixels(0.005),
-      image1_mask(NULL) {
+      image1_mask(NULL),
+      brute_matcher(NULL) {
 }
 
 namespace {
@@ -1226,6 +1227,7 @@ bool BruteTranslationOnlyInitialize(const FloatImage &image1,
                                     const FloatImage &image2,
                                     const int num_extra_points,
                                     const bool use_normalized_intensities,
+                                    BruteTranslationMatcher *brute_matcher,
                                     const double *x1, const double *y1,
                                     double *x2, double *y2) {
   // Create the pattern to match in the space of image2, assuming our inital
@@ -1267,8 +1269,19 @@ bool BruteTranslationOnlyInitialize(const FloatImage &image1,
   int best_c = -1;
   int w = pattern.cols();
   int h = pattern.rows();
+  bool matched = brute_matcher &&
+                 brute_matcher->FindBestTranslation(pattern.data(),
+                                                    mask.data(),
+                                                    w, h,
+                                                    mask_sum,
+                                                    use_normalized_intensities,
+                                                    image2,
+                                                    &best_c, &best_r);
+
+  // Nothing left to search on the CPU if the matcher found the shift.
+  const int num_rows = matched ? 0 : (image2.Height() - h);
   libmv_pragma_openmp(for)
-  for (int r = 0; r < (image2.Height() - h); ++r) {
+  for (int r = 0; r < num_rows; ++r) {
     int best_r_line = -1;
     int best_c_line = -1;
     double best_sad_line = std::numeric_limits<double>::max();
@@ -1424,6 +1437,7 @@ void TemplatedTrackRegion(const FloatImage &image1,
         image2,
         options.num_extra_points,
         options.use_normalized_intensities,
+        options.brute_matcher,
         x1, y1, x2, y2);
     if (!found_any_alignment) {
       LG << "Brute failed to find an alignment; pattern too small. "
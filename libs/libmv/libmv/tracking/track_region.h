@@ -29,6 +29,35 @@
 
 namespace libmv {
 
+// Brute-force translation search that may be provided by the caller, e.g. to
+// run it on the GPU. The refinement is always done on the CPU.
+class BruteTranslationMatcher {
+ public:
+  virtual ~BruteTranslationMatcher() {}
+
+  // Finds the position (best_c, best_r) in search_image of the top-left corner
+  // of the block minimizing the masked sum of absolute differences with the
+  // pattern, trying all the positions where the pattern fits, like the CPU
+  // brute initialization does.
+  //
+  // The pattern and mask are row-major arrays of pattern_width x
+  // pattern_height values. If use_normalized_intensities is true, the pattern
+  // is already premultiplied by the inverse of its mean and each block must
+  // be multiplied by mask_sum / (mask * block).sum() before the difference.
+  //
+  // Returns false if the search could not be done, in which case it is done
+  // on the CPU.
+  virtual bool FindBestTranslation(const float *pattern,
+                                   const float *mask,
+                                   int pattern_width,
+                                   int pattern_height,
+                                   double mask_sum,
+                                   bool use_normalized_intensities,
+                                   const FloatImage &search_image,
+                                   int *best_c,
+                                   int *best_r) = 0;
+};
+
 struct TrackRegionOptions {
   TrackRegionOptions();
 
@@ -111,6 +140,10 @@ struct TrackRegionOptions {
   // image1, even though only values inside the image1 quad are examined. The
   // values must be in the range 0.0 to 0.1.
   FloatImage *image1_mask;
+
+  // If non-null, this is used for the brute-force translation search instead
+  // of the CPU implementation.
+  BruteTranslationMatcher *brute_matcher;
 };
 
 struct TrackRegionResult {